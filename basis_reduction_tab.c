@@ -43,8 +43,31 @@ struct tab_lp {
 #define GBR_is_zero(a)			    (mpq_sgn(a) == 0)
 #define GBR_numref(a)			    mpq_numref(a)
 #define GBR_denref(a)			    mpq_denref(a)
+#ifdef USE_SMALL_INT_OPT
+#define GBR_floor(a,b)							\
+	do {								\
+		mpz_fdiv_q(isl_sio_reinit_big(a),			\
+			    GBR_numref(b), GBR_denref(b));		\
+		isl_sio_try_demote(a);					\
+	} while (0)
+#define GBR_ceil(a,b)							\
+	do {								\
+		mpz_cdiv_q(isl_sio_reinit_big(a),			\
+			    GBR_numref(b), GBR_denref(b));		\
+		isl_sio_try_demote(a);					\
+	} while (0)
+#define GBR_set_num_neg(a,b)						\
+	do {								\
+		isl_sio_get_mpz(GBR_numref(*a), *(b));			\
+		mpz_neg(GBR_numref(*a), GBR_numref(*a));		\
+	} while (0)
+#define GBR_set_den(a,b)		    isl_sio_get_mpz(GBR_denref(*a), *(b))
+#else
 #define GBR_floor(a,b)			    mpz_fdiv_q(a,GBR_numref(b),GBR_denref(b))
 #define GBR_ceil(a,b)			    mpz_cdiv_q(a,GBR_numref(b),GBR_denref(b))
+#define GBR_set_num_neg(a,b)		    isl_int_neg(GBR_numref(*a),b)
+#define GBR_set_den(a,b)		    isl_int_set(GBR_denref(*a),b)
+#endif /* USE_SMALL_INT_OPT */
 #endif /* USE_GMP_FOR_MP */
 
 #ifdef USE_IMATH_FOR_MP
@@ -62,6 +85,8 @@ struct tab_lp {
 #define GBR_denref(a)			    mp_rat_denom_ref(a)
 #define GBR_floor(a,b)			    impz_fdiv_q(a,GBR_numref(b),GBR_denref(b))
 #define GBR_ceil(a,b)			    impz_cdiv_q(a,GBR_numref(b),GBR_denref(b))
+#define GBR_set_num_neg(a,b)		    isl_int_neg(GBR_numref(*a),b)
+#define GBR_set_den(a,b)		    isl_int_set(GBR_denref(*a),b)
 #endif /* USE_IMATH_FOR_MP */
 
 static struct tab_lp *init_lp(struct isl_tab *tab);
@@ -219,8 +244,8 @@ static int cut_lp_to_hyperplane(struct tab_lp *lp, isl_int *row)
 
 static void get_obj_val(struct tab_lp* lp, GBR_type *F)
 {
-	isl_int_neg(GBR_numref(*F), lp->opt);
-	isl_int_set(GBR_denref(*F), lp->opt_denom);
+	GBR_set_num_neg(F, lp->opt);
+	GBR_set_den(F, lp->opt_denom);
 }
 
 static void delete_lp(struct tab_lp *lp)
@@ -256,8 +281,8 @@ static int add_lp_row(struct tab_lp *lp, isl_int *row, int dim)
 static void get_alpha(struct tab_lp* lp, int row, GBR_type *alpha)
 {
 	row += lp->con_offset;
-	isl_int_neg(GBR_numref(*alpha), lp->tab->dual->el[1 + row]);
-	isl_int_set(GBR_denref(*alpha), lp->tab->dual->el[0]);
+	GBR_set_num_neg(alpha, lp->tab->dual->el[1 + row]);
+	GBR_set_den(alpha, lp->tab->dual->el[0]);
 }
 
 static int del_lp_row(struct tab_lp *lp)
@@ -11,11 +11,277 @@
  */
 
 #include <stdlib.h>
+#include <math.h>
 #include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl_vec_private.h>
 #include <isl_options_private.h>
 #include "isl_basis_reduction.h"
+#include <isl_seq.h>
+
+/* The maximal absolute value of a basis coefficient for which
+ * the floating point pre-reduction below is performed.
+ * Beyond this value, the floating point computations are considered
+ * to be too inaccurate to be useful.
+ */
+#define GBR_LLL_MAX	1e12
+
+/* The maximal number of iterations of the floating point pre-reduction
+ * per basis vector.
+ */
+#define GBR_LLL_ITER	50
+
+/* Compute the matrix G (of size "dim" x "dim") of a quadratic form
+ * such that sqrt(c^T G c) approximates the width of the set
+ * represented by "tab" in direction c.
+ *
+ * In particular, G is the inverse of
+ *
+ *	H = sum_i a_i a_i^T / (s_i + 1)^2
+ *
+ * with a_i the linear parts of the constraints of tab->bmap and s_i
+ * the values of these constraints at the current sample value of "tab".
+ * The ellipsoid x^T H x <= 1 approximates the shape of the set,
+ * with constraints that are close to the sample value
+ * having the largest impact.
+ *
+ * Return 0 if G could be computed and -1 otherwise, e.g.,
+ * if the constraints are not tracked or if H is (numerically) singular.
+ */
+static int lll_width_form(struct isl_tab *tab, double *G)
+{
+	int i, j, k, n;
+	unsigned dim = tab->n_var;
+	isl_basic_map *bmap = tab->bmap;
+	struct isl_vec *sample;
+	double *H = NULL, *a = NULL;
+	double den, max = 0;
+	int r = -1;
+
+	if (!bmap || isl_basic_map_total_dim(bmap) != dim)
+		return -1;
+	sample = isl_tab_get_sample_value(tab);
+	H = isl_alloc_array(tab->mat->ctx, double, dim * dim);
+	a = isl_alloc_array(tab->mat->ctx, double, 1 + dim);
+	if (!sample || !H || !a)
+		goto done;
+
+	for (i = 0; i < dim * dim; ++i)
+		H[i] = 0;
+	den = isl_int_get_d(sample->el[0]);
+	n = bmap->n_eq + bmap->n_ineq;
+	for (i = 0; i < n; ++i) {
+		isl_int *c;
+		double s = 0, w;
+
+		c = i < bmap->n_eq ? bmap->eq[i] : bmap->ineq[i - bmap->n_eq];
+		for (j = 0; j < 1 + dim; ++j)
+			a[j] = isl_int_get_d(c[j]);
+		for (j = 0; j < 1 + dim; ++j)
+			s += a[j] * isl_int_get_d(sample->el[j]);
+		s /= den;
+		if (i < bmap->n_eq || s < 0)
+			s = 0;
+		w = 1 / ((s + 1) * (s + 1));
+		for (j = 0; j < dim; ++j)
+			for (k = 0; k < dim; ++k)
+				H[j * dim + k] += w * a[1 + j] * a[1 + k];
+	}
+
+	for (i = 0; i < dim; ++i) {
+		for (j = 0; j < dim; ++j)
+			G[i * dim + j] = i == j;
+		if (H[i * dim + i] > max)
+			max = H[i * dim + i];
+	}
+	for (i = 0; i < dim; ++i) {
+		int pivot = i;
+		double f;
+
+		for (j = i + 1; j < dim; ++j)
+			if (fabs(H[j * dim + i]) > fabs(H[pivot * dim + i]))
+				pivot = j;
+		if (!(fabs(H[pivot * dim + i]) > 1e-12 * max))
+			goto done;
+		for (k = 0; k < dim; ++k) {
+			double t;
+			t = H[i * dim + k];
+			H[i * dim + k] = H[pivot * dim + k];
+			H[pivot * dim + k] = t;
+			t = G[i * dim + k];
+			G[i * dim + k] = G[pivot * dim + k];
+			G[pivot * dim + k] = t;
+		}
+		f = H[i * dim + i];
+		for (k = 0; k < dim; ++k) {
+			H[i * dim + k] /= f;
+			G[i * dim + k] /= f;
+		}
+		for (j = 0; j < dim; ++j) {
+			if (j == i || H[j * dim + i] == 0)
+				continue;
+			f = H[j * dim + i];
+			for (k = 0; k < dim; ++k) {
+				H[j * dim + k] -= f * H[i * dim + k];
+				G[j * dim + k] -= f * G[i * dim + k];
+			}
+		}
+	}
+	r = 0;
+done:
+	isl_vec_free(sample);
+	free(H);
+	free(a);
+	return r;
+}
+
+/* Return the inner product of "u" and "v" (of length "dim")
+ * with respect to the quadratic form "G".
+ */
+static double lll_dot(double *G, double *u, double *v, unsigned dim)
+{
+	int i, j;
+	double s = 0;
+
+	for (i = 0; i < dim; ++i) {
+		double t = 0;
+		for (j = 0; j < dim; ++j)
+			t += G[i * dim + j] * v[j];
+		s += u[i] * t;
+	}
+	return s;
+}
+
+/* Compute the Gram-Schmidt coefficients "mu" and the squared norms "N"
+ * of the Gram-Schmidt vectors of rows "first" up to and including "last"
+ * of the basis "B" of the tableau with respect to the quadratic form "G".
+ * "b" and "bs" are scratch space for the (floating point) basis vectors
+ * and the Gram-Schmidt vectors.  All arrays are indexed by row.
+ */
+static void lll_gram_schmidt(struct isl_mat *B, double *G, int first, int last,
+	unsigned dim, double *b, double *bs, double *mu, double *N, int n)
+{
+	int i, j, k;
+
+	for (i = first; i <= last; ++i)
+		for (k = 0; k < dim; ++k)
+			b[i * dim + k] = isl_int_get_d(B->row[1 + i][1 + k]);
+	for (i = first; i <= last; ++i) {
+		for (k = 0; k < dim; ++k)
+			bs[i * dim + k] = b[i * dim + k];
+		for (j = first; j < i; ++j) {
+			double m = 0;
+			if (N[j] > 0)
+				m = lll_dot(G, b + i * dim, bs + j * dim, dim) /
+					N[j];
+			mu[i * n + j] = m;
+			for (k = 0; k < dim; ++k)
+				bs[i * dim + k] -= m * bs[j * dim + k];
+		}
+		N[i] = lll_dot(G, bs + i * dim, bs + i * dim, dim);
+	}
+}
+
+/* Is any of the coefficients of row "row" of "B" too large
+ * for the floating point pre-reduction?
+ */
+static int lll_too_large(struct isl_mat *B, int row, unsigned dim)
+{
+	int k;
+
+	for (k = 0; k < dim; ++k)
+		if (fabs(isl_int_get_d(B->row[1 + row][1 + k])) > GBR_LLL_MAX)
+			return 1;
+	return 0;
+}
+
+/* Perform a cheap pre-reduction of rows "first" up to (but not including)
+ * "last" of tab->basis, before the exact generalized basis reduction.
+ *
+ * The exact reduction measures the width of the set in a direction
+ * by solving LPs.  Here, the width is approximated by the norm
+ * derived from the quadratic form computed by lll_width_form
+ * and the rows are reduced using the LLL algorithm (with delta = 3/4)
+ * with respect to this norm, in floating point arithmetic.
+ * Only the Gram-Schmidt computations are performed in floating point.
+ * The basis itself is updated using exact integer row operations,
+ * such that it remains unimodular, whatever the accuracy of
+ * the floating point computations.
+ * The pre-reduction is stopped (keeping the basis computed so far)
+ * when the coefficients become too large or when too many
+ * iterations have been performed.
+ *
+ * The exact reduction then starts from a basis that
+ * is usually close to reduced and therefore needs fewer LPs.
+ */
+static void lll_pre_reduce(struct isl_tab *tab, int first, int last)
+{
+	isl_ctx *ctx = tab->mat->ctx;
+	struct isl_mat *B = tab->basis;
+	unsigned dim = tab->n_var;
+	int n = last;
+	int i, j, k, iter;
+	double *G, *b, *bs, *mu, *N;
+	isl_int q;
+
+	if (last - first < 2)
+		return;
+
+	G = isl_alloc_array(ctx, double, dim * dim);
+	b = isl_alloc_array(ctx, double, n * dim);
+	bs = isl_alloc_array(ctx, double, n * dim);
+	mu = isl_alloc_array(ctx, double, n * n);
+	N = isl_alloc_array(ctx, double, n);
+	if (!G || !b || !bs || !mu || !N)
+		goto done;
+	if (lll_width_form(tab, G) < 0)
+		goto done;
+	for (i = first; i < last; ++i)
+		if (lll_too_large(B, i, dim))
+			goto done;
+
+	isl_int_init(q);
+	k = first + 1;
+	for (iter = 0; k < last && iter < GBR_LLL_ITER * (last - first);
+	     ++iter) {
+		lll_gram_schmidt(B, G, first, k, dim, b, bs, mu, N, n);
+		for (j = k - 1; j >= first; --j) {
+			double m = floor(mu[k * n + j] + 0.5);
+
+			if (m == 0)
+				continue;
+			isl_int_set_si(q, (long) m);
+			isl_int_neg(q, q);
+			isl_seq_combine(B->row[1 + k] + 1, ctx->one,
+				B->row[1 + k] + 1, q, B->row[1 + j] + 1, dim);
+			for (i = first; i < j; ++i)
+				mu[k * n + i] -= m * mu[j * n + i];
+			mu[k * n + j] -= m;
+		}
+		if (lll_too_large(B, k, dim))
+			break;
+		lll_gram_schmidt(B, G, first, k, dim, b, bs, mu, N, n);
+		if (N[k] >= (0.75 - mu[k * n + k - 1] * mu[k * n + k - 1]) *
+				N[k - 1]) {
+			++k;
+			continue;
+		}
+		B = isl_mat_swap_rows(B, 1 + k, 1 + k - 1);
+		if (!B)
+			break;
+		tab->basis = B;
+		ctx->stats->gbr_lll_swaps++;
+		if (k > first + 1)
+			--k;
+	}
+	isl_int_clear(q);
+done:
+	free(G);
+	free(b);
+	free(bs);
+	free(mu);
+	free(N);
+}
 
 static void save_alpha(GBR_LP *lp, int first, int n, GBR_type *alpha)
 {
@@ -91,6 +357,13 @@ struct isl_tab *isl_tab_compute_reduced_basis(struct isl_tab *tab)
 	if (n_bounded <= tab->n_zero + 1)
 		return tab;
 
+	if (ctx->opt->gbr_lll) {
+		lll_pre_reduce(tab, tab->n_zero, n_bounded);
+		B = tab->basis;
+		if (!B)
+			return tab;
+	}
+
 	isl_int_init(tmp);
 	isl_int_init(mu[0]);
 	isl_int_init(mu[1]);
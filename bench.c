@@ -0,0 +1,1058 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+/* This program measures the performance of isl on a collection
+ * of input files.
+ *
+ * The kind of computation that is performed on an input file
+ * depends on its extension.
+ * - ".in": AST generation, as in isl_codegen
+ * - ".pip": parametric integer programming, as in isl_pip
+ * - ".pwqp": bound computation, as in isl_bound
+ *
+ * Each input is processed "repeat" times, each time in a fresh isl_ctx.
+ * For each input, a line is printed with the name of the input,
+ * the minimal and median wall-clock time (in microseconds),
+ * the number of operations and the peak memory usage (in bytes)
+ * of the integers allocated by the isl_ctx.
+ * The operation counts and memory usage are the same for every run.
+ * Arguments without an extension are interpreted as the names
+ * of microbenchmarks (see "micro" below) that each exercise
+ * a single subsystem on randomly generated inputs.
+ *
+ * The output can be used as a baseline for later runs,
+ * in which case the times and operation counts are also printed
+ * relative to those in the baseline.
+ *
+ * If the --codegen-variants option is set, then each ".in" input
+ * is processed under each of the option combinations in
+ * "codegen_variants" below, and the name of the variant is appended
+ * to the name of the input, separated by an "@".
+ * If the --csv option is set, then the measurements are also written
+ * to the given file in CSV format, including the number of nodes
+ * in the generated AST, if any.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <isl_ctx_private.h>
+#include <isl_map_private.h>
+#include <isl/aff.h>
+#include <isl/ast.h>
+#include <isl/ast_build.h>
+#include <isl/constraint.h>
+#include <isl/lp.h>
+#include <isl/options.h>
+#include <isl/polynomial.h>
+#include <isl/printer.h>
+#include <isl/set.h>
+#include <isl/stream.h>
+#include <isl/val.h>
+
+struct options {
+	int	 repeat;
+	char	*baseline;
+
+	int	 dim;
+	int	 n_con;
+	int	 coef_bits;
+	int	 n_disjunct;
+	int	 iterations;
+	int	 seed;
+
+	int	 codegen_variants;
+	int	 max_pieces;
+	char	*csv;
+};
+
+ISL_ARGS_START(struct options, options_args)
+ISL_ARG_INT(struct options, repeat, 'r', "repeat", "n", 5,
+	"number of times each input is processed")
+ISL_ARG_STR(struct options, baseline, 'b', "baseline", "file", NULL,
+	"output of an earlier run to compare against")
+ISL_ARG_INT(struct options, dim, 0, "dim", "n", 4,
+	"dimension of the random sets of the microbenchmarks")
+ISL_ARG_INT(struct options, n_con, 0, "n-constraint", "n", 8,
+	"number of random constraints per basic set")
+ISL_ARG_INT(struct options, coef_bits, 0, "coef-bits", "n", 4,
+	"number of bits of the random coefficients")
+ISL_ARG_INT(struct options, n_disjunct, 0, "n-disjunct", "n", 8,
+	"number of disjuncts of the random sets")
+ISL_ARG_INT(struct options, iterations, 0, "iterations", "n", 20,
+	"number of iterations of each microbenchmark")
+ISL_ARG_INT(struct options, seed, 0, "seed", "n", 1,
+	"seed of the random generator")
+ISL_ARG_BOOL(struct options, codegen_variants, 0, "codegen-variants", 0,
+	"process AST generation inputs under several option combinations")
+ISL_ARG_INT(struct options, max_pieces, 0, "max-pieces", "limit", 1000,
+	"value of the ast_build_max_pieces option for the option combinations")
+ISL_ARG_STR(struct options, csv, 0, "csv", "file", NULL,
+	"also write the measurements to this file in CSV format")
+ISL_ARGS_END
+
+ISL_ARG_DEF(options, struct options, options_args)
+
+/* The measurements for a single input.
+ * "time" contains the wall-clock times (in microseconds) of each run.
+ * "ast_size" is the number of nodes in the generated AST
+ * or -1 if the input is not an AST generation input.
+ */
+struct measurement {
+	double *time;
+	unsigned long operations;
+	long peak_memory;
+	int ast_size;
+};
+
+/* A combination of AST generation options.
+ * If "option" is not NULL, then it is the name of an AST generation option
+ * ("atomic", "separate" or "unroll") that is applied to the schedule
+ * domain, replacing any "atomic", "separate" or "unroll"
+ * options in the input.
+ * If "innermost" is set, then the option is only applied to
+ * the innermost schedule dimension.  Otherwise, it is applied
+ * to all schedule dimensions.
+ * Unrolling all schedule dimensions can make the AST explode,
+ * so "unroll" is only applied to the innermost schedule dimension.
+ * "exploit_nested_bounds" is the value of the
+ * ast_build_exploit_nested_bounds option.
+ */
+struct codegen_variant {
+	const char *name;
+	const char *option;
+	int innermost;
+	int exploit_nested_bounds;
+};
+
+static struct codegen_variant codegen_variants[] = {
+	{ "default", NULL, 0, 1 },
+	{ "atomic", "atomic", 0, 1 },
+	{ "separate", "separate", 0, 1 },
+	{ "unroll", "unroll", 1, 1 },
+	{ "default-no-nested", NULL, 0, 0 },
+	{ "atomic-no-nested", "atomic", 0, 0 },
+	{ "separate-no-nested", "separate", 0, 0 },
+	{ "unroll-no-nested", "unroll", 1, 0 },
+};
+
+/* Return a universal, 1-dimensional set with the given name.
+ */
+static __isl_give isl_set *universe(isl_ctx *ctx, const char *name)
+{
+	isl_space *space;
+
+	space = isl_space_set_alloc(ctx, 0, 1);
+	space = isl_space_set_tuple_name(space, isl_dim_set, name);
+	return isl_set_universe(space);
+}
+
+/* Update *user to the maximum of its current value and
+ * the number of output dimensions of "map".
+ */
+static int update_max_out(__isl_take isl_map *map, void *user)
+{
+	int *n = user;
+	int n_out = isl_map_dim(map, isl_dim_out);
+
+	if (n_out > *n)
+		*n = n_out;
+	isl_map_free(map);
+
+	return 0;
+}
+
+/* Replace the "atomic", "separate" and "unroll" options in "opt"
+ * by the option described by "variant" on the domain of "schedule"
+ * (see codegen.c).
+ */
+static __isl_give isl_union_map *set_variant_option(
+	__isl_take isl_union_map *opt, __isl_keep isl_union_map *schedule,
+	struct codegen_variant *variant)
+{
+	isl_ctx *ctx = isl_union_map_get_ctx(opt);
+	isl_union_set *domain;
+	isl_set *target;
+
+	opt = isl_union_map_subtract_range(opt,
+			    isl_union_set_from_set(universe(ctx, "atomic")));
+	opt = isl_union_map_subtract_range(opt,
+			    isl_union_set_from_set(universe(ctx, "separate")));
+	opt = isl_union_map_subtract_range(opt,
+			    isl_union_set_from_set(universe(ctx, "unroll")));
+
+	target = universe(ctx, variant->option);
+	if (variant->innermost) {
+		int n = 0;
+
+		if (isl_union_map_foreach_map(schedule,
+						&update_max_out, &n) < 0)
+			target = isl_set_free(target);
+		target = isl_set_fix_si(target, isl_dim_set, 0, n - 1);
+	}
+
+	domain = isl_union_map_range(isl_union_map_copy(schedule));
+	domain = isl_union_set_universe(domain);
+	opt = isl_union_map_union(opt,
+		isl_union_map_from_domain_and_range(domain,
+					    isl_union_set_from_set(target)));
+
+	return opt;
+}
+
+/* Return the number of nodes in "node" or -1 on error.
+ */
+static int ast_size(__isl_keep isl_ast_node *node)
+{
+	int i, n, size;
+	isl_ast_node *child;
+	isl_ast_node_list *list;
+
+	switch (isl_ast_node_get_type(node)) {
+	case isl_ast_node_for:
+		child = isl_ast_node_for_get_body(node);
+		size = ast_size(child);
+		isl_ast_node_free(child);
+		return size < 0 ? -1 : 1 + size;
+	case isl_ast_node_if:
+		child = isl_ast_node_if_get_then(node);
+		size = ast_size(child);
+		isl_ast_node_free(child);
+		if (size >= 0 && isl_ast_node_if_has_else(node)) {
+			child = isl_ast_node_if_get_else(node);
+			n = ast_size(child);
+			isl_ast_node_free(child);
+			size = n < 0 ? -1 : size + n;
+		}
+		return size < 0 ? -1 : 1 + size;
+	case isl_ast_node_block:
+		list = isl_ast_node_block_get_children(node);
+		n = isl_ast_node_list_n_ast_node(list);
+		size = list ? 1 : -1;
+		for (i = 0; size >= 0 && i < n; ++i) {
+			int child_size;
+
+			child = isl_ast_node_list_get_ast_node(list, i);
+			child_size = ast_size(child);
+			isl_ast_node_free(child);
+			size = child_size < 0 ? -1 : size + child_size;
+		}
+		isl_ast_node_list_free(list);
+		return size;
+	case isl_ast_node_user:
+		return 1;
+	case isl_ast_node_error:
+		break;
+	}
+
+	return -1;
+}
+
+/* Generate an AST from the schedule, context and options in "file"
+ * (see codegen.c), taking into account "variant", if any, and
+ * store the number of nodes in the AST in m->ast_size.
+ */
+static int run_codegen(isl_ctx *ctx, FILE *file,
+	struct codegen_variant *variant, struct measurement *m)
+{
+	isl_set *context;
+	isl_union_map *schedule, *options_map;
+	isl_ast_build *build;
+	isl_ast_node *tree;
+
+	schedule = isl_union_map_read_from_file(ctx, file);
+	context = isl_set_read_from_file(ctx, file);
+	options_map = isl_union_map_read_from_file(ctx, file);
+
+	if (variant && variant->option)
+		options_map = set_variant_option(options_map, schedule, variant);
+
+	build = isl_ast_build_from_context(context);
+	build = isl_ast_build_set_options(build, options_map);
+	tree = isl_ast_build_ast_from_schedule(build, schedule);
+	isl_ast_build_free(build);
+
+	m->ast_size = tree ? ast_size(tree) : -1;
+	isl_ast_node_free(tree);
+	return tree ? 0 : -1;
+}
+
+/* Solve the parametric integer programming problem in "file"
+ * (see pip.c).
+ */
+static int run_pip(isl_ctx *ctx, FILE *file,
+	struct codegen_variant *variant, struct measurement *m)
+{
+	isl_basic_set *context, *bset;
+	isl_set *set, *empty;
+	char s[1024];
+	int neg_one;
+	int max = 0;
+	int urs_parms = 0;
+	int urs_unknowns = 0;
+	int nparam;
+
+	context = isl_basic_set_read_from_file(ctx, file);
+	if (fscanf(file, "%d", &neg_one) != 1 || neg_one != -1) {
+		isl_basic_set_free(context);
+		return -1;
+	}
+	bset = isl_basic_set_read_from_file(ctx, file);
+
+	while (fgets(s, sizeof(s), file)) {
+		if (strncasecmp(s, "Maximize", 8) == 0)
+			max = 1;
+		if (strncasecmp(s, "Rational", 8) == 0)
+			bset = isl_basic_set_set_rational(bset);
+		if (strncasecmp(s, "Urs_parms", 9) == 0)
+			urs_parms = 1;
+		if (strncasecmp(s, "Urs_unknowns", 12) == 0)
+			urs_unknowns = 1;
+	}
+	if (!urs_parms)
+		context = isl_basic_set_intersect(context,
+		isl_basic_set_positive_orthant(isl_basic_set_get_space(context)));
+	context = isl_basic_set_move_dims(context, isl_dim_param, 0,
+		    isl_dim_set, 0, isl_basic_set_dim(context, isl_dim_set));
+	context = isl_basic_set_params(context);
+	nparam = isl_basic_set_dim(context, isl_dim_param);
+	if (nparam != isl_basic_set_dim(bset, isl_dim_param)) {
+		int dim = isl_basic_set_dim(bset, isl_dim_set);
+		bset = isl_basic_set_move_dims(bset, isl_dim_param, 0,
+					    isl_dim_set, dim - nparam, nparam);
+	}
+	if (!urs_unknowns)
+		bset = isl_basic_set_intersect(bset,
+		isl_basic_set_positive_orthant(isl_basic_set_get_space(bset)));
+
+	if (max)
+		set = isl_basic_set_partial_lexmax(bset, context, &empty);
+	else
+		set = isl_basic_set_partial_lexmin(bset, context, &empty);
+
+	isl_set_free(set);
+	isl_set_free(empty);
+	return set ? 0 : -1;
+}
+
+/* Compute a bound on the piecewise quasi-polynomial in "file"
+ * (see bound.c).
+ */
+static int run_bound(isl_ctx *ctx, FILE *file,
+	struct codegen_variant *variant, struct measurement *m)
+{
+	struct isl_stream *s;
+	struct isl_obj obj;
+	isl_pw_qpolynomial_fold *pwf;
+	int exact;
+
+	s = isl_stream_new_file(ctx, file);
+	obj = isl_stream_read_obj(s);
+	isl_stream_free(s);
+	if (obj.type == isl_obj_pw_qpolynomial)
+		pwf = isl_pw_qpolynomial_fold_from_pw_qpolynomial(isl_fold_max,
+								  obj.v);
+	else if (obj.type == isl_obj_pw_qpolynomial_fold)
+		pwf = obj.v;
+	else {
+		if (obj.v)
+			obj.type->free(obj.v);
+		return -1;
+	}
+
+	pwf = isl_pw_qpolynomial_fold_bound(pwf, &exact);
+	pwf = isl_pw_qpolynomial_fold_coalesce(pwf);
+
+	isl_pw_qpolynomial_fold_free(pwf);
+	return pwf ? 0 : -1;
+}
+
+/* Return the function that processes inputs with the same extension
+ * as "name" or NULL if the extension is not recognized.
+ */
+static int (*get_runner(const char *name))(isl_ctx *ctx, FILE *file,
+	struct codegen_variant *variant, struct measurement *m)
+{
+	const char *ext = strrchr(name, '.');
+
+	if (!ext)
+		return NULL;
+	if (!strcmp(ext, ".in"))
+		return &run_codegen;
+	if (!strcmp(ext, ".pip"))
+		return &run_pip;
+	if (!strcmp(ext, ".pwqp"))
+		return &run_bound;
+	return NULL;
+}
+
+/* Process the input "name" options->repeat times,
+ * each time in a fresh isl_ctx, and store the results in "m".
+ * If "variant" is not NULL, then the input is processed
+ * under the AST generation options described by "variant",
+ * with the number of pieces generated by unrolling and separation
+ * limited by options->max_pieces.
+ * Return -1 if the input could not be processed.
+ */
+static int measure(const char *name, struct options *options,
+	struct codegen_variant *variant, struct measurement *m)
+{
+	int i;
+	int (*run)(isl_ctx *ctx, FILE *file,
+		struct codegen_variant *variant, struct measurement *m);
+
+	run = get_runner(name);
+	if (!run) {
+		fprintf(stderr, "%s: unrecognized extension\n", name);
+		return -1;
+	}
+
+	m->ast_size = -1;
+	for (i = 0; i < options->repeat; ++i) {
+		isl_ctx *ctx;
+		FILE *file;
+		double start;
+		int r;
+
+		file = fopen(name, "r");
+		if (!file) {
+			fprintf(stderr, "%s: unable to open\n", name);
+			return -1;
+		}
+		ctx = isl_ctx_alloc();
+		if (variant) {
+			isl_options_set_ast_build_exploit_nested_bounds(ctx,
+					    variant->exploit_nested_bounds);
+			isl_options_set_ast_build_max_pieces(ctx,
+					    options->max_pieces);
+		}
+		start = isl_monotonic_time();
+		r = run(ctx, file, variant, m);
+		m->time[i] = 1e6 * (isl_monotonic_time() - start);
+		m->operations = ctx->operations;
+		m->peak_memory = isl_ctx_get_stat(ctx, "peak_memory");
+		isl_ctx_free(ctx);
+		fclose(file);
+		if (r < 0) {
+			fprintf(stderr, "%s: failed\n", name);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* Return the next pseudo-random number (of 31 bits) from the generator
+ * with state "state".
+ * A fixed linear congruential generator is used instead of rand
+ * such that the same inputs are generated on every platform.
+ */
+static unsigned random_next(uint64_t *state)
+{
+	*state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+	return (unsigned) (*state >> 33);
+}
+
+/* Return a random integer with absolute value smaller than 2^bits.
+ */
+static __isl_give isl_val *random_val(isl_ctx *ctx, uint64_t *state,
+	int bits)
+{
+	isl_val *v;
+	int neg;
+
+	neg = random_next(state) & 1;
+	v = isl_val_zero(ctx);
+	while (bits > 0) {
+		int b = bits < 30 ? bits : 30;
+
+		v = isl_val_mul_ui(v, 1UL << b);
+		v = isl_val_add_ui(v, random_next(state) & ((1UL << b) - 1));
+		bits -= b;
+	}
+	if (neg)
+		v = isl_val_neg(v);
+
+	return v;
+}
+
+/* Add a random constraint to "bset" that is satisfied by
+ * the integer point "center".
+ * If "eq" is set, then the constraint is an equality.
+ * Otherwise, it is an inequality that is satisfied by "center"
+ * with some random slack.
+ */
+static __isl_give isl_basic_set *add_random_constraint(
+	__isl_take isl_basic_set *bset, int eq, int *center,
+	struct options *options, uint64_t *state)
+{
+	isl_ctx *ctx = isl_basic_set_get_ctx(bset);
+	isl_local_space *ls;
+	isl_constraint *c;
+	isl_val *cst;
+	int i;
+
+	ls = isl_local_space_from_space(isl_basic_set_get_space(bset));
+	c = eq ? isl_equality_alloc(ls) : isl_inequality_alloc(ls);
+	cst = eq ? isl_val_zero(ctx) :
+		isl_val_abs(random_val(ctx, state, options->coef_bits));
+	for (i = 0; i < options->dim; ++i) {
+		isl_val *v = random_val(ctx, state, options->coef_bits);
+
+		cst = isl_val_sub(cst, isl_val_mul(isl_val_copy(v),
+					isl_val_int_from_si(ctx, center[i])));
+		c = isl_constraint_set_coefficient_val(c, isl_dim_set, i, v);
+	}
+	c = isl_constraint_set_constant_val(c, cst);
+
+	return isl_basic_set_add_constraint(bset, c);
+}
+
+/* Return the half-width of the boxes that bound the random basic sets,
+ * i.e., 2^options->coef_bits, but at most 2^16.
+ */
+static int box_size(struct options *options)
+{
+	return 1 << (options->coef_bits < 16 ? options->coef_bits : 16);
+}
+
+/* Construct a random basic set of dimension options->dim that contains
+ * the integer point "center" and that is bounded by
+ * a box of half-width box_size(options) around "center" and
+ * options->n_con random inequality constraints.
+ * Additionally, "n_eq" random equality constraints are imposed.
+ */
+static __isl_give isl_basic_set *random_basic_set(isl_ctx *ctx,
+	int n_eq, int *center, struct options *options, uint64_t *state)
+{
+	isl_space *space;
+	isl_local_space *ls;
+	isl_basic_set *bset;
+	int i, sign;
+	int size = box_size(options);
+
+	space = isl_space_set_alloc(ctx, 0, options->dim);
+	ls = isl_local_space_from_space(isl_space_copy(space));
+	bset = isl_basic_set_universe(space);
+	for (i = 0; i < options->dim; ++i) {
+		for (sign = -1; sign <= 1; sign += 2) {
+			isl_constraint *c;
+
+			c = isl_inequality_alloc(isl_local_space_copy(ls));
+			c = isl_constraint_set_coefficient_si(c,
+							isl_dim_set, i, sign);
+			c = isl_constraint_set_constant_si(c,
+							size - sign * center[i]);
+			bset = isl_basic_set_add_constraint(bset, c);
+		}
+	}
+	isl_local_space_free(ls);
+	for (i = 0; i < n_eq; ++i)
+		bset = add_random_constraint(bset, 1, center, options, state);
+	for (i = 0; i < options->n_con; ++i)
+		bset = add_random_constraint(bset, 0, center, options, state);
+
+	return bset;
+}
+
+/* Construct the union of options->n_disjunct random basic sets
+ * with random centers that are close enough to each other
+ * for the basic sets to overlap.
+ */
+static __isl_give isl_set *random_set(isl_ctx *ctx, struct options *options,
+	uint64_t *state)
+{
+	isl_set *set;
+	int *center;
+	int i, j;
+	int size = box_size(options);
+
+	center = isl_alloc_array(ctx, int, options->dim);
+	if (options->dim && !center)
+		return NULL;
+	set = isl_set_empty(isl_space_set_alloc(ctx, 0, options->dim));
+	for (i = 0; i < options->n_disjunct; ++i) {
+		isl_basic_set *bset;
+
+		for (j = 0; j < options->dim; ++j)
+			center[j] = (int) (random_next(state) % (2 * size + 1));
+		bset = random_basic_set(ctx, 0, center, options, state);
+		set = isl_set_union(set, isl_set_from_basic_set(bset));
+	}
+	free(center);
+
+	return set;
+}
+
+/* The state of a microbenchmark.
+ * "bset", "hole" and "set" are the randomly generated inputs.
+ * "obj" are random objective functions.
+ * "str" is a textual representation of "set".
+ */
+struct micro_state {
+	isl_ctx *ctx;
+	struct options *options;
+	isl_basic_set *bset;
+	isl_basic_set *hole;
+	isl_set *set;
+	isl_aff_list *obj;
+	char *str;
+};
+
+/* Generate the inputs for the microbenchmarks.
+ * The inputs are generated for each microbenchmark separately
+ * (but deterministically) to keep the operation counts of one
+ * microbenchmark independent of those of the others.
+ */
+static struct micro_state *micro_setup(isl_ctx *ctx, struct options *options)
+{
+	struct micro_state *ms;
+	uint64_t state = options->seed;
+	isl_local_space *ls;
+	int *center;
+	int i, j;
+
+	ms = isl_calloc_type(ctx, struct micro_state);
+	center = isl_calloc_array(ctx, int, options->dim);
+	if (!ms || (options->dim && !center))
+		goto error;
+	ms->ctx = ctx;
+	ms->options = options;
+	ms->bset = random_basic_set(ctx, options->dim / 2, center, options,
+					&state);
+	ms->set = random_set(ctx, options, &state);
+	for (i = 0; i < options->dim; ++i)
+		center[i] = box_size(options);
+	ms->hole = random_basic_set(ctx, 0, center, options, &state);
+	ms->obj = isl_aff_list_alloc(ctx, options->iterations);
+	ls = isl_local_space_from_space(isl_space_set_alloc(ctx, 0,
+							options->dim));
+	for (i = 0; i < options->iterations; ++i) {
+		isl_aff *aff;
+
+		aff = isl_aff_zero_on_domain(isl_local_space_copy(ls));
+		for (j = 0; j < options->dim; ++j)
+			aff = isl_aff_set_coefficient_val(aff, isl_dim_in, j,
+			    random_val(ctx, &state, options->coef_bits));
+		ms->obj = isl_aff_list_add(ms->obj, aff);
+	}
+	isl_local_space_free(ls);
+	ms->str = isl_set_to_str(ms->set);
+	free(center);
+	if (!ms->bset || !ms->hole || !ms->set || !ms->obj || !ms->str)
+		goto error;
+
+	return ms;
+error:
+	free(center);
+	if (ms) {
+		isl_basic_set_free(ms->bset);
+		isl_basic_set_free(ms->hole);
+		isl_set_free(ms->set);
+		isl_aff_list_free(ms->obj);
+		free(ms->str);
+		free(ms);
+	}
+	return NULL;
+}
+
+static void micro_free(struct micro_state *ms)
+{
+	if (!ms)
+		return;
+	isl_basic_set_free(ms->bset);
+	isl_basic_set_free(ms->hole);
+	isl_set_free(ms->set);
+	isl_aff_list_free(ms->obj);
+	free(ms->str);
+	free(ms);
+}
+
+/* Solve LP relaxations over the random basic set
+ * for each of the random objective functions,
+ * exercising mainly the pivoting of the tableaus.
+ */
+static int micro_lp(struct micro_state *ms)
+{
+	int i;
+
+	for (i = 0; i < ms->options->iterations; ++i) {
+		isl_aff *obj;
+		isl_val *v;
+
+		obj = isl_aff_list_get_aff(ms->obj, i);
+		v = isl_basic_set_max_lp_val(ms->bset, obj);
+		isl_aff_free(obj);
+		isl_val_free(v);
+		if (!v)
+			return -1;
+	}
+
+	return 0;
+}
+
+/* Perform Gaussian elimination on copies of the random basic set,
+ * which has options->dim / 2 equality constraints.
+ */
+static int micro_gauss(struct micro_state *ms)
+{
+	int i;
+
+	for (i = 0; i < ms->options->iterations; ++i) {
+		isl_basic_set *bset;
+
+		bset = isl_basic_set_dup(ms->bset);
+		bset = isl_basic_set_gauss(bset, NULL);
+		isl_basic_set_free(bset);
+		if (!bset)
+			return -1;
+	}
+
+	return 0;
+}
+
+/* Coalesce the random set.
+ */
+static int micro_coalesce(struct micro_state *ms)
+{
+	int i;
+
+	for (i = 0; i < ms->options->iterations; ++i) {
+		isl_set *set;
+
+		set = isl_set_coalesce(isl_set_copy(ms->set));
+		isl_set_free(set);
+		if (!set)
+			return -1;
+	}
+
+	return 0;
+}
+
+/* Subtract a random basic set from the middle of the random set.
+ */
+static int micro_subtract(struct micro_state *ms)
+{
+	int i;
+
+	for (i = 0; i < ms->options->iterations; ++i) {
+		isl_set *set;
+
+		set = isl_set_subtract(isl_set_copy(ms->set),
+			    isl_set_from_basic_set(isl_basic_set_copy(ms->hole)));
+		isl_set_free(set);
+		if (!set)
+			return -1;
+	}
+
+	return 0;
+}
+
+/* Parse the textual representation of the random set.
+ */
+static int micro_parse(struct micro_state *ms)
+{
+	int i;
+
+	for (i = 0; i < ms->options->iterations; ++i) {
+		isl_set *set;
+
+		set = isl_set_read_from_str(ms->ctx, ms->str);
+		isl_set_free(set);
+		if (!set)
+			return -1;
+	}
+
+	return 0;
+}
+
+/* Print the random set to a string.
+ */
+static int micro_print(struct micro_state *ms)
+{
+	int i;
+
+	for (i = 0; i < ms->options->iterations; ++i) {
+		isl_printer *p;
+		char *str;
+
+		p = isl_printer_to_str(ms->ctx);
+		p = isl_printer_print_set(p, ms->set);
+		str = isl_printer_get_str(p);
+		isl_printer_free(p);
+		free(str);
+		if (!str)
+			return -1;
+	}
+
+	return 0;
+}
+
+/* The microbenchmarks, each exercising a single subsystem.
+ */
+static struct {
+	const char *name;
+	int (*run)(struct micro_state *ms);
+} micro[] = {
+	{ "lp", &micro_lp },
+	{ "gauss", &micro_gauss },
+	{ "coalesce", &micro_coalesce },
+	{ "subtract", &micro_subtract },
+	{ "parse", &micro_parse },
+	{ "print", &micro_print },
+};
+
+/* Run the microbenchmark "name" options->repeat times,
+ * each time in a fresh isl_ctx, and store the results in "m".
+ * The generation of the inputs is not included in the measurements,
+ * except for the peak memory.
+ * Return -1 if "name" is not a microbenchmark or if it fails.
+ */
+static int measure_micro(const char *name, struct options *options,
+	struct measurement *m)
+{
+	int i, k;
+	int n = sizeof(micro) / sizeof(micro[0]);
+
+	for (k = 0; k < n; ++k)
+		if (!strcmp(micro[k].name, name))
+			break;
+	if (k >= n) {
+		fprintf(stderr, "%s: unknown microbenchmark\n", name);
+		return -1;
+	}
+
+	m->ast_size = -1;
+	for (i = 0; i < options->repeat; ++i) {
+		isl_ctx *ctx;
+		struct micro_state *ms;
+		double start;
+		int r;
+
+		ctx = isl_ctx_alloc();
+		ms = micro_setup(ctx, options);
+		isl_ctx_reset_operations(ctx);
+		start = isl_monotonic_time();
+		r = ms ? micro[k].run(ms) : -1;
+		m->time[i] = 1e6 * (isl_monotonic_time() - start);
+		m->operations = ctx->operations;
+		m->peak_memory = isl_ctx_get_stat(ctx, "peak_memory");
+		micro_free(ms);
+		isl_ctx_free(ctx);
+		if (r < 0) {
+			fprintf(stderr, "%s: failed\n", name);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double da = *(const double *) a;
+	double db = *(const double *) b;
+
+	return da < db ? -1 : da > db ? 1 : 0;
+}
+
+/* A line of the baseline output.
+ */
+struct baseline_entry {
+	char name[1024];
+	double min;
+	unsigned long operations;
+};
+
+/* Read the entries of the baseline in "filename".
+ * Lines starting with '#' are ignored.
+ * Return the number of entries or -1 on error.
+ */
+static int read_baseline(const char *filename, struct baseline_entry **entries)
+{
+	FILE *file;
+	char line[2048];
+	int n = 0, size = 0;
+
+	*entries = NULL;
+	file = fopen(filename, "r");
+	if (!file) {
+		fprintf(stderr, "%s: unable to open\n", filename);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), file)) {
+		struct baseline_entry e;
+		double median;
+
+		if (line[0] == '#')
+			continue;
+		if (sscanf(line, "%1023s %lf %lf %lu", e.name, &e.min, &median,
+			    &e.operations) != 4)
+			continue;
+		if (n >= size) {
+			struct baseline_entry *ext;
+
+			size = 2 * size + 16;
+			ext = realloc(*entries, size * sizeof(**entries));
+			if (!ext) {
+				fclose(file);
+				return -1;
+			}
+			*entries = ext;
+		}
+		(*entries)[n++] = e;
+	}
+	fclose(file);
+
+	return n;
+}
+
+/* Return the entry with name "name" among the "n" entries in "entries"
+ * or NULL if there is no such entry.
+ */
+static struct baseline_entry *find_baseline(struct baseline_entry *entries,
+	int n, const char *name)
+{
+	int i;
+
+	for (i = 0; i < n; ++i)
+		if (!strcmp(entries[i].name, name))
+			return &entries[i];
+
+	return NULL;
+}
+
+/* Print the measurements in "m" of the input "name"
+ * (processed under "variant" if it is not NULL), along with
+ * their ratios with respect to the corresponding entry of
+ * the "n_baseline" entries in "baseline", if any.
+ * If "csv" is not NULL, then also write them to "csv".
+ */
+static void report(const char *name, struct codegen_variant *variant,
+	struct measurement *m, int repeat, struct baseline_entry *baseline,
+	int n_baseline, FILE *csv)
+{
+	struct baseline_entry *base;
+	double min, median;
+	char label[1024];
+
+	if (variant)
+		snprintf(label, sizeof(label), "%s@%s", name, variant->name);
+	else
+		snprintf(label, sizeof(label), "%s", name);
+
+	qsort(m->time, repeat, sizeof(double), &cmp_double);
+	min = m->time[0];
+	median = m->time[repeat / 2];
+	printf("%s\t%.0f\t%.0f\t%lu\t%ld", label, min, median,
+		m->operations, m->peak_memory);
+	base = find_baseline(baseline, n_baseline, label);
+	if (base)
+		printf("\t%.3f\t%.3f",
+			base->min > 0 ? min / base->min : 1.0,
+			base->operations > 0 ?
+			    (double) m->operations / base->operations : 1.0);
+	printf("\n");
+	fflush(stdout);
+
+	if (!csv)
+		return;
+	fprintf(csv, "%s,%s,%.0f,%.0f,%lu,%ld,", name,
+		variant ? variant->name : "", min, median,
+		m->operations, m->peak_memory);
+	if (m->ast_size >= 0)
+		fprintf(csv, "%d", m->ast_size);
+	fprintf(csv, "\n");
+}
+
+/* Is "name" an AST generation input?
+ */
+static int is_codegen_input(const char *name)
+{
+	const char *ext = strrchr(name, '.');
+
+	return ext && !strcmp(ext, ".in");
+}
+
+int main(int argc, char **argv)
+{
+	struct options *options;
+	struct baseline_entry *baseline = NULL;
+	struct measurement m;
+	FILE *csv = NULL;
+	int n_baseline = 0;
+	int i, j, r;
+	int n_variant;
+	int failed = 0;
+
+	options = options_new_with_defaults();
+	if (!options)
+		return EXIT_FAILURE;
+	argc = options_parse(options, argc, argv, 0);
+	if (options->repeat < 1)
+		options->repeat = 1;
+	if (options->baseline) {
+		n_baseline = read_baseline(options->baseline, &baseline);
+		if (n_baseline < 0)
+			return EXIT_FAILURE;
+	}
+	if (options->csv) {
+		csv = fopen(options->csv, "w");
+		if (!csv) {
+			fprintf(stderr, "%s: unable to open\n", options->csv);
+			return EXIT_FAILURE;
+		}
+		fprintf(csv, "input,variant,min_us,median_us,operations,"
+			"peak_memory,ast_nodes\n");
+	}
+
+	m.time = malloc(options->repeat * sizeof(double));
+	if (!m.time)
+		return EXIT_FAILURE;
+
+	n_variant = sizeof(codegen_variants) / sizeof(codegen_variants[0]);
+	printf("# input\tmin_us\tmedian_us\toperations\tpeak_memory%s\n",
+		baseline ? "\ttime_ratio\toperations_ratio" : "");
+	for (i = 1; i < argc; ++i) {
+		if (argv[i][0] == '-') {
+			fprintf(stderr, "%s: unrecognized option\n", argv[i]);
+			failed = 1;
+			continue;
+		}
+		if (options->codegen_variants && is_codegen_input(argv[i])) {
+			for (j = 0; j < n_variant; ++j) {
+				struct codegen_variant *variant;
+
+				variant = &codegen_variants[j];
+				r = measure(argv[i], options, variant, &m);
+				if (r < 0) {
+					failed = 1;
+					continue;
+				}
+				report(argv[i], variant, &m, options->repeat,
+					baseline, n_baseline, csv);
+			}
+			continue;
+		}
+		if (!strchr(argv[i], '.'))
+			r = measure_micro(argv[i], options, &m);
+		else
+			r = measure(argv[i], options, NULL, &m);
+		if (r < 0) {
+			failed = 1;
+			continue;
+		}
+		report(argv[i], NULL, &m, options->repeat,
+			baseline, n_baseline, csv);
+	}
+
+	if (csv)
+		fclose(csv);
+	free(m.time);
+	free(baseline);
+	options_free(options);
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
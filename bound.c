@@ -1,4 +1,17 @@
+/* This program computes (and optionally verifies) an upper bound
+ * for each piecewise quasipolynomial (fold) read from stdin.
+ *
+ * If the isl --threads option is set to a value greater than one
+ * and --verify is not set, then the inputs are distributed over
+ * that many worker threads, each with its own isl_ctx
+ * (see isl_thread_run).
+ * The results are printed in input order.
+ * If the --time option is set, then the distribution of the time
+ * taken for each input is printed to stderr.
+ */
+
 #include <assert.h>
+#include <stdlib.h>
 #include <isl/stream.h>
 #include <isl_map_private.h>
 #include <isl_polynomial_private.h>
@@ -6,12 +19,16 @@
 #include <isl/options.h>
 #include <isl/deprecated/point_int.h>
 #include <isl/deprecated/polynomial_int.h>
+#include <isl_ctx_private.h>
+#include <isl_thread.h>
+#include "tool_latency.h"
 
 struct bound_options {
 	struct isl_options	*isl;
 	unsigned		 verify;
 	int			 print_all;
 	int			 continue_on_error;
+	unsigned		 time;
 };
 
 ISL_ARGS_START(struct bound_options, bound_options_args)
@@ -20,6 +37,8 @@ ISL_ARG_CHILD(struct bound_options, isl, "isl", &isl_options_args,
 ISL_ARG_BOOL(struct bound_options, verify, 'T', "verify", 0, NULL)
 ISL_ARG_BOOL(struct bound_options, print_all, 'A', "print-all", 0, NULL)
 ISL_ARG_BOOL(struct bound_options, continue_on_error, '\0', "continue-on-error", 0, NULL)
+ISL_ARG_BOOL(struct bound_options, time, 0, "time", 0,
+	"print per-object latency percentiles to stderr")
 ISL_ARGS_END
 
 ISL_ARG_DEF(bound_options, struct bound_options, bound_options_args)
@@ -237,25 +256,18 @@ static int check_solution(__isl_take isl_pw_qpolynomial_fold *pwf,
 	return 0;
 }
 
-int main(int argc, char **argv)
+/* Compute a bound on the object "obj" and print it to "p" or,
+ * if the --verify option is set, check it.
+ * Set "*r" to -1 if the input is invalid or if the check fails.
+ */
+static __isl_give isl_printer *bound(__isl_take isl_printer *p,
+	struct isl_obj obj, struct bound_options *options, int *r)
 {
-	isl_ctx *ctx;
+	isl_ctx *ctx = isl_printer_get_ctx(p);
 	isl_pw_qpolynomial_fold *copy;
 	isl_pw_qpolynomial_fold *pwf;
-	struct isl_stream *s;
-	struct isl_obj obj;
-	struct bound_options *options;
 	int exact;
-	int r = 0;
-
-	options = bound_options_new_with_defaults();
-	assert(options);
-	argc = bound_options_parse(options, argc, argv, ISL_ARG_ALL);
-
-	ctx = isl_ctx_alloc_with_options(&bound_options_args, options);
 
-	s = isl_stream_new_file(ctx, stdin);
-	obj = isl_stream_read_obj(s);
 	if (obj.type == isl_obj_pw_qpolynomial)
 		pwf = isl_pw_qpolynomial_fold_from_pw_qpolynomial(isl_fold_max,
 								  obj.v);
@@ -263,7 +275,8 @@ int main(int argc, char **argv)
 		pwf = obj.v;
 	else {
 		obj.type->free(obj.v);
-		isl_die(ctx, isl_error_invalid, "invalid input", goto error);
+		*r = -1;
+		isl_die(ctx, isl_error_invalid, "invalid input", return p);
 	}
 
 	if (options->verify)
@@ -273,16 +286,172 @@ int main(int argc, char **argv)
 	pwf = isl_pw_qpolynomial_fold_coalesce(pwf);
 
 	if (options->verify) {
-		r = check_solution(copy, pwf, exact, options);
+		if (check_solution(copy, pwf, exact, options) < 0)
+			*r = -1;
 	} else {
-		if (!exact)
-			printf("# NOT exact\n");
-		isl_pw_qpolynomial_fold_print(pwf, stdout, 0);
-		fprintf(stdout, "\n");
+		if (!exact) {
+			p = isl_printer_print_str(p, "# NOT exact");
+			p = isl_printer_end_line(p);
+		}
+		p = isl_printer_print_pw_qpolynomial_fold(p, pwf);
+		p = isl_printer_end_line(p);
 		isl_pw_qpolynomial_fold_free(pwf);
 	}
 
-error:
+	return p;
+}
+
+/* The objects read by read_jobs, printed to strings such that
+ * they can be parsed again in a worker isl_ctx.
+ * out[i] is the output for in[i], computed in a worker isl_ctx,
+ * and time[i] is the time this took.
+ */
+struct bound_jobs {
+	struct bound_options *options;
+	int n;
+	int size;
+	char **in;
+	char **out;
+	double *time;
+};
+
+/* Process object "i" of "user" in the isl_ctx of "worker" and
+ * keep track of the output.
+ * Since the input is a string, no objects of the isl_ctx
+ * passed to isl_thread_run are accessed.
+ */
+static int bound_job(struct isl_thread_worker *worker, int i, void *user)
+{
+	struct bound_jobs *jobs = user;
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	struct isl_stream *s;
+	isl_printer *p;
+	double start;
+	int r = 0;
+
+	start = isl_monotonic_time();
+	s = isl_stream_new_str(ctx, jobs->in[i]);
+	p = isl_printer_to_str(ctx);
+	p = bound(p, isl_stream_read_obj(s), jobs->options, &r);
+	if (r >= 0)
+		jobs->out[i] = isl_printer_get_str(p);
+	isl_printer_free(p);
+	isl_stream_free(s);
+	jobs->time[i] = isl_monotonic_time() - start;
+
+	return jobs->out[i] ? 0 : -1;
+}
+
+/* Read all objects from "s" and store them in "jobs".
+ */
+static int read_jobs(struct isl_stream *s, struct bound_jobs *jobs)
+{
+	isl_ctx *ctx = s->ctx;
+
+	do {
+		struct isl_obj obj;
+		isl_printer *p;
+		char *str;
+
+		obj = isl_stream_read_obj(s);
+		p = isl_printer_to_str(ctx);
+		if (obj.type == isl_obj_pw_qpolynomial)
+			p = isl_printer_print_pw_qpolynomial(p, obj.v);
+		else if (obj.type == isl_obj_pw_qpolynomial_fold)
+			p = isl_printer_print_pw_qpolynomial_fold(p, obj.v);
+		else
+			p = isl_printer_free(p);
+		if (obj.v)
+			obj.type->free(obj.v);
+		str = isl_printer_get_str(p);
+		isl_printer_free(p);
+		if (!str)
+			return -1;
+		if (jobs->n >= jobs->size) {
+			jobs->size = 2 * jobs->size + 16;
+			jobs->in = isl_realloc_array(ctx, jobs->in, char *,
+							jobs->size);
+			assert(jobs->in);
+		}
+		jobs->in[jobs->n++] = str;
+	} while (!isl_stream_is_empty(s));
+
+	return 0;
+}
+
+/* Read all objects from "s" and compute a bound on each of them
+ * using several threads (see isl_thread_run),
+ * printing the results in input order.
+ * Return the number of objects and store the time taken
+ * for each of them in "time".
+ * Set "*r" to -1 if any of this fails.
+ */
+static int bound_threads(struct isl_stream *s, struct bound_options *options,
+	double **time, int *r)
+{
+	int i;
+	isl_ctx *ctx = s->ctx;
+	struct bound_jobs jobs = { options };
+
+	*r = read_jobs(s, &jobs);
+	jobs.out = isl_calloc_array(ctx, char *, jobs.n);
+	jobs.time = isl_calloc_array(ctx, double, jobs.n);
+	assert(jobs.n == 0 || (jobs.out && jobs.time));
+	if (*r >= 0)
+		*r = isl_thread_run(ctx, jobs.n, &bound_job, &jobs);
+	for (i = 0; i < jobs.n; ++i) {
+		if (jobs.out[i])
+			fputs(jobs.out[i], stdout);
+		free(jobs.in[i]);
+		free(jobs.out[i]);
+	}
+	free(jobs.in);
+	free(jobs.out);
+	*time = jobs.time;
+
+	return jobs.n;
+}
+
+int main(int argc, char **argv)
+{
+	isl_ctx *ctx;
+	struct isl_stream *s;
+	struct bound_options *options;
+	double *time = NULL;
+	int n_time = 0;
+	int r = 0;
+
+	options = bound_options_new_with_defaults();
+	assert(options);
+	argc = bound_options_parse(options, argc, argv, ISL_ARG_ALL);
+
+	ctx = isl_ctx_alloc_with_options(&bound_options_args, options);
+
+	s = isl_stream_new_file(ctx, stdin);
+	if (isl_options_get_threads(ctx) > 1 && !options->verify)
+		n_time = bound_threads(s, options, &time, &r);
+	else {
+		isl_printer *p = isl_printer_to_file(ctx, stdout);
+		int size = 0;
+
+		do {
+			double start = isl_monotonic_time();
+
+			p = bound(p, isl_stream_read_obj(s), options, &r);
+			if (n_time >= size) {
+				size = 2 * size + 16;
+				time = realloc(time, size * sizeof(double));
+				assert(time);
+			}
+			time[n_time++] = isl_monotonic_time() - start;
+		} while (r >= 0 && !isl_stream_is_empty(s));
+		isl_printer_free(p);
+	}
+
+	if (options->time)
+		tool_print_latency(stderr, n_time, time);
+
+	free(time);
 	isl_stream_free(s);
 
 	isl_ctx_free(ctx);
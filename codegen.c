@@ -14,18 +14,30 @@
  * - a schedule
  * - a context
  * - a relation describing AST generation options
+ *
+ * If the --batch option is set, then the input may consist of
+ * several such triples, which are processed in turn using
+ * the same isl_ctx.  The output for each of them is terminated
+ * by a line "%%".
+ * If, moreover, the --threads option is set to a value "n"
+ * greater than one, then the inputs are read in groups of 4 * "n"
+ * and the ASTs of the inputs in each group are generated on "n" threads.
+ * The ASTs are still printed in input order.
  */
 
 #include <assert.h>
+#include <ctype.h>
 #include <isl/ast.h>
 #include <isl/ast_build.h>
 #include <isl/options.h>
 #include <isl/set.h>
+#include <isl_thread.h>
 
 struct options {
 	struct isl_options	*isl;
 	unsigned		 atomic;
 	unsigned		 separate;
+	unsigned		 batch;
 };
 
 ISL_ARGS_START(struct options, options_args)
@@ -34,6 +46,8 @@ ISL_ARG_BOOL(struct options, atomic, 0, "atomic", 0,
 	"globally set the atomic option")
 ISL_ARG_BOOL(struct options, separate, 0, "separate", 0,
 	"globally set the separate option")
+ISL_ARG_BOOL(struct options, batch, 0, "batch", 0,
+	"process a sequence of inputs")
 ISL_ARGS_END
 
 ISL_ARG_DEF(options, struct options, options_args)
@@ -100,39 +114,202 @@ static __isl_give isl_ast_build *set_options(__isl_take isl_ast_build *build,
 	return build;
 }
 
-int main(int argc, char **argv)
+/* Skip white space in "file" and return 1 if there is any more input.
+ */
+static int more_input(FILE *file)
 {
-	isl_ctx *ctx;
-	isl_set *context;
+	int c;
+
+	do {
+		c = fgetc(file);
+	} while (c != EOF && isspace(c));
+	if (c == EOF)
+		return 0;
+	ungetc(c, file);
+	return 1;
+}
+
+/* An input read by read_input.
+ */
+struct codegen_input {
 	isl_union_map *schedule;
-	isl_union_map *options_map;
-	isl_ast_build *build;
-	isl_ast_node *tree;
-	struct options *options;
-	isl_printer *p;
+	isl_set *context;
+	isl_union_map *options;
+};
 
-	options = options_new_with_defaults();
-	assert(options);
-	argc = options_parse(options, argc, argv, ISL_ARG_ALL);
+/* Free all objects in "input".
+ */
+static void clear_input(struct codegen_input *input)
+{
+	input->schedule = isl_union_map_free(input->schedule);
+	isl_set_free(input->context);
+	input->context = NULL;
+	input->options = isl_union_map_free(input->options);
+}
 
-	ctx = isl_ctx_alloc_with_options(&options_args, options);
+/* Read a schedule, a context and a relation describing
+ * AST generation options from stdin into "input".
+ * Return -1 if the input could not be read.
+ */
+static int read_input(isl_ctx *ctx, struct codegen_input *input)
+{
+	input->schedule = isl_union_map_read_from_file(ctx, stdin);
+	input->context = isl_set_read_from_file(ctx, stdin);
+	input->options = isl_union_map_read_from_file(ctx, stdin);
+	if (!input->schedule || !input->context || !input->options) {
+		clear_input(input);
+		return -1;
+	}
+
+	return 0;
+}
 
-	schedule = isl_union_map_read_from_file(ctx, stdin);
-	context = isl_set_read_from_file(ctx, stdin);
-	options_map = isl_union_map_read_from_file(ctx, stdin);
+/* Print the AST that scans the domain elements of "schedule"
+ * in the order of their images, within "context" and taking into account
+ * the AST generation options "options_map", to "p".
+ */
+static __isl_give isl_printer *print_ast_for(__isl_take isl_printer *p,
+	struct options *options, __isl_take isl_union_map *schedule,
+	__isl_take isl_set *context, __isl_take isl_union_map *options_map)
+{
+	isl_ast_build *build;
+	isl_ast_node *tree;
 
 	build = isl_ast_build_from_context(context);
 	build = set_options(build, options_map, options, schedule);
 	tree = isl_ast_build_ast_from_schedule(build, schedule);
 	isl_ast_build_free(build);
 
-	p = isl_printer_to_file(ctx, stdout);
 	p = isl_printer_set_output_format(p, ISL_FORMAT_C);
 	p = isl_printer_print_ast_node(p, tree);
-	isl_printer_free(p);
 
 	isl_ast_node_free(tree);
 
+	return p;
+}
+
+/* Read a schedule, a context and a relation describing
+ * AST generation options from stdin and print the corresponding AST.
+ * Return -1 if the input could not be read.
+ */
+static int print_ast(isl_ctx *ctx, struct options *options)
+{
+	struct codegen_input input;
+	isl_printer *p;
+
+	if (read_input(ctx, &input) < 0)
+		return -1;
+
+	p = isl_printer_to_file(ctx, stdout);
+	p = print_ast_for(p, options, input.schedule, input.context,
+			    input.options);
+	isl_printer_free(p);
+
+	return 0;
+}
+
+/* A group of "n" inputs read by print_ast_batch_threads.
+ * out[i] is the printed AST of input[i], generated
+ * in a worker isl_ctx.
+ */
+struct codegen_batch {
+	struct options *options;
+	int n;
+	struct codegen_input *input;
+	char **out;
+};
+
+/* Generate the AST of input "i" of "user" in the isl_ctx of "worker" and
+ * keep track of the printed AST.
+ */
+static int generate(struct isl_thread_worker *worker, int i, void *user)
+{
+	struct codegen_batch *batch = user;
+	struct codegen_input *input = &batch->input[i];
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	isl_union_map *schedule, *options_map;
+	isl_set *context;
+	isl_printer *p;
+
+	isl_thread_worker_lock(worker);
+	schedule = isl_union_map_import(ctx, input->schedule);
+	context = isl_set_import(ctx, input->context);
+	options_map = isl_union_map_import(ctx, input->options);
+	isl_thread_worker_unlock(worker);
+
+	p = isl_printer_to_str(ctx);
+	p = print_ast_for(p, batch->options, schedule, context, options_map);
+	batch->out[i] = isl_printer_get_str(p);
+	isl_printer_free(p);
+
+	return batch->out[i] ? 0 : -1;
+}
+
+/* Read inputs from stdin in groups of (at most) 4 * "n" inputs,
+ * with "n" the value of the threads option, generate the ASTs
+ * of the inputs in each group using "n" threads and
+ * print them in input order, each terminated by a "%%" line.
+ * The inputs are read in "ctx" and the ASTs are generated
+ * in worker isl_ctx objects (see isl_thread_run).
+ * Stop after the first input that cannot be read or
+ * after the first group on which the generation fails.
+ */
+static void print_ast_batch_threads(isl_ctx *ctx, struct options *options)
+{
+	int i, r = 0;
+	int size = 4 * isl_options_get_threads(ctx);
+	int more = 1;
+	struct codegen_batch batch = { options };
+
+	batch.input = isl_calloc_array(ctx, struct codegen_input, size);
+	batch.out = isl_calloc_array(ctx, char *, size);
+	assert(batch.input && batch.out);
+
+	while (r >= 0 && more) {
+		for (batch.n = 0; batch.n < size; ++batch.n) {
+			more = more_input(stdin) &&
+			    read_input(ctx, &batch.input[batch.n]) >= 0;
+			if (!more)
+				break;
+		}
+		r = isl_thread_run(ctx, batch.n, &generate, &batch);
+		for (i = 0; i < batch.n; ++i) {
+			if (batch.out[i])
+				printf("%s%%%%\n", batch.out[i]);
+			free(batch.out[i]);
+			batch.out[i] = NULL;
+			clear_input(&batch.input[i]);
+		}
+		fflush(stdout);
+	}
+
+	free(batch.input);
+	free(batch.out);
+}
+
+int main(int argc, char **argv)
+{
+	isl_ctx *ctx;
+	struct options *options;
+
+	options = options_new_with_defaults();
+	assert(options);
+	argc = options_parse(options, argc, argv, ISL_ARG_ALL);
+
+	ctx = isl_ctx_alloc_with_options(&options_args, options);
+
+	if (!options->batch)
+		print_ast(ctx, options);
+	else if (isl_options_get_threads(ctx) > 1)
+		print_ast_batch_threads(ctx, options);
+	else
+		while (more_input(stdin)) {
+			if (print_ast(ctx, options) < 0)
+				break;
+			printf("%%%%\n");
+			fflush(stdout);
+		}
+
 	isl_ctx_free(ctx);
 	return 0;
 }
@@ -9,6 +9,7 @@
 #include <isl/multi.h>
 #include <isl/union_set_type.h>
 #include <isl/val.h>
+#include <isl/stdint.h>
 
 #if defined(__cplusplus)
 extern "C" {
@@ -127,6 +128,9 @@ __isl_give isl_basic_set *isl_aff_ge_basic_set(__isl_take isl_aff *aff1,
 	__isl_take isl_aff *aff2);
 
 __isl_give isl_aff *isl_aff_read_from_str(isl_ctx *ctx, const char *str);
+void *isl_aff_to_binary(__isl_keep isl_aff *aff, size_t *size);
+__isl_give isl_aff *isl_aff_from_binary(isl_ctx *ctx,
+	const void *buf, size_t size, size_t *used);
 __isl_give isl_printer *isl_printer_print_aff(__isl_take isl_printer *p,
 	__isl_keep isl_aff *aff);
 void isl_aff_dump(__isl_keep isl_aff *aff);
@@ -469,6 +473,17 @@ int isl_pw_multi_aff_foreach_piece(__isl_keep isl_pw_multi_aff *pma,
 	int (*fn)(__isl_take isl_set *set, __isl_take isl_multi_aff *maff,
 		    void *user), void *user);
 
+__isl_give isl_pw_multi_aff_compiled *isl_pw_multi_aff_compile(
+	__isl_keep isl_pw_multi_aff *pma);
+__isl_give isl_pw_multi_aff_compiled *isl_pw_aff_compile(
+	__isl_keep isl_pw_aff *pa);
+__isl_null isl_pw_multi_aff_compiled *isl_pw_multi_aff_compiled_free(
+	__isl_take isl_pw_multi_aff_compiled *c);
+int isl_pw_multi_aff_compiled_dim(__isl_keep isl_pw_multi_aff_compiled *c,
+	enum isl_dim_type type);
+int isl_pw_multi_aff_compiled_eval(__isl_keep isl_pw_multi_aff_compiled *c,
+	int n, const int64_t *points, int64_t *values, int *defined);
+
 __isl_give isl_map *isl_map_from_pw_multi_aff(__isl_take isl_pw_multi_aff *pma);
 __isl_give isl_set *isl_set_from_pw_multi_aff(__isl_take isl_pw_multi_aff *pma);
 
@@ -480,6 +495,10 @@ __isl_give isl_pw_multi_aff *isl_pw_multi_aff_from_map(__isl_take isl_map *map);
 
 __isl_give isl_pw_multi_aff *isl_pw_multi_aff_read_from_str(isl_ctx *ctx,
 	const char *str);
+void *isl_pw_multi_aff_to_binary(__isl_keep isl_pw_multi_aff *pma,
+	size_t *size);
+__isl_give isl_pw_multi_aff *isl_pw_multi_aff_from_binary(isl_ctx *ctx,
+	const void *buf, size_t size, size_t *used);
 void isl_pw_multi_aff_dump(__isl_keep isl_pw_multi_aff *pma);
 
 
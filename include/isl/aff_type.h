@@ -23,6 +23,9 @@ typedef struct isl_multi_aff isl_multi_aff;
 struct isl_pw_multi_aff;
 typedef struct isl_pw_multi_aff isl_pw_multi_aff;
 
+struct isl_pw_multi_aff_compiled;
+typedef struct isl_pw_multi_aff_compiled isl_pw_multi_aff_compiled;
+
 struct isl_union_pw_multi_aff;
 typedef struct isl_union_pw_multi_aff isl_union_pw_multi_aff;
 
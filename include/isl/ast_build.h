@@ -39,6 +39,9 @@ int isl_options_get_ast_build_allow_else(isl_ctx *ctx);
 int isl_options_set_ast_build_allow_or(isl_ctx *ctx, int val);
 int isl_options_get_ast_build_allow_or(isl_ctx *ctx);
 
+int isl_options_set_ast_build_max_pieces(isl_ctx *ctx, int val);
+int isl_options_get_ast_build_max_pieces(isl_ctx *ctx);
+
 isl_ctx *isl_ast_build_get_ctx(__isl_keep isl_ast_build *build);
 
 __isl_give isl_ast_build *isl_ast_build_from_context(__isl_take isl_set *set);
@@ -59,6 +62,9 @@ __isl_null isl_ast_build *isl_ast_build_free(
 __isl_give isl_ast_build *isl_ast_build_set_options(
 	__isl_take isl_ast_build *build,
 	__isl_take isl_union_map *options);
+__isl_give isl_ast_build *isl_ast_build_set_coincident(
+	__isl_take isl_ast_build *build,
+	__isl_take isl_union_map *coincident);
 __isl_give isl_ast_build *isl_ast_build_set_iterators(
 	__isl_take isl_ast_build *build,
 	__isl_take isl_id_list *iterators);
@@ -74,6 +80,8 @@ __isl_give isl_ast_build *isl_ast_build_set_after_each_for(
 	__isl_take isl_ast_build *build,
 	__isl_give isl_ast_node *(*fn)(__isl_take isl_ast_node *node,
 		__isl_keep isl_ast_build *build, void *user), void *user);
+__isl_give isl_ast_build *isl_ast_build_set_reuse_subtrees(
+	__isl_take isl_ast_build *build, int reuse);
 __isl_give isl_ast_build *isl_ast_build_set_create_leaf(
 	__isl_take isl_ast_build *build,
 	__isl_give isl_ast_node *(*fn)(__isl_take isl_ast_build *build,
@@ -92,6 +100,9 @@ __isl_give isl_ast_expr *isl_ast_build_call_from_multi_pw_aff(
 
 __isl_give isl_ast_node *isl_ast_build_ast_from_schedule(
 	__isl_keep isl_ast_build *build, __isl_take isl_union_map *schedule);
+int isl_ast_build_foreach_ast_from_schedule(__isl_keep isl_ast_build *build,
+	__isl_take isl_union_map *schedule,
+	int (*fn)(__isl_take isl_ast_node *node, void *user), void *user);
 
 #if defined(__cplusplus)
 }
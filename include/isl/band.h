@@ -13,6 +13,9 @@ extern "C" {
 struct isl_band;
 typedef struct isl_band isl_band;
 
+struct isl_band_tile_plan;
+typedef struct isl_band_tile_plan isl_band_tile_plan;
+
 ISL_DECLARE_LIST(band)
 
 __isl_give isl_band *isl_band_copy(__isl_keep isl_band *band);
@@ -37,6 +40,12 @@ int isl_options_set_tile_shift_point_loops(isl_ctx *ctx, int val);
 int isl_options_get_tile_shift_point_loops(isl_ctx *ctx);
 
 int isl_band_tile(__isl_keep isl_band *band, __isl_take isl_vec *sizes);
+__isl_give isl_band_tile_plan *isl_band_tile_plan_alloc(
+	__isl_keep isl_band *band);
+__isl_null isl_band_tile_plan *isl_band_tile_plan_free(
+	__isl_take isl_band_tile_plan *plan);
+__isl_give isl_union_map *isl_band_tile_plan_get_partial_schedule(
+	__isl_keep isl_band_tile_plan *plan, __isl_keep isl_vec *sizes);
 int isl_band_split(__isl_keep isl_band *band, int pos);
 
 int isl_band_n_member(__isl_keep isl_band *band);
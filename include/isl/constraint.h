@@ -42,6 +42,10 @@ int isl_basic_map_foreach_constraint(__isl_keep isl_basic_map *bmap,
 	int (*fn)(__isl_take isl_constraint *c, void *user), void *user);
 int isl_basic_set_foreach_constraint(__isl_keep isl_basic_set *bset,
 	int (*fn)(__isl_take isl_constraint *c, void *user), void *user);
+int isl_basic_map_foreach_constraint_view(__isl_keep isl_basic_map *bmap,
+	int (*fn)(__isl_keep isl_constraint *c, void *user), void *user);
+int isl_basic_set_foreach_constraint_view(__isl_keep isl_basic_set *bset,
+	int (*fn)(__isl_keep isl_constraint *c, void *user), void *user);
 __isl_give isl_constraint_list *isl_basic_map_get_constraint_list(
 	__isl_keep isl_basic_map *bmap);
 __isl_give isl_constraint_list *isl_basic_set_get_constraint_list(
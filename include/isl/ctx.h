@@ -77,7 +77,8 @@ enum isl_error {
 	isl_error_internal,
 	isl_error_invalid,
 	isl_error_quota,
-	isl_error_unsupported
+	isl_error_unsupported,
+	isl_error_timeout
 };
 struct isl_ctx;
 typedef struct isl_ctx isl_ctx;
@@ -103,18 +104,27 @@ typedef struct isl_ctx isl_ctx;
 void *isl_malloc_or_die(isl_ctx *ctx, size_t size);
 void *isl_calloc_or_die(isl_ctx *ctx, size_t nmemb, size_t size);
 void *isl_realloc_or_die(isl_ctx *ctx, void *ptr, size_t size);
-
-#define isl_alloc(ctx,type,size)	((type *)isl_malloc_or_die(ctx, size))
-#define isl_calloc(ctx,type,size)	((type *)isl_calloc_or_die(ctx,\
-								    1, size))
-#define isl_realloc(ctx,ptr,type,size)	((type *)isl_realloc_or_die(ctx,\
-								    ptr, size))
+void *isl_malloc_type_or_die(isl_ctx *ctx, size_t size, const char *type);
+void *isl_calloc_type_or_die(isl_ctx *ctx, size_t nmemb, size_t size,
+	const char *type);
+void *isl_realloc_type_or_die(isl_ctx *ctx, void *ptr, size_t size,
+	const char *type);
+
+/* The name of "type" after macro expansion, used for allocation accounting. */
+#define ISL_TYPE_NAME(type)		#type
+
+#define isl_alloc(ctx,type,size)	((type *)isl_malloc_type_or_die(ctx,\
+					    size, ISL_TYPE_NAME(type)))
+#define isl_calloc(ctx,type,size)	((type *)isl_calloc_type_or_die(ctx,\
+					    1, size, ISL_TYPE_NAME(type)))
+#define isl_realloc(ctx,ptr,type,size)	((type *)isl_realloc_type_or_die(ctx,\
+					    ptr, size, ISL_TYPE_NAME(type)))
 #define isl_alloc_type(ctx,type)	isl_alloc(ctx,type,sizeof(type))
 #define isl_calloc_type(ctx,type)	isl_calloc(ctx,type,sizeof(type))
 #define isl_realloc_type(ctx,ptr,type)	isl_realloc(ctx,ptr,type,sizeof(type))
 #define isl_alloc_array(ctx,type,n)	isl_alloc(ctx,type,(n)*sizeof(type))
-#define isl_calloc_array(ctx,type,n)	((type *)isl_calloc_or_die(ctx,\
-							    n, sizeof(type)))
+#define isl_calloc_array(ctx,type,n)	((type *)isl_calloc_type_or_die(ctx,\
+					    n, sizeof(type), ISL_TYPE_NAME(type)))
 #define isl_realloc_array(ctx,ptr,type,n) \
 				    isl_realloc(ctx,ptr,type,(n)*sizeof(type))
 
@@ -145,6 +155,7 @@ struct isl_options *isl_ctx_options(isl_ctx *ctx);
 isl_ctx *isl_ctx_alloc_with_options(struct isl_args *args,
 	__isl_take void *opt);
 isl_ctx *isl_ctx_alloc(void);
+isl_ctx *isl_ctx_alloc_arena(void);
 void *isl_ctx_peek_options(isl_ctx *ctx, struct isl_args *args);
 int isl_ctx_parse_options(isl_ctx *ctx, int argc, char **argv, unsigned flags);
 void isl_ctx_ref(struct isl_ctx *ctx);
@@ -155,10 +166,33 @@ void isl_ctx_abort(isl_ctx *ctx);
 void isl_ctx_resume(isl_ctx *ctx);
 int isl_ctx_aborted(isl_ctx *ctx);
 
+void isl_ctx_set_deadline(isl_ctx *ctx, unsigned long ms);
+
 void isl_ctx_set_max_operations(isl_ctx *ctx, unsigned long max_operations);
 unsigned long isl_ctx_get_max_operations(isl_ctx *ctx);
 void isl_ctx_reset_operations(isl_ctx *ctx);
 
+void isl_ctx_set_max_memory(isl_ctx *ctx, unsigned long max_memory);
+unsigned long isl_ctx_get_max_memory(isl_ctx *ctx);
+
+void isl_ctx_defer_free(isl_ctx *ctx);
+void isl_ctx_drain_deferred_free(isl_ctx *ctx);
+
+long isl_ctx_get_stat(isl_ctx *ctx, const char *name);
+
+__isl_give char *isl_ctx_profile_to_str(isl_ctx *ctx);
+void isl_ctx_dump_profile(isl_ctx *ctx);
+void isl_ctx_reset_profile(isl_ctx *ctx);
+
+int isl_ctx_set_trace_callback(isl_ctx *ctx,
+	void (*fn)(const char *name, int begin, double timestamp,
+		const char *args, void *user), void *user);
+int isl_ctx_set_trace_file(isl_ctx *ctx, FILE *file);
+
+int isl_ctx_set_thread_executor(isl_ctx *ctx,
+	int (*execute)(int n, void (*task)(int i, void *data), void *data,
+		void *user), void *user);
+
 #define ISL_ARG_CTX_DECL(prefix,st,args)				\
 st *isl_ctx_peek_ ## prefix(isl_ctx *ctx);
 
@@ -49,6 +49,7 @@ struct isl_hash_table_entry
 struct isl_hash_table {
 	int    bits;
 	int    n;
+	int    max_probe;
 	struct isl_hash_table_entry *entries;
 };
 
@@ -60,6 +61,8 @@ void isl_hash_table_free(struct isl_ctx *ctx, struct isl_hash_table *table);
 int isl_hash_table_init(struct isl_ctx *ctx, struct isl_hash_table *table,
 			int min_size);
 void isl_hash_table_clear(struct isl_hash_table *table);
+int isl_hash_table_reserve(struct isl_ctx *ctx, struct isl_hash_table *table,
+	int n);
 struct isl_hash_table_entry *isl_hash_table_find(struct isl_ctx *ctx,
 				struct isl_hash_table *table,
 				uint32_t key_hash,
@@ -32,6 +32,10 @@ __isl_give ISL_HMAP *ISL_FN(ISL_HMAP,set)(__isl_take ISL_HMAP *hmap,
 	__isl_take ISL_KEY *key, __isl_take ISL_VAL *val);
 __isl_give ISL_HMAP *ISL_FN(ISL_HMAP,drop)(__isl_take ISL_HMAP *hmap,
 	__isl_take ISL_KEY *key);
+__isl_give ISL_HMAP *ISL_FN(ISL_HMAP,take)(__isl_take ISL_HMAP *hmap,
+	__isl_take ISL_KEY *key, __isl_give ISL_VAL **val);
+__isl_give ISL_HMAP *ISL_FN(ISL_HMAP,set_all)(__isl_take ISL_HMAP *dst,
+	__isl_take ISL_HMAP *src);
 
 int ISL_FN(ISL_HMAP,foreach)(__isl_keep ISL_HMAP *hmap,
 	int (*fn)(__isl_take ISL_KEY *key, __isl_take ISL_VAL *val, void *user),
@@ -121,6 +121,8 @@ struct isl_basic_map *isl_basic_map_identity_like(struct isl_basic_map *model);
 struct isl_basic_map *isl_basic_map_finalize(struct isl_basic_map *bmap);
 __isl_null isl_basic_map *isl_basic_map_free(__isl_take isl_basic_map *bmap);
 __isl_give isl_basic_map *isl_basic_map_copy(__isl_keep isl_basic_map *bmap);
+__isl_give isl_basic_map *isl_basic_map_import(isl_ctx *ctx,
+	__isl_keep isl_basic_map *bmap);
 struct isl_basic_map *isl_basic_map_extend(struct isl_basic_map *base,
 		unsigned nparam, unsigned n_in, unsigned n_out, unsigned extra,
 		unsigned n_eq, unsigned n_ineq);
@@ -200,6 +202,8 @@ struct isl_basic_map *isl_basic_map_simplify(struct isl_basic_map *bmap);
 __isl_export
 __isl_give isl_basic_map *isl_basic_map_detect_equalities(
 						__isl_take isl_basic_map *bmap);
+__isl_give isl_basic_map *isl_basic_map_compact(
+	__isl_take isl_basic_map *bmap);
 __isl_give isl_basic_map *isl_basic_map_read_from_file(isl_ctx *ctx,
 	FILE *input);
 __isl_constructor
@@ -208,6 +212,12 @@ __isl_give isl_basic_map *isl_basic_map_read_from_str(isl_ctx *ctx,
 __isl_give isl_map *isl_map_read_from_file(isl_ctx *ctx, FILE *input);
 __isl_constructor
 __isl_give isl_map *isl_map_read_from_str(isl_ctx *ctx, const char *str);
+void *isl_basic_map_to_binary(__isl_keep isl_basic_map *bmap, size_t *size);
+__isl_give isl_basic_map *isl_basic_map_from_binary(isl_ctx *ctx,
+	const void *buf, size_t size, size_t *used);
+void *isl_map_to_binary(__isl_keep isl_map *map, size_t *size);
+__isl_give isl_map *isl_map_from_binary(isl_ctx *ctx,
+	const void *buf, size_t size, size_t *used);
 void isl_basic_map_dump(__isl_keep isl_basic_map *bmap);
 void isl_basic_map_print(__isl_keep isl_basic_map *bmap, FILE *out, int indent,
 	const char *prefix, const char *suffix, unsigned output_format);
@@ -273,6 +283,24 @@ __isl_give isl_pw_multi_aff *isl_basic_map_partial_lexmax_pw_multi_aff(
 	__isl_give isl_set **empty);
 __isl_give isl_pw_multi_aff *isl_basic_map_lexmin_pw_multi_aff(
 	__isl_take isl_basic_map *bmap);
+int isl_basic_map_foreach_partial_lexmin(__isl_keep isl_basic_map *bmap,
+	__isl_keep isl_basic_set *dom,
+	int (*fn)(__isl_take isl_basic_set *dom,
+		  __isl_take isl_multi_aff *maff, void *user),
+	void *user);
+int isl_basic_map_foreach_partial_lexmax(__isl_keep isl_basic_map *bmap,
+	__isl_keep isl_basic_set *dom,
+	int (*fn)(__isl_take isl_basic_set *dom,
+		  __isl_take isl_multi_aff *maff, void *user),
+	void *user);
+int isl_basic_map_foreach_lexmin(__isl_keep isl_basic_map *bmap,
+	int (*fn)(__isl_take isl_basic_set *dom,
+		  __isl_take isl_multi_aff *maff, void *user),
+	void *user);
+int isl_basic_map_foreach_lexmax(__isl_keep isl_basic_map *bmap,
+	int (*fn)(__isl_take isl_basic_set *dom,
+		  __isl_take isl_multi_aff *maff, void *user),
+	void *user);
 __isl_give isl_pw_multi_aff *isl_map_lexmin_pw_multi_aff(
 	__isl_take isl_map *map);
 __isl_give isl_pw_multi_aff *isl_map_lexmax_pw_multi_aff(
@@ -327,6 +355,7 @@ __isl_give isl_map *isl_map_lex_ge(__isl_take isl_space *set_dim);
 struct isl_map *isl_map_finalize(struct isl_map *map);
 __isl_null isl_map *isl_map_free(__isl_take isl_map *map);
 __isl_give isl_map *isl_map_copy(__isl_keep isl_map *map);
+__isl_give isl_map *isl_map_import(isl_ctx *ctx, __isl_keep isl_map *map);
 struct isl_map *isl_map_extend(struct isl_map *base,
 		unsigned nparam, unsigned n_in, unsigned n_out);
 __isl_export
@@ -424,6 +453,7 @@ __isl_give isl_basic_map *isl_basic_map_deltas_map(
 __isl_give isl_map *isl_map_deltas_map(__isl_take isl_map *map);
 __isl_export
 __isl_give isl_map *isl_map_detect_equalities(__isl_take isl_map *map);
+__isl_give isl_map *isl_map_compact(__isl_take isl_map *map);
 __isl_export
 __isl_give isl_basic_map *isl_map_affine_hull(__isl_take isl_map *map);
 __isl_give isl_basic_map *isl_map_convex_hull(__isl_take isl_map *map);
@@ -445,6 +475,27 @@ __isl_give isl_basic_map *isl_basic_map_move_dims(
 __isl_give isl_map *isl_map_move_dims(__isl_take isl_map *map,
 	enum isl_dim_type dst_type, unsigned dst_pos,
 	enum isl_dim_type src_type, unsigned src_pos, unsigned n);
+
+__isl_give isl_dim_edits *isl_dim_edits_alloc(isl_ctx *ctx);
+__isl_give isl_dim_edits *isl_dim_edits_copy(__isl_keep isl_dim_edits *edits);
+__isl_null isl_dim_edits *isl_dim_edits_free(__isl_take isl_dim_edits *edits);
+isl_ctx *isl_dim_edits_get_ctx(__isl_keep isl_dim_edits *edits);
+__isl_give isl_dim_edits *isl_dim_edits_insert(__isl_take isl_dim_edits *edits,
+	enum isl_dim_type type, unsigned pos, unsigned n);
+__isl_give isl_dim_edits *isl_dim_edits_move(__isl_take isl_dim_edits *edits,
+	enum isl_dim_type dst_type, unsigned dst_pos,
+	enum isl_dim_type src_type, unsigned src_pos, unsigned n);
+__isl_give isl_dim_edits *isl_dim_edits_project_out(
+	__isl_take isl_dim_edits *edits,
+	enum isl_dim_type type, unsigned first, unsigned n);
+__isl_give isl_dim_edits *isl_dim_edits_set_dim_name(
+	__isl_take isl_dim_edits *edits,
+	enum isl_dim_type type, unsigned pos, const char *s);
+__isl_give isl_basic_map *isl_basic_map_apply_dim_edits(
+	__isl_take isl_basic_map *bmap, __isl_keep isl_dim_edits *edits);
+__isl_give isl_map *isl_map_apply_dim_edits(__isl_take isl_map *map,
+	__isl_keep isl_dim_edits *edits);
+
 __isl_give isl_basic_map *isl_basic_map_project_out(
 		__isl_take isl_basic_map *bmap,
 		enum isl_dim_type type, unsigned first, unsigned n);
@@ -625,11 +676,14 @@ ISL_DEPRECATED
 int isl_map_fast_is_equal(__isl_keep isl_map *map1, __isl_keep isl_map *map2);
 
 uint32_t isl_map_get_hash(__isl_keep isl_map *map);
+uint32_t isl_map_get_fingerprint(__isl_keep isl_map *map);
 
 int isl_map_n_basic_map(__isl_keep isl_map *map);
 __isl_export
 int isl_map_foreach_basic_map(__isl_keep isl_map *map,
 	int (*fn)(__isl_take isl_basic_map *bmap, void *user), void *user);
+int isl_map_foreach_basic_map_peek(__isl_keep isl_map *map,
+	int (*fn)(__isl_keep isl_basic_map *bmap, void *user), void *user);
 
 __isl_give isl_map *isl_set_lifting(__isl_take isl_set *set);
 
@@ -640,6 +694,9 @@ __isl_give isl_map *isl_map_reaching_path_lengths(__isl_take isl_map *map,
 	int *exact);
 __isl_give isl_map *isl_map_transitive_closure(__isl_take isl_map *map,
 	int *exact);
+__isl_give isl_map *isl_map_transitive_closure_extend(
+	__isl_take isl_map *closure, int closure_exact,
+	__isl_take isl_map *map, int *exact);
 
 __isl_give isl_map *isl_map_lex_le_map(__isl_take isl_map *map1,
 	__isl_take isl_map *map2);
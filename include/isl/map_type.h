@@ -25,6 +25,9 @@ typedef struct isl_set isl_set;
 ISL_DECLARE_LIST_TYPE(set)
 #endif
 
+struct isl_dim_edits;
+typedef struct isl_dim_edits isl_dim_edits;
+
 ISL_DECLARE_LIST_FN(basic_set)
 ISL_DECLARE_LIST_FN(set)
 
@@ -39,6 +39,7 @@ int isl_mat_rows(__isl_keep isl_mat *mat);
 int isl_mat_cols(__isl_keep isl_mat *mat);
 __isl_give isl_val *isl_mat_get_element_val(__isl_keep isl_mat *mat,
 	int row, int col);
+int isl_mat_get_elements_si(__isl_keep isl_mat *mat, long *elements);
 __isl_give isl_mat *isl_mat_set_element_si(__isl_take isl_mat *mat,
 	int row, int col, int v);
 __isl_give isl_mat *isl_mat_set_element_val(__isl_take isl_mat *mat,
@@ -32,16 +32,103 @@ int isl_options_get_bound(isl_ctx *ctx);
 int isl_options_set_on_error(isl_ctx *ctx, int val);
 int isl_options_get_on_error(isl_ctx *ctx);
 
+int isl_options_set_profile(isl_ctx *ctx, int val);
+int isl_options_get_profile(isl_ctx *ctx);
+int isl_options_set_profile_allocations(isl_ctx *ctx, int val);
+int isl_options_get_profile_allocations(isl_ctx *ctx);
+
+int isl_options_set_int_pool_size(isl_ctx *ctx, int val);
+int isl_options_get_int_pool_size(isl_ctx *ctx);
+
+int isl_options_set_blk_cache_size(isl_ctx *ctx, int val);
+int isl_options_get_blk_cache_size(isl_ctx *ctx);
+
+int isl_options_get_arena(isl_ctx *ctx);
+
+int isl_options_set_threads(isl_ctx *ctx, int val);
+int isl_options_get_threads(isl_ctx *ctx);
+int isl_options_set_deferred_free_thread(isl_ctx *ctx, int val);
+int isl_options_get_deferred_free_thread(isl_ctx *ctx);
+
+int isl_options_set_sample_cache_size(isl_ctx *ctx, int val);
+int isl_options_get_sample_cache_size(isl_ctx *ctx);
+
+int isl_options_set_flow_cache_size(isl_ctx *ctx, int val);
+int isl_options_get_flow_cache_size(isl_ctx *ctx);
+
+int isl_options_set_closure_cache_size(isl_ctx *ctx, int val);
+int isl_options_get_closure_cache_size(isl_ctx *ctx);
+
+int isl_options_set_compression_cache_size(isl_ctx *ctx, int val);
+int isl_options_get_compression_cache_size(isl_ctx *ctx);
+
+int isl_options_set_coefficients_cache_size(isl_ctx *ctx, int val);
+int isl_options_get_coefficients_cache_size(isl_ctx *ctx);
+
 int isl_options_set_gbr_only_first(isl_ctx *ctx, int val);
 int isl_options_get_gbr_only_first(isl_ctx *ctx);
 
+int isl_options_set_gbr_reuse(isl_ctx *ctx, int val);
+int isl_options_get_gbr_reuse(isl_ctx *ctx);
+
+int isl_options_set_gbr_lll(isl_ctx *ctx, int val);
+int isl_options_get_gbr_lll(isl_ctx *ctx);
+
+int isl_options_set_tab_lean(isl_ctx *ctx, int val);
+int isl_options_get_tab_lean(isl_ctx *ctx);
+
+int isl_options_set_tab_dual_simplex(isl_ctx *ctx, int val);
+int isl_options_get_tab_dual_simplex(isl_ctx *ctx);
+
+#define		ISL_TAB_PIVOT_BLAND		0
+#define		ISL_TAB_PIVOT_DANTZIG		1
+#define		ISL_TAB_PIVOT_STEEPEST_EDGE	2
+int isl_options_set_tab_pivot(isl_ctx *ctx, int val);
+int isl_options_get_tab_pivot(isl_ctx *ctx);
+
+int isl_options_set_tab_batch_redundant(isl_ctx *ctx, int val);
+int isl_options_get_tab_batch_redundant(isl_ctx *ctx);
+int isl_options_set_tab_batch_redundant_min(isl_ctx *ctx, int val);
+int isl_options_get_tab_batch_redundant_min(isl_ctx *ctx);
+
+int isl_options_set_float_filter(isl_ctx *ctx, int val);
+int isl_options_get_float_filter(isl_ctx *ctx);
+
+int isl_options_set_sample_centre_out(isl_ctx *ctx, int val);
+int isl_options_get_sample_centre_out(isl_ctx *ctx);
+
+int isl_options_set_pip_split_inherit(isl_ctx *ctx, int val);
+int isl_options_get_pip_split_inherit(isl_ctx *ctx);
+int isl_options_set_pip_shift(isl_ctx *ctx, int val);
+int isl_options_get_pip_shift(isl_ctx *ctx);
+
 #define		ISL_SCHEDULE_ALGORITHM_ISL		0
 #define		ISL_SCHEDULE_ALGORITHM_FEAUTRIER	1
+#define		ISL_SCHEDULE_ALGORITHM_CLUSTER		2
 int isl_options_set_schedule_algorithm(isl_ctx *ctx, int val);
 int isl_options_get_schedule_algorithm(isl_ctx *ctx);
 
 int isl_options_set_coalesce_bounded_wrapping(isl_ctx *ctx, int val);
 int isl_options_get_coalesce_bounded_wrapping(isl_ctx *ctx);
+int isl_options_set_coalesce_box_filter(isl_ctx *ctx, int val);
+int isl_options_get_coalesce_box_filter(isl_ctx *ctx);
+int isl_options_set_simplify_budget(isl_ctx *ctx, int val);
+int isl_options_get_simplify_budget(isl_ctx *ctx);
+
+int isl_options_set_union_map_lazy_empty(isl_ctx *ctx, int val);
+int isl_options_get_union_map_lazy_empty(isl_ctx *ctx);
+
+int isl_options_set_compact_on_finalize(isl_ctx *ctx, int val);
+int isl_options_get_compact_on_finalize(isl_ctx *ctx);
+
+#define		ISL_MAKE_DISJOINT_SUBTRACT	0
+#define		ISL_MAKE_DISJOINT_FILTER	1
+#define		ISL_MAKE_DISJOINT_COALESCE	2
+int isl_options_set_make_disjoint(isl_ctx *ctx, int val);
+int isl_options_get_make_disjoint(isl_ctx *ctx);
+
+int isl_options_set_ilp_prune(isl_ctx *ctx, int val);
+int isl_options_get_ilp_prune(isl_ctx *ctx);
 
 #if defined(__cplusplus)
 }
@@ -11,6 +11,7 @@
 #include <isl/aff_type.h>
 #include <isl/polynomial_type.h>
 #include <isl/val.h>
+#include <isl/stdint.h>
 
 #if defined(__cplusplus)
 extern "C" {
@@ -217,6 +218,18 @@ __isl_give isl_pw_qpolynomial *isl_pw_qpolynomial_fix_val(
 __isl_give isl_val *isl_pw_qpolynomial_eval(
 	__isl_take isl_pw_qpolynomial *pwqp, __isl_take isl_point *pnt);
 
+__isl_give isl_pw_qpolynomial_compiled *isl_pw_qpolynomial_compile(
+	__isl_keep isl_pw_qpolynomial *pwqp);
+__isl_null isl_pw_qpolynomial_compiled *isl_pw_qpolynomial_compiled_free(
+	__isl_take isl_pw_qpolynomial_compiled *c);
+int isl_pw_qpolynomial_compiled_dim(__isl_keep isl_pw_qpolynomial_compiled *c);
+int isl_pw_qpolynomial_compiled_eval_int64(
+	__isl_keep isl_pw_qpolynomial_compiled *c, int n,
+	const int64_t *points, double *values);
+int isl_pw_qpolynomial_compiled_eval_double(
+	__isl_keep isl_pw_qpolynomial_compiled *c, int n,
+	const double *points, double *values);
+
 __isl_give isl_val *isl_pw_qpolynomial_max(__isl_take isl_pw_qpolynomial *pwqp);
 __isl_give isl_val *isl_pw_qpolynomial_min(__isl_take isl_pw_qpolynomial *pwqp);
 
@@ -251,6 +264,10 @@ __isl_give isl_pw_qpolynomial *isl_pw_qpolynomial_gist_params(
 __isl_give isl_pw_qpolynomial *isl_pw_qpolynomial_split_periods(
 	__isl_take isl_pw_qpolynomial *pwqp, int max_periods);
 
+__isl_give isl_pw_qpolynomial *isl_basic_set_card(
+	__isl_take isl_basic_set *bset);
+__isl_give isl_pw_qpolynomial *isl_set_card(__isl_take isl_set *set);
+
 __isl_give isl_pw_qpolynomial *isl_basic_set_multiplicative_call(
 	__isl_take isl_basic_set *bset,
 	__isl_give isl_pw_qpolynomial *(*fn)(__isl_take isl_basic_set *bset));
@@ -10,6 +10,9 @@ typedef struct isl_term isl_term;
 struct __isl_export isl_pw_qpolynomial;
 typedef struct isl_pw_qpolynomial isl_pw_qpolynomial;
 
+struct isl_pw_qpolynomial_compiled;
+typedef struct isl_pw_qpolynomial_compiled isl_pw_qpolynomial_compiled;
+
 enum isl_fold {
 	isl_fold_min,
 	isl_fold_max,
@@ -1,6 +1,7 @@
 #ifndef ISL_SCHEDULE_H
 #define ISL_SCHEDULE_H
 
+#include <isl/stdint.h>
 #include <isl/union_set_type.h>
 #include <isl/union_map_type.h>
 #include <isl/band.h>
@@ -33,6 +34,9 @@ int isl_options_get_schedule_split_scaled(isl_ctx *ctx);
 int isl_options_set_schedule_separate_components(isl_ctx *ctx, int val);
 int isl_options_get_schedule_separate_components(isl_ctx *ctx);
 
+int isl_options_set_schedule_cluster_size(isl_ctx *ctx, int val);
+int isl_options_get_schedule_cluster_size(isl_ctx *ctx);
+
 #define		ISL_SCHEDULE_FUSE_MAX			0
 #define		ISL_SCHEDULE_FUSE_MIN			1
 int isl_options_set_schedule_fuse(isl_ctx *ctx, int val);
@@ -67,12 +71,25 @@ void isl_schedule_constraints_dump(__isl_keep isl_schedule_constraints *sc);
 __isl_give isl_schedule *isl_schedule_constraints_compute_schedule(
 	__isl_take isl_schedule_constraints *sc);
 
+uint32_t isl_schedule_constraints_get_hash(
+	__isl_keep isl_schedule_constraints *sc);
+int isl_ctx_set_schedule_cache(isl_ctx *ctx,
+	__isl_give isl_schedule *(*load)(
+		__isl_keep isl_schedule_constraints *sc, uint32_t hash,
+		void *user),
+	int (*store)(__isl_keep isl_schedule_constraints *sc, uint32_t hash,
+		__isl_keep isl_schedule *schedule, void *user),
+	void *user);
+
 __isl_give isl_schedule *isl_union_set_compute_schedule(
 	__isl_take isl_union_set *domain,
 	__isl_take isl_union_map *validity,
 	__isl_take isl_union_map *proximity);
+__isl_give isl_schedule *isl_schedule_copy(__isl_keep isl_schedule *sched);
 __isl_null isl_schedule *isl_schedule_free(__isl_take isl_schedule *sched);
 __isl_give isl_union_map *isl_schedule_get_map(__isl_keep isl_schedule *sched);
+__isl_give isl_union_map *isl_schedule_get_coincident(
+	__isl_keep isl_schedule *sched);
 
 isl_ctx *isl_schedule_get_ctx(__isl_keep isl_schedule *sched);
 
@@ -10,6 +10,7 @@
 #ifndef ISL_SET_H
 #define ISL_SET_H
 
+#include <isl/stdint.h>
 #include <isl/map_type.h>
 #include <isl/aff_type.h>
 #include <isl/list.h>
@@ -99,6 +100,8 @@ struct isl_basic_set *isl_basic_set_extend_constraints(
 struct isl_basic_set *isl_basic_set_finalize(struct isl_basic_set *bset);
 __isl_null isl_basic_set *isl_basic_set_free(__isl_take isl_basic_set *bset);
 __isl_give isl_basic_set *isl_basic_set_copy(__isl_keep isl_basic_set *bset);
+__isl_give isl_basic_set *isl_basic_set_import(isl_ctx *ctx,
+	__isl_keep isl_basic_set *bset);
 struct isl_basic_set *isl_basic_set_dup(struct isl_basic_set *bset);
 __isl_give isl_basic_set *isl_basic_set_empty(__isl_take isl_space *dim);
 struct isl_basic_set *isl_basic_set_empty_like(struct isl_basic_set *bset);
@@ -136,6 +139,8 @@ struct isl_basic_set *isl_basic_set_simplify(struct isl_basic_set *bset);
 __isl_export
 __isl_give isl_basic_set *isl_basic_set_detect_equalities(
 						__isl_take isl_basic_set *bset);
+__isl_give isl_basic_set *isl_basic_set_compact(
+	__isl_take isl_basic_set *bset);
 __isl_give isl_basic_set *isl_basic_set_remove_redundancies(
 	__isl_take isl_basic_set *bset);
 __isl_give isl_set *isl_set_remove_redundancies(__isl_take isl_set *set);
@@ -152,6 +157,12 @@ __isl_give isl_basic_set *isl_basic_set_read_from_str(isl_ctx *ctx,
 __isl_give isl_set *isl_set_read_from_file(isl_ctx *ctx, FILE *input);
 __isl_constructor
 __isl_give isl_set *isl_set_read_from_str(isl_ctx *ctx, const char *str);
+void *isl_basic_set_to_binary(__isl_keep isl_basic_set *bset, size_t *size);
+__isl_give isl_basic_set *isl_basic_set_from_binary(isl_ctx *ctx,
+	const void *buf, size_t size, size_t *used);
+void *isl_set_to_binary(__isl_keep isl_set *set, size_t *size);
+__isl_give isl_set *isl_set_from_binary(isl_ctx *ctx,
+	const void *buf, size_t size, size_t *used);
 void isl_basic_set_dump(__isl_keep isl_basic_set *bset);
 void isl_set_dump(__isl_keep isl_set *set);
 __isl_give isl_printer *isl_printer_print_basic_set(
@@ -268,6 +279,7 @@ __isl_give isl_set *isl_set_add_basic_set(__isl_take isl_set *set,
 						__isl_take isl_basic_set *bset);
 struct isl_set *isl_set_finalize(struct isl_set *set);
 __isl_give isl_set *isl_set_copy(__isl_keep isl_set *set);
+__isl_give isl_set *isl_set_import(isl_ctx *ctx, __isl_keep isl_set *set);
 __isl_null isl_set *isl_set_free(__isl_take isl_set *set);
 struct isl_set *isl_set_dup(struct isl_set *set);
 __isl_constructor
@@ -278,6 +290,7 @@ __isl_give isl_point *isl_basic_set_sample_point(__isl_take isl_basic_set *bset)
 __isl_give isl_point *isl_set_sample_point(__isl_take isl_set *set);
 __isl_export
 __isl_give isl_set *isl_set_detect_equalities(__isl_take isl_set *set);
+__isl_give isl_set *isl_set_compact(__isl_take isl_set *set);
 __isl_export
 __isl_give isl_basic_set *isl_set_affine_hull(__isl_take isl_set *set);
 __isl_give isl_basic_set *isl_set_convex_hull(__isl_take isl_set *set);
@@ -348,6 +361,10 @@ __isl_give isl_basic_set *isl_basic_set_move_dims(__isl_take isl_basic_set *bset
 __isl_give isl_set *isl_set_move_dims(__isl_take isl_set *set,
 	enum isl_dim_type dst_type, unsigned dst_pos,
 	enum isl_dim_type src_type, unsigned src_pos, unsigned n);
+__isl_give isl_basic_set *isl_basic_set_apply_dim_edits(
+	__isl_take isl_basic_set *bset, __isl_keep isl_dim_edits *edits);
+__isl_give isl_set *isl_set_apply_dim_edits(__isl_take isl_set *set,
+	__isl_keep isl_dim_edits *edits);
 __isl_give isl_basic_set *isl_basic_set_project_out(
 		__isl_take isl_basic_set *bset,
 		enum isl_dim_type type, unsigned first, unsigned n);
@@ -468,6 +485,7 @@ int isl_set_fast_is_disjoint(__isl_keep isl_set *set1,
 	__isl_keep isl_set *set2);
 
 uint32_t isl_set_get_hash(struct isl_set *set);
+uint32_t isl_set_get_fingerprint(__isl_keep isl_set *set);
 
 int isl_set_dim_is_unique(struct isl_set *set, unsigned dim);
 
@@ -475,9 +493,14 @@ int isl_set_n_basic_set(__isl_keep isl_set *set);
 __isl_export
 int isl_set_foreach_basic_set(__isl_keep isl_set *set,
 	int (*fn)(__isl_take isl_basic_set *bset, void *user), void *user);
+int isl_set_foreach_basic_set_peek(__isl_keep isl_set *set,
+	int (*fn)(__isl_keep isl_basic_set *bset, void *user), void *user);
 
 int isl_set_foreach_point(__isl_keep isl_set *set,
 	int (*fn)(__isl_take isl_point *pnt, void *user), void *user);
+int isl_set_foreach_point_batch(__isl_keep isl_set *set,
+	int64_t *buffer, int max_points,
+	int (*fn)(int64_t *points, int n, void *user), void *user);
 __isl_give isl_val *isl_set_count_val(__isl_keep isl_set *set);
 
 __isl_give isl_basic_set *isl_basic_set_from_point(__isl_take isl_point *pnt);
@@ -12,6 +12,7 @@
 
 #include <stdio.h>
 #include <isl/hash.h>
+#include <isl/id.h>
 #include <isl/aff_type.h>
 #include <isl/obj.h>
 #include <isl/val.h>
@@ -50,6 +51,7 @@ struct isl_stream {
 	struct isl_ctx	*ctx;
 	FILE        	*file;
 	const char  	*str;
+	const char  	*end;
 	int	    	line;
 	int	    	col;
 	int	    	eof;
@@ -66,10 +68,14 @@ struct isl_stream {
 
 	struct isl_hash_table	*keywords;
 	enum isl_token_type	 next_type;
+
+	isl_id_list		*ids;
 };
 
 struct isl_stream* isl_stream_new_file(struct isl_ctx *ctx, FILE *file);
 struct isl_stream* isl_stream_new_str(struct isl_ctx *ctx, const char *str);
+struct isl_stream* isl_stream_new_buffer(struct isl_ctx *ctx,
+	const char *buf, size_t size);
 void isl_stream_free(struct isl_stream *s);
 
 void isl_stream_error(struct isl_stream *s, struct isl_token *tok, char *msg);
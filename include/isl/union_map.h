@@ -22,7 +22,11 @@ __isl_give isl_union_map *isl_union_map_from_basic_map(
 __isl_constructor
 __isl_give isl_union_map *isl_union_map_from_map(__isl_take isl_map *map);
 __isl_give isl_union_map *isl_union_map_empty(__isl_take isl_space *dim);
+__isl_give isl_union_map *isl_union_map_reserve(
+	__isl_take isl_union_map *umap, int n);
 __isl_give isl_union_map *isl_union_map_copy(__isl_keep isl_union_map *umap);
+__isl_give isl_union_map *isl_union_map_import(isl_ctx *ctx,
+	__isl_keep isl_union_map *umap);
 __isl_null isl_union_map *isl_union_map_free(__isl_take isl_union_map *umap);
 
 isl_ctx *isl_union_map_get_ctx(__isl_keep isl_union_map *umap);
@@ -142,6 +146,8 @@ __isl_give isl_union_map *isl_union_map_from_domain_and_range(
 __isl_export
 __isl_give isl_union_map *isl_union_map_detect_equalities(
 	__isl_take isl_union_map *umap);
+__isl_give isl_union_map *isl_union_map_compact(
+	__isl_take isl_union_map *umap);
 __isl_export
 __isl_give isl_union_set *isl_union_map_deltas(__isl_take isl_union_map *umap);
 __isl_give isl_union_map *isl_union_map_deltas_map(
@@ -174,9 +180,12 @@ int isl_union_map_is_strict_subset(__isl_keep isl_union_map *umap1,
 	__isl_keep isl_union_map *umap2);
 
 int isl_union_map_n_map(__isl_keep isl_union_map *umap);
+uint32_t isl_union_map_get_fingerprint(__isl_keep isl_union_map *umap);
 __isl_export
 int isl_union_map_foreach_map(__isl_keep isl_union_map *umap,
 	int (*fn)(__isl_take isl_map *map, void *user), void *user);
+int isl_union_map_foreach_map_peek(__isl_keep isl_union_map *umap,
+	int (*fn)(__isl_keep isl_map *map, void *user), void *user);
 __isl_give int isl_union_map_contains(__isl_keep isl_union_map *umap,
 	__isl_keep isl_space *dim);
 __isl_give isl_map *isl_union_map_extract_map(__isl_keep isl_union_map *umap,
@@ -206,6 +215,9 @@ __isl_give isl_union_map *isl_union_map_read_from_file(isl_ctx *ctx,
 __isl_constructor
 __isl_give isl_union_map *isl_union_map_read_from_str(isl_ctx *ctx,
 	const char *str);
+void *isl_union_map_to_binary(__isl_keep isl_union_map *umap, size_t *size);
+__isl_give isl_union_map *isl_union_map_from_binary(isl_ctx *ctx,
+	const void *buf, size_t size, size_t *used);
 __isl_give isl_printer *isl_printer_print_union_map(__isl_take isl_printer *p,
 	__isl_keep isl_union_map *umap);
 void isl_union_map_dump(__isl_keep isl_union_map *umap);
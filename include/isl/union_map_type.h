@@ -14,6 +14,9 @@ struct __isl_export isl_union_set;
 typedef struct isl_union_set isl_union_set;
 #endif
 
+struct isl_union_set_compiled;
+typedef struct isl_union_set_compiled isl_union_set_compiled;
+
 #if defined(__cplusplus)
 }
 #endif
@@ -13,8 +13,14 @@ __isl_give isl_union_set *isl_union_set_from_basic_set(
 	__isl_take isl_basic_set *bset);
 __isl_constructor
 __isl_give isl_union_set *isl_union_set_from_set(__isl_take isl_set *set);
+__isl_give isl_union_set *isl_union_set_from_set_list(
+	__isl_take isl_set_list *list);
 __isl_give isl_union_set *isl_union_set_empty(__isl_take isl_space *dim);
+__isl_give isl_union_set *isl_union_set_reserve(
+	__isl_take isl_union_set *uset, int n);
 __isl_give isl_union_set *isl_union_set_copy(__isl_keep isl_union_set *uset);
+__isl_give isl_union_set *isl_union_set_import(isl_ctx *ctx,
+	__isl_keep isl_union_set *uset);
 __isl_null isl_union_set *isl_union_set_free(__isl_take isl_union_set *uset);
 
 isl_ctx *isl_union_set_get_ctx(__isl_keep isl_union_set *uset);
@@ -30,6 +36,8 @@ __isl_give isl_set *isl_union_set_params(__isl_take isl_union_set *uset);
 __isl_export
 __isl_give isl_union_set *isl_union_set_detect_equalities(
 	__isl_take isl_union_set *uset);
+__isl_give isl_union_set *isl_union_set_compact(
+	__isl_take isl_union_set *uset);
 __isl_export
 __isl_give isl_union_set *isl_union_set_affine_hull(
 	__isl_take isl_union_set *uset);
@@ -96,9 +104,12 @@ int isl_union_set_is_strict_subset(__isl_keep isl_union_set *uset1,
 	__isl_keep isl_union_set *uset2);
 
 int isl_union_set_n_set(__isl_keep isl_union_set *uset);
+uint32_t isl_union_set_get_fingerprint(__isl_keep isl_union_set *uset);
 __isl_export
 int isl_union_set_foreach_set(__isl_keep isl_union_set *uset,
 	int (*fn)(__isl_take isl_set *set, void *user), void *user);
+int isl_union_set_foreach_set_peek(__isl_keep isl_union_set *uset,
+	int (*fn)(__isl_keep isl_set *set, void *user), void *user);
 __isl_give int isl_union_set_contains(__isl_keep isl_union_set *uset,
 	__isl_keep isl_space *dim);
 __isl_give isl_set *isl_union_set_extract_set(__isl_keep isl_union_set *uset,
@@ -107,6 +118,19 @@ __isl_give isl_set *isl_set_from_union_set(__isl_take isl_union_set *uset);
 int isl_union_set_foreach_point(__isl_keep isl_union_set *uset,
 	int (*fn)(__isl_take isl_point *pnt, void *user), void *user);
 
+__isl_give isl_union_set_compiled *isl_union_set_compile(
+	__isl_keep isl_union_set *uset);
+__isl_null isl_union_set_compiled *isl_union_set_compiled_free(
+	__isl_take isl_union_set_compiled *c);
+int isl_union_set_compiled_n_space(__isl_keep isl_union_set_compiled *c);
+int isl_union_set_compiled_find_space(__isl_keep isl_union_set_compiled *c,
+	__isl_keep isl_space *space);
+__isl_give isl_space *isl_union_set_compiled_get_space(
+	__isl_keep isl_union_set_compiled *c, int pos);
+int isl_union_set_compiled_dim(__isl_keep isl_union_set_compiled *c, int pos);
+int isl_union_set_compiled_contains(__isl_keep isl_union_set_compiled *c,
+	int pos, int n, const int64_t *points, int *contains);
+
 __isl_give isl_basic_set *isl_union_set_sample(__isl_take isl_union_set *uset);
 
 __isl_give isl_union_set *isl_union_set_lift(__isl_take isl_union_set *uset);
@@ -130,6 +154,9 @@ __isl_give isl_union_set *isl_union_set_read_from_file(isl_ctx *ctx,
 __isl_constructor
 __isl_give isl_union_set *isl_union_set_read_from_str(isl_ctx *ctx,
 	const char *str);
+void *isl_union_set_to_binary(__isl_keep isl_union_set *uset, size_t *size);
+__isl_give isl_union_set *isl_union_set_from_binary(isl_ctx *ctx,
+	const void *buf, size_t size, size_t *used);
 __isl_give isl_printer *isl_printer_print_union_set(__isl_take isl_printer *p,
 	__isl_keep isl_union_set *uset);
 void isl_union_set_dump(__isl_keep isl_union_set *uset);
@@ -3,6 +3,7 @@
 
 #include <isl/aff_type.h>
 #include <isl/set_type.h>
+#include <isl/constraint.h>
 
 #if defined(__cplusplus)
 extern "C" {
@@ -25,6 +26,9 @@ void isl_vertex_free(__isl_take isl_vertex *vertex);
 
 __isl_give isl_vertices *isl_basic_set_compute_vertices(
 	__isl_keep isl_basic_set *bset);
+__isl_give isl_vertices *isl_vertices_add_constraint(
+	__isl_take isl_vertices *vertices,
+	__isl_take isl_constraint *constraint);
 isl_ctx *isl_vertices_get_ctx(__isl_keep isl_vertices *vertices);
 int isl_vertices_get_n_vertices(__isl_keep isl_vertices *vertices);
 int isl_vertices_foreach_vertex(__isl_keep isl_vertices *vertices,
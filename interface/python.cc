@@ -92,6 +92,8 @@ struct isl_class {
 	void print(map<string, isl_class> &classes, set<string> &done);
 	void print_constructor(FunctionDecl *method);
 	void print_method(FunctionDecl *method, bool subclass, string super);
+	void print_foreach_list(FunctionDecl *method);
+	void print_constraint_arrays();
 };
 
 /* Return the class that has a name that matches the initial part
@@ -343,6 +345,96 @@ void isl_class::print_method(FunctionDecl *method, bool subclass, string super)
 	}
 }
 
+/* Is "method" a function of the form isl_<class>_foreach_<element>
+ * that calls its callback on objects of a single isl type?
+ */
+static bool is_foreach(FunctionDecl *method, const string &name)
+{
+	string fullname = method->getName();
+	string prefix = name + "_foreach_";
+	int num_params = method->getNumParams();
+
+	if (fullname.substr(0, prefix.length()) != prefix)
+		return false;
+	if (num_params != 3)
+		return false;
+
+	QualType type = method->getParamDecl(1)->getOriginalType();
+	if (!is_callback(type))
+		return false;
+	const FunctionProtoType *fn;
+	fn = type->getPointeeType()->getAs<FunctionProtoType>();
+	return fn->getNumArgs() == 2 && is_isl_type(fn->getArgType(0));
+}
+
+/* Print a python method that collects the objects on which
+ * the foreach function "method" calls its callback in a list.
+ * For isl_<class>_foreach_<element>, the method is called <element>_list.
+ *
+ * In contrast to the wrapper printed by print_callback,
+ * the callback only stores the raw pointers and cannot raise
+ * any exceptions.  The python objects are only constructed
+ * after the foreach function has returned.
+ */
+void isl_class::print_foreach_list(FunctionDecl *method)
+{
+	string fullname = method->getName();
+	string prefix = name + "_foreach_";
+	string list_name = fullname.substr(prefix.length()) + "_list";
+	string p_name = type2python(name);
+	QualType type = method->getParamDecl(1)->getOriginalType();
+	const FunctionProtoType *fn;
+	string el_type;
+
+	fn = type->getPointeeType()->getAs<FunctionProtoType>();
+	el_type = type2python(extract_type(fn->getArgType(0)));
+
+	printf("    def %s(arg0):\n", list_name.c_str());
+	printf("        if not arg0.__class__ is %s:\n", p_name.c_str());
+	printf("            arg0 = %s(arg0)\n", p_name.c_str());
+	printf("        ptrs = []\n");
+	printf("        fn = CFUNCTYPE(c_int, c_void_p, c_void_p)\n");
+	printf("        def cb_func(cb_arg0, cb_arg1):\n");
+	printf("            ptrs.append(cb_arg0)\n");
+	printf("            return 0\n");
+	printf("        cb = fn(cb_func)\n");
+	printf("        res = isl.%s(arg0.ptr, cb, None)\n", fullname.c_str());
+	printf("        list = [%s(ctx=arg0.ctx, ptr=ptr) for ptr in ptrs]\n",
+		el_type.c_str());
+	printf("        if res < 0:\n");
+	printf("            raise Error\n");
+	printf("        return list\n");
+}
+
+/* Print methods "equalities_array" and "inequalities_array"
+ * for basic sets and basic maps, returning a memoryview
+ * of the corresponding constraint matrix, extracted in a single call
+ * to isl_mat_get_elements_si.
+ * The columns of the matrix correspond to the parameters,
+ * the input and output or set dimensions, the existentially
+ * quantified variables and finally the constant term.
+ * The arguments below are the corresponding isl_dim_type values.
+ */
+void isl_class::print_constraint_arrays()
+{
+	const char *dims;
+	const char *kinds[] = { "equalities", "inequalities" };
+
+	if (name == "isl_basic_set")
+		dims = "1, 3, 4, 0";
+	else if (name == "isl_basic_map")
+		dims = "1, 2, 3, 4, 0";
+	else
+		return;
+
+	for (int i = 0; i < 2; ++i) {
+		printf("    def %s_array(arg0):\n", kinds[i]);
+		printf("        mat = isl.%s_%s_matrix(arg0.ptr, %s)\n",
+			name.c_str(), kinds[i], dims);
+		printf("        return mat_to_memoryview(mat)\n");
+	}
+}
+
 /* Print part of the constructor for this isl_class.
  *
  * In particular, check if the actual arguments correspond to the
@@ -405,7 +497,9 @@ void isl_class::print_constructor(FunctionDecl *cons)
  * was marked as a constructor.
  *
  * Next, we print out some common methods and the methods corresponding
- * to functions that are not marked as constructors.
+ * to functions that are not marked as constructors, along with
+ * the bulk variants of foreach functions and, for basic sets and
+ * basic maps, of the extraction of the constraint matrices.
  *
  * Finally, we tell ctypes about the types of the arguments of the
  * constructor functions and the return types of those function returning
@@ -448,8 +542,12 @@ void isl_class::print(map<string, isl_class> &classes, set<string> &done)
 	printf("    def __repr__(self):\n");
 	printf("        return 'isl.%s(\"%%s\")' %% str(self)\n", p_name.c_str());
 
-	for (in = methods.begin(); in != methods.end(); ++in)
+	for (in = methods.begin(); in != methods.end(); ++in) {
 		print_method(*in, subclass, super);
+		if (is_foreach(*in, name))
+			print_foreach_list(*in);
+	}
+	print_constraint_arrays();
 
 	printf("\n");
 	for (in = constructors.begin(); in != constructors.end(); ++in) {
@@ -477,6 +575,12 @@ void isl_class::print(map<string, isl_class> &classes, set<string> &done)
 		if (is_isl_type((*in)->getReturnType()))
 			printf("isl.%s.restype = c_void_p\n", fullname.c_str());
 	}
+	if (name == "isl_basic_set" || name == "isl_basic_map") {
+		printf("isl.%s_equalities_matrix.restype = c_void_p\n",
+			name.c_str());
+		printf("isl.%s_inequalities_matrix.restype = c_void_p\n",
+			name.c_str());
+	}
 	printf("isl.%s_free.argtypes = [c_void_p]\n", name.c_str());
 	printf("isl.%s_to_str.argtypes = [c_void_p]\n", name.c_str());
 	printf("isl.%s_to_str.restype = POINTER(c_char)\n", name.c_str());
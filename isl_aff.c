@@ -230,6 +230,36 @@ __isl_give isl_aff *isl_aff_dup(__isl_keep isl_aff *aff)
 				 isl_vec_copy(aff->v));
 }
 
+/* Return a copy of "aff" that is allocated in "ctx".
+ */
+__isl_give isl_aff *isl_aff_import(isl_ctx *ctx, __isl_keep isl_aff *aff)
+{
+	int i;
+	isl_local_space *ls;
+	isl_vec *v;
+
+	if (!aff)
+		return NULL;
+	if (isl_aff_get_ctx(aff) == ctx)
+		return isl_aff_copy(aff);
+
+	ls = isl_local_space_alloc(isl_space_import(ctx, aff->ls->dim),
+				    aff->ls->div->n_row);
+	v = isl_vec_alloc(ctx, aff->v->size);
+	if (!ls || !v)
+		goto error;
+	for (i = 0; i < aff->ls->div->n_row; ++i)
+		isl_seq_cpy(ls->div->row[i], aff->ls->div->row[i],
+				aff->ls->div->n_col);
+	isl_seq_cpy(v->el, aff->v->el, v->size);
+
+	return isl_aff_alloc_vec(ls, v);
+error:
+	isl_local_space_free(ls);
+	isl_vec_free(v);
+	return NULL;
+}
+
 __isl_give isl_aff *isl_aff_cow(__isl_take isl_aff *aff)
 {
 	if (!aff)
@@ -1690,12 +1720,18 @@ error:
 	return NULL;
 }
 
-/* Add two affine expressions that live in the same local space.
+/* Add "sign" times "aff2" to "aff1", where "sign" is either 1 or -1,
+ * for two affine expressions that live in the same local space.
+ *
+ * If the two expressions have the same denominator, e.g.,
+ * because both have integer coefficients, then the coefficients
+ * can simply be added or subtracted.
  */
 static __isl_give isl_aff *add_expanded(__isl_take isl_aff *aff1,
-	__isl_take isl_aff *aff2)
+	__isl_take isl_aff *aff2, int sign)
 {
 	isl_int gcd, f;
+	unsigned len;
 
 	aff1 = isl_aff_cow(aff1);
 	if (!aff1 || !aff2)
@@ -1705,13 +1741,28 @@ static __isl_give isl_aff *add_expanded(__isl_take isl_aff *aff1,
 	if (!aff1->v)
 		goto error;
 
+	len = aff1->v->size - 1;
+	if (isl_int_eq(aff1->v->el[0], aff2->v->el[0])) {
+		if (sign > 0)
+			isl_seq_addmul(aff1->v->el + 1, aff1->v->ctx->one,
+					aff2->v->el + 1, len);
+		else
+			isl_seq_submul(aff1->v->el + 1, aff1->v->ctx->one,
+					aff2->v->el + 1, len);
+		isl_aff_free(aff2);
+		return aff1;
+	}
+
 	isl_int_init(gcd);
 	isl_int_init(f);
 	isl_int_gcd(gcd, aff1->v->el[0], aff2->v->el[0]);
 	isl_int_divexact(f, aff2->v->el[0], gcd);
-	isl_seq_scale(aff1->v->el + 1, aff1->v->el + 1, f, aff1->v->size - 1);
+	isl_seq_scale(aff1->v->el + 1, aff1->v->el + 1, f, len);
 	isl_int_divexact(f, aff1->v->el[0], gcd);
-	isl_seq_addmul(aff1->v->el + 1, f, aff2->v->el + 1, aff1->v->size - 1);
+	if (sign > 0)
+		isl_seq_addmul(aff1->v->el + 1, f, aff2->v->el + 1, len);
+	else
+		isl_seq_submul(aff1->v->el + 1, f, aff2->v->el + 1, len);
 	isl_int_divexact(f, aff2->v->el[0], gcd);
 	isl_int_mul(aff1->v->el[0], aff1->v->el[0], f);
 	isl_int_clear(f);
@@ -1725,18 +1776,24 @@ error:
 	return NULL;
 }
 
-/* Return the sum of "aff1" and "aff2".
+/* Return the sum of "aff1" and "sign" times "aff2",
+ * where "sign" is either 1 or -1.
  *
  * If either of the two is NaN, then the result is NaN.
+ * If the two already have the same integer divisions,
+ * e.g., because they have been aligned before or
+ * because neither has any integer divisions,
+ * then there is no need to merge the integer divisions.
  */
-__isl_give isl_aff *isl_aff_add(__isl_take isl_aff *aff1,
-	__isl_take isl_aff *aff2)
+static __isl_give isl_aff *aff_add(__isl_take isl_aff *aff1,
+	__isl_take isl_aff *aff2, int sign)
 {
 	isl_ctx *ctx;
 	int *exp1 = NULL;
 	int *exp2 = NULL;
 	isl_mat *div;
 	int n_div1, n_div2;
+	int equal;
 
 	if (!aff1 || !aff2)
 		goto error;
@@ -1755,10 +1812,14 @@ __isl_give isl_aff *isl_aff_add(__isl_take isl_aff *aff1,
 		return aff2;
 	}
 
+	equal = isl_local_space_has_equal_divs(aff1->ls, aff2->ls);
+	if (equal < 0)
+		goto error;
+	if (equal)
+		return add_expanded(aff1, aff2, sign);
+
 	n_div1 = isl_aff_dim(aff1, isl_dim_div);
 	n_div2 = isl_aff_dim(aff2, isl_dim_div);
-	if (n_div1 == 0 && n_div2 == 0)
-		return add_expanded(aff1, aff2);
 
 	exp1 = isl_alloc_array(ctx, int, n_div1);
 	exp2 = isl_alloc_array(ctx, int, n_div2);
@@ -1771,7 +1832,7 @@ __isl_give isl_aff *isl_aff_add(__isl_take isl_aff *aff1,
 	free(exp1);
 	free(exp2);
 
-	return add_expanded(aff1, aff2);
+	return add_expanded(aff1, aff2, sign);
 error:
 	free(exp1);
 	free(exp2);
@@ -1780,10 +1841,20 @@ error:
 	return NULL;
 }
 
+__isl_give isl_aff *isl_aff_add(__isl_take isl_aff *aff1,
+	__isl_take isl_aff *aff2)
+{
+	return aff_add(aff1, aff2, 1);
+}
+
+/* Return the difference of "aff1" and "aff2".
+ * The coefficients of "aff2" are subtracted directly,
+ * without constructing the negation of "aff2".
+ */
 __isl_give isl_aff *isl_aff_sub(__isl_take isl_aff *aff1,
 	__isl_take isl_aff *aff2)
 {
-	return isl_aff_add(aff1, isl_aff_neg(aff2));
+	return aff_add(aff1, aff2, -1);
 }
 
 /* Return the result of scaling "aff" by a factor of "f".
@@ -2508,6 +2579,9 @@ error:
  * of those of pwaff1 and pwaff2.  If only one of pwaff1 or pwaff2
  * is defined on a given cell, then the associated expression
  * is the defined one.
+ *
+ * Pairs of pieces with obviously disjoint domains are skipped
+ * without computing their intersection.
  */
 static __isl_give isl_pw_aff *pw_aff_union_opt(__isl_take isl_pw_aff *pwaff1,
 	__isl_take isl_pw_aff *pwaff2,
@@ -2518,6 +2592,7 @@ static __isl_give isl_pw_aff *pw_aff_union_opt(__isl_take isl_pw_aff *pwaff1,
 	isl_pw_aff *res;
 	isl_ctx *ctx;
 	isl_set *set;
+	struct isl_map_plain_boxes *boxes1 = NULL, *boxes2 = NULL;
 
 	if (!pwaff1 || !pwaff2)
 		goto error;
@@ -2537,6 +2612,11 @@ static __isl_give isl_pw_aff *pw_aff_union_opt(__isl_take isl_pw_aff *pwaff1,
 		return pwaff1;
 	}
 
+	boxes1 = isl_pw_aff_plain_boxes(pwaff1);
+	boxes2 = isl_pw_aff_plain_boxes(pwaff2);
+	if (!boxes1 || !boxes2)
+		goto error;
+
 	n = 2 * (pwaff1->n + 1) * (pwaff2->n + 1);
 	res = isl_pw_aff_alloc_size(isl_space_copy(pwaff1->dim), n);
 
@@ -2546,6 +2626,9 @@ static __isl_give isl_pw_aff *pw_aff_union_opt(__isl_take isl_pw_aff *pwaff1,
 			struct isl_set *common;
 			isl_set *better;
 
+			if (isl_pw_aff_pieces_plain_disjoint(ctx, boxes1, i,
+								boxes2, j))
+				continue;
 			common = isl_set_intersect(
 					isl_set_copy(pwaff1->p[i].set),
 					isl_set_copy(pwaff2->p[j].set));
@@ -2568,18 +2651,26 @@ static __isl_give isl_pw_aff *pw_aff_union_opt(__isl_take isl_pw_aff *pwaff1,
 
 	for (j = 0; j < pwaff2->n; ++j) {
 		set = isl_set_copy(pwaff2->p[j].set);
-		for (i = 0; i < pwaff1->n; ++i)
+		for (i = 0; i < pwaff1->n; ++i) {
+			if (isl_map_plain_boxes_is_disjoint(boxes1, i,
+							    boxes2, j))
+				continue;
 			set = isl_set_subtract(set,
 					isl_set_copy(pwaff1->p[i].set));
+		}
 		res = isl_pw_aff_add_piece(res, set,
 						isl_aff_copy(pwaff2->p[j].aff));
 	}
 
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
 	isl_pw_aff_free(pwaff1);
 	isl_pw_aff_free(pwaff2);
 
 	return res;
 error:
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
 	isl_pw_aff_free(pwaff1);
 	isl_pw_aff_free(pwaff2);
 	return NULL;
@@ -3389,18 +3480,125 @@ error:
 	return NULL;
 }
 
+/* Return the difference between "aff2" and "aff1" if "max" is not set
+ * and the difference between "aff1" and "aff2" if "max" is set.
+ * That is, return an expression that is non-negative where
+ * "aff1" is at least as good as "aff2".
+ */
+static __isl_give isl_aff *aff_opt_diff(__isl_keep isl_aff *aff1,
+	__isl_keep isl_aff *aff2, int max)
+{
+	if (max)
+		return isl_aff_sub(isl_aff_copy(aff1), isl_aff_copy(aff2));
+	else
+		return isl_aff_sub(isl_aff_copy(aff2), isl_aff_copy(aff1));
+}
+
+/* Compute a piecewise quasi-affine expression with a domain that
+ * is the intersection of those of pwaff1 and pwaff2 and such that
+ * on each cell, the quasi-affine expression is the minimum
+ * (if "max" is not set) or the maximum (if "max" is set)
+ * of those of pwaff1 and pwaff2.  Where both are equal,
+ * the expression of pwaff1 is used.
+ *
+ * The pieces of pwaff1 and pwaff2 are compared pairwise,
+ * but only on the intersection of their domains.
+ * Pairs of pieces with obviously disjoint domains are skipped
+ * without computing their intersection.
+ * If the difference between the two expressions is a constant,
+ * then one of them is better on the entire intersection and
+ * no comparison set needs to be constructed.
+ */
+static __isl_give isl_pw_aff *pw_aff_opt(__isl_take isl_pw_aff *pwaff1,
+	__isl_take isl_pw_aff *pwaff2, int max)
+{
+	int i, j, n;
+	isl_pw_aff *res;
+	isl_ctx *ctx;
+	struct isl_map_plain_boxes *boxes1 = NULL, *boxes2 = NULL;
+
+	if (!pwaff1 || !pwaff2)
+		goto error;
+
+	ctx = isl_space_get_ctx(pwaff1->dim);
+	if (!isl_space_is_equal(pwaff1->dim, pwaff2->dim))
+		isl_die(ctx, isl_error_invalid,
+			"arguments should live in same space", goto error);
+
+	boxes1 = isl_pw_aff_plain_boxes(pwaff1);
+	boxes2 = isl_pw_aff_plain_boxes(pwaff2);
+	if (!boxes1 || !boxes2)
+		goto error;
+
+	n = 2 * pwaff1->n * pwaff2->n;
+	res = isl_pw_aff_alloc_size(isl_space_copy(pwaff1->dim), n);
+
+	for (i = 0; i < pwaff1->n; ++i) {
+		for (j = 0; j < pwaff2->n; ++j) {
+			isl_set *common, *better;
+			isl_aff *diff;
+			int rational;
+
+			if (isl_pw_aff_pieces_plain_disjoint(ctx, boxes1, i,
+								boxes2, j))
+				continue;
+			common = isl_set_intersect(
+					isl_set_copy(pwaff1->p[i].set),
+					isl_set_copy(pwaff2->p[j].set));
+			if (isl_set_plain_is_empty(common)) {
+				isl_set_free(common);
+				continue;
+			}
+			diff = aff_opt_diff(pwaff1->p[i].aff,
+					    pwaff2->p[j].aff, max);
+			if (!diff) {
+				isl_set_free(common);
+				goto error_res;
+			}
+			if (!isl_aff_is_nan(diff) && isl_aff_is_cst(diff)) {
+				isl_aff *aff;
+
+				if (isl_int_is_nonneg(diff->v->el[1]))
+					aff = pwaff1->p[i].aff;
+				else
+					aff = pwaff2->p[j].aff;
+				isl_aff_free(diff);
+				res = isl_pw_aff_add_piece(res, common,
+							isl_aff_copy(aff));
+				continue;
+			}
+			rational = isl_set_has_rational(common);
+			better = isl_set_from_basic_set(
+					aff_nonneg_basic_set(diff, rational));
+			better = isl_set_intersect(better, isl_set_copy(common));
+			common = isl_set_subtract(common, isl_set_copy(better));
+			res = isl_pw_aff_add_piece(res, better,
+					isl_aff_copy(pwaff1->p[i].aff));
+			res = isl_pw_aff_add_piece(res, common,
+					isl_aff_copy(pwaff2->p[j].aff));
+		}
+	}
+
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
+	isl_pw_aff_free(pwaff1);
+	isl_pw_aff_free(pwaff2);
+
+	return res;
+error_res:
+	isl_pw_aff_free(res);
+error:
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
+	isl_pw_aff_free(pwaff1);
+	isl_pw_aff_free(pwaff2);
+	return NULL;
+}
+
 static __isl_give isl_pw_aff *pw_aff_min(__isl_take isl_pw_aff *pwaff1,
 	__isl_take isl_pw_aff *pwaff2)
 {
-	isl_set *le;
-	isl_set *dom;
-
-	dom = isl_set_intersect(isl_pw_aff_domain(isl_pw_aff_copy(pwaff1)),
-				isl_pw_aff_domain(isl_pw_aff_copy(pwaff2)));
-	le = isl_pw_aff_le_set(isl_pw_aff_copy(pwaff1),
-				isl_pw_aff_copy(pwaff2));
-	dom = isl_set_subtract(dom, isl_set_copy(le));
-	return isl_pw_aff_select(le, pwaff1, dom, pwaff2);
+	return pw_aff_opt(pwaff1, pwaff2, 0);
 }
 
 __isl_give isl_pw_aff *isl_pw_aff_min(__isl_take isl_pw_aff *pwaff1,
@@ -3412,15 +3610,7 @@ __isl_give isl_pw_aff *isl_pw_aff_min(__isl_take isl_pw_aff *pwaff1,
 static __isl_give isl_pw_aff *pw_aff_max(__isl_take isl_pw_aff *pwaff1,
 	__isl_take isl_pw_aff *pwaff2)
 {
-	isl_set *ge;
-	isl_set *dom;
-
-	dom = isl_set_intersect(isl_pw_aff_domain(isl_pw_aff_copy(pwaff1)),
-				isl_pw_aff_domain(isl_pw_aff_copy(pwaff2)));
-	ge = isl_pw_aff_ge_set(isl_pw_aff_copy(pwaff1),
-				isl_pw_aff_copy(pwaff2));
-	dom = isl_set_subtract(dom, isl_set_copy(ge));
-	return isl_pw_aff_select(ge, pwaff1, dom, pwaff2);
+	return pw_aff_opt(pwaff1, pwaff2, 1);
 }
 
 __isl_give isl_pw_aff *isl_pw_aff_max(__isl_take isl_pw_aff *pwaff1,
@@ -3429,10 +3619,96 @@ __isl_give isl_pw_aff *isl_pw_aff_max(__isl_take isl_pw_aff *pwaff1,
 	return isl_pw_aff_align_params_pw_pw_and(pwaff1, pwaff2, &pw_aff_max);
 }
 
-static __isl_give isl_pw_aff *pw_aff_list_reduce(
-	__isl_take isl_pw_aff_list *list,
-	__isl_give isl_pw_aff *(*fn)(__isl_take isl_pw_aff *pwaff1,
-					__isl_take isl_pw_aff *pwaff2))
+/* Is "pwaff1" obviously at least as good as "pwaff2"
+ * everywhere, where "better" means smaller if "max" is not set and
+ * larger if "max" is set?
+ *
+ * This is only checked for a pair of piecewise quasi-affine expressions
+ * that have obviously the same domains and that differ
+ * by a constant of the right sign on each piece.
+ * In particular, the domain of the minimum or maximum of pwaff1
+ * and pwaff2 is then equal to the domain of pwaff1, such that
+ * pwaff2 can simply be dropped.
+ */
+static int pw_aff_plain_dominates(__isl_keep isl_pw_aff *pwaff1,
+	__isl_keep isl_pw_aff *pwaff2, int max)
+{
+	int i;
+
+	if (!pwaff1 || !pwaff2)
+		return -1;
+	if (pwaff1->n != pwaff2->n)
+		return 0;
+	if (!isl_space_is_equal(pwaff1->dim, pwaff2->dim))
+		return 0;
+
+	for (i = 0; i < pwaff1->n; ++i) {
+		isl_aff *diff;
+		int equal, dominates;
+
+		equal = isl_set_plain_is_equal(pwaff1->p[i].set,
+						pwaff2->p[i].set);
+		if (equal < 0 || !equal)
+			return equal;
+		diff = aff_opt_diff(pwaff1->p[i].aff, pwaff2->p[i].aff, max);
+		if (!diff)
+			return -1;
+		dominates = !isl_aff_is_nan(diff) && isl_aff_is_cst(diff) &&
+			    isl_int_is_nonneg(diff->v->el[1]);
+		isl_aff_free(diff);
+		if (!dominates)
+			return 0;
+	}
+
+	return 1;
+}
+
+/* Remove the elements from "list" that are obviously dominated
+ * by some other element in the list, where "better" means
+ * smaller if "max" is not set and larger if "max" is set.
+ * Of two elements that obviously dominate each other
+ * (because they are equal), the first is kept.
+ */
+static __isl_give isl_pw_aff_list *pw_aff_list_drop_dominated(
+	__isl_take isl_pw_aff_list *list, int max)
+{
+	int i, j;
+
+	if (!list)
+		return NULL;
+
+	for (i = list->n - 1; i >= 0; --i) {
+		for (j = 0; j < list->n; ++j) {
+			int dominated;
+
+			if (j == i)
+				continue;
+			dominated = pw_aff_plain_dominates(list->p[j],
+							list->p[i], max);
+			if (dominated < 0)
+				return isl_pw_aff_list_free(list);
+			if (dominated)
+				break;
+		}
+		if (j < list->n)
+			list = isl_pw_aff_list_drop(list, i, 1);
+		if (!list)
+			return NULL;
+	}
+
+	return list;
+}
+
+/* Return an isl_pw_aff that maps each element in the intersection of the
+ * domains of the elements of list to the minimal (if "max" is not set)
+ * or maximal (if "max" is set) corresponding affine expression.
+ *
+ * The elements that are obviously dominated by other elements
+ * are removed first, such that the remaining elements
+ * only need to be compared to each other.
+ */
+static __isl_give isl_pw_aff *pw_aff_list_opt(
+	__isl_take isl_pw_aff_list *list, int max)
 {
 	int i;
 	isl_ctx *ctx;
@@ -3446,9 +3722,19 @@ static __isl_give isl_pw_aff *pw_aff_list_reduce(
 		isl_die(ctx, isl_error_invalid,
 			"list should contain at least one element", goto error);
 
+	list = pw_aff_list_drop_dominated(list, max);
+	if (!list)
+		return NULL;
+
 	res = isl_pw_aff_copy(list->p[0]);
-	for (i = 1; i < list->n; ++i)
-		res = fn(res, isl_pw_aff_copy(list->p[i]));
+	for (i = 1; i < list->n; ++i) {
+		isl_pw_aff *pa = isl_pw_aff_copy(list->p[i]);
+
+		if (max)
+			res = isl_pw_aff_max(res, pa);
+		else
+			res = isl_pw_aff_min(res, pa);
+	}
 
 	isl_pw_aff_list_free(list);
 	return res;
@@ -3463,7 +3749,7 @@ error:
  */
 __isl_give isl_pw_aff *isl_pw_aff_list_min(__isl_take isl_pw_aff_list *list)
 {
-	return pw_aff_list_reduce(list, &isl_pw_aff_min);
+	return pw_aff_list_opt(list, 0);
 }
 
 /* Return an isl_pw_aff that maps each element in the intersection of the
@@ -3472,7 +3758,7 @@ __isl_give isl_pw_aff *isl_pw_aff_list_min(__isl_take isl_pw_aff_list *list)
  */
 __isl_give isl_pw_aff *isl_pw_aff_list_max(__isl_take isl_pw_aff_list *list)
 {
-	return pw_aff_list_reduce(list, &isl_pw_aff_max);
+	return pw_aff_list_opt(list, 1);
 }
 
 /* Mark the domains of "pwaff" as rational.
@@ -3584,6 +3870,28 @@ error:
 #undef NO_DOMAIN
 #undef NO_INTERSECT_DOMAIN
 
+/* Return a copy of "ma" that is allocated in "ctx".
+ * See isl_aff_import.
+ */
+__isl_give isl_multi_aff *isl_multi_aff_import(isl_ctx *ctx,
+	__isl_keep isl_multi_aff *ma)
+{
+	int i;
+	isl_multi_aff *res;
+
+	if (!ma)
+		return NULL;
+	if (isl_multi_aff_get_ctx(ma) == ctx)
+		return isl_multi_aff_copy(ma);
+
+	res = isl_multi_aff_alloc(isl_space_import(ctx, ma->space));
+	for (i = 0; i < ma->n; ++i)
+		res = isl_multi_aff_set_aff(res, i,
+					    isl_aff_import(ctx, ma->p[i]));
+
+	return res;
+}
+
 /* Remove any internal structure of the domain of "ma".
  * If there is any such internal structure in the input,
  * then the name of the corresponding space is also removed.
@@ -3961,6 +4269,30 @@ __isl_give isl_set *isl_multi_aff_lex_ge_set(__isl_take isl_multi_aff *ma1,
 
 #include <isl_union_templ.c>
 
+/* Return a copy of "pma" that is allocated in "ctx".
+ * See isl_aff_import.
+ */
+__isl_give isl_pw_multi_aff *isl_pw_multi_aff_import(isl_ctx *ctx,
+	__isl_keep isl_pw_multi_aff *pma)
+{
+	int i;
+	isl_pw_multi_aff *res;
+
+	if (!pma)
+		return NULL;
+	if (isl_pw_multi_aff_get_ctx(pma) == ctx)
+		return isl_pw_multi_aff_copy(pma);
+
+	res = isl_pw_multi_aff_alloc_size(isl_space_import(ctx, pma->dim),
+					  pma->n);
+	for (i = 0; i < pma->n; ++i)
+		res = isl_pw_multi_aff_add_piece(res,
+				isl_set_import(ctx, pma->p[i].set),
+				isl_multi_aff_import(ctx, pma->p[i].maff));
+
+	return res;
+}
+
 /* Given a function "cmp" that returns the set of elements where
  * "ma1" is "better" than "ma2", return the intersection of this
  * set with "dom1" and "dom2".
@@ -3993,6 +4325,9 @@ static __isl_give isl_set *shared_and_better(__isl_keep isl_set *dom1,
  * of "pma1" and "pma2" that maps to the "best" of "pma1" and
  * "pma2" on each cell.  If only one of the two input functions
  * is defined on a given cell, then it is considered the best.
+ *
+ * Pairs of pieces with obviously disjoint domains are skipped
+ * without computing their intersection.
  */
 static __isl_give isl_pw_multi_aff *pw_multi_aff_union_opt(
 	__isl_take isl_pw_multi_aff *pma1,
@@ -4004,6 +4339,7 @@ static __isl_give isl_pw_multi_aff *pw_multi_aff_union_opt(
 	isl_pw_multi_aff *res = NULL;
 	isl_ctx *ctx;
 	isl_set *set = NULL;
+	struct isl_map_plain_boxes *boxes1 = NULL, *boxes2 = NULL;
 
 	if (!pma1 || !pma2)
 		goto error;
@@ -4023,6 +4359,11 @@ static __isl_give isl_pw_multi_aff *pw_multi_aff_union_opt(
 		return pma1;
 	}
 
+	boxes1 = isl_pw_multi_aff_plain_boxes(pma1);
+	boxes2 = isl_pw_multi_aff_plain_boxes(pma2);
+	if (!boxes1 || !boxes2)
+		goto error;
+
 	n = 2 * (pma1->n + 1) * (pma2->n + 1);
 	res = isl_pw_multi_aff_alloc_size(isl_space_copy(pma1->dim), n);
 
@@ -4032,6 +4373,9 @@ static __isl_give isl_pw_multi_aff *pw_multi_aff_union_opt(
 			isl_set *better;
 			int is_empty;
 
+			if (isl_pw_multi_aff_pieces_plain_disjoint(ctx,
+						boxes1, i, boxes2, j))
+				continue;
 			better = shared_and_better(pma2->p[j].set,
 					pma1->p[i].set, pma2->p[j].maff,
 					pma1->p[i].maff, cmp);
@@ -4053,18 +4397,26 @@ static __isl_give isl_pw_multi_aff *pw_multi_aff_union_opt(
 
 	for (j = 0; j < pma2->n; ++j) {
 		set = isl_set_copy(pma2->p[j].set);
-		for (i = 0; i < pma1->n; ++i)
+		for (i = 0; i < pma1->n; ++i) {
+			if (isl_map_plain_boxes_is_disjoint(boxes1, i,
+							    boxes2, j))
+				continue;
 			set = isl_set_subtract(set,
 					isl_set_copy(pma1->p[i].set));
+		}
 		res = isl_pw_multi_aff_add_piece(res, set,
 					isl_multi_aff_copy(pma2->p[j].maff));
 	}
 
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
 	isl_pw_multi_aff_free(pma1);
 	isl_pw_multi_aff_free(pma2);
 
 	return res;
 error:
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
 	isl_pw_multi_aff_free(pma1);
 	isl_pw_multi_aff_free(pma2);
 	isl_set_free(set);
@@ -5294,6 +5646,7 @@ __isl_give isl_multi_aff *isl_multi_aff_pullback_multi_aff(
 
 /* Extend the local space of "dst" to include the divs
  * in the local space of "src".
+ * There is nothing to do if "dst" already has the same divs as "src".
  */
 __isl_give isl_aff *isl_aff_align_divs(__isl_take isl_aff *dst,
 	__isl_keep isl_aff *src)
@@ -5302,6 +5655,7 @@ __isl_give isl_aff *isl_aff_align_divs(__isl_take isl_aff *dst,
 	int *exp1 = NULL;
 	int *exp2 = NULL;
 	isl_mat *div;
+	int equal;
 
 	if (!src || !dst)
 		return isl_aff_free(dst);
@@ -5313,6 +5667,11 @@ __isl_give isl_aff *isl_aff_align_divs(__isl_take isl_aff *dst,
 
 	if (src->ls->div->n_row == 0)
 		return dst;
+	equal = isl_local_space_has_equal_divs(src->ls, dst->ls);
+	if (equal < 0)
+		return isl_aff_free(dst);
+	if (equal)
+		return dst;
 
 	exp1 = isl_alloc_array(ctx, int, src->ls->div->n_row);
 	exp2 = isl_alloc_array(ctx, int, dst->ls->div->n_row);
@@ -0,0 +1,300 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <isl_ctx_private.h>
+#include <isl_mat_private.h>
+#include <isl_vec_private.h>
+#include <isl_aff_private.h>
+#include <isl_local_space_private.h>
+#include <isl_seq.h>
+#include <isl_compile_private.h>
+
+/* A piece of a compiled piecewise multi-affine expression.
+ * The domain of piece i is set i of the compiled domain.
+ * The affine expressions are stored in rows "first_aff" up to
+ * "first_aff" + n_out of the affine expression table.
+ */
+struct isl_compiled_multi_aff {
+	int first_aff;
+};
+
+/* A piecewise multi-affine expression that has been compiled into
+ * flat tables for fast evaluation.
+ *
+ * "dom" contains the domains of all pieces, along with all
+ * integer divisions that appear in the domains or in the affine
+ * expressions.
+ * "aff" contains rows of length 2 + n_in + dom->n_div, each holding
+ * the denominator, the constant term and the coefficients
+ * of the inputs and the integer divisions of "dom".
+ * During construction, these rows are kept in "aff_mat" instead.
+ */
+struct isl_pw_multi_aff_compiled {
+	struct isl_compiled_domain *dom;
+
+	int n_out;
+
+	int n_piece;
+	int size_piece;
+	struct isl_compiled_multi_aff *piece;
+
+	int64_t *aff;
+	isl_mat *aff_mat;
+};
+
+__isl_null isl_pw_multi_aff_compiled *isl_pw_multi_aff_compiled_free(
+	__isl_take isl_pw_multi_aff_compiled *c)
+{
+	if (!c)
+		return NULL;
+
+	isl_compiled_domain_free(c->dom);
+	free(c->piece);
+	free(c->aff);
+	isl_mat_free(c->aff_mat);
+	free(c);
+
+	return NULL;
+}
+
+/* Return the number of inputs (type isl_dim_in) or outputs
+ * (type isl_dim_out) of each point passed
+ * to isl_pw_multi_aff_compiled_eval.
+ * The inputs consist of the parameters followed by the input dimensions
+ * of the original expression.
+ */
+int isl_pw_multi_aff_compiled_dim(__isl_keep isl_pw_multi_aff_compiled *c,
+	enum isl_dim_type type)
+{
+	if (!c)
+		return -1;
+	if (type == isl_dim_in)
+		return c->dom->n_in;
+	if (type == isl_dim_out)
+		return c->n_out;
+	isl_die(c->dom->ctx, isl_error_invalid,
+		"only input and output dimensions can be queried", return -1);
+}
+
+/* Append the affine expression "aff" to c->aff_mat.
+ */
+static int add_aff(isl_pw_multi_aff_compiled *c, __isl_keep isl_aff *aff)
+{
+	isl_mat *div;
+	int *map;
+	int j, n_in, n_div, row;
+
+	if (!aff)
+		return -1;
+	if (isl_int_is_zero(aff->v->el[0]))
+		isl_die(c->dom->ctx, isl_error_invalid,
+			"cannot compile NaN", return -1);
+
+	n_in = c->dom->n_in;
+	div = aff->ls->div;
+	n_div = div->n_row;
+	map = isl_alloc_array(c->dom->ctx, int, n_div);
+	if (n_div && !map)
+		return -1;
+	if (isl_compiled_domain_map_divs(c->dom, div, map) < 0)
+		goto error;
+
+	row = c->aff_mat->n_row;
+	c->aff_mat = isl_compiled_domain_extend(c->dom, c->aff_mat, 2 + n_in);
+	c->aff_mat = isl_mat_add_zero_rows(c->aff_mat, 1);
+	if (!c->aff_mat)
+		goto error;
+	isl_seq_cpy(c->aff_mat->row[row], aff->v->el, 2 + n_in);
+	for (j = 0; j < n_div; ++j)
+		isl_int_set(c->aff_mat->row[row][2 + n_in + map[j]],
+			    aff->v->el[2 + n_in + j]);
+
+	free(map);
+	return 0;
+error:
+	free(map);
+	return -1;
+}
+
+/* Add the piece with domain "set" and multi-affine expression "maff"
+ * to "c".
+ */
+static int add_piece(__isl_take isl_set *set, __isl_take isl_multi_aff *maff,
+	void *user)
+{
+	isl_pw_multi_aff_compiled *c = user;
+	struct isl_compiled_multi_aff *cp;
+	int i;
+
+	if (!set || !maff)
+		goto error;
+	if (c->n_piece >= c->size_piece) {
+		c->size_piece = 2 * c->size_piece + 4;
+		c->piece = isl_realloc_array(c->dom->ctx, c->piece,
+				struct isl_compiled_multi_aff, c->size_piece);
+		if (!c->piece)
+			goto error;
+	}
+
+	cp = &c->piece[c->n_piece++];
+	cp->first_aff = c->aff_mat->n_row;
+
+	if (isl_compiled_domain_add_set(c->dom, set) < 0)
+		goto error_maff;
+
+	for (i = 0; i < maff->n; ++i)
+		if (add_aff(c, maff->p[i]) < 0)
+			goto error_maff;
+
+	isl_multi_aff_free(maff);
+	return 0;
+error:
+	isl_set_free(set);
+error_maff:
+	isl_multi_aff_free(maff);
+	return -1;
+}
+
+/* Compile "pma" into flat tables that allow for the evaluation
+ * of "pma" on many integer points without using any isl objects.
+ *
+ * Each piece is represented by the constraints of the basic sets
+ * in its domain and by the coefficients of its affine expressions.
+ * All integer divisions that appear in any of the domains or
+ * affine expressions are collected in a single table,
+ * such that they can be evaluated once per point.
+ * Compilation fails if any of the coefficients does not fit in 64 bits.
+ */
+__isl_give isl_pw_multi_aff_compiled *isl_pw_multi_aff_compile(
+	__isl_keep isl_pw_multi_aff *pma)
+{
+	isl_ctx *ctx;
+	isl_pw_multi_aff_compiled *c;
+	int n_in;
+
+	if (!pma)
+		return NULL;
+
+	ctx = isl_pw_multi_aff_get_ctx(pma);
+	c = isl_calloc_type(ctx, isl_pw_multi_aff_compiled);
+	if (!c)
+		return NULL;
+	n_in = isl_pw_multi_aff_dim(pma, isl_dim_param) +
+		isl_pw_multi_aff_dim(pma, isl_dim_in);
+	c->n_out = isl_pw_multi_aff_dim(pma, isl_dim_out);
+	c->dom = isl_compiled_domain_alloc(ctx, n_in);
+	c->aff_mat = isl_mat_alloc(ctx, 0, 2 + n_in);
+	if (!c->dom || !c->aff_mat)
+		return isl_pw_multi_aff_compiled_free(c);
+
+	if (isl_pw_multi_aff_foreach_piece(pma, &add_piece, c) < 0)
+		return isl_pw_multi_aff_compiled_free(c);
+	c->aff_mat = isl_compiled_domain_extend(c->dom, c->aff_mat, 2 + n_in);
+	if (isl_compiled_domain_finalize(c->dom) < 0)
+		return isl_pw_multi_aff_compiled_free(c);
+	c->aff = isl_compiled_mat_to_int64(c->aff_mat);
+	if (!c->aff)
+		return isl_pw_multi_aff_compiled_free(c);
+	c->aff_mat = isl_mat_free(c->aff_mat);
+
+	return c;
+}
+
+/* Compile "pa" into a piecewise multi-affine expression
+ * with a single output.
+ */
+__isl_give isl_pw_multi_aff_compiled *isl_pw_aff_compile(
+	__isl_keep isl_pw_aff *pa)
+{
+	isl_pw_multi_aff *pma;
+	isl_pw_multi_aff_compiled *c;
+
+	pma = isl_pw_multi_aff_from_pw_aff(isl_pw_aff_copy(pa));
+	c = isl_pw_multi_aff_compile(pma);
+	isl_pw_multi_aff_free(pma);
+
+	return c;
+}
+
+/* Evaluate the affine expressions of piece "cp" of "c"
+ * at the values "val", storing the results in "out".
+ */
+static int eval_piece(__isl_keep isl_pw_multi_aff_compiled *c,
+	struct isl_compiled_multi_aff *cp, const int64_t *val, int64_t *out)
+{
+	int j, len, n_val;
+
+	n_val = c->dom->n_in + c->dom->n_div;
+	len = 2 + n_val;
+	for (j = 0; j < c->n_out; ++j) {
+		int64_t *row = c->aff + (cp->first_aff + j) * len;
+		int64_t v;
+
+		if (isl_compiled_affine_int64(c->dom->ctx, row + 1, val,
+						n_val, &v) < 0)
+			return -1;
+		if (v % row[0] != 0)
+			isl_die(c->dom->ctx, isl_error_invalid,
+				"non-integral value", return -1);
+		out[j] = v / row[0];
+	}
+
+	return 0;
+}
+
+/* Evaluate the compiled piecewise multi-affine expression "c"
+ * at the "n" points in "points", each consisting of
+ * isl_pw_multi_aff_compiled_dim(c, isl_dim_in) values,
+ * storing the isl_pw_multi_aff_compiled_dim(c, isl_dim_out) results
+ * for each point in "values".
+ *
+ * If "defined" is not NULL, then defined[i] is set to 1 if point i
+ * lies in the domain and to 0 otherwise.  In the latter case,
+ * the corresponding values are left untouched.
+ * If "defined" is NULL, then it is an error for a point
+ * to lie outside the domain.
+ * All computations are performed exactly on 64 bit integers and
+ * an error is reported if any of them overflows or if any of the results
+ * is not integral.
+ */
+int isl_pw_multi_aff_compiled_eval(__isl_keep isl_pw_multi_aff_compiled *c,
+	int n, const int64_t *points, int64_t *values, int *defined)
+{
+	struct isl_compiled_domain *dom;
+	int i, p;
+	int64_t *val;
+	int n_val;
+
+	if (!c)
+		return -1;
+
+	dom = c->dom;
+	n_val = dom->n_in + dom->n_div;
+	val = isl_alloc_array(dom->ctx, int64_t, n_val);
+	if (n_val && !val)
+		return -1;
+
+	for (i = 0; i < n; ++i) {
+		const int64_t *pnt = points + (size_t) i * dom->n_in;
+		int64_t *out = values + (size_t) i * c->n_out;
+
+		if (isl_compiled_domain_eval_divs_int64(dom, pnt, val) < 0)
+			goto error;
+		if (isl_compiled_domain_locate_int64(dom, val, &p) < 0)
+			goto error;
+		if (p >= 0 && eval_piece(c, &c->piece[p], val, out) < 0)
+			goto error;
+		if (defined)
+			defined[i] = p >= 0;
+		else if (p < 0)
+			isl_die(dom->ctx, isl_error_invalid,
+				"point outside domain", goto error);
+	}
+
+	free(val);
+	return 0;
+error:
+	free(val);
+	return -1;
+}
@@ -65,6 +65,9 @@ struct isl_pw_multi_aff {
 __isl_give isl_aff *isl_aff_alloc_vec(__isl_take isl_local_space *ls,
 	__isl_take isl_vec *v);
 __isl_give isl_aff *isl_aff_alloc(__isl_take isl_local_space *ls);
+__isl_give isl_aff *isl_aff_import(isl_ctx *ctx, __isl_keep isl_aff *aff);
+__isl_give isl_multi_aff *isl_multi_aff_import(isl_ctx *ctx,
+	__isl_keep isl_multi_aff *ma);
 
 __isl_give isl_aff *isl_aff_reset_space_and_domain(__isl_take isl_aff *aff,
 	__isl_take isl_space *space, __isl_take isl_space *domain);
@@ -93,6 +96,14 @@ __isl_give isl_pw_aff *isl_pw_aff_reset_domain_space(
 __isl_give isl_pw_aff *isl_pw_aff_add_disjoint(
 	__isl_take isl_pw_aff *pwaff1, __isl_take isl_pw_aff *pwaff2);
 
+__isl_give isl_pw_multi_aff *isl_pw_multi_aff_alloc_size(
+	__isl_take isl_space *space, int n);
+__isl_give isl_pw_multi_aff *isl_pw_multi_aff_add_piece(
+	__isl_take isl_pw_multi_aff *pma,
+	__isl_take isl_set *set, __isl_take isl_multi_aff *maff);
+__isl_give isl_pw_multi_aff *isl_pw_multi_aff_import(isl_ctx *ctx,
+	__isl_keep isl_pw_multi_aff *pma);
+
 __isl_give isl_pw_aff *isl_pw_aff_union_opt(__isl_take isl_pw_aff *pwaff1,
 	__isl_take isl_pw_aff *pwaff2, int max);
 
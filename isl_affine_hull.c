@@ -1081,6 +1081,35 @@ error:
 	return NULL;
 }
 
+/* Return the equalities satisfied by the integer points of "bmap",
+ * expressed in the underlying set, as computed by
+ * equalities_in_underlying_set.
+ * If the result has been computed before and cached in bmap->hull,
+ * then it is simply reused.
+ * Otherwise, the result is cached if there are other references to "bmap"
+ * since only those could give rise to a reuse, the caller holding
+ * its reference with the purpose of modifying "bmap".
+ */
+static __isl_give isl_basic_set *cached_equalities(
+	__isl_keep isl_basic_map *bmap)
+{
+	isl_basic_set *hull;
+
+	if (bmap->hull && isl_basic_set_total_dim(bmap->hull) ==
+			    isl_basic_map_total_dim(bmap)) {
+		bmap->ctx->stats->affine_hull_hits++;
+		return isl_basic_set_copy(bmap->hull);
+	}
+	bmap->hull = isl_basic_set_free(bmap->hull);
+
+	bmap->ctx->stats->affine_hull_misses++;
+	hull = equalities_in_underlying_set(isl_basic_map_copy(bmap));
+	if (hull && bmap->ref > 1)
+		bmap->hull = isl_basic_set_copy(hull);
+
+	return hull;
+}
+
 /* Detect and make explicit all equalities satisfied by the (integer)
  * points in bmap.
  */
@@ -1101,7 +1130,7 @@ struct isl_basic_map *isl_basic_map_detect_equalities(
 	if (ISL_F_ISSET(bmap, ISL_BASIC_MAP_RATIONAL))
 		return isl_basic_map_implicit_equalities(bmap);
 
-	hull = equalities_in_underlying_set(isl_basic_map_copy(bmap));
+	hull = cached_equalities(bmap);
 	if (!hull)
 		goto error;
 	if (ISL_F_ISSET(hull, ISL_BASIC_SET_EMPTY)) {
@@ -7,6 +7,8 @@
  * Ecole Normale Superieure, 45 rue d’Ulm, 75230 Paris, France
  */
 
+#include <string.h>
+#include <isl_ctx_private.h>
 #include <isl_ast_private.h>
 
 #undef BASE
@@ -19,6 +21,77 @@
 
 #include <isl_list_templ.c>
 
+/* Return a fresh, zeroed isl_ast_expr structure, taken from the free list
+ * of "ctx" if possible.
+ */
+static isl_ast_expr *expr_header_alloc(isl_ctx *ctx)
+{
+	isl_ast_expr *expr;
+
+	if (ctx->n_free_ast_expr == 0) {
+		ctx->stats->free_list_misses++;
+		return isl_calloc_type(ctx, isl_ast_expr);
+	}
+	if (isl_ctx_next_operation(ctx) < 0)
+		return NULL;
+	ctx->stats->free_list_hits++;
+	expr = ctx->free_ast_expr[--ctx->n_free_ast_expr];
+	memset(expr, 0, sizeof(*expr));
+	return expr;
+}
+
+/* Release the isl_ast_expr structure "expr", keeping it in the free list
+ * of "ctx" if there is room.
+ */
+static void expr_header_free(isl_ctx *ctx, isl_ast_expr *expr)
+{
+	if (ctx->n_free_ast_expr < ISL_AST_FREE_LIST_SIZE)
+		ctx->free_ast_expr[ctx->n_free_ast_expr++] = expr;
+	else
+		free(expr);
+}
+
+/* Return a fresh, zeroed isl_ast_node structure, taken from the free list
+ * of "ctx" if possible.
+ */
+static isl_ast_node *node_header_alloc(isl_ctx *ctx)
+{
+	isl_ast_node *node;
+
+	if (ctx->n_free_ast_node == 0) {
+		ctx->stats->free_list_misses++;
+		return isl_calloc_type(ctx, isl_ast_node);
+	}
+	if (isl_ctx_next_operation(ctx) < 0)
+		return NULL;
+	ctx->stats->free_list_hits++;
+	node = ctx->free_ast_node[--ctx->n_free_ast_node];
+	memset(node, 0, sizeof(*node));
+	return node;
+}
+
+/* Release the isl_ast_node structure "node", keeping it in the free list
+ * of "ctx" if there is room.
+ */
+static void node_header_free(isl_ctx *ctx, isl_ast_node *node)
+{
+	if (ctx->n_free_ast_node < ISL_AST_FREE_LIST_SIZE)
+		ctx->free_ast_node[ctx->n_free_ast_node++] = node;
+	else
+		free(node);
+}
+
+/* Free all isl_ast_expr and isl_ast_node structures kept
+ * in the free lists of "ctx".
+ */
+void isl_ast_clear_free_list(isl_ctx *ctx)
+{
+	while (ctx->n_free_ast_expr > 0)
+		free(ctx->free_ast_expr[--ctx->n_free_ast_expr]);
+	while (ctx->n_free_ast_node > 0)
+		free(ctx->free_ast_node[--ctx->n_free_ast_node]);
+}
+
 isl_ctx *isl_ast_print_options_get_ctx(
 	__isl_keep isl_ast_print_options *options)
 {
@@ -58,6 +131,7 @@ __isl_give isl_ast_print_options *isl_ast_print_options_dup(
 	dup->print_for_user = options->print_for_user;
 	dup->print_user = options->print_user;
 	dup->print_user_user = options->print_user_user;
+	dup->in_parallel = options->in_parallel;
 
 	return dup;
 }
@@ -201,6 +275,7 @@ __isl_give isl_ast_expr *isl_ast_expr_cow(__isl_take isl_ast_expr *expr)
 __isl_null isl_ast_expr *isl_ast_expr_free(__isl_take isl_ast_expr *expr)
 {
 	int i;
+	isl_ctx *ctx;
 
 	if (!expr)
 		return NULL;
@@ -208,7 +283,7 @@ __isl_null isl_ast_expr *isl_ast_expr_free(__isl_take isl_ast_expr *expr)
 	if (--expr->ref > 0)
 		return NULL;
 
-	isl_ctx_deref(expr->ctx);
+	ctx = expr->ctx;
 
 	switch (expr->type) {
 	case isl_ast_expr_int:
@@ -221,13 +296,15 @@ __isl_null isl_ast_expr *isl_ast_expr_free(__isl_take isl_ast_expr *expr)
 		if (expr->u.op.args)
 			for (i = 0; i < expr->u.op.n_arg; ++i)
 				isl_ast_expr_free(expr->u.op.args[i]);
-		free(expr->u.op.args);
+		if (expr->u.op.args != expr->u.op.inline_args)
+			free(expr->u.op.args);
 		break;
 	case isl_ast_expr_error:
 		break;
 	}
 
-	free(expr);
+	expr_header_free(ctx, expr);
+	isl_ctx_deref(ctx);
 	return NULL;
 }
 
@@ -363,13 +440,15 @@ int isl_ast_expr_is_equal(__isl_keep isl_ast_expr *expr1,
 
 /* Create a new operation expression of operation type "op",
  * with "n_arg" as yet unspecified arguments.
+ * If there are at most two arguments, then they are stored
+ * inside the expression itself.
  */
 __isl_give isl_ast_expr *isl_ast_expr_alloc_op(isl_ctx *ctx,
 	enum isl_ast_op_type op, int n_arg)
 {
 	isl_ast_expr *expr;
 
-	expr = isl_calloc_type(ctx, isl_ast_expr);
+	expr = expr_header_alloc(ctx);
 	if (!expr)
 		return NULL;
 
@@ -379,7 +458,10 @@ __isl_give isl_ast_expr *isl_ast_expr_alloc_op(isl_ctx *ctx,
 	expr->type = isl_ast_expr_op;
 	expr->u.op.op = op;
 	expr->u.op.n_arg = n_arg;
-	expr->u.op.args = isl_calloc_array(ctx, isl_ast_expr *, n_arg);
+	if (n_arg <= 2)
+		expr->u.op.args = expr->u.op.inline_args;
+	else
+		expr->u.op.args = isl_calloc_array(ctx, isl_ast_expr *, n_arg);
 
 	if (n_arg && !expr->u.op.args)
 		return isl_ast_expr_free(expr);
@@ -398,7 +480,7 @@ __isl_give isl_ast_expr *isl_ast_expr_from_id(__isl_take isl_id *id)
 		return NULL;
 
 	ctx = isl_id_get_ctx(id);
-	expr = isl_calloc_type(ctx, isl_ast_expr);
+	expr = expr_header_alloc(ctx);
 	if (!expr)
 		goto error;
 
@@ -420,7 +502,7 @@ __isl_give isl_ast_expr *isl_ast_expr_alloc_int_si(isl_ctx *ctx, int i)
 {
 	isl_ast_expr *expr;
 
-	expr = isl_calloc_type(ctx, isl_ast_expr);
+	expr = expr_header_alloc(ctx);
 	if (!expr)
 		return NULL;
 
@@ -449,7 +531,7 @@ __isl_give isl_ast_expr *isl_ast_expr_from_val(__isl_take isl_val *v)
 			"expecting integer value", goto error);
 
 	ctx = isl_val_get_ctx(v);
-	expr = isl_calloc_type(ctx, isl_ast_expr);
+	expr = expr_header_alloc(ctx);
 	if (!expr)
 		goto error;
 
@@ -736,7 +818,7 @@ __isl_give isl_ast_node *isl_ast_node_alloc(isl_ctx *ctx,
 {
 	isl_ast_node *node;
 
-	node = isl_calloc_type(ctx, isl_ast_node);
+	node = node_header_alloc(ctx);
 	if (!node)
 		return NULL;
 
@@ -892,6 +974,8 @@ __isl_give isl_ast_node *isl_ast_node_dup(__isl_keep isl_ast_node *node)
 			return isl_ast_node_free(dup);
 		break;
 	case isl_ast_node_for:
+		dup->u.f.degenerate = node->u.f.degenerate;
+		dup->u.f.coincident = node->u.f.coincident;
 		dup->u.f.iterator = isl_ast_expr_copy(node->u.f.iterator);
 		dup->u.f.init = isl_ast_expr_copy(node->u.f.init);
 		dup->u.f.cond = isl_ast_expr_copy(node->u.f.cond);
@@ -931,6 +1015,8 @@ __isl_give isl_ast_node *isl_ast_node_cow(__isl_take isl_ast_node *node)
 
 __isl_null isl_ast_node *isl_ast_node_free(__isl_take isl_ast_node *node)
 {
+	isl_ctx *ctx;
+
 	if (!node)
 		return NULL;
 
@@ -961,8 +1047,9 @@ __isl_null isl_ast_node *isl_ast_node_free(__isl_take isl_ast_node *node)
 	}
 
 	isl_id_free(node->annotation);
-	isl_ctx_deref(node->ctx);
-	free(node);
+	ctx = node->ctx;
+	node_header_free(ctx, node);
+	isl_ctx_deref(ctx);
 
 	return NULL;
 }
@@ -1022,6 +1109,32 @@ int isl_ast_node_for_is_degenerate(__isl_keep isl_ast_node *node)
 	return node->u.f.degenerate;
 }
 
+/* Mark the given for node as being coincident.
+ */
+__isl_give isl_ast_node *isl_ast_node_for_mark_coincident(
+	__isl_take isl_ast_node *node)
+{
+	node = isl_ast_node_cow(node);
+	if (!node)
+		return NULL;
+	node->u.f.coincident = 1;
+	return node;
+}
+
+/* Is the given for node coincident?
+ * That is, is it known that the iterations of the loop
+ * can be executed in any order, e.g., in parallel?
+ */
+int isl_ast_node_for_is_coincident(__isl_keep isl_ast_node *node)
+{
+	if (!node)
+		return -1;
+	if (node->type != isl_ast_node_for)
+		isl_die(isl_ast_node_get_ctx(node), isl_error_invalid,
+			"not a for node", return -1);
+	return node->u.f.coincident;
+}
+
 __isl_give isl_ast_expr *isl_ast_node_for_get_iterator(
 	__isl_keep isl_ast_node *node)
 {
@@ -1555,6 +1668,698 @@ static __isl_give isl_printer *print_ast_node_isl(__isl_take isl_printer *p,
 	return p;
 }
 
+/* Does "expr" involve the identifier "id"?
+ */
+static int expr_involves_id(__isl_keep isl_ast_expr *expr,
+	__isl_keep isl_id *id)
+{
+	int i;
+
+	switch (expr->type) {
+	case isl_ast_expr_id:
+		return expr->u.id == id;
+	case isl_ast_expr_op:
+		for (i = 0; i < expr->u.op.n_arg; ++i)
+			if (expr_involves_id(expr->u.op.args[i], id))
+				return 1;
+		return 0;
+	case isl_ast_expr_int:
+	case isl_ast_expr_error:
+		break;
+	}
+
+	return 0;
+}
+
+/* Should the upper bound of the for node "node" be evaluated
+ * before the loop when printing in C format?
+ *
+ * This is only done if the ast_print_hoist_bounds option is set,
+ * if the loop is not degenerate and if the condition is of the form
+ *
+ *	iterator <= bound	or	iterator < bound
+ *
+ * with "bound" an operation that does not involve the iterator.
+ * There is no point in evaluating a single identifier or integer
+ * before the loop.
+ */
+static int hoist_upper_bound(__isl_keep isl_ast_node *node)
+{
+	isl_ast_expr *cond, *bound;
+	isl_ctx *ctx;
+
+	if (node->type != isl_ast_node_for || node->u.f.degenerate)
+		return 0;
+	ctx = isl_ast_node_get_ctx(node);
+	if (!isl_options_get_ast_print_hoist_bounds(ctx))
+		return 0;
+	cond = node->u.f.cond;
+	if (!cond || cond->type != isl_ast_expr_op)
+		return 0;
+	if (cond->u.op.op != isl_ast_op_le && cond->u.op.op != isl_ast_op_lt)
+		return 0;
+	if (cond->u.op.args[0]->type != isl_ast_expr_id ||
+	    cond->u.op.args[0]->u.id != node->u.f.iterator->u.id)
+		return 0;
+	bound = cond->u.op.args[1];
+	if (bound->type != isl_ast_expr_op)
+		return 0;
+	return !expr_involves_id(bound, node->u.f.iterator->u.id);
+}
+
+/* Does "node" contain any for node?
+ */
+static int contains_for(__isl_keep isl_ast_node *node)
+{
+	int i, n;
+
+	if (!node)
+		return 0;
+
+	switch (node->type) {
+	case isl_ast_node_for:
+		return 1;
+	case isl_ast_node_if:
+		return contains_for(node->u.i.then) ||
+			contains_for(node->u.i.else_node);
+	case isl_ast_node_block:
+		n = isl_ast_node_list_n_ast_node(node->u.b.children);
+		for (i = 0; i < n; ++i)
+			if (contains_for(node->u.b.children->p[i]))
+				return 1;
+		return 0;
+	case isl_ast_node_user:
+	case isl_ast_node_error:
+		break;
+	}
+
+	return 0;
+}
+
+/* Return the OpenMP pragma that should be printed in front of
+ * the non-degenerate for node "node" or NULL if no pragma
+ * should be printed.
+ *
+ * Pragmas are only printed if the ast_print_omp_pragmas option is set
+ * and only for loops that have been marked coincident.
+ * The outermost such loop is executed in parallel.
+ * Inside such a parallel loop, an innermost coincident loop
+ * is marked for vectorization instead.
+ */
+static const char *omp_pragma(__isl_keep isl_ast_node *node,
+	__isl_keep isl_ast_print_options *options)
+{
+	isl_ctx *ctx;
+
+	if (!node->u.f.coincident)
+		return NULL;
+	ctx = isl_ast_node_get_ctx(node);
+	if (!isl_options_get_ast_print_omp_pragmas(ctx))
+		return NULL;
+	if (!options->in_parallel)
+		return "#pragma omp parallel for";
+	if (!contains_for(node->u.f.body))
+		return "#pragma omp simd";
+	return NULL;
+}
+
+/* A division or remainder expression "div" in the body of a for loop
+ * with a numerator "num" that is an affine expression in the loop iterator.
+ * "d" is the (positive) divisor and "inc" is the increment
+ * of "num" in each iteration of the loop.
+ * "q" and "r" are the variables that keep track of the quotient and
+ * the remainder of the floor division of "num" by "d"
+ * in the current iteration.
+ */
+struct isl_ast_reduction {
+	isl_ast_expr *div;
+	isl_ast_expr *num;
+	isl_val *d;
+	isl_val *inc;
+	isl_ast_expr *q;
+	isl_ast_expr *r;
+};
+
+/* Data used during the strength reduction of the division and
+ * remainder expressions in the body of a for node.
+ *
+ * "iterator" is the iterator of the for node and "step" its increment.
+ * "reduction" has room for "size" elements, "n" of which are in use.
+ */
+struct isl_ast_reduce_data {
+	isl_ctx *ctx;
+	isl_id *iterator;
+	isl_val *step;
+
+	int n;
+	int size;
+	struct isl_ast_reduction *reduction;
+};
+
+/* Free all memory allocated by "data".
+ */
+static void reduce_data_clear(struct isl_ast_reduce_data *data)
+{
+	int i;
+
+	for (i = 0; i < data->n; ++i) {
+		isl_ast_expr_free(data->reduction[i].div);
+		isl_ast_expr_free(data->reduction[i].num);
+		isl_val_free(data->reduction[i].d);
+		isl_val_free(data->reduction[i].inc);
+		isl_ast_expr_free(data->reduction[i].q);
+		isl_ast_expr_free(data->reduction[i].r);
+	}
+	free(data->reduction);
+	isl_val_free(data->step);
+}
+
+/* Return the coefficient of "id" in "expr" if "expr" is an affine
+ * expression in "id" with all other parts independent of "id".
+ * Otherwise, return NaN.
+ */
+static __isl_give isl_val *iterator_coefficient(__isl_keep isl_ast_expr *expr,
+	__isl_keep isl_id *id)
+{
+	isl_ctx *ctx;
+	isl_ast_expr **args;
+	isl_val *v;
+
+	ctx = isl_ast_expr_get_ctx(expr);
+	switch (expr->type) {
+	case isl_ast_expr_int:
+		return isl_val_zero(ctx);
+	case isl_ast_expr_id:
+		return expr->u.id == id ? isl_val_one(ctx) : isl_val_zero(ctx);
+	case isl_ast_expr_op:
+		break;
+	case isl_ast_expr_error:
+		return NULL;
+	}
+
+	args = expr->u.op.args;
+	switch (expr->u.op.op) {
+	case isl_ast_op_add:
+		return isl_val_add(iterator_coefficient(args[0], id),
+				    iterator_coefficient(args[1], id));
+	case isl_ast_op_sub:
+		return isl_val_sub(iterator_coefficient(args[0], id),
+				    iterator_coefficient(args[1], id));
+	case isl_ast_op_minus:
+		return isl_val_neg(iterator_coefficient(args[0], id));
+	case isl_ast_op_mul:
+		if (args[0]->type == isl_ast_expr_int) {
+			v = iterator_coefficient(args[1], id);
+			return isl_val_mul(v, isl_val_copy(args[0]->u.v));
+		}
+		if (args[1]->type == isl_ast_expr_int) {
+			v = iterator_coefficient(args[0], id);
+			return isl_val_mul(v, isl_val_copy(args[1]->u.v));
+		}
+		break;
+	default:
+		break;
+	}
+
+	if (expr_involves_id(expr, id))
+		return isl_val_nan(ctx);
+	return isl_val_zero(ctx);
+}
+
+/* Create an identifier expression for the variable called
+ * "<iterator>_<c><pos>".
+ */
+static __isl_give isl_ast_expr *reduction_var(isl_ctx *ctx,
+	__isl_keep isl_id *iterator, char c, int pos)
+{
+	const char *name;
+	char *var;
+	size_t len;
+	isl_id *id;
+
+	name = isl_id_get_name(iterator);
+	len = strlen(name) + 3 + 3 * sizeof(int);
+	var = isl_alloc_array(ctx, char, len);
+	if (!var)
+		return NULL;
+	snprintf(var, len, "%s_%c%d", name, c, pos);
+	id = isl_id_alloc(ctx, var, NULL);
+	free(var);
+
+	return isl_ast_expr_from_id(id);
+}
+
+/* Add the division or remainder expression "div", the numerator
+ * of which has coefficient "coef" in data->iterator,
+ * to data->reduction, unless it already appears there.
+ */
+static int add_reduction(struct isl_ast_reduce_data *data,
+	__isl_keep isl_ast_expr *div, __isl_take isl_val *coef)
+{
+	int i;
+	struct isl_ast_reduction *r;
+
+	for (i = 0; i < data->n; ++i) {
+		int equal = isl_ast_expr_is_equal(data->reduction[i].div, div);
+		if (equal < 0 || equal) {
+			isl_val_free(coef);
+			return equal < 0 ? -1 : 0;
+		}
+	}
+
+	if (data->n >= data->size) {
+		int size = 2 * data->size + 4;
+		r = isl_realloc_array(data->ctx, data->reduction,
+					struct isl_ast_reduction, size);
+		if (!r)
+			goto error;
+		data->reduction = r;
+		data->size = size;
+	}
+
+	r = &data->reduction[data->n];
+	r->div = isl_ast_expr_copy(div);
+	r->num = isl_ast_expr_copy(div->u.op.args[0]);
+	r->d = isl_val_copy(div->u.op.args[1]->u.v);
+	r->inc = isl_val_mul(coef, isl_val_copy(data->step));
+	r->q = reduction_var(data->ctx, data->iterator, 'q', data->n);
+	r->r = reduction_var(data->ctx, data->iterator, 'r', data->n);
+	data->n++;
+
+	if (!r->d || !r->inc || !r->q || !r->r)
+		return -1;
+
+	return 0;
+error:
+	isl_val_free(coef);
+	return -1;
+}
+
+/* Collect the division and remainder expressions in "expr"
+ * that can be strength reduced with respect to data->iterator,
+ * ignoring any expressions that involve "excluded" (if not NULL).
+ *
+ * The candidates are floor divisions and (non-negative) remainders
+ * by a positive integer constant of an expression
+ * that is affine in data->iterator with a non-zero coefficient.
+ * Remainders that are only used to test for divisibility
+ * (isl_ast_op_zdiv_r) are left alone.
+ */
+static int collect_reductions_expr(__isl_keep isl_ast_expr *expr,
+	struct isl_ast_reduce_data *data, __isl_keep isl_id *excluded)
+{
+	int i;
+	enum isl_ast_op_type op;
+
+	if (!expr)
+		return -1;
+	if (expr->type != isl_ast_expr_op)
+		return 0;
+
+	op = expr->u.op.op;
+	if ((op == isl_ast_op_fdiv_q || op == isl_ast_op_pdiv_q ||
+	     op == isl_ast_op_pdiv_r) &&
+	    expr->u.op.args[1]->type == isl_ast_expr_int &&
+	    isl_val_is_pos(expr->u.op.args[1]->u.v) &&
+	    (!excluded || !expr_involves_id(expr, excluded))) {
+		isl_val *coef;
+
+		coef = iterator_coefficient(expr->u.op.args[0],
+						data->iterator);
+		if (!coef)
+			return -1;
+		if (isl_val_is_int(coef) && !isl_val_is_zero(coef))
+			return add_reduction(data, expr, coef);
+		isl_val_free(coef);
+	}
+
+	for (i = 0; i < expr->u.op.n_arg; ++i)
+		if (collect_reductions_expr(expr->u.op.args[i],
+						data, excluded) < 0)
+			return -1;
+
+	return 0;
+}
+
+/* Collect the division and remainder expressions in "node"
+ * that can be strength reduced with respect to data->iterator.
+ *
+ * The bodies of nested for nodes are not considered since
+ * the expressions in there may depend on the iterators
+ * of those nested for nodes.  For the same reason,
+ * only the parts of the condition of a nested for node
+ * that do not involve its iterator are considered.
+ */
+static int collect_reductions_node(__isl_keep isl_ast_node *node,
+	struct isl_ast_reduce_data *data)
+{
+	int i, n;
+
+	if (!node)
+		return -1;
+
+	switch (node->type) {
+	case isl_ast_node_for:
+		if (collect_reductions_expr(node->u.f.init, data, NULL) < 0)
+			return -1;
+		if (node->u.f.degenerate)
+			return 0;
+		return collect_reductions_expr(node->u.f.cond, data,
+						node->u.f.iterator->u.id);
+	case isl_ast_node_if:
+		if (collect_reductions_expr(node->u.i.guard, data, NULL) < 0)
+			return -1;
+		if (collect_reductions_node(node->u.i.then, data) < 0)
+			return -1;
+		if (node->u.i.else_node &&
+		    collect_reductions_node(node->u.i.else_node, data) < 0)
+			return -1;
+		return 0;
+	case isl_ast_node_block:
+		n = isl_ast_node_list_n_ast_node(node->u.b.children);
+		for (i = 0; i < n; ++i)
+			if (collect_reductions_node(node->u.b.children->p[i],
+							data) < 0)
+				return -1;
+		return 0;
+	case isl_ast_node_user:
+		return collect_reductions_expr(node->u.e.expr, data, NULL);
+	case isl_ast_node_error:
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Collect the division and remainder expressions in the body
+ * of the for node "node" that can be strength reduced, i.e.,
+ * that can be replaced by variables that are updated incrementally
+ * in each iteration of the loop.
+ * Return 1 if there are any such expressions and 0 otherwise.
+ * "data" needs to be cleared by the caller in both cases.
+ *
+ * This is only done if the ast_print_strength_reduce option is set
+ * and if the for node is not degenerate and has a constant increment.
+ * It is also not done if the loop is annotated as a parallel or
+ * vectorizable loop according to "options" (if not NULL)
+ * since the updates of the variables introduce a dependence
+ * between the iterations.
+ */
+static int collect_reductions(__isl_keep isl_ast_node *node,
+	__isl_keep isl_ast_print_options *options,
+	struct isl_ast_reduce_data *data)
+{
+	data->ctx = isl_ast_node_get_ctx(node);
+	data->iterator = NULL;
+	data->step = NULL;
+	data->n = 0;
+	data->size = 0;
+	data->reduction = NULL;
+
+	if (node->type != isl_ast_node_for || node->u.f.degenerate)
+		return 0;
+	if (!isl_options_get_ast_print_strength_reduce(data->ctx))
+		return 0;
+	if (node->u.f.inc->type != isl_ast_expr_int)
+		return 0;
+	if (options && omp_pragma(node, options))
+		return 0;
+
+	data->iterator = node->u.f.iterator->u.id;
+	data->step = isl_val_copy(node->u.f.inc->u.v);
+	if (collect_reductions_node(node->u.f.body, data) < 0)
+		return -1;
+
+	return data->n > 0;
+}
+
+/* Does the for node "node" have any division or remainder expressions
+ * that can be strength reduced when printed with "options"?
+ */
+static int has_reductions(__isl_keep isl_ast_node *node,
+	__isl_keep isl_ast_print_options *options)
+{
+	int r;
+	struct isl_ast_reduce_data data;
+
+	r = collect_reductions(node, options, &data);
+	reduce_data_clear(&data);
+
+	return r;
+}
+
+/* Replace the division and remainder expressions in "expr"
+ * that appear in data->reduction by the corresponding variables.
+ */
+static __isl_give isl_ast_expr *reduce_expr(__isl_take isl_ast_expr *expr,
+	struct isl_ast_reduce_data *data)
+{
+	int i;
+
+	if (!expr)
+		return NULL;
+	if (expr->type != isl_ast_expr_op)
+		return expr;
+
+	for (i = 0; i < data->n; ++i) {
+		struct isl_ast_reduction *r = &data->reduction[i];
+		int equal = isl_ast_expr_is_equal(expr, r->div);
+		if (equal < 0)
+			return isl_ast_expr_free(expr);
+		if (!equal)
+			continue;
+		isl_ast_expr_free(expr);
+		if (r->div->u.op.op == isl_ast_op_pdiv_r)
+			return isl_ast_expr_copy(r->r);
+		return isl_ast_expr_copy(r->q);
+	}
+
+	for (i = 0; i < expr->u.op.n_arg; ++i) {
+		isl_ast_expr *arg;
+
+		arg = isl_ast_expr_copy(expr->u.op.args[i]);
+		arg = reduce_expr(arg, data);
+		if (arg == expr->u.op.args[i]) {
+			isl_ast_expr_free(arg);
+			continue;
+		}
+		expr = isl_ast_expr_cow(expr);
+		if (!expr || !arg) {
+			isl_ast_expr_free(arg);
+			return isl_ast_expr_free(expr);
+		}
+		isl_ast_expr_free(expr->u.op.args[i]);
+		expr->u.op.args[i] = arg;
+	}
+
+	return expr;
+}
+
+/* Replace the division and remainder expressions in "node"
+ * that appear in data->reduction by the corresponding variables,
+ * in the same parts of "node" that were considered
+ * by collect_reductions_node.
+ */
+static __isl_give isl_ast_node *reduce_node(__isl_take isl_ast_node *node,
+	struct isl_ast_reduce_data *data)
+{
+	int i, n;
+
+	node = isl_ast_node_cow(node);
+	if (!node)
+		return NULL;
+
+	switch (node->type) {
+	case isl_ast_node_for:
+		node->u.f.init = reduce_expr(node->u.f.init, data);
+		if (!node->u.f.init)
+			return isl_ast_node_free(node);
+		if (node->u.f.degenerate)
+			break;
+		node->u.f.cond = reduce_expr(node->u.f.cond, data);
+		if (!node->u.f.cond)
+			return isl_ast_node_free(node);
+		break;
+	case isl_ast_node_if:
+		node->u.i.guard = reduce_expr(node->u.i.guard, data);
+		node->u.i.then = reduce_node(node->u.i.then, data);
+		if (!node->u.i.guard || !node->u.i.then)
+			return isl_ast_node_free(node);
+		if (!node->u.i.else_node)
+			break;
+		node->u.i.else_node = reduce_node(node->u.i.else_node, data);
+		if (!node->u.i.else_node)
+			return isl_ast_node_free(node);
+		break;
+	case isl_ast_node_block:
+		n = isl_ast_node_list_n_ast_node(node->u.b.children);
+		for (i = 0; i < n; ++i) {
+			isl_ast_node *child;
+
+			child = isl_ast_node_list_get_ast_node(
+						node->u.b.children, i);
+			child = reduce_node(child, data);
+			node->u.b.children = isl_ast_node_list_set_ast_node(
+					node->u.b.children, i, child);
+		}
+		if (!node->u.b.children)
+			return isl_ast_node_free(node);
+		break;
+	case isl_ast_node_user:
+		node->u.e.expr = reduce_expr(node->u.e.expr, data);
+		if (!node->u.e.expr)
+			return isl_ast_node_free(node);
+		break;
+	case isl_ast_node_error:
+		break;
+	}
+
+	return node;
+}
+
+/* Print the declarations of the variables in data->reduction
+ * for the for node "node", with "type" the type of the iterator.
+ * That is, for each division or remainder expression
+ * with numerator "num" and divisor "d", print
+ *
+ *	type q = floord(num0, d);
+ *	type r = num0 - d * q;
+ *
+ * with "num0" the value of "num" in the first iteration.
+ * A floor division is used even if the original expression
+ * is a division of a non-negative numerator since the numerator
+ * may not be non-negative in the first iteration.
+ */
+static __isl_give isl_printer *print_reduction_decls(__isl_take isl_printer *p,
+	__isl_keep isl_ast_node *node, struct isl_ast_reduce_data *data,
+	const char *type)
+{
+	int i;
+
+	for (i = 0; i < data->n; ++i) {
+		struct isl_ast_reduction *r = &data->reduction[i];
+		isl_id_to_ast_expr *id2expr;
+		isl_ast_expr *num, *q, *rem, *d;
+
+		id2expr = isl_id_to_ast_expr_alloc(data->ctx, 1);
+		id2expr = isl_id_to_ast_expr_set(id2expr,
+					isl_id_copy(data->iterator),
+					isl_ast_expr_copy(node->u.f.init));
+		num = isl_ast_expr_copy(r->num);
+		num = isl_ast_expr_substitute_ids(num, id2expr);
+		d = isl_ast_expr_from_val(isl_val_copy(r->d));
+		q = isl_ast_expr_alloc_binary(isl_ast_op_fdiv_q,
+				isl_ast_expr_copy(num), isl_ast_expr_copy(d));
+		rem = isl_ast_expr_mul(d, isl_ast_expr_copy(r->q));
+		rem = isl_ast_expr_sub(num, rem);
+
+		p = isl_printer_start_line(p);
+		p = isl_printer_print_str(p, type);
+		p = isl_printer_print_str(p, " ");
+		p = isl_printer_print_ast_expr(p, r->q);
+		p = isl_printer_print_str(p, " = ");
+		p = isl_printer_print_ast_expr(p, q);
+		p = isl_printer_print_str(p, ";");
+		p = isl_printer_end_line(p);
+		p = isl_printer_start_line(p);
+		p = isl_printer_print_str(p, type);
+		p = isl_printer_print_str(p, " ");
+		p = isl_printer_print_ast_expr(p, r->r);
+		p = isl_printer_print_str(p, " = ");
+		p = isl_printer_print_ast_expr(p, rem);
+		p = isl_printer_print_str(p, ";");
+		p = isl_printer_end_line(p);
+
+		isl_ast_expr_free(q);
+		isl_ast_expr_free(rem);
+	}
+
+	return p;
+}
+
+/* Print the statement
+ *
+ *	var op= v;
+ */
+static __isl_give isl_printer *print_update(__isl_take isl_printer *p,
+	__isl_keep isl_ast_expr *var, const char *op, __isl_keep isl_val *v)
+{
+	p = isl_printer_start_line(p);
+	p = isl_printer_print_ast_expr(p, var);
+	p = isl_printer_print_str(p, op);
+	p = isl_printer_print_val(p, v);
+	p = isl_printer_print_str(p, ";");
+	p = isl_printer_end_line(p);
+
+	return p;
+}
+
+/* Print the updates of the variables in data->reduction
+ * at the end of an iteration of the loop.
+ * Let "inc" be the increment of the numerator and "d" the divisor, and
+ * let qinc = floor(inc/d) and rinc = inc - d * qinc, with 0 <= rinc < d.
+ * The updates are then printed as
+ *
+ *	r += rinc;
+ *	if (r >= d) {
+ *	  r -= d;
+ *	  q += 1;
+ *	}
+ *	q += qinc;
+ *
+ * omitting the parts that have no effect.
+ */
+static __isl_give isl_printer *print_reduction_updates(
+	__isl_take isl_printer *p, struct isl_ast_reduce_data *data)
+{
+	int i;
+
+	for (i = 0; i < data->n; ++i) {
+		struct isl_ast_reduction *r = &data->reduction[i];
+		isl_val *qinc, *rinc, *one;
+
+		qinc = isl_val_div(isl_val_copy(r->inc), isl_val_copy(r->d));
+		qinc = isl_val_floor(qinc);
+		rinc = isl_val_mul(isl_val_copy(qinc), isl_val_copy(r->d));
+		rinc = isl_val_sub(isl_val_copy(r->inc), rinc);
+		if (!qinc || !rinc) {
+			isl_val_free(qinc);
+			isl_val_free(rinc);
+			return isl_printer_free(p);
+		}
+
+		if (!isl_val_is_zero(rinc)) {
+			p = print_update(p, r->r, " += ", rinc);
+			p = isl_printer_start_line(p);
+			p = isl_printer_print_str(p, "if (");
+			p = isl_printer_print_ast_expr(p, r->r);
+			p = isl_printer_print_str(p, " >= ");
+			p = isl_printer_print_val(p, r->d);
+			p = isl_printer_print_str(p, ") {");
+			p = isl_printer_end_line(p);
+			p = isl_printer_indent(p, 2);
+			p = print_update(p, r->r, " -= ", r->d);
+			one = isl_val_one(data->ctx);
+			p = print_update(p, r->q, " += ", one);
+			isl_val_free(one);
+			p = isl_printer_indent(p, -2);
+			p = isl_printer_start_line(p);
+			p = isl_printer_print_str(p, "}");
+			p = isl_printer_end_line(p);
+		}
+		if (isl_val_is_neg(qinc)) {
+			qinc = isl_val_neg(qinc);
+			p = print_update(p, r->q, " -= ", qinc);
+		} else if (!isl_val_is_zero(qinc))
+			p = print_update(p, r->q, " += ", qinc);
+
+		isl_val_free(qinc);
+		isl_val_free(rinc);
+	}
+
+	return p;
+}
+
 /* Do we need to print a block around the body "node" of a for or if node?
  *
  * If the node is a block, then we need to print a block.
@@ -1563,9 +2368,14 @@ static __isl_give isl_printer *print_ast_node_isl(__isl_take isl_printer *p,
  * as well.
  * If the node is an if node with an else, then we print a block
  * to avoid spurious dangling else warnings emitted by some compilers.
+ * If the node is a for node with an upper bound that is evaluated
+ * before the loop or with division or remainder expressions that are
+ * strength reduced when printed with "options", then the declarations
+ * printed before the loop and the loop need to be in a block.
  * If the ast_always_print_block option has been set, then we print a block.
  */
-static int need_block(__isl_keep isl_ast_node *node)
+static int need_block(__isl_keep isl_ast_node *node,
+	__isl_keep isl_ast_print_options *options)
 {
 	isl_ctx *ctx;
 
@@ -1575,6 +2385,10 @@ static int need_block(__isl_keep isl_ast_node *node)
 		return 1;
 	if (node->type == isl_ast_node_if && node->u.i.else_node)
 		return 1;
+	if (hoist_upper_bound(node))
+		return 1;
+	if (has_reductions(node, options) == 1)
+		return 1;
 
 	ctx = isl_ast_node_get_ctx(node);
 	return isl_options_get_ast_always_print_block(ctx);
@@ -1610,7 +2424,7 @@ static __isl_give isl_printer *print_body_c(__isl_take isl_printer *p,
 	if (!node)
 		return isl_printer_free(p);
 
-	if (!else_node && !need_block(node)) {
+	if (!else_node && !need_block(node, options)) {
 		p = isl_printer_end_line(p);
 		p = isl_printer_indent(p, 2);
 		p = isl_ast_node_print(node, p,
@@ -1664,6 +2478,34 @@ static __isl_give isl_printer *end_block(__isl_take isl_printer *p)
 	return p;
 }
 
+/* Print the body "node" of a for node with division and remainder
+ * expressions that are strength reduced according to "data".
+ * The body is printed as a block with the expressions replaced
+ * by the corresponding variables, followed by the updates
+ * of those variables.
+ */
+static __isl_give isl_printer *print_reduced_body_c(__isl_take isl_printer *p,
+	__isl_keep isl_ast_node *node, struct isl_ast_reduce_data *data,
+	__isl_keep isl_ast_print_options *options)
+{
+	node = reduce_node(isl_ast_node_copy(node), data);
+	if (!node)
+		return isl_printer_free(p);
+
+	p = isl_printer_print_str(p, " {");
+	p = isl_printer_end_line(p);
+	p = isl_printer_indent(p, 2);
+	p = print_ast_node_c(p, node, options, 1, 1);
+	p = print_reduction_updates(p, data);
+	p = isl_printer_indent(p, -2);
+	p = isl_printer_start_line(p);
+	p = isl_printer_print_str(p, "}");
+	p = isl_printer_end_line(p);
+
+	isl_ast_node_free(node);
+	return p;
+}
+
 /* Print the for node "node".
  *
  * If the for node is degenerate, it is printed as
@@ -1682,6 +2524,27 @@ static __isl_give isl_printer *end_block(__isl_take isl_printer *p)
  * then we print a block around a degenerate for loop such that the variable
  * declaration will not conflict with any potential other declaration
  * of the same variable.
+ *
+ * If the upper bound of a non-degenerate for node should be evaluated
+ * before the loop (see hoist_upper_bound), then the node is printed as
+ *
+ *	type iterator_ub = bound;
+ *	for (type iterator = init; iterator <= iterator_ub; iterator += inc)
+ *		body
+ *
+ * with the same block placement as for a degenerate for loop.
+ *
+ * If an OpenMP pragma should be printed in front of a non-degenerate
+ * for node (see omp_pragma), then it is printed right before
+ * the "for" keyword.  The body of a loop that is annotated
+ * as a parallel loop is printed with options->in_parallel set.
+ *
+ * If some division or remainder expressions in the body of
+ * a non-degenerate for node can be strength reduced
+ * (see collect_reductions), then the variables replacing them
+ * are declared before the loop (with the same block placement
+ * as for a degenerate for loop) and updated at the end of the body
+ * (see print_reduced_body_c).
  */
 static __isl_give isl_printer *print_for_c(__isl_take isl_printer *p,
 	__isl_keep isl_ast_node *node,
@@ -1693,9 +2556,41 @@ static __isl_give isl_printer *print_for_c(__isl_take isl_printer *p,
 
 	type = isl_options_get_ast_iterator_type(isl_printer_get_ctx(p));
 	if (!node->u.f.degenerate) {
+		int hoist = hoist_upper_bound(node);
+		const char *pragma = omp_pragma(node, options);
+		isl_ast_expr *cond = node->u.f.cond;
+		isl_ast_print_options *body_options;
+		struct isl_ast_reduce_data data;
+		int reduce, block;
+
+		reduce = collect_reductions(node, options, &data);
+		if (reduce < 0) {
+			reduce_data_clear(&data);
+			return isl_printer_free(p);
+		}
+		block = (hoist || reduce) && (!in_block || in_list);
 		id = isl_ast_expr_get_id(node->u.f.iterator);
 		name = isl_id_get_name(id);
 		isl_id_free(id);
+		if (block)
+			p = start_block(p);
+		if (hoist) {
+			p = isl_printer_start_line(p);
+			p = isl_printer_print_str(p, type);
+			p = isl_printer_print_str(p, " ");
+			p = isl_printer_print_str(p, name);
+			p = isl_printer_print_str(p, "_ub = ");
+			p = isl_printer_print_ast_expr(p, cond->u.op.args[1]);
+			p = isl_printer_print_str(p, ";");
+			p = isl_printer_end_line(p);
+		}
+		if (reduce)
+			p = print_reduction_decls(p, node, &data, type);
+		if (pragma) {
+			p = isl_printer_start_line(p);
+			p = isl_printer_print_str(p, pragma);
+			p = isl_printer_end_line(p);
+		}
 		p = isl_printer_start_line(p);
 		p = isl_printer_print_str(p, "for (");
 		p = isl_printer_print_str(p, type);
@@ -1704,13 +2599,36 @@ static __isl_give isl_printer *print_for_c(__isl_take isl_printer *p,
 		p = isl_printer_print_str(p, " = ");
 		p = isl_printer_print_ast_expr(p, node->u.f.init);
 		p = isl_printer_print_str(p, "; ");
-		p = isl_printer_print_ast_expr(p, node->u.f.cond);
+		if (hoist) {
+			p = isl_printer_print_str(p, name);
+			p = isl_printer_print_str(p,
+			    cond->u.op.op == isl_ast_op_le ? " <= " : " < ");
+			p = isl_printer_print_str(p, name);
+			p = isl_printer_print_str(p, "_ub");
+		} else
+			p = isl_printer_print_ast_expr(p, cond);
 		p = isl_printer_print_str(p, "; ");
 		p = isl_printer_print_str(p, name);
 		p = isl_printer_print_str(p, " += ");
 		p = isl_printer_print_ast_expr(p, node->u.f.inc);
 		p = isl_printer_print_str(p, ")");
-		p = print_body_c(p, node->u.f.body, NULL, options);
+		body_options = isl_ast_print_options_copy(options);
+		if (pragma && !options->in_parallel) {
+			body_options = isl_ast_print_options_cow(body_options);
+			if (body_options)
+				body_options->in_parallel = 1;
+		}
+		if (!body_options)
+			p = isl_printer_free(p);
+		else if (reduce)
+			p = print_reduced_body_c(p, node->u.f.body, &data,
+						body_options);
+		else
+			p = print_body_c(p, node->u.f.body, NULL, body_options);
+		isl_ast_print_options_free(body_options);
+		reduce_data_clear(&data);
+		if (block)
+			p = end_block(p);
 	} else {
 		id = isl_ast_expr_get_id(node->u.f.iterator);
 		name = isl_id_get_name(id);
@@ -1943,6 +2861,8 @@ static int ast_node_required_macros(__isl_keep isl_ast_node *node, int macros)
 
 	switch (node->type) {
 	case isl_ast_node_for:
+		if (has_reductions(node, NULL) == 1)
+			macros |= ISL_AST_MACRO_FLOORD;
 		macros = ast_expr_required_macros(node->u.f.init, macros);
 		if (!node->u.f.degenerate) {
 			macros = ast_expr_required_macros(node->u.f.cond,
@@ -10,11 +10,18 @@
  * B.P. 105 - 78153 Le Chesnay, France
  */
 
+#include <string.h>
 #include <isl/map.h>
 #include <isl/aff.h>
 #include <isl/map.h>
+#include <isl_ctx_private.h>
+#include <isl_aff_private.h>
+#include <isl_seq.h>
+#include <isl_vec_private.h>
 #include <isl_ast_build_private.h>
+#include <isl_gist_private.h>
 #include <isl_ast_private.h>
+#include <isl_ast_graft_private.h>
 
 /* Construct a map that isolates the current dimension.
  *
@@ -97,6 +104,54 @@ static __isl_give isl_id *generate_name(isl_ctx *ctx, int i,
 	return isl_id_alloc(ctx, name, NULL);
 }
 
+/* Return a fresh, zeroed isl_ast_build structure, taken from the free list
+ * of "ctx" if possible, with a reference to "ctx".
+ */
+static isl_ast_build *build_header_alloc(isl_ctx *ctx)
+{
+	isl_ast_build *build;
+
+	if (ctx->n_free_ast_build == 0) {
+		ctx->stats->free_list_misses++;
+		build = isl_calloc_type(ctx, isl_ast_build);
+	} else {
+		if (isl_ctx_next_operation(ctx) < 0)
+			return NULL;
+		ctx->stats->free_list_hits++;
+		build = ctx->free_ast_build[--ctx->n_free_ast_build];
+		memset(build, 0, sizeof(*build));
+	}
+	if (!build)
+		return NULL;
+
+	build->ctx = ctx;
+	isl_ctx_ref(ctx);
+
+	return build;
+}
+
+/* Release the isl_ast_build structure "build", keeping it in the free list
+ * of its isl_ctx if there is room.
+ */
+static void build_header_free(isl_ast_build *build)
+{
+	isl_ctx *ctx = build->ctx;
+
+	isl_ctx_deref(ctx);
+	if (ctx->n_free_ast_build < ISL_FREE_LIST_SIZE)
+		ctx->free_ast_build[ctx->n_free_ast_build++] = build;
+	else
+		free(build);
+}
+
+/* Free all isl_ast_build structures kept in the free list of "ctx".
+ */
+void isl_ast_build_clear_free_list(isl_ctx *ctx)
+{
+	while (ctx->n_free_ast_build > 0)
+		free(ctx->free_ast_build[--ctx->n_free_ast_build]);
+}
+
 /* Create an isl_ast_build with "set" as domain.
  *
  * The input set is usually a parameter domain, but we currently allow it to
@@ -116,7 +171,7 @@ __isl_give isl_ast_build *isl_ast_build_from_context(__isl_take isl_set *set)
 
 	ctx = isl_set_get_ctx(set);
 
-	build = isl_calloc_type(ctx, isl_ast_build);
+	build = build_header_alloc(ctx);
 	if (!build)
 		goto error;
 
@@ -155,6 +210,79 @@ __isl_give isl_ast_build *isl_ast_build_copy(__isl_keep isl_ast_build *build)
 	return build;
 }
 
+static struct isl_ast_build_reuse *isl_ast_build_reuse_copy(
+	struct isl_ast_build_reuse *reuse)
+{
+	if (!reuse)
+		return NULL;
+
+	reuse->ref++;
+	return reuse;
+}
+
+static void clear_reuse_entry(struct isl_ast_build_reuse_entry *entry)
+{
+	isl_union_map_free(entry->executed);
+	isl_set_free(entry->domain);
+	isl_union_map_free(entry->options);
+	isl_union_map_free(entry->coincident);
+	isl_ast_graft_list_free(entry->list);
+}
+
+static struct isl_ast_build_reuse *isl_ast_build_reuse_free(
+	struct isl_ast_build_reuse *reuse)
+{
+	int i;
+
+	if (!reuse)
+		return NULL;
+
+	if (--reuse->ref > 0)
+		return NULL;
+
+	for (i = 0; i < reuse->n; ++i)
+		clear_reuse_entry(&reuse->entry[i]);
+	free(reuse->entry);
+	isl_ctx_deref(reuse->ctx);
+	free(reuse);
+
+	return NULL;
+}
+
+static struct isl_ast_build_expr_memo *isl_ast_build_expr_memo_copy(
+	struct isl_ast_build_expr_memo *memo)
+{
+	if (!memo)
+		return NULL;
+
+	memo->ref++;
+	return memo;
+}
+
+static struct isl_ast_build_expr_memo *isl_ast_build_expr_memo_free(
+	struct isl_ast_build_expr_memo *memo)
+{
+	int i;
+
+	if (!memo)
+		return NULL;
+
+	if (--memo->ref > 0)
+		return NULL;
+
+	for (i = 0; i < memo->n; ++i) {
+		isl_pw_aff_free(memo->entry[i].pa);
+		isl_ast_expr_free(memo->entry[i].expr);
+	}
+	isl_set_free(memo->domain);
+	isl_multi_aff_free(memo->values);
+	isl_id_list_free(memo->iterators);
+	isl_ctx_deref(memo->ctx);
+	free(memo);
+
+	return NULL;
+}
+
 __isl_give isl_ast_build *isl_ast_build_dup(__isl_keep isl_ast_build *build)
 {
 	isl_ctx *ctx;
@@ -164,7 +292,7 @@ __isl_give isl_ast_build *isl_ast_build_dup(__isl_keep isl_ast_build *build)
 		return NULL;
 
 	ctx = isl_ast_build_get_ctx(build);
-	dup = isl_calloc_type(ctx, isl_ast_build);
+	dup = build_header_alloc(ctx);
 	if (!dup)
 		return NULL;
 
@@ -179,9 +307,14 @@ __isl_give isl_ast_build *isl_ast_build_dup(__isl_keep isl_ast_build *build)
 	dup->value = isl_pw_aff_copy(build->value);
 	dup->strides = isl_vec_copy(build->strides);
 	dup->offsets = isl_multi_aff_copy(build->offsets);
+	dup->hull_domain = isl_set_copy(build->hull_domain);
+	dup->hull = isl_basic_set_copy(build->hull);
+	dup->gist_domain = isl_set_copy(build->gist_domain);
+	dup->gist_context = isl_map_gist_context_copy(build->gist_context);
 	dup->executed = isl_union_map_copy(build->executed);
 	dup->single_valued = build->single_valued;
 	dup->options = isl_union_map_copy(build->options);
+	dup->coincident = isl_union_map_copy(build->coincident);
 	dup->at_each_domain = build->at_each_domain;
 	dup->at_each_domain_user = build->at_each_domain_user;
 	dup->before_each_for = build->before_each_for;
@@ -190,11 +323,18 @@ __isl_give isl_ast_build *isl_ast_build_dup(__isl_keep isl_ast_build *build)
 	dup->after_each_for_user = build->after_each_for_user;
 	dup->create_leaf = build->create_leaf;
 	dup->create_leaf_user = build->create_leaf_user;
+	dup->stream = build->stream;
+	dup->stream_user = build->stream_user;
+	dup->reuse = isl_ast_build_reuse_copy(build->reuse);
+	dup->expr_memo = isl_ast_build_expr_memo_copy(build->expr_memo);
 
 	if (!dup->iterators || !dup->domain || !dup->generated ||
 	    !dup->pending || !dup->values ||
 	    !dup->strides || !dup->offsets || !dup->options ||
+	    (build->hull && !dup->hull) ||
+	    (build->gist_context && !dup->gist_context) ||
 	    (build->executed && !dup->executed) ||
+	    (build->coincident && !dup->coincident) ||
 	    (build->value && !dup->value))
 		return isl_ast_build_free(dup);
 
@@ -264,17 +404,24 @@ __isl_null isl_ast_build *isl_ast_build_free(
 	isl_vec_free(build->strides);
 	isl_multi_aff_free(build->offsets);
 	isl_multi_aff_free(build->schedule_map);
+	isl_set_free(build->hull_domain);
+	isl_basic_set_free(build->hull);
+	isl_set_free(build->gist_domain);
+	isl_map_gist_context_free(build->gist_context);
 	isl_union_map_free(build->executed);
 	isl_union_map_free(build->options);
+	isl_union_map_free(build->coincident);
+	isl_ast_build_reuse_free(build->reuse);
+	isl_ast_build_expr_memo_free(build->expr_memo);
 
-	free(build);
+	build_header_free(build);
 
 	return NULL;
 }
 
 isl_ctx *isl_ast_build_get_ctx(__isl_keep isl_ast_build *build)
 {
-	return build ? isl_set_get_ctx(build->domain) : NULL;
+	return build ? build->ctx : NULL;
 }
 
 /* Replace build->options by "options".
@@ -296,6 +443,35 @@ error:
 	return isl_ast_build_free(build);
 }
 
+/* Replace build->coincident by "coincident".
+ *
+ * "coincident" is of the form
+ *
+ *	{ S[i] -> coincident[d] }
+ *
+ * and specifies that schedule dimension "d" is coincident for
+ * statement instance "S[i]", e.g., as computed by
+ * isl_schedule_get_coincident.  The for nodes at such dimensions
+ * are marked coincident if all the statement instances
+ * they execute appear in "coincident" with the same "d".
+ */
+__isl_give isl_ast_build *isl_ast_build_set_coincident(
+	__isl_take isl_ast_build *build, __isl_take isl_union_map *coincident)
+{
+	build = isl_ast_build_cow(build);
+
+	if (!build || !coincident)
+		goto error;
+
+	isl_union_map_free(build->coincident);
+	build->coincident = coincident;
+
+	return build;
+error:
+	isl_union_map_free(coincident);
+	return isl_ast_build_free(build);
+}
+
 /* Set the iterators for the next code generation.
  *
  * If we still have some iterators left from the previous code generation
@@ -401,6 +577,314 @@ __isl_give isl_ast_build *isl_ast_build_set_create_leaf(
 	return build;
 }
 
+/* Set the "stream" callback of "build" to "fn".
+ */
+__isl_give isl_ast_build *isl_ast_build_set_stream(
+	__isl_take isl_ast_build *build,
+	int (*fn)(__isl_take struct isl_ast_graft_list *list, void *user),
+	void *user)
+{
+	build = isl_ast_build_cow(build);
+
+	if (!build)
+		return NULL;
+
+	build->stream = fn;
+	build->stream_user = user;
+
+	return build;
+}
+
+/* Keep track of the grafts generated for the outermost components
+ * of the AST if "reuse" is set, such that later code generations
+ * with "build" can reuse them for components that have not changed.
+ * Any previously collected grafts are discarded.
+ */
+__isl_give isl_ast_build *isl_ast_build_set_reuse_subtrees(
+	__isl_take isl_ast_build *build, int reuse)
+{
+	isl_ctx *ctx;
+
+	build = isl_ast_build_cow(build);
+	if (!build)
+		return NULL;
+
+	build->reuse = isl_ast_build_reuse_free(build->reuse);
+	if (!reuse)
+		return build;
+
+	ctx = isl_ast_build_get_ctx(build);
+	build->reuse = isl_calloc_type(ctx, struct isl_ast_build_reuse);
+	if (!build->reuse)
+		return isl_ast_build_free(build);
+	build->reuse->ref = 1;
+	build->reuse->ctx = ctx;
+	isl_ctx_ref(ctx);
+
+	return build;
+}
+
+/* Are "coincident1" and "coincident2" equal, where either
+ * may be NULL to indicate the absence of coincidence information?
+ */
+static int coincident_is_equal(__isl_keep isl_union_map *coincident1,
+	__isl_keep isl_union_map *coincident2)
+{
+	if (!coincident1 || !coincident2)
+		return coincident1 == coincident2;
+	return isl_union_map_is_equal(coincident1, coincident2);
+}
+
+/* Return a copy of the grafts stored in build->reuse for
+ * an outermost component with inverse schedule "executed",
+ * generated in a build with the same domain, options and
+ * coincidence information as "build".
+ * Return NULL if there are no such grafts.
+ *
+ * The grafts themselves are copied since they may get modified
+ * by the caller.  The AST nodes are shared.
+ */
+__isl_give isl_ast_graft_list *isl_ast_build_reuse_lookup(
+	__isl_keep isl_ast_build *build, __isl_keep isl_union_map *executed)
+{
+	int i;
+	struct isl_ast_build_reuse *reuse;
+
+	if (!build || !build->reuse || !executed)
+		return NULL;
+
+	reuse = build->reuse;
+	for (i = 0; i < reuse->n; ++i) {
+		struct isl_ast_build_reuse_entry *entry = &reuse->entry[i];
+		int equal;
+
+		equal = isl_set_plain_is_equal(entry->domain, build->domain);
+		if (equal > 0)
+			equal = isl_union_map_is_equal(entry->options,
+							build->options);
+		if (equal > 0)
+			equal = coincident_is_equal(entry->coincident,
+							build->coincident);
+		if (equal > 0)
+			equal = isl_union_map_is_equal(entry->executed,
+							executed);
+		if (equal < 0)
+			return NULL;
+		if (!equal)
+			continue;
+		entry->used = 1;
+		reuse->ctx->stats->ast_reuse_hits++;
+		return isl_ast_graft_list_dup_grafts(entry->list);
+	}
+
+	reuse->ctx->stats->ast_reuse_misses++;
+	return NULL;
+}
+
+/* Store a copy of the grafts in "list", generated for
+ * an outermost component with inverse schedule "executed" in "build",
+ * in build->reuse.
+ */
+int isl_ast_build_reuse_store(__isl_keep isl_ast_build *build,
+	__isl_keep isl_union_map *executed,
+	__isl_keep isl_ast_graft_list *list)
+{
+	struct isl_ast_build_reuse *reuse;
+	struct isl_ast_build_reuse_entry *entry;
+
+	if (!build || !executed || !list)
+		return -1;
+	if (!build->reuse)
+		return 0;
+
+	reuse = build->reuse;
+	if (reuse->n >= reuse->size) {
+		int size = 2 * reuse->size + 4;
+		struct isl_ast_build_reuse_entry *e;
+
+		e = isl_realloc_array(reuse->ctx, reuse->entry,
+				struct isl_ast_build_reuse_entry, size);
+		if (!e)
+			return -1;
+		reuse->entry = e;
+		reuse->size = size;
+	}
+
+	entry = &reuse->entry[reuse->n];
+	entry->executed = isl_union_map_copy(executed);
+	entry->domain = isl_set_copy(build->domain);
+	entry->options = isl_union_map_copy(build->options);
+	entry->coincident = isl_union_map_copy(build->coincident);
+	entry->list = isl_ast_graft_list_dup_grafts(list);
+	entry->used = 1;
+	reuse->n++;
+
+	if (!entry->list)
+		return -1;
+
+	return 0;
+}
+
+/* Remove all entries from build->reuse that have not been used
+ * during the latest code generation and reset the "used" flags
+ * of the remaining entries.
+ */
+void isl_ast_build_reuse_prune(__isl_keep isl_ast_build *build)
+{
+	int i, j;
+	struct isl_ast_build_reuse *reuse;
+
+	if (!build || !build->reuse)
+		return;
+
+	reuse = build->reuse;
+	for (i = 0, j = 0; i < reuse->n; ++i) {
+		if (!reuse->entry[i].used) {
+			clear_reuse_entry(&reuse->entry[i]);
+			continue;
+		}
+		reuse->entry[i].used = 0;
+		if (i != j)
+			reuse->entry[j] = reuse->entry[i];
+		++j;
+	}
+	reuse->n = j;
+}
+
+/* Does build->expr_memo refer to the current domain, values and
+ * iterators of "build"?
+ */
+static int expr_memo_is_valid(__isl_keep isl_ast_build *build)
+{
+	struct isl_ast_build_expr_memo *memo = build->expr_memo;
+
+	return memo && memo->domain == build->domain &&
+		memo->values == build->values &&
+		memo->iterators == build->iterators;
+}
+
+/* Return a hash value for "pa" that is only based on the number
+ * of pieces and on the coefficients of the affine expressions.
+ */
+static uint32_t pw_aff_get_hash(__isl_keep isl_pw_aff *pa)
+{
+	int i;
+	uint32_t hash;
+
+	hash = isl_hash_init();
+	isl_hash_hash(hash, pa->n);
+	for (i = 0; i < pa->n; ++i) {
+		isl_vec *v = pa->p[i].aff->v;
+		uint32_t h = isl_seq_get_hash(v->el, v->size);
+		isl_hash_hash(hash, h);
+	}
+
+	return hash;
+}
+
+/* Return a copy of the AST expression that was previously constructed
+ * from "pa" in a build with the same domain, values and iterators
+ * as "build".
+ * Return NULL if there is no such expression.
+ */
+__isl_give isl_ast_expr *isl_ast_build_expr_memo_lookup(
+	__isl_keep isl_ast_build *build, __isl_keep isl_pw_aff *pa)
+{
+	int i;
+	uint32_t hash;
+	struct isl_ast_build_expr_memo *memo;
+
+	if (!build || !pa)
+		return NULL;
+
+	if (!expr_memo_is_valid(build)) {
+		isl_ast_build_get_ctx(build)->stats->ast_expr_memo_misses++;
+		return NULL;
+	}
+
+	memo = build->expr_memo;
+	hash = pw_aff_get_hash(pa);
+	for (i = 0; i < memo->n; ++i) {
+		struct isl_ast_build_expr_memo_entry *entry = &memo->entry[i];
+		int equal;
+
+		if (entry->hash != hash)
+			continue;
+		equal = isl_pw_aff_plain_is_equal(entry->pa, pa);
+		if (equal < 0)
+			return NULL;
+		if (!equal)
+			continue;
+		memo->ctx->stats->ast_expr_memo_hits++;
+		return isl_ast_expr_copy(entry->expr);
+	}
+
+	memo->ctx->stats->ast_expr_memo_misses++;
+	return NULL;
+}
+
+/* Create a fresh (empty) memo for the current domain, values and
+ * iterators of "build".
+ */
+static struct isl_ast_build_expr_memo *expr_memo_alloc(
+	__isl_keep isl_ast_build *build)
+{
+	isl_ctx *ctx;
+	struct isl_ast_build_expr_memo *memo;
+
+	ctx = isl_ast_build_get_ctx(build);
+	memo = isl_calloc_type(ctx, struct isl_ast_build_expr_memo);
+	if (!memo)
+		return NULL;
+
+	memo->ref = 1;
+	memo->ctx = ctx;
+	isl_ctx_ref(ctx);
+	memo->domain = isl_set_copy(build->domain);
+	memo->values = isl_multi_aff_copy(build->values);
+	memo->iterators = isl_id_list_copy(build->iterators);
+
+	return memo;
+}
+
+/* Store a copy of "expr", constructed from "pa" in "build",
+ * in build->expr_memo.
+ * If build->expr_memo refers to a different domain, values or
+ * iterators, then it is first replaced by a fresh memo.
+ * If the memo is full, then the oldest entry is replaced.
+ */
+int isl_ast_build_expr_memo_store(__isl_keep isl_ast_build *build,
+	__isl_keep isl_pw_aff *pa, __isl_keep isl_ast_expr *expr)
+{
+	struct isl_ast_build_expr_memo *memo;
+	struct isl_ast_build_expr_memo_entry *entry;
+
+	if (!build || !pa || !expr)
+		return -1;
+
+	if (!expr_memo_is_valid(build)) {
+		isl_ast_build_expr_memo_free(build->expr_memo);
+		build->expr_memo = expr_memo_alloc(build);
+		if (!build->expr_memo)
+			return -1;
+	}
+
+	memo = build->expr_memo;
+	if (memo->n < ISL_AST_BUILD_EXPR_MEMO_SIZE) {
+		entry = &memo->entry[memo->n++];
+	} else {
+		entry = &memo->entry[memo->next];
+		memo->next = (memo->next + 1) % ISL_AST_BUILD_EXPR_MEMO_SIZE;
+		isl_pw_aff_free(entry->pa);
+		isl_ast_expr_free(entry->expr);
+	}
+	entry->hash = pw_aff_get_hash(pa);
+	entry->pa = isl_pw_aff_copy(pa);
+	entry->expr = isl_ast_expr_copy(expr);
+
+	return 0;
+}
+
 /* Clear all information that is specific to this code generation
  * and that is (probably) not meaningful to any nested code generation.
  */
@@ -416,6 +900,8 @@ __isl_give isl_ast_build *isl_ast_build_clear_local_info(
 	space = isl_union_map_get_space(build->options);
 	isl_union_map_free(build->options);
 	build->options = isl_union_map_empty(space);
+	isl_union_map_free(build->coincident);
+	build->coincident = NULL;
 
 	build->at_each_domain = NULL;
 	build->at_each_domain_user = NULL;
@@ -425,6 +911,9 @@ __isl_give isl_ast_build *isl_ast_build_clear_local_info(
 	build->after_each_for_user = NULL;
 	build->create_leaf = NULL;
 	build->create_leaf_user = NULL;
+	build->stream = NULL;
+	build->stream_user = NULL;
+	build->reuse = isl_ast_build_reuse_free(build->reuse);
 
 	if (!build->options)
 		return isl_ast_build_free(build);
@@ -1271,7 +1760,7 @@ struct isl_detect_stride_data {
  *
  * The expression "-a h(p)/g" can therefore be used as offset.
  */
-static int detect_stride(__isl_take isl_constraint *c, void *user)
+static int detect_stride(__isl_keep isl_constraint *c, void *user)
 {
 	struct isl_detect_stride_data *data = user;
 	int i, n_div;
@@ -1279,10 +1768,8 @@ static int detect_stride(__isl_take isl_constraint *c, void *user)
 	isl_val *v, *stride, *m;
 
 	if (!isl_constraint_is_equality(c) ||
-	    !isl_constraint_involves_dims(c, isl_dim_set, data->pos, 1)) {
-		isl_constraint_free(c);
+	    !isl_constraint_involves_dims(c, isl_dim_set, data->pos, 1))
 		return 0;
-	}
 
 	ctx = isl_constraint_get_ctx(c);
 	stride = isl_val_zero(ctx);
@@ -1320,7 +1807,6 @@ static int detect_stride(__isl_take isl_constraint *c, void *user)
 		isl_val_free(v);
 	}
 
-	isl_constraint_free(c);
 	return 0;
 }
 
@@ -1349,7 +1835,8 @@ __isl_give isl_ast_build *isl_ast_build_detect_strides(
 	data.pos = isl_ast_build_get_depth(build);
 	hull = isl_set_affine_hull(set);
 
-	if (isl_basic_set_foreach_constraint(hull, &detect_stride, &data) < 0)
+	if (isl_basic_set_foreach_constraint_view(hull,
+					&detect_stride, &data) < 0)
 		data.build = isl_ast_build_free(data.build);
 
 	isl_basic_set_free(hull);
@@ -1399,6 +1886,46 @@ int isl_ast_build_options_involve_depth(__isl_keep isl_ast_build *build)
 	return data.involves;
 }
 
+/* Is the dimension at the current depth coincident for all
+ * statement instances that are executed by build->executed?
+ * That is, are all those instances mapped to coincident[depth]
+ * by build->coincident?
+ *
+ * If there is no coincidence information, then the dimension
+ * is not considered to be coincident.
+ * Note that the positions in build->coincident are relative
+ * to the current AST generation.
+ */
+int isl_ast_build_is_coincident(__isl_keep isl_ast_build *build)
+{
+	int is_coincident;
+	isl_ctx *ctx;
+	isl_space *space;
+	isl_set *set;
+	isl_union_set *instances, *coincident;
+
+	if (!build)
+		return -1;
+	if (!build->coincident || !build->executed)
+		return 0;
+
+	ctx = isl_ast_build_get_ctx(build);
+	space = isl_space_set_alloc(ctx, 0, 1);
+	space = isl_space_set_tuple_name(space, isl_dim_set, "coincident");
+	set = isl_set_universe(space);
+	set = isl_set_fix_si(set, isl_dim_set, 0,
+				build->depth - build->outer_pos);
+	coincident = isl_union_map_domain(isl_union_map_intersect_range(
+			    isl_union_map_copy(build->coincident),
+			    isl_union_set_from_set(set)));
+	instances = isl_union_map_range(isl_union_map_copy(build->executed));
+	is_coincident = isl_union_set_is_subset(instances, coincident);
+	isl_union_set_free(instances);
+	isl_union_set_free(coincident);
+
+	return is_coincident;
+}
+
 /* Construct the map
  *
  *	{ [i] -> [i] : i < pos; [i] -> [i + 1] : i >= pos }
@@ -1493,11 +2020,39 @@ static __isl_give isl_union_map *options_insert_dim(
 	return options;
 }
 
+/* Update "coincident" to reflect the insertion of a dimension
+ * at position "pos" in the schedule domain space.
+ * That is, apply the map
+ *
+ *	{ coincident[i] -> coincident[i] : i < pos;
+ *	  coincident[i] -> coincident[i + 1] : i >= pos }
+ *
+ * The inserted dimension itself is not considered to be coincident.
+ */
+static __isl_give isl_union_map *coincident_insert_dim(
+	__isl_take isl_union_map *coincident, int pos)
+{
+	isl_map *map;
+
+	if (!coincident)
+		return NULL;
+
+	map = construct_insertion_map(isl_union_map_get_space(coincident), pos);
+	map = isl_map_set_tuple_name(map, isl_dim_in, "coincident");
+	map = isl_map_set_tuple_name(map, isl_dim_out, "coincident");
+	coincident = isl_union_map_apply_range(coincident,
+						isl_union_map_from_map(map));
+
+	return coincident;
+}
+
 /* Insert a single dimension in the schedule domain at position "pos".
  * The new dimension is given an isl_id with the empty string as name.
  *
  * The main difficulty is updating build->options to reflect the
  * extra dimension.  This is handled in options_insert_dim.
+ * The positions in build->coincident, if any, are updated
+ * in a similar way.
  *
  * Note that because of the dimension manipulations, the resulting
  * schedule domain space will always be unnamed and unstructured.
@@ -1538,6 +2093,12 @@ __isl_give isl_ast_build *isl_ast_build_insert_dim(
 	ma = isl_multi_aff_identity(ma_space);
 	build->values = isl_multi_aff_splice(build->values, pos, pos, ma);
 	build->options = options_insert_dim(build->options, space, pos);
+	if (build->coincident) {
+		build->coincident = coincident_insert_dim(build->coincident,
+							pos);
+		if (!build->coincident)
+			return isl_ast_build_free(build);
+	}
 
 	if (!build->iterators || !build->domain || !build->generated ||
 	    !build->pending || !build->values ||
@@ -1861,6 +2422,30 @@ int isl_ast_build_has_value(__isl_keep isl_ast_build *build)
 	return build->value != NULL;
 }
 
+/* Return the simple hull of build->domain.
+ *
+ * We cache a copy of the simple hull in build->hull, along with
+ * the value of build->domain for which it was computed.
+ * Since we keep a reference to this value, any change to build->domain
+ * results in a different object and the cached hull is recomputed.
+ */
+static __isl_give isl_basic_set *isl_ast_build_get_domain_hull(
+	__isl_keep isl_ast_build *build)
+{
+	if (!build)
+		return NULL;
+
+	if (build->hull && build->hull_domain == build->domain)
+		return isl_basic_set_copy(build->hull);
+
+	isl_set_free(build->hull_domain);
+	isl_basic_set_free(build->hull);
+	build->hull_domain = isl_set_copy(build->domain);
+	build->hull = isl_set_simple_hull(isl_set_copy(build->domain));
+
+	return isl_basic_set_copy(build->hull);
+}
+
 /* Simplify the basic set "bset" based on what we know about
  * the iterators of already generated loops.
  *
@@ -1874,8 +2459,7 @@ __isl_give isl_basic_set *isl_ast_build_compute_gist_basic_set(
 
 	bset = isl_basic_set_preimage_multi_aff(bset,
 					isl_multi_aff_copy(build->values));
-	bset = isl_basic_set_gist(bset,
-			isl_set_simple_hull(isl_set_copy(build->domain)));
+	bset = isl_basic_set_gist(bset, isl_ast_build_get_domain_hull(build));
 
 	return bset;
 error:
@@ -1883,20 +2467,50 @@ error:
 	return NULL;
 }
 
+/* Return a context for computing gists with respect to build->domain.
+ *
+ * As in isl_ast_build_get_domain_hull, the context is cached
+ * in build->gist_context, along with the value of build->domain
+ * for which it was computed.  The context is shared
+ * among copies of "build" and only recomputed when build->domain changes.
+ */
+static isl_map_gist_context *isl_ast_build_get_gist_context(
+	__isl_keep isl_ast_build *build)
+{
+	if (!build)
+		return NULL;
+
+	if (build->gist_context && build->gist_domain == build->domain)
+		return build->gist_context;
+
+	isl_set_free(build->gist_domain);
+	isl_map_gist_context_free(build->gist_context);
+	build->gist_domain = isl_set_copy(build->domain);
+	build->gist_context =
+		isl_set_gist_context_alloc(isl_set_copy(build->domain));
+
+	return build->gist_context;
+}
+
 /* Simplify the set "set" based on what we know about
  * the iterators of already generated loops.
  *
  * "set" is assumed to live in the (internal) schedule domain.
+ * The gist is computed using a context that is reused
+ * for all gists with respect to the same build->domain.
  */
 __isl_give isl_set *isl_ast_build_compute_gist(
 	__isl_keep isl_ast_build *build, __isl_take isl_set *set)
 {
+	isl_map_gist_context *gc;
+
 	if (!build)
 		goto error;
 
 	set = isl_set_preimage_multi_aff(set,
 					isl_multi_aff_copy(build->values));
-	set = isl_set_gist(set, isl_set_copy(build->domain));
+	gc = isl_ast_build_get_gist_context(build);
+	set = isl_set_gist_with_context(set, gc);
 
 	return set;
 error:
@@ -541,7 +541,7 @@ static int mod_constraint_is_simpler(struct isl_extract_mod_data *data,
  * very well involve such coefficients.  This means that we may actually
  * miss some cases.
  */
-static int check_parallel_or_opposite(__isl_take isl_constraint *c, void *user)
+static int check_parallel_or_opposite(__isl_keep isl_constraint *c, void *user)
 {
 	struct isl_extract_mod_data *data = user;
 	enum isl_dim_type c_type[2] = { isl_dim_param, isl_dim_set };
@@ -592,8 +592,6 @@ static int check_parallel_or_opposite(__isl_take isl_constraint *c, void *user)
 		data->sign = parallel ? 1 : -1;
 	}
 
-	isl_constraint_free(c);
-
 	if (data->sign != 0 && data->nonneg == NULL)
 		return -1;
 
@@ -697,7 +695,8 @@ static int try_extract_mod(struct isl_extract_mod_data *data)
 	hull = isl_basic_set_remove_divs(hull);
 	data->sign = 0;
 	data->nonneg = NULL;
-	r = isl_basic_set_foreach_constraint(hull, &check_parallel_or_opposite,
+	r = isl_basic_set_foreach_constraint_view(hull,
+					&check_parallel_or_opposite,
 					data);
 	isl_basic_set_free(hull);
 
@@ -1309,17 +1308,33 @@ static int ast_expr_from_pw_aff(__isl_take isl_set *set,
  * The result is simplified in terms of build->domain.
  *
  * The domain of "pa" lives in the internal schedule space.
+ *
+ * The same expression is frequently converted several times
+ * in the same build, e.g., in a guard, in a for condition and
+ * in the children.  The results are therefore memoized in the build
+ * and a previously constructed expression is returned if "pa"
+ * was already converted for the same domain, values and iterators.
  */
 __isl_give isl_ast_expr *isl_ast_build_expr_from_pw_aff_internal(
 	__isl_keep isl_ast_build *build, __isl_take isl_pw_aff *pa)
 {
 	struct isl_from_pw_aff_data data;
 	isl_ast_expr *res = NULL;
+	isl_pw_aff *key;
+
+	res = isl_ast_build_expr_memo_lookup(build, pa);
+	if (res) {
+		isl_pw_aff_free(pa);
+		return res;
+	}
+	key = isl_pw_aff_copy(pa);
 
 	pa = isl_ast_build_compute_gist_pw_aff(build, pa);
 	pa = isl_pw_aff_coalesce(pa);
-	if (!pa)
+	if (!pa) {
+		isl_pw_aff_free(key);
 		return NULL;
+	}
 
 	data.build = build;
 	data.n = isl_pw_aff_n_piece(pa);
@@ -1332,6 +1347,10 @@ __isl_give isl_ast_expr *isl_ast_build_expr_from_pw_aff_internal(
 		isl_die(isl_pw_aff_get_ctx(pa), isl_error_invalid,
 			"cannot handle void expression", res = NULL);
 
+	if (res && isl_ast_build_expr_memo_store(build, key, res) < 0)
+		res = isl_ast_expr_free(res);
+
+	isl_pw_aff_free(key);
 	isl_pw_aff_free(pa);
 	isl_set_free(data.dom);
 	return res;
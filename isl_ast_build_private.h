@@ -7,6 +7,77 @@
 #include <isl/set.h>
 #include <isl/list.h>
 
+struct isl_ast_graft_list;
+
+/* An entry in an isl_ast_build_reuse cache.
+ *
+ * "list" contains the grafts that were generated for the outermost
+ * component with inverse schedule "executed" in a build with
+ * domain "domain", options "options" and coincidence information
+ * "coincident".
+ * "used" is set if the entry was used during the latest code generation.
+ */
+struct isl_ast_build_reuse_entry {
+	isl_union_map *executed;
+	isl_set *domain;
+	isl_union_map *options;
+	isl_union_map *coincident;
+	struct isl_ast_graft_list *list;
+	int used;
+};
+
+/* A cache of the grafts generated for the outermost components
+ * of an AST, shared by all copies of an isl_ast_build.
+ *
+ * "entry" has room for "size" elements, "n" of which are in use.
+ */
+struct isl_ast_build_reuse {
+	int ref;
+
+	isl_ctx *ctx;
+
+	int n;
+	int size;
+	struct isl_ast_build_reuse_entry *entry;
+};
+
+#define ISL_AST_BUILD_EXPR_MEMO_SIZE	16
+
+/* An entry in an isl_ast_build_expr_memo.
+ *
+ * "expr" is the AST expression constructed from "pa",
+ * which has hash value "hash".
+ */
+struct isl_ast_build_expr_memo_entry {
+	uint32_t hash;
+	isl_pw_aff *pa;
+	isl_ast_expr *expr;
+};
+
+/* A memo of the AST expressions constructed from piecewise
+ * affine expressions, shared by all copies of an isl_ast_build
+ * that have the same "domain", "values" and "iterators".
+ * References to these objects are kept such that a build
+ * with different values for these fields necessarily
+ * refers to different objects.
+ *
+ * "entry" contains "n" elements.  Once it is full,
+ * the entry at position "next" is replaced first.
+ */
+struct isl_ast_build_expr_memo {
+	int ref;
+
+	isl_ctx *ctx;
+
+	isl_set *domain;
+	isl_multi_aff *values;
+	isl_id_list *iterators;
+
+	int n;
+	int next;
+	struct isl_ast_build_expr_memo_entry entry[ISL_AST_BUILD_EXPR_MEMO_SIZE];
+};
+
 enum isl_ast_build_domain_type {
 	atomic,
 	unroll,
@@ -89,6 +160,24 @@ enum isl_ast_build_domain_type {
  * domain.  It may be NULL if it hasn't been computed yet.
  * See isl_ast_build_get_schedule_map_multi_aff.
  *
+ * "hull" is the simple hull of "hull_domain", which is
+ * the value of "domain" for which "hull" was computed.
+ * Since a reference to "hull_domain" is kept, "hull" is valid
+ * if and only if "hull_domain" is the same object as "domain".
+ * Both may be NULL if the simple hull hasn't been computed yet.
+ * See isl_ast_build_compute_gist_basic_set.
+ *
+ * Similarly, "gist_context" is a context for computing gists
+ * with respect to "gist_domain", which is valid if and only if
+ * "gist_domain" is the same object as "domain".
+ * See isl_ast_build_compute_gist.
+ *
+ * "coincident" is set by isl_ast_build_set_coincident and maps
+ * statement instances to elements coincident[d], with "d" a position
+ * in the schedule domain of the current AST generation, for each
+ * scheduling dimension that is known to be coincident for that instance.
+ * It is NULL if no such information is available.
+ *
  * The "create_leaf" callback is called for every leaf in the generated AST.
  * The callback is responsible for creating the node to be placed at those
  * leaves.  If this callback is not set, then isl will generated user
@@ -104,6 +193,24 @@ enum isl_ast_build_domain_type {
  * The "after_each_for" callback is called on each for node after
  * its children have been created.
  *
+ * The "stream" callback is only set by
+ * isl_ast_build_foreach_ast_from_schedule.  If it is set, then
+ * the grafts generated for each outermost component are passed
+ * to this callback as soon as they have been generated instead of
+ * being collected.
+ *
+ * "reuse" is set by isl_ast_build_set_reuse_subtrees.  If it is set,
+ * then the grafts generated for the outermost components are
+ * stored in this cache and reused by later code generations
+ * for identical components.
+ *
+ * "expr_memo" contains the AST expressions that were constructed
+ * from piecewise affine expressions for the current values
+ * of "domain", "values" and "iterators".  It may be NULL
+ * or refer to different values of these fields, in which case
+ * it is replaced on the next store.
+ * See isl_ast_build_expr_memo_lookup.
+ *
  * "executed" contains the inverse schedule at this point
  * of the AST generation.
  * It is currently only used in isl_ast_build_get_schedule, which is
@@ -119,6 +226,7 @@ enum isl_ast_build_domain_type {
  */
 struct isl_ast_build {
 	int ref;
+	isl_ctx *ctx;
 
 	int outer_pos;
 	int depth;
@@ -137,7 +245,14 @@ struct isl_ast_build {
 
 	isl_multi_aff *schedule_map;
 
+	isl_set *hull_domain;
+	isl_basic_set *hull;
+
+	isl_set *gist_domain;
+	struct isl_map_gist_context *gist_context;
+
 	isl_union_map *options;
+	isl_union_map *coincident;
 
 	__isl_give isl_ast_node *(*at_each_domain)(
 		__isl_take isl_ast_node *node,
@@ -156,10 +271,33 @@ struct isl_ast_build {
 		__isl_take isl_ast_build *build, void *user);
 	void *create_leaf_user;
 
+	int (*stream)(__isl_take struct isl_ast_graft_list *list, void *user);
+	void *stream_user;
+
+	struct isl_ast_build_reuse *reuse;
+
+	struct isl_ast_build_expr_memo *expr_memo;
+
 	isl_union_map *executed;
 	int single_valued;
 };
 
+void isl_ast_build_clear_free_list(isl_ctx *ctx);
+
+__isl_give isl_ast_build *isl_ast_build_set_stream(
+	__isl_take isl_ast_build *build,
+	int (*fn)(__isl_take struct isl_ast_graft_list *list, void *user),
+	void *user);
+__isl_give struct isl_ast_graft_list *isl_ast_build_reuse_lookup(
+	__isl_keep isl_ast_build *build, __isl_keep isl_union_map *executed);
+int isl_ast_build_reuse_store(__isl_keep isl_ast_build *build,
+	__isl_keep isl_union_map *executed,
+	__isl_keep struct isl_ast_graft_list *list);
+void isl_ast_build_reuse_prune(__isl_keep isl_ast_build *build);
+__isl_give isl_ast_expr *isl_ast_build_expr_memo_lookup(
+	__isl_keep isl_ast_build *build, __isl_keep isl_pw_aff *pa);
+int isl_ast_build_expr_memo_store(__isl_keep isl_ast_build *build,
+	__isl_keep isl_pw_aff *pa, __isl_keep isl_ast_expr *expr);
 __isl_give isl_ast_build *isl_ast_build_clear_local_info(
 	__isl_take isl_ast_build *build);
 __isl_give isl_ast_build *isl_ast_build_increase_depth(
@@ -263,5 +401,6 @@ __isl_give isl_map *isl_ast_build_map_to_iterator(
 	__isl_keep isl_ast_build *build, __isl_take isl_set *set);
 
 int isl_ast_build_options_involve_depth(__isl_keep isl_ast_build *build);
+int isl_ast_build_is_coincident(__isl_keep isl_ast_build *build);
 
 #endif
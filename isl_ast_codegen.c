@@ -10,17 +10,22 @@
  * B.P. 105 - 78153 Le Chesnay, France
  */
 
+#include <isl_config.h>
 #include <limits.h>
 #include <isl/aff.h>
 #include <isl/set.h>
 #include <isl/ilp.h>
 #include <isl/union_map.h>
+#include <isl/options.h>
 #include <isl_sort.h>
 #include <isl_tarjan.h>
+#include <isl_ctx_private.h>
 #include <isl_ast_private.h>
 #include <isl_ast_build_expr.h>
 #include <isl_ast_build_private.h>
 #include <isl_ast_graft_private.h>
+#include <isl_profile.h>
+#include <isl_thread.h>
 
 /* Data used in generate_domain.
  *
@@ -1271,11 +1276,15 @@ static __isl_give isl_ast_graft *refine_generic(
 /* Create a for node for the current level.
  *
  * Mark the for node degenerate if "degenerate" is set.
+ * Mark it coincident if the current dimension is coincident
+ * for all statement instances executed by the loop
+ * (see isl_ast_build_set_coincident).
  */
 static __isl_give isl_ast_node *create_for(__isl_keep isl_ast_build *build,
 	int degenerate)
 {
 	int depth;
+	int coincident;
 	isl_id *id;
 	isl_ast_node *node;
 
@@ -1287,6 +1296,11 @@ static __isl_give isl_ast_node *create_for(__isl_keep isl_ast_build *build,
 	node = isl_ast_node_alloc_for(id);
 	if (degenerate)
 		node = isl_ast_node_for_mark_degenerate(node);
+	coincident = isl_ast_build_is_coincident(build);
+	if (coincident < 0)
+		return isl_ast_node_free(node);
+	if (coincident)
+		node = isl_ast_node_for_mark_coincident(node);
 
 	return node;
 }
@@ -1500,17 +1514,15 @@ struct isl_check_scaled_data {
  * reducing data->m if needed.
  * Break out of the iteration if data->m has become equal to "1".
  */
-static int constraint_check_scaled(__isl_take isl_constraint *c, void *user)
+static int constraint_check_scaled(__isl_keep isl_constraint *c, void *user)
 {
 	struct isl_check_scaled_data *data = user;
 	int i, j, n;
 	enum isl_dim_type t[] = { isl_dim_param, isl_dim_in, isl_dim_out,
 				    isl_dim_div };
 
-	if (!isl_constraint_involves_dims(c, isl_dim_in, data->depth, 1)) {
-		isl_constraint_free(c);
+	if (!isl_constraint_involves_dims(c, isl_dim_in, data->depth, 1))
 		return 0;
-	}
 
 	for (i = 0; i < 4; ++i) {
 		n = isl_constraint_dim(c, t[i]);
@@ -1530,8 +1542,6 @@ static int constraint_check_scaled(__isl_take isl_constraint *c, void *user)
 			break;
 	}
 
-	isl_constraint_free(c);
-
 	return i < 4 ? -1 : 0;
 }
 
@@ -1540,15 +1550,10 @@ static int constraint_check_scaled(__isl_take isl_constraint *c, void *user)
  * reducing data->m if needed.
  * Break out of the iteration if data->m has become equal to "1".
  */
-static int basic_map_check_scaled(__isl_take isl_basic_map *bmap, void *user)
+static int basic_map_check_scaled(__isl_keep isl_basic_map *bmap, void *user)
 {
-	int r;
-
-	r = isl_basic_map_foreach_constraint(bmap,
+	return isl_basic_map_foreach_constraint_view(bmap,
 						&constraint_check_scaled, user);
-	isl_basic_map_free(bmap);
-
-	return r;
 }
 
 /* For each constraint of "map" that involves the input dimension data->depth,
@@ -1556,14 +1561,10 @@ static int basic_map_check_scaled(__isl_take isl_basic_map *bmap, void *user)
  * reducing data->m if needed.
  * Break out of the iteration if data->m has become equal to "1".
  */
-static int map_check_scaled(__isl_take isl_map *map, void *user)
+static int map_check_scaled(__isl_keep isl_map *map, void *user)
 {
-	int r;
-
-	r = isl_map_foreach_basic_map(map, &basic_map_check_scaled, user);
-	isl_map_free(map);
-
-	return r;
+	return isl_map_foreach_basic_map_peek(map,
+					&basic_map_check_scaled, user);
 }
 
 /* Create an AST node for the current dimension based on
@@ -1640,7 +1641,7 @@ static __isl_give isl_ast_graft *create_node(__isl_take isl_union_map *executed,
 	}
 
 	if (!isl_val_is_one(data.m)) {
-		if (isl_union_map_foreach_map(executed, &map_check_scaled,
+		if (isl_union_map_foreach_map_peek(executed, &map_check_scaled,
 						&data) < 0 &&
 		    !isl_val_is_one(data.m))
 			executed = isl_union_map_free(executed);
@@ -1998,27 +1999,54 @@ static __isl_give isl_ast_graft_list *generate_sorted_domains(
 	return data.list;
 }
 
-/* Do i and j share any values for the outer dimensions?
+/* Do the domains at positions i and j share any values
+ * for the outer dimensions?
+ *
+ * "user" is a list containing the projections of the domains
+ * onto their outer dimensions.
  */
-static int shared_outer(__isl_keep isl_basic_set *i,
-	__isl_keep isl_basic_set *j, void *user)
+static int shared_outer(int i, int j, void *user)
 {
-	int depth = *(int *) user;
-	isl_basic_map *test;
+	isl_basic_set_list *outer = user;
+	isl_basic_set *test;
 	int empty;
-	int l;
 
-	test = isl_basic_map_from_domain_and_range(isl_basic_set_copy(i),
-						    isl_basic_set_copy(j));
-	for (l = 0; l < depth; ++l)
-		test = isl_basic_map_equate(test, isl_dim_in, l,
-						isl_dim_out, l);
-	empty = isl_basic_map_is_empty(test);
-	isl_basic_map_free(test);
+	test = isl_basic_set_list_get_basic_set(outer, i);
+	test = isl_basic_set_intersect(test,
+				isl_basic_set_list_get_basic_set(outer, j));
+	empty = isl_basic_set_is_empty(test);
+	isl_basic_set_free(test);
 
 	return empty < 0 ? -1 : !empty;
 }
 
+/* Project each of the domains in "domain_list" onto
+ * its first "depth" dimensions.
+ */
+static __isl_give isl_basic_set_list *project_outer(
+	__isl_keep isl_basic_set_list *domain_list, int depth)
+{
+	int i, n;
+	isl_ctx *ctx;
+	isl_basic_set_list *outer;
+
+	ctx = isl_basic_set_list_get_ctx(domain_list);
+	n = isl_basic_set_list_n_basic_set(domain_list);
+	outer = isl_basic_set_list_alloc(ctx, n);
+	for (i = 0; i < n; ++i) {
+		isl_basic_set *bset;
+		int dim;
+
+		bset = isl_basic_set_list_get_basic_set(domain_list, i);
+		dim = isl_basic_set_dim(bset, isl_dim_set);
+		bset = isl_basic_set_project_out(bset, isl_dim_set,
+						depth, dim - depth);
+		outer = isl_basic_set_list_add(outer, bset);
+	}
+
+	return outer;
+}
+
 /* Internal data structure for generate_sorted_domains_wrap.
  *
  * "n" is the total number of basic sets
@@ -2084,12 +2112,35 @@ static int generate_sorted_domains_wrap(__isl_take isl_basic_set_list *scc,
  * final list can be freely reordered.  In particular, we sort them
  * according to an arbitrary but fixed ordering to ease merging of
  * graft lists from different components.
+ *
+ * Since the test is performed on the projections of the domains
+ * onto the outer dimensions, we compute these projections once
+ * rather than once for every pair of domains, and then compute
+ * the components directly on the resulting graph.
+ * If there is only a single component, then generate_sorted_domains
+ * is called on the original list to preserve the order of the domains.
+ *
+ * The components are not generated by worker threads
+ * (unlike the separation bounds in separate_schedule_domains).
+ * Generating a component calls the callbacks of "build"
+ * (create_leaf, at_each_domain, before_each_for, after_each_for, ...),
+ * which are passed the build and AST nodes and return
+ * AST nodes and identifiers (with user pointers) that need to live
+ * in the isl_ctx of the caller.  In a worker, they would be called
+ * concurrently and on objects in a different isl_ctx.
+ * Moreover, the components would have to be generated from
+ * an imported copy of "build", including its stream and reuse state,
+ * and the resulting grafts, with their AST nodes and expressions,
+ * would have to be imported back.
  */
 static __isl_give isl_ast_graft_list *generate_parallel_domains(
 	__isl_keep isl_basic_set_list *domain_list,
 	__isl_keep isl_union_map *executed, __isl_keep isl_ast_build *build)
 {
-	int depth;
+	int i, n;
+	isl_ctx *ctx;
+	isl_basic_set_list *outer;
+	struct isl_tarjan_graph *g;
 	struct isl_ast_generate_parallel_domains_data data;
 
 	if (!domain_list)
@@ -2099,16 +2150,53 @@ static __isl_give isl_ast_graft_list *generate_parallel_domains(
 	if (data.n <= 1)
 		return generate_sorted_domains(domain_list, executed, build);
 
-	depth = isl_ast_build_get_depth(build);
+	ctx = isl_basic_set_list_get_ctx(domain_list);
+	outer = project_outer(domain_list, isl_ast_build_get_depth(build));
+	if (!outer)
+		return NULL;
+	g = isl_tarjan_graph_init(ctx, data.n, &shared_outer, outer);
+	isl_basic_set_list_free(outer);
+	if (!g)
+		return NULL;
+
 	data.list = NULL;
 	data.executed = executed;
 	data.build = build;
 	data.single = 0;
-	if (isl_basic_set_list_foreach_scc(domain_list, &shared_outer, &depth,
-					    &generate_sorted_domains_wrap,
-					    &data) < 0)
-		data.list = isl_ast_graft_list_free(data.list);
 
+	i = 0;
+	n = data.n;
+	while (n) {
+		isl_basic_set_list *scc;
+		int first = i;
+
+		if (g->order[i] == -1)
+			isl_die(ctx, isl_error_internal, "cannot happen",
+				break);
+		while (g->order[i] != -1) {
+			++i; --n;
+		}
+
+		if (first == 0 && n == 0) {
+			scc = isl_basic_set_list_copy(domain_list);
+			first = i;
+		} else
+			scc = isl_basic_set_list_alloc(ctx, i - first);
+		for (; first < i; ++first) {
+			isl_basic_set *bset;
+
+			bset = isl_basic_set_list_get_basic_set(domain_list,
+							g->order[first]);
+			scc = isl_basic_set_list_add(scc, bset);
+		}
+		if (generate_sorted_domains_wrap(scc, &data) < 0)
+			break;
+		++i;
+	}
+	isl_tarjan_graph_free(g);
+
+	if (n > 0)
+		data.list = isl_ast_graft_list_free(data.list);
 	if (!data.single)
 		data.list = isl_ast_graft_list_sort_guard(data.list);
 
@@ -2125,6 +2213,8 @@ struct isl_separate_domain_data {
 	isl_ast_build *build;
 	int explicit;
 	isl_set *domain;
+	int max;
+	int exceeded;
 };
 
 /* Extract implicit bounds on the current dimension for the executed "map".
@@ -2173,33 +2263,172 @@ static __isl_give isl_set *explicit_bounds(__isl_take isl_map *map,
 	return domain;
 }
 
-/* Split data->domain into pieces that intersect with the range of "map"
- * and pieces that do not intersect with the range of "map"
- * and then add that part of the range of "map" that does not intersect
- * with data->domain.
+/* Extract the (explicit or implicit) bounds on the current dimension
+ * for the executed "map", as a disjoint set.
+ *
+ * Only the depth of "build" is used, such that this function
+ * may be called on a "map" that lives in a different isl_ctx than "build".
  */
-static int separate_domain(__isl_take isl_map *map, void *user)
+static __isl_give isl_set *separation_bounds(__isl_take isl_map *map,
+	__isl_keep isl_ast_build *build, int explicit)
 {
-	struct isl_separate_domain_data *data = user;
 	isl_set *domain;
-	isl_set *d1, *d2;
 
-	if (data->explicit)
-		domain = explicit_bounds(map, data->build);
+	if (explicit)
+		domain = explicit_bounds(map, build);
 	else
-		domain = implicit_bounds(map, data->build);
+		domain = implicit_bounds(map, build);
 
 	domain = isl_set_coalesce(domain);
 	domain = isl_set_make_disjoint(domain);
+
+	return domain;
+}
+
+/* Split data->domain into pieces that intersect with "domain"
+ * and pieces that do not intersect with "domain"
+ * and then add that part of "domain" that does not intersect
+ * with data->domain.
+ *
+ * If data->max is non-negative and the number of pieces exceeds data->max,
+ * then set data->exceeded and abort.
+ */
+static int add_separate_domain(struct isl_separate_domain_data *data,
+	__isl_take isl_set *domain)
+{
+	isl_set *d1, *d2;
+
 	d1 = isl_set_subtract(isl_set_copy(domain), isl_set_copy(data->domain));
 	d2 = isl_set_subtract(isl_set_copy(data->domain), isl_set_copy(domain));
 	data->domain = isl_set_intersect(data->domain, domain);
 	data->domain = isl_set_union(data->domain, d1);
 	data->domain = isl_set_union(data->domain, d2);
 
+	if (data->max >= 0 && data->domain &&
+	    isl_set_n_basic_set(data->domain) > data->max) {
+		data->exceeded = 1;
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Split data->domain along the bounds of the executed "map".
+ */
+static int separate_domain(__isl_take isl_map *map, void *user)
+{
+	struct isl_separate_domain_data *data = user;
+	isl_set *domain;
+
+	domain = separation_bounds(map, data->build, data->explicit);
+	return add_separate_domain(data, domain);
+}
+
+#ifdef HAVE_PTHREAD
+
+/* Internal data for separate_domains_threads.
+ *
+ * "data" is the data of the sequential computation.
+ * "map" contains the "n" executed maps and "res" the corresponding bounds,
+ * imported back into "ctx", the isl_ctx of the executed maps.
+ */
+struct isl_separate_threads {
+	isl_ctx *ctx;
+	struct isl_separate_domain_data *data;
+	int n;
+	isl_map **map;
+	isl_set **res;
+};
+
+/* Import executed map "i" into the isl_ctx of "worker",
+ * compute its bounds and import them back.
+ */
+static int separate_work(struct isl_thread_worker *worker, int i, void *user)
+{
+	struct isl_separate_threads *threads = user;
+	struct isl_separate_domain_data *data = threads->data;
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	isl_map *map;
+	isl_set *bounds;
+
+	isl_thread_worker_lock(worker);
+	map = isl_map_import(ctx, threads->map[i]);
+	isl_thread_worker_unlock(worker);
+
+	bounds = separation_bounds(map, data->build, data->explicit);
+
+	isl_thread_worker_lock(worker);
+	threads->res[i] = isl_set_import(threads->ctx, bounds);
+	isl_thread_worker_unlock(worker);
+	isl_set_free(bounds);
+
+	return threads->res[i] ? 0 : -1;
+}
+
+/* Add "map" to the array pointed to by "user".
+ */
+static int collect_executed(__isl_take isl_map *map, void *user)
+{
+	isl_map ***next = user;
+
+	*(*next)++ = map;
 	return 0;
 }
 
+/* Split data->domain along the bounds of the maps in "executed",
+ * computing these bounds in parallel.
+ *
+ * Each thread has its own isl_ctx, with the same options as
+ * the isl_ctx of "executed", into which it imports the maps that it handles
+ * (see isl_thread_run).
+ * The bounds are only combined with data->domain
+ * after all threads have finished, in the same order as
+ * in separate_schedule_domains, such that the result is the same
+ * as that of the sequential computation.
+ */
+static int separate_domains_threads(struct isl_separate_domain_data *data,
+	__isl_keep isl_union_map *executed)
+{
+	int i, r = 0;
+	isl_ctx *ctx;
+	isl_map **next;
+	struct isl_separate_threads threads = { NULL, data };
+
+	ctx = isl_union_map_get_ctx(executed);
+	threads.ctx = ctx;
+	threads.n = isl_union_map_n_map(executed);
+	threads.map = isl_calloc_array(ctx, isl_map *, threads.n);
+	threads.res = isl_calloc_array(ctx, isl_set *, threads.n);
+	if (!threads.map || !threads.res)
+		goto error;
+	next = threads.map;
+	if (isl_union_map_foreach_map(executed, &collect_executed, &next) < 0)
+		goto error;
+	if (isl_thread_run(ctx, threads.n, &separate_work, &threads) < 0)
+		goto error;
+
+	for (i = 0; i < threads.n; ++i) {
+		isl_set *bounds = threads.res[i];
+
+		threads.res[i] = NULL;
+		if (add_separate_domain(data, bounds) < 0)
+			goto error;
+	}
+
+	if (0)
+error:
+		r = -1;
+	for (i = 0; threads.res && i < threads.n; ++i)
+		isl_set_free(threads.res[i]);
+	for (i = 0; threads.map && i < threads.n; ++i)
+		isl_map_free(threads.map[i]);
+	free(threads.res);
+	free(threads.map);
+	return r;
+}
+
+#endif
+
 /* Separate the schedule domains of "executed".
  *
  * That is, break up the domain of "executed" into basic sets,
@@ -2207,20 +2436,39 @@ static int separate_domain(__isl_take isl_map *map, void *user)
  * the same domain spaces.
  *
  * "space" is the (single) domain space of "executed".
+ *
+ * If "max" is non-negative and the domain would need to be broken up
+ * into more than "max" basic sets, then set *exceeded and return NULL.
+ *
+ * If the threads option is set to a value greater than one and
+ * isl has been built with thread support,
+ * then the bounds of the different maps in "executed"
+ * are computed in parallel.
  */
 static __isl_give isl_set *separate_schedule_domains(
 	__isl_take isl_space *space, __isl_take isl_union_map *executed,
-	__isl_keep isl_ast_build *build)
+	__isl_keep isl_ast_build *build, int max, int *exceeded)
 {
 	struct isl_separate_domain_data data = { build };
 	isl_ctx *ctx;
+	int r;
 
 	ctx = isl_ast_build_get_ctx(build);
 	data.explicit = isl_options_get_ast_build_separation_bounds(ctx) ==
 				    ISL_AST_BUILD_SEPARATION_BOUNDS_EXPLICIT;
+	data.max = max;
+	data.exceeded = 0;
 	data.domain = isl_set_empty(space);
-	if (isl_union_map_foreach_map(executed, &separate_domain, &data) < 0)
+#ifdef HAVE_PTHREAD
+	if (isl_options_get_threads(ctx) > 1 &&
+	    isl_union_map_n_map(executed) > 1)
+		r = separate_domains_threads(&data, executed);
+	else
+#endif
+	r = isl_union_map_foreach_map(executed, &separate_domain, &data);
+	if (r < 0)
 		data.domain = isl_set_free(data.domain);
+	*exceeded = data.exceeded;
 
 	isl_union_map_free(executed);
 	return data.domain;
@@ -2314,16 +2562,12 @@ error:
 /* Check if we can use "c" as a lower bound and if it is better than
  * any previously found lower bound.
  */
-static int constraint_find_unroll(__isl_take isl_constraint *c, void *user)
+static int constraint_find_unroll(__isl_keep isl_constraint *c, void *user)
 {
 	struct isl_find_unroll_data *data;
-	int r;
 
 	data = (struct isl_find_unroll_data *) user;
-	r = update_unrolling_lower_bound(data, c);
-	isl_constraint_free(c);
-
-	return r;
+	return update_unrolling_lower_bound(data, c);
 }
 
 /* Look for a lower bound l(i) on the dimension at "depth"
@@ -2355,7 +2599,7 @@ static __isl_give isl_aff *find_unroll_lower_bound(__isl_keep isl_set *domain,
 
 	hull = isl_set_simple_hull(isl_set_copy(domain));
 
-	if (isl_basic_set_foreach_constraint(hull,
+	if (isl_basic_set_foreach_constraint_view(hull,
 					    &constraint_find_unroll, &data) < 0)
 		goto error;
 
@@ -2416,6 +2660,53 @@ struct isl_codegen_domains {
 	isl_set *done;
 };
 
+/* Return the maximal number of pieces into which a domain
+ * involving "n_stmt" statements may be split up at the current level,
+ * according to the ast_build_max_pieces option.
+ * Return -1 if there is no limit.
+ */
+static int max_pieces(isl_ctx *ctx, int n_stmt)
+{
+	int max;
+
+	max = isl_options_get_ast_build_max_pieces(ctx);
+	if (max <= 0)
+		return -1;
+	if (n_stmt < 1)
+		n_stmt = 1;
+	return max / n_stmt;
+}
+
+/* Add a single basic set that includes "domain" to domains->list,
+ * after eliminating inner dimensions, and remove it from "class_domain".
+ * Return the updated class domain.
+ *
+ * "domain" is a subset of the intersection of the schedule domain and
+ * the class domain.
+ * The basic set is intersected with "class_domain" and made disjoint
+ * to ensure that it does not intersect with any other class domains.
+ */
+static __isl_give isl_set *do_atomic(struct isl_codegen_domains *domains,
+	__isl_take isl_set *domain, __isl_take isl_set *class_domain)
+{
+	isl_basic_set *bset;
+	isl_basic_set_list *list;
+	isl_set *atomic_domain;
+
+	domain = isl_ast_build_eliminate(domains->build, domain);
+	domain = isl_set_coalesce(domain);
+	bset = isl_set_unshifted_simple_hull(domain);
+	domain = isl_set_from_basic_set(bset);
+	atomic_domain = isl_set_copy(domain);
+	domain = isl_set_intersect(domain, isl_set_copy(class_domain));
+	class_domain = isl_set_subtract(class_domain, atomic_domain);
+	domain = isl_set_make_disjoint(domain);
+	list = isl_basic_set_list_from_set(domain);
+	domains->list = isl_basic_set_list_concat(domains->list, list);
+
+	return class_domain;
+}
+
 /* Extend domains->list with a list of basic sets, one for each value
  * of the current dimension in "domain" and remove the corresponding
  * sets from the class domain.  Return the updated class domain.
@@ -2452,6 +2743,10 @@ struct isl_codegen_domains {
  * Since we may have dropped some constraints, we intersect with
  * the class domain again to ensure that each element in the list
  * is disjoint from the other class domains.
+ *
+ * If the number of values n exceeds the limit imposed by
+ * the ast_build_max_pieces option, then "domain" is handled
+ * as an atomic domain instead.
  */
 static __isl_give isl_set *do_unroll(struct isl_codegen_domains *domains,
 	__isl_take isl_set *domain, __isl_take isl_set *class_domain)
@@ -2463,12 +2758,15 @@ static __isl_give isl_set *do_unroll(struct isl_codegen_domains *domains,
 	isl_multi_aff *expansion;
 	isl_basic_map *bmap;
 	isl_set *unroll_domain;
+	isl_set *orig;
 	isl_ast_build *build;
+	int max;
 
 	if (!domain)
 		return isl_set_free(class_domain);
 
 	ctx = isl_set_get_ctx(domain);
+	orig = isl_set_copy(domain);
 	depth = isl_ast_build_get_depth(domains->build);
 	build = isl_ast_build_copy(domains->build);
 	domain = isl_ast_build_eliminate_inner(build, domain);
@@ -2486,6 +2784,16 @@ static __isl_give isl_set *do_unroll(struct isl_codegen_domains *domains,
 	if (!lower)
 		class_domain = isl_set_free(class_domain);
 
+	max = max_pieces(ctx, isl_union_map_n_map(domains->executed));
+	if (lower && max >= 0 && n > max) {
+		ctx->stats->ast_unroll_degraded++;
+		isl_aff_free(lower);
+		isl_set_free(domain);
+		isl_multi_aff_free(expansion);
+		return do_atomic(domains, orig, class_domain);
+	}
+	isl_set_free(orig);
+
 	bmap = isl_basic_map_from_multi_aff(expansion);
 
 	unroll_domain = isl_set_empty(isl_set_get_space(domain));
@@ -2597,9 +2905,7 @@ static __isl_give isl_set *compute_unroll_domains(
 static __isl_give isl_set *compute_atomic_domain(
 	struct isl_codegen_domains *domains, __isl_take isl_set *class_domain)
 {
-	isl_basic_set *bset;
-	isl_basic_set_list *list;
-	isl_set *domain, *atomic_domain;
+	isl_set *domain;
 	int empty;
 
 	domain = isl_set_copy(domains->option[atomic]);
@@ -2614,18 +2920,7 @@ static __isl_give isl_set *compute_atomic_domain(
 		return class_domain;
 	}
 
-	domain = isl_ast_build_eliminate(domains->build, domain);
-	domain = isl_set_coalesce(domain);
-	bset = isl_set_unshifted_simple_hull(domain);
-	domain = isl_set_from_basic_set(bset);
-	atomic_domain = isl_set_copy(domain);
-	domain = isl_set_intersect(domain, isl_set_copy(class_domain));
-	class_domain = isl_set_subtract(class_domain, atomic_domain);
-	domain = isl_set_make_disjoint(domain);
-	list = isl_basic_set_list_from_set(domain);
-	domains->list = isl_basic_set_list_concat(domains->list, list);
-
-	return class_domain;
+	return do_atomic(domains, domain, class_domain);
 }
 
 /* Split up the schedule domain into uniform basic sets,
@@ -2633,40 +2928,62 @@ static __isl_give isl_set *compute_atomic_domain(
  * elements of the same domains, and add the result to domains->list.
  * Do this for that part of the schedule domain that lies in the
  * intersection of "class_domain" and the separate option domain.
+ * Return the updated class domain.
  *
  * "class_domain" may or may not include the constraints
  * of the schedule domain, but this does not make a difference
  * since we are going to intersect it with the domain of the inverse schedule.
  * If it includes schedule domain constraints, then they may involve
  * inner dimensions, but we will eliminate them in separation_domain.
+ *
+ * If the schedule domain would need to be split up into more pieces
+ * than allowed by the ast_build_max_pieces option, then
+ * the part of the schedule domain that should be separated
+ * is handled as an atomic domain instead and
+ * it is removed from the class domain.
  */
-static int compute_separate_domain(struct isl_codegen_domains *domains,
-	__isl_keep isl_set *class_domain)
+static __isl_give isl_set *compute_separate_domain(
+	struct isl_codegen_domains *domains, __isl_take isl_set *class_domain)
 {
+	isl_ctx *ctx;
 	isl_space *space;
-	isl_set *domain;
+	isl_set *domain, *sep;
 	isl_union_map *executed;
 	isl_basic_set_list *list;
 	int empty;
+	int max, exceeded;
 
 	domain = isl_set_copy(domains->option[separate]);
 	domain = isl_set_intersect(domain, isl_set_copy(class_domain));
 	executed = isl_union_map_copy(domains->executed);
 	executed = isl_union_map_intersect_domain(executed,
-				    isl_union_set_from_set(domain));
+				    isl_union_set_from_set(isl_set_copy(domain)));
 	empty = isl_union_map_is_empty(executed);
 	if (empty < 0 || empty) {
 		isl_union_map_free(executed);
-		return empty < 0 ? -1 : 0;
+		isl_set_free(domain);
+		return empty < 0 ? isl_set_free(class_domain) : class_domain;
 	}
 
+	ctx = isl_set_get_ctx(class_domain);
+	max = max_pieces(ctx, isl_union_map_n_map(executed));
 	space = isl_set_get_space(class_domain);
-	domain = separate_schedule_domains(space, executed, domains->build);
+	sep = separate_schedule_domains(space, executed, domains->build,
+					max, &exceeded);
+	if (exceeded) {
+		ctx->stats->ast_separate_degraded++;
+		domain = isl_set_intersect(domain,
+				isl_set_copy(domains->schedule_domain));
+		return do_atomic(domains, domain, class_domain);
+	}
 
-	list = isl_basic_set_list_from_set(domain);
+	isl_set_free(domain);
+	if (!sep)
+		return isl_set_free(class_domain);
+	list = isl_basic_set_list_from_set(sep);
 	domains->list = isl_basic_set_list_concat(domains->list, list);
 
-	return 0;
+	return class_domain;
 }
 
 /* Split up the domain at the current depth into disjoint
@@ -2681,6 +2998,9 @@ static int compute_separate_domain(struct isl_codegen_domains *domains,
  * previously considered class domains.
  *
  * The separate domains can be computed directly from the "class_domain".
+ * If they are handled as atomic domains instead because of
+ * the ast_build_max_pieces option, then they are removed
+ * from "class_domain".
  *
  * The unroll, atomic and remainder domains need the constraints
  * from the schedule domain.
@@ -2719,11 +3039,11 @@ static int compute_partial_domains(struct isl_codegen_domains *domains,
 
 	class_domain = compute_atomic_domain(domains, class_domain);
 	class_domain = compute_unroll_domains(domains, class_domain);
+	class_domain = compute_separate_domain(domains, class_domain);
+	if (!class_domain)
+		return -1;
 
 	domain = isl_set_copy(class_domain);
-
-	if (compute_separate_domain(domains, domain) < 0)
-		goto error;
 	domain = isl_set_subtract(domain,
 				    isl_set_copy(domains->option[separate]));
 
@@ -2742,10 +3062,6 @@ static int compute_partial_domains(struct isl_codegen_domains *domains,
 	isl_set_free(class_domain);
 
 	return 0;
-error:
-	isl_set_free(domain);
-	isl_set_free(class_domain);
-	return -1;
 }
 
 /* Split up the domain at the current depth into disjoint
@@ -3514,6 +3830,36 @@ static int any_scheduled_after(int i, int j, void *user)
 	return data->group_coscheduled;
 }
 
+/* Generate code for a single outermost component, reusing the grafts
+ * that were generated for the same component by a previous
+ * code generation with the same build, if any.
+ * Otherwise, the component is generated by generate_component and
+ * the result is stored in build->reuse.
+ *
+ * The component inverse schedule is specified as the "map" fields
+ * of the elements of "domain" indexed by the first "n" elements of "order".
+ */
+static __isl_give isl_ast_graft_list *generate_component_reuse(
+	struct isl_set_map_pair *domain, int *order, int n,
+	__isl_take isl_ast_build *build)
+{
+	isl_union_map *executed;
+	isl_ast_graft_list *list;
+
+	executed = construct_component_executed(domain, order, n);
+	list = isl_ast_build_reuse_lookup(build, executed);
+	if (!list) {
+		list = generate_component(domain, order, n,
+					    isl_ast_build_copy(build));
+		if (isl_ast_build_reuse_store(build, executed, list) < 0)
+			list = isl_ast_graft_list_free(list);
+	}
+	isl_union_map_free(executed);
+	isl_ast_build_free(build);
+
+	return list;
+}
+
 /* Look for independent components at the current depth and generate code
  * for each component separately.  The resulting lists of grafts are
  * merged in an attempt to combine grafts with identical guards.
@@ -3530,6 +3876,15 @@ static int any_scheduled_after(int i, int j, void *user)
  * for each of the strongly connected components in this graph
  * in their topological order.
  *
+ * If we are streaming the outermost components of the AST
+ * (see isl_ast_build_foreach_ast_from_schedule), then the grafts
+ * of each component are passed to build->stream immediately
+ * and are not merged with those of other components.
+ *
+ * If the grafts of the outermost components are being kept for reuse
+ * (see isl_ast_build_set_reuse_subtrees), then they are generated
+ * by generate_component_reuse instead.
+ *
  * Since the test is performed on the domain of the inverse schedules of
  * the different domains, we precompute these domains and store
  * them in data.domain.
@@ -3578,10 +3933,19 @@ static __isl_give isl_ast_graft_list *generate_components(
 			++i; --n;
 		}
 
-		list_c = generate_component(data.domain,
+		if (data.depth == 0 && build->reuse)
+			list_c = generate_component_reuse(data.domain,
 					    g->order + first, i - first,
 					    isl_ast_build_copy(build));
-		list = isl_ast_graft_list_merge(list, list_c, build);
+		else
+			list_c = generate_component(data.domain,
+					    g->order + first, i - first,
+					    isl_ast_build_copy(build));
+		if (data.depth == 0 && build->stream) {
+			if (build->stream(list_c, build->stream_user) < 0)
+				goto error;
+		} else
+			list = isl_ast_graft_list_merge(list, list_c, build);
 
 		++i;
 	}
@@ -3617,26 +3981,33 @@ error:		list = isl_ast_graft_list_free(list);
 static __isl_give isl_ast_graft_list *generate_next_level(
 	__isl_take isl_union_map *executed, __isl_take isl_ast_build *build)
 {
-	int depth;
+	isl_ctx *ctx;
+	isl_ast_graft_list *list;
+	int depth, n;
 
 	if (!build || !executed)
 		goto error;
 
+	ctx = isl_ast_build_get_ctx(build);
 	if (isl_union_map_is_empty(executed)) {
-		isl_ctx *ctx = isl_ast_build_get_ctx(build);
 		isl_union_map_free(executed);
 		isl_ast_build_free(build);
 		return isl_ast_graft_list_alloc(ctx, 0);
 	}
 
 	depth = isl_ast_build_get_depth(build);
+	n = isl_union_map_n_map(executed);
+	isl_trace_begin(ctx, "codegen level", "\"depth\": %d, \"n\": %d",
+			depth, n);
 	if (depth >= isl_ast_build_dim(build, isl_dim_set))
-		return generate_inner_level(executed, build);
-
-	if (isl_union_map_n_map(executed) == 1)
-		return generate_shifted_component(executed, build);
+		list = generate_inner_level(executed, build);
+	else if (n == 1)
+		list = generate_shifted_component(executed, build);
+	else
+		list = generate_components(executed, build);
+	isl_trace_end(ctx, "codegen level");
 
-	return generate_components(executed, build);
+	return list;
 error:
 	isl_union_map_free(executed);
 	isl_ast_build_free(build);
@@ -3726,6 +4097,8 @@ static __isl_give isl_union_map *internal_executed(
  * If the original build space was not parametric, we undo the embedding
  * on the resulting isl_ast_node_list so that it can be used within
  * the outer AST build.
+ * Otherwise, if the result is being streamed, then it is passed
+ * to data->build->stream instead of being added to data->list.
  */
 static int generate_code_in_space(struct isl_generate_code_data *data,
 	__isl_take isl_set *set, __isl_take isl_space *space)
@@ -3756,6 +4129,9 @@ static int generate_code_in_space(struct isl_generate_code_data *data,
 
 	list = isl_ast_graft_list_unembed(list, embed);
 
+	if (!embed && data->build->stream)
+		return data->build->stream(list, data->build->stream_user);
+
 	data->list = isl_ast_graft_list_concat(data->list, list);
 
 	return 0;
@@ -3901,21 +4277,101 @@ error:
  * The main computation is performed on an inverse schedule (with
  * the schedule domain in the domain and the elements to be executed
  * in the range) called "executed".
+ *
+ * Any grafts kept for reuse that were not needed
+ * during this code generation are discarded at the end.
  */
 __isl_give isl_ast_node *isl_ast_build_ast_from_schedule(
 	__isl_keep isl_ast_build *build, __isl_take isl_union_map *schedule)
 {
+	isl_ctx *ctx = isl_ast_build_get_ctx(build);
 	isl_ast_graft_list *list;
 	isl_ast_node *node;
 	isl_union_map *executed;
+	struct isl_profile_node *prof;
 
+	prof = isl_profile_enter(ctx, "isl_ast_build_ast_from_schedule");
 	build = isl_ast_build_copy(build);
 	build = isl_ast_build_set_single_valued(build, 0);
 	schedule = isl_union_map_coalesce(schedule);
 	executed = isl_union_map_reverse(schedule);
 	list = generate_code(executed, isl_ast_build_copy(build), 0);
+	isl_ast_build_reuse_prune(build);
 	node = isl_ast_node_from_graft_list(list, build);
 	isl_ast_build_free(build);
+	isl_profile_leave(ctx, prof);
 
 	return node;
 }
+
+/* Internal data structure for isl_ast_build_foreach_ast_from_schedule.
+ *
+ * "build" is the build passed to isl_ast_build_foreach_ast_from_schedule.
+ * "fn" and "user" are the user callback and its argument.
+ */
+struct isl_ast_stream_data {
+	isl_ast_build *build;
+	int (*fn)(__isl_take isl_ast_node *node, void *user);
+	void *user;
+};
+
+/* Construct an AST node from the grafts in "list" and pass it
+ * to data->fn.  Nothing is passed to data->fn if "list" is empty.
+ */
+static int stream_graft_list(__isl_take isl_ast_graft_list *list, void *user)
+{
+	struct isl_ast_stream_data *data = user;
+	isl_ast_node *node;
+
+	if (!list)
+		return -1;
+	if (isl_ast_graft_list_n_ast_graft(list) == 0) {
+		isl_ast_graft_list_free(list);
+		return 0;
+	}
+
+	node = isl_ast_node_from_graft_list(list, data->build);
+	if (!node)
+		return -1;
+
+	return data->fn(node, data->user);
+}
+
+/* Generate an AST that visits the elements in the domain of "schedule"
+ * in the relative order specified by the corresponding image element(s),
+ * as in isl_ast_build_ast_from_schedule, and pass the AST to "fn"
+ * in pieces.  Each piece is passed to "fn" as soon as it has been
+ * generated such that the complete AST never needs to be kept in memory.
+ *
+ * The pieces are the outermost components of the AST, in the order
+ * in which they need to be executed.  The grafts of different
+ * components are not merged, so the pieces may enforce some guards
+ * separately that would be combined by isl_ast_build_ast_from_schedule.
+ * Any remaining part of the AST that was not passed to "fn" during
+ * the code generation, e.g., because "build" is not parametric,
+ * is passed to "fn" at the end.
+ */
+int isl_ast_build_foreach_ast_from_schedule(__isl_keep isl_ast_build *build,
+	__isl_take isl_union_map *schedule,
+	int (*fn)(__isl_take isl_ast_node *node, void *user), void *user)
+{
+	struct isl_ast_stream_data data = { NULL, fn, user };
+	isl_ast_build *gen_build;
+	isl_ast_graft_list *list;
+	isl_union_map *executed;
+	int r;
+
+	data.build = isl_ast_build_copy(build);
+	data.build = isl_ast_build_set_single_valued(data.build, 0);
+	gen_build = isl_ast_build_copy(data.build);
+	gen_build = isl_ast_build_set_stream(gen_build,
+					    &stream_graft_list, &data);
+	schedule = isl_union_map_coalesce(schedule);
+	executed = isl_union_map_reverse(schedule);
+	list = generate_code(executed, gen_build, 0);
+	isl_ast_build_reuse_prune(data.build);
+	r = stream_graft_list(list, &data);
+	isl_ast_build_free(data.build);
+
+	return r;
+}
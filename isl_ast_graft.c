@@ -97,8 +97,69 @@ static __isl_give isl_ast_graft *isl_ast_graft_copy(
 	return graft;
 }
 
+/* Return a fresh copy of "graft" that shares its node, guard and
+ * enforced conditions with "graft".
+ * Since grafts are modified in place, this copy needs to be used
+ * whenever a graft may still be referenced elsewhere.
+ */
+static __isl_give isl_ast_graft *isl_ast_graft_dup(
+	__isl_keep isl_ast_graft *graft)
+{
+	isl_ctx *ctx;
+	isl_ast_graft *dup;
+
+	if (!graft)
+		return NULL;
+
+	ctx = isl_ast_graft_get_ctx(graft);
+	dup = isl_calloc_type(ctx, isl_ast_graft);
+	if (!dup)
+		return NULL;
+
+	dup->ref = 1;
+	dup->node = isl_ast_node_copy(graft->node);
+	dup->guard = isl_set_copy(graft->guard);
+	dup->enforced = isl_basic_set_copy(graft->enforced);
+
+	if (!dup->node || !dup->guard || !dup->enforced)
+		return isl_ast_graft_free(dup);
+
+	return dup;
+}
+
+/* Return a list of fresh copies of the grafts in "list".
+ * The AST nodes are shared with those of the grafts in "list".
+ */
+__isl_give isl_ast_graft_list *isl_ast_graft_list_dup_grafts(
+	__isl_keep isl_ast_graft_list *list)
+{
+	int i, n;
+	isl_ctx *ctx;
+	isl_ast_graft_list *dup;
+
+	if (!list)
+		return NULL;
+
+	ctx = isl_ast_graft_list_get_ctx(list);
+	n = isl_ast_graft_list_n_ast_graft(list);
+	dup = isl_ast_graft_list_alloc(ctx, n);
+	for (i = 0; i < n; ++i) {
+		isl_ast_graft *graft;
+
+		graft = isl_ast_graft_list_get_ast_graft(list, i);
+		dup = isl_ast_graft_list_add(dup, isl_ast_graft_dup(graft));
+		isl_ast_graft_free(graft);
+	}
+
+	return dup;
+}
+
 /* Do all the grafts in "list" have the same guard and is this guard
  * independent of the current depth?
+ *
+ * The guards of the grafts are often obviously equal,
+ * so we first perform a plain comparison and only
+ * perform a full equality test if this comparison fails.
  */
 static int equal_independent_guards(__isl_keep isl_ast_graft_list *list,
 	__isl_keep isl_ast_build *build)
@@ -127,6 +188,9 @@ static int equal_independent_guards(__isl_keep isl_ast_graft_list *list,
 		if (!graft)
 			equal = -1;
 		else
+			equal = isl_set_plain_is_equal(graft_0->guard,
+							graft->guard);
+		if (equal == 0)
 			equal = isl_set_is_equal(graft_0->guard, graft->guard);
 		isl_ast_graft_free(graft);
 		if (equal < 0 || !equal)
@@ -532,6 +596,11 @@ static int clear_if_nodes(struct isl_if_node *if_node, int first, int n)
  * Otherwise, the current graft is appended to the list.
  *
  * We only construct else branches if allowed by the user.
+ *
+ * Consecutive grafts often have the same guard.  The guard of a graft
+ * is therefore first compared to the original guard of each if node.
+ * If they are obviously equal, then the graft can be inserted
+ * into the then branch without performing a subset test.
  */
 static __isl_give isl_ast_graft_list *insert_pending_guard_nodes(
 	__isl_take isl_ast_graft_list *list,
@@ -577,7 +646,10 @@ static __isl_give isl_ast_graft_list *insert_pending_guard_nodes(
 			test = isl_set_intersect(test,
 						isl_set_copy(build->domain));
 			for (j = n_if - 1; j >= 0; --j) {
-				subset = isl_set_is_subset(test,
+				subset = isl_set_plain_is_equal(graft->guard,
+							if_node[j].guard);
+				if (subset == 0)
+					subset = isl_set_is_subset(test,
 							if_node[j].guard);
 				if (subset < 0 || subset) {
 					found_then = j;
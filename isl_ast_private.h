@@ -10,6 +10,9 @@
 
 /* An expression is either an integer, an identifier or an operation
  * with zero or more arguments.
+ *
+ * The arguments of operations with at most two arguments
+ * are stored in "inline_args" to avoid a separate allocation.
  */
 struct isl_ast_expr {
 	int ref;
@@ -25,6 +28,7 @@ struct isl_ast_expr {
 			enum isl_ast_op_type op;
 			unsigned n_arg;
 			isl_ast_expr **args;
+			isl_ast_expr *inline_args[2];
 		} op;
 	} u;
 };
@@ -34,6 +38,8 @@ struct isl_ast_expr {
 
 #include <isl_list_templ.h>
 
+void isl_ast_clear_free_list(isl_ctx *ctx);
+
 __isl_give isl_ast_expr *isl_ast_expr_alloc_int_si(isl_ctx *ctx, int i);
 __isl_give isl_ast_expr *isl_ast_expr_alloc_op(isl_ctx *ctx,
 	enum isl_ast_op_type op, int n_arg);
@@ -66,6 +72,7 @@ struct isl_ast_node {
 		} i;
 		struct {
 			unsigned degenerate : 1;
+			unsigned coincident : 1;
 			isl_ast_expr *iterator;
 			isl_ast_expr *init;
 			isl_ast_expr *cond;
@@ -83,6 +90,8 @@ struct isl_ast_node {
 __isl_give isl_ast_node *isl_ast_node_alloc_for(__isl_take isl_id *id);
 __isl_give isl_ast_node *isl_ast_node_for_mark_degenerate(
 	__isl_take isl_ast_node *node);
+__isl_give isl_ast_node *isl_ast_node_for_mark_coincident(
+	__isl_take isl_ast_node *node);
 __isl_give isl_ast_node *isl_ast_node_alloc_if(__isl_take isl_ast_expr *guard);
 __isl_give isl_ast_node *isl_ast_node_alloc_block(
 	__isl_take isl_ast_node_list *list);
@@ -93,10 +102,15 @@ __isl_give isl_ast_node *isl_ast_node_for_set_body(
 __isl_give isl_ast_node *isl_ast_node_if_set_then(
 	__isl_take isl_ast_node *node, __isl_take isl_ast_node *child);
 
+/* "in_parallel" is set by the printer while printing the body
+ * of a loop that has been annotated as a parallel loop.
+ */
 struct isl_ast_print_options {
 	int ref;
 	isl_ctx *ctx;
 
+	int in_parallel;
+
 	__isl_give isl_printer *(*print_for)(__isl_take isl_printer *p,
 		__isl_take isl_ast_print_options *options,
 		__isl_keep isl_ast_node *node, void *user);
@@ -10,8 +10,12 @@
  * and Ecole Normale Superieure, 45 rue d'Ulm, 75230 Paris, France
  */
 
+#include <isl/set.h>
 #include <isl_band_private.h>
 #include <isl_schedule_private.h>
+#include <isl_aff_private.h>
+#include <isl_val_private.h>
+#include <isl_vec_private.h>
 
 #undef BASE
 #define BASE band
@@ -330,188 +334,322 @@ int isl_band_list_foreach_band(__isl_keep isl_band_list *list,
 	return 0;
 }
 
-/* Internal data used during the construction of the schedule
- * for the tile loops.
- *
- * sizes contains the tile sizes
- * scale is set if the tile loops should be scaled
- * tiled collects the result for a single statement
- * res collects the result for all statements
+/* A single piece of the partial schedule of a band,
+ * with domain "set" and affine expressions "ma".
+ * "aff" contains the n_member affine expressions of "ma".
  */
-struct isl_band_tile_data {
-	isl_multi_val *sizes;
-	isl_union_pw_multi_aff *res;
-	isl_pw_multi_aff *tiled;
-	int scale;
+struct isl_band_tile_plan_piece {
+	isl_set *set;
+	isl_multi_aff *ma;
+	isl_aff **aff;
 };
 
-/* Given part of the schedule of a band, construct the corresponding
- * schedule for the tile loops based on the tile sizes in data->sizes
- * and add the result to data->tiled.
- *
- * If data->scale is set, then dimension i of the schedule will be
- * of the form
- *
- *	m_i * floor(s_i(x) / m_i)
+/* A plan for tiling a band with different tile sizes.
  *
- * where s_i(x) refers to the original schedule and m_i is the tile size.
- * If data->scale is not set, then dimension i of the schedule will be
- * of the form
- *
- *	floor(s_i(x) / m_i)
+ * The plan contains all the information about the partial schedule
+ * of the band that does not depend on the tile sizes.
+ * "space" is the space of the partial schedule.
+ * "pw_space" contains the spaces of the "n_pw" isl_pw_multi_affs
+ * in the partial schedule.  The pieces of isl_pw_multi_aff i are
+ * stored in "piece", from position pw_first[i] up to pw_first[i + 1].
  *
+ * The tile sizes are only plugged into the affine expressions
+ * in isl_band_tile_plan_apply.
  */
-static int multi_aff_tile(__isl_take isl_set *set,
-	__isl_take isl_multi_aff *ma, void *user)
+struct isl_band_tile_plan {
+	isl_ctx *ctx;
+
+	int n_member;
+	isl_space *space;
+
+	int n_pw;
+	int size_pw;
+	isl_space **pw_space;
+	int *pw_first;
+
+	int n_piece;
+	int size_piece;
+	struct isl_band_tile_plan_piece *piece;
+};
+
+__isl_null isl_band_tile_plan *isl_band_tile_plan_free(
+	__isl_take isl_band_tile_plan *plan)
 {
-	struct isl_band_tile_data *data = user;
-	isl_pw_multi_aff *pma;
-	int i, n;
-	isl_val *v;
+	int i, j;
 
-	n = isl_multi_aff_dim(ma, isl_dim_out);
+	if (!plan)
+		return NULL;
 
-	for (i = 0; i < n; ++i) {
-		isl_aff *aff;
+	for (i = 0; plan->piece && i < plan->n_piece; ++i) {
+		struct isl_band_tile_plan_piece *piece = &plan->piece[i];
 
-		aff = isl_multi_aff_get_aff(ma, i);
-		v = isl_multi_val_get_val(data->sizes, i);
+		isl_set_free(piece->set);
+		isl_multi_aff_free(piece->ma);
+		if (piece->aff)
+			for (j = 0; j < plan->n_member; ++j)
+				isl_aff_free(piece->aff[j]);
+		free(piece->aff);
+	}
+	for (i = 0; plan->pw_space && i < plan->n_pw; ++i)
+		isl_space_free(plan->pw_space[i]);
+	free(plan->piece);
+	free(plan->pw_space);
+	free(plan->pw_first);
+	isl_space_free(plan->space);
+	free(plan);
 
-		aff = isl_aff_scale_down_val(aff, isl_val_copy(v));
-		aff = isl_aff_floor(aff);
-		if (data->scale)
-			aff = isl_aff_scale_val(aff, isl_val_copy(v));
-		isl_val_free(v);
+	return NULL;
+}
 
-		ma = isl_multi_aff_set_aff(ma, i, aff);
+/* Add the piece with domain "set" and affine expressions "ma"
+ * to the plan "user".
+ */
+static int plan_add_piece(__isl_take isl_set *set,
+	__isl_take isl_multi_aff *ma, void *user)
+{
+	isl_band_tile_plan *plan = user;
+	struct isl_band_tile_plan_piece *piece;
+	int i;
+
+	if (!set || !ma)
+		goto error;
+
+	if (plan->n_piece >= plan->size_piece) {
+		plan->size_piece = 2 * plan->size_piece + 4;
+		plan->piece = isl_realloc_array(plan->ctx, plan->piece,
+			struct isl_band_tile_plan_piece, plan->size_piece);
+		if (!plan->piece)
+			goto error;
 	}
 
-	pma = isl_pw_multi_aff_alloc(set, ma);
-	data->tiled = isl_pw_multi_aff_union_add(data->tiled, pma);
+	piece = &plan->piece[plan->n_piece++];
+	piece->set = set;
+	piece->ma = ma;
+	piece->aff = isl_calloc_array(plan->ctx, isl_aff *, plan->n_member);
+	if (plan->n_member && !piece->aff)
+		return -1;
+	for (i = 0; i < plan->n_member; ++i) {
+		piece->aff[i] = isl_multi_aff_get_aff(ma, i);
+		if (!piece->aff[i])
+			return -1;
+	}
 
 	return 0;
+error:
+	isl_set_free(set);
+	isl_multi_aff_free(ma);
+	return -1;
 }
 
-/* Given part of the schedule of a band, construct the corresponding
- * schedule for the tile loops based on the tile sizes in data->sizes
- * and add the result to data->res.
+/* Add the pieces of "pma" to the plan "user".
  */
-static int pw_multi_aff_tile(__isl_take isl_pw_multi_aff *pma, void *user)
+static int plan_add_pw_multi_aff(__isl_take isl_pw_multi_aff *pma, void *user)
 {
-	struct isl_band_tile_data *data = user;
+	isl_band_tile_plan *plan = user;
 
-	data->tiled = isl_pw_multi_aff_empty(isl_pw_multi_aff_get_space(pma));
+	if (!pma)
+		return -1;
 
-	if (isl_pw_multi_aff_foreach_piece(pma, &multi_aff_tile, data) < 0)
+	if (plan->n_pw >= plan->size_pw) {
+		plan->size_pw = 2 * plan->size_pw + 4;
+		plan->pw_space = isl_realloc_array(plan->ctx, plan->pw_space,
+					isl_space *, plan->size_pw);
+		plan->pw_first = isl_realloc_array(plan->ctx, plan->pw_first,
+					int, plan->size_pw + 1);
+		if (!plan->pw_space || !plan->pw_first)
+			goto error;
+	}
+
+	plan->pw_space[plan->n_pw] = isl_pw_multi_aff_get_space(pma);
+	plan->pw_first[plan->n_pw] = plan->n_piece;
+	plan->n_pw++;
+	if (isl_pw_multi_aff_foreach_piece(pma, &plan_add_piece, plan) < 0)
 		goto error;
+	plan->pw_first[plan->n_pw] = plan->n_piece;
 
 	isl_pw_multi_aff_free(pma);
-	data->res = isl_union_pw_multi_aff_add_pw_multi_aff(data->res,
-								data->tiled);
-
 	return 0;
 error:
 	isl_pw_multi_aff_free(pma);
-	isl_pw_multi_aff_free(data->tiled);
 	return -1;
 }
 
-/* Given the schedule of a band, construct the corresponding
- * schedule for the tile loops based on the given tile sizes
- * and return the result.
+/* Construct a plan for tiling "band".
+ * The plan decomposes the partial schedule of "band" into its pieces
+ * and extracts the affine expressions of all members of the band,
+ * such that tiling the band for a given vector of tile sizes
+ * only requires plugging the tile sizes into these affine expressions.
+ * The plan refers to the partial schedule of "band" at the time
+ * of the construction of the plan.
  */
-static isl_union_pw_multi_aff *isl_union_pw_multi_aff_tile(
-	__isl_take isl_union_pw_multi_aff *sched,
-	__isl_keep isl_multi_val *sizes)
+__isl_give isl_band_tile_plan *isl_band_tile_plan_alloc(
+	__isl_keep isl_band *band)
 {
 	isl_ctx *ctx;
-	isl_space *space;
-	struct isl_band_tile_data data = { sizes };
+	isl_band_tile_plan *plan;
 
-	ctx = isl_multi_val_get_ctx(sizes);
+	if (!band)
+		return NULL;
 
-	space = isl_union_pw_multi_aff_get_space(sched);
-	data.res = isl_union_pw_multi_aff_empty(space);
-	data.scale = isl_options_get_tile_scale_tile_loops(ctx);
+	ctx = isl_band_get_ctx(band);
+	plan = isl_calloc_type(ctx, isl_band_tile_plan);
+	if (!plan)
+		return NULL;
 
-	if (isl_union_pw_multi_aff_foreach_pw_multi_aff(sched,
-						&pw_multi_aff_tile, &data) < 0)
-		goto error;
+	plan->ctx = ctx;
+	plan->n_member = band->n;
+	plan->space = isl_union_pw_multi_aff_get_space(band->pma);
+	if (!plan->space)
+		return isl_band_tile_plan_free(plan);
+	if (isl_union_pw_multi_aff_foreach_pw_multi_aff(band->pma,
+					&plan_add_pw_multi_aff, plan) < 0)
+		return isl_band_tile_plan_free(plan);
 
-	isl_union_pw_multi_aff_free(sched);
-	return data.res;
-error:
-	isl_union_pw_multi_aff_free(sched);
-	isl_union_pw_multi_aff_free(data.res);
-	return NULL;
+	return plan;
 }
 
-/* Extract the range space from "pma" and store it in *user.
- * All entries are expected to have the same range space, so we can
- * stop after extracting the range space from the first entry.
+/* Compute the schedules of the tile loops and the point loops
+ * for the piece "piece" of the plan "plan", with tile sizes "sizes",
+ * and add them to *tile and *point.
+ * "sizes" contains one tile size for each member of the band.
+ *
+ * If "scale" is set, then the tile loops are scaled by the tile sizes.
+ * If "shift" is set, then the point loops are shifted to start at zero.
+ * In particular, these options affect the tile and point loop schedules
+ * as follows
+ *
+ *	scale	shift	original	tile		point
+ *
+ *	0	0	i		floor(i/s)	i
+ *	1	0	i		s * floor(i/s)	i
+ *	0	1	i		floor(i/s)	i - s * floor(i/s)
+ *	1	1	i		s * floor(i/s)	i - s * floor(i/s)
  */
-static int extract_range_space(__isl_take isl_pw_multi_aff *pma, void *user)
+static void tile_piece(__isl_keep isl_band_tile_plan *plan,
+	struct isl_band_tile_plan_piece *piece, isl_val **sizes,
+	int scale, int shift, isl_pw_multi_aff **tile,
+	isl_pw_multi_aff **point)
 {
-	isl_space **space = user;
+	int i;
+	isl_multi_aff *ma_tile, *ma_point;
 
-	*space = isl_space_range(isl_pw_multi_aff_get_space(pma));
-	isl_pw_multi_aff_free(pma);
+	ma_tile = isl_multi_aff_copy(piece->ma);
+	ma_point = isl_multi_aff_copy(piece->ma);
+	for (i = 0; i < plan->n_member; ++i) {
+		isl_aff *aff, *shifted;
 
-	return -1;
+		aff = isl_aff_copy(piece->aff[i]);
+		aff = isl_aff_scale_down_val(aff, isl_val_copy(sizes[i]));
+		aff = isl_aff_floor(aff);
+		if (shift) {
+			shifted = isl_aff_copy(aff);
+			shifted = isl_aff_scale_val(shifted,
+						isl_val_copy(sizes[i]));
+			shifted = isl_aff_sub(isl_aff_copy(piece->aff[i]),
+						shifted);
+			ma_point = isl_multi_aff_set_aff(ma_point, i, shifted);
+		}
+		if (scale)
+			aff = isl_aff_scale_val(aff, isl_val_copy(sizes[i]));
+		ma_tile = isl_multi_aff_set_aff(ma_tile, i, aff);
+	}
+
+	*tile = isl_pw_multi_aff_add_piece(*tile,
+					isl_set_copy(piece->set), ma_tile);
+	*point = isl_pw_multi_aff_add_piece(*point,
+					isl_set_copy(piece->set), ma_point);
 }
 
-/* Extract the range space of "band".  All entries in band->pma should
- * have the same range space.  Furthermore, band->pma should have at least
- * one entry.
+/* Compute the schedules of the tile loops and the point loops
+ * of the band for which "plan" was constructed, for the tile sizes
+ * in "sizes", and return them in *tile and *point.
+ * If "sizes" has fewer elements than the number of members of the band,
+ * then the remaining tile sizes are taken to be one.
+ * The effect of the tile scale tile loops and shift point loops options
+ * is described in tile_piece.
+ *
+ * Since each piece of the point loop schedule is computed
+ * from the same piece of the original schedule as the corresponding
+ * piece of the tile loop schedule, the point loop schedule has
+ * the same pieces as the original schedule.
  */
-static __isl_give isl_space *band_get_range_space(__isl_keep isl_band *band)
+static int isl_band_tile_plan_apply(__isl_keep isl_band_tile_plan *plan,
+	__isl_keep isl_vec *sizes, __isl_give isl_union_pw_multi_aff **tile,
+	__isl_give isl_union_pw_multi_aff **point)
 {
-	isl_space *space;
+	int i, j;
+	int scale, shift;
+	isl_val **v;
 
-	if (!band)
-		return NULL;
+	*tile = NULL;
+	*point = NULL;
+	if (!plan || !sizes)
+		return -1;
+
+	scale = isl_options_get_tile_scale_tile_loops(plan->ctx);
+	shift = isl_options_get_tile_shift_point_loops(plan->ctx);
 
-	space = NULL;
-	isl_union_pw_multi_aff_foreach_pw_multi_aff(band->pma,
-						&extract_range_space, &space);
+	v = isl_calloc_array(plan->ctx, isl_val *, plan->n_member);
+	if (plan->n_member && !v)
+		return -1;
+	for (i = 0; i < plan->n_member; ++i) {
+		if (i < sizes->size)
+			v[i] = isl_val_int_from_isl_int(plan->ctx,
+							sizes->el[i]);
+		else
+			v[i] = isl_val_one(plan->ctx);
+	}
 
-	return space;
+	*tile = isl_union_pw_multi_aff_empty(isl_space_copy(plan->space));
+	*point = isl_union_pw_multi_aff_empty(isl_space_copy(plan->space));
+	for (i = 0; i < plan->n_pw; ++i) {
+		isl_pw_multi_aff *pw_tile, *pw_point;
+		isl_space *space = plan->pw_space[i];
+		int n = plan->pw_first[i + 1] - plan->pw_first[i];
+
+		pw_tile = isl_pw_multi_aff_alloc_size(isl_space_copy(space), n);
+		pw_point = isl_pw_multi_aff_alloc_size(isl_space_copy(space),
+							n);
+		for (j = plan->pw_first[i]; j < plan->pw_first[i + 1]; ++j)
+			tile_piece(plan, &plan->piece[j], v, scale, shift,
+				    &pw_tile, &pw_point);
+		*tile = isl_union_pw_multi_aff_add_pw_multi_aff(*tile, pw_tile);
+		*point = isl_union_pw_multi_aff_add_pw_multi_aff(*point,
+								pw_point);
+	}
+
+	for (i = 0; i < plan->n_member; ++i)
+		isl_val_free(v[i]);
+	free(v);
+
+	if (!*tile || !*point) {
+		*tile = isl_union_pw_multi_aff_free(*tile);
+		*point = isl_union_pw_multi_aff_free(*point);
+		return -1;
+	}
+
+	return 0;
 }
 
-/* Construct and return an isl_multi_val in the given space, with as entries
- * the first elements of "v", padded with ones if the size of "v" is smaller
- * than the dimension of "space".
+/* Return the partial schedule of the band for which "plan" was constructed,
+ * after tiling with the tile sizes in "sizes", i.e.,
+ * the schedule of the tile loops, followed by that of the point loops.
+ * The band itself is not modified.
  */
-static __isl_give isl_multi_val *multi_val_from_vec(__isl_take isl_space *space,
-	__isl_take isl_vec *v)
+__isl_give isl_union_map *isl_band_tile_plan_get_partial_schedule(
+	__isl_keep isl_band_tile_plan *plan, __isl_keep isl_vec *sizes)
 {
-	isl_ctx *ctx;
-	isl_multi_val *mv;
-	int i, n, size;
+	isl_union_pw_multi_aff *tile, *point;
+	isl_union_map *umap;
 
-	if (!space || !v)
-		goto error;
-
-	ctx = isl_space_get_ctx(space);
-	mv = isl_multi_val_zero(space);
-	n = isl_multi_val_dim(mv, isl_dim_set);
-	size = isl_vec_size(v);
-	if (n < size)
-		size = n;
+	if (isl_band_tile_plan_apply(plan, sizes, &tile, &point) < 0)
+		return NULL;
 
-	for (i = 0; i < size; ++i) {
-		isl_val *val = isl_vec_get_element_val(v, i);
-		mv = isl_multi_val_set_val(mv, i, val);
-	}
-	for (i = size; i < n; ++i)
-		mv = isl_multi_val_set_val(mv, i, isl_val_one(ctx));
+	umap = isl_union_map_from_union_pw_multi_aff(tile);
+	umap = isl_union_map_flat_range_product(umap,
+				isl_union_map_from_union_pw_multi_aff(point));
 
-	isl_vec_free(v);
-	return mv;
-error:
-	isl_space_free(space);
-	isl_vec_free(v);
-	return NULL;
+	return umap;
 }
 
 /* Tile the given band using the specified tile sizes.
@@ -520,27 +658,18 @@ error:
  * The children of this point loop band are the children
  * of the original band.
  *
- * If the scale tile loops option is set, then the tile loops
- * are scaled by the tile sizes.  If the shift point loops option is set,
- * then the point loops are shifted to start at zero.
- * In particular, these options affect the tile and point loop schedules
- * as follows
- *
- *	scale	shift	original	tile		point
- *
- *	0	0	i		floor(i/s)	i
- *	1	0	i		s * floor(i/s)	i
- *	0	1	i		floor(i/s)	i - s * floor(i/s)
- *	1	1	i		s * floor(i/s)	i - s * floor(i/s)
+ * The schedules of the tile and point loops are computed
+ * by a tiling plan that is only used once.
+ * See isl_band_tile_plan_apply for the effect of the tile
+ * scale tile loops and shift point loops options.
  */
 int isl_band_tile(__isl_keep isl_band *band, __isl_take isl_vec *sizes)
 {
 	isl_ctx *ctx;
 	isl_band *child;
 	isl_band_list *list = NULL;
+	isl_band_tile_plan *plan;
 	isl_union_pw_multi_aff *sched = NULL, *child_sched = NULL;
-	isl_space *space;
-	isl_multi_val *mv_sizes;
 
 	if (!band || !sizes)
 		goto error;
@@ -552,21 +681,9 @@ int isl_band_tile(__isl_keep isl_band *band, __isl_take isl_vec *sizes)
 	if (!list)
 		goto error;
 
-	space = band_get_range_space(band);
-	mv_sizes = multi_val_from_vec(space, isl_vec_copy(sizes));
-	sched = isl_union_pw_multi_aff_copy(band->pma);
-	sched = isl_union_pw_multi_aff_tile(sched, mv_sizes);
-
-	child_sched = isl_union_pw_multi_aff_copy(child->pma);
-	if (isl_options_get_tile_shift_point_loops(ctx)) {
-		isl_union_pw_multi_aff *scaled;
-		scaled = isl_union_pw_multi_aff_copy(sched);
-		if (!isl_options_get_tile_scale_tile_loops(ctx))
-			scaled = isl_union_pw_multi_aff_scale_multi_val(scaled,
-						isl_multi_val_copy(mv_sizes));
-		child_sched = isl_union_pw_multi_aff_sub(child_sched, scaled);
-	}
-	isl_multi_val_free(mv_sizes);
+	plan = isl_band_tile_plan_alloc(band);
+	isl_band_tile_plan_apply(plan, sizes, &sched, &child_sched);
+	isl_band_tile_plan_free(plan);
 	if (!sched || !child_sched)
 		goto error;
 
@@ -577,6 +694,7 @@ int isl_band_tile(__isl_keep isl_band *band, __isl_take isl_vec *sizes)
 	band->pma = sched;
 	isl_union_pw_multi_aff_free(child->pma);
 	child->pma = child_sched;
+	isl_schedule_invalidate_map(band->schedule);
 
 	isl_vec_free(sizes);
 	return 0;
@@ -697,6 +815,7 @@ int isl_band_split(__isl_keep isl_band *band, int pos)
 	child->children = band->children;
 	band->children = list;
 	child->parent = band;
+	isl_schedule_invalidate_map(band->schedule);
 
 	return 0;
 }
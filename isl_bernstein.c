@@ -13,6 +13,7 @@
  * ZAC des vignes, 4 rue Jacques Monod, 91893 Orsay, France
  */
 
+#include <isl_config.h>
 #include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl/set.h>
@@ -24,7 +25,12 @@
 #include <isl_options_private.h>
 #include <isl_vec_private.h>
 #include <isl_bernstein.h>
+#include <isl_thread.h>
 
+/* "coord" caches the coordinates of the parametric vertices,
+ * with the coordinate j of vertex i stored at position i * nvar + j.
+ * The entries are computed on demand by get_vertex_coordinate.
+ */
 struct bernstein_data {
 	enum isl_fold type;
 	isl_qpolynomial *poly;
@@ -32,6 +38,9 @@ struct bernstein_data {
 
 	isl_cell *cell;
 
+	int nvar;
+	isl_qpolynomial **coord;
+
 	isl_qpolynomial_fold *fold;
 	isl_qpolynomial_fold *fold_tight;
 	isl_pw_qpolynomial_fold *pwf;
@@ -89,6 +98,22 @@ error:
 	return NULL;
 }
 
+/* Return coordinate "j" of vertex "k" of data->cell->vertices,
+ * computing it if it has not been computed before.
+ * The vertices are shared by all cells, so the result can be reused
+ * for all cells that contain the vertex.
+ */
+static __isl_give isl_qpolynomial *get_vertex_coordinate(
+	struct bernstein_data *data, int k, int j, __isl_keep isl_space *dim)
+{
+	isl_qpolynomial **v = &data->coord[k * data->nvar + j];
+
+	if (!*v)
+		*v = vertex_coordinate(data->cell->vertices->v[k].vertex, j,
+					isl_space_copy(dim));
+	return isl_qpolynomial_copy(*v);
+}
+
 /* Check whether the bound associated to the selection "k" is tight,
  * which is the case if we select exactly one vertex and if that vertex
  * is integral for all values of the parameters.
@@ -231,7 +256,7 @@ error:
 }
 
 /* Perform bernstein expansion on the parametric vertices that are active
- * on "cell".
+ * on "cell" and add the results to data->fold and data->fold_tight.
  *
  * data->poly has been homogenized in the calling function.
  *
@@ -242,7 +267,8 @@ error:
  * and the constant "1 = \sum_i \alpha_i" for the homogeneous dimension.
  * Next, we extract the coefficients of the Bernstein base polynomials.
  */
-static int bernstein_coefficients_cell(__isl_take isl_cell *cell, void *user)
+static int bernstein_coefficients_simplex(__isl_take isl_cell *cell,
+	void *user)
 {
 	int i, j;
 	struct bernstein_data *data = (struct bernstein_data *)user;
@@ -265,7 +291,7 @@ static int bernstein_coefficients_cell(__isl_take isl_cell *cell, void *user)
 	ctx = isl_qpolynomial_get_ctx(poly);
 	if (n_vertices > nvar + 1 && ctx->opt->bernstein_triangulate)
 		return isl_cell_foreach_simplex(cell,
-					    &bernstein_coefficients_cell, user);
+					&bernstein_coefficients_simplex, user);
 
 	subs = isl_alloc_array(ctx, isl_qpolynomial *, 1 + nvar);
 	if (!subs)
@@ -278,6 +304,7 @@ static int bernstein_coefficients_cell(__isl_take isl_cell *cell, void *user)
 	for (i = 0; i < 1 + nvar; ++i)
 		subs[i] = isl_qpolynomial_zero_on_domain(isl_space_copy(dim_dst));
 
+	data->cell = cell;
 	for (i = 0; i < n_vertices; ++i) {
 		isl_qpolynomial *c;
 		c = isl_qpolynomial_var_on_domain(isl_space_copy(dim_dst), isl_dim_set,
@@ -285,8 +312,7 @@ static int bernstein_coefficients_cell(__isl_take isl_cell *cell, void *user)
 		for (j = 0; j < nvar; ++j) {
 			int k = cell->ids[i];
 			isl_qpolynomial *v;
-			v = vertex_coordinate(cell->vertices->v[k].vertex, j,
-						isl_space_copy(dim_param));
+			v = get_vertex_coordinate(data, k, j, dim_param);
 			v = isl_qpolynomial_add_dims(v, isl_dim_in,
 							1 + nvar + n_vertices);
 			v = isl_qpolynomial_mul(v, isl_qpolynomial_copy(c));
@@ -302,17 +328,11 @@ static int bernstein_coefficients_cell(__isl_take isl_cell *cell, void *user)
 	poly = isl_qpolynomial_substitute(poly, isl_dim_in, 0, 1 + nvar, subs);
 	poly = isl_qpolynomial_drop_dims(poly, isl_dim_in, 0, 1 + nvar);
 
-	data->cell = cell;
+	isl_space_free(dim_param);
+
 	dom = isl_set_from_basic_set(isl_basic_set_copy(cell->dom));
-	data->fold = isl_qpolynomial_fold_empty(data->type, isl_space_copy(dim_param));
-	data->fold_tight = isl_qpolynomial_fold_empty(data->type, dim_param);
 	extract_coefficients(poly, dom, data);
-
-	pwf = isl_pw_qpolynomial_fold_alloc(data->type, isl_set_copy(dom),
-					    data->fold);
-	data->pwf = isl_pw_qpolynomial_fold_fold(data->pwf, pwf);
-	pwf = isl_pw_qpolynomial_fold_alloc(data->type, dom, data->fold_tight);
-	data->pwf_tight = isl_pw_qpolynomial_fold_fold(data->pwf_tight, pwf);
+	isl_set_free(dom);
 
 	isl_qpolynomial_free(poly);
 	isl_cell_free(cell);
@@ -325,11 +345,252 @@ error:
 	return -1;
 }
 
+/* Perform bernstein expansion on the parametric vertices that are active
+ * on "cell" and store the results in data->fold and data->fold_tight.
+ *
+ * If the cell gets triangulated, then all simplices share the domain
+ * of the cell, so their results are combined into a single fold.
+ */
+static int bernstein_coefficients_cell_folds(__isl_take isl_cell *cell,
+	struct bernstein_data *data)
+{
+	isl_space *dim_param;
+
+	if (!cell)
+		return -1;
+
+	dim_param = isl_basic_set_get_space(cell->dom);
+	data->fold = isl_qpolynomial_fold_empty(data->type,
+						isl_space_copy(dim_param));
+	data->fold_tight = isl_qpolynomial_fold_empty(data->type, dim_param);
+
+	if (bernstein_coefficients_simplex(cell, data) < 0) {
+		isl_qpolynomial_fold_free(data->fold);
+		isl_qpolynomial_fold_free(data->fold_tight);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Add "fold" and "fold_tight", the results of bernstein expansion
+ * on a cell with domain "dom", as a piece of data->pwf and
+ * data->pwf_tight.
+ *
+ * The cells are disjoint, so the pieces can simply be added
+ * to data->pwf and data->pwf_tight, without having to compute
+ * intersections with the pieces from other cells.
+ */
+static void add_cell_folds(__isl_take isl_basic_set *dom,
+	__isl_take isl_qpolynomial_fold *fold,
+	__isl_take isl_qpolynomial_fold *fold_tight,
+	struct bernstein_data *data)
+{
+	isl_set *set;
+	isl_pw_qpolynomial_fold *pwf;
+
+	set = isl_set_from_basic_set(dom);
+	pwf = isl_pw_qpolynomial_fold_alloc(data->type, isl_set_copy(set),
+					    fold);
+	data->pwf = isl_pw_qpolynomial_fold_add_disjoint(data->pwf, pwf);
+	pwf = isl_pw_qpolynomial_fold_alloc(data->type, set, fold_tight);
+	data->pwf_tight = isl_pw_qpolynomial_fold_add_disjoint(data->pwf_tight,
+								pwf);
+}
+
+/* Perform bernstein expansion on the parametric vertices that are active
+ * on "cell" and add the results as a piece of data->pwf and
+ * data->pwf_tight.
+ */
+static int bernstein_coefficients_cell(__isl_take isl_cell *cell, void *user)
+{
+	struct bernstein_data *data = (struct bernstein_data *)user;
+	isl_basic_set *dom;
+
+	if (!cell)
+		return -1;
+
+	dom = isl_basic_set_copy(cell->dom);
+	if (bernstein_coefficients_cell_folds(cell, data) < 0) {
+		isl_basic_set_free(dom);
+		return -1;
+	}
+	add_cell_folds(dom, data->fold, data->fold_tight, data);
+
+	return 0;
+}
+
+#ifdef HAVE_PTHREAD
+
+/* A cell of the chamber decomposition, along with the results
+ * of bernstein expansion on the cell.
+ */
+struct isl_bernstein_cell {
+	isl_cell		*cell;
+	isl_qpolynomial_fold	*fold;
+	isl_qpolynomial_fold	*fold_tight;
+};
+
+/* A sequence of "n" cells, with room for "size" cells.
+ */
+struct isl_bernstein_cells {
+	int			n;
+	int			size;
+	struct isl_bernstein_cell *p;
+};
+
+/* Append "cell" to the sequence of cells pointed to by "user".
+ */
+static int collect_cell(__isl_take isl_cell *cell, void *user)
+{
+	struct isl_bernstein_cells *cells = user;
+
+	if (!cell)
+		return -1;
+
+	if (cells->n >= cells->size) {
+		struct isl_bernstein_cell *p;
+
+		p = isl_realloc_array(isl_cell_get_ctx(cell), cells->p,
+				struct isl_bernstein_cell, 2 * cells->size + 4);
+		if (!p) {
+			isl_cell_free(cell);
+			return -1;
+		}
+		cells->p = p;
+		cells->size = 2 * cells->size + 4;
+	}
+
+	cells->p[cells->n].cell = cell;
+	cells->p[cells->n].fold = NULL;
+	cells->p[cells->n].fold_tight = NULL;
+	cells->n++;
+
+	return 0;
+}
+
+/* Internal data for bernstein_coefficients_cells_threads.
+ *
+ * "data" is the data of the calling thread, with data->poly
+ * the homogenized polynomial.
+ * "cells" contains the cells of the chamber decomposition,
+ * which live in "ctx", along with the results for each cell,
+ * imported back into "ctx".
+ */
+struct isl_bernstein_threads {
+	isl_ctx *ctx;
+	struct bernstein_data *data;
+	struct isl_bernstein_cells *cells;
+};
+
+/* Import cell "i", along with its vertices, and data->poly
+ * into the isl_ctx of "worker", perform bernstein expansion
+ * on the cell and import the results back.
+ * The coordinates of the vertices are computed by the worker itself,
+ * since they would otherwise need to be imported as well.
+ */
+static int bernstein_work(struct isl_thread_worker *worker, int i,
+	void *user)
+{
+	struct isl_bernstein_threads *threads = user;
+	struct isl_bernstein_cell *c = &threads->cells->p[i];
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	struct bernstein_data data;
+	isl_cell *cell;
+	int j, n = 0;
+	int r = -1;
+
+	data = *threads->data;
+	data.coord = NULL;
+
+	isl_thread_worker_lock(worker);
+	cell = isl_cell_import(ctx, c->cell);
+	data.poly = isl_qpolynomial_import(ctx, threads->data->poly);
+	isl_thread_worker_unlock(worker);
+
+	if (cell)
+		n = cell->vertices->n_vertices * data.nvar;
+	if (n > 0)
+		data.coord = isl_calloc_array(ctx, isl_qpolynomial *, n);
+	if (data.coord && data.poly)
+		r = bernstein_coefficients_cell_folds(cell, &data);
+	else
+		isl_cell_free(cell);
+	if (data.coord)
+		for (j = 0; j < n; ++j)
+			isl_qpolynomial_free(data.coord[j]);
+	free(data.coord);
+	isl_qpolynomial_free(data.poly);
+	if (r < 0)
+		return -1;
+
+	isl_thread_worker_lock(worker);
+	c->fold = isl_qpolynomial_fold_import(threads->ctx, data.fold);
+	c->fold_tight = isl_qpolynomial_fold_import(threads->ctx,
+						    data.fold_tight);
+	isl_thread_worker_unlock(worker);
+	isl_qpolynomial_fold_free(data.fold);
+	isl_qpolynomial_fold_free(data.fold_tight);
+
+	return c->fold && c->fold_tight ? 0 : -1;
+}
+
+/* Perform bernstein expansion on the parametric vertices that are active
+ * on each of the disjoint cells of "vertices" and add the results
+ * to data->pwf and data->pwf_tight, using several threads.
+ *
+ * The cells are first collected in the calling thread.
+ * Each thread has its own isl_ctx, into which it imports data->poly and
+ * the cells that it handles, along with their vertices
+ * (see isl_thread_run).
+ * The results are only added to data->pwf and data->pwf_tight
+ * after all threads have finished, in the order of the cells,
+ * such that the result is the same as that
+ * of the sequential computation.
+ */
+static int bernstein_coefficients_cells_threads(
+	__isl_keep isl_vertices *vertices, struct bernstein_data *data)
+{
+	int i, r = 0;
+	isl_ctx *ctx;
+	struct isl_bernstein_cells cells = { 0 };
+	struct isl_bernstein_threads threads = { NULL, data, &cells };
+
+	ctx = isl_vertices_get_ctx(vertices);
+	threads.ctx = ctx;
+	if (isl_vertices_foreach_disjoint_cell(vertices,
+					    &collect_cell, &cells) < 0)
+		r = -1;
+	if (r >= 0)
+		r = isl_thread_run(ctx, cells.n, &bernstein_work, &threads);
+
+	for (i = 0; i < cells.n; ++i) {
+		struct isl_bernstein_cell *c = &cells.p[i];
+
+		if (r >= 0)
+			add_cell_folds(isl_basic_set_copy(c->cell->dom),
+					c->fold, c->fold_tight, data);
+		else {
+			isl_qpolynomial_fold_free(c->fold);
+			isl_qpolynomial_fold_free(c->fold_tight);
+		}
+		isl_cell_free(c->cell);
+	}
+	free(cells.p);
+
+	return r;
+}
+
+#endif
+
 /* Base case of applying bernstein expansion.
  *
  * We compute the chamber decomposition of the parametric polytope "bset"
  * and then perform bernstein expansion on the parametric vertices
  * that are active on each chamber.
+ * If the threads option is greater than one and
+ * isl has been built with thread support, then the chambers are handled
+ * by several threads (see bernstein_coefficients_cells_threads).
  */
 static __isl_give isl_pw_qpolynomial_fold *bernstein_coefficients_base(
 	__isl_take isl_basic_set *bset,
@@ -373,8 +634,27 @@ static __isl_give isl_pw_qpolynomial_fold *bernstein_coefficients_base(
 	data->pwf_tight = isl_pw_qpolynomial_fold_zero(dim, data->type);
 	data->poly = isl_qpolynomial_homogenize(isl_qpolynomial_copy(poly));
 	vertices = isl_basic_set_compute_vertices(bset);
-	isl_vertices_foreach_disjoint_cell(vertices,
-		&bernstein_coefficients_cell, data);
+	data->nvar = nvar;
+	data->coord = NULL;
+	if (vertices && vertices->n_vertices > 0)
+		data->coord = isl_calloc_array(isl_basic_set_get_ctx(bset),
+			    isl_qpolynomial *, vertices->n_vertices * nvar);
+#ifdef HAVE_PTHREAD
+	if (data->coord && bset->ctx->opt->threads > 1) {
+		if (bernstein_coefficients_cells_threads(vertices, data) < 0)
+			data->pwf = isl_pw_qpolynomial_fold_free(data->pwf);
+	} else
+#endif
+	if (data->coord)
+		isl_vertices_foreach_disjoint_cell(vertices,
+			&bernstein_coefficients_cell, data);
+	if (data->coord) {
+		int i;
+
+		for (i = 0; i < vertices->n_vertices * nvar; ++i)
+			isl_qpolynomial_free(data->coord[i]);
+		free(data->coord);
+	}
 	isl_vertices_free(vertices);
 	isl_qpolynomial_free(data->poly);
 
@@ -0,0 +1,1134 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#define ISL_DIM_H
+#include <limits.h>
+#include <string.h>
+#include <isl_ctx_private.h>
+#include <isl_map_private.h>
+#include <isl_union_map_private.h>
+#include <isl_space_private.h>
+#include <isl_mat_private.h>
+#include <isl_vec_private.h>
+#include <isl_val_private.h>
+#include <isl_aff_private.h>
+#include <isl_local_space_private.h>
+#include <isl_id_private.h>
+
+/* The binary format consists of a header, followed by the encoding
+ * of a single object.  The header consists of the four bytes "ISLB",
+ * a version byte and a byte identifying the type of the object.
+ *
+ * All counts are encoded as unsigned LEB128 varints.
+ * Integer values are encoded as an unsigned varint "h".
+ * If the least significant bit of "h" is zero, then h >> 1 is
+ * the zigzag encoding of the value.
+ * Otherwise, h >> 2 is the number of bytes in the absolute value,
+ * which follow in little endian order, and bit 1 of "h" is set
+ * if the value is negative.
+ * Identifiers are encoded as their length plus one, followed by
+ * the characters of their name, with a zero length meaning
+ * that there is no identifier.
+ *
+ * A space is encoded as its kind (params, set or map), the number
+ * of parameters, the parameter identifiers and then the tuple (set)
+ * or the domain and range tuples (map).
+ * A tuple is encoded as a byte indicating whether it is nested and
+ * whether its identifier is isl_id_none, the tuple identifier and
+ * then either the nested domain and range tuples or the dimension and
+ * the dimension identifiers.
+ *
+ * A basic map is encoded without its space as its flags,
+ * the number of integer divisions, equalities and inequalities,
+ * followed by the rows of the integer divisions and the constraints.
+ * A map is encoded as its space, its flags, the number of basic maps
+ * and the basic maps.
+ * An affine expression is encoded without its space as the number
+ * of integer divisions, their rows and the coefficient vector.
+ * Each piece of a piecewise multi-affine expression is encoded
+ * as its domain (without space) and its affine expressions.
+ *
+ * The encoding is designed to be decoded directly from memory,
+ * e.g., a memory mapped file, without any intermediate copies.
+ * The flags of the basic maps and maps are stored as well,
+ * such that no simplification needs to be performed when
+ * the objects are reconstructed.
+ * These flags are not verified by the decoder, so the encoded data
+ * needs to be trusted.  The decoder does, however, reject data
+ * that would make it read past the end of the buffer or
+ * nest tuples deeper than ISL_BINARY_MAX_NESTING.
+ */
+
+#define ISL_BINARY_VERSION	1
+
+enum isl_binary_type {
+	isl_binary_basic_map = 1,
+	isl_binary_map,
+	isl_binary_union_map,
+	isl_binary_aff,
+	isl_binary_pw_multi_aff
+};
+
+/* The maximal nesting depth of tuples accepted by the decoder.
+ * Nested tuples are decoded recursively, so without a limit,
+ * a malformed input could exhaust the stack.
+ */
+#define ISL_BINARY_MAX_NESTING	64
+
+#define ISL_BINARY_TUPLE_NESTED	(1 << 0)
+#define ISL_BINARY_TUPLE_NONE	(1 << 1)
+
+enum isl_binary_space_kind {
+	isl_binary_space_params = 0,
+	isl_binary_space_set,
+	isl_binary_space_map
+};
+
+#define ISL_BINARY_BMAP_FLAGS						\
+	(ISL_BASIC_MAP_FINAL | ISL_BASIC_MAP_EMPTY |			\
+	 ISL_BASIC_MAP_NO_IMPLICIT | ISL_BASIC_MAP_NO_REDUNDANT |	\
+	 ISL_BASIC_MAP_RATIONAL | ISL_BASIC_MAP_NORMALIZED |		\
+	 ISL_BASIC_MAP_NORMALIZED_DIVS | ISL_BASIC_MAP_ALL_EQUALITIES)
+#define ISL_BINARY_MAP_FLAGS	(ISL_MAP_DISJOINT | ISL_MAP_NORMALIZED)
+
+/* A growing buffer holding the encoding of an object.
+ * "failed" is set if any allocation failed.
+ */
+struct isl_binary_writer {
+	isl_ctx *ctx;
+	unsigned char *buf;
+	size_t len;
+	size_t size;
+	int failed;
+};
+
+/* A position "p" in a buffer ending at "end" from which an object
+ * is being decoded.
+ */
+/* "depth" is the current nesting depth of the tuples being read.
+ */
+struct isl_binary_reader {
+	isl_ctx *ctx;
+	const unsigned char *p;
+	const unsigned char *end;
+	int depth;
+};
+
+/* Make sure there is room for "n" more bytes in "w".
+ */
+static int writer_reserve(struct isl_binary_writer *w, size_t n)
+{
+	unsigned char *buf;
+	size_t size;
+
+	if (w->failed)
+		return -1;
+	if (w->len + n <= w->size)
+		return 0;
+	size = 2 * w->size + n + 64;
+	buf = isl_realloc_array(w->ctx, w->buf, unsigned char, size);
+	if (!buf) {
+		w->failed = 1;
+		return -1;
+	}
+	w->buf = buf;
+	w->size = size;
+	return 0;
+}
+
+static void write_bytes(struct isl_binary_writer *w, const void *p, size_t n)
+{
+	if (writer_reserve(w, n) < 0)
+		return;
+	memcpy(w->buf + w->len, p, n);
+	w->len += n;
+}
+
+static void write_byte(struct isl_binary_writer *w, unsigned char c)
+{
+	write_bytes(w, &c, 1);
+}
+
+static void write_uvarint(struct isl_binary_writer *w, uint64_t u)
+{
+	if (writer_reserve(w, 10) < 0)
+		return;
+	while (u >= 0x80) {
+		w->buf[w->len++] = (u & 0x7f) | 0x80;
+		u >>= 7;
+	}
+	w->buf[w->len++] = u;
+}
+
+/* Write "v" in the format described at the top of this file.
+ * Values with an absolute value smaller than 2^61 are written
+ * as a zigzag encoded varint.  Larger values are written
+ * as a sequence of bytes.
+ */
+static void write_int(struct isl_binary_writer *w, isl_int v)
+{
+	isl_val *val;
+	size_t n;
+
+	if (isl_int_fits_slong(v)) {
+		int64_t s = isl_int_get_si(v);
+		const int64_t bound = INT64_C(1) << 61;
+
+		if (s > -bound && s < bound) {
+			uint64_t u = s < 0 ? ~((uint64_t) s << 1) :
+					     (uint64_t) s << 1;
+			write_uvarint(w, u << 1);
+			return;
+		}
+	}
+
+	val = isl_val_int_from_isl_int(w->ctx, v);
+	n = isl_val_n_abs_num_chunks(val, 1);
+	write_uvarint(w, ((uint64_t) n << 2) | (isl_int_is_neg(v) << 1) | 1);
+	if (val && writer_reserve(w, n) >= 0 &&
+	    isl_val_get_abs_num_chunks(val, 1, w->buf + w->len) >= 0)
+		w->len += n;
+	else
+		w->failed = 1;
+	isl_val_free(val);
+}
+
+static void write_seq(struct isl_binary_writer *w, isl_int *p, unsigned len)
+{
+	int i;
+
+	for (i = 0; i < len; ++i)
+		write_int(w, p[i]);
+}
+
+/* Write the name of "id" (taking ownership of "id"),
+ * or a zero length if there is no identifier.
+ */
+static void write_id(struct isl_binary_writer *w, __isl_take isl_id *id)
+{
+	const char *name;
+	size_t len;
+
+	name = id ? isl_id_get_name(id) : NULL;
+	if (!name) {
+		write_uvarint(w, 0);
+	} else {
+		len = strlen(name);
+		write_uvarint(w, len + 1);
+		write_bytes(w, name, len);
+	}
+	isl_id_free(id);
+}
+
+static void write_tuples(struct isl_binary_writer *w,
+	__isl_keep isl_space *space);
+
+/* Write the tuple of type "type" of "space".
+ */
+static void write_tuple(struct isl_binary_writer *w,
+	__isl_keep isl_space *space, enum isl_dim_type type)
+{
+	int i, n;
+	isl_space *nested = space->nested[type - isl_dim_in];
+	isl_id *id = space->tuple_id[type - isl_dim_in];
+	unsigned char flags = 0;
+
+	if (nested)
+		flags |= ISL_BINARY_TUPLE_NESTED;
+	if (id == &isl_id_none)
+		flags |= ISL_BINARY_TUPLE_NONE;
+	write_byte(w, flags);
+	if (id != &isl_id_none && isl_space_has_tuple_id(space, type))
+		write_id(w, isl_space_get_tuple_id(space, type));
+	else
+		write_id(w, NULL);
+	if (nested) {
+		write_tuples(w, nested);
+		return;
+	}
+
+	n = isl_space_dim(space, type);
+	write_uvarint(w, n);
+	for (i = 0; i < n; ++i) {
+		if (isl_space_has_dim_id(space, type, i))
+			write_id(w, isl_space_get_dim_id(space, type, i));
+		else
+			write_id(w, NULL);
+	}
+}
+
+/* Write the domain and range tuples of the map space "space".
+ */
+static void write_tuples(struct isl_binary_writer *w,
+	__isl_keep isl_space *space)
+{
+	write_tuple(w, space, isl_dim_in);
+	write_tuple(w, space, isl_dim_out);
+}
+
+static void write_space(struct isl_binary_writer *w,
+	__isl_keep isl_space *space)
+{
+	int i, nparam;
+
+	if (!space) {
+		w->failed = 1;
+		return;
+	}
+
+	if (isl_space_is_params(space))
+		write_byte(w, isl_binary_space_params);
+	else if (isl_space_is_set(space))
+		write_byte(w, isl_binary_space_set);
+	else
+		write_byte(w, isl_binary_space_map);
+
+	nparam = isl_space_dim(space, isl_dim_param);
+	write_uvarint(w, nparam);
+	for (i = 0; i < nparam; ++i) {
+		if (isl_space_has_dim_id(space, isl_dim_param, i))
+			write_id(w, isl_space_get_dim_id(space,
+							isl_dim_param, i));
+		else
+			write_id(w, NULL);
+	}
+
+	if (isl_space_is_params(space))
+		return;
+	if (isl_space_is_set(space))
+		write_tuple(w, space, isl_dim_set);
+	else
+		write_tuples(w, space);
+}
+
+static void write_header(struct isl_binary_writer *w,
+	enum isl_binary_type type)
+{
+	write_bytes(w, "ISLB", 4);
+	write_byte(w, ISL_BINARY_VERSION);
+	write_byte(w, type);
+}
+
+/* Write "bmap" without its space.
+ */
+static void write_basic_map_body(struct isl_binary_writer *w,
+	__isl_keep isl_basic_map *bmap)
+{
+	int i;
+	unsigned total;
+
+	if (!bmap) {
+		w->failed = 1;
+		return;
+	}
+
+	total = isl_basic_map_total_dim(bmap);
+	write_uvarint(w, bmap->flags & ISL_BINARY_BMAP_FLAGS);
+	write_uvarint(w, bmap->n_div);
+	write_uvarint(w, bmap->n_eq);
+	write_uvarint(w, bmap->n_ineq);
+	for (i = 0; i < bmap->n_div; ++i)
+		write_seq(w, bmap->div[i], 2 + total);
+	for (i = 0; i < bmap->n_eq; ++i)
+		write_seq(w, bmap->eq[i], 1 + total);
+	for (i = 0; i < bmap->n_ineq; ++i)
+		write_seq(w, bmap->ineq[i], 1 + total);
+}
+
+/* Write "map" without its space.
+ */
+static void write_map_body(struct isl_binary_writer *w,
+	__isl_keep isl_map *map)
+{
+	int i;
+
+	if (!map) {
+		w->failed = 1;
+		return;
+	}
+
+	write_uvarint(w, map->flags & ISL_BINARY_MAP_FLAGS);
+	write_uvarint(w, map->n);
+	for (i = 0; i < map->n; ++i)
+		write_basic_map_body(w, map->p[i]);
+}
+
+static void write_map(struct isl_binary_writer *w, __isl_keep isl_map *map)
+{
+	if (!map) {
+		w->failed = 1;
+		return;
+	}
+	write_space(w, map->dim);
+	write_map_body(w, map);
+}
+
+static int write_map_entry(__isl_keep isl_map *map, void *user)
+{
+	struct isl_binary_writer *w = user;
+
+	write_map(w, map);
+
+	return w->failed ? -1 : 0;
+}
+
+/* Write "aff" without its domain space.
+ */
+static void write_aff_body(struct isl_binary_writer *w,
+	__isl_keep isl_aff *aff)
+{
+	int i;
+	isl_mat *div;
+
+	if (!aff) {
+		w->failed = 1;
+		return;
+	}
+
+	div = aff->ls->div;
+	write_uvarint(w, div->n_row);
+	for (i = 0; i < div->n_row; ++i)
+		write_seq(w, div->row[i], div->n_col);
+	write_seq(w, aff->v->el, aff->v->size);
+}
+
+/* Return the buffer of "w", storing its length in "size",
+ * or return NULL if anything went wrong.
+ */
+static void *writer_finish(struct isl_binary_writer *w, size_t *size)
+{
+	if (w->failed) {
+		free(w->buf);
+		return NULL;
+	}
+	if (size)
+		*size = w->len;
+	return w->buf;
+}
+
+/* Return a newly allocated buffer containing the binary encoding
+ * of "bmap" and store its length in "size".
+ * The buffer should be freed by the caller using free().
+ */
+void *isl_basic_map_to_binary(__isl_keep isl_basic_map *bmap, size_t *size)
+{
+	struct isl_binary_writer w = { NULL };
+
+	if (!bmap)
+		return NULL;
+
+	w.ctx = isl_basic_map_get_ctx(bmap);
+	write_header(&w, isl_binary_basic_map);
+	write_space(&w, bmap->dim);
+	write_basic_map_body(&w, bmap);
+
+	return writer_finish(&w, size);
+}
+
+void *isl_basic_set_to_binary(__isl_keep isl_basic_set *bset, size_t *size)
+{
+	return isl_basic_map_to_binary(bset, size);
+}
+
+/* Return a newly allocated buffer containing the binary encoding
+ * of "map" and store its length in "size".
+ * The buffer should be freed by the caller using free().
+ */
+void *isl_map_to_binary(__isl_keep isl_map *map, size_t *size)
+{
+	struct isl_binary_writer w = { NULL };
+
+	if (!map)
+		return NULL;
+
+	w.ctx = isl_map_get_ctx(map);
+	write_header(&w, isl_binary_map);
+	write_map(&w, map);
+
+	return writer_finish(&w, size);
+}
+
+void *isl_set_to_binary(__isl_keep isl_set *set, size_t *size)
+{
+	return isl_map_to_binary(set, size);
+}
+
+/* Return a newly allocated buffer containing the binary encoding
+ * of "umap" and store its length in "size".
+ * The buffer should be freed by the caller using free().
+ */
+void *isl_union_map_to_binary(__isl_keep isl_union_map *umap, size_t *size)
+{
+	struct isl_binary_writer w = { NULL };
+
+	if (!umap)
+		return NULL;
+
+	w.ctx = isl_union_map_get_ctx(umap);
+	write_header(&w, isl_binary_union_map);
+	write_space(&w, umap->dim);
+	write_uvarint(&w, isl_union_map_n_map(umap));
+	if (isl_union_map_foreach_map_peek(umap, &write_map_entry, &w) < 0)
+		w.failed = 1;
+
+	return writer_finish(&w, size);
+}
+
+void *isl_union_set_to_binary(__isl_keep isl_union_set *uset, size_t *size)
+{
+	return isl_union_map_to_binary(uset, size);
+}
+
+/* Return a newly allocated buffer containing the binary encoding
+ * of "aff" and store its length in "size".
+ * The buffer should be freed by the caller using free().
+ */
+void *isl_aff_to_binary(__isl_keep isl_aff *aff, size_t *size)
+{
+	struct isl_binary_writer w = { NULL };
+	isl_space *space;
+
+	if (!aff)
+		return NULL;
+
+	w.ctx = isl_aff_get_ctx(aff);
+	write_header(&w, isl_binary_aff);
+	space = isl_aff_get_space(aff);
+	write_space(&w, space);
+	isl_space_free(space);
+	write_aff_body(&w, aff);
+
+	return writer_finish(&w, size);
+}
+
+/* Return a newly allocated buffer containing the binary encoding
+ * of "pma" and store its length in "size".
+ * The buffer should be freed by the caller using free().
+ */
+void *isl_pw_multi_aff_to_binary(__isl_keep isl_pw_multi_aff *pma,
+	size_t *size)
+{
+	struct isl_binary_writer w = { NULL };
+	int i, j;
+
+	if (!pma)
+		return NULL;
+
+	w.ctx = isl_pw_multi_aff_get_ctx(pma);
+	write_header(&w, isl_binary_pw_multi_aff);
+	write_space(&w, pma->dim);
+	write_uvarint(&w, pma->n);
+	for (i = 0; i < pma->n; ++i) {
+		isl_multi_aff *maff = pma->p[i].maff;
+
+		write_map_body(&w, pma->p[i].set);
+		for (j = 0; j < maff->n; ++j)
+			write_aff_body(&w, maff->p[j]);
+	}
+
+	return writer_finish(&w, size);
+}
+
+/* Report that the input ended prematurely.
+ */
+static int truncated(struct isl_binary_reader *r)
+{
+	isl_die(r->ctx, isl_error_invalid, "truncated binary data", return -1);
+}
+
+static int read_byte(struct isl_binary_reader *r, unsigned char *c)
+{
+	if (r->p >= r->end)
+		return truncated(r);
+	*c = *r->p++;
+	return 0;
+}
+
+static int read_uvarint(struct isl_binary_reader *r, uint64_t *u)
+{
+	int shift = 0;
+
+	*u = 0;
+	do {
+		if (r->p >= r->end)
+			return truncated(r);
+		if (shift >= 64)
+			isl_die(r->ctx, isl_error_invalid,
+				"invalid varint in binary data", return -1);
+		*u |= (uint64_t) (*r->p & 0x7f) << shift;
+		shift += 7;
+	} while (*r->p++ & 0x80);
+
+	return 0;
+}
+
+/* Read a count and check that it is not obviously too large, i.e.,
+ * that there are at least "min" bytes left in the input for
+ * each of the elements being counted.
+ */
+static int read_count(struct isl_binary_reader *r, int min, int *n)
+{
+	uint64_t u;
+
+	if (read_uvarint(r, &u) < 0)
+		return -1;
+	if (u > INT_MAX || (min > 0 && u > (r->end - r->p) / min))
+		return truncated(r);
+	*n = u;
+	return 0;
+}
+
+/* Set "v" to the integer with absolute value "u" and sign "neg".
+ */
+static int set_int(struct isl_binary_reader *r, isl_int v, uint64_t u,
+	int neg)
+{
+	isl_val *val;
+
+	if (u <= LONG_MAX) {
+		isl_int_set_si(v, (long) u);
+		if (neg)
+			isl_int_neg(v, v);
+		return 0;
+	}
+
+	val = isl_val_int_from_chunks(r->ctx, 1, sizeof(u), &u);
+	if (!val)
+		return -1;
+	if (neg)
+		isl_int_neg(v, val->n);
+	else
+		isl_int_set(v, val->n);
+	isl_val_free(val);
+	return 0;
+}
+
+static int read_int(struct isl_binary_reader *r, isl_int v)
+{
+	uint64_t h;
+	size_t n;
+	isl_val *val;
+
+	if (read_uvarint(r, &h) < 0)
+		return -1;
+	if (!(h & 1)) {
+		h >>= 1;
+		if (h & 1)
+			return set_int(r, v, (h >> 1) + 1, 1);
+		return set_int(r, v, h >> 1, 0);
+	}
+
+	n = h >> 2;
+	if (n == 0 || n > r->end - r->p)
+		return truncated(r);
+	val = isl_val_int_from_chunks(r->ctx, n, 1, r->p);
+	if (!val)
+		return -1;
+	r->p += n;
+	if (h & 2)
+		isl_int_neg(v, val->n);
+	else
+		isl_int_set(v, val->n);
+	isl_val_free(val);
+	return 0;
+}
+
+static int read_seq(struct isl_binary_reader *r, isl_int *p, unsigned len)
+{
+	int i;
+
+	for (i = 0; i < len; ++i)
+		if (read_int(r, p[i]) < 0)
+			return -1;
+	return 0;
+}
+
+/* Read an identifier, returning NULL in "id" if there is none.
+ */
+static int read_id(struct isl_binary_reader *r, isl_id **id)
+{
+	uint64_t len;
+	char *name;
+
+	*id = NULL;
+	if (read_uvarint(r, &len) < 0)
+		return -1;
+	if (len == 0)
+		return 0;
+	len--;
+	if (len > r->end - r->p)
+		return truncated(r);
+	name = isl_alloc_array(r->ctx, char, len + 1);
+	if (!name)
+		return -1;
+	memcpy(name, r->p, len);
+	name[len] = '\0';
+	r->p += len;
+	*id = isl_id_alloc(r->ctx, name, NULL);
+	free(name);
+
+	return *id ? 0 : -1;
+}
+
+/* Read an identifier and, if there is one, assign it to
+ * position "pos" of type "type" of "space" or to the tuple of type "type"
+ * if "pos" is negative.
+ */
+static __isl_give isl_space *read_space_id(struct isl_binary_reader *r,
+	__isl_take isl_space *space, enum isl_dim_type type, int pos)
+{
+	isl_id *id;
+
+	if (read_id(r, &id) < 0)
+		return isl_space_free(space);
+	if (!id)
+		return space;
+	if (pos < 0)
+		return isl_space_set_tuple_id(space, type, id);
+	return isl_space_set_dim_id(space, type, pos, id);
+}
+
+static __isl_give isl_space *read_tuples(struct isl_binary_reader *r,
+	__isl_keep isl_space *params);
+
+/* Read a tuple and return it as a set space with parameters "params".
+ * Reject tuples that are nested more than ISL_BINARY_MAX_NESTING deep.
+ */
+static __isl_give isl_space *read_tuple(struct isl_binary_reader *r,
+	__isl_keep isl_space *params)
+{
+	unsigned char flags;
+	isl_id *id;
+	isl_space *space;
+	int i, n;
+
+	if (read_byte(r, &flags) < 0 || read_id(r, &id) < 0)
+		return NULL;
+	if (flags & ISL_BINARY_TUPLE_NONE) {
+		isl_id_free(id);
+		id = &isl_id_none;
+	}
+	if (flags & ISL_BINARY_TUPLE_NESTED) {
+		if (r->depth >= ISL_BINARY_MAX_NESTING) {
+			isl_id_free(id);
+			isl_die(r->ctx, isl_error_invalid,
+				"tuples nested too deeply in binary data",
+				return NULL);
+		}
+		r->depth++;
+		space = isl_space_wrap(read_tuples(r, params));
+		r->depth--;
+	} else if (read_count(r, 1, &n) < 0) {
+		space = NULL;
+	} else {
+		space = isl_space_set_from_params(isl_space_copy(params));
+		space = isl_space_add_dims(space, isl_dim_set, n);
+		for (i = 0; i < n; ++i)
+			space = read_space_id(r, space, isl_dim_set, i);
+	}
+	if (id)
+		space = isl_space_set_tuple_id(space, isl_dim_set, id);
+
+	return space;
+}
+
+/* Read a domain and range tuple and return the corresponding
+ * map space with parameters "params".
+ */
+static __isl_give isl_space *read_tuples(struct isl_binary_reader *r,
+	__isl_keep isl_space *params)
+{
+	isl_space *dom, *ran;
+
+	dom = read_tuple(r, params);
+	ran = dom ? read_tuple(r, params) : NULL;
+	if (!ran) {
+		isl_space_free(dom);
+		return NULL;
+	}
+
+	return isl_space_map_from_domain_and_range(dom, ran);
+}
+
+static __isl_give isl_space *read_space(struct isl_binary_reader *r)
+{
+	unsigned char kind;
+	isl_space *params, *space;
+	int i, nparam;
+
+	if (read_byte(r, &kind) < 0 || read_count(r, 1, &nparam) < 0)
+		return NULL;
+	if (kind > isl_binary_space_map)
+		isl_die(r->ctx, isl_error_invalid,
+			"invalid space in binary data", return NULL);
+
+	params = isl_space_params_alloc(r->ctx, nparam);
+	for (i = 0; i < nparam; ++i)
+		params = read_space_id(r, params, isl_dim_param, i);
+	if (!params || kind == isl_binary_space_params)
+		return params;
+
+	if (kind == isl_binary_space_set)
+		space = read_tuple(r, params);
+	else
+		space = read_tuples(r, params);
+	isl_space_free(params);
+
+	return space;
+}
+
+/* Read the header and check that it describes an object of type "type".
+ */
+static int read_header(struct isl_binary_reader *r, enum isl_binary_type type)
+{
+	unsigned char version, t;
+
+	if (!r->p)
+		isl_die(r->ctx, isl_error_invalid, "no binary data",
+			return -1);
+	if (r->end - r->p < 4)
+		return truncated(r);
+	if (memcmp(r->p, "ISLB", 4))
+		isl_die(r->ctx, isl_error_invalid,
+			"not an isl binary object", return -1);
+	r->p += 4;
+	if (read_byte(r, &version) < 0 || read_byte(r, &t) < 0)
+		return -1;
+	if (version != ISL_BINARY_VERSION)
+		isl_die(r->ctx, isl_error_unsupported,
+			"unsupported binary format version", return -1);
+	if (t != type)
+		isl_die(r->ctx, isl_error_invalid,
+			"unexpected type of binary object", return -1);
+
+	return 0;
+}
+
+/* Read a basic map in space "space" (without the space itself).
+ *
+ * If the stored basic map was not final, then it is finalized here.
+ * Otherwise, its stored flags are reinstated as is.
+ */
+static __isl_give isl_basic_map *read_basic_map_body(
+	struct isl_binary_reader *r, __isl_take isl_space *space)
+{
+	isl_basic_map *bmap;
+	uint64_t flags;
+	int i, k, n_div, n_eq, n_ineq;
+	unsigned total;
+
+	if (read_uvarint(r, &flags) < 0 ||
+	    read_count(r, 1, &n_div) < 0 || read_count(r, 1, &n_eq) < 0 ||
+	    read_count(r, 1, &n_ineq) < 0) {
+		isl_space_free(space);
+		return NULL;
+	}
+
+	bmap = isl_basic_map_alloc_space(space, n_div, n_eq, n_ineq);
+	if (!bmap)
+		return NULL;
+	total = isl_basic_map_total_dim(bmap) + n_div;
+	for (i = 0; i < n_div; ++i) {
+		k = isl_basic_map_alloc_div(bmap);
+		if (k < 0 || read_seq(r, bmap->div[k], 2 + total) < 0)
+			goto error;
+	}
+	for (i = 0; i < n_eq; ++i) {
+		k = isl_basic_map_alloc_equality(bmap);
+		if (k < 0 || read_seq(r, bmap->eq[k], 1 + total) < 0)
+			goto error;
+	}
+	for (i = 0; i < n_ineq; ++i) {
+		k = isl_basic_map_alloc_inequality(bmap);
+		if (k < 0 || read_seq(r, bmap->ineq[k], 1 + total) < 0)
+			goto error;
+	}
+
+	if (!(flags & ISL_BASIC_MAP_FINAL)) {
+		if (flags & ISL_BASIC_MAP_RATIONAL)
+			ISL_F_SET(bmap, ISL_BASIC_MAP_RATIONAL);
+		return isl_basic_map_finalize(bmap);
+	}
+	/* The stored flags are trusted; see the description above. */
+	ISL_F_SET(bmap, flags & ISL_BINARY_BMAP_FLAGS);
+	return bmap;
+error:
+	isl_basic_map_free(bmap);
+	return NULL;
+}
+
+/* Read a map in space "space" (without the space itself).
+ */
+static __isl_give isl_map *read_map_body(struct isl_binary_reader *r,
+	__isl_take isl_space *space)
+{
+	isl_map *map;
+	uint64_t flags;
+	int i, n;
+
+	if (read_uvarint(r, &flags) < 0 || read_count(r, 4, &n) < 0) {
+		isl_space_free(space);
+		return NULL;
+	}
+
+	map = isl_map_alloc_space(isl_space_copy(space), n, 0);
+	for (i = 0; i < n && map; ++i) {
+		isl_basic_map *bmap;
+
+		bmap = read_basic_map_body(r, isl_space_copy(space));
+		map = isl_map_add_basic_map(map, bmap);
+	}
+	isl_space_free(space);
+	if (map)
+		ISL_F_SET(map, flags & ISL_BINARY_MAP_FLAGS);
+
+	return map;
+}
+
+static __isl_give isl_map *read_map(struct isl_binary_reader *r)
+{
+	return read_map_body(r, read_space(r));
+}
+
+/* Read an affine expression with domain space "space"
+ * (without the space itself).
+ */
+static __isl_give isl_aff *read_aff_body(struct isl_binary_reader *r,
+	__isl_take isl_space *space)
+{
+	isl_mat *div;
+	isl_vec *v;
+	isl_local_space *ls;
+	int i, n_div;
+	unsigned len;
+
+	if (!space || read_count(r, 1, &n_div) < 0) {
+		isl_space_free(space);
+		return NULL;
+	}
+
+	len = 2 + isl_space_dim(space, isl_dim_all) + n_div;
+	div = isl_mat_alloc(r->ctx, n_div, len);
+	if (!div)
+		goto error;
+	for (i = 0; i < n_div; ++i)
+		if (read_seq(r, div->row[i], len) < 0)
+			goto error;
+	ls = isl_local_space_alloc_div(space, div);
+	v = isl_vec_alloc(r->ctx, len);
+	if (v && read_seq(r, v->el, len) < 0)
+		v = isl_vec_free(v);
+
+	return isl_aff_alloc_vec(ls, v);
+error:
+	isl_mat_free(div);
+	isl_space_free(space);
+	return NULL;
+}
+
+/* Check that the input has been consumed completely if "used" is NULL
+ * and otherwise store the number of bytes read from "buf" in "used".
+ */
+static int reader_finish(struct isl_binary_reader *r, const void *buf,
+	size_t *used)
+{
+	if (used) {
+		*used = r->p - (const unsigned char *) buf;
+		return 0;
+	}
+	if (r->p != r->end)
+		isl_die(r->ctx, isl_error_invalid,
+			"trailing data after binary object", return -1);
+	return 0;
+}
+
+static void reader_init(struct isl_binary_reader *r, isl_ctx *ctx,
+	const void *buf, size_t size)
+{
+	r->ctx = ctx;
+	r->p = buf;
+	r->end = r->p + size;
+	r->depth = 0;
+}
+
+/* Decode the basic map encoded in the first "size" bytes of "buf".
+ * If "used" is not NULL, then the number of bytes that were
+ * actually read is stored in "used".  Otherwise, the encoding
+ * needs to take up the entire buffer.
+ */
+__isl_give isl_basic_map *isl_basic_map_from_binary(isl_ctx *ctx,
+	const void *buf, size_t size, size_t *used)
+{
+	struct isl_binary_reader r;
+	isl_basic_map *bmap;
+
+	reader_init(&r, ctx, buf, size);
+	if (read_header(&r, isl_binary_basic_map) < 0)
+		return NULL;
+	bmap = read_basic_map_body(&r, read_space(&r));
+	if (reader_finish(&r, buf, used) < 0)
+		return isl_basic_map_free(bmap);
+
+	return bmap;
+}
+
+__isl_give isl_basic_set *isl_basic_set_from_binary(isl_ctx *ctx,
+	const void *buf, size_t size, size_t *used)
+{
+	isl_basic_map *bmap;
+
+	bmap = isl_basic_map_from_binary(ctx, buf, size, used);
+	if (bmap && !isl_basic_map_may_be_set(bmap))
+		isl_die(ctx, isl_error_invalid, "expecting set",
+			return isl_basic_map_free(bmap));
+	return bmap;
+}
+
+/* Decode the map encoded in the first "size" bytes of "buf".
+ * If "used" is not NULL, then the number of bytes that were
+ * actually read is stored in "used".  Otherwise, the encoding
+ * needs to take up the entire buffer.
+ */
+__isl_give isl_map *isl_map_from_binary(isl_ctx *ctx,
+	const void *buf, size_t size, size_t *used)
+{
+	struct isl_binary_reader r;
+	isl_map *map;
+
+	reader_init(&r, ctx, buf, size);
+	if (read_header(&r, isl_binary_map) < 0)
+		return NULL;
+	map = read_map(&r);
+	if (reader_finish(&r, buf, used) < 0)
+		return isl_map_free(map);
+
+	return map;
+}
+
+__isl_give isl_set *isl_set_from_binary(isl_ctx *ctx,
+	const void *buf, size_t size, size_t *used)
+{
+	isl_map *map;
+
+	map = isl_map_from_binary(ctx, buf, size, used);
+	if (map && !isl_map_may_be_set(map))
+		isl_die(ctx, isl_error_invalid, "expecting set",
+			return isl_map_free(map));
+	return map;
+}
+
+/* Decode the union map encoded in the first "size" bytes of "buf".
+ * If "used" is not NULL, then the number of bytes that were
+ * actually read is stored in "used".  Otherwise, the encoding
+ * needs to take up the entire buffer.
+ */
+__isl_give isl_union_map *isl_union_map_from_binary(isl_ctx *ctx,
+	const void *buf, size_t size, size_t *used)
+{
+	struct isl_binary_reader r;
+	isl_union_map *umap;
+	int i, n;
+
+	reader_init(&r, ctx, buf, size);
+	if (read_header(&r, isl_binary_union_map) < 0)
+		return NULL;
+	umap = isl_union_map_empty(read_space(&r));
+	if (read_count(&r, 1, &n) < 0)
+		return isl_union_map_free(umap);
+	for (i = 0; i < n && umap; ++i)
+		umap = isl_union_map_add_map(umap, read_map(&r));
+	if (reader_finish(&r, buf, used) < 0)
+		return isl_union_map_free(umap);
+
+	return umap;
+}
+
+__isl_give isl_union_set *isl_union_set_from_binary(isl_ctx *ctx,
+	const void *buf, size_t size, size_t *used)
+{
+	return isl_union_map_from_binary(ctx, buf, size, used);
+}
+
+/* Decode the affine expression encoded in the first "size" bytes of "buf".
+ * If "used" is not NULL, then the number of bytes that were
+ * actually read is stored in "used".  Otherwise, the encoding
+ * needs to take up the entire buffer.
+ */
+__isl_give isl_aff *isl_aff_from_binary(isl_ctx *ctx,
+	const void *buf, size_t size, size_t *used)
+{
+	struct isl_binary_reader r;
+	isl_aff *aff;
+
+	reader_init(&r, ctx, buf, size);
+	if (read_header(&r, isl_binary_aff) < 0)
+		return NULL;
+	aff = read_aff_body(&r, isl_space_domain(read_space(&r)));
+	if (reader_finish(&r, buf, used) < 0)
+		return isl_aff_free(aff);
+
+	return aff;
+}
+
+/* Read a multi-affine expression in space "space"
+ * (without the space itself).
+ */
+static __isl_give isl_multi_aff *read_multi_aff_body(
+	struct isl_binary_reader *r, __isl_keep isl_space *space)
+{
+	isl_multi_aff *maff;
+	isl_space *dom;
+	int i, n;
+
+	maff = isl_multi_aff_zero(isl_space_copy(space));
+	dom = isl_space_domain(isl_space_copy(space));
+	n = isl_space_dim(space, isl_dim_out);
+	for (i = 0; i < n; ++i) {
+		isl_aff *aff;
+
+		aff = read_aff_body(r, isl_space_copy(dom));
+		maff = isl_multi_aff_set_aff(maff, i, aff);
+	}
+	isl_space_free(dom);
+
+	return maff;
+}
+
+/* Decode the piecewise multi-affine expression encoded
+ * in the first "size" bytes of "buf".
+ * If "used" is not NULL, then the number of bytes that were
+ * actually read is stored in "used".  Otherwise, the encoding
+ * needs to take up the entire buffer.
+ */
+__isl_give isl_pw_multi_aff *isl_pw_multi_aff_from_binary(isl_ctx *ctx,
+	const void *buf, size_t size, size_t *used)
+{
+	struct isl_binary_reader r;
+	isl_space *space;
+	isl_pw_multi_aff *pma;
+	int i, n;
+
+	reader_init(&r, ctx, buf, size);
+	if (read_header(&r, isl_binary_pw_multi_aff) < 0)
+		return NULL;
+	space = read_space(&r);
+	if (!space || read_count(&r, 2, &n) < 0) {
+		isl_space_free(space);
+		return NULL;
+	}
+	pma = isl_pw_multi_aff_alloc_size(isl_space_copy(space), n);
+	for (i = 0; i < n && pma; ++i) {
+		isl_set *set;
+		isl_multi_aff *maff;
+
+		set = read_map_body(&r, isl_space_domain(isl_space_copy(space)));
+		maff = read_multi_aff_body(&r, space);
+		pma = isl_pw_multi_aff_add_piece(pma, set, maff);
+	}
+	isl_space_free(space);
+	if (reader_finish(&r, buf, used) < 0)
+		return isl_pw_multi_aff_free(pma);
+
+	return pma;
+}
@@ -7,11 +7,10 @@
  * Computerwetenschappen, Celestijnenlaan 200A, B-3001 Leuven, Belgium
  */
 
+#include <string.h>
 #include <isl_blk.h>
 #include <isl_ctx_private.h>
-
-/* The maximal number of cache misses before first element is evicted */
-#define ISL_BLK_MAX_MISS	100
+#include <isl_options_private.h>
 
 struct isl_blk isl_blk_empty()
 {
@@ -39,14 +38,198 @@ int isl_blk_is_error(struct isl_blk block)
 	return block.size == -1 && block.data == NULL;
 }
 
+/* Initialize the "n" integers at "data", reusing integers
+ * from the integer pool of "ctx" where possible.
+ * Reused integers keep their memory (e.g., the GMP limbs),
+ * but not necessarily their value.
+ * Since the elements of a block are not assumed to have
+ * any particular value on allocation, this is not a problem.
+ */
+static void int_pool_init(struct isl_ctx *ctx, isl_int *data, size_t n)
+{
+	size_t i, n_reuse;
+
+	n_reuse = ctx->n_int_pool < n ? ctx->n_int_pool : n;
+	ctx->n_int_pool -= n_reuse;
+	memcpy(data, ctx->int_pool + ctx->n_int_pool, n_reuse * sizeof(isl_int));
+	for (i = n_reuse; i < n; ++i)
+		isl_int_init(data[i]);
+	ctx->stats->int_pool_hits += n_reuse;
+	ctx->stats->int_pool_misses += n - n_reuse;
+	ctx->stats->memory += (n - n_reuse) * sizeof(isl_int);
+	if (ctx->stats->memory > ctx->stats->peak_memory)
+		ctx->stats->peak_memory = ctx->stats->memory;
+}
+
+/* Check whether "n" more integers can be initialized (see int_pool_init)
+ * without exceeding the maximal amount of memory set by
+ * isl_ctx_set_max_memory.
+ * Only the integers that cannot be taken from the integer pool
+ * require additional memory.
+ */
+static int check_memory(struct isl_ctx *ctx, size_t n)
+{
+	if (!ctx->max_memory)
+		return 0;
+	if (n <= ctx->n_int_pool)
+		return 0;
+	n -= ctx->n_int_pool;
+	if (ctx->stats->memory + n * sizeof(isl_int) > ctx->max_memory)
+		isl_die(ctx, isl_error_quota,
+			"maximal amount of memory exceeded", return -1);
+	return 0;
+}
+
+/* Move as many of the "n" integers at "data" as allowed
+ * by the int_pool_size option to the integer pool of "ctx" and
+ * return the number of integers that were moved.
+ * The pool is extended on demand.  If this fails, then only
+ * the integers that fit in the current pool are moved.
+ */
+static size_t int_pool_keep(struct isl_ctx *ctx, isl_int *data, size_t n)
+{
+	size_t n_keep;
+	int max = ctx->opt->int_pool_size;
+
+	n_keep = ctx->n_int_pool < max ? max - ctx->n_int_pool : 0;
+	if (n_keep > n)
+		n_keep = n;
+	if (ctx->n_int_pool + n_keep > ctx->int_pool_size) {
+		isl_int *pool;
+		int size = ctx->n_int_pool + n_keep;
+
+		if (size < 2 * ctx->int_pool_size)
+			size = 2 * ctx->int_pool_size;
+		if (size > max)
+			size = max;
+		pool = realloc(ctx->int_pool, size * sizeof(isl_int));
+		if (pool) {
+			ctx->int_pool = pool;
+			ctx->int_pool_size = size;
+		} else
+			n_keep = ctx->int_pool_size - ctx->n_int_pool;
+	}
+	memcpy(ctx->int_pool + ctx->n_int_pool, data, n_keep * sizeof(isl_int));
+	ctx->n_int_pool += n_keep;
+	return n_keep;
+}
+
+/* Release the "n" integers at "data", moving as many of them
+ * as possible to the integer pool of "ctx" (see int_pool_keep).
+ * The integers that do not fit are simply cleared.
+ */
+static void int_pool_release(struct isl_ctx *ctx, isl_int *data, size_t n)
+{
+	size_t i, n_keep;
+
+	n_keep = int_pool_keep(ctx, data, n);
+	for (i = n_keep; i < n; ++i)
+		isl_int_clear(data[i]);
+	ctx->stats->memory -= (n - n_keep) * sizeof(isl_int);
+}
+
+/* Release the integers of "block" and its storage.
+ * In arena mode, the storage is owned by the arena and
+ * is only released by isl_blk_clear_cache.
+ */
+static void isl_blk_free_force(struct isl_ctx *ctx, struct isl_blk block)
+{
+	int_pool_release(ctx, block.data, block.size);
+	if (!ctx->blk_cache.arena)
+		free(block.data);
+}
+
+/* The number of elements in a chunk of the arena,
+ * unless a single block requires more.
+ */
+#define ISL_BLK_CHUNK_SIZE	4096
+
+/* Take storage for "n" (uninitialized) elements from the arena of "ctx",
+ * starting a new chunk if the current chunk does not have enough room.
+ * The remainder of the current chunk is then simply left unused.
+ */
+static isl_int *arena_alloc(struct isl_ctx *ctx, size_t n)
+{
+	struct isl_blk_chunk *chunk = ctx->blk_cache.chunk;
+	size_t size;
+
+	if (!chunk || chunk->size - chunk->n < n) {
+		size = n < ISL_BLK_CHUNK_SIZE ? ISL_BLK_CHUNK_SIZE : n;
+		chunk = isl_malloc_or_die(ctx, sizeof(struct isl_blk_chunk) +
+						(size - 1) * sizeof(isl_int));
+		if (!chunk)
+			return NULL;
+		chunk->size = size;
+		chunk->n = 0;
+		chunk->next = ctx->blk_cache.chunk;
+		ctx->blk_cache.chunk = chunk;
+		ctx->stats->arena_memory += sizeof(struct isl_blk_chunk) +
+						(size - 1) * sizeof(isl_int);
+	}
+
+	chunk->n += n;
+	return chunk->data + chunk->n - n;
+}
+
+/* Return the smallest power of two that is greater than or equal to "n".
+ */
+static size_t round_up(size_t n)
+{
+	size_t r = 1;
+
+	while (r < n)
+		r <<= 1;
+	return r;
+}
+
+/* Extend "block" to (at least) "new_n" elements in arena mode.
+ * The storage cannot be extended in place, so the elements
+ * are moved to new storage taken from the arena.
+ * The old storage is simply abandoned.
+ * The size is rounded up to a power of two such that
+ * the block can be reused for any request in its size class
+ * once it has been released.
+ */
+static struct isl_blk extend_arena(struct isl_ctx *ctx, struct isl_blk block,
+				size_t new_n)
+{
+	isl_int *p;
+
+	new_n = round_up(new_n);
+	if (check_memory(ctx, new_n - block.size) < 0) {
+		isl_blk_free_force(ctx, block);
+		return isl_blk_error();
+	}
+
+	p = arena_alloc(ctx, new_n);
+	if (!p) {
+		isl_blk_free_force(ctx, block);
+		return isl_blk_error();
+	}
+	if (block.size)
+		memcpy(p, block.data, block.size * sizeof(isl_int));
+	block.data = p;
+
+	int_pool_init(ctx, block.data + block.size, new_n - block.size);
+	block.size = new_n;
+
+	return block;
+}
+
 static struct isl_blk extend(struct isl_ctx *ctx, struct isl_blk block,
 				size_t new_n)
 {
-	int i;
 	isl_int *p;
 
 	if (block.size >= new_n)
 		return block;
+	if (ctx->blk_cache.arena)
+		return extend_arena(ctx, block, new_n);
+
+	if (check_memory(ctx, new_n - block.size) < 0) {
+		isl_blk_free_force(ctx, block);
+		return isl_blk_error();
+	}
 
 	p = block.data;
 	block.data = isl_realloc_array(ctx, block.data, isl_int, new_n);
@@ -55,52 +238,76 @@ static struct isl_blk extend(struct isl_ctx *ctx, struct isl_blk block,
 		return isl_blk_error();
 	}
 
-	for (i = block.size; i < new_n; ++i)
-		isl_int_init(block.data[i]);
+	int_pool_init(ctx, block.data + block.size, new_n - block.size);
 	block.size = new_n;
 
 	return block;
 }
 
-static void isl_blk_free_force(struct isl_ctx *ctx, struct isl_blk block)
+/* Return the size class of a block of size "n", i.e., floor(log2(n)).
+ */
+static int size_class(size_t n)
 {
-	int i;
+	int c = 0;
 
-	for (i = 0; i < block.size; ++i)
-		isl_int_clear(block.data[i]);
-	free(block.data);
+	while (n >>= 1)
+		++c;
+	return c;
 }
 
+/* Pop a block from size class "c" of the block cache of "ctx",
+ * or return an empty block if there is no such block.
+ */
+static struct isl_blk pop(struct isl_ctx *ctx, int c)
+{
+	struct isl_blk_size_class *sc;
+
+	if (c >= ISL_BLK_N_SIZE_CLASS)
+		return isl_blk_empty();
+	sc = &ctx->blk_cache.size_class[c];
+	if (sc->n == 0)
+		return isl_blk_empty();
+	ctx->blk_cache.n--;
+	return sc->blk[--sc->n];
+}
+
+/* Allocate a block of (at least) "n" elements.
+ *
+ * Since blocks in size class "c" have at least 2^c elements,
+ * any cached block in the size class of 2^ceil(log2(n)) is large enough.
+ * If there is no such block, we try the next size class, which
+ * contains blocks with fewer than 4n elements.
+ * Failing that, we reuse the most recently released block from
+ * the size class of "n" itself (if any), extending it as needed,
+ * such that at least the elements of that block do not need
+ * to be initialized again.
+ * The allocation is considered to be a cache hit if the block
+ * does not need to be extended.
+ */
 struct isl_blk isl_blk_alloc(struct isl_ctx *ctx, size_t n)
 {
-	int i;
+	int c;
 	struct isl_blk block;
 
-	block = isl_blk_empty();
-	if (n && ctx->n_cached) {
-		int best = 0;
-		for (i = 1; ctx->cache[best].size != n && i < ctx->n_cached; ++i) {
-			if (ctx->cache[best].size < n) {
-				if (ctx->cache[i].size > ctx->cache[best].size)
-					best = i;
-			} else if (ctx->cache[i].size >= n &&
-				   ctx->cache[i].size < ctx->cache[best].size)
-					best = i;
-		}
-		if (ctx->cache[best].size < 2 * n + 100) {
-			block = ctx->cache[best];
-			if (--ctx->n_cached != best)
-				ctx->cache[best] = ctx->cache[ctx->n_cached];
-			if (best == 0)
-				ctx->n_miss = 0;
-		} else if (ctx->n_miss++ >= ISL_BLK_MAX_MISS) {
-			isl_blk_free_force(ctx, ctx->cache[0]);
-			if (--ctx->n_cached != 0)
-				ctx->cache[0] = ctx->cache[ctx->n_cached];
-			ctx->n_miss = 0;
-		}
+	if (!n)
+		return isl_blk_empty();
+	if (ctx->blk_cache.n == 0) {
+		ctx->stats->blk_cache_misses++;
+		return extend(ctx, isl_blk_empty(), n);
 	}
 
+	c = size_class(n);
+	if ((n & (n - 1)) != 0)
+		c++;
+	block = pop(ctx, c);
+	if (isl_blk_is_empty(block))
+		block = pop(ctx, c + 1);
+	if (isl_blk_is_empty(block))
+		block = pop(ctx, size_class(n));
+	if (block.size >= n)
+		ctx->stats->blk_cache_hits++;
+	else
+		ctx->stats->blk_cache_misses++;
 	return extend(ctx, block, n);
 }
 
@@ -113,22 +320,279 @@ struct isl_blk isl_blk_extend(struct isl_ctx *ctx, struct isl_blk block,
 	return extend(ctx, block, new_n);
 }
 
+/* Release "block", keeping it in the block cache of "ctx"
+ * for later reuse, unless the cache already holds the maximal number
+ * of blocks specified by the blk_cache_size option or unless
+ * the cache cannot be extended.
+ * Inside a scope (see isl_blk_scope_enter) or in arena mode,
+ * the maximal number of blocks is not enforced.
+ */
 void isl_blk_free(struct isl_ctx *ctx, struct isl_blk block)
 {
+	struct isl_blk_size_class *sc;
+
 	if (isl_blk_is_empty(block) || isl_blk_is_error(block))
 		return;
 
-	if (ctx->n_cached < ISL_BLK_CACHE_SIZE)
-		ctx->cache[ctx->n_cached++] = block;
-	else
+	if (!ctx->blk_cache.arena && ctx->blk_cache.scope == 0 &&
+	    ctx->blk_cache.n >= ctx->opt->blk_cache_size) {
 		isl_blk_free_force(ctx, block);
+		return;
+	}
+
+	sc = &ctx->blk_cache.size_class[size_class(block.size)];
+	if (sc->n >= sc->size) {
+		struct isl_blk *blk;
+		int size = sc->size ? 2 * sc->size : 4;
+
+		blk = realloc(sc->blk, size * sizeof(struct isl_blk));
+		if (!blk) {
+			isl_blk_free_force(ctx, block);
+			return;
+		}
+		sc->blk = blk;
+		sc->size = size;
+	}
+	sc->blk[sc->n++] = block;
+	ctx->blk_cache.n++;
 }
 
-void isl_blk_clear_cache(struct isl_ctx *ctx)
+/* Enter a scope in which all released blocks are kept
+ * in the block cache of "ctx".
+ * This is meant to be used around operations that create and destroy
+ * large numbers of temporary objects, such that the memory
+ * of these temporaries can be reused without going through
+ * the system allocator.
+ * Scopes may be nested.
+ */
+void isl_blk_scope_enter(struct isl_ctx *ctx)
+{
+	if (!ctx)
+		return;
+	ctx->blk_cache.scope++;
+}
+
+#ifdef HAVE_PTHREAD
+
+/* The minimal number of integers in the blocks removed from
+ * the block cache by isl_blk_scope_leave for these blocks
+ * to be released on a background thread.
+ * For fewer integers, creating the thread costs more
+ * than releasing the blocks directly.
+ */
+#define ISL_BLK_DRAIN_MIN	4096
+
+/* A block that has been removed from the block cache of an isl_ctx.
+ * The integers from position "first" onward still need to be cleared.
+ */
+struct isl_blk_drained {
+	isl_int *data;
+	size_t first;
+	size_t size;
+};
+
+/* The "n" blocks in "blk" that are released by a background thread.
+ */
+struct isl_blk_drain {
+	int n;
+	struct isl_blk_drained blk[1];
+};
+
+/* Clear the remaining integers of the blocks in "user" and
+ * release their storage.
+ * The blocks are no longer owned by any isl_ctx, so this
+ * can be done in any thread.
+ */
+static void *drain(void *user)
 {
 	int i;
+	size_t j;
+	struct isl_blk_drain *drain = user;
+
+	for (i = 0; i < drain->n; ++i) {
+		struct isl_blk_drained *blk = &drain->blk[i];
+
+		for (j = blk->first; j < blk->size; ++j)
+			isl_int_clear(blk->data[j]);
+		free(blk->data);
+	}
+	free(drain);
+
+	return NULL;
+}
+
+/* Wait for the background thread started by drain_background
+ * (if any) to finish.
+ */
+static void drain_wait(struct isl_ctx *ctx)
+{
+	if (!ctx->blk_cache.draining)
+		return;
+	pthread_join(ctx->blk_cache.drain_thread, NULL);
+	ctx->blk_cache.draining = 0;
+}
+
+/* Return the number of blocks that need to be removed from
+ * the block cache of "ctx" to reduce it to the size specified
+ * by the blk_cache_size option, and store the total number
+ * of integers in these blocks in "n_int".
+ * The blocks are removed from the largest size classes first
+ * and from the top of the stack of each size class.
+ */
+static int surplus(struct isl_ctx *ctx, size_t *n_int)
+{
+	int c, i, n;
+
+	n = ctx->blk_cache.n - ctx->opt->blk_cache_size;
+	if (n < 0)
+		n = 0;
+	*n_int = 0;
+	for (c = ISL_BLK_N_SIZE_CLASS - 1, i = 0; c >= 0 && i < n; --c) {
+		struct isl_blk_size_class *sc = &ctx->blk_cache.size_class[c];
+		int j;
 
-	for (i = 0; i < ctx->n_cached; ++i)
-		isl_blk_free_force(ctx, ctx->cache[i]);
-	ctx->n_cached = 0;
+		for (j = sc->n - 1; j >= 0 && i < n; --j, ++i)
+			*n_int += sc->blk[j].size;
+	}
+
+	return n;
+}
+
+/* Reduce the block cache of "ctx" to the size specified
+ * by the blk_cache_size option, releasing the removed blocks
+ * on a background thread.
+ * Return 0 if the cache has been reduced and -1 if the caller
+ * should release the blocks instead, because there are too few
+ * integers in them to make a background thread pay off or
+ * because there is not enough memory to keep track of them.
+ *
+ * The integers of the removed blocks are first moved
+ * to the integer pool of "ctx" where possible, since the pool
+ * belongs to "ctx".  The remaining integers are no longer
+ * taken into account in the memory usage of "ctx".
+ * Only a single background thread is kept, so any earlier
+ * thread is waited for before starting a new one.
+ * If the thread cannot be created, then the blocks are released
+ * in the calling thread.
+ */
+static int drain_background(struct isl_ctx *ctx)
+{
+	int c, n;
+	size_t n_int;
+	struct isl_blk_drain *drain_data;
+
+	n = surplus(ctx, &n_int);
+	if (n_int < ISL_BLK_DRAIN_MIN)
+		return -1;
+	drain_data = malloc(sizeof(struct isl_blk_drain) +
+			    (n - 1) * sizeof(struct isl_blk_drained));
+	if (!drain_data)
+		return -1;
+
+	drain_data->n = 0;
+	for (c = ISL_BLK_N_SIZE_CLASS - 1; c >= 0 && drain_data->n < n; --c) {
+		while (drain_data->n < n) {
+			struct isl_blk_drained *blk;
+			struct isl_blk block = pop(ctx, c);
+			if (isl_blk_is_empty(block))
+				break;
+			blk = &drain_data->blk[drain_data->n++];
+			blk->data = block.data;
+			blk->size = block.size;
+			blk->first = int_pool_keep(ctx, block.data, block.size);
+			ctx->stats->memory -=
+				(block.size - blk->first) * sizeof(isl_int);
+		}
+	}
+
+	drain_wait(ctx);
+	if (pthread_create(&ctx->blk_cache.drain_thread, NULL,
+			    &drain, drain_data) == 0)
+		ctx->blk_cache.draining = 1;
+	else
+		drain(drain_data);
+
+	return 0;
+}
+
+#endif
+
+/* Leave a scope entered through isl_blk_scope_enter.
+ * When leaving the outermost scope, the block cache is reduced
+ * to the size specified by the blk_cache_size option,
+ * freeing the blocks in the largest size classes first.
+ * If the deferred_free_thread option is set and the threads option
+ * allows more than one thread, then the blocks may be freed
+ * on a background thread instead (see drain_background).
+ * In arena mode, the storage of the blocks cannot be freed
+ * individually, so all blocks are kept.
+ */
+void isl_blk_scope_leave(struct isl_ctx *ctx)
+{
+	int c;
+
+	if (!ctx)
+		return;
+	if (--ctx->blk_cache.scope > 0)
+		return;
+	if (ctx->blk_cache.arena)
+		return;
+#ifdef HAVE_PTHREAD
+	if (ctx->opt->deferred_free_thread && ctx->opt->threads > 1 &&
+	    drain_background(ctx) == 0)
+		return;
+#endif
+
+	for (c = ISL_BLK_N_SIZE_CLASS - 1;
+	     c >= 0 && ctx->blk_cache.n > ctx->opt->blk_cache_size; --c) {
+		while (ctx->blk_cache.n > ctx->opt->blk_cache_size) {
+			struct isl_blk block = pop(ctx, c);
+			if (isl_blk_is_empty(block))
+				break;
+			isl_blk_free_force(ctx, block);
+		}
+	}
+}
+
+/* Release all blocks in the block cache of "ctx",
+ * the integers in the integer pool and, in arena mode,
+ * all chunks of the arena.
+ * In arena mode, the storage of the blocks is not freed individually,
+ * but along with the chunks from which it was taken.
+ * Any blocks that are still being released on a background thread
+ * are waited for first.
+ */
+void isl_blk_clear_cache(struct isl_ctx *ctx)
+{
+	int i, j;
+	struct isl_blk_chunk *chunk;
+
+#ifdef HAVE_PTHREAD
+	drain_wait(ctx);
+#endif
+
+	for (i = 0; i < ISL_BLK_N_SIZE_CLASS; ++i) {
+		struct isl_blk_size_class *sc = &ctx->blk_cache.size_class[i];
+
+		for (j = 0; j < sc->n; ++j)
+			isl_blk_free_force(ctx, sc->blk[j]);
+		free(sc->blk);
+		sc->n = 0;
+		sc->size = 0;
+		sc->blk = NULL;
+	}
+	ctx->blk_cache.n = 0;
+
+	for (i = 0; i < ctx->n_int_pool; ++i)
+		isl_int_clear(ctx->int_pool[i]);
+	ctx->stats->memory -= ctx->n_int_pool * sizeof(isl_int);
+	free(ctx->int_pool);
+	ctx->n_int_pool = 0;
+	ctx->int_pool_size = 0;
+	ctx->int_pool = NULL;
+
+	while ((chunk = ctx->blk_cache.chunk) != NULL) {
+		ctx->blk_cache.chunk = chunk->next;
+		free(chunk);
+	}
 }
@@ -11,6 +11,9 @@
 #define ISL_BLK_H
 
 #include <isl_int.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 #if defined(__cplusplus)
 extern "C" {
@@ -21,7 +24,54 @@ struct isl_blk {
 	isl_int *data;
 };
 
-#define ISL_BLK_CACHE_SIZE	20
+/* The number of size classes in the block cache.
+ * Size class "c" contains blocks with a size in [2^c, 2^(c+1)).
+ */
+#define ISL_BLK_N_SIZE_CLASS	(8 * sizeof(size_t))
+
+/* A stack of cached blocks of a given size class.
+ * "n" is the number of blocks on the stack and "size"
+ * the number of elements allocated in "blk".
+ */
+struct isl_blk_size_class {
+	int n;
+	int size;
+	struct isl_blk *blk;
+};
+
+/* A chunk of memory from which the storage of blocks is carved out
+ * in arena mode.  "n" is the number of elements of "data"
+ * that have been handed out and "size" the total number of elements.
+ */
+struct isl_blk_chunk {
+	struct isl_blk_chunk *next;
+	size_t size;
+	size_t n;
+	isl_int data[1];
+};
+
+/* The blocks that have been released, but not yet freed,
+ * organized by size class.
+ * "n" is the total number of cached blocks.
+ * "scope" is the nesting depth of scopes entered
+ * through isl_blk_scope_enter.
+ * If "arena" is set, then the storage of all blocks is taken
+ * from the chunks in "chunk" and it is only returned to the system
+ * by isl_blk_clear_cache.
+ * If "draining" is set, then "drain_thread" is still releasing
+ * the blocks that were removed from the cache by isl_blk_scope_leave.
+ */
+struct isl_blk_cache {
+	int n;
+	int scope;
+	struct isl_blk_size_class size_class[ISL_BLK_N_SIZE_CLASS];
+	int arena;
+	struct isl_blk_chunk *chunk;
+#ifdef HAVE_PTHREAD
+	int draining;
+	pthread_t drain_thread;
+#endif
+};
 
 struct isl_ctx;
 
@@ -33,6 +83,9 @@ struct isl_blk isl_blk_extend(struct isl_ctx *ctx, struct isl_blk block,
 void isl_blk_free(struct isl_ctx *ctx, struct isl_blk block);
 void isl_blk_clear_cache(struct isl_ctx *ctx);
 
+void isl_blk_scope_enter(struct isl_ctx *ctx);
+void isl_blk_scope_leave(struct isl_ctx *ctx);
+
 #if defined(__cplusplus)
 }
 #endif
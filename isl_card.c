@@ -0,0 +1,440 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <isl_ctx_private.h>
+#include <isl_map_private.h>
+#include <isl/aff.h>
+#include <isl/constraint.h>
+#include <isl/set.h>
+#include <isl/val.h>
+#include <isl_polynomial_private.h>
+
+/* Data used during the summation of a quasi-polynomial
+ * over the integer points of a basic set.
+ *
+ * "poly" is the quasi-polynomial that is being summed over
+ * the last set variable of the basic set.
+ * "res" collects the results.
+ */
+struct isl_card_data {
+	isl_qpolynomial *poly;
+	isl_pw_qpolynomial *res;
+};
+
+static int sum_over_domain(__isl_take isl_basic_set *bset,
+	__isl_take isl_qpolynomial *poly, isl_pw_qpolynomial **res);
+
+/* Return the sums
+ *
+ *	F_j(n) = sum_{x = 1}^n x^j
+ *
+ * for 0 <= j <= "deg", with "n" the given quasi-polynomial.
+ * Each F_j is computed from the earlier ones using
+ *
+ *	(n + 1)^(j + 1) - 1 = sum_{i = 0}^j binomial(j + 1, i) F_i(n)
+ *
+ * which is obtained by summing (x + 1)^(j + 1) - x^(j + 1) over x.
+ * Note that the resulting polynomials satisfy F_j(n) - F_j(n - 1) = n^j
+ * for any integer n, such that sum_{x = l}^u x^j = F_j(u) - F_j(l - 1)
+ * whenever l <= u + 1.
+ */
+static isl_qpolynomial **power_sums(__isl_take isl_qpolynomial *n, int deg)
+{
+	int i, j;
+	isl_ctx *ctx;
+	isl_qpolynomial **F;
+	isl_qpolynomial *n1;
+	isl_int c;
+
+	if (!n)
+		return NULL;
+
+	ctx = isl_qpolynomial_get_ctx(n);
+	F = isl_calloc_array(ctx, isl_qpolynomial *, deg + 1);
+	if (!F)
+		goto error;
+
+	n1 = isl_qpolynomial_add(isl_qpolynomial_copy(n),
+		isl_qpolynomial_one_on_domain(isl_qpolynomial_get_domain_space(n)));
+	F[0] = isl_qpolynomial_copy(n);
+	if (!F[0])
+		goto error2;
+
+	isl_int_init(c);
+	for (j = 1; j <= deg; ++j) {
+		isl_qpolynomial *t;
+		isl_val *v;
+
+		t = isl_qpolynomial_pow(isl_qpolynomial_copy(n1), j + 1);
+		t = isl_qpolynomial_sub(t,
+		    isl_qpolynomial_one_on_domain(isl_qpolynomial_get_domain_space(n)));
+		isl_int_set_si(c, 1);
+		for (i = 0; i < j; ++i) {
+			isl_qpolynomial *f;
+
+			f = isl_qpolynomial_mul_isl_int(
+				isl_qpolynomial_copy(F[i]), c);
+			t = isl_qpolynomial_sub(t, f);
+			isl_int_mul_ui(c, c, j + 1 - i);
+			isl_int_divexact_ui(c, c, i + 1);
+		}
+		v = isl_val_div(isl_val_one(ctx),
+				isl_val_int_from_si(ctx, j + 1));
+		F[j] = isl_qpolynomial_scale_val(t, v);
+		if (!F[j])
+			break;
+	}
+	isl_int_clear(c);
+	if (j <= deg)
+		goto error2;
+
+	isl_qpolynomial_free(n1);
+	isl_qpolynomial_free(n);
+	return F;
+error2:
+	for (i = 0; i <= deg; ++i)
+		isl_qpolynomial_free(F[i]);
+	free(F);
+	isl_qpolynomial_free(n1);
+error:
+	isl_qpolynomial_free(n);
+	return NULL;
+}
+
+/* Free the array "F" of "n" quasi-polynomials.
+ */
+static void free_power_sums(isl_qpolynomial **F, int n)
+{
+	int i;
+
+	if (!F)
+		return;
+	for (i = 0; i < n; ++i)
+		isl_qpolynomial_free(F[i]);
+	free(F);
+}
+
+/* Sum data->poly over the last set variable x between
+ * the (rational) lower bound "lower" and upper bound "upper",
+ * which are the active bounds on "bset", the set of values
+ * of the remaining variables for which the sum needs to be computed.
+ *
+ * Since "bset" only contains integer points, the integer values of x
+ * run from l = ceil(lower) to u = floor(upper).
+ * Since the rational range is non-empty, we have l <= u + 1.
+ * Writing data->poly as sum_j c_j x^j, with the c_j independent of x,
+ * the result is then equal to sum_j c_j (F_j(u) - F_j(l - 1)),
+ * with F_j as computed by power_sums.
+ * The result is then summed over the remaining variables.
+ */
+static int sum_bound_pair(__isl_take isl_constraint *lower,
+	__isl_take isl_constraint *upper, __isl_take isl_basic_set *bset,
+	void *user)
+{
+	struct isl_card_data *data = user;
+	isl_qpolynomial *sum, *l, *u;
+	isl_qpolynomial **F_l = NULL, **F_u = NULL;
+	isl_aff *aff;
+	int j, deg;
+	unsigned pos;
+
+	if (!lower || !upper || !bset)
+		goto error;
+
+	pos = isl_basic_set_dim(bset, isl_dim_set);
+	deg = isl_qpolynomial_degree(data->poly);
+	if (deg < -1)
+		goto error;
+
+	aff = isl_constraint_get_bound(lower, isl_dim_set, pos);
+	aff = isl_aff_ceil(aff);
+	aff = isl_aff_add_constant_si(aff, -1);
+	l = isl_qpolynomial_from_aff(aff);
+	aff = isl_constraint_get_bound(upper, isl_dim_set, pos);
+	aff = isl_aff_floor(aff);
+	u = isl_qpolynomial_from_aff(aff);
+
+	sum = isl_qpolynomial_zero_on_domain(
+			isl_qpolynomial_get_domain_space(data->poly));
+	if (deg >= 0) {
+		F_l = power_sums(l, deg);
+		F_u = power_sums(u, deg);
+	} else {
+		isl_qpolynomial_free(l);
+		isl_qpolynomial_free(u);
+	}
+	if (deg >= 0 && (!F_l || !F_u))
+		sum = isl_qpolynomial_free(sum);
+	for (j = 0; sum && j <= deg; ++j) {
+		isl_qpolynomial *c, *d;
+
+		c = isl_qpolynomial_coeff(data->poly, isl_dim_in, pos, j);
+		d = isl_qpolynomial_sub(isl_qpolynomial_copy(F_u[j]),
+					isl_qpolynomial_copy(F_l[j]));
+		sum = isl_qpolynomial_add(sum, isl_qpolynomial_mul(c, d));
+	}
+	free_power_sums(F_l, deg + 1);
+	free_power_sums(F_u, deg + 1);
+
+	sum = isl_qpolynomial_drop_dims(sum, isl_dim_in, pos, 1);
+
+	isl_constraint_free(lower);
+	isl_constraint_free(upper);
+
+	return sum_over_domain(bset, sum, &data->res);
+error:
+	isl_constraint_free(lower);
+	isl_constraint_free(upper);
+	isl_basic_set_free(bset);
+	return -1;
+}
+
+/* Replace the variable at position "pos" of "bset" by
+ * "period" times this variable plus "residue".
+ * "bset" is assumed not to have any integer divisions.
+ */
+static __isl_give isl_basic_set *substitute_var_period(
+	__isl_take isl_basic_set *bset, unsigned pos,
+	isl_int period, isl_int residue)
+{
+	int i;
+
+	bset = isl_basic_set_cow(bset);
+	if (!bset)
+		return NULL;
+
+	for (i = 0; i < bset->n_eq; ++i) {
+		if (isl_int_is_zero(bset->eq[i][1 + pos]))
+			continue;
+		isl_int_addmul(bset->eq[i][0], bset->eq[i][1 + pos], residue);
+		isl_int_mul(bset->eq[i][1 + pos], bset->eq[i][1 + pos], period);
+	}
+	for (i = 0; i < bset->n_ineq; ++i) {
+		if (isl_int_is_zero(bset->ineq[i][1 + pos]))
+			continue;
+		isl_int_addmul(bset->ineq[i][0], bset->ineq[i][1 + pos],
+				residue);
+		isl_int_mul(bset->ineq[i][1 + pos], bset->ineq[i][1 + pos],
+				period);
+	}
+
+	bset = isl_basic_set_simplify(bset);
+	return isl_basic_set_finalize(bset);
+}
+
+/* Sum "poly" over the integer points of "bset", which does not have
+ * any integer divisions, and add the result to "res".
+ *
+ * If there are no set variables left, then the result is simply
+ * "poly" on the parameter domain of "bset".
+ * Otherwise, we sum over the last set variable x.
+ * If x appears in any of the integer divisions of "poly",
+ * then x is first replaced by p x' + r for each residue r modulo
+ * the period p computed by isl_qpolynomial_var_period, such that
+ * x' no longer appears in any of the integer divisions.
+ * Then, for each chamber of the remaining variables in which
+ * a fixed pair of lower and upper bounds on x' is active,
+ * the sum over x' is computed by sum_bound_pair.
+ */
+static int sum_over_domain(__isl_take isl_basic_set *bset,
+	__isl_take isl_qpolynomial *poly, isl_pw_qpolynomial **res)
+{
+	struct isl_card_data data;
+	isl_int period, r;
+	unsigned nparam, n;
+	int ok = 0;
+
+	if (!bset || !poly)
+		goto error;
+	if (bset->n_div > 0)
+		isl_die(isl_basic_set_get_ctx(bset), isl_error_internal,
+			"unexpected integer divisions", goto error);
+
+	if (isl_basic_set_plain_is_empty(bset) ||
+	    isl_qpolynomial_is_zero(poly)) {
+		isl_basic_set_free(bset);
+		isl_qpolynomial_free(poly);
+		return 0;
+	}
+
+	n = isl_basic_set_dim(bset, isl_dim_set);
+	if (n == 0) {
+		isl_set *dom;
+		isl_pw_qpolynomial *pwqp;
+
+		dom = isl_set_from_basic_set(isl_basic_set_params(bset));
+		poly = isl_qpolynomial_project_domain_on_params(poly);
+		pwqp = isl_pw_qpolynomial_alloc(dom, poly);
+		*res = isl_pw_qpolynomial_add(*res, pwqp);
+		return *res ? 0 : -1;
+	}
+
+	nparam = isl_basic_set_dim(bset, isl_dim_param);
+	isl_int_init(period);
+	isl_int_init(r);
+	if (isl_qpolynomial_var_period(poly, isl_dim_in, n - 1, &period) < 0)
+		ok = -1;
+	for (isl_int_set_si(r, 0); ok >= 0 && isl_int_lt(r, period);
+	     isl_int_add_ui(r, r, 1)) {
+		isl_basic_set *bset_r;
+
+		bset_r = isl_basic_set_copy(bset);
+		bset_r = substitute_var_period(bset_r, nparam + n - 1,
+						period, r);
+		data.poly = isl_qpolynomial_copy(poly);
+		data.poly = isl_qpolynomial_substitute_var_period(data.poly,
+					isl_dim_in, n - 1, period, r);
+		data.res = *res;
+		if (!bset_r || !data.poly)
+			ok = -1;
+		else if (isl_basic_set_plain_is_empty(bset_r))
+			ok = 0;
+		else
+			ok = isl_basic_set_foreach_bound_pair(bset_r,
+					isl_dim_set, n - 1,
+					&sum_bound_pair, &data);
+		*res = data.res;
+		isl_qpolynomial_free(data.poly);
+		isl_basic_set_free(bset_r);
+	}
+	isl_int_clear(r);
+	isl_int_clear(period);
+
+	isl_basic_set_free(bset);
+	isl_qpolynomial_free(poly);
+	return ok;
+error:
+	isl_basic_set_free(bset);
+	isl_qpolynomial_free(poly);
+	return -1;
+}
+
+/* Return the zero piecewise quasi-polynomial on the parameter space
+ * of "space".
+ */
+static __isl_give isl_pw_qpolynomial *zero_on_params(
+	__isl_take isl_space *space)
+{
+	space = isl_space_params(space);
+	space = isl_space_from_domain(space);
+	space = isl_space_add_dims(space, isl_dim_out, 1);
+	return isl_pw_qpolynomial_zero(space);
+}
+
+/* Compute the number of integer points in "bset", which is bounded,
+ * does not have any equalities and does not have any integer divisions,
+ * as a function of the parameters.
+ * We do this by summing the constant one over all the set variables,
+ * one variable at a time.
+ */
+static __isl_give isl_pw_qpolynomial *card_base(__isl_take isl_basic_set *bset)
+{
+	isl_space *space;
+	isl_qpolynomial *one;
+	isl_pw_qpolynomial *res;
+
+	if (!bset)
+		return NULL;
+
+	space = isl_basic_set_get_space(bset);
+	res = zero_on_params(isl_space_copy(space));
+	one = isl_qpolynomial_one_on_domain(space);
+	if (sum_over_domain(bset, one, &res) < 0)
+		return isl_pw_qpolynomial_free(res);
+
+	return res;
+}
+
+/* Replace the integer divisions of "bset", which are assumed to be known,
+ * by extra set variables, constrained to be equal to the values
+ * of the integer divisions.
+ * Since every point in "bset" corresponds to exactly one point
+ * in the result, the result has the same number of integer points.
+ */
+static __isl_give isl_basic_set *lift_divs(__isl_take isl_basic_set *bset)
+{
+	int i;
+
+	if (!bset)
+		return NULL;
+	if (bset->n_div == 0)
+		return bset;
+
+	bset = isl_basic_set_cow(bset);
+	bset = isl_basic_set_extend_constraints(bset, 0, 2 * bset->n_div);
+	if (!bset)
+		return NULL;
+	for (i = 0; i < bset->n_div; ++i)
+		if (isl_basic_map_add_div_constraints(bset, i) < 0)
+			return isl_basic_set_free(bset);
+
+	bset = isl_basic_set_lift(bset);
+	return isl_basic_set_flatten(bset);
+}
+
+/* Compute the number of integer points in "bset", as a function
+ * of the parameters.  The integer divisions of "bset" are assumed
+ * to be known.
+ *
+ * After replacing the integer divisions by set variables,
+ * special cases, equalities and factors are handled by
+ * isl_basic_set_multiplicative_call.
+ */
+static __isl_give isl_pw_qpolynomial *basic_set_card(
+	__isl_take isl_basic_set *bset)
+{
+	bset = lift_divs(bset);
+	return isl_basic_set_multiplicative_call(bset, &card_base);
+}
+
+/* Compute the number of integer points in "set", as a function
+ * of the parameters.
+ *
+ * The set is first split into disjoint basic sets with known
+ * integer divisions and the numbers of integer points in these
+ * basic sets are added up.
+ *
+ * The number of integer points of each basic set is computed
+ * by summing over the set variables one at a time,
+ * splitting the domain into chambers where a single pair of
+ * lower and upper bounds is active.  The result is therefore
+ * computed in time polynomial in the size of the input,
+ * for a fixed dimension and fixed denominators of the integer
+ * divisions that arise, rather than in time proportional
+ * to the number of points, as in isl_set_count_val.
+ * If the set is unbounded, then the result is infinity on
+ * the parameter values for which it is non-empty.
+ * Since the summation produces many overlapping pieces,
+ * the result is coalesced at the end.
+ */
+__isl_give isl_pw_qpolynomial *isl_set_card(__isl_take isl_set *set)
+{
+	int i;
+	isl_pw_qpolynomial *res;
+
+	set = isl_set_make_disjoint(set);
+	set = isl_set_compute_divs(set);
+	if (!set)
+		return NULL;
+
+	res = zero_on_params(isl_set_get_space(set));
+	for (i = 0; res && i < set->n; ++i) {
+		isl_pw_qpolynomial *card;
+
+		card = basic_set_card(isl_basic_set_copy(set->p[i]));
+		res = isl_pw_qpolynomial_add(res, card);
+	}
+
+	isl_set_free(set);
+	return isl_pw_qpolynomial_coalesce(res);
+}
+
+/* Compute the number of integer points in "bset", as a function
+ * of the parameters.
+ */
+__isl_give isl_pw_qpolynomial *isl_basic_set_card(
+	__isl_take isl_basic_set *bset)
+{
+	return isl_set_card(isl_set_from_basic_set(bset));
+}
@@ -12,13 +12,18 @@
  * and Ecole Normale Superieure, 45 rue d’Ulm, 75230 Paris, France
  */
 
+#include <isl_config.h>
+#include <isl_ctx_private.h>
 #include "isl_map_private.h"
 #include <isl_seq.h>
-#include <isl/options.h>
+#include <isl_options_private.h>
+#include <isl_lp_private.h>
 #include "isl_tab.h"
 #include <isl_mat_private.h>
 #include <isl_local_space_private.h>
 #include <isl_vec_private.h>
+#include <isl_profile.h>
+#include <isl_thread.h>
 
 #define STATUS_ERROR		-1
 #define STATUS_REDUNDANT	 1
@@ -637,6 +642,18 @@ static int allow_wrap(struct isl_wraps *wraps, int row)
 	return 1;
 }
 
+/* Wrap "facet" around "ridge" such that it includes the whole set "set",
+ * using the LP problem "lp" for wrapping around "set",
+ * which is constructed first if it is NULL.
+ */
+static __isl_give isl_tab_lp *wrap(__isl_keep isl_set *set,
+	__isl_take isl_tab_lp *lp, isl_int *facet, isl_int *ridge)
+{
+	if (!lp)
+		lp = isl_set_wrap_lp(set);
+	return isl_set_wrap_facet_lp(set, lp, facet, ridge);
+}
+
 /* For each non-redundant constraint in "bmap" (as determined by "tab"),
  * wrap the constraint around "bound" such that it includes the whole
  * set "set" and append the resulting constraint to "wraps".
@@ -650,6 +667,8 @@ static int allow_wrap(struct isl_wraps *wraps, int row)
  * Similarly, if we want to bound the coefficients of the wrapping
  * constraints and a newly added wrapping constraint does not
  * satisfy the bound, then wraps->n_row is also reset to zero.
+ * All wrapping problems are solved on the same set and
+ * therefore share a single LP problem.
  */
 static int add_wraps(struct isl_wraps *wraps, __isl_keep isl_basic_map *bmap,
 	struct isl_tab *tab, isl_int *bound, __isl_keep isl_set *set)
@@ -657,6 +676,7 @@ static int add_wraps(struct isl_wraps *wraps, __isl_keep isl_basic_map *bmap,
 	int l;
 	int w;
 	unsigned total = isl_basic_map_total_dim(bmap);
+	isl_tab_lp *lp = NULL;
 
 	w = wraps->mat->n_row;
 
@@ -669,7 +689,8 @@ static int add_wraps(struct isl_wraps *wraps, __isl_keep isl_basic_map *bmap,
 			continue;
 
 		isl_seq_cpy(wraps->mat->row[w], bound, 1 + total);
-		if (!isl_set_wrap_facet(set, wraps->mat->row[w], bmap->ineq[l]))
+		lp = wrap(set, lp, wraps->mat->row[w], bmap->ineq[l]);
+		if (!lp)
 			return -1;
 		if (isl_seq_eq(wraps->mat->row[w], bound, 1 + total))
 			goto unbounded;
@@ -685,8 +706,8 @@ static int add_wraps(struct isl_wraps *wraps, __isl_keep isl_basic_map *bmap,
 
 		isl_seq_cpy(wraps->mat->row[w], bound, 1 + total);
 		isl_seq_neg(wraps->mat->row[w + 1], bmap->eq[l], 1 + total);
-		if (!isl_set_wrap_facet(set, wraps->mat->row[w],
-					wraps->mat->row[w + 1]))
+		lp = wrap(set, lp, wraps->mat->row[w], wraps->mat->row[w + 1]);
+		if (!lp)
 			return -1;
 		if (isl_seq_eq(wraps->mat->row[w], bound, 1 + total))
 			goto unbounded;
@@ -695,7 +716,8 @@ static int add_wraps(struct isl_wraps *wraps, __isl_keep isl_basic_map *bmap,
 		++w;
 
 		isl_seq_cpy(wraps->mat->row[w], bound, 1 + total);
-		if (!isl_set_wrap_facet(set, wraps->mat->row[w], bmap->eq[l]))
+		lp = wrap(set, lp, wraps->mat->row[w], bmap->eq[l]);
+		if (!lp)
 			return -1;
 		if (isl_seq_eq(wraps->mat->row[w], bound, 1 + total))
 			goto unbounded;
@@ -704,9 +726,11 @@ static int add_wraps(struct isl_wraps *wraps, __isl_keep isl_basic_map *bmap,
 		++w;
 	}
 
+	isl_tab_lp_free(lp);
 	wraps->mat->n_row = w;
 	return 0;
 unbounded:
+	isl_tab_lp_free(lp);
 	wraps->mat->n_row = 0;
 	return 0;
 }
@@ -1629,7 +1653,239 @@ static int coalesce_pair(__isl_keep isl_map *map, int i, int j,
 	return check_coalesce_subset(map, i, j, tabs);
 }
 
-static struct isl_map *coalesce(struct isl_map *map, struct isl_tab **tabs)
+/* A rational bounding box of a basic map, computed from its tableau.
+ *
+ * "state" is BOX_UNKNOWN if the box has not been computed yet,
+ * BOX_UNUSABLE if it cannot be used to detect separating constraints and
+ * BOX_VALID otherwise.
+ * In the latter case, "bound" contains a lower bound for each variable,
+ * followed by an upper bound for each variable.  The bounds have been
+ * rounded outward to integers.  "finite" records which of the bounds
+ * are finite.
+ */
+struct isl_coalesce_box {
+#define BOX_UNKNOWN	0
+#define BOX_UNUSABLE	1
+#define BOX_VALID	2
+	int state;
+	isl_vec *bound;
+	int *finite;
+};
+
+static void box_clear(struct isl_coalesce_box *box)
+{
+	isl_vec_free(box->bound);
+	free(box->finite);
+	box->bound = NULL;
+	box->finite = NULL;
+	box->state = BOX_UNKNOWN;
+}
+
+static void boxes_free(struct isl_coalesce_box *boxes, int n)
+{
+	int i;
+
+	if (!boxes)
+		return;
+	for (i = 0; i < n; ++i)
+		box_clear(&boxes[i]);
+	free(boxes);
+}
+
+/* Compute a rational bounding box of basic map "i" from its tableau.
+ *
+ * The box is only used if the tableau does not have any equalities
+ * (see box_separates), so we do not bother computing it otherwise.
+ */
+static int box_compute(__isl_keep isl_map *map, int i, struct isl_tab **tabs,
+	struct isl_coalesce_box *box)
+{
+	int k, l;
+	unsigned total = isl_basic_map_total_dim(map->p[i]);
+	struct isl_tab *tab = tabs[i];
+	isl_vec *f;
+	isl_int opt, opt_denom;
+	enum isl_lp_result res = isl_lp_ok;
+
+	box->state = BOX_UNUSABLE;
+	if (map->p[i]->n_eq != 0 || tab->n_dead != 0 || tab->empty)
+		return 0;
+
+	f = isl_vec_alloc(map->ctx, 1 + total);
+	box->bound = isl_vec_alloc(map->ctx, 2 * total);
+	box->finite = isl_alloc_array(map->ctx, int, 2 * total);
+	if (!f || !box->bound || (total && !box->finite))
+		goto error;
+	if (isl_tab_extend_cons(tab, 1) < 0)
+		goto error;
+
+	isl_int_init(opt);
+	isl_int_init(opt_denom);
+	isl_seq_clr(f->el, 1 + total);
+	for (k = 0; k < total; ++k) {
+		for (l = 0; l < 2; ++l) {
+			isl_int *b = &box->bound->el[l * total + k];
+
+			isl_int_set_si(f->el[1 + k], l ? -1 : 1);
+			res = isl_tab_min(tab, f->el, map->ctx->one,
+					  &opt, &opt_denom, 0);
+			if (res == isl_lp_error || res == isl_lp_empty)
+				break;
+			box->finite[l * total + k] = res == isl_lp_ok;
+			if (res != isl_lp_ok)
+				continue;
+			isl_int_fdiv_q(*b, opt, opt_denom);
+			if (l)
+				isl_int_neg(*b, *b);
+		}
+		isl_int_set_si(f->el[1 + k], 0);
+		if (l < 2)
+			break;
+	}
+	isl_int_clear(opt);
+	isl_int_clear(opt_denom);
+	isl_vec_free(f);
+
+	if (res == isl_lp_error)
+		return -1;
+	if (res == isl_lp_empty) {
+		box_clear(box);
+		box->state = BOX_UNUSABLE;
+		return 0;
+	}
+
+	box->state = BOX_VALID;
+	return 0;
+error:
+	isl_vec_free(f);
+	box_clear(box);
+	return -1;
+}
+
+/* Is the upper bound of the affine expression "c" over the box "box"
+ * smaller than minus the gcd of the coefficients of the variables in "c"?
+ * "c" has "total" variables.  "tmp" and "g" are scratch variables.
+ */
+static int box_max_below_gcd(struct isl_coalesce_box *box, isl_int *c,
+	unsigned total, isl_int *tmp, isl_int *g)
+{
+	int k;
+
+	isl_seq_gcd(c + 1, total, g);
+	if (isl_int_is_zero(*g))
+		return 0;
+	isl_int_set(*tmp, c[0]);
+	for (k = 0; k < total; ++k) {
+		int l;
+
+		if (isl_int_is_zero(c[1 + k]))
+			continue;
+		l = isl_int_is_pos(c[1 + k]);
+		if (!box->finite[l * total + k])
+			return 0;
+		isl_int_addmul(*tmp, c[1 + k], box->bound->el[l * total + k]);
+	}
+	isl_int_add(*tmp, *tmp, *g);
+
+	return isl_int_is_neg(*tmp);
+}
+
+/* Is there any constraint of basic map "i" that is guaranteed to
+ * be considered separating with respect to basic map "j"
+ * by coalesce_local_pair, based on the bounding box of "j"?
+ *
+ * A constraint that is negative on all (rational) points of "j"
+ * is considered separating unless it is adjacent to a constraint of "j".
+ * In the latter case, the tableau row of the constraint is of the form
+ * -c (1 + r), with c a positive integer and r a non-negative
+ * tableau variable.  If the tableau of "j" has no equalities, then
+ * this is an identity between affine expressions over the whole space
+ * and since r has integer coefficients, c divides the gcd of
+ * the coefficients of the constraint and the maximal value
+ * of the constraint over "j" is -c.
+ * A constraint that attains only values smaller than minus this gcd
+ * is therefore separating.
+ * Each equality is considered as a pair of opposite inequalities and
+ * redundant inequalities are skipped, as in coalesce_local_pair.
+ */
+static int box_separates(__isl_keep isl_map *map, int i, int j,
+	struct isl_tab **tabs, struct isl_coalesce_box *boxes)
+{
+	int k, l;
+	int sep = 0;
+	unsigned total;
+	isl_basic_map *bmap = map->p[i];
+	isl_int tmp, g;
+
+	if (boxes[j].state == BOX_UNKNOWN &&
+	    box_compute(map, j, tabs, &boxes[j]) < 0)
+		return -1;
+	if (boxes[j].state != BOX_VALID)
+		return 0;
+
+	total = isl_basic_map_total_dim(bmap);
+	isl_int_init(tmp);
+	isl_int_init(g);
+	for (k = 0; !sep && k < bmap->n_eq; ++k) {
+		for (l = 0; !sep && l < 2; ++l) {
+			isl_seq_neg(bmap->eq[k], bmap->eq[k], 1 + total);
+			sep = box_max_below_gcd(&boxes[j], bmap->eq[k], total,
+						&tmp, &g);
+		}
+		if (l < 2)
+			isl_seq_neg(bmap->eq[k], bmap->eq[k], 1 + total);
+	}
+	for (k = 0; !sep && k < bmap->n_ineq; ++k) {
+		if (isl_tab_is_redundant(tabs[i], bmap->n_eq + k))
+			continue;
+		sep = box_max_below_gcd(&boxes[j], bmap->ineq[k], total,
+					&tmp, &g);
+	}
+	isl_int_clear(tmp);
+	isl_int_clear(g);
+
+	return sep;
+}
+
+/* Can the pair of basic maps "i" and "j" be skipped because
+ * the bounding box of one of them shows that some constraint
+ * of the other separates them?
+ * This check is only performed for basic maps with the same divs,
+ * since those are the only ones for which coalesce_pair compares
+ * the constraints of basic maps directly.
+ */
+static int box_skip_pair(__isl_keep isl_map *map, int i, int j,
+	struct isl_tab **tabs, struct isl_coalesce_box *boxes)
+{
+	int same, skip;
+
+	same = same_divs(map->p[i], map->p[j]);
+	if (same < 0 || !same)
+		return same;
+	skip = box_separates(map, i, j, tabs, boxes);
+	if (skip < 0 || skip)
+		return skip;
+	return box_separates(map, j, i, tabs, boxes);
+}
+
+/* Try and coalesce each pair of basic maps in "map".
+ *
+ * If "boxes" is not NULL, then it contains the (lazily computed)
+ * bounding boxes of the basic maps and these are used to skip pairs
+ * that can be seen not to be coalescable without examining
+ * the tableaus in detail.  Whenever the pair "i", "j" has been changed,
+ * the basic maps at positions "i" and "j" (and the last position,
+ * which may have been moved to either "i" or "j") are no longer
+ * the same and their boxes are discarded.
+ *
+ * The computation started when the number of pivots was "start".
+ * If the budget set by the simplify_budget option has been used up,
+ * then no further pairs are considered.  The result is then
+ * still equal to the input, but it may consist of more basic maps
+ * than necessary.
+ */
+static struct isl_map *coalesce(struct isl_map *map, struct isl_tab **tabs,
+	struct isl_coalesce_box *boxes, long start)
 {
 	int i, j;
 
@@ -1637,11 +1893,34 @@ static struct isl_map *coalesce(struct isl_map *map, struct isl_tab **tabs)
 restart:
 		for (j = i + 1; j < map->n; ++j) {
 			int changed;
+			int n = map->n;
+
+			if (isl_ctx_simplify_budget_exhausted(map->ctx, start)) {
+				map->ctx->stats->simplify_budget_exhausted++;
+				return map;
+			}
+			if (boxes) {
+				int skip;
+				skip = box_skip_pair(map, i, j, tabs, boxes);
+				if (skip < 0)
+					goto error;
+				if (skip) {
+					map->ctx->stats->coalesce_pairs_skipped++;
+					continue;
+				}
+			}
+			map->ctx->stats->coalesce_pairs_tested++;
 			changed = coalesce_pair(map, i, j, tabs);
 			if (changed < 0)
 				goto error;
-			if (changed)
+			if (changed) {
+				if (boxes) {
+					box_clear(&boxes[i]);
+					box_clear(&boxes[j]);
+					box_clear(&boxes[n - 1]);
+				}
 				goto restart;
+			}
 		}
 	return map;
 error:
@@ -1649,6 +1928,322 @@ error:
 	return NULL;
 }
 
+#ifdef HAVE_PTHREAD
+
+/* Data used by the workers of a round of coalesce_threads.
+ * "map" is the map that is being coalesced and lives in "ctx".
+ * "pair" contains the positions in "map" of the "n_pair" pairs
+ * of basic maps that are examined in this round.
+ * For each pair k, status[k] is set to 1 if the pair can be coalesced,
+ * in which case res[k] contains the result (imported into "ctx"), and
+ * to 0 if it cannot be coalesced.
+ * "budget" is the part of the budget set by the simplify_budget option
+ * of "ctx" that has not been used up yet (if this option is positive).
+ */
+struct isl_coalesce_threads {
+	isl_ctx *ctx;
+	isl_map *map;
+	int n_pair;
+	int *pair;
+	int *status;
+	isl_map **res;
+	int budget;
+};
+
+/* Try and coalesce the pair of basic maps "k" in the isl_ctx of "worker".
+ * The pair is coalesced by calling isl_map_coalesce on a map
+ * consisting of only these two basic maps, with the remaining part
+ * of the simplification budget of the caller.
+ */
+static int coalesce_work(struct isl_thread_worker *worker, int k, void *user)
+{
+	struct isl_coalesce_threads *data = user;
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	isl_basic_map *bmap1, *bmap2;
+	isl_map *pair;
+
+	isl_thread_worker_lock(worker);
+	bmap1 = isl_basic_map_import(ctx, data->map->p[data->pair[2 * k]]);
+	bmap2 = isl_basic_map_import(ctx, data->map->p[data->pair[2 * k + 1]]);
+	isl_thread_worker_unlock(worker);
+
+	if (data->budget > 0)
+		isl_options_set_simplify_budget(ctx, data->budget);
+	pair = isl_map_alloc_space(isl_basic_map_get_space(bmap1), 2, 0);
+	pair = isl_map_add_basic_map(pair, bmap1);
+	pair = isl_map_add_basic_map(pair, bmap2);
+	pair = isl_map_coalesce(pair);
+	if (!pair)
+		return -1;
+	if (pair->n <= 1) {
+		isl_thread_worker_lock(worker);
+		data->res[k] = isl_map_import(data->ctx, pair);
+		isl_thread_worker_unlock(worker);
+		data->status[k] = 1;
+	}
+	isl_map_free(pair);
+
+	if (data->status[k] && !data->res[k])
+		return -1;
+	return 0;
+}
+
+/* Replace the pairs of basic maps in "map" that have been found
+ * to be coalescable in "data" by the corresponding results.
+ * The pairs are considered in order and a pair is only
+ * replaced if neither of its basic maps has already been
+ * replaced in this round.
+ * "fresh" marks the basic maps of "map" that may be coalescable
+ * with some other basic map.  It is replaced by an array marking
+ * the basic maps of the result that may be coalescable
+ * with some other basic map, i.e., the results of the replacements and
+ * the basic maps that are part of a coalescable pair
+ * that was not replaced.
+ * *changed is set if any pair was replaced.
+ */
+static __isl_give isl_map *coalesce_commit(__isl_take isl_map *map,
+	struct isl_coalesce_threads *data, int **fresh, int *changed)
+{
+	int i, j, k, n;
+	int *used, *next_fresh;
+	isl_map **fused;
+	isl_map *res;
+
+	n = map->n;
+	used = isl_calloc_array(map->ctx, int, n);
+	next_fresh = isl_calloc_array(map->ctx, int, n);
+	fused = isl_calloc_array(map->ctx, isl_map *, n);
+	if (!used || !next_fresh || !fused)
+		goto error;
+
+	for (k = 0; k < data->n_pair; ++k) {
+		i = data->pair[2 * k];
+		j = data->pair[2 * k + 1];
+		if (data->status[k] != 1)
+			continue;
+		if (used[i] || used[j]) {
+			next_fresh[i] = next_fresh[j] = 1;
+			continue;
+		}
+		used[i] = used[j] = 1;
+		fused[i] = data->res[k];
+		*changed = 1;
+	}
+
+	res = isl_map_alloc_space(isl_map_get_space(map), n, map->flags);
+	for (i = 0; res && i < n; ++i) {
+		int before = res->n;
+
+		if (fused[i]) {
+			if (fused[i]->n == 1)
+				res = isl_map_add_basic_map(res,
+				    isl_basic_map_copy(fused[i]->p[0]));
+			if (res && res->n > before)
+				next_fresh[before] = 1;
+		} else if (!used[i]) {
+			res = isl_map_add_basic_map(res,
+					isl_basic_map_copy(map->p[i]));
+			if (res && res->n > before)
+				next_fresh[before] = next_fresh[i];
+		}
+	}
+	if (res)
+		ISL_F_CLR(res, ISL_MAP_NORMALIZED);
+
+	free(*fresh);
+	*fresh = next_fresh;
+	free(used);
+	free(fused);
+	isl_map_free(map);
+	return res;
+error:
+	free(used);
+	free(next_fresh);
+	free(fused);
+	isl_map_free(map);
+	return NULL;
+}
+
+/* Construct tableaus for the basic maps of "map" with their implicit
+ * equalities and redundant constraints detected, for use by box_skip_pair.
+ */
+static struct isl_tab **coalesce_box_tabs(__isl_keep isl_map *map)
+{
+	int i;
+	struct isl_tab **tabs;
+
+	tabs = isl_calloc_array(map->ctx, struct isl_tab *, map->n);
+	if (!tabs)
+		return NULL;
+	for (i = 0; i < map->n; ++i) {
+		tabs[i] = isl_tab_from_basic_map(map->p[i], 0);
+		if (!tabs[i])
+			goto error;
+		if (!ISL_F_ISSET(map->p[i], ISL_BASIC_MAP_NO_IMPLICIT))
+			if (isl_tab_detect_implicit_equalities(tabs[i]) < 0)
+				goto error;
+		if (!ISL_F_ISSET(map->p[i], ISL_BASIC_MAP_NO_REDUNDANT))
+			if (isl_tab_detect_redundant(tabs[i]) < 0)
+				goto error;
+	}
+
+	return tabs;
+error:
+	for (i = 0; i < map->n; ++i)
+		isl_tab_free(tabs[i]);
+	free(tabs);
+	return NULL;
+}
+
+/* Collect the pairs of basic maps in "map" that involve at least
+ * one basic map that is marked in "fresh" in data->pair.
+ * If the coalesce_box_filter option is set, then pairs that
+ * can be seen not to be coalescable from the bounding boxes
+ * of the basic maps (see box_skip_pair) are skipped.
+ */
+static int coalesce_collect_pairs(__isl_keep isl_map *map, int *fresh,
+	struct isl_coalesce_threads *data)
+{
+	int i, j, n, r = 0;
+	struct isl_tab **tabs = NULL;
+	struct isl_coalesce_box *boxes = NULL;
+
+	n = map->n;
+	data->pair = isl_alloc_array(map->ctx, int, n * (n - 1));
+	if (!data->pair)
+		return -1;
+	if (map->ctx->opt->coalesce_box_filter) {
+		tabs = coalesce_box_tabs(map);
+		boxes = isl_calloc_array(map->ctx, struct isl_coalesce_box, n);
+		if (!tabs || !boxes)
+			r = -1;
+	}
+
+	data->n_pair = 0;
+	for (i = 0; r >= 0 && i < n; ++i)
+		for (j = i + 1; r >= 0 && j < n; ++j) {
+			int skip = 0;
+
+			if (!fresh[i] && !fresh[j])
+				continue;
+			if (boxes)
+				skip = box_skip_pair(map, i, j, tabs, boxes);
+			if (skip < 0)
+				r = -1;
+			if (skip) {
+				map->ctx->stats->coalesce_pairs_skipped++;
+				continue;
+			}
+			data->pair[2 * data->n_pair] = i;
+			data->pair[2 * data->n_pair + 1] = j;
+			data->n_pair++;
+		}
+
+	for (i = 0; tabs && i < n; ++i)
+		isl_tab_free(tabs[i]);
+	free(tabs);
+	boxes_free(boxes, n);
+	return r;
+}
+
+/* Perform a single round of coalesce_threads, examining all pairs
+ * of basic maps in "map" that involve at least one basic map
+ * that is marked in "fresh" (except those that can be skipped
+ * based on their bounding boxes) in parallel.
+ * "budget" is the remaining part of the simplification budget.
+ */
+static __isl_give isl_map *coalesce_round(__isl_take isl_map *map,
+	int **fresh, int budget, int *changed)
+{
+	int k;
+	struct isl_coalesce_threads data = { 0 };
+
+	data.ctx = map->ctx;
+	data.map = map;
+	data.budget = budget;
+	if (coalesce_collect_pairs(map, *fresh, &data) < 0)
+		goto error;
+	if (data.n_pair == 0) {
+		free(data.pair);
+		return map;
+	}
+
+	data.status = isl_calloc_array(map->ctx, int, data.n_pair);
+	data.res = isl_calloc_array(map->ctx, isl_map *, data.n_pair);
+	if (!data.status || !data.res)
+		goto error;
+
+	if (isl_thread_run(map->ctx, data.n_pair, &coalesce_work, &data) < 0)
+		goto error;
+	map = coalesce_commit(map, &data, fresh, changed);
+
+	if (0)
+error:
+		map = isl_map_free(map);
+	for (k = 0; data.res && k < data.n_pair; ++k)
+		isl_map_free(data.res[k]);
+	free(data.pair);
+	free(data.status);
+	free(data.res);
+	return map;
+}
+
+/* Coalesce the basic maps in "map" using several threads.
+ *
+ * The computation proceeds in rounds.  In each round, all pairs
+ * of basic maps that may be coalescable are examined in parallel,
+ * each in the isl_ctx of the thread examining the pair
+ * (see isl_thread_run).
+ * Afterwards, the coalescable pairs that do not share any basic map
+ * are replaced by their results, in order, such that the result
+ * does not depend on which thread handled which pair.
+ * In the first round, all pairs are examined.  In subsequent rounds,
+ * only those pairs that involve a basic map that was created
+ * in the previous round or that is part of a coalescable pair
+ * that was not replaced, since the other pairs have already been
+ * found not to be coalescable.
+ * The rounds stop when no more pairs are replaced.
+ *
+ * The computation started when the number of pivots was "start".
+ * The pivots performed by the threads are added to those of
+ * the isl_ctx of "map" at the end of each round, so if
+ * the simplify_budget option is set, then no further rounds
+ * are performed once the budget has been used up and
+ * the threads only receive the remaining part of the budget.
+ */
+static __isl_give isl_map *coalesce_threads(__isl_take isl_map *map,
+	long start)
+{
+	int i, changed;
+	int *fresh;
+	isl_ctx *ctx;
+
+	ctx = map->ctx;
+	fresh = isl_alloc_array(ctx, int, map->n);
+	if (!fresh)
+		return isl_map_free(map);
+	for (i = 0; i < map->n; ++i)
+		fresh[i] = 1;
+
+	do {
+		int budget = ctx->opt->simplify_budget;
+
+		if (isl_ctx_simplify_budget_exhausted(ctx, start)) {
+			ctx->stats->simplify_budget_exhausted++;
+			break;
+		}
+		if (budget > 0)
+			budget -= ctx->stats->pivots - start;
+		changed = 0;
+		map = coalesce_round(map, &fresh, budget, &changed);
+	} while (map && changed);
+
+	free(fresh);
+	return map;
+}
+
+#endif
+
 /* For each pair of basic maps in the map, check if the union of the two
  * can be represented by a single basic map.
  * If so, replace the pair by the single basic map and start over.
@@ -1662,12 +2257,20 @@ error:
  * This means that we have to call isl_basic_map_gauss at the end
  * of the computation to ensure that the basic maps are not left
  * in an unexpected state.
+ *
+ * If the threads option is set to a value greater than one
+ * and isl has been built with thread support, then the pairs
+ * are coalesced by coalesce_threads instead and the tableaus
+ * are only used to simplify the remaining basic maps.
  */
-struct isl_map *isl_map_coalesce(struct isl_map *map)
+static struct isl_map *map_coalesce(struct isl_map *map)
 {
 	int i;
+	int pairs = 1;
 	unsigned n;
+	long start;
 	struct isl_tab **tabs = NULL;
+	struct isl_coalesce_box *boxes = NULL;
 
 	map = isl_map_remove_empty_parts(map);
 	if (!map)
@@ -1682,6 +2285,16 @@ struct isl_map *isl_map_coalesce(struct isl_map *map)
 	if (!map)
 		return NULL;
 
+	start = map->ctx->stats->pivots;
+#ifdef HAVE_PTHREAD
+	if (map->ctx->opt->threads > 1 && map->n > 2) {
+		map = coalesce_threads(map, start);
+		pairs = 0;
+		if (!map || map->n == 0)
+			return map;
+	}
+#endif
+
 	tabs = isl_calloc_array(map->ctx, struct isl_tab *, map->n);
 	if (!tabs)
 		goto error;
@@ -1706,7 +2319,14 @@ struct isl_map *isl_map_coalesce(struct isl_map *map)
 		if (tabs[i]->empty)
 			drop(map, i, tabs);
 
-	map = coalesce(map, tabs);
+	if (pairs && map->ctx->opt->coalesce_box_filter) {
+		boxes = isl_calloc_array(map->ctx, struct isl_coalesce_box, n);
+		if (!boxes)
+			goto error;
+	}
+
+	if (pairs)
+		map = coalesce(map, tabs, boxes, start);
 
 	if (map)
 		for (i = 0; i < map->n; ++i) {
@@ -1724,6 +2344,7 @@ struct isl_map *isl_map_coalesce(struct isl_map *map)
 		isl_tab_free(tabs[i]);
 
 	free(tabs);
+	boxes_free(boxes, n);
 
 	return map;
 error:
@@ -1731,10 +2352,34 @@ error:
 		for (i = 0; i < n; ++i)
 			isl_tab_free(tabs[i]);
 	free(tabs);
+	boxes_free(boxes, n);
 	isl_map_free(map);
 	return NULL;
 }
 
+/* Coalesce "map" (see map_coalesce).
+ * The tableaus and basic maps that are created and destroyed
+ * during the computation are kept in the block cache for reuse
+ * until the computation is finished.
+ */
+struct isl_map *isl_map_coalesce(struct isl_map *map)
+{
+	isl_ctx *ctx = isl_map_get_ctx(map);
+	struct isl_profile_node *prof;
+
+	prof = isl_profile_enter(ctx, "isl_map_coalesce");
+	if (map)
+		isl_trace_begin(ctx, "coalesce", "\"dim\": %d, \"n\": %d",
+				isl_map_dim(map, isl_dim_all), map->n);
+	isl_blk_scope_enter(ctx);
+	map = map_coalesce(map);
+	isl_blk_scope_leave(ctx);
+	isl_trace_end(ctx, "coalesce");
+	isl_profile_leave(ctx, prof);
+
+	return map;
+}
+
 /* For each pair of basic sets in the set, check if the union of the two
  * can be represented by a single basic set.
  * If so, replace the pair by the single basic set and start over.
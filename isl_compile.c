@@ -0,0 +1,744 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <math.h>
+#include <isl_ctx_private.h>
+#include <isl_map_private.h>
+#include <isl_mat_private.h>
+#include <isl_seq.h>
+#include <isl_compile_private.h>
+
+struct isl_compiled_domain *isl_compiled_domain_alloc(isl_ctx *ctx, int n_in)
+{
+	struct isl_compiled_domain *dom;
+
+	dom = isl_calloc_type(ctx, struct isl_compiled_domain);
+	if (!dom)
+		return NULL;
+
+	dom->ctx = ctx;
+	isl_ctx_ref(ctx);
+	dom->n_in = n_in;
+	dom->div_mat = isl_mat_alloc(ctx, 0, 2 + n_in);
+	dom->con_mat = isl_mat_alloc(ctx, 0, 1 + n_in);
+	if (!dom->div_mat || !dom->con_mat)
+		return isl_compiled_domain_free(dom);
+
+	return dom;
+}
+
+struct isl_compiled_domain *isl_compiled_domain_free(
+	struct isl_compiled_domain *dom)
+{
+	if (!dom)
+		return NULL;
+
+	isl_ctx_deref(dom->ctx);
+	free(dom->div);
+	free(dom->con);
+	free(dom->bset);
+	free(dom->node);
+	free(dom->leaf);
+	isl_mat_free(dom->div_mat);
+	isl_mat_free(dom->con_mat);
+	free(dom);
+
+	return NULL;
+}
+
+/* Return the position in dom->div_mat of the integer division
+ * with (local) description "row" of length "len" = 2 + n_in + n_local,
+ * where the local integer divisions are mapped to positions
+ * in dom->div_mat by "map".  Add the integer division to dom->div_mat
+ * if it does not appear there yet.
+ */
+static int add_div(struct isl_compiled_domain *dom, isl_int *row, int len,
+	int *map)
+{
+	int i, n_in, n_div, n_col;
+	isl_mat *div = dom->div_mat;
+
+	n_in = dom->n_in;
+	n_div = div->n_row;
+	n_col = div->n_col;
+
+	div = isl_mat_add_rows(div, 1);
+	div = isl_mat_add_zero_cols(div, 1);
+	dom->div_mat = div;
+	if (!div)
+		return -1;
+
+	isl_seq_clr(div->row[n_div], div->n_col);
+	isl_seq_cpy(div->row[n_div], row, 2 + n_in);
+	for (i = 2 + n_in; i < len; ++i) {
+		if (isl_int_is_zero(row[i]))
+			continue;
+		isl_int_set(div->row[n_div][2 + n_in + map[i - 2 - n_in]],
+			    row[i]);
+	}
+
+	for (i = 0; i < n_div; ++i)
+		if (isl_seq_eq(div->row[i], div->row[n_div], div->n_col))
+			break;
+	if (i < n_div) {
+		dom->div_mat = isl_mat_drop_rows(dom->div_mat, n_div, 1);
+		dom->div_mat = isl_mat_drop_cols(dom->div_mat, n_col, 1);
+		return dom->div_mat ? i : -1;
+	}
+
+	return n_div;
+}
+
+/* Map the integer divisions in the rows of "div" to positions
+ * in the integer divisions of "dom", storing the result in "map".
+ * Each row of "div" has the same layout as the rows of dom->div_mat,
+ * except that the coefficients of the integer divisions refer
+ * to the (earlier) rows of "div".
+ */
+int isl_compiled_domain_map_divs(struct isl_compiled_domain *dom,
+	__isl_keep isl_mat *div, int *map)
+{
+	int i;
+
+	if (!dom || !div)
+		return -1;
+
+	for (i = 0; i < div->n_row; ++i) {
+		if (isl_int_is_zero(div->row[i][0]))
+			isl_die(dom->ctx, isl_error_invalid,
+				"unknown integer division", return -1);
+		map[i] = add_div(dom, div->row[i], div->n_col, map);
+		if (map[i] < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/* Add zero columns to "mat" such that it has "n_fixed" columns
+ * in front of one column for each of the integer divisions of "dom"
+ * collected so far.
+ */
+__isl_give isl_mat *isl_compiled_domain_extend(struct isl_compiled_domain *dom,
+	__isl_take isl_mat *mat, int n_fixed)
+{
+	int extra;
+
+	if (!dom || !mat)
+		return isl_mat_free(mat);
+
+	extra = n_fixed + dom->div_mat->n_row - mat->n_col;
+	if (extra <= 0)
+		return mat;
+	return isl_mat_add_zero_cols(mat, extra);
+}
+
+/* Add the basic set "bset" to "dom".
+ */
+static int add_bset(__isl_take isl_basic_set *bset, void *user)
+{
+	struct isl_compiled_domain *dom = user;
+	struct isl_compiled_bset *cb;
+	isl_mat *div;
+	int *map = NULL;
+	int i, j, n, n_in, first;
+
+	if (!bset)
+		return -1;
+
+	n_in = dom->n_in;
+	if (dom->n_bset >= dom->size_bset) {
+		dom->size_bset = 2 * dom->size_bset + 4;
+		dom->bset = isl_realloc_array(dom->ctx, dom->bset,
+				struct isl_compiled_bset, dom->size_bset);
+		if (!dom->bset)
+			goto error;
+	}
+
+	map = isl_alloc_array(dom->ctx, int, bset->n_div);
+	div = isl_basic_set_get_divs(bset);
+	if ((bset->n_div && !map) ||
+	    isl_compiled_domain_map_divs(dom, div, map) < 0) {
+		isl_mat_free(div);
+		goto error;
+	}
+	isl_mat_free(div);
+
+	n = bset->n_eq + bset->n_ineq;
+	first = dom->con_mat->n_row;
+	dom->con_mat = isl_compiled_domain_extend(dom, dom->con_mat, 1 + n_in);
+	dom->con_mat = isl_mat_add_zero_rows(dom->con_mat, n);
+	if (!dom->con_mat)
+		goto error;
+	for (i = 0; i < n; ++i) {
+		isl_int *c = i < bset->n_eq ? bset->eq[i] :
+					bset->ineq[i - bset->n_eq];
+		isl_int *row = dom->con_mat->row[first + i];
+
+		isl_seq_cpy(row, c, 1 + n_in);
+		for (j = 0; j < bset->n_div; ++j)
+			isl_int_set(row[1 + n_in + map[j]], c[1 + n_in + j]);
+	}
+
+	cb = &dom->bset[dom->n_bset++];
+	cb->first = first;
+	cb->n_eq = bset->n_eq;
+	cb->n_ineq = bset->n_ineq;
+	cb->set = dom->n_set;
+
+	free(map);
+	isl_basic_set_free(bset);
+	return 0;
+error:
+	free(map);
+	isl_basic_set_free(bset);
+	return -1;
+}
+
+/* Add the basic sets of "set" to "dom", after computing
+ * explicit representations for all its integer divisions.
+ * The basic sets are appended to dom->bset and are marked
+ * as belonging to set dom->n_set, which is incremented
+ * even if "set" is empty.
+ */
+int isl_compiled_domain_add_set(struct isl_compiled_domain *dom,
+	__isl_take isl_set *set)
+{
+	int r;
+
+	if (!dom)
+		goto error;
+
+	set = isl_set_compute_divs(set);
+	r = isl_set_foreach_basic_set(set, &add_bset, dom);
+	isl_set_free(set);
+	dom->n_set++;
+
+	return r;
+error:
+	isl_set_free(set);
+	return -1;
+}
+
+/* Convert "mat" to a row-major array of int64_t, failing if
+ * any of the elements does not fit in 64 bits.
+ */
+int64_t *isl_compiled_mat_to_int64(__isl_keep isl_mat *mat)
+{
+	int i, j;
+	int64_t *a;
+
+	if (!mat)
+		return NULL;
+
+	a = isl_alloc_array(mat->ctx, int64_t, mat->n_row * mat->n_col + 1);
+	if (!a)
+		return NULL;
+	for (i = 0; i < mat->n_row; ++i)
+		for (j = 0; j < mat->n_col; ++j) {
+			if (!isl_int_fits_slong(mat->row[i][j]))
+				isl_die(mat->ctx, isl_error_unsupported,
+					"coefficient does not fit in 64 bits",
+					goto error);
+			a[i * mat->n_col + j] = isl_int_get_si(mat->row[i][j]);
+		}
+
+	return a;
+error:
+	free(a);
+	return NULL;
+}
+
+/* The maximal depth of the decision tree and the number of basic sets
+ * below which no further splitting is attempted.
+ */
+#define ISL_COMPILED_MAX_DEPTH	16
+#define ISL_COMPILED_LEAF_SIZE	2
+
+/* Add a node to the decision tree of "dom" and return its index.
+ */
+static int add_node(struct isl_compiled_domain *dom)
+{
+	if (dom->n_node >= dom->size_node) {
+		dom->size_node = 2 * dom->size_node + 8;
+		dom->node = isl_realloc_array(dom->ctx, dom->node,
+				struct isl_compiled_node, dom->size_node);
+		if (!dom->node)
+			return -1;
+	}
+
+	return dom->n_node++;
+}
+
+/* Turn node "k" of the decision tree of "dom" into a leaf
+ * containing the "n" basic sets in "cand".
+ */
+static int make_leaf(struct isl_compiled_domain *dom, int k,
+	int *cand, int n)
+{
+	int i;
+
+	if (dom->n_leaf + n > dom->size_leaf) {
+		dom->size_leaf = 2 * dom->size_leaf + n;
+		dom->leaf = isl_realloc_array(dom->ctx, dom->leaf, int,
+						dom->size_leaf);
+		if (!dom->leaf)
+			return -1;
+	}
+
+	dom->node[k].con = -1;
+	dom->node[k].first = dom->n_leaf;
+	dom->node[k].n = n;
+	for (i = 0; i < n; ++i)
+		dom->leaf[dom->n_leaf++] = cand[i];
+
+	return 0;
+}
+
+/* Is the linear part of constraint row "a" of "dom" equal to
+ * that of row "b" (if "sign" is 1) or to its opposite (if "sign" is -1)?
+ */
+static int same_direction(struct isl_compiled_domain *dom, int a, int b,
+	int sign)
+{
+	int k, len = 1 + dom->n_in + dom->n_div;
+	int64_t *ra = dom->con + a * len;
+	int64_t *rb = dom->con + b * len;
+
+	for (k = 1; k < len; ++k) {
+		if (sign > 0 && ra[k] != rb[k])
+			return 0;
+		if (sign < 0 && (rb[k] == INT64_MIN || ra[k] != -rb[k]))
+			return 0;
+	}
+	return 1;
+}
+
+/* Could basic set "b" of "dom" contain points that satisfy
+ * constraint row "r" (if "sat" is set) or that violate it
+ * (if "sat" is not set)?
+ *
+ * Let L x + c >= 0 be the constraint.  Collect the bounds on L x
+ * imposed by the constraints of "b" with the same linear part
+ * or its opposite.  The constraint can only be satisfied if
+ * the upper bound is at least -c and it can only be violated
+ * if the lower bound is at most -c - 1.
+ */
+static int may_satisfy(struct isl_compiled_domain *dom, int b, int r, int sat)
+{
+	int j, len = 1 + dom->n_in + dom->n_div;
+	struct isl_compiled_bset *cb = &dom->bset[b];
+	int64_t c = dom->con[r * len];
+
+	for (j = 0; j < cb->n_eq + cb->n_ineq; ++j) {
+		int s = cb->first + j;
+		int64_t d = dom->con[s * len];
+		int eq = j < cb->n_eq;
+
+		if ((sat || eq) && same_direction(dom, s, r, -1)) {
+			if (sat && d < -c)
+				return 0;
+			if (!sat && eq && d > -c - 1)
+				return 0;
+		}
+		if ((!sat || eq) && same_direction(dom, s, r, 1)) {
+			if (!sat && d <= c)
+				return 0;
+			if (sat && eq && d > c)
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* Collect in "res" the elements of the "n" basic sets in "cand"
+ * that may contain points that satisfy constraint row "r"
+ * (if "sat" is set) or that violate it (if "sat" is not set)
+ * and return the number of such basic sets.
+ */
+static int filter(struct isl_compiled_domain *dom, int *cand, int n,
+	int r, int sat, int *res)
+{
+	int i, n_res = 0;
+
+	for (i = 0; i < n; ++i)
+		if (may_satisfy(dom, cand[i], r, sat))
+			res[n_res++] = cand[i];
+
+	return n_res;
+}
+
+/* Find a constraint of one of the "n" basic sets in "cand" that
+ * splits "cand" best, i.e., such that the largest of the sets
+ * of basic sets that may contain points satisfying or violating
+ * the constraint is as small as possible.
+ * Only constraints that reduce the number of basic sets on both sides
+ * are considered.  Return -1 if there is no such constraint.
+ * "tmp" is scratch space for n elements.
+ */
+static int best_split(struct isl_compiled_domain *dom, int *cand, int n,
+	int *tmp)
+{
+	int i, j;
+	int best = -1, best_max = n, best_sum = 2 * n;
+	int len = 1 + dom->n_in + dom->n_div;
+
+	for (i = 0; i < n; ++i) {
+		struct isl_compiled_bset *cb = &dom->bset[cand[i]];
+
+		for (j = 0; j < cb->n_eq + cb->n_ineq; ++j) {
+			int r = cb->first + j;
+			int n_sat, n_unsat, max;
+
+			if (dom->con[r * len] == INT64_MIN)
+				continue;
+			n_sat = filter(dom, cand, n, r, 1, tmp);
+			n_unsat = filter(dom, cand, n, r, 0, tmp);
+			max = n_sat > n_unsat ? n_sat : n_unsat;
+			if (max > best_max)
+				continue;
+			if (max == best_max && n_sat + n_unsat >= best_sum)
+				continue;
+			if (max >= n)
+				continue;
+			best = r;
+			best_max = max;
+			best_sum = n_sat + n_unsat;
+		}
+	}
+
+	return best;
+}
+
+/* Construct a decision tree for the "n" basic sets in "cand"
+ * at depth "depth" and return the index of its root node.
+ * The node is turned into a leaf if there are only few basic sets left,
+ * if the maximal depth has been reached or if none of the constraints
+ * separates the basic sets.
+ */
+static int build_tree(struct isl_compiled_domain *dom, int *cand, int n,
+	int depth)
+{
+	int k, r, s, child;
+	int *sub;
+
+	k = add_node(dom);
+	if (k < 0)
+		return -1;
+	if (n <= ISL_COMPILED_LEAF_SIZE || depth >= ISL_COMPILED_MAX_DEPTH)
+		return make_leaf(dom, k, cand, n) < 0 ? -1 : k;
+
+	sub = isl_alloc_array(dom->ctx, int, n);
+	if (!sub)
+		return -1;
+	r = best_split(dom, cand, n, sub);
+	if (r < 0) {
+		free(sub);
+		return make_leaf(dom, k, cand, n) < 0 ? -1 : k;
+	}
+
+	dom->node[k].con = r;
+	for (s = 0; s < 2; ++s) {
+		int n_sub = filter(dom, cand, n, r, s, sub);
+		child = build_tree(dom, sub, n_sub, depth + 1);
+		if (child < 0)
+			break;
+		dom->node[k].next[s] = child;
+	}
+	free(sub);
+
+	return child < 0 ? -1 : k;
+}
+
+/* Construct a decision tree for locating the basic sets of "dom"
+ * that may contain a given point, if there are enough basic sets
+ * for this to be worthwhile.
+ */
+static int build_decision_tree(struct isl_compiled_domain *dom)
+{
+	int i, r;
+	int *cand;
+
+	if (dom->n_bset <= ISL_COMPILED_LEAF_SIZE)
+		return 0;
+
+	cand = isl_alloc_array(dom->ctx, int, dom->n_bset);
+	if (!cand)
+		return -1;
+	for (i = 0; i < dom->n_bset; ++i)
+		cand[i] = i;
+	r = build_tree(dom, cand, dom->n_bset, 0);
+	free(cand);
+
+	return r < 0 ? -1 : 0;
+}
+
+/* Convert the integer divisions and constraints collected in "dom"
+ * to the final int64_t tables, now that the total number
+ * of integer divisions is known, and construct a decision tree
+ * for locating the basic sets that contain a given point.
+ */
+int isl_compiled_domain_finalize(struct isl_compiled_domain *dom)
+{
+	if (!dom)
+		return -1;
+
+	dom->con_mat = isl_compiled_domain_extend(dom, dom->con_mat,
+						1 + dom->n_in);
+	if (!dom->con_mat)
+		return -1;
+
+	dom->n_div = dom->div_mat->n_row;
+	dom->div = isl_compiled_mat_to_int64(dom->div_mat);
+	dom->n_con = dom->con_mat->n_row;
+	dom->con = isl_compiled_mat_to_int64(dom->con_mat);
+	if (!dom->div || !dom->con)
+		return -1;
+
+	dom->div_mat = isl_mat_free(dom->div_mat);
+	dom->con_mat = isl_mat_free(dom->con_mat);
+
+	return build_decision_tree(dom);
+}
+
+/* Set "*res" to "a" + "b" * "c", returning -1 if the computation
+ * overflows.
+ */
+static int add_mul(isl_ctx *ctx, int64_t a, int64_t b, int64_t c,
+	int64_t *res)
+{
+	int64_t p;
+
+	if (b == 0 || c == 0) {
+		*res = a;
+		return 0;
+	}
+	if (b > 0 ? (c > 0 ? b > INT64_MAX / c : c < INT64_MIN / b) :
+		    (c > 0 ? b < INT64_MIN / c : c < INT64_MAX / b))
+		goto overflow;
+	p = b * c;
+	if ((p > 0 && a > INT64_MAX - p) || (p < 0 && a < INT64_MIN - p))
+		goto overflow;
+	*res = a + p;
+	return 0;
+overflow:
+	isl_die(ctx, isl_error_unsupported,
+		"overflow in 64 bit evaluation", return -1);
+}
+
+/* Set "*res" to row[0] + sum_{k < n} row[1 + k] * val[k],
+ * returning -1 if the computation overflows.
+ */
+int isl_compiled_affine_int64(isl_ctx *ctx, const int64_t *row,
+	const int64_t *val, int n, int64_t *res)
+{
+	int k;
+	int64_t v = row[0];
+
+	for (k = 0; k < n; ++k)
+		if (add_mul(ctx, v, row[1 + k], val[k], &v) < 0)
+			return -1;
+
+	*res = v;
+	return 0;
+}
+
+/* Return floor(a/b), with b positive.
+ */
+static int64_t fdiv_q(int64_t a, int64_t b)
+{
+	int64_t q = a / b;
+
+	if (a % b != 0 && a < 0)
+		q--;
+	return q;
+}
+
+/* Copy the dom->n_in inputs "pnt" to "val" and compute the values
+ * of the integer divisions of "dom" in the subsequent elements of "val".
+ * Return -1 if any of the computations overflows.
+ */
+int isl_compiled_domain_eval_divs_int64(struct isl_compiled_domain *dom,
+	const int64_t *pnt, int64_t *val)
+{
+	int j, len;
+
+	for (j = 0; j < dom->n_in; ++j)
+		val[j] = pnt[j];
+	len = 2 + dom->n_in + dom->n_div;
+	for (j = 0; j < dom->n_div; ++j) {
+		int64_t *row = dom->div + j * len;
+		int64_t v;
+
+		if (isl_compiled_affine_int64(dom->ctx, row + 1, val,
+						dom->n_in + j, &v) < 0)
+			return -1;
+		val[dom->n_in + j] = fdiv_q(v, row[0]);
+	}
+
+	return 0;
+}
+
+/* Copy the dom->n_in inputs "pnt" to "val" and compute the values
+ * of the integer divisions of "dom" in the subsequent elements of "val",
+ * using floating point arithmetic.
+ */
+void isl_compiled_domain_eval_divs_double(struct isl_compiled_domain *dom,
+	const double *pnt, double *val)
+{
+	int j, k, len;
+
+	for (j = 0; j < dom->n_in; ++j)
+		val[j] = pnt[j];
+	len = 2 + dom->n_in + dom->n_div;
+	for (j = 0; j < dom->n_div; ++j) {
+		int64_t *row = dom->div + j * len;
+		double v = row[1];
+
+		for (k = 0; k < dom->n_in + j; ++k)
+			v += row[2 + k] * val[k];
+		val[dom->n_in + j] = floor(v / row[0]);
+	}
+}
+
+/* Does basic set "b" of "dom" contain the point with values "val"
+ * (as computed by isl_compiled_domain_eval_divs_int64)?
+ * Return -1 if any of the computations overflows.
+ */
+static int bset_contains_int64(struct isl_compiled_domain *dom, int b,
+	const int64_t *val)
+{
+	int j, len, n_val;
+	struct isl_compiled_bset *cb = &dom->bset[b];
+
+	n_val = dom->n_in + dom->n_div;
+	len = 1 + n_val;
+	for (j = 0; j < cb->n_eq + cb->n_ineq; ++j) {
+		int64_t v;
+
+		if (isl_compiled_affine_int64(dom->ctx,
+			    dom->con + (cb->first + j) * len,
+			    val, n_val, &v) < 0)
+			return -1;
+		if (j < cb->n_eq ? v != 0 : v < 0)
+			return 0;
+	}
+
+	return 1;
+}
+
+/* Set "*set" to the index of the first set of "dom" that contains
+ * the point with values "val" (as computed by
+ * isl_compiled_domain_eval_divs_int64) or to -1 if there is no such set.
+ * If there is a decision tree, then only the basic sets in the leaf
+ * reached by the point need to be checked.
+ * Return -1 if any of the computations overflows.
+ */
+int isl_compiled_domain_locate_int64(struct isl_compiled_domain *dom,
+	const int64_t *val, int *set)
+{
+	int i, k, n_val, first, n;
+	int *leaf = NULL;
+
+	n_val = dom->n_in + dom->n_div;
+	first = 0;
+	n = dom->n_bset;
+	if (dom->n_node > 0) {
+		for (k = 0; dom->node[k].con >= 0; ) {
+			int64_t v;
+
+			if (isl_compiled_affine_int64(dom->ctx,
+				    dom->con + dom->node[k].con * (1 + n_val),
+				    val, n_val, &v) < 0)
+				return -1;
+			k = dom->node[k].next[v >= 0];
+		}
+		leaf = dom->leaf;
+		first = dom->node[k].first;
+		n = dom->node[k].n;
+	}
+
+	*set = -1;
+	for (i = first; i < first + n; ++i) {
+		int b = leaf ? leaf[i] : i;
+		int in = bset_contains_int64(dom, b, val);
+
+		if (in < 0)
+			return -1;
+		if (in) {
+			*set = dom->bset[b].set;
+			break;
+		}
+	}
+
+	return 0;
+}
+
+/* Evaluate constraint row "r" of "dom" at the values "val"
+ * using floating point arithmetic.
+ */
+static double eval_con_double(struct isl_compiled_domain *dom, int r,
+	const double *val)
+{
+	int k, n_val = dom->n_in + dom->n_div;
+	int64_t *row = dom->con + r * (1 + n_val);
+	double v = row[0];
+
+	for (k = 0; k < n_val; ++k)
+		v += row[1 + k] * val[k];
+
+	return v;
+}
+
+/* Does basic set "b" of "dom" contain the point with values "val"
+ * (as computed by isl_compiled_domain_eval_divs_double)?
+ */
+static int bset_contains_double(struct isl_compiled_domain *dom, int b,
+	const double *val)
+{
+	int j;
+	struct isl_compiled_bset *cb = &dom->bset[b];
+
+	for (j = 0; j < cb->n_eq + cb->n_ineq; ++j) {
+		double v = eval_con_double(dom, cb->first + j, val);
+
+		if (j < cb->n_eq ? v != 0 : v < 0)
+			return 0;
+	}
+
+	return 1;
+}
+
+/* Return the index of the first set of "dom" that contains
+ * the point with values "val" (as computed by
+ * isl_compiled_domain_eval_divs_double) or -1 if there is no such set.
+ */
+int isl_compiled_domain_locate_double(struct isl_compiled_domain *dom,
+	const double *val)
+{
+	int i, k, first, n;
+	int *leaf = NULL;
+
+	first = 0;
+	n = dom->n_bset;
+	if (dom->n_node > 0) {
+		for (k = 0; dom->node[k].con >= 0; ) {
+			double v = eval_con_double(dom, dom->node[k].con, val);
+			k = dom->node[k].next[v >= 0];
+		}
+		leaf = dom->leaf;
+		first = dom->node[k].first;
+		n = dom->node[k].n;
+	}
+
+	for (i = first; i < first + n; ++i) {
+		int b = leaf ? leaf[i] : i;
+
+		if (bset_contains_double(dom, b, val))
+			return dom->bset[b].set;
+	}
+
+	return -1;
+}
@@ -0,0 +1,115 @@
+#ifndef ISL_COMPILE_PRIVATE_H
+#define ISL_COMPILE_PRIVATE_H
+
+#include <isl/ctx.h>
+#include <isl/mat.h>
+#include <isl/set.h>
+#include <isl/stdint.h>
+
+/* A basic set of a compiled domain.
+ * The constraints are stored in rows "first" up to "first" + "n_eq"
+ * + "n_ineq" of the constraint table, with the equalities first.
+ * "set" is the index of the set to which the basic set belongs.
+ */
+struct isl_compiled_bset {
+	int first;
+	int n_eq;
+	int n_ineq;
+	int set;
+};
+
+/* A node of the decision tree of a compiled domain.
+ * If "con" is non-negative, then the node tests whether constraint
+ * row "con" is satisfied (as an inequality) and continues
+ * in node next[1] if it is and in node next[0] if it is not.
+ * Otherwise, the node is a leaf and the basic sets that may contain
+ * a point that reaches the leaf are those at positions "first" up to
+ * "first" + "n" of the "leaf" array of the compiled domain.
+ */
+struct isl_compiled_node {
+	int con;
+	int next[2];
+	int first;
+	int n;
+};
+
+/* A collection of sets compiled into flat tables
+ * for fast membership tests.
+ *
+ * "n_in" is the number of inputs, i.e., the parameters followed
+ * by the set variables.
+ * The values used during evaluation consist of the "n_in" inputs
+ * followed by the "n_div" integer divisions.
+ *
+ * "div" contains "n_div" rows of length 2 + n_in + n_div,
+ * each holding the denominator, the constant term and the coefficients
+ * of the inputs and of the (earlier) integer divisions.
+ * "con" contains "n_con" rows of length 1 + n_in + n_div,
+ * each holding the constant term and the coefficients of a constraint.
+ *
+ * "n_set" is the number of sets that have been added.
+ *
+ * If "n_node" is not zero, then "node" contains a decision tree
+ * with root node 0 that is used to locate the basic sets that
+ * may contain a given point.  The leaves refer to the elements
+ * of "leaf", which are indices of basic sets, in increasing order
+ * within each leaf.
+ *
+ * During construction, the integer divisions and the constraints
+ * are kept in "div_mat" and "con_mat" instead.
+ */
+struct isl_compiled_domain {
+	isl_ctx *ctx;
+
+	int n_in;
+
+	int n_div;
+	int64_t *div;
+
+	int n_con;
+	int64_t *con;
+
+	int n_bset;
+	int size_bset;
+	struct isl_compiled_bset *bset;
+
+	int n_set;
+
+	int n_node;
+	int size_node;
+	struct isl_compiled_node *node;
+	int n_leaf;
+	int size_leaf;
+	int *leaf;
+
+	isl_mat *div_mat;
+	isl_mat *con_mat;
+};
+
+struct isl_compiled_domain *isl_compiled_domain_alloc(isl_ctx *ctx, int n_in);
+struct isl_compiled_domain *isl_compiled_domain_free(
+	struct isl_compiled_domain *dom);
+
+int isl_compiled_domain_map_divs(struct isl_compiled_domain *dom,
+	__isl_keep isl_mat *div, int *map);
+int isl_compiled_domain_add_set(struct isl_compiled_domain *dom,
+	__isl_take isl_set *set);
+__isl_give isl_mat *isl_compiled_domain_extend(struct isl_compiled_domain *dom,
+	__isl_take isl_mat *mat, int n_fixed);
+int isl_compiled_domain_finalize(struct isl_compiled_domain *dom);
+
+int64_t *isl_compiled_mat_to_int64(__isl_keep isl_mat *mat);
+
+int isl_compiled_affine_int64(isl_ctx *ctx, const int64_t *row,
+	const int64_t *val, int n, int64_t *res);
+
+int isl_compiled_domain_eval_divs_int64(struct isl_compiled_domain *dom,
+	const int64_t *pnt, int64_t *val);
+void isl_compiled_domain_eval_divs_double(struct isl_compiled_domain *dom,
+	const double *pnt, double *val);
+int isl_compiled_domain_locate_int64(struct isl_compiled_domain *dom,
+	const int64_t *val, int *set);
+int isl_compiled_domain_locate_double(struct isl_compiled_domain *dom,
+	const double *val);
+
+#endif
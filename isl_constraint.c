@@ -16,6 +16,7 @@
 #include <isl_seq.h>
 #include <isl_aff_private.h>
 #include <isl_local_space_private.h>
+#include <isl_mat_private.h>
 #include <isl_val_private.h>
 #include <isl_vec_private.h>
 #include <isl/deprecated/constraint_int.h>
@@ -84,6 +85,37 @@ error:
 	return NULL;
 }
 
+/* Return a copy of "constraint" that is allocated in "ctx".
+ */
+__isl_give isl_constraint *isl_constraint_import(isl_ctx *ctx,
+	__isl_keep isl_constraint *constraint)
+{
+	int i;
+	isl_local_space *ls;
+	isl_vec *v;
+
+	if (!constraint)
+		return NULL;
+	if (isl_constraint_get_ctx(constraint) == ctx)
+		return isl_constraint_copy(constraint);
+
+	ls = isl_local_space_alloc(isl_space_import(ctx, constraint->ls->dim),
+				    constraint->ls->div->n_row);
+	v = isl_vec_alloc(ctx, constraint->v->size);
+	if (!ls || !v)
+		goto error;
+	for (i = 0; i < constraint->ls->div->n_row; ++i)
+		isl_seq_cpy(ls->div->row[i], constraint->ls->div->row[i],
+				constraint->ls->div->n_col);
+	isl_seq_cpy(v->el, constraint->v->el, v->size);
+
+	return isl_constraint_alloc_vec(constraint->eq, ls, v);
+error:
+	isl_local_space_free(ls);
+	isl_vec_free(v);
+	return NULL;
+}
+
 __isl_give isl_constraint *isl_constraint_alloc(int eq,
 	__isl_take isl_local_space *ls)
 {
@@ -249,6 +281,77 @@ int isl_basic_set_foreach_constraint(__isl_keep isl_basic_set *bset,
 	return isl_basic_map_foreach_constraint((isl_basic_map *)bset, fn, user);
 }
 
+/* Update "c" to represent the constraint "row" in local space "ls",
+ * where "eq" indicates whether it is an equality.
+ * If "c" is NULL or if "c" or its coefficients are referenced
+ * from elsewhere, then a fresh constraint is created instead.
+ */
+static __isl_give isl_constraint *set_view(__isl_take isl_constraint *c,
+	__isl_keep isl_local_space *ls, int eq, isl_int *row)
+{
+	if (c && (c->ref != 1 || c->v->ref != 1 || c->ls != ls))
+		c = isl_constraint_free(c);
+	if (!c)
+		c = isl_constraint_alloc(eq, isl_local_space_copy(ls));
+	if (!c)
+		return NULL;
+
+	c->eq = eq;
+	isl_seq_cpy(c->v->el, row, c->v->size);
+
+	return c;
+}
+
+/* Call "fn" on each constraint of "bmap".
+ *
+ * In contrast to isl_basic_map_foreach_constraint, the constraint
+ * is only borrowed by "fn" and is only valid during the call.
+ * This allows the same constraint object, along with a single
+ * local space, to be reused for all constraints,
+ * such that no memory needs to be allocated for each constraint.
+ * If "fn" does keep a reference to the constraint (or to anything
+ * that shares its coefficients), then a fresh constraint
+ * is created for the next call.
+ */
+int isl_basic_map_foreach_constraint_view(__isl_keep isl_basic_map *bmap,
+	int (*fn)(__isl_keep isl_constraint *c, void *user), void *user)
+{
+	int i;
+	int r = 0;
+	isl_local_space *ls;
+	isl_constraint *c = NULL;
+
+	if (!bmap)
+		return -1;
+
+	isl_assert(bmap->ctx, ISL_F_ISSET(bmap, ISL_BASIC_MAP_FINAL),
+			return -1);
+
+	ls = isl_basic_map_get_local_space(bmap);
+	if (!ls)
+		return -1;
+
+	for (i = 0; r >= 0 && i < bmap->n_eq + bmap->n_ineq; ++i) {
+		if (i < bmap->n_eq)
+			c = set_view(c, ls, 1, bmap->eq[i]);
+		else
+			c = set_view(c, ls, 0, bmap->ineq[i - bmap->n_eq]);
+		if (!c || fn(c, user) < 0)
+			r = -1;
+	}
+
+	isl_constraint_free(c);
+	isl_local_space_free(ls);
+
+	return r;
+}
+
+int isl_basic_set_foreach_constraint_view(__isl_keep isl_basic_set *bset,
+	int (*fn)(__isl_keep isl_constraint *c, void *user), void *user)
+{
+	return isl_basic_map_foreach_constraint_view(bset, fn, user);
+}
+
 /* Add the constraint to the list that "user" points to, if it is not
  * a div constraint.
  */
@@ -994,8 +1097,6 @@ static __isl_give isl_basic_set *set_smallest_upper_bound(
 	int j;
 
 	context = isl_basic_set_copy(context);
-	context = isl_basic_set_cow(context);
-
 	context = isl_basic_set_extend_constraints(context, 0, n_upper - 1);
 
 	for (j = 0; j < bset->n_ineq; ++j) {
@@ -1024,8 +1125,6 @@ static __isl_give isl_basic_set *set_largest_lower_bound(
 	int j;
 
 	context = isl_basic_set_copy(context);
-	context = isl_basic_set_cow(context);
-
 	context = isl_basic_set_extend_constraints(context, 0, n_lower - 1);
 
 	for (j = 0; j < bset->n_ineq; ++j) {
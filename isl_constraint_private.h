@@ -21,6 +21,9 @@ struct isl_constraint {
 struct isl_constraint *isl_basic_set_constraint(struct isl_basic_set *bset,
 	isl_int **line);
 
+__isl_give isl_constraint *isl_constraint_import(isl_ctx *ctx,
+	__isl_keep isl_constraint *constraint);
+
 void isl_constraint_get_coefficient(__isl_keep isl_constraint *constraint,
 	enum isl_dim_type type, int pos, isl_int *v);
 __isl_give isl_constraint *isl_constraint_set_constant(
@@ -10,6 +10,7 @@
  * B.P. 105 - 78153 Le Chesnay, France
  */
 
+#include <limits.h>
 #include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl_lp_private.h>
@@ -22,6 +23,7 @@
 #include "isl_equalities.h"
 #include "isl_tab.h"
 #include <isl_sort.h>
+#include <isl_thread.h>
 
 static struct isl_basic_set *uset_convex_hull_wrap_bounded(struct isl_set *set);
 
@@ -83,6 +85,204 @@ int isl_basic_set_constraint_is_redundant(struct isl_basic_set **bset,
  * corresponding equality and the checked if the dimension was that
  * of a facet.
  */
+/* The denominator of the rational approximations of the floating point
+ * points computed by the redundancy filter.
+ */
+#define FLOAT_FILTER_DENOM	1024
+
+/* Value of the constraint "c" of length 1 + "n" at "x".
+ */
+static double float_val(double *c, int n, double *x)
+{
+	int k;
+	double v = c[0];
+
+	for (k = 0; k < n; ++k)
+		v += c[1 + k] * x[k];
+	return v;
+}
+
+/* Inner product of the linear parts of the constraints "c1" and "c2".
+ */
+static double float_dot(double *c1, double *c2, int n)
+{
+	int k;
+	double v = 0;
+
+	for (k = 0; k < n; ++k)
+		v += c1[1 + k] * c2[1 + k];
+	return v;
+}
+
+/* Look for a point "x" that satisfies the "m" inequality constraints "c"
+ * of length 1 + "n" with a margin, using the relaxation method.
+ * That is, as long as some constraint is violated (by the largest
+ * amount, relative to the size of its coefficients), "x" is projected
+ * onto the hyperplane where that constraint is satisfied with the margin.
+ * A few decreasing margins are tried.
+ * Return 1 if such a point was found and 0 otherwise.
+ */
+static int float_interior_point(double *c, int m, int n, double *x)
+{
+	int i, j, k, it;
+	int max_it = 10 * (m + n);
+	double mu;
+
+	for (mu = 1; mu > 1.0 / 512; mu /= 16) {
+		for (k = 0; k < n; ++k)
+			x[k] = 0;
+		for (it = 0; it < max_it; ++it) {
+			double max = 0, sq;
+			int best = -1;
+
+			for (i = 0; i < m; ++i) {
+				double *ci = c + i * (1 + n);
+				double l1 = 0, viol;
+
+				for (k = 0; k < n; ++k)
+					l1 += ci[1 + k] < 0 ? -ci[1 + k] : ci[1 + k];
+				viol = mu * l1 - float_val(ci, n, x);
+				if (viol > max) {
+					max = viol;
+					best = i;
+				}
+			}
+			if (best < 0)
+				return 1;
+			j = best;
+			sq = float_dot(c + j * (1 + n), c + j * (1 + n), n);
+			if (sq == 0)
+				return 0;
+			for (k = 0; k < n; ++k)
+				x[k] += max / sq * c[j * (1 + n) + 1 + k];
+		}
+	}
+
+	return 0;
+}
+
+/* Store a rational approximation of the point "x" with "n" coordinates
+ * in homogeneous form in "v".
+ * Return 0 if some coordinate is too large to be represented.
+ */
+static int float_to_exact(double *x, int n, __isl_keep isl_vec *v)
+{
+	int k;
+	double bound = (double) (LONG_MAX / 2);
+
+	isl_int_set_si(v->el[0], FLOAT_FILTER_DENOM);
+	for (k = 0; k < n; ++k) {
+		double d = x[k] * FLOAT_FILTER_DENOM;
+
+		if (d >= bound || d <= -bound)
+			return 0;
+		isl_int_set_si(v->el[1 + k], (long) (d >= 0 ? d + 0.5 : d - 0.5));
+	}
+	return 1;
+}
+
+/* Check that the homogeneous point "v" satisfies all inequality
+ * constraints of "bmap" strictly, except constraint "skip",
+ * which it should strictly violate, if "skip" is non-negative.
+ */
+static int exact_check(__isl_keep isl_basic_map *bmap, __isl_keep isl_vec *v,
+	int skip, isl_int *t)
+{
+	int j;
+
+	for (j = 0; j < bmap->n_ineq; ++j) {
+		isl_seq_inner_product(bmap->ineq[j], v->el, v->size, t);
+		if (j == skip ? !isl_int_is_neg(*t) : !isl_int_is_pos(*t))
+			return 0;
+	}
+	return 1;
+}
+
+/* Try and certify that "bmap", which is assumed not to have
+ * any equality constraints, has no implicit equalities and
+ * no redundant inequality constraints (in the rational sense),
+ * using floating point computations that are verified exactly.
+ *
+ * First look for an interior point x0, which is verified to satisfy
+ * all constraints strictly.  This shows that there are no implicit
+ * equalities.  Then, for each constraint c_i, move from x0 in the direction
+ * opposite to the normal of c_i up to a point y_i beyond the hyperplane
+ * of c_i, but before any other constraint is violated.
+ * Each y_i is verified to violate c_i and to satisfy all other constraints,
+ * showing that c_i is not redundant.
+ *
+ * Return 1 if all these properties could be certified, 0 if not and
+ * -1 on error.
+ */
+static int float_certify_irredundant(__isl_keep isl_basic_map *bmap)
+{
+	isl_ctx *ctx;
+	int i, j, k, n, m;
+	double *c = NULL, *x = NULL, *y = NULL;
+	isl_vec *v = NULL;
+	isl_int t;
+	int r = -1;
+
+	ctx = isl_basic_map_get_ctx(bmap);
+	n = isl_basic_map_total_dim(bmap);
+	m = bmap->n_ineq;
+	c = isl_alloc_array(ctx, double, m * (1 + n));
+	x = isl_alloc_array(ctx, double, n);
+	y = isl_alloc_array(ctx, double, n);
+	v = isl_vec_alloc(ctx, 1 + n);
+	if (!c || (n && (!x || !y)) || !v)
+		goto error;
+	isl_int_init(t);
+
+	for (i = 0; i < m; ++i)
+		for (k = 0; k < 1 + n; ++k)
+			c[i * (1 + n) + k] = isl_int_get_d(bmap->ineq[i][k]);
+
+	r = 0;
+	if (!float_interior_point(c, m, n, x))
+		goto done;
+	if (!float_to_exact(x, n, v) || !exact_check(bmap, v, -1, &t))
+		goto done;
+
+	for (i = 0; i < m; ++i) {
+		double *ci = c + i * (1 + n);
+		double sq = float_dot(ci, ci, n);
+		double s, limit;
+
+		if (sq == 0)
+			goto done;
+		s = float_val(ci, n, x) / sq;
+		limit = 2 * s + 1;
+
+		for (j = 0; j < m; ++j) {
+			double *cj = c + j * (1 + n);
+			double dot;
+
+			if (j == i)
+				continue;
+			dot = float_dot(cj, ci, n);
+			if (dot > 0 && float_val(cj, n, x) / dot < limit)
+				limit = float_val(cj, n, x) / dot;
+		}
+		if (limit <= s)
+			goto done;
+		s = (s + limit) / 2;
+		for (k = 0; k < n; ++k)
+			y[k] = x[k] - s * ci[1 + k];
+		if (!float_to_exact(y, n, v) || !exact_check(bmap, v, i, &t))
+			goto done;
+	}
+	r = 1;
+done:
+	isl_int_clear(t);
+error:
+	isl_vec_free(v);
+	free(c);
+	free(x);
+	free(y);
+	return r;
+}
+
 __isl_give isl_basic_map *isl_basic_map_remove_redundancies(
 	__isl_take isl_basic_map *bmap)
 {
@@ -99,10 +299,23 @@ __isl_give isl_basic_map *isl_basic_map_remove_redundancies(
 	if (bmap->n_ineq <= 1)
 		return bmap;
 
+	if (bmap->n_eq == 0 && bmap->ctx->opt->float_filter) {
+		int certified = float_certify_irredundant(bmap);
+		if (certified < 0)
+			return isl_basic_map_free(bmap);
+		if (certified) {
+			bmap->ctx->stats->float_filter_hits++;
+			ISL_F_SET(bmap, ISL_BASIC_MAP_NO_IMPLICIT);
+			ISL_F_SET(bmap, ISL_BASIC_MAP_NO_REDUNDANT);
+			return bmap;
+		}
+		bmap->ctx->stats->float_filter_misses++;
+	}
+
 	tab = isl_tab_from_basic_map(bmap, 0);
 	if (isl_tab_detect_implicit_equalities(tab) < 0)
 		goto error;
-	if (isl_tab_detect_redundant(tab) < 0)
+	if (isl_tab_detect_redundant_batch(tab) < 0)
 		goto error;
 	bmap = isl_basic_map_update_from_tab(bmap, tab);
 	isl_tab_free(tab);
@@ -245,7 +458,6 @@ static struct isl_basic_set *isl_basic_set_add_equality(
 	isl_assert(bset->ctx, isl_basic_set_n_param(bset) == 0, goto error);
 	isl_assert(bset->ctx, bset->n_div == 0, goto error);
 	dim = isl_basic_set_n_dim(bset);
-	bset = isl_basic_set_cow(bset);
 	bset = isl_basic_set_extend(bset, 0, dim, 0, 1, 0);
 	i = isl_basic_set_alloc_equality(bset);
 	if (i < 0)
@@ -277,9 +489,8 @@ error:
 
 /* Given a union of basic sets, construct the constraints for wrapping
  * a facet around one of its ridges.
- * In particular, if each of n the d-dimensional basic sets i in "set"
- * contains the origin, satisfies the constraints x_1 >= 0 and x_2 >= 0
- * and is defined by the constraints
+ * In particular, if each of the n d-dimensional basic sets i in "set"
+ * is defined by the constraints
  *				    [ 1 ]
  *				A_i [ x ]  >= 0
  *
@@ -290,7 +501,8 @@ error:
  *
  *				      a_i   >= 0
  *
- *			\sum_i x_{i,1} = 1
+ * That is, it is the product of the homogenizations of the basic sets.
+ * See isl_set_wrap_facet_lp for the way these constraints are used.
  */
 static struct isl_basic_set *wrap_constraints(struct isl_set *set)
 {
@@ -304,7 +516,7 @@ static struct isl_basic_set *wrap_constraints(struct isl_set *set)
 		return NULL;
 
 	dim = 1 + isl_set_n_dim(set);
-	n_eq = 1;
+	n_eq = 0;
 	n_ineq = set->n;
 	for (i = 0; i < set->n; ++i) {
 		n_eq += set->p[i]->n_eq;
@@ -315,13 +527,6 @@ static struct isl_basic_set *wrap_constraints(struct isl_set *set)
 	if (!lp)
 		return NULL;
 	lp_dim = isl_basic_set_n_dim(lp);
-	k = isl_basic_set_alloc_equality(lp);
-	isl_int_set_si(lp->eq[k][0], -1);
-	for (i = 0; i < set->n; ++i) {
-		isl_int_set_si(lp->eq[k][1+dim*i], 0);
-		isl_int_set_si(lp->eq[k][1+dim*i+1], 1);
-		isl_seq_clr(lp->eq[k]+1+dim*i+2, dim-2);
-	}
 	for (i = 0; i < set->n; ++i) {
 		k = isl_basic_set_alloc_inequality(lp);
 		isl_seq_clr(lp->ineq[k], 1+lp_dim);
@@ -344,11 +549,23 @@ static struct isl_basic_set *wrap_constraints(struct isl_set *set)
 	return lp;
 }
 
+/* Construct an LP problem for wrapping facets of the convex hull
+ * of "set" around ridges.  The constraints of the problem
+ * (see wrap_constraints) only depend on "set" and not on the facet
+ * or the ridge, so the same problem can be reused for all calls
+ * to isl_set_wrap_facet_lp on "set".
+ */
+__isl_give isl_tab_lp *isl_set_wrap_lp(__isl_keep isl_set *set)
+{
+	return isl_tab_lp_from_basic_map(wrap_constraints(set));
+}
+
 /* Given a facet "facet" of the convex hull of "set" and a facet "ridge"
  * of that facet, compute the other facet of the convex hull that contains
- * the ridge.
+ * the ridge, using the LP problem "lp" constructed by isl_set_wrap_lp
+ * from "set".  The result is stored in "facet".
  *
- * We first transform the set such that the facet constraint becomes
+ * Consider any affine transformation that maps the facet constraint to
  *
  *			x_1 >= 0
  *
@@ -356,14 +573,11 @@ static struct isl_basic_set *wrap_constraints(struct isl_set *set)
  *
  *			x_1 = 0
  *
- * and on that facet, the constraint that defines the ridge is
+ * and on that facet, the constraint that defines the ridge to
  *
  *			x_2 >= 0
  *
- * (This transformation is not strictly needed, all that is needed is
- * that the ridge contains the origin.)
- *
- * Since the ridge contains the origin, the cone of the convex hull
+ * Since the ridge then contains the origin, the cone of the convex hull
  * will be of the form
  *
  *			x_1 >= 0
@@ -374,78 +588,64 @@ static struct isl_basic_set *wrap_constraints(struct isl_set *set)
  * convex hull to 1 and minimizing x_2.
  * Now, each element in the cone of the convex hull is the sum
  * of elements in the cones of the basic sets.
- * If a_i is the dilation factor of basic set i, then the problem
- * we need to solve is
+ * Since x_1 and x_2 are the values of "facet" and "ridge",
+ * the problem we need to solve in terms of the original variables is
  *
- *			min \sum_i x_{i,2}
+ *			min \sum_i ridge(a_i, x_i)
  *			st
- *				\sum_i x_{i,1} = 1
+ *				\sum_i facet(a_i, x_i) = 1
  *				    a_i   >= 0
- *				  [ a_i ]
- *				A [ x_i ] >= 0
- *
- * with
- *				    [  1  ]
+ *				    [ a_i ]
  *				A_i [ x_i ] >= 0
  *
- * the constraints of each (transformed) basic set.
- * If a = n/d, then the constraint defining the new facet (in the transformed
- * space) is
- *
- *			-n x_1 + d x_2 >= 0
+ * with a_i the dilation factor of basic set i and with the constraints
+ * of the basic sets as in wrap_constraints.
+ * The constraints of this problem are those of "lp", except for
+ * the normalization equality, which is added temporarily.
+ * Since the optimal basis of the previous problem is kept,
+ * successive wrapping problems typically only require a few pivots.
+ * If a = n/d, then the constraint defining the new facet is
  *
- * In the original space, we need to take the same combination of the
- * corresponding constraints "facet" and "ridge".
+ *			-n facet + d ridge >= 0
  *
  * If a = -infty = "-1/0", then we just return the original facet constraint.
  * This means that the facet is unbounded, but has a bounded intersection
  * with the union of sets.
+ *
+ * Return the updated LP problem or NULL on error.
  */
-isl_int *isl_set_wrap_facet(__isl_keep isl_set *set,
-	isl_int *facet, isl_int *ridge)
+__isl_give isl_tab_lp *isl_set_wrap_facet_lp(__isl_keep isl_set *set,
+	__isl_take isl_tab_lp *lp, isl_int *facet, isl_int *ridge)
 {
 	int i;
 	isl_ctx *ctx;
-	struct isl_mat *T = NULL;
-	struct isl_basic_set *lp = NULL;
-	struct isl_vec *obj;
+	struct isl_vec *eq, *obj;
+	struct isl_tab_undo *snap;
 	enum isl_lp_result res;
 	isl_int num, den;
 	unsigned dim;
 
-	if (!set)
-		return NULL;
+	if (!set || !lp)
+		return isl_tab_lp_free(lp);
 	ctx = set->ctx;
-	set = isl_set_copy(set);
-	set = isl_set_set_rational(set);
 
 	dim = 1 + isl_set_n_dim(set);
-	T = isl_mat_alloc(ctx, 3, dim);
-	if (!T)
-		goto error;
-	isl_int_set_si(T->row[0][0], 1);
-	isl_seq_clr(T->row[0]+1, dim - 1);
-	isl_seq_cpy(T->row[1], facet, dim);
-	isl_seq_cpy(T->row[2], ridge, dim);
-	T = isl_mat_right_inverse(T);
-	set = isl_set_preimage(set, T);
-	T = NULL;
-	if (!set)
-		goto error;
-	lp = wrap_constraints(set);
-	obj = isl_vec_alloc(ctx, 1 + dim*set->n);
-	if (!obj)
+	eq = isl_vec_alloc(ctx, 1 + dim * set->n);
+	obj = isl_vec_alloc(ctx, 1 + dim * set->n);
+	if (!eq || !obj)
 		goto error;
-	isl_int_set_si(obj->block.data[0], 0);
+	isl_int_set_si(eq->el[0], -1);
+	isl_int_set_si(obj->el[0], 0);
 	for (i = 0; i < set->n; ++i) {
-		isl_seq_clr(obj->block.data + 1 + dim*i, 2);
-		isl_int_set_si(obj->block.data[1 + dim*i+2], 1);
-		isl_seq_clr(obj->block.data + 1 + dim*i+3, dim-3);
+		isl_seq_cpy(eq->el + 1 + dim * i, facet, dim);
+		isl_seq_cpy(obj->el + 1 + dim * i, ridge, dim);
 	}
+
+	snap = isl_tab_lp_snap(lp);
+	lp = isl_tab_lp_add_eq(lp, eq->el);
 	isl_int_init(num);
 	isl_int_init(den);
-	res = isl_basic_set_solve_lp(lp, 0,
-			    obj->block.data, ctx->one, &num, &den, NULL);
+	res = isl_tab_lp_solve(lp, 0, obj->el, ctx->one, &num, &den, NULL);
 	if (res == isl_lp_ok) {
 		isl_int_neg(num, num);
 		isl_seq_combine(facet, num, facet, den, ridge, dim);
@@ -453,19 +653,40 @@ isl_int *isl_set_wrap_facet(__isl_keep isl_set *set,
 	}
 	isl_int_clear(num);
 	isl_int_clear(den);
+	isl_vec_free(eq);
 	isl_vec_free(obj);
-	isl_basic_set_free(lp);
-	isl_set_free(set);
 	if (res == isl_lp_error)
+		return isl_tab_lp_free(lp);
+	if (res != isl_lp_ok && res != isl_lp_unbounded)
+		isl_die(ctx, isl_error_internal,
+			"unable to wrap facet", return isl_tab_lp_free(lp));
+	return isl_tab_lp_rollback(lp, snap);
+error:
+	isl_vec_free(eq);
+	isl_vec_free(obj);
+	return isl_tab_lp_free(lp);
+}
+
+/* Given a facet "facet" of the convex hull of "set" and a facet "ridge"
+ * of that facet, compute the other facet of the convex hull that contains
+ * the ridge.
+ * See isl_set_wrap_facet_lp for details.
+ * Callers that perform several wrapping steps on the same set
+ * should construct the LP problem once using isl_set_wrap_lp and
+ * call isl_set_wrap_facet_lp directly instead.
+ */
+isl_int *isl_set_wrap_facet(__isl_keep isl_set *set,
+	isl_int *facet, isl_int *ridge)
+{
+	isl_tab_lp *lp;
+
+	lp = isl_set_wrap_lp(set);
+	lp = isl_set_wrap_facet_lp(set, lp, facet, ridge);
+	if (!lp)
 		return NULL;
-	isl_assert(ctx, res == isl_lp_ok || res == isl_lp_unbounded, 
-		   return NULL);
+	isl_tab_lp_free(lp);
+
 	return facet;
-error:
-	isl_basic_set_free(lp);
-	isl_mat_free(T);
-	isl_set_free(set);
-	return NULL;
 }
 
 /* Compute the constraint of a facet of "set".
@@ -489,6 +710,7 @@ static __isl_give isl_mat *initial_facet_constraint(__isl_keep isl_set *set)
 	unsigned dim = isl_set_n_dim(set);
 	int is_bound;
 	isl_mat *bounds = NULL;
+	isl_tab_lp *lp = NULL;
 
 	isl_assert(set->ctx, set->n > 0, goto error);
 	bounds = isl_mat_alloc(set->ctx, 1, 1 + dim);
@@ -520,14 +742,20 @@ static __isl_give isl_mat *initial_facet_constraint(__isl_keep isl_set *set)
 						face->eq[i], 1 + dim))
 				break;
 		isl_assert(set->ctx, i < face->n_eq, goto error);
-		if (!isl_set_wrap_facet(set, bounds->row[0], face->eq[i]))
+		if (!lp)
+			lp = isl_set_wrap_lp(set);
+		lp = isl_set_wrap_facet_lp(set, lp, bounds->row[0],
+					    face->eq[i]);
+		if (!lp)
 			goto error;
 		isl_seq_normalize(set->ctx, bounds->row[0], bounds->n_col);
 		isl_basic_set_free(face);
 	}
 
+	isl_tab_lp_free(lp);
 	return bounds;
 error:
+	isl_tab_lp_free(lp);
 	isl_basic_set_free(face);
 	isl_mat_free(bounds);
 	return NULL;
@@ -604,19 +832,214 @@ error:
 	return NULL;
 }
 
-/* Given an initial facet constraint, compute the remaining facets.
- * We do this by running through all facets found so far and computing
- * the adjacent facets through wrapping, adding those facets that we
- * hadn't already found before.
+/* Compute the facets of the convex hull of "set" that are adjacent
+ * to the facet hull->ineq[i] of the convex hull and that may not
+ * have been found yet, and return their constraints
+ * as the rows of a matrix.
  *
- * For each facet we have found so far, we first compute its facets
+ * We first compute the facets of facet hull->ineq[i]
  * in the resulting convex hull.  That is, we compute the ridges
  * of the resulting convex hull contained in the facet.
  * We also compute the corresponding facet in the current approximation
- * of the convex hull.  There is no need to wrap around the ridges
+ * "hull" of the convex hull.  There is no need to wrap around the ridges
  * in this facet since that would result in a facet that is already
  * present in the current approximation.
  *
+ * The wrapping steps use and update the LP problem "*lp"
+ * constructed from "set" by isl_set_wrap_lp.
+ */
+static __isl_give isl_mat *adjacent_facets(__isl_keep isl_set *set,
+	__isl_keep isl_basic_set *hull, int i, isl_tab_lp **lp)
+{
+	int j, f, n;
+	unsigned dim;
+	struct isl_basic_set *facet = NULL;
+	struct isl_basic_set *hull_facet = NULL;
+	isl_mat *wraps = NULL;
+
+	dim = isl_set_n_dim(set);
+	facet = compute_facet(set, hull->ineq[i]);
+	facet = isl_basic_set_add_equality(facet, hull->ineq[i]);
+	facet = isl_basic_set_gauss(facet, NULL);
+	facet = isl_basic_set_normalize_constraints(facet);
+	hull_facet = isl_basic_set_copy(hull);
+	hull_facet = isl_basic_set_add_equality(hull_facet, hull->ineq[i]);
+	hull_facet = isl_basic_set_gauss(hull_facet, NULL);
+	hull_facet = isl_basic_set_normalize_constraints(hull_facet);
+	if (!facet || !hull_facet)
+		goto error;
+	wraps = isl_mat_alloc(set->ctx, facet->n_ineq, 1 + dim);
+	if (!wraps)
+		goto error;
+	n = 0;
+	for (j = 0; j < facet->n_ineq; ++j) {
+		for (f = 0; f < hull_facet->n_ineq; ++f)
+			if (isl_seq_eq(facet->ineq[j],
+					hull_facet->ineq[f], 1 + dim))
+				break;
+		if (f < hull_facet->n_ineq)
+			continue;
+		isl_seq_cpy(wraps->row[n], hull->ineq[i], 1 + dim);
+		*lp = isl_set_wrap_facet_lp(set, *lp, wraps->row[n],
+					    facet->ineq[j]);
+		if (!*lp)
+			goto error;
+		n++;
+	}
+	wraps->n_row = n;
+	isl_basic_set_free(hull_facet);
+	isl_basic_set_free(facet);
+	return wraps;
+error:
+	isl_mat_free(wraps);
+	isl_basic_set_free(hull_facet);
+	isl_basic_set_free(facet);
+	return NULL;
+}
+
+/* Add the constraints in the rows of "wraps" to "hull".
+ * If "unique" is set, then skip the constraints that already
+ * appear in "hull".
+ */
+static __isl_give isl_basic_set *add_facets(__isl_take isl_basic_set *hull,
+	__isl_keep isl_mat *wraps, int unique)
+{
+	int i, j, k;
+	unsigned dim;
+
+	if (!hull || !wraps)
+		return isl_basic_set_free(hull);
+
+	dim = isl_basic_set_n_dim(hull);
+	hull = isl_basic_set_extend_space(hull, isl_space_copy(hull->dim),
+					0, 0, wraps->n_row);
+	if (!hull)
+		return NULL;
+	for (i = 0; i < wraps->n_row; ++i) {
+		if (unique) {
+			for (j = 0; j < hull->n_ineq; ++j)
+				if (isl_seq_eq(hull->ineq[j], wraps->row[i],
+						1 + dim))
+					break;
+			if (j < hull->n_ineq)
+				continue;
+		}
+		k = isl_basic_set_alloc_inequality(hull);
+		if (k < 0)
+			return isl_basic_set_free(hull);
+		isl_seq_cpy(hull->ineq[k], wraps->row[i], 1 + dim);
+	}
+
+	return hull;
+}
+
+#ifdef HAVE_PTHREAD
+
+/* Data shared by the workers of extend_threads.
+ * "set" and "hull" live in the isl_ctx of the caller.
+ * The facets adjacent to facet hull->ineq[first + i] are
+ * stored in wraps[i], also in the isl_ctx of the caller.
+ */
+struct isl_hull_threads {
+	isl_set *set;
+	isl_basic_set *hull;
+	int first;
+	isl_mat **wraps;
+};
+
+/* Import data->set and data->hull into the isl_ctx of "worker",
+ * compute the facets adjacent to facet data->first + i of the hull
+ * there and import them back into data->wraps[i].
+ */
+static int extend_work(struct isl_thread_worker *worker, int i, void *user)
+{
+	struct isl_hull_threads *data = user;
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	isl_set *set;
+	isl_basic_set *hull;
+	isl_tab_lp *lp;
+	isl_mat *wraps = NULL;
+
+	isl_thread_worker_lock(worker);
+	set = isl_set_import(ctx, data->set);
+	hull = isl_basic_set_import(ctx, data->hull);
+	isl_thread_worker_unlock(worker);
+
+	lp = isl_set_wrap_lp(set);
+	if (set && hull && lp)
+		wraps = adjacent_facets(set, hull, data->first + i, &lp);
+	isl_tab_lp_free(lp);
+	isl_basic_set_free(hull);
+	isl_set_free(set);
+	if (!wraps)
+		return -1;
+
+	isl_thread_worker_lock(worker);
+	data->wraps[i] = isl_mat_import(data->set->ctx, wraps);
+	isl_thread_worker_unlock(worker);
+
+	isl_mat_free(wraps);
+	return data->wraps[i] ? 0 : -1;
+}
+
+/* Given an initial facet constraint, compute the remaining facets,
+ * using several threads.
+ *
+ * The computation proceeds in rounds.  In each round, the facets
+ * adjacent to each of the facets that were found in the previous round
+ * (or the initial facets in the first round) are computed in parallel,
+ * each in a separate isl_ctx (see isl_thread_run), with respect
+ * to the approximation of the convex hull at the start of the round.
+ * The same facet may then be found from several facets in the same round,
+ * so only those facets that do not appear in the hull yet
+ * are added at the end of the round, in the order of the facets
+ * from which they were found.
+ * The resulting convex hull therefore does not depend
+ * on the number of threads.
+ */
+static __isl_give isl_basic_set *extend_threads(__isl_take isl_basic_set *hull,
+	__isl_keep isl_set *set)
+{
+	int i, n;
+	int r;
+	struct isl_hull_threads data = { set };
+
+	data.first = 0;
+	while (hull && data.first < hull->n_ineq) {
+		n = hull->n_ineq - data.first;
+		data.hull = hull;
+		data.wraps = isl_calloc_array(set->ctx, isl_mat *, n);
+		if (!data.wraps)
+			return isl_basic_set_free(hull);
+		r = isl_thread_run(set->ctx, n, &extend_work, &data);
+		data.first = hull->n_ineq;
+		for (i = 0; i < n; ++i) {
+			if (r >= 0)
+				hull = add_facets(hull, data.wraps[i], 1);
+			isl_mat_free(data.wraps[i]);
+		}
+		free(data.wraps);
+		if (r < 0)
+			return isl_basic_set_free(hull);
+	}
+	hull = isl_basic_set_simplify(hull);
+	hull = isl_basic_set_finalize(hull);
+	return hull;
+}
+
+#endif
+
+/* Given an initial facet constraint, compute the remaining facets.
+ * We do this by running through all facets found so far and computing
+ * the adjacent facets through wrapping (see adjacent_facets),
+ * adding those facets that we hadn't already found before.
+ *
+ * All wrapping steps are performed on the same set and therefore
+ * share a single LP problem.
+ * If the threads option is greater than one and isl
+ * has been built with thread support, then the adjacent facets
+ * are computed in parallel by extend_threads instead.
+ *
  * This function can still be significantly optimized by checking which of
  * the facets of the basic sets are also facets of the convex hull and
  * using all the facets so far to help in constructing the facets of the
@@ -628,58 +1051,37 @@ error:
 static struct isl_basic_set *extend(struct isl_basic_set *hull,
 	struct isl_set *set)
 {
-	int i, j, f;
-	int k;
-	struct isl_basic_set *facet = NULL;
-	struct isl_basic_set *hull_facet = NULL;
-	unsigned dim;
+	int i;
+	isl_mat *wraps;
+	isl_tab_lp *lp = NULL;
 
 	if (!hull)
 		return NULL;
 
 	isl_assert(set->ctx, set->n > 0, goto error);
 
-	dim = isl_set_n_dim(set);
+#ifdef HAVE_PTHREAD
+	if (set->ctx->opt->threads > 1)
+		return extend_threads(hull, set);
+#endif
+
+	lp = isl_set_wrap_lp(set);
+	if (!lp)
+		goto error;
 
 	for (i = 0; i < hull->n_ineq; ++i) {
-		facet = compute_facet(set, hull->ineq[i]);
-		facet = isl_basic_set_add_equality(facet, hull->ineq[i]);
-		facet = isl_basic_set_gauss(facet, NULL);
-		facet = isl_basic_set_normalize_constraints(facet);
-		hull_facet = isl_basic_set_copy(hull);
-		hull_facet = isl_basic_set_add_equality(hull_facet, hull->ineq[i]);
-		hull_facet = isl_basic_set_gauss(hull_facet, NULL);
-		hull_facet = isl_basic_set_normalize_constraints(hull_facet);
-		if (!facet || !hull_facet)
-			goto error;
-		hull = isl_basic_set_cow(hull);
-		hull = isl_basic_set_extend_space(hull,
-			isl_space_copy(hull->dim), 0, 0, facet->n_ineq);
+		wraps = adjacent_facets(set, hull, i, &lp);
+		hull = add_facets(hull, wraps, 0);
+		isl_mat_free(wraps);
 		if (!hull)
 			goto error;
-		for (j = 0; j < facet->n_ineq; ++j) {
-			for (f = 0; f < hull_facet->n_ineq; ++f)
-				if (isl_seq_eq(facet->ineq[j],
-						hull_facet->ineq[f], 1 + dim))
-					break;
-			if (f < hull_facet->n_ineq)
-				continue;
-			k = isl_basic_set_alloc_inequality(hull);
-			if (k < 0)
-				goto error;
-			isl_seq_cpy(hull->ineq[k], hull->ineq[i], 1+dim);
-			if (!isl_set_wrap_facet(set, hull->ineq[k], facet->ineq[j]))
-				goto error;
-		}
-		isl_basic_set_free(hull_facet);
-		isl_basic_set_free(facet);
 	}
+	isl_tab_lp_free(lp);
 	hull = isl_basic_set_simplify(hull);
 	hull = isl_basic_set_finalize(hull);
 	return hull;
 error:
-	isl_basic_set_free(hull_facet);
-	isl_basic_set_free(facet);
+	isl_tab_lp_free(lp);
 	isl_basic_set_free(hull);
 	return NULL;
 }
@@ -7,13 +7,30 @@
  * Computerwetenschappen, Celestijnenlaan 200A, B-3001 Leuven, Belgium
  */
 
+#include <stddef.h>
+#include <string.h>
 #include <isl_ctx_private.h>
 #include <isl/vec.h>
+#include <isl_vec_private.h>
+#include <isl_ast_private.h>
+#include <isl_ast_build_private.h>
+#include <isl_mat_private.h>
+#include <isl_tab.h>
+#include <isl_sample.h>
+#include <isl_flow_private.h>
+#include <isl_transitive_closure_private.h>
 #include <isl_options_private.h>
+#include <isl_profile.h>
+#include <isl_thread.h>
+#include <isl_reordering.h>
+#include <isl_morph.h>
+#include <isl_farkas_private.h>
 
 #define __isl_calloc(type,size)		((type *)calloc(1, size))
 #define __isl_calloc_type(type)		__isl_calloc(type,sizeof(type))
 
+#define ARRAY_SIZE(array) (sizeof(array)/sizeof(*array))
+
 /* Check that the result of an allocation ("p") is not NULL and
  * complain if it is.
  * The only exception is when allocation size ("size") is equal to zero.
@@ -25,56 +42,156 @@ static void *check_non_null(isl_ctx *ctx, void *p, size_t size)
 	isl_die(ctx, isl_error_alloc, "allocation failure", return NULL);
 }
 
+/* Return the current value of a monotonic clock, in seconds.
+ * Fall back to the (non-monotonic) calendar time
+ * if no monotonic clock is available.
+ */
+double isl_monotonic_time(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+		return ts.tv_sec + 1e-9 * ts.tv_nsec;
+#endif
+	return (double) time(NULL);
+}
+
+/* Return the processor time in seconds consumed by the calling thread.
+ * Fall back to the processor time of the whole process
+ * if per-thread clocks are not available.
+ */
+double isl_thread_cpu_time(void)
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+		return ts.tv_sec + 1e-9 * ts.tv_nsec;
+#endif
+	return (double) clock() / CLOCKS_PER_SEC;
+}
+
+/* The number of operations between two consecutive checks
+ * of the deadline.
+ */
+#define ISL_CTX_DEADLINE_PERIOD	256
+
+/* Check whether the deadline of "ctx" has passed and
+ * fail with an isl_error_timeout error if so.
+ * Reading the clock is much more expensive than performing
+ * an operation, so it is only read once every
+ * ISL_CTX_DEADLINE_PERIOD operations.
+ * Once the deadline has passed, every subsequent operation fails
+ * until the deadline is reset.
+ */
+static int check_deadline(isl_ctx *ctx)
+{
+	if (!ctx->deadline_expired) {
+		if (--ctx->deadline_countdown > 0)
+			return 0;
+		ctx->deadline_countdown = ISL_CTX_DEADLINE_PERIOD;
+		if (isl_monotonic_time() < ctx->deadline)
+			return 0;
+		ctx->deadline_expired = 1;
+	}
+	isl_die(ctx, isl_error_timeout, "deadline exceeded", return -1);
+}
+
 /* Prepare for performing the next "operation" in the context.
  * Return 0 if we are allowed to perform this operation and
  * return -1 if we should abort the computation.
  *
  * In particular, we should stop if the user has explicitly aborted
- * the computation or if the maximal number of operations has been exceeded.
+ * the computation (in "ctx" or, for a worker, in the isl_ctx on whose
+ * behalf it performs the computation), if the maximal number
+ * of operations has been exceeded or if the deadline has passed.
  */
 int isl_ctx_next_operation(isl_ctx *ctx)
 {
 	if (!ctx)
 		return -1;
-	if (ctx->abort) {
+	if (isl_ctx_aborted(ctx) ||
+	    (ctx->parent && isl_ctx_aborted(ctx->parent))) {
 		isl_ctx_set_error(ctx, isl_error_abort);
 		return -1;
 	}
 	if (ctx->max_operations && ctx->operations >= ctx->max_operations)
 		isl_die(ctx, isl_error_quota,
 			"maximal number of operations exceeded", return -1);
+	if (ctx->has_deadline && check_deadline(ctx) < 0)
+		return -1;
 	ctx->operations++;
 	return 0;
 }
 
 /* Call malloc and complain if it fails.
  * If ctx is NULL, then return NULL.
+ * "type" describes the type of the allocated object
+ * (or of the elements of the allocated array).
+ * It is only used for accounting the allocation if
+ * the "profile_allocations" option is set.
  */
-void *isl_malloc_or_die(isl_ctx *ctx, size_t size)
+void *isl_malloc_type_or_die(isl_ctx *ctx, size_t size, const char *type)
 {
 	if (isl_ctx_next_operation(ctx) < 0)
 		return NULL;
-	return ctx ? check_non_null(ctx, malloc(size), size) : NULL;
+	if (ctx->opt && ctx->opt->profile_allocations)
+		isl_profile_record_alloc(ctx, type, size);
+	return check_non_null(ctx, malloc(size), size);
 }
 
 /* Call calloc and complain if it fails.
  * If ctx is NULL, then return NULL.
+ * "type" is only used for accounting, as in isl_malloc_type_or_die.
  */
-void *isl_calloc_or_die(isl_ctx *ctx, size_t nmemb, size_t size)
+void *isl_calloc_type_or_die(isl_ctx *ctx, size_t nmemb, size_t size,
+	const char *type)
 {
 	if (isl_ctx_next_operation(ctx) < 0)
 		return NULL;
-	return ctx ? check_non_null(ctx, calloc(nmemb, size), nmemb) : NULL;
+	if (ctx->opt && ctx->opt->profile_allocations)
+		isl_profile_record_alloc(ctx, type, nmemb * size);
+	return check_non_null(ctx, calloc(nmemb, size), nmemb);
 }
 
 /* Call realloc and complain if it fails.
  * If ctx is NULL, then return NULL.
+ * "type" is only used for accounting, as in isl_malloc_type_or_die.
+ * A reallocation is accounted as an allocation of the new size.
  */
-void *isl_realloc_or_die(isl_ctx *ctx, void *ptr, size_t size)
+void *isl_realloc_type_or_die(isl_ctx *ctx, void *ptr, size_t size,
+	const char *type)
 {
 	if (isl_ctx_next_operation(ctx) < 0)
 		return NULL;
-	return ctx ? check_non_null(ctx, realloc(ptr, size), size) : NULL;
+	if (ctx->opt && ctx->opt->profile_allocations)
+		isl_profile_record_alloc(ctx, type, size);
+	return check_non_null(ctx, realloc(ptr, size), size);
+}
+
+/* Call malloc and complain if it fails.
+ * If ctx is NULL, then return NULL.
+ */
+void *isl_malloc_or_die(isl_ctx *ctx, size_t size)
+{
+	return isl_malloc_type_or_die(ctx, size, NULL);
+}
+
+/* Call calloc and complain if it fails.
+ * If ctx is NULL, then return NULL.
+ */
+void *isl_calloc_or_die(isl_ctx *ctx, size_t nmemb, size_t size)
+{
+	return isl_calloc_type_or_die(ctx, nmemb, size, NULL);
+}
+
+/* Call realloc and complain if it fails.
+ * If ctx is NULL, then return NULL.
+ */
+void *isl_realloc_or_die(isl_ctx *ctx, void *ptr, size_t size)
+{
+	return isl_realloc_type_or_die(ctx, ptr, size, NULL);
 }
 
 void isl_handle_error(isl_ctx *ctx, enum isl_error error, const char *msg,
@@ -164,10 +281,22 @@ isl_ctx *isl_ctx_alloc_with_options(struct isl_args *args, void *user_opt)
 	if (!ctx)
 		goto error;
 
+	if (isl_hash_table_init(ctx, &ctx->name_table, 0))
+		goto error;
 	if (isl_hash_table_init(ctx, &ctx->id_table, 0))
 		goto error;
+	if (isl_hash_table_init(ctx, &ctx->sample_cache, 0))
+		goto error;
+	if (isl_hash_table_init(ctx, &ctx->flow_cache, 0))
+		goto error;
+	if (isl_hash_table_init(ctx, &ctx->closure_cache, 0))
+		goto error;
+	if (isl_hash_table_init(ctx, &ctx->compression_cache, 0))
+		goto error;
+	if (isl_hash_table_init(ctx, &ctx->coefficients_cache, 0))
+		goto error;
 
-	ctx->stats = isl_calloc_type(ctx, struct isl_stats);
+	ctx->stats = isl_calloc_type(ctx, struct isl_ctx_stats);
 	if (!ctx->stats)
 		goto error;
 
@@ -191,13 +320,17 @@ isl_ctx *isl_ctx_alloc_with_options(struct isl_args *args, void *user_opt)
 
 	isl_int_init(ctx->normalize_gcd);
 
-	ctx->n_cached = 0;
-	ctx->n_miss = 0;
+	memset(&ctx->blk_cache, 0, sizeof(ctx->blk_cache));
+	ctx->blk_cache.arena = opt->arena;
+	ctx->n_int_pool = 0;
+	ctx->int_pool_size = 0;
+	ctx->int_pool = NULL;
 
 	ctx->error = isl_error_none;
 
 	ctx->operations = 0;
 	isl_ctx_set_max_operations(ctx, ctx->opt->max_operations);
+	isl_ctx_set_max_memory(ctx, ctx->opt->max_memory);
 
 	return ctx;
 error:
@@ -217,6 +350,115 @@ struct isl_ctx *isl_ctx_alloc()
 	return isl_ctx_alloc_with_options(&isl_options_args, opt);
 }
 
+/* Allocate an isl_ctx in arena mode.
+ * See the documentation of the arena option.
+ */
+isl_ctx *isl_ctx_alloc_arena(void)
+{
+	struct isl_options *opt;
+
+	opt = isl_options_new_with_defaults();
+	if (!opt)
+		return NULL;
+	opt->arena = 1;
+
+	return isl_ctx_alloc_with_options(&isl_options_args, opt);
+}
+
+/* Replace the isl options in "opt" by a copy of those in "src",
+ * the options of the isl_ctx on whose behalf a worker isl_ctx
+ * with options "opt" performs a computation.
+ * Statistics and profiles are not printed by the worker and
+ * the worker does not create any threads of its own, such that
+ * the number of threads is bounded by the threads option of "src".
+ */
+static int copy_worker_options(struct isl_options *opt,
+	struct isl_options *src)
+{
+	char *ast_iterator_type = NULL;
+
+	if (src->ast_iterator_type) {
+		ast_iterator_type = strdup(src->ast_iterator_type);
+		if (!ast_iterator_type)
+			return -1;
+	}
+	free(opt->ast_iterator_type);
+	*opt = *src;
+	opt->ast_iterator_type = ast_iterator_type;
+	opt->print_stats = 0;
+	opt->profile = 0;
+	opt->profile_allocations = 0;
+	opt->threads = 1;
+
+	return 0;
+}
+
+/* Prepare the worker isl_ctx "worker" for performing (another) part
+ * of a computation on behalf of "ctx".
+ * The worker receives a copy of the isl options of "ctx"
+ * (see copy_worker_options), the deadline of "ctx" (if any) and
+ * the part of the operation and memory limits of "ctx"
+ * that has not been used up yet.  It also fails as soon as
+ * the computation in "ctx" is aborted.
+ * Any error of an earlier computation in "worker" is discarded.
+ */
+int isl_ctx_prepare_worker(isl_ctx *ctx, isl_ctx *worker)
+{
+	if (!ctx || !worker)
+		return -1;
+
+	if (copy_worker_options(worker->opt, ctx->opt) < 0)
+		return -1;
+	worker->parent = ctx;
+	worker->error = isl_error_none;
+	worker->has_deadline = ctx->has_deadline;
+	worker->deadline = ctx->deadline;
+	worker->deadline_expired = 0;
+	worker->deadline_countdown = 1;
+	worker->max_operations = 0;
+	if (ctx->max_operations)
+		worker->max_operations = worker->operations +
+			(ctx->operations < ctx->max_operations ?
+				ctx->max_operations - ctx->operations : 1);
+	worker->max_memory = 0;
+	if (ctx->max_memory)
+		worker->max_memory = worker->stats->memory +
+			(ctx->stats->memory < ctx->max_memory ?
+				ctx->max_memory - ctx->stats->memory : 1);
+
+	return 0;
+}
+
+/* Allocate a new isl_ctx for use by a worker thread that performs
+ * part of a computation on behalf of "ctx" (see isl_ctx_prepare_worker).
+ * Its operations and statistics should be added to those of "ctx"
+ * through isl_ctx_collect_worker or isl_ctx_free_worker.
+ */
+isl_ctx *isl_ctx_alloc_worker(isl_ctx *ctx)
+{
+	struct isl_options *opt;
+	isl_ctx *worker;
+
+	if (!ctx)
+		return NULL;
+
+	opt = isl_options_new_with_defaults();
+	if (!opt)
+		return NULL;
+	if (copy_worker_options(opt, ctx->opt) < 0) {
+		isl_options_free(opt);
+		return NULL;
+	}
+
+	worker = isl_ctx_alloc_with_options(&isl_options_args, opt);
+	if (isl_ctx_prepare_worker(ctx, worker) < 0) {
+		isl_ctx_free(worker);
+		return NULL;
+	}
+
+	return worker;
+}
+
 void isl_ctx_ref(struct isl_ctx *ctx)
 {
 	ctx->ref++;
@@ -228,17 +470,230 @@ void isl_ctx_deref(struct isl_ctx *ctx)
 	ctx->ref--;
 }
 
+/* The ways in which a statistic of a worker isl_ctx is combined
+ * with the same statistic of the isl_ctx on whose behalf it worked.
+ * isl_ctx_stat_add adds the value of the worker,
+ * isl_ctx_stat_max keeps the maximum of the two values and
+ * isl_ctx_stat_keep ignores the value of the worker.
+ */
+enum isl_ctx_stat_merge {
+	isl_ctx_stat_add,
+	isl_ctx_stat_max,
+	isl_ctx_stat_keep
+};
+
+/* Description of a statistic in struct isl_ctx_stats.
+ * "name" is the name under which it can be retrieved
+ * using isl_ctx_get_stat, "label" is the description printed
+ * by print_stats (NULL if it is not printed), "offset"
+ * is the offset of the field in struct isl_ctx_stats and
+ * "merge" describes how it is combined by isl_ctx_merge_stats.
+ */
+struct isl_ctx_stat_desc {
+	const char *name;
+	const char *label;
+	size_t offset;
+	enum isl_ctx_stat_merge merge;
+};
+
+#define ISL_CTX_STAT_MERGE(field, label, merge)				\
+	{ #field, label, offsetof(struct isl_ctx_stats, field), merge }
+#define ISL_CTX_STAT(field, label)					\
+	ISL_CTX_STAT_MERGE(field, label, isl_ctx_stat_add)
+
+/* The statistics of an isl_ctx, in the order in which
+ * they are printed.
+ */
+static struct isl_ctx_stat_desc isl_ctx_stat_desc[] = {
+	ISL_CTX_STAT_MERGE(memory, NULL, isl_ctx_stat_keep),
+	ISL_CTX_STAT(int_pool_hits, "int pool hits"),
+	ISL_CTX_STAT(int_pool_misses, "int pool misses"),
+	ISL_CTX_STAT(blk_cache_hits, "block cache hits"),
+	ISL_CTX_STAT(blk_cache_misses, "block cache misses"),
+	ISL_CTX_STAT_MERGE(peak_memory, "peak memory", isl_ctx_stat_max),
+	ISL_CTX_STAT(arena_memory, "arena memory"),
+	ISL_CTX_STAT(free_list_hits, "free list hits"),
+	ISL_CTX_STAT(free_list_misses, "free list misses"),
+	ISL_CTX_STAT(primal_pivots, "primal pivots"),
+	ISL_CTX_STAT(dual_pivots, "dual pivots"),
+	ISL_CTX_STAT(bound_prop_hits, "bound propagation hits"),
+	ISL_CTX_STAT(bound_prop_misses, "bound propagation misses"),
+	ISL_CTX_STAT(float_filter_hits, "float filter hits"),
+	ISL_CTX_STAT(float_filter_misses, "float filter misses"),
+	ISL_CTX_STAT(sample_nodes, "sample nodes"),
+	ISL_CTX_STAT(pivots, "pivots"),
+	ISL_CTX_STAT(degenerate_pivots, "degenerate pivots"),
+	ISL_CTX_STAT(tab_allocs, "tableau allocations"),
+	ISL_CTX_STAT(batch_irredundant, "batch irredundant"),
+	ISL_CTX_STAT(redundancy_lps, "redundancy LPs"),
+	ISL_CTX_STAT(sample_cache_hits, "sample cache hits"),
+	ISL_CTX_STAT(sample_cache_misses, "sample cache misses"),
+	ISL_CTX_STAT(pip_inherited_signs, "pip inherited signs"),
+	ISL_CTX_STAT(pip_hard_lexmin_checks, "pip hard lexmin checks"),
+	ISL_CTX_STAT(pip_context_switches, "pip context switches"),
+	ISL_CTX_STAT(pip_shifted, "pip shifted"),
+	ISL_CTX_STAT(gbr_solved_lps, "gbr solved LPs"),
+	ISL_CTX_STAT(gbr_basis_reuses, "gbr basis reuses"),
+	ISL_CTX_STAT(gbr_lll_swaps, "gbr lll swaps"),
+	ISL_CTX_STAT(coalesce_pairs_tested, "coalesce pairs tested"),
+	ISL_CTX_STAT(coalesce_pairs_skipped, "coalesce pairs skipped"),
+	ISL_CTX_STAT(simplify_budget_exhausted,
+		"simplification budget exhausted"),
+	ISL_CTX_STAT(pw_pairs_tested, "piecewise pairs tested"),
+	ISL_CTX_STAT(pw_pairs_skipped, "piecewise pairs skipped"),
+	ISL_CTX_STAT(reordering_cache_hits, "reordering cache hits"),
+	ISL_CTX_STAT(reordering_cache_misses, "reordering cache misses"),
+	ISL_CTX_STAT(affine_hull_hits, "affine hull hits"),
+	ISL_CTX_STAT(affine_hull_misses, "affine hull misses"),
+	ISL_CTX_STAT(fm_pruned, "Fourier-Motzkin combinations pruned"),
+	ISL_CTX_STAT(flow_cache_hits, "flow cache hits"),
+	ISL_CTX_STAT(flow_cache_misses, "flow cache misses"),
+	ISL_CTX_STAT(flow_sources_pruned, "flow sources pruned"),
+	ISL_CTX_STAT(flow_lexmax_memo_hits, "flow lexmax memo hits"),
+	ISL_CTX_STAT(sched_graph_us, "scheduler graph construction time (us)"),
+	ISL_CTX_STAT(sched_graph_ops,
+		"scheduler graph construction operations"),
+	ISL_CTX_STAT(sched_coef_us, "scheduler coefficients time (us)"),
+	ISL_CTX_STAT(sched_coef_ops, "scheduler coefficients operations"),
+	ISL_CTX_STAT(sched_setup_us, "scheduler LP setup time (us)"),
+	ISL_CTX_STAT(sched_setup_ops, "scheduler LP setup operations"),
+	ISL_CTX_STAT(sched_solve_us, "scheduler LP solving time (us)"),
+	ISL_CTX_STAT(sched_solve_ops, "scheduler LP solving operations"),
+	ISL_CTX_STAT(sched_feautrier_us, "scheduler Feautrier steps time (us)"),
+	ISL_CTX_STAT(sched_feautrier_ops,
+		"scheduler Feautrier steps operations"),
+	ISL_CTX_STAT(schedule_cache_hits, "schedule cache hits"),
+	ISL_CTX_STAT(schedule_cache_misses, "schedule cache misses"),
+	ISL_CTX_STAT(closure_cache_hits, "closure cache hits"),
+	ISL_CTX_STAT(closure_cache_misses, "closure cache misses"),
+	ISL_CTX_STAT(compression_cache_hits, "compression cache hits"),
+	ISL_CTX_STAT(compression_cache_misses, "compression cache misses"),
+	ISL_CTX_STAT(coefficients_cache_hits, "coefficients cache hits"),
+	ISL_CTX_STAT(coefficients_cache_misses, "coefficients cache misses"),
+	ISL_CTX_STAT(ast_reuse_hits, "AST subtree reuse hits"),
+	ISL_CTX_STAT(ast_reuse_misses, "AST subtree reuse misses"),
+	ISL_CTX_STAT(ast_unroll_degraded, "AST unrolling degraded to atomic"),
+	ISL_CTX_STAT(ast_separate_degraded,
+		"AST separation degraded to atomic"),
+	ISL_CTX_STAT(hash_lookups, "hash table lookups"),
+	ISL_CTX_STAT(hash_probes, "hash table probes"),
+	ISL_CTX_STAT_MERGE(hash_max_probe, "hash table maximal probe length",
+		isl_ctx_stat_max),
+	ISL_CTX_STAT(equal_fast_hits, "equality fast path hits"),
+	ISL_CTX_STAT(equal_fast_misses, "equality fast path misses"),
+	ISL_CTX_STAT(ast_expr_memo_hits, "AST expression memo hits"),
+	ISL_CTX_STAT(ast_expr_memo_misses, "AST expression memo misses"),
+};
+
+/* Return a pointer to the statistic described by "desc" in "stats".
+ */
+static long *stat_field(struct isl_ctx_stats *stats,
+	struct isl_ctx_stat_desc *desc)
+{
+	return (long *) ((char *) stats + desc->offset);
+}
+
+/* Combine the statistics of the worker "worker" with those of "ctx".
+ * The memory that is still in use by "worker" is not taken into
+ * account, but since the worker ran while "ctx" was using
+ * its current amount of memory, its peak memory usage
+ * is taken relative to this amount.
+ */
+void isl_ctx_merge_stats(isl_ctx *ctx, isl_ctx *worker)
+{
+	int i;
+
+	if (!ctx || !worker)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(isl_ctx_stat_desc); ++i) {
+		struct isl_ctx_stat_desc *desc = &isl_ctx_stat_desc[i];
+		long *dst = stat_field(ctx->stats, desc);
+		long src = *stat_field(worker->stats, desc);
+
+		if (desc->offset == offsetof(struct isl_ctx_stats, peak_memory))
+			src += ctx->stats->memory;
+		if (desc->merge == isl_ctx_stat_add)
+			*dst += src;
+		else if (desc->merge == isl_ctx_stat_max && src > *dst)
+			*dst = src;
+	}
+}
+
+/* Reset the statistics of the worker "worker" that are combined
+ * with those of another isl_ctx by isl_ctx_merge_stats.
+ * The peak memory usage is reset to the current memory usage.
+ */
+static void reset_merged_stats(isl_ctx *worker)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(isl_ctx_stat_desc); ++i) {
+		struct isl_ctx_stat_desc *desc = &isl_ctx_stat_desc[i];
+
+		if (desc->merge != isl_ctx_stat_keep)
+			*stat_field(worker->stats, desc) = 0;
+	}
+	worker->stats->peak_memory = worker->stats->memory;
+}
+
+/* Add the operations and the statistics of the worker "worker"
+ * to those of "ctx" and reset them in "worker", such that
+ * they are not added again after a later computation in "worker".
+ * Any objects computed by "worker" need to have been imported
+ * into "ctx" (or freed) before.
+ * This function should only be called after the worker thread
+ * has finished.
+ */
+void isl_ctx_collect_worker(isl_ctx *ctx, isl_ctx *worker)
+{
+	if (!ctx || !worker)
+		return;
+
+	ctx->operations += worker->operations;
+	isl_ctx_merge_stats(ctx, worker);
+	worker->operations = 0;
+	reset_merged_stats(worker);
+}
+
+/* Add the operations and the statistics of the worker "worker"
+ * (allocated by isl_ctx_alloc_worker) to those of "ctx" and
+ * free "worker".
+ */
+void isl_ctx_free_worker(isl_ctx *ctx, isl_ctx *worker)
+{
+	isl_ctx_collect_worker(ctx, worker);
+	isl_ctx_free(worker);
+}
+
 /* Print statistics on usage.
  */
 static void print_stats(isl_ctx *ctx)
 {
+	int i;
+
 	fprintf(stderr, "operations: %lu\n", ctx->operations);
+	for (i = 0; i < ARRAY_SIZE(isl_ctx_stat_desc); ++i) {
+		struct isl_ctx_stat_desc *desc = &isl_ctx_stat_desc[i];
+
+		if (!desc->label)
+			continue;
+		fprintf(stderr, "%s: %ld\n",
+			desc->label, *stat_field(ctx->stats, desc));
+	}
 }
 
 void isl_ctx_free(struct isl_ctx *ctx)
 {
 	if (!ctx)
 		return;
+	isl_thread_team_free(ctx);
+	isl_sample_cache_clear(ctx);
+	isl_flow_cache_clear(ctx);
+	isl_closure_cache_clear(ctx);
+	isl_reordering_cache_clear(ctx);
+	isl_compression_cache_clear(ctx);
+	isl_coefficients_cache_clear(ctx);
 	if (ctx->ref != 0)
 		isl_die(ctx, isl_error_invalid,
 			"isl_ctx freed, but some objects still reference it",
@@ -246,8 +701,23 @@ void isl_ctx_free(struct isl_ctx *ctx)
 
 	if (ctx->opt->print_stats)
 		print_stats(ctx);
+	if (ctx->opt->profile || ctx->opt->profile_allocations)
+		isl_ctx_dump_profile(ctx);
+	isl_profile_free(ctx);
+	isl_ctx_set_trace_callback(ctx, NULL, NULL);
 
 	isl_hash_table_clear(&ctx->id_table);
+	isl_hash_table_clear(&ctx->name_table);
+	isl_hash_table_clear(&ctx->sample_cache);
+	isl_hash_table_clear(&ctx->flow_cache);
+	isl_hash_table_clear(&ctx->closure_cache);
+	isl_hash_table_clear(&ctx->compression_cache);
+	isl_hash_table_clear(&ctx->coefficients_cache);
+	isl_tab_clear_free_list(ctx);
+	isl_mat_clear_free_list(ctx);
+	isl_vec_clear_free_list(ctx);
+	isl_ast_clear_free_list(ctx);
+	isl_ast_build_clear_free_list(ctx);
 	isl_blk_clear_cache(ctx);
 	isl_int_clear(ctx->zero);
 	isl_int_clear(ctx->one);
@@ -284,21 +754,59 @@ void isl_ctx_set_error(isl_ctx *ctx, enum isl_error error)
 		ctx->error = error;
 }
 
+/* Request any computation running in "ctx" to be aborted.
+ * This function may be called from a thread other than the one
+ * performing the computation.
+ */
 void isl_ctx_abort(isl_ctx *ctx)
 {
-	if (ctx)
-		ctx->abort = 1;
+	if (!ctx)
+		return;
+#ifdef ISL_HAVE_ATOMICS
+	atomic_store_explicit(&ctx->abort, 1, memory_order_relaxed);
+#else
+	ctx->abort = 1;
+#endif
 }
 
 void isl_ctx_resume(isl_ctx *ctx)
 {
-	if (ctx)
-		ctx->abort = 0;
+	if (!ctx)
+		return;
+#ifdef ISL_HAVE_ATOMICS
+	atomic_store_explicit(&ctx->abort, 0, memory_order_relaxed);
+#else
+	ctx->abort = 0;
+#endif
 }
 
 int isl_ctx_aborted(isl_ctx *ctx)
 {
-	return ctx ? ctx->abort : -1;
+	if (!ctx)
+		return -1;
+#ifdef ISL_HAVE_ATOMICS
+	return atomic_load_explicit(&ctx->abort, memory_order_relaxed);
+#else
+	return ctx->abort;
+#endif
+}
+
+/* Make computations in "ctx" fail with an isl_error_timeout error
+ * once "ms" milliseconds have passed from the time of this call.
+ * A value of zero removes any deadline.
+ * The deadline is checked periodically while "ctx" performs operations,
+ * so computations may run slightly past the deadline
+ * before they fail.
+ */
+void isl_ctx_set_deadline(isl_ctx *ctx, unsigned long ms)
+{
+	if (!ctx)
+		return;
+	ctx->has_deadline = ms != 0;
+	ctx->deadline_expired = 0;
+	ctx->deadline_countdown = 1;
+	if (ms)
+		ctx->deadline = isl_monotonic_time() + 1e-3 * ms;
 }
 
 int isl_ctx_parse_options(isl_ctx *ctx, int argc, char **argv, unsigned flags)
@@ -324,6 +832,82 @@ unsigned long isl_ctx_get_max_operations(isl_ctx *ctx)
 	return ctx ? ctx->max_operations : 0;
 }
 
+/* Set the maximal number of bytes of integer storage
+ * that may be allocated by "ctx" to "max_memory".
+ * A value of zero means that no bound is imposed.
+ */
+void isl_ctx_set_max_memory(isl_ctx *ctx, unsigned long max_memory)
+{
+	if (!ctx)
+		return;
+	ctx->max_memory = max_memory;
+}
+
+/* Return the maximal number of bytes of integer storage of "ctx".
+ */
+unsigned long isl_ctx_get_max_memory(isl_ctx *ctx)
+{
+	return ctx ? ctx->max_memory : 0;
+}
+
+/* Start deferring the release of the integer storage of objects
+ * freed in "ctx".
+ * While the release is deferred, the blocks of integers of freed objects
+ * are simply kept by "ctx", without clearing the individual integers,
+ * and they are reused by subsequent allocations.
+ * Calls may be nested.
+ */
+void isl_ctx_defer_free(isl_ctx *ctx)
+{
+	isl_blk_scope_enter(ctx);
+}
+
+/* Stop deferring the release of integer storage started
+ * by the matching call to isl_ctx_defer_free.
+ * When the outermost call is matched, all blocks kept by "ctx"
+ * beyond the blk_cache_size option are released in one go,
+ * on a background thread if the deferred_free_thread option is set
+ * and the threads option is greater than one.
+ * Any remaining blocks are released by isl_ctx_free.
+ */
+void isl_ctx_drain_deferred_free(isl_ctx *ctx)
+{
+	if (!ctx)
+		return;
+	if (ctx->blk_cache.scope <= 0)
+		isl_die(ctx, isl_error_invalid,
+			"no matching call to isl_ctx_defer_free", return);
+	isl_blk_scope_leave(ctx);
+}
+
+/* Return the value of the usage statistic called "name"
+ * collected by "ctx".
+ * Return -1 if there is no such statistic.
+ */
+long isl_ctx_get_stat(isl_ctx *ctx, const char *name)
+{
+	int i;
+
+	if (!ctx || !name)
+		return -1;
+	for (i = 0; i < ARRAY_SIZE(isl_ctx_stat_desc); ++i)
+		if (!strcmp(isl_ctx_stat_desc[i].name, name))
+			return *stat_field(ctx->stats, &isl_ctx_stat_desc[i]);
+	isl_die(ctx, isl_error_invalid, "unknown statistic", return -1);
+}
+
+/* Has a simplification that started when "ctx" had performed
+ * "start" tableau pivots used up the budget set by
+ * the simplify_budget option?
+ * A non-positive budget means that there is no limit.
+ */
+int isl_ctx_simplify_budget_exhausted(isl_ctx *ctx, long start)
+{
+	if (ctx->opt->simplify_budget <= 0)
+		return 0;
+	return ctx->stats->pivots - start >= ctx->opt->simplify_budget;
+}
+
 /* Reset the number of operations performed by "ctx".
  */
 void isl_ctx_reset_operations(isl_ctx *ctx)
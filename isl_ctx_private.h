@@ -1,10 +1,107 @@
+#include <time.h>
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && \
+    !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+#define ISL_HAVE_ATOMICS
+#endif
 #include <isl/ctx.h>
+#include <isl/stdint.h>
 #include <isl_blk.h>
 
+struct isl_sample_cache_entry;
+struct isl_flow_cache_entry;
+struct isl_closure_cache_entry;
+struct isl_compression_cache_entry;
+struct isl_coefficients_cache_entry;
+struct isl_profile_node;
+struct isl_thread_team;
+struct isl_reordering;
+struct isl_schedule;
+struct isl_schedule_constraints;
+
+/* Usage statistics of an isl_ctx.
+ * They can be read by name through isl_ctx_get_stat.
+ */
+struct isl_ctx_stats {
+	long	gbr_solved_lps;
+	long	gbr_basis_reuses;
+	long	gbr_lll_swaps;
+	long	int_pool_hits;
+	long	int_pool_misses;
+	long	blk_cache_hits;
+	long	blk_cache_misses;
+	long	memory;
+	long	peak_memory;
+	long	arena_memory;
+	long	free_list_hits;
+	long	free_list_misses;
+	long	primal_pivots;
+	long	dual_pivots;
+	long	bound_prop_hits;
+	long	bound_prop_misses;
+	long	float_filter_hits;
+	long	float_filter_misses;
+	long	sample_nodes;
+	long	pivots;
+	long	degenerate_pivots;
+	long	tab_allocs;
+	long	batch_irredundant;
+	long	redundancy_lps;
+	long	sample_cache_hits;
+	long	sample_cache_misses;
+	long	pip_inherited_signs;
+	long	pip_hard_lexmin_checks;
+	long	pip_context_switches;
+	long	pip_shifted;
+	long	coalesce_pairs_tested;
+	long	coalesce_pairs_skipped;
+	long	simplify_budget_exhausted;
+	long	pw_pairs_tested;
+	long	pw_pairs_skipped;
+	long	reordering_cache_hits;
+	long	reordering_cache_misses;
+	long	affine_hull_hits;
+	long	affine_hull_misses;
+	long	fm_pruned;
+	long	flow_cache_hits;
+	long	flow_cache_misses;
+	long	flow_sources_pruned;
+	long	flow_lexmax_memo_hits;
+	long	sched_graph_us;
+	long	sched_graph_ops;
+	long	sched_coef_us;
+	long	sched_coef_ops;
+	long	sched_setup_us;
+	long	sched_setup_ops;
+	long	sched_solve_us;
+	long	sched_solve_ops;
+	long	sched_feautrier_us;
+	long	sched_feautrier_ops;
+	long	schedule_cache_hits;
+	long	schedule_cache_misses;
+	long	closure_cache_hits;
+	long	closure_cache_misses;
+	long	compression_cache_hits;
+	long	compression_cache_misses;
+	long	coefficients_cache_hits;
+	long	coefficients_cache_misses;
+	long	ast_reuse_hits;
+	long	ast_reuse_misses;
+	long	ast_unroll_degraded;
+	long	ast_separate_degraded;
+	long	hash_lookups;
+	long	hash_probes;
+	long	hash_max_probe;
+	long	equal_fast_hits;
+	long	equal_fast_misses;
+	long	ast_expr_memo_hits;
+	long	ast_expr_memo_misses;
+};
+
 struct isl_ctx {
 	int			ref;
 
-	struct isl_stats	*stats;
+	struct isl_ctx_stats	*stats;
 
 	int			 opt_allocated;
 	struct isl_options	*opt;
@@ -18,17 +115,203 @@ struct isl_ctx {
 
 	isl_int			normalize_gcd;
 
-	int			n_cached;
-	int			n_miss;
-	struct isl_blk		cache[ISL_BLK_CACHE_SIZE];
+	struct isl_blk_cache	blk_cache;
+	int			n_int_pool;
+	int			int_pool_size;
+	isl_int			*int_pool;
+
+	/* Released objects kept for later reuse.
+	 * isl_mat objects keep their row arrays, with room
+	 * for at least n_row rows, while isl_tab objects keep
+	 * their var, con, col_var and row_var arrays, with room
+	 * for at least max_var variables and max_con constraints.
+	 */
+#define ISL_FREE_LIST_SIZE	8
+	int			n_free_vec;
+	struct isl_vec		*free_vec[ISL_FREE_LIST_SIZE];
+	int			n_free_mat;
+	struct isl_mat		*free_mat[ISL_FREE_LIST_SIZE];
+	int			n_free_tab;
+	struct isl_tab		*free_tab[ISL_FREE_LIST_SIZE];
+
+	/* Released AST expressions and nodes.  ASTs consist of
+	 * many small objects, so more of them are kept.
+	 */
+#define ISL_AST_FREE_LIST_SIZE	256
+	int			n_free_ast_expr;
+	struct isl_ast_expr	*free_ast_expr[ISL_AST_FREE_LIST_SIZE];
+	int			n_free_ast_node;
+	struct isl_ast_node	*free_ast_node[ISL_AST_FREE_LIST_SIZE];
+
+	/* Released AST builds.  A build is derived for every level
+	 * and every piece during AST generation, while its fields
+	 * are shared with the build from which it is derived.
+	 */
+	int			n_free_ast_build;
+	struct isl_ast_build	*free_ast_build[ISL_FREE_LIST_SIZE];
+
+	/* The names of the isl_ids in id_table, each stored only once. */
+	struct isl_hash_table	name_table;
 	struct isl_hash_table	id_table;
 
+	/* Recently computed parameter alignment reorderings,
+	 * from most recently to least recently used,
+	 * along with the parameter space of the alignee and
+	 * the aligner space from which they were computed.
+	 */
+#define ISL_REORDERING_CACHE_SIZE	8
+	int			n_reordering_cache;
+	struct isl_space	*reordering_alignee[ISL_REORDERING_CACHE_SIZE];
+	struct isl_space	*reordering_aligner[ISL_REORDERING_CACHE_SIZE];
+	struct isl_reordering	*reordering_cache[ISL_REORDERING_CACHE_SIZE];
+
+	/* Number of integer feasibility checks in lexmin contexts
+	 * that required many cuts and whether the adaptive
+	 * context mode has switched to gbr contexts as a result.
+	 */
+	int			pip_hard_lexmin;
+	int			pip_adaptive_gbr;
+
+	/* Results of earlier sampling operations, indexed by a hash
+	 * of the constraints.  The entries are also kept in a list
+	 * ordered from most recently to least recently used.
+	 */
+	struct isl_hash_table	sample_cache;
+	int			n_sample_cache;
+	struct isl_sample_cache_entry	*sample_cache_first;
+	struct isl_sample_cache_entry	*sample_cache_last;
+
+	/* Results of earlier dataflow analyses of individual sink accesses,
+	 * indexed by a hash of the sink and the potential sources.
+	 * The entries are also kept in a list ordered from most recently
+	 * to least recently used.
+	 */
+	struct isl_hash_table	flow_cache;
+	int			n_flow_cache;
+	struct isl_flow_cache_entry	*flow_cache_first;
+	struct isl_flow_cache_entry	*flow_cache_last;
+
+	/* Results of earlier power and transitive closure computations,
+	 * indexed by a hash of the input relation.
+	 * The entries are also kept in a list ordered from most recently
+	 * to least recently used.
+	 */
+	struct isl_hash_table	closure_cache;
+	int			n_closure_cache;
+	struct isl_closure_cache_entry	*closure_cache_first;
+	struct isl_closure_cache_entry	*closure_cache_last;
+
+	/* Results of earlier variable and parameter compressions,
+	 * indexed by a hash of the space and the equalities of the input.
+	 * The entries are also kept in a list ordered from most recently
+	 * to least recently used.
+	 */
+	struct isl_hash_table	compression_cache;
+	int			n_compression_cache;
+	struct isl_compression_cache_entry	*compression_cache_first;
+	struct isl_compression_cache_entry	*compression_cache_last;
+
+	/* Results of earlier computations of coefficients and solutions
+	 * of basic sets, indexed by a hash of the space and
+	 * the constraints of the input.
+	 * The entries are also kept in a list ordered from most recently
+	 * to least recently used.
+	 */
+	struct isl_hash_table	coefficients_cache;
+	int			n_coefficients_cache;
+	struct isl_coefficients_cache_entry	*coefficients_cache_first;
+	struct isl_coefficients_cache_entry	*coefficients_cache_last;
+
+	/* The phase of the scheduler that is currently being timed
+	 * (zero if none) and the processor time of the calling thread
+	 * and the number of operations at the start of the current
+	 * timing interval.
+	 */
+	int			sched_phase;
+	double			sched_phase_clock;
+	unsigned long		sched_phase_operations;
+
+	/* The root of the call tree of profiled entry points
+	 * (NULL if nothing has been profiled yet) and
+	 * the node of the innermost active entry point.
+	 */
+	struct isl_profile_node	*profile;
+	struct isl_profile_node	*profile_current;
+
+	/* The callback (if any) that is called on the begin and
+	 * end events of the traced algorithms and its user argument.
+	 * If "trace_file" is set, then the callback writes
+	 * the events to this file and "trace_n" is the number
+	 * of events written so far.
+	 */
+	void			(*trace)(const char *name, int begin,
+				    double timestamp, const char *args,
+				    void *user);
+	void			*trace_user;
+	FILE			*trace_file;
+	long			trace_n;
+
+	/* User callbacks for looking up and storing schedules
+	 * computed by isl_schedule_constraints_compute_schedule.
+	 */
+	struct isl_schedule	*(*schedule_cache_load)(
+				    struct isl_schedule_constraints *sc,
+				    uint32_t hash, void *user);
+	int			(*schedule_cache_store)(
+				    struct isl_schedule_constraints *sc,
+				    uint32_t hash,
+				    struct isl_schedule *schedule, void *user);
+	void			*schedule_cache_user;
+
 	enum isl_error		error;
 
-	int			abort;
+	/* "abort" may be set from a different thread
+	 * while a computation is running in "ctx".
+	 */
+#ifdef ISL_HAVE_ATOMICS
+	atomic_int		abort;
+#else
+	volatile int		abort;
+#endif
+
+	/* If "has_deadline" is set, then computations fail once
+	 * the monotonic clock passes "deadline" (in seconds).
+	 * The clock is only consulted once every
+	 * "deadline_countdown" operations.
+	 */
+	int			has_deadline;
+	int			deadline_expired;
+	int			deadline_countdown;
+	double			deadline;
 
 	unsigned long		operations;
 	unsigned long		max_operations;
+	unsigned long		max_memory;
+
+	/* The isl_ctx on whose behalf this worker isl_ctx
+	 * performs a computation (NULL if this is not a worker).
+	 */
+	struct isl_ctx		*parent;
+
+	/* The worker isl_ctx objects and threads used by isl_thread_run
+	 * (NULL if they have not been needed yet) and
+	 * the executor set by isl_ctx_set_thread_executor (if any),
+	 * along with its user argument.
+	 */
+	struct isl_thread_team	*thread_team;
+	int			(*thread_execute)(int n,
+				    void (*task)(int i, void *data),
+				    void *data, void *user);
+	void			*thread_execute_user;
 };
 
+isl_ctx *isl_ctx_alloc_worker(isl_ctx *ctx);
+int isl_ctx_prepare_worker(isl_ctx *ctx, isl_ctx *worker);
+void isl_ctx_collect_worker(isl_ctx *ctx, isl_ctx *worker);
+void isl_ctx_free_worker(isl_ctx *ctx, isl_ctx *worker);
+void isl_ctx_merge_stats(isl_ctx *ctx, isl_ctx *worker);
+
 int isl_ctx_next_operation(isl_ctx *ctx);
+int isl_ctx_simplify_budget_exhausted(isl_ctx *ctx, long start);
+double isl_monotonic_time(void);
+double isl_thread_cpu_time(void);
@@ -0,0 +1,570 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <string.h>
+#include <isl_ctx_private.h>
+#include <isl_map_private.h>
+#include <isl_space_private.h>
+#include <isl_dim_map.h>
+#include <isl_seq.h>
+
+enum isl_dim_edit_type {
+	isl_dim_edit_insert,
+	isl_dim_edit_move,
+	isl_dim_edit_project_out,
+	isl_dim_edit_set_name
+};
+
+/* A single edit in a sequence of dimension edits.
+ * "type" and "pos" are the type and position of the first affected
+ * dimension, i.e., the destination in case of a move, and "n" is
+ * the number of affected dimensions.
+ * In case of a move, "src_type" and "src_pos" describe the source.
+ * In case of a rename, "name" is the new name of the dimension.
+ */
+struct isl_dim_edit {
+	enum isl_dim_edit_type op;
+	enum isl_dim_type type;
+	unsigned pos;
+	enum isl_dim_type src_type;
+	unsigned src_pos;
+	unsigned n;
+	char *name;
+};
+
+/* A sequence of "n" dimension edits that are applied in order.
+ * "n_project" is the number of edits that project out dimensions.
+ */
+struct isl_dim_edits {
+	int ref;
+	isl_ctx *ctx;
+
+	int n_project;
+
+	int n;
+	int size;
+	struct isl_dim_edit *edit;
+};
+
+__isl_give isl_dim_edits *isl_dim_edits_alloc(isl_ctx *ctx)
+{
+	isl_dim_edits *edits;
+
+	edits = isl_calloc_type(ctx, isl_dim_edits);
+	if (!edits)
+		return NULL;
+
+	edits->ref = 1;
+	edits->ctx = ctx;
+	isl_ctx_ref(ctx);
+
+	return edits;
+}
+
+__isl_give isl_dim_edits *isl_dim_edits_copy(__isl_keep isl_dim_edits *edits)
+{
+	if (!edits)
+		return NULL;
+
+	edits->ref++;
+	return edits;
+}
+
+__isl_null isl_dim_edits *isl_dim_edits_free(__isl_take isl_dim_edits *edits)
+{
+	int i;
+
+	if (!edits)
+		return NULL;
+	if (--edits->ref > 0)
+		return NULL;
+
+	for (i = 0; i < edits->n; ++i)
+		free(edits->edit[i].name);
+	free(edits->edit);
+	isl_ctx_deref(edits->ctx);
+	free(edits);
+
+	return NULL;
+}
+
+isl_ctx *isl_dim_edits_get_ctx(__isl_keep isl_dim_edits *edits)
+{
+	return edits ? edits->ctx : NULL;
+}
+
+static __isl_give isl_dim_edits *isl_dim_edits_dup(
+	__isl_keep isl_dim_edits *edits)
+{
+	int i;
+	isl_dim_edits *dup;
+
+	if (!edits)
+		return NULL;
+
+	dup = isl_dim_edits_alloc(edits->ctx);
+	if (!dup)
+		return NULL;
+	dup->edit = isl_alloc_array(edits->ctx, struct isl_dim_edit, edits->n);
+	if (edits->n && !dup->edit)
+		return isl_dim_edits_free(dup);
+	dup->size = edits->n;
+	for (i = 0; i < edits->n; ++i) {
+		dup->edit[i] = edits->edit[i];
+		dup->edit[i].name = NULL;
+		dup->n++;
+		if (!edits->edit[i].name)
+			continue;
+		dup->edit[i].name = strdup(edits->edit[i].name);
+		if (!dup->edit[i].name)
+			return isl_dim_edits_free(dup);
+	}
+	dup->n_project = edits->n_project;
+
+	return dup;
+}
+
+static __isl_give isl_dim_edits *isl_dim_edits_cow(
+	__isl_take isl_dim_edits *edits)
+{
+	if (!edits)
+		return NULL;
+
+	if (edits->ref == 1)
+		return edits;
+	edits->ref--;
+	return isl_dim_edits_dup(edits);
+}
+
+/* Append the edit "edit" to "edits".
+ * If "name" is not NULL, then a copy is stored in the appended edit.
+ */
+static __isl_give isl_dim_edits *add_edit(__isl_take isl_dim_edits *edits,
+	struct isl_dim_edit *edit, const char *name)
+{
+	struct isl_dim_edit *e;
+
+	edits = isl_dim_edits_cow(edits);
+	if (!edits)
+		return NULL;
+
+	if (edits->n >= edits->size) {
+		edits->size = 2 * edits->size + 4;
+		edits->edit = isl_realloc_array(edits->ctx, edits->edit,
+					struct isl_dim_edit, edits->size);
+		if (!edits->edit)
+			return isl_dim_edits_free(edits);
+	}
+
+	e = &edits->edit[edits->n];
+	*e = *edit;
+	e->name = NULL;
+	if (name) {
+		e->name = strdup(name);
+		if (!e->name)
+			return isl_dim_edits_free(edits);
+	}
+	edits->n++;
+	if (e->op == isl_dim_edit_project_out)
+		edits->n_project++;
+
+	return edits;
+}
+
+/* Append an edit that inserts "n" dimensions of type "type"
+ * at position "pos".
+ */
+__isl_give isl_dim_edits *isl_dim_edits_insert(__isl_take isl_dim_edits *edits,
+	enum isl_dim_type type, unsigned pos, unsigned n)
+{
+	struct isl_dim_edit edit = { isl_dim_edit_insert, type, pos };
+
+	edit.n = n;
+	return add_edit(edits, &edit, NULL);
+}
+
+/* Append an edit that moves "n" dimensions of type "src_type"
+ * starting at "src_pos" to position "dst_pos" of type "dst_type".
+ */
+__isl_give isl_dim_edits *isl_dim_edits_move(__isl_take isl_dim_edits *edits,
+	enum isl_dim_type dst_type, unsigned dst_pos,
+	enum isl_dim_type src_type, unsigned src_pos, unsigned n)
+{
+	struct isl_dim_edit edit = { isl_dim_edit_move, dst_type, dst_pos,
+					src_type, src_pos, n };
+
+	return add_edit(edits, &edit, NULL);
+}
+
+/* Append an edit that projects out the "n" dimensions of type "type"
+ * starting at "first".
+ */
+__isl_give isl_dim_edits *isl_dim_edits_project_out(
+	__isl_take isl_dim_edits *edits,
+	enum isl_dim_type type, unsigned first, unsigned n)
+{
+	struct isl_dim_edit edit = { isl_dim_edit_project_out, type, first };
+
+	edit.n = n;
+	return add_edit(edits, &edit, NULL);
+}
+
+/* Append an edit that sets the name of dimension "pos" of type "type"
+ * to "s".
+ */
+__isl_give isl_dim_edits *isl_dim_edits_set_dim_name(
+	__isl_take isl_dim_edits *edits,
+	enum isl_dim_type type, unsigned pos, const char *s)
+{
+	struct isl_dim_edit edit = { isl_dim_edit_set_name, type, pos };
+
+	edit.n = 1;
+	return add_edit(edits, &edit, s);
+}
+
+/* The effect of a sequence of dimension edits on the variables
+ * of a basic map, other than its existentially quantified variables.
+ *
+ * For each of the parameters, input and output dimensions
+ * of the result, "pos" contains the position of the corresponding
+ * variable in the original basic map or -1 if the dimension
+ * was inserted.  The dimensions of type "t" are stored in pos[t - 1]
+ * and "n" has the same layout.
+ * "proj" contains the positions of the "n_proj" original variables
+ * that have been projected out.
+ */
+struct isl_dim_edits_layout {
+	int n[3];
+	int *pos[3];
+	int n_proj;
+	int *proj;
+};
+
+static void layout_clear(struct isl_dim_edits_layout *layout)
+{
+	int t;
+
+	for (t = 0; t < 3; ++t)
+		free(layout->pos[t]);
+	free(layout->proj);
+}
+
+/* Remove the "n" dimensions of type "type" starting at "first"
+ * from "layout", storing their original positions in "removed".
+ */
+static void layout_remove(struct isl_dim_edits_layout *layout,
+	enum isl_dim_type type, unsigned first, unsigned n, int *removed)
+{
+	int i;
+	int t = type - isl_dim_param;
+	int *pos = layout->pos[t];
+
+	for (i = 0; i < n; ++i)
+		removed[i] = pos[first + i];
+	for (i = first; i + n < layout->n[t]; ++i)
+		pos[i] = pos[i + n];
+	layout->n[t] -= n;
+}
+
+/* Insert "n" dimensions of type "type" at position "first" in "layout"
+ * with original positions "val" or -1 if "val" is NULL.
+ */
+static void layout_insert(struct isl_dim_edits_layout *layout,
+	enum isl_dim_type type, unsigned first, unsigned n, int *val)
+{
+	int i;
+	int t = type - isl_dim_param;
+	int *pos = layout->pos[t];
+
+	for (i = layout->n[t] - 1; i >= (int) first; --i)
+		pos[i + n] = pos[i];
+	for (i = 0; i < n; ++i)
+		pos[first + i] = val ? val[i] : -1;
+	layout->n[t] += n;
+}
+
+/* Apply "edit" to "space" and, if the result is valid, to "layout".
+ * "tmp" has room for the original positions of the moved dimensions.
+ */
+static __isl_give isl_space *apply_edit(__isl_take isl_space *space,
+	struct isl_dim_edit *edit, struct isl_dim_edits_layout *layout,
+	int *tmp)
+{
+	switch (edit->op) {
+	case isl_dim_edit_insert:
+		space = isl_space_insert_dims(space, edit->type, edit->pos,
+						edit->n);
+		if (space)
+			layout_insert(layout, edit->type, edit->pos, edit->n,
+					NULL);
+		break;
+	case isl_dim_edit_move:
+		space = isl_space_move_dims(space, edit->type, edit->pos,
+				edit->src_type, edit->src_pos, edit->n);
+		if (!space)
+			break;
+		layout_remove(layout, edit->src_type, edit->src_pos, edit->n,
+				tmp);
+		layout_insert(layout, edit->type, edit->pos, edit->n, tmp);
+		break;
+	case isl_dim_edit_project_out:
+		space = isl_space_drop_dims(space, edit->type, edit->pos,
+						edit->n);
+		if (!space)
+			break;
+		layout_remove(layout, edit->type, edit->pos, edit->n,
+				layout->proj + layout->n_proj);
+		layout->n_proj += edit->n;
+		break;
+	case isl_dim_edit_set_name:
+		space = isl_space_set_dim_name(space, edit->type, edit->pos,
+						edit->name);
+		break;
+	}
+
+	return space;
+}
+
+/* Apply "edits" to "space", returning the resulting space and
+ * storing the effect of the edits on the variables in "layout".
+ */
+static __isl_give isl_space *apply_edits(__isl_keep isl_dim_edits *edits,
+	__isl_take isl_space *space, struct isl_dim_edits_layout *layout)
+{
+	int i, t, total, cap, max_n = 0;
+	int *tmp = NULL;
+
+	memset(layout, 0, sizeof(*layout));
+	if (!edits || !space)
+		return isl_space_free(space);
+
+	total = isl_space_dim(space, isl_dim_all);
+	cap = total;
+	for (i = 0; i < edits->n; ++i) {
+		if (edits->edit[i].op == isl_dim_edit_insert)
+			cap += edits->edit[i].n;
+		if (edits->edit[i].n > max_n)
+			max_n = edits->edit[i].n;
+	}
+
+	for (t = 0; t < 3; ++t) {
+		enum isl_dim_type type = isl_dim_param + t;
+		int j, off = isl_space_offset(space, type);
+
+		layout->pos[t] = isl_alloc_array(edits->ctx, int, cap);
+		if (cap && !layout->pos[t])
+			return isl_space_free(space);
+		layout->n[t] = isl_space_dim(space, type);
+		for (j = 0; j < layout->n[t]; ++j)
+			layout->pos[t][j] = off + j;
+	}
+	layout->proj = isl_alloc_array(edits->ctx, int, cap);
+	tmp = isl_alloc_array(edits->ctx, int, max_n);
+	if ((cap && !layout->proj) || (max_n && !tmp))
+		space = isl_space_free(space);
+
+	for (i = 0; space && i < edits->n; ++i)
+		space = apply_edit(space, &edits->edit[i], layout, tmp);
+
+	free(tmp);
+	return space;
+}
+
+/* Apply the effect "layout" of a sequence of edits resulting
+ * in the space "space" to "bmap".
+ *
+ * All constraints are copied to the result in a single pass.
+ * The variables that are projected out are turned into
+ * existentially quantified variables without explicit representation,
+ * in front of the original existentially quantified variables,
+ * as in isl_basic_map_project_out.
+ */
+static __isl_give isl_basic_map *apply_layout(__isl_take isl_basic_map *bmap,
+	__isl_keep isl_space *space, struct isl_dim_edits_layout *layout)
+{
+	int i, t, k, off;
+	unsigned total, orig_total;
+	isl_dim_map *dim_map;
+	isl_basic_map *res;
+
+	if (!bmap || !space)
+		return isl_basic_map_free(bmap);
+
+	total = isl_space_dim(space, isl_dim_all);
+	orig_total = isl_space_dim(bmap->dim, isl_dim_all);
+	dim_map = isl_dim_map_alloc(bmap->ctx,
+				total + layout->n_proj + bmap->n_div);
+	off = 0;
+	for (t = 0; t < 3; ++t) {
+		for (i = 0; i < layout->n[t]; ++i)
+			if (layout->pos[t][i] >= 0)
+				isl_dim_map_range(dim_map, off + i, 0,
+					layout->pos[t][i], 0, 1, 1);
+		off += layout->n[t];
+	}
+	for (i = 0; i < layout->n_proj; ++i)
+		isl_dim_map_range(dim_map, total + i, 0,
+				layout->proj[i], 0, 1, 1);
+	isl_dim_map_range(dim_map, total + layout->n_proj, 1,
+				orig_total, 1, bmap->n_div, 1);
+
+	res = isl_basic_map_alloc_space(isl_space_copy(space),
+			layout->n_proj + bmap->n_div, bmap->n_eq, bmap->n_ineq);
+	if (isl_basic_map_is_rational(bmap))
+		res = isl_basic_map_set_rational(res);
+	if (isl_basic_map_plain_is_empty(bmap)) {
+		isl_basic_map_free(bmap);
+		free(dim_map);
+		return isl_basic_map_set_to_empty(res);
+	}
+	for (i = 0; res && i < layout->n_proj; ++i) {
+		k = isl_basic_map_alloc_div(res);
+		if (k < 0)
+			res = isl_basic_map_free(res);
+		else
+			isl_seq_clr(res->div[k], 2 + total + res->extra);
+	}
+	res = isl_basic_map_add_constraints_dim_map(res, bmap, dim_map);
+
+	if (layout->n_proj > 0) {
+		res = isl_basic_map_simplify(res);
+		res = isl_basic_map_drop_redundant_divs(res);
+	} else {
+		res = isl_basic_map_gauss(res, NULL);
+	}
+	return isl_basic_map_finalize(res);
+}
+
+/* Apply "edits" to "bmap" one by one using the functions
+ * that perform the individual edits.
+ */
+static __isl_give isl_basic_map *apply_one_by_one(
+	__isl_take isl_basic_map *bmap, __isl_keep isl_dim_edits *edits)
+{
+	int i;
+
+	for (i = 0; bmap && i < edits->n; ++i) {
+		struct isl_dim_edit *e = &edits->edit[i];
+
+		switch (e->op) {
+		case isl_dim_edit_insert:
+			bmap = isl_basic_map_insert_dims(bmap, e->type,
+							e->pos, e->n);
+			break;
+		case isl_dim_edit_move:
+			bmap = isl_basic_map_move_dims(bmap, e->type, e->pos,
+						e->src_type, e->src_pos, e->n);
+			break;
+		case isl_dim_edit_project_out:
+			bmap = isl_basic_map_project_out(bmap, e->type,
+							e->pos, e->n);
+			break;
+		case isl_dim_edit_set_name:
+			bmap = isl_basic_map_set_dim_name(bmap, e->type,
+							e->pos, e->name);
+			break;
+		}
+	}
+
+	return bmap;
+}
+
+/* Apply the effect "layout" of "edits", resulting in the space "space",
+ * to "bmap".
+ * Projecting out dimensions of a rational basic map requires
+ * Fourier-Motzkin elimination, so in this case, the edits
+ * are applied one by one.
+ */
+static __isl_give isl_basic_map *apply_to_basic_map(
+	__isl_take isl_basic_map *bmap, __isl_keep isl_dim_edits *edits,
+	__isl_keep isl_space *space, struct isl_dim_edits_layout *layout)
+{
+	if (!bmap)
+		return NULL;
+	if (edits->n_project > 0 && ISL_F_ISSET(bmap, ISL_BASIC_MAP_RATIONAL))
+		return apply_one_by_one(bmap, edits);
+	return apply_layout(bmap, space, layout);
+}
+
+/* Apply the sequence of dimension edits "edits" to "bmap".
+ * The result is the same as that of applying the corresponding
+ * isl_basic_map_insert_dims, isl_basic_map_move_dims,
+ * isl_basic_map_project_out and isl_basic_map_set_dim_name calls
+ * in order, but the constraints are only copied once.
+ */
+__isl_give isl_basic_map *isl_basic_map_apply_dim_edits(
+	__isl_take isl_basic_map *bmap, __isl_keep isl_dim_edits *edits)
+{
+	isl_space *space;
+	struct isl_dim_edits_layout layout;
+
+	if (!bmap || !edits)
+		return isl_basic_map_free(bmap);
+	if (edits->n == 0)
+		return bmap;
+
+	space = apply_edits(edits, isl_basic_map_get_space(bmap), &layout);
+	if (space)
+		bmap = apply_to_basic_map(bmap, edits, space, &layout);
+	else
+		bmap = isl_basic_map_free(bmap);
+	isl_space_free(space);
+	layout_clear(&layout);
+
+	return bmap;
+}
+
+__isl_give isl_basic_set *isl_basic_set_apply_dim_edits(
+	__isl_take isl_basic_set *bset, __isl_keep isl_dim_edits *edits)
+{
+	return isl_basic_map_apply_dim_edits(bset, edits);
+}
+
+/* Apply the sequence of dimension edits "edits" to "map".
+ * The effect of the edits on the space is only computed once
+ * and then applied to each of the basic maps.
+ */
+__isl_give isl_map *isl_map_apply_dim_edits(__isl_take isl_map *map,
+	__isl_keep isl_dim_edits *edits)
+{
+	int i;
+	isl_space *space;
+	struct isl_dim_edits_layout layout;
+
+	if (!map || !edits)
+		return isl_map_free(map);
+	if (edits->n == 0)
+		return map;
+
+	map = isl_map_cow(map);
+	if (!map)
+		return NULL;
+
+	space = apply_edits(edits, isl_map_get_space(map), &layout);
+	if (!space)
+		map = isl_map_free(map);
+	for (i = 0; map && i < map->n; ++i) {
+		map->p[i] = apply_to_basic_map(map->p[i], edits,
+						space, &layout);
+		if (!map->p[i])
+			map = isl_map_free(map);
+	}
+	if (map) {
+		isl_space_free(map->dim);
+		map->dim = isl_space_copy(space);
+		ISL_F_CLR(map, ISL_MAP_NORMALIZED);
+		if (edits->n_project > 0)
+			ISL_F_CLR(map, ISL_MAP_DISJOINT);
+	}
+	isl_space_free(space);
+	layout_clear(&layout);
+
+	return map;
+}
+
+__isl_give isl_set *isl_set_apply_dim_edits(__isl_take isl_set *set,
+	__isl_keep isl_dim_edits *edits)
+{
+	return isl_map_apply_dim_edits(set, edits);
+}
@@ -14,6 +14,7 @@
 #include <isl_space_private.h>
 #include <isl_dim_map.h>
 #include <isl_reordering.h>
+#include <isl_vec_private.h>
 
 struct isl_dim_map_entry {
 	int pos;
@@ -132,15 +133,47 @@ static void copy_div_dim_map(isl_int *dst, isl_int *src,
 	copy_constraint_dim_map(dst+1, src+1, dim_map);
 }
 
+/* Construct a sample point of "dst" from the cached sample point
+ * of "src", if any, by applying "dim_map", setting the coordinates
+ * that do not correspond to any coordinate of "src" to zero.
+ *
+ * This is only called when "dst" did not have any constraints
+ * before those of "src" were added, such that the result is
+ * a point of "dst" as long as the sample point of "src" is still valid.
+ * In any case, the validity of the sample point is checked before it
+ * is used, so an invalid point only costs a single containment test.
+ */
+static __isl_give isl_vec *sample_dim_map(__isl_keep isl_basic_map *dst,
+	__isl_keep isl_basic_map *src, struct isl_dim_map *dim_map)
+{
+	isl_vec *sample;
+
+	if (!src->sample ||
+	    src->sample->size != 1 + isl_basic_map_total_dim(src) ||
+	    dim_map->len != 1 + isl_basic_map_total_dim(dst))
+		return NULL;
+
+	sample = isl_vec_alloc(dst->ctx, dim_map->len);
+	if (!sample)
+		return NULL;
+	copy_constraint_dim_map(sample->el, src->sample->el, dim_map);
+
+	return sample;
+}
+
 __isl_give isl_basic_map *isl_basic_map_add_constraints_dim_map(
 	__isl_take isl_basic_map *dst, __isl_take isl_basic_map *src,
 	__isl_take isl_dim_map *dim_map)
 {
 	int i;
+	int fresh;
 
 	if (!src || !dst || !dim_map)
 		goto error;
 
+	fresh = !dst->sample && dst->n_eq == 0 && dst->n_ineq == 0 &&
+		dst->n_div == 0 && !ISL_F_ISSET(dst, ISL_BASIC_MAP_EMPTY);
+
 	for (i = 0; i < src->n_eq; ++i) {
 		int i1 = isl_basic_map_alloc_equality(dst);
 		if (i1 < 0)
@@ -162,6 +195,9 @@ __isl_give isl_basic_map *isl_basic_map_add_constraints_dim_map(
 		copy_div_dim_map(dst->div[i1], src->div[i], dim_map);
 	}
 
+	if (fresh)
+		dst->sample = sample_dim_map(dst, src, dim_map);
+
 	free(dim_map);
 	isl_basic_map_free(src);
 
@@ -329,3 +329,67 @@ error:
 	clear_groups(&g);
 	return NULL;
 }
+
+/* Return the number of groups of "f" that contain more than
+ * a single variable.
+ * Problems on the other groups can be solved directly.
+ */
+int isl_factorizer_n_nontrivial_group(__isl_keep isl_factorizer *f)
+{
+	int i, n = 0;
+
+	if (!f)
+		return -1;
+	for (i = 0; i < f->n_group; ++i)
+		if (f->len[i] > 1)
+			n++;
+	return n;
+}
+
+/* Apply the morphism of the non-trivial factorization "f" of "bset"
+ * to "bset" and return the factors of the result, i.e.,
+ * one basic set for each group of "f", involving only the parameters
+ * and the set variables of that group.
+ * Since the morphism is unimodular, problems such as sampling
+ * or counting can be solved on the factors separately,
+ * after which the results need to be combined and, if needed,
+ * mapped back through the inverse of the morphism.
+ */
+__isl_give isl_basic_set_list *isl_factorizer_factors(
+	__isl_keep isl_factorizer *f, __isl_take isl_basic_set *bset)
+{
+	int i, n;
+	unsigned nparam, nvar;
+	isl_basic_set_list *list;
+
+	if (!f || !bset)
+		goto error;
+
+	nparam = isl_basic_set_dim(bset, isl_dim_param);
+	nvar = isl_basic_set_dim(bset, isl_dim_set);
+	bset = isl_morph_basic_set(isl_morph_copy(f->morph), bset);
+	list = isl_basic_set_list_alloc(isl_basic_set_get_ctx(bset),
+					f->n_group);
+
+	for (i = 0, n = 0; i < f->n_group; ++i) {
+		isl_basic_set *bset_i;
+
+		bset_i = isl_basic_set_copy(bset);
+		bset_i = isl_basic_set_drop_constraints_involving(bset_i,
+			    nparam + n + f->len[i], nvar - n - f->len[i]);
+		bset_i = isl_basic_set_drop_constraints_involving(bset_i,
+			    nparam, n);
+		bset_i = isl_basic_set_drop(bset_i, isl_dim_set,
+			    n + f->len[i], nvar - n - f->len[i]);
+		bset_i = isl_basic_set_drop(bset_i, isl_dim_set, 0, n);
+		list = isl_basic_set_list_add(list, bset_i);
+
+		n += f->len[i];
+	}
+
+	isl_basic_set_free(bset);
+	return list;
+error:
+	isl_basic_set_free(bset);
+	return NULL;
+}
@@ -22,6 +22,9 @@ __isl_give isl_factorizer *isl_basic_set_factorizer(
 	__isl_keep isl_basic_set *bset);
 
 void isl_factorizer_free(__isl_take isl_factorizer *f);
+int isl_factorizer_n_nontrivial_group(__isl_keep isl_factorizer *f);
+__isl_give isl_basic_set_list *isl_factorizer_factors(
+	__isl_keep isl_factorizer *f, __isl_take isl_basic_set *bset);
 void isl_factorizer_dump(__isl_take isl_factorizer *f);
 
 #if defined(__cplusplus)
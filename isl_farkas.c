@@ -8,10 +8,14 @@
  * 91893 Orsay, France 
  */
 
+#include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl/set.h>
 #include <isl_space_private.h>
+#include <isl_mat_private.h>
 #include <isl_seq.h>
+#include <isl_options_private.h>
+#include <isl_farkas_private.h>
 
 /*
  * Let C be a cone and define
@@ -206,30 +210,23 @@ static __isl_give isl_basic_set *rational_universe(__isl_take isl_space *space)
 	return bset;
 }
 
-/* Compute the dual of "bset" by applying Farkas' lemma.
+/* Compute the dual of the non-empty basic set "bset"
+ * by applying Farkas' lemma.
  * As explained above, we add an extra dimension to represent
  * the coefficient of the constant term when going from solutions
  * to coefficients (shift == 1) and we drop the extra dimension when going
- * in the opposite direction (shift == -1).  "dim" is the space in which
+ * in the opposite direction (shift == -1).  "space" is the space in which
  * the dual should be created.
- *
- * If "bset" is (obviously) empty, then the way this emptiness
- * is represented by the constraints does not allow for the application
- * of the standard farkas algorithm.  We therefore handle this case
- * specifically and return the universe basic set.
+ * The multipliers are introduced as existentially quantified variables
+ * and then projected out.
  */
-static __isl_give isl_basic_set *farkas(__isl_take isl_space *space,
-	__isl_take isl_basic_set *bset, int shift)
+static __isl_give isl_basic_set *farkas_project(__isl_take isl_space *space,
+	__isl_keep isl_basic_set *bset, int shift)
 {
 	int i, j, k;
 	isl_basic_set *dual = NULL;
 	unsigned total;
 
-	if (isl_basic_set_plain_is_empty(bset)) {
-		isl_basic_set_free(bset);
-		return rational_universe(space);
-	}
-
 	total = isl_basic_set_total_dim(bset);
 
 	dual = isl_basic_set_alloc_space(space, bset->n_eq + bset->n_ineq,
@@ -284,11 +281,426 @@ static __isl_give isl_basic_set *farkas(__isl_take isl_space *space,
 	isl_basic_set_simplify(dual);
 	isl_basic_set_finalize(dual);
 
+	return dual;
+error:
+	isl_basic_set_free(dual);
+	return NULL;
+}
+
+/* Return the matrix of linear parts of the equalities
+ * followed by the inequalities of "bset", i.e., the matrix A above.
+ */
+static __isl_give isl_mat *constraint_matrix(__isl_keep isl_basic_set *bset)
+{
+	int i;
+	unsigned total;
+	isl_mat *A;
+
+	total = isl_basic_set_total_dim(bset);
+	A = isl_mat_alloc(bset->ctx, bset->n_eq + bset->n_ineq, total);
+	if (!A)
+		return NULL;
+	for (i = 0; i < bset->n_eq; ++i)
+		isl_seq_cpy(A->row[i], bset->eq[i] + 1, total);
+	for (i = 0; i < bset->n_ineq; ++i)
+		isl_seq_cpy(A->row[bset->n_eq + i], bset->ineq[i] + 1, total);
+
+	return A;
+}
+
+/* Compute the dual of the non-empty basic set "bset" directly,
+ * without introducing and projecting out the multipliers t,
+ * if the rows of the constraint matrix A are linearly independent,
+ * which is typically the case for basic sets with few constraints.
+ * Otherwise, fall back to farkas_project.
+ * "space" and "shift" are as in farkas_project.
+ *
+ * If A has full row rank, then y = t A uniquely determines t.
+ * In particular, let R be a right inverse of A, scaled by a positive
+ * factor d such that A R = d I.  Then t = y R / d and y is of the form t A
+ * if and only if y K = 0, with K a basis of the right kernel of A.
+ * The dual is therefore
+ *
+ *	{ w, y | y K = 0 and (y R)_j >= 0 for inequalities j and
+ *		 d w - y R b >= 0 }
+ *
+ * where the final constraint is only added if shift == 1.
+ * When shift == -1, the first element of y corresponds to
+ * the constant term of the dual, so the constraints can be constructed
+ * in the same way.
+ */
+static __isl_give isl_basic_set *farkas_direct(__isl_take isl_space *space,
+	__isl_keep isl_basic_set *bset, int shift)
+{
+	int i, j, k;
+	int n;
+	unsigned total;
+	isl_mat *A, *K = NULL, *R = NULL;
+	isl_basic_set *dual = NULL;
+	isl_int d;
+
+	total = isl_basic_set_total_dim(bset);
+	n = bset->n_eq + bset->n_ineq;
+	if (n == 0 || n > total)
+		return farkas_project(space, bset, shift);
+
+	A = constraint_matrix(bset);
+	K = isl_mat_right_kernel(isl_mat_copy(A));
+	if (!K)
+		goto error;
+	if (K->n_col != total - n) {
+		isl_mat_free(A);
+		isl_mat_free(K);
+		return farkas_project(space, bset, shift);
+	}
+	R = isl_mat_right_inverse(isl_mat_copy(A));
+	if (!R)
+		goto error;
+
+	dual = isl_basic_set_alloc_space(space, 0,
+				K->n_col, bset->n_ineq + (shift > 0));
+	space = NULL;
+	dual = isl_basic_set_set_rational(dual);
+	if (!dual)
+		goto error;
+
+	for (j = 0; j < K->n_col; ++j) {
+		k = isl_basic_set_alloc_equality(dual);
+		if (k < 0)
+			goto error;
+		isl_seq_clr(dual->eq[k], 1 + shift);
+		for (i = 0; i < total; ++i)
+			isl_int_set(dual->eq[k][1 + shift + i], K->row[i][j]);
+	}
+
+	for (j = 0; j < bset->n_ineq; ++j) {
+		k = isl_basic_set_alloc_inequality(dual);
+		if (k < 0)
+			goto error;
+		isl_seq_clr(dual->ineq[k], 1 + shift);
+		for (i = 0; i < total; ++i)
+			isl_int_set(dual->ineq[k][1 + shift + i],
+				    R->row[i][bset->n_eq + j]);
+	}
+
+	if (shift > 0) {
+		k = isl_basic_set_alloc_inequality(dual);
+		if (k < 0)
+			goto error;
+		isl_int_init(d);
+		isl_int_set_si(d, 0);
+		for (i = 0; i < total; ++i)
+			isl_int_addmul(d, A->row[0][i], R->row[i][0]);
+		isl_int_set_si(dual->ineq[k][0], 0);
+		isl_int_set(dual->ineq[k][1], d);
+		isl_int_clear(d);
+		for (i = 0; i < total; ++i) {
+			isl_int *c = &dual->ineq[k][2 + i];
+
+			isl_int_set_si(*c, 0);
+			for (j = 0; j < bset->n_eq; ++j)
+				isl_int_submul(*c, R->row[i][j],
+						bset->eq[j][0]);
+			for (j = 0; j < bset->n_ineq; ++j)
+				isl_int_submul(*c, R->row[i][bset->n_eq + j],
+						bset->ineq[j][0]);
+		}
+	}
+
+	isl_mat_free(A);
+	isl_mat_free(K);
+	isl_mat_free(R);
+
+	dual = isl_basic_set_simplify(dual);
+	dual = isl_basic_set_finalize(dual);
+	return dual;
+error:
+	isl_mat_free(A);
+	isl_mat_free(K);
+	isl_mat_free(R);
+	isl_space_free(space);
+	isl_basic_set_free(dual);
+	return NULL;
+}
+/* An entry in the coefficients cache of an isl_ctx.
+ * "dual" is the result of applying farkas with shift "shift"
+ * to a basic set living in "space" with equalities "eq"
+ * and inequalities "ineq".
+ * "hash" is a hash of "shift", "space" and the constraints.
+ */
+struct isl_coefficients_cache_entry {
+	uint32_t	hash;
+	int		shift;
+	isl_space	*space;
+	isl_mat		*eq;
+	isl_mat		*ineq;
+	isl_basic_set	*dual;
+
+	struct isl_coefficients_cache_entry	*prev;
+	struct isl_coefficients_cache_entry	*next;
+};
+
+/* The dual of "bset" with shift "shift" that is being looked up
+ * in the coefficients cache.
+ */
+struct isl_coefficients_cache_key {
+	uint32_t		hash;
+	int			shift;
+	isl_basic_set		*bset;
+};
+
+static void coefficients_cache_entry_free(
+	struct isl_coefficients_cache_entry *entry)
+{
+	if (!entry)
+		return;
+	isl_space_free(entry->space);
+	isl_mat_free(entry->eq);
+	isl_mat_free(entry->ineq);
+	isl_basic_set_free(entry->dual);
+	free(entry);
+}
+
+/* Remove "entry" from the list of cache entries of "ctx".
+ */
+static void coefficients_cache_unlink(isl_ctx *ctx,
+	struct isl_coefficients_cache_entry *entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		ctx->coefficients_cache_first = entry->next;
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		ctx->coefficients_cache_last = entry->prev;
+	entry->prev = entry->next = NULL;
+}
+
+/* Add "entry" to the front of the list of cache entries of "ctx".
+ */
+static void coefficients_cache_push_front(isl_ctx *ctx,
+	struct isl_coefficients_cache_entry *entry)
+{
+	entry->prev = NULL;
+	entry->next = ctx->coefficients_cache_first;
+	if (ctx->coefficients_cache_first)
+		ctx->coefficients_cache_first->prev = entry;
+	else
+		ctx->coefficients_cache_last = entry;
+	ctx->coefficients_cache_first = entry;
+}
+
+/* Remove all entries from the coefficients cache of "ctx".
+ */
+void isl_coefficients_cache_clear(isl_ctx *ctx)
+{
+	struct isl_coefficients_cache_entry *entry, *next;
+
+	for (entry = ctx->coefficients_cache_first; entry; entry = next) {
+		next = entry->next;
+		coefficients_cache_entry_free(entry);
+	}
+	ctx->coefficients_cache_first = ctx->coefficients_cache_last = NULL;
+	ctx->n_coefficients_cache = 0;
+	isl_hash_table_clear(&ctx->coefficients_cache);
+	isl_hash_table_init(ctx, &ctx->coefficients_cache, 0);
+}
+
+/* Are the rows of "mat" equal to the "n" constraints in "c"?
+ */
+static int mat_is_constraints(__isl_keep isl_mat *mat, isl_int **c, int n,
+	unsigned len)
+{
+	int i;
+
+	if (mat->n_row != n || mat->n_col != len)
+		return 0;
+	for (i = 0; i < n; ++i)
+		if (!isl_seq_eq(mat->row[i], c[i], len))
+			return 0;
+	return 1;
+}
+
+/* Is "entry" a cached dual for the key "val",
+ * i.e., was it computed with the same shift for a basic set
+ * with the same space and the same constraints, in the same order?
+ * The dimension names are taken into account since they
+ * determine those of the dual.
+ */
+static int coefficients_cache_has_key(const void *entry, const void *val)
+{
+	const struct isl_coefficients_cache_entry *e = entry;
+	const struct isl_coefficients_cache_key *key = val;
+	isl_basic_set *bset = key->bset;
+	unsigned len = 1 + isl_basic_set_total_dim(bset);
+
+	if (e->shift != key->shift)
+		return 0;
+	if (!mat_is_constraints(e->eq, bset->eq, bset->n_eq, len))
+		return 0;
+	if (!mat_is_constraints(e->ineq, bset->ineq, bset->n_ineq, len))
+		return 0;
+	return isl_space_is_identical(e->space, bset->dim) == 1;
+}
+
+static int coefficients_cache_is_entry(const void *entry, const void *val)
+{
+	return entry == val;
+}
+
+/* Remove the least recently used entry from the coefficients cache
+ * of "ctx".
+ */
+static void coefficients_cache_evict(isl_ctx *ctx)
+{
+	struct isl_coefficients_cache_entry *entry;
+	struct isl_hash_table_entry *he;
+
+	entry = ctx->coefficients_cache_last;
+	he = isl_hash_table_find(ctx, &ctx->coefficients_cache, entry->hash,
+				&coefficients_cache_is_entry, entry, 0);
+	if (he)
+		isl_hash_table_remove(ctx, &ctx->coefficients_cache, he);
+	coefficients_cache_unlink(ctx, entry);
+	coefficients_cache_entry_free(entry);
+	ctx->n_coefficients_cache--;
+}
+
+/* Return a matrix containing copies of the "n" constraints in "c".
+ */
+static __isl_give isl_mat *constraints_to_mat(isl_ctx *ctx, isl_int **c,
+	int n, unsigned len)
+{
+	int i;
+	isl_mat *mat;
+
+	mat = isl_mat_alloc(ctx, n, len);
+	if (!mat)
+		return NULL;
+	for (i = 0; i < n; ++i)
+		isl_seq_cpy(mat->row[i], c[i], len);
+
+	return mat;
+}
+
+/* Add the dual "dual" described by "key" to the coefficients
+ * cache of "ctx", evicting the least recently used entries if the cache
+ * would otherwise exceed the size specified by the coefficients_cache_size
+ * option.
+ */
+static void coefficients_cache_add(isl_ctx *ctx,
+	struct isl_coefficients_cache_key *key, __isl_keep isl_basic_set *dual)
+{
+	isl_basic_set *bset = key->bset;
+	unsigned len = 1 + isl_basic_set_total_dim(bset);
+	struct isl_coefficients_cache_entry *entry;
+	struct isl_hash_table_entry *he;
+
+	while (ctx->n_coefficients_cache > 0 &&
+	       ctx->n_coefficients_cache >= ctx->opt->coefficients_cache_size)
+		coefficients_cache_evict(ctx);
+
+	entry = isl_calloc_type(ctx, struct isl_coefficients_cache_entry);
+	if (!entry)
+		return;
+	entry->hash = key->hash;
+	entry->shift = key->shift;
+	entry->space = isl_space_copy(bset->dim);
+	entry->eq = constraints_to_mat(ctx, bset->eq, bset->n_eq, len);
+	entry->ineq = constraints_to_mat(ctx, bset->ineq, bset->n_ineq, len);
+	entry->dual = isl_basic_set_copy(dual);
+	if (!entry->space || !entry->eq || !entry->ineq || !entry->dual) {
+		coefficients_cache_entry_free(entry);
+		return;
+	}
+
+	he = isl_hash_table_find(ctx, &ctx->coefficients_cache, key->hash,
+				&coefficients_cache_has_key, key, 1);
+	if (!he || he->data) {
+		coefficients_cache_entry_free(entry);
+		return;
+	}
+	he->data = entry;
+	coefficients_cache_push_front(ctx, entry);
+	ctx->n_coefficients_cache++;
+}
+
+/* Compute the dual of "bset" by applying Farkas' lemma.
+ * "space" is the space in which the dual should be created and
+ * "shift" is 1 when going from solutions to coefficients and
+ * -1 when going in the opposite direction.
+ *
+ * If "bset" is (obviously) empty, then the way this emptiness
+ * is represented by the constraints does not allow for the application
+ * of the standard farkas algorithm.  We therefore handle this case
+ * specifically and return the universe basic set.
+ *
+ * Otherwise, the result of an earlier computation on a basic set
+ * with the same space and the same constraints is reused
+ * if it is still available in the coefficients cache.
+ */
+static __isl_give isl_basic_set *farkas(__isl_take isl_space *space,
+	__isl_take isl_basic_set *bset, int shift)
+{
+	int i;
+	isl_ctx *ctx;
+	isl_basic_set *dual;
+	unsigned total;
+	struct isl_coefficients_cache_key key;
+	struct isl_hash_table_entry *he;
+
+	if (!space || !bset)
+		goto error;
+
+	if (isl_basic_set_plain_is_empty(bset)) {
+		isl_basic_set_free(bset);
+		return rational_universe(space);
+	}
+
+	ctx = isl_basic_set_get_ctx(bset);
+	if (ctx->opt->coefficients_cache_size <= 0) {
+		dual = farkas_direct(space, bset, shift);
+		isl_basic_set_free(bset);
+		return dual;
+	}
+
+	total = isl_basic_set_total_dim(bset);
+	key.shift = shift;
+	key.bset = bset;
+	key.hash = isl_hash_init();
+	isl_hash_byte(key.hash, shift & 0xFF);
+	isl_hash_hash(key.hash, isl_space_get_hash(bset->dim));
+	for (i = 0; i < bset->n_eq; ++i)
+		isl_hash_hash(key.hash, isl_seq_get_hash(bset->eq[i], 1 + total));
+	isl_hash_byte(key.hash, 0xFF);
+	for (i = 0; i < bset->n_ineq; ++i)
+		isl_hash_hash(key.hash,
+				isl_seq_get_hash(bset->ineq[i], 1 + total));
+
+	he = isl_hash_table_find(ctx, &ctx->coefficients_cache, key.hash,
+				&coefficients_cache_has_key, &key, 0);
+	if (he) {
+		struct isl_coefficients_cache_entry *entry = he->data;
+
+		ctx->stats->coefficients_cache_hits++;
+		coefficients_cache_unlink(ctx, entry);
+		coefficients_cache_push_front(ctx, entry);
+		isl_space_free(space);
+		isl_basic_set_free(bset);
+		return isl_basic_set_copy(entry->dual);
+	}
+	ctx->stats->coefficients_cache_misses++;
+
+	dual = farkas_direct(space, bset, shift);
+	if (dual)
+		coefficients_cache_add(ctx, &key, dual);
+
 	isl_basic_set_free(bset);
 	return dual;
 error:
+	isl_space_free(space);
 	isl_basic_set_free(bset);
-	isl_basic_set_free(dual);
 	return NULL;
 }
 
@@ -0,0 +1,8 @@
+#ifndef ISL_FARKAS_PRIVATE_H
+#define ISL_FARKAS_PRIVATE_H
+
+#include <isl/ctx.h>
+
+void isl_coefficients_cache_clear(isl_ctx *ctx);
+
+#endif
@@ -14,10 +14,17 @@
  * ZAC des vignes, 4 rue Jacques Monod, 91893 Orsay, France 
  */
 
+#include <isl_config.h>
+#include <isl_map_private.h>
 #include <isl/set.h>
 #include <isl/map.h>
 #include <isl/flow.h>
-#include <isl_sort.h>
+#include <isl_ctx_private.h>
+#include <isl_options_private.h>
+#include <isl_space_private.h>
+#include <isl_flow_private.h>
+#include <isl_profile.h>
+#include <isl_thread.h>
 
 enum isl_restriction_type {
 	isl_restriction_type_empty,
@@ -154,6 +161,26 @@ struct isl_labeled_map {
 	int		must;
 };
 
+/* The maximal number of results of restricted_partial_lexmax
+ * that are kept in the memo of an isl_access_info.
+ */
+#define ISL_ACCESS_LEXMAX_MEMO_SIZE	8
+
+/* A memoized result of restricted_partial_lexmax.
+ * "res" and "empty" are the results of the partial lexicographic
+ * maximum of "dep", which relates the sink to source "source",
+ * on the sink iterations "sink", where "dep" only contains pairs
+ * where the source precedes the sink at level "level".
+ */
+struct isl_access_lexmax_memo {
+	int	source;
+	int	level;
+	isl_map	*dep;
+	isl_set	*sink;
+	isl_map	*res;
+	isl_set	*empty;
+};
+
 /* A structure containing the input for dependence analysis:
  * - a sink
  * - n_must + n_may (<= max_source) sources
@@ -165,15 +192,36 @@ struct isl_labeled_map {
  *
  * restrict_fn is a callback that (if not NULL) will be called
  * right before any lexicographical maximization.
+ *
+ * sort_key is a callback that (if not NULL) returns a non-negative
+ * key for the user data of a source that is compatible with
+ * the order imposed by level_before, i.e., if the key of a source
+ * is smaller than that of another source, then it is placed before
+ * this other source (at the outermost level).
+ * A negative key means that no such key is available.
+ *
+ * "memo" contains the "n_memo" most recent results
+ * of restricted_partial_lexmax, where "next_memo" is the position
+ * of the entry that will be replaced next.
+ *
+ * "after" is a cache (allocated on first use) of the relations
+ * computed by after_at_level, keyed on their space and level.
  */
 struct isl_access_info {
 	isl_map				*domain_map;
 	struct isl_labeled_map		sink;
 	isl_access_level_before		level_before;
+	int				(*sort_key)(void *data);
 
 	isl_access_restrict		restrict_fn;
 	void				*restrict_user;
 
+	int				n_memo;
+	int				next_memo;
+	struct isl_access_lexmax_memo	memo[ISL_ACCESS_LEXMAX_MEMO_SIZE];
+
+	struct isl_hash_table		*after;
+
 	int		    		max_source;
 	int		    		n_must;
 	int		    		n_may;
@@ -192,6 +240,48 @@ struct isl_flow {
 	struct isl_labeled_map	*dep;
 };
 
+/* An entry in the cache of after_at_level relations
+ * of an isl_access_info.
+ * "map" is the relation in space "space" for level "level".
+ */
+struct isl_access_after_entry {
+	isl_space	*space;
+	int		level;
+	isl_map		*map;
+};
+
+static int free_after_entry(void **entry, void *user)
+{
+	struct isl_access_after_entry *after = *entry;
+
+	isl_space_free(after->space);
+	isl_map_free(after->map);
+	free(after);
+
+	return 0;
+}
+
+/* Free the cache of after_at_level relations "after" of "acc".
+ */
+static void after_cache_free(__isl_keep isl_access_info *acc)
+{
+	isl_ctx *ctx;
+
+	if (!acc->after)
+		return;
+	ctx = isl_map_get_ctx(acc->sink.map);
+	isl_hash_table_foreach(ctx, acc->after, &free_after_entry, NULL);
+	isl_hash_table_free(ctx, acc->after);
+}
+
+static void lexmax_memo_clear(struct isl_access_lexmax_memo *memo)
+{
+	isl_map_free(memo->dep);
+	isl_set_free(memo->sink);
+	isl_map_free(memo->res);
+	isl_set_free(memo->empty);
+}
+
 /* Construct an isl_access_info structure and fill it up with
  * the given data.  The number of sources is set to 0.
  */
@@ -235,6 +325,9 @@ __isl_null isl_access_info *isl_access_info_free(
 
 	if (!acc)
 		return NULL;
+	for (i = 0; i < acc->n_memo; ++i)
+		lexmax_memo_clear(&acc->memo[i]);
+	after_cache_free(acc);
 	isl_map_free(acc->domain_map);
 	isl_map_free(acc->sink.map);
 	for (i = 0; i < acc->n_must + acc->n_may; ++i)
@@ -310,14 +403,11 @@ error:
  * of the iteration domains.  This results in an arbitrary, but fairly
  * stable ordering.
  */
-static int access_sort_cmp(const void *p1, const void *p2, void *user)
+static int access_sort_cmp(const struct isl_labeled_map *i1,
+	const struct isl_labeled_map *i2, isl_access_info *acc)
 {
-	isl_access_info *acc = user;
-	const struct isl_labeled_map *i1, *i2;
 	int level1, level2;
 	uint32_t h1, h2;
-	i1 = (const struct isl_labeled_map *) p1;
-	i2 = (const struct isl_labeled_map *) p2;
 
 	level1 = acc->level_before(i1->data, i2->data);
 	if (level1 % 2)
@@ -332,19 +422,68 @@ static int access_sort_cmp(const void *p1, const void *p2, void *user)
 	return h1 > h2 ? 1 : h1 < h2 ? -1 : 0;
 }
 
+#define SORT_FN		sort_sources
+#define SORT_EL		struct isl_labeled_map
+#define SORT_ARG	isl_access_info *
+#define SORT_CMP	access_sort_cmp
+
+#include <isl_sort_templ.c>
+
+#define SORT_FN		sort_sources_by_key
+#define SORT_EL		struct isl_labeled_map
+#define SORT_ARG	isl_access_info *
+#define SORT_KEY(el,acc)	((acc)->sort_key((el)->data))
+
+#include <isl_sort_templ.c>
+
+/* Do all must sources of "acc" have a sort key?
+ */
+static int has_sort_keys(__isl_keep isl_access_info *acc)
+{
+	int i;
+
+	if (!acc->sort_key)
+		return 0;
+	for (i = 0; i < acc->n_must; ++i)
+		if (acc->sort_key(acc->source[i].data) < 0)
+			return 0;
+	return 1;
+}
+
 /* Sort the must source accesses in their textual order.
+ *
+ * If all must sources have a sort key, then they are first
+ * bucket sorted on this key and only the sources with the same key
+ * are compared using access_sort_cmp.
  */
 static __isl_give isl_access_info *isl_access_info_sort_sources(
 	__isl_take isl_access_info *acc)
 {
+	int i, j;
+
 	if (!acc)
 		return NULL;
 	if (acc->n_must <= 1)
 		return acc;
 
-	if (isl_sort(acc->source, acc->n_must, sizeof(struct isl_labeled_map),
-		    access_sort_cmp, acc) < 0)
+	if (!has_sort_keys(acc)) {
+		if (sort_sources(acc->source, acc->n_must, acc) < 0)
+			return isl_access_info_free(acc);
+		return acc;
+	}
+
+	if (sort_sources_by_key(acc->source, acc->n_must, acc) < 0)
 		return isl_access_info_free(acc);
+	for (i = 0; i < acc->n_must; i = j) {
+		int key = acc->sort_key(acc->source[i].data);
+
+		for (j = i + 1; j < acc->n_must; ++j)
+			if (acc->sort_key(acc->source[j].data) != key)
+				break;
+		if (j - i > 1 &&
+		    sort_sources(acc->source + i, j - i, acc) < 0)
+			return isl_access_info_free(acc);
+	}
 
 	return acc;
 }
@@ -363,6 +502,19 @@ static __isl_give isl_space *space_align_and_join(__isl_take isl_space *left,
 	return isl_space_join(left, right);
 }
 
+/* Return an empty dependence relation between "source" and
+ * the sink of "acc".
+ */
+static __isl_give isl_map *empty_dep(__isl_keep isl_access_info *acc,
+	struct isl_labeled_map *source)
+{
+	isl_space *dim;
+
+	dim = space_align_and_join(isl_map_get_space(source->map),
+			isl_space_reverse(isl_map_get_space(acc->sink.map)));
+	return isl_map_empty(dim);
+}
+
 /* Initialize an empty isl_flow structure corresponding to a given
  * isl_access_info structure.
  * For each must access, two dependences are created (initialized
@@ -394,11 +546,7 @@ static __isl_give isl_flow *isl_flow_alloc(__isl_keep isl_access_info *acc)
 
 	dep->n_source = n;
 	for (i = 0; i < acc->n_must; ++i) {
-		isl_space *dim;
-		dim = space_align_and_join(
-			isl_map_get_space(acc->source[i].map),
-			isl_space_reverse(isl_map_get_space(acc->sink.map)));
-		dep->dep[2 * i].map = isl_map_empty(dim);
+		dep->dep[2 * i].map = empty_dep(acc, &acc->source[i]);
 		dep->dep[2 * i + 1].map = isl_map_copy(dep->dep[2 * i].map);
 		dep->dep[2 * i].data = acc->source[i].data;
 		dep->dep[2 * i + 1].data = acc->source[i].data;
@@ -408,11 +556,7 @@ static __isl_give isl_flow *isl_flow_alloc(__isl_keep isl_access_info *acc)
 			goto error;
 	}
 	for (i = acc->n_must; i < acc->n_must + acc->n_may; ++i) {
-		isl_space *dim;
-		dim = space_align_and_join(
-			isl_map_get_space(acc->source[i].map),
-			isl_space_reverse(isl_map_get_space(acc->sink.map)));
-		dep->dep[acc->n_must + i].map = isl_map_empty(dim);
+		dep->dep[acc->n_must + i].map = empty_dep(acc, &acc->source[i]);
 		dep->dep[acc->n_must + i].data = acc->source[i].data;
 		dep->dep[acc->n_must + i].must = 0;
 		if (!dep->dep[acc->n_must + i].map)
@@ -507,6 +651,91 @@ static __isl_give isl_map *after_at_level(__isl_take isl_space *dim, int level)
 	return isl_map_from_basic_map(bmap);
 }
 
+/* The key of an entry in the cache of after_at_level relations.
+ */
+struct isl_access_after_key {
+	isl_space	*space;
+	int		level;
+};
+
+static int has_after_key(const void *entry, const void *val)
+{
+	const struct isl_access_after_entry *after = entry;
+	const struct isl_access_after_key *key = val;
+
+	return after->level == key->level &&
+		isl_space_is_equal(after->space, key->space);
+}
+
+/* Return the relation after_at_level(space, level),
+ * reusing the result of an earlier call on "acc" if possible.
+ *
+ * The same relations are needed for each level at which
+ * a pair of sources is considered, so they are cached in "acc".
+ */
+static __isl_give isl_map *cached_after_at_level(
+	__isl_keep isl_access_info *acc, __isl_take isl_space *space,
+	int level)
+{
+	isl_ctx *ctx;
+	uint32_t hash;
+	struct isl_hash_table_entry *entry;
+	struct isl_access_after_key key = { space, level };
+	struct isl_access_after_entry *after;
+
+	if (!space)
+		return NULL;
+
+	ctx = isl_space_get_ctx(space);
+	if (!acc->after) {
+		acc->after = isl_hash_table_alloc(ctx, 0);
+		if (!acc->after)
+			goto error;
+	}
+
+	hash = isl_space_get_hash(space);
+	hash = isl_hash_builtin(hash, level);
+	entry = isl_hash_table_find(ctx, acc->after, hash,
+				    &has_after_key, &key, 1);
+	if (!entry)
+		goto error;
+	if (entry->data) {
+		after = entry->data;
+		isl_space_free(space);
+		return isl_map_copy(after->map);
+	}
+
+	after = isl_alloc_type(ctx, struct isl_access_after_entry);
+	if (!after) {
+		isl_hash_table_remove(ctx, acc->after, entry);
+		goto error;
+	}
+	after->space = isl_space_copy(space);
+	after->level = level;
+	after->map = after_at_level(space, level);
+	entry->data = after;
+	if (!after->map)
+		return NULL;
+
+	return isl_map_copy(after->map);
+error:
+	isl_space_free(space);
+	return NULL;
+}
+
+/* Intersect "map" with after_at_level(space, level), where "space"
+ * is the space of "map", by adding the corresponding constraints
+ * directly to the basic maps of "map".
+ */
+static __isl_give isl_map *intersect_after_at_level(__isl_take isl_map *map,
+	int level)
+{
+	if (level % 2)
+		return isl_map_intersect_equal_more_at(map, level/2, 0);
+	else
+		return isl_map_intersect_equal_more_at(map, level/2 - 1, 1);
+}
+
 /* Compute the partial lexicographic maximum of "dep" on domain "sink",
  * but first check if the user has set acc->restrict_fn and if so
  * update either the input or the output of the maximization problem
@@ -519,7 +748,7 @@ static __isl_give isl_map *after_at_level(__isl_take isl_space *dim, int level)
  * Similarly, the sink restriction specified by the user needs to be
  * converted back to the wrapped map.
  */
-static __isl_give isl_map *restricted_partial_lexmax(
+static __isl_give isl_map *compute_restricted_partial_lexmax(
 	__isl_keep isl_access_info *acc, __isl_take isl_map *dep,
 	int source, __isl_take isl_set *sink, __isl_give isl_set **empty)
 {
@@ -570,6 +799,124 @@ error:
 	return NULL;
 }
 
+/* Look for a result of restricted_partial_lexmax on "dep" and "sink"
+ * for source "source" at level "level" in the memo of "acc".
+ * Return the position of the entry in the memo if it can be found
+ * and -1 otherwise.  Return -2 on error.
+ */
+static int lexmax_memo_find(__isl_keep isl_access_info *acc,
+	__isl_keep isl_map *dep, int source, int level,
+	__isl_keep isl_set *sink)
+{
+	int i;
+
+	for (i = 0; i < acc->n_memo; ++i) {
+		struct isl_access_lexmax_memo *memo = &acc->memo[i];
+		int equal;
+
+		if (memo->source != source || memo->level != level)
+			continue;
+		equal = isl_set_plain_is_equal(memo->sink, sink);
+		if (equal >= 0 && equal)
+			equal = isl_map_plain_is_equal(memo->dep, dep);
+		if (equal < 0)
+			return -2;
+		if (equal)
+			return i;
+	}
+
+	return -1;
+}
+
+/* Store the result "res" and "empty" of restricted_partial_lexmax
+ * on "dep" and "sink" for source "source" at level "level"
+ * in the memo of "acc", replacing the oldest entry if the memo is full.
+ */
+static void lexmax_memo_add(__isl_keep isl_access_info *acc,
+	__isl_take isl_map *dep, int source, int level,
+	__isl_take isl_set *sink, __isl_keep isl_map *res,
+	__isl_keep isl_set *empty)
+{
+	struct isl_access_lexmax_memo *memo;
+
+	if (acc->n_memo < ISL_ACCESS_LEXMAX_MEMO_SIZE) {
+		memo = &acc->memo[acc->n_memo++];
+	} else {
+		memo = &acc->memo[acc->next_memo];
+		lexmax_memo_clear(memo);
+		acc->next_memo = (acc->next_memo + 1) %
+					ISL_ACCESS_LEXMAX_MEMO_SIZE;
+	}
+	memo->source = source;
+	memo->level = level;
+	memo->dep = dep;
+	memo->sink = sink;
+	memo->res = isl_map_copy(res);
+	memo->empty = isl_set_copy(empty);
+}
+
+/* Compute the partial lexicographic maximum of "dep" on domain "sink"
+ * as in compute_restricted_partial_lexmax, where "dep" only contains
+ * pairs where source "source" precedes the sink at level "level".
+ *
+ * The same problem may need to be solved several times during
+ * the analysis of a sink, e.g., for the must and the may dependences
+ * or when an intermediate source does not change the remaining
+ * sink iterations.  The most recent results are therefore kept
+ * in a small memo, keyed on the source, the level and the (plain) values
+ * of "dep" and "sink".  Since the restriction that is applied
+ * in compute_restricted_partial_lexmax only depends on the source,
+ * "dep" and "sink", it does not need to be taken into account separately.
+ *
+ * If "dep" is obviously empty and there is no restriction,
+ * then the result is empty and none of the sink iterations
+ * have a source, so that no lexicographic maximum needs to be computed.
+ */
+static __isl_give isl_map *restricted_partial_lexmax(
+	__isl_keep isl_access_info *acc, __isl_take isl_map *dep,
+	int source, int level, __isl_take isl_set *sink,
+	__isl_give isl_set **empty)
+{
+	int pos;
+	isl_map *res;
+	isl_map *dep_key;
+	isl_set *sink_key;
+
+	if (dep && sink && !acc->restrict_fn &&
+	    isl_map_plain_is_empty(dep)) {
+		*empty = sink;
+		return dep;
+	}
+
+	pos = dep && sink ? lexmax_memo_find(acc, dep, source, level, sink)
+			  : -2;
+	if (pos >= 0) {
+		isl_ctx *ctx = isl_map_get_ctx(dep);
+
+		ctx->stats->flow_lexmax_memo_hits++;
+		isl_map_free(dep);
+		isl_set_free(sink);
+		*empty = isl_set_copy(acc->memo[pos].empty);
+		return isl_map_copy(acc->memo[pos].res);
+	}
+	if (pos < -1)
+		return compute_restricted_partial_lexmax(acc, dep, source,
+							 sink, empty);
+
+	dep_key = isl_map_copy(dep);
+	sink_key = isl_set_copy(sink);
+	res = compute_restricted_partial_lexmax(acc, dep, source, sink, empty);
+	if (res && *empty)
+		lexmax_memo_add(acc, dep_key, source, level, sink_key,
+				res, *empty);
+	else {
+		isl_map_free(dep_key);
+		isl_set_free(sink_key);
+	}
+
+	return res;
+}
+
 /* Compute the last iteration of must source j that precedes the sink
  * at the given level for sink iterations in set_C.
  * The subset of set_C for which no such iteration can be found is returned
@@ -582,16 +929,15 @@ static struct isl_map *last_source(struct isl_access_info *acc,
 	struct isl_map *read_map;
 	struct isl_map *write_map;
 	struct isl_map *dep_map;
-	struct isl_map *after;
 	struct isl_map *result;
 
 	read_map = isl_map_copy(acc->sink.map);
 	write_map = isl_map_copy(acc->source[j].map);
 	write_map = isl_map_reverse(write_map);
 	dep_map = isl_map_apply_range(read_map, write_map);
-	after = after_at_level(isl_map_get_space(dep_map), level);
-	dep_map = isl_map_intersect(dep_map, after);
-	result = restricted_partial_lexmax(acc, dep_map, j, set_C, empty);
+	dep_map = intersect_after_at_level(dep_map, level);
+	result = restricted_partial_lexmax(acc, dep_map, j, level,
+					   set_C, empty);
 	result = isl_map_reverse(result);
 
 	return result;
@@ -615,7 +961,6 @@ static struct isl_map *last_later_source(struct isl_access_info *acc,
 	struct isl_map *write_map;
 	struct isl_map *dep_map;
 	struct isl_map *after_write;
-	struct isl_map *before_read;
 	struct isl_map *result;
 
 	set_C = isl_map_range(isl_map_copy(old_map));
@@ -626,13 +971,13 @@ static struct isl_map *last_later_source(struct isl_access_info *acc,
 	dep_map = isl_map_apply_range(read_map, write_map);
 	dim = space_align_and_join(isl_map_get_space(acc->source[k].map),
 		    isl_space_reverse(isl_map_get_space(acc->source[j].map)));
-	after_write = after_at_level(dim, after_level);
+	after_write = cached_after_at_level(acc, dim, after_level);
 	after_write = isl_map_apply_range(after_write, old_map);
 	after_write = isl_map_reverse(after_write);
 	dep_map = isl_map_intersect(dep_map, after_write);
-	before_read = after_at_level(isl_map_get_space(dep_map), before_level);
-	dep_map = isl_map_intersect(dep_map, before_read);
-	result = restricted_partial_lexmax(acc, dep_map, k, set_C, empty);
+	dep_map = intersect_after_at_level(dep_map, before_level);
+	result = restricted_partial_lexmax(acc, dep_map, k, before_level,
+					   set_C, empty);
 	result = isl_map_reverse(result);
 
 	return result;
@@ -718,15 +1063,13 @@ static __isl_give isl_map *all_sources(__isl_keep isl_access_info *acc,
 	isl_map *read_map;
 	isl_map *write_map;
 	isl_map *dep_map;
-	isl_map *after;
 
 	read_map = isl_map_copy(acc->sink.map);
 	read_map = isl_map_intersect_domain(read_map, set_C);
 	write_map = isl_map_copy(acc->source[acc->n_must + j].map);
 	write_map = isl_map_reverse(write_map);
 	dep_map = isl_map_apply_range(read_map, write_map);
-	after = after_at_level(isl_map_get_space(dep_map), level);
-	dep_map = isl_map_intersect(dep_map, after);
+	dep_map = intersect_after_at_level(dep_map, level);
 
 	return isl_map_reverse(dep_map);
 }
@@ -747,7 +1090,6 @@ static __isl_give isl_map *all_later_sources(__isl_keep isl_access_info *acc,
 	isl_map *write_map;
 	isl_map *dep_map;
 	isl_map *after_write;
-	isl_map *before_read;
 
 	set_C = isl_map_range(isl_map_copy(old_map));
 	read_map = isl_map_copy(acc->sink.map);
@@ -758,12 +1100,11 @@ static __isl_give isl_map *all_later_sources(__isl_keep isl_access_info *acc,
 	dep_map = isl_map_apply_range(read_map, write_map);
 	dim = isl_space_join(isl_map_get_space(acc->source[acc->n_must + j].map),
 		    isl_space_reverse(isl_map_get_space(acc->source[k].map)));
-	after_write = after_at_level(dim, after_level);
+	after_write = cached_after_at_level(acc, dim, after_level);
 	after_write = isl_map_apply_range(after_write, old_map);
 	after_write = isl_map_reverse(after_write);
 	dep_map = isl_map_intersect(dep_map, after_write);
-	before_read = after_at_level(isl_map_get_space(dep_map), before_level);
-	dep_map = isl_map_intersect(dep_map, before_read);
+	dep_map = intersect_after_at_level(dep_map, before_level);
 	return isl_map_reverse(dep_map);
 }
 
@@ -1040,6 +1381,151 @@ error:
 	return NULL;
 }
 
+/* Is the range of "source" disjoint from "footprint",
+ * the set of array elements accessed by the sink?
+ * Sources that are not known to access the same array are
+ * not considered to be disjoint.
+ */
+static int source_is_disjoint(__isl_keep isl_set *footprint,
+	__isl_keep isl_map *source)
+{
+	isl_space *space, *footprint_space;
+	isl_set *range;
+	int disjoint;
+
+	space = isl_space_range(isl_map_get_space(source));
+	footprint_space = isl_set_get_space(footprint);
+	disjoint = isl_space_is_equal(space, footprint_space);
+	isl_space_free(footprint_space);
+	isl_space_free(space);
+	if (disjoint <= 0)
+		return disjoint;
+
+	range = isl_map_range(isl_map_copy(source));
+	disjoint = isl_set_is_disjoint(range, footprint);
+	isl_set_free(range);
+
+	return disjoint;
+}
+
+/* Move the sources of "acc" that cannot access any of the elements
+ * in "footprint" to the end of acc->source and remove them
+ * from acc->n_must and acc->n_may, such that they are not
+ * considered during the computation of the dependences.
+ * The relative order of the remaining must sources is preserved.
+ * The numbers of removed must and may sources are returned
+ * in *n_must and *n_may.
+ */
+static __isl_give isl_access_info *access_info_prune_sources(
+	__isl_take isl_access_info *acc, __isl_keep isl_set *footprint,
+	int *n_must, int *n_may)
+{
+	int i, k, n;
+	isl_ctx *ctx;
+	int *disjoint = NULL;
+	struct isl_labeled_map *source = NULL;
+
+	*n_must = *n_may = 0;
+	if (!acc || !footprint)
+		return isl_access_info_free(acc);
+	n = acc->n_must + acc->n_may;
+	if (n == 0)
+		return acc;
+
+	ctx = isl_access_info_get_ctx(acc);
+	disjoint = isl_alloc_array(ctx, int, n);
+	if (!disjoint)
+		goto error;
+	for (i = 0; i < n; ++i) {
+		disjoint[i] = source_is_disjoint(footprint, acc->source[i].map);
+		if (disjoint[i] < 0)
+			goto error;
+		if (!disjoint[i])
+			continue;
+		if (i < acc->n_must)
+			(*n_must)++;
+		else
+			(*n_may)++;
+	}
+
+	if (*n_must + *n_may == 0) {
+		free(disjoint);
+		return acc;
+	}
+
+	source = isl_alloc_array(ctx, struct isl_labeled_map, n);
+	if (!source)
+		goto error;
+	k = 0;
+	for (i = 0; i < n; ++i)
+		if (!disjoint[i])
+			source[k++] = acc->source[i];
+	for (i = 0; i < n; ++i)
+		if (disjoint[i])
+			source[k++] = acc->source[i];
+	for (i = 0; i < n; ++i)
+		acc->source[i] = source[i];
+	acc->n_must -= *n_must;
+	acc->n_may -= *n_may;
+	ctx->stats->flow_sources_pruned += *n_must + *n_may;
+
+	free(source);
+	free(disjoint);
+	return acc;
+error:
+	*n_must = *n_may = 0;
+	free(disjoint);
+	return isl_access_info_free(acc);
+}
+
+/* Add empty dependences to "res" for the "n_must" must sources and
+ * the "n_may" may sources that were moved beyond the sources of "acc"
+ * by access_info_prune_sources and restore the numbers
+ * of sources of "acc".
+ */
+static __isl_give isl_flow *flow_add_pruned_sources(__isl_take isl_flow *res,
+	__isl_keep isl_access_info *acc, int n_must, int n_may)
+{
+	int i, first;
+	isl_ctx *ctx;
+	struct isl_labeled_map *dep;
+
+	first = acc->n_must + acc->n_may;
+	acc->n_must += n_must;
+	acc->n_may += n_may;
+	if (!res || n_must + n_may == 0)
+		return res;
+
+	ctx = isl_access_info_get_ctx(acc);
+	dep = isl_realloc_array(ctx, res->dep, struct isl_labeled_map,
+				res->n_source + 2 * n_must + n_may);
+	if (!dep)
+		goto error;
+	res->dep = dep;
+	for (i = 0; i < n_must + n_may; ++i) {
+		struct isl_labeled_map *source = &acc->source[first + i];
+
+		dep = &res->dep[res->n_source];
+		dep->map = empty_dep(acc, source);
+		dep->data = source->data;
+		dep->must = i < n_must;
+		res->n_source++;
+		if (!dep->map)
+			goto error;
+		if (i >= n_must)
+			continue;
+		dep[1].map = isl_map_copy(dep->map);
+		dep[1].data = source->data;
+		dep[1].must = 0;
+		res->n_source++;
+	}
+
+	return res;
+error:
+	isl_flow_free(res);
+	return NULL;
+}
+
 /* Given a "sink" access, a list of n "source" accesses,
  * compute for each iteration of the sink access
  * and for each element accessed by that iteration,
@@ -1056,26 +1542,40 @@ error:
  * domain is first extended with dimensions that correspond to the data
  * space.  After the computation is finished, these extra dimensions are
  * projected out again.
+ *
+ * Sources that do not access any of the array elements accessed
+ * by the sink cannot result in any dependences, so they are
+ * removed before the computation and only receive
+ * empty dependence relations.
  */
 __isl_give isl_flow *isl_access_info_compute_flow(__isl_take isl_access_info *acc)
 {
 	int j;
+	int n_must, n_may;
+	isl_set *footprint;
 	struct isl_flow *res = NULL;
 
 	if (!acc)
 		return NULL;
 
+	footprint = isl_map_range(isl_map_copy(acc->sink.map));
 	acc->domain_map = isl_map_domain_map(isl_map_copy(acc->sink.map));
 	acc->sink.map = isl_map_range_map(acc->sink.map);
 	if (!acc->sink.map)
 		goto error;
 
+	acc = isl_access_info_sort_sources(acc);
+	acc = access_info_prune_sources(acc, footprint, &n_must, &n_may);
+	isl_set_free(footprint);
+	footprint = NULL;
+	if (!acc)
+		return NULL;
+
 	if (acc->n_must == 0)
 		res = compute_mem_based_dependences(acc);
-	else {
-		acc = isl_access_info_sort_sources(acc);
+	else
 		res = compute_val_based_dependences(acc);
-	}
+	res = flow_add_pruned_sources(res, acc, n_must, n_may);
 	if (!res)
 		goto error;
 
@@ -1091,6 +1591,7 @@ __isl_give isl_flow *isl_access_info_compute_flow(__isl_take isl_access_info *ac
 	isl_access_info_free(acc);
 	return res;
 error:
+	isl_set_free(footprint);
 	isl_access_info_free(acc);
 	isl_flow_free(res);
 	return NULL;
@@ -1100,10 +1601,14 @@ error:
 /* Keep track of some information about a schedule for a given
  * access.  In particular, keep track of which dimensions
  * have a constant value and of the actual constant values.
+ * "key" is the rank of the constant value of the first schedule
+ * dimension among those of all sources, or -1 if this dimension
+ * does not have a constant value (or if it has not been computed).
  */
 struct isl_sched_info {
 	int *is_cst;
 	isl_vec *cst;
+	int key;
 };
 
 static void sched_info_free(__isl_take struct isl_sched_info *info)
@@ -1143,6 +1648,7 @@ static __isl_give struct isl_sched_info *sched_info_alloc(
 	info = isl_alloc_type(ctx, struct isl_sched_info);
 	if (!info)
 		return NULL;
+	info->key = -1;
 	info->is_cst = isl_alloc_array(ctx, int, n);
 	info->cst = isl_vec_alloc(ctx, n);
 	if (n && (!info->is_cst || !info->cst))
@@ -1167,6 +1673,26 @@ error:
 	return NULL;
 }
 
+/* A source access, along with its range, the hash value of this range
+ * and information on the schedule of the access.
+ * "must" is set if the access is a must-source.
+ */
+/* "hash" is the hash value of "range", while "map_hash" is
+ * the hash value of "map" itself, which is only computed
+ * if the flow cache is enabled.
+ */
+struct isl_compute_flow_source {
+	isl_map *map;
+	int must;
+	isl_space *range;
+	uint32_t hash;
+	uint32_t map_hash;
+	struct isl_sched_info *info;
+};
+
+/* "source" contains all "n_source" must-sources, followed by
+ * all may-sources.
+ */
 struct isl_compute_flow_data {
 	isl_union_map *must_source;
 	isl_union_map *may_source;
@@ -1175,71 +1701,150 @@ struct isl_compute_flow_data {
 	isl_union_map *must_no_source;
 	isl_union_map *may_no_source;
 
-	int count;
 	int must;
-	isl_space *dim;
-	struct isl_sched_info *sink_info;
-	struct isl_sched_info **source_info;
-	isl_access_info *accesses;
+	int n_source;
+	int max_source;
+	struct isl_compute_flow_source *source;
 };
 
-static int count_matching_array(__isl_take isl_map *map, void *user)
+/* Add "map" to data->source, computing the information on the source
+ * that does not depend on the sink only once.
+ */
+static int add_source(__isl_take isl_map *map, void *user)
 {
-	int eq;
-	isl_space *dim;
-	struct isl_compute_flow_data *data;
+	struct isl_compute_flow_data *data = user;
+	struct isl_compute_flow_source *source;
 
-	data = (struct isl_compute_flow_data *)user;
-
-	dim = isl_space_range(isl_map_get_space(map));
+	if (data->n_source >= data->max_source) {
+		isl_ctx *ctx = isl_map_get_ctx(map);
+		int max = 2 * data->max_source + 1;
 
-	eq = isl_space_is_equal(dim, data->dim);
-
-	isl_space_free(dim);
-	isl_map_free(map);
+		source = isl_realloc_array(ctx, data->source,
+					struct isl_compute_flow_source, max);
+		if (!source)
+			goto error;
+		data->source = source;
+		data->max_source = max;
+	}
 
-	if (eq < 0)
+	source = &data->source[data->n_source];
+	source->map = map;
+	source->must = data->must;
+	source->range = isl_space_range(isl_map_get_space(map));
+	source->info = sched_info_alloc(map);
+	data->n_source++;
+	if (!source->range || !source->info)
 		return -1;
-	if (eq)
-		data->count++;
+	source->hash = isl_space_get_hash(source->range);
+	if (isl_map_get_ctx(map)->opt->flow_cache_size > 0)
+		source->map_hash = isl_map_get_hash(map);
 
 	return 0;
+error:
+	isl_map_free(map);
+	return -1;
 }
 
-static int collect_matching_array(__isl_take isl_map *map, void *user)
+/* Compare the constant values of the first schedule dimension
+ * of the sources at positions "i1" and "i2" of data->source.
+ */
+static int first_cst_cmp(const int *i1, const int *i2,
+	struct isl_compute_flow_data *data)
 {
-	int eq;
-	isl_space *dim;
-	struct isl_sched_info *info;
-	struct isl_compute_flow_data *data;
-
-	data = (struct isl_compute_flow_data *)user;
+	return isl_vec_cmp_element(data->source[*i1].info->cst,
+				    data->source[*i2].info->cst, 0);
+}
 
-	dim = isl_space_range(isl_map_get_space(map));
+#define SORT_FN		sort_by_first_cst
+#define SORT_EL		int
+#define SORT_ARG	struct isl_compute_flow_data *
+#define SORT_CMP	first_cst_cmp
 
-	eq = isl_space_is_equal(dim, data->dim);
+#include <isl_sort_templ.c>
 
-	isl_space_free(dim);
+/* Set the sort keys of the sources in "data" to the ranks
+ * of the constant values of their first schedule dimensions,
+ * such that before() places a source with a smaller key
+ * before a source with a greater key.
+ * The sources without a constant value keep a negative key.
+ */
+static int set_sort_keys(struct isl_compute_flow_data *data)
+{
+	int i, n, key;
+	int *pos;
 
-	if (eq < 0)
-		goto error;
-	if (!eq) {
-		isl_map_free(map);
-		return 0;
+	pos = isl_alloc_array(isl_map_get_ctx(data->source[0].map),
+				int, data->n_source);
+	if (!pos)
+		return -1;
+	n = 0;
+	for (i = 0; i < data->n_source; ++i) {
+		struct isl_sched_info *info = data->source[i].info;
+		if (isl_vec_size(info->cst) > 0 && info->is_cst[0])
+			pos[n++] = i;
+	}
+	if (sort_by_first_cst(pos, n, data) < 0) {
+		free(pos);
+		return -1;
+	}
+	key = 0;
+	for (i = 0; i < n; ++i) {
+		if (i > 0 && first_cst_cmp(&pos[i - 1], &pos[i], data) != 0)
+			key++;
+		data->source[pos[i]].info->key = key;
 	}
+	free(pos);
 
-	info = sched_info_alloc(map);
-	data->source_info[data->count] = info;
+	return 0;
+}
 
-	data->accesses = isl_access_info_add_source(data->accesses,
-						    map, data->must, info);
+/* Return the sort key of the source with schedule information "data".
+ */
+static int sched_info_key(void *data)
+{
+	struct isl_sched_info *info = data;
 
-	data->count++;
+	return info->key;
+}
 
+/* Collect all must-sources and may-sources in data->source and
+ * compute their sort keys.
+ */
+static int collect_sources(struct isl_compute_flow_data *data)
+{
+	data->must = 1;
+	if (isl_union_map_foreach_map(data->must_source,
+					&add_source, data) < 0)
+		return -1;
+	data->must = 0;
+	if (isl_union_map_foreach_map(data->may_source,
+					&add_source, data) < 0)
+		return -1;
+	if (data->n_source > 1 && set_sort_keys(data) < 0)
+		return -1;
 	return 0;
-error:
-	isl_map_free(map);
-	return -1;
+}
+
+static void free_sources(struct isl_compute_flow_data *data)
+{
+	int i;
+
+	for (i = 0; i < data->n_source; ++i) {
+		isl_map_free(data->source[i].map);
+		isl_space_free(data->source[i].range);
+		sched_info_free(data->source[i].info);
+	}
+	free(data->source);
+}
+
+/* Does source "i" access the array "range" with hash value "hash"?
+ */
+static int source_matches(struct isl_compute_flow_data *data, int i,
+	__isl_keep isl_space *range, uint32_t hash)
+{
+	if (data->source[i].hash != hash)
+		return 0;
+	return isl_space_is_equal(data->source[i].range, range);
 }
 
 /* Determine the shared nesting level and the "textual order" of
@@ -1287,99 +1892,751 @@ static int before(void *first, void *second)
 	return 2 * n1;
 }
 
-/* Given a sink access, look for all the source accesses that access
- * the same array and perform dataflow analysis on them using
+/* Given a sink access "map" that accesses the array "range"
+ * with hash value "hash", look for all the source accesses that
+ * access the same array and perform dataflow analysis on them using
  * isl_access_info_compute_flow.
  */
-static int compute_flow(__isl_take isl_map *map, void *user)
+static __isl_give isl_flow *sink_compute_flow(
+	struct isl_compute_flow_data *data, __isl_keep isl_map *map,
+	__isl_keep isl_space *range, uint32_t hash)
 {
 	int i;
-	isl_ctx *ctx;
-	struct isl_compute_flow_data *data;
+	int count;
+	struct isl_sched_info *sink_info;
+	isl_access_info *accesses = NULL;
 	isl_flow *flow;
 
-	data = (struct isl_compute_flow_data *)user;
+	count = 0;
+	for (i = 0; i < data->n_source; ++i) {
+		int eq = source_matches(data, i, range, hash);
+		if (eq < 0)
+			return NULL;
+		if (eq)
+			count++;
+	}
 
-	ctx = isl_map_get_ctx(map);
+	sink_info = sched_info_alloc(map);
+	accesses = isl_access_info_alloc(isl_map_copy(map),
+				sink_info, &before, count);
+	if (!sink_info || !accesses)
+		goto error;
+	accesses->sort_key = &sched_info_key;
+	for (i = 0; i < data->n_source; ++i) {
+		int eq = source_matches(data, i, range, hash);
+		if (eq < 0)
+			goto error;
+		if (!eq)
+			continue;
+		accesses = isl_access_info_add_source(accesses,
+				isl_map_copy(data->source[i].map),
+				data->source[i].must, data->source[i].info);
+	}
 
-	data->accesses = NULL;
-	data->sink_info = NULL;
-	data->source_info = NULL;
-	data->count = 0;
-	data->dim = isl_space_range(isl_map_get_space(map));
+	flow = isl_access_info_compute_flow(accesses);
+	sched_info_free(sink_info);
 
-	if (isl_union_map_foreach_map(data->must_source,
-					&count_matching_array, data) < 0)
-		goto error;
-	if (isl_union_map_foreach_map(data->may_source,
-					&count_matching_array, data) < 0)
-		goto error;
+	return flow;
+error:
+	isl_access_info_free(accesses);
+	sched_info_free(sink_info);
+	return NULL;
+}
 
-	data->sink_info = sched_info_alloc(map);
-	data->source_info = isl_calloc_array(ctx, struct isl_sched_info *,
-					     data->count);
+/* A cached result of the dataflow analysis of the sink access "sink"
+ * with respect to the "n_source" potential sources "source",
+ * where "must" records whether the corresponding source
+ * is a must-source.
+ * The results of the analysis are stored in
+ * "must_no_source", "may_no_source", "must_dep" and "may_dep".
+ */
+struct isl_flow_cache_entry {
+	uint32_t	hash;
+	isl_map		*sink;
+	int		n_source;
+	isl_map		**source;
+	int		*must;
+
+	isl_map		*must_no_source;
+	isl_map		*may_no_source;
+	isl_union_map	*must_dep;
+	isl_union_map	*may_dep;
+
+	struct isl_flow_cache_entry	*prev;
+	struct isl_flow_cache_entry	*next;
+};
 
-	data->accesses = isl_access_info_alloc(isl_map_copy(map),
-				data->sink_info, &before, data->count);
-	if (!data->sink_info || (data->count && !data->source_info) ||
-	    !data->accesses)
-		goto error;
-	data->count = 0;
-	data->must = 1;
-	if (isl_union_map_foreach_map(data->must_source,
-					&collect_matching_array, data) < 0)
+static void flow_cache_entry_free(struct isl_flow_cache_entry *entry)
+{
+	int i;
+
+	if (!entry)
+		return;
+	isl_map_free(entry->sink);
+	if (entry->source)
+		for (i = 0; i < entry->n_source; ++i)
+			isl_map_free(entry->source[i]);
+	free(entry->source);
+	free(entry->must);
+	isl_map_free(entry->must_no_source);
+	isl_map_free(entry->may_no_source);
+	isl_union_map_free(entry->must_dep);
+	isl_union_map_free(entry->may_dep);
+	free(entry);
+}
+
+/* Remove "entry" from the list of cache entries of "ctx".
+ */
+static void flow_cache_unlink(isl_ctx *ctx, struct isl_flow_cache_entry *entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		ctx->flow_cache_first = entry->next;
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		ctx->flow_cache_last = entry->prev;
+	entry->prev = entry->next = NULL;
+}
+
+/* Add "entry" to the front of the list of cache entries of "ctx".
+ */
+static void flow_cache_push_front(isl_ctx *ctx,
+	struct isl_flow_cache_entry *entry)
+{
+	entry->prev = NULL;
+	entry->next = ctx->flow_cache_first;
+	if (ctx->flow_cache_first)
+		ctx->flow_cache_first->prev = entry;
+	else
+		ctx->flow_cache_last = entry;
+	ctx->flow_cache_first = entry;
+}
+
+/* Remove all entries from the flow cache of "ctx".
+ */
+void isl_flow_cache_clear(isl_ctx *ctx)
+{
+	struct isl_flow_cache_entry *entry, *next;
+
+	for (entry = ctx->flow_cache_first; entry; entry = next) {
+		next = entry->next;
+		flow_cache_entry_free(entry);
+	}
+	ctx->flow_cache_first = ctx->flow_cache_last = NULL;
+	ctx->n_flow_cache = 0;
+	isl_hash_table_clear(&ctx->flow_cache);
+	isl_hash_table_init(ctx, &ctx->flow_cache, 0);
+}
+
+/* A sink access that is being looked up in the flow cache,
+ * along with the sources in data->source that access the same array
+ * "range" with hash value "hash".  "n_source" is the number
+ * of these sources.
+ */
+struct isl_flow_cache_query {
+	isl_map				*sink;
+	struct isl_compute_flow_data	*data;
+	isl_space			*range;
+	uint32_t			hash;
+	int				n_source;
+};
+
+/* Compute the hash value "hash" of the sink access and potential sources
+ * of "q" and the number of these sources.
+ * The result of the dataflow analysis does not depend on the order
+ * of the potential sources, so neither does the hash value.
+ */
+static int flow_cache_query_hash(struct isl_flow_cache_query *q,
+	uint32_t *hash)
+{
+	int i;
+	uint32_t source_hash = 0;
+	struct isl_compute_flow_data *data = q->data;
+
+	q->n_source = 0;
+	for (i = 0; i < data->n_source; ++i) {
+		uint32_t h;
+		int eq = source_matches(data, i, q->range, q->hash);
+		if (eq < 0)
+			return -1;
+		if (!eq)
+			continue;
+		h = isl_hash_init();
+		isl_hash_byte(h, data->source[i].must);
+		isl_hash_hash(h, data->source[i].map_hash);
+		source_hash += h;
+		q->n_source++;
+	}
+
+	*hash = isl_hash_init();
+	isl_hash_hash(*hash, isl_map_get_hash(q->sink));
+	isl_hash_hash(*hash, source_hash);
+
+	return 0;
+}
+
+/* Does "entry" have a source that is equal to source "i" of "data",
+ * with the same must flag, that has not been marked in "used" yet?
+ * If so, mark it.
+ */
+static int flow_cache_entry_has_source(const struct isl_flow_cache_entry *e,
+	struct isl_compute_flow_data *data, int i, char *used)
+{
+	int k;
+
+	for (k = 0; k < e->n_source; ++k) {
+		if (used[k] || e->must[k] != data->source[i].must)
+			continue;
+		if (isl_map_plain_is_equal(e->source[k],
+					    data->source[i].map) != 1)
+			continue;
+		used[k] = 1;
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Does cache entry "entry" describe the sink access and
+ * potential sources of the query "val", irrespective of
+ * the order of the sources?
+ */
+static int flow_cache_has_key(const void *entry, const void *val)
+{
+	const struct isl_flow_cache_entry *e = entry;
+	const struct isl_flow_cache_query *q = val;
+	struct isl_compute_flow_data *data = q->data;
+	char *used;
+	int i;
+	int found = 1;
+
+	if (e->n_source != q->n_source)
+		return 0;
+	if (isl_map_plain_is_equal(e->sink, q->sink) != 1)
+		return 0;
+	if (e->n_source == 0)
+		return 1;
+	used = isl_calloc_array(isl_map_get_ctx(q->sink), char, e->n_source);
+	if (!used)
+		return 0;
+	for (i = 0; found && i < data->n_source; ++i) {
+		if (source_matches(data, i, q->range, q->hash) != 1)
+			continue;
+		found = flow_cache_entry_has_source(e, data, i, used);
+	}
+	free(used);
+
+	return found;
+}
+
+static int flow_cache_is_entry(const void *entry, const void *val)
+{
+	return entry == val;
+}
+
+/* Remove the least recently used entry from the flow cache of "ctx".
+ */
+static void flow_cache_evict(isl_ctx *ctx)
+{
+	struct isl_flow_cache_entry *entry = ctx->flow_cache_last;
+	struct isl_hash_table_entry *he;
+
+	he = isl_hash_table_find(ctx, &ctx->flow_cache, entry->hash,
+				&flow_cache_is_entry, entry, 0);
+	if (he)
+		isl_hash_table_remove(ctx, &ctx->flow_cache, he);
+	flow_cache_unlink(ctx, entry);
+	flow_cache_entry_free(entry);
+	ctx->n_flow_cache--;
+}
+
+/* Construct a flow cache entry for the query "q" with hash value "hash"
+ * that holds the results of the dataflow analysis "flow".
+ */
+static struct isl_flow_cache_entry *flow_cache_entry_alloc(
+	struct isl_flow_cache_query *q, uint32_t hash, __isl_keep isl_flow *flow)
+{
+	int i, k;
+	isl_ctx *ctx;
+	isl_space *space;
+	struct isl_compute_flow_data *data = q->data;
+	struct isl_flow_cache_entry *entry;
+
+	ctx = isl_map_get_ctx(q->sink);
+	entry = isl_calloc_type(ctx, struct isl_flow_cache_entry);
+	if (!entry)
+		return NULL;
+	entry->hash = hash;
+	entry->sink = isl_map_copy(q->sink);
+	entry->n_source = q->n_source;
+	entry->source = isl_calloc_array(ctx, isl_map *, q->n_source);
+	entry->must = isl_alloc_array(ctx, int, q->n_source);
+	if (q->n_source && (!entry->source || !entry->must))
 		goto error;
-	data->must = 0;
-	if (isl_union_map_foreach_map(data->may_source,
-					&collect_matching_array, data) < 0)
+	for (i = 0, k = 0; i < data->n_source; ++i) {
+		if (source_matches(data, i, q->range, q->hash) != 1)
+			continue;
+		entry->source[k] = isl_map_copy(data->source[i].map);
+		entry->must[k] = data->source[i].must;
+		k++;
+	}
+
+	entry->must_no_source = isl_flow_get_no_source(flow, 1);
+	entry->may_no_source = isl_flow_get_no_source(flow, 0);
+	space = isl_space_params(isl_map_get_space(q->sink));
+	entry->must_dep = isl_union_map_empty(isl_space_copy(space));
+	entry->may_dep = isl_union_map_empty(space);
+	for (i = 0; i < flow->n_source; ++i) {
+		isl_union_map *dep;
+		dep = isl_union_map_from_map(isl_map_copy(flow->dep[i].map));
+		if (flow->dep[i].must)
+			entry->must_dep = isl_union_map_union(entry->must_dep,
+								dep);
+		else
+			entry->may_dep = isl_union_map_union(entry->may_dep,
+								dep);
+	}
+	if (!entry->must_no_source || !entry->may_no_source ||
+	    !entry->must_dep || !entry->may_dep)
 		goto error;
 
-	flow = isl_access_info_compute_flow(data->accesses);
-	data->accesses = NULL;
+	return entry;
+error:
+	flow_cache_entry_free(entry);
+	return NULL;
+}
+
+/* Add "entry" to the flow cache of "ctx", evicting the least recently
+ * used entries if the cache would otherwise exceed the size specified
+ * by the flow_cache_size option.
+ */
+static int flow_cache_add(isl_ctx *ctx, struct isl_flow_cache_query *q,
+	struct isl_flow_cache_entry *entry)
+{
+	struct isl_hash_table_entry *he;
+
+	while (ctx->n_flow_cache > 0 &&
+	       ctx->n_flow_cache >= ctx->opt->flow_cache_size)
+		flow_cache_evict(ctx);
+
+	he = isl_hash_table_find(ctx, &ctx->flow_cache, entry->hash,
+				&flow_cache_has_key, q, 1);
+	if (!he)
+		return -1;
+	he->data = entry;
+	flow_cache_push_front(ctx, entry);
+	ctx->n_flow_cache++;
+
+	return 0;
+}
+
+/* Look up the results of the dataflow analysis of the sink access "map",
+ * which accesses the array "range" with hash value "hash",
+ * with respect to the matching sources in data->source
+ * in the flow cache of "ctx" and compute and store them
+ * in the cache if they cannot be found.
+ * The cache may have been filled up under a larger value
+ * of the flow_cache_size option, so first drop any entries
+ * beyond the current size.
+ *
+ * The sink and the sources are compared after their domains
+ * have been prefixed with the schedule, so a change in the schedule
+ * of any of the accesses also results in a cache miss.
+ */
+static struct isl_flow_cache_entry *sink_compute_flow_cached(isl_ctx *ctx,
+	struct isl_compute_flow_data *data, __isl_keep isl_map *map,
+	__isl_keep isl_space *range, uint32_t hash)
+{
+	struct isl_flow_cache_query q;
+	struct isl_hash_table_entry *he;
+	struct isl_flow_cache_entry *entry;
+	uint32_t key_hash;
+	isl_flow *flow;
+
+	while (ctx->n_flow_cache > ctx->opt->flow_cache_size)
+		flow_cache_evict(ctx);
+
+	q.sink = map;
+	q.data = data;
+	q.range = range;
+	q.hash = hash;
+	if (flow_cache_query_hash(&q, &key_hash) < 0)
+		return NULL;
 
+	he = isl_hash_table_find(ctx, &ctx->flow_cache, key_hash,
+				&flow_cache_has_key, &q, 0);
+	if (he) {
+		ctx->stats->flow_cache_hits++;
+		entry = he->data;
+		flow_cache_unlink(ctx, entry);
+		flow_cache_push_front(ctx, entry);
+		return entry;
+	}
+	ctx->stats->flow_cache_misses++;
+
+	flow = sink_compute_flow(data, map, range, hash);
 	if (!flow)
-		goto error;
+		return NULL;
+	entry = flow_cache_entry_alloc(&q, key_hash, flow);
+	isl_flow_free(flow);
+	if (!entry)
+		return NULL;
+	if (flow_cache_add(ctx, &q, entry) < 0) {
+		flow_cache_entry_free(entry);
+		return NULL;
+	}
 
+	return entry;
+}
+
+/* Add the results of the dataflow analysis stored in the flow cache
+ * entry "entry" to "data".
+ */
+static void add_cached_flow(struct isl_compute_flow_data *data,
+	struct isl_flow_cache_entry *entry)
+{
 	data->must_no_source = isl_union_map_union(data->must_no_source,
-		    isl_union_map_from_map(isl_flow_get_no_source(flow, 1)));
+		isl_union_map_from_map(isl_map_copy(entry->must_no_source)));
 	data->may_no_source = isl_union_map_union(data->may_no_source,
+		isl_union_map_from_map(isl_map_copy(entry->may_no_source)));
+	data->must_dep = isl_union_map_union(data->must_dep,
+				isl_union_map_copy(entry->must_dep));
+	data->may_dep = isl_union_map_union(data->may_dep,
+				isl_union_map_copy(entry->may_dep));
+}
+
+/* Add the dependences and the sink iterations without source
+ * computed in "flow" to "must_dep", "may_dep", "must_no_source"
+ * and "may_no_source".
+ */
+static void add_flow(__isl_keep isl_flow *flow,
+	isl_union_map **must_dep, isl_union_map **may_dep,
+	isl_union_map **must_no_source, isl_union_map **may_no_source)
+{
+	int i;
+
+	*must_no_source = isl_union_map_union(*must_no_source,
+		    isl_union_map_from_map(isl_flow_get_no_source(flow, 1)));
+	*may_no_source = isl_union_map_union(*may_no_source,
 		    isl_union_map_from_map(isl_flow_get_no_source(flow, 0)));
 
 	for (i = 0; i < flow->n_source; ++i) {
 		isl_union_map *dep;
 		dep = isl_union_map_from_map(isl_map_copy(flow->dep[i].map));
 		if (flow->dep[i].must)
-			data->must_dep = isl_union_map_union(data->must_dep, dep);
+			*must_dep = isl_union_map_union(*must_dep, dep);
 		else
-			data->may_dep = isl_union_map_union(data->may_dep, dep);
+			*may_dep = isl_union_map_union(*may_dep, dep);
 	}
+}
 
-	isl_flow_free(flow);
+/* Given a sink access, look for all the source accesses that access
+ * the same array and perform dataflow analysis on them using
+ * isl_access_info_compute_flow.
+ * If the flow cache is enabled, then the results of an earlier
+ * analysis of the same sink with respect to the same sources
+ * are reused if available.  This allows a caller that reruns
+ * isl_union_map_compute_flow after adding or modifying some
+ * accesses to only recompute the results for the affected sinks.
+ */
+static int compute_flow(__isl_take isl_map *map, void *user)
+{
+	uint32_t hash;
+	isl_ctx *ctx;
+	struct isl_compute_flow_data *data;
+	isl_space *range;
+	isl_flow *flow;
+
+	data = (struct isl_compute_flow_data *)user;
+
+	ctx = isl_map_get_ctx(map);
+
+	range = isl_space_range(isl_map_get_space(map));
+	if (!range)
+		goto error;
+	hash = isl_space_get_hash(range);
 
-	sched_info_free(data->sink_info);
-	if (data->source_info) {
-		for (i = 0; i < data->count; ++i)
-			sched_info_free(data->source_info[i]);
-		free(data->source_info);
+	if (ctx->opt->flow_cache_size > 0) {
+		struct isl_flow_cache_entry *entry;
+
+		entry = sink_compute_flow_cached(ctx, data, map, range, hash);
+		if (!entry)
+			goto error;
+		add_cached_flow(data, entry);
+		isl_space_free(range);
+		isl_map_free(map);
+		return 0;
 	}
-	isl_space_free(data->dim);
+
+	flow = sink_compute_flow(data, map, range, hash);
+	if (!flow)
+		goto error;
+
+	add_flow(flow, &data->must_dep, &data->may_dep,
+		&data->must_no_source, &data->may_no_source);
+
+	isl_flow_free(flow);
+
+	isl_space_free(range);
 	isl_map_free(map);
 
 	return 0;
 error:
-	isl_access_info_free(data->accesses);
-	sched_info_free(data->sink_info);
-	if (data->source_info) {
-		for (i = 0; i < data->count; ++i)
-			sched_info_free(data->source_info[i]);
-		free(data->source_info);
-	}
-	isl_space_free(data->dim);
+	isl_space_free(range);
 	isl_map_free(map);
 
 	return -1;
 }
 
+#ifdef HAVE_PTHREAD
+
+/* The results of the dataflow analysis of a single sink access.
+ */
+struct isl_compute_flow_sink_result {
+	isl_union_map *must_dep;
+	isl_union_map *may_dep;
+	isl_union_map *must_no_source;
+	isl_union_map *may_no_source;
+};
+
+/* Data used by compute_flow_threads and its workers.
+ * "sink" contains the "n" sink accesses, which live in "ctx",
+ * as do the sources in "data".
+ * "res" is filled with the results of the analysis of each sink,
+ * imported back into "ctx".
+ */
+struct isl_compute_flow_threads {
+	isl_ctx *ctx;
+	struct isl_compute_flow_data *data;
+	int n;
+	isl_map **sink;
+	struct isl_compute_flow_sink_result *res;
+};
+
+static void sink_result_free(struct isl_compute_flow_sink_result *res)
+{
+	isl_union_map_free(res->must_dep);
+	isl_union_map_free(res->may_dep);
+	isl_union_map_free(res->must_no_source);
+	isl_union_map_free(res->may_no_source);
+}
+
+/* Import the sink access at position "i" and the source accesses
+ * that access the same array into the isl_ctx of "worker",
+ * perform the dataflow analysis on them and import the results back.
+ *
+ * The sources that access the same array are selected in "ctx",
+ * since the spaces of the worker copies cannot be compared
+ * to those of the sources in "ctx".
+ * The schedule information of the sources is recomputed
+ * on the worker copies, but the sort keys are copied
+ * from the original sources since they depend on all sources.
+ */
+static int compute_flow_work(struct isl_thread_worker *worker, int i,
+	void *user)
+{
+	struct isl_compute_flow_threads *threads = user;
+	struct isl_compute_flow_data *data = threads->data;
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	struct isl_compute_flow_sink_result res = { NULL };
+	struct isl_sched_info *sink_info = NULL;
+	struct isl_sched_info **info = NULL;
+	isl_access_info *accesses = NULL;
+	isl_map **source = NULL;
+	int *pos = NULL;
+	isl_space *range, *space;
+	isl_flow *flow;
+	isl_map *sink;
+	uint32_t hash;
+	int j, n = 0;
+	int r = -1;
+
+	isl_thread_worker_lock(worker);
+	sink = isl_map_import(ctx, threads->sink[i]);
+	range = isl_space_range(isl_map_get_space(threads->sink[i]));
+	pos = isl_alloc_array(ctx, int, data->n_source);
+	source = isl_calloc_array(ctx, isl_map *, data->n_source);
+	if (range && (data->n_source == 0 || (pos && source))) {
+		hash = isl_space_get_hash(range);
+		for (j = 0; j < data->n_source; ++j) {
+			int eq = source_matches(data, j, range, hash);
+			if (eq < 0)
+				break;
+			if (!eq)
+				continue;
+			pos[n] = j;
+			source[n++] = isl_map_import(ctx, data->source[j].map);
+		}
+		if (j >= data->n_source)
+			r = 0;
+	}
+	isl_space_free(range);
+	isl_thread_worker_unlock(worker);
+	if (r < 0)
+		goto error;
+
+	info = isl_calloc_array(ctx, struct isl_sched_info *, n);
+	sink_info = sched_info_alloc(sink);
+	accesses = isl_access_info_alloc(isl_map_copy(sink),
+				sink_info, &before, n);
+	if ((n && !info) || !sink_info || !accesses)
+		goto error;
+	accesses->sort_key = &sched_info_key;
+	for (j = 0; j < n; ++j) {
+		info[j] = sched_info_alloc(source[j]);
+		if (!info[j])
+			goto error;
+		info[j]->key = data->source[pos[j]].info->key;
+		accesses = isl_access_info_add_source(accesses, source[j],
+				data->source[pos[j]].must, info[j]);
+		source[j] = NULL;
+	}
+
+	flow = isl_access_info_compute_flow(accesses);
+	accesses = NULL;
+	if (!flow)
+		goto error;
+	space = isl_space_params(isl_map_get_space(sink));
+	res.must_dep = isl_union_map_empty(isl_space_copy(space));
+	res.may_dep = isl_union_map_empty(isl_space_copy(space));
+	res.must_no_source = isl_union_map_empty(isl_space_copy(space));
+	res.may_no_source = isl_union_map_empty(space);
+	add_flow(flow, &res.must_dep, &res.may_dep,
+		&res.must_no_source, &res.may_no_source);
+	isl_flow_free(flow);
+
+	isl_thread_worker_lock(worker);
+	threads->res[i].must_dep = isl_union_map_import(threads->ctx,
+							res.must_dep);
+	threads->res[i].may_dep = isl_union_map_import(threads->ctx,
+							res.may_dep);
+	threads->res[i].must_no_source = isl_union_map_import(threads->ctx,
+							res.must_no_source);
+	threads->res[i].may_no_source = isl_union_map_import(threads->ctx,
+							res.may_no_source);
+	isl_thread_worker_unlock(worker);
+
+	if (threads->res[i].must_dep && threads->res[i].may_dep &&
+	    threads->res[i].must_no_source && threads->res[i].may_no_source)
+		r = 0;
+	else
+		r = -1;
+	if (0)
+error:
+		r = -1;
+	sink_result_free(&res);
+	isl_access_info_free(accesses);
+	for (j = 0; info && j < n; ++j)
+		sched_info_free(info[j]);
+	for (j = 0; source && j < n; ++j)
+		isl_map_free(source[j]);
+	sched_info_free(sink_info);
+	isl_map_free(sink);
+	free(info);
+	free(source);
+	free(pos);
+	return r;
+}
+
+/* Add a copy of "map" to the array pointed to by "user".
+ */
+static int collect_sink(__isl_take isl_map *map, void *user)
+{
+	isl_map ***next = user;
+
+	*(*next)++ = map;
+	return 0;
+}
+
+/* Perform the dataflow analysis of each sink access in "sink"
+ * with respect to the sources in "data" using several threads and
+ * add the results to "data".
+ *
+ * Each thread has its own isl_ctx, with the same options as
+ * the isl_ctx of "sink", into which it imports the sink accesses
+ * that it handles along with their potential sources
+ * (see isl_thread_run).
+ * The results are added to "data" in the order of the sink accesses
+ * in "sink", such that they do not depend on which thread
+ * handled which sink access.
+ */
+static int compute_flow_threads(struct isl_compute_flow_data *data,
+	__isl_keep isl_union_map *sink)
+{
+	int i;
+	isl_ctx *ctx;
+	isl_map **next;
+	struct isl_compute_flow_threads threads = { 0 };
+	int r = -1;
+
+	ctx = isl_union_map_get_ctx(sink);
+	threads.ctx = ctx;
+	threads.data = data;
+	threads.n = isl_union_map_n_map(sink);
+	threads.sink = isl_calloc_array(ctx, isl_map *, threads.n);
+	threads.res = isl_calloc_array(ctx,
+			struct isl_compute_flow_sink_result, threads.n);
+	if (!threads.sink || !threads.res)
+		goto error;
+	next = threads.sink;
+	if (isl_union_map_foreach_map(sink, &collect_sink, &next) < 0)
+		goto error;
+	if (isl_thread_run(ctx, threads.n, &compute_flow_work, &threads) < 0)
+		goto error;
+
+	for (i = 0; i < threads.n; ++i) {
+		struct isl_compute_flow_sink_result *res = &threads.res[i];
+
+		data->must_no_source = isl_union_map_union(
+			data->must_no_source, res->must_no_source);
+		data->may_no_source = isl_union_map_union(
+			data->may_no_source, res->may_no_source);
+		data->must_dep = isl_union_map_union(data->must_dep,
+							res->must_dep);
+		data->may_dep = isl_union_map_union(data->may_dep,
+							res->may_dep);
+		res->must_dep = res->may_dep = NULL;
+		res->must_no_source = res->may_no_source = NULL;
+	}
+
+	r = 0;
+error:
+	for (i = 0; threads.res && i < threads.n; ++i)
+		sink_result_free(&threads.res[i]);
+	for (i = 0; threads.sink && i < threads.n; ++i)
+		isl_map_free(threads.sink[i]);
+	free(threads.res);
+	free(threads.sink);
+	return r;
+}
+
+#endif
+
+/* Perform the dataflow analysis of each sink access in "sink"
+ * with respect to the sources in "data" and add the results to "data".
+ * If the threads option is set to a value greater than one,
+ * isl has been built with thread support and the flow cache
+ * (which lives in the isl_ctx) is disabled, then the sink accesses
+ * are handled by several threads in parallel.
+ */
+static int compute_flow_sinks(struct isl_compute_flow_data *data,
+	__isl_keep isl_union_map *sink)
+{
+#ifdef HAVE_PTHREAD
+	isl_ctx *ctx;
+
+	if (!sink)
+		return -1;
+	ctx = isl_union_map_get_ctx(sink);
+	if (ctx->opt->threads > 1 && ctx->opt->flow_cache_size <= 0 &&
+	    isl_union_map_n_map(sink) > 1)
+		return compute_flow_threads(data, sink);
+#endif
+	return isl_union_map_foreach_map(sink, &compute_flow, data);
+}
+
 /* Given a collection of "sink" and "source" accesses,
  * compute for each iteration of a sink access
  * and for each element accessed by that iteration,
@@ -1394,9 +2651,11 @@ error:
  *
  * We first prepend the schedule dimensions to the domain
  * of the accesses so that we can easily compare their relative order.
- * Then we consider each sink access individually in compute_flow.
+ * Then we collect the information on the source accesses that
+ * does not depend on the sink access and consider each sink access
+ * individually in compute_flow_sinks.
  */
-int isl_union_map_compute_flow(__isl_take isl_union_map *sink,
+static int union_map_compute_flow(__isl_take isl_union_map *sink,
 	__isl_take isl_union_map *must_source,
 	__isl_take isl_union_map *may_source,
 	__isl_take isl_union_map *schedule,
@@ -1429,6 +2688,9 @@ int isl_union_map_compute_flow(__isl_take isl_union_map *sink,
 
 	data.must_source = must_source;
 	data.may_source = may_source;
+	data.n_source = 0;
+	data.max_source = 0;
+	data.source = NULL;
 	data.must_dep = must_dep ?
 		isl_union_map_empty(isl_space_copy(dim)) : NULL;
 	data.may_dep = may_dep ? isl_union_map_empty(isl_space_copy(dim)) : NULL;
@@ -1439,9 +2701,12 @@ int isl_union_map_compute_flow(__isl_take isl_union_map *sink,
 
 	isl_space_free(dim);
 
-	if (isl_union_map_foreach_map(sink, &compute_flow, &data) < 0)
+	if (collect_sources(&data) < 0)
+		goto error;
+	if (compute_flow_sinks(&data, sink) < 0)
 		goto error;
 
+	free_sources(&data);
 	isl_union_map_free(sink);
 	isl_union_map_free(must_source);
 	isl_union_map_free(may_source);
@@ -1475,6 +2740,7 @@ int isl_union_map_compute_flow(__isl_take isl_union_map *sink,
 
 	return 0;
 error:
+	free_sources(&data);
 	isl_union_map_free(range_map);
 	isl_union_map_free(sink);
 	isl_union_map_free(must_source);
@@ -1494,3 +2760,26 @@ error:
 		*may_no_source = NULL;
 	return -1;
 }
+
+/* Compute the dependences between the "sink" and the "source" accesses
+ * (see union_map_compute_flow).
+ */
+int isl_union_map_compute_flow(__isl_take isl_union_map *sink,
+	__isl_take isl_union_map *must_source,
+	__isl_take isl_union_map *may_source,
+	__isl_take isl_union_map *schedule,
+	__isl_give isl_union_map **must_dep, __isl_give isl_union_map **may_dep,
+	__isl_give isl_union_map **must_no_source,
+	__isl_give isl_union_map **may_no_source)
+{
+	isl_ctx *ctx = isl_union_map_get_ctx(sink);
+	struct isl_profile_node *prof;
+	int r;
+
+	prof = isl_profile_enter(ctx, "isl_union_map_compute_flow");
+	r = union_map_compute_flow(sink, must_source, may_source, schedule,
+				must_dep, may_dep, must_no_source, may_no_source);
+	isl_profile_leave(ctx, prof);
+
+	return r;
+}
@@ -0,0 +1,8 @@
+#ifndef ISL_FLOW_PRIVATE_H
+#define ISL_FLOW_PRIVATE_H
+
+#include <isl/flow.h>
+
+void isl_flow_cache_clear(isl_ctx *ctx);
+
+#endif
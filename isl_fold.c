@@ -9,12 +9,14 @@
  */
 
 #define ISL_DIM_H
+#include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl_union_map_private.h>
 #include <isl_polynomial_private.h>
 #include <isl_point_private.h>
 #include <isl_space_private.h>
 #include <isl_lp_private.h>
+#include <isl/hash.h>
 #include <isl_seq.h>
 #include <isl_mat_private.h>
 #include <isl_val_private.h>
@@ -393,6 +395,163 @@ static int isl_qpolynomial_sign(__isl_keep isl_set *set,
 	return sgn;
 }
 
+/* Compute a hash of "up".
+ * If "skip_cst" is set, then the constant term, i.e., the constant
+ * reached by following the zeroth coefficients, is not taken
+ * into account.
+ */
+static uint32_t upoly_get_hash(__isl_keep struct isl_upoly *up, int skip_cst)
+{
+	int i;
+	uint32_t hash, h;
+	struct isl_upoly_rec *rec;
+
+	hash = isl_hash_init();
+	if (isl_upoly_is_cst(up)) {
+		struct isl_upoly_cst *cst = isl_upoly_as_cst(up);
+		if (skip_cst)
+			return hash;
+		h = isl_seq_get_hash(&cst->n, 1);
+		isl_hash_hash(hash, h);
+		h = isl_seq_get_hash(&cst->d, 1);
+		isl_hash_hash(hash, h);
+		return hash;
+	}
+
+	rec = isl_upoly_as_rec(up);
+	isl_hash_hash(hash, up->var);
+	isl_hash_hash(hash, rec->n);
+	for (i = 0; i < rec->n; ++i) {
+		h = upoly_get_hash(rec->p[i], skip_cst && i == 0);
+		isl_hash_hash(hash, h);
+	}
+
+	return hash;
+}
+
+/* Compute a hash of "qp" that does not depend on its constant term.
+ * Two quasi-polynomials with the same integer divisions that
+ * differ by a constant therefore have the same hash.
+ */
+static uint32_t qpolynomial_get_non_cst_hash(__isl_keep isl_qpolynomial *qp)
+{
+	int i;
+	uint32_t hash, h;
+
+	hash = isl_hash_init();
+	isl_hash_hash(hash, qp->div->n_row);
+	for (i = 0; i < qp->div->n_row; ++i) {
+		h = isl_seq_get_hash(qp->div->row[i], qp->div->n_col);
+		isl_hash_hash(hash, h);
+	}
+	h = upoly_get_hash(qp->upoly, 1);
+	isl_hash_hash(hash, h);
+
+	return hash;
+}
+
+/* Is "qp" infinite or NaN?
+ */
+static int qpolynomial_is_special(__isl_keep isl_qpolynomial *qp)
+{
+	return isl_qpolynomial_is_nan(qp) || isl_qpolynomial_is_infty(qp) ||
+		isl_qpolynomial_is_neginfty(qp);
+}
+
+/* Check if "qp1" or "qp2" can be dropped from a fold of type "type"
+ * without any knowledge about the domain.
+ * Return 1 if "qp2" can be dropped, -1 if "qp1" can be dropped
+ * and 0 if neither can be dropped (or if we cannot tell cheaply).
+ *
+ * If the two are obviously equal, then "qp2" is dropped.
+ * Otherwise, if neither is infinite or NaN and their difference
+ * is a constant, then the smaller (for isl_fold_max) or
+ * greater (for isl_fold_min) of the two is dominated everywhere.
+ */
+static int qpolynomial_plain_dominates(enum isl_fold type,
+	__isl_keep isl_qpolynomial *qp1, __isl_keep isl_qpolynomial *qp2)
+{
+	isl_qpolynomial *d;
+	int equal, is_cst, sgn;
+
+	equal = isl_qpolynomial_plain_is_equal(qp1, qp2);
+	if (equal < 0 || equal)
+		return equal < 0 ? 0 : 1;
+	if (qpolynomial_is_special(qp1) || qpolynomial_is_special(qp2))
+		return 0;
+
+	d = isl_qpolynomial_sub(isl_qpolynomial_copy(qp1),
+				isl_qpolynomial_copy(qp2));
+	is_cst = isl_qpolynomial_is_cst(d, NULL, NULL);
+	sgn = is_cst > 0 ? isl_qpolynomial_cst_sign(d) : 0;
+	isl_qpolynomial_free(d);
+
+	if (type == isl_fold_min)
+		sgn = -sgn;
+	return sgn;
+}
+
+/* Remove the elements of "fold" that are obviously redundant,
+ * i.e., those that are identical to another element or
+ * that differ from another element by a constant in the wrong direction.
+ * Since these checks do not depend on the domain, they are
+ * much cheaper than the checks performed by
+ * isl_qpolynomial_fold_fold_on_domain.
+ *
+ * Only pairs of elements with the same hash (computed without
+ * taking into account the constant term) can be redundant
+ * with respect to each other, so we first compute these hashes
+ * and then only compare pairs of elements with equal hashes.
+ * Folds of type isl_fold_list are left untouched.
+ */
+static __isl_give isl_qpolynomial_fold *fold_remove_redundant(
+	__isl_take isl_qpolynomial_fold *fold)
+{
+	int i, j, n;
+	uint32_t *hash;
+
+	if (!fold)
+		return NULL;
+	if (fold->n <= 1 || fold->type == isl_fold_list)
+		return fold;
+
+	hash = isl_alloc_array(fold->dim->ctx, uint32_t, fold->n);
+	if (!hash) {
+		isl_qpolynomial_fold_free(fold);
+		return NULL;
+	}
+	for (i = 0; i < fold->n; ++i)
+		hash[i] = qpolynomial_get_non_cst_hash(fold->qp[i]);
+
+	n = 0;
+	for (i = 0; i < fold->n; ++i) {
+		int dom = 0;
+
+		for (j = 0; j < n; ++j) {
+			if (hash[j] != hash[i])
+				continue;
+			dom = qpolynomial_plain_dominates(fold->type,
+						fold->qp[j], fold->qp[i]);
+			if (dom)
+				break;
+		}
+		if (dom > 0) {
+			isl_qpolynomial_free(fold->qp[i]);
+		} else if (dom < 0) {
+			isl_qpolynomial_free(fold->qp[j]);
+			fold->qp[j] = fold->qp[i];
+		} else {
+			fold->qp[n] = fold->qp[i];
+			hash[n] = hash[i];
+			n++;
+		}
+	}
+	fold->n = n;
+
+	free(hash);
+	return fold;
+}
+
 __isl_give isl_qpolynomial_fold *isl_qpolynomial_fold_fold_on_domain(
 	__isl_keep isl_set *set,
 	__isl_take isl_qpolynomial_fold *fold1,
@@ -433,6 +592,9 @@ __isl_give isl_qpolynomial_fold *isl_qpolynomial_fold_fold_on_domain(
 			goto error;
 		res->n++;
 	}
+	res = fold_remove_redundant(res);
+	if (!res)
+		goto error;
 	n1 = res->n;
 
 	for (i = 0; i < fold2->n; ++i) {
@@ -467,7 +629,7 @@ __isl_give isl_qpolynomial_fold *isl_qpolynomial_fold_fold_on_domain(
 	isl_qpolynomial_fold_free(fold1);
 	isl_qpolynomial_fold_free(fold2);
 
-	return res;
+	return fold_remove_redundant(res);
 error:
 	isl_qpolynomial_fold_free(res);
 	isl_qpolynomial_fold_free(fold1);
@@ -721,6 +883,37 @@ error:
 	return NULL;
 }
 
+/* Return a copy of "fold" that is allocated in "ctx".
+ */
+__isl_give isl_qpolynomial_fold *isl_qpolynomial_fold_import(isl_ctx *ctx,
+	__isl_keep isl_qpolynomial_fold *fold)
+{
+	int i;
+	isl_qpolynomial_fold *dup;
+
+	if (!fold)
+		return NULL;
+	if (fold->dim->ctx == ctx)
+		return isl_qpolynomial_fold_copy(fold);
+
+	dup = qpolynomial_fold_alloc(fold->type,
+				isl_space_import(ctx, fold->dim), fold->n);
+	if (!dup)
+		return NULL;
+
+	dup->n = fold->n;
+	for (i = 0; i < fold->n; ++i) {
+		dup->qp[i] = isl_qpolynomial_import(ctx, fold->qp[i]);
+		if (!dup->qp[i])
+			goto error;
+	}
+
+	return dup;
+error:
+	isl_qpolynomial_fold_free(dup);
+	return NULL;
+}
+
 __isl_give isl_qpolynomial_fold *isl_qpolynomial_fold_cow(
 	__isl_take isl_qpolynomial_fold *fold)
 {
@@ -802,7 +995,7 @@ __isl_give isl_qpolynomial_fold *isl_qpolynomial_fold_fold(
 	isl_qpolynomial_fold_free(fold1);
 	isl_qpolynomial_fold_free(fold2);
 
-	return res;
+	return fold_remove_redundant(res);
 error:
 	isl_qpolynomial_fold_free(res);
 	isl_qpolynomial_fold_free(fold1);
@@ -817,6 +1010,7 @@ __isl_give isl_pw_qpolynomial_fold *isl_pw_qpolynomial_fold_fold(
 	int i, j, n;
 	struct isl_pw_qpolynomial_fold *res;
 	isl_set *set;
+	struct isl_map_plain_boxes *boxes1 = NULL, *boxes2 = NULL;
 
 	if (!pw1 || !pw2)
 		goto error;
@@ -837,6 +1031,11 @@ __isl_give isl_pw_qpolynomial_fold *isl_pw_qpolynomial_fold_fold(
 		isl_die(pw1->dim->ctx, isl_error_invalid,
 			"fold types don't match", goto error);
 
+	boxes1 = isl_pw_qpolynomial_fold_plain_boxes(pw1);
+	boxes2 = isl_pw_qpolynomial_fold_plain_boxes(pw2);
+	if (!boxes1 || !boxes2)
+		goto error;
+
 	n = (pw1->n + 1) * (pw2->n + 1);
 	res = isl_pw_qpolynomial_fold_alloc_size(isl_space_copy(pw1->dim),
 						pw1->type, n);
@@ -846,6 +1045,9 @@ __isl_give isl_pw_qpolynomial_fold *isl_pw_qpolynomial_fold_fold(
 		for (j = 0; j < pw2->n; ++j) {
 			struct isl_set *common;
 			isl_qpolynomial_fold *sum;
+			if (isl_pw_qpolynomial_fold_pieces_plain_disjoint(
+				    pw1->dim->ctx, boxes1, i, boxes2, j))
+				continue;
 			set = isl_set_subtract(set,
 					isl_set_copy(pw2->p[j].set));
 			common = isl_set_intersect(isl_set_copy(pw1->p[i].set),
@@ -867,17 +1069,25 @@ __isl_give isl_pw_qpolynomial_fold *isl_pw_qpolynomial_fold_fold(
 
 	for (j = 0; j < pw2->n; ++j) {
 		set = isl_set_copy(pw2->p[j].set);
-		for (i = 0; i < pw1->n; ++i)
+		for (i = 0; i < pw1->n; ++i) {
+			if (isl_map_plain_boxes_is_disjoint(boxes1, i,
+							    boxes2, j))
+				continue;
 			set = isl_set_subtract(set, isl_set_copy(pw1->p[i].set));
+		}
 		res = isl_pw_qpolynomial_fold_add_piece(res, set,
 				    isl_qpolynomial_fold_copy(pw2->p[j].fold));
 	}
 
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
 	isl_pw_qpolynomial_fold_free(pw1);
 	isl_pw_qpolynomial_fold_free(pw2);
 
 	return res;
 error:
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
 	isl_pw_qpolynomial_fold_free(pw1);
 	isl_pw_qpolynomial_fold_free(pw2);
 	return NULL;
@@ -0,0 +1,23 @@
+#ifndef ISL_GIST_PRIVATE_H
+#define ISL_GIST_PRIVATE_H
+
+#include <isl/map.h>
+#include <isl/set.h>
+
+struct isl_map_gist_context;
+typedef struct isl_map_gist_context isl_map_gist_context;
+
+__isl_give isl_map_gist_context *isl_map_gist_context_alloc(
+	__isl_take isl_map *context);
+__isl_give isl_map_gist_context *isl_set_gist_context_alloc(
+	__isl_take isl_set *context);
+__isl_give isl_map_gist_context *isl_map_gist_context_copy(
+	__isl_keep isl_map_gist_context *gc);
+__isl_null isl_map_gist_context *isl_map_gist_context_free(
+	__isl_take isl_map_gist_context *gc);
+__isl_give isl_map *isl_map_gist_with_context(__isl_take isl_map *map,
+	__isl_keep isl_map_gist_context *gc);
+__isl_give isl_set *isl_set_gist_with_context(__isl_take isl_set *set,
+	__isl_keep isl_map_gist_context *gc);
+
+#endif
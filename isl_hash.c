@@ -10,7 +10,7 @@
 #include <stdlib.h>
 #include <strings.h>
 #include <isl/hash.h>
-#include <isl/ctx.h>
+#include <isl_ctx_private.h>
 #include "isl_config.h"
 
 uint32_t isl_hash_string(uint32_t hash, const char *s)
@@ -52,6 +52,7 @@ int isl_hash_table_init(struct isl_ctx *ctx, struct isl_hash_table *table,
 		min_size = 2;
 	table->bits = ffs(round_up(4 * (min_size + 1) / 3 - 1)) - 1;
 	table->n = 0;
+	table->max_probe = 0;
 
 	size = 1 << table->bits;
 	table->entries = isl_calloc_array(ctx, struct isl_hash_table_entry,
@@ -62,30 +63,116 @@ int isl_hash_table_init(struct isl_ctx *ctx, struct isl_hash_table *table,
 	return 0;
 }
 
-/* Dummy comparison function that always returns false.
+/* Return the distance of the entry at position "h" of "table"
+ * from its home position, i.e., the position determined by its hash value.
  */
-static int no(const void *entry, const void *val)
+static uint32_t probe_distance(struct isl_hash_table *table, uint32_t h)
 {
-	return 0;
+	uint32_t mask = (1 << table->bits) - 1;
+	uint32_t home = isl_hash_bits(table->entries[h].hash, table->bits);
+
+	return (h - home) & mask;
 }
 
-/* Extend "table" to twice its size.
+/* Look for an entry with hash value "key_hash" in "table"
+ * that is equal to "val" according to "eq".
+ * Return a pointer to this entry if it exists and NULL otherwise.
+ * In both cases, set *pos to the position where the lookup stopped and
+ * *n to the number of entries that were inspected (including
+ * the one at the final position).
+ * If no entry was found and *pos refers to an empty position,
+ * then this is where a new entry with hash value "key_hash"
+ * should be inserted.
+ *
+ * The table uses linear probing, but no entry is stored more than
+ * table->max_probe positions past its home position.
+ * A lookup can therefore stop after inspecting that many positions,
+ * even if it has not reached an empty position yet.
+ */
+static struct isl_hash_table_entry *locate(struct isl_hash_table *table,
+	uint32_t key_hash, int (*eq)(const void *entry, const void *val),
+	const void *val, uint32_t *pos, uint32_t *n)
+{
+	uint32_t mask;
+	uint32_t h, d;
+	struct isl_hash_table_entry *found = NULL;
+
+	mask = (1 << table->bits) - 1;
+	h = isl_hash_bits(key_hash, table->bits);
+	for (d = 0; table->entries[h].data; ++d, h = (h + 1) & mask) {
+		if (d > table->max_probe)
+			break;
+		if (table->entries[h].hash == key_hash &&
+		    eq(table->entries[h].data, val)) {
+			found = &table->entries[h];
+			break;
+		}
+	}
+
+	*pos = h;
+	*n = d + 1;
+	return found;
+}
+
+/* Create an entry with hash value "key_hash" and a NULL "data" field
+ * at the first empty position of "table" starting at position "h".
+ * "d" is the distance of "h" from the home position of "key_hash".
+ * The caller is responsible for ensuring that "table" has room
+ * for an extra entry.
+ *
+ * The other entries in the table are not moved, so if the caller
+ * does not fill in the "data" field, then the entry is simply
+ * treated as an empty position by subsequent operations.
+ */
+static struct isl_hash_table_entry *insert(struct isl_hash_table *table,
+	uint32_t h, uint32_t d, uint32_t key_hash)
+{
+	uint32_t mask;
+
+	mask = (1 << table->bits) - 1;
+	for (; table->entries[h].data; ++d, h = (h + 1) & mask)
+		;
+	if (d > table->max_probe)
+		table->max_probe = d;
+
+	table->n++;
+	table->entries[h].hash = key_hash;
+	table->entries[h].data = NULL;
+
+	return &table->entries[h];
+}
+
+/* Record a lookup in "table" that inspected "n" entries
+ * in the statistics of "ctx".
+ */
+static void update_stats(struct isl_ctx *ctx, uint32_t n)
+{
+	if (!ctx || !ctx->stats)
+		return;
+	ctx->stats->hash_lookups++;
+	ctx->stats->hash_probes += n;
+	if (n > ctx->stats->hash_max_probe)
+		ctx->stats->hash_max_probe = n;
+}
+
+/* Resize "table" to 2^"bits" entries, where "bits" is assumed
+ * to be large enough to hold all current entries.
  * Return 0 on success and -1 on error.
  *
- * We reuse isl_hash_table_find to create entries in the extended table.
+ * We reuse insert to create entries in the resized table.
  * Since all entries in the original table are assumed to be different,
- * there is no need to compare them against each other.
+ * there is no need to look them up first.
  */
-static int grow_table(struct isl_ctx *ctx, struct isl_hash_table *table)
+static int resize_table(struct isl_ctx *ctx, struct isl_hash_table *table,
+	int bits)
 {
-	int n;
 	size_t old_size, size;
 	struct isl_hash_table_entry *entries;
 	uint32_t h;
 
 	entries = table->entries;
 	old_size = 1 << table->bits;
-	size = 2 * old_size;
+	size = (size_t) 1 << bits;
 	table->entries = isl_calloc_array(ctx, struct isl_hash_table_entry,
 					  size);
 	if (!table->entries) {
@@ -93,26 +180,19 @@ static int grow_table(struct isl_ctx *ctx, struct isl_hash_table *table)
 		return -1;
 	}
 
-	n = table->n;
 	table->n = 0;
-	table->bits++;
+	table->max_probe = 0;
+	table->bits = bits;
 
 	for (h = 0; h < old_size; ++h) {
 		struct isl_hash_table_entry *entry;
+		uint32_t pos;
 
 		if (!entries[h].data)
 			continue;
 
-		entry = isl_hash_table_find(ctx, table, entries[h].hash,
-					    &no, NULL, 1);
-		if (!entry) {
-			table->bits--;
-			free(table->entries);
-			table->entries = entries;
-			table->n = n;
-			return -1;
-		}
-
+		pos = isl_hash_bits(entries[h].hash, table->bits);
+		entry = insert(table, pos, 0, entries[h].hash);
 		*entry = entries[h];
 	}
 
@@ -121,6 +201,39 @@ static int grow_table(struct isl_ctx *ctx, struct isl_hash_table *table)
 	return 0;
 }
 
+/* Extend "table" to twice its size.
+ * Return 0 on success and -1 on error.
+ */
+static int grow_table(struct isl_ctx *ctx, struct isl_hash_table *table)
+{
+	return resize_table(ctx, table, table->bits + 1);
+}
+
+/* Make sure that "n" extra entries can be added to "table"
+ * without the table having to grow in the process.
+ * If the table needs to grow, then it is resized only once,
+ * directly to its final size.
+ * Return 0 on success and -1 on error.
+ */
+int isl_hash_table_reserve(struct isl_ctx *ctx, struct isl_hash_table *table,
+	int n)
+{
+	int bits;
+
+	if (!table)
+		return -1;
+	if (n <= 0)
+		return 0;
+
+	bits = table->bits;
+	while (4 * ((size_t) table->n + n) > 3 * ((size_t) 1 << bits))
+		bits++;
+	if (bits == table->bits)
+		return 0;
+
+	return resize_table(ctx, table, bits);
+}
+
 struct isl_hash_table *isl_hash_table_alloc(struct isl_ctx *ctx, int min_size)
 {
 	struct isl_hash_table *table = NULL;
@@ -149,35 +262,36 @@ void isl_hash_table_free(struct isl_ctx *ctx, struct isl_hash_table *table)
 	free(table);
 }
 
+/* Look for an entry with hash value "key_hash" in "table"
+ * that is equal to "val" according to "eq".
+ * If there is no such entry and "reserve" is set, then
+ * create an entry with hash value "key_hash" and a NULL "data" field.
+ * The caller is expected to fill in the "data" field.
+ * If it does not, then the entry is treated as an empty position,
+ * although it still counts towards the number of elements in the table
+ * until it is removed using isl_hash_table_remove.
+ */
 struct isl_hash_table_entry *isl_hash_table_find(struct isl_ctx *ctx,
 				struct isl_hash_table *table,
 				uint32_t key_hash,
 				int (*eq)(const void *entry, const void *val),
 				const void *val, int reserve)
 {
-	size_t size;
-	uint32_t h, key_bits;
+	struct isl_hash_table_entry *entry;
+	uint32_t h, n;
 
-	key_bits = isl_hash_bits(key_hash, table->bits);
-	size = 1 << table->bits;
-	for (h = key_bits; table->entries[h].data; h = (h+1) % size)
-		if (table->entries[h].hash == key_hash &&
-		    eq(table->entries[h].data, val))
-			return &table->entries[h];
+	entry = locate(table, key_hash, eq, val, &h, &n);
+	update_stats(ctx, n);
+	if (entry || !reserve)
+		return entry;
 
-	if (!reserve)
-		return NULL;
-
-	if (4 * table->n >= 3 * size) {
+	if (4 * table->n >= 3 * (1 << table->bits)) {
 		if (grow_table(ctx, table) < 0)
 			return NULL;
 		return isl_hash_table_find(ctx, table, key_hash, eq, val, 1);
 	}
 
-	table->n++;
-	table->entries[h].hash = key_hash;
-
-	return &table->entries[h];
+	return insert(table, h, n - 1, key_hash);
 }
 
 int isl_hash_table_foreach(struct isl_ctx *ctx,
@@ -199,32 +313,44 @@ int isl_hash_table_foreach(struct isl_ctx *ctx,
 	return 0;
 }
 
+/* Remove "entry" from "table".
+ * The entry may also be one that was reserved by isl_hash_table_find,
+ * but that has not been filled in.
+ *
+ * In order not to leave a gap in the sequence of positions
+ * inspected by lookups of subsequent entries in the same run
+ * of occupied positions, each of those entries that would still
+ * be found at the position of the gap is moved into the gap,
+ * creating a new gap at its original position.
+ * This only reduces the distances of entries from their home positions,
+ * so table->max_probe remains an upper bound on these distances.
+ */
 void isl_hash_table_remove(struct isl_ctx *ctx,
 				struct isl_hash_table *table,
 				struct isl_hash_table_entry *entry)
 {
-	int h, h2;
+	int h;
+	uint32_t mask, next, d;
 	size_t size;
 
 	if (!table || !entry)
 		return;
 
 	size = 1 << table->bits;
+	mask = size - 1;
 	h = entry - table->entries;
 	isl_assert(ctx, h >= 0 && h < size, return);
 
-	for (h2 = h+1; table->entries[h2 % size].data; h2++) {
-		uint32_t bits = isl_hash_bits(table->entries[h2 % size].hash,
-						table->bits);
-		uint32_t offset = (size + bits - (h+1)) % size;
-		if (offset <= h2 - (h+1))
+	for (next = (h + 1) & mask, d = 1; table->entries[next].data;
+	     next = (next + 1) & mask, ++d) {
+		if (probe_distance(table, next) < d)
 			continue;
-		*entry = table->entries[h2 % size];
-		h = h2;
-		entry = &table->entries[h % size];
+		table->entries[h] = table->entries[next];
+		h = next;
+		d = 0;
 	}
 
-	entry->hash = 0;
-	entry->data = NULL;
+	table->entries[h].hash = 0;
+	table->entries[h].data = NULL;
 	table->n--;
 }
@@ -27,17 +27,35 @@
 #define yS(TYPE1,TYPE2,NAME) xS(TYPE1,TYPE2,NAME)
 #define S(NAME) yS(KEY_BASE,VAL_BASE,NAME)
 
-struct HMAP {
-	int ref;
-	isl_ctx *ctx;
-	struct isl_hash_table table;
-};
+/* The maximal number of pairs that are stored directly
+ * in the associative array, without a hash table.
+ */
+#define HMAP_SMALL	4
 
 S(pair) {
 	KEY *key;
 	VAL *val;
 };
 
+/* An associative array.
+ *
+ * If "n_small" is non-negative, then the array contains "n_small" pairs,
+ * stored in the first "n_small" elements of "small" in insertion order,
+ * with the corresponding hash values of the keys in "small_hash".
+ * "table" is not used in this case.
+ * Otherwise, the pairs are allocated separately and stored in "table".
+ * An array switches to a hash table when it needs to store
+ * more than HMAP_SMALL pairs and never switches back.
+ */
+struct HMAP {
+	int ref;
+	isl_ctx *ctx;
+	int n_small;
+	uint32_t small_hash[HMAP_SMALL];
+	S(pair) small[HMAP_SMALL];
+	struct isl_hash_table table;
+};
+
 __isl_give HMAP *FN(HMAP,alloc)(isl_ctx *ctx, int min_size)
 {
 	HMAP *hmap;
@@ -50,12 +68,64 @@ __isl_give HMAP *FN(HMAP,alloc)(isl_ctx *ctx, int min_size)
 	isl_ctx_ref(ctx);
 	hmap->ref = 1;
 
+	if (min_size <= HMAP_SMALL)
+		return hmap;
+
+	hmap->n_small = -1;
 	if (isl_hash_table_init(ctx, &hmap->table, min_size) < 0)
 		return FN(HMAP,free)(hmap);
 
 	return hmap;
 }
 
+/* Return the number of pairs in "hmap".
+ */
+static int FN(HMAP,size)(__isl_keep HMAP *hmap)
+{
+	return hmap->n_small >= 0 ? hmap->n_small : hmap->table.n;
+}
+
+static int has_key(const void *entry, const void *c_key)
+{
+	const S(pair) *pair = entry;
+	KEY *key = (KEY *) c_key;
+
+	return KEY_EQUAL(pair->key, key);
+}
+
+/* Move the pairs in the "small" array of "hmap" to a hash table.
+ * The pairs that have been moved are removed from "small"
+ * such that they are not freed twice if anything goes wrong.
+ */
+static int FN(HMAP,to_table)(__isl_keep HMAP *hmap)
+{
+	int i;
+
+	if (isl_hash_table_init(hmap->ctx, &hmap->table, 2 * HMAP_SMALL) < 0)
+		return -1;
+
+	for (i = hmap->n_small - 1; i >= 0; --i) {
+		struct isl_hash_table_entry *entry;
+		S(pair) *pair;
+
+		pair = isl_alloc_type(hmap->ctx, S(pair));
+		if (!pair)
+			return -1;
+		entry = isl_hash_table_find(hmap->ctx, &hmap->table,
+			hmap->small_hash[i], &has_key, hmap->small[i].key, 1);
+		if (!entry) {
+			free(pair);
+			return -1;
+		}
+		*pair = hmap->small[i];
+		entry->data = pair;
+		hmap->n_small--;
+	}
+	hmap->n_small = -1;
+
+	return 0;
+}
+
 static int free_pair(void **entry, void *user)
 {
 	S(pair) *pair = *entry;
@@ -68,12 +138,21 @@ static int free_pair(void **entry, void *user)
 
 __isl_null HMAP *FN(HMAP,free)(__isl_take HMAP *hmap)
 {
+	int i;
+
 	if (!hmap)
 		return NULL;
 	if (--hmap->ref > 0)
 		return NULL;
-	isl_hash_table_foreach(hmap->ctx, &hmap->table, &free_pair, NULL);
-	isl_hash_table_clear(&hmap->table);
+	for (i = 0; i < hmap->n_small; ++i) {
+		FN(KEY,free)(hmap->small[i].key);
+		FN(VAL,free)(hmap->small[i].val);
+	}
+	if (hmap->table.entries) {
+		isl_hash_table_foreach(hmap->ctx, &hmap->table,
+					&free_pair, NULL);
+		isl_hash_table_clear(&hmap->table);
+	}
 	isl_ctx_deref(hmap->ctx);
 	free(hmap);
 	return NULL;
@@ -84,6 +163,29 @@ isl_ctx *FN(HMAP,get_ctx)(__isl_keep HMAP *hmap)
 	return hmap ? hmap->ctx : NULL;
 }
 
+/* Call "fn" on a pointer to each pair in "hmap",
+ * in the same way as isl_hash_table_foreach.
+ * "fn" is not allowed to modify the pointer.
+ */
+static int FN(HMAP,foreach_pair)(__isl_keep HMAP *hmap,
+	int (*fn)(void **entry, void *user), void *user)
+{
+	int i;
+
+	if (hmap->n_small < 0)
+		return isl_hash_table_foreach(hmap->ctx, &hmap->table,
+						fn, user);
+
+	for (i = 0; i < hmap->n_small; ++i) {
+		void *entry = &hmap->small[i];
+
+		if (fn(&entry, user) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
 /* Add a mapping from "key" to "val" to the associative array
  * pointed to by user.
  */
@@ -106,7 +208,7 @@ __isl_give HMAP *FN(HMAP,dup)(__isl_keep HMAP *hmap)
 	if (!hmap)
 		return NULL;
 
-	dup = FN(HMAP,alloc)(hmap->ctx, hmap->table.n);
+	dup = FN(HMAP,alloc)(hmap->ctx, FN(HMAP,size)(hmap));
 	if (FN(HMAP,foreach)(hmap, &add_key_val, &dup) < 0)
 		return FN(HMAP,free)(dup);
 
@@ -133,12 +235,29 @@ __isl_give HMAP *FN(HMAP,copy)(__isl_keep HMAP *hmap)
 	return hmap;
 }
 
-static int has_key(const void *entry, const void *c_key)
+/* Return the pair in "hmap" with key "key", with hash value "hash",
+ * or NULL if there is no such pair.
+ * If "entry" is not NULL and "hmap" uses a hash table, then
+ * set *entry to the hash table entry containing the pair.
+ */
+static S(pair) *FN(HMAP,find)(__isl_keep HMAP *hmap, uint32_t hash,
+	__isl_keep KEY *key, struct isl_hash_table_entry **entry)
 {
-	const S(pair) *pair = entry;
-	KEY *key = (KEY *) c_key;
+	int i;
+	struct isl_hash_table_entry *e;
+
+	for (i = 0; i < hmap->n_small; ++i)
+		if (hmap->small_hash[i] == hash &&
+		    has_key(&hmap->small[i], key))
+			return &hmap->small[i];
+	if (hmap->n_small >= 0)
+		return NULL;
 
-	return KEY_EQUAL(pair->key, key);
+	e = isl_hash_table_find(hmap->ctx, &hmap->table, hash,
+				&has_key, key, 0);
+	if (entry)
+		*entry = e;
+	return e ? e->data : NULL;
 }
 
 int FN(HMAP,has)(__isl_keep HMAP *hmap, __isl_keep KEY *key)
@@ -149,13 +268,11 @@ int FN(HMAP,has)(__isl_keep HMAP *hmap, __isl_keep KEY *key)
 		return -1;
 
 	hash = FN(KEY,get_hash)(key);
-	return !!isl_hash_table_find(hmap->ctx, &hmap->table, hash,
-					&has_key, key, 0);
+	return !!FN(HMAP,find)(hmap, hash, key, NULL);
 }
 
 __isl_give VAL *FN(HMAP,get)(__isl_keep HMAP *hmap, __isl_take KEY *key)
 {
-	struct isl_hash_table_entry *entry;
 	S(pair) *pair;
 	uint32_t hash;
 
@@ -163,15 +280,12 @@ __isl_give VAL *FN(HMAP,get)(__isl_keep HMAP *hmap, __isl_take KEY *key)
 		goto error;
 
 	hash = FN(KEY,get_hash)(key);
-	entry = isl_hash_table_find(hmap->ctx, &hmap->table, hash,
-					&has_key, key, 0);
+	pair = FN(HMAP,find)(hmap, hash, key, NULL);
 	FN(KEY,free)(key);
 
-	if (!entry)
+	if (!pair)
 		return NULL;
 
-	pair = entry->data;
-
 	return FN(VAL,copy)(pair->val);
 error:
 	FN(KEY,free)(key);
@@ -179,23 +293,27 @@ error:
 }
 
 /* Remove the mapping between "key" and its associated value (if any)
- * from "hmap".
+ * from "hmap" and return the value in *val, or NULL if there is none.
+ * If "val" is NULL, then the value is freed instead.
  *
- * If "key" is not mapped to anything, then we leave "hmap" untouched"
+ * If "key" is not mapped to anything, then we leave "hmap" untouched.
+ * Otherwise, the value is taken out of the pair rather than copied,
+ * unless "hmap" is shared.
  */
-__isl_give HMAP *FN(HMAP,drop)(__isl_take HMAP *hmap, __isl_take KEY *key)
+static __isl_give HMAP *FN(HMAP,remove)(__isl_take HMAP *hmap,
+	__isl_take KEY *key, __isl_give VAL **val)
 {
-	struct isl_hash_table_entry *entry;
+	struct isl_hash_table_entry *entry = NULL;
 	S(pair) *pair;
 	uint32_t hash;
 
+	if (val)
+		*val = NULL;
 	if (!hmap || !key)
 		goto error;
 
 	hash = FN(KEY,get_hash)(key);
-	entry = isl_hash_table_find(hmap->ctx, &hmap->table, hash,
-					&has_key, key, 0);
-	if (!entry) {
+	if (!FN(HMAP,find)(hmap, hash, key, NULL)) {
 		FN(KEY,free)(key);
 		return hmap;
 	}
@@ -203,19 +321,30 @@ __isl_give HMAP *FN(HMAP,drop)(__isl_take HMAP *hmap, __isl_take KEY *key)
 	hmap = FN(HMAP,cow)(hmap);
 	if (!hmap)
 		goto error;
-	entry = isl_hash_table_find(hmap->ctx, &hmap->table, hash,
-					&has_key, key, 0);
+	pair = FN(HMAP,find)(hmap, hash, key, &entry);
 	FN(KEY,free)(key);
 
-	if (!entry)
+	if (!pair)
 		isl_die(hmap->ctx, isl_error_internal,
-			"missing entry" , goto error);
+			"missing entry" , return FN(HMAP,free)(hmap));
 
-	pair = entry->data;
-	isl_hash_table_remove(hmap->ctx, &hmap->table, entry);
 	FN(KEY,free)(pair->key);
-	FN(VAL,free)(pair->val);
-	free(pair);
+	if (val)
+		*val = pair->val;
+	else
+		FN(VAL,free)(pair->val);
+	if (hmap->n_small >= 0) {
+		int i = pair - hmap->small;
+
+		for (; i + 1 < hmap->n_small; ++i) {
+			hmap->small[i] = hmap->small[i + 1];
+			hmap->small_hash[i] = hmap->small_hash[i + 1];
+		}
+		hmap->n_small--;
+	} else {
+		isl_hash_table_remove(hmap->ctx, &hmap->table, entry);
+		free(pair);
+	}
 
 	return hmap;
 error:
@@ -224,11 +353,37 @@ error:
 	return NULL;
 }
 
+/* Remove the mapping between "key" and its associated value (if any)
+ * from "hmap".
+ *
+ * If "key" is not mapped to anything, then we leave "hmap" untouched"
+ */
+__isl_give HMAP *FN(HMAP,drop)(__isl_take HMAP *hmap, __isl_take KEY *key)
+{
+	return FN(HMAP,remove)(hmap, key, NULL);
+}
+
+/* Remove the mapping between "key" and its associated value (if any)
+ * from "hmap" and return the value in *val (or NULL if "key"
+ * is not mapped to anything).
+ * In contrast to calling get and drop, the value is not copied
+ * if "hmap" is not shared.
+ */
+__isl_give HMAP *FN(HMAP,take)(__isl_take HMAP *hmap, __isl_take KEY *key,
+	__isl_give VAL **val)
+{
+	return FN(HMAP,remove)(hmap, key, val);
+}
+
 /* Add a mapping from "key" to "val" to "hmap".
  * If "key" was already mapped to something else, then that mapping
  * is replaced.
  * If key happened to be mapped to "val" already, then we leave
  * "hmap" untouched.
+ *
+ * As long as "hmap" has room for another pair in its "small" array,
+ * a new pair is simply appended.
+ * Otherwise, the pairs are first moved to a hash table.
  */
 __isl_give HMAP *FN(HMAP,set)(__isl_take HMAP *hmap,
 	__isl_take KEY *key, __isl_take VAL *val)
@@ -241,11 +396,9 @@ __isl_give HMAP *FN(HMAP,set)(__isl_take HMAP *hmap,
 		goto error;
 
 	hash = FN(KEY,get_hash)(key);
-	entry = isl_hash_table_find(hmap->ctx, &hmap->table, hash,
-					&has_key, key, 0);
-	if (entry) {
+	pair = FN(HMAP,find)(hmap, hash, key, NULL);
+	if (pair) {
 		int equal;
-		pair = entry->data;
 		equal = VAL_EQUAL(pair->val, val);
 		if (equal < 0)
 			goto error;
@@ -260,23 +413,35 @@ __isl_give HMAP *FN(HMAP,set)(__isl_take HMAP *hmap,
 	if (!hmap)
 		goto error;
 
-	entry = isl_hash_table_find(hmap->ctx, &hmap->table, hash,
-					&has_key, key, 1);
-
-	if (!entry)
-		goto error;
-
-	if (entry->data) {
-		pair = entry->data;
+	pair = FN(HMAP,find)(hmap, hash, key, NULL);
+	if (pair) {
 		FN(VAL,free)(pair->val);
 		pair->val = val;
 		FN(KEY,free)(key);
 		return hmap;
 	}
 
+	if (hmap->n_small >= 0 && hmap->n_small < HMAP_SMALL) {
+		hmap->small_hash[hmap->n_small] = hash;
+		hmap->small[hmap->n_small].key = key;
+		hmap->small[hmap->n_small].val = val;
+		hmap->n_small++;
+		return hmap;
+	}
+	if (hmap->n_small >= 0 && FN(HMAP,to_table)(hmap) < 0)
+		goto error;
+
+	entry = isl_hash_table_find(hmap->ctx, &hmap->table, hash,
+					&has_key, key, 1);
+
+	if (!entry)
+		goto error;
+
 	pair = isl_alloc_type(hmap->ctx, S(pair));
-	if (!pair)
+	if (!pair) {
+		isl_hash_table_remove(hmap->ctx, &hmap->table, entry);
 		goto error;
+	}
 
 	entry->data = pair;
 	pair->key = key;
@@ -288,6 +453,69 @@ error:
 	return FN(HMAP,free)(hmap);
 }
 
+/* Internal data structure for set_all.
+ *
+ * hmap is the associative array to which the pairs are being added.
+ * steal is set if the keys and values can be taken out of the pairs.
+ */
+S(set_all_data) {
+	HMAP *hmap;
+	int steal;
+};
+
+/* Add the pair in *entry to data->hmap, taking out the key and value
+ * if data->steal is set and copying them otherwise.
+ */
+static int set_pair(void **entry, void *user)
+{
+	S(pair) *pair = *entry;
+	S(set_all_data) *data = (S(set_all_data) *) user;
+	KEY *key;
+	VAL *val;
+
+	if (data->steal) {
+		key = pair->key;
+		val = pair->val;
+		pair->key = NULL;
+		pair->val = NULL;
+	} else {
+		key = FN(KEY,copy)(pair->key);
+		val = FN(VAL,copy)(pair->val);
+	}
+
+	data->hmap = FN(HMAP,set)(data->hmap, key, val);
+	if (!data->hmap)
+		return -1;
+	return 0;
+}
+
+/* Add all mappings of "src" to "dst", replacing any mappings
+ * of the same keys in "dst".
+ * If "src" is not shared, then its keys and values are moved to "dst"
+ * rather than copied.
+ */
+__isl_give HMAP *FN(HMAP,set_all)(__isl_take HMAP *dst, __isl_take HMAP *src)
+{
+	S(set_all_data) data;
+
+	if (!dst || !src)
+		goto error;
+
+	data.hmap = dst;
+	data.steal = src->ref == 1;
+	if (FN(HMAP,foreach_pair)(src, &set_pair, &data) < 0)
+		dst = NULL;
+	else
+		dst = data.hmap;
+
+	FN(HMAP,free)(src);
+	return dst;
+error:
+	FN(HMAP,free)(dst);
+	FN(HMAP,free)(src);
+	return NULL;
+}
+
 /* Internal data structure for isl_map_to_basic_set_foreach.
  *
  * fn is the function that should be called on each entry.
@@ -320,8 +548,7 @@ int FN(HMAP,foreach)(__isl_keep HMAP *hmap,
 	if (!hmap)
 		return -1;
 
-	return isl_hash_table_foreach(hmap->ctx, &hmap->table,
-				      &call_on_copy, &data);
+	return FN(HMAP,foreach_pair)(hmap, &call_on_copy, &data);
 }
 
 /* Internal data structure for print_pair.
@@ -7,6 +7,7 @@
  * Computerwetenschappen, Celestijnenlaan 200A, B-3001 Leuven, Belgium
  */
 
+#include <stddef.h>
 #include <string.h>
 #include <isl_ctx_private.h>
 #include <isl_id_private.h>
@@ -42,33 +43,142 @@ const char *isl_id_get_name(__isl_keep isl_id *id)
 	return id ? id->name : NULL;
 }
 
-static __isl_give isl_id *id_alloc(isl_ctx *ctx, const char *name, void *user)
+/* A name interned in the name table of an isl_ctx.
+ * All isl_ids in the same isl_ctx with the same name share
+ * a single isl_name, irrespective of their user pointers,
+ * such that two names of such isl_ids are equal if and only if
+ * they are the same pointer.
+ * "hash" is the hash value of the string "s", computed
+ * when the name is interned.
+ * "ref" is the number of isl_ids with this name.
+ */
+struct isl_name {
+	int ref;
+	uint32_t hash;
+	char s[1];
+};
+
+/* Return the isl_name containing the interned string "s".
+ */
+static struct isl_name *name_of(const char *s)
 {
-	const char *copy = name ? strdup(name) : NULL;
-	isl_id *id;
+	return (struct isl_name *) (s - offsetof(struct isl_name, s));
+}
+
+static int isl_name_has_str(const void *entry, const void *val)
+{
+	const struct isl_name *name = entry;
+
+	return !strcmp(name->s, val);
+}
 
-	if (name && !copy)
+/* Return the isl_name for "str" in the name table of "ctx",
+ * creating it (with a zero reference count) if needed.
+ * This is the only place where "str" is hashed and compared
+ * character by character.
+ */
+static struct isl_name *intern_name(isl_ctx *ctx, const char *str)
+{
+	struct isl_hash_table_entry *entry;
+	struct isl_name *name;
+	uint32_t hash;
+	size_t len;
+
+	hash = isl_hash_string(isl_hash_init(), str);
+	entry = isl_hash_table_find(ctx, &ctx->name_table, hash,
+					&isl_name_has_str, str, 1);
+	if (!entry)
 		return NULL;
+	if (entry->data)
+		return entry->data;
+
+	len = strlen(str) + 1;
+	name = isl_alloc(ctx, struct isl_name, sizeof(struct isl_name) + len);
+	if (!name) {
+		isl_hash_table_remove(ctx, &ctx->name_table, entry);
+		return NULL;
+	}
+	name->ref = 0;
+	name->hash = hash;
+	memcpy(name->s, str, len);
+	entry->data = name;
+
+	return name;
+}
+
+static int isl_name_eq(const void *entry, const void *val)
+{
+	return entry == val;
+}
+
+/* Drop a reference to the interned name "name" in "ctx",
+ * removing it from the name table if it is no longer referenced.
+ */
+static void release_name(isl_ctx *ctx, struct isl_name *name)
+{
+	struct isl_hash_table_entry *entry;
+
+	if (!name || --name->ref > 0)
+		return;
+
+	entry = isl_hash_table_find(ctx, &ctx->name_table, name->hash,
+					&isl_name_eq, name, 0);
+	if (entry)
+		isl_hash_table_remove(ctx, &ctx->name_table, entry);
+	free(name);
+}
+
+/* Return the hash value of an isl_id with the given name and user pointer.
+ * If "name" is not NULL, then "hash" is the hash value of "name".
+ */
+static uint32_t id_hash(const char *name, uint32_t hash, void *user)
+{
+	if (name)
+		return hash;
+
+	hash = isl_hash_init();
+	return isl_hash_builtin(hash, user);
+}
+
+/* Return the key under which an isl_id with the given (interned) name
+ * and user pointer is stored in the id table of its isl_ctx.
+ * Since interned names are unique, the key is computed
+ * from the name pointer rather than from the characters in the name.
+ */
+static uint32_t id_key(const char *name, void *user)
+{
+	uint32_t hash;
+
+	hash = isl_hash_init();
+	hash = isl_hash_builtin(hash, name);
+	hash = isl_hash_builtin(hash, user);
+
+	return hash;
+}
+
+/* Allocate a new isl_id with the given interned name, user pointer and
+ * hash value.
+ */
+static __isl_give isl_id *id_alloc(isl_ctx *ctx, struct isl_name *name,
+	void *user, uint32_t hash)
+{
+	isl_id *id;
+
 	id = isl_calloc_type(ctx, struct isl_id);
 	if (!id)
-		goto error;
+		return NULL;
 
 	id->ctx = ctx;
 	isl_ctx_ref(id->ctx);
 	id->ref = 1;
-	id->name = copy;
+	if (name) {
+		name->ref++;
+		id->name = name->s;
+	}
 	id->user = user;
-
-	id->hash = isl_hash_init();
-	if (name)
-		id->hash = isl_hash_string(id->hash, name);
-	else
-		id->hash = isl_hash_builtin(id->hash, user);
+	id->hash = hash;
 
 	return id;
-error:
-	free((char *)copy);
-	return NULL;
 }
 
 uint32_t isl_id_get_hash(__isl_keep isl_id *id)
@@ -81,43 +191,69 @@ struct isl_name_and_user {
 	void *user;
 };
 
+/* Is "entry" an isl_id with the given name pointer and user pointer?
+ */
 static int isl_id_has_name_and_user(const void *entry, const void *val)
 {
 	isl_id *id = (isl_id *)entry;
 	struct isl_name_and_user *nu = (struct isl_name_and_user *) val;
 
-	if (id->user != nu->user)
-		return 0;
-	if (!id->name && !nu->name)
-		return 1;
-
-	return !strcmp(id->name, nu->name);
+	return id->name == nu->name && id->user == nu->user;
 }
 
+/* Return an isl_id with the given name and user pointer.
+ *
+ * If "name" is the (interned) name of an existing isl_id,
+ * as is the case for names obtained from isl_id_get_name,
+ * from isl_space_get_dim_name or from the parser,
+ * then a matching isl_id is found through a single lookup
+ * on the name pointer in the id table.
+ * Otherwise, the name is first interned, which involves
+ * hashing and comparing the characters in the name,
+ * and the lookup is performed on the interned name.
+ */
 __isl_give isl_id *isl_id_alloc(isl_ctx *ctx, const char *name, void *user)
 {
 	struct isl_hash_table_entry *entry;
-	uint32_t id_hash;
+	struct isl_name *interned = NULL;
 	struct isl_name_and_user nu = { name, user };
+	uint32_t hash = 0;
 
 	if (!ctx)
 		return NULL;
 
-	id_hash = isl_hash_init();
-	if (name)
-		id_hash = isl_hash_string(id_hash, name);
-	else
-		id_hash = isl_hash_builtin(id_hash, user);
-	entry = isl_hash_table_find(ctx, &ctx->id_table, id_hash,
-					isl_id_has_name_and_user, &nu, 1);
+	if (name) {
+		entry = isl_hash_table_find(ctx, &ctx->id_table,
+				id_key(name, user), isl_id_has_name_and_user,
+				&nu, 0);
+		if (entry)
+			return isl_id_copy(entry->data);
+		interned = intern_name(ctx, name);
+		if (!interned)
+			return NULL;
+		nu.name = interned->s;
+		hash = interned->hash;
+	}
+
+	entry = isl_hash_table_find(ctx, &ctx->id_table,
+			id_key(nu.name, user), isl_id_has_name_and_user, &nu, 1);
 	if (!entry)
-		return NULL;
+		goto error;
 	if (entry->data)
 		return isl_id_copy(entry->data);
-	entry->data = id_alloc(ctx, name, user);
-	if (!entry->data)
-		ctx->id_table.n--;
+	entry->data = id_alloc(ctx, interned, user,
+				id_hash(nu.name, hash, user));
+	if (!entry->data) {
+		isl_hash_table_remove(ctx, &ctx->id_table, entry);
+		goto error;
+	}
 	return entry->data;
+error:
+	if (interned && interned->ref == 0) {
+		interned->ref = 1;
+		release_name(ctx, interned);
+	}
+	return NULL;
 }
 
 /* If the id has a negative refcount, then it is a static isl_id
@@ -162,11 +298,6 @@ int isl_id_cmp(__isl_keep isl_id *id1, __isl_keep isl_id *id2)
 		return 1;
 }
 
-static int isl_id_eq(const void *entry, const void *name)
-{
-	return entry == name;
-}
-
 uint32_t isl_hash_id(uint32_t hash, __isl_keep isl_id *id)
 {
 	if (id)
@@ -194,6 +325,7 @@ __isl_give isl_id *isl_id_set_free_user(__isl_take isl_id *id,
 __isl_null isl_id *isl_id_free(__isl_take isl_id *id)
 {
 	struct isl_hash_table_entry *entry;
+	struct isl_name_and_user nu;
 
 	if (!id)
 		return NULL;
@@ -204,18 +336,22 @@ __isl_null isl_id *isl_id_free(__isl_take isl_id *id)
 	if (--id->ref > 0)
 		return NULL;
 
-	entry = isl_hash_table_find(id->ctx, &id->ctx->id_table, id->hash,
-					isl_id_eq, id, 0);
+	nu.name = id->name;
+	nu.user = id->user;
+	entry = isl_hash_table_find(id->ctx, &id->ctx->id_table,
+			id_key(id->name, id->user), isl_id_has_name_and_user,
+			&nu, 0);
 	if (!entry)
 		isl_die(id->ctx, isl_error_unknown,
 			"unable to find id", (void)0);
 	else
 		isl_hash_table_remove(id->ctx, &id->ctx->id_table, entry);
+	if (id->name)
+		release_name(id->ctx, name_of(id->name));
 
 	if (id->free_user)
 		id->free_user(id->user);
 
-	free((char *)id->name);
 	isl_ctx_deref(id->ctx);
 	free(id);
 
@@ -16,6 +16,10 @@
  *
  * If "free_user" is set, then it will be called on "user" when
  * the last instance of the isl_id is freed.
+ *
+ * Except for the static isl_id_none, "name" (if not NULL) points
+ * to a name interned in the name table of "ctx", which is shared
+ * by all isl_ids in "ctx" with the same name.
  */
 struct isl_id {
 	int ref;
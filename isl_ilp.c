@@ -7,8 +7,10 @@
  * Computerwetenschappen, Celestijnenlaan 200A, B-3001 Leuven, Belgium
  */
 
+#include <isl_config.h>
 #include <isl_ctx_private.h>
 #include <isl_map_private.h>
+#include <isl_options_private.h>
 #include <isl/ilp.h>
 #include "isl_sample.h"
 #include <isl_seq.h>
@@ -20,6 +22,7 @@
 #include <isl_vec_private.h>
 #include <isl_lp_private.h>
 #include <isl_ilp_private.h>
+#include <isl_thread.h>
 #include <isl/deprecated/ilp_int.h>
 
 /* Given a basic set "bset", construct a basic set U such that for
@@ -340,8 +343,46 @@ error:
 	return isl_lp_error;
 }
 
+/* Restrict "bset" to those points where the affine expression "f"
+ * attains a value that is strictly smaller than "bound",
+ * or strictly greater if "max" is set.
+ * Since "f" has integer coefficients and only integer points
+ * are considered, this means that f <= bound - 1 or f >= bound + 1.
+ */
+static __isl_give isl_basic_set *add_better_than(
+	__isl_take isl_basic_set *bset, int max, isl_int *f, isl_int bound)
+{
+	int k;
+	unsigned total;
+
+	total = isl_basic_set_total_dim(bset);
+	bset = isl_basic_set_extend_constraints(bset, 0, 1);
+	k = isl_basic_set_alloc_inequality(bset);
+	if (k < 0)
+		return isl_basic_set_free(bset);
+	if (max) {
+		isl_seq_cpy(bset->ineq[k], f, 1 + total);
+		isl_int_sub(bset->ineq[k][0], bset->ineq[k][0], bound);
+		isl_int_sub_ui(bset->ineq[k][0], bset->ineq[k][0], 1);
+	} else {
+		isl_seq_neg(bset->ineq[k], f, 1 + total);
+		isl_int_add(bset->ineq[k][0], bset->ineq[k][0], bound);
+		isl_int_sub_ui(bset->ineq[k][0], bset->ineq[k][0], 1);
+	}
+
+	return bset;
+}
+
+/* Compute the minimum (maximum if max is set) of the integer affine
+ * expression obj over the points in bset, which does not have
+ * any integer divisions other than those of "obj", and
+ * put the result in *opt.
+ * If "bound" is not NULL, then only values that are strictly smaller
+ * (greater if max is set) than *bound are taken into account,
+ * meaning that isl_lp_empty is returned if there are no such values.
+ */
 static enum isl_lp_result basic_set_opt(__isl_keep isl_basic_set *bset, int max,
-	__isl_keep isl_aff *obj, isl_int *opt)
+	__isl_keep isl_aff *obj, isl_int *opt, isl_int *bound)
 {
 	enum isl_lp_result res;
 
@@ -349,6 +390,8 @@ static enum isl_lp_result basic_set_opt(__isl_keep isl_basic_set *bset, int max,
 		return isl_lp_error;
 	bset = isl_basic_set_copy(bset);
 	bset = isl_basic_set_underlying_set(bset);
+	if (bound)
+		bset = add_better_than(bset, max, obj->v->el + 1, *bound);
 	res = isl_basic_set_solve_ilp(bset, max, obj->v->el + 1, opt, NULL);
 	isl_basic_set_free(bset);
 	return res;
@@ -371,8 +414,13 @@ static __isl_give isl_mat *extract_divs(__isl_keep isl_basic_set *bset)
 	return div;
 }
 
-enum isl_lp_result isl_basic_set_opt(__isl_keep isl_basic_set *bset, int max,
-	__isl_keep isl_aff *obj, isl_int *opt)
+/* Compute the minimum (maximum if max is set) of the integer affine
+ * expression obj over the points in bset and put the result in *opt.
+ * If "bound" is not NULL, then only values that are strictly better
+ * than *bound are taken into account (see basic_set_opt).
+ */
+static enum isl_lp_result basic_set_opt_bounded(__isl_keep isl_basic_set *bset,
+	int max, __isl_keep isl_aff *obj, isl_int *opt, isl_int *bound)
 {
 	int *exp1 = NULL;
 	int *exp2 = NULL;
@@ -397,7 +445,7 @@ enum isl_lp_result isl_basic_set_opt(__isl_keep isl_basic_set *bset, int max,
 	bset_n_div = isl_basic_set_dim(bset, isl_dim_div);
 	obj_n_div = isl_aff_dim(obj, isl_dim_div);
 	if (bset_n_div == 0 && obj_n_div == 0)
-		return basic_set_opt(bset, max, obj, opt);
+		return basic_set_opt(bset, max, obj, opt, bound);
 
 	bset = isl_basic_set_copy(bset);
 	obj = isl_aff_copy(obj);
@@ -413,7 +461,7 @@ enum isl_lp_result isl_basic_set_opt(__isl_keep isl_basic_set *bset, int max,
 	bset = isl_basic_set_expand_divs(bset, isl_mat_copy(div), exp1);
 	obj = isl_aff_expand_divs(obj, isl_mat_copy(div), exp2);
 
-	res = basic_set_opt(bset, max, obj, opt);
+	res = basic_set_opt(bset, max, obj, opt, bound);
 
 	isl_mat_free(bset_div);
 	isl_mat_free(div);
@@ -433,15 +481,161 @@ error:
 	return isl_lp_error;
 }
 
+enum isl_lp_result isl_basic_set_opt(__isl_keep isl_basic_set *bset, int max,
+	__isl_keep isl_aff *obj, isl_int *opt)
+{
+	return basic_set_opt_bounded(bset, max, obj, opt, NULL);
+}
+
+/* Is "v" strictly better than "best", i.e., strictly greater
+ * if "max" is set and strictly smaller otherwise?
+ */
+static int is_better(int max, isl_int v, isl_int best)
+{
+	return max ? isl_int_gt(v, best) : isl_int_lt(v, best);
+}
+
+#ifdef HAVE_PTHREAD
+
+/* Data shared by the workers of isl_set_opt_threads.
+ * "set" and "obj" live in the isl_ctx of the caller.
+ * "res" collects the results for the "n" basic sets of "set".
+ * If "has_best" is set, then "best" is the best value
+ * found by any worker so far.
+ * The workers only access "res", "has_best", "best" and
+ * the objects that live in the isl_ctx of the caller
+ * while holding the lock of isl_thread_run.
+ */
+struct isl_ilp_threads {
+	isl_set *set;
+	int max;
+	isl_aff *obj;
+	int prune;
+	int n;
+	enum isl_lp_result *res;
+	int has_best;
+	isl_int best;
+};
+
+/* Import basic set "i" and the objective function into the isl_ctx
+ * of "worker" and compute the optimum over this basic set,
+ * only considering values that are better than the best value
+ * found by any worker so far if data->prune is set.
+ */
+static int ilp_work(struct isl_thread_worker *worker, int i, void *user)
+{
+	struct isl_ilp_threads *data = user;
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	isl_basic_set *bset;
+	isl_aff *obj;
+	enum isl_lp_result res;
+	isl_int opt, bound;
+	int bounded;
+
+	isl_int_init(opt);
+	isl_int_init(bound);
+
+	isl_thread_worker_lock(worker);
+	obj = isl_aff_import(ctx, data->obj);
+	bset = isl_basic_set_import(ctx, data->set->p[i]);
+	bounded = data->prune && data->has_best;
+	if (bounded)
+		isl_int_set(bound, data->best);
+	isl_thread_worker_unlock(worker);
+
+	if (!obj)
+		res = isl_lp_error;
+	else
+		res = basic_set_opt_bounded(bset, data->max, obj, &opt,
+					    bounded ? &bound : NULL);
+	isl_basic_set_free(bset);
+	isl_aff_free(obj);
+
+	isl_thread_worker_lock(worker);
+	data->res[i] = res;
+	if (res == isl_lp_ok &&
+	    (!data->has_best || is_better(data->max, opt, data->best))) {
+		isl_int_set(data->best, opt);
+		data->has_best = 1;
+	}
+	isl_thread_worker_unlock(worker);
+
+	isl_int_clear(opt);
+	isl_int_clear(bound);
+
+	return res == isl_lp_error ? -1 : 0;
+}
+
+/* Compute the minimum (maximum if max is set) of the integer affine
+ * expression obj over the points in set, using several threads,
+ * and put the result in *opt.
+ *
+ * Each thread has its own isl_ctx, into which it imports "obj" and
+ * the basic sets that it handles (see isl_thread_run).
+ * The best value found so far is shared between the threads such that,
+ * if "prune" is set, each of them can skip any values that are not better.
+ * The result is the same as that of the sequential computation
+ * in isl_set_opt_aligned, since the first unboundedness
+ * (in the order of the basic sets) is reported and otherwise
+ * the best value over all basic sets.
+ */
+static enum isl_lp_result isl_set_opt_threads(__isl_keep isl_set *set,
+	int max, __isl_keep isl_aff *obj, isl_int *opt, int prune)
+{
+	int i;
+	isl_ctx *ctx;
+	enum isl_lp_result res = isl_lp_error;
+	struct isl_ilp_threads data = { set, max, obj, prune, set->n };
+
+	ctx = isl_set_get_ctx(set);
+	isl_int_init(data.best);
+	data.res = isl_alloc_array(ctx, enum isl_lp_result, set->n);
+	if (!data.res)
+		goto error;
+	for (i = 0; i < set->n; ++i)
+		data.res[i] = isl_lp_error;
+	if (isl_thread_run(ctx, set->n, &ilp_work, &data) < 0)
+		goto error;
+
+	for (i = 0; i < set->n; ++i)
+		if (data.res[i] == isl_lp_unbounded)
+			break;
+	if (i < set->n)
+		res = isl_lp_unbounded;
+	else if (!data.has_best)
+		res = isl_lp_empty;
+	else {
+		isl_int_set(*opt, data.best);
+		res = isl_lp_ok;
+	}
+
+error:
+	free(data.res);
+	isl_int_clear(data.best);
+	return res;
+}
+
+#endif
+
 /* Compute the minimum (maximum if max is set) of the integer affine
  * expression obj over the points in set and put the result in *opt.
  *
  * The parameters are assumed to have been aligned.
+ *
+ * If the ilp_prune option is set, then the best value found so far
+ * is used as a bound on the remaining basic sets, such that
+ * their optimization problems only need to look for better values.
+ * This does not affect the result, since any basic set over which
+ * the objective function is unbounded remains so
+ * after adding the bound.
+ * If the threads option is greater than one and isl has been built
+ * with thread support, then the basic sets are handled in parallel.
  */
 static enum isl_lp_result isl_set_opt_aligned(__isl_keep isl_set *set, int max,
 	__isl_keep isl_aff *obj, isl_int *opt)
 {
 	int i;
+	int prune;
 	enum isl_lp_result res;
 	int empty = 1;
 	isl_int opt_i;
@@ -451,25 +645,28 @@ static enum isl_lp_result isl_set_opt_aligned(__isl_keep isl_set *set, int max,
 	if (set->n == 0)
 		return isl_lp_empty;
 
-	res = isl_basic_set_opt(set->p[0], max, obj, opt);
-	if (res == isl_lp_error || res == isl_lp_unbounded)
-		return res;
-	if (set->n == 1)
-		return res;
-	if (res == isl_lp_ok)
-		empty = 0;
+	prune = set->ctx->opt->ilp_prune;
+#ifdef HAVE_PTHREAD
+	if (set->n > 1 && set->ctx->opt->threads > 1)
+		return isl_set_opt_threads(set, max, obj, opt, prune);
+#endif
 
 	isl_int_init(opt_i);
-	for (i = 1; i < set->n; ++i) {
-		res = isl_basic_set_opt(set->p[i], max, obj, &opt_i);
+	for (i = 0; i < set->n; ++i) {
+		isl_int *bound = NULL;
+
+		if (prune && !empty)
+			bound = opt;
+		res = basic_set_opt_bounded(set->p[i], max, obj, &opt_i, bound);
 		if (res == isl_lp_error || res == isl_lp_unbounded) {
 			isl_int_clear(opt_i);
 			return res;
 		}
-		if (res == isl_lp_ok)
-			empty = 0;
-		if (max ? isl_int_gt(opt_i, *opt) : isl_int_lt(opt_i, *opt))
+		if (res != isl_lp_ok)
+			continue;
+		if (empty || is_better(max, opt_i, *opt))
 			isl_int_set(*opt, opt_i);
+		empty = 0;
 	}
 	isl_int_clear(opt_i);
 
@@ -15,9 +15,11 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <string.h>
+#include <isl_config.h>
 #include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl/set.h>
+#include <isl/hash.h>
 #include <isl_seq.h>
 #include <isl_stream_private.h>
 #include <isl/obj.h>
@@ -28,17 +30,35 @@
 #include <isl_vec_private.h>
 #include <isl/list.h>
 #include <isl_val_private.h>
-
+#include <isl_options_private.h>
+#include <isl_thread.h>
+
+/* A variable in the parser's scope.
+ * "name" is the name of "id", which is shared with the tokens
+ * and the isl objects that refer to the same name.
+ * "next" is the variable that was declared before this one and
+ * "shadow" is the most recent earlier variable with the same name,
+ * i.e., the variable that is visible again when this one is dropped.
+ */
 struct variable {
-	char    	    	*name;
+	isl_id			*id;
+	const char		*name;
 	int	     		 pos;
+	uint32_t		 hash;
 	struct variable		*next;
+	struct variable		*shadow;
 };
 
+/* The variables in the parser's scope, with the most recently
+ * declared variable first.
+ * "table" maps each name to the most recently declared variable
+ * with that name.
+ */
 struct vars {
 	struct isl_ctx	*ctx;
 	int		 n;
 	struct variable	*v;
+	struct isl_hash_table *table;
 };
 
 static struct vars *vars_new(struct isl_ctx *ctx)
@@ -50,6 +70,11 @@ static struct vars *vars_new(struct isl_ctx *ctx)
 	v->ctx = ctx;
 	v->n = 0;
 	v->v = NULL;
+	v->table = isl_hash_table_alloc(ctx, 16);
+	if (!v->table) {
+		free(v);
+		return NULL;
+	}
 	return v;
 }
 
@@ -57,7 +82,7 @@ static void variable_free(struct variable *var)
 {
 	while (var) {
 		struct variable *next = var->next;
-		free(var->name);
+		isl_id_free(var->id);
 		free(var);
 		var = next;
 	}
@@ -68,9 +93,35 @@ static void vars_free(struct vars *v)
 	if (!v)
 		return;
 	variable_free(v->v);
+	isl_hash_table_free(v->ctx, v->table);
 	free(v);
 }
 
+static int same_name(const void *entry, const void *val)
+{
+	const struct variable *var = entry;
+	const char *name = val;
+
+	return !strcmp(var->name, name);
+}
+
+/* Remove "var" from the table of "v", making the variable it shadows
+ * (if any) visible again.
+ */
+static void vars_unregister(struct vars *v, struct variable *var)
+{
+	struct isl_hash_table_entry *entry;
+
+	entry = isl_hash_table_find(v->ctx, v->table, var->hash, &same_name,
+					var->name, 0);
+	if (!entry)
+		return;
+	if (var->shadow)
+		entry->data = var->shadow;
+	else
+		isl_hash_table_remove(v->ctx, v->table, entry);
+}
+
 static void vars_drop(struct vars *v, int n)
 {
 	struct variable *var;
@@ -83,56 +134,89 @@ static void vars_drop(struct vars *v, int n)
 	var = v->v;
 	while (--n >= 0) {
 		struct variable *next = var->next;
-		free(var->name);
+		vars_unregister(v, var);
+		isl_id_free(var->id);
 		free(var);
 		var = next;
 	}
 	v->v = var;
 }
 
-static struct variable *variable_new(struct vars *v, const char *name, int len,
-				int pos)
+/* Add a variable with the given name at position
+ * "pos" to the front of the list of variables in "v" and
+ * make it the visible variable with that name.
+ */
+static struct variable *variable_new(struct vars *v, const char *name, int pos)
 {
 	struct variable *var;
+	struct isl_hash_table_entry *entry;
+
 	var = isl_calloc_type(v->ctx, struct variable);
 	if (!var)
 		goto error;
-	var->name = strdup(name);
-	var->name[len] = '\0';
+	var->id = isl_id_alloc(v->ctx, name, NULL);
+	if (!var->id)
+		goto error;
+	var->name = isl_id_get_name(var->id);
 	var->pos = pos;
 	var->next = v->v;
+	var->hash = isl_hash_string(isl_hash_init(), var->name);
+	entry = isl_hash_table_find(v->ctx, v->table, var->hash, &same_name,
+					var->name, 1);
+	if (!entry)
+		goto error;
+	var->shadow = entry->data;
+	entry->data = var;
 	return var;
 error:
+	if (var)
+		isl_id_free(var->id);
+	free(var);
+	for (var = v->v; var; var = var->next)
+		vars_unregister(v, var);
 	variable_free(v->v);
 	return NULL;
 }
 
+/* Return the position of the most recently declared variable
+ * with name "s" (of length "len" or of the length of "s" if "len" is -1),
+ * introducing a new variable if there is no such variable.
+ */
 static int vars_pos(struct vars *v, const char *s, int len)
 {
 	int pos;
 	struct variable *q;
+	struct isl_hash_table_entry *entry;
+	char *name = NULL;
+	uint32_t hash;
 
-	if (len == -1)
-		len = strlen(s);
-	for (q = v->v; q; q = q->next) {
-		if (strncmp(q->name, s, len) == 0 && q->name[len] == '\0')
-			break;
+	if (len != -1 && s[len] != '\0') {
+		name = strdup(s);
+		if (!name)
+			return -1;
+		name[len] = '\0';
+		s = name;
 	}
+	hash = isl_hash_string(isl_hash_init(), s);
+	entry = isl_hash_table_find(v->ctx, v->table, hash, &same_name, s, 0);
+	q = entry ? entry->data : NULL;
 	if (q)
 		pos = q->pos;
 	else {
 		pos = v->n;
-		v->v = variable_new(v, s, len, v->n);
+		v->v = variable_new(v, s, v->n);
 		if (!v->v)
-			return -1;
-		v->n++;
+			pos = -1;
+		else
+			v->n++;
 	}
+	free(name);
 	return pos;
 }
 
 static int vars_add_anon(struct vars *v)
 {
-	v->v = variable_new(v, "", 0, v->n);
+	v->v = variable_new(v, "", v->n);
 
 	if (!v->v)
 		return -1;
@@ -1023,21 +1107,29 @@ static __isl_give isl_multi_pw_aff *tuple_add_dim(
  * During printing, we add primes if the same name appears more than once
  * to distinguish the occurrences.  Here, we remove those primes from "name"
  * before setting the name of the dimension.
+ * Since "name" may be shared with other objects, the primes
+ * are removed from a copy.
  */
 static __isl_give isl_multi_pw_aff *tuple_set_dim_name(
-	__isl_take isl_multi_pw_aff *tuple, int pos, char *name)
+	__isl_take isl_multi_pw_aff *tuple, int pos, const char *name)
 {
-	char *prime;
+	const char *prime;
+	char *copy;
 
 	if (!name)
 		return tuple;
 
 	prime = strchr(name, '\'');
-	if (prime)
-		*prime = '\0';
-	tuple = isl_multi_pw_aff_set_dim_name(tuple, isl_dim_set, pos, name);
-	if (prime)
-		*prime = '\'';
+	if (!prime)
+		return isl_multi_pw_aff_set_dim_name(tuple, isl_dim_set,
+							pos, name);
+
+	copy = strdup(name);
+	if (!copy)
+		return isl_multi_pw_aff_free(tuple);
+	copy[prime - name] = '\0';
+	tuple = isl_multi_pw_aff_set_dim_name(tuple, isl_dim_set, pos, copy);
+	free(copy);
 
 	return tuple;
 }
@@ -2330,12 +2422,93 @@ error:
 	return obj1;
 }
 
+/* The objects read so far from a sequence of disjuncts,
+ * which still need to be combined into a single object.
+ * If bit "i" of "n" is set, then obj[i] is the combination
+ * of 2^i consecutive disjuncts, with higher levels containing
+ * earlier disjuncts.
+ * Combining the disjuncts in a balanced way avoids a cost
+ * that is quadratic in the number of disjuncts when
+ * many of them live in the same space.
+ */
+#define ISL_OBJ_PARTIAL_LEVELS	(8 * sizeof(unsigned))
+
+struct isl_obj_partial {
+	unsigned n;
+	struct isl_obj obj[ISL_OBJ_PARTIAL_LEVELS];
+};
+
+static void obj_partial_free(struct isl_obj_partial *partial)
+{
+	int i;
+
+	for (i = 0; i < ISL_OBJ_PARTIAL_LEVELS; ++i)
+		if (partial->n & (1u << i))
+			partial->obj[i].type->free(partial->obj[i].v);
+	partial->n = 0;
+}
+
+/* Add the disjunct "o" to "partial", combining it with
+ * the partial results at the lowest levels.
+ */
+static int obj_partial_add(isl_ctx *ctx, struct isl_obj_partial *partial,
+	struct isl_obj o)
+{
+	int i;
+
+	for (i = 0; i < ISL_OBJ_PARTIAL_LEVELS && (partial->n & (1u << i));
+	     ++i) {
+		partial->n &= ~(1u << i);
+		o = obj_add(ctx, partial->obj[i], o);
+		if (o.type == isl_obj_none || !o.v)
+			goto error;
+	}
+	if (i >= ISL_OBJ_PARTIAL_LEVELS)
+		isl_die(ctx, isl_error_unsupported, "too many disjuncts",
+			goto error);
+	partial->obj[i] = o;
+	partial->n |= 1u << i;
+
+	return 0;
+error:
+	o.type->free(o.v);
+	obj_partial_free(partial);
+	return -1;
+}
+
+/* Combine all partial results in "partial" into a single object.
+ * "partial" is assumed to contain at least one disjunct.
+ */
+static struct isl_obj obj_partial_finish(isl_ctx *ctx,
+	struct isl_obj_partial *partial)
+{
+	int i;
+	struct isl_obj obj = { isl_obj_none, NULL };
+
+	for (i = 0; i < ISL_OBJ_PARTIAL_LEVELS; ++i) {
+		if (!(partial->n & (1u << i)))
+			continue;
+		partial->n &= ~(1u << i);
+		if (!obj.v)
+			obj = partial->obj[i];
+		else
+			obj = obj_add(ctx, partial->obj[i], obj);
+		if (obj.type == isl_obj_none || !obj.v) {
+			obj_partial_free(partial);
+			break;
+		}
+	}
+
+	return obj;
+}
+
 static struct isl_obj obj_read(struct isl_stream *s)
 {
 	isl_map *map = NULL;
 	struct isl_token *tok;
 	struct vars *v = NULL;
 	struct isl_obj obj = { isl_obj_set, NULL };
+	struct isl_obj_partial partial = { 0 };
 
 	tok = next_token(s);
 	if (!tok) {
@@ -2422,13 +2595,8 @@ static struct isl_obj obj_read(struct isl_stream *s)
 		o = obj_read_body(s, isl_map_copy(map), v);
 		if (o.type == isl_obj_none || !o.v)
 			goto error;
-		if (!obj.v)
-			obj = o;
-		else {
-			obj = obj_add(s->ctx, obj, o);
-			if (obj.type == isl_obj_none || !obj.v)
-				goto error;
-		}
+		if (obj_partial_add(s->ctx, &partial, o) < 0)
+			goto error;
 		tok = isl_stream_next_token(s);
 		if (!tok || tok->type != ';')
 			break;
@@ -2447,6 +2615,9 @@ static struct isl_obj obj_read(struct isl_stream *s)
 			isl_token_free(tok);
 		goto error;
 	}
+	obj = obj_partial_finish(s->ctx, &partial);
+	if (obj.type == isl_obj_none || !obj.v)
+		goto error;
 done:
 	vars_free(v);
 	isl_map_free(map);
@@ -2454,6 +2625,7 @@ done:
 	return obj;
 error:
 	isl_map_free(map);
+	obj_partial_free(&partial);
 	obj.type->free(obj.v);
 	if (v)
 		vars_free(v);
@@ -2689,6 +2861,285 @@ struct isl_set *isl_set_read_from_str(struct isl_ctx *ctx,
 	return set;
 }
 
+#ifdef HAVE_PTHREAD
+
+/* The number of groups of consecutive disjuncts per thread
+ * into which read_threads divides its input.
+ * Having more groups than threads balances the work
+ * if the disjuncts differ in size.
+ */
+#define ISL_READ_GROUPS_PER_THREAD	4
+
+/* Data used by read_threads for parsing the disjuncts of
+ * the union map or union set of type "type" in "str" on several threads.
+ * The first "prefix_len" characters of "str" contain
+ * the parameter declarations (if any) and the opening brace.
+ * Element "i" of the "n" pieces of the input consists of
+ * the characters of "str" from position start[i] up to
+ * (but not including) position end[i].
+ * These pieces are first the disjuncts and then the groups
+ * of consecutive disjuncts.
+ * res[i] is the result of parsing group "i", imported into "ctx".
+ */
+struct isl_read_threads {
+	isl_ctx *ctx;
+	const char *str;
+	isl_obj_type type;
+	size_t prefix_len;
+	int n;
+	int size;
+	size_t *start;
+	size_t *end;
+	void **res;
+};
+
+/* Return the position of the first character in "str"
+ * at or after position "pos" that is not a white space.
+ */
+static size_t skip_space(const char *str, size_t pos)
+{
+	while (isspace((unsigned char) str[pos]))
+		++pos;
+	return pos;
+}
+
+/* Return the position of the first character in "str"
+ * at or after position "pos" that is either a ';' that is not nested
+ * inside parentheses, brackets or braces, or a closing parenthesis,
+ * bracket or brace that does not match any opening one after "pos".
+ * If there is no such character, then return the position
+ * of the terminating NUL character.
+ */
+static size_t skip_nested(const char *str, size_t pos)
+{
+	int depth = 0;
+
+	for (;; ++pos) {
+		char c = str[pos];
+
+		if (!c)
+			return pos;
+		if (c == '(' || c == '[' || c == '{')
+			++depth;
+		else if (c == ')' || c == ']' || c == '}') {
+			if (depth-- == 0)
+				return pos;
+		} else if (c == ';' && depth == 0)
+			return pos;
+	}
+}
+
+/* Add the piece of data->str from position "start" up to position "end"
+ * to data->start and data->end.
+ */
+static int add_piece(struct isl_read_threads *data, size_t start, size_t end)
+{
+	if (data->n >= data->size) {
+		int size = 2 * data->size + 16;
+		size_t *p;
+
+		p = isl_realloc_array(data->ctx, data->start, size_t, size);
+		if (!p)
+			return -1;
+		data->start = p;
+		p = isl_realloc_array(data->ctx, data->end, size_t, size);
+		if (!p)
+			return -1;
+		data->end = p;
+		data->size = size;
+	}
+	data->start[data->n] = start;
+	data->end[data->n] = end;
+	data->n++;
+
+	return 0;
+}
+
+/* Split data->str into its parameter declarations and its disjuncts,
+ * which are separated by ';' characters at the outer level.
+ * Return 1 if the input has been split into at least two disjuncts,
+ * 0 if the input should be parsed by the calling thread instead and
+ * -1 on error.
+ *
+ * The input is only split if it is of the form
+ *
+ *	[params] -> { disjunct; ...; disjunct }
+ *
+ * with optional parameter declarations and an optional ';'
+ * after the final disjunct.
+ * Inputs that contain comments or strings are not split since
+ * they may contain any character.  Inputs in PolyLib format
+ * (which do not start with '[' or '{') and inputs with
+ * a "Sym" declaration (which applies to all disjuncts)
+ * are not split either.
+ * Any other kind of syntax error in the input is left
+ * for the parser to report, except that an empty disjunct
+ * may be accepted when it is parsed on its own.  Such inputs
+ * are therefore also left to the calling thread.
+ */
+static int split_disjuncts(struct isl_read_threads *data)
+{
+	const char *str = data->str;
+	size_t pos, end;
+
+	if (!str || strpbrk(str, "#\""))
+		return 0;
+	pos = skip_space(str, 0);
+	if (str[pos] == '[') {
+		pos = skip_nested(str, pos + 1);
+		if (str[pos] != ']')
+			return 0;
+		pos = skip_space(str, pos + 1);
+		if (strncmp(str + pos, "->", 2))
+			return 0;
+		pos = skip_space(str, pos + 2);
+	}
+	if (str[pos] != '{')
+		return 0;
+	data->prefix_len = ++pos;
+	pos = skip_space(str, pos);
+	if (!strncmp(str + pos, "Sym", 3) &&
+	    !isalnum((unsigned char) str[pos + 3]) && str[pos + 3] != '_')
+		return 0;
+
+	for (;;) {
+		end = skip_nested(str, pos);
+		if (skip_space(str, pos) == end) {
+			if (str[end] == '}' && data->n > 0)
+				break;
+			return 0;
+		}
+		if (add_piece(data, pos, end) < 0)
+			return -1;
+		if (str[end] != ';')
+			break;
+		pos = end + 1;
+	}
+
+	if (str[end] != '}')
+		return 0;
+	return data->n >= 2;
+}
+
+/* Parse group "i" of the disjuncts in data->str, preceded by
+ * the parameter declarations and the opening brace in the first
+ * data->prefix_len characters of data->str, in the isl_ctx of "worker" and
+ * import the result into data->ctx.
+ */
+static int read_group(struct isl_thread_worker *worker, int i, void *user)
+{
+	struct isl_read_threads *data = user;
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	size_t len = data->end[i] - data->start[i];
+	struct isl_stream *s;
+	char *str;
+	void *v;
+
+	str = isl_alloc_array(ctx, char, data->prefix_len + len + 3);
+	if (!str)
+		return -1;
+	memcpy(str, data->str, data->prefix_len);
+	memcpy(str + data->prefix_len, data->str + data->start[i], len);
+	strcpy(str + data->prefix_len + len, " }");
+	s = isl_stream_new_str(ctx, str);
+	if (!s)
+		v = NULL;
+	else if (data->type == isl_obj_union_set)
+		v = isl_stream_read_union_set(s);
+	else
+		v = isl_stream_read_union_map(s);
+	isl_stream_free(s);
+	free(str);
+	if (!v)
+		return -1;
+
+	isl_thread_worker_lock(worker);
+	if (data->type == isl_obj_union_set)
+		data->res[i] = isl_union_set_import(data->ctx, v);
+	else
+		data->res[i] = isl_union_map_import(data->ctx, v);
+	isl_thread_worker_unlock(worker);
+	data->type->free(v);
+
+	return data->res[i] ? 0 : -1;
+}
+
+/* Read a union map or union set (depending on "type") from "str"
+ * using (at most) "n_thread" threads.
+ * Return an object of type isl_obj_none if "str" should be parsed
+ * by the calling thread instead (see split_disjuncts).
+ *
+ * The disjuncts are divided over groups of consecutive disjuncts,
+ * each of which is parsed, together with the parameter declarations,
+ * in a worker isl_ctx.  Since a disjunct can only refer to
+ * the parameters and to the variables that it declares itself
+ * (see obj_read_body), this results in the same disjuncts
+ * as parsing the entire input.
+ * The results of the groups are combined in order
+ * in the same way as the disjuncts in obj_read.
+ */
+static struct isl_obj read_threads(isl_ctx *ctx, const char *str,
+	isl_obj_type type, int n_thread)
+{
+	struct isl_read_threads data = { ctx, str, type };
+	struct isl_obj_partial partial = { 0 };
+	struct isl_obj obj = { isl_obj_none, NULL };
+	int i, n, r;
+
+	r = split_disjuncts(&data);
+	if (r == 0) {
+		free(data.start);
+		free(data.end);
+		return obj;
+	}
+	obj.type = type;
+	if (r < 0)
+		goto error;
+
+	n = ISL_READ_GROUPS_PER_THREAD * n_thread;
+	if (n > data.n)
+		n = data.n;
+	for (i = 0; i < n; ++i) {
+		int first = (size_t) i * data.n / n;
+		int last = (size_t) (i + 1) * data.n / n - 1;
+
+		data.start[i] = data.start[first];
+		data.end[i] = data.end[last];
+	}
+	data.n = n;
+
+	data.res = isl_calloc_array(ctx, void *, n);
+	if (!data.res)
+		goto error;
+	if (isl_thread_run(ctx, n, &read_group, &data) < 0)
+		goto error;
+
+	for (i = 0; i < n; ++i) {
+		struct isl_obj o = { type, data.res[i] };
+
+		data.res[i] = NULL;
+		if (obj_partial_add(ctx, &partial, o) < 0)
+			goto error;
+	}
+	obj = obj_partial_finish(ctx, &partial);
+	obj.type = type;
+
+	free(data.res);
+	free(data.start);
+	free(data.end);
+	return obj;
+error:
+	if (data.res)
+		for (i = 0; i < data.n; ++i)
+			type->free(data.res[i]);
+	free(data.res);
+	free(data.start);
+	free(data.end);
+	obj.v = NULL;
+	return obj;
+}
+#endif
+
 __isl_give isl_union_map *isl_union_map_read_from_file(isl_ctx *ctx,
 	FILE *input)
 {
@@ -2705,7 +3156,19 @@ __isl_give isl_union_map *isl_union_map_read_from_str(struct isl_ctx *ctx,
 		const char *str)
 {
 	isl_union_map *umap;
-	struct isl_stream *s = isl_stream_new_str(ctx, str);
+	struct isl_stream *s;
+
+#ifdef HAVE_PTHREAD
+	if (ctx && ctx->opt->threads > 1) {
+		struct isl_obj obj;
+
+		obj = read_threads(ctx, str, isl_obj_union_map,
+				    ctx->opt->threads);
+		if (obj.type != isl_obj_none)
+			return obj.v;
+	}
+#endif
+	s = isl_stream_new_str(ctx, str);
 	if (!s)
 		return NULL;
 	umap = isl_stream_read_union_map(s);
@@ -2729,7 +3192,19 @@ __isl_give isl_union_set *isl_union_set_read_from_str(struct isl_ctx *ctx,
 		const char *str)
 {
 	isl_union_set *uset;
-	struct isl_stream *s = isl_stream_new_str(ctx, str);
+	struct isl_stream *s;
+
+#ifdef HAVE_PTHREAD
+	if (ctx && ctx->opt->threads > 1) {
+		struct isl_obj obj;
+
+		obj = read_threads(ctx, str, isl_obj_union_set,
+				    ctx->opt->threads);
+		if (obj.type != isl_obj_none)
+			return obj.v;
+	}
+#endif
+	s = isl_stream_new_str(ctx, str);
 	if (!s)
 		return NULL;
 	uset = isl_stream_read_union_set(s);
@@ -17,8 +17,12 @@
 #include <isl_config.h>
 
 #ifdef USE_GMP_FOR_MP
+#ifdef USE_SMALL_INT_OPT
+#include <isl_int_sio.h>
+#else
 #include <isl_int_gmp.h>
 #endif
+#endif
 
 #ifdef USE_IMATH_FOR_MP
 #include <isl_int_imath.h>
@@ -0,0 +1,12 @@
+#include <isl_int.h>
+
+/* Hash the value of "arg".
+ * The result is the same as that of isl_gmp_hash applied
+ * to the corresponding mpz_t, independently of the representation.
+ */
+uint32_t isl_sio_hash(isl_sio arg, uint32_t hash)
+{
+	isl_sio_scratch scratch;
+
+	return isl_gmp_hash(isl_sio_bigarg_src(arg, &scratch), hash);
+}
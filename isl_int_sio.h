@@ -0,0 +1,861 @@
+#ifndef ISL_INT_SIO_H
+#define ISL_INT_SIO_H
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <gmp.h>
+
+#include "isl_hide_deprecated.h"
+
+/* isl_int is the basic integer type, implemented as a tagged 64-bit word
+ * on top of GMP's mpz_t (small integer optimization).
+ *
+ * If the least significant bit of the word is set, then the upper 32 bits
+ * contain the value of the integer as a signed 32-bit integer
+ * (the "small" representation).
+ * Otherwise, the word is a pointer to a heap allocated mpz_t
+ * (the "big" representation).
+ *
+ * Operations on small integers are performed on machine words.
+ * If the result does not fit in 32 bits, it is promoted
+ * to the big representation.  The result of an operation on
+ * big integers is demoted to the small representation whenever it fits.
+ *
+ * An isl_int is declared as an array of size one, such that,
+ * as with mpz_t, it is passed by reference.
+ */
+typedef uint64_t isl_sio;
+typedef isl_sio *isl_sio_ptr;
+typedef isl_sio isl_int[1];
+
+/* Scratch space for presenting a small integer as a read-only mpz_t.
+ * The absolute value of a 32-bit integer always fits in a single limb.
+ */
+typedef struct {
+	__mpz_struct big;
+	mp_limb_t limb;
+} isl_sio_scratch;
+
+static inline int isl_sio_is_small(isl_sio val)
+{
+	return val & 1;
+}
+
+static inline int isl_sio_is_big(isl_sio val)
+{
+	return !(val & 1);
+}
+
+static inline int32_t isl_sio_get_small(isl_sio val)
+{
+	return (int32_t) (val >> 32);
+}
+
+static inline mpz_ptr isl_sio_get_big(isl_sio val)
+{
+	return (mpz_ptr) (uintptr_t) val;
+}
+
+static inline isl_sio isl_sio_encode_small(int32_t val)
+{
+	return ((isl_sio) (uint32_t) val) << 32 | 1;
+}
+
+static inline isl_sio isl_sio_encode_big(mpz_ptr val)
+{
+	return (isl_sio) (uintptr_t) val;
+}
+
+/* Return a read-only mpz_t representation of "val".
+ * If "val" is small, then the representation is constructed in "scratch".
+ */
+static inline mpz_ptr isl_sio_bigarg_src(isl_sio val, isl_sio_scratch *scratch)
+{
+	int32_t small;
+
+	if (isl_sio_is_big(val))
+		return isl_sio_get_big(val);
+
+	small = isl_sio_get_small(val);
+	scratch->limb = small < 0 ? -(mp_limb_t) small : (mp_limb_t) small;
+	scratch->big._mp_alloc = 1;
+	scratch->big._mp_size = small < 0 ? -1 : small > 0;
+	scratch->big._mp_d = &scratch->limb;
+	return &scratch->big;
+}
+
+/* Free the big representation of "*ptr", if any.
+ * The mpz_t itself was allocated by isl_sio_reinit_big
+ * using the GMP allocation functions, so it is also released
+ * using the matching GMP function.
+ */
+static inline void isl_sio_release(isl_sio_ptr ptr)
+{
+	mpz_ptr big;
+	void (*free_func)(void *, size_t);
+
+	if (isl_sio_is_small(*ptr))
+		return;
+	big = isl_sio_get_big(*ptr);
+	mpz_clear(big);
+	mp_get_memory_functions(NULL, NULL, &free_func);
+	free_func(big, sizeof(__mpz_struct));
+}
+
+/* Make sure "*ptr" has a big representation and return a pointer to it.
+ * The value of "*ptr" is not preserved.
+ *
+ * The isl_int operations do not have access to an isl_ctx and
+ * cannot report errors, so an allocation failure cannot be
+ * turned into an isl_error_alloc error here.
+ * Instead, the mpz_t is allocated using the GMP allocation functions,
+ * such that a failure is handled in the same way as a failure
+ * to allocate the limbs of any GMP integer, by the GMP backend
+ * of isl_int as well as by this one.  By default, GMP prints
+ * an error message and aborts, but this can be changed
+ * by the user through mp_set_memory_functions.
+ */
+static inline mpz_ptr isl_sio_reinit_big(isl_sio_ptr ptr)
+{
+	mpz_ptr big;
+	void *(*alloc_func)(size_t);
+
+	if (isl_sio_is_big(*ptr))
+		return isl_sio_get_big(*ptr);
+
+	mp_get_memory_functions(&alloc_func, NULL, NULL);
+	big = (mpz_ptr) alloc_func(sizeof(__mpz_struct));
+	mpz_init(big);
+	*ptr = isl_sio_encode_big(big);
+	return big;
+}
+
+/* Make sure "*ptr" has a big representation and return a pointer to it,
+ * preserving the value of "*ptr".
+ */
+static inline mpz_ptr isl_sio_promote(isl_sio_ptr ptr)
+{
+	int32_t small;
+	mpz_ptr big;
+
+	if (isl_sio_is_big(*ptr))
+		return isl_sio_get_big(*ptr);
+
+	small = isl_sio_get_small(*ptr);
+	big = isl_sio_reinit_big(ptr);
+	mpz_set_si(big, small);
+	return big;
+}
+
+static inline void isl_sio_set_int32(isl_sio_ptr dst, int32_t val)
+{
+	isl_sio_release(dst);
+	*dst = isl_sio_encode_small(val);
+}
+
+/* Switch "*ptr" to the small representation if its value fits.
+ */
+static inline void isl_sio_try_demote(isl_sio_ptr ptr)
+{
+	mpz_ptr big;
+	mp_limb_t limb;
+	int sgn;
+
+	if (isl_sio_is_small(*ptr))
+		return;
+	big = isl_sio_get_big(*ptr);
+	if (mpz_size(big) > 1)
+		return;
+	sgn = mpz_sgn(big);
+	limb = mpz_getlimbn(big, 0);
+	if (sgn >= 0 && limb > (mp_limb_t) INT32_MAX)
+		return;
+	if (sgn < 0 && limb > (mp_limb_t) INT32_MAX + 1)
+		return;
+	if (sgn < 0)
+		isl_sio_set_int32(ptr, (int32_t) -(int64_t) limb);
+	else
+		isl_sio_set_int32(ptr, (int32_t) limb);
+}
+
+static inline void isl_sio_mpz_set_int64(mpz_ptr big, int64_t val)
+{
+#if LONG_MAX >= INT64_MAX
+	mpz_set_si(big, val);
+#else
+	uint64_t abs_val = val < 0 ? -(uint64_t) val : (uint64_t) val;
+
+	mpz_set_ui(big, (unsigned long) (abs_val >> 32));
+	mpz_mul_2exp(big, big, 32);
+	mpz_add_ui(big, big, (unsigned long) (abs_val & 0xffffffff));
+	if (val < 0)
+		mpz_neg(big, big);
+#endif
+}
+
+static inline void isl_sio_set_int64(isl_sio_ptr dst, int64_t val)
+{
+	if (val >= INT32_MIN && val <= INT32_MAX) {
+		isl_sio_set_int32(dst, (int32_t) val);
+		return;
+	}
+	isl_sio_mpz_set_int64(isl_sio_reinit_big(dst), val);
+}
+
+static inline void isl_sio_init(isl_sio_ptr dst)
+{
+	*dst = isl_sio_encode_small(0);
+}
+
+static inline void isl_sio_clear(isl_sio_ptr dst)
+{
+	isl_sio_release(dst);
+}
+
+static inline void isl_sio_set(isl_sio_ptr dst, isl_sio val)
+{
+	if (*dst == val)
+		return;
+	if (isl_sio_is_small(val)) {
+		isl_sio_set_int32(dst, isl_sio_get_small(val));
+		return;
+	}
+	mpz_set(isl_sio_reinit_big(dst), isl_sio_get_big(val));
+}
+
+static inline void isl_sio_set_si(isl_sio_ptr dst, long val)
+{
+	if (val >= INT32_MIN && val <= INT32_MAX) {
+		isl_sio_set_int32(dst, (int32_t) val);
+		return;
+	}
+	mpz_set_si(isl_sio_reinit_big(dst), val);
+}
+
+static inline void isl_sio_set_ui(isl_sio_ptr dst, unsigned long val)
+{
+	if (val <= INT32_MAX) {
+		isl_sio_set_int32(dst, (int32_t) val);
+		return;
+	}
+	mpz_set_ui(isl_sio_reinit_big(dst), val);
+}
+
+/* Set "dst" to the value of the GMP integer "val".
+ */
+static inline void isl_sio_set_mpz(isl_sio_ptr dst, mpz_srcptr val)
+{
+	mpz_set(isl_sio_reinit_big(dst), val);
+	isl_sio_try_demote(dst);
+}
+
+/* Set the GMP integer "dst" to the value of "val".
+ */
+static inline void isl_sio_get_mpz(mpz_ptr dst, isl_sio val)
+{
+	if (isl_sio_is_small(val))
+		mpz_set_si(dst, isl_sio_get_small(val));
+	else
+		mpz_set(dst, isl_sio_get_big(val));
+}
+
+static inline int isl_sio_fits_slong(isl_sio val)
+{
+	if (isl_sio_is_small(val))
+		return 1;
+	return mpz_fits_slong_p(isl_sio_get_big(val));
+}
+
+static inline long isl_sio_get_si(isl_sio val)
+{
+	if (isl_sio_is_small(val))
+		return isl_sio_get_small(val);
+	return mpz_get_si(isl_sio_get_big(val));
+}
+
+static inline int isl_sio_fits_ulong(isl_sio val)
+{
+	if (isl_sio_is_small(val))
+		return isl_sio_get_small(val) >= 0;
+	return mpz_fits_ulong_p(isl_sio_get_big(val));
+}
+
+static inline unsigned long isl_sio_get_ui(isl_sio val)
+{
+	if (isl_sio_is_small(val))
+		return isl_sio_get_small(val);
+	return mpz_get_ui(isl_sio_get_big(val));
+}
+
+static inline double isl_sio_get_d(isl_sio val)
+{
+	if (isl_sio_is_small(val))
+		return isl_sio_get_small(val);
+	return mpz_get_d(isl_sio_get_big(val));
+}
+
+/* Return a string representation of "val" that should be freed
+ * using isl_int_free_str.
+ */
+static inline char *isl_sio_get_str(isl_sio val)
+{
+	char *s;
+	mpz_ptr big;
+
+	if (isl_sio_is_small(val)) {
+		s = (char *) malloc(12);
+		if (s)
+			snprintf(s, 12, "%ld", (long) isl_sio_get_small(val));
+		return s;
+	}
+
+	big = isl_sio_get_big(val);
+	s = (char *) malloc(mpz_sizeinbase(big, 10) + 2);
+	if (s)
+		mpz_get_str(s, 10, big);
+	return s;
+}
+
+static inline int isl_sio_read(isl_sio_ptr dst, const char *str)
+{
+	int r;
+
+	r = mpz_set_str(isl_sio_reinit_big(dst), str, 10);
+	isl_sio_try_demote(dst);
+	return r;
+}
+
+static inline void isl_sio_abs(isl_sio_ptr dst, isl_sio arg)
+{
+	int64_t small;
+
+	if (isl_sio_is_small(arg)) {
+		small = isl_sio_get_small(arg);
+		isl_sio_set_int64(dst, small < 0 ? -small : small);
+		return;
+	}
+	mpz_abs(isl_sio_reinit_big(dst), isl_sio_get_big(arg));
+}
+
+static inline void isl_sio_neg(isl_sio_ptr dst, isl_sio arg)
+{
+	if (isl_sio_is_small(arg)) {
+		isl_sio_set_int64(dst, -(int64_t) isl_sio_get_small(arg));
+		return;
+	}
+	mpz_neg(isl_sio_reinit_big(dst), isl_sio_get_big(arg));
+	isl_sio_try_demote(dst);
+}
+
+static inline void isl_sio_swap(isl_sio_ptr lhs, isl_sio_ptr rhs)
+{
+	isl_sio tmp = *lhs;
+	*lhs = *rhs;
+	*rhs = tmp;
+}
+
+static inline void isl_sio_add(isl_sio_ptr dst, isl_sio lhs, isl_sio rhs)
+{
+	isl_sio_scratch s1, s2;
+
+	if (isl_sio_is_small(lhs) && isl_sio_is_small(rhs)) {
+		isl_sio_set_int64(dst, (int64_t) isl_sio_get_small(lhs) +
+					isl_sio_get_small(rhs));
+		return;
+	}
+	mpz_add(isl_sio_reinit_big(dst), isl_sio_bigarg_src(lhs, &s1),
+		isl_sio_bigarg_src(rhs, &s2));
+	isl_sio_try_demote(dst);
+}
+
+static inline void isl_sio_sub(isl_sio_ptr dst, isl_sio lhs, isl_sio rhs)
+{
+	isl_sio_scratch s1, s2;
+
+	if (isl_sio_is_small(lhs) && isl_sio_is_small(rhs)) {
+		isl_sio_set_int64(dst, (int64_t) isl_sio_get_small(lhs) -
+					isl_sio_get_small(rhs));
+		return;
+	}
+	mpz_sub(isl_sio_reinit_big(dst), isl_sio_bigarg_src(lhs, &s1),
+		isl_sio_bigarg_src(rhs, &s2));
+	isl_sio_try_demote(dst);
+}
+
+static inline void isl_sio_add_ui(isl_sio_ptr dst, isl_sio lhs,
+	unsigned long rhs)
+{
+	isl_sio_scratch s;
+
+	if (isl_sio_is_small(lhs) && rhs <= UINT32_MAX) {
+		isl_sio_set_int64(dst, (int64_t) isl_sio_get_small(lhs) +
+					(int64_t) rhs);
+		return;
+	}
+	mpz_add_ui(isl_sio_reinit_big(dst), isl_sio_bigarg_src(lhs, &s), rhs);
+	isl_sio_try_demote(dst);
+}
+
+static inline void isl_sio_sub_ui(isl_sio_ptr dst, isl_sio lhs,
+	unsigned long rhs)
+{
+	isl_sio_scratch s;
+
+	if (isl_sio_is_small(lhs) && rhs <= UINT32_MAX) {
+		isl_sio_set_int64(dst, (int64_t) isl_sio_get_small(lhs) -
+					(int64_t) rhs);
+		return;
+	}
+	mpz_sub_ui(isl_sio_reinit_big(dst), isl_sio_bigarg_src(lhs, &s), rhs);
+	isl_sio_try_demote(dst);
+}
+
+static inline void isl_sio_mul(isl_sio_ptr dst, isl_sio lhs, isl_sio rhs)
+{
+	isl_sio_scratch s1, s2;
+
+	if (isl_sio_is_small(lhs) && isl_sio_is_small(rhs)) {
+		isl_sio_set_int64(dst, (int64_t) isl_sio_get_small(lhs) *
+					isl_sio_get_small(rhs));
+		return;
+	}
+	mpz_mul(isl_sio_reinit_big(dst), isl_sio_bigarg_src(lhs, &s1),
+		isl_sio_bigarg_src(rhs, &s2));
+	isl_sio_try_demote(dst);
+}
+
+static inline void isl_sio_mul_si(isl_sio_ptr dst, isl_sio lhs, long rhs)
+{
+	isl_sio_scratch s;
+
+	if (isl_sio_is_small(lhs) && rhs >= INT32_MIN && rhs <= INT32_MAX) {
+		isl_sio_set_int64(dst, (int64_t) isl_sio_get_small(lhs) * rhs);
+		return;
+	}
+	mpz_mul_si(isl_sio_reinit_big(dst), isl_sio_bigarg_src(lhs, &s), rhs);
+	isl_sio_try_demote(dst);
+}
+
+static inline void isl_sio_mul_ui(isl_sio_ptr dst, isl_sio lhs,
+	unsigned long rhs)
+{
+	isl_sio_scratch s;
+
+	if (isl_sio_is_small(lhs) && rhs <= UINT32_MAX) {
+		isl_sio_set_int64(dst, (int64_t) isl_sio_get_small(lhs) *
+					(int64_t) rhs);
+		return;
+	}
+	mpz_mul_ui(isl_sio_reinit_big(dst), isl_sio_bigarg_src(lhs, &s), rhs);
+	isl_sio_try_demote(dst);
+}
+
+static inline void isl_sio_mul_2exp(isl_sio_ptr dst, isl_sio lhs,
+	unsigned long exp)
+{
+	isl_sio_scratch s;
+
+	if (isl_sio_is_small(lhs) && exp <= 32) {
+		isl_sio_set_int64(dst, (int64_t) isl_sio_get_small(lhs) *
+					((int64_t) 1 << exp));
+		return;
+	}
+	mpz_mul_2exp(isl_sio_reinit_big(dst), isl_sio_bigarg_src(lhs, &s), exp);
+	isl_sio_try_demote(dst);
+}
+
+static inline void isl_sio_pow_ui(isl_sio_ptr dst, isl_sio lhs,
+	unsigned long exp)
+{
+	isl_sio_scratch s;
+
+	mpz_pow_ui(isl_sio_reinit_big(dst), isl_sio_bigarg_src(lhs, &s), exp);
+	isl_sio_try_demote(dst);
+}
+
+/* Set "dst" to "dst" + "lhs" * "rhs".
+ * In the small case, the product fits in 63 bits, such that
+ * adding a 32-bit value cannot overflow a 64-bit integer.
+ */
+static inline void isl_sio_addmul(isl_sio_ptr dst, isl_sio lhs, isl_sio rhs)
+{
+	isl_sio_scratch s1, s2;
+
+	if (isl_sio_is_small(*dst) &&
+	    isl_sio_is_small(lhs) && isl_sio_is_small(rhs)) {
+		isl_sio_set_int64(dst, (int64_t) isl_sio_get_small(*dst) +
+			(int64_t) isl_sio_get_small(lhs) *
+			isl_sio_get_small(rhs));
+		return;
+	}
+	mpz_addmul(isl_sio_promote(dst), isl_sio_bigarg_src(lhs, &s1),
+		isl_sio_bigarg_src(rhs, &s2));
+	isl_sio_try_demote(dst);
+}
+
+static inline void isl_sio_addmul_ui(isl_sio_ptr dst, isl_sio lhs,
+	unsigned long rhs)
+{
+	isl_sio_scratch s;
+
+	if (isl_sio_is_small(*dst) && isl_sio_is_small(lhs) &&
+	    rhs <= INT32_MAX) {
+		isl_sio_set_int64(dst, (int64_t) isl_sio_get_small(*dst) +
+			(int64_t) isl_sio_get_small(lhs) * (int64_t) rhs);
+		return;
+	}
+	mpz_addmul_ui(isl_sio_promote(dst), isl_sio_bigarg_src(lhs, &s), rhs);
+	isl_sio_try_demote(dst);
+}
+
+/* Set "dst" to "dst" - "lhs" * "rhs".
+ */
+static inline void isl_sio_submul(isl_sio_ptr dst, isl_sio lhs, isl_sio rhs)
+{
+	isl_sio_scratch s1, s2;
+
+	if (isl_sio_is_small(*dst) &&
+	    isl_sio_is_small(lhs) && isl_sio_is_small(rhs)) {
+		isl_sio_set_int64(dst, (int64_t) isl_sio_get_small(*dst) -
+			(int64_t) isl_sio_get_small(lhs) *
+			isl_sio_get_small(rhs));
+		return;
+	}
+	mpz_submul(isl_sio_promote(dst), isl_sio_bigarg_src(lhs, &s1),
+		isl_sio_bigarg_src(rhs, &s2));
+	isl_sio_try_demote(dst);
+}
+
+static inline void isl_sio_submul_ui(isl_sio_ptr dst, isl_sio lhs,
+	unsigned long rhs)
+{
+	isl_sio_scratch s;
+
+	if (isl_sio_is_small(*dst) && isl_sio_is_small(lhs) &&
+	    rhs <= INT32_MAX) {
+		isl_sio_set_int64(dst, (int64_t) isl_sio_get_small(*dst) -
+			(int64_t) isl_sio_get_small(lhs) * (int64_t) rhs);
+		return;
+	}
+	mpz_submul_ui(isl_sio_promote(dst), isl_sio_bigarg_src(lhs, &s), rhs);
+	isl_sio_try_demote(dst);
+}
+
+static inline uint32_t isl_sio_gcd_small(uint32_t a, uint32_t b)
+{
+	while (b) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+static inline uint32_t isl_sio_abs_small(int32_t val)
+{
+	return val < 0 ? -(uint32_t) val : (uint32_t) val;
+}
+
+static inline void isl_sio_gcd(isl_sio_ptr dst, isl_sio lhs, isl_sio rhs)
+{
+	isl_sio_scratch s1, s2;
+
+	if (isl_sio_is_small(lhs) && isl_sio_is_small(rhs)) {
+		isl_sio_set_int64(dst, isl_sio_gcd_small(
+				isl_sio_abs_small(isl_sio_get_small(lhs)),
+				isl_sio_abs_small(isl_sio_get_small(rhs))));
+		return;
+	}
+	mpz_gcd(isl_sio_reinit_big(dst), isl_sio_bigarg_src(lhs, &s1),
+		isl_sio_bigarg_src(rhs, &s2));
+	isl_sio_try_demote(dst);
+}
+
+static inline void isl_sio_lcm(isl_sio_ptr dst, isl_sio lhs, isl_sio rhs)
+{
+	isl_sio_scratch s1, s2;
+
+	if (isl_sio_is_small(lhs) && isl_sio_is_small(rhs)) {
+		uint32_t a = isl_sio_abs_small(isl_sio_get_small(lhs));
+		uint32_t b = isl_sio_abs_small(isl_sio_get_small(rhs));
+
+		if (a == 0 || b == 0) {
+			isl_sio_set_int32(dst, 0);
+			return;
+		}
+		isl_sio_set_int64(dst,
+			(int64_t) (a / isl_sio_gcd_small(a, b)) * b);
+		return;
+	}
+	mpz_lcm(isl_sio_reinit_big(dst), isl_sio_bigarg_src(lhs, &s1),
+		isl_sio_bigarg_src(rhs, &s2));
+	isl_sio_try_demote(dst);
+}
+
+static inline void isl_sio_divexact(isl_sio_ptr dst, isl_sio lhs, isl_sio rhs)
+{
+	isl_sio_scratch s1, s2;
+
+	if (isl_sio_is_small(lhs) && isl_sio_is_small(rhs)) {
+		isl_sio_set_int64(dst, (int64_t) isl_sio_get_small(lhs) /
+					isl_sio_get_small(rhs));
+		return;
+	}
+	mpz_divexact(isl_sio_reinit_big(dst), isl_sio_bigarg_src(lhs, &s1),
+		isl_sio_bigarg_src(rhs, &s2));
+	isl_sio_try_demote(dst);
+}
+
+static inline void isl_sio_divexact_ui(isl_sio_ptr dst, isl_sio lhs,
+	unsigned long rhs)
+{
+	isl_sio_scratch s;
+
+	if (isl_sio_is_small(lhs) && rhs <= UINT32_MAX) {
+		isl_sio_set_int64(dst, (int64_t) isl_sio_get_small(lhs) /
+					(int64_t) rhs);
+		return;
+	}
+	mpz_divexact_ui(isl_sio_reinit_big(dst),
+			isl_sio_bigarg_src(lhs, &s), rhs);
+	isl_sio_try_demote(dst);
+}
+
+static inline void isl_sio_tdiv_q(isl_sio_ptr dst, isl_sio lhs, isl_sio rhs)
+{
+	isl_sio_scratch s1, s2;
+
+	if (isl_sio_is_small(lhs) && isl_sio_is_small(rhs)) {
+		isl_sio_set_int64(dst, (int64_t) isl_sio_get_small(lhs) /
+					isl_sio_get_small(rhs));
+		return;
+	}
+	mpz_tdiv_q(isl_sio_reinit_big(dst), isl_sio_bigarg_src(lhs, &s1),
+		isl_sio_bigarg_src(rhs, &s2));
+	isl_sio_try_demote(dst);
+}
+
+/* Return the floor of "a" divided by "b", assuming "b" is not zero.
+ */
+static inline int64_t isl_sio_fdiv_q_int64(int64_t a, int64_t b)
+{
+	int64_t q = a / b;
+
+	if (q * b != a && ((a < 0) != (b < 0)))
+		--q;
+	return q;
+}
+
+/* Return the ceiling of "a" divided by "b", assuming "b" is not zero.
+ */
+static inline int64_t isl_sio_cdiv_q_int64(int64_t a, int64_t b)
+{
+	int64_t q = a / b;
+
+	if (q * b != a && ((a < 0) == (b < 0)))
+		++q;
+	return q;
+}
+
+static inline void isl_sio_cdiv_q(isl_sio_ptr dst, isl_sio lhs, isl_sio rhs)
+{
+	isl_sio_scratch s1, s2;
+
+	if (isl_sio_is_small(lhs) && isl_sio_is_small(rhs)) {
+		isl_sio_set_int64(dst,
+			    isl_sio_cdiv_q_int64(isl_sio_get_small(lhs),
+						isl_sio_get_small(rhs)));
+		return;
+	}
+	mpz_cdiv_q(isl_sio_reinit_big(dst), isl_sio_bigarg_src(lhs, &s1),
+		isl_sio_bigarg_src(rhs, &s2));
+	isl_sio_try_demote(dst);
+}
+
+static inline void isl_sio_fdiv_q(isl_sio_ptr dst, isl_sio lhs, isl_sio rhs)
+{
+	isl_sio_scratch s1, s2;
+
+	if (isl_sio_is_small(lhs) && isl_sio_is_small(rhs)) {
+		isl_sio_set_int64(dst,
+			    isl_sio_fdiv_q_int64(isl_sio_get_small(lhs),
+						isl_sio_get_small(rhs)));
+		return;
+	}
+	mpz_fdiv_q(isl_sio_reinit_big(dst), isl_sio_bigarg_src(lhs, &s1),
+		isl_sio_bigarg_src(rhs, &s2));
+	isl_sio_try_demote(dst);
+}
+
+static inline void isl_sio_fdiv_q_ui(isl_sio_ptr dst, isl_sio lhs,
+	unsigned long rhs)
+{
+	isl_sio_scratch s;
+
+	if (isl_sio_is_small(lhs) && rhs <= UINT32_MAX) {
+		isl_sio_set_int64(dst,
+			    isl_sio_fdiv_q_int64(isl_sio_get_small(lhs),
+						(int64_t) rhs));
+		return;
+	}
+	mpz_fdiv_q_ui(isl_sio_reinit_big(dst), isl_sio_bigarg_src(lhs, &s), rhs);
+	isl_sio_try_demote(dst);
+}
+
+/* Set "dst" to the remainder of the floor division of "lhs" by "rhs".
+ * The result has the same sign as "rhs".
+ */
+static inline void isl_sio_fdiv_r(isl_sio_ptr dst, isl_sio lhs, isl_sio rhs)
+{
+	isl_sio_scratch s1, s2;
+
+	if (isl_sio_is_small(lhs) && isl_sio_is_small(rhs)) {
+		int64_t a = isl_sio_get_small(lhs);
+		int64_t b = isl_sio_get_small(rhs);
+		int64_t r = a % b;
+
+		if (r != 0 && ((r < 0) != (b < 0)))
+			r += b;
+		isl_sio_set_int64(dst, r);
+		return;
+	}
+	mpz_fdiv_r(isl_sio_reinit_big(dst), isl_sio_bigarg_src(lhs, &s1),
+		isl_sio_bigarg_src(rhs, &s2));
+	isl_sio_try_demote(dst);
+}
+
+static inline int isl_sio_sgn(isl_sio arg)
+{
+	int32_t small;
+
+	if (isl_sio_is_small(arg)) {
+		small = isl_sio_get_small(arg);
+		return small < 0 ? -1 : small > 0;
+	}
+	return mpz_sgn(isl_sio_get_big(arg));
+}
+
+static inline int isl_sio_cmp(isl_sio lhs, isl_sio rhs)
+{
+	isl_sio_scratch s1, s2;
+	int32_t a, b;
+
+	if (isl_sio_is_small(lhs) && isl_sio_is_small(rhs)) {
+		a = isl_sio_get_small(lhs);
+		b = isl_sio_get_small(rhs);
+		return a < b ? -1 : a > b;
+	}
+	return mpz_cmp(isl_sio_bigarg_src(lhs, &s1),
+			isl_sio_bigarg_src(rhs, &s2));
+}
+
+static inline int isl_sio_cmp_si(isl_sio lhs, long rhs)
+{
+	long a;
+
+	if (isl_sio_is_small(lhs)) {
+		a = isl_sio_get_small(lhs);
+		return a < rhs ? -1 : a > rhs;
+	}
+	return mpz_cmp_si(isl_sio_get_big(lhs), rhs);
+}
+
+static inline int isl_sio_abs_cmp(isl_sio lhs, isl_sio rhs)
+{
+	isl_sio_scratch s1, s2;
+	uint32_t a, b;
+
+	if (isl_sio_is_small(lhs) && isl_sio_is_small(rhs)) {
+		a = isl_sio_abs_small(isl_sio_get_small(lhs));
+		b = isl_sio_abs_small(isl_sio_get_small(rhs));
+		return a < b ? -1 : a > b;
+	}
+	return mpz_cmpabs(isl_sio_bigarg_src(lhs, &s1),
+			isl_sio_bigarg_src(rhs, &s2));
+}
+
+static inline int isl_sio_is_divisible_by(isl_sio lhs, isl_sio rhs)
+{
+	isl_sio_scratch s1, s2;
+	int64_t a, b;
+
+	if (isl_sio_is_small(lhs) && isl_sio_is_small(rhs)) {
+		a = isl_sio_get_small(lhs);
+		b = isl_sio_get_small(rhs);
+		if (b == 0)
+			return a == 0;
+		return a % b == 0;
+	}
+	return mpz_divisible_p(isl_sio_bigarg_src(lhs, &s1),
+			isl_sio_bigarg_src(rhs, &s2));
+}
+
+uint32_t isl_gmp_hash(mpz_t v, uint32_t hash);
+uint32_t isl_sio_hash(isl_sio arg, uint32_t hash);
+
+#define isl_int_init(i)		isl_sio_init(i)
+#define isl_int_clear(i)	isl_sio_clear(i)
+
+#define isl_int_set(r,i)	isl_sio_set(r,*(i))
+#define isl_int_set_si(r,i)	isl_sio_set_si(r,i)
+#define isl_int_set_ui(r,i)	isl_sio_set_ui(r,i)
+#define isl_int_fits_slong(r)	isl_sio_fits_slong(*(r))
+#define isl_int_get_si(r)	isl_sio_get_si(*(r))
+#define isl_int_fits_ulong(r)	isl_sio_fits_ulong(*(r))
+#define isl_int_get_ui(r)	isl_sio_get_ui(*(r))
+#define isl_int_get_d(r)	isl_sio_get_d(*(r))
+#define isl_int_get_str(r)	isl_sio_get_str(*(r))
+#define isl_int_abs(r,i)	isl_sio_abs(r,*(i))
+#define isl_int_neg(r,i)	isl_sio_neg(r,*(i))
+#define isl_int_swap(i,j)	isl_sio_swap(i,j)
+#define isl_int_swap_or_set(i,j)	isl_sio_swap(i,j)
+#define isl_int_add_ui(r,i,j)	isl_sio_add_ui(r,*(i),j)
+#define isl_int_sub_ui(r,i,j)	isl_sio_sub_ui(r,*(i),j)
+
+#define isl_int_add(r,i,j)	isl_sio_add(r,*(i),*(j))
+#define isl_int_sub(r,i,j)	isl_sio_sub(r,*(i),*(j))
+#define isl_int_mul(r,i,j)	isl_sio_mul(r,*(i),*(j))
+#define isl_int_mul_2exp(r,i,j)	isl_sio_mul_2exp(r,*(i),j)
+#define isl_int_mul_si(r,i,j)	isl_sio_mul_si(r,*(i),j)
+#define isl_int_mul_ui(r,i,j)	isl_sio_mul_ui(r,*(i),j)
+#define isl_int_pow_ui(r,i,j)	isl_sio_pow_ui(r,*(i),j)
+#define isl_int_addmul(r,i,j)	isl_sio_addmul(r,*(i),*(j))
+#define isl_int_addmul_ui(r,i,j)	isl_sio_addmul_ui(r,*(i),j)
+#define isl_int_submul(r,i,j)	isl_sio_submul(r,*(i),*(j))
+#define isl_int_submul_ui(r,i,j)	isl_sio_submul_ui(r,*(i),j)
+
+#define isl_int_gcd(r,i,j)	isl_sio_gcd(r,*(i),*(j))
+#define isl_int_lcm(r,i,j)	isl_sio_lcm(r,*(i),*(j))
+#define isl_int_divexact(r,i,j)	isl_sio_divexact(r,*(i),*(j))
+#define isl_int_divexact_ui(r,i,j)	isl_sio_divexact_ui(r,*(i),j)
+#define isl_int_tdiv_q(r,i,j)	isl_sio_tdiv_q(r,*(i),*(j))
+#define isl_int_cdiv_q(r,i,j)	isl_sio_cdiv_q(r,*(i),*(j))
+#define isl_int_fdiv_q(r,i,j)	isl_sio_fdiv_q(r,*(i),*(j))
+#define isl_int_fdiv_r(r,i,j)	isl_sio_fdiv_r(r,*(i),*(j))
+#define isl_int_fdiv_q_ui(r,i,j)	isl_sio_fdiv_q_ui(r,*(i),j)
+
+#define isl_int_read(r,s)	isl_sio_read(r,s)
+#define isl_int_sgn(i)		isl_sio_sgn(*(i))
+#define isl_int_cmp(i,j)	isl_sio_cmp(*(i),*(j))
+#define isl_int_cmp_si(i,si)	isl_sio_cmp_si(*(i),si)
+#define isl_int_eq(i,j)		(isl_sio_cmp(*(i),*(j)) == 0)
+#define isl_int_ne(i,j)		(isl_sio_cmp(*(i),*(j)) != 0)
+#define isl_int_lt(i,j)		(isl_sio_cmp(*(i),*(j)) < 0)
+#define isl_int_le(i,j)		(isl_sio_cmp(*(i),*(j)) <= 0)
+#define isl_int_gt(i,j)		(isl_sio_cmp(*(i),*(j)) > 0)
+#define isl_int_ge(i,j)		(isl_sio_cmp(*(i),*(j)) >= 0)
+#define isl_int_abs_cmp(i,j)	isl_sio_abs_cmp(*(i),*(j))
+#define isl_int_abs_eq(i,j)	(isl_sio_abs_cmp(*(i),*(j)) == 0)
+#define isl_int_abs_ne(i,j)	(isl_sio_abs_cmp(*(i),*(j)) != 0)
+#define isl_int_abs_lt(i,j)	(isl_sio_abs_cmp(*(i),*(j)) < 0)
+#define isl_int_abs_gt(i,j)	(isl_sio_abs_cmp(*(i),*(j)) > 0)
+#define isl_int_abs_ge(i,j)	(isl_sio_abs_cmp(*(i),*(j)) >= 0)
+#define isl_int_is_divisible_by(i,j)	isl_sio_is_divisible_by(*(i),*(j))
+
+#define isl_int_hash(v,h)	isl_sio_hash(*(v),h)
+
+#define isl_int_free_str(s)	free(s)
+
+#endif /* ISL_INT_SIO_H */
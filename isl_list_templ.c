@@ -130,6 +130,22 @@ static __isl_give LIST(EL) *FN(LIST(EL),grow)(__isl_take LIST(EL) *list, int n)
 	return res;
 }
 
+/* Make sure "list" has room for at least "n" more elements,
+ * such that they can be added without any further reallocation.
+ */
+__isl_give LIST(EL) *FN(LIST(EL),reserve)(__isl_take LIST(EL) *list, int n)
+{
+	if (!list)
+		return NULL;
+	if (n < 0)
+		isl_die(list->ctx, isl_error_invalid,
+			"cannot reserve negative number of elements",
+			return FN(LIST(EL),free)(list));
+	if (list->ref == 1 && list->n + n <= list->size)
+		return list;
+	return FN(LIST(EL),grow)(list, n);
+}
+
 __isl_give LIST(EL) *FN(LIST(EL),add)(__isl_take LIST(EL) *list,
 	__isl_take struct EL *el)
 {
@@ -192,8 +208,8 @@ __isl_give LIST(EL) *FN(LIST(EL),insert)(__isl_take LIST(EL) *list,
 			"index out of bounds", goto error);
 
 	if (list->ref == 1 && list->size > list->n) {
-		for (i = list->n - 1; i >= pos; --i)
-			list->p[i + 1] = list->p[i];
+		for (i = list->n; i > pos; --i)
+			list->p[i] = list->p[i - 1];
 		list->n++;
 		list->p[pos] = el;
 		return list;
@@ -273,6 +289,97 @@ error:
 	return NULL;
 }
 
+/* Remove the element at position "index" from "list" and
+ * return it in *el.
+ * If "list" has only a single reference, then the element is
+ * moved out of the list rather than copied.
+ */
+__isl_give LIST(EL) *FN(FN(LIST(EL),take),BASE)(__isl_take LIST(EL) *list,
+	int index, __isl_give EL **el)
+{
+	int i;
+
+	if (!el)
+		return FN(LIST(EL),free)(list);
+	*el = NULL;
+	if (!list)
+		return NULL;
+	if (index < 0 || index >= list->n)
+		isl_die(list->ctx, isl_error_invalid,
+			"index out of bounds", return FN(LIST(EL),free)(list));
+	if (list->ref != 1) {
+		*el = FN(EL,copy)(list->p[index]);
+		return FN(LIST(EL),drop)(list, index, 1);
+	}
+	*el = list->p[index];
+	for (i = index; i + 1 < list->n; ++i)
+		list->p[i] = list->p[i + 1];
+	list->n--;
+	return list;
+}
+
+/* Swap the elements at positions "pos1" and "pos2" of "list".
+ */
+__isl_give LIST(EL) *FN(LIST(EL),swap)(__isl_take LIST(EL) *list,
+	unsigned pos1, unsigned pos2)
+{
+	EL *el;
+
+	if (!list)
+		return NULL;
+	if (pos1 >= list->n || pos2 >= list->n)
+		isl_die(list->ctx, isl_error_invalid,
+			"index out of bounds", return FN(LIST(EL),free)(list));
+	if (pos1 == pos2)
+		return list;
+	list = FN(LIST(EL),cow)(list);
+	if (!list)
+		return NULL;
+	el = list->p[pos1];
+	list->p[pos1] = list->p[pos2];
+	list->p[pos2] = el;
+	return list;
+}
+
+/* Replace each element of "list" by the result of applying "fn" to it.
+ * The elements are passed to "fn" without being copied
+ * (after making sure "list" has only a single reference).
+ * If "fn" fails, then the remaining elements are left untouched and
+ * the list is freed.
+ *
+ * The calls to "fn" are not distributed over worker threads
+ * (see isl_thread_run).  The only work that would be performed
+ * in parallel is that of "fn" itself, which is supplied by the caller
+ * and may access other objects of the caller's isl_ctx through "user",
+ * e.g., to collect results, while a worker may only access those
+ * between isl_thread_worker_lock and isl_thread_worker_unlock.
+ * Running "fn" in a worker would therefore change the contract
+ * of this function.  Furthermore, only some of the element types
+ * of lists (basic sets, sets, affine expressions and constraints)
+ * can be imported into a worker isl_ctx and back.
+ */
+__isl_give LIST(EL) *FN(LIST(EL),map)(__isl_take LIST(EL) *list,
+	__isl_give EL *(*fn)(__isl_take EL *el, void *user), void *user)
+{
+	int i;
+
+	list = FN(LIST(EL),cow)(list);
+	if (!list)
+		return NULL;
+
+	for (i = 0; i < list->n; ++i) {
+		EL *el = list->p[i];
+
+		list->p[i] = NULL;
+		el = fn(el, user);
+		if (!el)
+			return FN(LIST(EL),free)(list);
+		list->p[i] = el;
+	}
+
+	return list;
+}
+
 int FN(LIST(EL),foreach)(__isl_keep LIST(EL) *list,
 	int (*fn)(__isl_take EL *el, void *user), void *user)
 {
@@ -461,26 +568,38 @@ error:
 	return NULL;
 }
 
+/* Concatenate "list1" and "list2".
+ *
+ * The elements of "list2" are appended to "list1",
+ * which is extended in place if it has only a single reference.
+ * If "list2" has only a single reference (and is not the same
+ * list as "list1"), then its elements are moved rather than copied.
+ */
 __isl_give LIST(EL) *FN(LIST(EL),concat)(__isl_take LIST(EL) *list1,
 	__isl_take LIST(EL) *list2)
 {
 	int i;
-	isl_ctx *ctx;
-	LIST(EL) *res;
+	int steal;
 
 	if (!list1 || !list2)
 		goto error;
 
-	ctx = FN(LIST(EL),get_ctx)(list1);
-	res = FN(LIST(EL),alloc)(ctx, list1->n + list2->n);
-	for (i = 0; i < list1->n; ++i)
-		res = FN(LIST(EL),add)(res, FN(EL,copy)(list1->p[i]));
-	for (i = 0; i < list2->n; ++i)
-		res = FN(LIST(EL),add)(res, FN(EL,copy)(list2->p[i]));
+	list1 = FN(LIST(EL),grow)(list1, list2->n);
+	if (!list1)
+		goto error;
+	steal = list2->ref == 1 && list1 != list2;
+	for (i = 0; i < list2->n; ++i) {
+		if (steal)
+			list1->p[list1->n + i] = list2->p[i];
+		else
+			list1->p[list1->n + i] = FN(EL,copy)(list2->p[i]);
+	}
+	list1->n += list2->n;
+	if (steal)
+		list2->n = 0;
 
-	FN(LIST(EL),free)(list1);
 	FN(LIST(EL),free)(list2);
-	return res;
+	return list1;
 error:
 	FN(LIST(EL),free)(list1);
 	FN(LIST(EL),free)(list2);
@@ -149,6 +149,24 @@ int isl_local_space_is_equal(__isl_keep isl_local_space *ls1,
 	return isl_mat_is_equal(ls1->div, ls2->div);
 }
 
+/* Do "ls1" and "ls2" have the same integer divisions,
+ * in the same order?
+ *
+ * Local spaces that result from aligning the divs of two objects
+ * share the same div matrix, so check for that case first
+ * before comparing the matrices.
+ */
+int isl_local_space_has_equal_divs(__isl_keep isl_local_space *ls1,
+	__isl_keep isl_local_space *ls2)
+{
+	if (!ls1 || !ls2)
+		return -1;
+
+	if (ls1->div == ls2->div)
+		return 1;
+	return isl_mat_is_equal(ls1->div, ls2->div);
+}
+
 /* Compare two isl_local_spaces.
  *
  * Return -1 if "ls1" is "smaller" than "ls2", 1 if "ls1" is "greater"
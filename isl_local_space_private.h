@@ -33,6 +33,8 @@ __isl_give isl_local_space *isl_local_space_replace_divs(
 	__isl_take isl_local_space *ls, __isl_take isl_mat *div);
 int isl_local_space_div_is_known(__isl_keep isl_local_space *ls, int div);
 int isl_local_space_divs_known(__isl_keep isl_local_space *ls);
+int isl_local_space_has_equal_divs(__isl_keep isl_local_space *ls1,
+	__isl_keep isl_local_space *ls2);
 
 __isl_give isl_local_space *isl_local_space_substitute_equalities(
 	__isl_take isl_local_space *ls, __isl_take isl_basic_set *eq);
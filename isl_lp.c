@@ -18,28 +18,29 @@
 #include <isl_mat_private.h>
 #include <isl_val_private.h>
 #include <isl_vec_private.h>
+#include <isl_lp_private.h>
 
-enum isl_lp_result isl_tab_solve_lp(struct isl_basic_map *bmap, int maximize,
-				      isl_int *f, isl_int denom, isl_int *opt,
-				      isl_int *opt_denom,
-				      struct isl_vec **sol)
+/* Compute the minimal (or maximal if "maximize" is set) value
+ * of the affine expression "f" with "dim" variables
+ * and denominator "denom" over "tab".
+ * The optimal basis of "tab" is kept, such that it can serve
+ * as a starting point for subsequent optimizations.
+ */
+static enum isl_lp_result tab_solve_lp(struct isl_tab *tab, unsigned dim,
+	int maximize, isl_int *f, isl_int denom, isl_int *opt,
+	isl_int *opt_denom, __isl_give isl_vec **sol)
 {
-	struct isl_tab *tab;
 	enum isl_lp_result res;
-	unsigned dim = isl_basic_map_total_dim(bmap);
 
 	if (maximize)
 		isl_seq_neg(f, f, 1 + dim);
 
-	bmap = isl_basic_map_gauss(bmap, NULL);
-	tab = isl_tab_from_basic_map(bmap, 0);
 	res = isl_tab_min(tab, f, denom, opt, opt_denom, 0);
 	if (res == isl_lp_ok && sol) {
 		*sol = isl_tab_get_sample_value(tab);
 		if (!*sol)
 			res = isl_lp_error;
 	}
-	isl_tab_free(tab);
 
 	if (maximize)
 		isl_seq_neg(f, f, 1 + dim);
@@ -49,6 +50,166 @@ enum isl_lp_result isl_tab_solve_lp(struct isl_basic_map *bmap, int maximize,
 	return res;
 }
 
+enum isl_lp_result isl_tab_solve_lp(struct isl_basic_map *bmap, int maximize,
+				      isl_int *f, isl_int denom, isl_int *opt,
+				      isl_int *opt_denom,
+				      struct isl_vec **sol)
+{
+	struct isl_tab *tab;
+	enum isl_lp_result res;
+	unsigned dim = isl_basic_map_total_dim(bmap);
+
+	bmap = isl_basic_map_gauss(bmap, NULL);
+	tab = isl_tab_lean_from_basic_map(bmap);
+	res = tab_solve_lp(tab, dim, maximize, f, denom, opt, opt_denom, sol);
+	isl_tab_free(tab);
+
+	return res;
+}
+
+/* A tableau for solving a sequence of related LP problems.
+ * "dim" is the total number of variables.
+ *
+ * Each LP problem is solved starting from the optimal basis
+ * of the previous problem rather than from scratch.
+ * Constraints can be added in between (which only requires
+ * a few pivots to restore feasibility) and the most recently added
+ * constraints can be removed again by rolling back to a snapshot.
+ */
+struct isl_tab_lp {
+	unsigned dim;
+	struct isl_tab *tab;
+};
+
+/* Construct an isl_tab_lp for solving LP problems over "bmap".
+ */
+__isl_give isl_tab_lp *isl_tab_lp_from_basic_map(
+	__isl_take isl_basic_map *bmap)
+{
+	isl_ctx *ctx;
+	isl_tab_lp *lp;
+
+	if (!bmap)
+		return NULL;
+
+	ctx = isl_basic_map_get_ctx(bmap);
+	lp = isl_calloc_type(ctx, struct isl_tab_lp);
+	if (!lp)
+		goto error;
+
+	lp->dim = isl_basic_map_total_dim(bmap);
+	bmap = isl_basic_map_gauss(bmap, NULL);
+	lp->tab = isl_tab_lean_from_basic_map(bmap);
+	isl_basic_map_free(bmap);
+	if (!lp->tab)
+		return isl_tab_lp_free(lp);
+
+	return lp;
+error:
+	isl_basic_map_free(bmap);
+	return NULL;
+}
+
+__isl_null isl_tab_lp *isl_tab_lp_free(__isl_take isl_tab_lp *lp)
+{
+	if (!lp)
+		return NULL;
+
+	isl_tab_free(lp->tab);
+	free(lp);
+
+	return NULL;
+}
+
+isl_ctx *isl_tab_lp_get_ctx(__isl_keep isl_tab_lp *lp)
+{
+	return lp ? isl_tab_get_ctx(lp->tab) : NULL;
+}
+
+/* Return the total number of variables of "lp".
+ */
+int isl_tab_lp_dim(__isl_keep isl_tab_lp *lp)
+{
+	return lp ? lp->dim : -1;
+}
+
+/* Add the inequality constraint "ineq" of length 1 + isl_tab_lp_dim(lp)
+ * to "lp".
+ * Room is reserved for an extra constraint, such that the objective
+ * function can still be added by isl_tab_min on a lean tableau.
+ */
+__isl_give isl_tab_lp *isl_tab_lp_add_ineq(__isl_take isl_tab_lp *lp,
+	isl_int *ineq)
+{
+	if (!lp)
+		return NULL;
+
+	if (isl_tab_extend_cons(lp->tab, 2) < 0 ||
+	    isl_tab_add_ineq(lp->tab, ineq) < 0)
+		return isl_tab_lp_free(lp);
+
+	return lp;
+}
+
+/* Add the equality constraint "eq" of length 1 + isl_tab_lp_dim(lp)
+ * to "lp".
+ * As in isl_tab_lp_add_ineq, room is reserved for the objective function.
+ */
+__isl_give isl_tab_lp *isl_tab_lp_add_eq(__isl_take isl_tab_lp *lp,
+	isl_int *eq)
+{
+	if (!lp)
+		return NULL;
+
+	if (isl_tab_extend_cons(lp->tab, 3) < 0 ||
+	    isl_tab_add_eq(lp->tab, eq) < 0)
+		return isl_tab_lp_free(lp);
+
+	return lp;
+}
+
+/* Return a snapshot of the constraints of "lp".
+ */
+struct isl_tab_undo *isl_tab_lp_snap(__isl_keep isl_tab_lp *lp)
+{
+	return lp ? isl_tab_snap(lp->tab) : NULL;
+}
+
+/* Remove the constraints that were added to "lp"
+ * since the snapshot "snap" was taken.
+ * The current basis is kept as a starting point for the next LP problem.
+ */
+__isl_give isl_tab_lp *isl_tab_lp_rollback(__isl_take isl_tab_lp *lp,
+	struct isl_tab_undo *snap)
+{
+	if (!lp)
+		return NULL;
+
+	if (isl_tab_rollback(lp->tab, snap) < 0)
+		return isl_tab_lp_free(lp);
+
+	return lp;
+}
+
+/* Set *opt / *opt_denom to the minimal (or maximal if "max" is true)
+ * value attained by "f"/"denom" over the current constraints of "lp",
+ * starting from the optimal basis of the previously solved problem.
+ * The meaning of the arguments and of the return value
+ * is the same as for isl_basic_map_solve_lp.
+ */
+enum isl_lp_result isl_tab_lp_solve(__isl_keep isl_tab_lp *lp, int max,
+	isl_int *f, isl_int denom, isl_int *opt, isl_int *opt_denom,
+	__isl_give isl_vec **sol)
+{
+	if (sol)
+		*sol = NULL;
+	if (!lp)
+		return isl_lp_error;
+
+	return tab_solve_lp(lp->tab, lp->dim, max, f, denom,
+				opt, opt_denom, sol);
+}
+
 /* Given a basic map "bmap" and an affine combination of the variables "f"
  * with denominator "denom", set *opt / *opt_denom to the minimal
  * (or maximal if "maximize" is true) value attained by f/d over "bmap",
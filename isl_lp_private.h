@@ -18,4 +18,28 @@ enum isl_lp_result isl_set_solve_lp(__isl_keep isl_set *set, int max,
 	isl_int *f, isl_int denom, isl_int *opt, isl_int *opt_denom,
 	__isl_give isl_vec **sol);
 
+struct isl_tab_undo;
+struct isl_tab_lp;
+typedef struct isl_tab_lp isl_tab_lp;
+
+__isl_give isl_tab_lp *isl_tab_lp_from_basic_map(
+	__isl_take isl_basic_map *bmap);
+__isl_null isl_tab_lp *isl_tab_lp_free(__isl_take isl_tab_lp *lp);
+isl_ctx *isl_tab_lp_get_ctx(__isl_keep isl_tab_lp *lp);
+int isl_tab_lp_dim(__isl_keep isl_tab_lp *lp);
+__isl_give isl_tab_lp *isl_tab_lp_add_ineq(__isl_take isl_tab_lp *lp,
+	isl_int *ineq);
+__isl_give isl_tab_lp *isl_tab_lp_add_eq(__isl_take isl_tab_lp *lp,
+	isl_int *eq);
+struct isl_tab_undo *isl_tab_lp_snap(__isl_keep isl_tab_lp *lp);
+__isl_give isl_tab_lp *isl_tab_lp_rollback(__isl_take isl_tab_lp *lp,
+	struct isl_tab_undo *snap);
+enum isl_lp_result isl_tab_lp_solve(__isl_keep isl_tab_lp *lp, int max,
+	isl_int *f, isl_int denom, isl_int *opt, isl_int *opt_denom,
+	__isl_give isl_vec **sol);
+
+__isl_give isl_tab_lp *isl_set_wrap_lp(__isl_keep isl_set *set);
+__isl_give isl_tab_lp *isl_set_wrap_facet_lp(__isl_keep isl_set *set,
+	__isl_take isl_tab_lp *lp, isl_int *facet, isl_int *ridge);
+
 #endif
@@ -16,6 +16,7 @@
  */
 
 #include <string.h>
+#include <isl_config.h>
 #include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl_blk.h>
@@ -27,7 +28,6 @@
 #include <isl/map.h>
 #include <isl_reordering.h>
 #include "isl_sample.h"
-#include <isl_sort.h>
 #include "isl_tab.h"
 #include <isl/vec.h>
 #include <isl_mat_private.h>
@@ -38,6 +38,9 @@
 #include <isl_options_private.h>
 #include <isl_morph.h>
 #include <isl_val_private.h>
+#include <isl_profile.h>
+#include <isl_point_private.h>
+#include <isl_thread.h>
 #include <isl/deprecated/map_int.h>
 #include <isl/deprecated/set_int.h>
 
@@ -1016,6 +1019,132 @@ struct isl_basic_map *isl_basic_map_dup(struct isl_basic_map *bmap)
 	return dup;
 }
 
+/* Exchange the storage of the constraints and integer divisions
+ * of "bmap1" and "bmap2".
+ */
+static void swap_storage(__isl_keep isl_basic_map *bmap1,
+	__isl_keep isl_basic_map *bmap2)
+{
+	struct isl_blk blk;
+	isl_int **p;
+	unsigned u;
+
+	blk = bmap1->block; bmap1->block = bmap2->block; bmap2->block = blk;
+	blk = bmap1->block2; bmap1->block2 = bmap2->block2; bmap2->block2 = blk;
+	p = bmap1->eq; bmap1->eq = bmap2->eq; bmap2->eq = p;
+	p = bmap1->ineq; bmap1->ineq = bmap2->ineq; bmap2->ineq = p;
+	p = bmap1->div; bmap1->div = bmap2->div; bmap2->div = p;
+	u = bmap1->extra; bmap1->extra = bmap2->extra; bmap2->extra = u;
+	u = bmap1->c_size; bmap1->c_size = bmap2->c_size; bmap2->c_size = u;
+}
+
+/* Reallocate the constraints and integer divisions of "bmap"
+ * such that they take up no more memory than needed, i.e.,
+ * such that there is no room for any additional constraints
+ * or integer divisions.
+ *
+ * The constraints are copied into a fresh basic map of the exact size.
+ * If "bmap" is not shared, then the storage of the two basic maps
+ * is exchanged such that "bmap" is compacted in place.
+ * Otherwise, other users may still refer to the rows of "bmap"
+ * and the fresh basic map is returned instead, as a copy of "bmap".
+ */
+__isl_give isl_basic_map *isl_basic_map_compact(
+	__isl_take isl_basic_map *bmap)
+{
+	isl_basic_map *tmp;
+
+	if (!bmap)
+		return NULL;
+	if (bmap->extra == bmap->n_div &&
+	    bmap->c_size == bmap->n_eq + bmap->n_ineq)
+		return bmap;
+
+	tmp = isl_basic_map_alloc_space(isl_space_copy(bmap->dim),
+			bmap->n_div, bmap->n_eq, bmap->n_ineq);
+	if (!tmp)
+		return isl_basic_map_free(bmap);
+	dup_constraints(tmp, bmap);
+	if (bmap->ref != 1) {
+		tmp->flags = bmap->flags;
+		tmp->sample = isl_vec_copy(bmap->sample);
+		isl_basic_map_free(bmap);
+		return tmp;
+	}
+	swap_storage(bmap, tmp);
+	isl_basic_map_free(tmp);
+
+	return bmap;
+}
+
+__isl_give isl_basic_set *isl_basic_set_compact(
+	__isl_take isl_basic_set *bset)
+{
+	return (isl_basic_set *) isl_basic_map_compact((isl_basic_map *) bset);
+}
+
+/* Return a copy of "bmap" that is allocated in "ctx".
+ */
+__isl_give isl_basic_map *isl_basic_map_import(isl_ctx *ctx,
+	__isl_keep isl_basic_map *bmap)
+{
+	isl_basic_map *res;
+
+	if (!bmap)
+		return NULL;
+	if (bmap->ctx == ctx)
+		return isl_basic_map_copy(bmap);
+
+	res = isl_basic_map_alloc_space(isl_space_import(ctx, bmap->dim),
+			bmap->n_div, bmap->n_eq, bmap->n_ineq);
+	if (!res)
+		return NULL;
+	dup_constraints(res, bmap);
+	res->flags = bmap->flags;
+	if (bmap->sample) {
+		res->sample = isl_vec_alloc(ctx, bmap->sample->size);
+		if (!res->sample)
+			return isl_basic_map_free(res);
+		isl_seq_cpy(res->sample->el, bmap->sample->el,
+				bmap->sample->size);
+	}
+	return res;
+}
+
+__isl_give isl_basic_set *isl_basic_set_import(isl_ctx *ctx,
+	__isl_keep isl_basic_set *bset)
+{
+	return (isl_basic_set *) isl_basic_map_import(ctx,
+						(isl_basic_map *) bset);
+}
+
+/* Return a copy of "map" that is allocated in "ctx".
+ */
+__isl_give isl_map *isl_map_import(isl_ctx *ctx, __isl_keep isl_map *map)
+{
+	int i;
+	isl_map *res;
+
+	if (!map)
+		return NULL;
+	if (map->ctx == ctx)
+		return isl_map_copy(map);
+
+	res = isl_map_alloc_space(isl_space_import(ctx, map->dim),
+				map->n, map->flags);
+	for (i = 0; i < map->n; ++i)
+		res = isl_map_add_basic_map(res,
+				isl_basic_map_import(ctx, map->p[i]));
+	if (res)
+		res->flags = map->flags;
+	return res;
+}
+
+__isl_give isl_set *isl_set_import(isl_ctx *ctx, __isl_keep isl_set *set)
+{
+	return (isl_set *) isl_map_import(ctx, (isl_map *) set);
+}
+
 struct isl_basic_set *isl_basic_set_dup(struct isl_basic_set *bset)
 {
 	struct isl_basic_map *dup;
@@ -1083,6 +1212,7 @@ __isl_null isl_basic_map *isl_basic_map_free(__isl_take isl_basic_map *bmap)
 	free(bmap->ineq);
 	isl_blk_free(bmap->ctx, bmap->block);
 	isl_vec_free(bmap->sample);
+	isl_basic_set_free(bmap->hull);
 	isl_space_free(bmap->dim);
 	free(bmap);
 
@@ -1243,6 +1373,90 @@ void isl_basic_map_inequality_to_equality(
 	ISL_F_CLR(bmap, ISL_BASIC_MAP_ALL_EQUALITIES);
 }
 
+/* Make sure the constraint rows of "bmap" appear in memory
+ * in the same order as the pointers in bmap->ineq (and bmap->eq),
+ * such that the constraints can be swept sequentially.
+ *
+ * The rows are equally sized slots in bmap->block.
+ * Since constraints are only ever reordered by swapping pointers,
+ * these pointers form a permutation of the slots.
+ * Since the number of variables may have been reduced since
+ * the allocation of "bmap", the size of a slot is derived
+ * from the position of the last slot.
+ * We first check whether the rows are already in order and,
+ * if not, undo the permutation one slot at a time, by swapping
+ * the contents of the slot where a row should be with the contents
+ * of the slot where it currently is.
+ * "slot" keeps track of the index in bmap->ineq of the row
+ * that is currently stored in a given slot.
+ *
+ * If the pointers do not seem to form a permutation of the slots,
+ * then the layout is left untouched.
+ * The meaning of "bmap" is not affected, so this can be performed
+ * even if "bmap" is shared.
+ */
+int isl_basic_map_compact_rows(__isl_keep isl_basic_map *bmap)
+{
+	int i;
+	int *slot;
+	size_t row_size;
+	isl_int *data, *last;
+
+	if (!bmap)
+		return -1;
+	if (bmap->c_size <= 1)
+		return 0;
+
+	data = bmap->block.data;
+	last = data;
+	for (i = 0; i < bmap->c_size; ++i)
+		if (bmap->ineq[i] > last)
+			last = bmap->ineq[i];
+	row_size = (last - data) / (bmap->c_size - 1);
+	if (row_size == 0)
+		return 0;
+	for (i = 0; i < bmap->c_size; ++i)
+		if (bmap->ineq[i] != data + i * row_size)
+			break;
+	if (i >= bmap->c_size)
+		return 0;
+
+	slot = isl_alloc_array(bmap->ctx, int, bmap->c_size);
+	if (!slot)
+		return -1;
+	for (i = 0; i < bmap->c_size; ++i)
+		slot[i] = -1;
+	for (i = 0; i < bmap->c_size; ++i) {
+		size_t pos = bmap->ineq[i] - data;
+
+		if (bmap->ineq[i] < data || pos % row_size != 0 ||
+		    pos / row_size >= bmap->c_size ||
+		    slot[pos / row_size] != -1)
+			break;
+		slot[pos / row_size] = i;
+	}
+	if (i < bmap->c_size) {
+		free(slot);
+		return 0;
+	}
+
+	for (i = 0; i < bmap->c_size; ++i) {
+		int j;
+		isl_int *target = data + i * row_size;
+
+		if (bmap->ineq[i] == target)
+			continue;
+		j = slot[i];
+		isl_seq_swp_or_cpy(target, bmap->ineq[i], row_size);
+		slot[(bmap->ineq[i] - data) / row_size] = j;
+		bmap->ineq[j] = bmap->ineq[i];
+		bmap->ineq[i] = target;
+	}
+
+	free(slot);
+	return 0;
+}
+
 static int room_for_ineq(struct isl_basic_map *bmap, unsigned n)
 {
 	return bmap->n_ineq + n <= bmap->eq - bmap->ineq;
@@ -1492,6 +1706,19 @@ struct isl_basic_set *isl_basic_set_add_constraints(struct isl_basic_set *bset1,
 				(struct isl_basic_map *)bset2, 0, pos);
 }
 
+/* Return a basic map with space "dim" and room for "extra" more
+ * integer divisions, "n_eq" more equalities and "n_ineq" more inequalities
+ * than "base" and with the same constraints as "base".
+ * The result is never shared, so that the caller can modify it,
+ * and it is not marked final.
+ *
+ * If "base" is not shared and already has enough room,
+ * then it is returned directly.  Otherwise, a new basic map
+ * is constructed and the constraints of "base" are copied over.
+ * In the latter case, "base" is not modified, so the caller does not
+ * need to call isl_basic_map_cow on "base" before calling this function.
+ * Doing so would result in a (useless) extra copy of the constraints.
+ */
 struct isl_basic_map *isl_basic_map_extend_space(struct isl_basic_map *base,
 		__isl_take isl_space *dim, unsigned extra,
 		unsigned n_eq, unsigned n_ineq)
@@ -1509,9 +1736,10 @@ struct isl_basic_map *isl_basic_map_extend_space(struct isl_basic_map *base,
 	dims_ok = isl_space_is_equal(base->dim, dim) &&
 		  base->extra >= base->n_div + extra;
 
-	if (dims_ok && room_for_con(base, n_eq + n_ineq) &&
+	if (base->ref == 1 && dims_ok && room_for_con(base, n_eq + n_ineq) &&
 		       room_for_ineq(base, n_ineq)) {
 		isl_space_free(dim);
+		ISL_F_CLR(base, ISL_BASIC_SET_FINAL);
 		return base;
 	}
 
@@ -1614,8 +1842,10 @@ struct isl_basic_map *isl_basic_map_cow(struct isl_basic_map *bmap)
 		bmap->ref--;
 		bmap = isl_basic_map_dup(bmap);
 	}
-	if (bmap)
+	if (bmap) {
 		ISL_F_CLR(bmap, ISL_BASIC_SET_FINAL);
+		bmap->hull = isl_basic_set_free(bmap->hull);
+	}
 	return bmap;
 }
 
@@ -1734,6 +1964,7 @@ struct isl_basic_map *isl_basic_map_set_to_empty(struct isl_basic_map *bmap)
 	ISL_F_SET(bmap, ISL_BASIC_MAP_EMPTY);
 	isl_vec_free(bmap->sample);
 	bmap->sample = NULL;
+	bmap->hull = isl_basic_set_free(bmap->hull);
 	return isl_basic_map_finalize(bmap);
 error:
 	isl_basic_map_free(bmap);
@@ -1994,7 +2225,6 @@ static __isl_give isl_basic_map *insert_bounds_on_div_from_ineq(
 	if (!lb && !ub)
 		return bmap;
 
-	bmap = isl_basic_map_cow(bmap);
 	bmap = isl_basic_map_extend_constraints(bmap, 0, lb + ub);
 	if (lb) {
 		int k = isl_basic_map_alloc_inequality(bmap);
@@ -2737,7 +2967,6 @@ struct isl_basic_map *isl_basic_map_intersect_domain(
 		isl_assert(bset->ctx,
 		    isl_basic_map_compatible_domain(bmap, bset), goto error);
 
-	bmap = isl_basic_map_cow(bmap);
 	if (!bmap)
 		goto error;
 	bmap = isl_basic_map_extend_space(bmap, isl_space_copy(bmap->dim),
@@ -2773,7 +3002,6 @@ struct isl_basic_map *isl_basic_map_intersect_range(
 		return bmap;
 	}
 
-	bmap = isl_basic_map_cow(bmap);
 	if (!bmap)
 		goto error;
 	bmap = isl_basic_map_extend_space(bmap, isl_space_copy(bmap->dim),
@@ -2860,9 +3088,6 @@ struct isl_basic_map *isl_basic_map_intersect(
 	    isl_basic_map_contains(bmap2, bmap2->sample) > 0)
 		sample = isl_vec_copy(bmap2->sample);
 
-	bmap1 = isl_basic_map_cow(bmap1);
-	if (!bmap1)
-		goto error;
 	bmap1 = isl_basic_map_extend_space(bmap1, isl_space_copy(bmap1->dim),
 			bmap2->n_div, bmap2->n_eq, bmap2->n_ineq);
 	bmap1 = add_constraints(bmap1, bmap2, 0, 0);
@@ -2953,6 +3178,15 @@ error:
 
 /* map2 may be either a parameter domain or a map living in the same
  * space as map1.
+ *
+ * If both maps consist of several basic maps and live in the same space,
+ * then we first compute the plain bounds on the basic maps so that
+ * pairs of basic maps that are obviously disjoint can be skipped
+ * without computing their intersection.
+ * If the maps live in the same space, then any pair of basic maps
+ * that survives this test is also subjected to
+ * isl_basic_map_plain_is_disjoint, which catches conflicting
+ * equalities and opposite inequalities.
  */
 static __isl_give isl_map *map_intersect_internal(__isl_take isl_map *map1,
 	__isl_take isl_map *map2)
@@ -2960,6 +3194,8 @@ static __isl_give isl_map *map_intersect_internal(__isl_take isl_map *map1,
 	unsigned flags = 0;
 	isl_map *result;
 	int i, j;
+	int same_space;
+	struct isl_map_plain_boxes *boxes1 = NULL, *boxes2 = NULL;
 
 	if (!map1 || !map2)
 		goto error;
@@ -2993,6 +3229,16 @@ static __isl_give isl_map *map_intersect_internal(__isl_take isl_map *map1,
 	    ISL_F_ISSET(map2, ISL_MAP_DISJOINT))
 		ISL_FL_SET(flags, ISL_MAP_DISJOINT);
 
+	same_space = isl_space_is_equal(map1->dim, map2->dim);
+	if (same_space < 0)
+		goto error;
+	if (map1->n > 1 && map2->n > 1 && same_space) {
+		boxes1 = isl_map_plain_boxes(map1);
+		boxes2 = isl_map_plain_boxes(map2);
+		if (!boxes1 || !boxes2)
+			goto error;
+	}
+
 	result = isl_map_alloc_space(isl_space_copy(map1->dim),
 				map1->n * map2->n, flags);
 	if (!result)
@@ -3000,6 +3246,19 @@ static __isl_give isl_map *map_intersect_internal(__isl_take isl_map *map1,
 	for (i = 0; i < map1->n; ++i)
 		for (j = 0; j < map2->n; ++j) {
 			struct isl_basic_map *part;
+			int disjoint;
+
+			if (boxes1 &&
+			    isl_map_plain_boxes_is_disjoint(boxes1, i,
+							    boxes2, j))
+				continue;
+			disjoint = same_space &&
+			    isl_basic_map_plain_is_disjoint(map1->p[i],
+							    map2->p[j]);
+			if (disjoint < 0)
+				goto error_result;
+			if (disjoint)
+				continue;
 			part = isl_basic_map_intersect(
 				    isl_basic_map_copy(map1->p[i]),
 				    isl_basic_map_copy(map2->p[j]));
@@ -3009,10 +3268,16 @@ static __isl_give isl_map *map_intersect_internal(__isl_take isl_map *map1,
 			if (!result)
 				goto error;
 		}
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
 	isl_map_free(map1);
 	isl_map_free(map2);
 	return result;
+error_result:
+	isl_map_free(result);
 error:
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
 	isl_map_free(map1);
 	isl_map_free(map2);
 	return NULL;
@@ -4457,7 +4722,6 @@ __isl_give isl_basic_map *isl_basic_map_add_known_div_constraints(
 	n_div = isl_basic_map_dim(bmap, isl_dim_div);
 	if (n_div == 0)
 		return bmap;
-	bmap = isl_basic_map_cow(bmap);
 	bmap = isl_basic_map_extend_constraints(bmap, 0, 2 * n_div);
 	if (!bmap)
 		return NULL;
@@ -5399,6 +5663,13 @@ struct isl_map *isl_map_dup(struct isl_map *map)
 	return dup;
 }
 
+/* Add "bmap" to "map".
+ *
+ * If the compact_on_finalize option is set, then "bmap" is compacted
+ * if it has been finalized.  This is not done in isl_basic_map_finalize
+ * itself since some callers still add constraints or integer divisions
+ * to a basic map after finalizing it.
+ */
 __isl_give isl_map *isl_map_add_basic_map(__isl_take isl_map *map,
 						__isl_take isl_basic_map *bmap)
 {
@@ -5410,6 +5681,12 @@ __isl_give isl_map *isl_map_add_basic_map(__isl_take isl_map *map,
 	}
 	isl_assert(map->ctx, isl_space_is_equal(map->dim, bmap->dim), goto error);
 	isl_assert(map->ctx, map->n < map->size, goto error);
+	if (map->ctx->opt->compact_on_finalize &&
+	    ISL_F_ISSET(bmap, ISL_BASIC_MAP_FINAL)) {
+		bmap = isl_basic_map_compact(bmap);
+		if (!bmap)
+			goto error;
+	}
 	map->p[map->n] = bmap;
 	map->n++;
 	ISL_F_CLR(map, ISL_MAP_NORMALIZED);
@@ -5477,7 +5754,6 @@ static struct isl_basic_map *isl_basic_map_fix_pos_si(
 {
 	int j;
 
-	bmap = isl_basic_map_cow(bmap);
 	bmap = isl_basic_map_extend_constraints(bmap, 1, 0);
 	j = isl_basic_map_alloc_equality(bmap);
 	if (j < 0)
@@ -5497,7 +5773,6 @@ static __isl_give isl_basic_map *isl_basic_map_fix_pos(
 {
 	int j;
 
-	bmap = isl_basic_map_cow(bmap);
 	bmap = isl_basic_map_extend_constraints(bmap, 1, 0);
 	j = isl_basic_map_alloc_equality(bmap);
 	if (j < 0)
@@ -5627,6 +5902,47 @@ static int remove_if_empty(__isl_keep isl_map *map, int i)
  * to be careful not to modify "map" in a way that breaks "map"
  * in case anything goes wrong.
  */
+/* Compact each of the basic maps of "map" (see isl_basic_map_compact)
+ * and let them share the space of "map" if their own space
+ * is identical to it.
+ * If "map" is shared, then a copy is compacted instead, such that
+ * the basic maps are compacted through copies as well.
+ */
+__isl_give isl_map *isl_map_compact(__isl_take isl_map *map)
+{
+	int i;
+
+	map = isl_map_cow(map);
+	if (!map)
+		return NULL;
+
+	for (i = 0; i < map->n; ++i) {
+		isl_basic_map *bmap;
+		int identical;
+
+		bmap = isl_basic_map_compact(map->p[i]);
+		map->p[i] = bmap;
+		if (!bmap)
+			return isl_map_free(map);
+		if (bmap->dim == map->dim)
+			continue;
+		identical = isl_space_is_identical(bmap->dim, map->dim);
+		if (identical < 0)
+			return isl_map_free(map);
+		if (!identical)
+			continue;
+		isl_space_free(bmap->dim);
+		bmap->dim = isl_space_copy(map->dim);
+	}
+
+	return map;
+}
+
+__isl_give isl_set *isl_set_compact(__isl_take isl_set *set)
+{
+	return (isl_set *) isl_map_compact((isl_map *) set);
+}
+
 __isl_give isl_map *isl_map_inline_foreach_basic_map(__isl_take isl_map *map,
 	__isl_give isl_basic_map *(*fn)(__isl_take isl_basic_map *bmap))
 {
@@ -5675,6 +5991,81 @@ error:
 	return NULL;
 }
 
+/* Add constraints to "bmap" expressing i_[0..pos) = o_[0..pos) and,
+ * if "more" is set, i_pos > o_pos.
+ * The constraints are added directly to "bmap", without
+ * constructing the corresponding relation isl_basic_map_equal(dim, pos) or
+ * isl_basic_map_more_at(dim, pos) and intersecting with it.
+ */
+static __isl_give isl_basic_map *basic_map_intersect_equal_more_at(
+	__isl_take isl_basic_map *bmap, unsigned pos, int more)
+{
+	int i, k;
+	unsigned nparam, n_in, total;
+
+	bmap = isl_basic_map_extend_constraints(bmap, pos, more);
+	if (!bmap)
+		return NULL;
+
+	nparam = isl_basic_map_n_param(bmap);
+	n_in = isl_basic_map_n_in(bmap);
+	total = isl_basic_map_total_dim(bmap);
+	for (i = 0; i < pos; ++i) {
+		k = isl_basic_map_alloc_equality(bmap);
+		if (k < 0)
+			goto error;
+		isl_seq_clr(bmap->eq[k], 1 + total);
+		isl_int_set_si(bmap->eq[k][1 + nparam + i], -1);
+		isl_int_set_si(bmap->eq[k][1 + nparam + n_in + i], 1);
+	}
+	if (more) {
+		k = isl_basic_map_alloc_inequality(bmap);
+		if (k < 0)
+			goto error;
+		isl_seq_clr(bmap->ineq[k], 1 + total);
+		isl_int_set_si(bmap->ineq[k][0], -1);
+		isl_int_set_si(bmap->ineq[k][1 + nparam + pos], 1);
+		isl_int_set_si(bmap->ineq[k][1 + nparam + n_in + pos], -1);
+	}
+
+	bmap = isl_basic_map_simplify(bmap);
+	return isl_basic_map_finalize(bmap);
+error:
+	isl_basic_map_free(bmap);
+	return NULL;
+}
+
+/* Intersect "map" with the relation expressing i_[0..pos) = o_[0..pos)
+ * and, if "more" is set, i_pos > o_pos, i.e., with
+ * isl_basic_map_equal(dim, pos) if "more" is not set and
+ * with isl_basic_map_more_at(dim, pos) if it is set.
+ */
+__isl_give isl_map *isl_map_intersect_equal_more_at(__isl_take isl_map *map,
+	unsigned pos, int more)
+{
+	int i;
+
+	map = isl_map_cow(map);
+	if (!map)
+		return NULL;
+
+	if (pos + !!more > isl_map_dim(map, isl_dim_in) ||
+	    pos + !!more > isl_map_dim(map, isl_dim_out))
+		isl_die(map->ctx, isl_error_invalid,
+			"position out of bounds", goto error);
+	for (i = map->n - 1; i >= 0; --i) {
+		map->p[i] = basic_map_intersect_equal_more_at(map->p[i],
+								pos, more);
+		if (remove_if_empty(map, i) < 0)
+			goto error;
+	}
+	ISL_F_CLR(map, ISL_MAP_NORMALIZED);
+	return map;
+error:
+	isl_map_free(map);
+	return NULL;
+}
+
 __isl_give isl_set *isl_set_fix_si(__isl_take isl_set *set,
 		enum isl_dim_type type, unsigned pos, int value)
 {
@@ -5774,7 +6165,6 @@ static __isl_give isl_basic_map *basic_map_bound_si(
 		return NULL;
 	isl_assert(bmap->ctx, pos < isl_basic_map_dim(bmap, type), goto error);
 	pos += isl_basic_map_offset(bmap, type);
-	bmap = isl_basic_map_cow(bmap);
 	bmap = isl_basic_map_extend_constraints(bmap, 0, 1);
 	j = isl_basic_map_alloc_inequality(bmap);
 	if (j < 0)
@@ -5815,7 +6205,6 @@ struct isl_basic_set *isl_basic_set_lower_bound_dim(struct isl_basic_set *bset,
 {
 	int j;
 
-	bset = isl_basic_set_cow(bset);
 	bset = isl_basic_set_extend_constraints(bset, 0, 1);
 	j = isl_basic_set_alloc_inequality(bset);
 	if (j < 0)
@@ -5893,7 +6282,6 @@ static __isl_give isl_basic_map *basic_map_bound(
 		isl_die(bmap->ctx, isl_error_invalid,
 			"index out of bounds", goto error);
 	pos += isl_basic_map_offset(bmap, type);
-	bmap = isl_basic_map_cow(bmap);
 	bmap = isl_basic_map_extend_constraints(bmap, 0, 1);
 	j = isl_basic_map_alloc_inequality(bmap);
 	if (j < 0)
@@ -6115,6 +6503,63 @@ __isl_give isl_pw_multi_aff *isl_basic_set_partial_lexmax_pw_multi_aff(
 	return isl_basic_map_partial_lexmax_pw_multi_aff(bset, dom, empty);
 }
 
+int isl_basic_map_foreach_partial_lexmin(__isl_keep isl_basic_map *bmap,
+	__isl_keep isl_basic_set *dom,
+	int (*fn)(__isl_take isl_basic_set *dom,
+		  __isl_take isl_multi_aff *maff, void *user),
+	void *user)
+{
+	return isl_basic_map_foreach_partial_lexopt_multi_aff(bmap, dom, 0,
+								fn, user);
+}
+
+int isl_basic_map_foreach_partial_lexmax(__isl_keep isl_basic_map *bmap,
+	__isl_keep isl_basic_set *dom,
+	int (*fn)(__isl_take isl_basic_set *dom,
+		  __isl_take isl_multi_aff *maff, void *user),
+	void *user)
+{
+	return isl_basic_map_foreach_partial_lexopt_multi_aff(bmap, dom, 1,
+								fn, user);
+}
+
+/* Call "fn" on each piece of the lexicographic minimum (or maximum
+ * if "max" is set) of "bmap" over its entire domain space.
+ */
+static int basic_map_foreach_lexopt_multi_aff(__isl_keep isl_basic_map *bmap,
+	int max,
+	int (*fn)(__isl_take isl_basic_set *dom,
+		  __isl_take isl_multi_aff *maff, void *user),
+	void *user)
+{
+	int r;
+	isl_basic_set *dom;
+
+	if (!bmap)
+		return -1;
+	dom = isl_basic_set_universe(isl_space_domain(isl_space_copy(bmap->dim)));
+	r = isl_basic_map_foreach_partial_lexopt_multi_aff(bmap, dom, max,
+								fn, user);
+	isl_basic_set_free(dom);
+	return r;
+}
+
+int isl_basic_map_foreach_lexmin(__isl_keep isl_basic_map *bmap,
+	int (*fn)(__isl_take isl_basic_set *dom,
+		  __isl_take isl_multi_aff *maff, void *user),
+	void *user)
+{
+	return basic_map_foreach_lexopt_multi_aff(bmap, 0, fn, user);
+}
+
+int isl_basic_map_foreach_lexmax(__isl_keep isl_basic_map *bmap,
+	int (*fn)(__isl_take isl_basic_set *dom,
+		  __isl_take isl_multi_aff *maff, void *user),
+	void *user)
+{
+	return basic_map_foreach_lexopt_multi_aff(bmap, 1, fn, user);
+}
+
 __isl_give isl_pw_multi_aff *isl_basic_map_lexopt_pw_multi_aff(
 	__isl_take isl_basic_map *bmap, int max)
 {
@@ -6147,24 +6592,47 @@ __isl_give isl_pw_multi_aff *isl_basic_map_lexmin_pw_multi_aff(
 #define ADD	isl_pw_multi_aff_union_add
 #include "isl_map_lexopt_templ.c"
 
+/* Combine the partial lexicographic optima "res1" and "res2",
+ * computed on the same domain, with corresponding subsets "todo1" and
+ * "todo2" of the domain without a solution, into a single partial
+ * lexicographic optimum.  Store the subset of the domain without
+ * a solution in *todo.
+ */
+static __isl_give isl_pw_multi_aff *combine_partial_lexopt_pw_multi_aff(
+	__isl_take isl_pw_multi_aff *res1, __isl_take isl_set *todo1,
+	__isl_take isl_pw_multi_aff *res2, __isl_take isl_set *todo2,
+	__isl_give isl_set **todo, int max)
+{
+	*todo = isl_set_intersect(todo1, todo2);
+	if (max)
+		return isl_pw_multi_aff_union_lexmax(res1, res2);
+	else
+		return isl_pw_multi_aff_union_lexmin(res1, res2);
+}
+
 /* Given a map "map", compute the lexicographically minimal
  * (or maximal) image element for each domain element in dom,
  * in the form of an isl_pw_multi_aff.
  * Set *empty to those elements in dom that do not have an image element.
  *
  * We first compute the lexicographically minimal or maximal element
- * in the first basic map.  This results in a partial solution "res"
- * and a subset "todo" of dom that still need to be handled.
- * We then consider each of the remaining maps in "map" and successively
- * update both "res" and "todo".
+ * in each of the basic maps, possibly in worker threads
+ * (see partial_lexopt_disjuncts).
+ * This results in partial solutions res[i]
+ * and subsets todo[i] of dom that still need to be handled.
+ * These are then combined pairwise in a tournament, i.e.,
+ * in each round, the results for consecutive groups of basic maps
+ * are combined two by two, such that each of the intermediate results
+ * is only involved in a logarithmic number of combinations.
  */
 static __isl_give isl_pw_multi_aff *isl_map_partial_lexopt_aligned_pw_multi_aff(
 	__isl_take isl_map *map, __isl_take isl_set *dom,
 	__isl_give isl_set **empty, int max)
 {
-	int i;
-	isl_pw_multi_aff *res;
-	isl_set *todo;
+	int i, step;
+	isl_pw_multi_aff **res = NULL;
+	isl_set **todo = NULL;
+	isl_pw_multi_aff *pma;
 
 	if (!map || !dom)
 		goto error;
@@ -6177,36 +6645,35 @@ static __isl_give isl_pw_multi_aff *isl_map_partial_lexopt_aligned_pw_multi_aff(
 		return isl_pw_multi_aff_from_map(map);
 	}
 
-	res = basic_map_partial_lexopt_pw_multi_aff(
-					    isl_basic_map_copy(map->p[0]),
-					    isl_set_copy(dom), &todo, max);
-
-	for (i = 1; i < map->n; ++i) {
-		isl_pw_multi_aff *res_i;
-		isl_set *todo_i;
+	res = isl_alloc_array(map->ctx, isl_pw_multi_aff *, map->n);
+	todo = isl_alloc_array(map->ctx, isl_set *, map->n);
+	if (!res || !todo)
+		goto error;
 
-		res_i = basic_map_partial_lexopt_pw_multi_aff(
-					    isl_basic_map_copy(map->p[i]),
-					    isl_set_copy(dom), &todo_i, max);
+	if (partial_lexopt_disjuncts_pw_multi_aff(map, dom, max, res, todo) < 0)
+		goto error;
 
-		if (max)
-			res = isl_pw_multi_aff_union_lexmax(res, res_i);
-		else
-			res = isl_pw_multi_aff_union_lexmin(res, res_i);
+	for (step = 1; step < map->n; step *= 2)
+		for (i = 0; i + step < map->n; i += 2 * step)
+			res[i] = combine_partial_lexopt_pw_multi_aff(res[i],
+				    todo[i], res[i + step], todo[i + step],
+				    &todo[i], max);
 
-		todo = isl_set_intersect(todo, todo_i);
-	}
+	pma = res[0];
+	if (empty)
+		*empty = todo[0];
+	else
+		isl_set_free(todo[0]);
 
+	free(res);
+	free(todo);
 	isl_set_free(dom);
 	isl_map_free(map);
 
-	if (empty)
-		*empty = todo;
-	else
-		isl_set_free(todo);
-
-	return res;
+	return pma;
 error:
+	free(res);
+	free(todo);
 	if (empty)
 		*empty = NULL;
 	isl_set_free(dom);
@@ -6224,66 +6691,106 @@ error:
 #define ADD	isl_map_union_disjoint
 #include "isl_map_lexopt_templ.c"
 
-/* Given a map "map", compute the lexicographically minimal
- * (or maximal) image element for each domain element in dom.
- * Set *empty to those elements in dom that do not have an image element.
+/* Combine the partial lexicographic optima "res1" and "res2",
+ * computed on the same domain, with corresponding subsets "todo1" and
+ * "todo2" of the domain without a solution, into a single partial
+ * lexicographic optimum.  Store the subset of the domain without
+ * a solution in *todo.
  *
- * We first compute the lexicographically minimal or maximal element
- * in the first basic map.  This results in a partial solution "res"
- * and a subset "todo" of dom that still need to be handled.
- * We then consider each of the remaining maps in "map" and successively
- * update both "res" and "todo".
- *
- * Let res^k and todo^k be the results after k steps and let i = k + 1.
  * Assume we are computing the lexicographical maximum.
- * We first compute the lexicographically maximal element in basic map i.
- * This results in a partial solution res_i and a subset todo_i.
- * Then we combine these results with those obtain for the first k basic maps
- * to obtain a result that is valid for the first k+1 basic maps.
- * In particular, the set where there is no solution is the set where
- * there is no solution for the first k basic maps and also no solution
- * for the ith basic map, i.e.,
- *
- *	todo^i = todo^k * todo_i
- *
- * On dom(res^k) * dom(res_i), we need to pick the larger of the two
- * solutions, arbitrarily breaking ties in favor of res^k.
- * That is, when res^k(a) >= res_i(a), we pick res^k and
- * when res^k(a) < res_i(a), we pick res_i.  (Here, ">=" and "<" denote
+ * The set where there is no solution is the set where
+ * there is no solution for either of the two partial results, i.e.,
+ *
+ *	todo = todo1 * todo2
+ *
+ * On dom(res1) * dom(res2), we need to pick the larger of the two
+ * solutions, arbitrarily breaking ties in favor of res1.
+ * That is, when res1(a) >= res2(a), we pick res1 and
+ * when res1(a) < res2(a), we pick res2.  (Here, ">=" and "<" denote
  * the lexicographic order.)
  * In practice, we compute
  *
- *	res^k * (res_i . "<=")
+ *	res1 * (res2 . "<=")
  *
  * and
  *
- *	res_i * (res^k . "<")
+ *	res2 * (res1 . "<")
  *
- * Finally, we consider the symmetric difference of dom(res^k) and dom(res_i),
- * where only one of res^k and res_i provides a solution and we simply pick
+ * Finally, we consider the symmetric difference of dom(res1) and dom(res2),
+ * where only one of res1 and res2 provides a solution and we simply pick
  * that one, i.e.,
  *
- *	res^k * todo_i
+ *	res1 * todo2
  * and
- *	res_i * todo^k
+ *	res2 * todo1
  *
- * Note that we only compute these intersections when dom(res^k) intersects
- * dom(res_i).  Otherwise, the only effect of these intersections is to
- * potentially break up res^k and res_i into smaller pieces.
+ * Note that we only compute these intersections when dom(res1) intersects
+ * dom(res2).  Otherwise, the only effect of these intersections is to
+ * potentially break up res1 and res2 into smaller pieces.
  * We want to avoid such splintering as much as possible.
  * In fact, an earlier implementation of this function would look for
- * better results in the domain of res^k and for extra results in todo^k,
- * but this would always result in a splintering according to todo^k,
- * even when the domain of basic map i is disjoint from the domains of
- * the previous basic maps.
+ * better results in the domain of res1 and for extra results in todo1,
+ * but this would always result in a splintering according to todo1,
+ * even when the domain of res2 is disjoint from the domain of res1.
+ */
+static __isl_give isl_map *combine_partial_lexopt(__isl_take isl_map *res1,
+	__isl_take isl_set *todo1, __isl_take isl_map *res2,
+	__isl_take isl_set *todo2, __isl_give isl_set **todo, int max)
+{
+	isl_map *lt, *le;
+	isl_space *dim = isl_space_range(isl_map_get_space(res1));
+
+	if (max) {
+		lt = isl_map_lex_lt(isl_space_copy(dim));
+		le = isl_map_lex_le(dim);
+	} else {
+		lt = isl_map_lex_gt(isl_space_copy(dim));
+		le = isl_map_lex_ge(dim);
+	}
+	lt = isl_map_apply_range(isl_map_copy(res1), lt);
+	lt = isl_map_intersect(lt, isl_map_copy(res2));
+	le = isl_map_apply_range(isl_map_copy(res2), le);
+	le = isl_map_intersect(le, isl_map_copy(res1));
+
+	if (!isl_map_is_empty(lt) || !isl_map_is_empty(le)) {
+		res1 = isl_map_intersect_domain(res1, isl_set_copy(todo2));
+		res2 = isl_map_intersect_domain(res2, isl_set_copy(todo1));
+	}
+
+	res1 = isl_map_union_disjoint(res1, res2);
+	res1 = isl_map_union_disjoint(res1, lt);
+	res1 = isl_map_union_disjoint(res1, le);
+
+	*todo = isl_set_intersect(todo1, todo2);
+
+	return res1;
+}
+
+/* Given a map "map", compute the lexicographically minimal
+ * (or maximal) image element for each domain element in dom.
+ * Set *empty to those elements in dom that do not have an image element.
+ *
+ * We first compute the lexicographically minimal or maximal element
+ * in each of the basic maps, possibly in worker threads
+ * (see partial_lexopt_disjuncts).
+ * This results in partial solutions res[i]
+ * and subsets todo[i] of dom that still need to be handled.
+ * These are then combined pairwise in a tournament, i.e.,
+ * in each round, the results for consecutive groups of basic maps
+ * are combined two by two using combine_partial_lexopt.
+ * Compared to successively combining the result for each basic map
+ * with the combined result for all previous basic maps,
+ * the (growing) intermediate results are involved in fewer combinations.
+ * Ties are still broken in favor of earlier basic maps.
  */
 static __isl_give isl_map *isl_map_partial_lexopt_aligned(
 		__isl_take isl_map *map, __isl_take isl_set *dom,
 		__isl_give isl_set **empty, int max)
 {
-	int i;
-	struct isl_map *res;
-	struct isl_set *todo;
+	int i, step;
+	isl_map **res = NULL;
+	isl_set **todo = NULL;
+	isl_map *opt;
 
 	if (!map || !dom)
 		goto error;
@@ -6296,54 +6803,35 @@ static __isl_give isl_map *isl_map_partial_lexopt_aligned(
 		return map;
 	}
 
-	res = basic_map_partial_lexopt(isl_basic_map_copy(map->p[0]),
-					isl_set_copy(dom), &todo, max);
-
-	for (i = 1; i < map->n; ++i) {
-		isl_map *lt, *le;
-		isl_map *res_i;
-		isl_set *todo_i;
-		isl_space *dim = isl_space_range(isl_map_get_space(res));
-
-		res_i = basic_map_partial_lexopt(isl_basic_map_copy(map->p[i]),
-					isl_set_copy(dom), &todo_i, max);
+	res = isl_alloc_array(map->ctx, isl_map *, map->n);
+	todo = isl_alloc_array(map->ctx, isl_set *, map->n);
+	if (!res || !todo)
+		goto error;
 
-		if (max) {
-			lt = isl_map_lex_lt(isl_space_copy(dim));
-			le = isl_map_lex_le(dim);
-		} else {
-			lt = isl_map_lex_gt(isl_space_copy(dim));
-			le = isl_map_lex_ge(dim);
-		}
-		lt = isl_map_apply_range(isl_map_copy(res), lt);
-		lt = isl_map_intersect(lt, isl_map_copy(res_i));
-		le = isl_map_apply_range(isl_map_copy(res_i), le);
-		le = isl_map_intersect(le, isl_map_copy(res));
-
-		if (!isl_map_is_empty(lt) || !isl_map_is_empty(le)) {
-			res = isl_map_intersect_domain(res,
-							isl_set_copy(todo_i));
-			res_i = isl_map_intersect_domain(res_i,
-							isl_set_copy(todo));
-		}
+	if (partial_lexopt_disjuncts(map, dom, max, res, todo) < 0)
+		goto error;
 
-		res = isl_map_union_disjoint(res, res_i);
-		res = isl_map_union_disjoint(res, lt);
-		res = isl_map_union_disjoint(res, le);
+	for (step = 1; step < map->n; step *= 2)
+		for (i = 0; i + step < map->n; i += 2 * step)
+			res[i] = combine_partial_lexopt(res[i], todo[i],
+					res[i + step], todo[i + step],
+					&todo[i], max);
 
-		todo = isl_set_intersect(todo, todo_i);
-	}
+	opt = res[0];
+	if (empty)
+		*empty = todo[0];
+	else
+		isl_set_free(todo[0]);
 
+	free(res);
+	free(todo);
 	isl_set_free(dom);
 	isl_map_free(map);
 
-	if (empty)
-		*empty = todo;
-	else
-		isl_set_free(todo);
-
-	return res;
+	return opt;
 error:
+	free(res);
+	free(todo);
 	if (empty)
 		*empty = NULL;
 	isl_set_free(dom);
@@ -6414,12 +6902,28 @@ __isl_give isl_map *isl_basic_map_lexopt(__isl_take isl_basic_map *bmap, int max
 
 __isl_give isl_map *isl_basic_map_lexmin(__isl_take isl_basic_map *bmap)
 {
-	return isl_basic_map_lexopt(bmap, 0);
+	isl_ctx *ctx = isl_basic_map_get_ctx(bmap);
+	struct isl_profile_node *prof;
+	isl_map *res;
+
+	prof = isl_profile_enter(ctx, "isl_basic_map_lexmin");
+	res = isl_basic_map_lexopt(bmap, 0);
+	isl_profile_leave(ctx, prof);
+
+	return res;
 }
 
 __isl_give isl_map *isl_basic_map_lexmax(__isl_take isl_basic_map *bmap)
 {
-	return isl_basic_map_lexopt(bmap, 1);
+	isl_ctx *ctx = isl_basic_map_get_ctx(bmap);
+	struct isl_profile_node *prof;
+	isl_map *res;
+
+	prof = isl_profile_enter(ctx, "isl_basic_map_lexmax");
+	res = isl_basic_map_lexopt(bmap, 1);
+	isl_profile_leave(ctx, prof);
+
+	return res;
 }
 
 __isl_give isl_set *isl_basic_set_lexmin(__isl_take isl_basic_set *bset)
@@ -6586,13 +7090,17 @@ static struct isl_basic_set *basic_set_parameter_preimage(
 	bset->dim->nparam = 0;
 	bset->dim->n_out = nparam;
 	bset = isl_basic_set_preimage(bset, mat);
-	if (bset) {
-		bset->dim->nparam = bset->dim->n_out;
-		bset->dim->n_out = 0;
-	}
+	if (!bset)
+		return NULL;
+	bset->dim = isl_space_cow(bset->dim);
+	if (!bset->dim)
+		goto error2;
+	bset->dim->nparam = bset->dim->n_out;
+	bset->dim->n_out = 0;
 	return bset;
 error:
 	isl_mat_free(mat);
+error2:
 	isl_basic_set_free(bset);
 	return NULL;
 }
@@ -7463,7 +7971,6 @@ struct isl_basic_set *isl_basic_map_deltas(struct isl_basic_map *bmap)
 	dim = isl_basic_map_n_in(bmap);
 	nparam = isl_basic_map_n_param(bmap);
 	bset = isl_basic_set_from_basic_map(bmap);
-	bset = isl_basic_set_cow(bset);
 	dims = isl_basic_set_get_space(bset);
 	dims = isl_space_add_dims(dims, isl_dim_set, dim);
 	bset = isl_basic_set_extend_space(bset, dims, 0, dim, 0);
@@ -7850,6 +8357,35 @@ int isl_set_is_equal(struct isl_set *set1, struct isl_set *set2)
 	return isl_map_is_equal((struct isl_map *)set1, (struct isl_map *)set2);
 }
 
+/* Check if "bmap1" is a subset of "bmap2", given that both are boxes
+ * (see isl_basic_map_plain_is_box) living in the same space.
+ * The check only involves comparing the bounds on each dimension.
+ */
+static int basic_map_box_is_subset(__isl_keep isl_basic_map *bmap1,
+	__isl_keep isl_basic_map *bmap2)
+{
+	int is_subset;
+	struct isl_map_plain_boxes *box1, *box2;
+
+	box1 = isl_basic_map_plain_box(bmap1);
+	box2 = isl_basic_map_plain_box(bmap2);
+	if (!box1 || !box2)
+		is_subset = -1;
+	else if (isl_map_plain_boxes_is_empty(box1, 0))
+		is_subset = 1;
+	else
+		is_subset = isl_map_plain_boxes_is_subset(box1, 0, box2, 0);
+	isl_map_plain_boxes_free(box1);
+	isl_map_plain_boxes_free(box2);
+
+	return is_subset;
+}
+
+/* Is "bmap1" a subset of "bmap2"?
+ *
+ * If both are boxes living in the same space, then the result
+ * can be obtained by simply comparing their bounds.
+ */
 int isl_basic_map_is_subset(
 		struct isl_basic_map *bmap1, struct isl_basic_map *bmap2)
 {
@@ -7860,6 +8396,11 @@ int isl_basic_map_is_subset(
 	if (!bmap1 || !bmap2)
 		return -1;
 
+	if (isl_space_is_equal(bmap1->dim, bmap2->dim) &&
+	    isl_basic_map_plain_is_box(bmap1) == 1 &&
+	    isl_basic_map_plain_is_box(bmap2) == 1)
+		return basic_map_box_is_subset(bmap1, bmap2);
+
 	map1 = isl_map_from_basic_map(isl_basic_map_copy(bmap1));
 	map2 = isl_map_from_basic_map(isl_basic_map_copy(bmap2));
 
@@ -7956,12 +8497,112 @@ int isl_set_has_equal_space(__isl_keep isl_set *set1, __isl_keep isl_set *set2)
 	return isl_space_is_equal(set1->dim, set2->dim);
 }
 
+/* Is the cached sample point of "bmap" known not to belong to "map"?
+ *
+ * The sample point is only used if it is an integer point
+ * that is still contained in "bmap".
+ * It is projected onto the space of "bmap" by dropping
+ * the values of the existentially quantified variables.
+ * The caller is responsible for checking that all divs of "map" are known.
+ */
+static int sample_is_outside(__isl_keep isl_basic_map *bmap,
+	__isl_keep isl_map *map)
+{
+	int i;
+	unsigned dim;
+	isl_vec *sample;
+	isl_point *pnt;
+	int contains;
+
+	sample = bmap->sample;
+	if (ISL_F_ISSET(bmap, ISL_BASIC_MAP_RATIONAL) || !sample ||
+	    sample->size != 1 + isl_basic_map_total_dim(bmap) ||
+	    !isl_int_is_one(sample->el[0]))
+		return 0;
+	contains = isl_basic_map_contains(bmap, sample);
+	if (contains < 0 || !contains)
+		return contains < 0 ? -1 : 0;
+
+	dim = isl_basic_map_total_dim(bmap) - bmap->n_div;
+	sample = isl_vec_alloc(bmap->ctx, 1 + dim);
+	if (!sample)
+		return -1;
+	isl_seq_cpy(sample->el, bmap->sample->el, 1 + dim);
+	pnt = isl_point_alloc(isl_basic_map_get_space(bmap), sample);
+	if (!pnt)
+		return -1;
+
+	contains = 0;
+	for (i = 0; !contains && i < map->n; ++i)
+		contains = isl_basic_map_contains_point(map->p[i], pnt);
+
+	isl_point_free(pnt);
+	return contains < 0 ? -1 : !contains;
+}
+
+/* Is there any basic map in "map1" with a sample point
+ * that is known not to belong to "map2"?
+ *
+ * This is a cheap necessary condition for "map1" being a subset
+ * of "map2" that only uses the sample points that were cached
+ * by earlier computations.  It is only applied if all divs of "map2"
+ * are known since the containment test would otherwise require
+ * explicit representations to be computed.
+ * A negative answer does not mean that "map1" is a subset of "map2".
+ */
+static int has_sample_outside(__isl_keep isl_map *map1,
+	__isl_keep isl_map *map2)
+{
+	int i;
+	int known;
+
+	known = map_divs_known(map2);
+	if (known < 0 || !known)
+		return known;
+
+	for (i = 0; i < map1->n; ++i) {
+		int outside = sample_is_outside(map1->p[i], map2);
+		if (outside < 0 || outside)
+			return outside;
+	}
+
+	return 0;
+}
+
+/* Is "map1" equal to "map2"?
+ *
+ * First perform some cheap tests that may decide the answer.
+ * In particular, the maps are obviously equal if they are
+ * equal after normalization and they are obviously different
+ * if one of them has a cached sample point that does not belong
+ * to the other.  Otherwise, check that each is a subset of the other.
+ */
 static int map_is_equal(__isl_keep isl_map *map1, __isl_keep isl_map *map2)
 {
 	int is_subset;
+	int outside;
 
 	if (!map1 || !map2)
 		return -1;
+	if (!isl_space_is_equal(map1->dim, map2->dim))
+		return 0;
+	is_subset = isl_map_plain_is_equal(map1, map2);
+	if (is_subset < 0)
+		return -1;
+	if (is_subset) {
+		map1->ctx->stats->equal_fast_hits++;
+		return 1;
+	}
+	outside = has_sample_outside(map1, map2);
+	if (outside >= 0 && !outside)
+		outside = has_sample_outside(map2, map1);
+	if (outside < 0)
+		return -1;
+	if (outside) {
+		map1->ctx->stats->equal_fast_hits++;
+		return 0;
+	}
+	map1->ctx->stats->equal_fast_misses++;
 	is_subset = isl_map_is_subset(map1, map2);
 	if (is_subset != 1)
 		return is_subset;
@@ -8050,6 +8691,196 @@ int isl_set_fast_is_universe(__isl_keep isl_set *set)
 	return isl_set_plain_is_universe(set);
 }
 
+/* Lower ("bound[0]") and upper ("bound[1]") bounds on the "n" variables
+ * of a basic map, derived through bound propagation.
+ * "has[0][i]" ("has[1][i]") is set if a lower (upper) bound
+ * on variable i is known.
+ * "empty" is set if the bounds are known to be inconsistent.
+ * "changed" is set if any bound was updated during the current round.
+ */
+struct isl_bound_prop {
+	unsigned n;
+	isl_vec *bound[2];
+	char *has[2];
+	int empty;
+	int changed;
+};
+
+/* Update the lower (if "upper" is not set) or upper (if "upper" is set)
+ * bound on variable "pos" in "bp" with the bound "num"/"den", where
+ * "den" is non-zero, rounding it to the appropriate integer.
+ */
+static void bound_prop_update(struct isl_bound_prop *bp, int pos, int upper,
+	isl_int num, isl_int den, isl_int t)
+{
+	if (upper)
+		isl_int_fdiv_q(t, num, den);
+	else
+		isl_int_cdiv_q(t, num, den);
+	if (bp->has[upper][pos]) {
+		int cmp = isl_int_cmp(t, bp->bound[upper]->el[pos]);
+		if (upper ? cmp >= 0 : cmp <= 0)
+			return;
+	}
+	isl_int_set(bp->bound[upper]->el[pos], t);
+	bp->has[upper][pos] = 1;
+	bp->changed = 1;
+	if (bp->has[!upper][pos] &&
+	    isl_int_gt(bp->bound[0]->el[pos], bp->bound[1]->el[pos]))
+		bp->empty = 1;
+}
+
+/* Use the inequality constraint "c" to tighten the bounds in "bp".
+ * Let u be the maximal value of "c" over the current bounds.
+ * If u is negative, then the constraint cannot be satisfied.
+ * Otherwise, for each variable x_p with non-zero coefficient a_p,
+ * the maximal value of the other terms is u - max(a_p x_p) and
+ * a_p x_p >= max(a_p x_p) - u.
+ * This maximal value is only available if at most one of
+ * the terms of "c" is unbounded and in the latter case,
+ * only the variable with the unbounded term can be bounded.
+ */
+static void bound_prop_ineq(struct isl_bound_prop *bp, isl_int *c,
+	isl_int max, isl_int t, isl_int num)
+{
+	int i;
+	int n_inf = 0, inf = -1;
+
+	isl_int_set(max, c[0]);
+	for (i = 0; i < bp->n; ++i) {
+		int upper;
+
+		if (isl_int_is_zero(c[1 + i]))
+			continue;
+		upper = isl_int_is_pos(c[1 + i]);
+		if (!bp->has[upper][i]) {
+			if (n_inf++)
+				return;
+			inf = i;
+			continue;
+		}
+		isl_int_addmul(max, c[1 + i], bp->bound[upper]->el[i]);
+	}
+
+	if (n_inf == 0 && isl_int_is_neg(max)) {
+		bp->empty = 1;
+		return;
+	}
+
+	for (i = 0; i < bp->n; ++i) {
+		int pos;
+
+		if (isl_int_is_zero(c[1 + i]))
+			continue;
+		if (n_inf && i != inf)
+			continue;
+		pos = isl_int_is_pos(c[1 + i]);
+		if (n_inf)
+			isl_int_neg(num, max);
+		else {
+			isl_int_mul(num, c[1 + i], bp->bound[pos]->el[i]);
+			isl_int_sub(num, num, max);
+		}
+		bound_prop_update(bp, i, !pos, num, c[1 + i], t);
+		if (bp->empty)
+			return;
+	}
+}
+
+/* Perform a few rounds of bound propagation on the constraints of "bmap",
+ * with each equality treated as a pair of inequalities.
+ */
+static void bound_prop_run(struct isl_bound_prop *bp,
+	__isl_keep isl_basic_map *bmap, isl_int *neg)
+{
+	int i, round;
+	isl_int max, t, num;
+	const int max_rounds = 4;
+
+	isl_int_init(max);
+	isl_int_init(t);
+	isl_int_init(num);
+	for (round = 0; round < max_rounds; ++round) {
+		bp->changed = 0;
+		for (i = 0; !bp->empty && i < bmap->n_eq; ++i) {
+			bound_prop_ineq(bp, bmap->eq[i], max, t, num);
+			isl_seq_neg(neg, bmap->eq[i], 1 + bp->n);
+			if (!bp->empty)
+				bound_prop_ineq(bp, neg, max, t, num);
+		}
+		for (i = 0; !bp->empty && i < bmap->n_ineq; ++i)
+			bound_prop_ineq(bp, bmap->ineq[i], max, t, num);
+		if (bp->empty || !bp->changed)
+			break;
+	}
+	isl_int_clear(max);
+	isl_int_clear(t);
+	isl_int_clear(num);
+}
+
+/* Try and decide the (integer) emptiness of "bmap" without
+ * constructing a tableau.
+ * Bounds on the variables are derived through bound propagation.
+ * If these bounds are inconsistent, then "bmap" is empty.
+ * Otherwise, the point with each variable set to the value closest
+ * to zero within its bounds is checked for being an element of "bmap".
+ * If so, it is stored in *sample.
+ *
+ * Return 1 if "bmap" is known to be empty, 0 if a sample point
+ * was found, 2 if the emptiness could not be decided and -1 on error.
+ */
+static int basic_map_bound_prop_is_empty(__isl_keep isl_basic_map *bmap,
+	__isl_give isl_vec **sample)
+{
+	int i;
+	isl_ctx *ctx;
+	struct isl_bound_prop bp;
+	isl_vec *point;
+	int res = -1;
+
+	ctx = isl_basic_map_get_ctx(bmap);
+	bp.n = isl_basic_map_total_dim(bmap);
+	bp.empty = 0;
+	bp.bound[0] = isl_vec_alloc(ctx, bp.n);
+	bp.bound[1] = isl_vec_alloc(ctx, bp.n);
+	bp.has[0] = isl_calloc_array(ctx, char, bp.n);
+	bp.has[1] = isl_calloc_array(ctx, char, bp.n);
+	point = isl_vec_alloc(ctx, 1 + bp.n);
+	if (!bp.bound[0] || !bp.bound[1] || !point ||
+	    (bp.n && (!bp.has[0] || !bp.has[1])))
+		goto done;
+
+	bound_prop_run(&bp, bmap, point->el);
+	if (bp.empty) {
+		res = 1;
+		goto done;
+	}
+
+	isl_int_set_si(point->el[0], 1);
+	for (i = 0; i < bp.n; ++i) {
+		if (bp.has[0][i] && isl_int_is_pos(bp.bound[0]->el[i]))
+			isl_int_set(point->el[1 + i], bp.bound[0]->el[i]);
+		else if (bp.has[1][i] && isl_int_is_neg(bp.bound[1]->el[i]))
+			isl_int_set(point->el[1 + i], bp.bound[1]->el[i]);
+		else
+			isl_int_set_si(point->el[1 + i], 0);
+	}
+	res = isl_basic_map_contains(bmap, point);
+	if (res == 1) {
+		*sample = point;
+		point = NULL;
+		res = 0;
+	} else if (res == 0)
+		res = 2;
+done:
+	isl_vec_free(point);
+	isl_vec_free(bp.bound[0]);
+	isl_vec_free(bp.bound[1]);
+	free(bp.has[0]);
+	free(bp.has[1]);
+	return res;
+}
+
 int isl_basic_map_is_empty(struct isl_basic_map *bmap)
 {
 	struct isl_basic_set *bset = NULL;
@@ -8084,6 +8915,16 @@ int isl_basic_map_is_empty(struct isl_basic_map *bmap)
 	}
 	isl_vec_free(bmap->sample);
 	bmap->sample = NULL;
+	empty = basic_map_bound_prop_is_empty(bmap, &bmap->sample);
+	if (empty < 0)
+		return -1;
+	if (empty != 2) {
+		bmap->ctx->stats->bound_prop_hits++;
+		if (empty)
+			ISL_F_SET(bmap, ISL_BASIC_MAP_EMPTY);
+		return empty;
+	}
+	bmap->ctx->stats->bound_prop_misses++;
 	bset = isl_basic_map_underlying_set(isl_basic_map_copy(bmap));
 	if (!bset)
 		return -1;
@@ -8314,7 +9155,6 @@ __isl_give isl_basic_map *isl_basic_map_align_divs(
 		if (j < 0) {
 			if (!extended) {
 				int extra = src->n_div - i;
-				dst = isl_basic_map_cow(dst);
 				if (!dst)
 					return NULL;
 				dst = isl_basic_map_extend_space(dst,
@@ -8549,7 +9389,6 @@ static enum isl_lp_result basic_set_maximal_difference_at(
 	bmap2 = isl_basic_map_from_basic_set(isl_basic_set_copy(bset2), dims);
 	if (!bmap1 || !bmap2)
 		goto error;
-	bmap1 = isl_basic_map_cow(bmap1);
 	bmap1 = isl_basic_map_extend(bmap1, nparam,
 			pos, (dim1 - pos) + (dim2 - pos),
 			bmap2->n_div, bmap2->n_eq, bmap2->n_ineq);
@@ -8965,22 +9804,26 @@ int isl_set_plain_dim_has_fixed_lower_bound(__isl_keep isl_set *set,
 /* uset_gist depends on constraints without existentially quantified
  * variables sorting first.
  */
-static int sort_constraint_cmp(const void *p1, const void *p2, void *arg)
+static int sort_constraint_cmp(isl_int *c1, isl_int *c2, unsigned size)
 {
-	isl_int **c1 = (isl_int **) p1;
-	isl_int **c2 = (isl_int **) p2;
 	int l1, l2;
-	unsigned size = *(unsigned *) arg;
 
-	l1 = isl_seq_last_non_zero(*c1 + 1, size);
-	l2 = isl_seq_last_non_zero(*c2 + 1, size);
+	l1 = isl_seq_last_non_zero(c1 + 1, size);
+	l2 = isl_seq_last_non_zero(c2 + 1, size);
 
 	if (l1 != l2)
 		return l1 - l2;
 
-	return isl_seq_cmp(*c1 + 1, *c2 + 1, size);
+	return isl_seq_cmp(c1 + 1, c2 + 1, size);
 }
 
+#define SORT_FN		sort_constraints
+#define SORT_EL		isl_int *
+#define SORT_ARG	unsigned
+#define SORT_CMP(c1, c2, size)	sort_constraint_cmp(*(c1), *(c2), size)
+
+#include <isl_sort_templ.c>
+
 static struct isl_basic_map *isl_basic_map_sort_constraints(
 	struct isl_basic_map *bmap)
 {
@@ -8993,8 +9836,7 @@ static struct isl_basic_map *isl_basic_map_sort_constraints(
 	if (ISL_F_ISSET(bmap, ISL_BASIC_MAP_NORMALIZED))
 		return bmap;
 	total = isl_basic_map_total_dim(bmap);
-	if (isl_sort(bmap->ineq, bmap->n_ineq, sizeof(isl_int *),
-		    &sort_constraint_cmp, &total) < 0)
+	if (sort_constraints(bmap->ineq, bmap->n_ineq, total) < 0)
 		return isl_basic_map_free(bmap);
 	return bmap;
 }
@@ -9111,36 +9953,139 @@ int isl_basic_set_plain_is_equal(__isl_keep isl_basic_set *bset1,
 					    (isl_basic_map *)bset2);
 }
 
-static int qsort_bmap_cmp(const void *p1, const void *p2)
+/* A basic map along with some precomputed information about it,
+ * used when sorting the basic maps of a map.
+ * "rational", "empty", "n_eq", "n_ineq" and "n_div" are the properties
+ * that isl_basic_map_plain_cmp looks at before comparing constraints.
+ * "hash" is a hash of the plain representation of the basic map.
+ */
+struct isl_basic_map_sort_key {
+	int rational;
+	int empty;
+	int n_eq;
+	int n_ineq;
+	int n_div;
+	uint32_t hash;
+	isl_basic_map *bmap;
+};
+
+/* Return a hash of the plain representation of "bmap" that is
+ * compatible with isl_basic_map_plain_cmp, i.e., basic maps that
+ * compare equal are assigned the same hash value.
+ * In particular, all empty basic maps are assigned the same hash value.
+ */
+static uint32_t basic_map_plain_hash(__isl_keep isl_basic_map *bmap)
 {
-	const struct isl_basic_map *bmap1 = *(const struct isl_basic_map **)p1;
-	const struct isl_basic_map *bmap2 = *(const struct isl_basic_map **)p2;
+	int i;
+	uint32_t hash = isl_hash_init();
+	unsigned total;
 
-	return isl_basic_map_plain_cmp(bmap1, bmap2);
+	isl_hash_byte(hash, ISL_F_ISSET(bmap, ISL_BASIC_MAP_RATIONAL) ? 1 : 0);
+	if (ISL_F_ISSET(bmap, ISL_BASIC_MAP_EMPTY))
+		return hash;
+	total = isl_basic_map_total_dim(bmap);
+	isl_hash_byte(hash, bmap->n_eq & 0xFF);
+	for (i = 0; i < bmap->n_eq; ++i)
+		isl_hash_hash(hash, isl_seq_get_hash(bmap->eq[i], 1 + total));
+	isl_hash_byte(hash, bmap->n_ineq & 0xFF);
+	for (i = 0; i < bmap->n_ineq; ++i)
+		isl_hash_hash(hash, isl_seq_get_hash(bmap->ineq[i], 1 + total));
+	isl_hash_byte(hash, bmap->n_div & 0xFF);
+	for (i = 0; i < bmap->n_div; ++i)
+		isl_hash_hash(hash, isl_seq_get_hash(bmap->div[i], 1 + 1 + total));
+	return hash;
 }
 
+/* Compare the basic maps in "key1" and "key2" in the same way
+ * as isl_basic_map_plain_cmp, given that they live in the same space.
+ * The precomputed properties are compared first and only
+ * if they are all the same are the constraints themselves compared.
+ */
+static int sort_key_cmp(const struct isl_basic_map_sort_key *key1,
+	const struct isl_basic_map_sort_key *key2)
+{
+	if (key1->rational != key2->rational)
+		return key1->rational ? -1 : 1;
+	if (key1->empty && key2->empty)
+		return 0;
+	if (key1->empty != key2->empty)
+		return key1->empty ? 1 : -1;
+	if (key1->n_eq != key2->n_eq)
+		return key1->n_eq - key2->n_eq;
+	if (key1->n_ineq != key2->n_ineq)
+		return key1->n_ineq - key2->n_ineq;
+	if (key1->n_div != key2->n_div)
+		return key1->n_div - key2->n_div;
+	return isl_basic_map_plain_cmp(key1->bmap, key2->bmap);
+}
+
+#define SORT_FN		sort_basic_maps
+#define SORT_EL		struct isl_basic_map_sort_key
+#define SORT_ARG	void *
+#define SORT_CMP(key1, key2, arg) sort_key_cmp(key1, key2)
+
+#include <isl_sort_templ.c>
+
 /* Sort the basic maps of "map" and remove duplicate basic maps.
  *
  * While removing basic maps, we make sure that the basic maps remain
  * sorted because isl_map_normalize expects the basic maps of the result
  * to be sorted.
+ * The properties of the basic maps that are compared before
+ * their constraints are collected once for each basic map
+ * in an array of sort keys, such that most comparisons performed
+ * by the sort do not need to access the basic maps themselves.
+ * The order itself is that of isl_basic_map_plain_cmp since
+ * it determines the order in which disjuncts end up being printed.
+ * A hash of the constraints is also computed for each basic map
+ * such that checking whether adjacent basic maps are identical
+ * only needs to walk their constraints if the hashes are the same.
+ * Since duplicates are adjacent after sorting, they are removed
+ * in a single pass that compacts the remaining basic maps,
+ * rather than by shifting the tail of the array for each duplicate.
+ * This matters for maps with many (identical) disjuncts,
+ * e.g., those produced by subtraction.
  */
 static __isl_give isl_map *sort_and_remove_duplicates(__isl_take isl_map *map)
 {
-	int i, j;
+	int i, n;
+	struct isl_basic_map_sort_key *keys;
 
 	map = isl_map_remove_empty_parts(map);
 	if (!map)
 		return NULL;
-	qsort(map->p, map->n, sizeof(struct isl_basic_map *), qsort_bmap_cmp);
-	for (i = map->n - 1; i >= 1; --i) {
-		if (!isl_basic_map_plain_is_equal(map->p[i - 1], map->p[i]))
+	if (map->n <= 1)
+		return map;
+	keys = isl_alloc_array(map->ctx, struct isl_basic_map_sort_key, map->n);
+	if (!keys)
+		return isl_map_free(map);
+	for (i = 0; i < map->n; ++i) {
+		isl_basic_map *bmap = map->p[i];
+
+		keys[i].rational = ISL_F_ISSET(bmap, ISL_BASIC_MAP_RATIONAL);
+		keys[i].empty = ISL_F_ISSET(bmap, ISL_BASIC_MAP_EMPTY);
+		keys[i].n_eq = bmap->n_eq;
+		keys[i].n_ineq = bmap->n_ineq;
+		keys[i].n_div = bmap->n_div;
+		keys[i].hash = basic_map_plain_hash(bmap);
+		keys[i].bmap = bmap;
+	}
+	if (sort_basic_maps(keys, map->n, NULL) < 0) {
+		free(keys);
+		return isl_map_free(map);
+	}
+	map->p[0] = keys[0].bmap;
+	n = 1;
+	for (i = 1; i < map->n; ++i) {
+		if (keys[i].hash == keys[i - 1].hash &&
+		    isl_basic_map_plain_is_equal(map->p[n - 1], keys[i].bmap)) {
+			isl_basic_map_free(keys[i].bmap);
 			continue;
-		isl_basic_map_free(map->p[i-1]);
-		for (j = i; j < map->n; ++j)
-			map->p[j - 1] = map->p[j];
-		map->n--;
+		}
+		map->p[n++] = keys[i].bmap;
 	}
+	map->n = n;
+	free(keys);
 
 	return map;
 }
@@ -9182,6 +10127,13 @@ __isl_give isl_map *isl_map_remove_obvious_duplicates(__isl_take isl_map *map)
 /* We normalize in place, but if anything goes wrong we need
  * to return NULL, so we need to make sure we don't change the
  * meaning of any possible other copies of map.
+ *
+ * The basic maps are normalized in the calling thread.
+ * Normalizing a basic map that has already been simplified
+ * when it was finalized takes about twice as long as importing it
+ * into another isl_ctx, so a worker thread (see isl_thread_run) would
+ * spend as much time importing the basic map and its result
+ * under the lock of the pool as it would save.
  */
 __isl_give isl_map *isl_map_normalize(__isl_take isl_map *map)
 {
@@ -9840,6 +10792,31 @@ uint32_t isl_set_get_hash(__isl_keep isl_set *set)
 	return isl_map_get_hash((isl_map *)set);
 }
 
+/* Return a fingerprint of "map", i.e., a hash value that depends
+ * on both the space of "map" and its (normalized) disjuncts.
+ * Since the disjuncts are sorted by isl_map_normalize,
+ * the result does not depend on the order in which they appear in "map".
+ * Maps that are plainly equal therefore have the same fingerprint.
+ */
+uint32_t isl_map_get_fingerprint(__isl_keep isl_map *map)
+{
+	uint32_t hash;
+
+	if (!map)
+		return 0;
+
+	hash = isl_hash_init();
+	isl_hash_hash(hash, isl_space_get_hash(map->dim));
+	isl_hash_hash(hash, isl_map_get_hash(map));
+
+	return hash;
+}
+
+uint32_t isl_set_get_fingerprint(__isl_keep isl_set *set)
+{
+	return isl_map_get_fingerprint((isl_map *)set);
+}
+
 /* Check if the value for dimension dim is completely determined
  * by the values of the other parameters and variables.
  * That is, check if dimension dim is involved in an equality.
@@ -9920,6 +10897,32 @@ int isl_set_foreach_basic_set(__isl_keep isl_set *set,
 	return 0;
 }
 
+/* Call "fn" on each basic map of "map", without passing
+ * ownership of the basic map to "fn".
+ * "fn" is not allowed to modify or free the basic map.
+ */
+int isl_map_foreach_basic_map_peek(__isl_keep isl_map *map,
+	int (*fn)(__isl_keep isl_basic_map *bmap, void *user), void *user)
+{
+	int i;
+
+	if (!map)
+		return -1;
+
+	for (i = 0; i < map->n; ++i)
+		if (fn(map->p[i], user) < 0)
+			return -1;
+
+	return 0;
+}
+
+int isl_set_foreach_basic_set_peek(__isl_keep isl_set *set,
+	int (*fn)(__isl_keep isl_basic_set *bset, void *user), void *user)
+{
+	return isl_map_foreach_basic_map_peek(set,
+		(int (*)(__isl_keep isl_basic_map *, void *)) fn, user);
+}
+
 __isl_give isl_basic_set *isl_basic_set_lift(__isl_take isl_basic_set *bset)
 {
 	isl_space *dim;
@@ -10254,7 +11257,7 @@ int isl_basic_set_vars_get_sign(__isl_keep isl_basic_set *bset,
 		return -1;
 
 	bound = isl_vec_alloc(bset->ctx, 1 + isl_basic_set_total_dim(bset));
-	tab = isl_tab_from_basic_set(bset, 0);
+	tab = isl_tab_lean_from_basic_set(bset);
 	if (!bound || !tab)
 		goto error;
 
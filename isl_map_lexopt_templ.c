@@ -72,6 +72,120 @@ error:
 	return NULL;
 }
 
+#ifdef HAVE_PTHREAD
+
+/* Data used by the workers of partial_lexopt_threads.
+ * "map" and "dom" are the input of partial_lexopt_disjuncts and
+ * "max" is set if the lexicographic maximum should be computed.
+ * "res" and "todo" collect the results for the basic maps of "map".
+ */
+struct SF(isl_partial_lexopt_threads,SUFFIX) {
+	isl_map *map;
+	isl_set *dom;
+	int max;
+	TYPE **res;
+	isl_set **todo;
+};
+
+/* Compute the partial lexicographic optimum of basic map "i"
+ * of data->map over data->dom in the isl_ctx of "worker" and
+ * store the result and the subset of data->dom without a solution
+ * in data->res[i] and data->todo[i], in the isl_ctx of data->map.
+ * The input is imported into the worker isl_ctx and
+ * the results are imported back while holding the lock of the pool.
+ */
+static int SF(partial_lexopt_disjunct,SUFFIX)(
+	struct isl_thread_worker *worker, int i, void *user)
+{
+	struct SF(isl_partial_lexopt_threads,SUFFIX) *data = user;
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	isl_ctx *parent = data->map->ctx;
+	isl_basic_map *bmap;
+	isl_set *dom, *todo;
+	TYPE *res;
+
+	isl_thread_worker_lock(worker);
+	bmap = isl_basic_map_import(ctx, data->map->p[i]);
+	dom = isl_set_import(ctx, data->dom);
+	isl_thread_worker_unlock(worker);
+
+	res = SF(basic_map_partial_lexopt,SUFFIX)(bmap, dom, &todo, data->max);
+
+	isl_thread_worker_lock(worker);
+	data->res[i] = SF(TYPE,_import)(parent, res);
+	data->todo[i] = isl_set_import(parent, todo);
+	isl_thread_worker_unlock(worker);
+
+	SF(TYPE,_free)(res);
+	isl_set_free(todo);
+
+	if (!data->res[i] || !data->todo[i])
+		return -1;
+	return 0;
+}
+
+/* Compute the partial lexicographic optima of the basic maps
+ * of "map" over "dom" as in partial_lexopt_disjuncts,
+ * using several worker threads.
+ * Each basic map is handled by a single worker, in its own isl_ctx.
+ * If anything goes wrong, then all results that have been
+ * computed are freed again.
+ */
+static int SF(partial_lexopt_threads,SUFFIX)(__isl_keep isl_map *map,
+	__isl_keep isl_set *dom, int max, TYPE **res, isl_set **todo)
+{
+	int i;
+	struct SF(isl_partial_lexopt_threads,SUFFIX) data =
+		{ map, dom, max, res, todo };
+
+	for (i = 0; i < map->n; ++i) {
+		res[i] = NULL;
+		todo[i] = NULL;
+	}
+	if (isl_thread_run(map->ctx, map->n,
+			&SF(partial_lexopt_disjunct,SUFFIX), &data) >= 0)
+		return 0;
+
+	for (i = 0; i < map->n; ++i) {
+		SF(TYPE,_free)(res[i]);
+		isl_set_free(todo[i]);
+	}
+	return -1;
+}
+
+#endif
+
+/* Compute the lexicographically minimal (or maximal) image element
+ * over "dom" of each basic map of "map", storing the partial solution
+ * for basic map "i" in res[i] and the subset of "dom" where it
+ * does not have an image element in todo[i].
+ *
+ * The basic maps are independent of each other, so if
+ * the threads option is set to more than one thread,
+ * then they are handled in worker threads (see partial_lexopt_threads).
+ * Return -1 if the worker threads could not complete
+ * the computation, in which case no results are stored.
+ * Otherwise, any error is reported through a NULL result.
+ */
+static int SF(partial_lexopt_disjuncts,SUFFIX)(__isl_keep isl_map *map,
+	__isl_keep isl_set *dom, int max, TYPE **res, isl_set **todo)
+{
+	int i;
+
+#ifdef HAVE_PTHREAD
+	if (map->ctx->opt->threads > 1 && map->n > 1)
+		return SF(partial_lexopt_threads,SUFFIX)(map, dom, max,
+							res, todo);
+#endif
+
+	for (i = 0; i < map->n; ++i)
+		res[i] = SF(basic_map_partial_lexopt,SUFFIX)(
+					isl_basic_map_copy(map->p[i]),
+					isl_set_copy(dom), &todo[i], max);
+
+	return 0;
+}
+
 static __isl_give TYPE *SF(isl_map_partial_lexopt_aligned,SUFFIX)(
 	__isl_take isl_map *map, __isl_take isl_set *dom,
 	__isl_give isl_set **empty, int max);
@@ -108,14 +222,21 @@ error:
 
 __isl_give TYPE *SF(isl_map_lexopt,SUFFIX)(__isl_take isl_map *map, int max)
 {
+	isl_ctx *ctx;
 	isl_set *dom = NULL;
 	isl_space *dom_space;
+	struct isl_profile_node *prof;
+	TYPE *res;
 
 	if (!map)
 		goto error;
+	ctx = isl_map_get_ctx(map);
+	prof = isl_profile_enter(ctx, max ? "isl_map_lexmax" : "isl_map_lexmin");
 	dom_space = isl_space_domain(isl_space_copy(map->dim));
 	dom = isl_set_universe(dom_space);
-	return SF(isl_map_partial_lexopt,SUFFIX)(map, dom, NULL, max);
+	res = SF(isl_map_partial_lexopt,SUFFIX)(map, dom, NULL, max);
+	isl_profile_leave(ctx, prof);
+	return res;
 error:
 	isl_map_free(map);
 	return NULL;
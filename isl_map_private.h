@@ -32,6 +32,12 @@ ISL_DECLARE_LIST(map)
  * n_in is the number of in variables
  * n_out is the number of out variables
  * n_in + n_out should be equal to set.dim
+ *
+ * If "hull" is not NULL, then it contains the equalities satisfied
+ * by the integer points of the basic map, expressed in
+ * the underlying set, as computed by isl_basic_map_detect_equalities.
+ * It is shared by all copies of the basic map and is dropped
+ * by isl_basic_map_cow, i.e., whenever the basic map may get modified.
  */
 struct isl_basic_map {
 	int ref;
@@ -70,6 +76,7 @@ struct isl_basic_map {
 	isl_int **div;
 
 	struct isl_vec *sample;
+	struct isl_basic_set *hull;
 
 	struct isl_blk block;
 	struct isl_blk block2;
@@ -172,6 +179,7 @@ int isl_basic_set_free_equality(struct isl_basic_set *bset, unsigned n);
 int isl_basic_set_alloc_inequality(struct isl_basic_set *bset);
 int isl_basic_map_alloc_inequality(struct isl_basic_map *bmap);
 int isl_basic_map_free_inequality(struct isl_basic_map *bmap, unsigned n);
+int isl_basic_map_compact_rows(__isl_keep isl_basic_map *bmap);
 int isl_basic_map_alloc_div(struct isl_basic_map *bmap);
 int isl_basic_set_alloc_div(struct isl_basic_set *bset);
 int isl_basic_map_free_div(struct isl_basic_map *bmap, unsigned n);
@@ -225,6 +233,40 @@ int isl_basic_map_plain_cmp(const __isl_keep isl_basic_map *bmap1,
 	const __isl_keep isl_basic_map *bmap2);
 int isl_basic_map_plain_is_equal(__isl_keep isl_basic_map *bmap1,
 	__isl_keep isl_basic_map *bmap2);
+uint32_t isl_basic_map_get_hash(__isl_keep isl_basic_map *bmap);
+uint32_t isl_basic_set_get_hash(__isl_keep isl_basic_set *bset);
+
+/* Bounds on the parameters and the input and output dimensions
+ * of the basic maps in a map, derived from the constraints
+ * that involve a single such dimension and no divs.
+ *
+ * Row 2 * i of "bound" contains the lower bounds of basic map i and
+ * row 2 * i + 1 the upper bounds.  "finite" has the same layout and
+ * records which of the bounds are actually available.
+ * No bounds are derived for rational basic maps.
+ */
+struct isl_map_plain_boxes {
+	unsigned dim;
+	struct isl_mat *bound;
+	int *finite;
+};
+
+struct isl_map_plain_boxes *isl_map_plain_boxes(__isl_keep isl_map *map);
+struct isl_map_plain_boxes *isl_basic_map_plain_box(
+	__isl_keep isl_basic_map *bmap);
+void *isl_map_plain_boxes_free(struct isl_map_plain_boxes *boxes);
+struct isl_map_plain_boxes *isl_map_plain_boxes_alloc(isl_ctx *ctx,
+	int n, unsigned dim);
+int isl_map_plain_boxes_set_hull(struct isl_map_plain_boxes *boxes, int i,
+	__isl_keep isl_map *map);
+int isl_basic_map_plain_is_box(__isl_keep isl_basic_map *bmap);
+int isl_map_plain_boxes_is_empty(struct isl_map_plain_boxes *boxes, int i);
+int isl_map_plain_boxes_is_disjoint(struct isl_map_plain_boxes *boxes1, int i,
+	struct isl_map_plain_boxes *boxes2, int j);
+int isl_basic_map_plain_is_disjoint(__isl_keep isl_basic_map *bmap1,
+	__isl_keep isl_basic_map *bmap2);
+int isl_map_plain_boxes_is_subset(struct isl_map_plain_boxes *boxes1, int i,
+	struct isl_map_plain_boxes *boxes2, int j);
 struct isl_basic_map *isl_basic_map_normalize_constraints(
 	struct isl_basic_map *bmap);
 struct isl_basic_set *isl_basic_set_normalize_constraints(
@@ -263,6 +305,9 @@ struct isl_map *isl_map_remove_empty_parts(struct isl_map *map);
 struct isl_set *isl_set_remove_empty_parts(struct isl_set *set);
 __isl_give isl_map *isl_map_remove_obvious_duplicates(__isl_take isl_map *map);
 
+__isl_give isl_map *isl_map_intersect_equal_more_at(__isl_take isl_map *map,
+	unsigned pos, int more);
+
 struct isl_set *isl_set_normalize(struct isl_set *set);
 
 struct isl_set *isl_set_drop_vars(
@@ -270,6 +315,8 @@ struct isl_set *isl_set_drop_vars(
 
 struct isl_basic_map *isl_basic_map_eliminate_vars(
 	struct isl_basic_map *bmap, unsigned pos, unsigned n);
+__isl_give isl_basic_map *isl_basic_map_eliminate_selected_vars(
+	__isl_take isl_basic_map *bmap, int *elim);
 struct isl_basic_set *isl_basic_set_eliminate_vars(
 	struct isl_basic_set *bset, unsigned pos, unsigned n);
 
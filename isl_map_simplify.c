@@ -12,6 +12,7 @@
  * B.P. 105 - 78153 Le Chesnay, France
  */
 
+#include <limits.h>
 #include <strings.h>
 #include <isl_ctx_private.h>
 #include <isl_map_private.h>
@@ -19,6 +20,7 @@
 #include <isl/map.h>
 #include <isl_seq.h>
 #include "isl_tab.h"
+#include <isl_gist_private.h>
 #include <isl_space_private.h>
 #include <isl_mat_private.h>
 #include <isl_vec_private.h>
@@ -158,6 +160,10 @@ error:
  * of columns remains constant, but we would have to extend
  * the div array too as the number of rows in this array is assumed
  * to be equal to extra.
+ *
+ * The corresponding coordinates are also removed from the cached
+ * sample point, if any, such that a basic map that was known
+ * to be non-empty does not need to be checked again from scratch.
  */
 struct isl_basic_map *isl_basic_map_drop(struct isl_basic_map *bmap,
 	enum isl_dim_type type, unsigned first, unsigned n)
@@ -191,6 +197,14 @@ struct isl_basic_map *isl_basic_map_drop(struct isl_basic_map *bmap,
 	for (i = 0; i < bmap->n_div; ++i)
 		constraint_drop_vars(bmap->div[i]+1+offset, n, left);
 
+	if (bmap->sample &&
+	    bmap->sample->size == 1 + isl_basic_map_total_dim(bmap))
+		bmap->sample = isl_vec_drop_els(bmap->sample, offset, n);
+	else {
+		isl_vec_free(bmap->sample);
+		bmap->sample = NULL;
+	}
+
 	if (type == isl_dim_div) {
 		bmap = move_divs_last(bmap, first, n);
 		if (!bmap)
@@ -437,7 +451,135 @@ static __isl_give isl_basic_map *normalize_div_expressions(
 	return bmap;
 }
 
+/* Machine integer copies of an equality and of a row in which
+ * a variable is being eliminated using that equality.
+ * "eq" is NULL if the equality does not fit in machine integers.
+ */
+struct isl_elim_long {
+	long *eq;
+	long *row;
+};
+
+/* Copy the sequence "p" of length "len" to "l".
+ * Return 0 if all elements fit in a long that is not LONG_MIN and
+ * -1 otherwise.  Excluding LONG_MIN ensures that the absolute values
+ * can be computed without overflow.
+ */
+static int seq_to_long(long *l, isl_int *p, unsigned len)
+{
+	int i;
+
+	for (i = 0; i < len; ++i) {
+		if (!isl_int_fits_slong(p[i]))
+			return -1;
+		l[i] = isl_int_get_si(p[i]);
+		if (l[i] == LONG_MIN)
+			return -1;
+	}
+
+	return 0;
+}
+
+/* Set "*r" to "a" * "x" + "b" * "y", returning -1 if the computation
+ * overflows or if the result is LONG_MIN.
+ * None of the arguments are LONG_MIN.
+ */
+static int long_combine(long *r, long a, long x, long b, long y)
+{
+	long p1, p2;
+
+	if (x != 0 && (a > 0 ? (x > 0 ? a > LONG_MAX / x : x < LONG_MIN / a) :
+			       (x > 0 ? a < LONG_MIN / x : x < LONG_MAX / a)))
+		return -1;
+	if (y != 0 && (b > 0 ? (y > 0 ? b > LONG_MAX / y : y < LONG_MIN / b) :
+			       (y > 0 ? b < LONG_MIN / y : y < LONG_MAX / b)))
+		return -1;
+	p1 = a * x;
+	p2 = b * y;
+	if ((p2 > 0 && p1 > LONG_MAX - p2) || (p2 < 0 && p1 < LONG_MIN - p2))
+		return -1;
+	*r = p1 + p2;
+	return *r == LONG_MIN ? -1 : 0;
+}
+
+/* Return the greatest common divisor of the non-negative "a" and "b".
+ */
+static long long_gcd(long a, long b)
+{
+	while (b) {
+		long t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/* Initialize "el" for eliminating variables using "eq" of length "len".
+ * If "eq" does not fit in machine integers or if the memory
+ * cannot be allocated, then el->eq is set to NULL such that
+ * elim_long always falls back to the isl_int computation.
+ */
+static void elim_long_init(struct isl_elim_long *el, isl_ctx *ctx,
+	isl_int *eq, unsigned len)
+{
+	el->eq = isl_alloc_array(ctx, long, 2 * len);
+	if (!el->eq)
+		return;
+	el->row = el->eq + len;
+	if (seq_to_long(el->eq, eq, len) < 0) {
+		free(el->eq);
+		el->eq = NULL;
+	}
+}
+
+static void elim_long_clear(struct isl_elim_long *el)
+{
+	free(el->eq);
+}
+
+/* Perform isl_seq_elim(row, eq, pos, len, NULL) followed by
+ * isl_seq_normalize(row, len) on machine integers,
+ * where "eq" has been stored in "el" by elim_long_init.
+ * Return 1 if the computation was performed and 0 if some element
+ * of "row" does not fit in a machine integer or if any of
+ * the intermediate results overflows.  In the latter case,
+ * "row" is left untouched.
+ */
+static int elim_long(struct isl_elim_long *el, isl_int *row,
+	unsigned pos, unsigned len)
+{
+	int i;
+	long a, b, g;
+
+	if (!el->eq)
+		return 0;
+	if (seq_to_long(el->row, row, len) < 0)
+		return 0;
+
+	g = long_gcd(labs(el->eq[pos]), labs(el->row[pos]));
+	b = el->row[pos] / g;
+	if (el->eq[pos] > 0)
+		b = -b;
+	a = labs(el->eq[pos] / g);
+	g = 0;
+	for (i = 0; i < len; ++i) {
+		if (long_combine(&el->row[i], a, el->row[i],
+				 b, el->eq[i]) < 0)
+			return 0;
+		if (g != 1)
+			g = long_gcd(labs(el->row[i]), g);
+	}
+
+	for (i = 0; i < len; ++i)
+		isl_int_set_si(row[i], g > 1 ? el->row[i] / g : el->row[i]);
+
+	return 1;
+}
+
 /* Assumes divs have been ordered if keep_divs is set.
+ *
+ * The equalities and inequalities are first updated
+ * on machine integers, if possible.
  */
 static void eliminate_var_using_equality(struct isl_basic_map *bmap,
 	unsigned pos, isl_int *eq, int keep_divs, int *progress)
@@ -446,10 +588,12 @@ static void eliminate_var_using_equality(struct isl_basic_map *bmap,
 	unsigned space_total;
 	int k;
 	int last_div;
+	struct isl_elim_long el;
 
 	total = isl_basic_map_total_dim(bmap);
 	space_total = isl_space_dim(bmap->dim, isl_dim_all);
 	last_div = isl_seq_last_non_zero(eq + 1 + space_total, bmap->n_div);
+	elim_long_init(&el, bmap->ctx, eq, 1 + total);
 	for (k = 0; k < bmap->n_eq; ++k) {
 		if (bmap->eq[k] == eq)
 			continue;
@@ -457,6 +601,8 @@ static void eliminate_var_using_equality(struct isl_basic_map *bmap,
 			continue;
 		if (progress)
 			*progress = 1;
+		if (elim_long(&el, bmap->eq[k], 1 + pos, 1 + total))
+			continue;
 		isl_seq_elim(bmap->eq[k], eq, 1+pos, 1+total, NULL);
 		isl_seq_normalize(bmap->ctx, bmap->eq[k], 1 + total);
 	}
@@ -466,10 +612,13 @@ static void eliminate_var_using_equality(struct isl_basic_map *bmap,
 			continue;
 		if (progress)
 			*progress = 1;
+		ISL_F_CLR(bmap, ISL_BASIC_MAP_NORMALIZED);
+		if (elim_long(&el, bmap->ineq[k], 1 + pos, 1 + total))
+			continue;
 		isl_seq_elim(bmap->ineq[k], eq, 1+pos, 1+total, NULL);
 		isl_seq_normalize(bmap->ctx, bmap->ineq[k], 1 + total);
-		ISL_F_CLR(bmap, ISL_BASIC_MAP_NORMALIZED);
 	}
+	elim_long_clear(&el);
 
 	for (k = 0; k < bmap->n_div; ++k) {
 		if (isl_int_is_zero(bmap->div[k][0]))
@@ -617,8 +766,8 @@ struct isl_basic_map *isl_basic_map_gauss(
 
 	bmap = isl_basic_map_order_divs(bmap);
 
-	if (!bmap)
-		return NULL;
+	if (isl_basic_map_compact_rows(bmap) < 0)
+		return isl_basic_map_free(bmap);
 
 	total = isl_basic_map_total_dim(bmap);
 	total_var = total - bmap->n_div;
@@ -1126,6 +1275,8 @@ __isl_give isl_basic_map *isl_basic_map_remove_duplicate_constraints(
 
 	if (!bmap || bmap->n_ineq <= 1)
 		return bmap;
+	if (isl_basic_map_compact_rows(bmap) < 0)
+		return isl_basic_map_free(bmap);
 
 	size = round_up(4 * (bmap->n_ineq+1) / 3 - 1);
 	bits = ffs(size) - 1;
@@ -1482,42 +1633,301 @@ static struct isl_basic_map *remove_dependent_vars(struct isl_basic_map *bmap,
 	return bmap;
 }
 
-/* Eliminate the specified variables from the constraints using
- * Fourier-Motzkin.  The variables themselves are not removed.
+/* Chernikov's rule for Fourier-Motzkin elimination keeps track
+ * of the set of constraints of some initial system of inequality
+ * constraints that a constraint obtained during the elimination
+ * is a non-negative combination of.
+ * After eliminating "n_elim" variables from the initial system,
+ * any constraint that is a combination of more than n_elim + 1
+ * initial constraints is redundant and does not need to be constructed.
+ *
+ * "valid" is set if the histories correspond to the current
+ * inequality constraints.
+ * "rational" is set if the basic map is rational.
+ * Otherwise, the constant terms of the constraints get rounded down
+ * after each elimination, such that the constraints are no longer
+ * exact combinations of the initial constraints, and keeping
+ * redundant constraints around could lead to different (tighter)
+ * constraints after rounding.  The rule is then not applied and
+ * redundant constraints are removed after each elimination.
+ * "n_init" is the number of constraints in the initial system.
+ * "n_word" is the number of words in a single history and
+ * "size" is the number of histories for which room has been allocated.
+ * The history of inequality constraint i is stored in "set"
+ * at position i * n_word.
  */
-struct isl_basic_map *isl_basic_map_eliminate_vars(
-	struct isl_basic_map *bmap, unsigned pos, unsigned n)
+struct isl_fm_history {
+	int valid;
+	int rational;
+	int n_init;
+	int n_elim;
+	int n_word;
+	int size;
+	unsigned long *set;
+};
+
+#define ISL_FM_WORD_BITS	(8 * sizeof(unsigned long))
+
+/* Make sure "hist" has room for at least "n" histories.
+ */
+static int fm_history_extend(isl_ctx *ctx, struct isl_fm_history *hist,
+	int n)
+{
+	unsigned long *set;
+
+	if (n <= hist->size)
+		return 0;
+	n = 2 * n;
+	set = isl_realloc_array(ctx, hist->set, unsigned long,
+				n * hist->n_word);
+	if (!set)
+		return -1;
+	hist->set = set;
+	hist->size = n;
+	return 0;
+}
+
+/* Take the "n_ineq" current inequality constraints as the initial system,
+ * each of them being a combination of only itself.
+ */
+static int fm_history_init(isl_ctx *ctx, struct isl_fm_history *hist,
+	int n_ineq)
+{
+	int i;
+	int n_word;
+
+	n_word = (n_ineq + ISL_FM_WORD_BITS - 1) / ISL_FM_WORD_BITS;
+	if (n_word < 1)
+		n_word = 1;
+	if (n_word != hist->n_word) {
+		free(hist->set);
+		hist->set = NULL;
+		hist->size = 0;
+		hist->n_word = n_word;
+	}
+	if (fm_history_extend(ctx, hist, n_ineq) < 0)
+		return -1;
+	for (i = 0; i < n_ineq; ++i) {
+		unsigned long *h = hist->set + i * n_word;
+		memset(h, 0, n_word * sizeof(unsigned long));
+		h[i / ISL_FM_WORD_BITS] |= 1UL << (i % ISL_FM_WORD_BITS);
+	}
+	hist->n_init = n_ineq;
+	hist->n_elim = 0;
+	hist->valid = 1;
+	return 0;
+}
+
+/* Store the union of the histories "i" and "j" in "k" and
+ * return the number of elements in this union.
+ */
+static int fm_history_combine(struct isl_fm_history *hist, int k, int i, int j)
+{
+	int w;
+	int n = 0;
+	unsigned long *h_i = hist->set + i * hist->n_word;
+	unsigned long *h_j = hist->set + j * hist->n_word;
+	unsigned long *h_k = hist->set + k * hist->n_word;
+
+	for (w = 0; w < hist->n_word; ++w) {
+		unsigned long b = h_i[w] | h_j[w];
+		h_k[w] = b;
+		for (; b; b &= b - 1)
+			n++;
+	}
+	return n;
+}
+
+/* Drop inequality constraint "pos" from "bmap", keeping
+ * the histories in "hist" (if valid) in sync with the constraints.
+ */
+static int fm_drop_inequality(__isl_keep isl_basic_map *bmap,
+	struct isl_fm_history *hist, int pos)
+{
+	int last = bmap->n_ineq - 1;
+
+	if (hist->valid && pos != last)
+		memcpy(hist->set + pos * hist->n_word,
+			hist->set + last * hist->n_word,
+			hist->n_word * sizeof(unsigned long));
+	return isl_basic_map_drop_inequality(bmap, pos);
+}
+
+/* Drop all inequality constraints of "bmap" that involve variable "d".
+ */
+static int fm_drop_involving(__isl_keep isl_basic_map *bmap,
+	struct isl_fm_history *hist, unsigned d)
+{
+	int i;
+
+	for (i = bmap->n_ineq - 1; i >= 0; --i) {
+		if (isl_int_is_zero(bmap->ineq[i][1 + d]))
+			continue;
+		if (fm_drop_inequality(bmap, hist, i) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/* Divide inequality constraint "k" of "bmap" by the gcd of its coefficients,
+ * rounding down the constant term if "bmap" is not rational.
+ * Return 1 if the constraint has no coefficients left.
+ */
+static int fm_normalize_inequality(__isl_keep isl_basic_map *bmap, int k)
+{
+	unsigned total = isl_basic_map_total_dim(bmap);
+	isl_int *gcd = &bmap->ctx->normalize_gcd;
+
+	isl_seq_gcd(bmap->ineq[k] + 1, total, gcd);
+	if (isl_int_is_zero(*gcd))
+		return 1;
+	if (ISL_F_ISSET(bmap, ISL_BASIC_MAP_RATIONAL))
+		isl_int_gcd(*gcd, *gcd, bmap->ineq[k][0]);
+	if (isl_int_is_one(*gcd))
+		return 0;
+	isl_int_fdiv_q(bmap->ineq[k][0], bmap->ineq[k][0], *gcd);
+	isl_seq_scale_down(bmap->ineq[k] + 1, bmap->ineq[k] + 1, *gcd, total);
+	return 0;
+}
+
+/* Eliminate variable "d", which has "n_lower" lower bounds and
+ * "n_upper" upper bounds and which does not appear in any equality,
+ * from the inequality constraints of "bmap" by combining
+ * each lower bound with each upper bound and then dropping
+ * the original bounds.
+ * If "bmap" is rational, then combinations that are redundant
+ * according to Chernikov's rule are not constructed and
+ * the new constraints are normalized immediately.
+ * If the histories in "hist" are not valid, then the current
+ * inequality constraints are taken as the initial system.
+ */
+static __isl_give isl_basic_map *fm_eliminate_var(
+	__isl_take isl_basic_map *bmap, unsigned d, int n_lower, int n_upper,
+	struct isl_fm_history *hist)
 {
-	int d;
 	int i, j, k;
 	unsigned total;
+	isl_ctx *ctx;
+
+	bmap = isl_basic_map_extend_constraints(bmap, 0, n_lower * n_upper);
+	if (!bmap)
+		return NULL;
+	ctx = bmap->ctx;
+	total = isl_basic_map_total_dim(bmap);
+	if (hist->rational) {
+		if (!hist->valid &&
+		    fm_history_init(ctx, hist, bmap->n_ineq) < 0)
+			return isl_basic_map_free(bmap);
+		if (fm_history_extend(ctx, hist,
+				    bmap->n_ineq + n_lower * n_upper) < 0)
+			return isl_basic_map_free(bmap);
+		hist->n_elim++;
+	}
+
+	for (i = bmap->n_ineq - 1; i >= 0; --i) {
+		int last;
+		if (isl_int_is_zero(bmap->ineq[i][1 + d]))
+			continue;
+		last = -1;
+		for (j = 0; j < i; ++j) {
+			if (isl_int_is_zero(bmap->ineq[j][1 + d]))
+				continue;
+			last = j;
+			if (isl_int_sgn(bmap->ineq[i][1 + d]) ==
+			    isl_int_sgn(bmap->ineq[j][1 + d]))
+				continue;
+			if (hist->valid &&
+			    fm_history_combine(hist, bmap->n_ineq, i, j) >
+			    hist->n_elim + 1) {
+				ctx->stats->fm_pruned++;
+				continue;
+			}
+			k = isl_basic_map_alloc_inequality(bmap);
+			if (k < 0)
+				return isl_basic_map_free(bmap);
+			isl_seq_cpy(bmap->ineq[k], bmap->ineq[i], 1 + total);
+			isl_seq_elim(bmap->ineq[k], bmap->ineq[j],
+					1 + d, 1 + total, NULL);
+			if (!hist->valid || !fm_normalize_inequality(bmap, k))
+				continue;
+			if (isl_int_is_neg(bmap->ineq[k][0]))
+				return isl_basic_map_set_to_empty(bmap);
+			isl_basic_map_free_inequality(bmap, 1);
+		}
+		if (fm_drop_inequality(bmap, hist, i) < 0)
+			return isl_basic_map_free(bmap);
+		i = last + 1;
+	}
+
+	return bmap;
+}
+
+/* Remove the redundant constraints that may have been introduced
+ * by Fourier-Motzkin elimination.
+ */
+static __isl_give isl_basic_map *fm_cleanup(__isl_take isl_basic_map *bmap)
+{
+	bmap = isl_basic_map_normalize_constraints(bmap);
+	bmap = isl_basic_map_remove_duplicate_constraints(bmap, NULL, 0);
+	bmap = isl_basic_map_gauss(bmap, NULL);
+	bmap = isl_basic_map_remove_redundancies(bmap);
+	return bmap;
+}
+
+/* Eliminate the variables "d" for which elim[d] is set
+ * from the constraints using Fourier-Motzkin.
+ * The variables themselves are not removed.
+ *
+ * The variables are eliminated one by one, from last to first.
+ * If "bmap" is rational, then Chernikov's rule is applied across
+ * the eliminations, such that most redundant constraints
+ * are never constructed and the (expensive) removal of the remaining
+ * redundant constraints only needs to be performed at the end,
+ * or when the number of constraints has grown too much.
+ * The histories are reset whenever the constraints are modified
+ * in any other way.
+ */
+__isl_give isl_basic_map *isl_basic_map_eliminate_selected_vars(
+	__isl_take isl_basic_map *bmap, int *elim)
+{
+	int d;
+	int i;
+	unsigned total;
 	int need_gauss = 0;
+	int dirty = 0;
+	struct isl_fm_history hist = { 0 };
 
-	if (n == 0)
-		return bmap;
 	if (!bmap)
 		return NULL;
 	total = isl_basic_map_total_dim(bmap);
+	for (d = total - 1; d >= 0; --d)
+		if (elim[d])
+			break;
+	if (d < 0)
+		return bmap;
 
 	bmap = isl_basic_map_cow(bmap);
-	for (d = pos + n - 1; d >= 0 && d >= pos; --d)
-		bmap = remove_dependent_vars(bmap, d);
+	for (d = total - 1; d >= 0; --d)
+		if (elim[d])
+			bmap = remove_dependent_vars(bmap, d);
 	if (!bmap)
 		return NULL;
+	hist.rational = ISL_F_ISSET(bmap, ISL_BASIC_MAP_RATIONAL);
 
-	for (d = pos + n - 1;
-	     d >= 0 && d >= total - bmap->n_div && d >= pos; --d)
-		isl_seq_clr(bmap->div[d-(total-bmap->n_div)], 2+total);
-	for (d = pos + n - 1; d >= 0 && d >= pos; --d) {
+	for (d = total - 1; d >= 0 && d >= total - bmap->n_div; --d)
+		if (elim[d])
+			isl_seq_clr(bmap->div[d-(total-bmap->n_div)], 2+total);
+	for (d = total - 1; d >= 0; --d) {
 		int n_lower, n_upper;
-		if (!bmap)
-			return NULL;
+		if (!elim[d])
+			continue;
 		for (i = 0; i < bmap->n_eq; ++i) {
 			if (isl_int_is_zero(bmap->eq[i][1+d]))
 				continue;
 			eliminate_var_using_equality(bmap, d, bmap->eq[i], 0, NULL);
 			isl_basic_map_drop_equality(bmap, i);
 			need_gauss = 1;
+			hist.valid = 0;
 			break;
 		}
 		if (i < bmap->n_eq)
@@ -1530,55 +1940,72 @@ struct isl_basic_map *isl_basic_map_eliminate_vars(
 			else if (isl_int_is_neg(bmap->ineq[i][1+d]))
 				n_upper++;
 		}
-		bmap = isl_basic_map_extend_constraints(bmap,
-				0, n_lower * n_upper);
-		if (!bmap)
-			goto error;
-		for (i = bmap->n_ineq - 1; i >= 0; --i) {
-			int last;
-			if (isl_int_is_zero(bmap->ineq[i][1+d]))
-				continue;
-			last = -1;
-			for (j = 0; j < i; ++j) {
-				if (isl_int_is_zero(bmap->ineq[j][1+d]))
-					continue;
-				last = j;
-				if (isl_int_sgn(bmap->ineq[i][1+d]) ==
-				    isl_int_sgn(bmap->ineq[j][1+d]))
-					continue;
-				k = isl_basic_map_alloc_inequality(bmap);
-				if (k < 0)
-					goto error;
-				isl_seq_cpy(bmap->ineq[k], bmap->ineq[i],
-						1+total);
-				isl_seq_elim(bmap->ineq[k], bmap->ineq[j],
-						1+d, 1+total, NULL);
-			}
-			isl_basic_map_drop_inequality(bmap, i);
-			i = last + 1;
-		}
-		if (n_lower > 0 && n_upper > 0) {
-			bmap = isl_basic_map_normalize_constraints(bmap);
-			bmap = isl_basic_map_remove_duplicate_constraints(bmap,
-								    NULL, 0);
-			bmap = isl_basic_map_gauss(bmap, NULL);
-			bmap = isl_basic_map_remove_redundancies(bmap);
-			need_gauss = 0;
-			if (!bmap)
+		if (n_lower == 0 || n_upper == 0) {
+			if (fm_drop_involving(bmap, &hist, d) < 0)
 				goto error;
-			if (ISL_F_ISSET(bmap, ISL_BASIC_MAP_EMPTY))
-				break;
+			hist.n_elim++;
+			continue;
 		}
+		bmap = fm_eliminate_var(bmap, d, n_lower, n_upper, &hist);
+		if (!bmap)
+			goto error;
+		dirty = 1;
+		if (ISL_F_ISSET(bmap, ISL_BASIC_MAP_EMPTY))
+			break;
+		if (hist.rational && bmap->n_ineq <= 2 * hist.n_init)
+			continue;
+		bmap = fm_cleanup(bmap);
+		need_gauss = 0;
+		dirty = 0;
+		hist.valid = 0;
+		if (!bmap)
+			goto error;
+		if (ISL_F_ISSET(bmap, ISL_BASIC_MAP_EMPTY))
+			break;
+	}
+	free(hist.set);
+	if (dirty && !ISL_F_ISSET(bmap, ISL_BASIC_MAP_EMPTY)) {
+		bmap = fm_cleanup(bmap);
+		need_gauss = 0;
 	}
+	if (!bmap)
+		return NULL;
 	ISL_F_CLR(bmap, ISL_BASIC_MAP_NORMALIZED);
 	if (need_gauss)
 		bmap = isl_basic_map_gauss(bmap, NULL);
 	return bmap;
 error:
+	free(hist.set);
 	isl_basic_map_free(bmap);
 	return NULL;
 }
 
+/* Eliminate the specified variables from the constraints using
+ * Fourier-Motzkin.  The variables themselves are not removed.
+ */
+struct isl_basic_map *isl_basic_map_eliminate_vars(
+	struct isl_basic_map *bmap, unsigned pos, unsigned n)
+{
+	int i;
+	int *elim;
+	unsigned total;
+
+	if (n == 0)
+		return bmap;
+	if (!bmap)
+		return NULL;
+	total = isl_basic_map_total_dim(bmap);
+
+	elim = isl_calloc_array(bmap->ctx, int, total);
+	if (total && !elim)
+		return isl_basic_map_free(bmap);
+	for (i = 0; i < n && pos + i < total; ++i)
+		elim[pos + i] = 1;
+	bmap = isl_basic_map_eliminate_selected_vars(bmap, elim);
+	free(elim);
+	return bmap;
+}
+
 struct isl_basic_set *isl_basic_set_eliminate_vars(
 	struct isl_basic_set *bset, unsigned pos, unsigned n)
 {
@@ -1967,6 +2394,129 @@ error:
 	return isl_basic_set_free(context);
 }
 
+/* Drop the inequalities of "full" that are marked redundant.
+ * The first "n_context" inequalities are considered to be redundant
+ * if "drop_context" is set, while the redundancy of the remaining
+ * inequalities is given by "redundant".
+ * The inequalities are dropped in the same order
+ * as in isl_basic_set_update_from_tab.
+ */
+static __isl_give isl_basic_set *drop_marked(__isl_take isl_basic_set *full,
+	int n_context, int *redundant, int drop_context)
+{
+	int i;
+
+	if (!full)
+		return NULL;
+	for (i = full->n_ineq - 1; i >= 0; --i) {
+		if (i < n_context ? !drop_context : !redundant[i - n_context])
+			continue;
+		if (isl_basic_set_drop_inequality(full, i) < 0)
+			return isl_basic_set_free(full);
+	}
+	return full;
+}
+
+/* Remove all information from "bset" that is redundant in the context
+ * of "context", using "context_tab" to detect the constraints
+ * of "bset" that are redundant (over the rationals).
+ * "context_tab" is a tableau of a basic set with the same constraints
+ * as "context" and possibly some extra constraints that are irrelevant
+ * for "bset".  All its constraints have been frozen.
+ * The constraints of "bset" are only temporarily added to "context_tab"
+ * such that it can be reused for subsequent calls.
+ *
+ * The remaining computation is the same as in uset_gist_full,
+ * except that the redundant constraints are kept track of
+ * in the "redundant" array rather than in the tableau.
+ */
+static __isl_give isl_basic_set *drop_redundant_in_context_tab(
+	__isl_take isl_basic_set *bset, __isl_keep isl_basic_set *context,
+	struct isl_tab *context_tab)
+{
+	int i, k;
+	int off;
+	int n_ineq;
+	int context_ineq;
+	int *redundant = NULL;
+	unsigned total;
+	struct isl_tab_undo *snap;
+	isl_basic_set *full = NULL, *combined = NULL;
+
+	if (!bset)
+		return NULL;
+
+	n_ineq = bset->n_ineq;
+	redundant = isl_calloc_array(bset->ctx, int, n_ineq);
+	if (!redundant)
+		goto error;
+
+	snap = isl_tab_snap(context_tab);
+	off = context_tab->n_con;
+	if (isl_tab_extend_cons(context_tab, n_ineq) < 0)
+		goto error;
+	for (i = 0; i < n_ineq; ++i)
+		if (isl_tab_add_ineq(context_tab, bset->ineq[i]) < 0)
+			goto error;
+	if (isl_tab_detect_redundant(context_tab) < 0)
+		goto error;
+	if (context_tab->empty) {
+		if (isl_tab_rollback(context_tab, snap) < 0)
+			goto error;
+		free(redundant);
+		return isl_basic_set_set_to_empty(bset);
+	}
+	for (i = 0; i < n_ineq; ++i)
+		redundant[i] = isl_tab_is_redundant(context_tab, off + i);
+	if (isl_tab_rollback(context_tab, snap) < 0)
+		goto error;
+
+	context_ineq = context->n_ineq;
+	full = isl_basic_set_extend_constraints(isl_basic_set_copy(context),
+						0, n_ineq);
+	full = isl_basic_set_add_constraints(full, bset, 0);
+	bset = NULL;
+	if (!full)
+		goto error;
+	total = isl_basic_set_total_dim(full);
+	for (i = 0; i < n_ineq; ++i) {
+		int is_empty;
+		if (redundant[i])
+			continue;
+		redundant[i] = 1;
+		combined = isl_basic_set_dup(full);
+		combined = drop_marked(combined, context_ineq, redundant, 0);
+		combined = isl_basic_set_extend_constraints(combined, 0, 1);
+		k = isl_basic_set_alloc_inequality(combined);
+		if (k < 0)
+			goto error;
+		isl_seq_neg(combined->ineq[k], full->ineq[context_ineq + i],
+				1 + total);
+		isl_int_sub_ui(combined->ineq[k][0], combined->ineq[k][0], 1);
+		is_empty = isl_basic_set_is_empty(combined);
+		if (is_empty < 0)
+			goto error;
+		isl_basic_set_free(combined);
+		combined = NULL;
+		if (!is_empty)
+			redundant[i] = 0;
+	}
+	full = drop_marked(full, context_ineq, redundant, 1);
+	if (full) {
+		ISL_F_SET(full, ISL_BASIC_SET_NO_IMPLICIT);
+		ISL_F_SET(full, ISL_BASIC_SET_NO_REDUNDANT);
+	}
+
+	free(redundant);
+	return full;
+error:
+	free(redundant);
+	isl_basic_set_free(combined);
+	isl_basic_set_free(full);
+	isl_basic_set_free(bset);
+	return NULL;
+}
+
 /* Remove all information from bset that is redundant in the context
  * of context.  Both bset and context are assumed to be full-dimensional.
  *
@@ -1988,9 +2538,15 @@ error:
  * would lead to an empty set.  This last step is fairly expensive
  * and could be optimized by more reuse of the tableau.
  * Finally, we update bset according to the results.
+ *
+ * If "context_tab" is not NULL, then it is a tableau of a basic set
+ * with the same constraints as "context" and possibly some extra
+ * constraints that are irrelevant for computing the gist of "bset".
+ * The redundant constraints are then detected by
+ * drop_redundant_in_context_tab instead.
  */
 static __isl_give isl_basic_set *uset_gist_full(__isl_take isl_basic_set *bset,
-	__isl_take isl_basic_set *context)
+	__isl_take isl_basic_set *context, struct isl_tab *context_tab)
 {
 	int i, k;
 	isl_basic_set *combined = NULL;
@@ -2025,9 +2581,15 @@ static __isl_give isl_basic_set *uset_gist_full(__isl_take isl_basic_set *bset,
 		return bset;
 	}
 
+	if (context_tab) {
+		bset = drop_redundant_in_context_tab(bset, context,
+							context_tab);
+		goto done;
+	}
+
 	context_ineq = context->n_ineq;
-	combined = isl_basic_set_cow(isl_basic_set_copy(context));
-	combined = isl_basic_set_extend_constraints(combined, 0, bset->n_ineq);
+	combined = isl_basic_set_extend_constraints(isl_basic_set_copy(context),
+							0, bset->n_ineq);
 	tab = isl_tab_from_basic_set(combined, 0);
 	for (i = 0; i < context_ineq; ++i)
 		if (isl_tab_freeze_constraint(tab, i) < 0)
@@ -2107,9 +2669,13 @@ error:
  * quantified variables are given precedence over those that do.
  * We have to perform this sorting before the variable compression,
  * because that may effect the order of the variables.
+ *
+ * If "context_tab" is not NULL, then it is a tableau of "context"
+ * (see uset_gist_full).  It can only be used if the intersection
+ * has no equalities since the context is compressed otherwise.
  */
 static __isl_give isl_basic_set *uset_gist(__isl_take isl_basic_set *bset,
-	__isl_take isl_basic_set *context)
+	__isl_take isl_basic_set *context, struct isl_tab *context_tab)
 {
 	isl_mat *eq;
 	isl_mat *T, *T2;
@@ -2135,7 +2701,7 @@ static __isl_give isl_basic_set *uset_gist(__isl_take isl_basic_set *bset,
 	bset = isl_basic_set_sort_constraints(bset);
 	if (aff->n_eq == 0) {
 		isl_basic_set_free(aff);
-		return uset_gist_full(bset, context);
+		return uset_gist_full(bset, context, context_tab);
 	}
 	total = isl_basic_set_total_dim(bset);
 	eq = isl_mat_sub_alloc6(bset->ctx, aff->eq, 0, aff->n_eq, 0, 1 + total);
@@ -2154,7 +2720,7 @@ static __isl_give isl_basic_set *uset_gist(__isl_take isl_basic_set *bset,
 	bset = isl_basic_set_preimage(bset, isl_mat_copy(T));
 	context = isl_basic_set_preimage(context, T);
 
-	bset = uset_gist_full(bset, context);
+	bset = uset_gist_full(bset, context, NULL);
 	bset = isl_basic_set_preimage(bset, T2);
 	bset = isl_basic_set_intersect(bset, aff);
 	bset = isl_basic_set_reduce_using_equalities(bset, aff_context);
@@ -2225,9 +2791,16 @@ static struct isl_basic_map *normalize_divs_in_context(
  * this form that are most obviously redundant with respect to
  * the context.  We also remove those div constraints that are
  * redundant with respect to the other constraints in the result.
+ *
+ * If "context_tab" is not NULL, then it is a tableau of "context",
+ * which is then known not to have any equalities or integer divisions.
+ * It is only passed on if "bmap" does not have any integer divisions
+ * either, since the context would otherwise get extended
+ * with the integer divisions of "bmap".
  */
-struct isl_basic_map *isl_basic_map_gist(struct isl_basic_map *bmap,
-	struct isl_basic_map *context)
+static __isl_give isl_basic_map *basic_map_gist(
+	__isl_take isl_basic_map *bmap, __isl_take isl_basic_map *context,
+	struct isl_tab *context_tab)
 {
 	isl_basic_set *bset, *eq;
 	isl_basic_map *eq_bmap;
@@ -2263,8 +2836,11 @@ struct isl_basic_map *isl_basic_map_gist(struct isl_basic_map *bmap,
 	bmap = isl_basic_map_align_divs(bmap, context);
 	n_div = isl_basic_map_dim(bmap, isl_dim_div);
 
+	if (n_div != 0)
+		context_tab = NULL;
 	bset = uset_gist(isl_basic_map_underlying_set(isl_basic_map_copy(bmap)),
-		    isl_basic_map_underlying_set(isl_basic_map_copy(context)));
+		    isl_basic_map_underlying_set(isl_basic_map_copy(context)),
+		    context_tab);
 
 	if (!bset || bset->n_eq == 0 || n_div == 0 ||
 	    isl_basic_set_plain_is_empty(bset)) {
@@ -2294,17 +2870,48 @@ error:
 	return NULL;
 }
 
+struct isl_basic_map *isl_basic_map_gist(struct isl_basic_map *bmap,
+	struct isl_basic_map *context)
+{
+	return basic_map_gist(bmap, context, NULL);
+}
+
+/* Return a basic map that has the same intersection with "context"
+ * as "bmap", without performing any tableau operations.
+ * In particular, only remove the constraints of "bmap" that are
+ * identical to or more relaxed than constraints of "context".
+ */
+static __isl_give isl_basic_map *basic_map_plain_gist(
+	__isl_take isl_basic_map *bmap, __isl_take isl_basic_map *context)
+{
+	bmap = isl_basic_map_remove_shifted_constraints(bmap, context);
+	bmap = isl_basic_map_simplify(bmap);
+	bmap = isl_basic_map_finalize(bmap);
+	return bmap;
+}
+
 /*
  * Assumes context has no implicit divs.
+ *
+ * If the budget set by the simplify_budget option gets used up,
+ * then the remaining basic maps are only simplified
+ * by basic_map_plain_gist.
+ *
+ * If "context_tab" is not NULL, then it is a tableau of "context"
+ * that is reused for the gist of each basic map (see basic_map_gist).
  */
-__isl_give isl_map *isl_map_gist_basic_map(__isl_take isl_map *map,
-	__isl_take isl_basic_map *context)
+static __isl_give isl_map *map_gist_basic_map(__isl_take isl_map *map,
+	__isl_take isl_basic_map *context, struct isl_tab *context_tab)
 {
 	int i;
+	long start;
+	int exhausted = 0;
 
 	if (!map || !context)
 		goto error;
 
+	start = map->ctx->stats->pivots;
+
 	if (isl_basic_map_plain_is_empty(context)) {
 		isl_space *space = isl_map_get_space(map);
 		isl_map_free(map);
@@ -2321,8 +2928,17 @@ __isl_give isl_map *isl_map_gist_basic_map(__isl_take isl_map *map,
 	if (!map)
 		goto error;
 	for (i = map->n - 1; i >= 0; --i) {
-		map->p[i] = isl_basic_map_gist(map->p[i],
+		if (!exhausted &&
+		    isl_ctx_simplify_budget_exhausted(map->ctx, start)) {
+			map->ctx->stats->simplify_budget_exhausted++;
+			exhausted = 1;
+		}
+		if (exhausted)
+			map->p[i] = basic_map_plain_gist(map->p[i],
 						isl_basic_map_copy(context));
+		else
+			map->p[i] = basic_map_gist(map->p[i],
+				isl_basic_map_copy(context), context_tab);
 		if (!map->p[i])
 			goto error;
 		if (isl_basic_map_plain_is_empty(map->p[i])) {
@@ -2341,6 +2957,12 @@ error:
 	return NULL;
 }
 
+__isl_give isl_map *isl_map_gist_basic_map(__isl_take isl_map *map,
+	__isl_take isl_basic_map *context)
+{
+	return map_gist_basic_map(map, context, NULL);
+}
+
 /* Return a map that has the same intersection with "context" as "map"
  * and that is as "simple" as possible.
  *
@@ -2392,6 +3014,152 @@ __isl_give isl_map *isl_map_gist(__isl_take isl_map *map,
 	return isl_map_align_params_map_map_and(map, context, &map_gist);
 }
 
+/* A context for repeated gist computations.
+ *
+ * "context" is the context, with its integer divisions computed,
+ * "hull" is the simple hull of "context" with redundant constraints
+ * removed, as computed by map_gist, and
+ * "tab" is a tableau of "hull" with all constraints frozen
+ * or NULL if "hull" has any equalities or integer divisions or
+ * if it is empty or the universe.
+ * The constraints of the basic maps of which the gist is computed
+ * are added to "tab" temporarily, such that "tab" does not
+ * need to be recomputed for each of them.
+ */
+struct isl_map_gist_context {
+	int ref;
+
+	isl_map *context;
+	isl_basic_map *hull;
+	struct isl_tab *tab;
+};
+
+/* Construct a context for computing the gist of several maps
+ * with respect to "context".
+ */
+__isl_give isl_map_gist_context *isl_map_gist_context_alloc(
+	__isl_take isl_map *context)
+{
+	int i;
+	isl_ctx *ctx;
+	isl_basic_map *hull;
+	isl_map_gist_context *gc;
+
+	if (!context)
+		return NULL;
+
+	ctx = isl_map_get_ctx(context);
+	gc = isl_calloc_type(ctx, isl_map_gist_context);
+	if (!gc)
+		goto error;
+	gc->ref = 1;
+	gc->context = isl_map_compute_divs(context);
+	hull = isl_map_simple_hull(isl_map_copy(gc->context));
+	gc->hull = isl_basic_map_remove_redundancies(hull);
+	if (!gc->hull)
+		return isl_map_gist_context_free(gc);
+
+	hull = gc->hull;
+	if (hull->n_eq != 0 || hull->n_div != 0 ||
+	    isl_basic_map_plain_is_empty(hull) ||
+	    isl_basic_map_is_universe(hull))
+		return gc;
+
+	gc->tab = isl_tab_from_basic_map(hull, 0);
+	if (!gc->tab)
+		return isl_map_gist_context_free(gc);
+	for (i = 0; i < gc->tab->n_con; ++i)
+		if (isl_tab_freeze_constraint(gc->tab, i) < 0)
+			return isl_map_gist_context_free(gc);
+	if (gc->tab->empty) {
+		isl_tab_free(gc->tab);
+		gc->tab = NULL;
+	}
+
+	return gc;
+error:
+	isl_map_free(context);
+	return NULL;
+}
+
+__isl_give isl_map_gist_context *isl_set_gist_context_alloc(
+	__isl_take isl_set *context)
+{
+	return isl_map_gist_context_alloc((isl_map *) context);
+}
+
+__isl_give isl_map_gist_context *isl_map_gist_context_copy(
+	__isl_keep isl_map_gist_context *gc)
+{
+	if (!gc)
+		return NULL;
+
+	gc->ref++;
+	return gc;
+}
+
+__isl_null isl_map_gist_context *isl_map_gist_context_free(
+	__isl_take isl_map_gist_context *gc)
+{
+	if (!gc)
+		return NULL;
+	if (--gc->ref > 0)
+		return NULL;
+
+	isl_map_free(gc->context);
+	isl_basic_map_free(gc->hull);
+	isl_tab_free(gc->tab);
+	free(gc);
+
+	return NULL;
+}
+
+/* Compute the gist of "map" with respect to the context of "gc".
+ * The result is the same as that of isl_map_gist, but the simple hull
+ * of the context and its tableau are reused from "gc".
+ *
+ * If the spaces of "map" and the context are not the same,
+ * then we simply call isl_map_gist.
+ * Otherwise, the special cases of map_gist are handled first.
+ */
+__isl_give isl_map *isl_map_gist_with_context(__isl_take isl_map *map,
+	__isl_keep isl_map_gist_context *gc)
+{
+	int equal;
+	int is_universe;
+
+	if (!map || !gc)
+		return isl_map_free(map);
+
+	if (!isl_space_is_equal(map->dim, gc->context->dim))
+		return isl_map_gist(map, isl_map_copy(gc->context));
+
+	is_universe = isl_map_plain_is_universe(map);
+	if (is_universe >= 0 && !is_universe)
+		is_universe = isl_map_plain_is_universe(gc->context);
+	if (is_universe < 0)
+		return isl_map_free(map);
+	if (is_universe)
+		return map;
+
+	equal = isl_map_plain_is_equal(map, gc->context);
+	if (equal < 0)
+		return isl_map_free(map);
+	if (equal) {
+		isl_map *res = isl_map_universe(isl_map_get_space(map));
+		isl_map_free(map);
+		return res;
+	}
+
+	return map_gist_basic_map(map, isl_basic_map_copy(gc->hull), gc->tab);
+}
+
+__isl_give isl_set *isl_set_gist_with_context(__isl_take isl_set *set,
+	__isl_keep isl_map_gist_context *gc)
+{
+	return (isl_set *) isl_map_gist_with_context((isl_map *) set, gc);
+}
+
 struct isl_basic_set *isl_basic_set_gist(struct isl_basic_set *bset,
 						struct isl_basic_set *context)
 {
@@ -2452,8 +3220,379 @@ __isl_give isl_set *isl_set_gist_params(__isl_take isl_set *set,
 	return isl_map_gist_params(set, context);
 }
 
+void *isl_map_plain_boxes_free(struct isl_map_plain_boxes *boxes)
+{
+	if (!boxes)
+		return NULL;
+	isl_mat_free(boxes->bound);
+	free(boxes->finite);
+	free(boxes);
+	return NULL;
+}
+
+/* Update the bounds of basic map "i" in "boxes" based on "c",
+ * which is an inequality of the basic map or, if "eq" is set,
+ * an equality.  "total" is the total number of variables in "c".
+ */
+static void plain_boxes_update(struct isl_map_plain_boxes *boxes, int i,
+	isl_int *c, unsigned total, int eq, isl_int *b)
+{
+	int pos;
+	int l;
+	isl_int *lower = boxes->bound->row[2 * i];
+	isl_int *upper = boxes->bound->row[2 * i + 1];
+	int *has_lower = boxes->finite + 2 * i * boxes->dim;
+	int *has_upper = has_lower + boxes->dim;
+
+	pos = isl_seq_first_non_zero(c + 1, boxes->dim);
+	if (pos < 0)
+		return;
+	if (isl_seq_first_non_zero(c + 1 + pos + 1, total - pos - 1) != -1)
+		return;
+
+	for (l = 0; l < 1 + eq; ++l) {
+		if (l) {
+			isl_int_neg(c[0], c[0]);
+			isl_int_neg(c[1 + pos], c[1 + pos]);
+		}
+		if (isl_int_is_pos(c[1 + pos])) {
+			isl_int_neg(*b, c[0]);
+			isl_int_cdiv_q(*b, *b, c[1 + pos]);
+			if (!has_lower[pos] || isl_int_gt(*b, lower[pos]))
+				isl_int_set(lower[pos], *b);
+			has_lower[pos] = 1;
+		} else {
+			isl_int_neg(*b, c[1 + pos]);
+			isl_int_fdiv_q(*b, c[0], *b);
+			if (!has_upper[pos] || isl_int_lt(*b, upper[pos]))
+				isl_int_set(upper[pos], *b);
+			has_upper[pos] = 1;
+		}
+	}
+	if (eq) {
+		isl_int_neg(c[0], c[0]);
+		isl_int_neg(c[1 + pos], c[1 + pos]);
+	}
+}
+
+/* Allocate room for the bounds of "n" boxes in a space of dimension "dim".
+ * Initially, none of the bounds are available.
+ */
+struct isl_map_plain_boxes *isl_map_plain_boxes_alloc(isl_ctx *ctx,
+	int n, unsigned dim)
+{
+	struct isl_map_plain_boxes *boxes;
+
+	boxes = isl_calloc_type(ctx, struct isl_map_plain_boxes);
+	if (!boxes)
+		return NULL;
+	boxes->dim = dim;
+	boxes->bound = isl_mat_alloc(ctx, 2 * n, dim);
+	boxes->finite = isl_calloc_array(ctx, int, 2 * n * dim);
+	if (!boxes->bound || (n && dim && !boxes->finite))
+		return isl_map_plain_boxes_free(boxes);
+
+	return boxes;
+}
+
+/* Set the bounds of basic map "i" in "boxes" to those that can be
+ * read off from the constraints of "bmap".
+ */
+static void plain_boxes_set(struct isl_map_plain_boxes *boxes, int i,
+	__isl_keep isl_basic_map *bmap, isl_int *b)
+{
+	int k;
+	unsigned total = isl_basic_map_total_dim(bmap);
+
+	if (ISL_F_ISSET(bmap, ISL_BASIC_MAP_RATIONAL))
+		return;
+	for (k = 0; k < bmap->n_eq; ++k)
+		plain_boxes_update(boxes, i, bmap->eq[k], total, 1, b);
+	for (k = 0; k < bmap->n_ineq; ++k)
+		plain_boxes_update(boxes, i, bmap->ineq[k], total, 0, b);
+}
+
+/* Compute bounds on the parameters and the input and output dimensions
+ * of each basic map in "map" that can be read off from the constraints
+ * without any further computation.
+ * The result can be used by isl_map_plain_boxes_is_disjoint to quickly
+ * detect pairs of basic maps that are disjoint before any tableau
+ * is constructed.
+ */
+struct isl_map_plain_boxes *isl_map_plain_boxes(__isl_keep isl_map *map)
+{
+	int i;
+	isl_int b;
+	struct isl_map_plain_boxes *boxes;
+
+	if (!map)
+		return NULL;
+
+	boxes = isl_map_plain_boxes_alloc(isl_map_get_ctx(map), map->n,
+				  isl_space_dim(map->dim, isl_dim_all));
+	if (!boxes)
+		return NULL;
+
+	isl_int_init(b);
+	for (i = 0; i < map->n; ++i)
+		plain_boxes_set(boxes, i, map->p[i], &b);
+	isl_int_clear(b);
+
+	return boxes;
+}
+
+/* Set the bounds of box "i" in "boxes" to bounds that hold
+ * for all the basic maps in "map" and that can be read off
+ * from their constraints.
+ * A bound is only available if it is available for each of
+ * the basic maps that are not obviously empty.
+ * If all basic maps are obviously empty, then no bounds are set.
+ */
+int isl_map_plain_boxes_set_hull(struct isl_map_plain_boxes *boxes, int i,
+	__isl_keep isl_map *map)
+{
+	int j, k;
+	int first = 1;
+	isl_int b;
+	unsigned dim;
+	isl_int *lower, *upper;
+	int *has_lower, *has_upper;
+	struct isl_map_plain_boxes *box;
+
+	if (!boxes || !map)
+		return -1;
+
+	dim = boxes->dim;
+	lower = boxes->bound->row[2 * i];
+	upper = boxes->bound->row[2 * i + 1];
+	has_lower = boxes->finite + 2 * i * dim;
+	has_upper = has_lower + dim;
+	for (k = 0; k < dim; ++k)
+		has_lower[k] = has_upper[k] = 0;
+
+	box = isl_map_plain_boxes_alloc(isl_map_get_ctx(map), 1, dim);
+	if (!box)
+		return -1;
+
+	isl_int_init(b);
+	for (j = 0; j < map->n; ++j) {
+		if (ISL_F_ISSET(map->p[j], ISL_BASIC_MAP_EMPTY))
+			continue;
+		for (k = 0; k < 2 * dim; ++k)
+			box->finite[k] = 0;
+		plain_boxes_set(box, 0, map->p[j], &b);
+		for (k = 0; k < dim; ++k) {
+			if (first || (has_lower[k] && box->finite[k] &&
+			    isl_int_lt(box->bound->row[0][k], lower[k])))
+				isl_int_set(lower[k], box->bound->row[0][k]);
+			if (first || (has_upper[k] && box->finite[dim + k] &&
+			    isl_int_gt(box->bound->row[1][k], upper[k])))
+				isl_int_set(upper[k], box->bound->row[1][k]);
+			has_lower[k] = box->finite[k] &&
+					(first || has_lower[k]);
+			has_upper[k] = box->finite[dim + k] &&
+					(first || has_upper[k]);
+		}
+		first = 0;
+	}
+	isl_int_clear(b);
+
+	isl_map_plain_boxes_free(box);
+	return 0;
+}
+
+/* Compute the bounds on the parameters and the input and output
+ * dimensions of "bmap" that can be read off from its constraints.
+ * If "bmap" is a box (see isl_basic_map_plain_is_box), then
+ * the result describes "bmap" exactly.
+ */
+struct isl_map_plain_boxes *isl_basic_map_plain_box(
+	__isl_keep isl_basic_map *bmap)
+{
+	isl_int b;
+	struct isl_map_plain_boxes *box;
+
+	if (!bmap)
+		return NULL;
+
+	box = isl_map_plain_boxes_alloc(isl_basic_map_get_ctx(bmap), 1,
+				isl_space_dim(bmap->dim, isl_dim_all));
+	if (!box)
+		return NULL;
+
+	isl_int_init(b);
+	plain_boxes_set(box, 0, bmap, &b);
+	isl_int_clear(b);
+
+	return box;
+}
+
+/* Is "bmap" an obvious box?
+ * That is, is it an integer basic map without divs such that
+ * each of its constraints involves at most one variable?
+ * Constraints that do not involve any variable are required
+ * to be satisfied.
+ * The integer points of such a basic map are exactly
+ * the integer points in the box described by isl_basic_map_plain_box.
+ */
+int isl_basic_map_plain_is_box(__isl_keep isl_basic_map *bmap)
+{
+	int k;
+	unsigned total;
+
+	if (!bmap)
+		return -1;
+	if (bmap->n_div != 0 || ISL_F_ISSET(bmap, ISL_BASIC_MAP_RATIONAL))
+		return 0;
+
+	total = isl_basic_map_total_dim(bmap);
+	for (k = 0; k < bmap->n_eq; ++k) {
+		int pos = isl_seq_first_non_zero(bmap->eq[k] + 1, total);
+		if (pos < 0 && !isl_int_is_zero(bmap->eq[k][0]))
+			return 0;
+		if (pos >= 0 && isl_seq_first_non_zero(bmap->eq[k] + 2 + pos,
+						      total - pos - 1) != -1)
+			return 0;
+	}
+	for (k = 0; k < bmap->n_ineq; ++k) {
+		int pos = isl_seq_first_non_zero(bmap->ineq[k] + 1, total);
+		if (pos < 0 && isl_int_is_neg(bmap->ineq[k][0]))
+			return 0;
+		if (pos >= 0 && isl_seq_first_non_zero(bmap->ineq[k] + 2 + pos,
+						      total - pos - 1) != -1)
+			return 0;
+	}
+
+	return 1;
+}
+
+/* Is the box of basic map "i" in "boxes" empty, i.e., is there
+ * any dimension where the lower bound exceeds the upper bound?
+ */
+int isl_map_plain_boxes_is_empty(struct isl_map_plain_boxes *boxes, int i)
+{
+	int k;
+	unsigned dim = boxes->dim;
+	isl_int *lower = boxes->bound->row[2 * i];
+	isl_int *upper = boxes->bound->row[2 * i + 1];
+	int *finite = boxes->finite + 2 * i * dim;
+
+	for (k = 0; k < dim; ++k)
+		if (finite[k] && finite[dim + k] &&
+		    isl_int_gt(lower[k], upper[k]))
+			return 1;
+
+	return 0;
+}
+
+/* Is the box of basic map "i" in "boxes1" a subset of the box
+ * of basic map "j" in "boxes2"?
+ * The first box is assumed to be non-empty.
+ * Each finite bound of the second box then needs to be implied
+ * by the corresponding bound of the first box.
+ */
+int isl_map_plain_boxes_is_subset(struct isl_map_plain_boxes *boxes1, int i,
+	struct isl_map_plain_boxes *boxes2, int j)
+{
+	int k;
+	unsigned dim = boxes1->dim;
+	isl_int *lower1 = boxes1->bound->row[2 * i];
+	isl_int *upper1 = boxes1->bound->row[2 * i + 1];
+	isl_int *lower2 = boxes2->bound->row[2 * j];
+	isl_int *upper2 = boxes2->bound->row[2 * j + 1];
+	int *finite1 = boxes1->finite + 2 * i * dim;
+	int *finite2 = boxes2->finite + 2 * j * dim;
+
+	for (k = 0; k < dim; ++k) {
+		if (finite2[k] &&
+		    (!finite1[k] || isl_int_lt(lower1[k], lower2[k])))
+			return 0;
+		if (finite2[dim + k] &&
+		    (!finite1[dim + k] || isl_int_gt(upper1[k], upper2[k])))
+			return 0;
+	}
+
+	return 1;
+}
+
+/* Are basic map "i" of the map from which "boxes1" was computed and
+ * basic map "j" of the map from which "boxes2" was computed
+ * obviously disjoint based on these bounds?
+ * That is, is there any dimension for which the lower bound
+ * of one exceeds the upper bound of the other?
+ * The two maps are assumed to live in the same space.
+ */
+int isl_map_plain_boxes_is_disjoint(struct isl_map_plain_boxes *boxes1, int i,
+	struct isl_map_plain_boxes *boxes2, int j)
+{
+	int k;
+	unsigned dim = boxes1->dim;
+	isl_int *lower1 = boxes1->bound->row[2 * i];
+	isl_int *upper1 = boxes1->bound->row[2 * i + 1];
+	isl_int *lower2 = boxes2->bound->row[2 * j];
+	isl_int *upper2 = boxes2->bound->row[2 * j + 1];
+	int *finite1 = boxes1->finite + 2 * i * dim;
+	int *finite2 = boxes2->finite + 2 * j * dim;
+
+	for (k = 0; k < dim; ++k) {
+		if (finite1[k] && finite2[dim + k] &&
+		    isl_int_gt(lower1[k], upper2[k]))
+			return 1;
+		if (finite2[k] && finite1[dim + k] &&
+		    isl_int_gt(lower2[k], upper1[k]))
+			return 1;
+	}
+
+	return 0;
+}
+
+/* Do "bmap1" and "bmap2" have a pair of inequality constraints
+ * that do not involve any integer divisions and that have opposite
+ * linear parts, but constant terms that sum to a negative value?
+ * That is, does "bmap1" impose f(x) >= -c1 and "bmap2" f(x) <= c2,
+ * with c2 < -c1?  If so, the two basic maps are disjoint.
+ * This generalizes isl_map_plain_boxes_is_disjoint to bounds
+ * on arbitrary affine combinations of the variables.
+ */
+static int has_opposite_ineq(__isl_keep isl_basic_map *bmap1,
+	__isl_keep isl_basic_map *bmap2)
+{
+	int i, j;
+	unsigned total;
+	isl_int sum;
+	int opposite = 0;
+
+	total = isl_space_dim(bmap1->dim, isl_dim_all);
+	isl_int_init(sum);
+	for (i = 0; !opposite && i < bmap1->n_ineq; ++i) {
+		isl_int *c1 = bmap1->ineq[i];
+
+		if (isl_seq_first_non_zero(c1 + 1 + total, bmap1->n_div) != -1)
+			continue;
+		for (j = 0; j < bmap2->n_ineq; ++j) {
+			isl_int *c2 = bmap2->ineq[j];
+
+			isl_int_add(sum, c1[0], c2[0]);
+			if (!isl_int_is_neg(sum))
+				continue;
+			if (!isl_seq_is_neg(c1 + 1, c2 + 1, total))
+				continue;
+			if (isl_seq_first_non_zero(c2 + 1 + total,
+						    bmap2->n_div) != -1)
+				continue;
+			opposite = 1;
+			break;
+		}
+	}
+	isl_int_clear(sum);
+
+	return opposite;
+}
+
 /* Quick check to see if two basic maps are disjoint.
- * In particular, we reduce the equalities and inequalities of
+ * First check if they have opposite inequality constraints
+ * that cannot be satisfied simultaneously.
+ * Then we reduce the equalities and inequalities of
  * one basic map in the context of the equalities of the other
  * basic map and check if we get a contradiction.
  */
@@ -2469,6 +3608,8 @@ int isl_basic_map_plain_is_disjoint(__isl_keep isl_basic_map *bmap1,
 		return -1;
 	isl_assert(bmap1->ctx, isl_space_is_equal(bmap1->dim, bmap2->dim),
 			return -1);
+	if (has_opposite_ineq(bmap1, bmap2))
+		return 1;
 	if (bmap1->n_div || bmap2->n_div)
 		return 0;
 	if (!bmap1->n_eq && !bmap2->n_eq)
@@ -7,6 +7,7 @@
  * Computerwetenschappen, Celestijnenlaan 200A, B-3001 Leuven, Belgium
  */
 
+#include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl_seq.h>
 #include <isl/set.h>
@@ -14,6 +15,8 @@
 #include "isl_tab.h"
 #include <isl_point_private.h>
 #include <isl_vec_private.h>
+#include <isl_profile.h>
+#include <isl_options_private.h>
 
 /* Expand the constraint "c" into "v".  The initial "dim" dimensions
  * are the same, but "v" may have more divs than "c" and the divs of "c"
@@ -42,17 +45,18 @@ static void expand_constraint(isl_vec *v, unsigned dim,
 
 /* Add all constraints of bmap to tab.  The equalities of bmap
  * are added as a pair of inequalities.
+ * "v" is used as temporary storage for the expanded constraints
+ * and is assumed to be large enough to hold a constraint of tab.
  */
 static int tab_add_constraints(struct isl_tab *tab,
-	__isl_keep isl_basic_map *bmap, int *div_map)
+	__isl_keep isl_basic_map *bmap, int *div_map, __isl_keep isl_vec *v)
 {
 	int i;
 	unsigned dim;
 	unsigned tab_total;
 	unsigned bmap_total;
-	isl_vec *v;
 
-	if (!tab || !bmap)
+	if (!tab || !bmap || !v)
 		return -1;
 
 	tab_total = isl_basic_map_total_dim(tab->bmap);
@@ -62,18 +66,16 @@ static int tab_add_constraints(struct isl_tab *tab,
 	if (isl_tab_extend_cons(tab, 2 * bmap->n_eq + bmap->n_ineq) < 0)
 		return -1;
 
-	v = isl_vec_alloc(bmap->ctx, 1 + tab_total);
-	if (!v)
-		return -1;
+	v->size = 1 + tab_total;
 
 	for (i = 0; i < bmap->n_eq; ++i) {
 		expand_constraint(v, dim, bmap->eq[i], div_map, bmap->n_div);
 		if (isl_tab_add_ineq(tab, v->el) < 0)
-			goto error;
+			return -1;
 		isl_seq_neg(bmap->eq[i], bmap->eq[i], 1 + bmap_total);
 		expand_constraint(v, dim, bmap->eq[i], div_map, bmap->n_div);
 		if (isl_tab_add_ineq(tab, v->el) < 0)
-			goto error;
+			return -1;
 		isl_seq_neg(bmap->eq[i], bmap->eq[i], 1 + bmap_total);
 		if (tab->empty)
 			break;
@@ -82,42 +84,37 @@ static int tab_add_constraints(struct isl_tab *tab,
 	for (i = 0; i < bmap->n_ineq; ++i) {
 		expand_constraint(v, dim, bmap->ineq[i], div_map, bmap->n_div);
 		if (isl_tab_add_ineq(tab, v->el) < 0)
-			goto error;
+			return -1;
 		if (tab->empty)
 			break;
 	}
 
-	isl_vec_free(v);
 	return 0;
-error:
-	isl_vec_free(v);
-	return -1;
 }
 
 /* Add a specific constraint of bmap (or its opposite) to tab.
  * The position of the constraint is specified by "c", where
  * the equalities of bmap are counted twice, once for the inequality
  * that is equal to the equality, and once for its negation.
+ * "v" is used as temporary storage as in tab_add_constraints.
  */
 static int tab_add_constraint(struct isl_tab *tab,
-	__isl_keep isl_basic_map *bmap, int *div_map, int c, int oppose)
+	__isl_keep isl_basic_map *bmap, int *div_map, int c, int oppose,
+	__isl_keep isl_vec *v)
 {
 	unsigned dim;
 	unsigned tab_total;
 	unsigned bmap_total;
-	isl_vec *v;
 	int r;
 
-	if (!tab || !bmap)
+	if (!tab || !bmap || !v)
 		return -1;
 
 	tab_total = isl_basic_map_total_dim(tab->bmap);
 	bmap_total = isl_basic_map_total_dim(bmap);
 	dim = isl_space_dim(tab->bmap->dim, isl_dim_all);
 
-	v = isl_vec_alloc(bmap->ctx, 1 + tab_total);
-	if (!v)
-		return -1;
+	v->size = 1 + tab_total;
 
 	if (c < 2 * bmap->n_eq) {
 		if ((c % 2) != oppose)
@@ -148,19 +145,24 @@ static int tab_add_constraint(struct isl_tab *tab,
 		}
 	}
 
-	isl_vec_free(v);
 	return r;
 }
 
+/* Add the integer divisions of "bmap" that do not already appear
+ * in "tab" to "tab" and keep track of the positions of
+ * the integer divisions of "bmap" in "tab" in "div_map".
+ * "vec" is used as temporary storage and is assumed to be large enough
+ * to hold an integer division of "tab" after all integer divisions
+ * of "bmap" have been added.
+ */
 static int tab_add_divs(struct isl_tab *tab, __isl_keep isl_basic_map *bmap,
-	int **div_map)
+	int **div_map, __isl_keep isl_vec *vec)
 {
 	int i, j;
-	struct isl_vec *vec;
 	unsigned total;
 	unsigned dim;
 
-	if (!bmap)
+	if (!bmap || !vec)
 		return -1;
 	if (!bmap->n_div)
 		return 0;
@@ -172,9 +174,6 @@ static int tab_add_divs(struct isl_tab *tab, __isl_keep isl_basic_map *bmap,
 
 	total = isl_basic_map_total_dim(tab->bmap);
 	dim = total - tab->bmap->n_div;
-	vec = isl_vec_alloc(bmap->ctx, 2 + total + bmap->n_div);
-	if (!vec)
-		return -1;
 
 	for (i = 0; i < bmap->n_div; ++i) {
 		isl_seq_cpy(vec->el, bmap->div[i], 2 + dim);
@@ -190,17 +189,11 @@ static int tab_add_divs(struct isl_tab *tab, __isl_keep isl_basic_map *bmap,
 		if (j == tab->bmap->n_div) {
 			vec->size = 2 + dim + tab->bmap->n_div;
 			if (isl_tab_add_div(tab, vec, NULL, NULL) < 0)
-				goto error;
+				return -1;
 		}
 	}
 
-	isl_vec_free(vec);
-
 	return 0;
-error:
-	isl_vec_free(vec);
-
-	return -1;
 }
 
 /* Freeze all constraints of tableau tab.
@@ -286,6 +279,15 @@ struct isl_diff_collector {
  * and if so, pass it along to dc->add.  As a special case, if nothing
  * has been removed when we end up in a leaf, we simply pass along
  * the original basic map.
+ *
+ * A single tableau of "bmap" is used throughout the computation.
+ * The constraints and integer divisions of the basic maps in "map"
+ * are only ever added on top of this tableau and removed again
+ * by rolling back to a snapshot.
+ * Similarly, a single vector "v" is used to hold the expanded constraints
+ * and integer divisions that are added to the tableau.
+ * Its size is large enough to hold the integer divisions of "bmap"
+ * along with those of all basic maps in "map".
  */
 static int basic_map_collect_diff(__isl_take isl_basic_map *bmap,
 	__isl_take isl_map *map, struct isl_diff_collector *dc)
@@ -302,6 +304,8 @@ static int basic_map_collect_diff(__isl_take isl_basic_map *bmap,
 	int *n = NULL;
 	int **index = NULL;
 	int **div_map = NULL;
+	isl_vec *v = NULL;
+	unsigned size;
 
 	empty = isl_basic_map_is_empty(bmap);
 	if (empty) {
@@ -327,9 +331,15 @@ static int basic_map_collect_diff(__isl_take isl_basic_map *bmap,
 
 	bmap = isl_basic_map_order_divs(bmap);
 	map = isl_map_order_divs(map);
+	if (!bmap || !map)
+		goto error;
 
+	size = 2 + isl_basic_map_total_dim(bmap);
+	for (i = 0; i < map->n; ++i)
+		size += map->p[i]->n_div;
+	v = isl_vec_alloc(ctx, size);
 	tab = isl_tab_from_basic_map(bmap, 1);
-	if (!tab)
+	if (!v || !tab)
 		goto error;
 
 	modified = 0;
@@ -366,14 +376,14 @@ static int basic_map_collect_diff(__isl_take isl_basic_map *bmap,
 			struct isl_tab_undo *snap2;
 			snap2 = isl_tab_snap(tab);
 			if (tab_add_divs(tab, map->p[level],
-					 &div_map[level]) < 0)
+					 &div_map[level], v) < 0)
 				goto error;
 			offset = tab->n_con;
 			snap[level] = isl_tab_snap(tab);
 			if (tab_freeze_constraints(tab) < 0)
 				goto error;
 			if (tab_add_constraints(tab, map->p[level],
-						div_map[level]) < 0)
+						div_map[level], v) < 0)
 				goto error;
 			k[level] = 0;
 			n[level] = 0;
@@ -396,7 +406,8 @@ static int basic_map_collect_diff(__isl_take isl_basic_map *bmap,
 			if (isl_tab_rollback(tab, snap[level]) < 0)
 				goto error;
 			if (tab_add_constraint(tab, map->p[level],
-					div_map[level], index[level][0], 1) < 0)
+					div_map[level], index[level][0], 1,
+					v) < 0)
 				goto error;
 			level++;
 			continue;
@@ -409,13 +420,13 @@ static int basic_map_collect_diff(__isl_take isl_basic_map *bmap,
 				goto error;
 			if (tab_add_constraint(tab, map->p[level],
 						div_map[level],
-						index[level][k[level]], 0) < 0)
+						index[level][k[level]], 0, v) < 0)
 				goto error;
 			snap[level] = isl_tab_snap(tab);
 			k[level]++;
 			if (tab_add_constraint(tab, map->p[level],
 						div_map[level],
-						index[level][k[level]], 1) < 0)
+						index[level][k[level]], 1, v) < 0)
 				goto error;
 			level++;
 			init = 1;
@@ -423,6 +434,7 @@ static int basic_map_collect_diff(__isl_take isl_basic_map *bmap,
 		}
 	}
 
+	isl_vec_free(v);
 	isl_tab_free(tab);
 	free(snap);
 	free(n);
@@ -439,6 +451,7 @@ static int basic_map_collect_diff(__isl_take isl_basic_map *bmap,
 
 	return 0;
 error:
+	isl_vec_free(v);
 	isl_tab_free(tab);
 	free(snap);
 	free(n);
@@ -491,10 +504,51 @@ static __isl_give isl_map *basic_map_subtract(__isl_take isl_basic_map *bmap,
 	return sdc.diff;
 }
 
+/* Return a map containing those basic maps of "map" that are not
+ * obviously disjoint from basic map "i" of the map from which "boxes1"
+ * was computed, based on the bounds "boxes" computed from "map".
+ */
+static __isl_give isl_map *filter_overlapping(__isl_keep isl_map *map,
+	struct isl_map_plain_boxes *boxes,
+	struct isl_map_plain_boxes *boxes1, int i)
+{
+	int j, n;
+	int *overlap;
+	isl_map *res;
+
+	overlap = isl_alloc_array(map->ctx, int, map->n);
+	if (map->n && !overlap)
+		return NULL;
+	n = 0;
+	for (j = 0; j < map->n; ++j) {
+		overlap[j] = !isl_map_plain_boxes_is_disjoint(boxes1, i,
+							      boxes, j);
+		n += overlap[j];
+	}
+	if (n == map->n) {
+		free(overlap);
+		return isl_map_copy(map);
+	}
+
+	res = isl_map_alloc_space(isl_map_get_space(map), n,
+				  map->flags & ISL_MAP_DISJOINT);
+	for (j = 0; j < map->n; ++j)
+		if (overlap[j])
+			res = isl_map_add_basic_map(res,
+					    isl_basic_map_copy(map->p[j]));
+	free(overlap);
+
+	return res;
+}
+
 /* Return the set difference between map1 and map2.
  * (U_i A_i) \ (U_j B_j) is computed as U_i (A_i \ (U_j B_j))
  *
  * If "map1" and "map2" are disjoint, then simply return "map1".
+ *
+ * The B_j that are obviously disjoint from A_i, based on plain bounds
+ * on the dimensions, are removed before computing A_i \ (U_j B_j),
+ * such that no tableau work is performed on them.
  */
 static __isl_give isl_map *map_subtract( __isl_take isl_map *map1,
 	__isl_take isl_map *map2)
@@ -502,6 +556,7 @@ static __isl_give isl_map *map_subtract( __isl_take isl_map *map1,
 	int i;
 	int disjoint;
 	struct isl_map *diff;
+	struct isl_map_plain_boxes *boxes1 = NULL, *boxes2 = NULL;
 
 	if (!map1 || !map2)
 		goto error;
@@ -524,31 +579,54 @@ static __isl_give isl_map *map_subtract( __isl_take isl_map *map1,
 	map1 = isl_map_remove_empty_parts(map1);
 	map2 = isl_map_remove_empty_parts(map2);
 
+	boxes1 = isl_map_plain_boxes(map1);
+	boxes2 = isl_map_plain_boxes(map2);
+	if (!boxes1 || !boxes2)
+		goto error;
+
 	diff = isl_map_empty_like(map1);
 	for (i = 0; i < map1->n; ++i) {
 		struct isl_map *d;
 		d = basic_map_subtract(isl_basic_map_copy(map1->p[i]),
-				       isl_map_copy(map2));
+				filter_overlapping(map2, boxes2, boxes1, i));
 		if (ISL_F_ISSET(map1, ISL_MAP_DISJOINT))
 			diff = isl_map_union_disjoint(diff, d);
 		else
 			diff = isl_map_union(diff, d);
 	}
 
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
 	isl_map_free(map1);
 	isl_map_free(map2);
 
 	return diff;
 error:
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
 	isl_map_free(map1);
 	isl_map_free(map2);
 	return NULL;
 }
 
+/* Compute "map1" minus "map2".
+ * The temporary objects that are created and destroyed
+ * during the computation are kept in the block cache for reuse
+ * until the computation is finished.
+ */
 __isl_give isl_map *isl_map_subtract( __isl_take isl_map *map1,
 	__isl_take isl_map *map2)
 {
-	return isl_map_align_params_map_map_and(map1, map2, &map_subtract);
+	isl_ctx *ctx = isl_map_get_ctx(map1);
+	struct isl_profile_node *prof;
+
+	prof = isl_profile_enter(ctx, "isl_map_subtract");
+	isl_blk_scope_enter(ctx);
+	map1 = isl_map_align_params_map_map_and(map1, map2, &map_subtract);
+	isl_blk_scope_leave(ctx);
+	isl_profile_leave(ctx, prof);
+
+	return map1;
 }
 
 struct isl_set *isl_set_subtract(struct isl_set *set1, struct isl_set *set2)
@@ -657,21 +735,34 @@ static int basic_map_diff_is_empty(__isl_keep isl_basic_map *bmap,
 
 /* Check if map1 \ map2 is empty by checking if the set difference is empty
  * for each of the basic maps in map1.
+ * As in map_subtract, the basic maps of map2 that are obviously
+ * disjoint from a given basic map of map1 are not taken into account.
  */
 static int map_diff_is_empty(__isl_keep isl_map *map1, __isl_keep isl_map *map2)
 {
 	int i;
 	int is_empty = 1;
+	struct isl_map_plain_boxes *boxes1, *boxes2;
 
 	if (!map1 || !map2)
 		return -1;
-	
-	for (i = 0; i < map1->n; ++i) {
-		is_empty = basic_map_diff_is_empty(map1->p[i], map2);
-		if (is_empty < 0 || !is_empty)
-			 break;
+
+	boxes1 = isl_map_plain_boxes(map1);
+	boxes2 = isl_map_plain_boxes(map2);
+	if (!boxes1 || !boxes2)
+		is_empty = -1;
+
+	for (i = 0; is_empty == 1 && i < map1->n; ++i) {
+		isl_map *filtered;
+
+		filtered = filter_overlapping(map2, boxes2, boxes1, i);
+		is_empty = basic_map_diff_is_empty(map1->p[i], filtered);
+		isl_map_free(filtered);
 	}
 
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
+
 	return is_empty;
 }
 
@@ -841,25 +932,16 @@ int isl_set_is_subset(struct isl_set *set1, struct isl_set *set2)
 			(struct isl_map *)set1, (struct isl_map *)set2);
 }
 
-__isl_give isl_map *isl_map_make_disjoint(__isl_take isl_map *map)
+/* Compute a disjoint representation of "map" by subtracting
+ * the pieces computed for all earlier basic maps of "map"
+ * from each basic map of "map".
+ */
+static __isl_give isl_map *make_disjoint_subtract(__isl_take isl_map *map)
 {
 	int i;
 	struct isl_subtract_diff_collector sdc;
 	sdc.dc.add = &basic_map_subtract_add;
 
-	if (!map)
-		return NULL;
-	if (ISL_F_ISSET(map, ISL_MAP_DISJOINT))
-		return map;
-	if (map->n <= 1)
-		return map;
-
-	map = isl_map_compute_divs(map);
-	map = isl_map_remove_empty_parts(map);
-
-	if (!map || map->n <= 1)
-		return map;
-
 	sdc.diff = isl_map_from_basic_map(isl_basic_map_copy(map->p[0]));
 
 	for (i = 1; i < map->n; ++i) {
@@ -877,6 +959,119 @@ __isl_give isl_map *isl_map_make_disjoint(__isl_take isl_map *map)
 	return sdc.diff;
 }
 
+/* Return the union of the (disjoint) maps piece[j] for j < n.
+ * If "boxes" is not NULL, then only those piece[j] are taken
+ * for which box j in "boxes" is not disjoint from box n.
+ */
+static __isl_give isl_map *union_pieces(__isl_keep isl_map *map,
+	isl_map **piece, int n, struct isl_map_plain_boxes *boxes)
+{
+	int j;
+	int size = 0;
+	isl_map *res;
+
+	for (j = 0; j < n; ++j)
+		size += piece[j]->n;
+	res = isl_map_alloc_space(isl_map_get_space(map), size,
+				  ISL_MAP_DISJOINT);
+	for (j = 0; j < n; ++j) {
+		int k;
+
+		if (boxes && isl_map_plain_boxes_is_disjoint(boxes, n, boxes, j))
+			continue;
+		for (k = 0; k < piece[j]->n; ++k)
+			res = isl_map_add_basic_map(res,
+					isl_basic_map_copy(piece[j]->p[k]));
+	}
+
+	return res;
+}
+
+/* Compute a disjoint representation of "map" in the same way
+ * as make_disjoint_subtract, except that the pieces computed
+ * for an earlier basic map of "map" are only subtracted
+ * if the plain bounding box of that earlier basic map is not
+ * disjoint from the bounding box of the current basic map.
+ * Since the pieces of an earlier basic map are subsets
+ * of that basic map, the other pieces are disjoint from
+ * the current basic map and would only be added to the tableau
+ * of the current basic map to find out that they do not intersect it.
+ *
+ * piece[i] contains the pieces of basic map i.
+ * If "coalesce" is set, then these pieces are coalesced
+ * as soon as they have been computed.  This may reduce
+ * the number of pieces in the result, both directly and
+ * by reducing the number of constraints that need
+ * to be subtracted from later basic maps.
+ */
+static __isl_give isl_map *make_disjoint_filter(__isl_take isl_map *map,
+	int coalesce)
+{
+	int i;
+	isl_ctx *ctx = map->ctx;
+	struct isl_map_plain_boxes *boxes;
+	isl_map **piece;
+	isl_map *res = NULL;
+
+	boxes = isl_map_plain_boxes(map);
+	piece = isl_calloc_array(ctx, isl_map *, map->n);
+	if (!boxes || !piece)
+		goto error;
+
+	for (i = 0; i < map->n; ++i) {
+		struct isl_subtract_diff_collector sdc;
+		isl_map *earlier;
+
+		sdc.dc.add = &basic_map_subtract_add;
+		sdc.diff = isl_map_empty(isl_map_get_space(map));
+		earlier = union_pieces(map, piece, i, boxes);
+		if (basic_map_collect_diff(isl_basic_map_copy(map->p[i]),
+					    earlier, &sdc.dc) < 0)
+			sdc.diff = isl_map_free(sdc.diff);
+		if (coalesce)
+			sdc.diff = isl_map_coalesce(sdc.diff);
+		piece[i] = sdc.diff;
+		if (!piece[i])
+			goto error;
+	}
+
+	res = union_pieces(map, piece, map->n, NULL);
+error:
+	for (i = 0; piece && i < map->n; ++i)
+		isl_map_free(piece[i]);
+	free(piece);
+	isl_map_plain_boxes_free(boxes);
+	isl_map_free(map);
+	return res;
+}
+
+/* Compute a disjoint representation of "map", using the algorithm
+ * selected by the make_disjoint option.
+ */
+__isl_give isl_map *isl_map_make_disjoint(__isl_take isl_map *map)
+{
+	int option;
+
+	if (!map)
+		return NULL;
+	if (ISL_F_ISSET(map, ISL_MAP_DISJOINT))
+		return map;
+	if (map->n <= 1)
+		return map;
+
+	map = isl_map_compute_divs(map);
+	map = isl_map_remove_empty_parts(map);
+
+	if (!map || map->n <= 1)
+		return map;
+
+	option = map->ctx->opt->make_disjoint;
+	if (option == ISL_MAKE_DISJOINT_SUBTRACT)
+		return make_disjoint_subtract(map);
+	return make_disjoint_filter(map,
+				option == ISL_MAKE_DISJOINT_COALESCE);
+}
+
 __isl_give isl_set *isl_set_make_disjoint(__isl_take isl_set *set)
 {
 	return (struct isl_set *)isl_map_make_disjoint((struct isl_map *)set);
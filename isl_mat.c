@@ -9,6 +9,8 @@
  * and Ecole Normale Superieure, 45 rue d'Ulm, 75230 Paris, France
  */
 
+#include <limits.h>
+#include <stdlib.h>
 #include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl/space.h>
@@ -24,23 +26,83 @@ isl_ctx *isl_mat_get_ctx(__isl_keep isl_mat *mat)
 	return mat ? mat->ctx : NULL;
 }
 
+/* Return a fresh isl_mat structure with a row array of (at least)
+ * "n_row" elements, taken from the free list of "ctx" if possible.
+ * The free list entry with the smallest row array that is large enough
+ * is selected.
+ */
+static struct isl_mat *mat_header_alloc(isl_ctx *ctx, unsigned n_row)
+{
+	int i, best = -1;
+	struct isl_mat *mat;
+
+	for (i = 0; i < ctx->n_free_mat; ++i) {
+		if (ctx->free_mat[i]->n_row < n_row)
+			continue;
+		if (best < 0 || ctx->free_mat[i]->n_row <
+				ctx->free_mat[best]->n_row)
+			best = i;
+	}
+	if (best >= 0) {
+		if (isl_ctx_next_operation(ctx) < 0)
+			return NULL;
+		ctx->stats->free_list_hits++;
+		mat = ctx->free_mat[best];
+		ctx->free_mat[best] = ctx->free_mat[--ctx->n_free_mat];
+		return mat;
+	}
+
+	ctx->stats->free_list_misses++;
+	mat = isl_alloc_type(ctx, struct isl_mat);
+	if (!mat)
+		return NULL;
+	mat->row = isl_alloc_array(ctx, isl_int *, n_row);
+	if (n_row && !mat->row) {
+		free(mat);
+		return NULL;
+	}
+	return mat;
+}
+
+/* Release the isl_mat structure "mat" and its row array,
+ * keeping them in the free list of "ctx" if there is room.
+ * The row array has room for at least mat->n_row elements.
+ */
+static void mat_header_free(isl_ctx *ctx, struct isl_mat *mat)
+{
+	if (ctx->n_free_mat < ISL_FREE_LIST_SIZE) {
+		ctx->free_mat[ctx->n_free_mat++] = mat;
+		return;
+	}
+	free(mat->row);
+	free(mat);
+}
+
+/* Free all isl_mat structures kept in the free list of "ctx".
+ */
+void isl_mat_clear_free_list(isl_ctx *ctx)
+{
+	while (ctx->n_free_mat > 0) {
+		struct isl_mat *mat = ctx->free_mat[--ctx->n_free_mat];
+		free(mat->row);
+		free(mat);
+	}
+}
+
 struct isl_mat *isl_mat_alloc(struct isl_ctx *ctx,
 	unsigned n_row, unsigned n_col)
 {
 	int i;
 	struct isl_mat *mat;
 
-	mat = isl_alloc_type(ctx, struct isl_mat);
+	mat = mat_header_alloc(ctx, n_row);
 	if (!mat)
 		return NULL;
 
-	mat->row = NULL;
+	mat->n_row = n_row;
 	mat->block = isl_blk_alloc(ctx, n_row * n_col);
 	if (isl_blk_is_error(mat->block))
 		goto error;
-	mat->row = isl_alloc_array(ctx, isl_int *, n_row);
-	if (n_row && !mat->row)
-		goto error;
 
 	for (i = 0; i < n_row; ++i)
 		mat->row[i] = mat->block.data + i * n_col;
@@ -55,8 +117,7 @@ struct isl_mat *isl_mat_alloc(struct isl_ctx *ctx,
 
 	return mat;
 error:
-	isl_blk_free(ctx, mat->block);
-	free(mat);
+	mat_header_free(ctx, mat);
 	return NULL;
 }
 
@@ -123,12 +184,9 @@ __isl_give isl_mat *isl_mat_sub_alloc6(isl_ctx *ctx, isl_int **row,
 	int i;
 	struct isl_mat *mat;
 
-	mat = isl_alloc_type(ctx, struct isl_mat);
+	mat = mat_header_alloc(ctx, n_row);
 	if (!mat)
 		return NULL;
-	mat->row = isl_alloc_array(ctx, isl_int *, n_row);
-	if (n_row && !mat->row)
-		goto error;
 	for (i = 0; i < n_row; ++i)
 		mat->row[i] = row[first_row+i] + first_col;
 	mat->ctx = ctx;
@@ -139,9 +197,6 @@ __isl_give isl_mat *isl_mat_sub_alloc6(isl_ctx *ctx, isl_int **row,
 	mat->block = isl_blk_empty();
 	mat->flags = ISL_MAT_BORROWED;
 	return mat;
-error:
-	free(mat);
-	return NULL;
 }
 
 __isl_give isl_mat *isl_mat_sub_alloc(__isl_keep isl_mat *mat,
@@ -195,6 +250,26 @@ struct isl_mat *isl_mat_dup(struct isl_mat *mat)
 	return mat2;
 }
 
+/* Return a copy of "mat" that is allocated in "ctx".
+ */
+__isl_give isl_mat *isl_mat_import(isl_ctx *ctx, __isl_keep isl_mat *mat)
+{
+	int i;
+	isl_mat *res;
+
+	if (!mat)
+		return NULL;
+	if (mat->ctx == ctx)
+		return isl_mat_copy(mat);
+
+	res = isl_mat_alloc(ctx, mat->n_row, mat->n_col);
+	if (!res)
+		return NULL;
+	for (i = 0; i < mat->n_row; ++i)
+		isl_seq_cpy(res->row[i], mat->row[i], mat->n_col);
+	return res;
+}
+
 struct isl_mat *isl_mat_cow(struct isl_mat *mat)
 {
 	struct isl_mat *mat2;
@@ -220,8 +295,7 @@ __isl_null isl_mat *isl_mat_free(__isl_take isl_mat *mat)
 	if (!ISL_F_ISSET(mat, ISL_MAT_BORROWED))
 		isl_blk_free(mat->ctx, mat->block);
 	isl_ctx_deref(mat->ctx);
-	free(mat->row);
-	free(mat);
+	mat_header_free(mat->ctx, mat);
 
 	return NULL;
 }
@@ -269,6 +343,29 @@ __isl_give isl_val *isl_mat_get_element_val(__isl_keep isl_mat *mat,
 	return isl_val_int_from_isl_int(ctx, mat->row[row][col]);
 }
 
+/* Store the elements of "mat" in row-major order in "elements",
+ * which is assumed to have room for all of them.
+ * Return -1 if any of the elements does not fit in a long.
+ */
+int isl_mat_get_elements_si(__isl_keep isl_mat *mat, long *elements)
+{
+	int i, j;
+
+	if (!mat)
+		return -1;
+
+	for (i = 0; i < mat->n_row; ++i)
+		for (j = 0; j < mat->n_col; ++j) {
+			if (!isl_int_fits_slong(mat->row[i][j]))
+				isl_die(mat->ctx, isl_error_invalid,
+					"element does not fit in a long",
+					return -1);
+			*elements++ = isl_int_get_si(mat->row[i][j]);
+		}
+
+	return 0;
+}
+
 __isl_give isl_mat *isl_mat_set_element(__isl_take isl_mat *mat,
 	int row, int col, isl_int v)
 {
@@ -550,6 +647,275 @@ static void oppose(struct isl_mat *M, struct isl_mat **U,
 		isl_seq_neg((*Q)->row[col], (*Q)->row[col], (*Q)->n_col);
 }
 
+/* Copies of the matrices M, U and Q of isl_mat_left_hermite
+ * with machine integer entries, stored row by row.
+ * "u" and "q" are NULL if U or Q are not computed.
+ * No entry is ever equal to LONG_MIN, such that entries can always
+ * be negated.
+ */
+struct isl_hermite_long {
+	int n_row;
+	int n_col;
+	long *m;
+	long *u;
+	long *q;
+};
+
+/* Set "*r" to "*r" - "m" * "b", returning -1 if the computation
+ * overflows or if the result is LONG_MIN.
+ * "m" and "b" are assumed not to be LONG_MIN.
+ */
+static int long_submul(long *r, long m, long b)
+{
+	long p;
+
+	if (m == 0 || b == 0)
+		return 0;
+	if (m > 0 ? (b > 0 ? m > LONG_MAX / b : b < LONG_MIN / m) :
+		    (b > 0 ? m < LONG_MIN / b : b < LONG_MAX / m))
+		return -1;
+	p = m * b;
+	if ((p > 0 && *r < LONG_MIN + p) || (p < 0 && *r > LONG_MAX + p))
+		return -1;
+	*r -= p;
+	return *r == LONG_MIN ? -1 : 0;
+}
+
+/* Return floor(a/b) or, if "ceil" is set, ceil(a/b), with b positive.
+ */
+static long long_div_q(long a, long b, int ceil)
+{
+	long q = a / b;
+
+	if (a % b == 0)
+		return q;
+	if (!ceil && a < 0)
+		return q - 1;
+	if (ceil && a > 0)
+		return q + 1;
+	return q;
+}
+
+/* Machine integer version of exchange.
+ */
+static void exchange_long(struct isl_hermite_long *h,
+	unsigned row, unsigned i, unsigned j)
+{
+	int r;
+	long t;
+	int n = h->n_col;
+
+	for (r = row; r < h->n_row; ++r) {
+		t = h->m[r * n + i];
+		h->m[r * n + i] = h->m[r * n + j];
+		h->m[r * n + j] = t;
+	}
+	for (r = 0; h->u && r < n; ++r) {
+		t = h->u[r * n + i];
+		h->u[r * n + i] = h->u[r * n + j];
+		h->u[r * n + j] = t;
+	}
+	for (r = 0; h->q && r < n; ++r) {
+		t = h->q[i * n + r];
+		h->q[i * n + r] = h->q[j * n + r];
+		h->q[j * n + r] = t;
+	}
+}
+
+/* Machine integer version of subtract.
+ * Return -1 if any of the computations overflows.
+ */
+static int subtract_long(struct isl_hermite_long *h,
+	unsigned row, unsigned i, unsigned j, long m)
+{
+	int r;
+	int n = h->n_col;
+
+	for (r = row; r < h->n_row; ++r)
+		if (long_submul(&h->m[r * n + j], m, h->m[r * n + i]) < 0)
+			return -1;
+	for (r = 0; h->u && r < n; ++r)
+		if (long_submul(&h->u[r * n + j], m, h->u[r * n + i]) < 0)
+			return -1;
+	for (r = 0; h->q && r < n; ++r)
+		if (long_submul(&h->q[i * n + r], -m, h->q[j * n + r]) < 0)
+			return -1;
+	return 0;
+}
+
+/* Machine integer version of oppose.
+ */
+static void oppose_long(struct isl_hermite_long *h, unsigned row, unsigned col)
+{
+	int r;
+	int n = h->n_col;
+
+	for (r = row; r < h->n_row; ++r)
+		h->m[r * n + col] = -h->m[r * n + col];
+	for (r = 0; h->u && r < n; ++r)
+		h->u[r * n + col] = -h->u[r * n + col];
+	for (r = 0; h->q && r < n; ++r)
+		h->q[col * n + r] = -h->q[col * n + r];
+}
+
+/* Return the position of the first element in "p" of length "len"
+ * with minimal non-zero absolute value, or -1 if all elements are zero,
+ * as in isl_seq_abs_min_non_zero.
+ */
+static int long_abs_min_non_zero(long *p, unsigned len)
+{
+	int i, min = -1;
+
+	for (i = 0; i < len; ++i) {
+		if (p[i] == 0)
+			continue;
+		if (min < 0 || labs(p[i]) < labs(p[min]))
+			min = i;
+	}
+	return min;
+}
+
+/* Return the position of the first non-zero element in "p"
+ * of length "len", or -1 if all elements are zero.
+ */
+static int long_first_non_zero(long *p, unsigned len)
+{
+	int i;
+
+	for (i = 0; i < len; ++i)
+		if (p[i] != 0)
+			return i;
+	return -1;
+}
+
+/* Perform the computation of isl_mat_left_hermite on the machine
+ * integer copies in "h", following the exact same steps.
+ * Return -1 if any of the computations overflows.
+ */
+static int left_hermite_long_core(struct isl_hermite_long *h, int neg)
+{
+	int row, col;
+	int n = h->n_col;
+	long c;
+
+	col = 0;
+	for (row = 0; row < h->n_row; ++row) {
+		int first, i, off;
+		long *m_row = h->m + row * n;
+
+		first = long_abs_min_non_zero(m_row + col, n - col);
+		if (first == -1)
+			continue;
+		first += col;
+		if (first != col)
+			exchange_long(h, row, first, col);
+		if (m_row[col] < 0)
+			oppose_long(h, row, col);
+		first = col + 1;
+		while ((off = long_first_non_zero(m_row + first,
+						    n - first)) != -1) {
+			first += off;
+			c = long_div_q(m_row[first], m_row[col], 0);
+			if (subtract_long(h, row, col, first, c) < 0)
+				return -1;
+			if (m_row[first] != 0)
+				exchange_long(h, row, first, col);
+			else
+				++first;
+		}
+		for (i = 0; i < col; ++i) {
+			if (m_row[i] == 0)
+				continue;
+			c = long_div_q(m_row[i], m_row[col], neg);
+			if (c == 0)
+				continue;
+			if (subtract_long(h, row, col, i, c) < 0)
+				return -1;
+		}
+		++col;
+	}
+
+	return 0;
+}
+
+/* Return an n x n matrix with the entries in "v", stored row by row.
+ */
+static __isl_give isl_mat *mat_from_long(isl_ctx *ctx, int n, long *v)
+{
+	int i, j;
+	isl_mat *mat;
+
+	mat = isl_mat_alloc(ctx, n, n);
+	if (!mat)
+		return NULL;
+	for (i = 0; i < n; ++i)
+		for (j = 0; j < n; ++j)
+			isl_int_set_si(mat->row[i][j], v[i * n + j]);
+	return mat;
+}
+
+/* Try and compute the result of isl_mat_left_hermite on "M"
+ * using machine integers.
+ * If all entries of "M" fit in a long and none of the intermediate
+ * results overflows, then the result is stored in "M", which
+ * is assumed to be modifiable, and in *U and *Q, if requested,
+ * and 1 is returned.
+ * If some computation overflows, then "M" is left untouched
+ * and 0 is returned, such that the caller can perform
+ * the same computation using arbitrary precision integers.
+ * Since the same steps are performed, the results are identical.
+ */
+static int left_hermite_long(struct isl_mat *M, int neg,
+	struct isl_mat **U, struct isl_mat **Q)
+{
+	int i, j, n;
+	int res = 0;
+	struct isl_hermite_long h = { M->n_row, M->n_col };
+
+	n = M->n_col;
+	if (M->n_row == 0 || n == 0)
+		return 0;
+	for (i = 0; i < M->n_row; ++i)
+		for (j = 0; j < n; ++j)
+			if (!isl_int_fits_slong(M->row[i][j]) ||
+			    isl_int_get_si(M->row[i][j]) == LONG_MIN)
+				return 0;
+
+	h.m = isl_alloc_array(M->ctx, long, M->n_row * n);
+	if (U)
+		h.u = isl_calloc_array(M->ctx, long, n * n);
+	if (Q)
+		h.q = isl_calloc_array(M->ctx, long, n * n);
+	if (!h.m || (U && !h.u) || (Q && !h.q))
+		goto done;
+	for (i = 0; i < M->n_row; ++i)
+		for (j = 0; j < n; ++j)
+			h.m[i * n + j] = isl_int_get_si(M->row[i][j]);
+	for (i = 0; i < n; ++i) {
+		if (h.u)
+			h.u[i * n + i] = 1;
+		if (h.q)
+			h.q[i * n + i] = 1;
+	}
+
+	if (left_hermite_long_core(&h, neg) < 0)
+		goto done;
+
+	if (U)
+		*U = mat_from_long(M->ctx, n, h.u);
+	if (Q)
+		*Q = mat_from_long(M->ctx, n, h.q);
+	res = (U && !*U) || (Q && !*Q) ? -1 : 1;
+	for (i = 0; res > 0 && i < M->n_row; ++i)
+		for (j = 0; j < n; ++j)
+			isl_int_set_si(M->row[i][j], h.m[i * n + j]);
+done:
+	free(h.m);
+	free(h.u);
+	free(h.q);
+	return res;
+}
+
 /* Given matrix M, compute
  *
  *		M U = H
@@ -561,12 +927,19 @@ static void oppose(struct isl_mat *M, struct isl_mat **U,
  * and strictly smaller (in absolute value) than the entries in the echelon
  * column.
  * If U or Q are NULL, then these matrices are not computed.
+ *
+ * Entries may grow significantly during the computation, but they
+ * usually remain small enough to fit in a machine integer.
+ * The computation is therefore first attempted on machine integers
+ * and only performed on arbitrary precision integers if this attempt
+ * detects an overflow.
  */
 struct isl_mat *isl_mat_left_hermite(struct isl_mat *M, int neg,
 	struct isl_mat **U, struct isl_mat **Q)
 {
 	isl_int c;
 	int row, col;
+	int r;
 
 	if (U)
 		*U = NULL;
@@ -577,6 +950,11 @@ struct isl_mat *isl_mat_left_hermite(struct isl_mat *M, int neg,
 	M = isl_mat_cow(M);
 	if (!M)
 		goto error;
+	r = left_hermite_long(M, neg, U, Q);
+	if (r < 0)
+		goto error;
+	if (r > 0)
+		return M;
 	if (U) {
 		*U = isl_mat_identity(M->ctx, M->n_col);
 		if (!*U)
@@ -1549,6 +1927,9 @@ int isl_mat_is_equal(__isl_keep isl_mat *mat1, __isl_keep isl_mat *mat2)
 	if (!mat1 || !mat2)
 		return -1;
 
+	if (mat1 == mat2)
+		return 1;
+
 	if (mat1->n_row != mat2->n_row)
 		return 0;
 
@@ -20,6 +20,10 @@ struct isl_mat {
 	struct isl_blk block;
 };
 
+void isl_mat_clear_free_list(isl_ctx *ctx);
+
+__isl_give isl_mat *isl_mat_import(isl_ctx *ctx, __isl_keep isl_mat *mat);
+
 __isl_give isl_mat *isl_mat_sub_alloc(__isl_keep isl_mat *mat,
 	unsigned first_row, unsigned n_row, unsigned first_col, unsigned n_col);
 __isl_give isl_mat *isl_mat_sub_alloc6(isl_ctx *ctx, isl_int **row,
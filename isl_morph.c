@@ -10,6 +10,7 @@
  * and Ecole Normale Superieure, 45 rue d'Ulm, 75230 Paris, France
  */
 
+#include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl_aff_private.h>
 #include <isl_morph.h>
@@ -17,6 +18,7 @@
 #include <isl_mat_private.h>
 #include <isl_space_private.h>
 #include <isl_equalities.h>
+#include <isl_options_private.h>
 
 isl_ctx *isl_morph_get_ctx(__isl_keep isl_morph *morph)
 {
@@ -457,7 +459,7 @@ error:
  * Both matrices are extended to map the full original space to the full
  * compressed space.
  */
-__isl_give isl_morph *isl_basic_set_variable_compression(
+static __isl_give isl_morph *variable_compression(
 	__isl_keep isl_basic_set *bset, enum isl_dim_type type)
 {
 	unsigned otype;
@@ -576,7 +578,7 @@ error:
  *
  *	p = T p'.
  */
-__isl_give isl_morph *isl_basic_set_parameter_compression(
+static __isl_give isl_morph *parameter_compression(
 	__isl_keep isl_basic_set *bset)
 {
 	unsigned nparam;
@@ -622,6 +624,257 @@ __isl_give isl_morph *isl_basic_set_parameter_compression(
 	return isl_morph_alloc(dom, ran, map, inv);
 }
 
+/* An entry in the compression cache of an isl_ctx.
+ * "morph" is the result of a variable compression on the dimensions
+ * of type "kind" or, if "kind" is isl_dim_all, of a parameter compression,
+ * of a basic set living in "space" with equalities "eq".
+ * "hash" is a hash of "kind", "space" and "eq".
+ */
+struct isl_compression_cache_entry {
+	uint32_t	hash;
+	int		kind;
+	isl_space	*space;
+	isl_mat		*eq;
+	isl_morph	*morph;
+
+	struct isl_compression_cache_entry	*prev;
+	struct isl_compression_cache_entry	*next;
+};
+
+/* A compression of kind "kind" of "bset" that is being looked up
+ * in the compression cache.
+ */
+struct isl_compression_cache_key {
+	uint32_t		hash;
+	int			kind;
+	isl_basic_set		*bset;
+};
+
+static void compression_cache_entry_free(
+	struct isl_compression_cache_entry *entry)
+{
+	if (!entry)
+		return;
+	isl_space_free(entry->space);
+	isl_mat_free(entry->eq);
+	isl_morph_free(entry->morph);
+	free(entry);
+}
+
+/* Remove "entry" from the list of cache entries of "ctx".
+ */
+static void compression_cache_unlink(isl_ctx *ctx,
+	struct isl_compression_cache_entry *entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		ctx->compression_cache_first = entry->next;
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		ctx->compression_cache_last = entry->prev;
+	entry->prev = entry->next = NULL;
+}
+
+/* Add "entry" to the front of the list of cache entries of "ctx".
+ */
+static void compression_cache_push_front(isl_ctx *ctx,
+	struct isl_compression_cache_entry *entry)
+{
+	entry->prev = NULL;
+	entry->next = ctx->compression_cache_first;
+	if (ctx->compression_cache_first)
+		ctx->compression_cache_first->prev = entry;
+	else
+		ctx->compression_cache_last = entry;
+	ctx->compression_cache_first = entry;
+}
+
+/* Remove all entries from the compression cache of "ctx".
+ */
+void isl_compression_cache_clear(isl_ctx *ctx)
+{
+	struct isl_compression_cache_entry *entry, *next;
+
+	for (entry = ctx->compression_cache_first; entry; entry = next) {
+		next = entry->next;
+		compression_cache_entry_free(entry);
+	}
+	ctx->compression_cache_first = ctx->compression_cache_last = NULL;
+	ctx->n_compression_cache = 0;
+	isl_hash_table_clear(&ctx->compression_cache);
+	isl_hash_table_init(ctx, &ctx->compression_cache, 0);
+}
+
+/* Is "entry" a cached compression for the key "val",
+ * i.e., was it computed for the same kind of compression
+ * of a basic set with the same space and the same equalities?
+ */
+static int compression_cache_has_key(const void *entry, const void *val)
+{
+	const struct isl_compression_cache_entry *e = entry;
+	const struct isl_compression_cache_key *key = val;
+	isl_basic_set *bset = key->bset;
+	int i;
+
+	if (e->kind != key->kind)
+		return 0;
+	if (e->eq->n_row != bset->n_eq ||
+	    e->eq->n_col != 1 + isl_basic_set_total_dim(bset))
+		return 0;
+	for (i = 0; i < bset->n_eq; ++i)
+		if (!isl_seq_eq(e->eq->row[i], bset->eq[i], e->eq->n_col))
+			return 0;
+	return isl_space_is_equal(e->space, bset->dim) == 1;
+}
+
+static int compression_cache_is_entry(const void *entry, const void *val)
+{
+	return entry == val;
+}
+
+/* Remove the least recently used entry from the compression cache
+ * of "ctx".
+ */
+static void compression_cache_evict(isl_ctx *ctx)
+{
+	struct isl_compression_cache_entry *entry;
+	struct isl_hash_table_entry *he;
+
+	entry = ctx->compression_cache_last;
+	he = isl_hash_table_find(ctx, &ctx->compression_cache, entry->hash,
+				&compression_cache_is_entry, entry, 0);
+	if (he)
+		isl_hash_table_remove(ctx, &ctx->compression_cache, he);
+	compression_cache_unlink(ctx, entry);
+	compression_cache_entry_free(entry);
+	ctx->n_compression_cache--;
+}
+
+/* Add the compression "morph" described by "key" to the compression
+ * cache of "ctx", evicting the least recently used entries if the cache
+ * would otherwise exceed the size specified by the compression_cache_size
+ * option.
+ */
+static void compression_cache_add(isl_ctx *ctx,
+	struct isl_compression_cache_key *key, __isl_keep isl_morph *morph)
+{
+	int i;
+	isl_basic_set *bset = key->bset;
+	struct isl_compression_cache_entry *entry;
+	struct isl_hash_table_entry *he;
+
+	while (ctx->n_compression_cache > 0 &&
+	       ctx->n_compression_cache >= ctx->opt->compression_cache_size)
+		compression_cache_evict(ctx);
+
+	entry = isl_calloc_type(ctx, struct isl_compression_cache_entry);
+	if (!entry)
+		return;
+	entry->hash = key->hash;
+	entry->kind = key->kind;
+	entry->space = isl_space_copy(bset->dim);
+	entry->eq = isl_mat_alloc(ctx, bset->n_eq,
+				1 + isl_basic_set_total_dim(bset));
+	entry->morph = isl_morph_copy(morph);
+	if (!entry->space || !entry->eq || !entry->morph) {
+		compression_cache_entry_free(entry);
+		return;
+	}
+	for (i = 0; i < bset->n_eq; ++i)
+		isl_seq_cpy(entry->eq->row[i], bset->eq[i], entry->eq->n_col);
+
+	he = isl_hash_table_find(ctx, &ctx->compression_cache, key->hash,
+				&compression_cache_has_key, key, 1);
+	if (!he || he->data) {
+		compression_cache_entry_free(entry);
+		return;
+	}
+	he->data = entry;
+	compression_cache_push_front(ctx, entry);
+	ctx->n_compression_cache++;
+}
+
+/* Compute a compression of "bset" of kind "kind", i.e.,
+ * a variable compression on the dimensions of type "kind" or,
+ * if "kind" is isl_dim_all, a parameter compression.
+ */
+static __isl_give isl_morph *compute_compression(
+	__isl_keep isl_basic_set *bset, int kind)
+{
+	if (kind == isl_dim_all)
+		return parameter_compression(bset);
+	return variable_compression(bset, kind);
+}
+
+/* Compute a compression of "bset" of kind "kind",
+ * reusing the result of an earlier computation if it is available
+ * in the compression cache.
+ *
+ * The compressions only depend on the space and the equalities
+ * of "bset", so the cache is keyed on a hash of those.
+ * Empty basic sets and basic sets without equalities
+ * are handled directly by compute_compression.
+ */
+static __isl_give isl_morph *cached_compression(
+	__isl_keep isl_basic_set *bset, int kind)
+{
+	int i;
+	isl_ctx *ctx;
+	isl_morph *morph;
+	unsigned total;
+	struct isl_compression_cache_key key;
+	struct isl_hash_table_entry *he;
+
+	if (!bset)
+		return NULL;
+
+	ctx = isl_basic_set_get_ctx(bset);
+	if (ctx->opt->compression_cache_size <= 0 || bset->n_eq == 0 ||
+	    isl_basic_set_plain_is_empty(bset))
+		return compute_compression(bset, kind);
+
+	total = isl_basic_set_total_dim(bset);
+	key.kind = kind;
+	key.bset = bset;
+	key.hash = isl_hash_init();
+	isl_hash_byte(key.hash, kind);
+	isl_hash_hash(key.hash, isl_space_get_hash(bset->dim));
+	for (i = 0; i < bset->n_eq; ++i)
+		isl_hash_hash(key.hash, isl_seq_get_hash(bset->eq[i], 1 + total));
+
+	he = isl_hash_table_find(ctx, &ctx->compression_cache, key.hash,
+				&compression_cache_has_key, &key, 0);
+	if (he) {
+		struct isl_compression_cache_entry *entry = he->data;
+
+		ctx->stats->compression_cache_hits++;
+		compression_cache_unlink(ctx, entry);
+		compression_cache_push_front(ctx, entry);
+		return isl_morph_copy(entry->morph);
+	}
+	ctx->stats->compression_cache_misses++;
+
+	morph = compute_compression(bset, kind);
+	if (morph)
+		compression_cache_add(ctx, &key, morph);
+
+	return morph;
+}
+
+__isl_give isl_morph *isl_basic_set_variable_compression(
+	__isl_keep isl_basic_set *bset, enum isl_dim_type type)
+{
+	return cached_compression(bset, type);
+}
+
+__isl_give isl_morph *isl_basic_set_parameter_compression(
+	__isl_keep isl_basic_set *bset)
+{
+	return cached_compression(bset, isl_dim_all);
+}
+
 /* Add stride constraints to "bset" based on the inverse mapping
  * that was plugged in.  In particular, if morph maps x' to x,
  * the the constraints of the original input
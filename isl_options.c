@@ -20,6 +20,7 @@
 struct isl_arg_choice isl_pip_context_choice[] = {
 	{"gbr",		ISL_CONTEXT_GBR},
 	{"lexmin",	ISL_CONTEXT_LEXMIN},
+	{"adaptive",	ISL_CONTEXT_ADAPTIVE},
 	{0}
 };
 
@@ -52,6 +53,14 @@ static struct isl_arg_choice on_error[] = {
 static struct isl_arg_choice isl_schedule_algorithm_choice[] = {
 	{"isl",		ISL_SCHEDULE_ALGORITHM_ISL},
 	{"feautrier",   ISL_SCHEDULE_ALGORITHM_FEAUTRIER},
+	{"cluster",	ISL_SCHEDULE_ALGORITHM_CLUSTER},
+	{0}
+};
+
+static struct isl_arg_choice make_disjoint[] = {
+	{"subtract",	ISL_MAKE_DISJOINT_SUBTRACT},
+	{"filter",	ISL_MAKE_DISJOINT_FILTER},
+	{"coalesce",	ISL_MAKE_DISJOINT_COALESCE},
 	{0}
 };
 
@@ -66,6 +75,13 @@ static struct isl_arg_flags bernstein_recurse[] = {
 	{0}
 };
 
+static struct isl_arg_choice tab_pivot[] = {
+	{"bland",		ISL_TAB_PIVOT_BLAND},
+	{"dantzig",		ISL_TAB_PIVOT_DANTZIG},
+	{"steepest-edge",	ISL_TAB_PIVOT_STEEPEST_EDGE},
+	{0}
+};
+
 static struct isl_arg_choice convex[] = {
 	{"wrap",	ISL_CONVEX_HULL_WRAP},
 	{"fm",		ISL_CONVEX_HULL_FM},
@@ -101,6 +117,12 @@ ISL_ARG_CHOICE(struct isl_options, closure, 0, "closure", \
 	"closure operation to use")
 ISL_ARG_BOOL(struct isl_options, gbr_only_first, 0, "gbr-only-first", 0,
 	"only perform basis reduction in first direction")
+ISL_ARG_INT(struct isl_options, gbr_reuse, 0, "gbr-reuse", "factor", 2,
+	"reuse a reduced basis for sampling the same tableau again as long "
+	"as the widths have grown by at most this factor (0 to disable)")
+ISL_ARG_BOOL(struct isl_options, gbr_lll, 0, "gbr-lll", 1,
+	"pre-reduce the basis using floating point LLL "
+	"before generalized basis reduction")
 ISL_ARG_CHOICE(struct isl_options, bound, 0, "bound", bound,
 	ISL_BOUND_BERNSTEIN, "algorithm to use for computing bounds")
 ISL_ARG_CHOICE(struct isl_options, on_error, 0, "on-error", on_error,
@@ -110,12 +132,59 @@ ISL_ARG_FLAGS(struct isl_options, bernstein_recurse, 0,
 ISL_ARG_BOOL(struct isl_options, bernstein_triangulate, 0,
 	"bernstein-triangulate", 1,
 	"triangulate domains during Bernstein expansion")
+ISL_ARG_BOOL(struct isl_options, pip_split_inherit, 0, "pip-split-inherit", 1,
+	"reuse row signs computed while selecting a context split")
+ISL_ARG_BOOL(struct isl_options, pip_shift, 0, "pip-shift", 1,
+	"shift bounded variables to avoid the big parameter in PIP")
 ISL_ARG_BOOL(struct isl_options, pip_symmetry, 0, "pip-symmetry", 1,
 	"detect simple symmetries in PIP input")
+ISL_ARG_BOOL(struct isl_options, tab_lean, 0, "tab-lean", 1,
+	"only reserve room for the constraints themselves in tableaus "
+	"for pure LP and feasibility queries")
+ISL_ARG_BOOL(struct isl_options, tab_dual_simplex, 0, "tab-dual-simplex", 0,
+	"resolve violated inequalities added to a tableau "
+	"using dual simplex pivots")
+ISL_ARG_CHOICE(struct isl_options, tab_pivot, 0, "tab-pivot", tab_pivot,
+	ISL_TAB_PIVOT_BLAND, "rule for selecting pivot columns in tableaus")
+ISL_ARG_BOOL(struct isl_options, tab_batch_redundant, 0,
+	"tab-batch-redundant", 1,
+	"detect irredundant constraints using shared witness points "
+	"before solving an LP for each constraint")
+ISL_ARG_INT(struct isl_options, tab_batch_redundant_min, 0,
+	"tab-batch-redundant-min", "n", 32, "minimal number of constraints "
+	"in a tableau for using shared witness points")
+ISL_ARG_BOOL(struct isl_options, float_filter, 0, "float-filter", 1,
+	"try and certify the absence of redundant constraints "
+	"using floating point computations before constructing a tableau")
+ISL_ARG_BOOL(struct isl_options, sample_centre_out, 0, "sample-centre-out", 0,
+	"scan the values of each direction during integer sampling "
+	"starting from the middle of their range")
 ISL_ARG_CHOICE(struct isl_options, convex, 0, "convex-hull", \
 	convex,	ISL_CONVEX_HULL_WRAP, "convex hull algorithm to use")
 ISL_ARG_BOOL(struct isl_options, coalesce_bounded_wrapping, 0,
 	"coalesce-bounded-wrapping", 1, "bound wrapping during coalescing")
+ISL_ARG_BOOL(struct isl_options, coalesce_box_filter, 0,
+	"coalesce-box-filter", 1,
+	"skip pairs of basic maps that are separated by a bounding box "
+	"during coalescing")
+ISL_ARG_INT(struct isl_options, simplify_budget, 0, "simplify-budget",
+	"pivots", 0, "maximal number of tableau pivots in a single coalescing "
+	"or gist computation before settling for a less simplified result "
+	"(0 for no limit)")
+ISL_ARG_BOOL(struct isl_options, union_map_lazy_empty, 0,
+	"union-map-lazy-empty", 0,
+	"only remove obviously empty maps from the results of "
+	"union map operations until the union map is coalesced")
+ISL_ARG_BOOL(struct isl_options, compact_on_finalize, 0,
+	"compact-on-finalize", 0,
+	"reallocate finalized basic sets and relations to their exact size "
+	"when they are added to a set or relation")
+ISL_ARG_CHOICE(struct isl_options, make_disjoint, 0, "make-disjoint",
+	make_disjoint, ISL_MAKE_DISJOINT_FILTER,
+	"algorithm for computing disjoint representations")
+ISL_ARG_BOOL(struct isl_options, ilp_prune, 0, "ilp-prune", 1,
+	"only look for better values in the remaining disjuncts "
+	"when optimizing over a set")
 ISL_ARG_INT(struct isl_options, schedule_max_coefficient, 0,
 	"schedule-max-coefficient", "limit", -1, "Only consider schedules "
 	"where the coefficients of the variable and parameter dimensions "
@@ -142,6 +211,9 @@ ISL_ARG_BOOL(struct isl_options, schedule_separate_components, 0,
 ISL_ARG_CHOICE(struct isl_options, schedule_algorithm, 0,
 	"schedule-algorithm", isl_schedule_algorithm_choice,
 	ISL_SCHEDULE_ALGORITHM_ISL, "scheduling algorithm to use")
+ISL_ARG_INT(struct isl_options, schedule_cluster_size, 0,
+	"schedule-cluster-size", "size", 64, "maximal number of statements "
+	"scheduled together by the cluster scheduling algorithm")
 ISL_ARG_CHOICE(struct isl_options, schedule_fuse, 0, "schedule-fuse", fuse,
 	ISL_SCHEDULE_FUSE_MAX, "level of fusion during scheduling")
 ISL_ARG_BOOL(struct isl_options, tile_scale_tile_loops, 0,
@@ -154,6 +226,16 @@ ISL_ARG_STR(struct isl_options, ast_iterator_type, 0,
 ISL_ARG_BOOL(struct isl_options, ast_always_print_block, 0,
 	"ast-always-print-block", 0, "print for and if bodies as a block "
 	"regardless of the number of statements in the body")
+ISL_ARG_BOOL(struct isl_options, ast_print_hoist_bounds, 0,
+	"ast-print-hoist-bounds", 0, "evaluate loop upper bounds "
+	"that do not depend on the loop iterator once before the loop")
+ISL_ARG_BOOL(struct isl_options, ast_print_omp_pragmas, 0,
+	"ast-print-omp-pragmas", 0, "print OpenMP pragmas "
+	"in front of coincident for loops")
+ISL_ARG_BOOL(struct isl_options, ast_print_strength_reduce, 0,
+	"ast-print-strength-reduce", 0, "replace divisions and remainders "
+	"of affine expressions in the loop iterator by incrementally "
+	"updated variables")
 ISL_ARG_BOOL(struct isl_options, ast_build_atomic_upper_bound, 0,
 	"ast-build-atomic-upper-bound", 1, "generate atomic upper bounds")
 ISL_ARG_BOOL(struct isl_options, ast_build_prefer_pdiv, 0,
@@ -175,10 +257,50 @@ ISL_ARG_BOOL(struct isl_options, ast_build_allow_else, 0,
 	"ast-build-allow-else", 1, "generate if statements with else branches")
 ISL_ARG_BOOL(struct isl_options, ast_build_allow_or, 0,
 	"ast-build-allow-or", 1, "generate if conditions with disjunctions")
+ISL_ARG_INT(struct isl_options, ast_build_max_pieces, 0,
+	"ast-build-max-pieces", "limit", 0, "maximal number of statement "
+	"copies generated at a single level by unrolling or separation "
+	"before falling back to atomic code. A value of 0 means no limit.")
 ISL_ARG_BOOL(struct isl_options, print_stats, 0, "print-stats", 0,
 	"print statistics for every isl_ctx")
+ISL_ARG_BOOL(struct isl_options, profile, 0, "profile", 0,
+	"collect (and print) a hierarchical profile of the main entry points "
+	"for every isl_ctx")
+ISL_ARG_BOOL(struct isl_options, profile_allocations, 0,
+	"profile-allocations", 0, "count the allocations performed by "
+	"each of the main entry points, by type and by size")
 ISL_ARG_ULONG(struct isl_options, max_operations, 0,
 	"max-operations", 0, "default number of maximal operations per isl_ctx")
+ISL_ARG_ULONG(struct isl_options, max_memory, 0, "max-memory", 0,
+	"default maximal number of bytes of integer storage per isl_ctx")
+ISL_ARG_INT(struct isl_options, int_pool_size, 0, "int-pool-size", "size",
+	1024, "maximal number of released integers kept for reuse per isl_ctx")
+ISL_ARG_INT(struct isl_options, blk_cache_size, 0, "blk-cache-size", "size",
+	64, "maximal number of released blocks kept for reuse per isl_ctx")
+ISL_ARG_BOOL(struct isl_options, arena, 0, "arena", 0,
+	"take the integer storage of each isl_ctx from a region owned "
+	"by the isl_ctx and release it only when the isl_ctx is freed")
+ISL_ARG_INT(struct isl_options, threads, 0, "threads", "n", 1,
+	"maximal number of threads (including the calling thread) used by "
+	"the computations that can be split over several threads")
+ISL_ARG_BOOL(struct isl_options, deferred_free_thread, 0,
+	"deferred-free-thread", 0, "release the storage kept since "
+	"isl_ctx_defer_free on a background thread")
+ISL_ARG_INT(struct isl_options, sample_cache_size, 0, "sample-cache-size",
+	"size", 0, "maximal number of sampling results cached per isl_ctx")
+ISL_ARG_INT(struct isl_options, flow_cache_size, 0, "flow-cache-size",
+	"size", 0, "maximal number of per-sink dataflow results cached "
+	"per isl_ctx")
+ISL_ARG_INT(struct isl_options, closure_cache_size, 0, "closure-cache-size",
+	"size", 0, "maximal number of power and transitive closure results "
+	"cached per isl_ctx")
+ISL_ARG_INT(struct isl_options, compression_cache_size, 0,
+	"compression-cache-size", "size", 32,
+	"maximal number of equality compressions cached per isl_ctx")
+ISL_ARG_INT(struct isl_options, coefficients_cache_size, 0,
+	"coefficients-cache-size", "size", 32,
+	"maximal number of coefficients and solutions computations "
+	"cached per isl_ctx")
 ISL_ARG_VERSION(print_version)
 ISL_ARGS_END
 
@@ -199,11 +321,154 @@ ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 	coalesce_bounded_wrapping)
 
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	coalesce_box_filter)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	coalesce_box_filter)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	simplify_budget)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	simplify_budget)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	union_map_lazy_empty)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	union_map_lazy_empty)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	compact_on_finalize)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	compact_on_finalize)
+
+ISL_CTX_SET_CHOICE_DEF(isl_options, struct isl_options, isl_options_args,
+	make_disjoint)
+ISL_CTX_GET_CHOICE_DEF(isl_options, struct isl_options, isl_options_args,
+	make_disjoint)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	ilp_prune)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	ilp_prune)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	profile)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	profile)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	profile_allocations)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	profile_allocations)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	int_pool_size)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	int_pool_size)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	blk_cache_size)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	blk_cache_size)
+
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	arena)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	threads)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	threads)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	deferred_free_thread)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	deferred_free_thread)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	sample_cache_size)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	sample_cache_size)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	flow_cache_size)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	flow_cache_size)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	closure_cache_size)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	closure_cache_size)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	compression_cache_size)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	compression_cache_size)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	coefficients_cache_size)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	coefficients_cache_size)
+
 ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 	gbr_only_first)
 ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 	gbr_only_first)
 
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	gbr_reuse)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	gbr_reuse)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	gbr_lll)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	gbr_lll)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	tab_lean)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	tab_lean)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	tab_dual_simplex)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	tab_dual_simplex)
+
+ISL_CTX_SET_CHOICE_DEF(isl_options, struct isl_options, isl_options_args,
+	tab_pivot)
+ISL_CTX_GET_CHOICE_DEF(isl_options, struct isl_options, isl_options_args,
+	tab_pivot)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	tab_batch_redundant)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	tab_batch_redundant)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	tab_batch_redundant_min)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	tab_batch_redundant_min)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	float_filter)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	float_filter)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	sample_centre_out)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	sample_centre_out)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	pip_split_inherit)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	pip_split_inherit)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	pip_shift)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	pip_shift)
+
 ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
 	schedule_max_coefficient)
 ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
@@ -239,6 +504,11 @@ ISL_CTX_SET_CHOICE_DEF(isl_options, struct isl_options, isl_options_args,
 ISL_CTX_GET_CHOICE_DEF(isl_options, struct isl_options, isl_options_args,
 	schedule_algorithm)
 
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	schedule_cluster_size)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	schedule_cluster_size)
+
 ISL_CTX_SET_CHOICE_DEF(isl_options, struct isl_options, isl_options_args,
 	schedule_fuse)
 ISL_CTX_GET_CHOICE_DEF(isl_options, struct isl_options, isl_options_args,
@@ -284,6 +554,21 @@ ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 	ast_always_print_block)
 
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	ast_print_hoist_bounds)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	ast_print_hoist_bounds)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	ast_print_omp_pragmas)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	ast_print_omp_pragmas)
+
+ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	ast_print_strength_reduce)
+ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
+	ast_print_strength_reduce)
+
 ISL_CTX_SET_CHOICE_DEF(isl_options, struct isl_options, isl_options_args,
 	ast_build_separation_bounds)
 ISL_CTX_GET_CHOICE_DEF(isl_options, struct isl_options, isl_options_args,
@@ -303,3 +588,8 @@ ISL_CTX_SET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 	ast_build_allow_or)
 ISL_CTX_GET_BOOL_DEF(isl_options, struct isl_options, isl_options_args,
 	ast_build_allow_or)
+
+ISL_CTX_SET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	ast_build_max_pieces)
+ISL_CTX_GET_INT_DEF(isl_options, struct isl_options, isl_options_args,
+	ast_build_max_pieces)
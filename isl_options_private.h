@@ -6,6 +6,7 @@
 struct isl_options {
 	#define			ISL_CONTEXT_GBR		0
 	#define			ISL_CONTEXT_LEXMIN	1
+	#define			ISL_CONTEXT_ADAPTIVE	2
 	unsigned		context;
 
 	#define			ISL_GBR_NEVER	0
@@ -13,6 +14,8 @@ struct isl_options {
 	#define			ISL_GBR_ALWAYS	2
 	unsigned		gbr;
 	unsigned		gbr_only_first;
+	int			gbr_reuse;
+	unsigned		gbr_lll;
 
 	#define			ISL_CLOSURE_ISL		0
 	#define			ISL_CLOSURE_BOX		1
@@ -28,12 +31,43 @@ struct isl_options {
 	int			bernstein_triangulate;
 
 	int			pip_symmetry;
+	int			pip_split_inherit;
+	int			pip_shift;
+
+	int			tab_lean;
+	int			tab_dual_simplex;
+	int			tab_pivot;
+	int			tab_batch_redundant;
+	int			tab_batch_redundant_min;
+	int			float_filter;
+	int			sample_centre_out;
+	int			sample_cache_size;
 
 	#define			ISL_CONVEX_HULL_WRAP	0
 	#define			ISL_CONVEX_HULL_FM	1
 	int			convex;
 
 	int			coalesce_bounded_wrapping;
+	int			coalesce_box_filter;
+	int			simplify_budget;
+
+	int			union_map_lazy_empty;
+
+	int			compact_on_finalize;
+
+	unsigned		make_disjoint;
+
+
+	int			ilp_prune;
+
+	int			flow_cache_size;
+
+	int			closure_cache_size;
+
+	int			compression_cache_size;
+
+	int			coefficients_cache_size;
+
 
 	int			schedule_max_coefficient;
 	int			schedule_max_constant_term;
@@ -43,6 +77,7 @@ struct isl_options {
 	int			schedule_split_scaled;
 	int			schedule_separate_components;
 	unsigned		schedule_algorithm;
+	int			schedule_cluster_size;
 	int			schedule_fuse;
 
 	int			tile_scale_tile_loops;
@@ -50,6 +85,9 @@ struct isl_options {
 
 	char			*ast_iterator_type;
 	int			ast_always_print_block;
+	int			ast_print_hoist_bounds;
+	int			ast_print_omp_pragmas;
+	int			ast_print_strength_reduce;
 
 	int			ast_build_atomic_upper_bound;
 	int			ast_build_prefer_pdiv;
@@ -59,9 +97,18 @@ struct isl_options {
 	int			ast_build_scale_strides;
 	int			ast_build_allow_else;
 	int			ast_build_allow_or;
+	int			ast_build_max_pieces;
 
 	int			print_stats;
+	int			profile;
+	int			profile_allocations;
 	unsigned long		max_operations;
+	unsigned long		max_memory;
+	int			int_pool_size;
+	int			blk_cache_size;
+	int			arena;
+	int			threads;
+	int			deferred_free_thread;
 };
 
 #endif
@@ -1130,7 +1130,7 @@ struct isl_union_print_data {
 	int first;
 };
 
-static int print_map_body(__isl_take isl_map *map, void *user)
+static int print_map_body(__isl_keep isl_map *map, void *user)
 {
 	struct isl_union_print_data *data;
 	data = (struct isl_union_print_data *)user;
@@ -1140,7 +1140,6 @@ static int print_map_body(__isl_take isl_map *map, void *user)
 	data->first = 0;
 
 	data->p = isl_map_print_isl_body(map, data->p);
-	isl_map_free(map);
 
 	return 0;
 }
@@ -1159,13 +1158,13 @@ static __isl_give isl_printer *isl_union_map_print_isl(
 	}
 	isl_space_free(dim);
 	p = isl_printer_print_str(p, s_open_set[0]);
-	isl_union_map_foreach_map(umap, &print_map_body, &data);
+	isl_union_map_foreach_map_peek(umap, &print_map_body, &data);
 	p = data.p;
 	p = isl_printer_print_str(p, s_close_set[0]);
 	return p;
 }
 
-static int print_latex_map_body(__isl_take isl_map *map, void *user)
+static int print_latex_map_body(__isl_keep isl_map *map, void *user)
 {
 	struct isl_union_print_data *data;
 	data = (struct isl_union_print_data *)user;
@@ -1175,7 +1174,6 @@ static int print_latex_map_body(__isl_take isl_map *map, void *user)
 	data->first = 0;
 
 	data->p = isl_map_print_latex(map, data->p);
-	isl_map_free(map);
 
 	return 0;
 }
@@ -1184,7 +1182,7 @@ static __isl_give isl_printer *isl_union_map_print_latex(
 	__isl_keep isl_union_map *umap, __isl_take isl_printer *p)
 {
 	struct isl_union_print_data data = { p, 1 };
-	isl_union_map_foreach_map(umap, &print_latex_map_body, &data);
+	isl_union_map_foreach_map_peek(umap, &print_latex_map_body, &data);
 	p = data.p;
 	return p;
 }
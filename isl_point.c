@@ -213,6 +213,9 @@ __isl_give isl_point *isl_point_set_coordinate_val(__isl_take isl_point *pnt,
 		isl_die(isl_point_get_ctx(pnt), isl_error_invalid,
 			"expecting rational value", goto error);
 
+	if (type == isl_dim_set)
+		pos += isl_space_dim(pnt->dim, isl_dim_param);
+
 	if (isl_int_eq(pnt->vec->el[1 + pos], v->n) &&
 	    isl_int_eq(pnt->vec->el[0], v->d)) {
 		isl_val_free(v);
@@ -348,30 +351,134 @@ error:
 	return -1;
 }
 
+/* Data used in isl_set_foreach_point_batch.
+ *
+ * "buffer" has room for "max" points of "dim" coordinates each,
+ * of which the first "n" have been filled in.
+ */
+struct isl_foreach_point_batch {
+	struct isl_scan_callback callback;
+	int (*fn)(int64_t *points, int n, void *user);
+	void *user;
+	int64_t *buffer;
+	int max;
+	int n;
+	unsigned dim;
+};
+
+/* Pass the points collected so far to the user callback, if any.
+ */
+static int flush_point_batch(struct isl_foreach_point_batch *fp)
+{
+	int n = fp->n;
+
+	if (n == 0)
+		return 0;
+	fp->n = 0;
+	return fp->fn(fp->buffer, n, fp->user);
+}
+
+/* Copy the parameters and set variables of "sample" to the next
+ * free position in the buffer, passing the buffer to the user callback
+ * when it is full.
+ * Fail if any of the coordinates does not fit in 64 bits.
+ * The coordinates are extracted through a long, so on platforms
+ * where a long is smaller, the check is correspondingly stricter.
+ */
+static int foreach_point_batch(struct isl_scan_callback *cb,
+	__isl_take isl_vec *sample)
+{
+	struct isl_foreach_point_batch *fp;
+	int64_t *pos;
+	int i;
+
+	fp = (struct isl_foreach_point_batch *) cb;
+	if (!sample)
+		return -1;
+
+	pos = fp->buffer + (size_t) fp->n * fp->dim;
+	for (i = 0; i < fp->dim; ++i) {
+		if (!isl_int_fits_slong(sample->el[1 + i]))
+			isl_die(isl_vec_get_ctx(sample), isl_error_invalid,
+				"coordinate does not fit in 64 bits",
+				goto error);
+		pos[i] = isl_int_get_si(sample->el[1 + i]);
+	}
+	isl_vec_free(sample);
+
+	if (++fp->n < fp->max)
+		return 0;
+	return flush_point_batch(fp);
+error:
+	isl_vec_free(sample);
+	return -1;
+}
+
+/* Enumerate the points of "set", storing the values of the parameters
+ * followed by those of the set variables of each point in "buffer",
+ * which is assumed to have room for "max_points" such points.
+ * Each time the buffer is full, as well as at the end of the enumeration
+ * if there are any points left in the buffer, "fn" is called with
+ * the buffer and the number of points in the buffer.
+ * This avoids the construction of an isl_point for each individual point.
+ */
+int isl_set_foreach_point_batch(__isl_keep isl_set *set,
+	int64_t *buffer, int max_points,
+	int (*fn)(int64_t *points, int n, void *user), void *user)
+{
+	struct isl_foreach_point_batch fp = { { &foreach_point_batch },
+						fn, user, buffer, max_points };
+	int i;
+
+	if (!set)
+		return -1;
+	if (!buffer || max_points <= 0)
+		isl_die(isl_set_get_ctx(set), isl_error_invalid,
+			"invalid buffer", return -1);
+
+	fp.dim = isl_set_dim(set, isl_dim_all);
+
+	set = isl_set_copy(set);
+	set = isl_set_cow(set);
+	set = isl_set_make_disjoint(set);
+	set = isl_set_compute_divs(set);
+	if (!set)
+		return -1;
+
+	for (i = 0; i < set->n; ++i)
+		if (isl_basic_set_scan(isl_basic_set_copy(set->p[i]),
+					&fp.callback) < 0)
+			goto error;
+
+	isl_set_free(set);
+
+	return flush_point_batch(&fp);
+error:
+	isl_set_free(set);
+	return -1;
+}
+
 /* Return 1 if "bmap" contains the point "point".
  * "bmap" is assumed to have known divs.
- * The point is first extended with the divs and then passed
- * to basic_map_contains.
+ * If "bmap" has any divs, then "vec" is a vector with room for
+ * at least the coordinates of "point" followed by those divs.
+ * The point is first extended with the divs in "vec"
+ * and then passed to basic_map_contains.
+ * The size of "vec" is adjusted to that of "bmap" such that "vec"
+ * can be reused for other basic maps with a different number of divs.
  */
-int isl_basic_map_contains_point(__isl_keep isl_basic_map *bmap,
-	__isl_keep isl_point *point)
+static int basic_map_contains_point(__isl_keep isl_basic_map *bmap,
+	__isl_keep isl_point *point, __isl_keep isl_vec *vec)
 {
 	int i;
-	struct isl_vec *vec;
 	unsigned dim;
-	int contains;
 
-	if (!bmap || !point)
-		return -1;
 	isl_assert(bmap->ctx, isl_space_is_equal(bmap->dim, point->dim), return -1);
 	if (bmap->n_div == 0)
 		return isl_basic_map_contains(bmap, point->vec);
 
 	dim = isl_basic_map_total_dim(bmap) - bmap->n_div;
-	vec = isl_vec_alloc(bmap->ctx, 1 + dim + bmap->n_div);
-	if (!vec)
-		return -1;
-
+	vec->size = 1 + dim + bmap->n_div;
 	isl_seq_cpy(vec->el, point->vec->el, point->vec->size);
 	for (i = 0; i < bmap->n_div; ++i) {
 		isl_seq_inner_product(bmap->div[i] + 1, vec->el,
@@ -380,16 +487,52 @@ int isl_basic_map_contains_point(__isl_keep isl_basic_map *bmap,
 				bmap->div[i][0]);
 	}
 
-	contains = isl_basic_map_contains(bmap, vec);
+	return isl_basic_map_contains(bmap, vec);
+}
+
+/* Allocate a vector with room for the coordinates of "point"
+ * followed by "n_div" divs.
+ * No vector is needed if there are no divs.
+ */
+static __isl_give isl_vec *alloc_extended(__isl_keep isl_point *point,
+	unsigned n_div)
+{
+	if (n_div == 0)
+		return NULL;
+	return isl_vec_alloc(isl_point_get_ctx(point),
+				point->vec->size + n_div);
+}
 
+int isl_basic_map_contains_point(__isl_keep isl_basic_map *bmap,
+	__isl_keep isl_point *point)
+{
+	isl_vec *vec;
+	int contains;
+
+	if (!bmap || !point)
+		return -1;
+
+	vec = alloc_extended(point, bmap->n_div);
+	if (bmap->n_div && !vec)
+		return -1;
+	contains = basic_map_contains_point(bmap, point, vec);
 	isl_vec_free(vec);
+
 	return contains;
 }
 
+/* Return 1 if "map" contains the point "point".
+ *
+ * A single vector with room for the largest number of divs
+ * in any of the basic maps is used to extend the point with
+ * the values of those divs.
+ */
 int isl_map_contains_point(__isl_keep isl_map *map, __isl_keep isl_point *point)
 {
 	int i;
 	int found = 0;
+	unsigned n_div = 0;
+	isl_vec *vec;
 
 	if (!map || !point)
 		return -1;
@@ -399,17 +542,26 @@ int isl_map_contains_point(__isl_keep isl_map *map, __isl_keep isl_point *point)
 	if (!map)
 		return -1;
 
+	for (i = 0; i < map->n; ++i)
+		if (map->p[i]->n_div > n_div)
+			n_div = map->p[i]->n_div;
+	vec = alloc_extended(point, n_div);
+	if (n_div && !vec)
+		goto error;
+
 	for (i = 0; i < map->n; ++i) {
-		found = isl_basic_map_contains_point(map->p[i], point);
+		found = basic_map_contains_point(map->p[i], point, vec);
 		if (found < 0)
 			goto error;
 		if (found)
 			break;
 	}
+	isl_vec_free(vec);
 	isl_map_free(map);
 
 	return found;
 error:
+	isl_vec_free(vec);
 	isl_map_free(map);
 	return -1;
 }
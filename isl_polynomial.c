@@ -1101,6 +1101,70 @@ error:
 	return NULL;
 }
 
+/* Return a copy of "up" that is allocated in "ctx".
+ */
+static __isl_give struct isl_upoly *upoly_import(isl_ctx *ctx,
+	__isl_keep struct isl_upoly *up)
+{
+	int i;
+	struct isl_upoly_cst *cst, *cst_dup;
+	struct isl_upoly_rec *rec, *dup;
+
+	if (!up)
+		return NULL;
+
+	if (isl_upoly_is_cst(up)) {
+		cst = isl_upoly_as_cst(up);
+		cst_dup = isl_upoly_cst_alloc(ctx);
+		if (!cst_dup)
+			return NULL;
+		isl_int_set(cst_dup->n, cst->n);
+		isl_int_set(cst_dup->d, cst->d);
+		return &cst_dup->up;
+	}
+
+	rec = isl_upoly_as_rec(up);
+	dup = isl_upoly_alloc_rec(ctx, up->var, rec->n);
+	if (!dup)
+		return NULL;
+
+	for (i = 0; i < rec->n; ++i) {
+		dup->p[i] = upoly_import(ctx, rec->p[i]);
+		if (!dup->p[i])
+			goto error;
+		dup->n++;
+	}
+
+	return &dup->up;
+error:
+	isl_upoly_free(&dup->up);
+	return NULL;
+}
+
+/* Return a copy of "qp" that is allocated in "ctx".
+ */
+__isl_give isl_qpolynomial *isl_qpolynomial_import(isl_ctx *ctx,
+	__isl_keep isl_qpolynomial *qp)
+{
+	int i;
+	isl_qpolynomial *dup;
+
+	if (!qp)
+		return NULL;
+	if (qp->dim->ctx == ctx)
+		return isl_qpolynomial_copy(qp);
+
+	dup = isl_qpolynomial_alloc(isl_space_import(ctx, qp->dim),
+			qp->div->n_row, upoly_import(ctx, qp->upoly));
+	if (!dup)
+		return NULL;
+	for (i = 0; i < qp->div->n_row; ++i)
+		isl_seq_cpy(dup->div->row[i], qp->div->row[i],
+				qp->div->n_col);
+
+	return dup;
+}
+
 __isl_give isl_qpolynomial *isl_qpolynomial_cow(__isl_take isl_qpolynomial *qp)
 {
 	if (!qp)
@@ -2817,10 +2881,13 @@ __isl_give isl_pw_qpolynomial *isl_pw_qpolynomial_mul(
 {
 	int i, j, n;
 	struct isl_pw_qpolynomial *res;
+	isl_ctx *ctx;
+	struct isl_map_plain_boxes *boxes1 = NULL, *boxes2 = NULL;
 
 	if (!pwqp1 || !pwqp2)
 		goto error;
 
+	ctx = isl_pw_qpolynomial_get_ctx(pwqp1);
 	isl_assert(pwqp1->dim->ctx, isl_space_is_equal(pwqp1->dim, pwqp2->dim),
 			goto error);
 
@@ -2844,6 +2911,11 @@ __isl_give isl_pw_qpolynomial *isl_pw_qpolynomial_mul(
 		return pwqp1;
 	}
 
+	boxes1 = isl_pw_qpolynomial_plain_boxes(pwqp1);
+	boxes2 = isl_pw_qpolynomial_plain_boxes(pwqp2);
+	if (!boxes1 || !boxes2)
+		goto error;
+
 	n = pwqp1->n * pwqp2->n;
 	res = isl_pw_qpolynomial_alloc_size(isl_space_copy(pwqp1->dim), n);
 
@@ -2851,6 +2923,9 @@ __isl_give isl_pw_qpolynomial *isl_pw_qpolynomial_mul(
 		for (j = 0; j < pwqp2->n; ++j) {
 			struct isl_set *common;
 			struct isl_qpolynomial *prod;
+			if (isl_pw_qpolynomial_pieces_plain_disjoint(ctx,
+						boxes1, i, boxes2, j))
+				continue;
 			common = isl_set_intersect(isl_set_copy(pwqp1->p[i].set),
 						isl_set_copy(pwqp2->p[j].set));
 			if (isl_set_plain_is_empty(common)) {
@@ -2866,11 +2941,15 @@ __isl_give isl_pw_qpolynomial *isl_pw_qpolynomial_mul(
 		}
 	}
 
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
 	isl_pw_qpolynomial_free(pwqp1);
 	isl_pw_qpolynomial_free(pwqp2);
 
 	return res;
 error:
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
 	isl_pw_qpolynomial_free(pwqp1);
 	isl_pw_qpolynomial_free(pwqp2);
 	return NULL;
@@ -4384,6 +4463,248 @@ error:
 	return NULL;
 }
 
+/* Compute the coefficient of the variable at position "xpos"
+ * in each of the integer divisions of "qp", after expanding
+ * any nested integer divisions.
+ * That is, if integer division i is of the form
+ *
+ *	floor((c x + sum_j e_j d_j + r)/m)
+ *
+ * with the d_j earlier integer divisions, then its coefficient
+ * in x is (c + sum_j e_j v_j)/m, with v_j the coefficient of d_j.
+ * The (rational) coefficient of integer division i is stored
+ * in num->el[i]/den->el[i].
+ */
+static int div_var_coefficients(__isl_keep isl_qpolynomial *qp, int xpos,
+	__isl_keep isl_vec *num, __isl_keep isl_vec *den)
+{
+	int i, j;
+	unsigned total;
+	isl_int g;
+
+	total = isl_space_dim(qp->dim, isl_dim_all);
+	isl_int_init(g);
+	for (i = 0; i < qp->div->n_row; ++i) {
+		isl_int *row = qp->div->row[i];
+
+		isl_int_set(num->el[i], row[2 + xpos]);
+		isl_int_set_si(den->el[i], 1);
+		for (j = 0; j < i; ++j) {
+			if (isl_int_is_zero(row[2 + total + j]))
+				continue;
+			if (isl_int_is_zero(num->el[j]))
+				continue;
+			isl_int_mul(num->el[i], num->el[i], den->el[j]);
+			isl_int_mul(g, row[2 + total + j], num->el[j]);
+			isl_int_addmul(num->el[i], g, den->el[i]);
+			isl_int_mul(den->el[i], den->el[i], den->el[j]);
+			isl_int_gcd(g, num->el[i], den->el[i]);
+			if (!isl_int_is_zero(g) && !isl_int_is_one(g)) {
+				isl_int_divexact(num->el[i], num->el[i], g);
+				isl_int_divexact(den->el[i], den->el[i], g);
+			}
+		}
+		isl_int_mul(den->el[i], den->el[i], row[0]);
+		isl_int_gcd(g, num->el[i], den->el[i]);
+		if (!isl_int_is_zero(g) && !isl_int_is_one(g)) {
+			isl_int_divexact(num->el[i], num->el[i], g);
+			isl_int_divexact(den->el[i], den->el[i], g);
+		}
+	}
+	isl_int_clear(g);
+
+	return 0;
+}
+
+/* Compute the smallest positive integer "period" such that
+ * replacing the variable at position "pos" of type "type" in "qp"
+ * by "period" times a new variable plus a constant results
+ * in integer divisions that are affine in this new variable.
+ * In particular, "period" is one if none of the integer divisions
+ * involves the variable.
+ */
+int isl_qpolynomial_var_period(__isl_keep isl_qpolynomial *qp,
+	enum isl_dim_type type, unsigned t_pos, isl_int *period)
+{
+	int i;
+	isl_vec *num, *den;
+
+	if (!qp)
+		return -1;
+	if (type == isl_dim_in)
+		type = isl_dim_set;
+	isl_assert(qp->dim->ctx, t_pos < isl_space_dim(qp->dim, type),
+			return -1);
+
+	num = isl_vec_alloc(qp->dim->ctx, qp->div->n_row);
+	den = isl_vec_alloc(qp->dim->ctx, qp->div->n_row);
+	if (!num || !den)
+		goto error;
+
+	div_var_coefficients(qp, pos(qp->dim, type) + t_pos, num, den);
+
+	isl_int_set_si(*period, 1);
+	for (i = 0; i < qp->div->n_row; ++i)
+		isl_int_lcm(*period, *period, den->el[i]);
+
+	isl_vec_free(num);
+	isl_vec_free(den);
+	return 0;
+error:
+	isl_vec_free(num);
+	isl_vec_free(den);
+	return -1;
+}
+
+/* Replace all integer divisions that do not involve any variables
+ * by their constant values.
+ */
+static __isl_give isl_qpolynomial *substitute_cst_divs(
+	__isl_take isl_qpolynomial *qp)
+{
+	int i, j;
+	int total;
+	isl_int v;
+	struct isl_upoly *s;
+
+	if (!qp)
+		return NULL;
+
+	total = isl_space_dim(qp->dim, isl_dim_all);
+	isl_int_init(v);
+	for (i = 0; qp && i < qp->div->n_row; ++i) {
+		if (isl_seq_first_non_zero(qp->div->row[i] + 2,
+					    total + qp->div->n_row) != -1)
+			continue;
+		isl_int_fdiv_q(v, qp->div->row[i][1], qp->div->row[i][0]);
+		for (j = i + 1; j < qp->div->n_row; ++j) {
+			if (isl_int_is_zero(qp->div->row[j][2 + total + i]))
+				continue;
+			isl_int_addmul(qp->div->row[j][1],
+				qp->div->row[j][2 + total + i], v);
+			isl_int_set_si(qp->div->row[j][2 + total + i], 0);
+			normalize_div(qp, j);
+		}
+		s = isl_upoly_rat_cst(qp->dim->ctx, v, qp->dim->ctx->one);
+		qp = substitute_div(qp, i, s);
+		--i;
+	}
+	isl_int_clear(v);
+
+	return qp;
+}
+
+/* Replace the variable x at position "pos" of type "type" in "qp"
+ * by "period" * x + "residue", where "period" is assumed to be
+ * a multiple of the period computed by isl_qpolynomial_var_period.
+ * Each integer division d_i of "qp" can then be written as
+ * alpha_i x + d'_i, with alpha_i an integer and d'_i an integer
+ * division that does not involve x.
+ * The integer divisions are replaced by the d'_i and every
+ * occurrence of d_i in the polynomial is replaced by alpha_i x + d'_i.
+ *
+ * In particular, if d_i is of the form
+ *
+ *	floor((c x + sum_j e_j d_j + r)/m)
+ *
+ * then after the substitution, it is equal to
+ *
+ *	floor((c (period x + residue) + sum_j e_j (alpha_j x + d'_j) + r)/m)
+ *
+ * with m alpha_i = c period + sum_j e_j alpha_j, such that
+ * d'_i is obtained by adding c residue to the constant term
+ * and removing the coefficient of x.
+ * Integer divisions that end up being constant are replaced
+ * by their values.
+ */
+__isl_give isl_qpolynomial *isl_qpolynomial_substitute_var_period(
+	__isl_take isl_qpolynomial *qp, enum isl_dim_type type, unsigned t_pos,
+	isl_int period, isl_int residue)
+{
+	int i;
+	unsigned total, xpos, n_sub;
+	isl_ctx *ctx;
+	isl_vec *num = NULL, *den = NULL;
+	struct isl_upoly **subs = NULL;
+
+	qp = isl_qpolynomial_cow(qp);
+	if (!qp)
+		return NULL;
+	if (type == isl_dim_in)
+		type = isl_dim_set;
+	ctx = qp->dim->ctx;
+	isl_assert(ctx, t_pos < isl_space_dim(qp->dim, type), goto error);
+
+	qp->div = isl_mat_cow(qp->div);
+	if (!qp->div)
+		goto error;
+
+	total = isl_space_dim(qp->dim, isl_dim_all);
+	xpos = pos(qp->dim, type) + t_pos;
+	n_sub = total + qp->div->n_row - xpos;
+
+	num = isl_vec_alloc(ctx, qp->div->n_row);
+	den = isl_vec_alloc(ctx, qp->div->n_row);
+	subs = isl_calloc_array(ctx, struct isl_upoly *, n_sub);
+	if (!num || !den || !subs)
+		goto error;
+
+	div_var_coefficients(qp, xpos, num, den);
+
+	subs[0] = isl_upoly_var_pow(ctx, xpos, 1);
+	subs[0] = isl_upoly_mul_isl_int(subs[0], period);
+	subs[0] = isl_upoly_sum(subs[0],
+			isl_upoly_rat_cst(ctx, residue, ctx->one));
+	for (i = xpos + 1; i < total + qp->div->n_row; ++i)
+		subs[i - xpos] = isl_upoly_var_pow(ctx, i, 1);
+	for (i = 0; i < qp->div->n_row; ++i) {
+		isl_int *row = qp->div->row[i];
+		struct isl_upoly *t;
+
+		if (!isl_int_is_divisible_by(period, den->el[i]))
+			isl_die(ctx, isl_error_invalid,
+				"period not compatible with integer divisions",
+				goto error);
+		if (!isl_int_is_zero(num->el[i])) {
+			isl_int_divexact(den->el[i], period, den->el[i]);
+			isl_int_mul(num->el[i], num->el[i], den->el[i]);
+			t = isl_upoly_var_pow(ctx, xpos, 1);
+			t = isl_upoly_mul_isl_int(t, num->el[i]);
+			subs[total + i - xpos] =
+				isl_upoly_sum(subs[total + i - xpos], t);
+		}
+
+		isl_int_addmul(row[1], row[2 + xpos], residue);
+		isl_int_set_si(row[2 + xpos], 0);
+	}
+
+	for (i = 0; i < n_sub; ++i)
+		if (!subs[i])
+			goto error;
+
+	qp->upoly = isl_upoly_subs(qp->upoly, xpos, n_sub, subs);
+
+	for (i = 0; i < n_sub; ++i)
+		isl_upoly_free(subs[i]);
+	free(subs);
+	isl_vec_free(num);
+	isl_vec_free(den);
+
+	if (!qp->upoly)
+		return isl_qpolynomial_free(qp);
+
+	return substitute_cst_divs(qp);
+error:
+	if (subs)
+		for (i = 0; i < n_sub; ++i)
+			isl_upoly_free(subs[i]);
+	free(subs);
+	isl_vec_free(num);
+	isl_vec_free(den);
+	isl_qpolynomial_free(qp);
+	return NULL;
+}
+
 /* Construct a piecewise quasipolynomial that is constant on the given
  * domain.  In particular, it is
  *	0	if cst == 0
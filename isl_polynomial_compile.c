@@ -0,0 +1,343 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <math.h>
+#include <isl_ctx_private.h>
+#include <isl_mat_private.h>
+#include <isl_val_private.h>
+#include <isl_polynomial_private.h>
+#include <isl_compile_private.h>
+
+/* A single monomial of a compiled quasi-polynomial.
+ * "coef" is the coefficient and the monomial is the product
+ * of the values at positions pos[i] raised to the powers exp[i]
+ * for "first" <= i < "first" + "n" in the factor arrays
+ * of the compiled piecewise quasi-polynomial.
+ */
+struct isl_compiled_term {
+	double coef;
+	int first;
+	int n;
+};
+
+/* A piece of a compiled piecewise quasi-polynomial.
+ * The domain of piece i is set i of the compiled domain.
+ * If "cst" is not zero, then the value on the domain is "cst"
+ * (which is then infinite or NaN).  Otherwise, it is the sum
+ * of the terms "first_term" up to "first_term" + "n_term".
+ */
+struct isl_compiled_piece {
+	double cst;
+	int first_term;
+	int n_term;
+};
+
+/* A piecewise quasi-polynomial that has been compiled into
+ * flat tables for fast evaluation.
+ *
+ * "dom" contains the domains of all pieces, along with all
+ * integer divisions that appear in the domains or in the terms.
+ * The positions in "pos" refer to the values computed by "dom",
+ * i.e., the inputs followed by the integer divisions.
+ *
+ * "map" is only used during construction and maps the integer
+ * divisions of the current quasi-polynomial to those of "dom".
+ */
+struct isl_pw_qpolynomial_compiled {
+	struct isl_compiled_domain *dom;
+
+	int n_piece;
+	int size_piece;
+	struct isl_compiled_piece *piece;
+
+	int n_term;
+	int size_term;
+	struct isl_compiled_term *term;
+
+	int n_factor;
+	int *pos;
+	int *exp;
+
+	int *map;
+};
+
+__isl_null isl_pw_qpolynomial_compiled *isl_pw_qpolynomial_compiled_free(
+	__isl_take isl_pw_qpolynomial_compiled *c)
+{
+	if (!c)
+		return NULL;
+
+	isl_compiled_domain_free(c->dom);
+	free(c->piece);
+	free(c->term);
+	free(c->pos);
+	free(c->exp);
+	free(c->map);
+	free(c);
+
+	return NULL;
+}
+
+/* Return the number of inputs of each point passed
+ * to the evaluation functions.
+ */
+int isl_pw_qpolynomial_compiled_dim(__isl_keep isl_pw_qpolynomial_compiled *c)
+{
+	return c ? c->dom->n_in : -1;
+}
+
+/* Add the term "term" to the last piece of "c".
+ */
+static int add_term(__isl_take isl_term *term, void *user)
+{
+	isl_pw_qpolynomial_compiled *c = user;
+	isl_ctx *ctx = c->dom->ctx;
+	int n_in = c->dom->n_in;
+	struct isl_compiled_term *ct;
+	isl_val *v;
+	int i, n;
+
+	if (!term)
+		return -1;
+
+	n = n_in + term->div->n_row;
+	if (c->n_term >= c->size_term) {
+		c->size_term = 2 * c->size_term + 4;
+		c->term = isl_realloc_array(ctx, c->term,
+				struct isl_compiled_term, c->size_term);
+		if (!c->term)
+			goto error;
+	}
+	c->pos = isl_realloc_array(ctx, c->pos, int, c->n_factor + n);
+	c->exp = isl_realloc_array(ctx, c->exp, int, c->n_factor + n);
+	if (n && (!c->pos || !c->exp))
+		goto error;
+
+	ct = &c->term[c->n_term++];
+	v = isl_val_rat_from_isl_int(ctx, term->n, term->d);
+	ct->coef = isl_val_get_d(v);
+	isl_val_free(v);
+	ct->first = c->n_factor;
+	ct->n = 0;
+	for (i = 0; i < n; ++i) {
+		if (!term->pow[i])
+			continue;
+		c->pos[c->n_factor] = i < n_in ? i : n_in + c->map[i - n_in];
+		c->exp[c->n_factor] = term->pow[i];
+		c->n_factor++;
+		ct->n++;
+	}
+
+	isl_term_free(term);
+	return 0;
+error:
+	isl_term_free(term);
+	return -1;
+}
+
+/* Add the piece with domain "set" and quasi-polynomial "qp" to "c".
+ */
+static int add_piece(__isl_take isl_set *set, __isl_take isl_qpolynomial *qp,
+	void *user)
+{
+	isl_pw_qpolynomial_compiled *c = user;
+	struct isl_compiled_piece *cp;
+
+	if (!set || !qp)
+		goto error;
+	if (c->n_piece >= c->size_piece) {
+		c->size_piece = 2 * c->size_piece + 4;
+		c->piece = isl_realloc_array(c->dom->ctx, c->piece,
+				struct isl_compiled_piece, c->size_piece);
+		if (!c->piece)
+			goto error;
+	}
+
+	cp = &c->piece[c->n_piece++];
+	cp->cst = 0;
+	cp->first_term = c->n_term;
+	cp->n_term = 0;
+
+	if (isl_compiled_domain_add_set(c->dom, set) < 0)
+		goto error_qp;
+
+	if (isl_qpolynomial_is_infty(qp))
+		cp->cst = HUGE_VAL;
+	else if (isl_qpolynomial_is_neginfty(qp))
+		cp->cst = -HUGE_VAL;
+	else if (isl_qpolynomial_is_nan(qp))
+		cp->cst = NAN;
+	if (cp->cst == 0) {
+		free(c->map);
+		c->map = isl_alloc_array(c->dom->ctx, int, qp->div->n_row);
+		if (qp->div->n_row && !c->map)
+			goto error_qp;
+		if (isl_compiled_domain_map_divs(c->dom, qp->div, c->map) < 0)
+			goto error_qp;
+		if (isl_qpolynomial_foreach_term(qp, &add_term, c) < 0)
+			goto error_qp;
+		cp->n_term = c->n_term - cp->first_term;
+	}
+
+	isl_qpolynomial_free(qp);
+	return 0;
+error:
+	isl_set_free(set);
+error_qp:
+	isl_qpolynomial_free(qp);
+	return -1;
+}
+
+/* Compile "pwqp" into flat tables that allow for the evaluation
+ * of "pwqp" on many points without using any isl objects.
+ *
+ * Each piece is represented by the constraints of the basic sets
+ * in its domain and by the list of terms of its quasi-polynomial.
+ * All integer divisions that appear in any of the domains or
+ * quasi-polynomials are collected in a single table,
+ * such that they can be evaluated once per point.
+ * Each term is stored as a floating point coefficient and a sparse
+ * list of (position, exponent) pairs.
+ * Compilation fails if any of the coefficients of the integer divisions
+ * or the constraints does not fit in 64 bits.
+ */
+__isl_give isl_pw_qpolynomial_compiled *isl_pw_qpolynomial_compile(
+	__isl_keep isl_pw_qpolynomial *pwqp)
+{
+	isl_ctx *ctx;
+	isl_pw_qpolynomial_compiled *c;
+	int n_in;
+
+	if (!pwqp)
+		return NULL;
+
+	ctx = isl_pw_qpolynomial_get_ctx(pwqp);
+	c = isl_calloc_type(ctx, isl_pw_qpolynomial_compiled);
+	if (!c)
+		return NULL;
+	n_in = isl_pw_qpolynomial_dim(pwqp, isl_dim_param) +
+		isl_pw_qpolynomial_dim(pwqp, isl_dim_in);
+	c->dom = isl_compiled_domain_alloc(ctx, n_in);
+	if (!c->dom)
+		return isl_pw_qpolynomial_compiled_free(c);
+
+	if (isl_pw_qpolynomial_foreach_piece(pwqp, &add_piece, c) < 0)
+		return isl_pw_qpolynomial_compiled_free(c);
+	if (isl_compiled_domain_finalize(c->dom) < 0)
+		return isl_pw_qpolynomial_compiled_free(c);
+
+	return c;
+}
+
+/* Evaluate the terms of piece "cp" of "c" at the values "val".
+ */
+static double eval_terms(__isl_keep isl_pw_qpolynomial_compiled *c,
+	struct isl_compiled_piece *cp, double *val)
+{
+	int i, j, k;
+	double sum = 0;
+
+	if (cp->cst != 0)
+		return cp->cst;
+
+	for (i = cp->first_term; i < cp->first_term + cp->n_term; ++i) {
+		struct isl_compiled_term *ct = &c->term[i];
+		double t = ct->coef;
+
+		for (j = ct->first; j < ct->first + ct->n; ++j)
+			for (k = 0; k < c->exp[j]; ++k)
+				t *= val[c->pos[j]];
+		sum += t;
+	}
+
+	return sum;
+}
+
+/* Evaluate the compiled piecewise quasi-polynomial "c" at the "n" points
+ * in "points", each consisting of isl_pw_qpolynomial_compiled_dim(c)
+ * values, storing the results in "values".
+ *
+ * The integer divisions and the constraints are evaluated exactly,
+ * failing if any of the intermediate results overflows,
+ * while the terms are evaluated in floating point.
+ */
+int isl_pw_qpolynomial_compiled_eval_int64(
+	__isl_keep isl_pw_qpolynomial_compiled *c, int n,
+	const int64_t *points, double *values)
+{
+	struct isl_compiled_domain *dom;
+	int i, j, p;
+	int64_t *ival;
+	double *val;
+	int n_val;
+
+	if (!c)
+		return -1;
+
+	dom = c->dom;
+	n_val = dom->n_in + dom->n_div;
+	ival = isl_alloc_array(dom->ctx, int64_t, n_val);
+	val = isl_alloc_array(dom->ctx, double, n_val);
+	if (n_val && (!ival || !val))
+		goto error;
+
+	for (i = 0; i < n; ++i) {
+		const int64_t *pnt = points + (size_t) i * dom->n_in;
+
+		if (isl_compiled_domain_eval_divs_int64(dom, pnt, ival) < 0)
+			goto error;
+		for (j = 0; j < n_val; ++j)
+			val[j] = (double) ival[j];
+
+		if (isl_compiled_domain_locate_int64(dom, ival, &p) < 0)
+			goto error;
+		values[i] = p >= 0 ? eval_terms(c, &c->piece[p], val) : 0;
+	}
+
+	free(ival);
+	free(val);
+	return 0;
+error:
+	free(ival);
+	free(val);
+	return -1;
+}
+
+/* Evaluate the compiled piecewise quasi-polynomial "c" at the "n" points
+ * in "points", each consisting of isl_pw_qpolynomial_compiled_dim(c)
+ * values, storing the results in "values".
+ *
+ * All computations are performed in floating point.
+ * The input values are assumed to be integral.
+ */
+int isl_pw_qpolynomial_compiled_eval_double(
+	__isl_keep isl_pw_qpolynomial_compiled *c, int n,
+	const double *points, double *values)
+{
+	struct isl_compiled_domain *dom;
+	int i, p;
+	double *val;
+	int n_val;
+
+	if (!c)
+		return -1;
+
+	dom = c->dom;
+	n_val = dom->n_in + dom->n_div;
+	val = isl_alloc_array(dom->ctx, double, n_val);
+	if (n_val && !val)
+		return -1;
+
+	for (i = 0; i < n; ++i) {
+		const double *pnt = points + (size_t) i * dom->n_in;
+
+		isl_compiled_domain_eval_divs_double(dom, pnt, val);
+
+		p = isl_compiled_domain_locate_double(dom, val);
+		values[i] = p >= 0 ? eval_terms(c, &c->piece[p], val) : 0;
+	}
+
+	free(val);
+	return 0;
+}
@@ -122,6 +122,8 @@ __isl_give isl_qpolynomial *isl_qpolynomial_alloc(__isl_take isl_space *dim,
 	unsigned n_div, __isl_take struct isl_upoly *up);
 __isl_give isl_qpolynomial *isl_qpolynomial_cow(__isl_take isl_qpolynomial *qp);
 __isl_give isl_qpolynomial *isl_qpolynomial_dup(__isl_keep isl_qpolynomial *qp);
+__isl_give isl_qpolynomial *isl_qpolynomial_import(isl_ctx *ctx,
+	__isl_keep isl_qpolynomial *qp);
 
 __isl_give isl_qpolynomial *isl_qpolynomial_cst_on_domain(__isl_take isl_space *dim,
 	isl_int v);
@@ -157,6 +159,12 @@ __isl_give isl_pw_qpolynomial *isl_pw_qpolynomial_add_piece(
 	__isl_take isl_set *set, __isl_take isl_qpolynomial *qp);
 int isl_pw_qpolynomial_is_one(__isl_keep isl_pw_qpolynomial *pwqp);
 
+int isl_qpolynomial_var_period(__isl_keep isl_qpolynomial *qp,
+	enum isl_dim_type type, unsigned pos, isl_int *period);
+__isl_give isl_qpolynomial *isl_qpolynomial_substitute_var_period(
+	__isl_take isl_qpolynomial *qp, enum isl_dim_type type, unsigned pos,
+	isl_int period, isl_int residue);
+
 __isl_give isl_pw_qpolynomial *isl_pw_qpolynomial_project_out(
 	__isl_take isl_pw_qpolynomial *pwqp,
 	enum isl_dim_type type, unsigned first, unsigned n);
@@ -170,6 +178,8 @@ __isl_give isl_qpolynomial_fold *isl_qpolynomial_fold_cow(
 	__isl_take isl_qpolynomial_fold *fold);
 __isl_give isl_qpolynomial_fold *isl_qpolynomial_fold_dup(
 	__isl_keep isl_qpolynomial_fold *fold);
+__isl_give isl_qpolynomial_fold *isl_qpolynomial_fold_import(isl_ctx *ctx,
+	__isl_keep isl_qpolynomial_fold *fold);
 
 __isl_give isl_pw_qpolynomial_fold *isl_pw_qpolynomial_fold_cow(
 	__isl_take isl_pw_qpolynomial_fold *pwf);
@@ -4,14 +4,22 @@
 
 static __isl_give isl_printer *file_start_line(__isl_take isl_printer *p)
 {
-	fprintf(p->file, "%s%*s%s", p->indent_prefix ? p->indent_prefix : "",
-				    p->indent, "", p->prefix ? p->prefix : "");
+	int i;
+
+	if (p->indent_prefix)
+		fputs(p->indent_prefix, p->file);
+	for (i = 0; i < p->indent; ++i)
+		putc(' ', p->file);
+	if (p->prefix)
+		fputs(p->prefix, p->file);
 	return p;
 }
 
 static __isl_give isl_printer *file_end_line(__isl_take isl_printer *p)
 {
-	fprintf(p->file, "%s\n", p->suffix ? p->suffix : "");
+	if (p->suffix)
+		fputs(p->suffix, p->file);
+	putc('\n', p->file);
 	return p;
 }
 
@@ -24,7 +32,7 @@ static __isl_give isl_printer *file_flush(__isl_take isl_printer *p)
 static __isl_give isl_printer *file_print_str(__isl_take isl_printer *p,
 	const char *s)
 {
-	fprintf(p->file, "%s", s);
+	fputs(s, p->file);
 	return p;
 }
 
@@ -47,9 +55,9 @@ static __isl_give isl_printer *file_print_isl_int(__isl_take isl_printer *p, isl
 	return p;
 }
 
-static int grow_buf(__isl_keep isl_printer *p, int extra)
+static int grow_buf(__isl_keep isl_printer *p, size_t extra)
 {
-	int new_size;
+	size_t new_size;
 	char *new_buf;
 
 	if (p->buf_size == 0)
@@ -68,7 +76,7 @@ static int grow_buf(__isl_keep isl_printer *p, int extra)
 }
 
 static __isl_give isl_printer *str_print(__isl_take isl_printer *p,
-	const char *s, int len)
+	const char *s, size_t len)
 {
 	if (p->buf_n + len + 1 >= p->buf_size && grow_buf(p, len))
 		goto error;
@@ -130,9 +138,11 @@ static __isl_give isl_printer *str_print_str(__isl_take isl_printer *p,
 static __isl_give isl_printer *str_print_double(__isl_take isl_printer *p,
 	double d)
 {
-	int left = p->buf_size - p->buf_n;
+	size_t left = p->buf_size - p->buf_n;
 	int need = snprintf(p->buf + p->buf_n, left, "%g", d);
-	if (need >= left) {
+	if (need < 0)
+		goto error;
+	if ((size_t) need >= left) {
 		if (grow_buf(p, need))
 			goto error;
 		left = p->buf_size - p->buf_n;
@@ -147,9 +157,11 @@ error:
 
 static __isl_give isl_printer *str_print_int(__isl_take isl_printer *p, int i)
 {
-	int left = p->buf_size - p->buf_n;
+	size_t left = p->buf_size - p->buf_n;
 	int need = snprintf(p->buf + p->buf_n, left, "%d", i);
-	if (need >= left) {
+	if (need < 0)
+		goto error;
+	if ((size_t) need >= left) {
 		if (grow_buf(p, need))
 			goto error;
 		left = p->buf_size - p->buf_n;
@@ -165,9 +177,17 @@ error:
 static __isl_give isl_printer *str_print_isl_int(__isl_take isl_printer *p,
 	isl_int i)
 {
+	char buf[32];
 	char *s;
 	int len;
 
+	if (isl_int_fits_slong(i)) {
+		len = snprintf(buf, sizeof(buf), "%ld", isl_int_get_si(i));
+		if (len < p->width)
+			p = str_print_indent(p, p->width - len);
+		return str_print(p, buf, len);
+	}
+
 	s = isl_int_get_str(i);
 	len = strlen(s);
 	if (len < p->width)
@@ -177,6 +197,76 @@ static __isl_give isl_printer *str_print_isl_int(__isl_take isl_printer *p,
 	return p;
 }
 
+/* The number of bytes that a callback printer collects
+ * before passing them to its callback.
+ */
+#define ISL_PRINTER_CALLBACK_CHUNK	(1 << 16)
+
+/* Pass the contents of the buffer of the callback printer "p"
+ * to its callback and clear the buffer.
+ */
+static __isl_give isl_printer *callback_emit(__isl_take isl_printer *p)
+{
+	if (!p)
+		return NULL;
+	if (p->buf_n == 0)
+		return p;
+	if (p->write(p->buf, p->buf_n, p->write_user) < 0) {
+		p->buf_n = 0;
+		isl_die(p->ctx, isl_error_unknown, "printer callback failed",
+			return isl_printer_free(p));
+	}
+	p->buf_n = 0;
+	p->buf[0] = '\0';
+	return p;
+}
+
+/* Pass the contents of the buffer of the callback printer "p"
+ * to its callback if it has grown beyond ISL_PRINTER_CALLBACK_CHUNK.
+ * Smaller pieces of output are collected such that the callback
+ * is called only on large batches.
+ */
+static __isl_give isl_printer *callback_check(__isl_take isl_printer *p)
+{
+	if (!p || p->buf_n < ISL_PRINTER_CALLBACK_CHUNK)
+		return p;
+	return callback_emit(p);
+}
+
+static __isl_give isl_printer *callback_start_line(__isl_take isl_printer *p)
+{
+	return callback_check(str_start_line(p));
+}
+
+static __isl_give isl_printer *callback_end_line(__isl_take isl_printer *p)
+{
+	return callback_check(str_end_line(p));
+}
+
+static __isl_give isl_printer *callback_print_double(__isl_take isl_printer *p,
+	double d)
+{
+	return callback_check(str_print_double(p, d));
+}
+
+static __isl_give isl_printer *callback_print_int(__isl_take isl_printer *p,
+	int i)
+{
+	return callback_check(str_print_int(p, i));
+}
+
+static __isl_give isl_printer *callback_print_isl_int(
+	__isl_take isl_printer *p, isl_int i)
+{
+	return callback_check(str_print_isl_int(p, i));
+}
+
+static __isl_give isl_printer *callback_print_str(__isl_take isl_printer *p,
+	const char *s)
+{
+	return callback_check(str_print_str(p, s));
+}
+
 struct isl_printer_ops {
 	__isl_give isl_printer *(*start_line)(__isl_take isl_printer *p);
 	__isl_give isl_printer *(*end_line)(__isl_take isl_printer *p);
@@ -210,6 +300,16 @@ static struct isl_printer_ops str_ops = {
 	str_flush
 };
 
+static struct isl_printer_ops callback_ops = {
+	callback_start_line,
+	callback_end_line,
+	callback_print_double,
+	callback_print_int,
+	callback_print_isl_int,
+	callback_print_str,
+	callback_emit
+};
+
 __isl_give isl_printer *isl_printer_to_file(isl_ctx *ctx, FILE *file)
 {
 	struct isl_printer *p = isl_alloc_type(ctx, struct isl_printer);
@@ -222,6 +322,8 @@ __isl_give isl_printer *isl_printer_to_file(isl_ctx *ctx, FILE *file)
 	p->buf = NULL;
 	p->buf_n = 0;
 	p->buf_size = 0;
+	p->write = NULL;
+	p->write_user = NULL;
 	p->indent = 0;
 	p->output_format = ISL_FORMAT_ISL;
 	p->indent_prefix = NULL;
@@ -260,10 +362,39 @@ error:
 	return NULL;
 }
 
+/* Create a printer that passes its output to "write".
+ * The output is collected in a buffer and passed to "write"
+ * in large batches, each time the buffer has grown beyond
+ * ISL_PRINTER_CALLBACK_CHUNK bytes, as well as when the printer
+ * is flushed or freed.
+ * "write" is called with the start and the length of a batch
+ * (which is not NUL-terminated) and with "user" and
+ * is expected to return -1 on error.
+ */
+__isl_give isl_printer *isl_printer_to_callback(isl_ctx *ctx,
+	int (*write)(const char *s, size_t len, void *user), void *user)
+{
+	isl_printer *p;
+
+	if (!write)
+		isl_die(ctx, isl_error_invalid, "no callback specified",
+			return NULL);
+	p = isl_printer_to_str(ctx);
+	if (!p)
+		return NULL;
+	p->ops = &callback_ops;
+	p->write = write;
+	p->write_user = user;
+
+	return p;
+}
+
 __isl_null isl_printer *isl_printer_free(__isl_take isl_printer *p)
 {
 	if (!p)
 		return NULL;
+	if (p->write && p->buf_size > 0 && p->buf_n > 0)
+		p->write(p->buf, p->buf_n, p->write_user);
 	free(p->buf);
 	free(p->indent_prefix);
 	free(p->prefix);
@@ -6,9 +6,11 @@ struct isl_printer {
 	struct isl_ctx	*ctx;
 	struct isl_printer_ops *ops;
 	FILE        	*file;
-	int		buf_n;
-	int		buf_size;
+	size_t		buf_n;
+	size_t		buf_size;
 	char		*buf;
+	int		(*write)(const char *s, size_t len, void *user);
+	void		*write_user;
 	int		indent;
 	int		output_format;
 	char		*indent_prefix;
@@ -0,0 +1,485 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <isl_ctx_private.h>
+#include <isl_options_private.h>
+#include <isl_profile.h>
+#include <isl/printer.h>
+
+/* Free the profile node "node" along with its descendants and
+ * the siblings that follow it.
+ */
+static void node_free(struct isl_profile_node *node)
+{
+	while (node) {
+		struct isl_profile_node *next = node->next;
+
+		node_free(node->child);
+		free(node->alloc);
+		free(node);
+		node = next;
+	}
+}
+
+/* Free the call tree of profiled entry points of "ctx".
+ */
+void isl_profile_free(isl_ctx *ctx)
+{
+	node_free(ctx->profile);
+	ctx->profile = NULL;
+	ctx->profile_current = NULL;
+}
+
+/* Return the child of "node" with name "name", creating it
+ * if it does not exist yet.
+ * The nodes are allocated directly with calloc rather than
+ * through isl_calloc_type to avoid affecting the operation count
+ * of the isl_ctx.
+ */
+static struct isl_profile_node *get_child(struct isl_profile_node *node,
+	const char *name)
+{
+	struct isl_profile_node *child, **last;
+
+	last = &node->child;
+	for (child = node->child; child; child = child->next) {
+		if (child->name == name || !strcmp(child->name, name))
+			return child;
+		last = &child->next;
+	}
+
+	child = calloc(1, sizeof(*child));
+	if (!child)
+		return NULL;
+	child->name = name;
+	child->parent = node;
+	*last = child;
+
+	return child;
+}
+
+/* Return the root of the call tree of "ctx", creating it
+ * if it does not exist yet.
+ */
+static struct isl_profile_node *get_root(isl_ctx *ctx)
+{
+	if (!ctx->profile) {
+		ctx->profile = calloc(1, sizeof(*ctx->profile));
+		ctx->profile_current = ctx->profile;
+	}
+	return ctx->profile;
+}
+
+/* Record the start of a call to the entry point called "name"
+ * in the call tree of "ctx", if the "profile" or
+ * the "profile_allocations" option is set.
+ * Return the node representing the call, to be passed
+ * to the corresponding isl_profile_leave, or NULL if the call
+ * is not being profiled.
+ */
+struct isl_profile_node *isl_profile_enter(isl_ctx *ctx, const char *name)
+{
+	struct isl_profile_node *node;
+
+	if (!ctx || (!ctx->opt->profile && !ctx->opt->profile_allocations))
+		return NULL;
+
+	if (!get_root(ctx))
+		return NULL;
+
+	node = get_child(ctx->profile_current, name);
+	if (!node)
+		return NULL;
+	node->calls++;
+	node->start_clock = clock();
+	node->start_operations = ctx->operations;
+	ctx->profile_current = node;
+
+	return node;
+}
+
+/* Record the end of the call represented by "node",
+ * as returned by the corresponding isl_profile_enter.
+ * The number of operations may have been reset in the mean time,
+ * in which case only the operations since the reset are counted.
+ */
+void isl_profile_leave(isl_ctx *ctx, struct isl_profile_node *node)
+{
+	if (!ctx || !node)
+		return;
+
+	node->clock += clock() - node->start_clock;
+	if (ctx->operations >= node->start_operations)
+		node->operations += ctx->operations - node->start_operations;
+	else
+		node->operations += ctx->operations;
+	ctx->profile_current = node->parent;
+}
+
+/* Return the size class of an allocation of "size" bytes.
+ */
+static int size_class(size_t size)
+{
+	int i;
+
+	for (i = 0; i < ISL_PROFILE_N_SIZE - 1; ++i)
+		if (size <= ((size_t) 1 << i))
+			return i;
+	return ISL_PROFILE_N_SIZE - 1;
+}
+
+/* Return the entry of "node" that counts the allocations
+ * of type "type", creating it if it does not exist yet.
+ * The types are usually string literals that are shared
+ * by all allocations of the same type, so first look for
+ * an identical pointer.
+ * As in get_child, the entries are allocated directly
+ * to avoid affecting the operation count (and
+ * to avoid recursive accounting).
+ */
+static struct isl_profile_alloc *get_alloc(struct isl_profile_node *node,
+	const char *type)
+{
+	int i;
+	struct isl_profile_alloc *alloc;
+
+	if (!type)
+		type = "(untyped)";
+	for (i = 0; i < node->n_alloc; ++i)
+		if (node->alloc[i].type == type)
+			return &node->alloc[i];
+	for (i = 0; i < node->n_alloc; ++i)
+		if (!strcmp(node->alloc[i].type, type))
+			return &node->alloc[i];
+
+	if (node->n_alloc >= node->size_alloc) {
+		int size = 2 * node->size_alloc + 8;
+
+		alloc = realloc(node->alloc, size * sizeof(*alloc));
+		if (!alloc)
+			return NULL;
+		node->alloc = alloc;
+		node->size_alloc = size;
+	}
+	alloc = &node->alloc[node->n_alloc++];
+	alloc->type = type;
+	alloc->count = 0;
+	alloc->bytes = 0;
+
+	return alloc;
+}
+
+/* Record an allocation of "size" bytes of type "type"
+ * in the innermost active profiled entry point of "ctx" or
+ * in the root of the call tree if there is no such entry point.
+ * This function is only called if the "profile_allocations" option is set.
+ * Failure to record the allocation is silently ignored.
+ */
+void isl_profile_record_alloc(isl_ctx *ctx, const char *type, size_t size)
+{
+	struct isl_profile_alloc *alloc;
+	struct isl_profile_node *node;
+
+	if (!get_root(ctx))
+		return;
+	node = ctx->profile_current;
+	node->size[size_class(size)]++;
+	alloc = get_alloc(node, type);
+	if (!alloc)
+		return;
+	alloc->count++;
+	alloc->bytes += size;
+}
+
+/* Compare the allocation entries "a" and "b", putting
+ * the most frequently allocated type first.
+ */
+static int cmp_alloc(const void *a, const void *b)
+{
+	const struct isl_profile_alloc *alloc_a = a;
+	const struct isl_profile_alloc *alloc_b = b;
+
+	if (alloc_a->count != alloc_b->count)
+		return alloc_a->count < alloc_b->count ? 1 : -1;
+	return strcmp(alloc_a->type, alloc_b->type);
+}
+
+/* Print the allocations performed directly in "node" to "p",
+ * indented by "indent" positions.
+ * The types are printed in order of decreasing number of allocations,
+ * followed by the non-empty size classes of the histogram.
+ */
+static __isl_give isl_printer *print_allocs(__isl_take isl_printer *p,
+	struct isl_profile_node *node, int indent)
+{
+	int i;
+	char buffer[100];
+
+	if (node->n_alloc == 0)
+		return p;
+
+	qsort(node->alloc, node->n_alloc, sizeof(*node->alloc), &cmp_alloc);
+	p = isl_printer_set_indent(p, indent);
+	for (i = 0; i < node->n_alloc; ++i) {
+		snprintf(buffer, sizeof(buffer), ": %ld times, %lu bytes",
+			node->alloc[i].count,
+			(unsigned long) node->alloc[i].bytes);
+		p = isl_printer_start_line(p);
+		p = isl_printer_print_str(p, "allocated ");
+		p = isl_printer_print_str(p, node->alloc[i].type);
+		p = isl_printer_print_str(p, buffer);
+		p = isl_printer_end_line(p);
+	}
+
+	p = isl_printer_start_line(p);
+	p = isl_printer_print_str(p, "allocation sizes:");
+	for (i = 0; i < ISL_PROFILE_N_SIZE; ++i) {
+		if (!node->size[i])
+			continue;
+		if (i < ISL_PROFILE_N_SIZE - 1)
+			snprintf(buffer, sizeof(buffer), " <=%lu: %ld",
+				1UL << i, node->size[i]);
+		else
+			snprintf(buffer, sizeof(buffer), " >%lu: %ld",
+				1UL << (i - 1), node->size[i]);
+		p = isl_printer_print_str(p, buffer);
+	}
+	p = isl_printer_end_line(p);
+
+	return p;
+}
+
+/* Print the children of "node" and their descendants to "p",
+ * indented by "indent" positions.
+ * The allocations of each child are printed below the child,
+ * before its own children.
+ */
+static __isl_give isl_printer *print_nodes(__isl_take isl_printer *p,
+	struct isl_profile_node *node, int indent)
+{
+	struct isl_profile_node *child;
+
+	for (child = node->child; child; child = child->next) {
+		char buffer[100];
+		long us;
+
+		us = (long) ((double) child->clock * 1000000 / CLOCKS_PER_SEC);
+		snprintf(buffer, sizeof(buffer),
+			": %ld calls, %ld us, %lu operations",
+			child->calls, us, child->operations);
+		p = isl_printer_set_indent(p, indent);
+		p = isl_printer_start_line(p);
+		p = isl_printer_print_str(p, child->name);
+		p = isl_printer_print_str(p, buffer);
+		p = isl_printer_end_line(p);
+		p = print_allocs(p, child, indent + 2);
+		p = print_nodes(p, child, indent + 2);
+	}
+
+	return p;
+}
+
+/* Return a textual representation of the call tree of the entry points
+ * that have been profiled by "ctx" since it was created or
+ * since the last call to isl_ctx_reset_profile.
+ * Each entry point is printed on a separate line, along with
+ * the number of calls and the total processor time and number
+ * of operations spent in these calls.
+ * Nested entry points are printed on subsequent lines,
+ * with increased indentation.
+ * If allocations have been counted, then they are printed
+ * below the entry point that performed them.
+ * Allocations performed outside of any profiled entry point
+ * are printed first.
+ * The allocations performed by the printer itself are not counted
+ * since they would modify the call tree while it is being printed.
+ */
+__isl_give char *isl_ctx_profile_to_str(isl_ctx *ctx)
+{
+	isl_printer *p;
+	char *str;
+	int profile_allocations;
+
+	if (!ctx)
+		return NULL;
+
+	profile_allocations = ctx->opt->profile_allocations;
+	ctx->opt->profile_allocations = 0;
+	p = isl_printer_to_str(ctx);
+	if (ctx->profile && ctx->profile->n_alloc) {
+		p = isl_printer_start_line(p);
+		p = isl_printer_print_str(p,
+				"(outside profiled entry points)");
+		p = isl_printer_end_line(p);
+		p = print_allocs(p, ctx->profile, 2);
+	}
+	if (ctx->profile)
+		p = print_nodes(p, ctx->profile, 0);
+	str = isl_printer_get_str(p);
+	isl_printer_free(p);
+	ctx->opt->profile_allocations = profile_allocations;
+
+	return str;
+}
+
+/* Print the call tree of the profiled entry points of "ctx" to stderr.
+ */
+void isl_ctx_dump_profile(isl_ctx *ctx)
+{
+	char *str;
+
+	str = isl_ctx_profile_to_str(ctx);
+	if (str)
+		fprintf(stderr, "%s", str);
+	free(str);
+}
+
+/* Discard the profiling information collected by "ctx".
+ * This may not be called while any profiled entry point is active.
+ */
+void isl_ctx_reset_profile(isl_ctx *ctx)
+{
+	if (!ctx)
+		return;
+	isl_profile_free(ctx);
+}
+
+/* Report the begin event of the traced algorithm called "name"
+ * to the trace callback of "ctx", if any.
+ * "fmt" and the remaining arguments describe the (JSON) members
+ * of the object that summarizes the input of the algorithm.
+ * The arguments are only formatted if a trace callback has been set,
+ * such that tracing has hardly any cost if it is disabled.
+ */
+void isl_trace_begin(isl_ctx *ctx, const char *name, const char *fmt, ...)
+{
+	char args[200];
+	va_list ap;
+	int n;
+
+	if (!ctx || !ctx->trace)
+		return;
+
+	args[0] = '{';
+	va_start(ap, fmt);
+	n = vsnprintf(args + 1, sizeof(args) - 2, fmt, ap);
+	va_end(ap);
+	if (n < 0)
+		n = 0;
+	if (n > sizeof(args) - 3)
+		n = sizeof(args) - 3;
+	args[1 + n] = '}';
+	args[2 + n] = '\0';
+	ctx->trace(name, 1, 1e6 * isl_monotonic_time(), args,
+		    ctx->trace_user);
+}
+
+/* Report the end event of the traced algorithm called "name"
+ * to the trace callback of "ctx", if any.
+ */
+void isl_trace_end(isl_ctx *ctx, const char *name)
+{
+	if (!ctx || !ctx->trace)
+		return;
+
+	ctx->trace(name, 0, 1e6 * isl_monotonic_time(), "{}",
+		    ctx->trace_user);
+}
+
+/* Set the callback that is called on the begin and end events
+ * of the traced algorithms of "ctx" to "fn", with user argument "user".
+ * Each event is described by the name of the algorithm,
+ * whether it is a begin (1) or end (0) event, a timestamp in microseconds
+ * and a JSON object that summarizes the input of the algorithm
+ * (empty for end events).
+ * A NULL "fn" disables tracing.
+ * If the events were being written to a file, then
+ * the trace in that file is completed first.
+ */
+int isl_ctx_set_trace_callback(isl_ctx *ctx,
+	void (*fn)(const char *name, int begin, double timestamp,
+		const char *args, void *user), void *user)
+{
+	if (!ctx)
+		return -1;
+
+	if (ctx->trace_file) {
+		fprintf(ctx->trace_file, "\n]\n");
+		fflush(ctx->trace_file);
+		ctx->trace_file = NULL;
+	}
+	ctx->trace = fn;
+	ctx->trace_user = user;
+
+	return 0;
+}
+
+/* Write the event described by "name", "begin", "timestamp" and "args"
+ * that occurred in thread "tid" to the trace file of "ctx"
+ * in the Chrome trace event format.
+ */
+static void print_trace_event(isl_ctx *ctx, int tid, const char *name,
+	int begin, double timestamp, const char *args)
+{
+	fprintf(ctx->trace_file, "%s{\"name\": \"%s\", \"ph\": \"%s\", "
+		"\"ts\": %.3f, \"pid\": 0, \"tid\": %d, \"args\": %s}",
+		ctx->trace_n++ ? ",\n" : "", name, begin ? "B" : "E",
+		timestamp, tid, args);
+}
+
+/* Write the event described by "name", "begin", "timestamp" and "args"
+ * to the trace file of the isl_ctx "user".
+ * Events that occur in "user" itself are attributed to thread 0.
+ */
+static void write_trace_event(const char *name, int begin, double timestamp,
+	const char *args, void *user)
+{
+	print_trace_event(user, 0, name, begin, timestamp, args);
+}
+
+/* Report the event described by "name", "begin", "timestamp" and "args"
+ * that occurred in a worker of "ctx" running in thread "tid"
+ * to the trace callback of "ctx", if any.
+ * If the events of "ctx" are written to a trace file,
+ * then the event is attributed to thread "tid" in that file.
+ * The caller is responsible for ensuring that the trace callback
+ * of "ctx" is not called from several threads at the same time.
+ */
+void isl_ctx_trace_event(isl_ctx *ctx, int tid, const char *name, int begin,
+	double timestamp, const char *args)
+{
+	if (!ctx || !ctx->trace)
+		return;
+
+	if (ctx->trace_file)
+		print_trace_event(ctx, tid, name, begin, timestamp, args);
+	else
+		ctx->trace(name, begin, timestamp, args, ctx->trace_user);
+}
+
+/* Write the begin and end events of the traced algorithms of "ctx"
+ * to "file" in the JSON array format of Chrome trace events,
+ * such that they can be visualized using, e.g., chrome://tracing
+ * or Perfetto.
+ * The trace is completed when a different trace callback is set
+ * (or tracing is disabled) or when "ctx" is freed.
+ * The caller remains responsible for closing "file".
+ */
+int isl_ctx_set_trace_file(isl_ctx *ctx, FILE *file)
+{
+	if (isl_ctx_set_trace_callback(ctx, file ? &write_trace_event : NULL,
+					ctx) < 0)
+		return -1;
+	if (!file)
+		return 0;
+
+	ctx->trace_file = file;
+	ctx->trace_n = 0;
+	fprintf(file, "[\n");
+
+	return 0;
+}
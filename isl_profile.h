@@ -0,0 +1,81 @@
+#ifndef ISL_PROFILE_H
+#define ISL_PROFILE_H
+
+#include <time.h>
+#include <isl/ctx.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* The number of size classes in the allocation histograms.
+ * Size class i (i > 0) contains the allocations of more than 2^(i-1)
+ * and at most 2^i bytes, except for the last size class,
+ * which contains all larger allocations.
+ */
+#define ISL_PROFILE_N_SIZE	32
+
+/* The number ("count") and total size ("bytes") of the allocations
+ * of objects of type "type" (a string literal).
+ */
+struct isl_profile_alloc {
+	const char *type;
+	long count;
+	size_t bytes;
+};
+
+/* A node in the call tree of profiled entry points.
+ *
+ * "name" is the name of the entry point (a string literal).
+ * "calls" is the number of times the entry point was called
+ * from the entry point represented by "parent" and
+ * "clock" and "operations" are the total processor time and
+ * the total number of operations spent in these calls,
+ * including the time and operations spent in nested entry points.
+ * "start_clock" and "start_operations" are the processor time and
+ * the number of operations at the start of the current call.
+ *
+ * If the "profile_allocations" option is set, then "alloc" contains
+ * "n_alloc" (out of "size_alloc") entries counting the allocations
+ * performed directly in these calls, i.e., not in nested entry points,
+ * per type and "size" is a histogram of the sizes of those allocations.
+ *
+ * The children of a node form a linked list starting at "child"
+ * and continuing through "next".
+ * The root of the tree has a NULL name.
+ * Its allocations are those performed outside of any profiled entry point.
+ */
+struct isl_profile_node {
+	const char *name;
+	long calls;
+	clock_t clock;
+	unsigned long operations;
+
+	clock_t start_clock;
+	unsigned long start_operations;
+
+	int n_alloc;
+	int size_alloc;
+	struct isl_profile_alloc *alloc;
+	long size[ISL_PROFILE_N_SIZE];
+
+	struct isl_profile_node *parent;
+	struct isl_profile_node *child;
+	struct isl_profile_node *next;
+};
+
+struct isl_profile_node *isl_profile_enter(isl_ctx *ctx, const char *name);
+void isl_profile_leave(isl_ctx *ctx, struct isl_profile_node *node);
+void isl_profile_free(isl_ctx *ctx);
+void isl_profile_record_alloc(isl_ctx *ctx, const char *type, size_t size);
+
+void isl_trace_begin(isl_ctx *ctx, const char *name, const char *fmt, ...);
+void isl_trace_end(isl_ctx *ctx, const char *name);
+void isl_ctx_trace_event(isl_ctx *ctx, int tid, const char *name, int begin,
+	double timestamp, const char *args);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
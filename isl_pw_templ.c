@@ -12,6 +12,7 @@
  */
 
 #include <isl/aff.h>
+#include <isl_map_private.h>
 #include <isl_val_private.h>
 
 #define xFN(TYPE,NAME) TYPE ## _ ## NAME
@@ -351,6 +352,58 @@ error:
 }
 #endif
 
+/* Compute bounds on the parameters and domain dimensions of
+ * each piece of "pw" that can be read off from the constraints
+ * of the piece domains.
+ * The result can be used by FN(PW,pieces_plain_disjoint) to skip pairs
+ * of pieces of two piecewise expressions with disjoint domains
+ * without computing their intersection.
+ */
+static struct isl_map_plain_boxes *FN(PW,plain_boxes)(__isl_keep PW *pw)
+	__attribute__ ((unused));
+static struct isl_map_plain_boxes *FN(PW,plain_boxes)(__isl_keep PW *pw)
+{
+	int i;
+	unsigned dim;
+	struct isl_map_plain_boxes *boxes;
+
+	if (!pw)
+		return NULL;
+
+	dim = isl_space_dim(pw->dim, isl_dim_param) +
+		isl_space_dim(pw->dim, isl_dim_in);
+	boxes = isl_map_plain_boxes_alloc(FN(PW,get_ctx)(pw), pw->n, dim);
+	for (i = 0; boxes && i < pw->n; ++i)
+		if (isl_map_plain_boxes_set_hull(boxes, i, pw->p[i].set) < 0)
+			boxes = isl_map_plain_boxes_free(boxes);
+
+	return boxes;
+}
+
+/* Are the domains of piece "i" of the piecewise expression
+ * with piece bounds "boxes1" and piece "j" of the piecewise expression
+ * with piece bounds "boxes2" obviously disjoint?
+ * Keep track of the number of pairs that are skipped in "ctx".
+ */
+static int FN(PW,pieces_plain_disjoint)(isl_ctx *ctx,
+	struct isl_map_plain_boxes *boxes1, int i,
+	struct isl_map_plain_boxes *boxes2, int j) __attribute__ ((unused));
+static int FN(PW,pieces_plain_disjoint)(isl_ctx *ctx,
+	struct isl_map_plain_boxes *boxes1, int i,
+	struct isl_map_plain_boxes *boxes2, int j)
+{
+	ctx->stats->pw_pairs_tested++;
+	if (!isl_map_plain_boxes_is_disjoint(boxes1, i, boxes2, j))
+		return 0;
+	ctx->stats->pw_pairs_skipped++;
+	return 1;
+}
+
+/* Compute the sum of "pw1" and "pw2" on the union of their domains.
+ *
+ * Pairs of pieces with obviously disjoint domains are skipped
+ * without computing their intersection.
+ */
 static __isl_give PW *FN(PW,union_add_aligned)(__isl_take PW *pw1,
 	__isl_take PW *pw2)
 {
@@ -358,6 +411,7 @@ static __isl_give PW *FN(PW,union_add_aligned)(__isl_take PW *pw1,
 	struct PW *res;
 	isl_ctx *ctx;
 	isl_set *set;
+	struct isl_map_plain_boxes *boxes1 = NULL, *boxes2 = NULL;
 
 	if (!pw1 || !pw2)
 		goto error;
@@ -380,6 +434,11 @@ static __isl_give PW *FN(PW,union_add_aligned)(__isl_take PW *pw1,
 		return pw1;
 	}
 
+	boxes1 = FN(PW,plain_boxes)(pw1);
+	boxes2 = FN(PW,plain_boxes)(pw2);
+	if (!boxes1 || !boxes2)
+		goto error;
+
 	n = (pw1->n + 1) * (pw2->n + 1);
 #ifdef HAS_TYPE
 	res = FN(PW,alloc_size)(isl_space_copy(pw1->dim), pw1->type, n);
@@ -392,6 +451,9 @@ static __isl_give PW *FN(PW,union_add_aligned)(__isl_take PW *pw1,
 		for (j = 0; j < pw2->n; ++j) {
 			struct isl_set *common;
 			EL *sum;
+			if (FN(PW,pieces_plain_disjoint)(ctx, boxes1, i,
+							boxes2, j))
+				continue;
 			common = isl_set_intersect(isl_set_copy(pw1->p[i].set),
 						isl_set_copy(pw2->p[j].set));
 			if (isl_set_plain_is_empty(common)) {
@@ -412,17 +474,25 @@ static __isl_give PW *FN(PW,union_add_aligned)(__isl_take PW *pw1,
 
 	for (j = 0; j < pw2->n; ++j) {
 		set = isl_set_copy(pw2->p[j].set);
-		for (i = 0; i < pw1->n; ++i)
+		for (i = 0; i < pw1->n; ++i) {
+			if (isl_map_plain_boxes_is_disjoint(boxes1, i,
+							    boxes2, j))
+				continue;
 			set = isl_set_subtract(set,
 					isl_set_copy(pw1->p[i].set));
+		}
 		res = FN(PW,add_piece)(res, set, FN(EL,copy)(pw2->p[j].FIELD));
 	}
 
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
 	FN(PW,free)(pw1);
 	FN(PW,free)(pw2);
 
 	return res;
 error:
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
 	FN(PW,free)(pw1);
 	FN(PW,free)(pw2);
 	return NULL;
@@ -539,6 +609,8 @@ static __isl_give PW *FN(PW,on_shared_domain_in)(__isl_take PW *pw1,
 
 /* Apply "fn" to pairs of elements from pw1 and pw2 on shared domains.
  * The result of "fn" (and therefore also of this function) lives in "space".
+ * Pairs of pieces with obviously disjoint domains are skipped
+ * without computing their intersection.
  */
 static __isl_give PW *FN(PW,on_shared_domain_in)(__isl_take PW *pw1,
 	__isl_take PW *pw2, __isl_take isl_space *space,
@@ -546,10 +618,18 @@ static __isl_give PW *FN(PW,on_shared_domain_in)(__isl_take PW *pw1,
 {
 	int i, j, n;
 	PW *res = NULL;
+	isl_ctx *ctx;
+	struct isl_map_plain_boxes *boxes1 = NULL, *boxes2 = NULL;
 
 	if (!pw1 || !pw2)
 		goto error;
 
+	ctx = FN(PW,get_ctx)(pw1);
+	boxes1 = FN(PW,plain_boxes)(pw1);
+	boxes2 = FN(PW,plain_boxes)(pw2);
+	if (!boxes1 || !boxes2)
+		goto error;
+
 	n = pw1->n * pw2->n;
 #ifdef HAS_TYPE
 	res = FN(PW,alloc_size)(isl_space_copy(space), pw1->type, n);
@@ -563,6 +643,9 @@ static __isl_give PW *FN(PW,on_shared_domain_in)(__isl_take PW *pw1,
 			EL *res_ij;
 			int empty;
 
+			if (FN(PW,pieces_plain_disjoint)(ctx, boxes1, i,
+							boxes2, j))
+				continue;
 			common = isl_set_intersect(
 					isl_set_copy(pw1->p[i].set),
 					isl_set_copy(pw2->p[j].set));
@@ -582,11 +665,15 @@ static __isl_give PW *FN(PW,on_shared_domain_in)(__isl_take PW *pw1,
 		}
 	}
 
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
 	isl_space_free(space);
 	FN(PW,free)(pw1);
 	FN(PW,free)(pw2);
 	return res;
 error:
+	isl_map_plain_boxes_free(boxes1);
+	isl_map_plain_boxes_free(boxes2);
 	isl_space_free(space);
 	FN(PW,free)(pw1);
 	FN(PW,free)(pw2);
@@ -1,10 +1,36 @@
+#include <isl_config.h>
 #include <isl_ctx_private.h>
 #include <isl_constraint_private.h>
 #include <isl/set.h>
+#include <isl/options.h>
 #include <isl_polynomial_private.h>
 #include <isl_morph.h>
 #include <isl_range.h>
+#include <isl_thread.h>
 
+/* A guarded polynomial, living in a parameter space,
+ * along with an indication of whether it is known to be tight.
+ */
+struct isl_range_piece {
+	isl_basic_set		*bset;
+	isl_qpolynomial		*poly;
+	int			tight;
+};
+
+/* A sequence of guarded polynomials computed by a worker thread
+ * for a single bound pair.
+ */
+struct isl_range_pieces {
+	int			n;
+	int			size;
+	struct isl_range_piece	*p;
+};
+
+/* "n_thread" is the number of threads that may be used for
+ * handling the bound pairs of a single variable.
+ * If "pieces" is set, then the guarded polynomials are collected
+ * in "pieces" instead of being added to "pwf" or "pwf_tight".
+ */
 struct range_data {
 	struct isl_bound	*bound;
 	int 		    	*signs;
@@ -15,6 +41,8 @@ struct range_data {
 	isl_qpolynomial	    	*poly;
 	isl_pw_qpolynomial_fold *pwf;
 	isl_pw_qpolynomial_fold *pwf_tight;
+	int			n_thread;
+	struct isl_range_pieces	*pieces;
 };
 
 static int propagate_on_domain(__isl_take isl_basic_set *bset,
@@ -59,6 +87,8 @@ static int has_sign(__isl_keep isl_basic_set *bset,
 	data_m.pwf = isl_pw_qpolynomial_fold_zero(dim, type);
 	data_m.tight = 0;
 	data_m.pwf_tight = NULL;
+	data_m.n_thread = 0;
+	data_m.pieces = NULL;
 
 	if (propagate_on_domain(bset, poly, &data_m) < 0)
 		goto error;
@@ -246,24 +276,22 @@ error:
 	return NULL;
 }
 
-/* Helper function to add a guarded polynomial to either pwf_tight or pwf,
- * depending on whether the result has been determined to be tight.
+/* Add the guarded polynomial "poly" on the parameter domain "bset"
+ * to either pwf_tight or pwf, depending on whether the result
+ * has been determined to be tight.
  */
-static int add_guarded_poly(__isl_take isl_basic_set *bset,
-	__isl_take isl_qpolynomial *poly, struct range_data *data)
+static int fold_guarded_poly(__isl_take isl_basic_set *bset,
+	__isl_take isl_qpolynomial *poly, int tight, struct range_data *data)
 {
 	enum isl_fold type = data->sign < 0 ? isl_fold_min : isl_fold_max;
 	isl_set *set;
 	isl_qpolynomial_fold *fold;
 	isl_pw_qpolynomial_fold *pwf;
 
-	bset = isl_basic_set_params(bset);
-	poly = isl_qpolynomial_project_domain_on_params(poly);
-
 	fold = isl_qpolynomial_fold_alloc(type, poly);
 	set = isl_set_from_basic_set(bset);
 	pwf = isl_pw_qpolynomial_fold_alloc(type, set, fold);
-	if (data->tight)
+	if (tight)
 		data->pwf_tight = isl_pw_qpolynomial_fold_fold(
 						data->pwf_tight, pwf);
 	else
@@ -272,6 +300,57 @@ static int add_guarded_poly(__isl_take isl_basic_set *bset,
 	return 0;
 }
 
+/* Append the guarded polynomial "poly" on the parameter domain "bset"
+ * to "pieces".
+ */
+static int add_piece(struct isl_range_pieces *pieces,
+	__isl_take isl_basic_set *bset, __isl_take isl_qpolynomial *poly,
+	int tight)
+{
+	isl_ctx *ctx;
+
+	if (!bset || !poly)
+		goto error;
+
+	ctx = isl_basic_set_get_ctx(bset);
+	if (pieces->n >= pieces->size) {
+		struct isl_range_piece *p;
+
+		p = isl_realloc_array(ctx, pieces->p, struct isl_range_piece,
+					2 * pieces->size + 4);
+		if (!p)
+			goto error;
+		pieces->p = p;
+		pieces->size = 2 * pieces->size + 4;
+	}
+
+	pieces->p[pieces->n].bset = bset;
+	pieces->p[pieces->n].poly = poly;
+	pieces->p[pieces->n].tight = tight;
+	pieces->n++;
+
+	return 0;
+error:
+	isl_basic_set_free(bset);
+	isl_qpolynomial_free(poly);
+	return -1;
+}
+
+/* Helper function to add a guarded polynomial to either pwf_tight or pwf,
+ * depending on whether the result has been determined to be tight,
+ * or to data->pieces if it is set.
+ */
+static int add_guarded_poly(__isl_take isl_basic_set *bset,
+	__isl_take isl_qpolynomial *poly, struct range_data *data)
+{
+	bset = isl_basic_set_params(bset);
+	poly = isl_qpolynomial_project_domain_on_params(poly);
+
+	if (data->pieces)
+		return add_piece(data->pieces, bset, poly, data->tight);
+	return fold_guarded_poly(bset, poly, data->tight, data);
+}
+
 /* Given a lower and upper bound on the final variable and constraints
  * on the remaining variables where these bounds are active,
  * eliminate the variable from data->poly based on these bounds.
@@ -353,6 +432,233 @@ static int propagate_on_bound_pair(__isl_take isl_constraint *lower,
 	return r;
 }
 
+#ifdef HAVE_PTHREAD
+
+/* A lower and an upper bound on the final variable of a basic set
+ * (NULL if there is no such bound), along with the constraints
+ * on the remaining variables where these bounds are active.
+ */
+struct isl_range_pair {
+	isl_constraint		*lower;
+	isl_constraint		*upper;
+	isl_basic_set		*bset;
+};
+
+/* A sequence of "n" bound pairs, with room for "size" bound pairs.
+ */
+struct isl_range_pairs {
+	int			n;
+	int			size;
+	struct isl_range_pair	*p;
+};
+
+/* Append the bound pair to the sequence of bound pairs pointed to by "user".
+ * Either bound may be NULL if there is no such bound.
+ */
+static int collect_bound_pair(__isl_take isl_constraint *lower,
+	__isl_take isl_constraint *upper, __isl_take isl_basic_set *bset,
+	void *user)
+{
+	struct isl_range_pairs *pairs = user;
+
+	if (!bset)
+		goto error;
+
+	if (pairs->n >= pairs->size) {
+		struct isl_range_pair *p;
+
+		p = isl_realloc_array(isl_basic_set_get_ctx(bset), pairs->p,
+				    struct isl_range_pair, 2 * pairs->size + 4);
+		if (!p)
+			goto error;
+		pairs->p = p;
+		pairs->size = 2 * pairs->size + 4;
+	}
+
+	pairs->p[pairs->n].lower = lower;
+	pairs->p[pairs->n].upper = upper;
+	pairs->p[pairs->n].bset = bset;
+	pairs->n++;
+
+	return 0;
+error:
+	isl_constraint_free(lower);
+	isl_constraint_free(upper);
+	isl_basic_set_free(bset);
+	return -1;
+}
+
+/* Internal data for propagate_on_bound_pairs_threads.
+ *
+ * "data" is the data of the calling thread, with data->poly
+ * the polynomial from which the final variable is eliminated.
+ * "pairs" contains the bound pairs of this variable, which live in "ctx",
+ * and "res" collects the results for each pair, imported back into "ctx".
+ */
+struct isl_range_threads {
+	isl_ctx *ctx;
+	struct range_data *data;
+	struct isl_range_pairs *pairs;
+	struct isl_range_pieces *res;
+};
+
+/* Import bound pair "i" and data->poly into the isl_ctx of "worker",
+ * eliminate the final variable based on this bound pair,
+ * collecting the resulting guarded polynomials in res[i], and
+ * import these guarded polynomials back.
+ * The bound pairs of the remaining variables are handled
+ * by the worker itself, without starting any further threads.
+ */
+static int range_work(struct isl_thread_worker *worker, int i, void *user)
+{
+	struct isl_range_threads *threads = user;
+	struct isl_range_pair *pair = &threads->pairs->p[i];
+	struct isl_range_pieces *pieces = &threads->res[i];
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	struct range_data data;
+	isl_constraint *lower, *upper;
+	isl_basic_set *bset;
+	int j, r = -1;
+
+	data = *threads->data;
+	data.pwf = NULL;
+	data.pwf_tight = NULL;
+	data.n_thread = 0;
+	data.pieces = pieces;
+
+	isl_thread_worker_lock(worker);
+	lower = isl_constraint_import(ctx, pair->lower);
+	upper = isl_constraint_import(ctx, pair->upper);
+	bset = isl_basic_set_import(ctx, pair->bset);
+	data.poly = isl_qpolynomial_import(ctx, threads->data->poly);
+	isl_thread_worker_unlock(worker);
+
+	if ((lower || !pair->lower) && (upper || !pair->upper) &&
+	    bset && data.poly)
+		r = propagate_on_bound_pair(lower, upper, bset, &data);
+	else {
+		isl_constraint_free(lower);
+		isl_constraint_free(upper);
+		isl_basic_set_free(bset);
+	}
+	isl_qpolynomial_free(data.poly);
+
+	isl_thread_worker_lock(worker);
+	for (j = 0; j < pieces->n; ++j) {
+		isl_basic_set *dom = pieces->p[j].bset;
+		isl_qpolynomial *poly = pieces->p[j].poly;
+
+		pieces->p[j].bset = isl_basic_set_import(threads->ctx, dom);
+		pieces->p[j].poly = isl_qpolynomial_import(threads->ctx, poly);
+		isl_basic_set_free(dom);
+		isl_qpolynomial_free(poly);
+		if (!pieces->p[j].bset || !pieces->p[j].poly)
+			r = -1;
+	}
+	isl_thread_worker_unlock(worker);
+
+	return r;
+}
+
+/* Eliminate the final variable of "bset" from data->poly
+ * based on each of the bound pairs of this variable,
+ * handling the bound pairs in parallel.
+ *
+ * The bound pairs are first collected in the calling thread.
+ * If there is only one of them, then it is handled directly.
+ * Otherwise, each thread has its own isl_ctx, into which it imports
+ * data->poly and the bound pairs that it handles (see isl_thread_run).
+ * The resulting guarded polynomials are only
+ * added to data->pwf or data->pwf_tight after all threads have finished,
+ * in the order of the bound pairs, such that the result is the same
+ * as that of the sequential computation.
+ */
+static int propagate_on_bound_pairs_threads(__isl_keep isl_basic_set *bset,
+	struct range_data *data)
+{
+	int i, j, r = 0;
+	unsigned d;
+	isl_ctx *ctx;
+	struct isl_range_pairs pairs = { 0 };
+	struct isl_range_threads threads = { NULL, data, &pairs };
+
+	ctx = isl_basic_set_get_ctx(bset);
+	d = isl_basic_set_dim(bset, isl_dim_set);
+	if (isl_basic_set_foreach_bound_pair(bset, isl_dim_set, d - 1,
+					    &collect_bound_pair, &pairs) < 0)
+		goto error;
+	if (pairs.n == 1) {
+		pairs.n = 0;
+		r = propagate_on_bound_pair(pairs.p[0].lower, pairs.p[0].upper,
+					    pairs.p[0].bset, data);
+		free(pairs.p);
+		return r;
+	}
+
+	threads.ctx = ctx;
+	threads.res = isl_calloc_array(ctx, struct isl_range_pieces, pairs.n);
+	if (pairs.n && !threads.res)
+		goto error;
+	if (isl_thread_run(ctx, pairs.n, &range_work, &threads) < 0)
+		goto error;
+
+	for (i = 0; i < pairs.n; ++i) {
+		for (j = 0; j < threads.res[i].n; ++j) {
+			struct isl_range_piece *piece = &threads.res[i].p[j];
+			isl_basic_set *dom = piece->bset;
+			isl_qpolynomial *poly = piece->poly;
+
+			piece->bset = NULL;
+			piece->poly = NULL;
+			if (fold_guarded_poly(dom, poly, piece->tight,
+						data) < 0)
+				goto error;
+		}
+	}
+
+	if (0)
+error:
+		r = -1;
+	for (i = 0; threads.res && i < pairs.n; ++i) {
+		for (j = 0; j < threads.res[i].n; ++j) {
+			isl_basic_set_free(threads.res[i].p[j].bset);
+			isl_qpolynomial_free(threads.res[i].p[j].poly);
+		}
+		free(threads.res[i].p);
+	}
+	for (i = 0; i < pairs.n; ++i) {
+		isl_constraint_free(pairs.p[i].lower);
+		isl_constraint_free(pairs.p[i].upper);
+		isl_basic_set_free(pairs.p[i].bset);
+	}
+	free(pairs.p);
+	free(threads.res);
+	return r;
+}
+
+#endif
+
+/* Eliminate the final variable of "bset" from data->poly
+ * based on each of the bound pairs of this variable.
+ *
+ * If data->n_thread is greater than one, isl has been built
+ * with thread support and there is more than one bound pair,
+ * then the bound pairs are handled in parallel.
+ */
+static int propagate_on_bound_pairs(__isl_keep isl_basic_set *bset,
+	struct range_data *data)
+{
+	unsigned d = isl_basic_set_dim(bset, isl_dim_set);
+
+#ifdef HAVE_PTHREAD
+	if (data->n_thread > 1)
+		return propagate_on_bound_pairs_threads(bset, data);
+#endif
+
+	return isl_basic_set_foreach_bound_pair(bset, isl_dim_set, d - 1,
+					    &propagate_on_bound_pair, data);
+}
+
 /* Recursively perform range propagation on the polynomial "poly"
  * defined over the basic set "bset" and collect the results in "data".
  */
@@ -385,8 +691,7 @@ static int propagate_on_domain(__isl_take isl_basic_set *bset,
 		goto error;
 
 	data->poly = poly;
-	if (isl_basic_set_foreach_bound_pair(bset, isl_dim_set, d - 1,
-					    &propagate_on_bound_pair, data) < 0)
+	if (propagate_on_bound_pairs(bset, data) < 0)
 		goto error;
 
 	isl_basic_set_free(bset);
@@ -445,6 +750,8 @@ static int qpolynomial_bound_on_domain_range(__isl_take isl_basic_set *bset,
 	if (!bset)
 		goto error;
 
+	data->n_thread = isl_options_get_threads(isl_basic_set_get_ctx(bset));
+	data->pieces = NULL;
 	if (nvar == 0)
 		return add_guarded_poly(bset, poly, data);
 
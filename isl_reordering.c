@@ -87,7 +87,7 @@ void *isl_reordering_free(__isl_take isl_reordering *exp)
  * that has the parameters of "aligner" first, followed by
  * any remaining parameters of "alignee" that do not occur in "aligner".
  */
-__isl_give isl_reordering *isl_parameter_alignment_reordering(
+static __isl_give isl_reordering *parameter_alignment_reordering(
 	__isl_keep isl_space *alignee, __isl_keep isl_space *aligner)
 {
 	int i, j;
@@ -136,6 +136,121 @@ error:
 	return NULL;
 }
 
+/* Remove all entries from the cache of parameter alignment reorderings
+ * of "ctx".
+ */
+void isl_reordering_cache_clear(isl_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < ctx->n_reordering_cache; ++i) {
+		isl_space_free(ctx->reordering_alignee[i]);
+		isl_space_free(ctx->reordering_aligner[i]);
+		isl_reordering_free(ctx->reordering_cache[i]);
+	}
+	ctx->n_reordering_cache = 0;
+}
+
+/* Move entry "pos" of the reordering cache of "ctx" to the front.
+ */
+static void reordering_cache_move_to_front(isl_ctx *ctx, int pos)
+{
+	isl_space *alignee = ctx->reordering_alignee[pos];
+	isl_space *aligner = ctx->reordering_aligner[pos];
+	isl_reordering *exp = ctx->reordering_cache[pos];
+
+	for (; pos > 0; --pos) {
+		ctx->reordering_alignee[pos] = ctx->reordering_alignee[pos - 1];
+		ctx->reordering_aligner[pos] = ctx->reordering_aligner[pos - 1];
+		ctx->reordering_cache[pos] = ctx->reordering_cache[pos - 1];
+	}
+	ctx->reordering_alignee[0] = alignee;
+	ctx->reordering_aligner[0] = aligner;
+	ctx->reordering_cache[0] = exp;
+}
+
+/* Look for a reordering in the cache of "ctx" that was computed
+ * for an alignee with the same parameters as "alignee" and
+ * an aligner that is equal to "aligner".
+ * Return a copy of the reordering if it is found and NULL otherwise.
+ */
+static __isl_give isl_reordering *reordering_cache_find(isl_ctx *ctx,
+	__isl_keep isl_space *alignee, __isl_keep isl_space *aligner)
+{
+	int i;
+
+	for (i = 0; i < ctx->n_reordering_cache; ++i) {
+		if (!isl_space_match(ctx->reordering_alignee[i], isl_dim_param,
+				    alignee, isl_dim_param))
+			continue;
+		if (isl_space_is_equal(ctx->reordering_aligner[i], aligner) <= 0)
+			continue;
+		reordering_cache_move_to_front(ctx, i);
+		return isl_reordering_copy(ctx->reordering_cache[0]);
+	}
+
+	return NULL;
+}
+
+/* Add the reordering "exp" computed for "alignee" and "aligner"
+ * to the front of the cache of "ctx", evicting the least recently
+ * used entry if the cache is full.
+ */
+static void reordering_cache_add(isl_ctx *ctx, __isl_keep isl_space *alignee,
+	__isl_keep isl_space *aligner, __isl_keep isl_reordering *exp)
+{
+	int n = ctx->n_reordering_cache;
+	isl_space *params;
+
+	params = isl_space_params(isl_space_copy(alignee));
+	if (!params)
+		return;
+
+	if (n == ISL_REORDERING_CACHE_SIZE) {
+		--n;
+		isl_space_free(ctx->reordering_alignee[n]);
+		isl_space_free(ctx->reordering_aligner[n]);
+		isl_reordering_free(ctx->reordering_cache[n]);
+	}
+	ctx->reordering_alignee[n] = params;
+	ctx->reordering_aligner[n] = isl_space_copy(aligner);
+	ctx->reordering_cache[n] = isl_reordering_copy(exp);
+	ctx->n_reordering_cache = n + 1;
+	reordering_cache_move_to_front(ctx, n);
+}
+
+/* Construct a reordering that maps the parameters of "alignee"
+ * to the corresponding parameters in a new dimension specification
+ * that has the parameters of "aligner" first, followed by
+ * any remaining parameters of "alignee" that do not occur in "aligner".
+ *
+ * The same alignments tend to be performed over and over again,
+ * so the most recently computed reorderings are kept in a cache
+ * and reused if they were computed for an alignee with the same
+ * parameters and for the same aligner.
+ */
+__isl_give isl_reordering *isl_parameter_alignment_reordering(
+	__isl_keep isl_space *alignee, __isl_keep isl_space *aligner)
+{
+	isl_reordering *exp;
+
+	if (!alignee || !aligner)
+		return NULL;
+
+	exp = reordering_cache_find(alignee->ctx, alignee, aligner);
+	if (exp) {
+		alignee->ctx->stats->reordering_cache_hits++;
+		return exp;
+	}
+	alignee->ctx->stats->reordering_cache_misses++;
+
+	exp = parameter_alignment_reordering(alignee, aligner);
+	if (exp)
+		reordering_cache_add(alignee->ctx, alignee, aligner, exp);
+
+	return exp;
+}
+
 __isl_give isl_reordering *isl_reordering_extend(__isl_take isl_reordering *exp,
 	unsigned extra)
 {
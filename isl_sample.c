@@ -20,6 +20,8 @@
 #include <isl_point_private.h>
 #include <isl_options_private.h>
 #include <isl_vec_private.h>
+#include <isl_sort.h>
+#include <isl_thread.h>
 
 static struct isl_vec *empty_sample(struct isl_basic_set *bset)
 {
@@ -306,6 +308,102 @@ static int greedy_search(isl_ctx *ctx, struct isl_tab *tab,
 	return 0;
 }
 
+/* Start a centre-out scan of the range [min, max] at "level"
+ * by setting "mid" to the (rounded down) middle of the range and
+ * "lo" and "hi" to the first candidate values below and above
+ * (or at) this middle.
+ */
+static void centre_out_init(__isl_keep isl_vec *min, __isl_keep isl_vec *max,
+	__isl_keep isl_vec *mid, __isl_keep isl_vec *lo,
+	__isl_keep isl_vec *hi, int level)
+{
+	isl_int_add(mid->el[level], min->el[level], max->el[level]);
+	isl_int_fdiv_q_ui(mid->el[level], mid->el[level], 2);
+	isl_int_set(hi->el[level], mid->el[level]);
+	isl_int_sub_ui(lo->el[level], mid->el[level], 1);
+}
+
+/* Select the next value in a centre-out scan of the range [min, max]
+ * at "level" and store it in "v".
+ * The values are visited in order of increasing distance
+ * from the middle of the range, with the value above the middle
+ * preceding the value at the same distance below the middle.
+ * That is, we pick "hi" if hi - mid <= mid - lo - 1 or if "lo"
+ * has dropped below "min".
+ * Note that "hi" may also lie below "min" if the range is empty.
+ * Return 1 if a value was selected and 0 if the range has been exhausted.
+ */
+static int centre_out_next(__isl_keep isl_vec *min, __isl_keep isl_vec *max,
+	__isl_keep isl_vec *mid, __isl_keep isl_vec *lo,
+	__isl_keep isl_vec *hi, int level, isl_int *v)
+{
+	int up, down;
+
+	up = isl_int_le(hi->el[level], max->el[level]) &&
+	     isl_int_ge(hi->el[level], min->el[level]);
+	down = isl_int_ge(lo->el[level], min->el[level]);
+	if (up && down) {
+		isl_int_add(*v, hi->el[level], lo->el[level]);
+		isl_int_submul_ui(*v, mid->el[level], 2);
+		up = isl_int_is_neg(*v);
+	}
+	if (up) {
+		isl_int_set(*v, hi->el[level]);
+		isl_int_add_ui(hi->el[level], hi->el[level], 1);
+		return 1;
+	}
+	if (down) {
+		isl_int_set(*v, lo->el[level]);
+		isl_int_sub_ui(lo->el[level], lo->el[level], 1);
+		return 1;
+	}
+	return 0;
+}
+
+/* Record the width max - min of "tab" in direction "level" of its basis,
+ * which has just been reduced, in tab->basis_width.
+ * The later directions may still be changed by subsequent reductions
+ * and their recorded widths are therefore reset.
+ */
+static int record_width(struct isl_ctx *ctx, struct isl_tab *tab,
+	struct isl_vec *min, struct isl_vec *max, int level)
+{
+	if (!tab->basis_width) {
+		tab->basis_width = isl_vec_alloc(ctx, tab->n_var);
+		if (!tab->basis_width)
+			return -1;
+		isl_seq_clr(tab->basis_width->el, tab->n_var);
+	}
+	isl_int_sub(tab->basis_width->el[level],
+		    max->el[level], min->el[level]);
+	isl_seq_clr(tab->basis_width->el + level + 1, tab->n_var - level - 1);
+	return 0;
+}
+
+/* Can direction "level" of the basis of "tab", which was reduced
+ * by an earlier call to isl_tab_sample, be used without
+ * reducing it again?
+ * That is, is its current width max - min at most gbr_reuse times
+ * the width right after it was reduced?
+ */
+static int reuse_reduced(struct isl_ctx *ctx, struct isl_tab *tab,
+	struct isl_vec *min, struct isl_vec *max, int level)
+{
+	int reuse;
+	isl_int w;
+
+	if (isl_int_is_zero(tab->basis_width->el[level]))
+		return 0;
+	isl_int_init(w);
+	isl_int_sub(w, max->el[level], min->el[level]);
+	isl_int_submul_ui(w, tab->basis_width->el[level], ctx->opt->gbr_reuse);
+	reuse = !isl_int_is_pos(w);
+	isl_int_clear(w);
+	if (reuse)
+		ctx->stats->gbr_basis_reuses++;
+	return reuse;
+}
+
 /* Given a tableau representing a set, find and return
  * an integer point in the set, if there is any.
  *
@@ -360,6 +458,23 @@ static int greedy_search(isl_ctx *ctx, struct isl_tab *tab,
  * When ctx->opt->gbr is set to ISL_GBR_ALWAYS, then we allow the basis
  * reduction computation to return early.  That is, as soon as it
  * finds a reasonable first direction.
+ *
+ * The width in each direction right after a basis reduction
+ * is recorded in tab->basis_width.  If the basis was already reduced
+ * by an earlier call on the same tableau (e.g., the context tableau
+ * of parametric integer programming to which some constraints
+ * have been added since), then a direction is only reduced again
+ * if its current width exceeds the recorded width by more than
+ * the factor specified by the gbr_reuse option.
+ *
+ * By default, the values at each level are scanned in increasing order,
+ * from min to max.  If ctx->opt->sample_centre_out is set, then they
+ * are scanned starting from the middle of the range instead, which
+ * tends to reach a feasible leaf earlier when the set is non-empty.
+ * The scanned values are the same in both cases, so the emptiness
+ * result does not depend on this option, but the sample that is
+ * found may.  The number of values that are tried is recorded
+ * in the sample_nodes statistic.
  */ 
 struct isl_vec *isl_tab_sample(struct isl_tab *tab)
 {
@@ -373,6 +488,11 @@ struct isl_vec *isl_tab_sample(struct isl_tab *tab)
 	int level;
 	int init;
 	int reduced;
+	int reuse;
+	int centre_out;
+	struct isl_vec *mid = NULL;
+	struct isl_vec *lo = NULL;
+	struct isl_vec *hi = NULL;
 	struct isl_tab_undo **snap;
 
 	if (!tab)
@@ -380,6 +500,13 @@ struct isl_vec *isl_tab_sample(struct isl_tab *tab)
 	if (tab->empty)
 		return isl_vec_alloc(tab->mat->ctx, 0);
 
+	ctx = tab->mat->ctx;
+	if (!tab->basis || (tab->basis_width &&
+			    tab->basis_width->size != tab->n_var)) {
+		isl_vec_free(tab->basis_width);
+		tab->basis_width = NULL;
+	}
+	reuse = tab->basis_width && ctx->opt->gbr_reuse > 0;
 	if (!tab->basis)
 		tab->basis = initial_basis(tab);
 	if (!tab->basis)
@@ -389,7 +516,6 @@ struct isl_vec *isl_tab_sample(struct isl_tab *tab)
 	isl_assert(tab->mat->ctx, tab->basis->n_col == tab->n_var + 1,
 		    return NULL);
 
-	ctx = tab->mat->ctx;
 	dim = tab->n_var;
 	gbr = ctx->opt->gbr;
 
@@ -412,6 +538,15 @@ struct isl_vec *isl_tab_sample(struct isl_tab *tab)
 	if (!min || !max || !snap)
 		goto error;
 
+	centre_out = ctx->opt->sample_centre_out;
+	if (centre_out) {
+		mid = isl_vec_alloc(ctx, dim);
+		lo = isl_vec_alloc(ctx, dim);
+		hi = isl_vec_alloc(ctx, dim);
+		if (!mid || !lo || !hi)
+			goto error;
+	}
+
 	level = 0;
 	init = 1;
 	reduced = 0;
@@ -447,6 +582,9 @@ struct isl_vec *isl_tab_sample(struct isl_tab *tab)
 				if (g)
 					break;
 			}
+			if (!reduced && choice && reuse &&
+			    reuse_reduced(ctx, tab, min, max, level))
+				choice = 0;
 			if (!reduced && choice &&
 			    ctx->opt->gbr != ISL_GBR_NEVER) {
 				unsigned gbr_only_first;
@@ -463,12 +601,20 @@ struct isl_vec *isl_tab_sample(struct isl_tab *tab)
 				reduced = 1;
 				continue;
 			}
+			if (reduced && record_width(ctx, tab, min, max,
+							level) < 0)
+				goto error;
 			reduced = 0;
 			snap[level] = isl_tab_snap(tab);
-		} else
+			if (centre_out)
+				centre_out_init(min, max, mid, lo, hi, level);
+		} else if (!centre_out)
 			isl_int_add_ui(min->el[level], min->el[level], 1);
 
-		if (isl_int_gt(min->el[level], max->el[level])) {
+		if (centre_out ?
+		    !centre_out_next(min, max, mid, lo, hi, level,
+					&tab->basis->row[1 + level][0]) :
+		    isl_int_gt(min->el[level], max->el[level])) {
 			level--;
 			init = 0;
 			if (level >= 0)
@@ -476,7 +622,13 @@ struct isl_vec *isl_tab_sample(struct isl_tab *tab)
 					goto error;
 			continue;
 		}
-		isl_int_neg(tab->basis->row[1 + level][0], min->el[level]);
+		ctx->stats->sample_nodes++;
+		if (centre_out)
+			isl_int_neg(tab->basis->row[1 + level][0],
+				    tab->basis->row[1 + level][0]);
+		else
+			isl_int_neg(tab->basis->row[1 + level][0],
+				    min->el[level]);
 		if (isl_tab_add_valid_eq(tab, tab->basis->row[1 + level]) < 0)
 			goto error;
 		isl_int_set_si(tab->basis->row[1 + level][0], 0);
@@ -505,62 +657,182 @@ struct isl_vec *isl_tab_sample(struct isl_tab *tab)
 	ctx->opt->gbr = gbr;
 	isl_vec_free(min);
 	isl_vec_free(max);
+	isl_vec_free(mid);
+	isl_vec_free(lo);
+	isl_vec_free(hi);
 	free(snap);
 	return sample;
 error:
 	ctx->opt->gbr = gbr;
 	isl_vec_free(min);
 	isl_vec_free(max);
+	isl_vec_free(mid);
+	isl_vec_free(lo);
+	isl_vec_free(hi);
 	free(snap);
 	return NULL;
 }
 
 static struct isl_vec *sample_bounded(struct isl_basic_set *bset);
 
+#ifdef HAVE_PTHREAD
+
+/* Data used by sample_factors_threads for computing sample points
+ * of the factors "factors" of the factorization "f" by calling
+ * "sample_factor" on each of them.
+ * pos[i] is the position of the sample point of factor "i" in "sample".
+ * "empty" is set as soon as some factor turns out to be empty,
+ * after which the remaining factors are not sampled.
+ */
+struct isl_sample_factors {
+	isl_basic_set_list *factors;
+	isl_factorizer *f;
+	struct isl_vec *(*sample_factor)(struct isl_basic_set *bset);
+	int *pos;
+	isl_vec *sample;
+	int empty;
+};
+
+/* Compute a sample point of factor "i" in the isl_ctx of "worker",
+ * unless some factor has already turned out to be empty, and
+ * copy it into data->sample.
+ */
+static int sample_factor(struct isl_thread_worker *worker, int i, void *user)
+{
+	struct isl_sample_factors *data = user;
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	isl_basic_set *factor = NULL;
+	isl_vec *sample;
+	int skip;
+
+	isl_thread_worker_lock(worker);
+	skip = data->empty;
+	if (!skip) {
+		isl_basic_set *bset;
+
+		bset = isl_basic_set_list_get_basic_set(data->factors, i);
+		factor = isl_basic_set_import(ctx, bset);
+		isl_basic_set_free(bset);
+	}
+	isl_thread_worker_unlock(worker);
+	if (skip)
+		return 0;
+
+	sample = data->sample_factor(factor);
+	if (!sample)
+		return -1;
+
+	isl_thread_worker_lock(worker);
+	if (sample->size == 0)
+		data->empty = 1;
+	else
+		isl_seq_cpy(data->sample->el + data->pos[i],
+			    sample->el + 1, data->f->len[i]);
+	isl_thread_worker_unlock(worker);
+
+	isl_vec_free(sample);
+	return 0;
+}
+
+/* Compute sample points of the factors "factors" of the factorization "f"
+ * by calling "sample_factor" on each of them, using several threads,
+ * and store them in "sample" starting at position "pos".
+ * Return 1 if all factors have a sample point, 0 if some factor
+ * is empty and -1 on error.
+ *
+ * Each factor is sampled in a separate isl_ctx (see isl_thread_run).
+ * Since the factors are independent, the result is the same
+ * as that of sampling them one after the other.
+ */
+static int sample_factors_threads(__isl_keep isl_basic_set_list *factors,
+	__isl_keep isl_factorizer *f, __isl_keep isl_vec *sample, int pos,
+	struct isl_vec *(*sample_factor_fn)(struct isl_basic_set *bset))
+{
+	int i, r;
+	isl_ctx *ctx = isl_vec_get_ctx(sample);
+	struct isl_sample_factors data = { factors, f, sample_factor_fn };
+
+	data.pos = isl_alloc_array(ctx, int, f->n_group);
+	if (!data.pos)
+		return -1;
+	for (i = 0; i < f->n_group; ++i) {
+		data.pos[i] = pos;
+		pos += f->len[i];
+	}
+	data.sample = sample;
+
+	r = isl_thread_run(ctx, f->n_group, &sample_factor, &data);
+	free(data.pos);
+
+	if (r < 0)
+		return -1;
+	return !data.empty;
+}
+#endif
+
 /* Compute a sample point of the given basic set, based on the given,
- * non-trivial factorization.
+ * non-trivial factorization, by calling "sample_factor"
+ * on each of the factors.
+ * The sample points of the factors are combined into a sample point
+ * of the transformed basic set, which is then mapped back
+ * to the original space.
+ * If the threads option is greater than one and isl has been
+ * built with thread support, then the factors are sampled
+ * in parallel by sample_factors_threads, provided at least two
+ * of them involve more than one variable.  Otherwise, the cost
+ * of the worker isl_ctx objects exceeds that of the sampling.
  */
 static __isl_give isl_vec *factored_sample(__isl_take isl_basic_set *bset,
-	__isl_take isl_factorizer *f)
+	__isl_take isl_factorizer *f,
+	struct isl_vec *(*sample_factor)(struct isl_basic_set *bset))
 {
 	int i, n;
 	isl_vec *sample = NULL;
 	isl_ctx *ctx;
+	isl_basic_set_list *factors;
 	unsigned nparam;
-	unsigned nvar;
 
 	ctx = isl_basic_set_get_ctx(bset);
 	if (!ctx)
 		goto error;
 
 	nparam = isl_basic_set_dim(bset, isl_dim_param);
-	nvar = isl_basic_set_dim(bset, isl_dim_set);
 
 	sample = isl_vec_alloc(ctx, 1 + isl_basic_set_total_dim(bset));
 	if (!sample)
 		goto error;
 	isl_int_set_si(sample->el[0], 1);
 
-	bset = isl_morph_basic_set(isl_morph_copy(f->morph), bset);
-
+	factors = isl_factorizer_factors(f, bset);
+	if (!factors)
+		goto error_factors;
+
+#ifdef HAVE_PTHREAD
+	if (ctx->opt->threads > 1 &&
+	    isl_factorizer_n_nontrivial_group(f) >= 2) {
+		int r;
+
+		r = sample_factors_threads(factors, f, sample, 1 + nparam,
+					    sample_factor);
+		if (r < 0)
+			goto error_factors;
+		if (r == 0) {
+			isl_basic_set_list_free(factors);
+			isl_factorizer_free(f);
+			isl_vec_free(sample);
+			return isl_vec_alloc(ctx, 0);
+		}
+	} else
+#endif
 	for (i = 0, n = 0; i < f->n_group; ++i) {
-		isl_basic_set *bset_i;
 		isl_vec *sample_i;
 
-		bset_i = isl_basic_set_copy(bset);
-		bset_i = isl_basic_set_drop_constraints_involving(bset_i,
-			    nparam + n + f->len[i], nvar - n - f->len[i]);
-		bset_i = isl_basic_set_drop_constraints_involving(bset_i,
-			    nparam, n);
-		bset_i = isl_basic_set_drop(bset_i, isl_dim_set,
-			    n + f->len[i], nvar - n - f->len[i]);
-		bset_i = isl_basic_set_drop(bset_i, isl_dim_set, 0, n);
-
-		sample_i = sample_bounded(bset_i);
+		sample_i = sample_factor(isl_basic_set_list_get_basic_set(
+							factors, i));
 		if (!sample_i)
-			goto error;
+			goto error_factors;
 		if (sample_i->size == 0) {
-			isl_basic_set_free(bset);
+			isl_basic_set_list_free(factors);
 			isl_factorizer_free(f);
 			isl_vec_free(sample);
 			return sample_i;
@@ -575,7 +847,7 @@ static __isl_give isl_vec *factored_sample(__isl_take isl_basic_set *bset,
 	f->morph = isl_morph_inverse(f->morph);
 	sample = isl_morph_vec(isl_morph_copy(f->morph), sample);
 
-	isl_basic_set_free(bset);
+	isl_basic_set_list_free(factors);
 	isl_factorizer_free(f);
 	return sample;
 error:
@@ -583,14 +855,303 @@ error:
 	isl_factorizer_free(f);
 	isl_vec_free(sample);
 	return NULL;
+error_factors:
+	isl_basic_set_list_free(factors);
+	isl_factorizer_free(f);
+	isl_vec_free(sample);
+	return NULL;
+}
+
+#ifdef HAVE_PTHREAD
+
+/* The maximal number of slabs into which sample_tab_threads splits
+ * the range of a direction.
+ */
+#define ISL_SAMPLE_MAX_SLABS	64
+
+/* Data shared by the workers of sample_tab_threads.
+ * "bset" lives in the isl_ctx of the caller and "basis" is
+ * the basis of the tableau constructed from "bset".
+ * The first "level" directions of "basis" only attain
+ * a single integer value over "bset", stored in "fixed".
+ * The "width" values of direction "level" starting at "min" are split
+ * into "n" slabs of consecutive values.
+ * "found" is the index of the first slab in which an integer point
+ * has been found so far, or -1 if no such point has been found yet,
+ * and "sample" is this point, in the isl_ctx of the caller.
+ */
+struct isl_sample_threads {
+	isl_basic_set *bset;
+	isl_mat *basis;
+	int level;
+	isl_vec *fixed;
+	isl_int min;
+	isl_int width;
+	int n;
+	int found;
+	isl_vec *sample;
+};
+
+/* Set "v" to the smallest value of direction data->level in slab "i".
+ */
+static void slab_start(struct isl_sample_threads *data, int i, isl_int *v)
+{
+	isl_int_mul_ui(*v, data->width, i);
+	isl_int_fdiv_q_ui(*v, *v, data->n);
+	isl_int_add(*v, *v, data->min);
 }
 
+/* Add the constraint "dir" x = "v" to "bset".
+ */
+static __isl_give isl_basic_set *add_fixed(__isl_take isl_basic_set *bset,
+	isl_int *dir, isl_int v)
+{
+	int k;
+
+	k = isl_basic_set_alloc_equality(bset);
+	if (k < 0)
+		return isl_basic_set_free(bset);
+	isl_seq_cpy(bset->eq[k], dir, 1 + isl_basic_set_total_dim(bset));
+	isl_int_neg(bset->eq[k][0], v);
+	return bset;
+}
+
+/* Add the constraints "dir" x >= "lo" and "dir" x <= "hi" to "bset".
+ */
+static __isl_give isl_basic_set *add_range(__isl_take isl_basic_set *bset,
+	isl_int *dir, isl_int lo, isl_int hi)
+{
+	int k;
+	unsigned total = isl_basic_set_total_dim(bset);
+
+	k = isl_basic_set_alloc_inequality(bset);
+	if (k < 0)
+		return isl_basic_set_free(bset);
+	isl_seq_cpy(bset->ineq[k], dir, 1 + total);
+	isl_int_neg(bset->ineq[k][0], lo);
+	k = isl_basic_set_alloc_inequality(bset);
+	if (k < 0)
+		return isl_basic_set_free(bset);
+	isl_seq_neg(bset->ineq[k], dir, 1 + total);
+	isl_int_set(bset->ineq[k][0], hi);
+	return bset;
+}
+
+/* Restrict "bset" to the fixed values of the first data->level
+ * directions and to the values of direction data->level in slab "i".
+ * If the slab consists of a single value, then the latter restriction
+ * is also imposed as an equality such that the direction can be
+ * eliminated by sample_eq.
+ */
+static __isl_give isl_basic_set *add_slab(__isl_take isl_basic_set *bset,
+	struct isl_sample_threads *data, int i)
+{
+	int j;
+	isl_int lo, hi;
+
+	bset = isl_basic_set_cow(bset);
+	bset = isl_basic_set_extend_constraints(bset, data->level + 1, 2);
+	for (j = 0; j < data->level; ++j)
+		bset = add_fixed(bset, data->basis->row[1 + j],
+				data->fixed->el[j]);
+	if (!bset)
+		return NULL;
+
+	isl_int_init(lo);
+	isl_int_init(hi);
+	slab_start(data, i, &lo);
+	slab_start(data, i + 1, &hi);
+	isl_int_sub_ui(hi, hi, 1);
+	if (isl_int_eq(lo, hi))
+		bset = add_fixed(bset, data->basis->row[1 + data->level], lo);
+	else
+		bset = add_range(bset, data->basis->row[1 + data->level],
+				lo, hi);
+	isl_int_clear(lo);
+	isl_int_clear(hi);
+
+	return isl_basic_set_finalize(bset);
+}
+
+/* Look for an integer point in slab "i" of data->bset
+ * in the isl_ctx of "worker", unless an integer point has already
+ * been found in an earlier slab.
+ * If a point is found and no point has been found in an earlier slab
+ * in the mean time, then store the point in data->sample.
+ */
+static int sample_slab(struct isl_thread_worker *worker, int i, void *user)
+{
+	struct isl_sample_threads *data = user;
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	isl_basic_set *bset = NULL;
+	isl_vec *sample;
+	int skip;
+	int ok = 1;
+
+	isl_thread_worker_lock(worker);
+	skip = data->found >= 0 && data->found < i;
+	if (!skip)
+		bset = add_slab(isl_basic_set_import(ctx, data->bset), data, i);
+	isl_thread_worker_unlock(worker);
+	if (skip)
+		return 0;
+
+	sample = isl_basic_set_sample_bounded(bset);
+	if (!sample)
+		return -1;
+	if (sample->size == 0) {
+		isl_vec_free(sample);
+		return 0;
+	}
+
+	isl_thread_worker_lock(worker);
+	if (data->found < 0 || i < data->found) {
+		isl_vec_free(data->sample);
+		data->sample = isl_vec_alloc(data->bset->ctx, sample->size);
+		if (data->sample)
+			isl_seq_cpy(data->sample->el, sample->el, sample->size);
+		data->found = i;
+		ok = data->sample != NULL;
+	}
+	isl_thread_worker_unlock(worker);
+
+	isl_vec_free(sample);
+	return ok ? 0 : -1;
+}
+
+/* Search the slabs of the range of direction "level" of the basis
+ * of "tab" between "min" and "max" for an integer point of "bset",
+ * given that the directions before "level" attain the single values
+ * in "fixed", using several threads.
+ *
+ * The range is split into at most ISL_SAMPLE_MAX_SLABS slabs of
+ * consecutive values.  Each slab is searched in a separate isl_ctx
+ * (see isl_thread_run) by a sequential call
+ * to isl_basic_set_sample_bounded on "bset" restricted to the slab.
+ * Slabs that come after a slab in which a point has already been found
+ * are skipped.  The result is the point found in the first slab
+ * that contains any, which does not depend on the number of threads.
+ */
+static __isl_give isl_vec *sample_slabs(__isl_keep isl_basic_set *bset,
+	struct isl_tab *tab, int level, __isl_keep isl_vec *fixed,
+	isl_int min, isl_int max)
+{
+	isl_ctx *ctx = tab->mat->ctx;
+	struct isl_sample_threads data = { bset, tab->basis, level, fixed };
+
+	isl_int_init(data.min);
+	isl_int_init(data.width);
+	isl_int_set(data.min, min);
+	isl_int_sub(data.width, max, min);
+	isl_int_add_ui(data.width, data.width, 1);
+	if (isl_int_cmp_si(data.width, ISL_SAMPLE_MAX_SLABS) > 0)
+		data.n = ISL_SAMPLE_MAX_SLABS;
+	else
+		data.n = isl_int_get_si(data.width);
+	data.found = -1;
+	if (isl_thread_run(ctx, data.n, &sample_slab, &data) < 0)
+		data.sample = isl_vec_free(data.sample);
+	else if (data.found < 0)
+		data.sample = isl_vec_alloc(ctx, 0);
+	isl_int_clear(data.min);
+	isl_int_clear(data.width);
+
+	return data.sample;
+}
+
+/* Given a tableau "tab" representing the bounded basic set "bset",
+ * find and return an integer point in the set, if there is any,
+ * using several threads.
+ *
+ * Since a reduced basis tends to have a first direction
+ * that only attains a single integer value, the same holds
+ * for most of the nodes near the root of the search tree
+ * of isl_tab_sample.  These directions are therefore handled
+ * as in isl_tab_sample, reducing the basis of the remaining directions
+ * and fixing each direction to its single value, until a direction
+ * is found with several values.  The subtrees for these values are
+ * then searched in parallel by sample_slabs.
+ * If no such direction is found or if the rational sample happens
+ * to be integral, then isl_tab_sample is called on the tableau
+ * instead.  Note that fixing the directions does not remove
+ * any integer points from the set represented by the tableau.
+ */
+static __isl_give isl_vec *sample_tab_threads(__isl_keep isl_basic_set *bset,
+	struct isl_tab *tab)
+{
+	isl_ctx *ctx = tab->mat->ctx;
+	unsigned dim = tab->n_var;
+	isl_vec *min, *max;
+	isl_vec *sample;
+	enum isl_lp_result res;
+	int level;
+
+	if (tab->empty)
+		return isl_tab_sample(tab);
+	isl_mat_free(tab->basis);
+	tab->basis = initial_basis(tab);
+	if (!tab->basis || isl_tab_extend_cons(tab, dim + 1) < 0)
+		return NULL;
+
+	min = isl_vec_alloc(ctx, dim);
+	max = isl_vec_alloc(ctx, dim);
+	if (!min || !max)
+		goto error;
+
+	for (level = 0; level < dim; ++level) {
+		if (ctx->opt->gbr == ISL_GBR_ALWAYS ||
+		    (ctx->opt->gbr == ISL_GBR_ONCE && level == 0)) {
+			int gbr_only_first = ctx->opt->gbr_only_first;
+
+			if (tab->n_zero < level)
+				tab->n_zero = level;
+			ctx->opt->gbr_only_first = 1;
+			tab = isl_tab_compute_reduced_basis(tab);
+			ctx->opt->gbr_only_first = gbr_only_first;
+			if (!tab || !tab->basis)
+				goto error;
+		}
+		res = compute_min(ctx, tab, min, level);
+		if (res == isl_lp_ok && !isl_tab_sample_is_integer(tab))
+			res = compute_max(ctx, tab, max, level);
+		if (res == isl_lp_error)
+			goto error;
+		if (res != isl_lp_ok || isl_tab_sample_is_integer(tab) ||
+		    isl_int_gt(min->el[level], max->el[level]))
+			break;
+		if (isl_int_lt(min->el[level], max->el[level])) {
+			sample = sample_slabs(bset, tab, level, min,
+					min->el[level], max->el[level]);
+			isl_vec_free(min);
+			isl_vec_free(max);
+			return sample;
+		}
+		isl_int_neg(tab->basis->row[1 + level][0], min->el[level]);
+		if (isl_tab_add_valid_eq(tab, tab->basis->row[1 + level]) < 0)
+			goto error;
+		isl_int_set_si(tab->basis->row[1 + level][0], 0);
+	}
+
+	isl_vec_free(min);
+	isl_vec_free(max);
+	return isl_tab_sample(tab);
+error:
+	isl_vec_free(min);
+	isl_vec_free(max);
+	return NULL;
+}
+
+#endif
+
 /* Given a basic set that is known to be bounded, find and return
  * an integer point in the basic set, if there is any.
  *
  * After handling some trivial cases, we construct a tableau
  * and then use isl_tab_sample to find a sample, passing it
  * the identity matrix as initial basis.
+ * If the threads option is greater than one and isl has been
+ * built with thread support, then the search is split over
+ * several threads by sample_tab_threads instead.
  */ 
 static struct isl_vec *sample_bounded(struct isl_basic_set *bset)
 {
@@ -618,7 +1179,7 @@ static struct isl_vec *sample_bounded(struct isl_basic_set *bset)
 	if (!f)
 		goto error;
 	if (f->n_group != 0)
-		return factored_sample(bset, f);
+		return factored_sample(bset, f, &sample_bounded);
 	isl_factorizer_free(f);
 		
 	ctx = bset->ctx;
@@ -636,6 +1197,11 @@ static struct isl_vec *sample_bounded(struct isl_basic_set *bset)
 		if (isl_tab_detect_implicit_equalities(tab) < 0)
 			goto error;
 
+#ifdef HAVE_PTHREAD
+	if (ctx->opt->threads > 1)
+		sample = sample_tab_threads(bset, tab);
+	else
+#endif
 	sample = isl_tab_sample(tab);
 	if (!sample)
 		goto error;
@@ -710,7 +1276,7 @@ static struct isl_vec *rational_sample(struct isl_basic_set *bset)
 	if (!bset)
 		return NULL;
 
-	tab = isl_tab_from_basic_set(bset, 0);
+	tab = isl_tab_lean_from_basic_set(bset);
 	sample = isl_tab_get_sample_value(tab);
 	isl_tab_free(tab);
 
@@ -1062,6 +1628,8 @@ int isl_tab_set_initial_basis_with_cone(struct isl_tab *tab,
 	if (!tab || !tab_cone)
 		return -1;
 
+	isl_vec_free(tab->basis_width);
+	tab->basis_width = NULL;
 	if (tab_cone->n_col == tab_cone->n_dead) {
 		tab->basis = initial_basis(tab);
 		return tab->basis ? 0 : -1;
@@ -1115,6 +1683,272 @@ error:
 	return NULL;
 }
 
+/* An entry in the cache of sampling results of an isl_ctx.
+ * "key" contains the equalities (the first "n_eq" rows) and
+ * the inequalities of the sampled basic set, each sorted and
+ * with the equalities normalized to have a positive first
+ * non-zero coefficient.
+ * "sample" is the sample point that was found or
+ * a zero-length vector if the basic set was found to be empty.
+ */
+struct isl_sample_cache_entry {
+	uint32_t	hash;
+	int		rational;
+	int		n_eq;
+	isl_mat		*key;
+	isl_vec		*sample;
+
+	struct isl_sample_cache_entry	*prev;
+	struct isl_sample_cache_entry	*next;
+};
+
+static void sample_cache_entry_free(struct isl_sample_cache_entry *entry)
+{
+	if (!entry)
+		return;
+	isl_mat_free(entry->key);
+	isl_vec_free(entry->sample);
+	free(entry);
+}
+
+/* Remove "entry" from the list of cache entries of "ctx".
+ */
+static void sample_cache_unlink(isl_ctx *ctx,
+	struct isl_sample_cache_entry *entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		ctx->sample_cache_first = entry->next;
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		ctx->sample_cache_last = entry->prev;
+	entry->prev = entry->next = NULL;
+}
+
+/* Add "entry" to the front of the list of cache entries of "ctx".
+ */
+static void sample_cache_push_front(isl_ctx *ctx,
+	struct isl_sample_cache_entry *entry)
+{
+	entry->prev = NULL;
+	entry->next = ctx->sample_cache_first;
+	if (ctx->sample_cache_first)
+		ctx->sample_cache_first->prev = entry;
+	else
+		ctx->sample_cache_last = entry;
+	ctx->sample_cache_first = entry;
+}
+
+/* Remove all entries from the sample cache of "ctx".
+ */
+void isl_sample_cache_clear(isl_ctx *ctx)
+{
+	struct isl_sample_cache_entry *entry, *next;
+
+	for (entry = ctx->sample_cache_first; entry; entry = next) {
+		next = entry->next;
+		sample_cache_entry_free(entry);
+	}
+	ctx->sample_cache_first = ctx->sample_cache_last = NULL;
+	ctx->n_sample_cache = 0;
+	isl_hash_table_clear(&ctx->sample_cache);
+	isl_hash_table_init(ctx, &ctx->sample_cache, 0);
+}
+
+static int sample_cache_row_cmp(const void *p1, const void *p2, void *arg)
+{
+	isl_int **c1 = (isl_int **) p1;
+	isl_int **c2 = (isl_int **) p2;
+	unsigned len = *(unsigned *) arg;
+
+	return isl_seq_cmp(*c1, *c2, len);
+}
+
+/* Construct the key of "bset" in the sample cache and
+ * compute its hash value in "hash".
+ * The result only depends on the constraints of "bset" and
+ * not on the order in which they appear or on the sign
+ * of the equalities.
+ */
+static __isl_give isl_mat *sample_cache_key(__isl_keep isl_basic_set *bset,
+	uint32_t *hash)
+{
+	int i, j;
+	unsigned len;
+	isl_mat *key;
+
+	len = 1 + isl_basic_set_total_dim(bset);
+	key = isl_mat_alloc(bset->ctx, bset->n_eq + bset->n_ineq, len);
+	if (!key)
+		return NULL;
+
+	for (i = 0; i < bset->n_eq; ++i) {
+		j = isl_seq_first_non_zero(bset->eq[i], len);
+		if (j >= 0 && isl_int_is_neg(bset->eq[i][j]))
+			isl_seq_neg(key->row[i], bset->eq[i], len);
+		else
+			isl_seq_cpy(key->row[i], bset->eq[i], len);
+	}
+	for (i = 0; i < bset->n_ineq; ++i)
+		isl_seq_cpy(key->row[bset->n_eq + i], bset->ineq[i], len);
+
+	if (isl_sort(key->row, bset->n_eq, sizeof(isl_int *),
+		    &sample_cache_row_cmp, &len) < 0 ||
+	    isl_sort(key->row + bset->n_eq, bset->n_ineq, sizeof(isl_int *),
+		    &sample_cache_row_cmp, &len) < 0)
+		return isl_mat_free(key);
+
+	*hash = isl_hash_init();
+	isl_hash_byte(*hash, bset->n_eq & 0xFF);
+	isl_hash_byte(*hash, len & 0xFF);
+	for (i = 0; i < key->n_row; ++i)
+		isl_hash_hash(*hash, isl_seq_get_hash(key->row[i], len));
+
+	return key;
+}
+
+/* A basic set that is being looked up in the sample cache.
+ */
+struct isl_sample_cache_query {
+	int	rational;
+	int	n_eq;
+	isl_mat	*key;
+};
+
+static int sample_cache_has_key(const void *entry, const void *val)
+{
+	const struct isl_sample_cache_entry *e = entry;
+	const struct isl_sample_cache_query *q = val;
+	int i;
+
+	if (e->rational != q->rational || e->n_eq != q->n_eq)
+		return 0;
+	if (e->key->n_row != q->key->n_row || e->key->n_col != q->key->n_col)
+		return 0;
+	for (i = 0; i < q->key->n_row; ++i)
+		if (!isl_seq_eq(e->key->row[i], q->key->row[i], q->key->n_col))
+			return 0;
+	return 1;
+}
+
+static int sample_cache_is_entry(const void *entry, const void *val)
+{
+	return entry == val;
+}
+
+/* Remove the least recently used entry from the sample cache of "ctx".
+ */
+static void sample_cache_evict(isl_ctx *ctx)
+{
+	struct isl_sample_cache_entry *entry = ctx->sample_cache_last;
+	struct isl_hash_table_entry *he;
+
+	he = isl_hash_table_find(ctx, &ctx->sample_cache, entry->hash,
+				&sample_cache_is_entry, entry, 0);
+	if (he)
+		isl_hash_table_remove(ctx, &ctx->sample_cache, he);
+	sample_cache_unlink(ctx, entry);
+	sample_cache_entry_free(entry);
+	ctx->n_sample_cache--;
+}
+
+/* Add an entry to the sample cache of "ctx" recording that "sample"
+ * was found for the basic set identified by "q" and "hash",
+ * evicting the least recently used entries if the cache would
+ * otherwise exceed the size specified by the sample_cache_size option.
+ * A copy of "sample" is stored such that later changes
+ * to the sample returned to the user do not affect the cache.
+ * The key of "q" is taken over by the cache.
+ */
+static int sample_cache_add(isl_ctx *ctx, uint32_t hash,
+	struct isl_sample_cache_query *q, __isl_keep isl_vec *sample)
+{
+	struct isl_sample_cache_entry *entry;
+	struct isl_hash_table_entry *he;
+
+	while (ctx->n_sample_cache > 0 &&
+	       ctx->n_sample_cache >= ctx->opt->sample_cache_size)
+		sample_cache_evict(ctx);
+
+	entry = isl_calloc_type(ctx, struct isl_sample_cache_entry);
+	if (!entry)
+		goto error;
+	entry->hash = hash;
+	entry->rational = q->rational;
+	entry->n_eq = q->n_eq;
+	entry->key = q->key;
+	q->key = NULL;
+	entry->sample = isl_vec_dup(sample);
+	if (!entry->sample)
+		goto error;
+
+	he = isl_hash_table_find(ctx, &ctx->sample_cache, hash,
+				&sample_cache_has_key, q, 1);
+	if (!he)
+		goto error;
+	he->data = entry;
+	sample_cache_push_front(ctx, entry);
+	ctx->n_sample_cache++;
+
+	return 0;
+error:
+	sample_cache_entry_free(entry);
+	return -1;
+}
+
+static struct isl_vec *basic_set_sample_core(struct isl_basic_set *bset,
+	int bounded);
+
+/* Compute a sample point of "bset", reusing the result of an earlier
+ * computation on a basic set with the same constraints, if any.
+ * The cache may have been filled up under a larger value
+ * of the sample_cache_size option, so first drop any entries
+ * beyond the current size.
+ */
+static __isl_give isl_vec *basic_set_sample_cached(
+	__isl_take isl_basic_set *bset, int bounded)
+{
+	isl_ctx *ctx = bset->ctx;
+	struct isl_sample_cache_query q;
+	struct isl_hash_table_entry *he;
+	struct isl_sample_cache_entry *entry;
+	isl_vec *sample;
+	uint32_t hash;
+
+	while (ctx->n_sample_cache > ctx->opt->sample_cache_size)
+		sample_cache_evict(ctx);
+
+	q.rational = ISL_F_ISSET(bset, ISL_BASIC_SET_RATIONAL) ? 1 : 0;
+	q.n_eq = bset->n_eq;
+	q.key = sample_cache_key(bset, &hash);
+	if (!q.key)
+		goto error;
+
+	he = isl_hash_table_find(ctx, &ctx->sample_cache, hash,
+				&sample_cache_has_key, &q, 0);
+	if (he) {
+		ctx->stats->sample_cache_hits++;
+		entry = he->data;
+		sample_cache_unlink(ctx, entry);
+		sample_cache_push_front(ctx, entry);
+		isl_mat_free(q.key);
+		isl_basic_set_free(bset);
+		return isl_vec_dup(entry->sample);
+	}
+	ctx->stats->sample_cache_misses++;
+
+	sample = basic_set_sample_core(bset, bounded);
+	if (sample && sample_cache_add(ctx, hash, &q, sample) < 0)
+		sample = isl_vec_free(sample);
+	isl_mat_free(q.key);
+	return sample;
+error:
+	isl_basic_set_free(bset);
+	return NULL;
+}
+
 static struct isl_vec *basic_set_sample(struct isl_basic_set *bset, int bounded)
 {
 	struct isl_ctx *ctx;
@@ -1143,6 +1977,44 @@ static struct isl_vec *basic_set_sample(struct isl_basic_set *bset, int bounded)
 	isl_vec_free(bset->sample);
 	bset->sample = NULL;
 
+	if (ctx->opt->sample_cache_size > 0)
+		return basic_set_sample_cached(bset, bounded);
+	return basic_set_sample_core(bset, bounded);
+error:
+	isl_basic_set_free(bset);
+	return NULL;
+}
+
+/* Compute a sample point of "bset", which may be unbounded.
+ * If "bset" can be factored, then the factors are sampled separately.
+ * Otherwise, generalized basis reduction is applied to the entire set.
+ */
+static struct isl_vec *sample_unbounded(struct isl_basic_set *bset)
+{
+	isl_factorizer *f;
+
+	f = isl_basic_set_factorizer(bset);
+	if (!f)
+		goto error;
+	if (f->n_group != 0)
+		return factored_sample(bset, f, &isl_basic_set_sample_vec);
+	isl_factorizer_free(f);
+
+	return gbr_sample(bset);
+error:
+	isl_basic_set_free(bset);
+	return NULL;
+}
+
+/* Compute a sample point of "bset", which is known not to have
+ * any parameters or existentially quantified variables.
+ */
+static struct isl_vec *basic_set_sample_core(struct isl_basic_set *bset,
+	int bounded)
+{
+	unsigned dim;
+
+	dim = isl_basic_set_n_dim(bset);
 	if (bset->n_eq > 0)
 		return sample_eq(bset, bounded ? isl_basic_set_sample_bounded
 					       : isl_basic_set_sample_vec);
@@ -1151,10 +2023,7 @@ static struct isl_vec *basic_set_sample(struct isl_basic_set *bset, int bounded)
 	if (dim == 1)
 		return interval_sample(bset);
 
-	return bounded ? sample_bounded(bset) : gbr_sample(bset);
-error:
-	isl_basic_set_free(bset);
-	return NULL;
+	return bounded ? sample_bounded(bset) : sample_unbounded(bset);
 }
 
 __isl_give isl_vec *isl_basic_set_sample_vec(__isl_take isl_basic_set *bset)
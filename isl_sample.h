@@ -28,6 +28,8 @@ int isl_tab_set_initial_basis_with_cone(struct isl_tab *tab,
 	struct isl_tab *tab_cone);
 struct isl_vec *isl_tab_sample(struct isl_tab *tab);
 
+void isl_sample_cache_clear(isl_ctx *ctx);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -7,14 +7,19 @@
  * Computerwetenschappen, Celestijnenlaan 200A, B-3001 Leuven, Belgium
  */
 
+#include <stdint.h>
+#include <isl_config.h>
 #include <isl_ctx_private.h>
 #include <isl_map_private.h>
+#include <isl_options_private.h>
 #include "isl_basis_reduction.h"
 #include "isl_scan.h"
 #include <isl_seq.h>
 #include "isl_tab.h"
+#include <isl_factorization.h>
 #include <isl_val_private.h>
 #include <isl_vec_private.h>
+#include <isl_thread.h>
 
 struct isl_counter {
 	struct isl_scan_callback callback;
@@ -65,6 +70,77 @@ static int add_solution(struct isl_tab *tab, struct isl_scan_callback *callback)
 	return callback->add(callback, sample);
 }
 
+/* Return the sample value of "tab" after fixing the value of
+ * the basis direction "dir" (with a zero constant term) to "val",
+ * leaving "tab" in its original state.
+ */
+static __isl_give isl_vec *sample_at(struct isl_tab *tab, isl_int *dir,
+	isl_int val)
+{
+	struct isl_tab_undo *snap;
+	isl_vec *sample;
+
+	snap = isl_tab_snap(tab);
+	isl_int_neg(dir[0], val);
+	if (isl_tab_add_valid_eq(tab, dir) < 0) {
+		isl_int_set_si(dir[0], 0);
+		return NULL;
+	}
+	isl_int_set_si(dir[0], 0);
+	sample = isl_tab_get_sample_value(tab);
+	if (isl_tab_rollback(tab, snap) < 0)
+		return isl_vec_free(sample);
+	return sample;
+}
+
+/* Call callback->add on each of the integer points of "tab" that
+ * have a value in the range [min, max] in the basis direction "dir",
+ * where all other basis directions have already been fixed.
+ *
+ * The integer points form a line segment, so we only need to compute
+ * the first two of them using the tableau.  The remaining points
+ * are obtained by adding the difference between those two points.
+ */
+static int scan_line(struct isl_tab *tab, isl_int *dir, isl_int min,
+	isl_int max, struct isl_scan_callback *callback)
+{
+	isl_int v;
+	isl_vec *sample, *next, *step = NULL;
+
+	sample = sample_at(tab, dir, min);
+	if (!sample)
+		return -1;
+	if (isl_int_eq(min, max))
+		return callback->add(callback, sample);
+
+	isl_int_init(v);
+	isl_int_add_ui(v, min, 1);
+	step = sample_at(tab, dir, v);
+	if (!step)
+		goto error;
+	isl_seq_submul(step->el + 1, tab->mat->ctx->one, sample->el + 1,
+			step->size - 1);
+
+	for (isl_int_set(v, min); isl_int_le(v, max);
+	     isl_int_add_ui(v, v, 1)) {
+		next = isl_vec_dup(sample);
+		if (callback->add(callback, next) < 0)
+			goto error;
+		isl_seq_addmul(sample->el + 1, tab->mat->ctx->one,
+				step->el + 1, sample->size - 1);
+	}
+
+	isl_int_clear(v);
+	isl_vec_free(sample);
+	isl_vec_free(step);
+	return 0;
+error:
+	isl_int_clear(v);
+	isl_vec_free(sample);
+	isl_vec_free(step);
+	return -1;
+}
+
 static int scan_0D(struct isl_basic_set *bset,
 	struct isl_scan_callback *callback)
 {
@@ -81,10 +157,895 @@ static int scan_0D(struct isl_basic_set *bset,
 	return callback->add(callback, sample);
 }
 
+/* Add the number of integer points in "bset", which is assumed
+ * to be a box (see isl_basic_map_plain_is_box), to the counter "cnt".
+ * The number of points is the product of the extents
+ * in each of the dimensions.
+ * Return 1 if the points were counted, 0 if "bset" is unbounded
+ * such that they could not be counted in this way and -1 on error,
+ * including the case where the maximal count has been reached.
+ */
+static int count_box(__isl_keep isl_basic_set *bset, struct isl_counter *cnt)
+{
+	int k;
+	int res = 1;
+	unsigned dim;
+	isl_int n, extent;
+	struct isl_map_plain_boxes *box;
+
+	box = isl_basic_map_plain_box(bset);
+	if (!box)
+		return -1;
+
+	dim = box->dim;
+	for (k = 0; k < dim; ++k)
+		if (!box->finite[k] || !box->finite[dim + k]) {
+			isl_map_plain_boxes_free(box);
+			return 0;
+		}
+
+	isl_int_init(n);
+	isl_int_init(extent);
+	isl_int_set_si(n, 1);
+	for (k = 0; k < dim; ++k) {
+		isl_int_sub(extent, box->bound->row[1][k], box->bound->row[0][k]);
+		isl_int_add_ui(extent, extent, 1);
+		if (!isl_int_is_pos(extent)) {
+			isl_int_set_si(n, 0);
+			break;
+		}
+		isl_int_mul(n, n, extent);
+	}
+	isl_int_add(cnt->count, cnt->count, n);
+	if (!isl_int_is_zero(cnt->max) && isl_int_ge(cnt->count, cnt->max)) {
+		isl_int_set(cnt->count, cnt->max);
+		res = -1;
+	}
+	isl_int_clear(n);
+	isl_int_clear(extent);
+
+	isl_map_plain_boxes_free(box);
+	return res;
+}
+
+#ifdef HAVE_PTHREAD
+
+/* Data used by count_factors_threads for counting the points
+ * of the "n" factors in "factors", each up to "max".
+ * count[i] is the number of points in factor "i".
+ * "empty" is set as soon as some factor turns out to be empty,
+ * after which the remaining factors are not counted.
+ */
+struct isl_count_factors {
+	isl_basic_set_list *factors;
+	isl_int max;
+	isl_int *count;
+	int empty;
+};
+
+/* Count the points of factor "i" in the isl_ctx of "worker",
+ * unless some factor has already turned out to be empty.
+ */
+static int count_factor(struct isl_thread_worker *worker, int i, void *user)
+{
+	struct isl_count_factors *data = user;
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	isl_basic_set *factor = NULL;
+	isl_int count;
+	int r, skip;
+
+	isl_thread_worker_lock(worker);
+	skip = data->empty;
+	if (!skip) {
+		isl_basic_set *bset;
+
+		bset = isl_basic_set_list_get_basic_set(data->factors, i);
+		factor = isl_basic_set_import(ctx, bset);
+		isl_basic_set_free(bset);
+	}
+	isl_thread_worker_unlock(worker);
+	if (skip)
+		return 0;
+
+	isl_int_init(count);
+	r = isl_basic_set_count_upto(factor, data->max, &count);
+	isl_basic_set_free(factor);
+	if (r >= 0) {
+		isl_thread_worker_lock(worker);
+		isl_int_set(data->count[i], count);
+		if (isl_int_is_zero(count))
+			data->empty = 1;
+		isl_thread_worker_unlock(worker);
+	}
+	isl_int_clear(count);
+
+	return r < 0 ? -1 : 0;
+}
+
+/* Set "prod" to the product of the numbers of points
+ * in the "n" factors of "factors", each counted up to "max",
+ * using several threads.
+ *
+ * Each factor is counted in a separate isl_ctx (see isl_thread_run).
+ * The counts of factors that are skipped because some other factor
+ * is empty remain zero, which does not affect the (zero) product.
+ */
+static int count_factors_threads(__isl_keep isl_basic_set_list *factors,
+	int n, isl_int max, isl_int *prod)
+{
+	int i, r;
+	isl_ctx *ctx = isl_basic_set_list_get_ctx(factors);
+	struct isl_count_factors data = { factors };
+
+	data.count = isl_alloc_array(ctx, isl_int, n);
+	if (!data.count)
+		return -1;
+	for (i = 0; i < n; ++i)
+		isl_int_init(data.count[i]);
+	isl_int_init(data.max);
+	isl_int_set(data.max, max);
+
+	r = isl_thread_run(ctx, n, &count_factor, &data);
+
+	isl_int_set_si(*prod, 1);
+	for (i = 0; i < n; ++i) {
+		isl_int_mul(*prod, *prod, data.count[i]);
+		isl_int_clear(data.count[i]);
+	}
+	isl_int_clear(data.max);
+	free(data.count);
+
+	return r;
+}
+#endif
+
+/* Add the number of integer points in "bset", which is assumed
+ * to be bounded, to the counter "cnt", if "bset" can be factored.
+ * The number of points is then the product of the numbers of points
+ * in the factors, which are counted separately.
+ * Each factor is counted up to the maximal count of "cnt", if any,
+ * since reaching this count in any factor means that the product
+ * reaches it too, unless some other factor turns out to be empty.
+ * If the threads option is greater than one and isl has been
+ * built with thread support, then the factors are counted
+ * in parallel by count_factors_threads, provided at least two
+ * of them involve more than one variable.
+ * Return 1 if the points were counted, 0 if "bset" cannot be factored
+ * and -1 on error, including the case where the maximal count
+ * has been reached.
+ */
+static int count_factors(__isl_keep isl_basic_set *bset,
+	struct isl_counter *cnt)
+{
+	int i, n, n_nontrivial;
+	int res = 1;
+	isl_factorizer *f;
+	isl_basic_set_list *factors;
+	isl_int prod, count;
+
+	if (isl_basic_set_dim(bset, isl_dim_param) != 0 ||
+	    isl_basic_set_dim(bset, isl_dim_div) != 0)
+		return 0;
+
+	f = isl_basic_set_factorizer(bset);
+	if (!f)
+		return -1;
+	if (f->n_group == 0) {
+		isl_factorizer_free(f);
+		return 0;
+	}
+	n_nontrivial = isl_factorizer_n_nontrivial_group(f);
+	factors = isl_factorizer_factors(f, isl_basic_set_copy(bset));
+	isl_factorizer_free(f);
+	if (!factors)
+		return -1;
+
+	isl_int_init(prod);
+	isl_int_init(count);
+	isl_int_set_si(prod, 1);
+	n = isl_basic_set_list_n_basic_set(factors);
+#ifdef HAVE_PTHREAD
+	if (bset->ctx->opt->threads > 1 && n_nontrivial >= 2) {
+		if (count_factors_threads(factors, n, cnt->max, &prod) < 0)
+			res = -1;
+	} else
+#endif
+	for (i = 0; i < n; ++i) {
+		isl_basic_set *factor;
+		int r;
+
+		factor = isl_basic_set_list_get_basic_set(factors, i);
+		r = isl_basic_set_count_upto(factor, cnt->max, &count);
+		isl_basic_set_free(factor);
+		if (r < 0) {
+			res = -1;
+			break;
+		}
+		isl_int_mul(prod, prod, count);
+		if (isl_int_is_zero(prod))
+			break;
+	}
+	if (res > 0) {
+		isl_int_add(cnt->count, cnt->count, prod);
+		if (!isl_int_is_zero(cnt->max) &&
+		    isl_int_ge(cnt->count, cnt->max)) {
+			isl_int_set(cnt->count, cnt->max);
+			res = -1;
+		}
+	}
+	isl_int_clear(prod);
+	isl_int_clear(count);
+
+	isl_basic_set_list_free(factors);
+	return res;
+}
+
+/* Limits on the input of scan_fm that ensure that all intermediate
+ * results of the enumeration fit in 64 bits.
+ * The constant terms and the coefficients of the constraints and
+ * the coordinates of the points are bounded by ISL_SCAN_FM_MAX_CST,
+ * ISL_SCAN_FM_MAX_COEF and ISL_SCAN_FM_MAX_VAL, respectively,
+ * and there are at most ISL_SCAN_FM_MAX_DIM variables,
+ * such that the value of any constraint is smaller than 2^42
+ * in absolute value.
+ * ISL_SCAN_FM_MAX_ROW limits the number of constraints produced
+ * by Fourier-Motzkin elimination.
+ * If the bounding box of the set contains at most ISL_SCAN_FM_SMALL_BOX
+ * integer points, then no elimination is performed at all.
+ */
+#define ISL_SCAN_FM_MAX_DIM	32
+#define ISL_SCAN_FM_MAX_ROW	1024
+#define ISL_SCAN_FM_SMALL_BOX	1024
+#define ISL_SCAN_FM_MAX_CST	((int64_t) 1 << 40)
+#define ISL_SCAN_FM_MAX_COEF	((int64_t) 1 << 15)
+#define ISL_SCAN_FM_MAX_VAL	((int64_t) 1 << 20)
+
+/* Data used by scan_fm.
+ *
+ * "dim" is the number of variables.
+ * The constraints are stored by level, where the constraints
+ * at level k bound variable k in terms of the earlier variables.
+ * The constraints at level k are those in positions start[k]
+ * up to start[k + 1].
+ * Constraint r is of the form
+ *
+ *	cst[r] + sum_j coef[j * size + r] x_j >= 0
+ *
+ * with "size" the allocated number of constraints.
+ * "partial" holds the values of the constraints at levels beyond
+ * the current level, evaluated at the current values "x"
+ * of the earlier variables.
+ * "max" holds the upper bound of the current range of each variable.
+ * "box_lo" and "box_hi" hold bounds on each variable over the entire set.
+ */
+struct isl_scan_fm {
+	int dim;
+	int n_row;
+	int size;
+	int *start;
+	int64_t *cst;
+	int64_t *coef;
+	int64_t *partial;
+	int64_t *x;
+	int64_t *max;
+	int64_t *box_lo;
+	int64_t *box_hi;
+};
+
+static void isl_scan_fm_clear(struct isl_scan_fm *fm)
+{
+	free(fm->start);
+	free(fm->cst);
+	free(fm->coef);
+	free(fm->partial);
+	free(fm->x);
+	free(fm->max);
+	free(fm->box_lo);
+	free(fm->box_hi);
+}
+
+/* Is "v" at most "max" in absolute value?
+ */
+static int fits(isl_int v, int64_t max)
+{
+	if (isl_int_is_neg(v))
+		return isl_int_cmp_si(v, -max) >= 0;
+	return isl_int_cmp_si(v, max) <= 0;
+}
+
+/* Append the constraint sign * c >= 0, which bounds variable "level"
+ * in terms of the earlier variables, to "fm".
+ * Return 1 if the constraint was added, 0 if its coefficients
+ * are too large and -1 on error.
+ */
+static int fm_add_row(isl_ctx *ctx, struct isl_scan_fm *fm, isl_int *c,
+	int sign)
+{
+	int j, r;
+
+	if (!fits(c[0], ISL_SCAN_FM_MAX_CST))
+		return 0;
+	for (j = 0; j < fm->dim; ++j)
+		if (!fits(c[1 + j], ISL_SCAN_FM_MAX_COEF))
+			return 0;
+	if (fm->n_row >= ISL_SCAN_FM_MAX_ROW)
+		return 0;
+
+	if (fm->n_row >= fm->size) {
+		int64_t *coef;
+		int size = 2 * fm->size + 8;
+
+		if (size > ISL_SCAN_FM_MAX_ROW)
+			size = ISL_SCAN_FM_MAX_ROW;
+		fm->cst = isl_realloc_array(ctx, fm->cst, int64_t, size);
+		coef = isl_alloc_array(ctx, int64_t, size * fm->dim);
+		if (!fm->cst || !coef) {
+			free(coef);
+			return -1;
+		}
+		for (j = 0; j < fm->dim; ++j)
+			memcpy(coef + j * size, fm->coef + j * fm->size,
+				fm->n_row * sizeof(int64_t));
+		free(fm->coef);
+		fm->coef = coef;
+		fm->size = size;
+	}
+
+	r = fm->n_row++;
+	fm->cst[r] = sign * isl_int_get_si(c[0]);
+	for (j = 0; j < fm->dim; ++j)
+		fm->coef[j * fm->size + r] = sign * isl_int_get_si(c[1 + j]);
+
+	return 1;
+}
+
+/* Add the constraints of "bset" that involve variable "level",
+ * which is the last variable that is involved in any of the constraints,
+ * to "fm".
+ * An equality is added as a pair of inequalities.
+ * Return 1 if all constraints were added, 0 if some of them have
+ * coefficients that are too large and -1 on error.
+ */
+static int fm_add_level(isl_ctx *ctx, struct isl_scan_fm *fm,
+	__isl_keep isl_basic_set *bset, int level)
+{
+	int i, r;
+
+	fm->start[level] = fm->n_row;
+	for (i = 0; i < bset->n_eq; ++i) {
+		if (isl_int_is_zero(bset->eq[i][1 + level]))
+			continue;
+		r = fm_add_row(ctx, fm, bset->eq[i], 1);
+		if (r > 0)
+			r = fm_add_row(ctx, fm, bset->eq[i], -1);
+		if (r <= 0)
+			return r;
+	}
+	for (i = 0; i < bset->n_ineq; ++i) {
+		if (isl_int_is_zero(bset->ineq[i][1 + level]))
+			continue;
+		r = fm_add_row(ctx, fm, bset->ineq[i], 1);
+		if (r <= 0)
+			return r;
+	}
+
+	return 1;
+}
+
+/* Compute bounds on each of the variables of "bset" over the entire set
+ * and store them in fm->box_lo and fm->box_hi.
+ * Return 1 if the bounds were computed, 0 if "bset" is unbounded
+ * or if the bounds are too large and -1 on error.
+ * If "bset" turns out to be empty, then *empty is set.
+ */
+static int fm_compute_box(struct isl_scan_fm *fm,
+	__isl_keep isl_basic_set *bset, int *empty)
+{
+	int j;
+	struct isl_tab *tab;
+	isl_vec *obj;
+	isl_int v;
+	enum isl_lp_result res = isl_lp_ok;
+
+	tab = isl_tab_from_basic_set(bset, 0);
+	obj = isl_vec_alloc(bset->ctx, 1 + fm->dim);
+	if (!tab || !obj)
+		res = isl_lp_error;
+	else if (tab->empty)
+		res = isl_lp_empty;
+
+	isl_int_init(v);
+	if (obj)
+		isl_seq_clr(obj->el, obj->size);
+	for (j = 0; res == isl_lp_ok && j < fm->dim; ++j) {
+		isl_int_set_si(obj->el[1 + j], 1);
+		res = isl_tab_min(tab, obj->el, bset->ctx->one, &v, NULL, 0);
+		if (res == isl_lp_ok && !fits(v, ISL_SCAN_FM_MAX_VAL))
+			res = isl_lp_unbounded;
+		if (res == isl_lp_ok) {
+			fm->box_lo[j] = isl_int_get_si(v);
+			isl_int_set_si(obj->el[1 + j], -1);
+			res = isl_tab_min(tab, obj->el, bset->ctx->one,
+					&v, NULL, 0);
+			isl_int_neg(v, v);
+		}
+		if (res == isl_lp_ok && !fits(v, ISL_SCAN_FM_MAX_VAL))
+			res = isl_lp_unbounded;
+		if (res == isl_lp_ok)
+			fm->box_hi[j] = isl_int_get_si(v);
+		isl_int_set_si(obj->el[1 + j], 0);
+	}
+	isl_int_clear(v);
+
+	isl_vec_free(obj);
+	isl_tab_free(tab);
+
+	if (res == isl_lp_error)
+		return -1;
+	if (res == isl_lp_empty)
+		*empty = 1;
+	return res != isl_lp_unbounded;
+}
+
+/* Compute the constraints at each level of "fm" from "bset".
+ * The constraints at level k are those of the result
+ * of eliminating all later variables from "bset"
+ * using Fourier-Motzkin elimination that involve variable k.
+ * Return 1 if the constraints were computed, 0 if
+ * they are too large or too many and -1 on error.
+ */
+static int fm_compute_levels(struct isl_scan_fm *fm,
+	__isl_keep isl_basic_set *bset)
+{
+	int k, r = 1;
+	isl_basic_set **elim;
+
+	elim = isl_calloc_array(bset->ctx, isl_basic_set *, fm->dim);
+	if (!elim)
+		return -1;
+	elim[fm->dim - 1] = isl_basic_set_copy(bset);
+	for (k = fm->dim - 2; k >= 0; --k) {
+		elim[k] = isl_basic_set_copy(elim[k + 1]);
+		elim[k] = isl_basic_set_eliminate_vars(elim[k], k + 1, 1);
+		if (!elim[k]) {
+			r = -1;
+			break;
+		}
+		if (elim[k]->n_ineq + 2 * elim[k]->n_eq > ISL_SCAN_FM_MAX_ROW) {
+			r = 0;
+			break;
+		}
+	}
+	for (k = 0; r > 0 && k < fm->dim; ++k)
+		r = fm_add_level(bset->ctx, fm, elim[k], k);
+	fm->start[fm->dim] = fm->n_row;
+
+	for (k = 0; k < fm->dim; ++k)
+		isl_basic_set_free(elim[k]);
+	free(elim);
+	return r;
+}
+
+/* Does the bounding box of "fm" contain at most ISL_SCAN_FM_SMALL_BOX
+ * integer points?
+ */
+static int fm_box_is_small(struct isl_scan_fm *fm)
+{
+	int j;
+	int64_t n = 1;
+
+	for (j = 0; j < fm->dim; ++j) {
+		n *= fm->box_hi[j] - fm->box_lo[j] + 1;
+		if (n > ISL_SCAN_FM_SMALL_BOX)
+			return 0;
+	}
+	return 1;
+}
+
+/* Add the constraints of "bset" to "fm", each at the level
+ * of the last variable it involves, without performing any elimination.
+ * Constraints that do not involve any variables are not added,
+ * but *empty is set if any of them is violated.
+ * Return 1 if the constraints were added, 0 if
+ * they are too large and -1 on error.
+ *
+ * The ranges computed during the enumeration then only take
+ * into account the constraints of "bset" that do not involve
+ * any later variables.  This means that many of these ranges
+ * may turn out to be empty at a later level, but the number of
+ * partial points that are considered is bounded by the number
+ * of integer points in the bounding box.
+ */
+static int fm_direct_levels(struct isl_scan_fm *fm,
+	__isl_keep isl_basic_set *bset, int *empty)
+{
+	int i, k, r;
+
+	for (i = 0; i < bset->n_eq; ++i)
+		if (isl_seq_first_non_zero(bset->eq[i] + 1, fm->dim) == -1 &&
+		    !isl_int_is_zero(bset->eq[i][0]))
+			*empty = 1;
+	for (i = 0; i < bset->n_ineq; ++i)
+		if (isl_seq_first_non_zero(bset->ineq[i] + 1, fm->dim) == -1 &&
+		    isl_int_is_neg(bset->ineq[i][0]))
+			*empty = 1;
+
+	fm->n_row = 0;
+	for (k = 0; k < fm->dim; ++k) {
+		fm->start[k] = fm->n_row;
+		for (i = 0; i < bset->n_eq; ++i) {
+			if (isl_seq_last_non_zero(bset->eq[i] + 1,
+						    fm->dim) != k)
+				continue;
+			r = fm_add_row(bset->ctx, fm, bset->eq[i], 1);
+			if (r > 0)
+				r = fm_add_row(bset->ctx, fm, bset->eq[i], -1);
+			if (r <= 0)
+				return r;
+		}
+		for (i = 0; i < bset->n_ineq; ++i) {
+			if (isl_seq_last_non_zero(bset->ineq[i] + 1,
+						    fm->dim) != k)
+				continue;
+			r = fm_add_row(bset->ctx, fm, bset->ineq[i], 1);
+			if (r <= 0)
+				return r;
+		}
+	}
+	fm->start[fm->dim] = fm->n_row;
+
+	return 1;
+}
+
+/* Return floor(a / b), with b > 0.
+ */
+static int64_t fdiv_int64(int64_t a, int64_t b)
+{
+	int64_t q = a / b;
+
+	if (a % b != 0 && a < 0)
+		--q;
+	return q;
+}
+
+/* Compute bounds on each of the variables of "fm" and
+ * store them in fm->box_lo and fm->box_hi, by propagating
+ * bounds through the constraints of "fm", without solving any LPs.
+ * That is, a constraint
+ *
+ *	c + sum_j a_j x_j >= 0
+ *
+ * with a_k > 0 implies the lower bound
+ *
+ *	x_k >= ceil((-c - sum_{j != k} max(a_j x_j))/a_k)
+ *
+ * where max(a_j x_j) is computed from the current bounds on x_j.
+ * Upper bounds are derived in the same way.
+ * Bounds that are larger than ISL_SCAN_FM_MAX_VAL in absolute value
+ * are ignored.  The propagation is repeated until no more bounds change,
+ * at most fm->dim + 1 times.
+ * Return 1 if all variables are bounded, 0 if some of them are not.
+ * If some range is found to be empty, then *empty is set.
+ * Since all constraint values are smaller than 2^42 in absolute value,
+ * no overflow can occur.
+ */
+static int fm_propagate_box(struct isl_scan_fm *fm, int *empty)
+{
+	int i, j, k, r, changed;
+	int64_t inf = ISL_SCAN_FM_MAX_VAL + 1;
+
+	for (j = 0; j < fm->dim; ++j) {
+		fm->box_lo[j] = -inf;
+		fm->box_hi[j] = inf;
+	}
+	changed = 1;
+	for (i = 0; changed && i <= fm->dim; ++i) {
+		changed = 0;
+		for (r = 0; r < fm->n_row; ++r) {
+			int n_inf = 0, inf_pos = -1;
+			int64_t s = fm->cst[r];
+
+			for (j = 0; j < fm->dim; ++j) {
+				int64_t a = fm->coef[j * fm->size + r];
+				int64_t b;
+
+				if (a == 0)
+					continue;
+				b = a > 0 ? fm->box_hi[j] : fm->box_lo[j];
+				if (b == inf || b == -inf) {
+					n_inf++;
+					inf_pos = j;
+					continue;
+				}
+				s += a * b;
+			}
+			for (k = 0; k < fm->dim && n_inf <= 1; ++k) {
+				int64_t a = fm->coef[k * fm->size + r];
+				int64_t b, rest;
+
+				if (a == 0)
+					continue;
+				if (n_inf == 1 && k != inf_pos)
+					continue;
+				b = a > 0 ? fm->box_hi[k] : fm->box_lo[k];
+				rest = s;
+				if (n_inf == 0)
+					rest -= a * b;
+				if (a > 0) {
+					b = -fdiv_int64(rest, a);
+					if (b > fm->box_lo[k] &&
+					    b <= ISL_SCAN_FM_MAX_VAL) {
+						fm->box_lo[k] = b;
+						changed = 1;
+					}
+				} else {
+					b = fdiv_int64(rest, -a);
+					if (b < fm->box_hi[k] &&
+					    b >= -ISL_SCAN_FM_MAX_VAL) {
+						fm->box_hi[k] = b;
+						changed = 1;
+					}
+				}
+				if (fm->box_lo[k] > fm->box_hi[k]) {
+					*empty = 1;
+					return 1;
+				}
+			}
+		}
+	}
+
+	for (j = 0; j < fm->dim; ++j)
+		if (fm->box_lo[j] == -inf || fm->box_hi[j] == inf)
+			return 0;
+	return 1;
+}
+
+/* Compute the range [*lo, *hi] of variable "level" of "fm",
+ * given the current values of the earlier variables.
+ */
+static void fm_range(struct isl_scan_fm *fm, int level,
+	int64_t *lo, int64_t *hi)
+{
+	int r;
+	int64_t *col = fm->coef + level * fm->size;
+
+	*lo = fm->box_lo[level];
+	*hi = fm->box_hi[level];
+	for (r = fm->start[level]; r < fm->start[level + 1]; ++r) {
+		int64_t b;
+
+		if (col[r] > 0) {
+			b = -fdiv_int64(fm->partial[r], col[r]);
+			if (b > *lo)
+				*lo = b;
+		} else {
+			b = fdiv_int64(fm->partial[r], -col[r]);
+			if (b < *hi)
+				*hi = b;
+		}
+	}
+}
+
+/* Add "m" times the coefficients of variable "level" to the values
+ * of the constraints at later levels.
+ * The loop is a plain vector update that compilers
+ * can easily vectorize.
+ */
+static void fm_update(struct isl_scan_fm *fm, int level, int64_t m)
+{
+	int r;
+	int64_t *col = fm->coef + level * fm->size;
+	int64_t *partial = fm->partial;
+
+	for (r = fm->start[level + 1]; r < fm->n_row; ++r)
+		partial[r] += m * col[r];
+}
+
+/* Call callback->add on the points of "fm" with the current values
+ * of all but the last variable and the last variable in [lo, hi],
+ * or count them if "callback" is a counter.
+ */
+static int fm_add_line(isl_ctx *ctx, struct isl_scan_fm *fm,
+	int64_t lo, int64_t hi, struct isl_scan_callback *callback)
+{
+	int j, r = 0;
+	int64_t v;
+
+	if (callback->add == increment_counter) {
+		isl_int min, max;
+
+		isl_int_init(min);
+		isl_int_init(max);
+		isl_int_set_si(min, lo);
+		isl_int_set_si(max, hi);
+		r = increment_range(callback, min, max);
+		isl_int_clear(min);
+		isl_int_clear(max);
+		return r ? -1 : 0;
+	}
+
+	for (v = lo; v <= hi; ++v) {
+		isl_vec *sample;
+
+		sample = isl_vec_alloc(ctx, 1 + fm->dim);
+		if (!sample)
+			return -1;
+		isl_int_set_si(sample->el[0], 1);
+		for (j = 0; j + 1 < fm->dim; ++j)
+			isl_int_set_si(sample->el[1 + j], fm->x[j]);
+		isl_int_set_si(sample->el[fm->dim], v);
+		if (callback->add(callback, sample) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/* Enumerate the points of "fm" in lexicographic order.
+ *
+ * The search is performed in the same way as in isl_basic_set_scan,
+ * except that the range of a variable is computed directly from
+ * the values of the constraints at its level.
+ * These values are updated incrementally whenever the value
+ * of an earlier variable changes.
+ */
+static int fm_enumerate(isl_ctx *ctx, struct isl_scan_fm *fm,
+	struct isl_scan_callback *callback)
+{
+	int level, init;
+	int64_t lo, hi;
+
+	memcpy(fm->partial, fm->cst, fm->n_row * sizeof(int64_t));
+	level = 0;
+	init = 1;
+	while (level >= 0) {
+		if (init) {
+			fm_range(fm, level, &lo, &hi);
+			if (level == fm->dim - 1) {
+				if (lo <= hi &&
+				    fm_add_line(ctx, fm, lo, hi, callback) < 0)
+					return -1;
+				level--;
+				init = 0;
+				continue;
+			}
+			if (lo > hi) {
+				level--;
+				init = 0;
+				continue;
+			}
+			fm->x[level] = lo;
+			fm->max[level] = hi;
+			fm_update(fm, level, lo);
+		} else {
+			fm->x[level]++;
+			if (fm->x[level] > fm->max[level]) {
+				fm_update(fm, level, -(fm->x[level] - 1));
+				level--;
+				continue;
+			}
+			fm_update(fm, level, 1);
+		}
+		level++;
+		init = 1;
+	}
+
+	return 0;
+}
+
+/* Look for all integer points in "bset", which is assumed to be bounded,
+ * and call callback->add on each of them, without using a tableau
+ * during the enumeration.
+ *
+ * This is only performed if all existentially quantified variables
+ * of "bset" have an explicit representation, if it does not have
+ * too many variables and if the constraints and the coordinates
+ * of its points are small enough to perform all computations
+ * in 64 bit integers.
+ * The existentially quantified variables are treated as extra variables,
+ * as in isl_basic_set_scan, after adding the constraints
+ * that define them.  Since their values are uniquely determined
+ * by the other variables, this does not affect the number of points.
+ * Bounds on the variables are first derived by propagating
+ * bounds through the constraints (see fm_propagate_box).
+ * If these bounds define a box that contains only a few integer points,
+ * then the points are enumerated directly (see fm_direct_levels)
+ * without solving any LP.  This means that counting the points
+ * of tiny sets, e.g., checking whether a set is a singleton,
+ * does not require the construction of a tableau.
+ * Otherwise, if "small_only" is set, then nothing is done.
+ * If not, bounds on each variable are computed by solving LPs.
+ * If the resulting box is small, then the points are again
+ * enumerated directly.  Otherwise, the constraints
+ * bounding each variable in terms of the earlier variables
+ * are obtained through Fourier-Motzkin elimination.
+ * Since this elimination computes the rational projection,
+ * each range that is computed during the enumeration may be empty,
+ * but each point with values within all ranges satisfies the constraints
+ * of "bset".
+ *
+ * Return 1 if the points have been enumerated, 0 if "bset" does not
+ * satisfy the requirements and -1 on error, including the case
+ * where callback->add returns an error.
+ */
+static int scan_fm(__isl_keep isl_basic_set *bset,
+	struct isl_scan_callback *callback, int small_only)
+{
+	isl_ctx *ctx;
+	struct isl_scan_fm fm = { 0 };
+	int r, empty = 0;
+
+	if (isl_basic_set_total_dim(bset) > ISL_SCAN_FM_MAX_DIM)
+		return 0;
+	bset = isl_basic_set_copy(bset);
+	if (isl_basic_set_dim(bset, isl_dim_div) != 0) {
+		if (!isl_basic_map_divs_known(bset)) {
+			isl_basic_set_free(bset);
+			return 0;
+		}
+		bset = isl_basic_map_add_known_div_constraints(bset);
+		bset = isl_basic_set_underlying_set(bset);
+	}
+	if (!bset)
+		return -1;
+	fm.dim = isl_basic_set_total_dim(bset);
+
+	ctx = isl_basic_set_get_ctx(bset);
+	fm.start = isl_alloc_array(ctx, int, fm.dim + 1);
+	fm.x = isl_alloc_array(ctx, int64_t, fm.dim);
+	fm.max = isl_alloc_array(ctx, int64_t, fm.dim);
+	fm.box_lo = isl_alloc_array(ctx, int64_t, fm.dim);
+	fm.box_hi = isl_alloc_array(ctx, int64_t, fm.dim);
+	if (!fm.start || !fm.x || !fm.max || !fm.box_lo || !fm.box_hi)
+		goto error;
+
+	r = fm_direct_levels(&fm, bset, &empty);
+	if (r > 0 && !empty)
+		r = fm_propagate_box(&fm, &empty);
+	if (r > 0 && !empty && !fm_box_is_small(&fm))
+		r = 0;
+	if (r == 0 && small_only) {
+		isl_scan_fm_clear(&fm);
+		isl_basic_set_free(bset);
+		return 0;
+	}
+	if (r == 0) {
+		fm.n_row = 0;
+		r = fm_compute_box(&fm, bset, &empty);
+		if (r > 0 && !empty && fm_box_is_small(&fm))
+			r = fm_direct_levels(&fm, bset, &empty);
+		else if (r > 0 && !empty)
+			r = fm_compute_levels(&fm, bset);
+	}
+	if (r > 0 && !empty) {
+		fm.partial = isl_alloc_array(ctx, int64_t, fm.n_row);
+		if (fm.n_row && !fm.partial)
+			goto error;
+		if (fm_enumerate(ctx, &fm, callback) < 0)
+			goto error;
+	}
+
+	isl_scan_fm_clear(&fm);
+	isl_basic_set_free(bset);
+	return r;
+error:
+	isl_scan_fm_clear(&fm);
+	isl_basic_set_free(bset);
+	return -1;
+}
+
 /* Look for all integer points in "bset", which is assumed to be bounded,
  * and call callback->add on each of them.
  *
- * We first compute a reduced basis for the set and then scan
+ * If we are only counting the points and "bset" is a box,
+ * then the points are counted directly, without constructing a tableau.
+ * Similarly, if "bset" can be factored, then the points
+ * of each factor are counted separately, unless "bset"
+ * is so small that scan_fm can enumerate its points without solving any LP.
+ * If "bset" is small enough, then the points are enumerated
+ * using 64 bit arithmetic by scan_fm.
+ *
+ * Otherwise, we first compute a reduced basis for the set and then scan
  * the set in the directions of this basis.
  * We basically perform a depth first search, where in each level i
  * we compute the range in the i-th basis vector direction, given
@@ -98,6 +1059,9 @@ static int scan_0D(struct isl_basic_set *bset,
  * level and false if we want the next value.
  * Solutions are added in the leaves of the search tree, i.e., after
  * we have fixed a value in each direction of the basis.
+ * At the innermost level, the points are either counted directly
+ * (see increment_range) or enumerated without further changes
+ * to the tableau (see scan_line).
  */
 int isl_basic_set_scan(struct isl_basic_set *bset,
 	struct isl_scan_callback *callback)
@@ -110,6 +1074,7 @@ int isl_basic_set_scan(struct isl_basic_set *bset,
 	struct isl_tab_undo **snap;
 	int level;
 	int init;
+	int r;
 	enum isl_lp_result res;
 
 	if (!bset)
@@ -119,6 +1084,33 @@ int isl_basic_set_scan(struct isl_basic_set *bset,
 	if (dim == 0)
 		return scan_0D(bset, callback);
 
+	if (callback->add == increment_counter &&
+	    isl_basic_map_plain_is_box(bset) == 1) {
+		r = count_box(bset, (struct isl_counter *) callback);
+		if (r != 0) {
+			isl_basic_set_free(bset);
+			return r < 0 ? -1 : 0;
+		}
+	}
+	if (callback->add == increment_counter && dim > 1) {
+		r = scan_fm(bset, callback, 1);
+		if (r != 0) {
+			isl_basic_set_free(bset);
+			return r < 0 ? -1 : 0;
+		}
+		r = count_factors(bset, (struct isl_counter *) callback);
+		if (r != 0) {
+			isl_basic_set_free(bset);
+			return r < 0 ? -1 : 0;
+		}
+	}
+
+	r = scan_fm(bset, callback, 0);
+	if (r != 0) {
+		isl_basic_set_free(bset);
+		return r < 0 ? -1 : 0;
+	}
+
 	min = isl_vec_alloc(bset->ctx, dim);
 	max = isl_vec_alloc(bset->ctx, dim);
 	snap = isl_alloc_array(bset->ctx, struct isl_tab_undo *, dim);
@@ -176,9 +1168,14 @@ int isl_basic_set_scan(struct isl_basic_set *bset,
 					goto error;
 			continue;
 		}
-		if (level == dim - 1 && callback->add == increment_counter) {
-			if (increment_range(callback,
+		if (level == dim - 1) {
+			if (callback->add == increment_counter) {
+				if (increment_range(callback,
 					    min->el[level], max->el[level]))
+					goto error;
+			} else if (scan_line(tab, B->row[1 + level],
+					min->el[level], max->el[level],
+					callback) < 0)
 				goto error;
 			level--;
 			init = 0;
@@ -220,6 +1217,18 @@ error:
 	return -1;
 }
 
+/* Call callback->add on each of the points of "set".
+ *
+ * Unlike counting (see isl_set_count_upto), the enumeration
+ * is not split over several threads.  The callback (e.g., the function
+ * passed to isl_set_foreach_point or isl_set_foreach_point_batch)
+ * needs to be called in the calling thread and
+ * in the order of the enumeration.
+ * The points found in a chunk of values scanned by a worker would therefore
+ * have to be kept until all earlier chunks have been delivered,
+ * i.e., up to all points of the set, while these interfaces
+ * are meant to hold at most a single point or a single batch at any time.
+ */
 int isl_set_scan(__isl_take isl_set *set, struct isl_scan_callback *callback)
 {
 	int i;
@@ -272,12 +1281,311 @@ error:
 	return -1;
 }
 
+#ifdef HAVE_PTHREAD
+
+/* The maximal number of chunks into which count_threads splits
+ * the range of the first variable of a disjunct.
+ */
+#define ISL_COUNT_MAX_CHUNKS	64
+
+/* The chunks of a disjunct of the set counted by count_threads.
+ * The "width" values of the first variable starting at "min" are split
+ * into "n" chunks of consecutive values.  If "width" is zero,
+ * then the disjunct is counted as a whole in a single chunk.
+ * "first" is the index of the first chunk among the chunks
+ * of all disjuncts.
+ * "factored" is set if the disjunct can be factored, in which case
+ * it does not have any chunks.
+ */
+struct isl_count_disjunct {
+	isl_int min;
+	isl_int width;
+	int n;
+	int first;
+	int factored;
+};
+
+/* Data shared by the workers of count_threads.
+ * "set" lives in the isl_ctx of the caller and
+ * "disjunct" describes the chunks of each of its disjuncts.
+ * "max" is the number of points after which counting can stop,
+ * or zero if all points need to be counted, and
+ * "count" is the number of points counted so far.
+ */
+struct isl_count_threads {
+	isl_set *set;
+	struct isl_count_disjunct *disjunct;
+	isl_int max;
+	isl_int count;
+};
+
+/* Set "v" to the smallest value of the first variable
+ * in chunk "i" of "disjunct".
+ */
+static void chunk_start(struct isl_count_disjunct *disjunct, int i, isl_int *v)
+{
+	isl_int_mul_ui(*v, disjunct->width, i);
+	isl_int_fdiv_q_ui(*v, *v, disjunct->n);
+	isl_int_add(*v, *v, disjunct->min);
+}
+
+/* Restrict "bset" to the values of its first variable in chunk "i"
+ * of "disjunct".
+ */
+static __isl_give isl_basic_set *add_chunk(__isl_take isl_basic_set *bset,
+	struct isl_count_disjunct *disjunct, int i)
+{
+	int k;
+	unsigned total;
+
+	if (isl_int_is_zero(disjunct->width))
+		return bset;
+
+	bset = isl_basic_set_cow(bset);
+	bset = isl_basic_set_extend_constraints(bset, 0, 2);
+	if (!bset)
+		return NULL;
+	total = isl_basic_set_total_dim(bset);
+	k = isl_basic_set_alloc_inequality(bset);
+	if (k < 0)
+		return isl_basic_set_free(bset);
+	isl_seq_clr(bset->ineq[k], 1 + total);
+	isl_int_set_si(bset->ineq[k][1], 1);
+	chunk_start(disjunct, i, &bset->ineq[k][0]);
+	isl_int_neg(bset->ineq[k][0], bset->ineq[k][0]);
+	k = isl_basic_set_alloc_inequality(bset);
+	if (k < 0)
+		return isl_basic_set_free(bset);
+	isl_seq_clr(bset->ineq[k], 1 + total);
+	isl_int_set_si(bset->ineq[k][1], -1);
+	chunk_start(disjunct, i + 1, &bset->ineq[k][0]);
+	isl_int_sub_ui(bset->ineq[k][0], bset->ineq[k][0], 1);
+
+	return isl_basic_set_finalize(bset);
+}
+
+/* Count the points in chunk "i" in the isl_ctx of "worker"
+ * and add them to data->count, unless data->max points
+ * have already been counted.
+ */
+static int count_chunk(struct isl_thread_worker *worker, int i, void *user)
+{
+	struct isl_count_threads *data = user;
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	isl_basic_set *bset = NULL;
+	int d;
+	int done;
+	int r;
+	isl_int count;
+
+	for (d = 0; i >= data->disjunct[d].first + data->disjunct[d].n; ++d)
+		;
+
+	isl_thread_worker_lock(worker);
+	done = !isl_int_is_zero(data->max) &&
+		isl_int_ge(data->count, data->max);
+	if (!done)
+		bset = isl_basic_set_import(ctx, data->set->p[d]);
+	isl_thread_worker_unlock(worker);
+	if (done)
+		return 0;
+
+	bset = add_chunk(bset, &data->disjunct[d],
+			i - data->disjunct[d].first);
+	isl_int_init(count);
+	r = isl_basic_set_count_upto(bset, data->max, &count);
+	isl_basic_set_free(bset);
+	if (r >= 0) {
+		isl_thread_worker_lock(worker);
+		isl_int_add(data->count, data->count, count);
+		isl_thread_worker_unlock(worker);
+	}
+	isl_int_clear(count);
+
+	return r;
+}
+
+/* Determine the range of the first variable of "bset" and
+ * split it into chunks, the first of which has index "first".
+ * The disjunct is not split if it has no variables or
+ * if the range is unbounded (in which case the count will fail
+ * in the same way as without threads), and it has no chunks at all
+ * if it is empty.
+ * If "bset" can be factored into at least two factors that involve
+ * more than one variable, then it does not have any chunks either,
+ * since each chunk would count all points of the factors that
+ * do not involve the first variable.  Instead, the factors
+ * are counted in parallel (see count_factors).
+ */
+static int init_disjunct(__isl_keep isl_basic_set *bset,
+	struct isl_count_disjunct *disjunct, int first)
+{
+	isl_ctx *ctx = isl_basic_set_get_ctx(bset);
+	struct isl_tab *tab;
+	isl_vec *obj;
+	isl_int max;
+	enum isl_lp_result res = isl_lp_ok;
+	unsigned total = isl_basic_set_total_dim(bset);
+
+	disjunct->first = first;
+	disjunct->n = 1;
+	isl_int_set_si(disjunct->width, 0);
+	if (total == 0)
+		return 0;
+	if (isl_basic_set_dim(bset, isl_dim_param) == 0 &&
+	    isl_basic_set_dim(bset, isl_dim_div) == 0) {
+		isl_factorizer *f;
+
+		f = isl_basic_set_factorizer(bset);
+		if (!f)
+			return -1;
+		disjunct->factored = isl_factorizer_n_nontrivial_group(f) >= 2;
+		isl_factorizer_free(f);
+		if (disjunct->factored) {
+			disjunct->n = 0;
+			return 0;
+		}
+	}
+
+	tab = isl_tab_from_basic_set(bset, 0);
+	obj = isl_vec_alloc(ctx, 1 + total);
+	if (!tab || !obj)
+		goto error;
+	isl_seq_clr(obj->el, 1 + total);
+	isl_int_set_si(obj->el[1], 1);
+	isl_int_init(max);
+	res = isl_tab_min(tab, obj->el, ctx->one, &disjunct->min, NULL, 0);
+	if (res == isl_lp_ok) {
+		isl_int_set_si(obj->el[1], -1);
+		res = isl_tab_min(tab, obj->el, ctx->one, &max, NULL, 0);
+		isl_int_neg(max, max);
+	}
+	if (res == isl_lp_ok) {
+		isl_int_sub(disjunct->width, max, disjunct->min);
+		isl_int_add_ui(disjunct->width, disjunct->width, 1);
+		if (isl_int_is_neg(disjunct->width))
+			res = isl_lp_empty;
+		else if (isl_int_cmp_si(disjunct->width,
+					ISL_COUNT_MAX_CHUNKS) > 0)
+			disjunct->n = ISL_COUNT_MAX_CHUNKS;
+		else
+			disjunct->n = isl_int_get_si(disjunct->width);
+	}
+	if (res == isl_lp_empty)
+		disjunct->n = 0;
+	if (res == isl_lp_unbounded)
+		isl_int_set_si(disjunct->width, 0);
+	isl_int_clear(max);
+	isl_vec_free(obj);
+	isl_tab_free(tab);
+
+	return res == isl_lp_error ? -1 : 0;
+error:
+	isl_vec_free(obj);
+	isl_tab_free(tab);
+	return -1;
+}
+
+/* Count the points of "set", stopping at "max" points if "max"
+ * is not zero, and store the result in "count",
+ * using several threads.
+ *
+ * As in isl_set_scan, "set" is first made disjoint.
+ * The range of the first variable of each disjunct is then split
+ * into at most ISL_COUNT_MAX_CHUNKS chunks of consecutive values and
+ * the points in each chunk are counted in a separate isl_ctx
+ * (see isl_thread_run) by a sequential call to isl_basic_set_count_upto.
+ * Chunks are skipped as soon as "max" points have been counted.
+ * The disjuncts that can be factored are counted afterwards
+ * in the calling thread, which counts their factors in parallel
+ * (see count_factors_threads).
+ * Since each chunk is counted up to "max" points,
+ * the sum may exceed "max" and is then reduced to "max".
+ */
+static int count_threads(__isl_keep isl_set *set, isl_int max,
+	isl_int *count)
+{
+	int i, n;
+	int r = -1;
+	struct isl_count_threads data = { NULL };
+
+	set = isl_set_copy(set);
+	set = isl_set_make_disjoint(set);
+	set = isl_set_compute_divs(set);
+	if (!set)
+		return -1;
+
+	data.set = set;
+	data.disjunct = isl_calloc_array(set->ctx, struct isl_count_disjunct,
+					set->n);
+	if (set->n && !data.disjunct)
+		goto error;
+	for (i = 0; i < set->n; ++i) {
+		isl_int_init(data.disjunct[i].min);
+		isl_int_init(data.disjunct[i].width);
+	}
+	isl_int_init(data.max);
+	isl_int_init(data.count);
+	isl_int_set(data.max, max);
+	isl_int_set_si(data.count, 0);
+
+	n = 0;
+	for (i = 0; i < set->n; ++i) {
+		if (init_disjunct(set->p[i], &data.disjunct[i], n) < 0)
+			break;
+		n += data.disjunct[i].n;
+	}
+	if (i >= set->n)
+		r = isl_thread_run(set->ctx, n, &count_chunk, &data);
+	for (i = 0; r >= 0 && i < set->n; ++i) {
+		isl_int count_i;
+
+		if (!data.disjunct[i].factored)
+			continue;
+		if (!isl_int_is_zero(max) && isl_int_ge(data.count, max))
+			break;
+		isl_int_init(count_i);
+		r = isl_basic_set_count_upto(set->p[i], max, &count_i);
+		isl_int_add(data.count, data.count, count_i);
+		isl_int_clear(count_i);
+	}
+	if (r >= 0) {
+		if (!isl_int_is_zero(max) && isl_int_gt(data.count, max))
+			isl_int_set(data.count, max);
+		isl_int_set(*count, data.count);
+	}
+
+	isl_int_clear(data.max);
+	isl_int_clear(data.count);
+	for (i = 0; i < set->n; ++i) {
+		isl_int_clear(data.disjunct[i].min);
+		isl_int_clear(data.disjunct[i].width);
+	}
+error:
+	free(data.disjunct);
+	isl_set_free(set);
+	return r;
+}
+
+#endif
+
+/* Count the points of "set", stopping at "max" points if "max"
+ * is not zero, and store the result in "count".
+ *
+ * If the threads option is greater than one and isl has been
+ * built with thread support, then the counting is split
+ * over several threads by count_threads.
+ */
 int isl_set_count_upto(__isl_keep isl_set *set, isl_int max, isl_int *count)
 {
 	struct isl_counter cnt = { { &increment_counter } };
 
 	if (!set)
 		return -1;
+#ifdef HAVE_PTHREAD
+	if (set->ctx->opt->threads > 1)
+		return count_threads(set, max, count);
+#endif
 
 	isl_int_init(cnt.count);
 	isl_int_init(cnt.max);
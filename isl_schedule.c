@@ -18,6 +18,15 @@
 #include <isl_schedule_private.h>
 #include <isl_band_private.h>
 
+__isl_give isl_schedule *isl_schedule_copy(__isl_keep isl_schedule *sched)
+{
+	if (!sched)
+		return NULL;
+
+	sched->ref++;
+	return sched;
+}
+
 __isl_null isl_schedule *isl_schedule_free(__isl_take isl_schedule *sched)
 {
 	int i;
@@ -35,6 +44,7 @@ __isl_null isl_schedule *isl_schedule_free(__isl_take isl_schedule *sched)
 	}
 	isl_space_free(sched->dim);
 	isl_band_list_free(sched->band_forest);
+	isl_union_map_free(sched->map);
 	free(sched);
 	return NULL;
 }
@@ -47,7 +57,7 @@ isl_ctx *isl_schedule_get_ctx(__isl_keep isl_schedule *schedule)
 /* Set max_out to the maximal number of output dimensions over
  * all maps.
  */
-static int update_max_out(__isl_take isl_map *map, void *user)
+static int update_max_out(__isl_keep isl_map *map, void *user)
 {
 	int *max_out = user;
 	int n_out = isl_map_dim(map, isl_dim_out);
@@ -55,7 +65,6 @@ static int update_max_out(__isl_take isl_map *map, void *user)
 	if (n_out > *max_out)
 		*max_out = n_out;
 
-	isl_map_free(map);
 	return 0;
 }
 
@@ -103,7 +112,8 @@ static __isl_give isl_union_map *pad_schedule_map(
 		return umap;
 
 	data.max_out = 0;
-	if (isl_union_map_foreach_map(umap, &update_max_out, &data.max_out) < 0)
+	if (isl_union_map_foreach_map_peek(umap, &update_max_out,
+					    &data.max_out) < 0)
 		return isl_union_map_free(umap);
 
 	data.res = isl_union_map_empty(isl_union_map_get_space(umap));
@@ -114,7 +124,18 @@ static __isl_give isl_union_map *pad_schedule_map(
 	return data.res;
 }
 
-/* Return an isl_union_map of the schedule.  If we have already constructed
+/* Drop the cached schedule map of "schedule", if any.
+ * This function is called whenever a band in the band forest
+ * of "schedule" is modified.
+ */
+void isl_schedule_invalidate_map(__isl_keep isl_schedule *schedule)
+{
+	if (!schedule)
+		return;
+	schedule->map = isl_union_map_free(schedule->map);
+}
+
+/* Compute an isl_union_map of the schedule.  If we have already constructed
  * a band forest, then this band forest may have been modified so we need
  * to extract the isl_union_map from the forest rather than from
  * the originally computed schedule.  This reconstructed schedule map
@@ -122,14 +143,11 @@ static __isl_give isl_union_map *pad_schedule_map(
  * since the result of isl_band_list_get_suffix_schedule may not have
  * a unified schedule space.
  */
-__isl_give isl_union_map *isl_schedule_get_map(__isl_keep isl_schedule *sched)
+static __isl_give isl_union_map *compute_map(__isl_keep isl_schedule *sched)
 {
 	int i;
 	isl_union_map *umap;
 
-	if (!sched)
-		return NULL;
-
 	if (sched->band_forest) {
 		umap = isl_band_list_get_suffix_schedule(sched->band_forest);
 		return pad_schedule_map(umap);
@@ -146,6 +164,20 @@ __isl_give isl_union_map *isl_schedule_get_map(__isl_keep isl_schedule *sched)
 	return umap;
 }
 
+/* Return an isl_union_map of the schedule.
+ * The map is only computed on the first call (or the first call
+ * after the band forest has been modified) and cached in "sched".
+ */
+__isl_give isl_union_map *isl_schedule_get_map(__isl_keep isl_schedule *sched)
+{
+	if (!sched)
+		return NULL;
+
+	if (!sched->map)
+		sched->map = compute_map(sched);
+	return isl_union_map_copy(sched->map);
+}
+
 static __isl_give isl_band_list *construct_band_list(
 	__isl_keep isl_schedule *schedule, __isl_keep isl_band *parent,
 	int band_nr, int *parent_active, int n_active);
@@ -573,6 +605,10 @@ static __isl_give isl_band_list *construct_forest(
 }
 
 /* Return the roots of a band forest representation of the schedule.
+ * The band forest is only constructed on the first call.
+ * The list itself is duplicated (which only copies references
+ * to the bands) such that each returned band holds a reference
+ * to "schedule".
  */
 __isl_give isl_band_list *isl_schedule_get_band_forest(
 	__isl_keep isl_schedule *schedule)
@@ -602,6 +638,109 @@ int isl_schedule_foreach_band(__isl_keep isl_schedule *sched,
 	return r;
 }
 
+static __isl_give isl_union_map *add_coincident_band_list(
+	__isl_take isl_union_map *coincident, __isl_keep isl_band_list *list,
+	int pos);
+
+/* Add the coincident members of "band", which starts at
+ * scheduling dimension "pos", as well as those of its descendants
+ * to "coincident".
+ * In particular, for each coincident member at position "pos + i",
+ * add a mapping from the domains of the partial schedule of "band"
+ * to "coincident[pos + i]".
+ */
+static __isl_give isl_union_map *add_coincident_band(
+	__isl_take isl_union_map *coincident, __isl_keep isl_band *band,
+	int pos)
+{
+	int i;
+	isl_ctx *ctx;
+	isl_union_set *domain;
+
+	if (!coincident || !band)
+		return isl_union_map_free(coincident);
+
+	ctx = isl_band_get_ctx(band);
+	domain = isl_union_pw_multi_aff_domain(
+				isl_union_pw_multi_aff_copy(band->pma));
+	for (i = 0; i < band->n; ++i) {
+		isl_space *space;
+		isl_set *set;
+		isl_union_map *umap;
+
+		if (!band->coincident[i])
+			continue;
+		space = isl_space_set_alloc(ctx, 0, 1);
+		space = isl_space_set_tuple_name(space, isl_dim_set,
+						"coincident");
+		set = isl_set_universe(space);
+		set = isl_set_fix_si(set, isl_dim_set, 0, pos + i);
+		umap = isl_union_map_from_domain_and_range(
+					isl_union_set_copy(domain),
+					isl_union_set_from_set(set));
+		coincident = isl_union_map_union(coincident, umap);
+	}
+	isl_union_set_free(domain);
+
+	if (band->children)
+		coincident = add_coincident_band_list(coincident,
+						band->children, pos + band->n);
+
+	return coincident;
+}
+
+/* Add the coincident members of the bands in "list" and
+ * their descendants to "coincident", where the bands in "list"
+ * start at scheduling dimension "pos".
+ */
+static __isl_give isl_union_map *add_coincident_band_list(
+	__isl_take isl_union_map *coincident, __isl_keep isl_band_list *list,
+	int pos)
+{
+	int i, n;
+
+	n = isl_band_list_n_band(list);
+	for (i = 0; i < n; ++i) {
+		isl_band *band;
+
+		band = isl_band_list_get_band(list, i);
+		coincident = add_coincident_band(coincident, band, pos);
+		isl_band_free(band);
+	}
+
+	return coincident;
+}
+
+/* Return a description of the coincident scheduling dimensions of "sched"
+ * in the form
+ *
+ *	{ S[i] -> coincident[d] }
+ *
+ * where "S[i]" ranges over the statement instances and "d" over
+ * the positions in the schedule map (as returned by isl_schedule_get_map)
+ * of the scheduling dimensions that are coincident for "S[i]".
+ * The result can be passed to isl_ast_build_set_coincident.
+ *
+ * The band forest is used since it may have been modified
+ * after the schedule was computed.
+ */
+__isl_give isl_union_map *isl_schedule_get_coincident(
+	__isl_keep isl_schedule *sched)
+{
+	isl_band_list *forest;
+	isl_union_map *coincident;
+
+	if (!sched)
+		return NULL;
+
+	forest = isl_schedule_get_band_forest(sched);
+	coincident = isl_union_map_empty(isl_space_copy(sched->dim));
+	coincident = add_coincident_band_list(coincident, forest, 0);
+	isl_band_list_free(forest);
+
+	return coincident;
+}
+
 static __isl_give isl_printer *print_band_list(__isl_take isl_printer *p,
 	__isl_keep isl_band_list *list);
 
@@ -27,6 +27,9 @@ struct isl_schedule_node {
  * dim contains a description of the parameters.
  * band_forest points to a band forest representation of the schedule
  * and may be NULL if the forest hasn't been created yet.
+ * map caches the result of isl_schedule_get_map and may be NULL
+ * if it hasn't been computed yet or if the band forest
+ * has been modified since it was computed.
  */
 struct isl_schedule {
 	int ref;
@@ -37,8 +40,11 @@ struct isl_schedule {
 	isl_space *dim;
 
 	isl_band_list *band_forest;
+	isl_union_map *map;
 
 	struct isl_schedule_node node[1];
 };
 
+void isl_schedule_invalidate_map(__isl_keep isl_schedule *schedule);
+
 #endif
@@ -10,6 +10,8 @@
  * and Ecole Normale Superieure, 45 rue d'Ulm, 75230 Paris, France
  */
 
+#include <string.h>
+#include <isl_config.h>
 #include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl_space_private.h>
@@ -29,6 +31,8 @@
 #include <isl_options_private.h>
 #include <isl_tarjan.h>
 #include <isl_morph.h>
+#include <isl_profile.h>
+#include <isl_thread.h>
 
 /*
  * The scheduling algorithm implemented in this file was inspired by
@@ -46,6 +50,109 @@ enum isl_edge_type {
 	isl_edge_last = isl_edge_proximity
 };
 
+/* The phases of the scheduler for which the processor time and
+ * the number of operations are recorded in the statistics of the isl_ctx.
+ */
+enum isl_sched_phase {
+	isl_sched_phase_none = 0,
+	isl_sched_phase_graph,
+	isl_sched_phase_coef,
+	isl_sched_phase_setup,
+	isl_sched_phase_solve,
+	isl_sched_phase_feautrier
+};
+
+/* The names of the phases of the scheduler in the trace events.
+ */
+static const char *sched_phase_name[] = {
+	[isl_sched_phase_none] = "scheduler",
+	[isl_sched_phase_graph] = "scheduler graph construction",
+	[isl_sched_phase_coef] = "scheduler coefficients",
+	[isl_sched_phase_setup] = "scheduler LP setup",
+	[isl_sched_phase_solve] = "scheduler LP solving",
+	[isl_sched_phase_feautrier] = "scheduler Feautrier step",
+};
+
+/* Attribute the processor time of the calling thread
+ * and the number of operations
+ * since the start of the current timing interval to the phase
+ * of the scheduler that is currently active and start
+ * a new timing interval.
+ * Only the time of the calling thread is counted such that
+ * the time spent in worker threads (on worker contexts) is not
+ * attributed to the phase that is waiting for them.  The worker times
+ * are added to the statistics when the workers are merged.
+ * The number of operations may have been reset in the mean time,
+ * in which case only the operations since the reset are counted.
+ */
+static void sched_phase_charge(isl_ctx *ctx)
+{
+	double now;
+	long us, ops;
+	struct isl_ctx_stats *stats = ctx->stats;
+
+	now = isl_thread_cpu_time();
+	us = (long) ((now - ctx->sched_phase_clock) * 1000000);
+	if (ctx->operations >= ctx->sched_phase_operations)
+		ops = ctx->operations - ctx->sched_phase_operations;
+	else
+		ops = ctx->operations;
+
+	switch (ctx->sched_phase) {
+	case isl_sched_phase_graph:
+		stats->sched_graph_us += us;
+		stats->sched_graph_ops += ops;
+		break;
+	case isl_sched_phase_coef:
+		stats->sched_coef_us += us;
+		stats->sched_coef_ops += ops;
+		break;
+	case isl_sched_phase_setup:
+		stats->sched_setup_us += us;
+		stats->sched_setup_ops += ops;
+		break;
+	case isl_sched_phase_solve:
+		stats->sched_solve_us += us;
+		stats->sched_solve_ops += ops;
+		break;
+	case isl_sched_phase_feautrier:
+		stats->sched_feautrier_us += us;
+		stats->sched_feautrier_ops += ops;
+		break;
+	default:
+		break;
+	}
+
+	ctx->sched_phase_clock = now;
+	ctx->sched_phase_operations = ctx->operations;
+}
+
+/* Start phase "phase" of the scheduler, interrupting the phase
+ * that is currently active, if any, and return the interrupted phase.
+ * The interrupted phase is resumed by a call to sched_phase_leave.
+ */
+static enum isl_sched_phase sched_phase_enter(isl_ctx *ctx,
+	enum isl_sched_phase phase)
+{
+	enum isl_sched_phase prev = ctx->sched_phase;
+
+	sched_phase_charge(ctx);
+	ctx->sched_phase = phase;
+	isl_trace_begin(ctx, sched_phase_name[phase], "");
+
+	return prev;
+}
+
+/* Finish the phase of the scheduler that is currently active and
+ * resume phase "prev".
+ */
+static void sched_phase_leave(isl_ctx *ctx, enum isl_sched_phase prev)
+{
+	sched_phase_charge(ctx);
+	isl_trace_end(ctx, sched_phase_name[ctx->sched_phase]);
+	ctx->sched_phase = prev;
+}
+
 /* The constraints that need to be satisfied by a schedule on "domain".
  *
  * "validity" constraints map domain elements i to domain elements
@@ -622,27 +729,6 @@ static struct isl_sched_edge *graph_find_edge(struct isl_sched_graph *graph,
 	return entry->data;
 }
 
-/* Check whether the dependence graph has an edge of the given type
- * between the given two nodes.
- */
-static int graph_has_edge(struct isl_sched_graph *graph,
-	enum isl_edge_type type,
-	struct isl_sched_node *src, struct isl_sched_node *dst)
-{
-	struct isl_sched_edge *edge;
-	int empty;
-
-	edge = graph_find_edge(graph, type, src, dst);
-	if (!edge)
-		return 0;
-
-	empty = isl_map_plain_is_empty(edge->map);
-	if (empty < 0)
-		return -1;
-
-	return !empty;
-}
-
 /* Look for any edge with the same src, dst and map fields as "model".
  *
  * Return the matching edge if one can be found.
@@ -691,47 +777,6 @@ static void graph_remove_edge(struct isl_sched_graph *graph,
 	}
 }
 
-/* Check whether the dependence graph has any edge
- * between the given two nodes.
- */
-static int graph_has_any_edge(struct isl_sched_graph *graph,
-	struct isl_sched_node *src, struct isl_sched_node *dst)
-{
-	enum isl_edge_type i;
-	int r;
-
-	for (i = isl_edge_first; i <= isl_edge_last; ++i) {
-		r = graph_has_edge(graph, i, src, dst);
-		if (r < 0 || r)
-			return r;
-	}
-
-	return r;
-}
-
-/* Check whether the dependence graph has a validity edge
- * between the given two nodes.
- *
- * Conditional validity edges are essentially validity edges that
- * can be ignored if the corresponding condition edges are iteration private.
- * Here, we are only checking for the presence of validity
- * edges, so we need to consider the conditional validity edges too.
- * In particular, this function is used during the detection
- * of strongly connected components and we cannot ignore
- * conditional validity edges during this detection.
- */
-static int graph_has_validity_edge(struct isl_sched_graph *graph,
-	struct isl_sched_node *src, struct isl_sched_node *dst)
-{
-	int r;
-
-	r = graph_has_edge(graph, isl_edge_validity, src, dst);
-	if (r < 0 || r)
-		return r;
-
-	return graph_has_edge(graph, isl_edge_conditional_validity, src, dst);
-}
-
 static int graph_alloc(isl_ctx *ctx, struct isl_sched_graph *graph,
 	int n_node, int n_edge)
 {
@@ -979,9 +1024,15 @@ error:
 	return -1;
 }
 
+/* Data used by extract_edge.
+ * "orig" contains, for each edge in "graph" that was intersected
+ * with the hull of its source or destination, the relation
+ * from which it was extracted, before this intersection.
+ */
 struct isl_extract_edge_data {
 	enum isl_edge_type type;
 	struct isl_sched_graph *graph;
+	isl_map **orig;
 };
 
 /* Merge edge2 into edge1, freeing the contents of edge2.
@@ -1100,6 +1151,48 @@ static __isl_give isl_map *map_intersect_domains(__isl_take isl_map *tagged,
 	return tagged;
 }
 
+/* Look for an edge from "src" to "dst" of a type that was added before
+ * that was extracted from a relation that is obviously equal to "map",
+ * before intersecting it with the hulls of "src" and "dst".
+ * Set *shared to this edge if it can be found and to NULL otherwise.
+ * Return 0 on success and -1 on error.
+ *
+ * The relations are typically the same in the common case where
+ * the same dependence relations are used for several types
+ * of schedule constraints, in which case they even tend to be
+ * represented by the same object.
+ */
+static int find_shared_edge(struct isl_extract_edge_data *data,
+	struct isl_sched_node *src, struct isl_sched_node *dst,
+	__isl_keep isl_map *map, struct isl_sched_edge **shared)
+{
+	enum isl_edge_type i;
+	struct isl_sched_graph *graph = data->graph;
+
+	*shared = NULL;
+	for (i = isl_edge_first; i < data->type; ++i) {
+		struct isl_sched_edge *edge;
+		isl_map *orig;
+		int is_equal;
+
+		edge = graph_find_edge(graph, i, src, dst);
+		if (!edge)
+			continue;
+		orig = data->orig[edge - graph->edge];
+		if (!orig)
+			continue;
+		is_equal = isl_map_plain_is_equal(orig, map);
+		if (is_equal < 0)
+			return -1;
+		if (is_equal) {
+			*shared = edge;
+			return 0;
+		}
+	}
+
+	return 0;
+}
+
 /* Add a new edge to the graph based on the given map
  * and add it to data->graph->edge_table[data->type].
  * If a dependence relation of a given type happens to be identical
@@ -1122,6 +1215,14 @@ static __isl_give isl_map *map_intersect_domains(__isl_take isl_map *tagged,
  * This ensures that there are no schedule constraints defined
  * outside of these domains, while the scheduler no longer has
  * any control over those outside parts.
+ * If an edge between the same nodes was previously extracted from
+ * an identical relation, then the intersected relation of that edge
+ * is reused instead of performing the intersection again.
+ * Since the resulting relation is then represented by the same object,
+ * the edges are subsequently merged without having to compare
+ * the relations.
+ * For new edges that are intersected, the original relation
+ * is kept in data->orig.
  */
 static int extract_edge(__isl_take isl_map *map, void *user)
 {
@@ -1132,6 +1233,7 @@ static int extract_edge(__isl_take isl_map *map, void *user)
 	isl_space *dim;
 	struct isl_sched_edge *edge;
 	isl_map *tagged = NULL;
+	isl_map *orig = NULL;
 
 	if (data->type == isl_edge_condition ||
 	    data->type == isl_edge_conditional_validity) {
@@ -1158,10 +1260,24 @@ static int extract_edge(__isl_take isl_map *map, void *user)
 
 	if (src->compressed || dst->compressed) {
 		isl_map *hull;
+		struct isl_sched_edge *shared;
+
+		if (find_shared_edge(data, src, dst, map, &shared) < 0) {
+			isl_map_free(map);
+			isl_map_free(tagged);
+			return -1;
+		}
 		hull = extract_hull(src, dst);
 		if (tagged)
 			tagged = map_intersect_domains(tagged, hull);
-		map = isl_map_intersect(map, hull);
+		if (shared) {
+			isl_map_free(hull);
+			isl_map_free(map);
+			map = isl_map_copy(shared->map);
+		} else {
+			orig = isl_map_copy(map);
+			map = isl_map_intersect(map, hull);
+		}
 	}
 
 	graph->edge[graph->n_edge].src = src;
@@ -1194,12 +1310,16 @@ static int extract_edge(__isl_take isl_map *map, void *user)
 
 	edge = graph_find_matching_edge(graph, &graph->edge[graph->n_edge]);
 	if (!edge) {
+		isl_map_free(orig);
 		graph->n_edge++;
 		return -1;
 	}
-	if (edge == &graph->edge[graph->n_edge])
+	if (edge == &graph->edge[graph->n_edge]) {
+		data->orig[graph->n_edge] = orig;
 		return graph_edge_table_add(ctx, graph, data->type,
 				    &graph->edge[graph->n_edge++]);
+	}
+	isl_map_free(orig);
 
 	if (merge_edge(data->type, edge, &graph->edge[graph->n_edge]) < 0)
 		return -1;
@@ -1207,43 +1327,117 @@ static int extract_edge(__isl_take isl_map *map, void *user)
 	return graph_edge_table_add(ctx, graph, data->type, edge);
 }
 
-/* Check whether there is any dependence from node[j] to node[i]
- * or from node[i] to node[j].
+/* Is "edge" non-empty?
+ *
+ * Edges that have become (obviously) empty are removed from
+ * the edge tables by update_edge, but they are kept in graph->edge.
+ * Checking the edges in graph->edge directly is therefore equivalent
+ * to looking them up in the edge tables, without the hash table lookups.
  */
-static int node_follows_weak(int i, int j, void *user)
+static int is_non_empty_edge(struct isl_sched_edge *edge)
 {
-	int f;
-	struct isl_sched_graph *graph = user;
+	int empty;
 
-	f = graph_has_any_edge(graph, &graph->node[j], &graph->node[i]);
-	if (f < 0 || f)
-		return f;
-	return graph_has_any_edge(graph, &graph->node[i], &graph->node[j]);
+	empty = isl_map_plain_is_empty(edge->map);
+	if (empty < 0)
+		return -1;
+	return !empty;
 }
 
-/* Check whether there is a (conditional) validity dependence from node[j]
- * to node[i], forcing node[i] to follow node[j].
+/* Is "edge" a non-empty (conditional) validity edge?
+ *
+ * Conditional validity edges are essentially validity edges that
+ * can be ignored if the corresponding condition edges are iteration private.
+ * Here, we are only checking for the presence of validity
+ * edges, so we need to consider the conditional validity edges too.
+ * In particular, this function is used during the detection
+ * of strongly connected components and we cannot ignore
+ * conditional validity edges during this detection.
  */
-static int node_follows_strong(int i, int j, void *user)
+static int is_strong_edge(struct isl_sched_edge *edge)
 {
-	struct isl_sched_graph *graph = user;
+	if (!edge->validity && !edge->conditional_validity)
+		return 0;
+	return is_non_empty_edge(edge);
+}
+
+#define SORT_FN		sort_nodes
+#define SORT_EL		int
+#define SORT_ARG	void *
+#define SORT_KEY(i, user)	*(i)
 
-	return graph_has_validity_edge(graph, &graph->node[j], &graph->node[i]);
+#include <isl_sort_templ.c>
+
+/* Construct the adjacency lists of the (conditional) validity
+ * dependences in "graph" in the format expected by
+ * isl_tarjan_graph_init_edges.  That is, node i follows
+ * the nodes (*edge)[(*first)[i]] up to (*edge)[(*first)[i + 1] - 1],
+ * which are sorted in increasing order.
+ */
+static int strong_edges(isl_ctx *ctx, struct isl_sched_graph *graph,
+	int **first, int **edge)
+{
+	int i, n = 0;
+	int *pos;
+
+	*first = isl_calloc_array(ctx, int, graph->n + 1);
+	pos = isl_alloc_array(ctx, int, graph->n);
+	if (!*first || (graph->n && !pos))
+		goto error;
+
+	for (i = 0; i < graph->n_edge; ++i) {
+		int strong = is_strong_edge(&graph->edge[i]);
+		if (strong < 0)
+			goto error;
+		if (!strong)
+			continue;
+		(*first)[graph->edge[i].dst - graph->node + 1]++;
+		n++;
+	}
+	for (i = 0; i < graph->n; ++i) {
+		(*first)[i + 1] += (*first)[i];
+		pos[i] = (*first)[i];
+	}
+
+	*edge = isl_alloc_array(ctx, int, n);
+	if (n && !*edge)
+		goto error;
+	for (i = 0; i < graph->n_edge; ++i) {
+		struct isl_sched_edge *e = &graph->edge[i];
+		if (!is_strong_edge(e))
+			continue;
+		(*edge)[pos[e->dst - graph->node]++] = e->src - graph->node;
+	}
+	for (i = 0; i < graph->n; ++i) {
+		int len = (*first)[i + 1] - (*first)[i];
+		if (sort_nodes(*edge + (*first)[i], len, NULL) < 0)
+			goto error;
+	}
+
+	free(pos);
+	return 0;
+error:
+	free(pos);
+	return -1;
 }
 
-/* Use Tarjan's algorithm for computing the strongly connected components
+/* Apply Tarjan's algorithm to detect the strongly connected components
  * in the dependence graph (only validity edges).
- * If weak is set, we consider the graph to be undirected and
- * we effectively compute the (weakly) connected components.
- * Additionally, we also consider other edges when weak is set.
+ *
+ * The (conditional) validity edges are collected in adjacency lists
+ * first such that Tarjan's algorithm does not need to check for
+ * the presence of an edge between every pair of nodes.
  */
-static int detect_ccs(isl_ctx *ctx, struct isl_sched_graph *graph, int weak)
+static int detect_sccs(isl_ctx *ctx, struct isl_sched_graph *graph)
 {
 	int i, n;
+	int *first = NULL, *edge = NULL;
 	struct isl_tarjan_graph *g = NULL;
 
-	g = isl_tarjan_graph_init(ctx, graph->n,
-		weak ? &node_follows_weak : &node_follows_strong, graph);
+	if (strong_edges(ctx, graph, &first, &edge) >= 0)
+		g = isl_tarjan_graph_init_edges(ctx, graph->n, first, edge);
+	free(first);
+	free(edge);
 	if (!g)
 		return -1;
 
@@ -1265,36 +1459,95 @@ static int detect_ccs(isl_ctx *ctx, struct isl_sched_graph *graph, int weak)
 	return 0;
 }
 
-/* Apply Tarjan's algorithm to detect the strongly connected components
- * in the dependence graph.
+/* Return the representative of the set containing "i"
+ * in the union-find structure "parent".
  */
-static int detect_sccs(isl_ctx *ctx, struct isl_sched_graph *graph)
+static int wcc_find(int *parent, int i)
 {
-	return detect_ccs(ctx, graph, 0);
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
 }
 
-/* Apply Tarjan's algorithm to detect the (weakly) connected components
- * in the dependence graph.
+/* Detect the (weakly) connected components in the dependence graph,
+ * considering edges of any type.
+ *
+ * Rather than checking every pair of nodes for edges, as a
+ * (weak) application of Tarjan's algorithm would do, we merge the
+ * end points of every (non-empty) edge in a union-find structure,
+ * such that the time is linear in the size of the graph.
+ * The edges are taken directly from graph->edge, without
+ * looking them up in the edge tables.
+ * The components are then numbered in the same order as Tarjan's
+ * algorithm would produce them, i.e., in decreasing order
+ * of the largest index of a node in the component,
+ * such that the resulting schedule does not depend
+ * on the method used.
  */
 static int detect_wccs(isl_ctx *ctx, struct isl_sched_graph *graph)
 {
-	return detect_ccs(ctx, graph, 1);
-}
+	int i;
+	int *parent, *scc;
 
-static int cmp_scc(const void *a, const void *b, void *data)
-{
-	struct isl_sched_graph *graph = data;
-	const int *i1 = a;
-	const int *i2 = b;
+	parent = isl_alloc_array(ctx, int, graph->n);
+	scc = isl_alloc_array(ctx, int, graph->n);
+	if (graph->n && (!parent || !scc))
+		goto error;
+
+	for (i = 0; i < graph->n; ++i) {
+		parent[i] = i;
+		scc[i] = -1;
+	}
+	for (i = 0; i < graph->n_edge; ++i) {
+		struct isl_sched_edge *edge = &graph->edge[i];
+		int has, src, dst;
+
+		has = is_non_empty_edge(edge);
+		if (has < 0)
+			goto error;
+		if (!has)
+			continue;
+		src = wcc_find(parent, edge->src - graph->node);
+		dst = wcc_find(parent, edge->dst - graph->node);
+		if (src < dst)
+			parent[src] = dst;
+		else
+			parent[dst] = src;
+	}
+
+	graph->scc = 0;
+	for (i = graph->n - 1; i >= 0; --i) {
+		int root = wcc_find(parent, i);
+
+		if (scc[root] < 0)
+			scc[root] = graph->scc++;
+		graph->node[i].scc = scc[root];
+	}
 
-	return graph->node[*i1].scc - graph->node[*i2].scc;
+	free(parent);
+	free(scc);
+	return 0;
+error:
+	free(parent);
+	free(scc);
+	return -1;
 }
 
+#define SORT_FN		sort_by_scc
+#define SORT_EL		int
+#define SORT_ARG	struct isl_sched_graph *
+#define SORT_KEY(i, graph)	(graph)->node[*(i)].scc
+
+#include <isl_sort_templ.c>
+
 /* Sort the elements of graph->sorted according to the corresponding SCCs.
+ * Since the SCCs are small non-negative integers, a radix sort is used.
  */
 static int sort_sccs(struct isl_sched_graph *graph)
 {
-	return isl_sort(graph->sorted, graph->n, sizeof(int), &cmp_scc, graph);
+	return sort_by_scc(graph->sorted, graph->n, graph);
 }
 
 /* Given a dependence relation R from "node" to itself,
@@ -1321,13 +1574,17 @@ static __isl_give isl_basic_set *intra_coefficients(
 	struct isl_sched_graph *graph, struct isl_sched_node *node,
 	__isl_take isl_map *map)
 {
+	isl_ctx *ctx;
 	isl_set *delta;
 	isl_map *key;
 	isl_basic_set *coef;
+	enum isl_sched_phase phase;
 
 	if (isl_map_to_basic_set_has(graph->intra_hmap, map))
 		return isl_map_to_basic_set_get(graph->intra_hmap, map);
 
+	ctx = isl_map_get_ctx(map);
+	phase = sched_phase_enter(ctx, isl_sched_phase_coef);
 	key = isl_map_copy(map);
 	if (node->compressed) {
 		map = isl_map_preimage_domain_multi_aff(map,
@@ -1337,6 +1594,7 @@ static __isl_give isl_basic_set *intra_coefficients(
 	}
 	delta = isl_set_remove_divs(isl_map_deltas(map));
 	coef = isl_set_coefficients(delta);
+	sched_phase_leave(ctx, phase);
 	graph->intra_hmap = isl_map_to_basic_set_set(graph->intra_hmap, key,
 					isl_basic_set_copy(coef));
 
@@ -1358,13 +1616,17 @@ static __isl_give isl_basic_set *inter_coefficients(
 	struct isl_sched_graph *graph, struct isl_sched_edge *edge,
 	__isl_take isl_map *map)
 {
+	isl_ctx *ctx;
 	isl_set *set;
 	isl_map *key;
 	isl_basic_set *coef;
+	enum isl_sched_phase phase;
 
 	if (isl_map_to_basic_set_has(graph->inter_hmap, map))
 		return isl_map_to_basic_set_get(graph->inter_hmap, map);
 
+	ctx = isl_map_get_ctx(map);
+	phase = sched_phase_enter(ctx, isl_sched_phase_coef);
 	key = isl_map_copy(map);
 	if (edge->src->compressed)
 		map = isl_map_preimage_domain_multi_aff(map,
@@ -1374,6 +1636,7 @@ static __isl_give isl_basic_set *inter_coefficients(
 				    isl_multi_aff_copy(edge->dst->decompress));
 	set = isl_map_wrap(isl_map_remove_divs(map));
 	coef = isl_set_coefficients(set);
+	sched_phase_leave(ctx, phase);
 	graph->inter_hmap = isl_map_to_basic_set_set(graph->inter_hmap, key,
 					isl_basic_set_copy(coef));
 
@@ -2764,6 +3027,30 @@ static int compute_maxvar(struct isl_sched_graph *graph)
 	return 0;
 }
 
+/* Hand over the caches of coefficient sets of "src" to "dst",
+ * replacing those of "dst".
+ *
+ * The caches are keyed on the dependence relations and
+ * the nodes of a subgraph have the same compression as the corresponding
+ * nodes in the original graph, so the coefficient sets
+ * computed for the original graph can be reused for the subgraph and
+ * those computed for the subgraph can be reused in the original graph
+ * once the caches have been handed back.
+ * Since the original graph is not used while the schedule
+ * of the subgraph is being computed, the caches can simply be moved
+ * rather than copied.
+ */
+static void lend_coefficients(struct isl_sched_graph *dst,
+	struct isl_sched_graph *src)
+{
+	isl_map_to_basic_set_free(dst->intra_hmap);
+	isl_map_to_basic_set_free(dst->inter_hmap);
+	dst->intra_hmap = src->intra_hmap;
+	dst->inter_hmap = src->inter_hmap;
+	src->intra_hmap = NULL;
+	src->inter_hmap = NULL;
+}
+
 static int compute_schedule(isl_ctx *ctx, struct isl_sched_graph *graph);
 static int compute_schedule_wcc(isl_ctx *ctx, struct isl_sched_graph *graph);
 
@@ -2788,6 +3075,7 @@ static int compute_sub_schedule(isl_ctx *ctx,
 
 	if (graph_alloc(ctx, &split, n, n_edge) < 0)
 		goto error;
+	lend_coefficients(&split, graph);
 	if (copy_nodes(&split, graph, node_pred, data) < 0)
 		goto error;
 	if (graph_init_table(ctx, &split) < 0)
@@ -2811,9 +3099,11 @@ static int compute_sub_schedule(isl_ctx *ctx,
 
 	copy_schedule(graph, &split, node_pred, data);
 
+	lend_coefficients(graph, &split);
 	graph_free(ctx, &split);
 	return 0;
 error:
+	lend_coefficients(graph, &split);
 	graph_free(ctx, &split);
 	return -1;
 }
@@ -3378,7 +3668,7 @@ error:
 }
 
 static int compute_component_schedule(isl_ctx *ctx,
-	struct isl_sched_graph *graph);
+	struct isl_sched_graph *graph, int wcc);
 
 /* Is the schedule row "sol" trivial on node "node"?
  * That is, is the solution zero on the dimensions orthogonal to
@@ -3477,16 +3767,20 @@ static int carry_dependences(isl_ctx *ctx, struct isl_sched_graph *graph)
 	int trivial;
 	isl_vec *sol;
 	isl_basic_set *lp;
+	enum isl_sched_phase phase;
 
 	n_edge = 0;
 	for (i = 0; i < graph->n_edge; ++i)
 		n_edge += graph->edge[i].map->n;
 
-	if (setup_carry_lp(ctx, graph) < 0)
-		return -1;
-
-	lp = isl_basic_set_copy(graph->lp);
-	sol = isl_tab_basic_set_non_neg_lexmin(lp);
+	phase = sched_phase_enter(ctx, isl_sched_phase_feautrier);
+	if (setup_carry_lp(ctx, graph) < 0) {
+		sol = NULL;
+	} else {
+		lp = isl_basic_set_copy(graph->lp);
+		sol = isl_tab_basic_set_non_neg_lexmin(lp);
+	}
+	sched_phase_leave(ctx, phase);
 	if (!sol)
 		return -1;
 
@@ -3508,7 +3802,7 @@ static int carry_dependences(isl_ctx *ctx, struct isl_sched_graph *graph)
 		sol = isl_vec_free(sol);
 	} else if (trivial && graph->scc > 1) {
 		isl_vec_free(sol);
-		return compute_component_schedule(ctx, graph);
+		return compute_component_schedule(ctx, graph, 1);
 	}
 
 	if (update_schedule(graph, sol, 0, 0) < 0)
@@ -3874,6 +4168,7 @@ static int compute_schedule_wcc(isl_ctx *ctx, struct isl_sched_graph *graph)
 	int use_coincidence;
 	int force_coincidence = 0;
 	int check_conditional;
+	enum isl_sched_phase phase;
 
 	if (detect_sccs(ctx, graph) < 0)
 		return -1;
@@ -3902,9 +4197,15 @@ static int compute_schedule_wcc(isl_ctx *ctx, struct isl_sched_graph *graph)
 		graph->src_scc = -1;
 		graph->dst_scc = -1;
 
-		if (setup_lp(ctx, graph, use_coincidence) < 0)
+		phase = sched_phase_enter(ctx, isl_sched_phase_setup);
+		if (setup_lp(ctx, graph, use_coincidence) < 0) {
+			sched_phase_leave(ctx, phase);
 			return -1;
+		}
+		sched_phase_leave(ctx, phase);
+		phase = sched_phase_enter(ctx, isl_sched_phase_solve);
 		sol = solve_lp(graph);
+		sched_phase_leave(ctx, phase);
 		if (!sol)
 			return -1;
 		if (sol->size == 0) {
@@ -3976,47 +4277,26 @@ static int split_on_scc(isl_ctx *ctx, struct isl_sched_graph *graph)
 }
 
 /* Compute a schedule for each component (identified by node->scc)
- * of the dependence graph separately and then combine the results.
- * Depending on the setting of schedule_fuse, a component may be
- * either weakly or strongly connected.
- *
- * The band_id is adjusted such that each component has a separate id.
- * Note that the band_id may have already been set to a value different
- * from zero by compute_split_schedule.
+ * of "graph" one after the other, where component "c" consists
+ * of n[c] nodes and at most n_edge[c] edges, and
+ * set graph->n_total_row and graph->n_band to their maximal values
+ * over all components.
  */
-static int compute_component_schedule(isl_ctx *ctx,
-	struct isl_sched_graph *graph)
+static int compute_components(isl_ctx *ctx, struct isl_sched_graph *graph,
+	int *n, int *n_edge, int wcc)
 {
-	int wcc, i;
-	int n, n_edge;
+	int c;
 	int n_total_row, orig_total_row;
 	int n_band, orig_band;
 
-	if (ctx->opt->schedule_fuse == ISL_SCHEDULE_FUSE_MIN ||
-	    ctx->opt->schedule_separate_components)
-		if (split_on_scc(ctx, graph) < 0)
-			return -1;
-
 	n_total_row = 0;
 	orig_total_row = graph->n_total_row;
 	n_band = 0;
 	orig_band = graph->n_band;
-	for (i = 0; i < graph->n; ++i)
-		graph->node[i].band_id[graph->n_band] += graph->node[i].scc;
-	for (wcc = 0; wcc < graph->scc; ++wcc) {
-		n = 0;
-		for (i = 0; i < graph->n; ++i)
-			if (graph->node[i].scc == wcc)
-				n++;
-		n_edge = 0;
-		for (i = 0; i < graph->n_edge; ++i)
-			if (graph->edge[i].src->scc == wcc &&
-			    graph->edge[i].dst->scc == wcc)
-				n_edge++;
-
-		if (compute_sub_schedule(ctx, graph, n, n_edge,
+	for (c = 0; c < graph->scc; ++c) {
+		if (compute_sub_schedule(ctx, graph, n[c], n_edge[c],
 				    &node_scc_exactly,
-				    &edge_scc_exactly, wcc, 1) < 0)
+				    &edge_scc_exactly, c, wcc) < 0)
 			return -1;
 		if (graph->n_total_row > n_total_row)
 			n_total_row = graph->n_total_row;
@@ -4029,7 +4309,346 @@ static int compute_component_schedule(isl_ctx *ctx,
 	graph->n_total_row = n_total_row;
 	graph->n_band = n_band;
 
+	return 0;
+}
+
+#ifdef HAVE_PTHREAD
+
+/* Data used by compute_components_threads and its workers.
+ * "graph" lives in "ctx" and its components (identified by node->scc)
+ * are scheduled separately, where component "c" consists of
+ * n[c] nodes and at most n_edge[c] edges.
+ * "wcc" is set if the components are known to be connected.
+ * n_total_row[c] and n_band[c] are set to the values of
+ * graph->n_total_row and graph->n_band after scheduling component "c".
+ */
+struct isl_sched_components_threads {
+	isl_ctx *ctx;
+	struct isl_sched_graph *graph;
+	int wcc;
+	int *n;
+	int *n_edge;
+	int *n_total_row;
+	int *n_band;
+};
+
+/* Construct in "split" the subgraph of "graph" formed by component "c",
+ * consisting of "n" nodes and at most "n_edge" edges,
+ * with all its objects imported into "ctx".
+ * This is the same subgraph as the one constructed by
+ * compute_sub_schedule, except that the coefficient caches of "graph"
+ * cannot be lent to "split".
+ * The nodes of "split" live in a different isl_ctx, so their spaces
+ * cannot be compared to those of "graph".  Instead, pos[i] is set
+ * to the position in "split" of node i of "graph" and
+ * the end points of the edges are found through "pos".
+ */
+static int extract_component(isl_ctx *ctx, struct isl_sched_graph *split,
+	struct isl_sched_graph *graph, int c, int n, int n_edge, int *pos)
+{
+	int i;
+	enum isl_edge_type t;
+
+	if (graph_alloc(ctx, split, n, n_edge) < 0)
+		return -1;
+	split->n = 0;
+	for (i = 0; i < graph->n; ++i) {
+		struct isl_sched_node *node = &graph->node[i];
+		struct isl_sched_node *copy;
+
+		if (!node_scc_exactly(node, c))
+			continue;
+		pos[i] = split->n;
+		copy = &split->node[split->n++];
+		copy->space = isl_space_import(ctx, node->space);
+		copy->compressed = node->compressed;
+		copy->hull = isl_set_import(ctx, node->hull);
+		copy->compress = isl_multi_aff_import(ctx, node->compress);
+		copy->decompress = isl_multi_aff_import(ctx, node->decompress);
+		copy->nvar = node->nvar;
+		copy->nparam = node->nparam;
+		copy->sched = isl_mat_import(ctx, node->sched);
+		copy->sched_map = isl_map_import(ctx, node->sched_map);
+		copy->band = node->band;
+		copy->band_id = node->band_id;
+		copy->coincident = node->coincident;
+
+		if (!copy->space || !copy->sched)
+			return -1;
+		if (copy->compressed &&
+		    (!copy->hull || !copy->compress || !copy->decompress))
+			return -1;
+	}
+	if (graph_init_table(ctx, split) < 0)
+		return -1;
+	for (t = 0; t <= isl_edge_last; ++t)
+		split->max_edge[t] = graph->max_edge[t];
+	if (graph_init_edge_tables(ctx, split) < 0)
+		return -1;
+
+	split->n_edge = 0;
+	for (i = 0; i < graph->n_edge; ++i) {
+		struct isl_sched_edge *edge = &graph->edge[i];
+		struct isl_sched_edge *copy;
+
+		if (!edge_scc_exactly(edge, c))
+			continue;
+		if (isl_map_plain_is_empty(edge->map))
+			continue;
+
+		copy = &split->edge[split->n_edge++];
+		copy->src = &split->node[pos[edge->src - graph->node]];
+		copy->dst = &split->node[pos[edge->dst - graph->node]];
+		copy->map = isl_map_import(ctx, edge->map);
+		copy->tagged_condition = isl_union_map_import(ctx,
+						edge->tagged_condition);
+		copy->tagged_validity = isl_union_map_import(ctx,
+						edge->tagged_validity);
+		copy->validity = edge->validity;
+		copy->proximity = edge->proximity;
+		copy->coincidence = edge->coincidence;
+		copy->condition = edge->condition;
+		copy->conditional_validity = edge->conditional_validity;
+
+		if (!copy->map)
+			return -1;
+		if (edge->tagged_condition && !copy->tagged_condition)
+			return -1;
+		if (edge->tagged_validity && !copy->tagged_validity)
+			return -1;
+
+		for (t = isl_edge_first; t <= isl_edge_last; ++t) {
+			if (edge !=
+			    graph_find_edge(graph, t, edge->src, edge->dst))
+				continue;
+			if (graph_edge_table_add(ctx, split, t, copy) < 0)
+				return -1;
+		}
+	}
+
+	split->n_row = graph->n_row;
+	split->max_row = graph->max_row;
+	split->n_total_row = graph->n_total_row;
+	split->n_band = graph->n_band;
+	split->band_start = graph->band_start;
+
+	return 0;
+}
+
+/* Construct the subgraph formed by component "c" in the isl_ctx
+ * of "worker", compute a schedule for it and import the schedules
+ * of its nodes back into the nodes of the original graph.
+ *
+ * The band information of the nodes is shared with the original graph,
+ * but each component only modifies that of its own nodes.
+ */
+static int component_work(struct isl_thread_worker *worker, int c,
+	void *user)
+{
+	struct isl_sched_components_threads *data = user;
+	struct isl_sched_graph *graph = data->graph;
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	struct isl_sched_graph split = { 0 };
+	int *pos;
+	int i, r;
+
+	pos = isl_alloc_array(ctx, int, graph->n);
+	isl_thread_worker_lock(worker);
+	r = pos ? extract_component(ctx, &split, graph, c,
+				data->n[c], data->n_edge[c], pos) : -1;
+	isl_thread_worker_unlock(worker);
+
+	if (r >= 0)
+		r = data->wcc ? compute_schedule_wcc(ctx, &split) :
+				compute_schedule(ctx, &split);
+
+	if (r >= 0) {
+		isl_thread_worker_lock(worker);
+		for (i = 0; i < graph->n; ++i) {
+			struct isl_sched_node *node = &graph->node[i];
+			struct isl_sched_node *copy;
+
+			if (!node_scc_exactly(node, c))
+				continue;
+			copy = &split.node[pos[i]];
+			isl_mat_free(node->sched);
+			isl_map_free(node->sched_map);
+			node->sched = isl_mat_import(data->ctx, copy->sched);
+			node->sched_map = isl_map_import(data->ctx,
+							copy->sched_map);
+			if (!node->sched)
+				r = -1;
+		}
+		isl_thread_worker_unlock(worker);
+		data->n_total_row[c] = split.n_total_row;
+		data->n_band[c] = split.n_band;
+	}
+
+	graph_free(ctx, &split);
+	free(pos);
+	return r;
+}
+
+/* Compute a schedule for each component of "graph" as in
+ * compute_components, but using several threads.
+ *
+ * Each thread has its own isl_ctx, with the same options as "ctx",
+ * into which it imports the components that it handles
+ * (see isl_thread_run).
+ * The components are independent of each other, so the resulting
+ * schedules do not depend on which thread handled which component.
+ */
+static int compute_components_threads(isl_ctx *ctx,
+	struct isl_sched_graph *graph, int *n, int *n_edge, int wcc)
+{
+	int c;
+	struct isl_sched_components_threads data =
+		{ ctx, graph, wcc, n, n_edge };
+	int r = -1;
+
+	data.n_total_row = isl_alloc_array(ctx, int, graph->scc);
+	data.n_band = isl_alloc_array(ctx, int, graph->scc);
+	if (!data.n_total_row || !data.n_band)
+		goto error;
+	if (isl_thread_run(ctx, graph->scc, &component_work, &data) < 0)
+		goto error;
+
+	graph->n_total_row = 0;
+	graph->n_band = 0;
+	for (c = 0; c < graph->scc; ++c) {
+		if (data.n_total_row[c] > graph->n_total_row)
+			graph->n_total_row = data.n_total_row[c];
+		if (data.n_band[c] > graph->n_band)
+			graph->n_band = data.n_band[c];
+	}
+
+	r = 0;
+error:
+	free(data.n_total_row);
+	free(data.n_band);
+	return r;
+}
+
+#endif
+
+/* Compute a schedule for each component (identified by node->scc)
+ * of the dependence graph separately and then combine the results.
+ * Depending on the setting of schedule_fuse, a component may be
+ * either weakly or strongly connected.
+ * If "wcc" is not set, then the components are clusters of
+ * strongly connected components formed by cluster_sccs.
+ * These need to be separated by an outer schedule row and
+ * they may themselves consist of several components.
+ *
+ * The band_id is adjusted such that each component has a separate id.
+ * Note that the band_id may have already been set to a value different
+ * from zero by compute_split_schedule.
+ *
+ * If the threads option is set to a value greater than one
+ * and isl has been built with thread support, then the components
+ * are scheduled by several threads in parallel.
+ */
+static int compute_component_schedule(isl_ctx *ctx,
+	struct isl_sched_graph *graph, int wcc)
+{
+	int i, r;
+	int *n = NULL, *n_edge = NULL;
+
+	if (!wcc || ctx->opt->schedule_fuse == ISL_SCHEDULE_FUSE_MIN ||
+	    ctx->opt->schedule_separate_components)
+		if (split_on_scc(ctx, graph) < 0)
+			return -1;
+
+	n = isl_calloc_array(ctx, int, graph->scc);
+	n_edge = isl_calloc_array(ctx, int, graph->scc);
+	if (graph->scc && (!n || !n_edge))
+		goto error;
+	for (i = 0; i < graph->n; ++i)
+		n[graph->node[i].scc]++;
+	for (i = 0; i < graph->n_edge; ++i)
+		if (graph->edge[i].src->scc == graph->edge[i].dst->scc)
+			n_edge[graph->edge[i].src->scc]++;
+
+	for (i = 0; i < graph->n; ++i)
+		graph->node[i].band_id[graph->n_band] += graph->node[i].scc;
+#ifdef HAVE_PTHREAD
+	if (ctx->opt->threads > 1 && graph->scc > 1)
+		r = compute_components_threads(ctx, graph, n, n_edge, wcc);
+	else
+#endif
+		r = compute_components(ctx, graph, n, n_edge, wcc);
+
+	free(n);
+	free(n_edge);
+
+	if (r < 0)
+		return -1;
 	return pad_schedule(graph);
+error:
+	free(n);
+	free(n_edge);
+	return -1;
+}
+
+/* Group the strongly connected components of "graph", as computed
+ * by detect_sccs, into clusters of consecutive components with
+ * at most schedule_cluster_size nodes each, unless a single
+ * strongly connected component has more nodes, and
+ * replace node->scc by the index of the cluster of the node.
+ * Since the strongly connected components are numbered
+ * in topological order, all dependences between distinct clusters
+ * go from a cluster to a later cluster.
+ */
+static int cluster_sccs(isl_ctx *ctx, struct isl_sched_graph *graph)
+{
+	int i;
+	int max, size, n_cluster;
+	int *count, *cluster;
+
+	max = ctx->opt->schedule_cluster_size;
+	if (max < 1)
+		max = 1;
+
+	count = isl_calloc_array(ctx, int, graph->scc);
+	cluster = isl_alloc_array(ctx, int, graph->scc);
+	if (graph->scc && (!count || !cluster))
+		goto error;
+
+	for (i = 0; i < graph->n; ++i)
+		count[graph->node[i].scc]++;
+	n_cluster = 0;
+	size = 0;
+	for (i = 0; i < graph->scc; ++i) {
+		if (size > 0 && size + count[i] > max) {
+			n_cluster++;
+			size = 0;
+		}
+		cluster[i] = n_cluster;
+		size += count[i];
+	}
+	for (i = 0; i < graph->n; ++i)
+		graph->node[i].scc = cluster[graph->node[i].scc];
+	if (graph->scc > 0)
+		graph->scc = n_cluster + 1;
+
+	free(count);
+	free(cluster);
+	return 0;
+error:
+	free(count);
+	free(cluster);
+	return -1;
+}
+
+/* Should the cluster scheduling algorithm be applied to "graph"?
+ * It is only applied to the original dependence graph and only
+ * if this graph has more nodes than fit in a single cluster.
+ */
+static int need_clusters(isl_ctx *ctx, struct isl_sched_graph *graph)
+{
+	if (ctx->opt->schedule_algorithm != ISL_SCHEDULE_ALGORITHM_CLUSTER)
+		return 0;
+	return graph->root && graph->n > ctx->opt->schedule_cluster_size;
 }
 
 /* Compute a schedule for the given dependence graph.
@@ -4039,9 +4658,23 @@ static int compute_component_schedule(isl_ctx *ctx,
  * If schedule_fuse is set to minimal fusion, then we check for strongly
  * connected components instead and compute a separate schedule for
  * each such strongly connected component.
+ *
+ * If the cluster scheduling algorithm is selected and the graph
+ * is too large, then the strongly connected components are first
+ * grouped into clusters, which are then scheduled separately
+ * and one after the other, unless they all end up in a single cluster.
  */
 static int compute_schedule(isl_ctx *ctx, struct isl_sched_graph *graph)
 {
+	if (need_clusters(ctx, graph)) {
+		if (detect_sccs(ctx, graph) < 0)
+			return -1;
+		if (cluster_sccs(ctx, graph) < 0)
+			return -1;
+		if (graph->scc > 1)
+			return compute_component_schedule(ctx, graph, 0);
+	}
+
 	if (ctx->opt->schedule_fuse == ISL_SCHEDULE_FUSE_MIN) {
 		if (detect_sccs(ctx, graph) < 0)
 			return -1;
@@ -4051,11 +4684,214 @@ static int compute_schedule(isl_ctx *ctx, struct isl_sched_graph *graph)
 	}
 
 	if (graph->scc > 1)
-		return compute_component_schedule(ctx, graph);
+		return compute_component_schedule(ctx, graph, 1);
 
 	return compute_schedule_wcc(ctx, graph);
 }
 
+/* Construct the original dependence graph "graph" from the constraints
+ * in "sc".  graph->n has been set to the number of statements in sc->domain.
+ */
+static int graph_extract(isl_ctx *ctx, struct isl_sched_graph *graph,
+	__isl_keep isl_schedule_constraints *sc)
+{
+	struct isl_extract_edge_data data;
+	enum isl_edge_type i;
+	int j, n_edge;
+
+	n_edge = isl_schedule_constraints_n_map(sc);
+	if (graph_alloc(ctx, graph, graph->n, n_edge) < 0)
+		return -1;
+	if (compute_max_row(graph, sc) < 0)
+		return -1;
+	graph->root = 1;
+	graph->n = 0;
+	if (isl_union_set_foreach_set(sc->domain, &extract_node, graph) < 0)
+		return -1;
+	if (graph_init_table(ctx, graph) < 0)
+		return -1;
+	for (i = isl_edge_first; i <= isl_edge_last; ++i)
+		graph->max_edge[i] = isl_union_map_n_map(sc->constraint[i]);
+	if (graph_init_edge_tables(ctx, graph) < 0)
+		return -1;
+	graph->n_edge = 0;
+	data.graph = graph;
+	data.orig = isl_calloc_array(ctx, isl_map *, n_edge);
+	if (n_edge && !data.orig)
+		return -1;
+	for (i = isl_edge_first; i <= isl_edge_last; ++i) {
+		data.type = i;
+		if (isl_union_map_foreach_map(sc->constraint[i],
+						&extract_edge, &data) < 0)
+			break;
+	}
+	for (j = 0; j < graph->n_edge; ++j)
+		isl_map_free(data.orig[j]);
+	free(data.orig);
+
+	return i <= isl_edge_last ? -1 : 0;
+}
+
+/* Compare the names of the parameters "a" and "b".
+ */
+static int cmp_param_name(const void *a, const void *b, void *user)
+{
+	isl_id *const *id_a = a;
+	isl_id *const *id_b = b;
+
+	return strcmp(isl_id_get_name(*id_a), isl_id_get_name(*id_b));
+}
+
+/* Return a parameter space with the parameters of "space",
+ * sorted by name.
+ */
+static __isl_give isl_space *sort_params(__isl_take isl_space *space)
+{
+	int i, nparam;
+	isl_ctx *ctx;
+	isl_id **ids;
+	isl_space *sorted;
+
+	if (!space)
+		return NULL;
+
+	ctx = isl_space_get_ctx(space);
+	nparam = isl_space_dim(space, isl_dim_param);
+	ids = isl_alloc_array(ctx, isl_id *, nparam);
+	if (nparam && !ids)
+		return isl_space_free(space);
+	for (i = 0; i < nparam; ++i)
+		ids[i] = isl_space_get_dim_id(space, isl_dim_param, i);
+	isl_space_free(space);
+
+	sorted = isl_space_params_alloc(ctx, nparam);
+	for (i = 0; i < nparam; ++i)
+		if (!ids[i])
+			sorted = isl_space_free(sorted);
+	if (sorted &&
+	    isl_sort(ids, nparam, sizeof(isl_id *), &cmp_param_name, NULL) < 0)
+		sorted = isl_space_free(sorted);
+	for (i = 0; i < nparam; ++i) {
+		if (sorted)
+			sorted = isl_space_set_dim_id(sorted,
+						isl_dim_param, i, ids[i]);
+		else
+			isl_id_free(ids[i]);
+	}
+	free(ids);
+
+	return sorted;
+}
+
+/* Add a hash of "map", including its space, to *user.
+ * The hashes of the maps are added such that the result
+ * does not depend on the order in which the maps are visited.
+ */
+static int add_map_hash(__isl_take isl_map *map, void *user)
+{
+	uint32_t *hash = user;
+	uint32_t map_hash;
+	isl_space *space;
+
+	map = isl_map_coalesce(map);
+	space = isl_map_get_space(map);
+	map_hash = isl_hash_init();
+	isl_hash_hash(map_hash, isl_space_get_hash(space));
+	isl_hash_hash(map_hash, isl_map_get_hash(map));
+	isl_space_free(space);
+	isl_map_free(map);
+
+	*hash += map_hash;
+
+	return 0;
+}
+
+/* Add a hash of "set", including its space, to *user.
+ */
+static int add_set_hash(__isl_take isl_set *set, void *user)
+{
+	return add_map_hash(isl_map_from_range(set), user);
+}
+
+/* Return a fingerprint of "sc" that does not depend on the order
+ * of the parameters or on the order of the maps and sets in
+ * the domain and the constraints.
+ * In particular, the parameters are first sorted by name and
+ * every map and set is coalesced and normalized before its hash
+ * is computed.
+ * Equal schedule constraints result in equal fingerprints, but
+ * the converse is not guaranteed.
+ * Return 0 on error.
+ */
+uint32_t isl_schedule_constraints_get_hash(
+	__isl_keep isl_schedule_constraints *sc)
+{
+	isl_space *space;
+	isl_union_set *domain;
+	isl_union_map *umap;
+	enum isl_edge_type i;
+	uint32_t hash, part;
+	int r;
+
+	if (!sc)
+		return 0;
+
+	space = isl_union_set_get_space(sc->domain);
+	for (i = isl_edge_first; i <= isl_edge_last; ++i)
+		space = isl_space_align_params(space,
+				    isl_union_map_get_space(sc->constraint[i]));
+	space = sort_params(space);
+	if (!space)
+		return 0;
+
+	hash = isl_hash_init();
+	domain = isl_union_set_align_params(isl_union_set_copy(sc->domain),
+					    isl_space_copy(space));
+	part = 0;
+	r = isl_union_set_foreach_set(domain, &add_set_hash, &part);
+	isl_union_set_free(domain);
+	isl_hash_hash(hash, part);
+	for (i = isl_edge_first; r >= 0 && i <= isl_edge_last; ++i) {
+		umap = isl_union_map_copy(sc->constraint[i]);
+		umap = isl_union_map_align_params(umap, isl_space_copy(space));
+		part = 0;
+		r = isl_union_map_foreach_map(umap, &add_map_hash, &part);
+		isl_union_map_free(umap);
+		isl_hash_byte(hash, i);
+		isl_hash_hash(hash, part);
+	}
+	isl_space_free(space);
+
+	return r < 0 ? 0 : hash;
+}
+
+/* Install "load" and "store" as the callbacks of a schedule cache
+ * for isl_schedule_constraints_compute_schedule.
+ * Before any schedule is computed, "load" is called with the schedule
+ * constraints and their fingerprint, as computed by
+ * isl_schedule_constraints_get_hash.  If it returns a schedule,
+ * then this schedule is returned instead of computing a new one.
+ * After a schedule has been computed, it is passed to "store".
+ * Either callback may be NULL.
+ */
+int isl_ctx_set_schedule_cache(isl_ctx *ctx,
+	__isl_give isl_schedule *(*load)(
+		__isl_keep isl_schedule_constraints *sc, uint32_t hash,
+		void *user),
+	int (*store)(__isl_keep isl_schedule_constraints *sc, uint32_t hash,
+		__isl_keep isl_schedule *schedule, void *user),
+	void *user)
+{
+	if (!ctx)
+		return -1;
+
+	ctx->schedule_cache_load = load;
+	ctx->schedule_cache_store = store;
+	ctx->schedule_cache_user = user;
+
+	return 0;
+}
+
 /* Compute a schedule on sc->domain that respects the given schedule
  * constraints.
  *
@@ -4070,52 +4906,57 @@ static int compute_schedule(isl_ctx *ctx, struct isl_sched_graph *graph)
  * then the conditional validity dependences may be violated inside
  * a tilable band, provided they have no adjacent non-local
  * condition dependences.
+ *
+ * If a schedule cache has been installed using isl_ctx_set_schedule_cache,
+ * then the schedule is first looked up in this cache and only
+ * computed if it cannot be found.  A computed schedule is then
+ * stored in the cache.
  */
-__isl_give isl_schedule *isl_schedule_constraints_compute_schedule(
+static __isl_give isl_schedule *schedule_constraints_compute_schedule(
 	__isl_take isl_schedule_constraints *sc)
 {
 	isl_ctx *ctx = isl_schedule_constraints_get_ctx(sc);
 	struct isl_sched_graph graph = { 0 };
 	isl_schedule *sched;
-	struct isl_extract_edge_data data;
-	enum isl_edge_type i;
+	enum isl_sched_phase phase;
+	uint32_t hash = 0;
+	int r;
 
 	sc = isl_schedule_constraints_align_params(sc);
 	if (!sc)
 		return NULL;
 
+	if (ctx->schedule_cache_load || ctx->schedule_cache_store)
+		hash = isl_schedule_constraints_get_hash(sc);
+	if (ctx->schedule_cache_load) {
+		sched = ctx->schedule_cache_load(sc, hash,
+						ctx->schedule_cache_user);
+		if (sched) {
+			ctx->stats->schedule_cache_hits++;
+			isl_schedule_constraints_free(sc);
+			return sched;
+		}
+		ctx->stats->schedule_cache_misses++;
+	}
+
 	graph.n = isl_union_set_n_set(sc->domain);
 	if (graph.n == 0)
 		goto empty;
-	if (graph_alloc(ctx, &graph, graph.n,
-	    isl_schedule_constraints_n_map(sc)) < 0)
-		goto error;
-	if (compute_max_row(&graph, sc) < 0)
+	phase = sched_phase_enter(ctx, isl_sched_phase_graph);
+	r = graph_extract(ctx, &graph, sc);
+	sched_phase_leave(ctx, phase);
+	if (r < 0)
 		goto error;
-	graph.root = 1;
-	graph.n = 0;
-	if (isl_union_set_foreach_set(sc->domain, &extract_node, &graph) < 0)
-		goto error;
-	if (graph_init_table(ctx, &graph) < 0)
-		goto error;
-	for (i = isl_edge_first; i <= isl_edge_last; ++i)
-		graph.max_edge[i] = isl_union_map_n_map(sc->constraint[i]);
-	if (graph_init_edge_tables(ctx, &graph) < 0)
-		goto error;
-	graph.n_edge = 0;
-	data.graph = &graph;
-	for (i = isl_edge_first; i <= isl_edge_last; ++i) {
-		data.type = i;
-		if (isl_union_map_foreach_map(sc->constraint[i],
-						&extract_edge, &data) < 0)
-			goto error;
-	}
 
 	if (compute_schedule(ctx, &graph) < 0)
 		goto error;
 
 empty:
 	sched = extract_schedule(&graph, isl_union_set_get_space(sc->domain));
+	if (sched && ctx->schedule_cache_store &&
+	    ctx->schedule_cache_store(sc, hash, sched,
+				      ctx->schedule_cache_user) < 0)
+		sched = isl_schedule_free(sched);
 
 	graph_free(ctx, &graph);
 	isl_schedule_constraints_free(sc);
@@ -4127,6 +4968,25 @@ error:
 	return NULL;
 }
 
+/* Compute a schedule on the domain of "sc" that respects
+ * the schedule constraints in "sc"
+ * (see schedule_constraints_compute_schedule).
+ */
+__isl_give isl_schedule *isl_schedule_constraints_compute_schedule(
+	__isl_take isl_schedule_constraints *sc)
+{
+	isl_ctx *ctx = isl_schedule_constraints_get_ctx(sc);
+	struct isl_profile_node *prof;
+	isl_schedule *sched;
+
+	prof = isl_profile_enter(ctx,
+				"isl_schedule_constraints_compute_schedule");
+	sched = schedule_constraints_compute_schedule(sc);
+	isl_profile_leave(ctx, prof);
+
+	return sched;
+}
+
 /* Compute a schedule for the given union of domains that respects
  * all the validity dependences and minimizes
  * the dependence distances over the proximity dependences.
@@ -48,15 +48,21 @@ void isl_seq_cpy(isl_int *dst, isl_int *src, unsigned len)
 void isl_seq_submul(isl_int *dst, isl_int f, isl_int *src, unsigned len)
 {
 	int i;
-	for (i = 0; i < len; ++i)
+	for (i = 0; i < len; ++i) {
+		if (isl_int_is_zero(src[i]))
+			continue;
 		isl_int_submul(dst[i], f, src[i]);
+	}
 }
 
 void isl_seq_addmul(isl_int *dst, isl_int f, isl_int *src, unsigned len)
 {
 	int i;
-	for (i = 0; i < len; ++i)
+	for (i = 0; i < len; ++i) {
+		if (isl_int_is_zero(src[i]))
+			continue;
 		isl_int_addmul(dst[i], f, src[i]);
+	}
 }
 
 void isl_seq_swp_or_cpy(isl_int *dst, isl_int *src, unsigned len)
@@ -101,6 +107,14 @@ void isl_seq_fdiv_r(isl_int *dst, isl_int *src, isl_int m, unsigned len)
 		isl_int_fdiv_r(dst[i], src[i], m);
 }
 
+/* Set dst to m1 * src1 + m2 * src2.
+ * "dst" is allowed to be equal to "src1" or "src2".
+ *
+ * The rows are typically sparse, so we handle the elements where
+ * one of the two terms is zero separately, without a temporary.
+ * Otherwise, the result is computed in "tmp" and then swapped
+ * into "dst", avoiding a copy.
+ */
 void isl_seq_combine(isl_int *dst, isl_int m1, isl_int *src1,
 			isl_int m2, isl_int *src2, unsigned len)
 {
@@ -109,9 +123,17 @@ void isl_seq_combine(isl_int *dst, isl_int m1, isl_int *src1,
 
 	isl_int_init(tmp);
 	for (i = 0; i < len; ++i) {
+		if (isl_int_is_zero(src2[i])) {
+			isl_int_mul(dst[i], m1, src1[i]);
+			continue;
+		}
+		if (isl_int_is_zero(src1[i])) {
+			isl_int_mul(dst[i], m2, src2[i]);
+			continue;
+		}
 		isl_int_mul(tmp, m1, src1[i]);
 		isl_int_addmul(tmp, m2, src2[i]);
-		isl_int_set(dst[i], tmp);
+		isl_int_swap(dst[i], tmp);
 	}
 	isl_int_clear(tmp);
 }
@@ -150,9 +172,14 @@ void isl_seq_elim(isl_int *dst, isl_int *src, unsigned pos, unsigned len,
 int isl_seq_eq(isl_int *p1, isl_int *p2, unsigned len)
 {
 	int i;
-	for (i = 0; i < len; ++i)
+	for (i = 0; i < len; ++i) {
+#ifdef USE_SMALL_INT_OPT
+		if (*p1[i] == *p2[i])
+			continue;
+#endif
 		if (isl_int_ne(p1[i], p2[i]))
 			return 0;
+	}
 	return 1;
 }
 
@@ -276,21 +303,69 @@ void isl_seq_inner_product(isl_int *p1, isl_int *p2, unsigned len,
 		return;
 	}
 	isl_int_mul(*prod, p1[0], p2[0]);
-	for (i = 1; i < len; ++i)
+	for (i = 1; i < len; ++i) {
+		if (isl_int_is_zero(p1[i]) || isl_int_is_zero(p2[i]))
+			continue;
 		isl_int_addmul(*prod, p1[i], p2[i]);
+	}
 }
 
+/* Mix the 64-bit value "v" into the 64-bit hash state "h".
+ */
+static inline uint64_t mix64(uint64_t h, uint64_t v)
+{
+	h ^= v;
+	h *= UINT64_C(0x9e3779b97f4a7c15);
+	return h ^ (h >> 29);
+}
+
+/* Mix the coefficient at position "i" of "p" into the hash state "h".
+ * Zero coefficients do not affect the hash state, such that
+ * the hash value of a sequence does not depend on trailing zeros.
+ * Coefficients that fit in a machine word are mixed in directly.
+ * Only larger coefficients are hashed by walking their limbs.
+ * Since the choice only depends on the value of the coefficient,
+ * the hash value does not depend on the integer representation.
+ */
+static inline uint64_t mix_coef(uint64_t h, isl_int *p, unsigned i)
+{
+	if (isl_int_is_zero(p[i]))
+		return h;
+	h += i;
+	if (isl_int_fits_slong(p[i]))
+		return mix64(h, (uint64_t) isl_int_get_si(p[i]));
+	return mix64(h, isl_int_hash(p[i], (uint32_t) h));
+}
+
+/* Combine "hash" with a hash value of the sequence "p" of length "len".
+ *
+ * The sequence is processed in blocks of four coefficients,
+ * each mixed into a separate 64-bit hash state, such that
+ * the multiplications of the different states are independent.
+ * The states are combined into a single 32-bit value at the end.
+ */
 uint32_t isl_seq_hash(isl_int *p, unsigned len, uint32_t hash)
 {
-	int i;
-	for (i = 0; i < len; ++i) {
-		if (isl_int_is_zero(p[i]))
-			continue;
-		hash *= 16777619;
-		hash ^= (i & 0xFF);
-		hash = isl_int_hash(p[i], hash);
+	unsigned i;
+	uint64_t h0, h1, h2, h3;
+
+	h0 = hash;
+	h1 = hash ^ UINT64_C(0x5555555555555555);
+	h2 = hash ^ UINT64_C(0x3333333333333333);
+	h3 = hash ^ UINT64_C(0x0f0f0f0f0f0f0f0f);
+	for (i = 0; i + 4 <= len; i += 4) {
+		h0 = mix_coef(h0, p, i);
+		h1 = mix_coef(h1, p, i + 1);
+		h2 = mix_coef(h2, p, i + 2);
+		h3 = mix_coef(h3, p, i + 3);
 	}
-	return hash;
+	for (; i < len; ++i)
+		h0 = mix_coef(h0, p, i);
+
+	h0 = mix64(h0, h1);
+	h0 = mix64(h0, h2);
+	h0 = mix64(h0, h3);
+	return (uint32_t) (h0 ^ (h0 >> 32));
 }
 
 uint32_t isl_seq_get_hash(isl_int *p, unsigned len)
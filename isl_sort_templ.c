@@ -0,0 +1,182 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+/* Template for a stable sort of an array of "n" elements of type SORT_EL,
+ * generating a function
+ *
+ *	static int SORT_FN(SORT_EL *array, size_t n, SORT_ARG arg)
+ *
+ * that returns 0 on success and -1 if memory allocation fails.
+ *
+ * If SORT_KEY is defined, then SORT_KEY(el, arg) should evaluate
+ * to a non-negative integer key (smaller than 2^32) of the element
+ * pointed to by "el" and the elements are sorted in increasing order
+ * of this key using a radix sort.
+ * Otherwise, SORT_CMP(el1, el2, arg) should compare the elements
+ * pointed to by "el1" and "el2", in the same way as the comparison
+ * function passed to isl_sort, and the elements are sorted
+ * using a merge sort.  Since the comparison is expanded inline,
+ * it avoids the indirect function calls and the element size
+ * independent copying of isl_sort.
+ *
+ * In both cases, elements that compare equal keep their relative order.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#define xSORT_CAT(A,B) A ## _ ## B
+#define SORT_CAT(A,B) xSORT_CAT(A,B)
+#define SORT_PRIV(NAME) SORT_CAT(SORT_FN,NAME)
+
+#ifdef SORT_KEY
+
+/* Sort "array" using a least significant digit first radix sort
+ * on bytes, using "buf" as temporary storage.
+ * Digits on which all keys agree are skipped, such that only
+ * a single pass is performed if all keys are smaller than 256.
+ */
+static int SORT_FN(SORT_EL *array, size_t n, SORT_ARG arg)
+{
+	size_t i;
+	unsigned shift;
+	unsigned long or_keys = 0, and_keys = ~0UL;
+	SORT_EL *buf, *src, *dst;
+
+	if (n < 2)
+		return 0;
+
+	for (i = 0; i < n; ++i) {
+		unsigned long key = SORT_KEY(&array[i], arg);
+		or_keys |= key;
+		and_keys &= key;
+	}
+
+	buf = malloc(n * sizeof(SORT_EL));
+	if (!buf)
+		return -1;
+
+	src = array;
+	dst = buf;
+	for (shift = 0; shift < 32; shift += 8) {
+		size_t count[256 + 1] = { 0 };
+		unsigned d;
+
+		if ((((or_keys ^ and_keys) >> shift) & 0xff) == 0)
+			continue;
+		for (i = 0; i < n; ++i) {
+			d = (SORT_KEY(&src[i], arg) >> shift) & 0xff;
+			count[d + 1]++;
+		}
+		for (d = 0; d < 256; ++d)
+			count[d + 1] += count[d];
+		for (i = 0; i < n; ++i) {
+			d = (SORT_KEY(&src[i], arg) >> shift) & 0xff;
+			dst[count[d]++] = src[i];
+		}
+		dst = src;
+		src = src == array ? buf : array;
+	}
+
+	if (src != array)
+		memcpy(array, src, n * sizeof(SORT_EL));
+	free(buf);
+	return 0;
+}
+
+#else
+
+/* Arrays of at most this many elements are sorted using insertion sort.
+ */
+#define SORT_INSERTION_MAX	16
+
+/* Sort the "n" elements of "array" using insertion sort.
+ */
+static void SORT_PRIV(insertion)(SORT_EL *array, size_t n, SORT_ARG arg)
+{
+	size_t i, j;
+
+	for (i = 1; i < n; ++i) {
+		SORT_EL el;
+
+		if (SORT_CMP(&array[i - 1], &array[i], arg) <= 0)
+			continue;
+		el = array[i];
+		j = i;
+		do {
+			array[j] = array[j - 1];
+			--j;
+		} while (j > 0 && SORT_CMP(&array[j - 1], &el, arg) > 0);
+		array[j] = el;
+	}
+}
+
+/* Sort the "n" elements of "array", using "buf" as temporary storage
+ * for (at most) n / 2 elements.
+ *
+ * The two halves are sorted recursively and then merged,
+ * after copying the first half to "buf".
+ * If the two halves are already in order, then no merge is needed.
+ */
+static void SORT_PRIV(merge)(SORT_EL *array, SORT_EL *buf, size_t n,
+	SORT_ARG arg)
+{
+	size_t mid, i, j, k;
+
+	if (n <= SORT_INSERTION_MAX) {
+		SORT_PRIV(insertion)(array, n, arg);
+		return;
+	}
+
+	mid = n / 2;
+	SORT_PRIV(merge)(array, buf, mid, arg);
+	SORT_PRIV(merge)(array + mid, buf, n - mid, arg);
+
+	if (SORT_CMP(&array[mid - 1], &array[mid], arg) <= 0)
+		return;
+
+	memcpy(buf, array, mid * sizeof(SORT_EL));
+	i = 0;
+	j = mid;
+	k = 0;
+	while (i < mid && j < n) {
+		if (SORT_CMP(&array[j], &buf[i], arg) < 0)
+			array[k++] = array[j++];
+		else
+			array[k++] = buf[i++];
+	}
+	while (i < mid)
+		array[k++] = buf[i++];
+}
+
+static int SORT_FN(SORT_EL *array, size_t n, SORT_ARG arg)
+{
+	SORT_EL *buf;
+
+	if (n <= SORT_INSERTION_MAX) {
+		SORT_PRIV(insertion)(array, n, arg);
+		return 0;
+	}
+
+	buf = malloc((n / 2) * sizeof(SORT_EL));
+	if (!buf)
+		return -1;
+	SORT_PRIV(merge)(array, buf, n, arg);
+	free(buf);
+
+	return 0;
+}
+
+#undef SORT_INSERTION_MAX
+
+#endif
+
+#undef xSORT_CAT
+#undef SORT_CAT
+#undef SORT_PRIV
+#undef SORT_FN
+#undef SORT_EL
+#undef SORT_ARG
+#undef SORT_CMP
+#undef SORT_KEY
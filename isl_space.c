@@ -48,6 +48,8 @@ __isl_give isl_space *isl_space_alloc(isl_ctx *ctx,
 	dim->n_id = 0;
 	dim->ids = NULL;
 
+	dim->hash_valid = 0;
+
 	return dim;
 }
 
@@ -318,13 +320,74 @@ error:
 	return NULL;
 }
 
+/* Return an isl_id in "ctx" with the same name and user pointer as "id".
+ * The isl_id_none marker is not tied to any context.
+ */
+static __isl_give isl_id *id_import(isl_ctx *ctx, __isl_keep isl_id *id)
+{
+	if (id == &isl_id_none)
+		return id;
+	return isl_id_alloc(ctx, isl_id_get_name(id), isl_id_get_user(id));
+}
+
+/* Return a copy of "space" that is allocated in "ctx".
+ * The identifiers are recreated in "ctx" with the same names and
+ * user pointers.  Any function for freeing the user pointer
+ * is not carried over.
+ */
+__isl_give isl_space *isl_space_import(isl_ctx *ctx,
+	__isl_keep isl_space *space)
+{
+	int i;
+	isl_space *res;
+	enum isl_dim_type types[] = { isl_dim_param, isl_dim_in, isl_dim_out };
+
+	if (!space)
+		return NULL;
+	if (space->ctx == ctx)
+		return isl_space_copy(space);
+
+	res = isl_space_alloc(ctx, space->nparam, space->n_in, space->n_out);
+	if (!res)
+		return NULL;
+	for (i = 0; i < 2; ++i) {
+		if (space->tuple_id[i] &&
+		    !(res->tuple_id[i] = id_import(ctx, space->tuple_id[i])))
+			goto error;
+		if (space->nested[i] &&
+		    !(res->nested[i] = isl_space_import(ctx, space->nested[i])))
+			goto error;
+	}
+	for (i = 0; i < 3; ++i) {
+		int j;
+		unsigned dim = n(space, types[i]);
+
+		for (j = 0; j < dim; ++j) {
+			isl_id *id = get_id(space, types[i], j);
+
+			if (!id)
+				continue;
+			res = set_id(res, types[i], j, id_import(ctx, id));
+			if (!res)
+				return NULL;
+		}
+	}
+
+	return res;
+error:
+	isl_space_free(res);
+	return NULL;
+}
+
 __isl_give isl_space *isl_space_cow(__isl_take isl_space *dim)
 {
 	if (!dim)
 		return NULL;
 
-	if (dim->ref == 1)
+	if (dim->ref == 1) {
+		dim->hash_valid = 0;
 		return dim;
+	}
 	dim->ref--;
 	return isl_space_dup(dim);
 }
@@ -1829,16 +1892,63 @@ static uint32_t isl_hash_dim(uint32_t hash, __isl_keep isl_space *dim)
 	return hash;
 }
 
+/* Return a hash value of "dim".
+ * The result is cached in "dim" since it is typically computed
+ * many times on the same space, e.g., during lookups
+ * in union maps.
+ */
 uint32_t isl_space_get_hash(__isl_keep isl_space *dim)
 {
 	uint32_t hash;
 
 	if (!dim)
 		return 0;
+	if (dim->hash_valid)
+		return dim->hash;
 
 	hash = isl_hash_init();
 	hash = isl_hash_dim(hash, dim);
 
+	dim->hash = hash;
+	dim->hash_valid = 1;
+
+	return hash;
+}
+
+/* Update "hash" with the tuples of "space", ignoring the parameters.
+ */
+static uint32_t isl_hash_tuples(uint32_t hash, __isl_keep isl_space *space)
+{
+	if (!space)
+		return hash;
+
+	isl_hash_byte(hash, space->n_in % 256);
+	isl_hash_byte(hash, space->n_out % 256);
+	hash = isl_hash_id(hash, tuple_id(space, isl_dim_in));
+	hash = isl_hash_id(hash, tuple_id(space, isl_dim_out));
+	hash = isl_hash_tuples(hash, space->nested[0]);
+	hash = isl_hash_tuples(hash, space->nested[1]);
+
+	return hash;
+}
+
+/* Return a hash value of the tuple of type "type" of "space".
+ * Tuples that are considered equal by isl_space_tuple_is_equal
+ * have the same hash value.
+ */
+uint32_t isl_space_get_tuple_hash(__isl_keep isl_space *space,
+	enum isl_dim_type type)
+{
+	uint32_t hash;
+
+	if (!space)
+		return 0;
+
+	hash = isl_hash_init();
+	isl_hash_byte(hash, n(space, type) % 256);
+	hash = isl_hash_id(hash, tuple_id(space, type));
+	hash = isl_hash_tuples(hash, nested(space, type));
+
 	return hash;
 }
 
@@ -2283,6 +2393,45 @@ static int isl_space_cmp_type(__isl_keep isl_space *space1,
 	return 0;
 }
 
+/* Are "space1" and "space2" identical, i.e., do they not only
+ * have the same tuples, but also the same identifiers
+ * for all their dimensions, including those of nested spaces?
+ */
+int isl_space_is_identical(__isl_keep isl_space *space1,
+	__isl_keep isl_space *space2)
+{
+	int i, total;
+
+	if (!space1 || !space2)
+		return -1;
+	if (space1 == space2)
+		return 1;
+	if (isl_space_cmp(space1, space2) != 0)
+		return 0;
+
+	for (i = 0; i < 2; ++i) {
+		int identical;
+
+		if (!space1->nested[i])
+			continue;
+		identical = isl_space_is_identical(space1->nested[i],
+						    space2->nested[i]);
+		if (identical < 0 || !identical)
+			return identical;
+	}
+
+	total = isl_space_dim(space1, isl_dim_all);
+	for (i = 0; i < total; ++i) {
+		isl_id *id1 = i < space1->n_id ? space1->ids[i] : NULL;
+		isl_id *id2 = i < space2->n_id ? space2->ids[i] : NULL;
+
+		if (id1 != id2)
+			return 0;
+	}
+
+	return 1;
+}
+
 /* Compare two isl_spaces.
  *
  * The order is fairly arbitrary.
@@ -6,6 +6,11 @@
 #include <isl/id.h>
 
 struct isl_name;
+/* "hash" caches the result of isl_space_get_hash if "hash_valid" is set.
+ * Since a space is only modified after a call to isl_space_cow
+ * (or right after it has been created), the cached value
+ * is invalidated by isl_space_cow.
+ */
 struct isl_space {
 	int ref;
 
@@ -20,6 +25,9 @@ struct isl_space {
 
 	unsigned n_id;
 	isl_id **ids;
+
+	int hash_valid;
+	uint32_t hash;
 };
 
 __isl_give isl_space *isl_space_cow(__isl_take isl_space *dim);
@@ -28,6 +36,8 @@ __isl_give isl_space *isl_space_underlying(__isl_take isl_space *dim,
 	unsigned n_div);
 
 uint32_t isl_space_get_hash(__isl_keep isl_space *dim);
+uint32_t isl_space_get_tuple_hash(__isl_keep isl_space *space,
+	enum isl_dim_type type);
 
 int isl_space_is_domain_internal(__isl_keep isl_space *space1,
 	__isl_keep isl_space *space2);
@@ -56,5 +66,7 @@ __isl_give isl_space *isl_space_extend_domain_with_range(
 	__isl_take isl_space *domain, __isl_take isl_space *model);
 
 int isl_space_cmp(__isl_keep isl_space *space1, __isl_keep isl_space *space2);
+int isl_space_is_identical(__isl_keep isl_space *space1,
+	__isl_keep isl_space *space2);
 
 #endif
@@ -15,6 +15,7 @@
 #include <isl/map.h>
 #include <isl/aff.h>
 #include <isl_val_private.h>
+#include <isl_id_private.h>
 
 struct isl_keyword {
 	char			*name;
@@ -55,16 +56,19 @@ enum isl_token_type isl_stream_register_keyword(struct isl_stream *s,
 
 	keyword = isl_calloc_type(s->ctx, struct isl_keyword);
 	if (!keyword)
-		return ISL_TOKEN_ERROR;
+		goto error;
 	keyword->type = s->next_type++;
 	keyword->name = strdup(name);
 	if (!keyword->name) {
 		free(keyword);
-		return ISL_TOKEN_ERROR;
+		goto error;
 	}
 	entry->data = keyword;
 
 	return keyword->type;
+error:
+	isl_hash_table_remove(s->ctx, s->keywords, entry);
+	return ISL_TOKEN_ERROR;
 }
 
 struct isl_token *isl_token_new(isl_ctx *ctx,
@@ -77,6 +81,7 @@ struct isl_token *isl_token_new(isl_ctx *ctx,
 	tok->col = col;
 	tok->on_new_line = on_new_line;
 	tok->is_keyword = 0;
+	tok->id = NULL;
 	tok->u.s = NULL;
 	return tok;
 }
@@ -124,8 +129,7 @@ void isl_token_free(struct isl_token *tok)
 		isl_map_free(tok->u.map);
 	else if (tok->type == ISL_TOKEN_AFF)
 		isl_pw_aff_free(tok->u.pwaff);
-	else
-		free(tok->u.s);
+	isl_id_free(tok->id);
 	free(tok);
 }
 
@@ -176,6 +180,7 @@ static struct isl_stream* isl_stream_new(struct isl_ctx *ctx)
 	isl_ctx_ref(s->ctx);
 	s->file = NULL;
 	s->str = NULL;
+	s->end = NULL;
 	s->len = 0;
 	s->line = 1;
 	s->col = 0;
@@ -186,6 +191,7 @@ static struct isl_stream* isl_stream_new(struct isl_ctx *ctx)
 		s->tokens[i] = NULL;
 	s->n_token = 0;
 	s->keywords = NULL;
+	s->ids = NULL;
 	s->size = 256;
 	s->buffer = isl_alloc_array(ctx, char, s->size);
 	if (!s->buffer)
@@ -217,6 +223,52 @@ struct isl_stream* isl_stream_new_str(struct isl_ctx *ctx, const char *str)
 	return s;
 }
 
+/* Create a stream that reads from the "size" bytes starting at "buf".
+ * The buffer does not need to be NUL-terminated, so it may,
+ * in particular, be (part of) a memory mapped file.
+ * The buffer needs to remain valid while the stream is in use.
+ */
+struct isl_stream* isl_stream_new_buffer(struct isl_ctx *ctx,
+	const char *buf, size_t size)
+{
+	struct isl_stream *s;
+	if (!buf)
+		return NULL;
+	s = isl_stream_new(ctx);
+	if (!s)
+		return NULL;
+	s->str = buf;
+	s->end = buf + size;
+	return s;
+}
+
+/* Does "s" read from memory and does it not have any pending
+ * characters that were pushed back?
+ * If so, the remaining input can be scanned directly.
+ */
+static int stream_is_direct(struct isl_stream *s)
+{
+	return !s->file && !s->n_un && !s->eof;
+}
+
+/* Return a pointer to the first character in the remaining input
+ * of the in-memory stream "s" that does not satisfy "pred".
+ */
+static const char *stream_span(struct isl_stream *s, int (*pred)(int c))
+{
+	const char *p = s->str;
+
+	if (s->end) {
+		while (p < s->end && pred((unsigned char) *p))
+			++p;
+	} else {
+		while (pred((unsigned char) *p))
+			++p;
+	}
+
+	return p;
+}
+
 static int stream_getc(struct isl_stream *s)
 {
 	int c;
@@ -225,9 +277,11 @@ static int stream_getc(struct isl_stream *s)
 	if (s->n_un)
 		return s->c = s->un[--s->n_un];
 	if (s->file)
-		c = fgetc(s->file);
+		c = getc(s->file);
+	else if (s->end && s->str >= s->end)
+		c = -1;
 	else {
-		c = *s->str++;
+		c = (unsigned char) *s->str++;
 		if (c == '\0')
 			c = -1;
 	}
@@ -281,54 +335,150 @@ static int isl_stream_push_char(struct isl_stream *s, int c)
 	return 0;
 }
 
+/* Append the "n" characters starting at "p" to the buffer of "s".
+ */
+static int isl_stream_push_chars(struct isl_stream *s, const char *p,
+	size_t n)
+{
+	if (s->len + n > s->size) {
+		char *buffer;
+		size_t size = (3 * s->size) / 2;
+		if (size < s->len + n)
+			size = s->len + n;
+		buffer = isl_realloc_array(s->ctx, s->buffer, char, size);
+		if (!buffer)
+			return -1;
+		s->buffer = buffer;
+		s->size = size;
+	}
+	memcpy(s->buffer + s->len, p, n);
+	s->len += n;
+	return 0;
+}
+
+/* Move the characters at the start of the remaining input
+ * of the in-memory stream "s" that satisfy "pred" to the buffer.
+ * Since these characters do not include any newline,
+ * the column can be updated in one go.
+ * The last character that was read is then the last of
+ * the moved characters.
+ */
+static int stream_scan(struct isl_stream *s, int (*pred)(int c))
+{
+	const char *p;
+	size_t n;
+
+	if (!stream_is_direct(s))
+		return 0;
+
+	p = stream_span(s, pred);
+	n = p - s->str;
+	if (n == 0)
+		return 0;
+	if (isl_stream_push_chars(s, s->str, n) < 0)
+		return -1;
+	s->col += n;
+	s->c = (unsigned char) p[-1];
+	s->str = p;
+	return 0;
+}
+
+static int is_ident_char(int c)
+{
+	return isalnum(c) || c == '_';
+}
+
+static int is_digit(int c)
+{
+	return isdigit(c);
+}
+
 void isl_stream_push_token(struct isl_stream *s, struct isl_token *tok)
 {
 	isl_assert(s->ctx, s->n_token < 5, return);
 	s->tokens[s->n_token++] = tok;
 }
 
+/* Return the type of the built-in keyword "name" or ISL_TOKEN_IDENT
+ * if "name" is not a built-in keyword.
+ * The candidates are selected based on the first character,
+ * such that at most three (case insensitive) comparisons
+ * need to be performed.
+ */
+static enum isl_token_type check_builtin_keywords(const char *name)
+{
+	switch (tolower((unsigned char) name[0])) {
+	case 'a':
+		if (!strcasecmp(name, "and"))
+			return ISL_TOKEN_AND;
+		break;
+	case 'c':
+		if (!strcasecmp(name, "ceild"))
+			return ISL_TOKEN_CEILD;
+		if (!strcasecmp(name, "ceil"))
+			return ISL_TOKEN_CEIL;
+		break;
+	case 'e':
+		if (!strcasecmp(name, "exists"))
+			return ISL_TOKEN_EXISTS;
+		break;
+	case 'f':
+		if (!strcasecmp(name, "false"))
+			return ISL_TOKEN_FALSE;
+		if (!strcasecmp(name, "floord"))
+			return ISL_TOKEN_FLOORD;
+		if (!strcasecmp(name, "floor"))
+			return ISL_TOKEN_FLOOR;
+		break;
+	case 'i':
+		if (!strcasecmp(name, "implies"))
+			return ISL_TOKEN_IMPLIES;
+		if (!strcasecmp(name, "infty"))
+			return ISL_TOKEN_INFTY;
+		if (!strcasecmp(name, "infinity"))
+			return ISL_TOKEN_INFTY;
+		break;
+	case 'm':
+		if (!strcasecmp(name, "min"))
+			return ISL_TOKEN_MIN;
+		if (!strcasecmp(name, "max"))
+			return ISL_TOKEN_MAX;
+		if (!strcasecmp(name, "mod"))
+			return ISL_TOKEN_MOD;
+		break;
+	case 'n':
+		if (!strcasecmp(name, "not"))
+			return ISL_TOKEN_NOT;
+		if (!strcasecmp(name, "NaN"))
+			return ISL_TOKEN_NAN;
+		break;
+	case 'o':
+		if (!strcasecmp(name, "or"))
+			return ISL_TOKEN_OR;
+		break;
+	case 'r':
+		if (!strcasecmp(name, "rat"))
+			return ISL_TOKEN_RAT;
+		break;
+	case 't':
+		if (!strcasecmp(name, "true"))
+			return ISL_TOKEN_TRUE;
+		break;
+	}
+
+	return ISL_TOKEN_IDENT;
+}
+
 static enum isl_token_type check_keywords(struct isl_stream *s)
 {
 	struct isl_hash_table_entry *entry;
 	struct isl_keyword *keyword;
 	uint32_t name_hash;
+	enum isl_token_type type;
 
-	if (!strcasecmp(s->buffer, "exists"))
-		return ISL_TOKEN_EXISTS;
-	if (!strcasecmp(s->buffer, "and"))
-		return ISL_TOKEN_AND;
-	if (!strcasecmp(s->buffer, "or"))
-		return ISL_TOKEN_OR;
-	if (!strcasecmp(s->buffer, "implies"))
-		return ISL_TOKEN_IMPLIES;
-	if (!strcasecmp(s->buffer, "not"))
-		return ISL_TOKEN_NOT;
-	if (!strcasecmp(s->buffer, "infty"))
-		return ISL_TOKEN_INFTY;
-	if (!strcasecmp(s->buffer, "infinity"))
-		return ISL_TOKEN_INFTY;
-	if (!strcasecmp(s->buffer, "NaN"))
-		return ISL_TOKEN_NAN;
-	if (!strcasecmp(s->buffer, "min"))
-		return ISL_TOKEN_MIN;
-	if (!strcasecmp(s->buffer, "max"))
-		return ISL_TOKEN_MAX;
-	if (!strcasecmp(s->buffer, "rat"))
-		return ISL_TOKEN_RAT;
-	if (!strcasecmp(s->buffer, "true"))
-		return ISL_TOKEN_TRUE;
-	if (!strcasecmp(s->buffer, "false"))
-		return ISL_TOKEN_FALSE;
-	if (!strcasecmp(s->buffer, "ceild"))
-		return ISL_TOKEN_CEILD;
-	if (!strcasecmp(s->buffer, "floord"))
-		return ISL_TOKEN_FLOORD;
-	if (!strcasecmp(s->buffer, "mod"))
-		return ISL_TOKEN_MOD;
-	if (!strcasecmp(s->buffer, "ceil"))
-		return ISL_TOKEN_CEIL;
-	if (!strcasecmp(s->buffer, "floor"))
-		return ISL_TOKEN_FLOOR;
+	type = check_builtin_keywords(s->buffer);
+	if (type != ISL_TOKEN_IDENT)
+		return type;
 
 	if (!s->keywords)
 		return ISL_TOKEN_IDENT;
@@ -355,6 +505,56 @@ int isl_stream_skip_line(struct isl_stream *s)
 	return c == -1 ? -1 : 0;
 }
 
+/* Set the string of "tok" to the (NUL-terminated) contents
+ * of the buffer of "s".
+ *
+ * The string is not copied into the token, but is taken
+ * from an isl_id with that name, which is shared with all other
+ * occurrences of the same name, both in the input and in the isl objects
+ * constructed from it.
+ * If the isl_id was created especially for this token, then
+ * an extra reference is kept in "s" such that later occurrences
+ * of the same name in the input can reuse it.
+ */
+static int set_interned_str(struct isl_stream *s, struct isl_token *tok)
+{
+	tok->id = isl_id_alloc(s->ctx, s->buffer, NULL);
+	if (!tok->id)
+		return -1;
+	tok->u.s = tok->id->name;
+	if (tok->id->ref != 1)
+		return 0;
+
+	if (!s->ids)
+		s->ids = isl_id_list_alloc(s->ctx, 16);
+	s->ids = isl_id_list_add(s->ids, isl_id_copy(tok->id));
+	if (!s->ids)
+		return -1;
+	return 0;
+}
+
+/* Read the value of "tok" from the digits (possibly preceded
+ * by a minus sign) in the buffer of "s", which contains "len" characters.
+ * Values with at most 9 digits are guaranteed to fit in a long and
+ * are computed directly, avoiding the generic conversion from a string.
+ */
+static void read_value(struct isl_stream *s, struct isl_token *tok,
+	size_t len)
+{
+	const char *p = s->buffer;
+	int minus = *p == '-';
+	long v = 0;
+
+	if (len - minus > 9) {
+		isl_int_read(tok->u.v, s->buffer);
+		return;
+	}
+
+	for (p += minus; *p; ++p)
+		v = 10 * v + (*p - '0');
+	isl_int_set_si(tok->u.v, minus ? -v : v);
+}
+
 static struct isl_token *next_token(struct isl_stream *s, int same_line)
 {
 	int c;
@@ -418,7 +618,7 @@ static struct isl_token *next_token(struct isl_stream *s, int same_line)
 			tok = isl_token_new(s->ctx, line, col, old_line != line);
 			if (!tok)
 				return NULL;
-			tok->u.s = strdup("->");
+			tok->u.s = "->";
 			tok->type = ISL_TOKEN_TO;
 			return tok;
 		}
@@ -441,13 +641,15 @@ static struct isl_token *next_token(struct isl_stream *s, int same_line)
 		isl_int_init(tok->u.v);
 		if (isl_stream_push_char(s, c))
 			goto error;
+		if (stream_scan(s, &is_digit) < 0)
+			goto error;
 		while ((c = isl_stream_getc(s)) != -1 && isdigit(c))
 			if (isl_stream_push_char(s, c))
 				goto error;
 		if (c != -1)
 			isl_stream_ungetc(s, c);
 		isl_stream_push_char(s, '\0');
-		isl_int_read(tok->u.v, s->buffer);
+		read_value(s, tok, s->len - 1);
 		if (minus && isl_int_is_zero(tok->u.v)) {
 			tok->col++;
 			tok->on_new_line = 0;
@@ -464,6 +666,8 @@ static struct isl_token *next_token(struct isl_stream *s, int same_line)
 		if (!tok)
 			return NULL;
 		isl_stream_push_char(s, c);
+		if (stream_scan(s, &is_ident_char) < 0)
+			goto error;
 		while ((c = isl_stream_getc(s)) != -1 &&
 				(isalnum(c) || c == '_'))
 			isl_stream_push_char(s, c);
@@ -477,8 +681,7 @@ static struct isl_token *next_token(struct isl_stream *s, int same_line)
 		tok->type = check_keywords(s);
 		if (tok->type != ISL_TOKEN_IDENT)
 			tok->is_keyword = 1;
-		tok->u.s = strdup(s->buffer);
-		if (!tok->u.s)
+		if (set_interned_str(s, tok) < 0)
 			goto error;
 		return tok;
 	}
@@ -495,7 +698,8 @@ static struct isl_token *next_token(struct isl_stream *s, int same_line)
 			goto error;
 		}
 		isl_stream_push_char(s, '\0');
-		tok->u.s = strdup(s->buffer);
+		if (set_interned_str(s, tok) < 0)
+			goto error;
 		return tok;
 	}
 	if (c == '=') {
@@ -504,7 +708,7 @@ static struct isl_token *next_token(struct isl_stream *s, int same_line)
 		if (!tok)
 			return NULL;
 		if ((c = isl_stream_getc(s)) == '=') {
-			tok->u.s = strdup("==");
+			tok->u.s = "==";
 			tok->type = ISL_TOKEN_EQ_EQ;
 			return tok;
 		}
@@ -519,7 +723,7 @@ static struct isl_token *next_token(struct isl_stream *s, int same_line)
 		if (!tok)
 			return NULL;
 		if ((c = isl_stream_getc(s)) == '=') {
-			tok->u.s = strdup(":=");
+			tok->u.s = ":=";
 			tok->type = ISL_TOKEN_DEF;
 			return tok;
 		}
@@ -534,19 +738,19 @@ static struct isl_token *next_token(struct isl_stream *s, int same_line)
 		if (!tok)
 			return NULL;
 		if ((c = isl_stream_getc(s)) == '=') {
-			tok->u.s = strdup(">=");
+			tok->u.s = ">=";
 			tok->type = ISL_TOKEN_GE;
 			return tok;
 		} else if (c == '>') {
 			if ((c = isl_stream_getc(s)) == '=') {
-				tok->u.s = strdup(">>=");
+				tok->u.s = ">>=";
 				tok->type = ISL_TOKEN_LEX_GE;
 				return tok;
 			}
-			tok->u.s = strdup(">>");
+			tok->u.s = ">>";
 			tok->type = ISL_TOKEN_LEX_GT;
 		} else {
-			tok->u.s = strdup(">");
+			tok->u.s = ">";
 			tok->type = ISL_TOKEN_GT;
 		}
 		if (c != -1)
@@ -559,19 +763,19 @@ static struct isl_token *next_token(struct isl_stream *s, int same_line)
 		if (!tok)
 			return NULL;
 		if ((c = isl_stream_getc(s)) == '=') {
-			tok->u.s = strdup("<=");
+			tok->u.s = "<=";
 			tok->type = ISL_TOKEN_LE;
 			return tok;
 		} else if (c == '<') {
 			if ((c = isl_stream_getc(s)) == '=') {
-				tok->u.s = strdup("<<=");
+				tok->u.s = "<<=";
 				tok->type = ISL_TOKEN_LEX_LE;
 				return tok;
 			}
-			tok->u.s = strdup("<<");
+			tok->u.s = "<<";
 			tok->type = ISL_TOKEN_LEX_LT;
 		} else {
-			tok->u.s = strdup("<");
+			tok->u.s = "<";
 			tok->type = ISL_TOKEN_LT;
 		}
 		if (c != -1)
@@ -584,10 +788,10 @@ static struct isl_token *next_token(struct isl_stream *s, int same_line)
 			return NULL;
 		tok->type = ISL_TOKEN_AND;
 		if ((c = isl_stream_getc(s)) != '&' && c != -1) {
-			tok->u.s = strdup("&");
+			tok->u.s = "&";
 			isl_stream_ungetc(s, c);
 		} else
-			tok->u.s = strdup("&&");
+			tok->u.s = "&&";
 		return tok;
 	}
 	if (c == '|') {
@@ -596,10 +800,10 @@ static struct isl_token *next_token(struct isl_stream *s, int same_line)
 			return NULL;
 		tok->type = ISL_TOKEN_OR;
 		if ((c = isl_stream_getc(s)) != '|' && c != -1) {
-			tok->u.s = strdup("|");
+			tok->u.s = "|";
 			isl_stream_ungetc(s, c);
 		} else
-			tok->u.s = strdup("||");
+			tok->u.s = "||";
 		return tok;
 	}
 	if (c == '/') {
@@ -610,7 +814,7 @@ static struct isl_token *next_token(struct isl_stream *s, int same_line)
 			tok->type = (enum isl_token_type) '/';
 			isl_stream_ungetc(s, c);
 		} else {
-			tok->u.s = strdup("/\\");
+			tok->u.s = "/\\";
 			tok->type = ISL_TOKEN_AND;
 		}
 		return tok;
@@ -623,7 +827,7 @@ static struct isl_token *next_token(struct isl_stream *s, int same_line)
 			tok->type = (enum isl_token_type) '\\';
 			isl_stream_ungetc(s, c);
 		} else {
-			tok->u.s = strdup("\\/");
+			tok->u.s = "\\/";
 			tok->type = ISL_TOKEN_OR;
 		}
 		return tok;
@@ -633,12 +837,12 @@ static struct isl_token *next_token(struct isl_stream *s, int same_line)
 		if (!tok)
 			return NULL;
 		if ((c = isl_stream_getc(s)) == '=') {
-			tok->u.s = strdup("!=");
+			tok->u.s = "!=";
 			tok->type = ISL_TOKEN_NE;
 			return tok;
 		} else {
 			tok->type = ISL_TOKEN_NOT;
-			tok->u.s = strdup("!");
+			tok->u.s = "!";
 		}
 		if (c != -1)
 			isl_stream_ungetc(s, c);
@@ -773,6 +977,7 @@ void isl_stream_free(struct isl_stream *s)
 		isl_hash_table_foreach(s->ctx, s->keywords, &free_keyword, NULL);
 		isl_hash_table_free(s->ctx, s->keywords);
 	}
+	isl_id_list_free(s->ids);
 	isl_ctx_deref(s->ctx);
 	free(s);
 }
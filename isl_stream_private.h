@@ -9,9 +9,13 @@ struct isl_token {
 	int line;
 	int col;
 
+	/* If "id" is set, then u.s points to its name.
+	 * Otherwise, u.s is either NULL or a string literal.
+	 */
+	isl_id *id;
 	union {
 		isl_int	v;
-		char	*s;
+		const char *s;
 		isl_map *map;
 		isl_pw_aff *pwaff;
 	} u;
@@ -9,6 +9,7 @@
  * and Ecole Normale Superieure, 45 rue d'Ulm, 75230 Paris, France
  */
 
+#include <string.h>
 #include <isl_ctx_private.h>
 #include <isl_mat_private.h>
 #include <isl_vec_private.h>
@@ -16,6 +17,8 @@
 #include "isl_tab.h"
 #include <isl_seq.h>
 #include <isl_config.h>
+#include <isl_options_private.h>
+#include <isl_profile.h>
 
 /*
  * The implementation of tableaus in this file was inspired by Section 8
@@ -23,19 +26,53 @@
  * prover for program checking".
  */
 
-struct isl_tab *isl_tab_alloc(struct isl_ctx *ctx,
-	unsigned n_row, unsigned n_var, unsigned M)
+/* Return a zeroed isl_tab structure with var and col_var arrays
+ * of (at least) "n_var" elements and con and row_var arrays
+ * of (at least) "n_row" elements, taken from the free list of "ctx"
+ * if possible.
+ * The free list entry with the smallest arrays that are large enough
+ * is selected.  The sizes of these arrays are kept in the max_var and
+ * max_con fields of the entries.
+ */
+static struct isl_tab *tab_header_alloc(isl_ctx *ctx,
+	unsigned n_row, unsigned n_var)
 {
-	int i;
-	struct isl_tab *tab;
-	unsigned off = 2 + M;
+	int i, best = -1;
+	struct isl_tab *tab, *cached;
+	struct isl_tab_var *var, *con;
+	int *col_var, *row_var;
+
+	for (i = 0; i < ctx->n_free_tab; ++i) {
+		cached = ctx->free_tab[i];
+		if (cached->max_con < n_row || cached->max_var < n_var)
+			continue;
+		if (best < 0 || cached->max_con + cached->max_var <
+			    ctx->free_tab[best]->max_con +
+			    ctx->free_tab[best]->max_var)
+			best = i;
+	}
+	if (best >= 0) {
+		if (isl_ctx_next_operation(ctx) < 0)
+			return NULL;
+		ctx->stats->free_list_hits++;
+		tab = ctx->free_tab[best];
+		ctx->free_tab[best] = ctx->free_tab[--ctx->n_free_tab];
+		var = tab->var;
+		con = tab->con;
+		col_var = tab->col_var;
+		row_var = tab->row_var;
+		memset(tab, 0, sizeof(*tab));
+		tab->var = var;
+		tab->con = con;
+		tab->col_var = col_var;
+		tab->row_var = row_var;
+		return tab;
+	}
 
+	ctx->stats->free_list_misses++;
 	tab = isl_calloc_type(ctx, struct isl_tab);
 	if (!tab)
 		return NULL;
-	tab->mat = isl_mat_alloc(ctx, n_row, off + n_var);
-	if (!tab->mat)
-		goto error;
 	tab->var = isl_alloc_array(ctx, struct isl_tab_var, n_var);
 	if (n_var && !tab->var)
 		goto error;
@@ -48,6 +85,64 @@ struct isl_tab *isl_tab_alloc(struct isl_ctx *ctx,
 	tab->row_var = isl_alloc_array(ctx, int, n_row);
 	if (n_row && !tab->row_var)
 		goto error;
+	return tab;
+error:
+	isl_tab_free(tab);
+	return NULL;
+}
+
+/* Release the isl_tab structure "tab" along with its var, con,
+ * col_var and row_var arrays, keeping them in the free list of "ctx"
+ * if there is room.
+ * Only the parts of the arrays that are known to be in use
+ * are recorded as being available.
+ */
+static void tab_header_free(isl_ctx *ctx, struct isl_tab *tab)
+{
+	if (!ctx || ctx->n_free_tab >= ISL_FREE_LIST_SIZE) {
+		free(tab->var);
+		free(tab->con);
+		free(tab->row_var);
+		free(tab->col_var);
+		free(tab);
+		return;
+	}
+
+	tab->max_var = tab->var && tab->col_var ?
+			isl_min(tab->n_var, tab->n_col) : 0;
+	tab->max_con = tab->con && tab->row_var ?
+			isl_min(tab->n_con, tab->n_row) : 0;
+	ctx->free_tab[ctx->n_free_tab++] = tab;
+}
+
+/* Free all isl_tab structures kept in the free list of "ctx".
+ */
+void isl_tab_clear_free_list(isl_ctx *ctx)
+{
+	while (ctx->n_free_tab > 0) {
+		struct isl_tab *tab = ctx->free_tab[--ctx->n_free_tab];
+		free(tab->var);
+		free(tab->con);
+		free(tab->row_var);
+		free(tab->col_var);
+		free(tab);
+	}
+}
+
+struct isl_tab *isl_tab_alloc(struct isl_ctx *ctx,
+	unsigned n_row, unsigned n_var, unsigned M)
+{
+	int i;
+	struct isl_tab *tab;
+	unsigned off = 2 + M;
+
+	tab = tab_header_alloc(ctx, n_row, n_var);
+	if (!tab)
+		return NULL;
+	ctx->stats->tab_allocs++;
+	tab->mat = isl_mat_alloc(ctx, n_row, off + n_var);
+	if (!tab->mat)
+		goto error;
 	for (i = 0; i < n_var; ++i) {
 		tab->var[i].index = i;
 		tab->var[i].is_row = 0;
@@ -79,10 +174,12 @@ struct isl_tab *isl_tab_alloc(struct isl_ctx *ctx,
 	tab->bottom.type = isl_tab_undo_bottom;
 	tab->bottom.next = NULL;
 	tab->top = &tab->bottom;
+	tab->undo_pool = NULL;
 
 	tab->n_zero = 0;
 	tab->n_unbounded = 0;
 	tab->basis = NULL;
+	tab->basis_width = NULL;
 
 	return tab;
 error:
@@ -172,7 +269,11 @@ int isl_tab_extend_vars(struct isl_tab *tab, unsigned n_new)
 	return 0;
 }
 
-static void free_undo_record(struct isl_tab_undo *undo)
+/* Release the undo record "undo", which has been popped from
+ * the undo stack of "tab".
+ * The record itself is kept in the undo pool of "tab" for reuse.
+ */
+static void free_undo_record(struct isl_tab *tab, struct isl_tab_undo *undo)
 {
 	switch (undo->type) {
 	case isl_tab_undo_saved_basis:
@@ -180,7 +281,8 @@ static void free_undo_record(struct isl_tab_undo *undo)
 		break;
 	default:;
 	}
-	free(undo);
+	undo->next = tab->undo_pool;
+	tab->undo_pool = undo;
 }
 
 static void free_undo(struct isl_tab *tab)
@@ -189,28 +291,42 @@ static void free_undo(struct isl_tab *tab)
 
 	for (undo = tab->top; undo && undo != &tab->bottom; undo = next) {
 		next = undo->next;
-		free_undo_record(undo);
+		free_undo_record(tab, undo);
 	}
 	tab->top = undo;
 }
 
+/* Free all undo records in the undo pool of "tab".
+ */
+static void free_undo_pool(struct isl_tab *tab)
+{
+	struct isl_tab_undo *undo, *next;
+
+	for (undo = tab->undo_pool; undo; undo = next) {
+		next = undo->next;
+		free(undo);
+	}
+	tab->undo_pool = NULL;
+}
+
 void isl_tab_free(struct isl_tab *tab)
 {
+	isl_ctx *ctx;
+
 	if (!tab)
 		return;
+	ctx = isl_tab_get_ctx(tab);
 	free_undo(tab);
+	free_undo_pool(tab);
 	isl_mat_free(tab->mat);
 	isl_vec_free(tab->dual);
 	isl_basic_map_free(tab->bmap);
-	free(tab->var);
-	free(tab->con);
-	free(tab->row_var);
-	free(tab->col_var);
 	free(tab->row_sign);
 	isl_mat_free(tab->samples);
 	free(tab->sample_index);
 	isl_mat_free(tab->basis);
-	free(tab);
+	isl_vec_free(tab->basis_width);
+	tab_header_free(ctx, tab);
 }
 
 struct isl_tab *isl_tab_dup(struct isl_tab *tab)
@@ -226,6 +342,7 @@ struct isl_tab *isl_tab_dup(struct isl_tab *tab)
 	dup = isl_calloc_type(tab->mat->ctx, struct isl_tab);
 	if (!dup)
 		return NULL;
+	tab->mat->ctx->stats->tab_allocs++;
 	dup->mat = isl_mat_dup(tab->mat);
 	if (!dup->mat)
 		goto error;
@@ -289,10 +406,12 @@ struct isl_tab *isl_tab_dup(struct isl_tab *tab)
 	dup->bottom.type = isl_tab_undo_bottom;
 	dup->bottom.next = NULL;
 	dup->top = &dup->bottom;
+	dup->undo_pool = NULL;
 
 	dup->n_zero = tab->n_zero;
 	dup->n_unbounded = tab->n_unbounded;
 	dup->basis = isl_mat_dup(tab->basis);
+	dup->basis_width = isl_vec_dup(tab->basis_width);
 
 	return dup;
 error:
@@ -452,6 +571,7 @@ struct isl_tab *isl_tab_product(struct isl_tab *tab1, struct isl_tab *tab2)
 	prod = isl_calloc_type(tab1->mat->ctx, struct isl_tab);
 	if (!prod)
 		return NULL;
+	tab1->mat->ctx->stats->tab_allocs++;
 	prod->mat = tab_mat_product(tab1->mat, tab2->mat,
 				tab1->n_row, tab2->n_row,
 				tab1->n_col, tab2->n_col, off, r1, r2, d1, d2);
@@ -542,10 +662,12 @@ struct isl_tab *isl_tab_product(struct isl_tab *tab1, struct isl_tab *tab2)
 	prod->bottom.type = isl_tab_undo_bottom;
 	prod->bottom.next = NULL;
 	prod->top = &prod->bottom;
+	prod->undo_pool = NULL;
 
 	prod->n_zero = 0;
 	prod->n_unbounded = 0;
 	prod->basis = NULL;
+	prod->basis_width = NULL;
 
 	return prod;
 error:
@@ -679,6 +801,94 @@ static int pivot_row(struct isl_tab *tab,
 	return r;
 }
 
+/* Is column "j" a candidate pivot column for changing the row
+ * with coefficients "tr" in the direction "sgn"?
+ * See find_pivot.
+ */
+static int is_pivot_col(struct isl_tab *tab, isl_int *tr, int sgn, int j)
+{
+	if (isl_int_is_zero(tr[j]))
+		return 0;
+	if (isl_int_sgn(tr[j]) != sgn && var_from_col(tab, j)->is_nonneg)
+		return 0;
+	return 1;
+}
+
+/* Return the square of the (floating point approximation of the)
+ * steepest edge weight of column "j", i.e., the squared norm
+ * of the column, including the implicit entry of the column
+ * variable itself.
+ * Redundant rows are ignored since they no longer
+ * play any role in the LP.
+ */
+static double col_weight(struct isl_tab *tab, int j)
+{
+	int i;
+	double w = 1.0;
+	unsigned off = 2 + tab->M;
+
+	for (i = tab->n_redundant; i < tab->n_row; ++i) {
+		double a;
+
+		if (isl_int_is_zero(tab->mat->row[i][off + j]))
+			continue;
+		a = isl_int_get_d(tab->mat->row[i][off + j]) /
+		    isl_int_get_d(tab->mat->row[i][0]);
+		w += a * a;
+	}
+	return w;
+}
+
+/* Select a pivot column for changing the row with coefficients "tr"
+ * in the direction "sgn" according to the pivot rule "rule",
+ * which is different from ISL_TAB_PIVOT_BLAND.
+ *
+ * ISL_TAB_PIVOT_DANTZIG selects the column with the largest
+ * absolute coefficient, i.e., the column that changes the row
+ * the most per unit step.
+ * ISL_TAB_PIVOT_STEEPEST_EDGE selects the column for which this
+ * change is largest relative to the length of the edge
+ * followed in the space of all variables.
+ * Ties are broken in favor of the variable with the smallest index.
+ */
+static int rule_pivot_col(struct isl_tab *tab, isl_int *tr, int sgn, int rule)
+{
+	int j, c = -1;
+	double best = 0;
+
+	for (j = tab->n_dead; j < tab->n_col; ++j) {
+		double score;
+
+		if (!is_pivot_col(tab, tr, sgn, j))
+			continue;
+		if (rule == ISL_TAB_PIVOT_DANTZIG) {
+			if (c >= 0 && !isl_int_abs_gt(tr[j], tr[c]) &&
+			    (!isl_int_abs_eq(tr[j], tr[c]) ||
+			     tab->col_var[j] > tab->col_var[c]))
+				continue;
+			c = j;
+			continue;
+		}
+		score = isl_int_get_d(tr[j]);
+		score = score * score / col_weight(tab, j);
+		if (c >= 0 && (score < best ||
+		    (score == best && tab->col_var[j] > tab->col_var[c])))
+			continue;
+		c = j;
+		best = score;
+	}
+	return c;
+}
+
+/* Would pivoting on row "r" leave the sample value unchanged?
+ */
+static int is_degenerate_row(struct isl_tab *tab, int r)
+{
+	if (!isl_int_is_zero(tab->mat->row[r][1]))
+		return 0;
+	return !tab->M || isl_int_is_zero(tab->mat->row[r][2]);
+}
+
 /* Find a pivot (row and col) that will increase (sgn > 0) or decrease
  * (sgn < 0) the value of row variable var.
  * If not NULL, then skip_var is a row variable that should be ignored
@@ -694,12 +904,21 @@ static int pivot_row(struct isl_tab *tab,
  * If a_ri is positive, then we need to move x_i in the same direction
  * to obtain the desired effect.  Otherwise, x_i has to move in the
  * opposite direction.
+ *
+ * By default (ISL_TAB_PIVOT_BLAND), we pick the candidate column
+ * with the smallest variable index.  If the tab_pivot option selects
+ * a different rule, then we first try the column selected by that rule.
+ * If this would result in a degenerate pivot, then we fall back
+ * to the default choice.  Since any cycle of pivots can only consist
+ * of degenerate pivots, this ensures that the other rules terminate
+ * whenever the default rule does.
  */
 static void find_pivot(struct isl_tab *tab,
 	struct isl_tab_var *var, struct isl_tab_var *skip_var,
 	int sgn, int *row, int *col)
 {
 	int j, r, c;
+	int rule;
 	isl_int *tr;
 
 	*row = *col = -1;
@@ -707,12 +926,22 @@ static void find_pivot(struct isl_tab *tab,
 	isl_assert(tab->mat->ctx, var->is_row, return);
 	tr = tab->mat->row[var->index] + 2 + tab->M;
 
+	rule = tab->mat->ctx->opt->tab_pivot;
+	if (rule != ISL_TAB_PIVOT_BLAND) {
+		c = rule_pivot_col(tab, tr, sgn, rule);
+		if (c < 0)
+			return;
+		r = pivot_row(tab, skip_var, sgn * isl_int_sgn(tr[c]), c);
+		if (r < 0 || !is_degenerate_row(tab, r)) {
+			*row = r < 0 ? var->index : r;
+			*col = c;
+			return;
+		}
+	}
+
 	c = -1;
 	for (j = tab->n_dead; j < tab->n_col; ++j) {
-		if (isl_int_is_zero(tr[j]))
-			continue;
-		if (isl_int_sgn(tr[j]) != sgn &&
-		    var_from_col(tab, j)->is_nonneg)
+		if (!is_pivot_col(tab, tr, sgn, j))
 			continue;
 		if (c < 0 || tab->col_var[j] < tab->col_var[c])
 			c = j;
@@ -791,9 +1020,14 @@ static int push_union(struct isl_tab *tab,
 	if (!tab->need_undo)
 		return 0;
 
-	undo = isl_alloc_type(tab->mat->ctx, struct isl_tab_undo);
-	if (!undo)
-		return -1;
+	if (tab->undo_pool) {
+		undo = tab->undo_pool;
+		tab->undo_pool = undo->next;
+	} else {
+		undo = isl_alloc_type(tab->mat->ctx, struct isl_tab_undo);
+		if (!undo)
+			return -1;
+	}
 	undo->type = type;
 	undo->u = u;
 	undo->next = tab->top;
@@ -1085,12 +1319,21 @@ static void update_row_sign(struct isl_tab *tab, int row, int col, int row_sgn)
  * s(n_rc)d_r/|n_rc|		-s(n_rc)n_ri/|n_rc|
  * s(n_rc)d_r n_jc/(|n_rc| d_j)	(n_ji |n_rc| - s(n_rc)n_jc n_ri)/(|n_rc| d_j)
  *
+ * Since most pivot rows are sparse and often have |n_rc| = 1
+ * after normalization, the multiplications by |n_rc| and
+ * the updates involving a zero n_ri are skipped.
+ * If |n_rc| = 1, then the positions of the non-zero n_ri are
+ * collected first, such that the update of each other row
+ * only needs to visit those positions rather than the entire row.
  */
 int isl_tab_pivot(struct isl_tab *tab, int row, int col)
 {
 	int i, j;
 	int sgn;
 	int t;
+	int one;
+	int n_nz = 0;
+	int *nz = NULL;
 	isl_ctx *ctx;
 	struct isl_mat *mat = tab->mat;
 	struct isl_tab_var *var;
@@ -1099,6 +1342,9 @@ int isl_tab_pivot(struct isl_tab *tab, int row, int col)
 	ctx = isl_tab_get_ctx(tab);
 	if (isl_ctx_next_operation(ctx) < 0)
 		return -1;
+	ctx->stats->pivots++;
+	if (is_degenerate_row(tab, row))
+		ctx->stats->degenerate_pivots++;
 
 	isl_int_swap(mat->row[row][0], mat->row[row][off + col]);
 	sgn = isl_int_sgn(mat->row[row][0]);
@@ -1113,25 +1359,47 @@ int isl_tab_pivot(struct isl_tab *tab, int row, int col)
 		}
 	if (!isl_int_is_one(mat->row[row][0]))
 		isl_seq_normalize(mat->ctx, mat->row[row], off + tab->n_col);
+	one = isl_int_is_one(mat->row[row][0]);
+	if (one) {
+		nz = isl_alloc_array(ctx, int, off - 1 + tab->n_col);
+		if (!nz)
+			return -1;
+		for (j = 0; j < off - 1 + tab->n_col; ++j) {
+			if (j == off - 1 + col)
+				continue;
+			if (!isl_int_is_zero(mat->row[row][1 + j]))
+				nz[n_nz++] = 1 + j;
+		}
+	}
 	for (i = 0; i < tab->n_row; ++i) {
 		if (i == row)
 			continue;
 		if (isl_int_is_zero(mat->row[i][off + col]))
 			continue;
-		isl_int_mul(mat->row[i][0], mat->row[i][0], mat->row[row][0]);
-		for (j = 0; j < off - 1 + tab->n_col; ++j) {
-			if (j == off - 1 + col)
-				continue;
-			isl_int_mul(mat->row[i][1 + j],
-				    mat->row[i][1 + j], mat->row[row][0]);
-			isl_int_addmul(mat->row[i][1 + j],
+		if (one)
+			for (j = 0; j < n_nz; ++j)
+				isl_int_addmul(mat->row[i][nz[j]],
+				    mat->row[i][off + col], mat->row[row][nz[j]]);
+		else {
+			isl_int_mul(mat->row[i][0],
+				    mat->row[i][0], mat->row[row][0]);
+			for (j = 0; j < off - 1 + tab->n_col; ++j) {
+				if (j == off - 1 + col)
+					continue;
+				isl_int_mul(mat->row[i][1 + j],
+					    mat->row[i][1 + j], mat->row[row][0]);
+				if (isl_int_is_zero(mat->row[row][1 + j]))
+					continue;
+				isl_int_addmul(mat->row[i][1 + j],
 				    mat->row[i][off + col], mat->row[row][1 + j]);
+			}
 		}
 		isl_int_mul(mat->row[i][off + col],
 			    mat->row[i][off + col], mat->row[row][off + col]);
 		if (!isl_int_is_one(mat->row[i][0]))
 			isl_seq_normalize(mat->ctx, mat->row[i], off + tab->n_col);
 	}
+	free(nz);
 	t = tab->row_var[row];
 	tab->row_var[row] = tab->col_var[col];
 	tab->col_var[col] = t;
@@ -1293,6 +1561,7 @@ static int restore_row(struct isl_tab *tab, struct isl_tab_var *var)
 		find_pivot(tab, var, var, 1, &row, &col);
 		if (row == -1)
 			break;
+		tab->mat->ctx->stats->primal_pivots++;
 		if (isl_tab_pivot(tab, row, col) < 0)
 			return -2;
 		if (!var->is_row) /* manifestly unbounded */
@@ -1301,6 +1570,92 @@ static int restore_row(struct isl_tab *tab, struct isl_tab_var *var)
 	return row_sgn(tab, var->index);
 }
 
+/* Return the first non-redundant row of "tab" that corresponds
+ * to a non-negative variable with a negative sample value,
+ * where the rows are ordered by the variables that they represent.
+ * Return -1 if there is no such row.
+ * "tab" is assumed not to have a big parameter.
+ */
+static int first_neg_row(struct isl_tab *tab)
+{
+	int i, row = -1;
+
+	for (i = tab->n_redundant; i < tab->n_row; ++i) {
+		if (!isl_tab_var_from_row(tab, i)->is_nonneg)
+			continue;
+		if (!isl_int_is_neg(tab->mat->row[i][1]))
+			continue;
+		if (row < 0 || tab->row_var[i] < tab->row_var[row])
+			row = i;
+	}
+	return row;
+}
+
+/* Return a column that can be used to increase the value
+ * of row "row" of "tab", i.e., a column with a positive coefficient
+ * or a column of a variable that may attain negative values
+ * with a non-zero coefficient.
+ * Among these columns, the one with the first variable is selected.
+ * Return -1 if there is no such column.
+ */
+static int dual_pivot_col(struct isl_tab *tab, int row)
+{
+	int j, col = -1;
+	isl_int *tr;
+
+	tr = tab->mat->row[row] + 2 + tab->M;
+	for (j = tab->n_dead; j < tab->n_col; ++j) {
+		if (isl_int_is_zero(tr[j]))
+			continue;
+		if (isl_int_is_neg(tr[j]) && var_from_col(tab, j)->is_nonneg)
+			continue;
+		if (col < 0 || tab->col_var[j] < tab->col_var[col])
+			col = j;
+	}
+	return col;
+}
+
+/* Perform dual simplex pivots until all non-negative row variables
+ * of "tab" have a non-negative sample value, where "var" is
+ * the only row variable that is known to have a negative sample value
+ * at the start.
+ * Since the tableau has no objective function, every basis is
+ * dual feasible and each violated row can be pivoted out of the basis
+ * without a ratio test.  The selection of the first row and column
+ * (in terms of the variables) prevents cycling.
+ * Return the sign of the sample value of "var" after the pivots,
+ * 1 if "var" has been moved to a column, -1 if some row turns out
+ * to be infeasible or -2 on error.
+ */
+static int restore_row_dual(struct isl_tab *tab, struct isl_tab_var *var)
+{
+	int row, col;
+
+	while ((row = first_neg_row(tab)) >= 0) {
+		col = dual_pivot_col(tab, row);
+		if (col < 0)
+			return -1;
+		tab->mat->ctx->stats->dual_pivots++;
+		if (isl_tab_pivot(tab, row, col) < 0)
+			return -2;
+	}
+	if (!var->is_row)
+		return 1;
+	return row_sgn(tab, var->index);
+}
+
+/* Should a violated constraint that is added to "tab" be resolved
+ * using dual simplex pivots (restore_row_dual)?
+ * This is only supported on feasible tableaus without a big parameter
+ * and without row signs.
+ */
+static int use_dual_restore(struct isl_tab *tab)
+{
+	if (!tab->mat->ctx->opt->tab_dual_simplex)
+		return 0;
+	return !tab->M && !tab->row_sign && !tab->empty;
+}
+
 /* Perform pivots until we are sure that the row variable "var"
  * can attain non-negative values.  After return from this
  * function, "var" is still a row variable, but its sample
@@ -1806,7 +2161,10 @@ int isl_tab_add_ineq(struct isl_tab *tab, isl_int *ineq)
 		return 0;
 	}
 
-	sgn = restore_row(tab, &tab->con[r]);
+	if (use_dual_restore(tab))
+		sgn = restore_row_dual(tab, &tab->con[r]);
+	else
+		sgn = restore_row(tab, &tab->con[r]);
 	if (sgn < -1)
 		return -1;
 	if (sgn < 0)
@@ -2202,17 +2560,16 @@ int isl_tab_add_div(struct isl_tab *tab, __isl_keep isl_vec *div,
  * in its bmap field.  This field is initialized from a copy of "bmap",
  * so we need to make sure that all constraints in "bmap" also appear
  * in the constructed tab.
+ * "n_row" is the number of rows (and constraints) for which
+ * room is reserved in the tableau.
  */
-__isl_give struct isl_tab *isl_tab_from_basic_map(
-	__isl_keep isl_basic_map *bmap, int track)
+static __isl_give struct isl_tab *tab_from_basic_map(
+	__isl_keep isl_basic_map *bmap, int track, unsigned n_row)
 {
 	int i;
 	struct isl_tab *tab;
 
-	if (!bmap)
-		return NULL;
-	tab = isl_tab_alloc(bmap->ctx,
-			    isl_basic_map_total_dim(bmap) + bmap->n_ineq + 1,
+	tab = isl_tab_alloc(bmap->ctx, n_row,
 			    isl_basic_map_total_dim(bmap), 0);
 	if (!tab)
 		return NULL;
@@ -2243,6 +2600,70 @@ error:
 	return NULL;
 }
 
+/* Construct a tableau from "bmap" (see tab_from_basic_map),
+ * reporting the construction to the trace callback, if any.
+ */
+__isl_give struct isl_tab *isl_tab_from_basic_map(
+	__isl_keep isl_basic_map *bmap, int track)
+{
+	struct isl_tab *tab;
+
+	if (!bmap)
+		return NULL;
+
+	isl_trace_begin(bmap->ctx, "tableau construction",
+		"\"dim\": %d, \"n_eq\": %d, \"n_ineq\": %d",
+		isl_basic_map_total_dim(bmap), bmap->n_eq, bmap->n_ineq);
+	tab = tab_from_basic_map(bmap, track,
+			    isl_basic_map_total_dim(bmap) + bmap->n_ineq + 1);
+	isl_trace_end(bmap->ctx, "tableau construction");
+
+	return tab;
+}
+
+/* Construct a lean tableau from "bmap" for pure LP and feasibility
+ * queries, i.e., a tableau that does not track "bmap" and
+ * on which isl_tab_init_samples is not called.
+ * Only room for the constraints of "bmap" and a single extra constraint,
+ * e.g., the objective function added by isl_tab_min, is reserved.
+ * Every equality constraint in "bmap" takes up at most one row,
+ * either the row of the equality itself or that of the variable
+ * that gets eliminated by it.
+ * Any further constraints need to be reserved using isl_tab_extend_cons.
+ * As for any tableau, undo records are only allocated
+ * after a snapshot has been taken.
+ *
+ * If the tab_lean option is not set, then room is reserved
+ * as in isl_tab_from_basic_map instead.
+ */
+__isl_give struct isl_tab *isl_tab_lean_from_basic_map(
+	__isl_keep isl_basic_map *bmap)
+{
+	struct isl_tab *tab;
+	unsigned n_row;
+
+	if (!bmap)
+		return NULL;
+
+	if (bmap->ctx->opt->tab_lean)
+		n_row = bmap->n_eq + bmap->n_ineq + 1;
+	else
+		n_row = isl_basic_map_total_dim(bmap) + bmap->n_ineq + 1;
+	isl_trace_begin(bmap->ctx, "tableau construction",
+		"\"dim\": %d, \"n_eq\": %d, \"n_ineq\": %d",
+		isl_basic_map_total_dim(bmap), bmap->n_eq, bmap->n_ineq);
+	tab = tab_from_basic_map(bmap, 0, n_row);
+	isl_trace_end(bmap->ctx, "tableau construction");
+
+	return tab;
+}
+
+__isl_give struct isl_tab *isl_tab_lean_from_basic_set(
+	__isl_keep isl_basic_set *bset)
+{
+	return isl_tab_lean_from_basic_map(bset);
+}
+
 __isl_give struct isl_tab *isl_tab_from_basic_set(
 	__isl_keep isl_basic_set *bset, int track)
 {
@@ -2836,6 +3257,124 @@ static int con_is_redundant(struct isl_tab *tab, struct isl_tab_var *var)
 	}
 }
 
+/* Consider the ray that starts at the current sample value and
+ * that moves the column variable "col" in the direction "sgn",
+ * keeping all other column variables fixed.
+ * If some point on this ray violates exactly one of the non-negative
+ * variables by the amount required by con_is_redundant, i.e.,
+ * a negative value for rational tableaus and a value of at most -1
+ * for integer tableaus, and if all the other non-redundant
+ * non-negative variables remain non-negative, then the violated
+ * variable is irredundant.  If this variable is still marked,
+ * then it is unmarked and 1 is returned.  Otherwise, 0 is returned.
+ *
+ * The non-negative rows that decrease along the ray are the rows
+ * with a coefficient of sign -sgn in column "col".  The ray leaves
+ * the region where such a row is non-negative at the ratio
+ * of its constant term and the absolute value of this coefficient.
+ * Let r1 be the row with the smallest ratio and r2 the row
+ * with the next smallest ratio.
+ * If the column variable itself is non-negative and moves down,
+ * then it becomes negative before any of the rows and it is
+ * the only violated variable as long as the step is at most
+ * the ratio of r1.  Otherwise, r1 is the only violated variable
+ * up to the ratio of r2.
+ * Since rows that represent equalities cannot be violated at all,
+ * we give up as soon as we find one that changes along the ray.
+ */
+static int witness_irredundant(struct isl_tab *tab, int col, int sgn,
+	isl_int t, isl_int u)
+{
+	int i, r1, r2;
+	unsigned off = 2 + tab->M;
+	struct isl_tab_var *var;
+
+	r1 = r2 = -1;
+	for (i = tab->n_redundant; i < tab->n_row; ++i) {
+		var = isl_tab_var_from_row(tab, i);
+		if (isl_int_is_zero(tab->mat->row[i][off + col]))
+			continue;
+		if (var->is_zero)
+			return 0;
+		if (!var->is_nonneg)
+			continue;
+		if (sgn * isl_int_sgn(tab->mat->row[i][off + col]) >= 0)
+			continue;
+		if (r1 < 0 || sgn * row_cmp(tab, r1, i, col, t) < 0) {
+			r2 = r1;
+			r1 = i;
+		} else if (r2 < 0 || sgn * row_cmp(tab, r2, i, col, t) < 0)
+			r2 = i;
+	}
+
+	var = var_from_col(tab, col);
+	if (sgn < 0 && var->is_nonneg) {
+		if (!var->marked)
+			return 0;
+		if (r1 >= 0 && tab->rational &&
+		    isl_int_is_zero(tab->mat->row[r1][1]))
+			return 0;
+		if (r1 >= 0 && !tab->rational &&
+		    isl_int_abs_lt(tab->mat->row[r1][1],
+				   tab->mat->row[r1][off + col]))
+			return 0;
+		var->marked = 0;
+		return 1;
+	}
+
+	if (r1 < 0)
+		return 0;
+	var = isl_tab_var_from_row(tab, r1);
+	if (!var->marked)
+		return 0;
+	if (r2 >= 0 && tab->rational &&
+	    sgn * row_cmp(tab, r2, r1, col, t) >= 0)
+		return 0;
+	if (r2 >= 0 && !tab->rational) {
+		isl_int_add(t, tab->mat->row[r1][1], tab->mat->row[r1][0]);
+		isl_int_abs(u, tab->mat->row[r2][off + col]);
+		isl_int_mul(t, t, u);
+		isl_int_abs(u, tab->mat->row[r1][off + col]);
+		isl_int_mul(u, u, tab->mat->row[r2][1]);
+		if (isl_int_gt(t, u))
+			return 0;
+	}
+	var->marked = 0;
+	return 1;
+}
+
+/* Unmark all marked variables that can be shown to be irredundant
+ * using the points on the rays of witness_irredundant, i.e.,
+ * the rays that start from the current sample value and
+ * move a single column variable in either direction.
+ * Each ray can prove the irredundancy of at most one variable,
+ * but together they can prove the irredundancy of many variables
+ * with a single pass over the tableau, without any pivoting.
+ * Return the number of variables that were unmarked.
+ *
+ * The tableau may not involve a big parameter.
+ */
+static int unmark_witnessed_irredundant(struct isl_tab *tab)
+{
+	int j, n = 0;
+	isl_int t, u;
+
+	if (tab->M)
+		return 0;
+
+	isl_int_init(t);
+	isl_int_init(u);
+	for (j = tab->n_dead; j < tab->n_col; ++j) {
+		n += witness_irredundant(tab, j, 1, t, u);
+		n += witness_irredundant(tab, j, -1, t, u);
+	}
+	isl_int_clear(t);
+	isl_int_clear(u);
+
+	tab->mat->ctx->stats->batch_irredundant += n;
+	return n;
+}
+
 /* Check for (near) redundant constraints.
  * A constraint is redundant if it is non-negative and if
  * its minimal value (temporarily ignoring the non-negativity) is either
@@ -2848,8 +3387,13 @@ static int con_is_redundant(struct isl_tab *tab, struct isl_tab_var *var)
  * any values smaller than zero or at most negative one.
  * If not, we mark the row as being redundant (assuming it hasn't
  * been detected as being obviously redundant in the mean time).
+ *
+ * If "batch" is set, then before each such check, we first unmark
+ * those variables that can be shown to be irredundant using cheap
+ * witnesses around the current sample value.  Since each check moves
+ * the sample value, this is repeated after each check.
  */
-int isl_tab_detect_redundant(struct isl_tab *tab)
+static int detect_redundant(struct isl_tab *tab, int batch)
 {
 	int i;
 	unsigned n_marked;
@@ -2878,6 +3422,10 @@ int isl_tab_detect_redundant(struct isl_tab *tab)
 	while (n_marked) {
 		struct isl_tab_var *var;
 		int red;
+		if (batch)
+			n_marked -= unmark_witnessed_irredundant(tab);
+		if (!n_marked)
+			break;
 		for (i = tab->n_redundant; i < tab->n_row; ++i) {
 			var = isl_tab_var_from_row(tab, i);
 			if (var->marked)
@@ -2894,6 +3442,7 @@ int isl_tab_detect_redundant(struct isl_tab *tab)
 		}
 		var->marked = 0;
 		n_marked--;
+		tab->mat->ctx->stats->redundancy_lps++;
 		red = con_is_redundant(tab, var);
 		if (red < 0)
 			return -1;
@@ -2914,6 +3463,36 @@ int isl_tab_detect_redundant(struct isl_tab *tab)
 	return 0;
 }
 
+int isl_tab_detect_redundant(struct isl_tab *tab)
+{
+	return detect_redundant(tab, 0);
+}
+
+/* Check for (near) redundant constraints, as in isl_tab_detect_redundant,
+ * but first try and show that many constraints are irredundant
+ * at once (see unmark_witnessed_irredundant), if the tab_batch_redundant
+ * option is set and if "tab" has at least tab_batch_redundant_min
+ * constraints.
+ * For integer tableaus or in the presence of implicit equalities,
+ * the set of constraints that is found to be redundant may depend
+ * on the order in which the constraints are considered, and
+ * in particular on whether some of them are skipped.
+ * The result is then equivalent, but not necessarily identical,
+ * to that of isl_tab_detect_redundant.
+ * Smaller tableaus are therefore handled by isl_tab_detect_redundant
+ * such that their results are not affected.
+ */
+int isl_tab_detect_redundant_batch(struct isl_tab *tab)
+{
+	struct isl_options *opt;
+
+	if (!tab)
+		return -1;
+	opt = tab->mat->ctx->opt;
+	return detect_redundant(tab, opt->tab_batch_redundant &&
+				tab->n_con >= opt->tab_batch_redundant_min);
+}
+
 int isl_tab_is_equality(struct isl_tab *tab, int con)
 {
 	int row;
@@ -3279,7 +3858,7 @@ int isl_tab_rollback(struct isl_tab *tab, struct isl_tab_undo *snap)
 			tab->in_undo = 0;
 			return -1;
 		}
-		free_undo_record(undo);
+		free_undo_record(tab, undo);
 	}
 	tab->in_undo = 0;
 	tab->top = undo;
@@ -121,8 +121,17 @@ struct isl_tab_undo {
  * out is removed.  These samples are only maintained for the context
  * tableau while solving PILP problems.
  *
+ * "basis", if not NULL, is the basis used by isl_tab_sample.
+ * If "basis_width" is not NULL, then it contains the width of
+ * the tableau in the directions of "basis" right after they were
+ * last reduced (zero if they were not), such that the basis can be
+ * reused by a subsequent call to isl_tab_sample.
+ *
  * If "preserve" is set, then we want to keep all constraints in the
  * tableau, even if they turn out to be redundant.
+ *
+ * "undo_pool" is a list of undo records that have been popped
+ * from the undo stack and that can be reused by subsequent pushes.
  */
 enum isl_tab_row_sign {
 	isl_tab_row_unknown = 0,
@@ -153,6 +162,7 @@ struct isl_tab {
 
 	struct isl_tab_undo bottom;
 	struct isl_tab_undo *top;
+	struct isl_tab_undo *undo_pool;
 
 	struct isl_vec *dual;
 	struct isl_basic_map *bmap;
@@ -165,6 +175,7 @@ struct isl_tab {
 	int n_zero;
 	int n_unbounded;
 	struct isl_mat *basis;
+	struct isl_vec *basis_width;
 
 	int (*conflict)(int con, void *user);
 	void *conflict_user;
@@ -182,6 +193,7 @@ struct isl_tab {
 struct isl_tab *isl_tab_alloc(struct isl_ctx *ctx,
 	unsigned n_row, unsigned n_var, unsigned M);
 void isl_tab_free(struct isl_tab *tab);
+void isl_tab_clear_free_list(isl_ctx *ctx);
 
 isl_ctx *isl_tab_get_ctx(struct isl_tab *tab);
 
@@ -189,6 +201,10 @@ __isl_give struct isl_tab *isl_tab_from_basic_map(
 	__isl_keep isl_basic_map *bmap, int track);
 __isl_give struct isl_tab *isl_tab_from_basic_set(
 	__isl_keep isl_basic_set *bset, int track);
+__isl_give struct isl_tab *isl_tab_lean_from_basic_map(
+	__isl_keep isl_basic_map *bmap);
+__isl_give struct isl_tab *isl_tab_lean_from_basic_set(
+	__isl_keep isl_basic_set *bset);
 struct isl_tab *isl_tab_from_recession_cone(struct isl_basic_set *bset,
 	int parametric);
 int isl_tab_cone_is_bounded(struct isl_tab *tab);
@@ -200,6 +216,7 @@ int isl_tab_detect_implicit_equalities(struct isl_tab *tab) WARN_UNUSED;
 __isl_give isl_basic_map *isl_tab_make_equalities_explicit(struct isl_tab *tab,
 	__isl_take isl_basic_map *bmap);
 int isl_tab_detect_redundant(struct isl_tab *tab) WARN_UNUSED;
+int isl_tab_detect_redundant_batch(struct isl_tab *tab) WARN_UNUSED;
 #define ISL_TAB_SAVE_DUAL	(1 << 0)
 enum isl_lp_result isl_tab_min(struct isl_tab *tab,
 	isl_int *f, isl_int denom, isl_int *opt, isl_int *opt_denom,
@@ -247,6 +264,11 @@ struct isl_map *isl_tab_basic_map_partial_lexopt(
 __isl_give isl_pw_multi_aff *isl_basic_map_partial_lexopt_pw_multi_aff(
 	__isl_take isl_basic_map *bmap, __isl_take isl_basic_set *dom,
 	__isl_give isl_set **empty, int max);
+int isl_basic_map_foreach_partial_lexopt_multi_aff(
+	__isl_keep isl_basic_map *bmap, __isl_keep isl_basic_set *dom, int max,
+	int (*fn)(__isl_take isl_basic_set *dom,
+		  __isl_take isl_multi_aff *maff, void *user),
+	void *user);
 
 /* An isl_region represents a sequence of consecutive variables.
  * pos is the location (starting at 0) of the first variable in the sequence.
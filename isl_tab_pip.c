@@ -19,6 +19,7 @@
 #include <isl_vec_private.h>
 #include <isl_aff_private.h>
 #include <isl_options_private.h>
+#include <isl_profile.h>
 #include <isl_config.h>
 
 /*
@@ -93,8 +94,12 @@ struct isl_context_op {
 	int (*add_div)(struct isl_context *context, struct isl_vec *div);
 	int (*detect_equalities)(struct isl_context *context,
 			struct isl_tab *tab);
-	/* return row index of "best" split */
-	int (*best_split)(struct isl_context *context, struct isl_tab *tab);
+	/* return row index of "best" split;
+	 * if pos is not NULL, mark the rows that are non-negative
+	 * in the non-negative part of this split.
+	 */
+	int (*best_split)(struct isl_context *context, struct isl_tab *tab,
+			int *pos);
 	/* check if context has already been determined to be empty */
 	int (*is_empty)(struct isl_context *context);
 	/* check if context is still usable */
@@ -164,6 +169,7 @@ struct isl_sol {
 	int level;
 	int max;
 	int n_out;
+	struct isl_mat *shift;
 	struct isl_context *context;
 	struct isl_partial_sol *partial;
 	void (*add)(struct isl_sol *sol,
@@ -184,6 +190,7 @@ static void sol_free(struct isl_sol *sol)
 		isl_mat_free(partial->M);
 		free(partial);
 	}
+	isl_mat_free(sol->shift);
 	sol->free(sol);
 }
 
@@ -397,6 +404,47 @@ static void scale_rows(struct isl_mat *mat, isl_int m, int n_row)
 		isl_seq_scale(mat->row[i], mat->row[i], m, mat->n_col);
 }
 
+/* Given a matrix "mat" describing the shifted output variables z
+ * in terms of the variables of the context, as constructed by sol_add,
+ * transform it to a matrix describing the original output variables x.
+ * Row i of "shift" contains the shift b_i of the output variable x_i
+ * (see shift_outputs), i.e.,
+ *
+ *	x_i = z_i + b_i(p, x_0, ..., x_{i-1})
+ *
+ * with p the parameters and input dimensions.
+ * Since b_i only refers to earlier output variables, the rows
+ * can be updated in order.  Note that the rows of "mat"
+ * have a common denominator, stored in the first row.
+ */
+static __isl_give isl_mat *unshift_sol(__isl_keep isl_mat *shift,
+	__isl_take isl_mat *mat)
+{
+	int i, j, k;
+	unsigned n_param;
+
+	if (!mat)
+		return NULL;
+
+	n_param = shift->n_col - 1 - shift->n_row;
+	for (i = 0; i < shift->n_row; ++i) {
+		isl_int *row = mat->row[1 + i];
+
+		for (j = 0; j < 1 + n_param; ++j)
+			isl_int_addmul(row[j], mat->row[0][0], shift->row[i][j]);
+		for (j = 0; j < i; ++j) {
+			isl_int *c = &shift->row[i][1 + n_param + j];
+
+			if (isl_int_is_zero(*c))
+				continue;
+			for (k = 0; k < mat->n_col; ++k)
+				isl_int_addmul(row[k], *c, mat->row[1 + j][k]);
+		}
+	}
+
+	return mat;
+}
+
 /* Add the solution identified by the tableau and the context tableau.
  *
  * The layout of the variables is as follows.
@@ -445,6 +493,12 @@ static void scale_rows(struct isl_mat *mat, isl_int m, int n_row)
  * with a d = m, the (updated) common denominator of the matrix.
  * In case of maximization, the row will be
  *	-a c - a e(y)
+ *
+ * If the output variables were shifted to avoid the big parameter
+ * (see shift_outputs), then the tableau does not contain M and
+ * the rows computed above describe the shifted variables
+ * rather than the output variables.  The shift is undone
+ * by unshift_sol.
  */
 static void sol_add(struct isl_sol *sol, struct isl_tab *tab)
 {
@@ -525,6 +579,8 @@ static void sol_add(struct isl_sol *sol, struct isl_tab *tab)
 
 	isl_int_clear(m);
 
+	if (sol->shift)
+		mat = unshift_sol(sol->shift, mat);
 	sol_push_sol(sol, bset, mat);
 	return;
 error2:
@@ -1772,10 +1828,38 @@ static int sample_is_finite(struct isl_tab *tab)
 	return 1;
 }
 
+/* In the adaptive context mode, an integer feasibility check
+ * in a lexmin context that requires at least ADAPTIVE_HARD_CUTS cuts
+ * is considered to be hard.  After ADAPTIVE_MAX_HARD such checks,
+ * later computations in the same isl_ctx use a gbr context instead.
+ */
+#define ADAPTIVE_HARD_CUTS	8
+#define ADAPTIVE_MAX_HARD	4
+
+/* Record that "n_cut" cuts were needed to decide the integer
+ * feasibility of a lexmin context tableau and switch to gbr contexts
+ * if this happens too often in the adaptive context mode.
+ */
+static void adaptive_record_cuts(isl_ctx *ctx, int n_cut)
+{
+	if (ctx->opt->context != ISL_CONTEXT_ADAPTIVE)
+		return;
+	if (n_cut < ADAPTIVE_HARD_CUTS)
+		return;
+	ctx->stats->pip_hard_lexmin_checks++;
+	ctx->pip_hard_lexmin++;
+	if (ctx->pip_adaptive_gbr || ctx->pip_hard_lexmin < ADAPTIVE_MAX_HARD)
+		return;
+	ctx->pip_adaptive_gbr = 1;
+	ctx->stats->pip_context_switches++;
+}
+
 /* Check if the context tableau of sol has any integer points.
  * Leave tab in empty state if no integer point can be found.
  * If an integer point can be found and if moreover it is finite,
  * then it is added to the list of sample values.
+ * The number of cuts that were needed is passed
+ * to adaptive_record_cuts.
  *
  * This function is only called when none of the currently active sample
  * values satisfies the most recently added constraint.
@@ -1783,10 +1867,14 @@ static int sample_is_finite(struct isl_tab *tab)
 static struct isl_tab *check_integer_feasible(struct isl_tab *tab)
 {
 	struct isl_tab_undo *snap;
+	isl_ctx *ctx;
+	int n_con;
 
 	if (!tab)
 		return NULL;
 
+	ctx = tab->mat->ctx;
+	n_con = tab->n_con;
 	snap = isl_tab_snap(tab);
 	if (isl_tab_push_basis(tab) < 0)
 		goto error;
@@ -1794,6 +1882,7 @@ static struct isl_tab *check_integer_feasible(struct isl_tab *tab)
 	tab = cut_to_integer_lexmin(tab, CUT_ALL);
 	if (!tab)
 		goto error;
+	adaptive_record_cuts(ctx, tab->n_con - n_con);
 
 	if (!tab->empty && sample_is_finite(tab)) {
 		struct isl_vec *sample;
@@ -2158,17 +2247,30 @@ error:
  * to some arbitrary value (0) anyway.  Without this redundant initialization
  * valgrind may warn about uninitialized memory accesses when isl
  * is compiled with some versions of gcc.
+ *
+ * If "pos" is not NULL, then the rows that are made redundant
+ * by the selected row are marked in "pos".  These rows are known
+ * to be non-negative in the part of the context where the selected
+ * row is non-negative, so that the caller does not need to determine
+ * their signs again in that part.
  */
-static int best_split(struct isl_tab *tab, struct isl_tab *context_tab)
+static int best_split(struct isl_tab *tab, struct isl_tab *context_tab,
+	int *pos)
 {
 	struct isl_tab_undo *snap;
 	int split;
 	int row;
 	int best = -1;
 	int best_r = 0;
+	int *cur = NULL;
 
 	if (isl_tab_extend_cons(context_tab, 2) < 0)
 		return -1;
+	if (pos) {
+		cur = isl_calloc_array(tab->mat->ctx, int, tab->n_row);
+		if (tab->n_row && !cur)
+			return -1;
+	}
 
 	snap = isl_tab_snap(context_tab);
 
@@ -2177,6 +2279,7 @@ static int best_split(struct isl_tab *tab, struct isl_tab *context_tab)
 		struct isl_vec *ineq = NULL;
 		int r = 0;
 		int ok;
+		int redundant;
 
 		if (!isl_tab_var_from_row(tab, split)->is_nonneg)
 			continue;
@@ -2185,14 +2288,17 @@ static int best_split(struct isl_tab *tab, struct isl_tab *context_tab)
 
 		ineq = get_row_parameter_ineq(tab, split);
 		if (!ineq)
-			return -1;
+			goto error;
 		ok = isl_tab_add_ineq(context_tab, ineq->el) >= 0;
 		isl_vec_free(ineq);
 		if (!ok)
-			return -1;
+			goto error;
 
 		snap2 = isl_tab_snap(context_tab);
 
+		if (cur)
+			for (row = 0; row < tab->n_row; ++row)
+				cur[row] = 0;
 		for (row = tab->n_redundant; row < tab->n_row; ++row) {
 			struct isl_tab_var *var;
 
@@ -2205,27 +2311,37 @@ static int best_split(struct isl_tab *tab, struct isl_tab *context_tab)
 
 			ineq = get_row_parameter_ineq(tab, row);
 			if (!ineq)
-				return -1;
+				goto error;
 			ok = isl_tab_add_ineq(context_tab, ineq->el) >= 0;
 			isl_vec_free(ineq);
 			if (!ok)
-				return -1;
+				goto error;
 			var = &context_tab->con[context_tab->n_con - 1];
-			if (!context_tab->empty &&
-			    !isl_tab_min_at_most_neg_one(context_tab, var))
+			redundant = !context_tab->empty &&
+			    !isl_tab_min_at_most_neg_one(context_tab, var);
+			if (redundant)
 				r++;
+			if (cur)
+				cur[row] = redundant;
 			if (isl_tab_rollback(context_tab, snap2) < 0)
-				return -1;
+				goto error;
 		}
 		if (best == -1 || r > best_r) {
 			best = split;
 			best_r = r;
+			if (cur)
+				for (row = 0; row < tab->n_row; ++row)
+					pos[row] = cur[row];
 		}
 		if (isl_tab_rollback(context_tab, snap) < 0)
-			return -1;
+			goto error;
 	}
 
+	free(cur);
 	return best;
+error:
+	free(cur);
+	return -1;
 }
 
 static struct isl_basic_set *context_lex_peek_basic_set(
@@ -2405,7 +2521,7 @@ static int context_lex_detect_equalities(struct isl_context *context,
 }
 
 static int context_lex_best_split(struct isl_context *context,
-		struct isl_tab *tab)
+		struct isl_tab *tab, int *pos)
 {
 	struct isl_context_lex *clex = (struct isl_context_lex *)context;
 	struct isl_tab_undo *snap;
@@ -2414,7 +2530,7 @@ static int context_lex_best_split(struct isl_context *context,
 	snap = isl_tab_snap(clex->tab);
 	if (isl_tab_push_basis(clex->tab) < 0)
 		return -1;
-	r = best_split(tab, clex->tab);
+	r = best_split(tab, clex->tab, pos);
 
 	if (r >= 0 && isl_tab_rollback(clex->tab, snap) < 0)
 		return -1;
@@ -2781,6 +2897,8 @@ static struct isl_vec *gbr_get_sample(struct isl_context_gbr *cgbr)
 			if (cgbr->tab->basis->n_col != 1 + cgbr->tab->n_var) {
 				isl_mat_free(cgbr->tab->basis);
 				cgbr->tab->basis = NULL;
+				isl_vec_free(cgbr->tab->basis_width);
+				cgbr->tab->basis_width = NULL;
 			}
 			cgbr->tab->n_zero = 0;
 			cgbr->tab->n_unbounded = 0;
@@ -2991,12 +3109,67 @@ static enum isl_tab_row_sign context_gbr_ineq_sign(struct isl_context *context,
 /* Check whether "ineq" can be added to the tableau without rendering
  * it infeasible.
  */
+/* A snapshot of the tableaux of an isl_context_gbr.
+ * Each snapshot only records the current position in the undo log
+ * of the corresponding tableau, so that taking a snapshot
+ * takes constant time, while rolling back to a snapshot
+ * only needs to undo the changes that were performed since.
+ * "shifted_snap" and "cone_snap" are NULL if the corresponding
+ * tableau had not been constructed yet when the snapshot was taken.
+ */
+struct isl_gbr_tab_undo {
+	struct isl_tab_undo *tab_snap;
+	struct isl_tab_undo *shifted_snap;
+	struct isl_tab_undo *cone_snap;
+};
+
+/* Take a snapshot of the tableaux of "cgbr" and store it in "snap".
+ */
+static void gbr_snap(struct isl_context_gbr *cgbr,
+	struct isl_gbr_tab_undo *snap)
+{
+	snap->tab_snap = isl_tab_snap(cgbr->tab);
+	snap->shifted_snap = cgbr->shifted ? isl_tab_snap(cgbr->shifted) : NULL;
+	snap->cone_snap = cgbr->cone ? isl_tab_snap(cgbr->cone) : NULL;
+}
+
+/* Roll back the tableaux of "cgbr" to the snapshot "snap".
+ *
+ * The shifted and cone tableaux are constructed lazily from
+ * the current context.  If such a tableau was only constructed
+ * after the snapshot was taken, then it may involve constraints
+ * that were added since and it cannot be rolled back.
+ * It is therefore discarded instead.
+ */
+static int gbr_rollback(struct isl_context_gbr *cgbr,
+	struct isl_gbr_tab_undo *snap)
+{
+	if (isl_tab_rollback(cgbr->tab, snap->tab_snap) < 0)
+		return -1;
+
+	if (snap->shifted_snap) {
+		if (isl_tab_rollback(cgbr->shifted, snap->shifted_snap) < 0)
+			return -1;
+	} else if (cgbr->shifted) {
+		isl_tab_free(cgbr->shifted);
+		cgbr->shifted = NULL;
+	}
+
+	if (snap->cone_snap) {
+		if (isl_tab_rollback(cgbr->cone, snap->cone_snap) < 0)
+			return -1;
+	} else if (cgbr->cone) {
+		isl_tab_free(cgbr->cone);
+		cgbr->cone = NULL;
+	}
+
+	return 0;
+}
+
 static int context_gbr_test_ineq(struct isl_context *context, isl_int *ineq)
 {
 	struct isl_context_gbr *cgbr = (struct isl_context_gbr *)context;
-	struct isl_tab_undo *snap;
-	struct isl_tab_undo *shifted_snap = NULL;
-	struct isl_tab_undo *cone_snap = NULL;
+	struct isl_gbr_tab_undo snap;
 	int feasible;
 
 	if (!cgbr->tab)
@@ -3005,32 +3178,14 @@ static int context_gbr_test_ineq(struct isl_context *context, isl_int *ineq)
 	if (isl_tab_extend_cons(cgbr->tab, 1) < 0)
 		return -1;
 
-	snap = isl_tab_snap(cgbr->tab);
-	if (cgbr->shifted)
-		shifted_snap = isl_tab_snap(cgbr->shifted);
-	if (cgbr->cone)
-		cone_snap = isl_tab_snap(cgbr->cone);
+	gbr_snap(cgbr, &snap);
 	add_gbr_ineq(cgbr, ineq);
 	check_gbr_integer_feasible(cgbr);
 	if (!cgbr->tab)
 		return -1;
 	feasible = !cgbr->tab->empty;
-	if (isl_tab_rollback(cgbr->tab, snap) < 0)
+	if (gbr_rollback(cgbr, &snap) < 0)
 		return -1;
-	if (shifted_snap) {
-		if (isl_tab_rollback(cgbr->shifted, shifted_snap))
-			return -1;
-	} else if (cgbr->shifted) {
-		isl_tab_free(cgbr->shifted);
-		cgbr->shifted = NULL;
-	}
-	if (cone_snap) {
-		if (isl_tab_rollback(cgbr->cone, cone_snap))
-			return -1;
-	} else if (cgbr->cone) {
-		isl_tab_free(cgbr->cone);
-		cgbr->cone = NULL;
-	}
 
 	return feasible;
 }
@@ -3202,14 +3357,14 @@ static int context_gbr_add_div(struct isl_context *context, struct isl_vec *div)
 }
 
 static int context_gbr_best_split(struct isl_context *context,
-		struct isl_tab *tab)
+		struct isl_tab *tab, int *pos)
 {
 	struct isl_context_gbr *cgbr = (struct isl_context_gbr *)context;
 	struct isl_tab_undo *snap;
 	int r;
 
 	snap = isl_tab_snap(cgbr->tab);
-	r = best_split(tab, cgbr->tab);
+	r = best_split(tab, cgbr->tab, pos);
 
 	if (r >= 0 && isl_tab_rollback(cgbr->tab, snap) < 0)
 		return -1;
@@ -3225,12 +3380,6 @@ static int context_gbr_is_empty(struct isl_context *context)
 	return cgbr->tab->empty;
 }
 
-struct isl_gbr_tab_undo {
-	struct isl_tab_undo *tab_snap;
-	struct isl_tab_undo *shifted_snap;
-	struct isl_tab_undo *cone_snap;
-};
-
 static void *context_gbr_save(struct isl_context *context)
 {
 	struct isl_context_gbr *cgbr = (struct isl_context_gbr *)context;
@@ -3243,20 +3392,10 @@ static void *context_gbr_save(struct isl_context *context)
 	if (!snap)
 		return NULL;
 
-	snap->tab_snap = isl_tab_snap(cgbr->tab);
+	gbr_snap(cgbr, snap);
 	if (isl_tab_save_samples(cgbr->tab) < 0)
 		goto error;
 
-	if (cgbr->shifted)
-		snap->shifted_snap = isl_tab_snap(cgbr->shifted);
-	else
-		snap->shifted_snap = NULL;
-
-	if (cgbr->cone)
-		snap->cone_snap = isl_tab_snap(cgbr->cone);
-	else
-		snap->cone_snap = NULL;
-
 	return snap;
 error:
 	free(snap);
@@ -3269,26 +3408,8 @@ static void context_gbr_restore(struct isl_context *context, void *save)
 	struct isl_gbr_tab_undo *snap = (struct isl_gbr_tab_undo *)save;
 	if (!snap)
 		goto error;
-	if (isl_tab_rollback(cgbr->tab, snap->tab_snap) < 0) {
-		isl_tab_free(cgbr->tab);
-		cgbr->tab = NULL;
-	}
-
-	if (snap->shifted_snap) {
-		if (isl_tab_rollback(cgbr->shifted, snap->shifted_snap) < 0)
-			goto error;
-	} else if (cgbr->shifted) {
-		isl_tab_free(cgbr->shifted);
-		cgbr->shifted = NULL;
-	}
-
-	if (snap->cone_snap) {
-		if (isl_tab_rollback(cgbr->cone, snap->cone_snap) < 0)
-			goto error;
-	} else if (cgbr->cone) {
-		isl_tab_free(cgbr->cone);
-		cgbr->cone = NULL;
-	}
+	if (gbr_rollback(cgbr, snap) < 0)
+		goto error;
 
 	free(snap);
 
@@ -3375,12 +3496,23 @@ error:
 	return NULL;
 }
 
+/* Allocate a context for "dom" of the type specified by
+ * the context option.
+ * In the adaptive mode, a lexmin context is used, unless
+ * earlier lexmin contexts in the same isl_ctx have been found
+ * to require too many cuts.  See adaptive_record_cuts.
+ */
 static struct isl_context *isl_context_alloc(struct isl_basic_set *dom)
 {
+	int lexmin;
+
 	if (!dom)
 		return NULL;
 
-	if (dom->ctx->opt->context == ISL_CONTEXT_LEXMIN)
+	lexmin = dom->ctx->opt->context == ISL_CONTEXT_LEXMIN;
+	if (dom->ctx->opt->context == ISL_CONTEXT_ADAPTIVE)
+		lexmin = !dom->ctx->pip_adaptive_gbr;
+	if (lexmin)
 		return isl_context_lex_alloc(dom);
 	else
 		return isl_context_gbr_alloc(dom);
@@ -3610,6 +3742,28 @@ error:
 
 static void find_solutions(struct isl_sol *sol, struct isl_tab *tab);
 
+/* Set the signs of the rows of "tab" that are marked in "pos"
+ * (if not NULL) to "sgn".
+ * If "sgn" is isl_tab_row_pos, then these rows are known to be
+ * non-negative in the non-negative part of a split and
+ * their signs do not need to be determined again there.
+ */
+static void set_split_pos_signs(struct isl_tab *tab, int *pos,
+	enum isl_tab_row_sign sgn)
+{
+	int row;
+
+	if (!pos)
+		return;
+	for (row = tab->n_redundant; row < tab->n_row; ++row) {
+		if (!pos[row])
+			continue;
+		tab->row_sign[row] = sgn;
+		if (sgn == isl_tab_row_pos)
+			tab->mat->ctx->stats->pip_inherited_signs++;
+	}
+}
+
 /* Find solutions for values of the parameters that satisfy the given
  * inequality.
  *
@@ -3623,6 +3777,17 @@ static void find_solutions(struct isl_sol *sol, struct isl_tab *tab);
  * we would have to keep in mind that we need to save the row signs
  * and that we need to do this before saving the current basis
  * such that the basis has been restore before we restore the row signs.
+ *
+ * The two parts of a split are not handed to separate threads.
+ * The context tableau, including any integer divisions added to it
+ * so far, is shared by both parts and the partial solutions of
+ * both parts are merged through its undo stack (see sol_dec_level).
+ * Since a tableau cannot be imported into another isl_ctx, a worker
+ * would have to redo all pivots and cuts that lead up to the split
+ * from the original problem, while the merging would be lost.
+ * Independent problems are only handed to separate threads
+ * at the level of entire maps (see union_lexopt_threads) and
+ * of the basic maps of a map (see partial_lexopt_threads).
  */
 static void find_in_pos(struct isl_sol *sol, struct isl_tab *tab, isl_int *ineq)
 {
@@ -3814,14 +3979,25 @@ static void find_solutions(struct isl_sol *sol, struct isl_tab *tab)
 		if (row < tab->n_row)
 			continue;
 		if (split != -1) {
-			struct isl_vec *ineq;
-			if (n_split != 1)
-				split = context->op->best_split(context, tab);
-			if (split < 0)
-				goto error;
-			ineq = get_row_parameter_ineq(tab, split);
-			if (!ineq)
+			struct isl_vec *ineq = NULL;
+			int *pos = NULL;
+			if (n_split != 1) {
+				isl_ctx *ctx = tab->mat->ctx;
+				if (ctx->opt->pip_split_inherit) {
+					pos = isl_calloc_array(ctx, int,
+								tab->n_row);
+					if (!pos)
+						goto error;
+				}
+				split = context->op->best_split(context,
+								tab, pos);
+			}
+			if (split >= 0)
+				ineq = get_row_parameter_ineq(tab, split);
+			if (split < 0 || !ineq) {
+				free(pos);
 				goto error;
+			}
 			is_strict(ineq);
 			for (row = tab->n_redundant; row < tab->n_row; ++row) {
 				if (!isl_tab_var_from_row(tab, row)->is_nonneg)
@@ -3830,8 +4006,11 @@ static void find_solutions(struct isl_sol *sol, struct isl_tab *tab)
 					tab->row_sign[row] = isl_tab_row_unknown;
 			}
 			tab->row_sign[split] = isl_tab_row_pos;
+			set_split_pos_signs(tab, pos, isl_tab_row_pos);
 			sol_inc_level(sol);
 			find_in_pos(sol, tab, ineq->el);
+			set_split_pos_signs(tab, pos, isl_tab_row_unknown);
+			free(pos);
 			tab->row_sign[split] = isl_tab_row_neg;
 			row = split;
 			isl_seq_neg(ineq->el, ineq->el, ineq->size);
@@ -3935,12 +4114,18 @@ static int sol_has_mergeable_solutions(struct isl_sol *sol)
  */
 static void find_solutions_main(struct isl_sol *sol, struct isl_tab *tab)
 {
+	isl_ctx *ctx = NULL;
 	int row;
 	void *saved;
 
 	if (!tab)
 		goto error;
 
+	ctx = tab->mat->ctx;
+	isl_trace_begin(ctx, "PIP find_solutions",
+		"\"n_param\": %d, \"n_var\": %d, \"n_row\": %d",
+		tab->n_param, tab->n_var - tab->n_param - tab->n_div,
+		tab->n_row);
 	sol->level = 0;
 
 	for (row = tab->n_redundant; row < tab->n_row; ++row) {
@@ -3998,8 +4183,10 @@ static void find_solutions_main(struct isl_sol *sol, struct isl_tab *tab)
 	sol->level = 0;
 	sol_pop(sol);
 
+	isl_trace_end(ctx, "PIP find_solutions");
 	return;
 error:
+	isl_trace_end(ctx, "PIP find_solutions");
 	isl_tab_free(tab);
 	sol->error = 1;
 }
@@ -4080,12 +4267,154 @@ error:
 	return NULL;
 }
 
+/* Is "c" a constraint with a unit coefficient on the variable
+ * at position "pos" that does not involve any of the "n"
+ * variables that follow?
+ */
+static int is_unit_bound(isl_int *c, unsigned pos, unsigned n)
+{
+	if (!isl_int_is_one(c[pos]) && !isl_int_is_negone(c[pos]))
+		return 0;
+	return isl_seq_first_non_zero(c + pos + 1, n) == -1;
+}
+
+/* Look for a constraint of "bmap" that bounds the output variable
+ * at position "pos" from below (in case of minimization) or
+ * from above (in case of maximization) with a unit coefficient and
+ * that only involves the parameters, the input dimensions and
+ * earlier output variables.
+ * If there is such a constraint, then write it as
+ *
+ *	x_pos >= b(p, x_0, ..., x_{pos-1})
+ * or
+ *	x_pos <= b(p, x_0, ..., x_{pos-1})
+ *
+ * and store the coefficients of b in "bound".
+ * Return 1 if a bound was found and 0 otherwise.
+ */
+static int find_unit_bound(__isl_keep isl_basic_map *bmap, int pos, int max,
+	isl_int *bound)
+{
+	int i;
+	unsigned o_out, n_after;
+
+	o_out = 1 + isl_basic_map_dim(bmap, isl_dim_param) +
+		    isl_basic_map_dim(bmap, isl_dim_in);
+	n_after = isl_basic_map_dim(bmap, isl_dim_out) - 1 - pos + bmap->n_div;
+	for (i = 0; i < bmap->n_eq + bmap->n_ineq; ++i) {
+		isl_int *c;
+
+		c = i < bmap->n_eq ? bmap->eq[i] : bmap->ineq[i - bmap->n_eq];
+		if (!is_unit_bound(c, o_out + pos, n_after))
+			continue;
+		if (i >= bmap->n_eq && isl_int_is_one(c[o_out + pos]) == max)
+			continue;
+		if (isl_int_is_one(c[o_out + pos]))
+			isl_seq_neg(bound, c, o_out + pos);
+		else
+			isl_seq_cpy(bound, c, o_out + pos);
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Substitute
+ *
+ *	x_i = z_i + b_i(p, x_0, ..., x_{i-1})
+ *
+ * in the affine expression "c", with b_i described by row i of "shift".
+ * The output variables start at position "o_out".
+ * Since b_i only involves earlier output variables,
+ * the substitutions are performed from the last to the first
+ * output variable.
+ */
+static void shift_constraint(isl_int *c, unsigned o_out,
+	__isl_keep isl_mat *shift)
+{
+	int i, j;
+
+	for (i = shift->n_row - 1; i >= 0; --i) {
+		if (isl_int_is_zero(c[o_out + i]))
+			continue;
+		for (j = 0; j < o_out + i; ++j)
+			isl_int_addmul(c[j], c[o_out + i], shift->row[i][j]);
+	}
+}
+
+/* Try and rewrite "bmap" such that the lexicographic optimum
+ * can be computed without a big parameter.
+ *
+ * The big parameter is only needed to handle output variables
+ * that may attain negative values (or positive values in case
+ * of maximization).  If each output variable x_i has a lower
+ * (or upper) bound b_i with unit coefficient that only involves
+ * the parameters, the input dimensions and earlier output variables,
+ * then we can replace each x_i by
+ *
+ *	z_i = x_i - b_i(p, x_0, ..., x_{i-1})
+ *
+ * which is non-negative (or non-positive) and which preserves
+ * the lexicographic order.  This requires the basic map not to have
+ * any existentially quantified variables other than the integer
+ * divisions of the context "dom", since those would also need to be
+ * bounded.
+ * If the rewriting is possible, then the bounds are stored
+ * in *shift, for use by unshift_sol.  Otherwise, *shift is set to NULL
+ * and "bmap" is returned unchanged.
+ */
+static __isl_give isl_basic_map *shift_outputs(__isl_take isl_basic_map *bmap,
+	__isl_keep isl_basic_set *dom, int max, __isl_give isl_mat **shift)
+{
+	int i;
+	unsigned o_out, n_out;
+	isl_ctx *ctx;
+
+	*shift = NULL;
+	if (!bmap || !dom)
+		return bmap;
+	ctx = isl_basic_map_get_ctx(bmap);
+	if (!ctx->opt->pip_shift || bmap->n_div != dom->n_div)
+		return bmap;
+
+	o_out = 1 + isl_basic_map_dim(bmap, isl_dim_param) +
+		    isl_basic_map_dim(bmap, isl_dim_in);
+	n_out = isl_basic_map_dim(bmap, isl_dim_out);
+	*shift = isl_mat_alloc(ctx, n_out, o_out + n_out);
+	if (!*shift)
+		return isl_basic_map_free(bmap);
+	for (i = 0; i < n_out; ++i) {
+		isl_seq_clr((*shift)->row[i], o_out + n_out);
+		if (find_unit_bound(bmap, i, max, (*shift)->row[i]))
+			continue;
+		*shift = isl_mat_free(*shift);
+		return bmap;
+	}
+
+	bmap = isl_basic_map_cow(bmap);
+	if (!bmap)
+		return NULL;
+	for (i = 0; i < bmap->n_eq; ++i)
+		shift_constraint(bmap->eq[i], o_out, *shift);
+	for (i = 0; i < bmap->n_ineq; ++i)
+		shift_constraint(bmap->ineq[i], o_out, *shift);
+	for (i = 0; i < bmap->n_div; ++i)
+		if (!isl_int_is_zero(bmap->div[i][0]))
+			shift_constraint(bmap->div[i] + 1, o_out, *shift);
+	ISL_F_CLR(bmap, ISL_BASIC_MAP_NORMALIZED);
+	ctx->stats->pip_shifted++;
+
+	return bmap;
+}
+
 /* Base case of isl_tab_basic_map_partial_lexopt, after removing
  * some obvious symmetries.
  *
  * We make sure the divs in the domain are properly ordered,
  * because they will be added one by one in the given order
  * during the construction of the solution map.
+ * If possible, the output variables are shifted such that
+ * the main tableau does not need a big parameter.
  */
 static struct isl_sol *basic_map_partial_lexopt_base(
 	__isl_take isl_basic_map *bmap, __isl_take isl_basic_set *dom,
@@ -4113,8 +4442,11 @@ static struct isl_sol *basic_map_partial_lexopt_base(
 			sol->add_empty(sol,
 		    isl_basic_set_copy(context->op->peek_basic_set(context)));
 	} else {
-		tab = tab_for_lexmin(bmap,
-				    context->op->peek_basic_set(context), 1, max);
+		dom = context->op->peek_basic_set(context);
+		bmap = shift_outputs(bmap, dom, max, &sol->shift);
+		if (!bmap)
+			goto error;
+		tab = tab_for_lexmin(bmap, dom, !sol->shift, max);
 		tab = context->op->detect_nonnegative_parameters(context, tab);
 		find_solutions_main(sol, tab);
 	}
@@ -4921,6 +5253,197 @@ int isl_basic_set_foreach_lexopt(__isl_keep isl_basic_set *bset, int max,
 	return isl_basic_map_foreach_lexopt(bset, max, fn, user);
 }
 
+/* An isl_sol for calling a user-defined function on each piece
+ * of the lexicographic optimum as an isl_multi_aff in "space".
+ */
+struct isl_sol_for_ma {
+	struct isl_sol	sol;
+	isl_space	*space;
+	int		(*fn)(__isl_take isl_basic_set *dom,
+				__isl_take isl_multi_aff *maff, void *user);
+	void		*user;
+};
+
+static void sol_for_ma_free(struct isl_sol_for_ma *sol_for)
+{
+	if (!sol_for)
+		return;
+	if (sol_for->sol.context)
+		sol_for->sol.context->op->free(sol_for->sol.context);
+	isl_space_free(sol_for->space);
+	free(sol_for);
+}
+
+static void sol_for_ma_free_wrap(struct isl_sol *sol)
+{
+	sol_for_ma_free((struct isl_sol_for_ma *)sol);
+}
+
+/* Call the user-defined function with the context "dom" and
+ * the affine expressions in "M", combined into an isl_multi_aff.
+ * See sol_pma_add for the construction of this isl_multi_aff.
+ */
+static void sol_for_ma_add(struct isl_sol_for_ma *sol,
+	__isl_take isl_basic_set *dom, __isl_take isl_mat *M)
+{
+	int i;
+	isl_local_space *ls;
+	isl_aff *aff;
+	isl_multi_aff *maff;
+
+	if (sol->sol.error || !dom || !M)
+		goto error;
+
+	maff = isl_multi_aff_alloc(isl_space_copy(sol->space));
+	ls = isl_basic_set_get_local_space(dom);
+	for (i = 1; i < M->n_row; ++i) {
+		aff = isl_aff_alloc(isl_local_space_copy(ls));
+		if (aff) {
+			isl_int_set(aff->v->el[0], M->row[0][0]);
+			isl_seq_cpy(aff->v->el + 1, M->row[i], M->n_col);
+		}
+		aff = isl_aff_normalize(aff);
+		maff = isl_multi_aff_set_aff(maff, i - 1, aff);
+	}
+	isl_local_space_free(ls);
+	isl_mat_free(M);
+	dom = isl_basic_set_simplify(dom);
+	dom = isl_basic_set_finalize(dom);
+	if (!dom || !maff) {
+		isl_basic_set_free(dom);
+		isl_multi_aff_free(maff);
+		sol->sol.error = 1;
+		return;
+	}
+
+	if (sol->fn(dom, maff, sol->user) < 0)
+		sol->sol.error = 1;
+	return;
+error:
+	isl_basic_set_free(dom);
+	isl_mat_free(M);
+	sol->sol.error = 1;
+}
+
+static void sol_for_ma_add_wrap(struct isl_sol *sol,
+	__isl_take isl_basic_set *dom, __isl_take isl_mat *M)
+{
+	sol_for_ma_add((struct isl_sol_for_ma *)sol, dom, M);
+}
+
+static struct isl_sol_for_ma *sol_for_ma_init(__isl_keep isl_basic_map *bmap,
+	__isl_take isl_basic_set *dom, int max,
+	int (*fn)(__isl_take isl_basic_set *dom,
+		  __isl_take isl_multi_aff *maff, void *user),
+	void *user)
+{
+	struct isl_sol_for_ma *sol_for = NULL;
+
+	sol_for = isl_calloc_type(bmap->ctx, struct isl_sol_for_ma);
+	if (!sol_for)
+		goto error;
+
+	sol_for->sol.rational = ISL_F_ISSET(bmap, ISL_BASIC_MAP_RATIONAL);
+	sol_for->sol.dec_level.callback.run = &sol_dec_level_wrap;
+	sol_for->sol.dec_level.sol = &sol_for->sol;
+	sol_for->fn = fn;
+	sol_for->user = user;
+	sol_for->sol.max = max;
+	sol_for->sol.n_out = isl_basic_map_dim(bmap, isl_dim_out);
+	sol_for->sol.add = &sol_for_ma_add_wrap;
+	sol_for->sol.add_empty = NULL;
+	sol_for->sol.free = &sol_for_ma_free_wrap;
+	sol_for->space = isl_basic_map_get_space(bmap);
+	if (!sol_for->space)
+		goto error;
+
+	sol_for->sol.context = isl_context_alloc(dom);
+	if (!sol_for->sol.context)
+		goto error;
+
+	isl_basic_set_free(dom);
+	return sol_for;
+error:
+	isl_basic_set_free(dom);
+	sol_for_ma_free(sol_for);
+	return NULL;
+}
+
+/* Call "fn" on each piece of the lexicographic minimum
+ * (or maximum if "max" is set) of "bmap" over the domain "dom",
+ * as soon as the piece has been computed, rather than collecting
+ * all pieces in a single result.
+ * Each piece consists of a basic set in the domain space of "bmap"
+ * and an isl_multi_aff that expresses the optimum on that basic set.
+ * The basic sets are pairwise disjoint.
+ * Parts of "dom" without solution are not reported.
+ *
+ * The preprocessing is the same as that of
+ * isl_basic_map_partial_lexopt_pw_multi_aff, except that
+ * symmetries are not exploited since that requires
+ * a post-processing step on the entire result.
+ */
+int isl_basic_map_foreach_partial_lexopt_multi_aff(
+	__isl_keep isl_basic_map *bmap, __isl_keep isl_basic_set *dom, int max,
+	int (*fn)(__isl_take isl_basic_set *dom,
+		  __isl_take isl_multi_aff *maff, void *user),
+	void *user)
+{
+	struct isl_sol_for_ma *sol_for = NULL;
+	struct isl_context *context;
+
+	if (!bmap || !dom)
+		return -1;
+
+	isl_assert(bmap->ctx,
+	    isl_basic_map_compatible_domain(bmap, dom), return -1);
+
+	bmap = isl_basic_map_copy(bmap);
+	dom = isl_basic_set_copy(dom);
+	if (isl_basic_set_dim(dom, isl_dim_all) != 0)
+		bmap = isl_basic_map_intersect_domain(bmap,
+						    isl_basic_set_copy(dom));
+	bmap = isl_basic_map_detect_equalities(bmap);
+	if (!bmap || !dom)
+		goto error;
+	if (dom->n_div) {
+		dom = isl_basic_set_order_divs(dom);
+		bmap = align_context_divs(bmap, dom);
+		if (!bmap)
+			goto error;
+	}
+
+	sol_for = sol_for_ma_init(bmap, dom, max, fn, user);
+	dom = NULL;
+	if (!sol_for)
+		goto error;
+
+	context = sol_for->sol.context;
+	if (isl_basic_set_plain_is_empty(context->op->peek_basic_set(context)))
+		/* nothing */;
+	else if (isl_basic_map_plain_is_empty(bmap))
+		/* nothing */;
+	else {
+		struct isl_tab *tab;
+		tab = tab_for_lexmin(bmap,
+				    context->op->peek_basic_set(context), 1, max);
+		tab = context->op->detect_nonnegative_parameters(context, tab);
+		find_solutions_main(&sol_for->sol, tab);
+	}
+	if (sol_for->sol.error)
+		goto error;
+
+	sol_free(&sol_for->sol);
+	isl_basic_map_free(bmap);
+	return 0;
+error:
+	if (sol_for)
+		sol_free(&sol_for->sol);
+	isl_basic_set_free(dom);
+	isl_basic_map_free(bmap);
+	return -1;
+}
+
 /* Check if the given sequence of len variables starting at pos
  * represents a trivial (i.e., zero) solution.
  * The variables are assumed to be non-negative and to come in pairs,
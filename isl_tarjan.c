@@ -14,12 +14,26 @@
 #include <isl/ctx.h>
 #include <isl_tarjan.h>
 
+/* The edges of the graph being traversed.
+ * If "follows" is set, then there is an edge from i to j
+ * if follows(i, j, user) returns 1.
+ * Otherwise, the edges from i lead to edge[first[i]]
+ * up to edge[first[i + 1] - 1].
+ */
+struct isl_tarjan_edges {
+	int (*follows)(int i, int j, void *user);
+	void *user;
+	const int *first;
+	const int *edge;
+};
+
 void isl_tarjan_graph_free(struct isl_tarjan_graph *g)
 {
 	if (!g)
 		return;
 	free(g->node);
 	free(g->stack);
+	free(g->call);
 	free(g->order);
 	free(g);
 }
@@ -41,11 +55,15 @@ static struct isl_tarjan_graph *isl_tarjan_graph_alloc(isl_ctx *ctx, int len)
 	g->stack = isl_alloc_array(ctx, int, len);
 	if (len && !g->stack)
 		goto error;
+	g->call = isl_alloc_array(ctx, int, len);
+	if (len && !g->call)
+		goto error;
 	g->order = isl_alloc_array(ctx, int, 2 * len);
 	if (len && !g->order)
 		goto error;
 
 	g->sp = 0;
+	g->csp = 0;
 	g->index = 0;
 	g->op = 0;
 
@@ -55,68 +73,122 @@ error:
 	return NULL;
 }
 
-/* Perform Tarjan's algorithm for computing the strongly connected components
- * in the graph with g->len nodes and with edges defined by "follows".
+/* Start visiting node "i", pushing it on both the stack
+ * of the algorithm and the stack of nodes being visited.
+ * The outgoing edges of "i" are considered in reverse order.
  */
-static int isl_tarjan_components(struct isl_tarjan_graph *g, int i,
-	int (*follows)(int i, int j, void *user), void *user)
+static void visit(struct isl_tarjan_graph *g, int i,
+	struct isl_tarjan_edges *edges)
 {
-	int j;
-
 	g->node[i].index = g->index;
 	g->node[i].min_index = g->index;
 	g->node[i].on_stack = 1;
+	g->node[i].next = edges->follows ? g->len - 1 : edges->first[i + 1] - 1;
 	g->index++;
 	g->stack[g->sp++] = i;
+	g->call[g->csp++] = i;
+}
 
-	for (j = g->len - 1; j >= 0; --j) {
-		int f;
+/* Look for the next edge from node "i" that may affect
+ * the outcome of the algorithm and store its target in "j".
+ * Edges to nodes that have already been visited and that are
+ * either no longer on the stack or that have an index
+ * that is not smaller than the current min_index of "i"
+ * have no effect and are skipped, without calling edges->follows.
+ *
+ * Return 1 if such an edge was found, 0 if there are no more edges
+ * from "i" and -1 on error.
+ */
+static int next_edge(struct isl_tarjan_graph *g, int i,
+	struct isl_tarjan_edges *edges, int *j)
+{
+	struct isl_tarjan_node *node = &g->node[i];
+	int end = edges->follows ? 0 : edges->first[i];
 
-		if (j == i)
+	while (node->next >= end) {
+		int k, f;
+
+		k = node->next--;
+		if (!edges->follows)
+			k = edges->edge[k];
+		if (k == i)
 			continue;
-		if (g->node[j].index >= 0 &&
-			(!g->node[j].on_stack ||
-			 g->node[j].index > g->node[i].min_index))
+		if (g->node[k].index >= 0 &&
+			(!g->node[k].on_stack ||
+			 g->node[k].index > node->min_index))
 			continue;
 
-		f = follows(i, j, user);
-		if (f < 0)
+		if (edges->follows) {
+			f = edges->follows(i, k, edges->user);
+			if (f < 0)
+				return -1;
+			if (!f)
+				continue;
+		}
+
+		*j = k;
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Perform Tarjan's algorithm for computing the strongly connected components
+ * in the graph with g->len nodes and with edges defined by "edges",
+ * starting from node "root".
+ *
+ * Rather than recursively visiting the nodes, the nodes
+ * on the current path are kept on an explicit stack g->call.
+ * When all edges of a node have been considered, the node is removed
+ * from this stack and its min_index is propagated to its parent.
+ */
+static int isl_tarjan_components(struct isl_tarjan_graph *g, int root,
+	struct isl_tarjan_edges *edges)
+{
+	visit(g, root, edges);
+
+	while (g->csp > 0) {
+		int i, j, r;
+
+		i = g->call[g->csp - 1];
+		r = next_edge(g, i, edges, &j);
+		if (r < 0)
 			return -1;
-		if (!f)
+		if (r) {
+			if (g->node[j].index < 0)
+				visit(g, j, edges);
+			else if (g->node[j].index < g->node[i].min_index)
+				g->node[i].min_index = g->node[j].index;
 			continue;
+		}
 
-		if (g->node[j].index < 0) {
-			isl_tarjan_components(g, j, follows, user);
-			if (g->node[j].min_index < g->node[i].min_index)
-				g->node[i].min_index = g->node[j].min_index;
-		} else if (g->node[j].index < g->node[i].min_index)
-			g->node[i].min_index = g->node[j].index;
-	}
+		g->csp--;
+		if (g->csp > 0) {
+			int p = g->call[g->csp - 1];
 
-	if (g->node[i].index != g->node[i].min_index)
-		return 0;
+			if (g->node[i].min_index < g->node[p].min_index)
+				g->node[p].min_index = g->node[i].min_index;
+		}
 
-	do {
-		j = g->stack[--g->sp];
-		g->node[j].on_stack = 0;
-		g->order[g->op++] = j;
-	} while (j != i);
-	g->order[g->op++] = -1;
+		if (g->node[i].index != g->node[i].min_index)
+			continue;
+
+		do {
+			j = g->stack[--g->sp];
+			g->node[j].on_stack = 0;
+			g->order[g->op++] = j;
+		} while (j != i);
+		g->order[g->op++] = -1;
+	}
 
 	return 0;
 }
 
-/* Decompose the graph with "len" nodes and edges defined by "follows"
+/* Decompose the graph with "len" nodes and edges defined by "edges"
  * into strongly connected components (SCCs).
- * follows(i, j, user) should return 1 if "i" follows "j" and 0 otherwise.
- * It should return -1 on error.
- *
- * If SCC a contains a node i that follows a node j in another SCC b
- * (i.e., follows(i, j, user) returns 1), then SCC a will appear after SCC b
- * in the result.
  */
-struct isl_tarjan_graph *isl_tarjan_graph_init(isl_ctx *ctx, int len,
-	int (*follows)(int i, int j, void *user), void *user)
+static struct isl_tarjan_graph *tarjan_graph_init(isl_ctx *ctx, int len,
+	struct isl_tarjan_edges *edges)
 {
 	int i;
 	struct isl_tarjan_graph *g = NULL;
@@ -127,7 +199,7 @@ struct isl_tarjan_graph *isl_tarjan_graph_init(isl_ctx *ctx, int len,
 	for (i = len - 1; i >= 0; --i) {
 		if (g->node[i].index >= 0)
 			continue;
-		if (isl_tarjan_components(g, i, follows, user) < 0)
+		if (isl_tarjan_components(g, i, edges) < 0)
 			goto error;
 	}
 
@@ -136,3 +208,38 @@ error:
 	isl_tarjan_graph_free(g);
 	return NULL;
 }
+
+/* Decompose the graph with "len" nodes and edges defined by "follows"
+ * into strongly connected components (SCCs).
+ * follows(i, j, user) should return 1 if "i" follows "j" and 0 otherwise.
+ * It should return -1 on error.
+ *
+ * If SCC a contains a node i that follows a node j in another SCC b
+ * (i.e., follows(i, j, user) returns 1), then SCC a will appear after SCC b
+ * in the result.
+ */
+struct isl_tarjan_graph *isl_tarjan_graph_init(isl_ctx *ctx, int len,
+	int (*follows)(int i, int j, void *user), void *user)
+{
+	struct isl_tarjan_edges edges = { follows, user, NULL, NULL };
+
+	return tarjan_graph_init(ctx, len, &edges);
+}
+
+/* Decompose the graph with "len" nodes into strongly connected
+ * components (SCCs), where node i follows the nodes
+ * edge[first[i]] up to edge[first[i + 1] - 1].
+ * "first" therefore has "len" + 1 elements.
+ *
+ * The result is the same as that of isl_tarjan_graph_init
+ * with a "follows" callback that returns 1 for exactly these pairs,
+ * provided the nodes followed by each node are sorted
+ * in increasing order.
+ */
+struct isl_tarjan_graph *isl_tarjan_graph_init_edges(isl_ctx *ctx, int len,
+	const int *first, const int *edge)
+{
+	struct isl_tarjan_edges edges = { NULL, NULL, first, edge };
+
+	return tarjan_graph_init(ctx, len, &edges);
+}
@@ -6,19 +6,25 @@
  * index represents the order in which nodes are visited.
  * min_index is the index of the root of a (sub)component.
  * on_stack indicates whether the node is currently on the stack.
+ * next is the position of the next outgoing edge to consider.
  */
 struct isl_tarjan_node {
 	int index;
 	int min_index;
 	int on_stack;
+	int next;
 };
 
 /* Structure for representing the graph being traversed
  * using Tarjan's algorithm.
  * len is the number of nodes
  * node is an array of nodes
- * stack contains the nodes on the path from the root to the current node
+ * stack contains the visited nodes that have not yet been assigned
+ *	to a component
  * sp is the stack pointer
+ * call contains the nodes that are currently being visited,
+ *	i.e., the path from the root to the current node
+ * csp is the pointer into call
  * index is the index of the last node visited
  * order contains the elements of the components separated by -1
  * op represents the current position in order
@@ -28,6 +34,8 @@ struct isl_tarjan_graph {
 	struct isl_tarjan_node *node;
 	int *stack;
 	int sp;
+	int *call;
+	int csp;
 	int index;
 	int *order;
 	int op;
@@ -35,6 +43,8 @@ struct isl_tarjan_graph {
 
 struct isl_tarjan_graph *isl_tarjan_graph_init(isl_ctx *ctx, int len,
 	int (*follows)(int i, int j, void *user), void *user);
+struct isl_tarjan_graph *isl_tarjan_graph_init_edges(isl_ctx *ctx, int len,
+	const int *first, const int *edge);
 void isl_tarjan_graph_free(struct isl_tarjan_graph *g);
 
 #endif
@@ -26,15 +26,24 @@
 #include <isl_constraint_private.h>
 #include <isl/polynomial.h>
 #include <isl/union_map.h>
+#include <isl/stream.h>
 #include <isl_factorization.h>
 #include <isl/schedule.h>
 #include <isl_options_private.h>
 #include <isl/vertices.h>
 #include <isl/ast_build.h>
+#include <isl/id_to_pw_aff.h>
 #include <isl/val.h>
 #include <isl/ilp.h>
 #include <isl_ast_build_expr.h>
 #include <isl/options.h>
+#include <isl_lp_private.h>
+#include <isl_vec_private.h>
+#include <isl_mat_private.h>
+#include <isl_tarjan.h>
+#include <isl_thread.h>
+#include <isl_seq.h>
+#include <isl_gist_private.h>
 
 #define ARRAY_SIZE(array) (sizeof(array)/sizeof(*array))
 
@@ -104,6 +113,181 @@ static void test_parse_pwaff(isl_ctx *ctx, const char *str)
 	isl_pw_aff_free(pwaff);
 }
 
+/* Check that parsing the union map "str" from a buffer
+ * that is not NUL-terminated produces the same result
+ * as parsing it from a string.
+ */
+static int test_parse_buffer_one(isl_ctx *ctx, const char *str)
+{
+	size_t len = strlen(str);
+	char *buf;
+	struct isl_stream *s;
+	isl_union_map *umap1, *umap2;
+	int equal;
+
+	buf = isl_alloc_array(ctx, char, len);
+	if (!buf)
+		return -1;
+	memcpy(buf, str, len);
+	s = isl_stream_new_buffer(ctx, buf, len);
+	umap1 = s ? isl_stream_read_union_map(s) : NULL;
+	isl_stream_free(s);
+	free(buf);
+	umap2 = isl_union_map_read_from_str(ctx, str);
+	equal = isl_union_map_is_equal(umap1, umap2);
+	isl_union_map_free(umap1);
+	isl_union_map_free(umap2);
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"parsing from buffer produces different result",
+			return -1);
+	return 0;
+}
+
+/* Union maps that are parsed from a buffer.
+ * The buffer has exactly the length of the input, such that
+ * any read beyond the end of the buffer can be detected
+ * by a memory checker.
+ */
+const char *parse_buffer_tests[] = {
+	"{ A[i] -> B[i + 1]; B[i] -> C[i, 2i] }",
+	"[n] -> {\n  S_1[i, j] -> T[j] : 0 <= i < j < n\n}",
+	"[n] -> { S[i] -> T[10 * i] : i < n }",
+	"{ [i] -> [i] }",
+};
+
+static int test_parse_buffer(isl_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(parse_buffer_tests); ++i)
+		if (test_parse_buffer_one(ctx, parse_buffer_tests[i]) < 0)
+			return -1;
+
+	return 0;
+}
+
+/* Check that a union set with many disjuncts, most of which
+ * live in the same space, is read correctly and that
+ * incompatible disjuncts are still detected.
+ */
+static int test_parse_many_disjuncts(isl_ctx *ctx)
+{
+	int i, n = 100, equal;
+	char buf[2000];
+	char *p = buf;
+	isl_union_set *uset1, *uset2;
+	isl_set *set;
+	int on_error;
+
+	p += sprintf(p, "[n] -> { ");
+	for (i = 0; i < n; ++i)
+		p += sprintf(p, "A[i] : i = %d; ", i);
+	sprintf(p, "B[n] }");
+	uset1 = isl_union_set_read_from_str(ctx, buf);
+	uset2 = isl_union_set_read_from_str(ctx,
+				"[n] -> { A[i] : 0 <= i < 100; B[n] }");
+	equal = isl_union_set_is_equal(uset1, uset2);
+	isl_union_set_free(uset1);
+	isl_union_set_free(uset2);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown, "unexpected result",
+			return -1);
+
+	on_error = isl_options_get_on_error(ctx);
+	isl_options_set_on_error(ctx, ISL_ON_ERROR_CONTINUE);
+	set = isl_set_read_from_str(ctx,
+		"{ [i] : i = 0; [i] : i = 1; [i] -> [j]; [i] : i = 2 }");
+	isl_options_set_on_error(ctx, on_error);
+	isl_set_free(set);
+	if (set)
+		isl_die(ctx, isl_error_unknown,
+			"mixing sets and maps not detected", return -1);
+
+	return 0;
+}
+
+/* Union maps that are read by test_parse_threads.
+ * The last few are not split over several threads.
+ */
+const char *parse_threads_tests[] = {
+	"[n] -> { A[i] -> B[i + 1] : 0 <= i < n; A[i] -> B[i - 1] : i >= n; "
+		"B[i] -> A[i] : exists (e : i = 2e); C[] -> A[n]; }",
+	"{ S[i, j] -> T[i] : 0 <= i, j <= 10 and (i < j or i = 2 * [j/2]); "
+		"S[i, j] -> T[j] : i > 10; T[i] -> S[i, i]; "
+		"T[i] -> S[([i/3]), i] }",
+	"[n, m] -> { [i] -> [j] : i = n; [i] -> [j] : j = m; "
+		"[i] -> [j] : i + j = n + m }",
+	"{ [i] -> [i] }",
+	"{ }",
+	"{ Sym=[n] [i] -> [n]; [i] -> [i] : i <= n }",
+	"# comment\n{ [i] -> [i + 1]; [i] -> [i - 1] }",
+};
+
+/* Check that the union maps in parse_threads_tests, as well as
+ * a union map and a union set with many disjuncts, are read
+ * in the same way independently of whether the disjuncts
+ * are parsed on several threads.
+ */
+static int test_parse_threads(isl_ctx *ctx)
+{
+	int i, j, n = 100, equal = 1;
+	char buf[4000], set_buf[4000];
+	char *p = buf;
+	int n_thread;
+	isl_union_map *umap[2];
+	isl_union_set *uset[2];
+
+	n_thread = isl_options_get_threads(ctx);
+	for (i = 0; equal > 0 && i < ARRAY_SIZE(parse_threads_tests); ++i) {
+		for (j = 0; j < 2; ++j) {
+			isl_options_set_threads(ctx, j == 0 ? 1 : 3);
+			umap[j] = isl_union_map_read_from_str(ctx,
+						parse_threads_tests[i]);
+		}
+		equal = isl_union_map_is_equal(umap[0], umap[1]);
+		isl_union_map_free(umap[0]);
+		isl_union_map_free(umap[1]);
+	}
+
+	p += sprintf(p, "[n] -> { ");
+	for (i = 0; i < n; ++i)
+		p += sprintf(p, "A[i] -> B[i + %d] : i <= %d; ", i, n - i);
+	sprintf(p, "B[n] -> A[n] }");
+	p = set_buf;
+	p += sprintf(p, "[n] -> { ");
+	for (i = 0; i < n; ++i)
+		p += sprintf(p, "A[i, %d] : i <= n - %d; ", i % 7, i);
+	sprintf(p, "B[n] }");
+	for (j = 0; j < 2; ++j) {
+		isl_options_set_threads(ctx, j == 0 ? 1 : 3);
+		umap[j] = isl_union_map_read_from_str(ctx, buf);
+		uset[j] = isl_union_set_read_from_str(ctx, set_buf);
+	}
+	isl_options_set_threads(ctx, n_thread);
+	if (equal > 0)
+		equal = isl_union_map_is_equal(umap[0], umap[1]);
+	if (equal > 0)
+		equal = isl_union_set_is_equal(uset[0], uset[1]);
+	isl_union_map_free(umap[0]);
+	isl_union_map_free(umap[1]);
+	isl_union_set_free(uset[0]);
+	isl_union_set_free(uset[1]);
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"result depends on number of threads", return -1);
+
+	return 0;
+}
+
 int test_parse(struct isl_ctx *ctx)
 {
 	isl_map *map, *map2;
@@ -252,6 +436,28 @@ int test_parse(struct isl_ctx *ctx)
 	    "{ [a] -> [2a] : a >= 0; [a] -> [0] : a < 0 }") < 0)
 		return -1;
 
+	str = "{ [i, j] -> [j] : i < j; [j, i] -> [i + j] : j > i }";
+	str2 = "{ [a, b] -> [b] : a < b; [a, b] -> [a + b] : a > b }";
+	if (test_parse_map_equal(ctx, str, str2) < 0)
+		return -1;
+
+	str = "{ [i] -> [i'] : i' = i + 1000000000 - 999999999 }";
+	str2 = "{ [a] -> [b] : b = a + 1 }";
+	if (test_parse_map_equal(ctx, str, str2) < 0)
+		return -1;
+
+	str = "{ [i] -> [-123456789012345678901 + 2 * i] }";
+	str2 = "{ [i] -> [j] : j + 123456789012345678901 = 2 * i }";
+	if (test_parse_map_equal(ctx, str, str2) < 0)
+		return -1;
+
+	if (test_parse_buffer(ctx) < 0)
+		return -1;
+	if (test_parse_many_disjuncts(ctx) < 0)
+		return -1;
+	if (test_parse_threads(ctx) < 0)
+		return -1;
+
 	return 0;
 }
 
@@ -366,6 +572,76 @@ void test_dim(struct isl_ctx *ctx)
 	isl_map_free(map2);
 }
 
+/* Check that applying a sequence of dimension edits to "str"
+ * produces the same result as applying the edits one by one.
+ */
+static int check_dim_edits(isl_ctx *ctx, const char *str)
+{
+	isl_map *map1, *map2;
+	isl_basic_map *bmap1, *bmap2;
+	isl_space *space1, *space2;
+	isl_dim_edits *edits;
+	int equal, equal_space;
+
+	edits = isl_dim_edits_alloc(ctx);
+	edits = isl_dim_edits_insert(edits, isl_dim_in, 0, 2);
+	edits = isl_dim_edits_move(edits, isl_dim_out, 0, isl_dim_param, 0, 1);
+	edits = isl_dim_edits_project_out(edits, isl_dim_in, 2, 1);
+	edits = isl_dim_edits_set_dim_name(edits, isl_dim_in, 1, "k");
+
+	map1 = isl_map_read_from_str(ctx, str);
+	bmap1 = isl_map_simple_hull(isl_map_copy(map1));
+	bmap2 = isl_basic_map_copy(bmap1);
+	map2 = isl_map_copy(map1);
+	map1 = isl_map_apply_dim_edits(map1, edits);
+	map2 = isl_map_insert_dims(map2, isl_dim_in, 0, 2);
+	map2 = isl_map_move_dims(map2, isl_dim_out, 0, isl_dim_param, 0, 1);
+	map2 = isl_map_project_out(map2, isl_dim_in, 2, 1);
+	map2 = isl_map_set_dim_name(map2, isl_dim_in, 1, "k");
+	equal = isl_map_is_equal(map1, map2);
+	space1 = isl_map_get_space(map1);
+	space2 = isl_map_get_space(map2);
+	equal_space = isl_space_is_equal(space1, space2);
+	isl_space_free(space1);
+	isl_space_free(space2);
+
+	bmap1 = isl_basic_map_apply_dim_edits(bmap1, edits);
+	bmap2 = isl_basic_map_insert_dims(bmap2, isl_dim_in, 0, 2);
+	bmap2 = isl_basic_map_move_dims(bmap2, isl_dim_out, 0,
+					isl_dim_param, 0, 1);
+	bmap2 = isl_basic_map_project_out(bmap2, isl_dim_in, 2, 1);
+	bmap2 = isl_basic_map_set_dim_name(bmap2, isl_dim_in, 1, "k");
+	if (equal >= 0 && equal)
+		equal = isl_basic_map_is_equal(bmap1, bmap2);
+
+	isl_map_free(map1);
+	isl_basic_map_free(bmap1);
+	isl_basic_map_free(bmap2);
+	isl_map_free(map2);
+	isl_dim_edits_free(edits);
+
+	if (equal < 0 || equal_space < 0)
+		return -1;
+	if (!equal || !equal_space)
+		isl_die(ctx, isl_error_unknown,
+			"batch dimension edits produce different result",
+			return -1);
+
+	return 0;
+}
+
+static int test_dim_edits(isl_ctx *ctx)
+{
+	if (check_dim_edits(ctx, "[n] -> { [i] -> [j] : "
+			"exists (a = [i/10] : i - 10a <= n and 0 <= j <= i) }") < 0)
+		return -1;
+	if (check_dim_edits(ctx, "[n] -> { [i] -> [j] : 0 <= i <= n and "
+			"j = 2 i or i = n + 3 and j = 0 }") < 0)
+		return -1;
+
+	return 0;
+}
+
 struct {
 	__isl_give isl_val *(*op)(__isl_take isl_val *v);
 	const char *arg;
@@ -508,6 +784,12 @@ struct {
 	{ "1/2", '+', "1/2", "1" },
 	{ "3/4", '-', "1/4", "1/2" },
 	{ "1/2", '-', "1/3", "1/6" },
+	{ "5/6", '-', "1/3", "1/2" },
+	{ "1/6", '+', "-1/10", "1/15" },
+	{ "-7/12", '+', "5/18", "-11/36" },
+	{ "4/9", '*', "3/8", "1/6" },
+	{ "-4/9", '*', "3/8", "-1/6" },
+	{ "-4/9", '*', "-9/4", "1" },
 	{ "infty", '+', "42", "infty" },
 	{ "infty", '+', "infty", "infty" },
 	{ "42", '+', "infty", "infty" },
@@ -570,742 +852,2298 @@ static int test_bin_val(isl_ctx *ctx)
 	return 0;
 }
 
-/* Perform some basic tests on isl_val objects.
+/* Values around the boundaries of machine word sized integers
+ * on which to test the isl_int operations.
  */
-static int test_val(isl_ctx *ctx)
-{
-	if (test_un_val(ctx) < 0)
-		return -1;
-	if (test_bin_val(ctx) < 0)
-		return -1;
-	return 0;
-}
+static const char *int_test_values[] = {
+	"0", "1", "-1", "7", "-12",
+	"2147483647", "-2147483647", "-2147483648", "2147483648",
+	"4294967295", "4294967296", "-4294967296",
+	"9223372036854775807", "-9223372036854775808",
+	"-340282366920938463463374607431768211456"
+};
 
-static int test_div(isl_ctx *ctx)
+/* Check that the isl_int operations on "a" and "b" satisfy
+ * some basic identities.
+ */
+static int test_int_pair(isl_ctx *ctx, isl_int a, isl_int b)
 {
-	unsigned n;
-	const char *str;
-	int empty;
-	isl_int v;
-	isl_space *dim;
-	isl_set *set;
-	isl_local_space *ls;
-	struct isl_basic_set *bset;
-	struct isl_constraint *c;
+	int ok = 1;
+	isl_int t, q, r, g;
 
-	isl_int_init(v);
+	isl_int_init(t);
+	isl_int_init(q);
+	isl_int_init(r);
+	isl_int_init(g);
+
+	isl_int_add(t, a, b);
+	isl_int_sub(t, t, b);
+	ok = ok && isl_int_eq(t, a);
+
+	isl_int_sub(t, a, b);
+	ok = ok && isl_int_sgn(t) == isl_int_cmp(a, b);
+
+	isl_int_set(t, a);
+	isl_int_addmul(t, a, b);
+	isl_int_submul(t, b, a);
+	ok = ok && isl_int_eq(t, a);
+
+	isl_int_gcd(g, a, b);
+	ok = ok && isl_int_is_nonneg(g);
+	if (!isl_int_is_zero(g)) {
+		ok = ok && isl_int_is_divisible_by(a, g);
+		ok = ok && isl_int_is_divisible_by(b, g);
+		isl_int_lcm(t, a, b);
+		isl_int_mul(t, t, g);
+		isl_int_mul(r, a, b);
+		isl_int_abs(r, r);
+		ok = ok && isl_int_eq(t, r);
+	}
 
-	/* test 1 */
-	dim = isl_space_set_alloc(ctx, 0, 3);
-	bset = isl_basic_set_universe(isl_space_copy(dim));
-	ls = isl_local_space_from_space(dim);
+	if (!isl_int_is_zero(b)) {
+		isl_int_mul(t, a, b);
+		isl_int_divexact(t, t, b);
+		ok = ok && isl_int_eq(t, a);
+
+		isl_int_fdiv_q(q, a, b);
+		isl_int_fdiv_r(r, a, b);
+		isl_int_mul(t, q, b);
+		isl_int_add(t, t, r);
+		ok = ok && isl_int_eq(t, a);
+		ok = ok && (isl_int_is_zero(r) ||
+			    isl_int_sgn(r) == isl_int_sgn(b));
+		ok = ok && isl_int_abs_lt(r, b);
+
+		isl_int_neg(t, a);
+		isl_int_fdiv_q(t, t, b);
+		isl_int_neg(t, t);
+		isl_int_cdiv_q(q, a, b);
+		ok = ok && isl_int_eq(t, q);
+
+		isl_int_tdiv_q(q, a, b);
+		isl_int_abs(t, a);
+		isl_int_abs(r, b);
+		isl_int_fdiv_q(t, t, r);
+		isl_int_abs(q, q);
+		ok = ok && isl_int_eq(t, q);
+	}
 
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, -1);
-	isl_constraint_set_constant(c, v);
-	isl_int_set_si(v, 1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, 3);
-	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+	isl_int_mul_2exp(t, a, 40);
+	isl_int_set_si(r, 1);
+	isl_int_mul_2exp(r, r, 40);
+	isl_int_divexact(t, t, r);
+	ok = ok && isl_int_eq(t, a);
+	ok = ok && isl_int_hash(t, 0) == isl_int_hash(a, 0);
 
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, 1);
-	isl_constraint_set_constant(c, v);
-	isl_int_set_si(v, -1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, 3);
-	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+	isl_int_clear(t);
+	isl_int_clear(q);
+	isl_int_clear(r);
+	isl_int_clear(g);
 
-	bset = isl_basic_set_project_out(bset, isl_dim_set, 1, 2);
+	if (!ok)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected result of isl_int operation", return -1);
 
-	assert(bset && bset->n_div == 1);
-	isl_local_space_free(ls);
-	isl_basic_set_free(bset);
+	return 0;
+}
 
-	/* test 2 */
-	dim = isl_space_set_alloc(ctx, 0, 3);
-	bset = isl_basic_set_universe(isl_space_copy(dim));
-	ls = isl_local_space_from_space(dim);
+/* Perform some basic tests on isl_int operations, in particular
+ * on values that (nearly) do not fit in a machine word.
+ */
+static int test_int(isl_ctx *ctx)
+{
+	int i, j;
+	int n = ARRAY_SIZE(int_test_values);
+	isl_int a, b;
+	char *s;
+	int r = 0;
 
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, 1);
-	isl_constraint_set_constant(c, v);
-	isl_int_set_si(v, -1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, 3);
-	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+	isl_int_init(a);
+	isl_int_init(b);
 
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, -1);
-	isl_constraint_set_constant(c, v);
-	isl_int_set_si(v, 1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, 3);
-	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+	for (i = 0; r >= 0 && i < n; ++i) {
+		isl_int_read(a, int_test_values[i]);
+		s = isl_int_get_str(a);
+		if (strcmp(s, int_test_values[i]))
+			isl_die(ctx, isl_error_unknown,
+				"unexpected string representation", r = -1);
+		isl_int_free_str(s);
+		for (j = 0; r >= 0 && j < n; ++j) {
+			isl_int_read(b, int_test_values[j]);
+			r = test_int_pair(ctx, a, b);
+		}
+	}
 
-	bset = isl_basic_set_project_out(bset, isl_dim_set, 1, 2);
+	isl_int_clear(a);
+	isl_int_clear(b);
 
-	assert(bset && bset->n_div == 1);
-	isl_local_space_free(ls);
-	isl_basic_set_free(bset);
+	return r;
+}
 
-	/* test 3 */
-	dim = isl_space_set_alloc(ctx, 0, 3);
-	bset = isl_basic_set_universe(isl_space_copy(dim));
-	ls = isl_local_space_from_space(dim);
+/* An element of the arrays sorted in test_sort.
+ * "key" is the sort key, while "pos" is the original position.
+ */
+struct isl_test_sort_el {
+	unsigned key;
+	int pos;
+};
 
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, 1);
-	isl_constraint_set_constant(c, v);
-	isl_int_set_si(v, -1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, 3);
-	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+static int test_sort_cmp(const struct isl_test_sort_el *a,
+	const struct isl_test_sort_el *b)
+{
+	return a->key < b->key ? -1 : a->key > b->key ? 1 : 0;
+}
 
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, -3);
-	isl_constraint_set_constant(c, v);
-	isl_int_set_si(v, 1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, 4);
-	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+#define SORT_FN		test_merge_sort
+#define SORT_EL		struct isl_test_sort_el
+#define SORT_ARG	void *
+#define SORT_CMP(a, b, arg)	test_sort_cmp(a, b)
 
-	bset = isl_basic_set_project_out(bset, isl_dim_set, 1, 2);
+#include <isl_sort_templ.c>
 
-	assert(bset && bset->n_div == 1);
-	isl_local_space_free(ls);
-	isl_basic_set_free(bset);
+#define SORT_FN		test_radix_sort
+#define SORT_EL		struct isl_test_sort_el
+#define SORT_ARG	void *
+#define SORT_KEY(a, arg)	(a)->key
 
-	/* test 4 */
-	dim = isl_space_set_alloc(ctx, 0, 3);
-	bset = isl_basic_set_universe(isl_space_copy(dim));
-	ls = isl_local_space_from_space(dim);
+#include <isl_sort_templ.c>
 
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, 2);
-	isl_constraint_set_constant(c, v);
-	isl_int_set_si(v, -1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, 3);
-	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+/* Check that the array "el" of length "n" is sorted on the keys
+ * and that elements with the same key appear in their original order.
+ */
+static int check_stably_sorted(isl_ctx *ctx,
+	struct isl_test_sort_el *el, int n)
+{
+	int i;
 
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, -1);
-	isl_constraint_set_constant(c, v);
-	isl_int_set_si(v, 1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, 6);
-	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+	for (i = 1; i < n; ++i) {
+		if (el[i - 1].key < el[i].key)
+			continue;
+		if (el[i - 1].key == el[i].key && el[i - 1].pos < el[i].pos)
+			continue;
+		isl_die(ctx, isl_error_unknown,
+			"array not stably sorted", return -1);
+	}
 
-	bset = isl_basic_set_project_out(bset, isl_dim_set, 1, 2);
+	return 0;
+}
 
-	assert(isl_basic_set_is_empty(bset));
-	isl_local_space_free(ls);
-	isl_basic_set_free(bset);
+/* Check that the merge sort and radix sort instances of isl_sort_templ.c
+ * sort arrays of various lengths with many duplicate keys stably.
+ * The keys of the second half of the radix sort tests need more
+ * than one byte.
+ */
+static int test_sort(isl_ctx *ctx)
+{
+	int i, n, r = 0;
+	struct isl_test_sort_el el[1000];
+	size_t len[] = { 0, 1, 2, 15, 16, 17, 100, 1000 };
+
+	for (n = 0; r == 0 && n < ARRAY_SIZE(len); ++n) {
+		for (i = 0; i < len[n]; ++i) {
+			el[i].key = (7919 * i) % 37;
+			el[i].pos = i;
+		}
+		if (test_merge_sort(el, len[n], NULL) < 0)
+			return -1;
+		r = check_stably_sorted(ctx, el, len[n]);
+		for (i = 0; r == 0 && i < len[n]; ++i) {
+			el[i].key = (7919 * i) % 37;
+			if (i >= len[n] / 2)
+				el[i].key = (el[i].key << 16) + 0x1234;
+			el[i].pos = i;
+		}
+		if (r == 0 && test_radix_sort(el, len[n], NULL) < 0)
+			return -1;
+		if (r == 0)
+			r = check_stably_sorted(ctx, el, len[n]);
+	}
 
-	/* test 5 */
-	dim = isl_space_set_alloc(ctx, 0, 3);
-	bset = isl_basic_set_universe(isl_space_copy(dim));
-	ls = isl_local_space_from_space(dim);
-
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, -1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, 3);
-	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+	return r;
+}
 
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, 1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, -3);
-	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+/* Check that the hash value of a sequence of integers does not depend
+ * on trailing zeros or on the way the coefficients were computed,
+ * in particular for coefficients that do not fit in a machine word,
+ * while it does depend on the positions of the coefficients.
+ */
+static int test_seq_hash(isl_ctx *ctx)
+{
+	int i;
+	isl_int v[6], w[6];
+	int ok;
 
-	bset = isl_basic_set_project_out(bset, isl_dim_set, 2, 1);
+	for (i = 0; i < 6; ++i) {
+		isl_int_init(v[i]);
+		isl_int_init(w[i]);
+	}
+	isl_int_set_si(v[0], 3);
+	isl_int_set_si(v[1], -5);
+	isl_int_set_si(v[2], 1);
+	isl_int_mul_2exp(v[2], v[2], 70);
+	isl_int_set_si(v[4], 7);
+	isl_int_set_si(w[0], 3);
+	isl_int_set_si(w[1], -5);
+	isl_int_read(w[2], "1180591620717411303424");
+	isl_int_set_si(w[4], 7);
+
+	ok = isl_seq_get_hash(v, 6) == isl_seq_get_hash(w, 5);
+	isl_int_swap(w[0], w[1]);
+	ok = ok && isl_seq_get_hash(v, 6) != isl_seq_get_hash(w, 5);
+
+	for (i = 0; i < 6; ++i) {
+		isl_int_clear(v[i]);
+		isl_int_clear(w[i]);
+	}
 
-	assert(bset && bset->n_div == 0);
-	isl_basic_set_free(bset);
-	isl_local_space_free(ls);
+	if (!ok)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected sequence hash", return -1);
+	return 0;
+}
 
-	/* test 6 */
-	dim = isl_space_set_alloc(ctx, 0, 3);
-	bset = isl_basic_set_universe(isl_space_copy(dim));
-	ls = isl_local_space_from_space(dim);
+/* Check that isl_mat_left_hermite computes matrices H, U and Q
+ * with M U = H and M = H Q for the 3 x 4 matrix with entries
+ * "scale" times "entries", plus "offset" on the diagonal.
+ * A large "scale" forces the computation to overflow machine integers.
+ */
+static int check_left_hermite(isl_ctx *ctx, int *entries, const char *scale,
+	int offset)
+{
+	int i, j;
+	isl_val *s;
+	isl_mat *M, *H, *U, *Q, *MU, *HQ;
+	int equal;
 
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, -1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, 6);
-	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+	M = isl_mat_alloc(ctx, 3, 4);
+	s = isl_val_read_from_str(ctx, scale);
+	for (i = 0; i < 3; ++i)
+		for (j = 0; j < 4; ++j) {
+			isl_val *v;
+
+			v = isl_val_mul_ui(isl_val_copy(s),
+					    abs(entries[4 * i + j]));
+			if (entries[4 * i + j] < 0)
+				v = isl_val_neg(v);
+			if (i == j)
+				v = isl_val_add_ui(v, offset);
+			M = isl_mat_set_element_val(M, i, j, v);
+		}
+	isl_val_free(s);
+	if (!M)
+		return -1;
+
+	H = isl_mat_left_hermite(isl_mat_copy(M), 0, &U, &Q);
+	MU = isl_mat_product(isl_mat_copy(M), U);
+	HQ = isl_mat_product(isl_mat_copy(H), Q);
+	equal = isl_mat_is_equal(MU, H);
+	if (equal > 0)
+		equal = isl_mat_is_equal(HQ, M);
+	isl_mat_free(M);
+	isl_mat_free(H);
+	isl_mat_free(MU);
+	isl_mat_free(HQ);
 
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, 1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, -3);
-	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"invalid Hermite normal form", return -1);
+	return 0;
+}
 
-	bset = isl_basic_set_project_out(bset, isl_dim_set, 2, 1);
+static int test_left_hermite(isl_ctx *ctx)
+{
+	int entries[] = { 2, -3, 5, 7, 4, 1, -6, 3, -8, 12, 10, 9 };
 
-	assert(bset && bset->n_div == 1);
-	isl_basic_set_free(bset);
-	isl_local_space_free(ls);
+	if (check_left_hermite(ctx, entries, "1", 0) < 0)
+		return -1;
+	if (check_left_hermite(ctx, entries, "1000000000000000000", 1) < 0)
+		return -1;
+	if (check_left_hermite(ctx, entries, "1000000000000000000000", 3) < 0)
+		return -1;
 
-	/* test 7 */
-	/* This test is a bit tricky.  We set up an equality
-	 *		a + 3b + 3c = 6 e0
-	 * Normalization of divs creates _two_ divs
-	 *		a = 3 e0
-	 *		c - b - e0 = 2 e1
-	 * Afterwards e0 is removed again because it has coefficient -1
-	 * and we end up with the original equality and div again.
-	 * Perhaps we can avoid the introduction of this temporary div.
-	 */
-	dim = isl_space_set_alloc(ctx, 0, 4);
-	bset = isl_basic_set_universe(isl_space_copy(dim));
-	ls = isl_local_space_from_space(dim);
+	return 0;
+}
 
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, -1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, -3);
-	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
-	isl_int_set_si(v, -3);
-	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
-	isl_int_set_si(v, 6);
-	isl_constraint_set_coefficient(c, isl_dim_set, 3, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+/* Edges of the graph used in test_tarjan, in the format
+ * of isl_tarjan_graph_init_edges.
+ * Node i follows the nodes tarjan_edge[tarjan_first[i]] up to
+ * tarjan_edge[tarjan_first[i + 1] - 1].
+ */
+static int tarjan_first[] = { 0, 1, 2, 4, 5, 5, 7, 8, 9 };
+static int tarjan_edge[] = { 2, 0, 1, 6, 2, 3, 6, 5, 4 };
 
-	bset = isl_basic_set_project_out(bset, isl_dim_set, 3, 1);
+/* Does node "i" follow node "j" in the graph of test_tarjan?
+ */
+static int tarjan_follows(int i, int j, void *user)
+{
+	int k;
 
-	/* Test disabled for now */
-	/*
-	assert(bset && bset->n_div == 1);
-	*/
-	isl_local_space_free(ls);
-	isl_basic_set_free(bset);
+	for (k = tarjan_first[i]; k < tarjan_first[i + 1]; ++k)
+		if (tarjan_edge[k] == j)
+			return 1;
+	return 0;
+}
 
-	/* test 8 */
-	dim = isl_space_set_alloc(ctx, 0, 5);
-	bset = isl_basic_set_universe(isl_space_copy(dim));
-	ls = isl_local_space_from_space(dim);
+/* Check that isl_tarjan_graph_init and isl_tarjan_graph_init_edges
+ * produce the same strongly connected components on a small graph and
+ * that isl_tarjan_graph_init_edges can handle a cycle that is
+ * too long for a recursive implementation on a small stack.
+ */
+static int test_tarjan(isl_ctx *ctx)
+{
+	int i, n = 8, len = 200000;
+	int *first, *edge;
+	struct isl_tarjan_graph *g1, *g2;
+	int equal;
 
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, -1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, -3);
-	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
-	isl_int_set_si(v, -3);
-	isl_constraint_set_coefficient(c, isl_dim_set, 3, v);
-	isl_int_set_si(v, 6);
-	isl_constraint_set_coefficient(c, isl_dim_set, 4, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+	g1 = isl_tarjan_graph_init(ctx, n, &tarjan_follows, NULL);
+	g2 = isl_tarjan_graph_init_edges(ctx, n, tarjan_first, tarjan_edge);
+	equal = g1 && g2 && g1->op == g2->op &&
+		!memcmp(g1->order, g2->order, g1->op * sizeof(int));
+	isl_tarjan_graph_free(g1);
+	isl_tarjan_graph_free(g2);
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"different components", return -1);
 
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, -1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, 1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
-	isl_int_set_si(v, 1);
-	isl_constraint_set_constant(c, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+	first = isl_alloc_array(ctx, int, len + 1);
+	edge = isl_alloc_array(ctx, int, len);
+	if (!first || !edge)
+		goto error;
+	for (i = 0; i <= len; ++i)
+		first[i] = i;
+	for (i = 0; i < len; ++i)
+		edge[i] = (i + 1) % len;
+	g1 = isl_tarjan_graph_init_edges(ctx, len, first, edge);
+	free(first);
+	free(edge);
+	if (!g1)
+		return -1;
+	equal = g1->op == len + 1 && g1->order[len] == -1;
+	isl_tarjan_graph_free(g1);
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"expecting single component", return -1);
 
-	bset = isl_basic_set_project_out(bset, isl_dim_set, 4, 1);
+	return 0;
+error:
+	free(first);
+	free(edge);
+	return -1;
+}
 
-	/* Test disabled for now */
-	/*
-	assert(bset && bset->n_div == 1);
-	*/
-	isl_local_space_free(ls);
-	isl_basic_set_free(bset);
+/* Check that integers released by blocks that do not fit
+ * in the block cache are reused by subsequent allocations,
+ * that a released block is reused for an allocation of the same size and
+ * that all released blocks are kept inside a scope.
+ * The vectors are chosen large enough for their elements
+ * not to fit in the inline storage of an isl_vec.
+ * "ctx" is allocated by with_blk_cache_ctx.
+ */
+static int check_blk_cache(isl_ctx *ctx)
+{
+	int i;
+	int cache_size;
+	isl_vec *vec[8];
+	long hits;
 
-	/* test 9 */
-	dim = isl_space_set_alloc(ctx, 0, 4);
-	bset = isl_basic_set_universe(isl_space_copy(dim));
-	ls = isl_local_space_from_space(dim);
+	cache_size = isl_options_get_blk_cache_size(ctx);
+	isl_options_set_blk_cache_size(ctx, 4);
 
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, 1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, -1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
-	isl_int_set_si(v, -2);
-	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+	for (i = 0; i < ARRAY_SIZE(vec); ++i)
+		vec[i] = isl_vec_alloc(ctx, ISL_VEC_SMALL_SIZE + 10 + i);
+	for (i = 0; i < ARRAY_SIZE(vec); ++i)
+		isl_vec_free(vec[i]);
 
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, -1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, 3);
-	isl_constraint_set_coefficient(c, isl_dim_set, 3, v);
-	isl_int_set_si(v, 2);
-	isl_constraint_set_constant(c, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+	isl_options_set_blk_cache_size(ctx, cache_size);
 
-	bset = isl_basic_set_project_out(bset, isl_dim_set, 2, 2);
+	hits = isl_ctx_get_stat(ctx, "int_pool_hits");
+	vec[0] = isl_vec_alloc(ctx, 1000);
+	if (!vec[0])
+		return -1;
+	isl_vec_free(vec[0]);
+	if (isl_ctx_get_stat(ctx, "int_pool_hits") <= hits)
+		isl_die(ctx, isl_error_unknown,
+			"integer pool not used", return -1);
 
-	bset = isl_basic_set_fix_si(bset, isl_dim_set, 0, 2);
+	hits = isl_ctx_get_stat(ctx, "blk_cache_hits");
+	vec[0] = isl_vec_alloc(ctx, 1000);
+	if (!vec[0])
+		return -1;
+	isl_vec_free(vec[0]);
+	if (isl_ctx_get_stat(ctx, "blk_cache_hits") != hits + 1)
+		isl_die(ctx, isl_error_unknown,
+			"block cache not used", return -1);
+
+	isl_options_set_blk_cache_size(ctx, 4);
+	isl_blk_scope_enter(ctx);
+	for (i = 0; i < ARRAY_SIZE(vec); ++i)
+		vec[i] = isl_vec_alloc(ctx, ISL_VEC_SMALL_SIZE + 10 + i);
+	for (i = 0; i < ARRAY_SIZE(vec); ++i)
+		isl_vec_free(vec[i]);
+	if (ctx->blk_cache.n < ARRAY_SIZE(vec))
+		isl_die(ctx, isl_error_unknown,
+			"blocks not kept inside scope", return -1);
+	isl_blk_scope_leave(ctx);
+	isl_options_set_blk_cache_size(ctx, cache_size);
+	if (ctx->blk_cache.n > 4)
+		isl_die(ctx, isl_error_unknown,
+			"block cache not reduced after scope", return -1);
 
-	assert(!isl_basic_set_is_empty(bset));
+	return 0;
+}
 
-	isl_local_space_free(ls);
-	isl_basic_set_free(bset);
+/* Check that the integer storage of objects freed while the release
+ * is deferred is kept by the isl_ctx and that it is released again
+ * by isl_ctx_drain_deferred_free, with the deferred_free_thread option
+ * set to "thread" and with matrices of "n" by "n" elements.
+ * The threads option is set to two if "thread" is set such that
+ * the background thread is allowed.
+ * The block cache size is temporarily set to zero such that
+ * no storage is kept outside of the deferred mode.
+ * "ctx" is allocated by with_blk_cache_ctx.
+ */
+static int test_deferred_free_with(isl_ctx *ctx, int thread, int n)
+{
+	int i;
+	isl_union_set *uset;
+	isl_mat *mat[8];
+	int cache_size, old_thread, threads;
+	int kept, left;
+
+	cache_size = isl_options_get_blk_cache_size(ctx);
+	old_thread = isl_options_get_deferred_free_thread(ctx);
+	threads = isl_options_get_threads(ctx);
+	isl_options_set_blk_cache_size(ctx, 0);
+	isl_options_set_deferred_free_thread(ctx, thread);
+	isl_options_set_threads(ctx, thread ? 2 : 1);
+	isl_ctx_defer_free(ctx);
+	for (i = 0; i < ARRAY_SIZE(mat); ++i)
+		mat[i] = isl_mat_alloc(ctx, n + i, n);
+	uset = isl_union_set_read_from_str(ctx,
+		"{ A[i, j] : 0 <= i, j <= 10; B[i] : i >= 0 or i <= -5 }");
+	uset = isl_union_set_coalesce(uset);
+	isl_union_set_free(uset);
+	for (i = 0; i < ARRAY_SIZE(mat); ++i)
+		isl_mat_free(mat[i]);
+	kept = ctx->blk_cache.n;
+	isl_ctx_drain_deferred_free(ctx);
+	left = ctx->blk_cache.n;
+	isl_options_set_threads(ctx, threads);
+	isl_options_set_deferred_free_thread(ctx, old_thread);
+	isl_options_set_blk_cache_size(ctx, cache_size);
+
+	if (kept < ARRAY_SIZE(mat))
+		isl_die(ctx, isl_error_unknown,
+			"storage not kept while deferred", return -1);
+	if (left != 0)
+		isl_die(ctx, isl_error_unknown,
+			"storage not released by drain", return -1);
 
-	/* test 10 */
-	dim = isl_space_set_alloc(ctx, 0, 3);
-	bset = isl_basic_set_universe(isl_space_copy(dim));
-	ls = isl_local_space_from_space(dim);
+	return 0;
+}
 
-	c = isl_equality_alloc(isl_local_space_copy(ls));
-	isl_int_set_si(v, 1);
-	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
-	isl_int_set_si(v, -2);
-	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
-	bset = isl_basic_set_add_constraint(bset, c);
+/* Check the deferred release of integer storage, both with
+ * the release performed by isl_ctx_drain_deferred_free itself and
+ * with the release performed on a background thread.
+ * The matrices in the latter case are large enough for
+ * the background thread to be used.
+ */
+static int check_deferred_free(isl_ctx *ctx)
+{
+	if (test_deferred_free_with(ctx, 0, 10) < 0)
+		return -1;
+	if (test_deferred_free_with(ctx, 1, 100) < 0)
+		return -1;
+	return 0;
+}
 
-	bset = isl_basic_set_project_out(bset, isl_dim_set, 2, 1);
+/* Call "fn" on a fresh isl_ctx with the default "int_pool_size" and
+ * "blk_cache_size" options and not in arena mode, independently
+ * of the options with which the test suite is run.
+ * In arena mode, all released blocks are kept and arena mode
+ * can only be selected when an isl_ctx is allocated,
+ * so it cannot be turned off on "ctx" itself.
+ */
+static int with_blk_cache_ctx(isl_ctx *ctx, int (*fn)(isl_ctx *ctx))
+{
+	struct isl_options *options;
+	isl_ctx *blk_ctx;
+	int r;
 
-	bset = isl_basic_set_fix_si(bset, isl_dim_set, 0, 2);
+	options = isl_options_new_with_defaults();
+	if (!options)
+		return -1;
+	options->arena = 0;
+	options->int_pool_size = 1024;
+	options->blk_cache_size = 64;
+	blk_ctx = isl_ctx_alloc_with_options(&isl_options_args, options);
+	if (!blk_ctx)
+		return -1;
+	r = fn(blk_ctx);
+	if (r < 0)
+		isl_ctx_set_error(ctx, isl_ctx_last_error(blk_ctx));
+	isl_ctx_free(blk_ctx);
 
-	isl_local_space_free(ls);
-	isl_basic_set_free(bset);
+	return r;
+}
 
-	isl_int_clear(v);
+static int test_blk_cache(isl_ctx *ctx)
+{
+	return with_blk_cache_ctx(ctx, &check_blk_cache);
+}
 
-	str = "{ [i] : exists (e0, e1: 3e1 >= 1 + 2e0 and "
-	    "8e1 <= -1 + 5i - 5e0 and 2e1 >= 1 + 2i - 5e0) }";
-	set = isl_set_read_from_str(ctx, str);
-	set = isl_set_compute_divs(set);
-	isl_set_free(set);
-	if (!set)
-		return -1;
+static int test_deferred_free(isl_ctx *ctx)
+{
+	return with_blk_cache_ctx(ctx, &check_deferred_free);
+}
 
-	str = "{ [i,j] : 2*[i/2] + 3 * [j/4] <= 10 and 2 i = j }";
-	bset = isl_basic_set_read_from_str(ctx, str);
-	n = isl_basic_set_dim(bset, isl_dim_div);
-	isl_basic_set_free(bset);
-	if (!bset)
-		return -1;
-	if (n != 0)
-		isl_die(ctx, isl_error_unknown,
-			"expecting no existentials", return -1);
+/* Coalesce and compute the lexicographic minimum of the set
+ * described by "str" in "ctx" and return the result as a string.
+ */
+static char *coalesce_lexmin_str(isl_ctx *ctx, const char *str)
+{
+	isl_set *set;
+	char *res;
 
-	str = "{ [i,j,k] : 3 + i + 2j >= 0 and 2 * [(i+2j)/4] <= k }";
 	set = isl_set_read_from_str(ctx, str);
-	set = isl_set_remove_divs_involving_dims(set, isl_dim_set, 0, 2);
-	set = isl_set_fix_si(set, isl_dim_set, 2, -3);
-	empty = isl_set_is_empty(set);
+	set = isl_set_coalesce(set);
+	set = isl_set_union(isl_set_lexmin(isl_set_copy(set)), set);
+	res = isl_set_to_str(set);
 	isl_set_free(set);
-	if (empty < 0)
-		return -1;
-	if (!empty)
-		isl_die(ctx, isl_error_unknown,
-			"result not as accurate as expected", return -1);
 
-	return 0;
+	return res;
 }
 
-void test_application_case(struct isl_ctx *ctx, const char *name)
+/* Check that a computation performed in an isl_ctx in arena mode
+ * produces the same result as in a regular isl_ctx and
+ * that the integer storage is taken from the arena.
+ */
+static int test_arena(isl_ctx *ctx)
 {
-	char *filename;
-	FILE *input;
-	struct isl_basic_set *bset1, *bset2;
-	struct isl_basic_map *bmap;
+	const char *str = "[n] -> { A[i, j] : 0 <= i, j <= n; "
+			"A[i, j] : n <= i <= 2n and 0 <= j <= 2n - i }";
+	isl_ctx *arena;
+	char *s1, *s2;
+	long memory;
+	int equal;
 
-	filename = get_filename(ctx, name, "omega");
-	assert(filename);
-	input = fopen(filename, "r");
-	assert(input);
+	arena = isl_ctx_alloc_arena();
+	if (!arena)
+		return -1;
+	s1 = coalesce_lexmin_str(ctx, str);
+	s2 = coalesce_lexmin_str(arena, str);
+	memory = isl_ctx_get_stat(arena, "arena_memory");
+	if (!isl_options_get_arena(arena))
+		memory = -1;
+	isl_ctx_free(arena);
+	equal = s1 && s2 && !strcmp(s1, s2);
+	free(s1);
+	free(s2);
 
-	bset1 = isl_basic_set_read_from_file(ctx, input);
-	bmap = isl_basic_map_read_from_file(ctx, input);
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"different result in arena mode", return -1);
+	if (memory <= 0)
+		isl_die(ctx, isl_error_unknown,
+			"no storage taken from arena", return -1);
 
-	bset1 = isl_basic_set_apply(bset1, bmap);
+	return 0;
+}
 
-	bset2 = isl_basic_set_read_from_file(ctx, input);
+/* Do the basic maps of "map" have no room
+ * for additional constraints or integer divisions?
+ */
+static int map_has_exact_storage(__isl_keep isl_map *map)
+{
+	int i;
 
-	assert(isl_basic_set_is_equal(bset1, bset2) == 1);
+	for (i = 0; i < map->n; ++i) {
+		isl_basic_map *bmap = map->p[i];
 
-	isl_basic_set_free(bset1);
-	isl_basic_set_free(bset2);
-	free(filename);
+		if (bmap->extra != bmap->n_div)
+			return 0;
+		if (bmap->c_size != bmap->n_eq + bmap->n_ineq)
+			return 0;
+	}
 
-	fclose(input);
+	return 1;
 }
 
-void test_application(struct isl_ctx *ctx)
+/* Is "map" compact, i.e., do its basic maps have no room
+ * for additional constraints or integer divisions and
+ * do they share the space of "map"?
+ */
+static int map_is_compact(__isl_keep isl_map *map)
 {
-	test_application_case(ctx, "application");
-	test_application_case(ctx, "application2");
+	int i;
+
+	if (!map_has_exact_storage(map))
+		return 0;
+	for (i = 0; i < map->n; ++i)
+		if (map->p[i]->dim != map->dim)
+			return 0;
+
+	return 1;
 }
 
-void test_affine_hull_case(struct isl_ctx *ctx, const char *name)
+/* Check that isl_map_compact and isl_union_map_compact reallocate
+ * the basic maps to their exact size without changing their meaning,
+ * that compacting a shared map leaves the other copy untouched and
+ * that the result of an operation is the same when
+ * the compact_on_finalize option is set.
+ */
+static int test_compact(isl_ctx *ctx)
 {
-	char *filename;
-	FILE *input;
-	struct isl_basic_set *bset1, *bset2;
+	const char *str;
+	isl_map *map, *copy;
+	isl_union_map *umap, *umap2;
+	int equal, compact, was_compact, copy_compact, opt;
 
-	filename = get_filename(ctx, name, "polylib");
-	assert(filename);
-	input = fopen(filename, "r");
-	assert(input);
+	str = "{ [i] -> [j] : exists (a = floor(i/3): 0 <= i < j < 10 and "
+		"i = 3a + 1); [i] -> [j] : i = j + 20 }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_intersect(map,
+		isl_map_read_from_str(ctx, "{ [i] -> [j] : j <= 5 + i }"));
+	copy = isl_map_copy(map);
+	was_compact = map ? map_has_exact_storage(map) : -1;
+	map = isl_map_compact(map);
+	compact = map ? map_is_compact(map) : -1;
+	copy_compact = copy ? map_has_exact_storage(copy) : -1;
+	equal = isl_map_is_equal(map, copy);
+	isl_map_free(map);
+	isl_map_free(copy);
+	if (compact < 0 || was_compact < 0 || copy_compact < 0 || equal < 0)
+		return -1;
+	if (!compact)
+		isl_die(ctx, isl_error_unknown, "map not compacted", return -1);
+	if (copy_compact != was_compact)
+		isl_die(ctx, isl_error_unknown, "shared copy compacted",
+			return -1);
+	if (!equal)
+		isl_die(ctx, isl_error_unknown, "compaction changed map",
+			return -1);
 
-	bset1 = isl_basic_set_read_from_file(ctx, input);
-	bset2 = isl_basic_set_read_from_file(ctx, input);
+	str = "{ A[i] -> B[i + 1] : 0 <= i < 10; C[i] -> D[] : i >= 0 }";
+	umap = isl_union_map_read_from_str(ctx, str);
+	umap2 = isl_union_map_compact(isl_union_map_copy(umap));
+	umap2 = isl_union_map_apply_range(umap2, isl_union_map_reverse(
+					isl_union_map_copy(umap)));
+	opt = isl_options_get_compact_on_finalize(ctx);
+	isl_options_set_compact_on_finalize(ctx, 1);
+	umap = isl_union_map_apply_range(umap,
+		isl_union_map_reverse(isl_union_map_copy(umap)));
+	isl_options_set_compact_on_finalize(ctx, opt);
+	equal = isl_union_map_is_equal(umap, umap2);
+	isl_union_map_free(umap);
+	isl_union_map_free(umap2);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown, "compaction changed result",
+			return -1);
 
-	bset1 = isl_basic_set_affine_hull(bset1);
+	return 0;
+}
 
-	assert(isl_basic_set_is_equal(bset1, bset2) == 1);
+/* Check that extending a vector beyond the size of its inline storage
+ * preserves its elements.
+ */
+static int test_vec_small(isl_ctx *ctx)
+{
+	int i;
+	isl_vec *vec;
+	int ok = 1;
+
+	vec = isl_vec_alloc(ctx, 3);
+	for (i = 0; i < 3; ++i)
+		vec = isl_vec_set_element_si(vec, i, 1 + i);
+	vec = isl_vec_zero_extend(vec, ISL_VEC_SMALL_SIZE);
+	vec = isl_vec_zero_extend(vec, 2 * ISL_VEC_SMALL_SIZE);
+	if (!vec)
+		return -1;
+	for (i = 0; i < vec->size; ++i)
+		if (isl_int_cmp_si(vec->el[i], i < 3 ? 1 + i : 0))
+			ok = 0;
+	isl_vec_free(vec);
 
-	isl_basic_set_free(bset1);
-	isl_basic_set_free(bset2);
-	free(filename);
+	if (!ok)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected vector elements", return -1);
+	return 0;
+}
 
-	fclose(input);
+/* Check that an allocation that would exceed the memory bound
+ * set by isl_ctx_set_max_memory fails with an isl_error_quota error and
+ * that the peak memory usage is tracked.
+ */
+static int test_max_memory(isl_ctx *ctx)
+{
+	int on_error;
+	isl_vec *vec;
+	enum isl_error error;
+
+	vec = isl_vec_alloc(ctx, 20000);
+	isl_vec_free(vec);
+	if (!vec)
+		return -1;
+	if (isl_ctx_get_stat(ctx, "peak_memory") < 20000 * sizeof(isl_int))
+		isl_die(ctx, isl_error_unknown,
+			"peak memory not tracked", return -1);
+
+	on_error = isl_options_get_on_error(ctx);
+	isl_options_set_on_error(ctx, ISL_ON_ERROR_CONTINUE);
+	isl_ctx_set_max_memory(ctx, isl_ctx_get_stat(ctx, "memory") + 1);
+	vec = isl_vec_alloc(ctx, 100000);
+	error = isl_ctx_last_error(ctx);
+	isl_vec_free(vec);
+	isl_ctx_set_max_memory(ctx, 0);
+	isl_ctx_reset_error(ctx);
+	isl_options_set_on_error(ctx, on_error);
+
+	if (vec)
+		isl_die(ctx, isl_error_unknown,
+			"memory bound not enforced", return -1);
+	if (error != isl_error_quota)
+		isl_die(ctx, isl_error_unknown,
+			"expecting quota error", return -1);
+
+	return 0;
 }
 
-int test_affine_hull(struct isl_ctx *ctx)
+/* Check that a computation fails with an isl_error_timeout error
+ * after the deadline set by isl_ctx_set_deadline has passed and
+ * with an isl_error_abort error after isl_ctx_abort has been called.
+ * The deadline of 1ms is bound to expire while computing
+ * the lexicographic minimum of a set with a large number of disjuncts.
+ */
+static int test_deadline(isl_ctx *ctx)
 {
-	const char *str;
+	int on_error;
 	isl_set *set;
-	isl_basic_set *bset, *bset2;
-	int n;
-	int subset;
-
-	test_affine_hull_case(ctx, "affine2");
-	test_affine_hull_case(ctx, "affine");
-	test_affine_hull_case(ctx, "affine3");
+	enum isl_error error, abort_error;
+	const char *str;
 
-	str = "[m] -> { [i0] : exists (e0, e1: e1 <= 1 + i0 and "
-			"m >= 3 and 4i0 <= 2 + m and e1 >= i0 and "
-			"e1 >= 0 and e1 <= 2 and e1 >= 1 + 2e0 and "
-			"2e1 <= 1 + m + 4e0 and 2e1 >= 2 - m + 4i0 - 4e0) }";
+	str = "[n] -> { [i, j] : 0 <= i, j <= n and (i mod 3 = 0 or "
+		"j mod 5 = 0 or (i + j) mod 7 = 0) }";
+	on_error = isl_options_get_on_error(ctx);
+	isl_options_set_on_error(ctx, ISL_ON_ERROR_CONTINUE);
+	isl_ctx_set_deadline(ctx, 1);
 	set = isl_set_read_from_str(ctx, str);
-	bset = isl_set_affine_hull(set);
-	n = isl_basic_set_dim(bset, isl_dim_div);
-	isl_basic_set_free(bset);
-	if (n != 0)
-		isl_die(ctx, isl_error_unknown, "not expecting any divs",
-			return -1);
+	while (set) {
+		set = isl_set_lexmin(isl_set_union(set,
+			isl_set_read_from_str(ctx, str)));
+		set = isl_set_coalesce(isl_set_union(set,
+			isl_set_read_from_str(ctx, str)));
+	}
+	error = isl_ctx_last_error(ctx);
+	isl_ctx_set_deadline(ctx, 0);
+	isl_ctx_reset_error(ctx);
 
-	/* Check that isl_map_affine_hull is not confused by
-	 * the reordering of divs in isl_map_align_divs.
-	 */
-	str = "{ [a, b, c, 0] : exists (e0 = [(b)/32], e1 = [(c)/32]: "
-				"32e0 = b and 32e1 = c); "
-		"[a, 0, c, 0] : exists (e0 = [(c)/32]: 32e0 = c) }";
+	isl_ctx_abort(ctx);
 	set = isl_set_read_from_str(ctx, str);
-	bset = isl_set_affine_hull(set);
-	isl_basic_set_free(bset);
-	if (!bset)
-		return -1;
+	abort_error = isl_ctx_last_error(ctx);
+	isl_set_free(set);
+	isl_ctx_resume(ctx);
+	isl_ctx_reset_error(ctx);
+	isl_options_set_on_error(ctx, on_error);
+
+	if (error != isl_error_timeout)
+		isl_die(ctx, isl_error_unknown,
+			"expecting timeout error", return -1);
+	if (set || abort_error != isl_error_abort)
+		isl_die(ctx, isl_error_unknown,
+			"expecting abort error", return -1);
 
-	str = "{ [a] : exists e0, e1, e2: 32e1 = 31 + 31a + 31e0 and "
-			"32e2 = 31 + 31e0 }";
 	set = isl_set_read_from_str(ctx, str);
-	bset = isl_set_affine_hull(set);
-	str = "{ [a] : exists e : a = 32 e }";
-	bset2 = isl_basic_set_read_from_str(ctx, str);
-	subset = isl_basic_set_is_subset(bset, bset2);
-	isl_basic_set_free(bset);
-	isl_basic_set_free(bset2);
-	if (subset < 0)
+	isl_set_free(set);
+	if (!set)
 		return -1;
-	if (!subset)
-		isl_die(ctx, isl_error_unknown, "not as accurate as expected",
-			return -1);
 
 	return 0;
 }
 
-void test_convex_hull_case(struct isl_ctx *ctx, const char *name)
+/* Check that a worker isl_ctx allocated by isl_ctx_alloc_worker
+ * does not create threads of its own, only receives the remaining part
+ * of the operation limit of its parent, fails once the parent is aborted and
+ * that its operations and statistics are added to those of its parent
+ * when it is freed through isl_ctx_free_worker.
+ */
+static int test_worker_ctx(isl_ctx *ctx)
 {
-	char *filename;
-	FILE *input;
-	struct isl_basic_set *bset1, *bset2;
-	struct isl_set *set;
+	isl_ctx *worker;
+	isl_set *set;
+	int threads;
+	unsigned long max_operations, operations, worker_operations;
+	long pivots, worker_pivots;
+	enum isl_error abort_error;
+	int ok;
 
-	filename = get_filename(ctx, name, "polylib");
-	assert(filename);
-	input = fopen(filename, "r");
-	assert(input);
+	threads = isl_options_get_threads(ctx);
+	isl_options_set_threads(ctx, 4);
+	max_operations = isl_ctx_get_max_operations(ctx);
+	isl_ctx_set_max_operations(ctx, ctx->operations + 1000000);
+	worker = isl_ctx_alloc_worker(ctx);
+	isl_ctx_set_max_operations(ctx, max_operations);
+	isl_options_set_threads(ctx, threads);
+	if (!worker)
+		return -1;
+	ok = isl_options_get_threads(worker) == 1 &&
+	    isl_ctx_get_max_operations(worker) == 1000000;
+
+	set = isl_set_read_from_str(worker,
+			"{ [i, j] : 0 <= i, j <= 10 and i + j >= 3 }");
+	set = isl_set_lexmin(set);
+	isl_set_free(set);
+	if (!set)
+		ok = -1;
 
-	bset1 = isl_basic_set_read_from_file(ctx, input);
-	bset2 = isl_basic_set_read_from_file(ctx, input);
+	isl_options_set_on_error(worker, ISL_ON_ERROR_CONTINUE);
+	isl_ctx_abort(ctx);
+	set = isl_set_read_from_str(worker, "{ [i] : 0 <= i <= 10 }");
+	abort_error = isl_ctx_last_error(worker);
+	isl_set_free(set);
+	isl_ctx_resume(ctx);
+	if (set || abort_error != isl_error_abort)
+		ok = 0;
+
+	operations = ctx->operations;
+	worker_operations = worker->operations;
+	pivots = isl_ctx_get_stat(ctx, "pivots");
+	worker_pivots = isl_ctx_get_stat(worker, "pivots");
+	isl_ctx_free_worker(ctx, worker);
+	if (ok < 0)
+		return -1;
+	if (!ok)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected worker limits or options", return -1);
+	if (ctx->operations != operations + worker_operations ||
+	    isl_ctx_get_stat(ctx, "pivots") != pivots + worker_pivots)
+		isl_die(ctx, isl_error_unknown,
+			"worker statistics not merged", return -1);
 
-	set = isl_basic_set_union(bset1, bset2);
-	bset1 = isl_set_convex_hull(set);
+	return 0;
+}
 
-	bset2 = isl_basic_set_read_from_file(ctx, input);
+/* Mark item "i" as handled in the array pointed to by "user",
+ * failing on item 5 if the array is NULL.
+ */
+static int mark_item(struct isl_thread_worker *worker, int i, void *user)
+{
+	int *handled = user;
 
-	assert(isl_basic_set_is_equal(bset1, bset2) == 1);
+	if (!handled && i == 5)
+		isl_die(isl_thread_worker_get_ctx(worker), isl_error_invalid,
+			"item rejected", return -1);
+	if (handled)
+		handled[i] = 1;
+	return 0;
+}
 
-	isl_basic_set_free(bset1);
-	isl_basic_set_free(bset2);
-	free(filename);
+/* Executor for test_thread_run that runs the "n" tasks one after
+ * the other and records the number of tasks in the integer
+ * pointed to by "user".
+ */
+static int sequential_execute(int n, void (*task)(int i, void *data),
+	void *data, void *user)
+{
+	int i;
+	int *n_task = user;
 
-	fclose(input);
+	*n_task = n;
+	for (i = 0; i < n; ++i)
+		task(i, data);
+
+	return 0;
 }
 
-struct {
-	const char *set;
-	const char *hull;
-} convex_hull_tests[] = {
-	{ "{ [i0, i1, i2] : (i2 = 1 and i0 = 0 and i1 >= 0) or "
-	       "(i0 = 1 and i1 = 0 and i2 = 1) or "
-	       "(i0 = 0 and i1 = 0 and i2 = 0) }",
-	  "{ [i0, i1, i2] : i0 >= 0 and i2 >= i0 and i2 <= 1 and i1 >= 0 }" },
-	{ "[n] -> { [i0, i1, i0] : i0 <= -4 + n; "
-	    "[i0, i0, i2] : n = 6 and i0 >= 0 and i2 <= 7 - i0 and "
-	    "i2 <= 5 and i2 >= 4; "
-	    "[3, i1, 3] : n = 5 and i1 <= 2 and i1 >= 0 }",
-	  "[n] -> { [i0, i1, i2] : i2 <= -1 + n and 2i2 <= -6 + 3n - i0 and "
-	    "i2 <= 5 + i0 and i2 >= i0 }" },
-	{ "{ [x, y] : 3y <= 2x and y >= -2 + 2x and 2y >= 2 - x }",
-	    "{ [x, y] : 1 = 0 }" },
-};
+/* Executor for test_thread_run that fails without running any task.
+ */
+static int failing_execute(int n, void (*task)(int i, void *data),
+	void *data, void *user)
+{
+	return -1;
+}
 
-void test_convex_hull_algo(struct isl_ctx *ctx, int convex)
+/* Check that isl_thread_run with "threads" threads
+ * handles each of 20 items.
+ */
+static int check_thread_run(isl_ctx *ctx, int threads)
 {
 	int i;
-	int orig_convex = ctx->opt->convex;
-	ctx->opt->convex = convex;
+	int handled[20] = { 0 };
 
-	test_convex_hull_case(ctx, "convex0");
-	test_convex_hull_case(ctx, "convex1");
-	test_convex_hull_case(ctx, "convex2");
-	test_convex_hull_case(ctx, "convex3");
-	test_convex_hull_case(ctx, "convex4");
-	test_convex_hull_case(ctx, "convex5");
-	test_convex_hull_case(ctx, "convex6");
-	test_convex_hull_case(ctx, "convex7");
-	test_convex_hull_case(ctx, "convex8");
-	test_convex_hull_case(ctx, "convex9");
-	test_convex_hull_case(ctx, "convex10");
-	test_convex_hull_case(ctx, "convex11");
-	test_convex_hull_case(ctx, "convex12");
-	test_convex_hull_case(ctx, "convex13");
-	test_convex_hull_case(ctx, "convex14");
-	test_convex_hull_case(ctx, "convex15");
+	isl_options_set_threads(ctx, threads);
+	if (isl_thread_run(ctx, 20, &mark_item, handled) < 0)
+		return -1;
+	for (i = 0; i < 20; ++i)
+		if (!handled[i])
+			isl_die(ctx, isl_error_unknown,
+				"item not handled", return -1);
 
-	for (i = 0; i < ARRAY_SIZE(convex_hull_tests); ++i) {
-		isl_set *set1, *set2;
+	return 0;
+}
 
-		set1 = isl_set_read_from_str(ctx, convex_hull_tests[i].set);
-		set2 = isl_set_read_from_str(ctx, convex_hull_tests[i].hull);
-		set1 = isl_set_from_basic_set(isl_set_convex_hull(set1));
-		assert(isl_set_is_equal(set1, set2));
-		isl_set_free(set1);
-		isl_set_free(set2);
+/* Check that isl_thread_run handles each item, using the default
+ * executor, an executor set by the user and an executor that fails,
+ * in which case the items are handled by the calling thread, and
+ * that the error of a failing worker is passed on to the caller.
+ */
+static int test_thread_run(isl_ctx *ctx)
+{
+	int r, on_error, threads;
+	int n_task = 0;
+	enum isl_error error;
+
+	threads = isl_options_get_threads(ctx);
+	r = check_thread_run(ctx, 4);
+	if (r >= 0)
+		r = check_thread_run(ctx, 4);
+	if (r >= 0) {
+		isl_ctx_set_thread_executor(ctx, &sequential_execute, &n_task);
+		r = check_thread_run(ctx, 3);
+		isl_ctx_set_thread_executor(ctx, &failing_execute, NULL);
+		if (r >= 0)
+			r = check_thread_run(ctx, 3);
+		isl_ctx_set_thread_executor(ctx, NULL, NULL);
+	}
+	if (r < 0) {
+		isl_options_set_threads(ctx, threads);
+		return -1;
 	}
+	if (n_task != 3)
+		isl_die(ctx, isl_error_unknown,
+			"executor not used", goto error);
+
+	on_error = isl_options_get_on_error(ctx);
+	isl_options_set_on_error(ctx, ISL_ON_ERROR_CONTINUE);
+	isl_options_set_threads(ctx, 4);
+	r = isl_thread_run(ctx, 20, &mark_item, NULL);
+	error = isl_ctx_last_error(ctx);
+	isl_ctx_reset_error(ctx);
+	isl_options_set_on_error(ctx, on_error);
+	if (r >= 0 || error != isl_error_invalid)
+		isl_die(ctx, isl_error_unknown,
+			"worker error not passed on", goto error);
 
-	ctx->opt->convex = orig_convex;
+	isl_options_set_threads(ctx, threads);
+	return 0;
+error:
+	isl_options_set_threads(ctx, threads);
+	return -1;
 }
 
-void test_convex_hull(struct isl_ctx *ctx)
+/* Is the integer pointed to by "entry" equal to the one pointed to by "val"?
+ */
+static int int_equal(const void *entry, const void *val)
 {
-	test_convex_hull_algo(ctx, ISL_CONVEX_HULL_FM);
-	test_convex_hull_algo(ctx, ISL_CONVEX_HULL_WRAP);
+	return *(const int *) entry == *(const int *) val;
 }
 
-void test_gist_case(struct isl_ctx *ctx, const char *name)
+/* Return a hash value for "v" that only takes on a few different values
+ * such that the runs of occupied positions in the hash table
+ * are long and contain entries with many different home positions.
+ */
+static uint32_t int_hash(int v)
 {
-	char *filename;
-	FILE *input;
-	struct isl_basic_set *bset1, *bset2;
+	return (v % 37) * 0x9e3779b1u;
+}
 
-	filename = get_filename(ctx, name, "polylib");
-	assert(filename);
-	input = fopen(filename, "r");
-	assert(input);
+/* Check that all elements of "val" that have not been removed are found
+ * in "table", while the removed elements are not found.
+ * The elements that have been removed are those at positions
+ * that are a multiple of "step", if "step" is positive.
+ */
+static int check_hash_table(isl_ctx *ctx, struct isl_hash_table *table,
+	int *val, int n, int step)
+{
+	int i;
 
-	bset1 = isl_basic_set_read_from_file(ctx, input);
-	bset2 = isl_basic_set_read_from_file(ctx, input);
+	for (i = 0; i < n; ++i) {
+		struct isl_hash_table_entry *entry;
+		int removed = step > 0 && i % step == 0;
 
-	bset1 = isl_basic_set_gist(bset1, bset2);
+		entry = isl_hash_table_find(ctx, table, int_hash(val[i]),
+					    &int_equal, &val[i], 0);
+		if (removed && entry)
+			isl_die(ctx, isl_error_unknown,
+				"removed element still found", return -1);
+		if (!removed && (!entry || entry->data != &val[i]))
+			isl_die(ctx, isl_error_unknown,
+				"element not found", return -1);
+	}
 
-	bset2 = isl_basic_set_read_from_file(ctx, input);
+	return 0;
+}
 
-	assert(isl_basic_set_is_equal(bset1, bset2) == 1);
+/* Check that isl_hash_table_find and isl_hash_table_remove
+ * keep all elements reachable, in particular in the presence
+ * of many collisions.
+ * Also check that an entry that is reserved, but not filled in,
+ * does not prevent any of the other elements from being found.
+ */
+static int test_hash_table(isl_ctx *ctx)
+{
+	int i;
+	int val[1000];
+	int n = sizeof(val) / sizeof(val[0]);
+	int extra = n;
+	struct isl_hash_table *table;
+	struct isl_hash_table_entry *reserved;
+	int r = -1;
+
+	table = isl_hash_table_alloc(ctx, 0);
+	if (!table)
+		return -1;
+	for (i = 0; i < n; ++i) {
+		struct isl_hash_table_entry *entry;
+
+		val[i] = i;
+		entry = isl_hash_table_find(ctx, table, int_hash(val[i]),
+					    &int_equal, &val[i], 1);
+		if (!entry)
+			goto error;
+		entry->data = &val[i];
+	}
+	if (check_hash_table(ctx, table, val, n, 0) < 0)
+		goto error;
+	reserved = isl_hash_table_find(ctx, table, int_hash(extra),
+					&int_equal, &extra, 1);
+	if (!reserved)
+		goto error;
+	if (check_hash_table(ctx, table, val, n, 0) < 0)
+		goto error;
+	isl_hash_table_remove(ctx, table, reserved);
+	for (i = 0; i < n; i += 3) {
+		struct isl_hash_table_entry *entry;
 
-	isl_basic_set_free(bset1);
-	isl_basic_set_free(bset2);
-	free(filename);
+		entry = isl_hash_table_find(ctx, table, int_hash(val[i]),
+					    &int_equal, &val[i], 0);
+		isl_hash_table_remove(ctx, table, entry);
+	}
+	if (table->n != n - (n + 2) / 3)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of elements", goto error);
+	if (check_hash_table(ctx, table, val, n, 3) < 0)
+		goto error;
 
-	fclose(input);
+	r = 0;
+error:
+	isl_hash_table_free(ctx, table);
+	return r;
 }
 
-struct {
-	const char *set;
-	const char *context;
-	const char *gist;
-} gist_tests[] = {
-	{ "{ [a, b, c] : a <= 15 and a >= 1 }",
-	  "{ [a, b, c] : exists (e0 = floor((-1 + a)/16): a >= 1 and "
-			"c <= 30 and 32e0 >= -62 + 2a + 2b - c and b >= 0) }",
-	  "{ [a, b, c] : a <= 15 }" },
-	{ "{ : }", "{ : 1 = 0 }", "{ : }" },
-	{ "{ : 1 = 0 }", "{ : 1 = 0 }", "{ : }" },
-};
+/* Check that the value associated to the identifier called "name"
+ * in "hmap" is "i" if "present" is set and that there is
+ * no such value otherwise.
+ */
+static int check_id_to_pw_aff(__isl_keep isl_id_to_pw_aff *hmap,
+	const char *name, int i, int present)
+{
+	isl_ctx *ctx = isl_id_to_pw_aff_get_ctx(hmap);
+	isl_pw_aff *pa, *expected;
+	char str[20];
+	int ok;
 
-static int test_gist(struct isl_ctx *ctx)
+	pa = isl_id_to_pw_aff_get(hmap, isl_id_alloc(ctx, name, NULL));
+	if (!present) {
+		isl_pw_aff_free(pa);
+		if (pa)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected value", return -1);
+		return 0;
+	}
+	if (!pa)
+		return -1;
+	snprintf(str, sizeof(str), "{ [%d] }", i);
+	expected = isl_pw_aff_read_from_str(ctx, str);
+	ok = isl_pw_aff_plain_is_equal(pa, expected);
+	isl_pw_aff_free(pa);
+	isl_pw_aff_free(expected);
+	if (ok < 0)
+		return -1;
+	if (!ok)
+		isl_die(ctx, isl_error_unknown, "unexpected value", return -1);
+	return 0;
+}
+
+/* Return an associative array that maps identifiers "prefix%d"
+ * to the constant %d, for %d ranging from "first" to "last".
+ */
+static __isl_give isl_id_to_pw_aff *id_to_pw_aff_range(isl_ctx *ctx,
+	const char *prefix, int first, int last)
 {
 	int i;
-	const char *str;
-	isl_basic_set *bset1, *bset2;
-	isl_map *map1, *map2;
-	int equal;
+	isl_id_to_pw_aff *hmap;
+
+	hmap = isl_id_to_pw_aff_alloc(ctx, 0);
+	for (i = first; i <= last; ++i) {
+		char name[20], str[20];
+		isl_pw_aff *pa;
+
+		snprintf(name, sizeof(name), "%s%d", prefix, i);
+		snprintf(str, sizeof(str), "{ [%d] }", i);
+		pa = isl_pw_aff_read_from_str(ctx, str);
+		hmap = isl_id_to_pw_aff_set(hmap,
+					isl_id_alloc(ctx, name, NULL), pa);
+	}
 
-	for (i = 0; i < ARRAY_SIZE(gist_tests); ++i) {
-		bset1 = isl_basic_set_read_from_str(ctx, gist_tests[i].set);
-		bset2 = isl_basic_set_read_from_str(ctx, gist_tests[i].context);
-		bset1 = isl_basic_set_gist(bset1, bset2);
-		bset2 = isl_basic_set_read_from_str(ctx, gist_tests[i].gist);
-		equal = isl_basic_set_is_equal(bset1, bset2);
-		isl_basic_set_free(bset1);
-		isl_basic_set_free(bset2);
-		if (equal < 0)
+	return hmap;
+}
+
+/* Check the basic operations on associative arrays,
+ * on arrays that are small enough to be stored without a hash table and
+ * on arrays that are large enough to require a hash table.
+ */
+static int test_hmap(isl_ctx *ctx)
+{
+	int i;
+	isl_id_to_pw_aff *hmap, *hmap2;
+	isl_pw_aff *pa;
+	int n[] = { 3, 20 };
+
+	for (i = 0; i < 2; ++i) {
+		int j;
+		char name[20];
+
+		hmap = id_to_pw_aff_range(ctx, "a", 0, n[i] - 1);
+		hmap = isl_id_to_pw_aff_drop(hmap,
+					isl_id_alloc(ctx, "a1", NULL));
+		hmap = isl_id_to_pw_aff_take(hmap,
+				isl_id_alloc(ctx, "a2", NULL), &pa);
+		if (!pa)
+			hmap = isl_id_to_pw_aff_free(hmap);
+		isl_pw_aff_free(pa);
+		hmap2 = isl_id_to_pw_aff_copy(hmap);
+		hmap2 = isl_id_to_pw_aff_set_all(hmap2,
+				id_to_pw_aff_range(ctx, "b", 0, n[i] - 1));
+		for (j = 0; j < n[i]; ++j) {
+			int present = j != 1 && j != 2;
+
+			snprintf(name, sizeof(name), "a%d", j);
+			if (check_id_to_pw_aff(hmap, name, j, present) < 0 ||
+			    check_id_to_pw_aff(hmap2, name, j, present) < 0)
+				break;
+			snprintf(name, sizeof(name), "b%d", j);
+			if (check_id_to_pw_aff(hmap, name, j, 0) < 0 ||
+			    check_id_to_pw_aff(hmap2, name, j, 1) < 0)
+				break;
+		}
+		isl_id_to_pw_aff_free(hmap);
+		isl_id_to_pw_aff_free(hmap2);
+		if (j < n[i])
 			return -1;
-		if (!equal)
-			isl_die(ctx, isl_error_unknown,
-				"incorrect gist result", return -1);
 	}
 
-	test_gist_case(ctx, "gist1");
+	return 0;
+}
 
-	str = "[p0, p2, p3, p5, p6, p10] -> { [] : "
-	    "exists (e0 = [(15 + p0 + 15p6 + 15p10)/16], e1 = [(p5)/8], "
-	    "e2 = [(p6)/128], e3 = [(8p2 - p5)/128], "
-	    "e4 = [(128p3 - p6)/4096]: 8e1 = p5 and 128e2 = p6 and "
-	    "128e3 = 8p2 - p5 and 4096e4 = 128p3 - p6 and p2 >= 0 and "
-	    "16e0 >= 16 + 16p6 + 15p10 and  p2 <= 15 and p3 >= 0 and "
-	    "p3 <= 31 and  p6 >= 128p3 and p5 >= 8p2 and p10 >= 0 and "
-	    "16e0 <= 15 + p0 + 15p6 + 15p10 and 16e0 >= p0 + 15p6 + 15p10 and "
-	    "p10 <= 15 and p10 <= -1 + p0 - p6) }";
-	bset1 = isl_basic_set_read_from_str(ctx, str);
-	str = "[p0, p2, p3, p5, p6, p10] -> { [] : exists (e0 = [(p5)/8], "
-	    "e1 = [(p6)/128], e2 = [(8p2 - p5)/128], "
-	    "e3 = [(128p3 - p6)/4096]: 8e0 = p5 and 128e1 = p6 and "
-	    "128e2 = 8p2 - p5 and 4096e3 = 128p3 - p6 and p5 >= -7 and "
-	    "p2 >= 0 and 8p2 <= -1 + p0 and p2 <= 15 and p3 >= 0 and "
-	    "p3 <= 31 and 128p3 <= -1 + p0 and p6 >= -127 and "
-	    "p5 <= -1 + p0 and p6 <= -1 + p0 and p6 >= 128p3 and "
-	    "p0 >= 1 and p5 >= 8p2 and p10 >= 0 and p10 <= 15 ) }";
-	bset2 = isl_basic_set_read_from_str(ctx, str);
-	bset1 = isl_basic_set_gist(bset1, bset2);
-	assert(bset1 && bset1->n_div == 0);
-	isl_basic_set_free(bset1);
+/* Check that the profile collected when the "profile" option is set
+ * records the nesting of the profiled entry points.
+ * In particular, AST generation coalesces the schedule, so
+ * isl_map_coalesce should appear (indented) below
+ * isl_ast_build_ast_from_schedule.
+ * The "profile_allocations" option is turned off during the test
+ * since it adds allocation counts to the profile.
+ */
+static int test_profile(isl_ctx *ctx)
+{
+	int profile, allocations;
+	isl_set *set;
+	isl_union_map *schedule;
+	isl_ast_build *build;
+	isl_ast_node *tree;
+	char *str;
+	int ok;
 
-	/* Check that the integer divisions of the second disjunct
-	 * do not spread to the first disjunct.
-	 */
-	str = "[t1] -> { S_0[] -> A[o0] : (exists (e0 = [(-t1 + o0)/16]: "
-		"16e0 = -t1 + o0 and o0 >= 0 and o0 <= 15 and t1 >= 0)) or "
-		"(exists (e0 = [(-1 + t1)/16], "
-			"e1 = [(-16 + t1 - 16e0)/4294967296]: "
-			"4294967296e1 = -16 + t1 - o0 - 16e0 and "
-			"16e0 <= -1 + t1 and 16e0 >= -16 + t1 and o0 >= 0 and "
-			"o0 <= 4294967295 and t1 <= -1)) }";
-	map1 = isl_map_read_from_str(ctx, str);
-	str = "[t1] -> { S_0[] -> A[o0] : t1 >= 0 and t1 <= 4294967295 }";
-	map2 = isl_map_read_from_str(ctx, str);
-	map1 = isl_map_gist(map1, map2);
-	if (!map1)
+	profile = isl_options_get_profile(ctx);
+	allocations = isl_options_get_profile_allocations(ctx);
+	isl_options_set_profile(ctx, 1);
+	isl_options_set_profile_allocations(ctx, 0);
+	isl_ctx_reset_profile(ctx);
+	set = isl_set_read_from_str(ctx, "[N] -> { : N >= 10 }");
+	schedule = isl_union_map_read_from_str(ctx,
+		"[N] -> { A[i] -> [i] : 0 <= i <= N; B[i] -> [i] : 0 <= i < N }");
+	build = isl_ast_build_from_context(set);
+	tree = isl_ast_build_ast_from_schedule(build, schedule);
+	isl_ast_build_free(build);
+	isl_ast_node_free(tree);
+	isl_options_set_profile(ctx, profile);
+	isl_options_set_profile_allocations(ctx, allocations);
+	str = isl_ctx_profile_to_str(ctx);
+	isl_ctx_reset_profile(ctx);
+	if (!tree || !str) {
+		free(str);
 		return -1;
-	if (map1->n != 1)
-		isl_die(ctx, isl_error_unknown, "expecting single disjunct",
-			isl_map_free(map1); return -1);
-	if (isl_basic_map_dim(map1->p[0], isl_dim_div) != 1)
-		isl_die(ctx, isl_error_unknown, "expecting single div",
-			isl_map_free(map1); return -1);
+	}
+
+	ok = !strncmp(str, "isl_ast_build_ast_from_schedule: 1 calls",
+			strlen("isl_ast_build_ast_from_schedule: 1 calls")) &&
+	     strstr(str, "\n  isl_map_coalesce: ") != NULL;
+	free(str);
+	if (!ok)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected profile", return -1);
+
+	str = isl_ctx_profile_to_str(ctx);
+	ok = str && !strcmp(str, "");
+	free(str);
+	if (!ok)
+		isl_die(ctx, isl_error_unknown,
+			"profile not reset", return -1);
+
+	return 0;
+}
+
+/* Check that the allocations performed by isl_map_subtract
+ * are counted per type when the "profile_allocations" option is set.
+ * In particular, subtraction allocates tableaus.
+ * The "profile" option is turned off during the test
+ * such that only the entry points of the subtraction itself
+ * are profiled.
+ */
+static int test_profile_allocations(isl_ctx *ctx)
+{
+	int profile, timing;
+	isl_map *map1, *map2;
+	char *str;
+	int ok;
+
+	profile = isl_options_get_profile_allocations(ctx);
+	timing = isl_options_get_profile(ctx);
+	isl_options_set_profile_allocations(ctx, 1);
+	isl_options_set_profile(ctx, 0);
+	isl_ctx_reset_profile(ctx);
+	map1 = isl_map_read_from_str(ctx, "{ [i] -> [j] : 0 <= i, j <= 10 }");
+	map2 = isl_map_read_from_str(ctx, "{ [i] -> [j] : i = j }");
+	map1 = isl_map_subtract(map1, map2);
 	isl_map_free(map1);
+	str = isl_ctx_profile_to_str(ctx);
+	isl_options_set_profile_allocations(ctx, profile);
+	isl_options_set_profile(ctx, timing);
+	isl_ctx_reset_profile(ctx);
+	if (!map1 || !str) {
+		free(str);
+		return -1;
+	}
+
+	ok = strstr(str, "\nisl_map_subtract: 1 calls") != NULL &&
+	     strstr(str, "\n  allocated struct isl_tab: ") != NULL &&
+	     strstr(str, "\n  allocation sizes: ") != NULL;
+	free(str);
+	if (!ok)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected allocation profile", return -1);
 
 	return 0;
 }
 
-int test_coalesce_set(isl_ctx *ctx, const char *str, int check_one)
+/* Internal data structure for test_trace.
+ *
+ * "depth" is the current nesting depth of the trace events.
+ * "error" is set if an end event does not match its begin event or
+ * if the timestamps are not monotonically increasing.
+ * "coalesce" is set if a coalescing of two disjuncts was traced.
+ */
+struct isl_test_trace_data {
+	int depth;
+	int error;
+	int coalesce;
+	double timestamp;
+	const char *name[10];
+};
+
+/* Record the event described by "name", "begin", "timestamp" and "args"
+ * in the isl_test_trace_data "user".
+ */
+static void trace_event(const char *name, int begin, double timestamp,
+	const char *args, void *user)
 {
-	isl_set *set, *set2;
-	int equal;
-	int one;
+	struct isl_test_trace_data *data = user;
+
+	if (timestamp < data->timestamp)
+		data->error = 1;
+	data->timestamp = timestamp;
+	if (!strcmp(name, "coalesce") &&
+	    !strcmp(args, "{\"dim\": 1, \"n\": 2}"))
+		data->coalesce = 1;
+	if (begin) {
+		if (data->depth < 10)
+			data->name[data->depth] = name;
+		data->depth++;
+		return;
+	}
+	data->depth--;
+	if (data->depth < 0 ||
+	    (data->depth < 10 && strcmp(data->name[data->depth], name)))
+		data->error = 1;
+}
 
-	set = isl_set_read_from_str(ctx, str);
-	set = isl_set_coalesce(set);
-	set2 = isl_set_read_from_str(ctx, str);
-	equal = isl_set_is_equal(set, set2);
-	one = set && set->n == 1;
-	isl_set_free(set);
-	isl_set_free(set2);
+/* Count the begin events of the coalescing of two one-dimensional
+ * disjuncts in the integer pointed to by "user".
+ */
+static void count_coalesce(const char *name, int begin, double timestamp,
+	const char *args, void *user)
+{
+	int *n = user;
 
-	if (equal < 0)
+	if (begin && !strcmp(name, "coalesce") &&
+	    !strcmp(args, "{\"dim\": 1, \"n\": 2}"))
+		(*n)++;
+}
+
+/* Check that the events of the coalescing of the sets in
+ * a union set, which is performed by the workers when using
+ * several threads, are passed on to the trace callback of "ctx".
+ */
+static int test_trace_threads(isl_ctx *ctx)
+{
+	int n = 0;
+	int threads;
+	isl_union_set *uset;
+
+	threads = isl_options_get_threads(ctx);
+	isl_options_set_threads(ctx, 2);
+	isl_ctx_set_trace_callback(ctx, &count_coalesce, &n);
+	uset = isl_union_set_read_from_str(ctx,
+		"{ A[i] : 0 <= i <= 10 or 5 <= i <= 20; "
+		"B[i] : 0 <= i <= 10 or 5 <= i <= 20 }");
+	uset = isl_union_set_coalesce(uset);
+	isl_ctx_set_trace_callback(ctx, NULL, NULL);
+	isl_options_set_threads(ctx, threads);
+	isl_union_set_free(uset);
+	if (!uset)
 		return -1;
-	if (!equal)
-		isl_die(ctx, isl_error_unknown,
-			"coalesced set not equal to input", return -1);
-	if (check_one && !one)
+
+	if (n != 2)
 		isl_die(ctx, isl_error_unknown,
-			"coalesced set should not be a union", return -1);
+			"coalescing in workers not traced", return -1);
 
 	return 0;
 }
 
-int test_coalesce_unbounded_wrapping(isl_ctx *ctx)
+/* Check that the begin and end events reported to the trace callback
+ * are properly nested and that they include the expected summary
+ * of the input of the coalescing, also when it is performed
+ * by the workers.
+ */
+static int test_trace(isl_ctx *ctx)
 {
-	int r = 0;
-	int bounded;
+	struct isl_test_trace_data data = { 0 };
+	isl_set *set;
 
-	bounded = isl_options_get_coalesce_bounded_wrapping(ctx);
-	isl_options_set_coalesce_bounded_wrapping(ctx, 0);
+	isl_ctx_set_trace_callback(ctx, &trace_event, &data);
+	set = isl_set_read_from_str(ctx,
+				"{ [i] : 0 <= i <= 10 or 5 <= i <= 20 }");
+	set = isl_set_coalesce(set);
+	set = isl_set_lexmin(set);
+	isl_ctx_set_trace_callback(ctx, NULL, NULL);
+	isl_set_free(set);
+	if (!set)
+		return -1;
 
-	if (test_coalesce_set(ctx,
-		"{[x,y,z] : y + 2 >= 0 and x - y + 1 >= 0 and "
-			"-x - y + 1 >= 0 and -3 <= z <= 3;"
-		"[x,y,z] : -x+z + 20 >= 0 and -x-z + 20 >= 0 and "
-			"x-z + 20 >= 0 and x+z + 20 >= 0 and "
-			"-10 <= y <= 0}", 1) < 0)
-		goto error;
-	if (test_coalesce_set(ctx,
-		"{[x,y] : 0 <= x,y <= 10; [5,y]: 4 <=y <= 11}", 1) < 0)
-		goto error;
-	if (test_coalesce_set(ctx,
-		"{[x,0,0] : -5 <= x <= 5; [0,y,1] : -5 <= y <= 5 }", 1) < 0)
-		goto error;
+	if (data.error || data.depth != 0)
+		isl_die(ctx, isl_error_unknown,
+			"unbalanced trace events", return -1);
+	if (!data.coalesce)
+		isl_die(ctx, isl_error_unknown,
+			"coalescing not traced", return -1);
 
-	if (0) {
-error:
-		r = -1;
-	}
+	return test_trace_threads(ctx);
+}
 
-	isl_options_set_coalesce_bounded_wrapping(ctx, bounded);
+/* Check that released isl_vec and isl_mat objects are reused
+ * by subsequent allocations and that an isl_mat object is only reused
+ * for a matrix with at most as many rows.
+ */
+static int test_free_list(isl_ctx *ctx)
+{
+	isl_vec *vec;
+	isl_mat *mat;
+	long hits;
+
+	vec = isl_vec_alloc(ctx, 5);
+	isl_vec_free(vec);
+	hits = isl_ctx_get_stat(ctx, "free_list_hits");
+	vec = isl_vec_alloc(ctx, 3);
+	isl_vec_free(vec);
+	if (!vec)
+		return -1;
+	if (isl_ctx_get_stat(ctx, "free_list_hits") != hits + 1)
+		isl_die(ctx, isl_error_unknown,
+			"vec free list not used", return -1);
 
-	return r;
+	mat = isl_mat_alloc(ctx, 4, 4);
+	isl_mat_free(mat);
+	hits = isl_ctx_get_stat(ctx, "free_list_hits");
+	mat = isl_mat_alloc(ctx, 3, 5);
+	if (!mat)
+		return -1;
+	isl_mat_free(mat);
+	if (isl_ctx_get_stat(ctx, "free_list_hits") != hits + 1)
+		isl_die(ctx, isl_error_unknown,
+			"mat free list not used", return -1);
+
+	hits = isl_ctx_get_stat(ctx, "free_list_hits");
+	mat = isl_mat_alloc(ctx, 10000, 1);
+	if (!mat)
+		return -1;
+	isl_mat_free(mat);
+	if (isl_ctx_get_stat(ctx, "free_list_hits") != hits)
+		isl_die(ctx, isl_error_unknown,
+			"matrix with too few rows reused", return -1);
+
+	return 0;
 }
 
-/* Inputs for coalescing tests.
- * "str" is a string representation of the input set.
- * "single_disjunct" is set if we expect the result to consist of
- *	a single disjunct.
+/* Perform some basic tests on isl_val objects.
  */
-struct {
-	int single_disjunct;
-	const char *str;
-} coalesce_tests[] = {
-	{ 1, "{[x,y]: x >= 0 & x <= 10 & y >= 0 & y <= 10 or "
-		       "y >= x & x >= 2 & 5 >= y }" },
-	{ 1, "{[x,y]: y >= 0 & 2x + y <= 30 & y <= 10 & x >= 0 or "
-		       "x + y >= 10 & y <= x & x + y <= 20 & y >= 0}" },
-	{ 0, "{[x,y]: y >= 0 & 2x + y <= 30 & y <= 10 & x >= 0 or "
-		       "x + y >= 10 & y <= x & x + y <= 19 & y >= 0}" },
+static int test_val(isl_ctx *ctx)
+{
+	if (test_un_val(ctx) < 0)
+		return -1;
+	if (test_bin_val(ctx) < 0)
+		return -1;
+	return 0;
+}
+
+static int test_div(isl_ctx *ctx)
+{
+	unsigned n;
+	const char *str;
+	int empty;
+	isl_int v;
+	isl_space *dim;
+	isl_set *set;
+	isl_local_space *ls;
+	struct isl_basic_set *bset;
+	struct isl_constraint *c;
+
+	isl_int_init(v);
+
+	/* test 1 */
+	dim = isl_space_set_alloc(ctx, 0, 3);
+	bset = isl_basic_set_universe(isl_space_copy(dim));
+	ls = isl_local_space_from_space(dim);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, -1);
+	isl_constraint_set_constant(c, v);
+	isl_int_set_si(v, 1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, 3);
+	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, 1);
+	isl_constraint_set_constant(c, v);
+	isl_int_set_si(v, -1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, 3);
+	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	bset = isl_basic_set_project_out(bset, isl_dim_set, 1, 2);
+
+	assert(bset && bset->n_div == 1);
+	isl_local_space_free(ls);
+	isl_basic_set_free(bset);
+
+	/* test 2 */
+	dim = isl_space_set_alloc(ctx, 0, 3);
+	bset = isl_basic_set_universe(isl_space_copy(dim));
+	ls = isl_local_space_from_space(dim);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, 1);
+	isl_constraint_set_constant(c, v);
+	isl_int_set_si(v, -1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, 3);
+	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, -1);
+	isl_constraint_set_constant(c, v);
+	isl_int_set_si(v, 1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, 3);
+	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	bset = isl_basic_set_project_out(bset, isl_dim_set, 1, 2);
+
+	assert(bset && bset->n_div == 1);
+	isl_local_space_free(ls);
+	isl_basic_set_free(bset);
+
+	/* test 3 */
+	dim = isl_space_set_alloc(ctx, 0, 3);
+	bset = isl_basic_set_universe(isl_space_copy(dim));
+	ls = isl_local_space_from_space(dim);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, 1);
+	isl_constraint_set_constant(c, v);
+	isl_int_set_si(v, -1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, 3);
+	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, -3);
+	isl_constraint_set_constant(c, v);
+	isl_int_set_si(v, 1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, 4);
+	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	bset = isl_basic_set_project_out(bset, isl_dim_set, 1, 2);
+
+	assert(bset && bset->n_div == 1);
+	isl_local_space_free(ls);
+	isl_basic_set_free(bset);
+
+	/* test 4 */
+	dim = isl_space_set_alloc(ctx, 0, 3);
+	bset = isl_basic_set_universe(isl_space_copy(dim));
+	ls = isl_local_space_from_space(dim);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, 2);
+	isl_constraint_set_constant(c, v);
+	isl_int_set_si(v, -1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, 3);
+	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, -1);
+	isl_constraint_set_constant(c, v);
+	isl_int_set_si(v, 1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, 6);
+	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	bset = isl_basic_set_project_out(bset, isl_dim_set, 1, 2);
+
+	assert(isl_basic_set_is_empty(bset));
+	isl_local_space_free(ls);
+	isl_basic_set_free(bset);
+
+	/* test 5 */
+	dim = isl_space_set_alloc(ctx, 0, 3);
+	bset = isl_basic_set_universe(isl_space_copy(dim));
+	ls = isl_local_space_from_space(dim);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, -1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, 3);
+	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, 1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, -3);
+	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	bset = isl_basic_set_project_out(bset, isl_dim_set, 2, 1);
+
+	assert(bset && bset->n_div == 0);
+	isl_basic_set_free(bset);
+	isl_local_space_free(ls);
+
+	/* test 6 */
+	dim = isl_space_set_alloc(ctx, 0, 3);
+	bset = isl_basic_set_universe(isl_space_copy(dim));
+	ls = isl_local_space_from_space(dim);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, -1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, 6);
+	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, 1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, -3);
+	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	bset = isl_basic_set_project_out(bset, isl_dim_set, 2, 1);
+
+	assert(bset && bset->n_div == 1);
+	isl_basic_set_free(bset);
+	isl_local_space_free(ls);
+
+	/* test 7 */
+	/* This test is a bit tricky.  We set up an equality
+	 *		a + 3b + 3c = 6 e0
+	 * Normalization of divs creates _two_ divs
+	 *		a = 3 e0
+	 *		c - b - e0 = 2 e1
+	 * Afterwards e0 is removed again because it has coefficient -1
+	 * and we end up with the original equality and div again.
+	 * Perhaps we can avoid the introduction of this temporary div.
+	 */
+	dim = isl_space_set_alloc(ctx, 0, 4);
+	bset = isl_basic_set_universe(isl_space_copy(dim));
+	ls = isl_local_space_from_space(dim);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, -1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, -3);
+	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
+	isl_int_set_si(v, -3);
+	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
+	isl_int_set_si(v, 6);
+	isl_constraint_set_coefficient(c, isl_dim_set, 3, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	bset = isl_basic_set_project_out(bset, isl_dim_set, 3, 1);
+
+	/* Test disabled for now */
+	/*
+	assert(bset && bset->n_div == 1);
+	*/
+	isl_local_space_free(ls);
+	isl_basic_set_free(bset);
+
+	/* test 8 */
+	dim = isl_space_set_alloc(ctx, 0, 5);
+	bset = isl_basic_set_universe(isl_space_copy(dim));
+	ls = isl_local_space_from_space(dim);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, -1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, -3);
+	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
+	isl_int_set_si(v, -3);
+	isl_constraint_set_coefficient(c, isl_dim_set, 3, v);
+	isl_int_set_si(v, 6);
+	isl_constraint_set_coefficient(c, isl_dim_set, 4, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, -1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, 1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
+	isl_int_set_si(v, 1);
+	isl_constraint_set_constant(c, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	bset = isl_basic_set_project_out(bset, isl_dim_set, 4, 1);
+
+	/* Test disabled for now */
+	/*
+	assert(bset && bset->n_div == 1);
+	*/
+	isl_local_space_free(ls);
+	isl_basic_set_free(bset);
+
+	/* test 9 */
+	dim = isl_space_set_alloc(ctx, 0, 4);
+	bset = isl_basic_set_universe(isl_space_copy(dim));
+	ls = isl_local_space_from_space(dim);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, 1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, -1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 1, v);
+	isl_int_set_si(v, -2);
+	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, -1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, 3);
+	isl_constraint_set_coefficient(c, isl_dim_set, 3, v);
+	isl_int_set_si(v, 2);
+	isl_constraint_set_constant(c, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	bset = isl_basic_set_project_out(bset, isl_dim_set, 2, 2);
+
+	bset = isl_basic_set_fix_si(bset, isl_dim_set, 0, 2);
+
+	assert(!isl_basic_set_is_empty(bset));
+
+	isl_local_space_free(ls);
+	isl_basic_set_free(bset);
+
+	/* test 10 */
+	dim = isl_space_set_alloc(ctx, 0, 3);
+	bset = isl_basic_set_universe(isl_space_copy(dim));
+	ls = isl_local_space_from_space(dim);
+
+	c = isl_equality_alloc(isl_local_space_copy(ls));
+	isl_int_set_si(v, 1);
+	isl_constraint_set_coefficient(c, isl_dim_set, 0, v);
+	isl_int_set_si(v, -2);
+	isl_constraint_set_coefficient(c, isl_dim_set, 2, v);
+	bset = isl_basic_set_add_constraint(bset, c);
+
+	bset = isl_basic_set_project_out(bset, isl_dim_set, 2, 1);
+
+	bset = isl_basic_set_fix_si(bset, isl_dim_set, 0, 2);
+
+	isl_local_space_free(ls);
+	isl_basic_set_free(bset);
+
+	isl_int_clear(v);
+
+	str = "{ [i] : exists (e0, e1: 3e1 >= 1 + 2e0 and "
+	    "8e1 <= -1 + 5i - 5e0 and 2e1 >= 1 + 2i - 5e0) }";
+	set = isl_set_read_from_str(ctx, str);
+	set = isl_set_compute_divs(set);
+	isl_set_free(set);
+	if (!set)
+		return -1;
+
+	str = "{ [i,j] : 2*[i/2] + 3 * [j/4] <= 10 and 2 i = j }";
+	bset = isl_basic_set_read_from_str(ctx, str);
+	n = isl_basic_set_dim(bset, isl_dim_div);
+	isl_basic_set_free(bset);
+	if (!bset)
+		return -1;
+	if (n != 0)
+		isl_die(ctx, isl_error_unknown,
+			"expecting no existentials", return -1);
+
+	str = "{ [i,j,k] : 3 + i + 2j >= 0 and 2 * [(i+2j)/4] <= k }";
+	set = isl_set_read_from_str(ctx, str);
+	set = isl_set_remove_divs_involving_dims(set, isl_dim_set, 0, 2);
+	set = isl_set_fix_si(set, isl_dim_set, 2, -3);
+	empty = isl_set_is_empty(set);
+	isl_set_free(set);
+	if (empty < 0)
+		return -1;
+	if (!empty)
+		isl_die(ctx, isl_error_unknown,
+			"result not as accurate as expected", return -1);
+
+	return 0;
+}
+
+void test_application_case(struct isl_ctx *ctx, const char *name)
+{
+	char *filename;
+	FILE *input;
+	struct isl_basic_set *bset1, *bset2;
+	struct isl_basic_map *bmap;
+
+	filename = get_filename(ctx, name, "omega");
+	assert(filename);
+	input = fopen(filename, "r");
+	assert(input);
+
+	bset1 = isl_basic_set_read_from_file(ctx, input);
+	bmap = isl_basic_map_read_from_file(ctx, input);
+
+	bset1 = isl_basic_set_apply(bset1, bmap);
+
+	bset2 = isl_basic_set_read_from_file(ctx, input);
+
+	assert(isl_basic_set_is_equal(bset1, bset2) == 1);
+
+	isl_basic_set_free(bset1);
+	isl_basic_set_free(bset2);
+	free(filename);
+
+	fclose(input);
+}
+
+void test_application(struct isl_ctx *ctx)
+{
+	test_application_case(ctx, "application");
+	test_application_case(ctx, "application2");
+}
+
+void test_affine_hull_case(struct isl_ctx *ctx, const char *name)
+{
+	char *filename;
+	FILE *input;
+	struct isl_basic_set *bset1, *bset2;
+
+	filename = get_filename(ctx, name, "polylib");
+	assert(filename);
+	input = fopen(filename, "r");
+	assert(input);
+
+	bset1 = isl_basic_set_read_from_file(ctx, input);
+	bset2 = isl_basic_set_read_from_file(ctx, input);
+
+	bset1 = isl_basic_set_affine_hull(bset1);
+
+	assert(isl_basic_set_is_equal(bset1, bset2) == 1);
+
+	isl_basic_set_free(bset1);
+	isl_basic_set_free(bset2);
+	free(filename);
+
+	fclose(input);
+}
+
+/* Check that the affine hull of a basic set is reused when
+ * it is computed again on a copy of the same basic set and
+ * that it is no longer reused after the basic set has been modified.
+ */
+static int test_affine_hull_cache(isl_ctx *ctx)
+{
+	const char *str;
+	isl_basic_set *bset, *hull1, *hull2, *mod;
+	long hits;
+	int equal;
+
+	str = "{ [i, j] : 0 <= i <= 10 and i <= j <= i and 2j <= 10 + i }";
+	bset = isl_basic_set_read_from_str(ctx, str);
+	hits = isl_ctx_get_stat(ctx, "affine_hull_hits");
+	hull1 = isl_basic_set_affine_hull(isl_basic_set_copy(bset));
+	hull2 = isl_basic_set_affine_hull(isl_basic_set_copy(bset));
+	equal = isl_basic_set_is_equal(hull1, hull2);
+	if (equal >= 0 && isl_ctx_get_stat(ctx, "affine_hull_hits") != hits + 1)
+		isl_die(ctx, isl_error_unknown, "affine hull not reused",
+			equal = -1);
+	isl_basic_set_free(hull1);
+	isl_basic_set_free(hull2);
+
+	mod = isl_basic_set_copy(bset);
+	mod = isl_basic_set_fix_si(mod, isl_dim_set, 0, 2);
+	hull1 = isl_basic_set_affine_hull(isl_basic_set_copy(mod));
+	str = "{ [2, 2] }";
+	hull2 = isl_basic_set_read_from_str(ctx, str);
+	if (equal >= 0 && equal)
+		equal = isl_basic_set_is_equal(hull1, hull2);
+	isl_basic_set_free(hull1);
+	isl_basic_set_free(hull2);
+	isl_basic_set_free(mod);
+	isl_basic_set_free(bset);
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown, "unexpected affine hull",
+			return -1);
+
+	return 0;
+}
+
+int test_affine_hull(struct isl_ctx *ctx)
+{
+	const char *str;
+	isl_set *set;
+	isl_basic_set *bset, *bset2;
+	int n;
+	int subset;
+
+	test_affine_hull_case(ctx, "affine2");
+	test_affine_hull_case(ctx, "affine");
+	test_affine_hull_case(ctx, "affine3");
+
+	if (test_affine_hull_cache(ctx) < 0)
+		return -1;
+
+	str = "[m] -> { [i0] : exists (e0, e1: e1 <= 1 + i0 and "
+			"m >= 3 and 4i0 <= 2 + m and e1 >= i0 and "
+			"e1 >= 0 and e1 <= 2 and e1 >= 1 + 2e0 and "
+			"2e1 <= 1 + m + 4e0 and 2e1 >= 2 - m + 4i0 - 4e0) }";
+	set = isl_set_read_from_str(ctx, str);
+	bset = isl_set_affine_hull(set);
+	n = isl_basic_set_dim(bset, isl_dim_div);
+	isl_basic_set_free(bset);
+	if (n != 0)
+		isl_die(ctx, isl_error_unknown, "not expecting any divs",
+			return -1);
+
+	/* Check that isl_map_affine_hull is not confused by
+	 * the reordering of divs in isl_map_align_divs.
+	 */
+	str = "{ [a, b, c, 0] : exists (e0 = [(b)/32], e1 = [(c)/32]: "
+				"32e0 = b and 32e1 = c); "
+		"[a, 0, c, 0] : exists (e0 = [(c)/32]: 32e0 = c) }";
+	set = isl_set_read_from_str(ctx, str);
+	bset = isl_set_affine_hull(set);
+	isl_basic_set_free(bset);
+	if (!bset)
+		return -1;
+
+	str = "{ [a] : exists e0, e1, e2: 32e1 = 31 + 31a + 31e0 and "
+			"32e2 = 31 + 31e0 }";
+	set = isl_set_read_from_str(ctx, str);
+	bset = isl_set_affine_hull(set);
+	str = "{ [a] : exists e : a = 32 e }";
+	bset2 = isl_basic_set_read_from_str(ctx, str);
+	subset = isl_basic_set_is_subset(bset, bset2);
+	isl_basic_set_free(bset);
+	isl_basic_set_free(bset2);
+	if (subset < 0)
+		return -1;
+	if (!subset)
+		isl_die(ctx, isl_error_unknown, "not as accurate as expected",
+			return -1);
+
+	return 0;
+}
+
+void test_convex_hull_case(struct isl_ctx *ctx, const char *name)
+{
+	char *filename;
+	FILE *input;
+	struct isl_basic_set *bset1, *bset2;
+	struct isl_set *set;
+
+	filename = get_filename(ctx, name, "polylib");
+	assert(filename);
+	input = fopen(filename, "r");
+	assert(input);
+
+	bset1 = isl_basic_set_read_from_file(ctx, input);
+	bset2 = isl_basic_set_read_from_file(ctx, input);
+
+	set = isl_basic_set_union(bset1, bset2);
+	bset1 = isl_set_convex_hull(set);
+
+	bset2 = isl_basic_set_read_from_file(ctx, input);
+
+	assert(isl_basic_set_is_equal(bset1, bset2) == 1);
+
+	isl_basic_set_free(bset1);
+	isl_basic_set_free(bset2);
+	free(filename);
+
+	fclose(input);
+}
+
+struct {
+	const char *set;
+	const char *hull;
+} convex_hull_tests[] = {
+	{ "{ [i0, i1, i2] : (i2 = 1 and i0 = 0 and i1 >= 0) or "
+	       "(i0 = 1 and i1 = 0 and i2 = 1) or "
+	       "(i0 = 0 and i1 = 0 and i2 = 0) }",
+	  "{ [i0, i1, i2] : i0 >= 0 and i2 >= i0 and i2 <= 1 and i1 >= 0 }" },
+	{ "[n] -> { [i0, i1, i0] : i0 <= -4 + n; "
+	    "[i0, i0, i2] : n = 6 and i0 >= 0 and i2 <= 7 - i0 and "
+	    "i2 <= 5 and i2 >= 4; "
+	    "[3, i1, 3] : n = 5 and i1 <= 2 and i1 >= 0 }",
+	  "[n] -> { [i0, i1, i2] : i2 <= -1 + n and 2i2 <= -6 + 3n - i0 and "
+	    "i2 <= 5 + i0 and i2 >= i0 }" },
+	{ "{ [x, y] : 3y <= 2x and y >= -2 + 2x and 2y >= 2 - x }",
+	    "{ [x, y] : 1 = 0 }" },
+};
+
+void test_convex_hull_algo(struct isl_ctx *ctx, int convex)
+{
+	int i;
+	int orig_convex = ctx->opt->convex;
+	ctx->opt->convex = convex;
+
+	test_convex_hull_case(ctx, "convex0");
+	test_convex_hull_case(ctx, "convex1");
+	test_convex_hull_case(ctx, "convex2");
+	test_convex_hull_case(ctx, "convex3");
+	test_convex_hull_case(ctx, "convex4");
+	test_convex_hull_case(ctx, "convex5");
+	test_convex_hull_case(ctx, "convex6");
+	test_convex_hull_case(ctx, "convex7");
+	test_convex_hull_case(ctx, "convex8");
+	test_convex_hull_case(ctx, "convex9");
+	test_convex_hull_case(ctx, "convex10");
+	test_convex_hull_case(ctx, "convex11");
+	test_convex_hull_case(ctx, "convex12");
+	test_convex_hull_case(ctx, "convex13");
+	test_convex_hull_case(ctx, "convex14");
+	test_convex_hull_case(ctx, "convex15");
+
+	for (i = 0; i < ARRAY_SIZE(convex_hull_tests); ++i) {
+		isl_set *set1, *set2;
+
+		set1 = isl_set_read_from_str(ctx, convex_hull_tests[i].set);
+		set2 = isl_set_read_from_str(ctx, convex_hull_tests[i].hull);
+		set1 = isl_set_from_basic_set(isl_set_convex_hull(set1));
+		assert(isl_set_is_equal(set1, set2));
+		isl_set_free(set1);
+		isl_set_free(set2);
+	}
+
+	ctx->opt->convex = orig_convex;
+}
+
+void test_convex_hull(struct isl_ctx *ctx)
+{
+	int n_thread = isl_options_get_threads(ctx);
+
+	test_convex_hull_algo(ctx, ISL_CONVEX_HULL_FM);
+	test_convex_hull_algo(ctx, ISL_CONVEX_HULL_WRAP);
+	isl_options_set_threads(ctx, 4);
+	test_convex_hull_algo(ctx, ISL_CONVEX_HULL_WRAP);
+	isl_options_set_threads(ctx, n_thread);
+}
+
+void test_gist_case(struct isl_ctx *ctx, const char *name)
+{
+	char *filename;
+	FILE *input;
+	struct isl_basic_set *bset1, *bset2;
+
+	filename = get_filename(ctx, name, "polylib");
+	assert(filename);
+	input = fopen(filename, "r");
+	assert(input);
+
+	bset1 = isl_basic_set_read_from_file(ctx, input);
+	bset2 = isl_basic_set_read_from_file(ctx, input);
+
+	bset1 = isl_basic_set_gist(bset1, bset2);
+
+	bset2 = isl_basic_set_read_from_file(ctx, input);
+
+	assert(isl_basic_set_is_equal(bset1, bset2) == 1);
+
+	isl_basic_set_free(bset1);
+	isl_basic_set_free(bset2);
+	free(filename);
+
+	fclose(input);
+}
+
+struct {
+	const char *set;
+	const char *context;
+	const char *gist;
+} gist_tests[] = {
+	{ "{ [a, b, c] : a <= 15 and a >= 1 }",
+	  "{ [a, b, c] : exists (e0 = floor((-1 + a)/16): a >= 1 and "
+			"c <= 30 and 32e0 >= -62 + 2a + 2b - c and b >= 0) }",
+	  "{ [a, b, c] : a <= 15 }" },
+	{ "{ : }", "{ : 1 = 0 }", "{ : }" },
+	{ "{ : 1 = 0 }", "{ : 1 = 0 }", "{ : }" },
+};
+
+/* Sets that are simplified with respect to the same context
+ * in test_gist_context.
+ */
+static const char *gist_context_tests[] = {
+	"[n] -> { [i, j] : 0 <= i <= n and 0 <= j <= i and j <= 100 }",
+	"[n] -> { [i, j] : i >= 0 and j <= n and i + j >= 5 }",
+	"[n] -> { [i, j] : 0 <= i < n and 3i >= 2j + 1 }",
+	"[n] -> { [i, j] : i = j and j <= n }",
+	"[n] -> { [i, j] : i >= 0 and exists (e : i = 2e) }",
+	"[n] -> { [i, j] : i > n or j < 0 }",
+	"[n] -> { [i, j] : i >= 20 }",
+	"[m] -> { [i, j] : i >= m }",
+};
+
+/* Check that computing the gist of several sets with respect
+ * to a reusable gist context produces the same results as isl_set_gist.
+ */
+static int test_gist_context(isl_ctx *ctx)
+{
+	int i;
+	const char *str;
+	isl_set *context;
+	isl_map_gist_context *gc;
+
+	str = "[n] -> { [i, j] : 0 <= i <= 10 and 0 <= j <= n }";
+	context = isl_set_read_from_str(ctx, str);
+	gc = isl_set_gist_context_alloc(isl_set_copy(context));
+
+	for (i = 0; i < ARRAY_SIZE(gist_context_tests); ++i) {
+		isl_set *set, *set1, *set2;
+		int equal;
+
+		set = isl_set_read_from_str(ctx, gist_context_tests[i]);
+		set1 = isl_set_gist(isl_set_copy(set), isl_set_copy(context));
+		set2 = isl_set_gist_with_context(set, gc);
+		equal = isl_set_plain_is_equal(set1, set2);
+		isl_set_free(set1);
+		isl_set_free(set2);
+		if (equal < 0 || !equal) {
+			isl_set_free(context);
+			isl_map_gist_context_free(gc);
+		}
+		if (equal < 0)
+			return -1;
+		if (!equal)
+			isl_die(ctx, isl_error_unknown,
+				"gist context changes result", return -1);
+	}
+
+	isl_set_free(context);
+	isl_map_gist_context_free(gc);
+
+	return 0;
+}
+
+static int test_gist(struct isl_ctx *ctx)
+{
+	int i;
+	const char *str;
+	isl_basic_set *bset1, *bset2;
+	isl_map *map1, *map2;
+	int equal;
+
+	for (i = 0; i < ARRAY_SIZE(gist_tests); ++i) {
+		bset1 = isl_basic_set_read_from_str(ctx, gist_tests[i].set);
+		bset2 = isl_basic_set_read_from_str(ctx, gist_tests[i].context);
+		bset1 = isl_basic_set_gist(bset1, bset2);
+		bset2 = isl_basic_set_read_from_str(ctx, gist_tests[i].gist);
+		equal = isl_basic_set_is_equal(bset1, bset2);
+		isl_basic_set_free(bset1);
+		isl_basic_set_free(bset2);
+		if (equal < 0)
+			return -1;
+		if (!equal)
+			isl_die(ctx, isl_error_unknown,
+				"incorrect gist result", return -1);
+	}
+
+	test_gist_case(ctx, "gist1");
+
+	str = "[p0, p2, p3, p5, p6, p10] -> { [] : "
+	    "exists (e0 = [(15 + p0 + 15p6 + 15p10)/16], e1 = [(p5)/8], "
+	    "e2 = [(p6)/128], e3 = [(8p2 - p5)/128], "
+	    "e4 = [(128p3 - p6)/4096]: 8e1 = p5 and 128e2 = p6 and "
+	    "128e3 = 8p2 - p5 and 4096e4 = 128p3 - p6 and p2 >= 0 and "
+	    "16e0 >= 16 + 16p6 + 15p10 and  p2 <= 15 and p3 >= 0 and "
+	    "p3 <= 31 and  p6 >= 128p3 and p5 >= 8p2 and p10 >= 0 and "
+	    "16e0 <= 15 + p0 + 15p6 + 15p10 and 16e0 >= p0 + 15p6 + 15p10 and "
+	    "p10 <= 15 and p10 <= -1 + p0 - p6) }";
+	bset1 = isl_basic_set_read_from_str(ctx, str);
+	str = "[p0, p2, p3, p5, p6, p10] -> { [] : exists (e0 = [(p5)/8], "
+	    "e1 = [(p6)/128], e2 = [(8p2 - p5)/128], "
+	    "e3 = [(128p3 - p6)/4096]: 8e0 = p5 and 128e1 = p6 and "
+	    "128e2 = 8p2 - p5 and 4096e3 = 128p3 - p6 and p5 >= -7 and "
+	    "p2 >= 0 and 8p2 <= -1 + p0 and p2 <= 15 and p3 >= 0 and "
+	    "p3 <= 31 and 128p3 <= -1 + p0 and p6 >= -127 and "
+	    "p5 <= -1 + p0 and p6 <= -1 + p0 and p6 >= 128p3 and "
+	    "p0 >= 1 and p5 >= 8p2 and p10 >= 0 and p10 <= 15 ) }";
+	bset2 = isl_basic_set_read_from_str(ctx, str);
+	bset1 = isl_basic_set_gist(bset1, bset2);
+	assert(bset1 && bset1->n_div == 0);
+	isl_basic_set_free(bset1);
+
+	/* Check that the integer divisions of the second disjunct
+	 * do not spread to the first disjunct.
+	 */
+	str = "[t1] -> { S_0[] -> A[o0] : (exists (e0 = [(-t1 + o0)/16]: "
+		"16e0 = -t1 + o0 and o0 >= 0 and o0 <= 15 and t1 >= 0)) or "
+		"(exists (e0 = [(-1 + t1)/16], "
+			"e1 = [(-16 + t1 - 16e0)/4294967296]: "
+			"4294967296e1 = -16 + t1 - o0 - 16e0 and "
+			"16e0 <= -1 + t1 and 16e0 >= -16 + t1 and o0 >= 0 and "
+			"o0 <= 4294967295 and t1 <= -1)) }";
+	map1 = isl_map_read_from_str(ctx, str);
+	str = "[t1] -> { S_0[] -> A[o0] : t1 >= 0 and t1 <= 4294967295 }";
+	map2 = isl_map_read_from_str(ctx, str);
+	map1 = isl_map_gist(map1, map2);
+	if (!map1)
+		return -1;
+	if (map1->n != 1)
+		isl_die(ctx, isl_error_unknown, "expecting single disjunct",
+			isl_map_free(map1); return -1);
+	if (isl_basic_map_dim(map1->p[0], isl_dim_div) != 1)
+		isl_die(ctx, isl_error_unknown, "expecting single div",
+			isl_map_free(map1); return -1);
+	isl_map_free(map1);
+
+	if (test_gist_context(ctx) < 0)
+		return -1;
+
+	return 0;
+}
+
+int test_coalesce_set(isl_ctx *ctx, const char *str, int check_one)
+{
+	isl_set *set, *set2;
+	int equal;
+	int one;
+
+	set = isl_set_read_from_str(ctx, str);
+	set = isl_set_coalesce(set);
+	set2 = isl_set_read_from_str(ctx, str);
+	equal = isl_set_is_equal(set, set2);
+	one = set && set->n == 1;
+	isl_set_free(set);
+	isl_set_free(set2);
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"coalesced set not equal to input", return -1);
+	if (check_one && !one)
+		isl_die(ctx, isl_error_unknown,
+			"coalesced set should not be a union", return -1);
+
+	return 0;
+}
+
+int test_coalesce_unbounded_wrapping(isl_ctx *ctx)
+{
+	int r = 0;
+	int bounded;
+
+	bounded = isl_options_get_coalesce_bounded_wrapping(ctx);
+	isl_options_set_coalesce_bounded_wrapping(ctx, 0);
+
+	if (test_coalesce_set(ctx,
+		"{[x,y,z] : y + 2 >= 0 and x - y + 1 >= 0 and "
+			"-x - y + 1 >= 0 and -3 <= z <= 3;"
+		"[x,y,z] : -x+z + 20 >= 0 and -x-z + 20 >= 0 and "
+			"x-z + 20 >= 0 and x+z + 20 >= 0 and "
+			"-10 <= y <= 0}", 1) < 0)
+		goto error;
+	if (test_coalesce_set(ctx,
+		"{[x,y] : 0 <= x,y <= 10; [5,y]: 4 <=y <= 11}", 1) < 0)
+		goto error;
+	if (test_coalesce_set(ctx,
+		"{[x,0,0] : -5 <= x <= 5; [0,y,1] : -5 <= y <= 5 }", 1) < 0)
+		goto error;
+
+	if (0) {
+error:
+		r = -1;
+	}
+
+	isl_options_set_coalesce_bounded_wrapping(ctx, bounded);
+
+	return r;
+}
+
+/* Inputs for coalescing tests.
+ * "str" is a string representation of the input set.
+ * "single_disjunct" is set if we expect the result to consist of
+ *	a single disjunct.
+ */
+struct {
+	int single_disjunct;
+	const char *str;
+} coalesce_tests[] = {
+	{ 1, "{[x,y]: x >= 0 & x <= 10 & y >= 0 & y <= 10 or "
+		       "y >= x & x >= 2 & 5 >= y }" },
+	{ 1, "{[x,y]: y >= 0 & 2x + y <= 30 & y <= 10 & x >= 0 or "
+		       "x + y >= 10 & y <= x & x + y <= 20 & y >= 0}" },
+	{ 0, "{[x,y]: y >= 0 & 2x + y <= 30 & y <= 10 & x >= 0 or "
+		       "x + y >= 10 & y <= x & x + y <= 19 & y >= 0}" },
 	{ 1, "{[x,y]: y >= 0 & x <= 5 & y <= x or "
 		       "y >= 0 & x >= 6 & x <= 10 & y <= x}" },
 	{ 0, "{[x,y]: y >= 0 & x <= 5 & y <= x or "
@@ -1414,3455 +3252,8944 @@ struct {
 		"[i0, 0] : i0 >= 123 and i0 <= 124 }" },
 };
 
-/* Test the functionality of isl_set_coalesce.
- * That is, check that the output is always equal to the input
- * and in some cases that the result consists of a single disjunct.
+/* Check that an empty intersection, which is only removed lazily
+ * if the union_map_lazy_empty option is set, is not visible
+ * to the user of the union map.
+ */
+static int test_coalesce_lazy_empty(isl_ctx *ctx)
+{
+	const char *str;
+	isl_union_map *umap1, *umap2;
+	isl_map *map;
+	int lazy;
+	int n_map;
+
+	lazy = isl_options_get_union_map_lazy_empty(ctx);
+	isl_options_set_union_map_lazy_empty(ctx, 1);
+	str = "{ A[x, y] -> B[] : 0 <= x, y <= 3; C[i] -> D[] : i >= 0 }";
+	umap1 = isl_union_map_read_from_str(ctx, str);
+	str = "{ A[x, y] -> B[] : 2x + 3y <= -2; C[i] -> D[] : i <= 5 }";
+	umap2 = isl_union_map_read_from_str(ctx, str);
+	umap1 = isl_union_map_intersect(umap1, umap2);
+	n_map = isl_union_map_n_map(umap1);
+	map = isl_map_from_union_map(umap1);
+	isl_map_free(map);
+	isl_options_set_union_map_lazy_empty(ctx, lazy);
+
+	if (!map)
+		return -1;
+	if (n_map != 1)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of maps", return -1);
+
+	return 0;
+}
+
+/* Check that coalescing skips pairs of basic sets that are separated
+ * according to a bounding box and that the result is the same
+ * as when the bounding boxes are not used.
+ * The final two disjuncts can be coalesced, the others cannot.
+ */
+static int test_coalesce_box_filter(isl_ctx *ctx)
+{
+	const char *str;
+	isl_set *set, *set1, *set2;
+	long skipped;
+	int filter;
+	int equal;
+
+	str = "{ [x, y] : (0 <= x <= 3 and 0 <= y <= 3) or "
+		"(10 <= x <= 13 and 0 <= y - x <= 3) or "
+		"(20 <= x <= 23 and 20 <= y <= 23) or "
+		"(0 <= x <= 3 and 20 <= y <= 23) or "
+		"(30 <= x <= 33 and 0 <= y <= 3) or "
+		"(34 <= x <= 36 and 0 <= y <= 3) }";
+	set = isl_set_read_from_str(ctx, str);
+
+	filter = isl_options_get_coalesce_box_filter(ctx);
+	skipped = isl_ctx_get_stat(ctx, "coalesce_pairs_skipped");
+	isl_options_set_coalesce_box_filter(ctx, 1);
+	set1 = isl_set_coalesce(isl_set_copy(set));
+	isl_options_set_coalesce_box_filter(ctx, 0);
+	set2 = isl_set_coalesce(isl_set_copy(set));
+	isl_options_set_coalesce_box_filter(ctx, filter);
+
+	equal = isl_set_plain_is_equal(set1, set2);
+	if (equal >= 0 && equal && isl_set_n_basic_set(set1) != 5)
+		equal = 0;
+	if (equal >= 0 && equal)
+		equal = isl_set_is_equal(set1, set);
+
+	isl_set_free(set);
+	isl_set_free(set1);
+	isl_set_free(set2);
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected result of coalescing", return -1);
+	if (isl_ctx_get_stat(ctx, "coalesce_pairs_skipped") <= skipped)
+		isl_die(ctx, isl_error_unknown,
+			"no pairs skipped", return -1);
+
+	return 0;
+}
+
+/* Check that coalescing the pairs of basic sets in a set
+ * using several threads produces the expected results.
+ * The last set consists of 20 points that are coalesced
+ * into a single interval over several rounds.
+ */
+static int test_coalesce_pair_threads(isl_ctx *ctx)
+{
+	int i;
+	int n_thread;
+	int r = 0;
+	isl_printer *p;
+	char *points;
+
+	n_thread = isl_options_get_threads(ctx);
+	isl_options_set_threads(ctx, 3);
+	for (i = 0; i < ARRAY_SIZE(coalesce_tests); ++i) {
+		const char *str = coalesce_tests[i].str;
+		int check_one = coalesce_tests[i].single_disjunct;
+		if (test_coalesce_set(ctx, str, check_one) < 0)
+			break;
+	}
+	if (i < ARRAY_SIZE(coalesce_tests))
+		r = -1;
+
+	p = isl_printer_to_str(ctx);
+	p = isl_printer_print_str(p, "{ [i] : ");
+	for (i = 0; i < 20; ++i) {
+		if (i)
+			p = isl_printer_print_str(p, " or ");
+		p = isl_printer_print_str(p, "i = ");
+		p = isl_printer_print_int(p, (7 * i) % 20);
+	}
+	p = isl_printer_print_str(p, " }");
+	points = isl_printer_get_str(p);
+	isl_printer_free(p);
+	if (r == 0 && (!points || test_coalesce_set(ctx, points, 1) < 0))
+		r = -1;
+	free(points);
+
+	isl_options_set_threads(ctx, n_thread);
+	return r;
+}
+
+/* Check that coalescing the maps in a union map using several threads
+ * produces the same result as coalescing them sequentially.
+ * The map in the space B has the largest number of disjuncts
+ * and is therefore handled first.
+ */
+static int test_coalesce_threads(isl_ctx *ctx)
+{
+	const char *str;
+	isl_union_map *umap, *seq, *par;
+	int n_thread;
+	int equal;
+
+	str = "[N] -> { A[i] -> [j] : 0 <= j <= i < N; "
+		"A[i] -> [j] : i = N and 0 <= j <= N; "
+		"B[i] -> [j] : i = 0 and 0 <= j <= 10; "
+		"B[i] -> [j] : i = 1 and 0 <= j <= 10; "
+		"B[i] -> [j] : i = 2 and 0 <= j <= 10; "
+		"B[i] -> [j] : i = 3 and 0 <= j <= 10; "
+		"C[i] -> [j] : i <= 3j <= N; D[] -> [j] : N <= j <= 2N; "
+		"E[i, j] -> [k] : i <= k <= 10 or j <= k <= 10 }";
+	umap = isl_union_map_read_from_str(ctx, str);
+	n_thread = isl_options_get_threads(ctx);
+	isl_options_set_threads(ctx, 1);
+	seq = isl_union_map_coalesce(isl_union_map_copy(umap));
+	isl_options_set_threads(ctx, 3);
+	par = isl_union_map_coalesce(umap);
+	isl_options_set_threads(ctx, n_thread);
+	equal = isl_union_map_is_equal(seq, par);
+	isl_union_map_free(seq);
+	isl_union_map_free(par);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"parallel coalesce differs from sequential",
+			return -1);
+
+	return 0;
+}
+
+/* Test the functionality of isl_set_coalesce.
+ * That is, check that the output is always equal to the input
+ * and in some cases that the result consists of a single disjunct.
+ */
+static int test_coalesce(struct isl_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(coalesce_tests); ++i) {
+		const char *str = coalesce_tests[i].str;
+		int check_one = coalesce_tests[i].single_disjunct;
+		if (test_coalesce_set(ctx, str, check_one) < 0)
+			return -1;
+	}
+
+	if (test_coalesce_unbounded_wrapping(ctx) < 0)
+		return -1;
+	if (test_coalesce_box_filter(ctx) < 0)
+		return -1;
+	if (test_coalesce_lazy_empty(ctx) < 0)
+		return -1;
+	if (test_coalesce_threads(ctx) < 0)
+		return -1;
+	if (test_coalesce_pair_threads(ctx) < 0)
+		return -1;
+
+	return 0;
+}
+
+/* Check that coalescing and gist computations that run out
+ * of the budget set by the simplify_budget option still produce
+ * correct results and that the budget is actually exhausted.
+ */
+static int test_simplify_budget(isl_ctx *ctx)
+{
+	const char *str;
+	isl_set *set, *set2, *context;
+	long exhausted;
+	int budget;
+	int equal;
+
+	budget = isl_options_get_simplify_budget(ctx);
+	exhausted = isl_ctx_get_stat(ctx, "simplify_budget_exhausted");
+	isl_options_set_simplify_budget(ctx, 1);
+
+	str = "{ [i] : 0 <= i <= 10 or 11 <= i <= 20 or 21 <= i <= 30 or "
+		"31 <= i <= 40 }";
+	set = isl_set_read_from_str(ctx, str);
+	set2 = isl_set_coalesce(isl_set_copy(set));
+	equal = isl_set_is_equal(set, set2);
+	isl_set_free(set);
+	isl_set_free(set2);
+
+	str = "{ [i, j] : 0 <= i <= 10 and 0 <= j <= 10 and j <= i + 100; "
+		"[i, j] : 20 <= i <= 30 and 0 <= j <= 10 and j <= i + 100 }";
+	set = isl_set_read_from_str(ctx, str);
+	str = "{ [i, j] : 0 <= j <= 10 and exists e : i = 2e }";
+	context = isl_set_read_from_str(ctx, str);
+	set2 = isl_set_gist(isl_set_copy(set), isl_set_copy(context));
+	set = isl_set_intersect(set, isl_set_copy(context));
+	set2 = isl_set_intersect(set2, context);
+	if (equal >= 0 && equal)
+		equal = isl_set_is_equal(set, set2);
+	isl_set_free(set);
+	isl_set_free(set2);
+
+	isl_options_set_simplify_budget(ctx, budget);
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"budgeted simplification changes result", return -1);
+	if (isl_ctx_get_stat(ctx, "simplify_budget_exhausted") < exhausted + 2)
+		isl_die(ctx, isl_error_unknown,
+			"simplification budget not exhausted", return -1);
+
+	return 0;
+}
+
+void test_closure(struct isl_ctx *ctx)
+{
+	const char *str;
+	isl_set *dom;
+	isl_map *up, *right;
+	isl_map *map, *map2;
+	isl_union_map *umap, *umap2;
+	int exact, exact2;
+	int n_thread;
+	long hits;
+
+	/* COCOA example 1 */
+	map = isl_map_read_from_str(ctx,
+		"[n] -> { [i,j] -> [i2,j2] : i2 = i + 1 and j2 = j + 1 and "
+			"1 <= i and i < n and 1 <= j and j < n or "
+			"i2 = i + 1 and j2 = j - 1 and "
+			"1 <= i and i < n and 2 <= j and j <= n }");
+	map = isl_map_power(map, &exact);
+	assert(exact);
+	isl_map_free(map);
+
+	/* COCOA example 1 */
+	map = isl_map_read_from_str(ctx,
+		"[n] -> { [i,j] -> [i2,j2] : i2 = i + 1 and j2 = j + 1 and "
+			"1 <= i and i < n and 1 <= j and j < n or "
+			"i2 = i + 1 and j2 = j - 1 and "
+			"1 <= i and i < n and 2 <= j and j <= n }");
+	map = isl_map_transitive_closure(map, &exact);
+	assert(exact);
+	map2 = isl_map_read_from_str(ctx,
+		"[n] -> { [i,j] -> [i2,j2] : exists (k1,k2,k : "
+			"1 <= i and i < n and 1 <= j and j <= n and "
+			"2 <= i2 and i2 <= n and 1 <= j2 and j2 <= n and "
+			"i2 = i + k1 + k2 and j2 = j + k1 - k2 and "
+			"k1 >= 0 and k2 >= 0 and k1 + k2 = k and k >= 1 )}");
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map2);
+	isl_map_free(map);
+
+	map = isl_map_read_from_str(ctx,
+		"[n] -> { [x] -> [y] : y = x + 1 and 0 <= x and x <= n and "
+				     " 0 <= y and y <= n }");
+	map = isl_map_transitive_closure(map, &exact);
+	map2 = isl_map_read_from_str(ctx,
+		"[n] -> { [x] -> [y] : y > x and 0 <= x and x <= n and "
+				     " 0 <= y and y <= n }");
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map2);
+	isl_map_free(map);
+
+	/* COCOA example 2 */
+	map = isl_map_read_from_str(ctx,
+		"[n] -> { [i,j] -> [i2,j2] : i2 = i + 2 and j2 = j + 2 and "
+			"1 <= i and i < n - 1 and 1 <= j and j < n - 1 or "
+			"i2 = i + 2 and j2 = j - 2 and "
+			"1 <= i and i < n - 1 and 3 <= j and j <= n }");
+	map = isl_map_transitive_closure(map, &exact);
+	assert(exact);
+	map2 = isl_map_read_from_str(ctx,
+		"[n] -> { [i,j] -> [i2,j2] : exists (k1,k2,k : "
+			"1 <= i and i < n - 1 and 1 <= j and j <= n and "
+			"3 <= i2 and i2 <= n and 1 <= j2 and j2 <= n and "
+			"i2 = i + 2 k1 + 2 k2 and j2 = j + 2 k1 - 2 k2 and "
+			"k1 >= 0 and k2 >= 0 and k1 + k2 = k and k >= 1) }");
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map);
+	isl_map_free(map2);
+
+	/* COCOA Fig.2 left */
+	map = isl_map_read_from_str(ctx,
+		"[n] -> { [i,j] -> [i2,j2] : i2 = i + 2 and j2 = j and "
+			"i <= 2 j - 3 and i <= n - 2 and j <= 2 i - 1 and "
+			"j <= n or "
+			"i2 = i and j2 = j + 2 and i <= 2 j - 1 and i <= n and "
+			"j <= 2 i - 3 and j <= n - 2 or "
+			"i2 = i + 1 and j2 = j + 1 and i <= 2 j - 1 and "
+			"i <= n - 1 and j <= 2 i - 1 and j <= n - 1 }");
+	map = isl_map_transitive_closure(map, &exact);
+	assert(exact);
+	isl_map_free(map);
+
+	/* COCOA Fig.2 right */
+	map = isl_map_read_from_str(ctx,
+		"[n] -> { [i,j] -> [i2,j2] : i2 = i + 3 and j2 = j and "
+			"i <= 2 j - 4 and i <= n - 3 and j <= 2 i - 1 and "
+			"j <= n or "
+			"i2 = i and j2 = j + 3 and i <= 2 j - 1 and i <= n and "
+			"j <= 2 i - 4 and j <= n - 3 or "
+			"i2 = i + 1 and j2 = j + 1 and i <= 2 j - 1 and "
+			"i <= n - 1 and j <= 2 i - 1 and j <= n - 1 }");
+	map = isl_map_power(map, &exact);
+	assert(exact);
+	isl_map_free(map);
+
+	/* COCOA Fig.2 right */
+	map = isl_map_read_from_str(ctx,
+		"[n] -> { [i,j] -> [i2,j2] : i2 = i + 3 and j2 = j and "
+			"i <= 2 j - 4 and i <= n - 3 and j <= 2 i - 1 and "
+			"j <= n or "
+			"i2 = i and j2 = j + 3 and i <= 2 j - 1 and i <= n and "
+			"j <= 2 i - 4 and j <= n - 3 or "
+			"i2 = i + 1 and j2 = j + 1 and i <= 2 j - 1 and "
+			"i <= n - 1 and j <= 2 i - 1 and j <= n - 1 }");
+	map = isl_map_transitive_closure(map, &exact);
+	assert(exact);
+	map2 = isl_map_read_from_str(ctx,
+		"[n] -> { [i,j] -> [i2,j2] : exists (k1,k2,k3,k : "
+			"i <= 2 j - 1 and i <= n and j <= 2 i - 1 and "
+			"j <= n and 3 + i + 2 j <= 3 n and "
+			"3 + 2 i + j <= 3n and i2 <= 2 j2 -1 and i2 <= n and "
+			"i2 <= 3 j2 - 4 and j2 <= 2 i2 -1 and j2 <= n and "
+			"13 + 4 j2 <= 11 i2 and i2 = i + 3 k1 + k3 and "
+			"j2 = j + 3 k2 + k3 and k1 >= 0 and k2 >= 0 and "
+			"k3 >= 0 and k1 + k2 + k3 = k and k > 0) }");
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map2);
+	isl_map_free(map);
+
+	/* COCOA Fig.1 right */
+	dom = isl_set_read_from_str(ctx,
+		"{ [x,y] : x >= 0 and -2 x + 3 y >= 0 and x <= 3 and "
+			"2 x - 3 y + 3 >= 0 }");
+	right = isl_map_read_from_str(ctx,
+		"{ [x,y] -> [x2,y2] : x2 = x + 1 and y2 = y }");
+	up = isl_map_read_from_str(ctx,
+		"{ [x,y] -> [x2,y2] : x2 = x and y2 = y + 1 }");
+	right = isl_map_intersect_domain(right, isl_set_copy(dom));
+	right = isl_map_intersect_range(right, isl_set_copy(dom));
+	up = isl_map_intersect_domain(up, isl_set_copy(dom));
+	up = isl_map_intersect_range(up, dom);
+	map = isl_map_union(up, right);
+	map = isl_map_transitive_closure(map, &exact);
+	assert(exact);
+	map2 = isl_map_read_from_str(ctx,
+		"{ [0,0] -> [0,1]; [0,0] -> [1,1]; [0,1] -> [1,1]; "
+		"  [2,2] -> [3,2]; [2,2] -> [3,3]; [3,2] -> [3,3] }");
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map2);
+	isl_map_free(map);
+
+	/* COCOA Theorem 1 counter example */
+	map = isl_map_read_from_str(ctx,
+		"{ [i,j] -> [i2,j2] : i = 0 and 0 <= j and j <= 1 and "
+			"i2 = 1 and j2 = j or "
+			"i = 0 and j = 0 and i2 = 0 and j2 = 1 }");
+	map = isl_map_transitive_closure(map, &exact);
+	assert(exact);
+	isl_map_free(map);
+
+	map = isl_map_read_from_str(ctx,
+		"[m,n] -> { [i,j] -> [i2,j2] : i2 = i and j2 = j + 2 and "
+			"1 <= i,i2 <= n and 1 <= j,j2 <= m or "
+			"i2 = i + 1 and 3 <= j2 - j <= 4 and "
+			"1 <= i,i2 <= n and 1 <= j,j2 <= m }");
+	map = isl_map_transitive_closure(map, &exact);
+	assert(exact);
+	isl_map_free(map);
+
+	/* Kelly et al 1996, fig 12 */
+	map = isl_map_read_from_str(ctx,
+		"[n] -> { [i,j] -> [i2,j2] : i2 = i and j2 = j + 1 and "
+			"1 <= i,j,j+1 <= n or "
+			"j = n and j2 = 1 and i2 = i + 1 and "
+			"1 <= i,i+1 <= n }");
+	map = isl_map_transitive_closure(map, &exact);
+	assert(exact);
+	map2 = isl_map_read_from_str(ctx,
+		"[n] -> { [i,j] -> [i2,j2] : 1 <= j < j2 <= n and "
+			"1 <= i <= n and i = i2 or "
+			"1 <= i < i2 <= n and 1 <= j <= n and "
+			"1 <= j2 <= n }");
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map2);
+	isl_map_free(map);
+
+	/* Omega's closure4 */
+	map = isl_map_read_from_str(ctx,
+		"[m,n] -> { [x,y] -> [x2,y2] : x2 = x and y2 = y + 1 and "
+			"1 <= x,y <= 10 or "
+			"x2 = x + 1 and y2 = y and "
+			"1 <= x <= 20 && 5 <= y <= 15 }");
+	map = isl_map_transitive_closure(map, &exact);
+	assert(exact);
+	isl_map_free(map);
+
+	map = isl_map_read_from_str(ctx,
+		"[n] -> { [x] -> [y]: 1 <= n <= y - x <= 10 }");
+	map = isl_map_transitive_closure(map, &exact);
+	assert(!exact);
+	map2 = isl_map_read_from_str(ctx,
+		"[n] -> { [x] -> [y] : 1 <= n <= 10 and y >= n + x }");
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map);
+	isl_map_free(map2);
+
+	str = "[n, m] -> { [i0, i1, i2, i3] -> [o0, o1, o2, o3] : "
+	    "i3 = 1 and o0 = i0 and o1 = -1 + i1 and o2 = -1 + i2 and "
+	    "o3 = -2 + i2 and i1 <= -1 + i0 and i1 >= 1 - m + i0 and "
+	    "i1 >= 2 and i1 <= n and i2 >= 3 and i2 <= 1 + n and i2 <= m }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_transitive_closure(map, &exact);
+	assert(exact);
+	map2 = isl_map_read_from_str(ctx, str);
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map);
+	isl_map_free(map2);
+
+	str = "{[0] -> [1]; [2] -> [3]}";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_transitive_closure(map, &exact);
+	assert(exact);
+	map2 = isl_map_read_from_str(ctx, str);
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map);
+	isl_map_free(map2);
+
+	str = "[n] -> { [[i0, i1, 1, 0, i0] -> [i5, 1]] -> "
+	    "[[i0, -1 + i1, 2, 0, i0] -> [-1 + i5, 2]] : "
+	    "exists (e0 = [(3 - n)/3]: i5 >= 2 and i1 >= 2 and "
+	    "3i0 <= -1 + n and i1 <= -1 + n and i5 <= -1 + n and "
+	    "3e0 >= 1 - n and 3e0 <= 2 - n and 3i0 >= -2 + n); "
+	    "[[i0, i1, 2, 0, i0] -> [i5, 1]] -> "
+	    "[[i0, i1, 1, 0, i0] -> [-1 + i5, 2]] : "
+	    "exists (e0 = [(3 - n)/3]: i5 >= 2 and i1 >= 1 and "
+	    "3i0 <= -1 + n and i1 <= -1 + n and i5 <= -1 + n and "
+	    "3e0 >= 1 - n and 3e0 <= 2 - n and 3i0 >= -2 + n); "
+	    "[[i0, i1, 1, 0, i0] -> [i5, 2]] -> "
+	    "[[i0, -1 + i1, 2, 0, i0] -> [i5, 1]] : "
+	    "exists (e0 = [(3 - n)/3]: i1 >= 2 and i5 >= 1 and "
+	    "3i0 <= -1 + n and i1 <= -1 + n and i5 <= -1 + n and "
+	    "3e0 >= 1 - n and 3e0 <= 2 - n and 3i0 >= -2 + n); "
+	    "[[i0, i1, 2, 0, i0] -> [i5, 2]] -> "
+	    "[[i0, i1, 1, 0, i0] -> [i5, 1]] : "
+	    "exists (e0 = [(3 - n)/3]: i5 >= 1 and i1 >= 1 and "
+	    "3i0 <= -1 + n and i1 <= -1 + n and i5 <= -1 + n and "
+	    "3e0 >= 1 - n and 3e0 <= 2 - n and 3i0 >= -2 + n) }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_transitive_closure(map, NULL);
+	assert(map);
+	isl_map_free(map);
+
+	/* Check the transitive closure of a uniform relation. */
+	str = "[n] -> { [i, j] -> [i + 3, j] : 0 <= i, j < n }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_transitive_closure(map, &exact);
+	assert(exact);
+	str = "[n] -> { [i, j] -> [o0, j] : exists (k : o0 = i + 3k and "
+		"k >= 1 and 0 <= i, j < n and 3 <= o0 < n + 3) }";
+	map2 = isl_map_read_from_str(ctx, str);
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map2);
+	isl_map_free(map);
+
+	/* Check that results are reused from the closure cache,
+	 * also if the input has its disjuncts in a different order,
+	 * but not for a different operation.
+	 */
+	isl_options_set_closure_cache_size(ctx, 4);
+	hits = isl_ctx_get_stat(ctx, "closure_cache_hits");
+	str = "{ [i] -> [i + 1] : 0 <= i < 10; [i] -> [i + 3] : 0 <= i < 8 }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_transitive_closure(map, &exact);
+	str = "{ [i] -> [i + 3] : 0 <= i < 8; [i] -> [i + 1] : 0 <= i < 10 }";
+	map2 = isl_map_read_from_str(ctx, str);
+	map2 = isl_map_transitive_closure(map2, &exact2);
+	assert(isl_ctx_get_stat(ctx, "closure_cache_hits") == hits + 1);
+	assert(exact == exact2);
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map2);
+	isl_map_free(map);
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_power(map, &exact);
+	assert(isl_ctx_get_stat(ctx, "closure_cache_hits") == hits + 1);
+	isl_map_free(map);
+	isl_options_set_closure_cache_size(ctx, 0);
+
+	/* Check that extending a closure with an extra relation
+	 * produces the closure of the union.
+	 */
+	str = "{ [i] -> [i + 1] : 0 <= i < 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_transitive_closure(map, &exact);
+	assert(exact);
+	str = "{ [i] -> [i + 3] : 5 <= i < 20 }";
+	map2 = isl_map_read_from_str(ctx, str);
+	map = isl_map_transitive_closure_extend(map, exact, map2, &exact);
+	assert(exact);
+	str = "{ [i] -> [i + 1] : 0 <= i < 10; [i] -> [i + 3] : 5 <= i < 20 }";
+	map2 = isl_map_read_from_str(ctx, str);
+	map2 = isl_map_transitive_closure(map2, &exact2);
+	assert(exact2);
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map2);
+	str = "{ [i] -> [i + 3] : 5 <= i < 20 }";
+	map2 = isl_map_read_from_str(ctx, str);
+	map = isl_map_transitive_closure_extend(map, 0, map2, &exact);
+	assert(!exact);
+	isl_map_free(map);
+
+	/* Check that updating the matrix of relations of the Floyd-Warshall
+	 * algorithm by several threads produces the same result
+	 * as updating it in a single thread.
+	 */
+	str = "[n] -> { A[i] -> B[i] : 0 <= i < n; B[i] -> C[i + 1]; "
+		"C[i] -> D[i] : i < n; D[i] -> A[i + 2]; B[i] -> D[i]; "
+		"C[i] -> A[i] : i > 3; D[i] -> E[i, i] }";
+	umap = isl_union_map_read_from_str(ctx, str);
+	n_thread = isl_options_get_threads(ctx);
+	isl_options_set_threads(ctx, 1);
+	umap = isl_union_map_transitive_closure(umap, &exact);
+	isl_options_set_threads(ctx, 3);
+	umap2 = isl_union_map_read_from_str(ctx, str);
+	umap2 = isl_union_map_transitive_closure(umap2, &exact2);
+	isl_options_set_threads(ctx, n_thread);
+	assert(exact == exact2);
+	assert(isl_union_map_is_equal(umap, umap2));
+	isl_union_map_free(umap2);
+	isl_union_map_free(umap);
+}
+
+void test_lex(struct isl_ctx *ctx)
+{
+	isl_space *dim;
+	isl_map *map;
+
+	dim = isl_space_set_alloc(ctx, 0, 0);
+	map = isl_map_lex_le(dim);
+	assert(!isl_map_is_empty(map));
+	isl_map_free(map);
+}
+
+/* Check that the value of "lp" in the direction "f",
+ * maximized if "max" is set, is equal to "expected".
+ */
+static int check_tab_lp(isl_tab_lp *lp, int max, isl_int *f, int expected)
+{
+	isl_ctx *ctx = isl_tab_lp_get_ctx(lp);
+	enum isl_lp_result res;
+	isl_int opt;
+	int equal;
+
+	isl_int_init(opt);
+	res = isl_tab_lp_solve(lp, max, f, ctx->one, &opt, NULL, NULL);
+	equal = isl_int_cmp_si(opt, expected) == 0;
+	isl_int_clear(opt);
+
+	if (res != isl_lp_ok)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected LP result", return -1);
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected optimum", return -1);
+	return 0;
+}
+
+/* Check that a sequence of related LP problems can be solved
+ * on the same isl_tab_lp, with constraints being added and removed
+ * in between.
+ */
+static int test_tab_lp(isl_ctx *ctx)
+{
+	const char *str;
+	isl_basic_set *bset;
+	isl_tab_lp *lp;
+	isl_vec *f, *c;
+	struct isl_tab_undo *snap;
+	int r = -1;
+
+	str = "{ [x, y] : 0 <= x <= 10 and 0 <= y <= 10 }";
+	bset = isl_basic_set_read_from_str(ctx, str);
+	lp = isl_tab_lp_from_basic_map(bset);
+	f = isl_vec_alloc(ctx, 3);
+	c = isl_vec_alloc(ctx, 3);
+	if (!lp || !f || !c)
+		goto error;
+
+	isl_int_set_si(f->el[0], 0);
+	isl_int_set_si(f->el[1], 1);
+	isl_int_set_si(f->el[2], 1);
+	if (check_tab_lp(lp, 1, f->el, 20) < 0)
+		goto error;
+
+	snap = isl_tab_lp_snap(lp);
+	isl_int_set_si(c->el[0], 5);
+	isl_int_set_si(c->el[1], -1);
+	isl_int_set_si(c->el[2], -1);
+	lp = isl_tab_lp_add_ineq(lp, c->el);
+	if (!lp)
+		goto error;
+	if (check_tab_lp(lp, 1, f->el, 5) < 0)
+		goto error;
+	isl_int_set_si(c->el[0], -2);
+	isl_int_set_si(c->el[1], 1);
+	isl_int_set_si(c->el[2], 0);
+	lp = isl_tab_lp_add_eq(lp, c->el);
+	isl_int_set_si(f->el[1], 0);
+	if (!lp)
+		goto error;
+	if (check_tab_lp(lp, 1, f->el, 3) < 0)
+		goto error;
+
+	lp = isl_tab_lp_rollback(lp, snap);
+	if (!lp)
+		goto error;
+	if (check_tab_lp(lp, 1, f->el, 10) < 0)
+		goto error;
+	isl_int_set_si(f->el[1], 1);
+	if (check_tab_lp(lp, 0, f->el, 0) < 0)
+		goto error;
+
+	r = 0;
+error:
+	isl_vec_free(f);
+	isl_vec_free(c);
+	isl_tab_lp_free(lp);
+	return r;
+}
+
+/* Basic sets, affine objective functions and the maximal rational
+ * value of the objective function over the basic set,
+ * used in test_tab_lean.
+ */
+struct {
+	const char *set;
+	const char *obj;
+	const char *max;
+} tab_lean_tests[] = {
+	{ "{ [x, y, z] : x = 2y and 0 <= y <= 10 and 0 <= z <= x }",
+	  "{ [x, y, z] -> [(x + y + z)] }", "50" },
+	{ "{ [x, y, z] : x + y = 3 and y = 2z and 0 <= 3z <= 7 and x >= 0 }",
+	  "{ [x, y, z] -> [(z - x)] }", "3/2" },
+	{ "{ [x, y] : 3x + 2y <= 12 and 2x - 5y <= 1 and x, y >= 0 }",
+	  "{ [x, y] -> [(2x + y)] }", "145/19" },
+};
+
+/* Check that LP problems are solved in the same way
+ * with and without the tab_lean option.
+ */
+static int test_tab_lean(isl_ctx *ctx)
+{
+	int i, j;
+	int lean;
+
+	lean = isl_options_get_tab_lean(ctx);
+	for (j = 0; j < 2; ++j) {
+		isl_options_set_tab_lean(ctx, j);
+		if (test_tab_lp(ctx) < 0)
+			break;
+		for (i = 0; i < ARRAY_SIZE(tab_lean_tests); ++i) {
+			isl_basic_set *bset;
+			isl_aff *obj;
+			isl_val *v, *expected;
+			int equal;
+
+			bset = isl_basic_set_read_from_str(ctx,
+						tab_lean_tests[i].set);
+			obj = isl_aff_read_from_str(ctx, tab_lean_tests[i].obj);
+			v = isl_basic_set_max_lp_val(bset, obj);
+			expected = isl_val_read_from_str(ctx,
+						tab_lean_tests[i].max);
+			equal = isl_val_eq(v, expected);
+			isl_basic_set_free(bset);
+			isl_aff_free(obj);
+			isl_val_free(v);
+			isl_val_free(expected);
+			if (!equal)
+				isl_die(ctx, isl_error_unknown,
+					"unexpected maximum", equal = -1);
+			if (equal < 0)
+				break;
+		}
+		if (i < ARRAY_SIZE(tab_lean_tests))
+			break;
+	}
+	isl_options_set_tab_lean(ctx, lean);
+
+	return j < 2 ? -1 : 0;
+}
+
+/* Pairs of sets that are subtracted from each other and
+ * coalesced in test_tab_dual_simplex and test_tab_pivot.
+ */
+struct {
+	const char *set1;
+	const char *set2;
+} dual_simplex_tests[] = {
+	{ "{ [x, y] : 0 <= x, y <= 10 }",
+	  "{ [x, y] : x + y >= 5 and x - y <= 3 }" },
+	{ "{ [x, y, z] : 0 <= x, y, z <= 10 and x + y + z <= 20 }",
+	  "{ [x, y, z] : 2x + 3y >= 7 z + 1 }" },
+	{ "[n] -> { [i, j] : 0 <= i < n and 0 <= j <= i }",
+	  "[n] -> { [i, j] : 2j >= i + 3 or i + j >= n }" },
+	{ "{ [x, y] : 3y <= 2x and 5y >= 3x - 4 and x <= 20 }",
+	  "{ [x, y] : 7y >= 4x + 1 }" },
+};
+
+/* Check that using dual simplex pivots for resolving violated constraints
+ * produces the same results as using primal simplex pivots and
+ * that dual simplex pivots are actually performed.
+ */
+static int test_tab_dual_simplex(isl_ctx *ctx)
+{
+	int i;
+	int dual;
+	long pivots;
+
+	dual = isl_options_get_tab_dual_simplex(ctx);
+	pivots = isl_ctx_get_stat(ctx, "dual_pivots");
+	for (i = 0; i < ARRAY_SIZE(dual_simplex_tests); ++i) {
+		isl_set *set1, *set2, *res[2];
+		int j, equal;
+
+		for (j = 0; j < 2; ++j) {
+			isl_options_set_tab_dual_simplex(ctx, j);
+			set1 = isl_set_read_from_str(ctx,
+						dual_simplex_tests[i].set1);
+			set2 = isl_set_read_from_str(ctx,
+						dual_simplex_tests[i].set2);
+			res[j] = isl_set_subtract(set1, set2);
+			res[j] = isl_set_coalesce(res[j]);
+		}
+		isl_options_set_tab_dual_simplex(ctx, dual);
+		equal = isl_set_is_equal(res[0], res[1]);
+		isl_set_free(res[0]);
+		isl_set_free(res[1]);
+		if (equal < 0)
+			return -1;
+		if (!equal)
+			isl_die(ctx, isl_error_unknown,
+				"primal and dual simplex results differ",
+				return -1);
+	}
+	if (isl_ctx_get_stat(ctx, "dual_pivots") <= pivots)
+		isl_die(ctx, isl_error_unknown,
+			"no dual simplex pivots performed", return -1);
+
+	return 0;
+}
+
+/* Compute the result of subtracting the second set of dual_simplex_tests[i]
+ * from the first, coalesced and with its lexicographic minimum
+ * appended, using pivot rule "rule".
+ */
+static __isl_give isl_set *pivot_rule_result(isl_ctx *ctx, int i, int rule)
+{
+	isl_set *set1, *set2;
+
+	isl_options_set_tab_pivot(ctx, rule);
+	set1 = isl_set_read_from_str(ctx, dual_simplex_tests[i].set1);
+	set2 = isl_set_read_from_str(ctx, dual_simplex_tests[i].set2);
+	set1 = isl_set_subtract(set1, set2);
+	set1 = isl_set_coalesce(set1);
+	set2 = isl_set_lexmin(isl_set_copy(set1));
+	return isl_set_union(set1, set2);
+}
+
+/* Check that all pivot rules produce the same results and
+ * that the pivot and tableau statistics are being updated.
+ */
+static int test_tab_pivot(isl_ctx *ctx)
+{
+	int i, j;
+	int rule;
+	long pivots, allocs;
+	int rules[] = { ISL_TAB_PIVOT_DANTZIG, ISL_TAB_PIVOT_STEEPEST_EDGE };
+
+	rule = isl_options_get_tab_pivot(ctx);
+	pivots = isl_ctx_get_stat(ctx, "pivots");
+	allocs = isl_ctx_get_stat(ctx, "tab_allocs");
+	for (i = 0; i < ARRAY_SIZE(dual_simplex_tests); ++i) {
+		isl_set *ref;
+
+		ref = pivot_rule_result(ctx, i, ISL_TAB_PIVOT_BLAND);
+		for (j = 0; j < ARRAY_SIZE(rules); ++j) {
+			isl_set *res;
+			int equal;
+
+			res = pivot_rule_result(ctx, i, rules[j]);
+			equal = isl_set_is_equal(ref, res);
+			isl_set_free(res);
+			if (equal < 0 || !equal)
+				break;
+		}
+		isl_set_free(ref);
+		isl_options_set_tab_pivot(ctx, rule);
+		if (j < ARRAY_SIZE(rules))
+			isl_die(ctx, isl_error_unknown,
+				"pivot rules produce different results",
+				return -1);
+	}
+	if (isl_ctx_get_stat(ctx, "pivots") <= pivots ||
+	    isl_ctx_get_stat(ctx, "tab_allocs") <= allocs)
+		isl_die(ctx, isl_error_unknown,
+			"statistics not updated", return -1);
+
+	return 0;
+}
+
+/* Check that computing the lexicographic optima of the maps
+ * in a union map using several threads produces the same result
+ * as computing them sequentially.
+ */
+static int test_union_lexopt_threads(isl_ctx *ctx)
+{
+	const char *str;
+	isl_union_map *umap, *seq, *par;
+	int n_thread;
+	int equal;
+
+	str = "[N] -> { A[i] -> [j] : 0 <= j <= i < N; "
+		"B[i] -> [j, k] : 0 <= j, k and j + k = i; "
+		"C[i] -> [j] : i <= 3j <= N; D[] -> [j] : N <= j <= 2N; "
+		"E[i, j] -> [k] : i, j <= k <= i + j + 10 }";
+	umap = isl_union_map_read_from_str(ctx, str);
+	n_thread = isl_options_get_threads(ctx);
+	isl_options_set_threads(ctx, 1);
+	seq = isl_union_map_lexmax(isl_union_map_copy(umap));
+	seq = isl_union_map_union(seq,
+			isl_union_map_lexmin(isl_union_map_copy(umap)));
+	isl_options_set_threads(ctx, 3);
+	par = isl_union_map_lexmax(isl_union_map_copy(umap));
+	par = isl_union_map_union(par, isl_union_map_lexmin(umap));
+	isl_options_set_threads(ctx, n_thread);
+	equal = isl_union_map_is_equal(seq, par);
+	isl_union_map_free(seq);
+	isl_union_map_free(par);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"parallel lexopt differs from sequential", return -1);
+
+	return 0;
+}
+
+/* Compute the lexicographic minimum and maximum of "map"
+ * using "n_thread" threads for the basic maps of "map",
+ * both in the form of an isl_map and in the form of
+ * an isl_pw_multi_aff, and return the union of the results.
+ */
+static __isl_give isl_map *lexopt_threads(__isl_keep isl_map *map,
+	int n_thread)
+{
+	isl_map *res;
+	isl_pw_multi_aff *pma;
+
+	isl_options_set_threads(isl_map_get_ctx(map), n_thread);
+	res = isl_map_lexmin(isl_map_copy(map));
+	res = isl_map_union(res, isl_map_lexmax(isl_map_copy(map)));
+	pma = isl_map_lexmin_pw_multi_aff(isl_map_copy(map));
+	res = isl_map_union(res, isl_map_from_pw_multi_aff(pma));
+	pma = isl_map_lexmax_pw_multi_aff(isl_map_copy(map));
+	res = isl_map_union(res, isl_map_from_pw_multi_aff(pma));
+
+	return res;
+}
+
+/* Check that computing the lexicographic optima of the basic maps
+ * of a map using several threads produces the same result
+ * as computing them sequentially.
+ */
+static int test_lexopt_threads(isl_ctx *ctx)
+{
+	const char *str;
+	isl_map *map, *seq, *par;
+	int n_thread;
+	int equal;
+
+	str = "[N] -> { [i] -> [j, k] : 0 <= j <= i < N and k = 0; "
+		"[i] -> [j, k] : i <= 3j <= N and 0 <= k <= j; "
+		"[i] -> [j, k] : N <= j <= 2N and k = i; "
+		"[i] -> [j, k] : 0 <= j, k and j + k = i; "
+		"[i] -> [j, k] : i <= j <= i + 10 and k = N - j }";
+	map = isl_map_read_from_str(ctx, str);
+	n_thread = isl_options_get_threads(ctx);
+	seq = lexopt_threads(map, 1);
+	par = lexopt_threads(map, 3);
+	isl_options_set_threads(ctx, n_thread);
+	isl_map_free(map);
+	equal = isl_map_is_equal(seq, par);
+	isl_map_free(seq);
+	isl_map_free(par);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"parallel lexopt differs from sequential", return -1);
+
+	return 0;
+}
+
+/* Inputs for which each output variable has a bound with unit coefficient
+ * in terms of the parameters, the input dimensions and earlier
+ * output variables, such that the lexicographic optimum
+ * can be computed without a big parameter.
+ */
+const char *pip_shift_tests[] = {
+	"[N] -> { [i] -> [j, k] : i - 5 <= j <= N and j - i <= k <= 10 }",
+	"[N] -> { [i] -> [j, k] : j = i - N and -3 <= k <= j and 2k >= i }",
+	"[N] -> { [i, j] -> [k] : 0 <= k <= N and 3k >= i + j - 7 }",
+	"{ [i] -> [j, k] : -i <= j <= i and -j <= k <= j + 2 and "
+		"j + k = 2 * floor((j + k)/2) }",
+	"[N] -> { [] -> [j, k] : -N <= j < 0 and k >= j and k <= N - j }",
+};
+
+/* Check that computing the lexicographic optimum of the elements
+ * of pip_shift_tests produces the same result with and without
+ * shifting the output variables and that the shift is actually applied.
+ */
+static int test_lexopt_shift(isl_ctx *ctx)
+{
+	int i, shift;
+	int equal;
+	long shifted;
+
+	shift = isl_options_get_pip_shift(ctx);
+	shifted = ctx->stats->pip_shifted;
+	for (i = 0; i < ARRAY_SIZE(pip_shift_tests); ++i) {
+		isl_map *map, *res1, *res2;
+
+		map = isl_map_read_from_str(ctx, pip_shift_tests[i]);
+		isl_options_set_pip_shift(ctx, 1);
+		res1 = isl_map_lexmin(isl_map_copy(map));
+		res1 = isl_map_union(res1, isl_map_lexmax(isl_map_copy(map)));
+		isl_options_set_pip_shift(ctx, 0);
+		res2 = isl_map_lexmin(isl_map_copy(map));
+		res2 = isl_map_union(res2, isl_map_lexmax(map));
+		equal = isl_map_is_equal(res1, res2);
+		isl_map_free(res1);
+		isl_map_free(res2);
+		if (equal < 0 || !equal)
+			break;
+	}
+	isl_options_set_pip_shift(ctx, shift);
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"shifted lexopt differs", return -1);
+	if (ctx->stats->pip_shifted == shifted)
+		isl_die(ctx, isl_error_unknown,
+			"output variables not shifted", return -1);
+
+	return 0;
+}
+
+/* Check that reusing a reduced basis for sampling the context
+ * of parametric integer programming does not affect the result of
+ * a lexicographic minimum computation for which the basis
+ * is actually reused.
+ */
+static int test_gbr_reuse(isl_ctx *ctx)
+{
+	const char *str;
+	isl_set *set, *res1, *res2;
+	int reuse, lll, equal;
+	long reuses;
+
+	str = "[n, m] -> { [j, k] : 0 <= n, m <= 20 and 3j <= n + 2m and "
+		"5j >= n - m and 2k <= j + n and 7k >= m - 2j + 3 }";
+	set = isl_set_read_from_str(ctx, str);
+	reuse = isl_options_get_gbr_reuse(ctx);
+	lll = isl_options_get_gbr_lll(ctx);
+	isl_options_set_gbr_lll(ctx, 0);
+	isl_options_set_gbr_reuse(ctx, 0);
+	res1 = isl_set_lexmin(isl_set_copy(set));
+	isl_options_set_gbr_reuse(ctx, 2);
+	reuses = ctx->stats->gbr_basis_reuses;
+	res2 = isl_set_lexmin(set);
+	reuses = ctx->stats->gbr_basis_reuses - reuses;
+	isl_options_set_gbr_reuse(ctx, reuse);
+	isl_options_set_gbr_lll(ctx, lll);
+	equal = isl_set_is_equal(res1, res2);
+	isl_set_free(res1);
+	isl_set_free(res2);
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"result depends on basis reuse", return -1);
+	if (reuses == 0)
+		isl_die(ctx, isl_error_unknown,
+			"reduced basis not reused", return -1);
+
+	return 0;
+}
+
+static int test_lexmin(struct isl_ctx *ctx)
+{
+	int equal;
+	const char *str;
+	isl_basic_map *bmap;
+	isl_map *map, *map2;
+	isl_set *set;
+	isl_set *set2;
+	isl_pw_multi_aff *pma;
+
+	str = "[p0, p1] -> { [] -> [] : "
+	    "exists (e0 = [(2p1)/3], e1, e2, e3 = [(3 - p1 + 3e0)/3], "
+	    "e4 = [(p1)/3], e5 = [(p1 + 3e4)/3]: "
+	    "3e0 >= -2 + 2p1 and 3e0 >= p1 and 3e3 >= 1 - p1 + 3e0 and "
+	    "3e0 <= 2p1 and 3e3 >= -2 + p1 and 3e3 <= -1 + p1 and p1 >= 3 and "
+	    "3e5 >= -2 + 2p1 and 3e5 >= p1 and 3e5 <= -1 + p1 + 3e4 and "
+	    "3e4 <= p1 and 3e4 >= -2 + p1 and e3 <= -1 + e0 and "
+	    "3e4 >= 6 - p1 + 3e1 and 3e1 >= p1 and 3e5 >= -2 + p1 + 3e4 and "
+	    "2e4 >= 3 - p1 + 2e1 and e4 <= e1 and 3e3 <= 2 - p1 + 3e0 and "
+	    "e5 >= 1 + e1 and 3e4 >= 6 - 2p1 + 3e1 and "
+	    "p0 >= 2 and p1 >= p0 and 3e2 >= p1 and 3e4 >= 6 - p1 + 3e2 and "
+	    "e2 <= e1 and e3 >= 1 and e4 <= e2) }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_lexmin(map);
+	isl_map_free(map);
+
+	str = "[C] -> { [obj,a,b,c] : obj <= 38 a + 7 b + 10 c and "
+	    "a + b <= 1 and c <= 10 b and c <= C and a,b,c,C >= 0 }";
+	set = isl_set_read_from_str(ctx, str);
+	set = isl_set_lexmax(set);
+	str = "[C] -> { [obj,a,b,c] : C = 8 }";
+	set2 = isl_set_read_from_str(ctx, str);
+	set = isl_set_intersect(set, set2);
+	assert(!isl_set_is_empty(set));
+	isl_set_free(set);
+
+	str = "{ [x] -> [y] : x <= y <= 10; [x] -> [5] : -8 <= x <= 8 }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_lexmin(map);
+	str = "{ [x] -> [5] : 6 <= x <= 8; "
+		"[x] -> [x] : x <= 5 or (9 <= x <= 10) }";
+	map2 = isl_map_read_from_str(ctx, str);
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map);
+	isl_map_free(map2);
+
+	str = "{ [x] -> [y] : 4y = x or 4y = -1 + x or 4y = -2 + x }";
+	map = isl_map_read_from_str(ctx, str);
+	map2 = isl_map_copy(map);
+	map = isl_map_lexmin(map);
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map);
+	isl_map_free(map2);
+
+	str = "{ [x] -> [y] : x = 4y; [x] -> [y] : x = 2y }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_lexmin(map);
+	str = "{ [x] -> [y] : (4y = x and x >= 0) or "
+		"(exists (e0 = [(x)/4], e1 = [(-2 + x)/4]: 2y = x and "
+		"4e1 = -2 + x and 4e0 <= -1 + x and 4e0 >= -3 + x)) or "
+		"(exists (e0 = [(x)/4]: 2y = x and 4e0 = x and x <= -4)) }";
+	map2 = isl_map_read_from_str(ctx, str);
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map);
+	isl_map_free(map2);
+
+	str = "{ [i] -> [i', j] : j = i - 8i' and i' >= 0 and i' <= 7 and "
+				" 8i' <= i and 8i' >= -7 + i }";
+	bmap = isl_basic_map_read_from_str(ctx, str);
+	pma = isl_basic_map_lexmin_pw_multi_aff(isl_basic_map_copy(bmap));
+	map2 = isl_map_from_pw_multi_aff(pma);
+	map = isl_map_from_basic_map(bmap);
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map);
+	isl_map_free(map2);
+
+	str = "{ T[a] -> S[b, c] : a = 4b-2c and c >= b }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_lexmin(map);
+	str = "{ T[a] -> S[b, c] : 2b = a and 2c = a }";
+	map2 = isl_map_read_from_str(ctx, str);
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map);
+	isl_map_free(map2);
+
+	/* Check that empty pieces are properly combined. */
+	str = "[K, N] -> { [x, y] -> [a, b] : K+2<=N<=K+4 and x>=4 and "
+		"2N-6<=x<K+N and N-1<=a<=K+N-1 and N+b-6<=a<=2N-4 and "
+		"b<=2N-3K+a and 3b<=4N-K+1 and b>=N and a>=x+1 }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_lexmin(map);
+	str = "[K, N] -> { [x, y] -> [1 + x, N] : x >= -6 + 2N and "
+		"x <= -5 + 2N and x >= -1 + 3K - N and x <= -2 + K + N and "
+		"x >= 4 }";
+	map2 = isl_map_read_from_str(ctx, str);
+	assert(isl_map_is_equal(map, map2));
+	isl_map_free(map);
+	isl_map_free(map2);
+
+	/* Check the combination of the results for many basic maps. */
+	str = "{ [x] -> [5] : 0 <= x <= 10; [x] -> [3] : 2 <= x <= 4; "
+		"[x] -> [7] : 8 <= x <= 12; [x] -> [1] : x = 9; "
+		"[x] -> [4] : 3 <= x <= 9 }";
+	map = isl_map_read_from_str(ctx, str);
+	pma = isl_map_lexmin_pw_multi_aff(isl_map_copy(map));
+	map = isl_map_lexmin(map);
+	str = "{ [x] -> [5] : 0 <= x <= 1 or x = 10; "
+		"[x] -> [3] : 2 <= x <= 4; [x] -> [4] : 5 <= x <= 8; "
+		"[x] -> [1] : x = 9; [x] -> [7] : 11 <= x <= 12 }";
+	map2 = isl_map_read_from_str(ctx, str);
+	equal = isl_map_is_equal(map, map2);
+	isl_map_free(map);
+	if (equal >= 0 && equal) {
+		map = isl_map_from_pw_multi_aff(pma);
+		pma = NULL;
+		equal = isl_map_is_equal(map, map2);
+		isl_map_free(map);
+	}
+	isl_pw_multi_aff_free(pma);
+	isl_map_free(map2);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected lexmin of union", return -1);
+
+	str = "[i] -> { [i', j] : j = i - 8i' and i' >= 0 and i' <= 7 and "
+				" 8i' <= i and 8i' >= -7 + i }";
+	set = isl_set_read_from_str(ctx, str);
+	pma = isl_set_lexmin_pw_multi_aff(isl_set_copy(set));
+	set2 = isl_set_from_pw_multi_aff(pma);
+	equal = isl_set_is_equal(set, set2);
+	isl_set_free(set);
+	isl_set_free(set2);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected difference between set and "
+			"piecewise affine expression", return -1);
+
+	if (test_union_lexopt_threads(ctx) < 0)
+		return -1;
+
+	if (test_lexopt_threads(ctx) < 0)
+		return -1;
+
+	if (test_lexopt_shift(ctx) < 0)
+		return -1;
+
+	return test_gbr_reuse(ctx);
+}
+
+/* Add the piece "dom" -> "maff" to the isl_pw_multi_aff pointed to
+ * by "user".
+ */
+static int add_lexopt_piece(__isl_take isl_basic_set *dom,
+	__isl_take isl_multi_aff *maff, void *user)
+{
+	isl_pw_multi_aff **pma = user;
+	isl_pw_multi_aff *piece;
+
+	piece = isl_pw_multi_aff_alloc(isl_set_from_basic_set(dom), maff);
+	*pma = isl_pw_multi_aff_add_disjoint(*pma, piece);
+
+	return *pma ? 0 : -1;
+}
+
+static int abort_lexopt(__isl_take isl_basic_set *dom,
+	__isl_take isl_multi_aff *maff, void *user)
+{
+	isl_basic_set_free(dom);
+	isl_multi_aff_free(maff);
+	return -1;
+}
+
+/* Inputs for test_foreach_lexopt, along with a domain.
+ */
+struct {
+	const char *map;
+	const char *dom;
+} foreach_lexopt_tests[] = {
+	{ "[K, N] -> { [x, y] -> [a, b] : K+2<=N<=K+4 and x>=4 and "
+		"2N-6<=x<K+N and N-1<=a<=K+N-1 and N+b-6<=a<=2N-4 and "
+		"b<=2N-3K+a and 3b<=4N-K+1 and b>=N and a>=x+1 }",
+	  "[K, N] -> { [x, y] : x <= 10 }" },
+	{ "{ [i] -> [i', j] : j = i - 8i' and i' >= 0 and i' <= 7 and "
+		"8i' <= i and 8i' >= -7 + i }",
+	  "{ [i] : exists (e : i = 2e) }" },
+	{ "[n] -> { [i] -> [j] : j >= i and j >= n - i and 2j <= n + 5 }",
+	  "[n] -> { [i] : 0 <= i <= n }" },
+};
+
+/* Check that the pieces reported by isl_basic_map_foreach_lexmin,
+ * isl_basic_map_foreach_lexmax and isl_basic_map_foreach_partial_lexmin
+ * combine to the same result as that of the corresponding functions
+ * that compute the entire result and that the computation
+ * can be aborted.
+ */
+static int test_foreach_lexopt(isl_ctx *ctx)
+{
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(foreach_lexopt_tests); ++i) {
+		for (j = 0; j < 3; ++j) {
+			isl_basic_map *bmap;
+			isl_basic_set *dom;
+			isl_pw_multi_aff *pma;
+			isl_map *map1, *map2;
+			int r, equal;
+
+			bmap = isl_basic_map_read_from_str(ctx,
+						foreach_lexopt_tests[i].map);
+			dom = isl_basic_set_read_from_str(ctx,
+						foreach_lexopt_tests[i].dom);
+			pma = isl_pw_multi_aff_empty(
+					isl_basic_map_get_space(bmap));
+			if (j == 0) {
+				r = isl_basic_map_foreach_lexmin(bmap,
+						&add_lexopt_piece, &pma);
+				map2 = isl_basic_map_lexmin(
+						isl_basic_map_copy(bmap));
+			} else if (j == 1) {
+				r = isl_basic_map_foreach_lexmax(bmap,
+						&add_lexopt_piece, &pma);
+				map2 = isl_basic_map_lexmax(
+						isl_basic_map_copy(bmap));
+			} else {
+				r = isl_basic_map_foreach_partial_lexmin(bmap,
+						dom, &add_lexopt_piece, &pma);
+				map2 = isl_basic_map_partial_lexmin(
+						isl_basic_map_copy(bmap),
+						isl_basic_set_copy(dom), NULL);
+			}
+			map1 = isl_map_from_pw_multi_aff(pma);
+			equal = isl_map_is_equal(map1, map2);
+			isl_map_free(map1);
+			isl_map_free(map2);
+			if (equal >= 0 && equal && r >= 0 &&
+			    j == 0 && !isl_basic_map_plain_is_empty(bmap) &&
+			    isl_basic_map_foreach_lexmin(bmap,
+					&abort_lexopt, NULL) != -1)
+				isl_die(ctx, isl_error_unknown,
+					"computation not aborted",
+					equal = -1);
+			isl_basic_set_free(dom);
+			isl_basic_map_free(bmap);
+			if (r < 0 || equal < 0)
+				return -1;
+			if (!equal)
+				isl_die(ctx, isl_error_unknown,
+					"pieces do not combine to "
+					"lexicographic optimum", return -1);
+		}
+	}
+
+	return 0;
+}
+
+/* Check that isl_set_min_val and isl_set_max_val compute the correct
+ * result on non-convex inputs.
+ */
+static int test_min(struct isl_ctx *ctx)
+{
+	isl_set *set;
+	isl_aff *aff;
+	isl_val *val;
+	int min_ok, max_ok;
+
+	set = isl_set_read_from_str(ctx, "{ [-1]; [1] }");
+	aff = isl_aff_read_from_str(ctx, "{ [x] -> [x] }");
+	val = isl_set_min_val(set, aff);
+	min_ok = isl_val_is_negone(val);
+	isl_val_free(val);
+	val = isl_set_max_val(set, aff);
+	max_ok = isl_val_is_one(val);
+	isl_val_free(val);
+	isl_aff_free(aff);
+	isl_set_free(set);
+
+	if (min_ok < 0 || max_ok < 0)
+		return -1;
+	if (!min_ok)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected minimum", return -1);
+	if (!max_ok)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected maximum", return -1);
+
+	return 0;
+}
+
+/* Sets, integer affine expressions and the expected minimum and maximum
+ * of the expression over the set, used in test_min_disjuncts.
+ */
+struct {
+	const char *set;
+	const char *obj;
+	const char *min;
+	const char *max;
+} min_disjuncts_tests[] = {
+	{ "{ [x, y] : 0 <= x <= 10 and y = x; [x, y] : 3 <= x <= 7 and "
+	  "y = 2x; [x, y] : x = 1 and 0 <= y <= 3 }",
+	  "{ [x, y] -> [(x + y)] }", "0", "21" },
+	{ "{ [x] : 5 <= x <= 6; [x] : 1 = 0; [x] : 2 <= 2x <= 3 }",
+	  "{ [x] -> [(3x)] }", "3", "18" },
+	{ "{ [x] : 0 <= x <= 10; [x] : x >= 20 }",
+	  "{ [x] -> [(x)] }", "0", "infty" },
+	{ "{ [x] : exists a : x = 3a and 1 <= x <= 10; "
+	  "[x] : exists a : x = 5a + 1 and 2 <= x <= 20 }",
+	  "{ [x] -> [(floor(x/2))] }", "1", "8" },
+	{ "{ [x] : 1 = 0 }", "{ [x] -> [(x)] }", "NaN", "NaN" },
+};
+
+/* Check that isl_set_min_val and isl_set_max_val compute the expected
+ * results on the inputs in min_disjuncts_tests, with and without
+ * pruning and with and without multiple threads.
+ */
+static int test_min_disjuncts(isl_ctx *ctx)
+{
+	int i, j;
+	int prune, n_thread;
+
+	prune = isl_options_get_ilp_prune(ctx);
+	n_thread = isl_options_get_threads(ctx);
+	for (j = 0; j < 4; ++j) {
+		isl_options_set_ilp_prune(ctx, j % 2);
+		isl_options_set_threads(ctx, j < 2 ? 1 : 3);
+		for (i = 0; i < ARRAY_SIZE(min_disjuncts_tests); ++i) {
+			isl_set *set;
+			isl_aff *obj;
+			isl_val *v, *min, *max;
+			int ok;
+
+			set = isl_set_read_from_str(ctx,
+						min_disjuncts_tests[i].set);
+			obj = isl_aff_read_from_str(ctx,
+						min_disjuncts_tests[i].obj);
+			min = isl_val_read_from_str(ctx,
+						min_disjuncts_tests[i].min);
+			max = isl_val_read_from_str(ctx,
+						min_disjuncts_tests[i].max);
+			v = isl_set_min_val(set, obj);
+			ok = isl_val_is_nan(min) ? isl_val_is_nan(v) :
+							isl_val_eq(v, min);
+			isl_val_free(v);
+			if (ok > 0) {
+				v = isl_set_max_val(set, obj);
+				ok = isl_val_is_nan(max) ? isl_val_is_nan(v) :
+							isl_val_eq(v, max);
+				isl_val_free(v);
+			}
+			isl_val_free(min);
+			isl_val_free(max);
+			isl_aff_free(obj);
+			isl_set_free(set);
+			if (!ok)
+				isl_die(ctx, isl_error_unknown,
+					"unexpected optimum", ok = -1);
+			if (ok < 0)
+				break;
+		}
+		if (i < ARRAY_SIZE(min_disjuncts_tests))
+			break;
+	}
+	isl_options_set_ilp_prune(ctx, prune);
+	isl_options_set_threads(ctx, n_thread);
+
+	return j < 4 ? -1 : 0;
+}
+
+struct must_may {
+	isl_map *must;
+	isl_map *may;
+};
+
+static int collect_must_may(__isl_take isl_map *dep, int must,
+	void *dep_user, void *user)
+{
+	struct must_may *mm = (struct must_may *)user;
+
+	if (must)
+		mm->must = isl_map_union(mm->must, dep);
+	else
+		mm->may = isl_map_union(mm->may, dep);
+
+	return 0;
+}
+
+static int common_space(void *first, void *second)
+{
+	int depth = *(int *)first;
+	return 2 * depth;
+}
+
+static int map_is_equal(__isl_keep isl_map *map, const char *str)
+{
+	isl_map *map2;
+	int equal;
+
+	if (!map)
+		return -1;
+
+	map2 = isl_map_read_from_str(map->ctx, str);
+	equal = isl_map_is_equal(map, map2);
+	isl_map_free(map2);
+
+	return equal;
+}
+
+static int map_check_equal(__isl_keep isl_map *map, const char *str)
+{
+	int equal;
+
+	equal = map_is_equal(map, str);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(isl_map_get_ctx(map), isl_error_unknown,
+			"result not as expected", return -1);
+	return 0;
+}
+
+void test_dep(struct isl_ctx *ctx)
+{
+	const char *str;
+	isl_space *dim;
+	isl_map *map;
+	isl_access_info *ai;
+	isl_flow *flow;
+	int depth;
+	long pruned;
+	struct must_may mm;
+
+	depth = 3;
+
+	str = "{ [2,i,0] -> [i] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_alloc(map, &depth, &common_space, 2);
+
+	str = "{ [0,i,0] -> [i] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_add_source(ai, map, 1, &depth);
+
+	str = "{ [1,i,0] -> [5] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_add_source(ai, map, 1, &depth);
+
+	flow = isl_access_info_compute_flow(ai);
+	dim = isl_space_alloc(ctx, 0, 3, 3);
+	mm.must = isl_map_empty(isl_space_copy(dim));
+	mm.may = isl_map_empty(dim);
+
+	isl_flow_foreach(flow, collect_must_may, &mm);
+
+	str = "{ [0,i,0] -> [2,i,0] : (0 <= i <= 4) or (6 <= i <= 10); "
+	      "  [1,10,0] -> [2,5,0] }";
+	assert(map_is_equal(mm.must, str));
+	str = "{ [i,j,k] -> [l,m,n] : 1 = 0 }";
+	assert(map_is_equal(mm.may, str));
+
+	isl_map_free(mm.must);
+	isl_map_free(mm.may);
+	isl_flow_free(flow);
+
+
+	str = "{ [2,i,0] -> [i] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_alloc(map, &depth, &common_space, 2);
+
+	str = "{ [0,i,0] -> [i] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_add_source(ai, map, 1, &depth);
+
+	str = "{ [1,i,0] -> [5] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_add_source(ai, map, 0, &depth);
+
+	flow = isl_access_info_compute_flow(ai);
+	dim = isl_space_alloc(ctx, 0, 3, 3);
+	mm.must = isl_map_empty(isl_space_copy(dim));
+	mm.may = isl_map_empty(dim);
+
+	isl_flow_foreach(flow, collect_must_may, &mm);
+
+	str = "{ [0,i,0] -> [2,i,0] : (0 <= i <= 4) or (6 <= i <= 10) }";
+	assert(map_is_equal(mm.must, str));
+	str = "{ [0,5,0] -> [2,5,0]; [1,i,0] -> [2,5,0] : 0 <= i <= 10 }";
+	assert(map_is_equal(mm.may, str));
+
+	isl_map_free(mm.must);
+	isl_map_free(mm.may);
+	isl_flow_free(flow);
+
+
+	str = "{ [2,i,0] -> [i] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_alloc(map, &depth, &common_space, 2);
+
+	str = "{ [0,i,0] -> [i] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_add_source(ai, map, 0, &depth);
+
+	str = "{ [1,i,0] -> [5] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_add_source(ai, map, 0, &depth);
+
+	flow = isl_access_info_compute_flow(ai);
+	dim = isl_space_alloc(ctx, 0, 3, 3);
+	mm.must = isl_map_empty(isl_space_copy(dim));
+	mm.may = isl_map_empty(dim);
+
+	isl_flow_foreach(flow, collect_must_may, &mm);
+
+	str = "{ [0,i,0] -> [2,i,0] : 0 <= i <= 10; "
+	      "  [1,i,0] -> [2,5,0] : 0 <= i <= 10 }";
+	assert(map_is_equal(mm.may, str));
+	str = "{ [i,j,k] -> [l,m,n] : 1 = 0 }";
+	assert(map_is_equal(mm.must, str));
+
+	isl_map_free(mm.must);
+	isl_map_free(mm.may);
+	isl_flow_free(flow);
+
+
+	str = "{ [0,i,2] -> [i] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_alloc(map, &depth, &common_space, 2);
+
+	str = "{ [0,i,0] -> [i] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_add_source(ai, map, 0, &depth);
+
+	str = "{ [0,i,1] -> [5] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_add_source(ai, map, 0, &depth);
+
+	flow = isl_access_info_compute_flow(ai);
+	dim = isl_space_alloc(ctx, 0, 3, 3);
+	mm.must = isl_map_empty(isl_space_copy(dim));
+	mm.may = isl_map_empty(dim);
+
+	isl_flow_foreach(flow, collect_must_may, &mm);
+
+	str = "{ [0,i,0] -> [0,i,2] : 0 <= i <= 10; "
+	      "  [0,i,1] -> [0,5,2] : 0 <= i <= 5 }";
+	assert(map_is_equal(mm.may, str));
+	str = "{ [i,j,k] -> [l,m,n] : 1 = 0 }";
+	assert(map_is_equal(mm.must, str));
+
+	isl_map_free(mm.must);
+	isl_map_free(mm.may);
+	isl_flow_free(flow);
+
+
+	str = "{ [0,i,1] -> [i] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_alloc(map, &depth, &common_space, 2);
+
+	str = "{ [0,i,0] -> [i] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_add_source(ai, map, 0, &depth);
+
+	str = "{ [0,i,2] -> [5] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_add_source(ai, map, 0, &depth);
+
+	flow = isl_access_info_compute_flow(ai);
+	dim = isl_space_alloc(ctx, 0, 3, 3);
+	mm.must = isl_map_empty(isl_space_copy(dim));
+	mm.may = isl_map_empty(dim);
+
+	isl_flow_foreach(flow, collect_must_may, &mm);
+
+	str = "{ [0,i,0] -> [0,i,1] : 0 <= i <= 10; "
+	      "  [0,i,2] -> [0,5,1] : 0 <= i <= 4 }";
+	assert(map_is_equal(mm.may, str));
+	str = "{ [i,j,k] -> [l,m,n] : 1 = 0 }";
+	assert(map_is_equal(mm.must, str));
+
+	isl_map_free(mm.must);
+	isl_map_free(mm.may);
+	isl_flow_free(flow);
+
+
+	depth = 5;
+
+	str = "{ [1,i,0,0,0] -> [i,j] : 0 <= i <= 10 and 0 <= j <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_alloc(map, &depth, &common_space, 1);
+
+	str = "{ [0,i,0,j,0] -> [i,j] : 0 <= i <= 10 and 0 <= j <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_add_source(ai, map, 1, &depth);
+
+	flow = isl_access_info_compute_flow(ai);
+	dim = isl_space_alloc(ctx, 0, 5, 5);
+	mm.must = isl_map_empty(isl_space_copy(dim));
+	mm.may = isl_map_empty(dim);
+
+	isl_flow_foreach(flow, collect_must_may, &mm);
+
+	str = "{ [0,i,0,j,0] -> [1,i,0,0,0] : 0 <= i,j <= 10 }";
+	assert(map_is_equal(mm.must, str));
+	str = "{ [0,0,0,0,0] -> [0,0,0,0,0] : 1 = 0 }";
+	assert(map_is_equal(mm.may, str));
+
+	isl_map_free(mm.must);
+	isl_map_free(mm.may);
+	isl_flow_free(flow);
+
+
+	depth = 3;
+	pruned = isl_ctx_get_stat(ctx, "flow_sources_pruned");
+
+	str = "{ [2,i,0] -> [i] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_alloc(map, &depth, &common_space, 3);
+
+	str = "{ [0,i,0] -> [i + 20] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_add_source(ai, map, 1, &depth);
+
+	str = "{ [1,i,0] -> [i] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_add_source(ai, map, 1, &depth);
+
+	str = "{ [1,i,1] -> [-1] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_add_source(ai, map, 0, &depth);
+
+	flow = isl_access_info_compute_flow(ai);
+	dim = isl_space_alloc(ctx, 0, 3, 3);
+	mm.must = isl_map_empty(isl_space_copy(dim));
+	mm.may = isl_map_empty(dim);
+
+	isl_flow_foreach(flow, collect_must_may, &mm);
+
+	str = "{ [1,i,0] -> [2,i,0] : 0 <= i <= 10 }";
+	assert(map_is_equal(mm.must, str));
+	str = "{ [i,j,k] -> [l,m,n] : 1 = 0 }";
+	assert(map_is_equal(mm.may, str));
+	assert(isl_ctx_get_stat(ctx, "flow_sources_pruned") == pruned + 2);
+
+	isl_map_free(mm.must);
+	isl_map_free(mm.may);
+	isl_flow_free(flow);
+}
+
+/* Check that isl_map_intersect_equal_more_at produces the same results
+ * as intersecting with isl_basic_map_equal or isl_basic_map_more_at.
+ */
+static int test_intersect_equal_more_at(isl_ctx *ctx)
+{
+	const char *str;
+	int pos, more;
+
+	str = "[N] -> { [i, j, k] -> [a, b, c] : 0 <= i, j, a, b <= N and "
+		"k = 2a - b; [i, j, k] -> [a, b, c] : i = 2a and c > N }";
+	for (pos = 0; pos <= 3; ++pos)
+		for (more = 0; more <= 1; ++more) {
+			isl_map *map, *map2;
+			isl_basic_map *bmap;
+			int equal;
+
+			if (pos + more > 3)
+				continue;
+			map = isl_map_read_from_str(ctx, str);
+			map2 = isl_map_copy(map);
+			map = isl_map_intersect_equal_more_at(map, pos, more);
+			if (more)
+				bmap = isl_basic_map_more_at(
+					isl_map_get_space(map2), pos);
+			else
+				bmap = isl_basic_map_equal(
+					isl_map_get_space(map2), pos);
+			map2 = isl_map_intersect(map2,
+					isl_map_from_basic_map(bmap));
+			equal = isl_map_is_equal(map, map2);
+			isl_map_free(map);
+			isl_map_free(map2);
+			if (equal < 0)
+				return -1;
+			if (!equal)
+				isl_die(ctx, isl_error_unknown,
+					"unexpected result", return -1);
+		}
+
+	return 0;
+}
+
+/* A restriction callback that does not restrict anything.
+ */
+static __isl_give isl_restriction *restrict_none(__isl_keep isl_map *source_map,
+	__isl_keep isl_set *sink, void *source_user, void *user)
+{
+	return isl_restriction_none(isl_map_copy(source_map));
+}
+
+/* Check that results of the parametric lexicographic maximum
+ * computations are reused during the analysis of a single sink.
+ * In this example, the same problem with empty dependences
+ * is encountered more than once.  The restriction callback
+ * prevents these empty dependences from being handled
+ * without any lexicographic maximum computation.
+ */
+static int test_flow_lexmax_memo(isl_ctx *ctx)
+{
+	const char *str;
+	isl_space *space;
+	isl_map *map;
+	isl_access_info *ai;
+	isl_flow *flow;
+	int depth = 3;
+	long hits;
+	struct must_may mm;
+	int r = 0;
+
+	hits = isl_ctx_get_stat(ctx, "flow_lexmax_memo_hits");
+
+	str = "{ [2,i,0] -> [i] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_alloc(map, &depth, &common_space, 2);
+	ai = isl_access_info_set_restrict(ai, &restrict_none, NULL);
+	str = "{ [0,i,0] -> [i] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_add_source(ai, map, 1, &depth);
+	str = "{ [1,i,0] -> [5] : 0 <= i <= 10 }";
+	map = isl_map_read_from_str(ctx, str);
+	ai = isl_access_info_add_source(ai, map, 1, &depth);
+	flow = isl_access_info_compute_flow(ai);
+
+	space = isl_space_alloc(ctx, 0, 3, 3);
+	mm.must = isl_map_empty(isl_space_copy(space));
+	mm.may = isl_map_empty(space);
+	if (isl_flow_foreach(flow, collect_must_may, &mm) < 0)
+		r = -1;
+	str = "{ [0,i,0] -> [2,i,0] : (0 <= i <= 4) or (6 <= i <= 10); "
+	      "  [1,10,0] -> [2,5,0] }";
+	if (r == 0 && map_check_equal(mm.must, str) < 0)
+		r = -1;
+	isl_map_free(mm.must);
+	isl_map_free(mm.may);
+	isl_flow_free(flow);
+	if (r < 0)
+		return -1;
+
+	if (isl_ctx_get_stat(ctx, "flow_lexmax_memo_hits") <= hits)
+		isl_die(ctx, isl_error_unknown,
+			"lexmax results not reused", return -1);
+
+	return 0;
+}
+
+/* Compute the must-dependences between the accesses in "access"
+ * (which are treated as both sinks and must-sources) under
+ * the schedule "schedule" and the sink iterations without source.
+ */
+static int compute_flow_str(isl_ctx *ctx, const char *access,
+	const char *schedule, isl_union_map **must_dep,
+	isl_union_map **must_no_source)
+{
+	isl_union_map *acc, *may, *sched;
+
+	acc = isl_union_map_read_from_str(ctx, access);
+	may = isl_union_map_empty(isl_union_map_get_space(acc));
+	sched = isl_union_map_read_from_str(ctx, schedule);
+	return isl_union_map_compute_flow(isl_union_map_copy(acc), acc, may,
+				sched, must_dep, NULL, must_no_source, NULL);
+}
+
+/* Check that the results of the dataflow analysis do not depend
+ * on whether the flow cache is enabled and that the results
+ * for the sinks that are not affected by adding some accesses
+ * are reused.
+ */
+static int test_flow_cache(isl_ctx *ctx)
+{
+	const char *acc1, *acc2, *sched;
+	isl_union_map *dep1, *dep2, *no1, *no2;
+	long hits;
+	int equal, equal_no;
+	int r = 0;
+
+	acc1 = "{ S0[i] -> A[i]; S1[i] -> A[i - 1] }";
+	acc2 = "{ S0[i] -> A[i]; S1[i] -> A[i - 1]; "
+		"S2[i] -> B[i]; S3[i] -> B[i + 1] }";
+	sched = "{ S0[i] -> [i, 0] : 0 <= i < 10; S1[i] -> [i, 1] : 0 < i < 10; "
+		"S2[i] -> [i, 2] : 0 <= i < 10; S3[i] -> [i, 3] : 0 <= i < 9 }";
+
+	if (compute_flow_str(ctx, acc2, sched, &dep1, &no1) < 0)
+		return -1;
+
+	isl_options_set_flow_cache_size(ctx, 16);
+	if (compute_flow_str(ctx, acc1, sched, &dep2, &no2) < 0)
+		r = -1;
+	isl_union_map_free(dep2);
+	isl_union_map_free(no2);
+	hits = isl_ctx_get_stat(ctx, "flow_cache_hits");
+	if (r >= 0 && compute_flow_str(ctx, acc2, sched, &dep2, &no2) < 0)
+		r = -1;
+	isl_options_set_flow_cache_size(ctx, 0);
+	if (r < 0) {
+		isl_union_map_free(dep1);
+		isl_union_map_free(no1);
+		return -1;
+	}
+
+	equal = isl_union_map_is_equal(dep1, dep2);
+	equal_no = isl_union_map_is_equal(no1, no2);
+	isl_union_map_free(dep1);
+	isl_union_map_free(dep2);
+	isl_union_map_free(no1);
+	isl_union_map_free(no2);
+	if (equal < 0 || equal_no < 0)
+		return -1;
+	if (!equal || !equal_no)
+		isl_die(ctx, isl_error_unknown,
+			"flow cache changes result", return -1);
+	if (isl_ctx_get_stat(ctx, "flow_cache_hits") < hits + 2)
+		isl_die(ctx, isl_error_unknown,
+			"unaffected sinks not reused", return -1);
+
+	return 0;
+}
+
+/* Check that the sources are sorted correctly, both when
+ * they can be sorted on the first schedule dimension (up to ties)
+ * and when some of them do not have a fixed first schedule dimension.
+ */
+static int test_flow_sort_keys(isl_ctx *ctx)
+{
+	int i;
+	const char *acc, *sched[2], *str;
+	isl_union_map *dep, *no, *expected;
+	int equal;
+
+	acc = "{ S3[i] -> A[]; S0[] -> A[]; S2[i] -> A[]; S1[] -> A[]; "
+		"S4[] -> A[] }";
+	sched[0] = "{ S0[] -> [0, 0, 0]; S1[] -> [1, 0, 0]; "
+		"S2[i] -> [2, i, 0] : 0 <= i < 10; "
+		"S3[i] -> [2, i, 1] : 0 <= i < 10; S4[] -> [3, 0, 0] }";
+	sched[1] = "{ S0[] -> [0, 0, 0]; S1[] -> [1, 0, 0]; "
+		"S2[i] -> [i, 10, 0] : 2 <= i < 12; "
+		"S3[i] -> [i, 10, 1] : 2 <= i < 12; S4[] -> [12, 0, 0] }";
+	str = "{ S0[] -> S1[]; S1[] -> S2[0]; S2[i] -> S3[i] : 0 <= i < 10; "
+		"S3[i] -> S2[i + 1] : 0 <= i < 9; S3[9] -> S4[] }";
+
+	for (i = 0; i < 2; ++i) {
+		if (compute_flow_str(ctx, acc, sched[i], &dep, &no) < 0)
+			return -1;
+		expected = isl_union_map_read_from_str(ctx, str);
+		if (i == 1) {
+			isl_union_map *shift;
+			shift = isl_union_map_read_from_str(ctx,
+			    "{ S0[] -> S0[]; S1[] -> S1[]; S4[] -> S4[]; "
+			    "S2[i] -> S2[i + 2]; S3[i] -> S3[i + 2] }");
+			expected = isl_union_map_apply_domain(expected,
+					isl_union_map_copy(shift));
+			expected = isl_union_map_apply_range(expected, shift);
+		}
+		equal = isl_union_map_is_equal(dep, expected);
+		isl_union_map_free(dep);
+		isl_union_map_free(no);
+		isl_union_map_free(expected);
+		if (equal < 0)
+			return -1;
+		if (!equal)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected dependences", return -1);
+	}
+
+	return 0;
+}
+
+/* Compute the must-dependences, may-dependences and the sink iterations
+ * without must-source between the sinks "sink" and
+ * the must-sources "must" and the may-sources "may" under
+ * the schedule "schedule", using "n_thread" threads.
+ */
+static int compute_flow_threads_str(isl_ctx *ctx, const char *sink,
+	const char *must, const char *may, const char *schedule, int n_thread,
+	isl_union_map **must_dep, isl_union_map **may_dep,
+	isl_union_map **must_no_source)
+{
+	int old, r;
+
+	old = isl_options_get_threads(ctx);
+	isl_options_set_threads(ctx, n_thread);
+	r = isl_union_map_compute_flow(isl_union_map_read_from_str(ctx, sink),
+		isl_union_map_read_from_str(ctx, must),
+		isl_union_map_read_from_str(ctx, may),
+		isl_union_map_read_from_str(ctx, schedule),
+		must_dep, may_dep, must_no_source, NULL);
+	isl_options_set_threads(ctx, old);
+
+	return r;
+}
+
+/* Check that analyzing the sink accesses by several threads
+ * produces the same results as analyzing them in a single thread.
+ */
+static int test_flow_threads(isl_ctx *ctx)
+{
+	const char *sink, *must, *may, *sched;
+	isl_union_map *must1, *may1, *no1, *must2, *may2, *no2;
+	int equal, equal_may, equal_no;
+
+	sink = "{ S1[i] -> A[i - 1]; S2[i] -> A[i]; S3[i] -> B[i + 1]; "
+		"S4[i] -> B[i]; S4[i] -> A[i - 2] }";
+	must = "{ S0[i] -> A[i]; S2[i] -> B[i]; S3[i] -> A[i + 1] }";
+	may = "{ S1[i] -> B[i]; S4[i] -> A[i] }";
+	sched = "{ S0[i] -> [i, 0] : 0 <= i < 10; S1[i] -> [i, 1] : 0 < i < 10; "
+		"S2[i] -> [i, 2] : 0 <= i < 10; S3[i] -> [i, 3] : 0 <= i < 9; "
+		"S4[i] -> [i, 4] : 2 <= i < 10 }";
+
+	if (compute_flow_threads_str(ctx, sink, must, may, sched, 1,
+					&must1, &may1, &no1) < 0)
+		return -1;
+	if (compute_flow_threads_str(ctx, sink, must, may, sched, 3,
+					&must2, &may2, &no2) < 0) {
+		isl_union_map_free(must1);
+		isl_union_map_free(may1);
+		isl_union_map_free(no1);
+		return -1;
+	}
+
+	equal = isl_union_map_is_equal(must1, must2);
+	equal_may = isl_union_map_is_equal(may1, may2);
+	equal_no = isl_union_map_is_equal(no1, no2);
+	isl_union_map_free(must1);
+	isl_union_map_free(may1);
+	isl_union_map_free(no1);
+	isl_union_map_free(must2);
+	isl_union_map_free(may2);
+	isl_union_map_free(no2);
+	if (equal < 0 || equal_may < 0 || equal_no < 0)
+		return -1;
+	if (!equal || !equal_may || !equal_no)
+		isl_die(ctx, isl_error_unknown,
+			"parallel dataflow analysis differs from sequential",
+			return -1);
+
+	return 0;
+}
+
+/* Check that the dependence analysis proceeds without errors.
+ * Earlier versions of isl would break down during the analysis
+ * due to the use of the wrong spaces.
+ */
+static int test_flow(isl_ctx *ctx)
+{
+	const char *str;
+	isl_union_map *access, *schedule;
+	isl_union_map *must_dep, *may_dep;
+	int r;
+
+	str = "{ S0[j] -> i[]; S1[j,i] -> i[]; S2[] -> i[]; S3[] -> i[] }";
+	access = isl_union_map_read_from_str(ctx, str);
+	str = "{ S0[j] -> [0,j,0,0] : 0 <= j < 10; "
+		"S1[j,i] -> [0,j,1,i] : 0 <= j < i < 10; "
+		"S2[] -> [1,0,0,0]; "
+		"S3[] -> [-1,0,0,0] }";
+	schedule = isl_union_map_read_from_str(ctx, str);
+	r = isl_union_map_compute_flow(access, isl_union_map_copy(access),
+					isl_union_map_copy(access), schedule,
+					&must_dep, &may_dep, NULL, NULL);
+	isl_union_map_free(may_dep);
+	isl_union_map_free(must_dep);
+	if (r < 0)
+		return -1;
+
+	if (test_flow_cache(ctx) < 0)
+		return -1;
+	if (test_flow_sort_keys(ctx) < 0)
+		return -1;
+	if (test_flow_threads(ctx) < 0)
+		return -1;
+	if (test_flow_lexmax_memo(ctx) < 0)
+		return -1;
+	if (test_intersect_equal_more_at(ctx) < 0)
+		return -1;
+
+	return 0;
+}
+
+struct {
+	const char *map;
+	int sv;
+} sv_tests[] = {
+	{ "[N] -> { [i] -> [f] : 0 <= i <= N and 0 <= i - 10 f <= 9 }", 1 },
+	{ "[N] -> { [i] -> [f] : 0 <= i <= N and 0 <= i - 10 f <= 10 }", 0 },
+	{ "{ [i] -> [3*floor(i/2) + 5*floor(i/3)] }", 1 },
+	{ "{ S1[i] -> [i] : 0 <= i <= 9; S2[i] -> [i] : 0 <= i <= 9 }", 1 },
+	{ "{ [i] -> S1[i] : 0 <= i <= 9; [i] -> S2[i] : 0 <= i <= 9 }", 0 },
+	{ "{ A[i] -> [i]; B[i] -> [i]; B[i] -> [i + 1] }", 0 },
+	{ "{ A[i] -> [i]; B[i] -> [i] : i < 0; B[i] -> [i + 1] : i > 0 }", 1 },
+	{ "{ A[i] -> [i]; B[i] -> A[i] : i < 0; B[i] -> [i + 1] : i > 0 }", 1 },
+	{ "{ A[i] -> [i]; B[i] -> [j] : i - 1 <= j <= i }", 0 },
+};
+
+int test_sv(isl_ctx *ctx)
+{
+	isl_union_map *umap;
+	int i;
+	int sv;
+
+	for (i = 0; i < ARRAY_SIZE(sv_tests); ++i) {
+		umap = isl_union_map_read_from_str(ctx, sv_tests[i].map);
+		sv = isl_union_map_is_single_valued(umap);
+		isl_union_map_free(umap);
+		if (sv < 0)
+			return -1;
+		if (sv_tests[i].sv && !sv)
+			isl_die(ctx, isl_error_internal,
+				"map not detected as single valued", return -1);
+		if (!sv_tests[i].sv && sv)
+			isl_die(ctx, isl_error_internal,
+				"map detected as single valued", return -1);
+	}
+
+	return 0;
+}
+
+void test_bijective_case(struct isl_ctx *ctx, const char *str, int bijective)
+{
+	isl_map *map;
+
+	map = isl_map_read_from_str(ctx, str);
+	if (bijective)
+		assert(isl_map_is_bijective(map));
+	else
+		assert(!isl_map_is_bijective(map));
+	isl_map_free(map);
+}
+
+void test_bijective(struct isl_ctx *ctx)
+{
+	test_bijective_case(ctx, "[N,M]->{[i,j] -> [i]}", 0);
+	test_bijective_case(ctx, "[N,M]->{[i,j] -> [i] : j=i}", 1);
+	test_bijective_case(ctx, "[N,M]->{[i,j] -> [i] : j=0}", 1);
+	test_bijective_case(ctx, "[N,M]->{[i,j] -> [i] : j=N}", 1);
+	test_bijective_case(ctx, "[N,M]->{[i,j] -> [j,i]}", 1);
+	test_bijective_case(ctx, "[N,M]->{[i,j] -> [i+j]}", 0);
+	test_bijective_case(ctx, "[N,M]->{[i,j] -> []}", 0);
+	test_bijective_case(ctx, "[N,M]->{[i,j] -> [i,j,N]}", 1);
+	test_bijective_case(ctx, "[N,M]->{[i,j] -> [2i]}", 0);
+	test_bijective_case(ctx, "[N,M]->{[i,j] -> [i,i]}", 0);
+	test_bijective_case(ctx, "[N,M]->{[i,j] -> [2i,i]}", 0);
+	test_bijective_case(ctx, "[N,M]->{[i,j] -> [2i,j]}", 1);
+	test_bijective_case(ctx, "[N,M]->{[i,j] -> [x,y] : 2x=i & y =j}", 1);
+}
+
+/* Inputs for isl_pw_qpolynomial_gist tests.
+ * "pwqp" is the input, "set" is the context and "gist" is the expected result.
+ */
+struct {
+	const char *pwqp;
+	const char *set;
+	const char *gist;
+} pwqp_gist_tests[] = {
+	{ "{ [i] -> i }", "{ [k] : exists a : k = 2a }", "{ [i] -> i }" },
+	{ "{ [i] -> i + [ (i + [i/3])/2 ] }", "{ [10] }", "{ [i] -> 16 }" },
+	{ "{ [i] -> ([(i)/2]) }", "{ [k] : exists a : k = 2a+1 }",
+	  "{ [i] -> -1/2 + 1/2 * i }" },
+	{ "{ [i] -> i^2 : i != 0 }", "{ [i] : i != 0 }", "{ [i] -> i^2 }" },
+};
+
+static int test_pwqp(struct isl_ctx *ctx)
+{
+	int i;
+	const char *str;
+	isl_set *set;
+	isl_pw_qpolynomial *pwqp1, *pwqp2;
+	int equal;
+
+	str = "{ [i,j,k] -> 1 + 9 * [i/5] + 7 * [j/11] + 4 * [k/13] }";
+	pwqp1 = isl_pw_qpolynomial_read_from_str(ctx, str);
+
+	pwqp1 = isl_pw_qpolynomial_move_dims(pwqp1, isl_dim_param, 0,
+						isl_dim_in, 1, 1);
+
+	str = "[j] -> { [i,k] -> 1 + 9 * [i/5] + 7 * [j/11] + 4 * [k/13] }";
+	pwqp2 = isl_pw_qpolynomial_read_from_str(ctx, str);
+
+	pwqp1 = isl_pw_qpolynomial_sub(pwqp1, pwqp2);
+
+	assert(isl_pw_qpolynomial_is_zero(pwqp1));
+
+	isl_pw_qpolynomial_free(pwqp1);
+
+	for (i = 0; i < ARRAY_SIZE(pwqp_gist_tests); ++i) {
+		str = pwqp_gist_tests[i].pwqp;
+		pwqp1 = isl_pw_qpolynomial_read_from_str(ctx, str);
+		str = pwqp_gist_tests[i].set;
+		set = isl_set_read_from_str(ctx, str);
+		pwqp1 = isl_pw_qpolynomial_gist(pwqp1, set);
+		str = pwqp_gist_tests[i].gist;
+		pwqp2 = isl_pw_qpolynomial_read_from_str(ctx, str);
+		pwqp1 = isl_pw_qpolynomial_sub(pwqp1, pwqp2);
+		equal = isl_pw_qpolynomial_is_zero(pwqp1);
+		isl_pw_qpolynomial_free(pwqp1);
+
+		if (equal < 0)
+			return -1;
+		if (!equal)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected result", return -1);
+	}
+
+	str = "{ [i] -> ([([i/2] + [i/2])/5]) }";
+	pwqp1 = isl_pw_qpolynomial_read_from_str(ctx, str);
+	str = "{ [i] -> ([(2 * [i/2])/5]) }";
+	pwqp2 = isl_pw_qpolynomial_read_from_str(ctx, str);
+
+	pwqp1 = isl_pw_qpolynomial_sub(pwqp1, pwqp2);
+
+	assert(isl_pw_qpolynomial_is_zero(pwqp1));
+
+	isl_pw_qpolynomial_free(pwqp1);
+
+	str = "{ [x] -> ([x/2] + [(x+1)/2]) }";
+	pwqp1 = isl_pw_qpolynomial_read_from_str(ctx, str);
+	str = "{ [x] -> x }";
+	pwqp2 = isl_pw_qpolynomial_read_from_str(ctx, str);
+
+	pwqp1 = isl_pw_qpolynomial_sub(pwqp1, pwqp2);
+
+	assert(isl_pw_qpolynomial_is_zero(pwqp1));
+
+	isl_pw_qpolynomial_free(pwqp1);
+
+	str = "{ [i] -> ([i/2]) : i >= 0; [i] -> ([i/3]) : i < 0 }";
+	pwqp1 = isl_pw_qpolynomial_read_from_str(ctx, str);
+	pwqp2 = isl_pw_qpolynomial_read_from_str(ctx, str);
+	pwqp1 = isl_pw_qpolynomial_coalesce(pwqp1);
+	pwqp1 = isl_pw_qpolynomial_sub(pwqp1, pwqp2);
+	assert(isl_pw_qpolynomial_is_zero(pwqp1));
+	isl_pw_qpolynomial_free(pwqp1);
+
+	str = "{ [a,b,a] -> (([(2*[a/3]+b)/5]) * ([(2*[a/3]+b)/5])) }";
+	pwqp2 = isl_pw_qpolynomial_read_from_str(ctx, str);
+	str = "{ [a,b,c] -> (([(2*[a/3]+b)/5]) * ([(2*[c/3]+b)/5])) }";
+	pwqp1 = isl_pw_qpolynomial_read_from_str(ctx, str);
+	set = isl_set_read_from_str(ctx, "{ [a,b,a] }");
+	pwqp1 = isl_pw_qpolynomial_intersect_domain(pwqp1, set);
+	equal = isl_pw_qpolynomial_plain_is_equal(pwqp1, pwqp2);
+	isl_pw_qpolynomial_free(pwqp1);
+	isl_pw_qpolynomial_free(pwqp2);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+
+	str = "{ [a,b,c] -> (([(2*[a/3]+1)/5]) * ([(2*[c/3]+1)/5])) : b = 1 }";
+	pwqp2 = isl_pw_qpolynomial_read_from_str(ctx, str);
+	str = "{ [a,b,c] -> (([(2*[a/3]+b)/5]) * ([(2*[c/3]+b)/5])) }";
+	pwqp1 = isl_pw_qpolynomial_read_from_str(ctx, str);
+	pwqp1 = isl_pw_qpolynomial_fix_val(pwqp1, isl_dim_set, 1,
+						isl_val_one(ctx));
+	equal = isl_pw_qpolynomial_plain_is_equal(pwqp1, pwqp2);
+	isl_pw_qpolynomial_free(pwqp1);
+	isl_pw_qpolynomial_free(pwqp2);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+
+	return 0;
+}
+
+void test_split_periods(isl_ctx *ctx)
+{
+	const char *str;
+	isl_pw_qpolynomial *pwqp;
+
+	str = "{ [U,V] -> 1/3 * U + 2/3 * V - [(U + 2V)/3] + [U/2] : "
+		"U + 2V + 3 >= 0 and - U -2V  >= 0 and - U + 10 >= 0 and "
+		"U  >= 0; [U,V] -> U^2 : U >= 100 }";
+	pwqp = isl_pw_qpolynomial_read_from_str(ctx, str);
+
+	pwqp = isl_pw_qpolynomial_split_periods(pwqp, 2);
+	assert(pwqp);
+
+	isl_pw_qpolynomial_free(pwqp);
+}
+
+void test_union(isl_ctx *ctx)
+{
+	const char *str;
+	isl_union_set *uset1, *uset2;
+	isl_union_map *umap1, *umap2;
+
+	str = "{ [i] : 0 <= i <= 1 }";
+	uset1 = isl_union_set_read_from_str(ctx, str);
+	str = "{ [1] -> [0] }";
+	umap1 = isl_union_map_read_from_str(ctx, str);
+
+	umap2 = isl_union_set_lex_gt_union_set(isl_union_set_copy(uset1), uset1);
+	assert(isl_union_map_is_equal(umap1, umap2));
+
+	isl_union_map_free(umap1);
+	isl_union_map_free(umap2);
+
+	str = "{ A[i] -> B[i]; B[i] -> C[i]; A[0] -> C[1] }";
+	umap1 = isl_union_map_read_from_str(ctx, str);
+	str = "{ A[i]; B[i] }";
+	uset1 = isl_union_set_read_from_str(ctx, str);
+
+	uset2 = isl_union_map_domain(umap1);
+
+	assert(isl_union_set_is_equal(uset1, uset2));
+
+	isl_union_set_free(uset1);
+	isl_union_set_free(uset2);
+}
+
+void test_bound(isl_ctx *ctx)
+{
+	const char *str;
+	isl_pw_qpolynomial *pwqp;
+	isl_pw_qpolynomial_fold *pwf;
+
+	str = "{ [[a, b, c, d] -> [e]] -> 0 }";
+	pwqp = isl_pw_qpolynomial_read_from_str(ctx, str);
+	pwf = isl_pw_qpolynomial_bound(pwqp, isl_fold_max, NULL);
+	assert(isl_pw_qpolynomial_fold_dim(pwf, isl_dim_in) == 4);
+	isl_pw_qpolynomial_fold_free(pwf);
+
+	str = "{ [[x]->[x]] -> 1 : exists a : x = 2 a }";
+	pwqp = isl_pw_qpolynomial_read_from_str(ctx, str);
+	pwf = isl_pw_qpolynomial_bound(pwqp, isl_fold_max, NULL);
+	assert(isl_pw_qpolynomial_fold_dim(pwf, isl_dim_in) == 1);
+	isl_pw_qpolynomial_fold_free(pwf);
+}
+
+/* Inputs for range propagation tests.
+ */
+const char *bound_range_tests[] = {
+	"[n, m] -> { [i, j] -> i * j + i : 0 <= i <= n and 0 <= j <= m and "
+		"i + j <= 10 and j <= n }",
+	"[n] -> { [i, j] -> i * i - 5 * j : 0 <= i <= n and 0 <= j <= i and "
+		"i + j <= 2n - 3 and 2i >= n - j }",
+	"[n] -> { [i] -> i : 0 <= i <= n }",
+	"[N] -> { [i, j, k] -> i * i + j + k * k * k : i >= 0 and "
+		"k >= -N + i and k >= -j and j <= i }",
+};
+
+/* Compute an upper bound on "str" using range propagation
+ * with "n_thread" threads.
+ */
+static __isl_give isl_pw_qpolynomial_fold *bound_range(isl_ctx *ctx,
+	const char *str, int n_thread, int *tight)
+{
+	isl_pw_qpolynomial *pwqp;
+
+	isl_options_set_threads(ctx, n_thread);
+	pwqp = isl_pw_qpolynomial_read_from_str(ctx, str);
+	return isl_pw_qpolynomial_bound(pwqp, isl_fold_max, tight);
+}
+
+/* Check that computing bounds using range propagation
+ * in parallel produces the same result as the sequential computation.
+ */
+static int test_bound_range_threads(isl_ctx *ctx)
+{
+	int i;
+	int bound, n_thread;
+	int r = 0;
+
+	bound = isl_options_get_bound(ctx);
+	n_thread = isl_options_get_threads(ctx);
+	isl_options_set_bound(ctx, ISL_BOUND_RANGE);
+	for (i = 0; r == 0 && i < ARRAY_SIZE(bound_range_tests); ++i) {
+		isl_pw_qpolynomial_fold *pwf1, *pwf2;
+		int tight1, tight2;
+		int equal;
+
+		pwf1 = bound_range(ctx, bound_range_tests[i], 1, &tight1);
+		pwf2 = bound_range(ctx, bound_range_tests[i], 4, &tight2);
+		equal = isl_pw_qpolynomial_fold_plain_is_equal(pwf1, pwf2);
+		isl_pw_qpolynomial_fold_free(pwf1);
+		isl_pw_qpolynomial_fold_free(pwf2);
+		if (equal < 0)
+			r = -1;
+		else if (!equal || tight1 != tight2)
+			isl_die(ctx, isl_error_unknown,
+				"parallel range propagation produces "
+				"different result", r = -1);
+	}
+	isl_options_set_bound(ctx, bound);
+	isl_options_set_threads(ctx, n_thread);
+
+	return r;
+}
+
+/* Inputs for Bernstein expansion tests, with several chambers.
+ */
+const char *bound_bernstein_tests[] = {
+	"[n, m] -> { [i, j] -> i * j + i : 0 <= i <= n and 0 <= j <= m and "
+		"i + j <= 10 and j <= n }",
+	"[n] -> { [i, j] -> i * i - 5 * j : 0 <= i <= n and 0 <= j <= i and "
+		"i + j <= 2n - 3 and 2i >= n - j }",
+	"[n, m] -> { [i, j, k] -> i * j * k : 0 <= i <= n and 0 <= j <= m and "
+		"0 <= k <= n + m - i - j and i + k <= 2m }",
+};
+
+/* Compute an upper bound on "str" using Bernstein expansion
+ * with "n_thread" threads.
+ */
+static __isl_give isl_pw_qpolynomial_fold *bound_bernstein(isl_ctx *ctx,
+	const char *str, int n_thread, int *tight)
+{
+	isl_pw_qpolynomial *pwqp;
+
+	isl_options_set_threads(ctx, n_thread);
+	pwqp = isl_pw_qpolynomial_read_from_str(ctx, str);
+	return isl_pw_qpolynomial_bound(pwqp, isl_fold_max, tight);
+}
+
+/* Check that computing bounds using Bernstein expansion
+ * in parallel produces the same result as the sequential computation.
+ */
+static int test_bound_bernstein_threads(isl_ctx *ctx)
+{
+	int i;
+	int bound, n_thread;
+	int r = 0;
+
+	bound = isl_options_get_bound(ctx);
+	n_thread = isl_options_get_threads(ctx);
+	isl_options_set_bound(ctx, ISL_BOUND_BERNSTEIN);
+	for (i = 0; r == 0 && i < ARRAY_SIZE(bound_bernstein_tests); ++i) {
+		isl_pw_qpolynomial_fold *pwf1, *pwf2;
+		int tight1, tight2;
+		int equal;
+
+		pwf1 = bound_bernstein(ctx, bound_bernstein_tests[i], 1,
+					&tight1);
+		pwf2 = bound_bernstein(ctx, bound_bernstein_tests[i], 4,
+					&tight2);
+		equal = isl_pw_qpolynomial_fold_plain_is_equal(pwf1, pwf2);
+		isl_pw_qpolynomial_fold_free(pwf1);
+		isl_pw_qpolynomial_fold_free(pwf2);
+		if (equal < 0)
+			r = -1;
+		else if (!equal || tight1 != tight2)
+			isl_die(ctx, isl_error_unknown,
+				"parallel Bernstein expansion produces "
+				"different result", r = -1);
+	}
+	isl_options_set_bound(ctx, bound);
+	isl_options_set_threads(ctx, n_thread);
+
+	return r;
+}
+
+void test_lift(isl_ctx *ctx)
+{
+	const char *str;
+	isl_basic_map *bmap;
+	isl_basic_set *bset;
+
+	str = "{ [i0] : exists e0 : i0 = 4e0 }";
+	bset = isl_basic_set_read_from_str(ctx, str);
+	bset = isl_basic_set_lift(bset);
+	bmap = isl_basic_map_from_range(bset);
+	bset = isl_basic_map_domain(bmap);
+	isl_basic_set_free(bset);
+}
+
+struct {
+	const char *set1;
+	const char *set2;
+	int subset;
+} subset_tests[] = {
+	{ "{ [112, 0] }",
+	  "{ [i0, i1] : exists (e0 = [(i0 - i1)/16], e1: "
+		"16e0 <= i0 - i1 and 16e0 >= -15 + i0 - i1 and "
+		"16e1 <= i1 and 16e0 >= -i1 and 16e1 >= -i0 + i1) }", 1 },
+	{ "{ [65] }",
+	  "{ [i] : exists (e0 = [(255i)/256], e1 = [(127i + 65e0)/191], "
+		"e2 = [(3i + 61e1)/65], e3 = [(52i + 12e2)/61], "
+		"e4 = [(2i + e3)/3], e5 = [(4i + e3)/4], e6 = [(8i + e3)/12]: "
+		    "3e4 = 2i + e3 and 4e5 = 4i + e3 and 12e6 = 8i + e3 and "
+		    "i <= 255 and 64e3 >= -45 + 67i and i >= 0 and "
+		    "256e0 <= 255i and 256e0 >= -255 + 255i and "
+		    "191e1 <= 127i + 65e0 and 191e1 >= -190 + 127i + 65e0 and "
+		    "65e2 <= 3i + 61e1 and 65e2 >= -64 + 3i + 61e1 and "
+		    "61e3 <= 52i + 12e2 and 61e3 >= -60 + 52i + 12e2) }", 1 },
+	{ "{ [i] : 0 <= i <= 10 }", "{ rat: [i] : 0 <= i <= 10 }", 1 },
+	{ "{ rat: [i] : 0 <= i <= 10 }", "{ [i] : 0 <= i <= 10 }", 0 },
+	{ "{ rat: [0] }", "{ [i] : 0 <= i <= 10 }", 1 },
+	{ "{ rat: [(1)/2] }", "{ [i] : 0 <= i <= 10 }", 0 },
+	{ "{ [t, i] : (exists (e0 = [(2 + t)/4]: 4e0 <= 2 + t and "
+			"4e0 >= -1 + t and i >= 57 and i <= 62 and "
+			"4e0 <= 62 + t - i and 4e0 >= -61 + t + i and "
+			"t >= 0 and t <= 511 and 4e0 <= -57 + t + i and "
+			"4e0 >= 58 + t - i and i >= 58 + t and i >= 62 - t)) }",
+	  "{ [i0, i1] : (exists (e0 = [(4 + i0)/4]: 4e0 <= 62 + i0 - i1 and "
+			"4e0 >= 1 + i0 and i0 >= 0 and i0 <= 511 and "
+			"4e0 <= -57 + i0 + i1)) or "
+		"(exists (e0 = [(2 + i0)/4]: 4e0 <= i0 and "
+			"4e0 >= 58 + i0 - i1 and i0 >= 2 and i0 <= 511 and "
+			"4e0 >= -61 + i0 + i1)) or "
+		"(i1 <= 66 - i0 and i0 >= 2 and i1 >= 59 + i0) }", 1 },
+	{ "{ [i, j] : (0 <= i <= 3 and 0 <= j <= 3) or "
+		"(4 <= i <= 7 and 0 <= j <= 3) }",
+	  "{ [i, j] : (0 <= i <= 1 and 0 <= j <= 3) or "
+		"(2 <= i <= 5 and 0 <= j <= 3) or "
+		"(6 <= i <= 7 and 0 <= j <= 3) or (20 <= i <= 30) }", 1 },
+	{ "[n] -> { [i] : (0 <= i <= 3 and n = 5) or i = 7 }",
+	  "[n] -> { [i] : (0 <= i <= 3 and n >= 6) or "
+		"(0 <= i <= 7 and n <= 5) or i = 7 }", 1 },
+	{ "[n] -> { [i] : (0 <= i <= 3 and n = 5) or i = 7 }",
+	  "[n] -> { [i] : (0 <= i <= 3 and n >= 6) or "
+		"(0 <= i <= 7 and n <= 4) or i = 7 }", 0 },
+};
+
+static int test_subset(isl_ctx *ctx)
+{
+	int i;
+	isl_set *set1, *set2;
+	int subset;
+
+	for (i = 0; i < ARRAY_SIZE(subset_tests); ++i) {
+		set1 = isl_set_read_from_str(ctx, subset_tests[i].set1);
+		set2 = isl_set_read_from_str(ctx, subset_tests[i].set2);
+		subset = isl_set_is_subset(set1, set2);
+		isl_set_free(set1);
+		isl_set_free(set2);
+		if (subset < 0)
+			return -1;
+		if (subset != subset_tests[i].subset)
+			isl_die(ctx, isl_error_unknown,
+				"incorrect subset result", return -1);
+	}
+
+	return 0;
+}
+
+struct {
+	const char *minuend;
+	const char *subtrahend;
+	const char *difference;
+} subtract_domain_tests[] = {
+	{ "{ A[i] -> B[i] }", "{ A[i] }", "{ }" },
+	{ "{ A[i] -> B[i] }", "{ B[i] }", "{ A[i] -> B[i] }" },
+	{ "{ A[i] -> B[i] }", "{ A[i] : i > 0 }", "{ A[i] -> B[i] : i <= 0 }" },
+};
+
+/* Inputs for subtraction and intersection tests on sets
+ * with many disjuncts, most pairs of which are disjoint.
+ */
+struct {
+	const char *set1;
+	const char *set2;
+	const char *difference;
+	const char *intersection;
+} subtract_tests[] = {
+	{ "{ [i, j] : (0 <= i <= 3 and 0 <= j <= 3) or "
+		"(4 <= i <= 7 and 0 <= j <= 3) or "
+		"(8 <= i <= 11 and 0 <= j <= 3) or "
+		"(0 <= i <= 3 and 4 <= j <= 7) or "
+		"(4 <= i <= 7 and 4 <= j <= 7) or "
+		"(8 <= i <= 11 and 4 <= j <= 7) }",
+	  "{ [i, j] : (2 <= i <= 5 and 0 <= j <= 3) or "
+		"(6 <= i <= 9 and 0 <= j <= 3) or "
+		"(10 <= i <= 13 and 0 <= j <= 3) or "
+		"(-2 <= i <= 1 and 4 <= j <= 7) }",
+	  "{ [i, j] : (0 <= i <= 1 and 0 <= j <= 3) or "
+		"(2 <= i <= 11 and 4 <= j <= 7) }",
+	  "{ [i, j] : (2 <= i <= 11 and 0 <= j <= 3) or "
+		"(0 <= i <= 1 and 4 <= j <= 7) }" },
+	{ "[n] -> { [i] : (0 <= i <= 3 and n = 0) or "
+		"(4 <= i <= 7 and n = 1) or (8 <= i <= 11 and n = 2) }",
+	  "[n] -> { [i] : (0 <= i <= 1 and n = 0) or "
+		"(0 <= i <= 11 and n = 1) or (i = 9 and n >= 2) }",
+	  "[n] -> { [i] : (2 <= i <= 3 and n = 0) or "
+		"(8 <= i <= 11 and i != 9 and n = 2) }",
+	  "[n] -> { [i] : (0 <= i <= 1 and n = 0) or "
+		"(4 <= i <= 7 and n = 1) or (i = 9 and n = 2) }" },
+	{ "{ [i] : 0 <= i <= 11 }",
+	  "{ [i] : exists (a : i = 2a); [i] : exists (b : i = 3b); "
+		"[i] : exists (c : i = 5c + 1 and i >= 10) }",
+	  "{ [1]; [5]; [7] }",
+	  "{ [0]; [2]; [3]; [4]; [6]; [8]; [9]; [10]; [11] }" },
+};
+
+/* Check that isl_set_subtract and isl_set_intersect produce
+ * the expected results on the inputs in subtract_tests.
+ */
+static int test_subtract_intersect(isl_ctx *ctx)
+{
+	int i;
+	isl_set *set1, *set2, *diff, *inter, *res;
+	int equal;
+
+	for (i = 0; i < ARRAY_SIZE(subtract_tests); ++i) {
+		set1 = isl_set_read_from_str(ctx, subtract_tests[i].set1);
+		set2 = isl_set_read_from_str(ctx, subtract_tests[i].set2);
+		diff = isl_set_subtract(isl_set_copy(set1), isl_set_copy(set2));
+		inter = isl_set_intersect(set1, set2);
+		res = isl_set_read_from_str(ctx, subtract_tests[i].difference);
+		equal = isl_set_is_equal(diff, res);
+		isl_set_free(res);
+		if (equal >= 0 && equal) {
+			res = isl_set_read_from_str(ctx,
+					subtract_tests[i].intersection);
+			equal = isl_set_is_equal(inter, res);
+			isl_set_free(res);
+		}
+		isl_set_free(diff);
+		isl_set_free(inter);
+		if (equal < 0)
+			return -1;
+		if (!equal)
+			isl_die(ctx, isl_error_unknown,
+				"incorrect subtract or intersect result",
+				return -1);
+	}
+
+	return 0;
+}
+
+/* Is "umap" equal to the union map described by "str"?
+ */
+static int union_map_is_equal(__isl_keep isl_union_map *umap, const char *str)
+{
+	isl_union_map *umap2;
+	int equal;
+
+	umap2 = isl_union_map_read_from_str(isl_union_map_get_ctx(umap), str);
+	equal = isl_union_map_is_equal(umap, umap2);
+	isl_union_map_free(umap2);
+
+	return equal;
+}
+
+/* Check that subtracting from and coalescing a union map
+ * that is also referenced elsewhere does not affect that other reference,
+ * while the maps of a union map without other references
+ * may be reused for the result.
+ */
+static int test_union_map_subtract_shared(isl_ctx *ctx)
+{
+	const char *str;
+	isl_union_map *umap, *umap2, *res;
+	int equal;
+
+	str = "{ A[i] -> B[i] : 0 <= i <= 10; C[i] -> D[] : 0 <= i <= 10 }";
+	umap = isl_union_map_read_from_str(ctx, str);
+	str = "{ A[i] -> B[i] : 5 <= i <= 20; C[i] -> D[] : i <= 3 }";
+	umap2 = isl_union_map_read_from_str(ctx, str);
+	res = isl_union_map_subtract(isl_union_map_copy(umap),
+					isl_union_map_copy(umap2));
+	res = isl_union_map_union(res, isl_union_map_copy(umap2));
+	res = isl_union_map_coalesce(res);
+	umap2 = isl_union_map_subtract(isl_union_map_copy(umap), umap2);
+	str = "{ A[i] -> B[i] : 0 <= i <= 10; C[i] -> D[] : 0 <= i <= 10 }";
+	equal = union_map_is_equal(umap, str);
+	if (equal >= 0 && equal) {
+		str = "{ A[i] -> B[i] : 0 <= i <= 4; C[i] -> D[] : 4 <= i <= 10 }";
+		equal = union_map_is_equal(umap2, str);
+	}
+	if (equal >= 0 && equal) {
+		str = "{ A[i] -> B[i] : 0 <= i <= 20; C[i] -> D[] : i <= 10 }";
+		equal = union_map_is_equal(res, str);
+	}
+	isl_union_map_free(umap);
+	isl_union_map_free(umap2);
+	isl_union_map_free(res);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected union map subtraction result", return -1);
+
+	return 0;
+}
+
+/* Apply "fn" to "umap1" and "umap2" with the union_bin_op_threads option
+ * set to "n_thread".
+ */
+static __isl_give isl_union_map *union_bin_op_with_threads(
+	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2,
+	__isl_give isl_union_map *(*fn)(__isl_take isl_union_map *umap1,
+		__isl_take isl_union_map *umap2), int n_thread)
+{
+	isl_ctx *ctx = isl_union_map_get_ctx(umap1);
+	int old;
+	isl_union_map *res;
+
+	old = isl_options_get_threads(ctx);
+	isl_options_set_threads(ctx, n_thread);
+	res = fn(umap1, umap2);
+	isl_options_set_threads(ctx, old);
+
+	return res;
+}
+
+/* Check that intersecting, subtracting and gisting union maps
+ * by several threads produces the same results as doing so
+ * in a single thread.
+ * The union maps contain maps without a matching map
+ * in the other union map as well as pairs of maps
+ * with an empty intersection or difference.
+ */
+static int test_union_bin_op_threads(isl_ctx *ctx)
+{
+	int i;
+	const char *str;
+	isl_union_map *umap1, *umap2, *seq, *par;
+	__isl_give isl_union_map *(*fn[])(__isl_take isl_union_map *umap1,
+		__isl_take isl_union_map *umap2) = {
+		&isl_union_map_intersect,
+		&isl_union_map_subtract,
+		&isl_union_map_gist,
+	};
+	int equal = 1;
+
+	str = "[N] -> { A[i] -> B[j] : 0 <= i, j <= N; "
+		"C[i] -> D[j] : 0 <= i <= j <= 10 or j <= i <= N; "
+		"E[i] -> F[] : 0 <= i <= 10; G[i] -> H[i] : i >= 0; "
+		"I[i, j] -> J[] : i <= j }";
+	umap1 = isl_union_map_read_from_str(ctx, str);
+	str = "[N] -> { A[i] -> B[j] : i >= j; C[i] -> D[j] : i >= 0; "
+		"E[i] -> F[] : i > 10; G[i] -> H[i]; K[] -> L[] }";
+	umap2 = isl_union_map_read_from_str(ctx, str);
+	for (i = 0; equal >= 0 && equal && i < ARRAY_SIZE(fn); ++i) {
+		seq = union_bin_op_with_threads(isl_union_map_copy(umap1),
+				isl_union_map_copy(umap2), fn[i], 1);
+		par = union_bin_op_with_threads(isl_union_map_copy(umap1),
+				isl_union_map_copy(umap2), fn[i], 3);
+		equal = isl_union_map_is_equal(seq, par);
+		isl_union_map_free(seq);
+		isl_union_map_free(par);
+	}
+	isl_union_map_free(umap1);
+	isl_union_map_free(umap2);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"parallel binary operation differs from sequential",
+			return -1);
+
+	return 0;
+}
+
+static int test_subtract(isl_ctx *ctx)
+{
+	int i;
+	isl_union_map *umap1, *umap2;
+	isl_union_set *uset;
+	int equal;
+
+	if (test_subtract_intersect(ctx) < 0)
+		return -1;
+
+	for (i = 0; i < ARRAY_SIZE(subtract_domain_tests); ++i) {
+		umap1 = isl_union_map_read_from_str(ctx,
+				subtract_domain_tests[i].minuend);
+		uset = isl_union_set_read_from_str(ctx,
+				subtract_domain_tests[i].subtrahend);
+		umap2 = isl_union_map_read_from_str(ctx,
+				subtract_domain_tests[i].difference);
+		umap1 = isl_union_map_subtract_domain(umap1, uset);
+		equal = isl_union_map_is_equal(umap1, umap2);
+		isl_union_map_free(umap1);
+		isl_union_map_free(umap2);
+		if (equal < 0)
+			return -1;
+		if (!equal)
+			isl_die(ctx, isl_error_unknown,
+				"incorrect subtract domain result", return -1);
+	}
+
+	if (test_union_map_subtract_shared(ctx) < 0)
+		return -1;
+	if (test_union_bin_op_threads(ctx) < 0)
+		return -1;
+
+	return 0;
+}
+
+/* Check that the basic sets of "set" are pairwise disjoint.
+ */
+static int basic_sets_are_disjoint(__isl_keep isl_set *set)
+{
+	int i, j;
+
+	for (i = 0; i < set->n; ++i)
+		for (j = i + 1; j < set->n; ++j) {
+			isl_basic_set *inter;
+			int empty;
+
+			inter = isl_basic_set_intersect(
+				isl_basic_set_copy(set->p[i]),
+				isl_basic_set_copy(set->p[j]));
+			empty = isl_basic_set_is_empty(inter);
+			isl_basic_set_free(inter);
+			if (empty < 0 || !empty)
+				return empty;
+		}
+
+	return 1;
+}
+
+/* Check that isl_set_make_disjoint produces a disjoint representation
+ * of the same set for each value of the make_disjoint option and
+ * that filtering produces the same number of pieces as subtracting.
+ */
+static int test_make_disjoint(isl_ctx *ctx)
+{
+	int i;
+	int option;
+	const char *str;
+	isl_set *set;
+	int n[3];
+	int modes[] = { ISL_MAKE_DISJOINT_SUBTRACT,
+			ISL_MAKE_DISJOINT_FILTER,
+			ISL_MAKE_DISJOINT_COALESCE };
+
+	str = "{ [i, j] : 0 <= i <= 10 and 0 <= j <= 10; "
+		"[i, j] : 5 <= i <= 15 and 5 <= j <= 15; "
+		"[i, j] : 20 <= i <= 30 and 0 <= j <= 10; "
+		"[i, j] : 25 <= i <= 35 and 5 <= j <= 15; "
+		"[i, j] : 0 <= i <= 35 and j = 7 }";
+	option = isl_options_get_make_disjoint(ctx);
+	for (i = 0; i < ARRAY_SIZE(modes); ++i) {
+		isl_set *disjoint;
+		int equal, ok;
+
+		set = isl_set_read_from_str(ctx, str);
+		isl_options_set_make_disjoint(ctx, modes[i]);
+		disjoint = isl_set_make_disjoint(isl_set_copy(set));
+		equal = isl_set_is_equal(set, disjoint);
+		ok = disjoint ? basic_sets_are_disjoint(disjoint) : -1;
+		n[i] = disjoint ? disjoint->n : -1;
+		isl_set_free(set);
+		isl_set_free(disjoint);
+		if (equal < 0 || ok < 0)
+			break;
+		if (!equal || !ok)
+			break;
+	}
+	isl_options_set_make_disjoint(ctx, option);
+
+	if (i < ARRAY_SIZE(modes))
+		isl_die(ctx, isl_error_unknown,
+			"incorrect disjoint representation", return -1);
+	if (n[0] != n[1])
+		isl_die(ctx, isl_error_unknown,
+			"filtering changed the number of pieces", return -1);
+
+	return 0;
+}
+
+int test_factorize(isl_ctx *ctx)
+{
+	const char *str;
+	isl_basic_set *bset;
+	isl_factorizer *f;
+
+	str = "{ [i0, i1, i2, i3, i4, i5, i6, i7] : 3i5 <= 2 - 2i0 and "
+	    "i0 >= -2 and i6 >= 1 + i3 and i7 >= 0 and 3i5 >= -2i0 and "
+	    "2i4 <= i2 and i6 >= 1 + 2i0 + 3i1 and i4 <= -1 and "
+	    "i6 >= 1 + 2i0 + 3i5 and i6 <= 2 + 2i0 + 3i5 and "
+	    "3i5 <= 2 - 2i0 - i2 + 3i4 and i6 <= 2 + 2i0 + 3i1 and "
+	    "i0 <= -1 and i7 <= i2 + i3 - 3i4 - i6 and "
+	    "3i5 >= -2i0 - i2 + 3i4 }";
+	bset = isl_basic_set_read_from_str(ctx, str);
+	f = isl_basic_set_factorizer(bset);
+	isl_basic_set_free(bset);
+	isl_factorizer_free(f);
+	if (!f)
+		isl_die(ctx, isl_error_unknown,
+			"failed to construct factorizer", return -1);
+
+	str = "{ [i0, i1, i2, i3, i4, i5, i6, i7, i8, i9, i10, i11, i12] : "
+	    "i12 <= 2 + i0 - i11 and 2i8 >= -i4 and i11 >= i1 and "
+	    "3i5 <= -i2 and 2i11 >= -i4 - 2i7 and i11 <= 3 + i0 + 3i9 and "
+	    "i11 <= -i4 - 2i7 and i12 >= -i10 and i2 >= -2 and "
+	    "i11 >= i1 + 3i10 and i11 >= 1 + i0 + 3i9 and "
+	    "i11 <= 1 - i4 - 2i8 and 6i6 <= 6 - i2 and 3i6 >= 1 - i2 and "
+	    "i11 <= 2 + i1 and i12 <= i4 + i11 and i12 >= i0 - i11 and "
+	    "3i5 >= -2 - i2 and i12 >= -1 + i4 + i11 and 3i3 <= 3 - i2 and "
+	    "9i6 <= 11 - i2 + 6i5 and 3i3 >= 1 - i2 and "
+	    "9i6 <= 5 - i2 + 6i3 and i12 <= -1 and i2 <= 0 }";
+	bset = isl_basic_set_read_from_str(ctx, str);
+	f = isl_basic_set_factorizer(bset);
+	isl_basic_set_free(bset);
+	isl_factorizer_free(f);
+	if (!f)
+		isl_die(ctx, isl_error_unknown,
+			"failed to construct factorizer", return -1);
+
+	return 0;
+}
+
+static int check_injective(__isl_take isl_map *map, void *user)
+{
+	int *injective = user;
+
+	*injective = isl_map_is_injective(map);
+	isl_map_free(map);
+
+	if (*injective < 0 || !*injective)
+		return -1;
+
+	return 0;
+}
+
+int test_one_schedule(isl_ctx *ctx, const char *d, const char *w,
+	const char *r, const char *s, int tilable, int parallel)
+{
+	int i;
+	isl_union_set *D;
+	isl_union_map *W, *R, *S;
+	isl_union_map *empty;
+	isl_union_map *dep_raw, *dep_war, *dep_waw, *dep;
+	isl_union_map *validity, *proximity, *coincidence;
+	isl_union_map *schedule;
+	isl_union_map *test;
+	isl_union_set *delta;
+	isl_union_set *domain;
+	isl_set *delta_set;
+	isl_set *slice;
+	isl_set *origin;
+	isl_schedule_constraints *sc;
+	isl_schedule *sched;
+	int is_nonneg, is_parallel, is_tilable, is_injection, is_complete;
+
+	D = isl_union_set_read_from_str(ctx, d);
+	W = isl_union_map_read_from_str(ctx, w);
+	R = isl_union_map_read_from_str(ctx, r);
+	S = isl_union_map_read_from_str(ctx, s);
+
+	W = isl_union_map_intersect_domain(W, isl_union_set_copy(D));
+	R = isl_union_map_intersect_domain(R, isl_union_set_copy(D));
+
+	empty = isl_union_map_empty(isl_union_map_get_space(S));
+        isl_union_map_compute_flow(isl_union_map_copy(R),
+				   isl_union_map_copy(W), empty,
+				   isl_union_map_copy(S),
+				   &dep_raw, NULL, NULL, NULL);
+        isl_union_map_compute_flow(isl_union_map_copy(W),
+				   isl_union_map_copy(W),
+				   isl_union_map_copy(R),
+				   isl_union_map_copy(S),
+				   &dep_waw, &dep_war, NULL, NULL);
+
+	dep = isl_union_map_union(dep_waw, dep_war);
+	dep = isl_union_map_union(dep, dep_raw);
+	validity = isl_union_map_copy(dep);
+	coincidence = isl_union_map_copy(dep);
+	proximity = isl_union_map_copy(dep);
+
+	sc = isl_schedule_constraints_on_domain(isl_union_set_copy(D));
+	sc = isl_schedule_constraints_set_validity(sc, validity);
+	sc = isl_schedule_constraints_set_coincidence(sc, coincidence);
+	sc = isl_schedule_constraints_set_proximity(sc, proximity);
+	sched = isl_schedule_constraints_compute_schedule(sc);
+	schedule = isl_schedule_get_map(sched);
+	isl_schedule_free(sched);
+	isl_union_map_free(W);
+	isl_union_map_free(R);
+	isl_union_map_free(S);
+
+	is_injection = 1;
+	isl_union_map_foreach_map(schedule, &check_injective, &is_injection);
+
+	domain = isl_union_map_domain(isl_union_map_copy(schedule));
+	is_complete = isl_union_set_is_subset(D, domain);
+	isl_union_set_free(D);
+	isl_union_set_free(domain);
+
+	test = isl_union_map_reverse(isl_union_map_copy(schedule));
+	test = isl_union_map_apply_range(test, dep);
+	test = isl_union_map_apply_range(test, schedule);
+
+	delta = isl_union_map_deltas(test);
+	if (isl_union_set_n_set(delta) == 0) {
+		is_tilable = 1;
+		is_parallel = 1;
+		is_nonneg = 1;
+		isl_union_set_free(delta);
+	} else {
+		delta_set = isl_set_from_union_set(delta);
+
+		slice = isl_set_universe(isl_set_get_space(delta_set));
+		for (i = 0; i < tilable; ++i)
+			slice = isl_set_lower_bound_si(slice, isl_dim_set, i, 0);
+		is_tilable = isl_set_is_subset(delta_set, slice);
+		isl_set_free(slice);
+
+		slice = isl_set_universe(isl_set_get_space(delta_set));
+		for (i = 0; i < parallel; ++i)
+			slice = isl_set_fix_si(slice, isl_dim_set, i, 0);
+		is_parallel = isl_set_is_subset(delta_set, slice);
+		isl_set_free(slice);
+
+		origin = isl_set_universe(isl_set_get_space(delta_set));
+		for (i = 0; i < isl_set_dim(origin, isl_dim_set); ++i)
+			origin = isl_set_fix_si(origin, isl_dim_set, i, 0);
+
+		delta_set = isl_set_union(delta_set, isl_set_copy(origin));
+		delta_set = isl_set_lexmin(delta_set);
+
+		is_nonneg = isl_set_is_equal(delta_set, origin);
+
+		isl_set_free(origin);
+		isl_set_free(delta_set);
+	}
+
+	if (is_nonneg < 0 || is_parallel < 0 || is_tilable < 0 ||
+	    is_injection < 0 || is_complete < 0)
+		return -1;
+	if (!is_complete)
+		isl_die(ctx, isl_error_unknown,
+			"generated schedule incomplete", return -1);
+	if (!is_injection)
+		isl_die(ctx, isl_error_unknown,
+			"generated schedule not injective on each statement",
+			return -1);
+	if (!is_nonneg)
+		isl_die(ctx, isl_error_unknown,
+			"negative dependences in generated schedule",
+			return -1);
+	if (!is_tilable)
+		isl_die(ctx, isl_error_unknown,
+			"generated schedule not as tilable as expected",
+			return -1);
+	if (!is_parallel)
+		isl_die(ctx, isl_error_unknown,
+			"generated schedule not as parallel as expected",
+			return -1);
+
+	return 0;
+}
+
+static __isl_give isl_union_map *compute_schedule(isl_ctx *ctx,
+	const char *domain, const char *validity, const char *proximity)
+{
+	isl_union_set *dom;
+	isl_union_map *dep;
+	isl_union_map *prox;
+	isl_schedule_constraints *sc;
+	isl_schedule *schedule;
+	isl_union_map *sched;
+
+	dom = isl_union_set_read_from_str(ctx, domain);
+	dep = isl_union_map_read_from_str(ctx, validity);
+	prox = isl_union_map_read_from_str(ctx, proximity);
+	sc = isl_schedule_constraints_on_domain(dom);
+	sc = isl_schedule_constraints_set_validity(sc, dep);
+	sc = isl_schedule_constraints_set_proximity(sc, prox);
+	schedule = isl_schedule_constraints_compute_schedule(sc);
+	sched = isl_schedule_get_map(schedule);
+	isl_schedule_free(schedule);
+
+	return sched;
+}
+
+/* Check that a schedule can be constructed on the given domain
+ * with the given validity and proximity constraints.
+ */
+static int test_has_schedule(isl_ctx *ctx, const char *domain,
+	const char *validity, const char *proximity)
+{
+	isl_union_map *sched;
+
+	sched = compute_schedule(ctx, domain, validity, proximity);
+	if (!sched)
+		return -1;
+
+	isl_union_map_free(sched);
+	return 0;
+}
+
+int test_special_schedule(isl_ctx *ctx, const char *domain,
+	const char *validity, const char *proximity, const char *expected_sched)
+{
+	isl_union_map *sched1, *sched2;
+	int equal;
+
+	sched1 = compute_schedule(ctx, domain, validity, proximity);
+	sched2 = isl_union_map_read_from_str(ctx, expected_sched);
+
+	equal = isl_union_map_is_equal(sched1, sched2);
+	isl_union_map_free(sched1);
+	isl_union_map_free(sched2);
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown, "unexpected schedule",
+			return -1);
+
+	return 0;
+}
+
+/* Check that the schedule map is properly padded, even after being
+ * reconstructed from the band forest.
+ */
+static int test_padded_schedule(isl_ctx *ctx)
+{
+	const char *str;
+	isl_union_set *D;
+	isl_union_map *validity, *proximity;
+	isl_schedule_constraints *sc;
+	isl_schedule *sched;
+	isl_union_map *map1, *map2;
+	isl_band_list *list;
+	int equal;
+
+	str = "[N] -> { S0[i] : 0 <= i <= N; S1[i, j] : 0 <= i, j <= N }";
+	D = isl_union_set_read_from_str(ctx, str);
+	validity = isl_union_map_empty(isl_union_set_get_space(D));
+	proximity = isl_union_map_copy(validity);
+	sc = isl_schedule_constraints_on_domain(D);
+	sc = isl_schedule_constraints_set_validity(sc, validity);
+	sc = isl_schedule_constraints_set_proximity(sc, proximity);
+	sched = isl_schedule_constraints_compute_schedule(sc);
+	map1 = isl_schedule_get_map(sched);
+	list = isl_schedule_get_band_forest(sched);
+	isl_band_list_free(list);
+	map2 = isl_schedule_get_map(sched);
+	isl_schedule_free(sched);
+	equal = isl_union_map_is_equal(map1, map2);
+	isl_union_map_free(map1);
+	isl_union_map_free(map2);
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"reconstructed schedule map not the same as original",
+			return -1);
+
+	return 0;
+}
+
+/* Check that tiling a band with fewer tile sizes than band members
+ * uses a tile size of one for the remaining members.
+ */
+static int test_band_tile(isl_ctx *ctx)
+{
+	const char *str;
+	isl_union_set *D;
+	isl_union_map *empty;
+	isl_schedule_constraints *sc;
+	isl_schedule *sched;
+	isl_band_list *list;
+	isl_band *band;
+	isl_union_map *umap, *expected;
+	isl_map *tile;
+	isl_vec *sizes;
+	int scale, equal;
+
+	str = "[N] -> { S[i, j] : 0 <= i, j <= N }";
+	D = isl_union_set_read_from_str(ctx, str);
+	empty = isl_union_map_empty(isl_union_set_get_space(D));
+	sc = isl_schedule_constraints_on_domain(D);
+	sc = isl_schedule_constraints_set_validity(sc,
+						isl_union_map_copy(empty));
+	sc = isl_schedule_constraints_set_proximity(sc, empty);
+	sched = isl_schedule_constraints_compute_schedule(sc);
+	list = isl_schedule_get_band_forest(sched);
+	band = isl_band_list_get_band(list, 0);
+	isl_band_list_free(list);
+	isl_schedule_free(sched);
+	if (!band)
+		return -1;
+	if (isl_band_n_member(band) != 2) {
+		isl_band_free(band);
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of members in band", return -1);
+	}
+
+	tile = isl_map_read_from_str(ctx, "{ [a, b] -> [floor(a/4), b] }");
+	expected = isl_band_get_partial_schedule(band);
+	expected = isl_union_map_apply_range(expected,
+						isl_union_map_from_map(tile));
+
+	scale = isl_options_get_tile_scale_tile_loops(ctx);
+	isl_options_set_tile_scale_tile_loops(ctx, 0);
+	sizes = isl_vec_alloc(ctx, 1);
+	sizes = isl_vec_set_element_si(sizes, 0, 4);
+	if (isl_band_tile(band, sizes) < 0)
+		band = isl_band_free(band);
+	isl_options_set_tile_scale_tile_loops(ctx, scale);
+
+	umap = isl_band_get_partial_schedule(band);
+	isl_band_free(band);
+	equal = isl_union_map_is_equal(umap, expected);
+	isl_union_map_free(umap);
+	isl_union_map_free(expected);
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected tile schedule", return -1);
+
+	return 0;
+}
+
+/* Check that using the same dependence relations as validity,
+ * coincidence and proximity constraints on statements with
+ * compressed domains produces the same schedule as
+ * using separately constructed copies of the relations.
+ */
+static int test_schedule_shared_constraints(isl_ctx *ctx)
+{
+	const char *domain, *dep;
+	isl_union_set *D;
+	isl_union_map *umap;
+	isl_schedule_constraints *sc;
+	isl_schedule *sched;
+	isl_union_map *sched1, *sched2;
+	int equal;
+
+	domain = "[N] -> { A[i, j] : i = 2j and 0 <= j <= N; "
+		"B[i, j] : j = i + 1 and 0 <= i <= N }";
+	dep = "[N] -> { A[i, j] -> B[j, j + 1] : i = 2j and 0 <= j <= N; "
+		"B[i, j] -> B[i + 1, j + 1] : 0 <= i < N }";
+
+	D = isl_union_set_read_from_str(ctx, domain);
+	umap = isl_union_map_read_from_str(ctx, dep);
+	sc = isl_schedule_constraints_on_domain(D);
+	sc = isl_schedule_constraints_set_validity(sc,
+						isl_union_map_copy(umap));
+	sc = isl_schedule_constraints_set_coincidence(sc,
+						isl_union_map_copy(umap));
+	sc = isl_schedule_constraints_set_proximity(sc, umap);
+	sched = isl_schedule_constraints_compute_schedule(sc);
+	sched1 = isl_schedule_get_map(sched);
+	isl_schedule_free(sched);
+
+	D = isl_union_set_read_from_str(ctx, domain);
+	sc = isl_schedule_constraints_on_domain(D);
+	umap = isl_union_map_read_from_str(ctx, dep);
+	sc = isl_schedule_constraints_set_validity(sc, umap);
+	umap = isl_union_map_read_from_str(ctx, dep);
+	sc = isl_schedule_constraints_set_coincidence(sc, umap);
+	umap = isl_union_map_read_from_str(ctx, dep);
+	sc = isl_schedule_constraints_set_proximity(sc, umap);
+	sched = isl_schedule_constraints_compute_schedule(sc);
+	sched2 = isl_schedule_get_map(sched);
+	isl_schedule_free(sched);
+
+	equal = isl_union_map_is_equal(sched1, sched2);
+	isl_union_map_free(sched1);
+	isl_union_map_free(sched2);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"shared constraints change schedule", return -1);
+
+	return 0;
+}
+
+/* Check that the schedule map returned by isl_schedule_get_map
+ * is computed only once, but that it is recomputed after
+ * a band in the band forest of the schedule has been tiled.
+ */
+static int test_schedule_map_cache(isl_ctx *ctx)
+{
+	const char *str;
+	isl_union_set *D;
+	isl_union_map *empty;
+	isl_schedule_constraints *sc;
+	isl_schedule *sched;
+	isl_band_list *list;
+	isl_band *band;
+	isl_union_map *umap1, *umap2, *umap3;
+	isl_vec *sizes;
+	int same, equal;
+
+	str = "[N] -> { S[i, j] : 0 <= i, j <= N }";
+	D = isl_union_set_read_from_str(ctx, str);
+	empty = isl_union_map_empty(isl_union_set_get_space(D));
+	sc = isl_schedule_constraints_on_domain(D);
+	sc = isl_schedule_constraints_set_validity(sc,
+						isl_union_map_copy(empty));
+	sc = isl_schedule_constraints_set_proximity(sc, empty);
+	sched = isl_schedule_constraints_compute_schedule(sc);
+
+	umap1 = isl_schedule_get_map(sched);
+	umap2 = isl_schedule_get_map(sched);
+	same = umap1 && umap1 == umap2;
+
+	list = isl_schedule_get_band_forest(sched);
+	band = isl_band_list_get_band(list, 0);
+	isl_band_list_free(list);
+	sizes = isl_vec_alloc(ctx, 1);
+	sizes = isl_vec_set_element_si(sizes, 0, 4);
+	if (isl_band_tile(band, sizes) < 0)
+		band = isl_band_free(band);
+	isl_band_free(band);
+
+	umap3 = isl_schedule_get_map(sched);
+	isl_schedule_free(sched);
+	equal = isl_union_map_is_equal(umap1, umap3);
+	isl_union_map_free(umap1);
+	isl_union_map_free(umap2);
+	isl_union_map_free(umap3);
+
+	if (!band || equal < 0)
+		return -1;
+	if (!same)
+		isl_die(ctx, isl_error_unknown,
+			"schedule map not cached", return -1);
+	if (equal)
+		isl_die(ctx, isl_error_unknown,
+			"stale schedule map after tiling", return -1);
+
+	return 0;
+}
+
+/* Check that a tiling plan can be reused for different tile sizes
+ * and that it produces the same partial schedule as isl_band_tile.
+ */
+static int test_band_tile_plan(isl_ctx *ctx)
+{
+	const char *str;
+	isl_union_set *D;
+	isl_union_map *dep;
+	isl_schedule_constraints *sc;
+	isl_schedule *sched;
+	isl_band_list *list;
+	isl_band *band, *child;
+	isl_band_tile_plan *plan;
+	isl_union_map *umap, *expected;
+	isl_map *tile;
+	isl_vec *sizes;
+	int scale, shift, equal1, equal2;
+
+	str = "[N] -> { S[i, j] : 0 <= i, j <= N; T[i] : 0 <= i <= N }";
+	D = isl_union_set_read_from_str(ctx, str);
+	str = "[N] -> { S[i, j] -> T[i] : 0 <= i, j <= N }";
+	dep = isl_union_map_read_from_str(ctx, str);
+	sc = isl_schedule_constraints_on_domain(D);
+	sc = isl_schedule_constraints_set_validity(sc, isl_union_map_copy(dep));
+	sc = isl_schedule_constraints_set_proximity(sc, dep);
+	sched = isl_schedule_constraints_compute_schedule(sc);
+	list = isl_schedule_get_band_forest(sched);
+	band = isl_band_list_get_band(list, 0);
+	isl_band_list_free(list);
+	isl_schedule_free(sched);
+	if (!band)
+		return -1;
+	if (isl_band_n_member(band) != 2) {
+		isl_band_free(band);
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of members in band", return -1);
+	}
+
+	scale = isl_options_get_tile_scale_tile_loops(ctx);
+	shift = isl_options_get_tile_shift_point_loops(ctx);
+	isl_options_set_tile_scale_tile_loops(ctx, 1);
+	isl_options_set_tile_shift_point_loops(ctx, 1);
+
+	plan = isl_band_tile_plan_alloc(band);
+
+	str = "{ [a, b] -> [3 * floor(a/3), b, a - 3 * floor(a/3), 0] }";
+	tile = isl_map_read_from_str(ctx, str);
+	expected = isl_band_get_partial_schedule(band);
+	expected = isl_union_map_apply_range(expected,
+						isl_union_map_from_map(tile));
+	sizes = isl_vec_alloc(ctx, 1);
+	sizes = isl_vec_set_element_si(sizes, 0, 3);
+	umap = isl_band_tile_plan_get_partial_schedule(plan, sizes);
+	isl_vec_free(sizes);
+	equal1 = isl_union_map_is_equal(umap, expected);
+	isl_union_map_free(umap);
+	isl_union_map_free(expected);
+
+	sizes = isl_vec_alloc(ctx, 2);
+	sizes = isl_vec_set_element_si(sizes, 0, 4);
+	sizes = isl_vec_set_element_si(sizes, 1, 5);
+	umap = isl_band_tile_plan_get_partial_schedule(plan, sizes);
+	isl_band_tile_plan_free(plan);
+	if (isl_band_tile(band, sizes) < 0)
+		band = isl_band_free(band);
+	list = isl_band_get_children(band);
+	child = isl_band_list_get_band(list, 0);
+	isl_band_list_free(list);
+	expected = isl_band_get_partial_schedule(band);
+	expected = isl_union_map_flat_range_product(expected,
+					isl_band_get_partial_schedule(child));
+	isl_band_free(child);
+	isl_band_free(band);
+	equal2 = isl_union_map_is_equal(umap, expected);
+	isl_union_map_free(umap);
+	isl_union_map_free(expected);
+
+	isl_options_set_tile_scale_tile_loops(ctx, scale);
+	isl_options_set_tile_shift_point_loops(ctx, shift);
+
+	if (equal1 < 0 || equal2 < 0)
+		return -1;
+	if (!equal1 || !equal2)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected tiling plan schedule", return -1);
+
+	return 0;
+}
+
+/* Input for testing of schedule construction based on
+ * conditional constraints.
+ *
+ * domain is the iteration domain
+ * flow are the flow dependences, which determine the validity and
+ * 	proximity constraints
+ * condition are the conditions on the conditional validity constraints
+ * conditional_validity are the conditional validity constraints
+ * outer_band_n is the expected number of members in the outer band
+ */
+struct {
+	const char *domain;
+	const char *flow;
+	const char *condition;
+	const char *conditional_validity;
+	int outer_band_n;
+} live_range_tests[] = {
+	/* Contrived example that illustrates that we need to keep
+	 * track of tagged condition dependences and
+	 * tagged conditional validity dependences
+	 * in isl_sched_edge separately.
+	 * In particular, the conditional validity constraints on A
+	 * cannot be satisfied,
+	 * but they can be ignored because there are no corresponding
+	 * condition constraints.  However, we do have an additional
+	 * conditional validity constraint that maps to the same
+	 * dependence relation
+	 * as the condition constraint on B.  If we did not make a distinction
+	 * between tagged condition and tagged conditional validity
+	 * dependences, then we
+	 * could end up treating this shared dependence as an condition
+	 * constraint on A, forcing a localization of the conditions,
+	 * which is impossible.
+	 */
+	{ "{ S[i] : 0 <= 1 < 100; T[i] : 0 <= 1 < 100 }",
+	  "{ S[i] -> S[i+1] : 0 <= i < 99 }",
+	  "{ [S[i] -> B[]] -> [S[i+1] -> B[]] : 0 <= i < 99 }",
+	  "{ [S[i] -> A[]] -> [T[i'] -> A[]] : 0 <= i', i < 100 and i != i';"
+	    "[T[i] -> A[]] -> [S[i'] -> A[]] : 0 <= i', i < 100 and i != i';"
+	    "[S[i] -> A[]] -> [S[i+1] -> A[]] : 0 <= i < 99 }",
+	  1
+	},
+	/* TACO 2013 Fig. 7 */
+	{ "[n] -> { S1[i,j] : 0 <= i,j < n; S2[i,j] : 0 <= i,j < n }",
+	  "[n] -> { S1[i,j] -> S2[i,j] : 0 <= i,j < n;"
+		   "S2[i,j] -> S2[i,j+1] : 0 <= i < n and 0 <= j < n - 1 }",
+	  "[n] -> { [S1[i,j] -> t[]] -> [S2[i,j] -> t[]] : 0 <= i,j < n;"
+		   "[S2[i,j] -> x1[]] -> [S2[i,j+1] -> x1[]] : "
+				"0 <= i < n and 0 <= j < n - 1 }",
+	  "[n] -> { [S2[i,j] -> t[]] -> [S1[i,j'] -> t[]] : "
+				"0 <= i < n and 0 <= j < j' < n;"
+		   "[S2[i,j] -> t[]] -> [S1[i',j'] -> t[]] : "
+				"0 <= i < i' < n and 0 <= j,j' < n;"
+		   "[S2[i,j] -> x1[]] -> [S2[i,j'] -> x1[]] : "
+				"0 <= i,j,j' < n and j < j' }",
+	    2
+	},
+	/* TACO 2013 Fig. 7, without tags */
+	{ "[n] -> { S1[i,j] : 0 <= i,j < n; S2[i,j] : 0 <= i,j < n }",
+	  "[n] -> { S1[i,j] -> S2[i,j] : 0 <= i,j < n;"
+		   "S2[i,j] -> S2[i,j+1] : 0 <= i < n and 0 <= j < n - 1 }",
+	  "[n] -> { S1[i,j] -> S2[i,j] : 0 <= i,j < n;"
+		   "S2[i,j] -> S2[i,j+1] : 0 <= i < n and 0 <= j < n - 1 }",
+	  "[n] -> { S2[i,j] -> S1[i,j'] : 0 <= i < n and 0 <= j < j' < n;"
+		   "S2[i,j] -> S1[i',j'] : 0 <= i < i' < n and 0 <= j,j' < n;"
+		   "S2[i,j] -> S2[i,j'] : 0 <= i,j,j' < n and j < j' }",
+	   1
+	},
+	/* TACO 2013 Fig. 12 */
+	{ "{ S1[i,0] : 0 <= i <= 1; S2[i,j] : 0 <= i <= 1 and 1 <= j <= 2;"
+	    "S3[i,3] : 0 <= i <= 1 }",
+	  "{ S1[i,0] -> S2[i,1] : 0 <= i <= 1;"
+	    "S2[i,1] -> S2[i,2] : 0 <= i <= 1;"
+	    "S2[i,2] -> S3[i,3] : 0 <= i <= 1 }",
+	  "{ [S1[i,0]->t[]] -> [S2[i,1]->t[]] : 0 <= i <= 1;"
+	    "[S2[i,1]->t[]] -> [S2[i,2]->t[]] : 0 <= i <= 1;"
+	    "[S2[i,2]->t[]] -> [S3[i,3]->t[]] : 0 <= i <= 1 }",
+	  "{ [S2[i,1]->t[]] -> [S2[i,2]->t[]] : 0 <= i <= 1;"
+	    "[S2[0,j]->t[]] -> [S2[1,j']->t[]] : 1 <= j,j' <= 2;"
+	    "[S2[0,j]->t[]] -> [S1[1,0]->t[]] : 1 <= j <= 2;"
+	    "[S3[0,3]->t[]] -> [S2[1,j]->t[]] : 1 <= j <= 2;"
+	    "[S3[0,3]->t[]] -> [S1[1,0]->t[]] }",
+	   1
+	}
+};
+
+/* Test schedule construction based on conditional constraints.
+ * In particular, check the number of members in the outer band
+ * as an indication of whether tiling is possible or not.
+ */
+static int test_conditional_schedule_constraints(isl_ctx *ctx)
+{
+	int i;
+	isl_union_set *domain;
+	isl_union_map *condition;
+	isl_union_map *flow;
+	isl_union_map *validity;
+	isl_schedule_constraints *sc;
+	isl_schedule *schedule;
+	isl_band_list *list;
+	isl_band *band;
+	int n_member;
+
+	for (i = 0; i < ARRAY_SIZE(live_range_tests); ++i) {
+		domain = isl_union_set_read_from_str(ctx,
+				live_range_tests[i].domain);
+		flow = isl_union_map_read_from_str(ctx,
+				live_range_tests[i].flow);
+		condition = isl_union_map_read_from_str(ctx,
+				live_range_tests[i].condition);
+		validity = isl_union_map_read_from_str(ctx,
+				live_range_tests[i].conditional_validity);
+		sc = isl_schedule_constraints_on_domain(domain);
+		sc = isl_schedule_constraints_set_validity(sc,
+				isl_union_map_copy(flow));
+		sc = isl_schedule_constraints_set_proximity(sc, flow);
+		sc = isl_schedule_constraints_set_conditional_validity(sc,
+				condition, validity);
+		schedule = isl_schedule_constraints_compute_schedule(sc);
+		list = isl_schedule_get_band_forest(schedule);
+		band = isl_band_list_get_band(list, 0);
+		n_member = isl_band_n_member(band);
+		isl_band_free(band);
+		isl_band_list_free(list);
+		isl_schedule_free(schedule);
+
+		if (!schedule)
+			return -1;
+		if (n_member != live_range_tests[i].outer_band_n)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected number of members in outer band",
+				return -1);
+	}
+	return 0;
+}
+
+/* A schedule cache with a single entry.
+ */
+struct single_schedule_cache {
+	uint32_t hash;
+	isl_schedule *schedule;
+};
+
+static __isl_give isl_schedule *load_schedule(
+	__isl_keep isl_schedule_constraints *sc, uint32_t hash, void *user)
+{
+	struct single_schedule_cache *cache = user;
+
+	if (!cache->schedule || cache->hash != hash)
+		return NULL;
+	return isl_schedule_copy(cache->schedule);
+}
+
+static int store_schedule(__isl_keep isl_schedule_constraints *sc,
+	uint32_t hash, __isl_keep isl_schedule *schedule, void *user)
+{
+	struct single_schedule_cache *cache = user;
+
+	isl_schedule_free(cache->schedule);
+	cache->hash = hash;
+	cache->schedule = isl_schedule_copy(schedule);
+
+	return 0;
+}
+
+/* Check that a schedule stored in a schedule cache is reused
+ * for the same schedule constraints, even if the parameters
+ * appear in a different order, and only for those.
+ */
+static int test_schedule_cache(isl_ctx *ctx)
+{
+	struct single_schedule_cache cache = { 0, NULL };
+	isl_union_map *sched1, *sched2;
+	long hits;
+	int equal;
+
+	isl_ctx_set_schedule_cache(ctx, &load_schedule, &store_schedule,
+				    &cache);
+	hits = isl_ctx_get_stat(ctx, "schedule_cache_hits");
+
+	sched1 = compute_schedule(ctx,
+		"[n, m] -> { A[i] : 0 <= i < n; B[i] : 0 <= i < m }",
+		"[n, m] -> { A[i] -> B[i] : 0 <= i < n, m }", "{}");
+	sched2 = compute_schedule(ctx,
+		"[m, n] -> { B[i] : 0 <= i < m; A[i] : 0 <= i < n }",
+		"[m, n] -> { A[i] -> B[i] : 0 <= i < n, m }", "{}");
+	equal = isl_union_map_is_equal(sched1, sched2);
+	isl_union_map_free(sched1);
+	isl_union_map_free(sched2);
+	if (equal >= 0 && isl_ctx_get_stat(ctx, "schedule_cache_hits") !=
+			hits + 1)
+		equal = 0;
+
+	sched1 = compute_schedule(ctx, "[n] -> { A[i] : 0 <= i < n }",
+				"{}", "{}");
+	if (!sched1)
+		equal = -1;
+	else if (isl_ctx_get_stat(ctx, "schedule_cache_hits") != hits + 1)
+		equal = 0;
+	isl_union_map_free(sched1);
+
+	isl_ctx_set_schedule_cache(ctx, NULL, NULL, NULL);
+	isl_schedule_free(cache.schedule);
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"schedule cache not used as expected", return -1);
+
+	return 0;
+}
+
+/* Compute a schedule as in compute_schedule, using "n_thread" threads
+ * for scheduling the components of the dependence graph.
+ * The input is read before the number of threads is changed
+ * since reading with several threads may result in a different
+ * (but equal) representation of the input, which may in turn
+ * result in a different schedule.
  */
-static int test_coalesce(struct isl_ctx *ctx)
+static __isl_give isl_union_map *compute_schedule_threads(isl_ctx *ctx,
+	const char *domain, const char *validity, const char *proximity,
+	int n_thread)
 {
-	int i;
+	int old;
+	isl_union_set *dom;
+	isl_union_map *dep;
+	isl_union_map *prox;
+	isl_schedule_constraints *sc;
+	isl_schedule *schedule;
+	isl_union_map *sched;
 
-	for (i = 0; i < ARRAY_SIZE(coalesce_tests); ++i) {
-		const char *str = coalesce_tests[i].str;
-		int check_one = coalesce_tests[i].single_disjunct;
-		if (test_coalesce_set(ctx, str, check_one) < 0)
-			return -1;
+	dom = isl_union_set_read_from_str(ctx, domain);
+	dep = isl_union_map_read_from_str(ctx, validity);
+	prox = isl_union_map_read_from_str(ctx, proximity);
+	sc = isl_schedule_constraints_on_domain(dom);
+	sc = isl_schedule_constraints_set_validity(sc, dep);
+	sc = isl_schedule_constraints_set_proximity(sc, prox);
+	old = isl_options_get_threads(ctx);
+	isl_options_set_threads(ctx, n_thread);
+	schedule = isl_schedule_constraints_compute_schedule(sc);
+	isl_options_set_threads(ctx, old);
+	sched = isl_schedule_get_map(schedule);
+	isl_schedule_free(schedule);
+
+	return sched;
+}
+
+/* Check that scheduling the components of a dependence graph
+ * by several threads produces the same schedule as scheduling them
+ * in a single thread, both for the weakly connected components
+ * (one of which has a compressed domain) and for the clusters
+ * of the cluster scheduling algorithm.
+ */
+static int test_schedule_threads(isl_ctx *ctx)
+{
+	int i;
+	const char *D, *V, *P;
+	isl_union_map *seq, *par;
+	int equal = 1;
+
+	D = "[n] -> { A[i] : 0 <= i < n; B[i] : 0 <= i < n; "
+		"C[i, j] : i = 2j and 0 <= j < n; D[i, j] : 0 <= i, j < n; "
+		"E[i] : 0 <= i < n; F[] }";
+	V = "[n] -> { A[i] -> B[i + 1] : 0 <= i < n - 1; "
+		"C[i, j] -> C[i + 2, j + 1] : 0 <= j < n - 1; "
+		"D[i, j] -> D[i + 1, j - 1] : 0 <= i < n - 1 and 0 < j < n; "
+		"D[i, j] -> E[j] : 0 <= i, j < n }";
+	P = "[n] -> { A[i] -> B[i] : 0 <= i < n; E[i] -> E[i + 1] }";
+
+	for (i = 0; equal >= 0 && equal && i < 2; ++i) {
+		if (i == 1) {
+			ctx->opt->schedule_algorithm =
+				ISL_SCHEDULE_ALGORITHM_CLUSTER;
+			ctx->opt->schedule_cluster_size = 2;
+		}
+		seq = compute_schedule_threads(ctx, D, V, P, 1);
+		par = compute_schedule_threads(ctx, D, V, P, 3);
+		equal = isl_union_map_is_equal(seq, par);
+		isl_union_map_free(seq);
+		isl_union_map_free(par);
 	}
+	ctx->opt->schedule_cluster_size = 64;
+	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_ISL;
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"parallel scheduling differs from sequential",
+			return -1);
+
+	return 0;
+}
+
+int test_schedule(isl_ctx *ctx)
+{
+	const char *D, *W, *R, *V, *P, *S;
+	long setup_ops, solve_ops;
+
+	/* Handle resulting schedule with zero bands. */
+	if (test_one_schedule(ctx, "{[]}", "{}", "{}", "{[] -> []}", 0, 0) < 0)
+		return -1;
+
+	/* Jacobi */
+	D = "[T,N] -> { S1[t,i] : 1 <= t <= T and 2 <= i <= N - 1 }";
+	W = "{ S1[t,i] -> a[t,i] }";
+	R = "{ S1[t,i] -> a[t-1,i]; S1[t,i] -> a[t-1,i-1]; "
+	    	"S1[t,i] -> a[t-1,i+1] }";
+	S = "{ S1[t,i] -> [t,i] }";
+	if (test_one_schedule(ctx, D, W, R, S, 2, 0) < 0)
+		return -1;
+
+	/* Fig. 5 of CC2008 */
+	D = "[N] -> { S_0[i, j] : i >= 0 and i <= -1 + N and j >= 2 and "
+				"j <= -1 + N }";
+	W = "[N] -> { S_0[i, j] -> a[i, j] : i >= 0 and i <= -1 + N and "
+				"j >= 2 and j <= -1 + N }";
+	R = "[N] -> { S_0[i, j] -> a[j, i] : i >= 0 and i <= -1 + N and "
+				"j >= 2 and j <= -1 + N; "
+		    "S_0[i, j] -> a[i, -1 + j] : i >= 0 and i <= -1 + N and "
+				"j >= 2 and j <= -1 + N }";
+	S = "[N] -> { S_0[i, j] -> [0, i, 0, j, 0] }";
+	if (test_one_schedule(ctx, D, W, R, S, 2, 0) < 0)
+		return -1;
+
+	D = "{ S1[i] : 0 <= i <= 10; S2[i] : 0 <= i <= 9 }";
+	W = "{ S1[i] -> a[i] }";
+	R = "{ S2[i] -> a[i+1] }";
+	S = "{ S1[i] -> [0,i]; S2[i] -> [1,i] }";
+	if (test_one_schedule(ctx, D, W, R, S, 1, 1) < 0)
+		return -1;
+
+	D = "{ S1[i] : 0 <= i < 10; S2[i] : 0 <= i < 10 }";
+	W = "{ S1[i] -> a[i] }";
+	R = "{ S2[i] -> a[9-i] }";
+	S = "{ S1[i] -> [0,i]; S2[i] -> [1,i] }";
+	if (test_one_schedule(ctx, D, W, R, S, 1, 1) < 0)
+		return -1;
+
+	D = "[N] -> { S1[i] : 0 <= i < N; S2[i] : 0 <= i < N }";
+	W = "{ S1[i] -> a[i] }";
+	R = "[N] -> { S2[i] -> a[N-1-i] }";
+	S = "{ S1[i] -> [0,i]; S2[i] -> [1,i] }";
+	if (test_one_schedule(ctx, D, W, R, S, 1, 1) < 0)
+		return -1;
+	
+	D = "{ S1[i] : 0 < i < 10; S2[i] : 0 <= i < 10 }";
+	W = "{ S1[i] -> a[i]; S2[i] -> b[i] }";
+	R = "{ S2[i] -> a[i]; S1[i] -> b[i-1] }";
+	S = "{ S1[i] -> [i,0]; S2[i] -> [i,1] }";
+	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
+		return -1;
+
+	D = "[N] -> { S1[i] : 1 <= i <= N; S2[i,j] : 1 <= i,j <= N }";
+	W = "{ S1[i] -> a[0,i]; S2[i,j] -> a[i,j] }";
+	R = "{ S2[i,j] -> a[i-1,j] }";
+	S = "{ S1[i] -> [0,i,0]; S2[i,j] -> [1,i,j] }";
+	if (test_one_schedule(ctx, D, W, R, S, 2, 1) < 0)
+		return -1;
+
+	D = "[N] -> { S1[i] : 1 <= i <= N; S2[i,j] : 1 <= i,j <= N }";
+	W = "{ S1[i] -> a[i,0]; S2[i,j] -> a[i,j] }";
+	R = "{ S2[i,j] -> a[i,j-1] }";
+	S = "{ S1[i] -> [0,i,0]; S2[i,j] -> [1,i,j] }";
+	if (test_one_schedule(ctx, D, W, R, S, 2, 1) < 0)
+		return -1;
+
+	D = "[N] -> { S_0[]; S_1[i] : i >= 0 and i <= -1 + N; S_2[] }";
+	W = "[N] -> { S_0[] -> a[0]; S_2[] -> b[0]; "
+		    "S_1[i] -> a[1 + i] : i >= 0 and i <= -1 + N }";
+	R = "[N] -> { S_2[] -> a[N]; S_1[i] -> a[i] : i >= 0 and i <= -1 + N }";
+	S = "[N] -> { S_1[i] -> [1, i, 0]; S_2[] -> [2, 0, 1]; "
+		    "S_0[] -> [0, 0, 0] }";
+	if (test_one_schedule(ctx, D, W, R, S, 1, 0) < 0)
+		return -1;
+	ctx->opt->schedule_parametric = 0;
+	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
+		return -1;
+	ctx->opt->schedule_parametric = 1;
+
+	D = "[N] -> { S1[i] : 1 <= i <= N; S2[i] : 1 <= i <= N; "
+		    "S3[i,j] : 1 <= i,j <= N; S4[i] : 1 <= i <= N }";
+	W = "{ S1[i] -> a[i,0]; S2[i] -> a[0,i]; S3[i,j] -> a[i,j] }";
+	R = "[N] -> { S3[i,j] -> a[i-1,j]; S3[i,j] -> a[i,j-1]; "
+		    "S4[i] -> a[i,N] }";
+	S = "{ S1[i] -> [0,i,0]; S2[i] -> [1,i,0]; S3[i,j] -> [2,i,j]; "
+		"S4[i] -> [4,i,0] }";
+	if (test_one_schedule(ctx, D, W, R, S, 2, 0) < 0)
+		return -1;
+
+	D = "[N] -> { S_0[i, j] : i >= 1 and i <= N and j >= 1 and j <= N }";
+	W = "[N] -> { S_0[i, j] -> s[0] : i >= 1 and i <= N and j >= 1 and "
+					"j <= N }";
+	R = "[N] -> { S_0[i, j] -> s[0] : i >= 1 and i <= N and j >= 1 and "
+					"j <= N; "
+		    "S_0[i, j] -> a[i, j] : i >= 1 and i <= N and j >= 1 and "
+					"j <= N }";
+	S = "[N] -> { S_0[i, j] -> [0, i, 0, j, 0] }";
+	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
+		return -1;
+
+	D = "[N] -> { S_0[t] : t >= 0 and t <= -1 + N; "
+		    " S_2[t] : t >= 0 and t <= -1 + N; "
+		    " S_1[t, i] : t >= 0 and t <= -1 + N and i >= 0 and "
+				"i <= -1 + N }";
+	W = "[N] -> { S_0[t] -> a[t, 0] : t >= 0 and t <= -1 + N; "
+		    " S_2[t] -> b[t] : t >= 0 and t <= -1 + N; "
+		    " S_1[t, i] -> a[t, 1 + i] : t >= 0 and t <= -1 + N and "
+						"i >= 0 and i <= -1 + N }";
+	R = "[N] -> { S_1[t, i] -> a[t, i] : t >= 0 and t <= -1 + N and "
+					    "i >= 0 and i <= -1 + N; "
+		    " S_2[t] -> a[t, N] : t >= 0 and t <= -1 + N }";
+	S = "[N] -> { S_2[t] -> [0, t, 2]; S_1[t, i] -> [0, t, 1, i, 0]; "
+		    " S_0[t] -> [0, t, 0] }";
+
+	if (test_one_schedule(ctx, D, W, R, S, 2, 1) < 0)
+		return -1;
+	ctx->opt->schedule_parametric = 0;
+	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
+		return -1;
+	ctx->opt->schedule_parametric = 1;
+
+	D = "[N] -> { S1[i,j] : 0 <= i,j < N; S2[i,j] : 0 <= i,j < N }";
+	S = "{ S1[i,j] -> [0,i,j]; S2[i,j] -> [1,i,j] }";
+	if (test_one_schedule(ctx, D, "{}", "{}", S, 2, 2) < 0)
+		return -1;
+
+	D = "[M, N] -> { S_1[i] : i >= 0 and i <= -1 + M; "
+	    "S_0[i, j] : i >= 0 and i <= -1 + M and j >= 0 and j <= -1 + N }";
+	W = "[M, N] -> { S_0[i, j] -> a[j] : i >= 0 and i <= -1 + M and "
+					    "j >= 0 and j <= -1 + N; "
+			"S_1[i] -> b[0] : i >= 0 and i <= -1 + M }";
+	R = "[M, N] -> { S_0[i, j] -> a[0] : i >= 0 and i <= -1 + M and "
+					    "j >= 0 and j <= -1 + N; "
+			"S_1[i] -> b[0] : i >= 0 and i <= -1 + M }";
+	S = "[M, N] -> { S_1[i] -> [1, i, 0]; S_0[i, j] -> [0, i, 0, j, 0] }";
+	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
+		return -1;
+
+	D = "{ S_0[i] : i >= 0 }";
+	W = "{ S_0[i] -> a[i] : i >= 0 }";
+	R = "{ S_0[i] -> a[0] : i >= 0 }";
+	S = "{ S_0[i] -> [0, i, 0] }";
+	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
+		return -1;
+
+	D = "{ S_0[i] : i >= 0; S_1[i] : i >= 0 }";
+	W = "{ S_0[i] -> a[i] : i >= 0; S_1[i] -> b[i] : i >= 0 }";
+	R = "{ S_0[i] -> b[0] : i >= 0; S_1[i] -> a[i] : i >= 0 }";
+	S = "{ S_1[i] -> [0, i, 1]; S_0[i] -> [0, i, 0] }";
+	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
+		return -1;
+
+	D = "[n] -> { S_0[j, k] : j <= -1 + n and j >= 0 and "
+				"k <= -1 + n and k >= 0 }";
+	W = "[n] -> { S_0[j, k] -> B[j] : j <= -1 + n and j >= 0 and "							"k <= -1 + n and k >= 0 }";
+	R = "[n] -> { S_0[j, k] -> B[j] : j <= -1 + n and j >= 0 and "
+					"k <= -1 + n and k >= 0; "
+		    "S_0[j, k] -> B[k] : j <= -1 + n and j >= 0 and "
+					"k <= -1 + n and k >= 0; "
+		    "S_0[j, k] -> A[k] : j <= -1 + n and j >= 0 and "
+					"k <= -1 + n and k >= 0 }";
+	S = "[n] -> { S_0[j, k] -> [2, j, k] }";
+	ctx->opt->schedule_outer_coincidence = 1;
+	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
+		return -1;
+	ctx->opt->schedule_outer_coincidence = 0;
+
+	D = "{Stmt_for_body24[i0, i1, i2, i3]:"
+		"i0 >= 0 and i0 <= 1 and i1 >= 0 and i1 <= 6 and i2 >= 2 and "
+		"i2 <= 6 - i1 and i3 >= 0 and i3 <= -1 + i2;"
+	     "Stmt_for_body24[i0, i1, 1, 0]:"
+		"i0 >= 0 and i0 <= 1 and i1 >= 0 and i1 <= 5;"
+	     "Stmt_for_body7[i0, i1, i2]:"
+		"i0 >= 0 and i0 <= 1 and i1 >= 0 and i1 <= 7 and i2 >= 0 and "
+		"i2 <= 7 }";
+
+	V = "{Stmt_for_body24[0, i1, i2, i3] -> "
+		"Stmt_for_body24[1, i1, i2, i3]:"
+		"i3 >= 0 and i3 <= -1 + i2 and i1 >= 0 and i2 <= 6 - i1 and "
+		"i2 >= 1;"
+	     "Stmt_for_body24[0, i1, i2, i3] -> "
+		"Stmt_for_body7[1, 1 + i1 + i3, 1 + i1 + i2]:"
+		"i3 <= -1 + i2 and i2 <= 6 - i1 and i2 >= 1 and i1 >= 0 and "
+		"i3 >= 0;"
+	      "Stmt_for_body24[0, i1, i2, i3] ->"
+		"Stmt_for_body7[1, i1, 1 + i1 + i3]:"
+		"i3 >= 0 and i2 <= 6 - i1 and i1 >= 0 and i3 <= -1 + i2;"
+	      "Stmt_for_body7[0, i1, i2] -> Stmt_for_body7[1, i1, i2]:"
+		"(i2 >= 1 + i1 and i2 <= 6 and i1 >= 0 and i1 <= 4) or "
+		"(i2 >= 3 and i2 <= 7 and i1 >= 1 and i2 >= 1 + i1) or "
+		"(i2 >= 0 and i2 <= i1 and i2 >= -7 + i1 and i1 <= 7);"
+	      "Stmt_for_body7[0, i1, 1 + i1] -> Stmt_for_body7[1, i1, 1 + i1]:"
+		"i1 <= 6 and i1 >= 0;"
+	      "Stmt_for_body7[0, 0, 7] -> Stmt_for_body7[1, 0, 7];"
+	      "Stmt_for_body7[i0, i1, i2] -> "
+		"Stmt_for_body24[i0, o1, -1 + i2 - o1, -1 + i1 - o1]:"
+		"i0 >= 0 and i0 <= 1 and o1 >= 0 and i2 >= 1 + i1 and "
+		"o1 <= -2 + i2 and i2 <= 7 and o1 <= -1 + i1;"
+	      "Stmt_for_body7[i0, i1, i2] -> "
+		"Stmt_for_body24[i0, i1, o2, -1 - i1 + i2]:"
+		"i0 >= 0 and i0 <= 1 and i1 >= 0 and o2 >= -i1 + i2 and "
+		"o2 >= 1 and o2 <= 6 - i1 and i2 >= 1 + i1 }";
+	P = V;
+	S = "{ Stmt_for_body24[i0, i1, i2, i3] -> "
+		"[i0, 5i0 + i1, 6i0 + i1 + i2, 1 + 6i0 + i1 + i2 + i3, 1];"
+	    "Stmt_for_body7[i0, i1, i2] -> [0, 5i0, 6i0 + i1, 6i0 + i2, 0] }";
 
-	if (test_coalesce_unbounded_wrapping(ctx) < 0)
+	if (test_special_schedule(ctx, D, V, P, S) < 0)
 		return -1;
 
-	return 0;
-}
-
-void test_closure(struct isl_ctx *ctx)
-{
-	const char *str;
-	isl_set *dom;
-	isl_map *up, *right;
-	isl_map *map, *map2;
-	int exact;
+	D = "{ S_0[i, j] : i >= 1 and i <= 10 and j >= 1 and j <= 8 }";
+	V = "{ S_0[i, j] -> S_0[i, 1 + j] : i >= 1 and i <= 10 and "
+					   "j >= 1 and j <= 7;"
+		"S_0[i, j] -> S_0[1 + i, j] : i >= 1 and i <= 9 and "
+					     "j >= 1 and j <= 8 }";
+	P = "{ }";
+	S = "{ S_0[i, j] -> [i + j, j] }";
+	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_FEAUTRIER;
+	if (test_special_schedule(ctx, D, V, P, S) < 0)
+		return -1;
+	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_ISL;
 
-	/* COCOA example 1 */
-	map = isl_map_read_from_str(ctx,
-		"[n] -> { [i,j] -> [i2,j2] : i2 = i + 1 and j2 = j + 1 and "
-			"1 <= i and i < n and 1 <= j and j < n or "
-			"i2 = i + 1 and j2 = j - 1 and "
-			"1 <= i and i < n and 2 <= j and j <= n }");
-	map = isl_map_power(map, &exact);
-	assert(exact);
-	isl_map_free(map);
+	/* Fig. 1 from Feautrier's "Some Efficient Solutions..." pt. 2, 1992 */
+	D = "[N] -> { S_0[i, j] : i >= 0 and i <= -1 + N and "
+				 "j >= 0 and j <= -1 + i }";
+	V = "[N] -> { S_0[i, j] -> S_0[i, 1 + j] : j <= -2 + i and "
+					"i <= -1 + N and j >= 0;"
+		     "S_0[i, -1 + i] -> S_0[1 + i, 0] : i >= 1 and "
+					"i <= -2 + N }";
+	P = "{ }";
+	S = "{ S_0[i, j] -> [i, j] }";
+	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_FEAUTRIER;
+	if (test_special_schedule(ctx, D, V, P, S) < 0)
+		return -1;
+	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_ISL;
 
-	/* COCOA example 1 */
-	map = isl_map_read_from_str(ctx,
-		"[n] -> { [i,j] -> [i2,j2] : i2 = i + 1 and j2 = j + 1 and "
-			"1 <= i and i < n and 1 <= j and j < n or "
-			"i2 = i + 1 and j2 = j - 1 and "
-			"1 <= i and i < n and 2 <= j and j <= n }");
-	map = isl_map_transitive_closure(map, &exact);
-	assert(exact);
-	map2 = isl_map_read_from_str(ctx,
-		"[n] -> { [i,j] -> [i2,j2] : exists (k1,k2,k : "
-			"1 <= i and i < n and 1 <= j and j <= n and "
-			"2 <= i2 and i2 <= n and 1 <= j2 and j2 <= n and "
-			"i2 = i + k1 + k2 and j2 = j + k1 - k2 and "
-			"k1 >= 0 and k2 >= 0 and k1 + k2 = k and k >= 1 )}");
-	assert(isl_map_is_equal(map, map2));
-	isl_map_free(map2);
-	isl_map_free(map);
+	/* Test both algorithms on a case with only proximity dependences. */
+	D = "{ S[i,j] : 0 <= i <= 10 }";
+	V = "{ }";
+	P = "{ S[i,j] -> S[i+1,j] : 0 <= i,j <= 10 }";
+	S = "{ S[i, j] -> [j, i] }";
+	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_FEAUTRIER;
+	if (test_special_schedule(ctx, D, V, P, S) < 0)
+		return -1;
+	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_ISL;
+	if (test_special_schedule(ctx, D, V, P, S) < 0)
+		return -1;
+	
+	D = "{ A[a]; B[] }";
+	V = "{}";
+	P = "{ A[a] -> B[] }";
+	if (test_has_schedule(ctx, D, V, P) < 0)
+		return -1;
 
-	map = isl_map_read_from_str(ctx,
-		"[n] -> { [x] -> [y] : y = x + 1 and 0 <= x and x <= n and "
-				     " 0 <= y and y <= n }");
-	map = isl_map_transitive_closure(map, &exact);
-	map2 = isl_map_read_from_str(ctx,
-		"[n] -> { [x] -> [y] : y > x and 0 <= x and x <= n and "
-				     " 0 <= y and y <= n }");
-	assert(isl_map_is_equal(map, map2));
-	isl_map_free(map2);
-	isl_map_free(map);
+	if (test_padded_schedule(ctx) < 0)
+		return -1;
 
-	/* COCOA example 2 */
-	map = isl_map_read_from_str(ctx,
-		"[n] -> { [i,j] -> [i2,j2] : i2 = i + 2 and j2 = j + 2 and "
-			"1 <= i and i < n - 1 and 1 <= j and j < n - 1 or "
-			"i2 = i + 2 and j2 = j - 2 and "
-			"1 <= i and i < n - 1 and 3 <= j and j <= n }");
-	map = isl_map_transitive_closure(map, &exact);
-	assert(exact);
-	map2 = isl_map_read_from_str(ctx,
-		"[n] -> { [i,j] -> [i2,j2] : exists (k1,k2,k : "
-			"1 <= i and i < n - 1 and 1 <= j and j <= n and "
-			"3 <= i2 and i2 <= n and 1 <= j2 and j2 <= n and "
-			"i2 = i + 2 k1 + 2 k2 and j2 = j + 2 k1 - 2 k2 and "
-			"k1 >= 0 and k2 >= 0 and k1 + k2 = k and k >= 1) }");
-	assert(isl_map_is_equal(map, map2));
-	isl_map_free(map);
-	isl_map_free(map2);
+	if (test_band_tile(ctx) < 0)
+		return -1;
+	if (test_schedule_map_cache(ctx) < 0)
+		return -1;
+	if (test_schedule_shared_constraints(ctx) < 0)
+		return -1;
+	if (test_band_tile_plan(ctx) < 0)
+		return -1;
 
-	/* COCOA Fig.2 left */
-	map = isl_map_read_from_str(ctx,
-		"[n] -> { [i,j] -> [i2,j2] : i2 = i + 2 and j2 = j and "
-			"i <= 2 j - 3 and i <= n - 2 and j <= 2 i - 1 and "
-			"j <= n or "
-			"i2 = i and j2 = j + 2 and i <= 2 j - 1 and i <= n and "
-			"j <= 2 i - 3 and j <= n - 2 or "
-			"i2 = i + 1 and j2 = j + 1 and i <= 2 j - 1 and "
-			"i <= n - 1 and j <= 2 i - 1 and j <= n - 1 }");
-	map = isl_map_transitive_closure(map, &exact);
-	assert(exact);
-	isl_map_free(map);
+	/* Check that check for progress is not confused by rational
+	 * solution.
+	 */
+	D = "[N] -> { S0[i, j] : i >= 0 and i <= N and j >= 0 and j <= N }";
+	V = "[N] -> { S0[i0, -1 + N] -> S0[2 + i0, 0] : i0 >= 0 and "
+							"i0 <= -2 + N; "
+			"S0[i0, i1] -> S0[i0, 1 + i1] : i0 >= 0 and "
+				"i0 <= N and i1 >= 0 and i1 <= -1 + N }";
+	P = "{}";
+	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_FEAUTRIER;
+	if (test_has_schedule(ctx, D, V, P) < 0)
+		return -1;
+	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_ISL;
 
-	/* COCOA Fig.2 right */
-	map = isl_map_read_from_str(ctx,
-		"[n] -> { [i,j] -> [i2,j2] : i2 = i + 3 and j2 = j and "
-			"i <= 2 j - 4 and i <= n - 3 and j <= 2 i - 1 and "
-			"j <= n or "
-			"i2 = i and j2 = j + 3 and i <= 2 j - 1 and i <= n and "
-			"j <= 2 i - 4 and j <= n - 3 or "
-			"i2 = i + 1 and j2 = j + 1 and i <= 2 j - 1 and "
-			"i <= n - 1 and j <= 2 i - 1 and j <= n - 1 }");
-	map = isl_map_power(map, &exact);
-	assert(exact);
-	isl_map_free(map);
+	/* Check that we allow schedule rows that are only non-trivial
+	 * on some full-dimensional domains.
+	 */
+	D = "{ S1[j] : 0 <= j <= 1; S0[]; S2[k] : 0 <= k <= 1 }";
+	V = "{ S0[] -> S1[j] : 0 <= j <= 1; S2[0] -> S0[];"
+		"S1[j] -> S2[1] : 0 <= j <= 1 }";
+	P = "{}";
+	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_FEAUTRIER;
+	if (test_has_schedule(ctx, D, V, P) < 0)
+		return -1;
+	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_ISL;
 
-	/* COCOA Fig.2 right */
-	map = isl_map_read_from_str(ctx,
-		"[n] -> { [i,j] -> [i2,j2] : i2 = i + 3 and j2 = j and "
-			"i <= 2 j - 4 and i <= n - 3 and j <= 2 i - 1 and "
-			"j <= n or "
-			"i2 = i and j2 = j + 3 and i <= 2 j - 1 and i <= n and "
-			"j <= 2 i - 4 and j <= n - 3 or "
-			"i2 = i + 1 and j2 = j + 1 and i <= 2 j - 1 and "
-			"i <= n - 1 and j <= 2 i - 1 and j <= n - 1 }");
-	map = isl_map_transitive_closure(map, &exact);
-	assert(exact);
-	map2 = isl_map_read_from_str(ctx,
-		"[n] -> { [i,j] -> [i2,j2] : exists (k1,k2,k3,k : "
-			"i <= 2 j - 1 and i <= n and j <= 2 i - 1 and "
-			"j <= n and 3 + i + 2 j <= 3 n and "
-			"3 + 2 i + j <= 3n and i2 <= 2 j2 -1 and i2 <= n and "
-			"i2 <= 3 j2 - 4 and j2 <= 2 i2 -1 and j2 <= n and "
-			"13 + 4 j2 <= 11 i2 and i2 = i + 3 k1 + k3 and "
-			"j2 = j + 3 k2 + k3 and k1 >= 0 and k2 >= 0 and "
-			"k3 >= 0 and k1 + k2 + k3 = k and k > 0) }");
-	assert(isl_map_is_equal(map, map2));
-	isl_map_free(map2);
-	isl_map_free(map);
+	/* Check that the cluster algorithm produces a valid schedule
+	 * when the statements need to be split over several clusters,
+	 * including a cluster containing a cycle.
+	 */
+	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_CLUSTER;
+	ctx->opt->schedule_cluster_size = 2;
+	D = "[n] -> { S1[i] : 0 <= i < n; S2[i] : 0 <= i < n; "
+		"S3[i] : 0 <= i < n; S4[i] : 0 <= i < n; S5[i] : 0 <= i < n }";
+	W = "{ S1[i] -> A[i]; S2[i] -> B[i]; S3[i] -> A[i]; "
+		"S4[i] -> C[i]; S5[i] -> D[i] }";
+	R = "{ S2[i] -> A[i - 1]; S3[i] -> B[i]; S3[i] -> A[i - 1]; "
+		"S4[i] -> A[i]; S5[i] -> C[i] }";
+	S = "{ S1[i] -> [0, i]; S2[i] -> [1, i]; S3[i] -> [2, i]; "
+		"S4[i] -> [3, i]; S5[i] -> [4, i] }";
+	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
+		return -1;
+	ctx->opt->schedule_cluster_size = 64;
+	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_ISL;
 
-	/* COCOA Fig.1 right */
-	dom = isl_set_read_from_str(ctx,
-		"{ [x,y] : x >= 0 and -2 x + 3 y >= 0 and x <= 3 and "
-			"2 x - 3 y + 3 >= 0 }");
-	right = isl_map_read_from_str(ctx,
-		"{ [x,y] -> [x2,y2] : x2 = x + 1 and y2 = y }");
-	up = isl_map_read_from_str(ctx,
-		"{ [x,y] -> [x2,y2] : x2 = x and y2 = y + 1 }");
-	right = isl_map_intersect_domain(right, isl_set_copy(dom));
-	right = isl_map_intersect_range(right, isl_set_copy(dom));
-	up = isl_map_intersect_domain(up, isl_set_copy(dom));
-	up = isl_map_intersect_range(up, dom);
-	map = isl_map_union(up, right);
-	map = isl_map_transitive_closure(map, &exact);
-	assert(exact);
-	map2 = isl_map_read_from_str(ctx,
-		"{ [0,0] -> [0,1]; [0,0] -> [1,1]; [0,1] -> [1,1]; "
-		"  [2,2] -> [3,2]; [2,2] -> [3,3]; [3,2] -> [3,3] }");
-	assert(isl_map_is_equal(map, map2));
-	isl_map_free(map2);
-	isl_map_free(map);
+	/* Check that the time spent in the different phases
+	 * of the scheduler is recorded.
+	 */
+	setup_ops = isl_ctx_get_stat(ctx, "sched_setup_ops");
+	solve_ops = isl_ctx_get_stat(ctx, "sched_solve_ops");
+	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
+		return -1;
+	if (isl_ctx_get_stat(ctx, "sched_setup_ops") <= setup_ops ||
+	    isl_ctx_get_stat(ctx, "sched_solve_ops") <= solve_ops)
+		isl_die(ctx, isl_error_unknown,
+			"scheduler phases not recorded", return -1);
 
-	/* COCOA Theorem 1 counter example */
-	map = isl_map_read_from_str(ctx,
-		"{ [i,j] -> [i2,j2] : i = 0 and 0 <= j and j <= 1 and "
-			"i2 = 1 and j2 = j or "
-			"i = 0 and j = 0 and i2 = 0 and j2 = 1 }");
-	map = isl_map_transitive_closure(map, &exact);
-	assert(exact);
-	isl_map_free(map);
+	if (test_conditional_schedule_constraints(ctx) < 0)
+		return -1;
 
-	map = isl_map_read_from_str(ctx,
-		"[m,n] -> { [i,j] -> [i2,j2] : i2 = i and j2 = j + 2 and "
-			"1 <= i,i2 <= n and 1 <= j,j2 <= m or "
-			"i2 = i + 1 and 3 <= j2 - j <= 4 and "
-			"1 <= i,i2 <= n and 1 <= j,j2 <= m }");
-	map = isl_map_transitive_closure(map, &exact);
-	assert(exact);
-	isl_map_free(map);
+	if (test_schedule_cache(ctx) < 0)
+		return -1;
+	if (test_schedule_threads(ctx) < 0)
+		return -1;
 
-	/* Kelly et al 1996, fig 12 */
-	map = isl_map_read_from_str(ctx,
-		"[n] -> { [i,j] -> [i2,j2] : i2 = i and j2 = j + 1 and "
-			"1 <= i,j,j+1 <= n or "
-			"j = n and j2 = 1 and i2 = i + 1 and "
-			"1 <= i,i+1 <= n }");
-	map = isl_map_transitive_closure(map, &exact);
-	assert(exact);
-	map2 = isl_map_read_from_str(ctx,
-		"[n] -> { [i,j] -> [i2,j2] : 1 <= j < j2 <= n and "
-			"1 <= i <= n and i = i2 or "
-			"1 <= i < i2 <= n and 1 <= j <= n and "
-			"1 <= j2 <= n }");
-	assert(isl_map_is_equal(map, map2));
-	isl_map_free(map2);
-	isl_map_free(map);
+	return 0;
+}
 
-	/* Omega's closure4 */
-	map = isl_map_read_from_str(ctx,
-		"[m,n] -> { [x,y] -> [x2,y2] : x2 = x and y2 = y + 1 and "
-			"1 <= x,y <= 10 or "
-			"x2 = x + 1 and y2 = y and "
-			"1 <= x <= 20 && 5 <= y <= 15 }");
-	map = isl_map_transitive_closure(map, &exact);
-	assert(exact);
-	isl_map_free(map);
+int test_plain_injective(isl_ctx *ctx, const char *str, int injective)
+{
+	isl_union_map *umap;
+	int test;
 
-	map = isl_map_read_from_str(ctx,
-		"[n] -> { [x] -> [y]: 1 <= n <= y - x <= 10 }");
-	map = isl_map_transitive_closure(map, &exact);
-	assert(!exact);
-	map2 = isl_map_read_from_str(ctx,
-		"[n] -> { [x] -> [y] : 1 <= n <= 10 and y >= n + x }");
-	assert(isl_map_is_equal(map, map2));
-	isl_map_free(map);
-	isl_map_free(map2);
+	umap = isl_union_map_read_from_str(ctx, str);
+	test = isl_union_map_plain_is_injective(umap);
+	isl_union_map_free(umap);
+	if (test < 0)
+		return -1;
+	if (test == injective)
+		return 0;
+	if (injective)
+		isl_die(ctx, isl_error_unknown,
+			"map not detected as injective", return -1);
+	else
+		isl_die(ctx, isl_error_unknown,
+			"map detected as injective", return -1);
+}
 
-	str = "[n, m] -> { [i0, i1, i2, i3] -> [o0, o1, o2, o3] : "
-	    "i3 = 1 and o0 = i0 and o1 = -1 + i1 and o2 = -1 + i2 and "
-	    "o3 = -2 + i2 and i1 <= -1 + i0 and i1 >= 1 - m + i0 and "
-	    "i1 >= 2 and i1 <= n and i2 >= 3 and i2 <= 1 + n and i2 <= m }";
-	map = isl_map_read_from_str(ctx, str);
-	map = isl_map_transitive_closure(map, &exact);
-	assert(exact);
-	map2 = isl_map_read_from_str(ctx, str);
-	assert(isl_map_is_equal(map, map2));
-	isl_map_free(map);
-	isl_map_free(map2);
+int test_injective(isl_ctx *ctx)
+{
+	const char *str;
 
-	str = "{[0] -> [1]; [2] -> [3]}";
-	map = isl_map_read_from_str(ctx, str);
-	map = isl_map_transitive_closure(map, &exact);
-	assert(exact);
-	map2 = isl_map_read_from_str(ctx, str);
-	assert(isl_map_is_equal(map, map2));
-	isl_map_free(map);
-	isl_map_free(map2);
+	if (test_plain_injective(ctx, "{S[i,j] -> A[0]; T[i,j] -> B[1]}", 0))
+		return -1;
+	if (test_plain_injective(ctx, "{S[] -> A[0]; T[] -> B[0]}", 1))
+		return -1;
+	if (test_plain_injective(ctx, "{S[] -> A[0]; T[] -> A[1]}", 1))
+		return -1;
+	if (test_plain_injective(ctx, "{S[] -> A[0]; T[] -> A[0]}", 0))
+		return -1;
+	if (test_plain_injective(ctx, "{S[i] -> A[i,0]; T[i] -> A[i,1]}", 1))
+		return -1;
+	if (test_plain_injective(ctx, "{S[i] -> A[i]; T[i] -> A[i]}", 0))
+		return -1;
+	if (test_plain_injective(ctx, "{S[] -> A[0,0]; T[] -> A[0,1]}", 1))
+		return -1;
+	if (test_plain_injective(ctx, "{S[] -> A[0,0]; T[] -> A[1,0]}", 1))
+		return -1;
 
-	str = "[n] -> { [[i0, i1, 1, 0, i0] -> [i5, 1]] -> "
-	    "[[i0, -1 + i1, 2, 0, i0] -> [-1 + i5, 2]] : "
-	    "exists (e0 = [(3 - n)/3]: i5 >= 2 and i1 >= 2 and "
-	    "3i0 <= -1 + n and i1 <= -1 + n and i5 <= -1 + n and "
-	    "3e0 >= 1 - n and 3e0 <= 2 - n and 3i0 >= -2 + n); "
-	    "[[i0, i1, 2, 0, i0] -> [i5, 1]] -> "
-	    "[[i0, i1, 1, 0, i0] -> [-1 + i5, 2]] : "
-	    "exists (e0 = [(3 - n)/3]: i5 >= 2 and i1 >= 1 and "
-	    "3i0 <= -1 + n and i1 <= -1 + n and i5 <= -1 + n and "
-	    "3e0 >= 1 - n and 3e0 <= 2 - n and 3i0 >= -2 + n); "
-	    "[[i0, i1, 1, 0, i0] -> [i5, 2]] -> "
-	    "[[i0, -1 + i1, 2, 0, i0] -> [i5, 1]] : "
-	    "exists (e0 = [(3 - n)/3]: i1 >= 2 and i5 >= 1 and "
-	    "3i0 <= -1 + n and i1 <= -1 + n and i5 <= -1 + n and "
-	    "3e0 >= 1 - n and 3e0 <= 2 - n and 3i0 >= -2 + n); "
-	    "[[i0, i1, 2, 0, i0] -> [i5, 2]] -> "
-	    "[[i0, i1, 1, 0, i0] -> [i5, 1]] : "
-	    "exists (e0 = [(3 - n)/3]: i5 >= 1 and i1 >= 1 and "
-	    "3i0 <= -1 + n and i1 <= -1 + n and i5 <= -1 + n and "
-	    "3e0 >= 1 - n and 3e0 <= 2 - n and 3i0 >= -2 + n) }";
-	map = isl_map_read_from_str(ctx, str);
-	map = isl_map_transitive_closure(map, NULL);
-	assert(map);
-	isl_map_free(map);
+	str = "{S[] -> A[0,0]; T[] -> A[0,1]; U[] -> A[1,0]}";
+	if (test_plain_injective(ctx, str, 1))
+		return -1;
+	str = "{S[] -> A[0,0]; T[] -> A[0,1]; U[] -> A[0,0]}";
+	if (test_plain_injective(ctx, str, 0))
+		return -1;
+
+	return 0;
 }
 
-void test_lex(struct isl_ctx *ctx)
+static int aff_plain_is_equal(__isl_keep isl_aff *aff, const char *str)
 {
-	isl_space *dim;
-	isl_map *map;
+	isl_aff *aff2;
+	int equal;
 
-	dim = isl_space_set_alloc(ctx, 0, 0);
-	map = isl_map_lex_le(dim);
-	assert(!isl_map_is_empty(map));
-	isl_map_free(map);
+	if (!aff)
+		return -1;
+
+	aff2 = isl_aff_read_from_str(isl_aff_get_ctx(aff), str);
+	equal = isl_aff_plain_is_equal(aff, aff2);
+	isl_aff_free(aff2);
+
+	return equal;
 }
 
-static int test_lexmin(struct isl_ctx *ctx)
+static int aff_check_plain_equal(__isl_keep isl_aff *aff, const char *str)
 {
 	int equal;
-	const char *str;
-	isl_basic_map *bmap;
-	isl_map *map, *map2;
-	isl_set *set;
-	isl_set *set2;
-	isl_pw_multi_aff *pma;
 
-	str = "[p0, p1] -> { [] -> [] : "
-	    "exists (e0 = [(2p1)/3], e1, e2, e3 = [(3 - p1 + 3e0)/3], "
-	    "e4 = [(p1)/3], e5 = [(p1 + 3e4)/3]: "
-	    "3e0 >= -2 + 2p1 and 3e0 >= p1 and 3e3 >= 1 - p1 + 3e0 and "
-	    "3e0 <= 2p1 and 3e3 >= -2 + p1 and 3e3 <= -1 + p1 and p1 >= 3 and "
-	    "3e5 >= -2 + 2p1 and 3e5 >= p1 and 3e5 <= -1 + p1 + 3e4 and "
-	    "3e4 <= p1 and 3e4 >= -2 + p1 and e3 <= -1 + e0 and "
-	    "3e4 >= 6 - p1 + 3e1 and 3e1 >= p1 and 3e5 >= -2 + p1 + 3e4 and "
-	    "2e4 >= 3 - p1 + 2e1 and e4 <= e1 and 3e3 <= 2 - p1 + 3e0 and "
-	    "e5 >= 1 + e1 and 3e4 >= 6 - 2p1 + 3e1 and "
-	    "p0 >= 2 and p1 >= p0 and 3e2 >= p1 and 3e4 >= 6 - p1 + 3e2 and "
-	    "e2 <= e1 and e3 >= 1 and e4 <= e2) }";
-	map = isl_map_read_from_str(ctx, str);
-	map = isl_map_lexmin(map);
-	isl_map_free(map);
+	equal = aff_plain_is_equal(aff, str);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(isl_aff_get_ctx(aff), isl_error_unknown,
+			"result not as expected", return -1);
+	return 0;
+}
 
-	str = "[C] -> { [obj,a,b,c] : obj <= 38 a + 7 b + 10 c and "
-	    "a + b <= 1 and c <= 10 b and c <= C and a,b,c,C >= 0 }";
-	set = isl_set_read_from_str(ctx, str);
-	set = isl_set_lexmax(set);
-	str = "[C] -> { [obj,a,b,c] : C = 8 }";
-	set2 = isl_set_read_from_str(ctx, str);
-	set = isl_set_intersect(set, set2);
-	assert(!isl_set_is_empty(set));
-	isl_set_free(set);
+struct {
+	__isl_give isl_aff *(*fn)(__isl_take isl_aff *aff1,
+				__isl_take isl_aff *aff2);
+} aff_bin_op[] = {
+	['+'] = { &isl_aff_add },
+	['-'] = { &isl_aff_sub },
+	['*'] = { &isl_aff_mul },
+	['/'] = { &isl_aff_div },
+};
 
-	str = "{ [x] -> [y] : x <= y <= 10; [x] -> [5] : -8 <= x <= 8 }";
-	map = isl_map_read_from_str(ctx, str);
-	map = isl_map_lexmin(map);
-	str = "{ [x] -> [5] : 6 <= x <= 8; "
-		"[x] -> [x] : x <= 5 or (9 <= x <= 10) }";
-	map2 = isl_map_read_from_str(ctx, str);
-	assert(isl_map_is_equal(map, map2));
-	isl_map_free(map);
-	isl_map_free(map2);
+struct {
+	const char *arg1;
+	unsigned char op;
+	const char *arg2;
+	const char *res;
+} aff_bin_tests[] = {
+	{ "{ [i] -> [i] }", '+', "{ [i] -> [i] }",
+	  "{ [i] -> [2i] }" },
+	{ "{ [i] -> [i] }", '-', "{ [i] -> [i] }",
+	  "{ [i] -> [0] }" },
+	{ "{ [i, j] -> [(i + 3j)/2] }", '-', "{ [i, j] -> [(i - j + 1)/2] }",
+	  "{ [i, j] -> [(4j - 1)/2] }" },
+	{ "{ [i] -> [i/2] }", '-', "{ [i] -> [i/3] }",
+	  "{ [i] -> [i/6] }" },
+	{ "{ [i] -> [i/2] }", '+', "{ [i] -> [i/3 + 1] }",
+	  "{ [i] -> [5i/6 + 1] }" },
+	{ "{ [i] -> [2 * floor(i/2)] }", '-', "{ [i] -> [floor(i/2) - i] }",
+	  "{ [i] -> [floor(i/2) + i] }" },
+	{ "{ [i] -> [i] }", '*', "{ [i] -> [2] }",
+	  "{ [i] -> [2i] }" },
+	{ "{ [i] -> [2] }", '*', "{ [i] -> [i] }",
+	  "{ [i] -> [2i] }" },
+	{ "{ [i] -> [i] }", '/', "{ [i] -> [2] }",
+	  "{ [i] -> [i/2] }" },
+	{ "{ [i] -> [2i] }", '/', "{ [i] -> [2] }",
+	  "{ [i] -> [i] }" },
+	{ "{ [i] -> [i] }", '+', "{ [i] -> [NaN] }",
+	  "{ [i] -> [NaN] }" },
+	{ "{ [i] -> [i] }", '-', "{ [i] -> [NaN] }",
+	  "{ [i] -> [NaN] }" },
+	{ "{ [i] -> [i] }", '*', "{ [i] -> [NaN] }",
+	  "{ [i] -> [NaN] }" },
+	{ "{ [i] -> [2] }", '*', "{ [i] -> [NaN] }",
+	  "{ [i] -> [NaN] }" },
+	{ "{ [i] -> [i] }", '/', "{ [i] -> [NaN] }",
+	  "{ [i] -> [NaN] }" },
+	{ "{ [i] -> [2] }", '/', "{ [i] -> [NaN] }",
+	  "{ [i] -> [NaN] }" },
+	{ "{ [i] -> [NaN] }", '+', "{ [i] -> [i] }",
+	  "{ [i] -> [NaN] }" },
+	{ "{ [i] -> [NaN] }", '-', "{ [i] -> [i] }",
+	  "{ [i] -> [NaN] }" },
+	{ "{ [i] -> [NaN] }", '*', "{ [i] -> [2] }",
+	  "{ [i] -> [NaN] }" },
+	{ "{ [i] -> [NaN] }", '*', "{ [i] -> [i] }",
+	  "{ [i] -> [NaN] }" },
+	{ "{ [i] -> [NaN] }", '/', "{ [i] -> [2] }",
+	  "{ [i] -> [NaN] }" },
+	{ "{ [i] -> [NaN] }", '/', "{ [i] -> [i] }",
+	  "{ [i] -> [NaN] }" },
+};
+
+/* Perform some basic tests of binary operations on isl_aff objects.
+ */
+static int test_bin_aff(isl_ctx *ctx)
+{
+	int i;
+	isl_aff *aff1, *aff2, *res;
+	__isl_give isl_aff *(*fn)(__isl_take isl_aff *aff1,
+				__isl_take isl_aff *aff2);
+	int ok;
+
+	for (i = 0; i < ARRAY_SIZE(aff_bin_tests); ++i) {
+		aff1 = isl_aff_read_from_str(ctx, aff_bin_tests[i].arg1);
+		aff2 = isl_aff_read_from_str(ctx, aff_bin_tests[i].arg2);
+		res = isl_aff_read_from_str(ctx, aff_bin_tests[i].res);
+		fn = aff_bin_op[aff_bin_tests[i].op].fn;
+		aff1 = fn(aff1, aff2);
+		if (isl_aff_is_nan(res))
+			ok = isl_aff_is_nan(aff1);
+		else
+			ok = isl_aff_plain_is_equal(aff1, res);
+		isl_aff_free(aff1);
+		isl_aff_free(res);
+		if (ok < 0)
+			return -1;
+		if (!ok)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected result", return -1);
+	}
+
+	return 0;
+}
 
-	str = "{ [x] -> [y] : 4y = x or 4y = -1 + x or 4y = -2 + x }";
-	map = isl_map_read_from_str(ctx, str);
-	map2 = isl_map_copy(map);
-	map = isl_map_lexmin(map);
-	assert(isl_map_is_equal(map, map2));
-	isl_map_free(map);
-	isl_map_free(map2);
+/* Check that combining the piecewise affine expressions "str1" and "str2"
+ * using "fn" results in "res" and that pairs of pieces with
+ * disjoint domains are skipped.
+ */
+static int check_pw_aff_pairs(isl_ctx *ctx, const char *str1,
+	const char *str2, __isl_give isl_pw_aff *(*fn)(
+		__isl_take isl_pw_aff *pa1, __isl_take isl_pw_aff *pa2),
+	const char *res)
+{
+	isl_pw_aff *pa1, *pa2;
+	isl_map *map, *expected;
+	long skipped;
+	int equal;
 
-	str = "{ [x] -> [y] : x = 4y; [x] -> [y] : x = 2y }";
-	map = isl_map_read_from_str(ctx, str);
-	map = isl_map_lexmin(map);
-	str = "{ [x] -> [y] : (4y = x and x >= 0) or "
-		"(exists (e0 = [(x)/4], e1 = [(-2 + x)/4]: 2y = x and "
-		"4e1 = -2 + x and 4e0 <= -1 + x and 4e0 >= -3 + x)) or "
-		"(exists (e0 = [(x)/4]: 2y = x and 4e0 = x and x <= -4)) }";
-	map2 = isl_map_read_from_str(ctx, str);
-	assert(isl_map_is_equal(map, map2));
+	skipped = isl_ctx_get_stat(ctx, "pw_pairs_skipped");
+	pa1 = isl_pw_aff_read_from_str(ctx, str1);
+	pa2 = isl_pw_aff_read_from_str(ctx, str2);
+	map = isl_map_from_pw_aff(fn(pa1, pa2));
+	expected = isl_map_read_from_str(ctx, res);
+	equal = isl_map_is_equal(map, expected);
 	isl_map_free(map);
-	isl_map_free(map2);
+	isl_map_free(expected);
 
-	str = "{ [i] -> [i', j] : j = i - 8i' and i' >= 0 and i' <= 7 and "
-				" 8i' <= i and 8i' >= -7 + i }";
-	bmap = isl_basic_map_read_from_str(ctx, str);
-	pma = isl_basic_map_lexmin_pw_multi_aff(isl_basic_map_copy(bmap));
-	map2 = isl_map_from_pw_multi_aff(pma);
-	map = isl_map_from_basic_map(bmap);
-	assert(isl_map_is_equal(map, map2));
-	isl_map_free(map);
-	isl_map_free(map2);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected result", return -1);
+	if (isl_ctx_get_stat(ctx, "pw_pairs_skipped") <= skipped)
+		isl_die(ctx, isl_error_unknown,
+			"no pairs skipped", return -1);
 
-	str = "{ T[a] -> S[b, c] : a = 4b-2c and c >= b }";
-	map = isl_map_read_from_str(ctx, str);
-	map = isl_map_lexmin(map);
-	str = "{ T[a] -> S[b, c] : 2b = a and 2c = a }";
-	map2 = isl_map_read_from_str(ctx, str);
-	assert(isl_map_is_equal(map, map2));
-	isl_map_free(map);
-	isl_map_free(map2);
+	return 0;
+}
 
-	/* Check that empty pieces are properly combined. */
-	str = "[K, N] -> { [x, y] -> [a, b] : K+2<=N<=K+4 and x>=4 and "
-		"2N-6<=x<K+N and N-1<=a<=K+N-1 and N+b-6<=a<=2N-4 and "
-		"b<=2N-3K+a and 3b<=4N-K+1 and b>=N and a>=x+1 }";
-	map = isl_map_read_from_str(ctx, str);
-	map = isl_map_lexmin(map);
-	str = "[K, N] -> { [x, y] -> [1 + x, N] : x >= -6 + 2N and "
-		"x <= -5 + 2N and x >= -1 + 3K - N and x <= -2 + K + N and "
-		"x >= 4 }";
-	map2 = isl_map_read_from_str(ctx, str);
-	assert(isl_map_is_equal(map, map2));
-	isl_map_free(map);
-	isl_map_free(map2);
+/* Check that pairs of pieces with disjoint domains are skipped
+ * when combining piecewise affine expressions.
+ */
+static int test_pw_aff_pairs(isl_ctx *ctx)
+{
+	const char *str1, *str2;
+
+	str1 = "{ [i] -> [i] : 0 <= i < 10; [i] -> [0] : 10 <= i < 20; "
+		"[i] -> [1] : 20 <= i < 30 }";
+	str2 = "{ [i] -> [5] : 5 <= i < 15; [i] -> [2] : 25 <= i < 40 }";
+	if (check_pw_aff_pairs(ctx, str1, str2, &isl_pw_aff_union_max,
+		"{ [i] -> [i] : 0 <= i < 10; [i] -> [5] : 10 <= i < 15; "
+		"[i] -> [0] : 15 <= i < 20; [i] -> [1] : 20 <= i < 25; "
+		"[i] -> [2] : 25 <= i < 40 }") < 0)
+		return -1;
+	if (check_pw_aff_pairs(ctx, str1, str2, &isl_pw_aff_union_add,
+		"{ [i] -> [i] : 0 <= i < 5; [i] -> [i + 5] : 5 <= i < 10; "
+		"[i] -> [5] : 10 <= i < 15; [i] -> [0] : 15 <= i < 20; "
+		"[i] -> [1] : 20 <= i < 25; [i] -> [3] : 25 <= i < 30; "
+		"[i] -> [2] : 30 <= i < 40 }") < 0)
+		return -1;
+	if (check_pw_aff_pairs(ctx, str1, str2, &isl_pw_aff_add,
+		"{ [i] -> [i + 5] : 5 <= i < 10; [i] -> [5] : 10 <= i < 15; "
+		"[i] -> [3] : 25 <= i < 30 }") < 0)
+		return -1;
+	if (check_pw_aff_pairs(ctx, str1, str2, &isl_pw_aff_min,
+		"{ [i] -> [5] : 5 <= i < 10; [i] -> [0] : 10 <= i < 15; "
+		"[i] -> [1] : 25 <= i < 30 }") < 0)
+		return -1;
+	if (check_pw_aff_pairs(ctx, str1, str2, &isl_pw_aff_max,
+		"{ [i] -> [i] : 5 <= i < 10; [i] -> [5] : 10 <= i < 15; "
+		"[i] -> [2] : 25 <= i < 30 }") < 0)
+		return -1;
+
+	return 0;
+}
+
+/* Check that the minimum of a list of piecewise affine expressions
+ * is computed correctly and that the elements that are obviously
+ * dominated by other elements do not introduce any extra pieces.
+ */
+static int test_pw_aff_list_min(isl_ctx *ctx)
+{
+	const char *str;
+	isl_pw_aff *pa1, *pa2;
+	int equal;
+
+	str = "{ [i] -> [min(i, i + 1, 2i, i - 2, i - 2)] }";
+	pa1 = isl_pw_aff_read_from_str(ctx, str);
+	str = "{ [i] -> [min(2i, i - 2)] }";
+	pa2 = isl_pw_aff_read_from_str(ctx, str);
+	equal = isl_pw_aff_is_equal(pa1, pa2);
+	if (equal >= 0 && equal && isl_pw_aff_n_piece(pa1) > 2)
+		equal = 0;
+	isl_pw_aff_free(pa1);
+	isl_pw_aff_free(pa2);
 
-	str = "[i] -> { [i', j] : j = i - 8i' and i' >= 0 and i' <= 7 and "
-				" 8i' <= i and 8i' >= -7 + i }";
-	set = isl_set_read_from_str(ctx, str);
-	pma = isl_set_lexmin_pw_multi_aff(isl_set_copy(set));
-	set2 = isl_set_from_pw_multi_aff(pma);
-	equal = isl_set_is_equal(set, set2);
-	isl_set_free(set);
-	isl_set_free(set2);
 	if (equal < 0)
 		return -1;
 	if (!equal)
 		isl_die(ctx, isl_error_unknown,
-			"unexpected difference between set and "
-			"piecewise affine expression", return -1);
+			"unexpected result", return -1);
 
 	return 0;
 }
 
-/* Check that isl_set_min_val and isl_set_max_val compute the correct
- * result on non-convex inputs.
- */
-static int test_min(struct isl_ctx *ctx)
+int test_aff(isl_ctx *ctx)
 {
+	const char *str;
 	isl_set *set;
+	isl_space *space;
+	isl_local_space *ls;
 	isl_aff *aff;
-	isl_val *val;
-	int min_ok, max_ok;
+	int zero, equal;
 
-	set = isl_set_read_from_str(ctx, "{ [-1]; [1] }");
-	aff = isl_aff_read_from_str(ctx, "{ [x] -> [x] }");
-	val = isl_set_min_val(set, aff);
-	min_ok = isl_val_is_negone(val);
-	isl_val_free(val);
-	val = isl_set_max_val(set, aff);
-	max_ok = isl_val_is_one(val);
-	isl_val_free(val);
+	if (test_bin_aff(ctx) < 0)
+		return -1;
+	if (test_pw_aff_pairs(ctx) < 0)
+		return -1;
+	if (test_pw_aff_list_min(ctx) < 0)
+		return -1;
+
+	space = isl_space_set_alloc(ctx, 0, 1);
+	ls = isl_local_space_from_space(space);
+	aff = isl_aff_zero_on_domain(ls);
+
+	aff = isl_aff_add_coefficient_si(aff, isl_dim_in, 0, 1);
+	aff = isl_aff_scale_down_ui(aff, 3);
+	aff = isl_aff_floor(aff);
+	aff = isl_aff_add_coefficient_si(aff, isl_dim_in, 0, 1);
+	aff = isl_aff_scale_down_ui(aff, 2);
+	aff = isl_aff_floor(aff);
+	aff = isl_aff_add_coefficient_si(aff, isl_dim_in, 0, 1);
+
+	str = "{ [10] }";
+	set = isl_set_read_from_str(ctx, str);
+	aff = isl_aff_gist(aff, set);
+
+	aff = isl_aff_add_constant_si(aff, -16);
+	zero = isl_aff_plain_is_zero(aff);
 	isl_aff_free(aff);
-	isl_set_free(set);
 
-	if (min_ok < 0 || max_ok < 0)
+	if (zero < 0)
+		return -1;
+	if (!zero)
+		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+
+	aff = isl_aff_read_from_str(ctx, "{ [-1] }");
+	aff = isl_aff_scale_down_ui(aff, 64);
+	aff = isl_aff_floor(aff);
+	equal = aff_check_plain_equal(aff, "{ [-1] }");
+	isl_aff_free(aff);
+	if (equal < 0)
 		return -1;
-	if (!min_ok)
-		isl_die(ctx, isl_error_unknown,
-			"unexpected minimum", return -1);
-	if (!max_ok)
-		isl_die(ctx, isl_error_unknown,
-			"unexpected maximum", return -1);
 
 	return 0;
 }
 
-struct must_may {
-	isl_map *must;
-	isl_map *may;
-};
-
-static int collect_must_may(__isl_take isl_map *dep, int must,
-	void *dep_user, void *user)
+int test_dim_max(isl_ctx *ctx)
 {
-	struct must_may *mm = (struct must_may *)user;
+	int equal;
+	const char *str;
+	isl_set *set1, *set2;
+	isl_set *set;
+	isl_map *map;
+	isl_pw_aff *pwaff;
+
+	str = "[N] -> { [i] : 0 <= i <= min(N,10) }";
+	set = isl_set_read_from_str(ctx, str);
+	pwaff = isl_set_dim_max(set, 0);
+	set1 = isl_set_from_pw_aff(pwaff);
+	str = "[N] -> { [10] : N >= 10; [N] : N <= 9 and N >= 0 }";
+	set2 = isl_set_read_from_str(ctx, str);
+	equal = isl_set_is_equal(set1, set2);
+	isl_set_free(set1);
+	isl_set_free(set2);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+
+	str = "[N] -> { [i] : 0 <= i <= max(2N,N+6) }";
+	set = isl_set_read_from_str(ctx, str);
+	pwaff = isl_set_dim_max(set, 0);
+	set1 = isl_set_from_pw_aff(pwaff);
+	str = "[N] -> { [6 + N] : -6 <= N <= 5; [2N] : N >= 6 }";
+	set2 = isl_set_read_from_str(ctx, str);
+	equal = isl_set_is_equal(set1, set2);
+	isl_set_free(set1);
+	isl_set_free(set2);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+
+	str = "[N] -> { [i] : 0 <= i <= 2N or 0 <= i <= N+6 }";
+	set = isl_set_read_from_str(ctx, str);
+	pwaff = isl_set_dim_max(set, 0);
+	set1 = isl_set_from_pw_aff(pwaff);
+	str = "[N] -> { [6 + N] : -6 <= N <= 5; [2N] : N >= 6 }";
+	set2 = isl_set_read_from_str(ctx, str);
+	equal = isl_set_is_equal(set1, set2);
+	isl_set_free(set1);
+	isl_set_free(set2);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+
+	str = "[N,M] -> { [i,j] -> [([i/16]), i%16, ([j/16]), j%16] : "
+			"0 <= i < N and 0 <= j < M }";
+	map = isl_map_read_from_str(ctx, str);
+	set = isl_map_range(map);
+
+	pwaff = isl_set_dim_max(isl_set_copy(set), 0);
+	set1 = isl_set_from_pw_aff(pwaff);
+	str = "[N,M] -> { [([(N-1)/16])] : M,N > 0 }";
+	set2 = isl_set_read_from_str(ctx, str);
+	equal = isl_set_is_equal(set1, set2);
+	isl_set_free(set1);
+	isl_set_free(set2);
+
+	pwaff = isl_set_dim_max(isl_set_copy(set), 3);
+	set1 = isl_set_from_pw_aff(pwaff);
+	str = "[N,M] -> { [t] : t = min(M-1,15) and M,N > 0 }";
+	set2 = isl_set_read_from_str(ctx, str);
+	if (equal >= 0 && equal)
+		equal = isl_set_is_equal(set1, set2);
+	isl_set_free(set1);
+	isl_set_free(set2);
+
+	isl_set_free(set);
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+
+	/* Check that solutions are properly merged. */
+	str = "[n] -> { [a, b, c] : c >= -4a - 2b and "
+				"c <= -1 + n - 4a - 2b and c >= -2b and "
+				"4a >= -4 + n and c >= 0 }";
+	set = isl_set_read_from_str(ctx, str);
+	pwaff = isl_set_dim_min(set, 2);
+	set1 = isl_set_from_pw_aff(pwaff);
+	str = "[n] -> { [(0)] : n >= 1 }";
+	set2 = isl_set_read_from_str(ctx, str);
+	equal = isl_set_is_equal(set1, set2);
+	isl_set_free(set1);
+	isl_set_free(set2);
+
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+
+	/* Check that empty solution lie in the right space. */
+	str = "[n] -> { [t,a] : 1 = 0 }";
+	set = isl_set_read_from_str(ctx, str);
+	pwaff = isl_set_dim_max(set, 0);
+	set1 = isl_set_from_pw_aff(pwaff);
+	str = "[n] -> { [t] : 1 = 0 }";
+	set2 = isl_set_read_from_str(ctx, str);
+	equal = isl_set_is_equal(set1, set2);
+	isl_set_free(set1);
+	isl_set_free(set2);
 
-	if (must)
-		mm->must = isl_map_union(mm->must, dep);
-	else
-		mm->may = isl_map_union(mm->may, dep);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
 
 	return 0;
 }
 
-static int common_space(void *first, void *second)
-{
-	int depth = *(int *)first;
-	return 2 * depth;
-}
-
-static int map_is_equal(__isl_keep isl_map *map, const char *str)
+/* Is "pma" obviously equal to the isl_pw_multi_aff represented by "str"?
+ */
+static int pw_multi_aff_plain_is_equal(__isl_keep isl_pw_multi_aff *pma,
+	const char *str)
 {
-	isl_map *map2;
+	isl_ctx *ctx;
+	isl_pw_multi_aff *pma2;
 	int equal;
 
-	if (!map)
+	if (!pma)
 		return -1;
 
-	map2 = isl_map_read_from_str(map->ctx, str);
-	equal = isl_map_is_equal(map, map2);
-	isl_map_free(map2);
+	ctx = isl_pw_multi_aff_get_ctx(pma);
+	pma2 = isl_pw_multi_aff_read_from_str(ctx, str);
+	equal = isl_pw_multi_aff_plain_is_equal(pma, pma2);
+	isl_pw_multi_aff_free(pma2);
 
 	return equal;
 }
 
-static int map_check_equal(__isl_keep isl_map *map, const char *str)
+/* Check that "pma" is obviously equal to the isl_pw_multi_aff
+ * represented by "str".
+ */
+static int pw_multi_aff_check_plain_equal(__isl_keep isl_pw_multi_aff *pma,
+	const char *str)
 {
 	int equal;
 
-	equal = map_is_equal(map, str);
+	equal = pw_multi_aff_plain_is_equal(pma, str);
 	if (equal < 0)
 		return -1;
 	if (!equal)
-		isl_die(isl_map_get_ctx(map), isl_error_unknown,
+		isl_die(isl_pw_multi_aff_get_ctx(pma), isl_error_unknown,
 			"result not as expected", return -1);
 	return 0;
 }
 
-void test_dep(struct isl_ctx *ctx)
+/* Basic test for isl_pw_multi_aff_product.
+ *
+ * Check that multiple pieces are properly handled.
+ */
+static int test_product_pma(isl_ctx *ctx)
 {
+	int equal;
 	const char *str;
-	isl_space *dim;
-	isl_map *map;
-	isl_access_info *ai;
-	isl_flow *flow;
-	int depth;
-	struct must_may mm;
-
-	depth = 3;
-
-	str = "{ [2,i,0] -> [i] : 0 <= i <= 10 }";
-	map = isl_map_read_from_str(ctx, str);
-	ai = isl_access_info_alloc(map, &depth, &common_space, 2);
-
-	str = "{ [0,i,0] -> [i] : 0 <= i <= 10 }";
-	map = isl_map_read_from_str(ctx, str);
-	ai = isl_access_info_add_source(ai, map, 1, &depth);
-
-	str = "{ [1,i,0] -> [5] : 0 <= i <= 10 }";
-	map = isl_map_read_from_str(ctx, str);
-	ai = isl_access_info_add_source(ai, map, 1, &depth);
-
-	flow = isl_access_info_compute_flow(ai);
-	dim = isl_space_alloc(ctx, 0, 3, 3);
-	mm.must = isl_map_empty(isl_space_copy(dim));
-	mm.may = isl_map_empty(dim);
-
-	isl_flow_foreach(flow, collect_must_may, &mm);
-
-	str = "{ [0,i,0] -> [2,i,0] : (0 <= i <= 4) or (6 <= i <= 10); "
-	      "  [1,10,0] -> [2,5,0] }";
-	assert(map_is_equal(mm.must, str));
-	str = "{ [i,j,k] -> [l,m,n] : 1 = 0 }";
-	assert(map_is_equal(mm.may, str));
-
-	isl_map_free(mm.must);
-	isl_map_free(mm.may);
-	isl_flow_free(flow);
-
-
-	str = "{ [2,i,0] -> [i] : 0 <= i <= 10 }";
-	map = isl_map_read_from_str(ctx, str);
-	ai = isl_access_info_alloc(map, &depth, &common_space, 2);
-
-	str = "{ [0,i,0] -> [i] : 0 <= i <= 10 }";
-	map = isl_map_read_from_str(ctx, str);
-	ai = isl_access_info_add_source(ai, map, 1, &depth);
-
-	str = "{ [1,i,0] -> [5] : 0 <= i <= 10 }";
-	map = isl_map_read_from_str(ctx, str);
-	ai = isl_access_info_add_source(ai, map, 0, &depth);
-
-	flow = isl_access_info_compute_flow(ai);
-	dim = isl_space_alloc(ctx, 0, 3, 3);
-	mm.must = isl_map_empty(isl_space_copy(dim));
-	mm.may = isl_map_empty(dim);
-
-	isl_flow_foreach(flow, collect_must_may, &mm);
-
-	str = "{ [0,i,0] -> [2,i,0] : (0 <= i <= 4) or (6 <= i <= 10) }";
-	assert(map_is_equal(mm.must, str));
-	str = "{ [0,5,0] -> [2,5,0]; [1,i,0] -> [2,5,0] : 0 <= i <= 10 }";
-	assert(map_is_equal(mm.may, str));
-
-	isl_map_free(mm.must);
-	isl_map_free(mm.may);
-	isl_flow_free(flow);
-
-
-	str = "{ [2,i,0] -> [i] : 0 <= i <= 10 }";
-	map = isl_map_read_from_str(ctx, str);
-	ai = isl_access_info_alloc(map, &depth, &common_space, 2);
-
-	str = "{ [0,i,0] -> [i] : 0 <= i <= 10 }";
-	map = isl_map_read_from_str(ctx, str);
-	ai = isl_access_info_add_source(ai, map, 0, &depth);
-
-	str = "{ [1,i,0] -> [5] : 0 <= i <= 10 }";
-	map = isl_map_read_from_str(ctx, str);
-	ai = isl_access_info_add_source(ai, map, 0, &depth);
-
-	flow = isl_access_info_compute_flow(ai);
-	dim = isl_space_alloc(ctx, 0, 3, 3);
-	mm.must = isl_map_empty(isl_space_copy(dim));
-	mm.may = isl_map_empty(dim);
-
-	isl_flow_foreach(flow, collect_must_may, &mm);
+	isl_pw_multi_aff *pma1, *pma2;
 
-	str = "{ [0,i,0] -> [2,i,0] : 0 <= i <= 10; "
-	      "  [1,i,0] -> [2,5,0] : 0 <= i <= 10 }";
-	assert(map_is_equal(mm.may, str));
-	str = "{ [i,j,k] -> [l,m,n] : 1 = 0 }";
-	assert(map_is_equal(mm.must, str));
+	str = "{ A[i] -> B[1] : i < 0; A[i] -> B[2] : i >= 0 }";
+	pma1 = isl_pw_multi_aff_read_from_str(ctx, str);
+	str = "{ C[] -> D[] }";
+	pma2 = isl_pw_multi_aff_read_from_str(ctx, str);
+	pma1 = isl_pw_multi_aff_product(pma1, pma2);
+	str = "{ [A[i] -> C[]] -> [B[(1)] -> D[]] : i < 0;"
+		"[A[i] -> C[]] -> [B[(2)] -> D[]] : i >= 0 }";
+	equal = pw_multi_aff_check_plain_equal(pma1, str);
+	isl_pw_multi_aff_free(pma1);
+	if (equal < 0)
+		return -1;
 
-	isl_map_free(mm.must);
-	isl_map_free(mm.may);
-	isl_flow_free(flow);
+	return 0;
+}
 
+int test_product(isl_ctx *ctx)
+{
+	const char *str;
+	isl_set *set;
+	isl_union_set *uset1, *uset2;
+	int ok;
 
-	str = "{ [0,i,2] -> [i] : 0 <= i <= 10 }";
-	map = isl_map_read_from_str(ctx, str);
-	ai = isl_access_info_alloc(map, &depth, &common_space, 2);
+	str = "{ A[i] }";
+	set = isl_set_read_from_str(ctx, str);
+	set = isl_set_product(set, isl_set_copy(set));
+	ok = isl_set_is_wrapping(set);
+	isl_set_free(set);
+	if (ok < 0)
+		return -1;
+	if (!ok)
+		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
 
-	str = "{ [0,i,0] -> [i] : 0 <= i <= 10 }";
-	map = isl_map_read_from_str(ctx, str);
-	ai = isl_access_info_add_source(ai, map, 0, &depth);
+	str = "{ [] }";
+	uset1 = isl_union_set_read_from_str(ctx, str);
+	uset1 = isl_union_set_product(uset1, isl_union_set_copy(uset1));
+	str = "{ [[] -> []] }";
+	uset2 = isl_union_set_read_from_str(ctx, str);
+	ok = isl_union_set_is_equal(uset1, uset2);
+	isl_union_set_free(uset1);
+	isl_union_set_free(uset2);
+	if (ok < 0)
+		return -1;
+	if (!ok)
+		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
 
-	str = "{ [0,i,1] -> [5] : 0 <= i <= 10 }";
-	map = isl_map_read_from_str(ctx, str);
-	ai = isl_access_info_add_source(ai, map, 0, &depth);
+	if (test_product_pma(ctx) < 0)
+		return -1;
 
-	flow = isl_access_info_compute_flow(ai);
-	dim = isl_space_alloc(ctx, 0, 3, 3);
-	mm.must = isl_map_empty(isl_space_copy(dim));
-	mm.may = isl_map_empty(dim);
+	return 0;
+}
 
-	isl_flow_foreach(flow, collect_must_may, &mm);
+struct {
+	const char *set;
+	int count;
+} box_count_tests[] = {
+	{ "{ [i, j] : 0 <= i <= 9 and 0 <= j <= 9 }", 100 },
+	{ "{ [i, j] : 0 <= i <= 9 and 2j = 5 }", 0 },
+	{ "{ [i, j, k] : -3 <= 2i <= 3 and j = 4 and 0 <= k < 1000 }", 3000 },
+	{ "{ [i, j] : 0 <= i <= 9 and 5 <= j <= 4 }", 0 },
+	{ "{ [i, j] : (0 <= i <= 9 and 0 <= j <= 9) or "
+		"(5 <= i <= 14 and 5 <= j <= 14) }", 175 },
+};
 
-	str = "{ [0,i,0] -> [0,i,2] : 0 <= i <= 10; "
-	      "  [0,i,1] -> [0,5,2] : 0 <= i <= 5 }";
-	assert(map_is_equal(mm.may, str));
-	str = "{ [i,j,k] -> [l,m,n] : 1 = 0 }";
-	assert(map_is_equal(mm.must, str));
+struct {
+	const char *set1;
+	const char *set2;
+	int subset;
+} box_subset_tests[] = {
+	{ "{ [i, j] : 1 <= i <= 8 and j = 3 }",
+	  "{ [i, j] : 0 <= i <= 9 and 0 <= j }", 1 },
+	{ "{ [i, j] : 1 <= i <= 10 and j = 3 }",
+	  "{ [i, j] : 0 <= i <= 9 and 0 <= j }", 0 },
+	{ "{ [i, j] : 1 <= i and j = 3 }",
+	  "{ [i, j] : 0 <= i <= 9 }", 0 },
+	{ "{ [i, j] : 1 <= i <= 0 }", "{ [i, j] : i = 3 and j = 4 }", 1 },
+	{ "{ [i, j] : 0 <= 2i <= 1 }", "{ [i, j] : i = 0 }", 1 },
+};
 
-	isl_map_free(mm.must);
-	isl_map_free(mm.may);
-	isl_flow_free(flow);
+/* Check the results of counting points in and checking inclusion of
+ * box-shaped sets, which are computed without constructing any tableau.
+ */
+static int test_box(isl_ctx *ctx)
+{
+	int i;
 
+	for (i = 0; i < ARRAY_SIZE(box_count_tests); ++i) {
+		isl_set *set;
+		isl_val *v;
+		int ok;
 
-	str = "{ [0,i,1] -> [i] : 0 <= i <= 10 }";
-	map = isl_map_read_from_str(ctx, str);
-	ai = isl_access_info_alloc(map, &depth, &common_space, 2);
+		set = isl_set_read_from_str(ctx, box_count_tests[i].set);
+		v = isl_set_count_val(set);
+		isl_set_free(set);
+		if (!v)
+			return -1;
+		ok = isl_val_cmp_si(v, box_count_tests[i].count) == 0;
+		isl_val_free(v);
+		if (!ok)
+			isl_die(ctx, isl_error_unknown,
+				"incorrect number of points", return -1);
+	}
 
-	str = "{ [0,i,0] -> [i] : 0 <= i <= 10 }";
-	map = isl_map_read_from_str(ctx, str);
-	ai = isl_access_info_add_source(ai, map, 0, &depth);
+	for (i = 0; i < ARRAY_SIZE(box_subset_tests); ++i) {
+		isl_basic_set *bset1, *bset2;
+		int subset;
 
-	str = "{ [0,i,2] -> [5] : 0 <= i <= 10 }";
-	map = isl_map_read_from_str(ctx, str);
-	ai = isl_access_info_add_source(ai, map, 0, &depth);
+		bset1 = isl_basic_set_read_from_str(ctx,
+						box_subset_tests[i].set1);
+		bset2 = isl_basic_set_read_from_str(ctx,
+						box_subset_tests[i].set2);
+		subset = isl_basic_set_is_subset(bset1, bset2);
+		isl_basic_set_free(bset1);
+		isl_basic_set_free(bset2);
+		if (subset < 0)
+			return -1;
+		if (subset != box_subset_tests[i].subset)
+			isl_die(ctx, isl_error_unknown,
+				"incorrect subset result", return -1);
+	}
 
-	flow = isl_access_info_compute_flow(ai);
-	dim = isl_space_alloc(ctx, 0, 3, 3);
-	mm.must = isl_map_empty(isl_space_copy(dim));
-	mm.may = isl_map_empty(dim);
+	return 0;
+}
 
-	isl_flow_foreach(flow, collect_must_may, &mm);
+static int count_point(__isl_take isl_point *pnt, void *user)
+{
+	int *n = user;
 
-	str = "{ [0,i,0] -> [0,i,1] : 0 <= i <= 10; "
-	      "  [0,i,2] -> [0,5,1] : 0 <= i <= 4 }";
-	assert(map_is_equal(mm.may, str));
-	str = "{ [i,j,k] -> [l,m,n] : 1 = 0 }";
-	assert(map_is_equal(mm.must, str));
+	isl_point_free(pnt);
+	(*n)++;
+	return 0;
+}
 
-	isl_map_free(mm.must);
-	isl_map_free(mm.may);
-	isl_flow_free(flow);
+/* Sets for which the points are both enumerated and counted.
+ * The innermost dimension of these sets is skewed with respect
+ * to the outer dimensions, such that enumerating a line of points
+ * requires stepping along the other coordinates as well.
+ */
+const char *scan_tests[] = {
+	"{ [i, j] : 0 <= i <= 5 and i <= j <= 2i + 3 }",
+	"{ [i, j, k] : 0 <= i <= 3 and 0 <= j <= i and "
+		"i + j <= k <= 2i + 4 }",
+	"{ [i, j] : 0 <= i <= 7 and exists a : j = 3a + i and 0 <= a <= i }",
+	"{ [i] : 0 <= i <= 10 }",
+	"{ [i, j] : 0 <= i <= 3 and j = 2i }",
+	"{ [i, j, k] : 0 <= i, j <= 4 and i + j <= k <= 6 and "
+		"3i - 2j + k <= 7 }",
+	"{ [i, j, k] : i + j + k = 5 and 0 <= i, j, k }",
+	"{ [i, j] : 0 <= i <= 2 and 100000 i <= j <= 100000 i + 3 }",
+	"{ [i, j] : 0 <= i <= 2 and 0 <= j and "
+		"1099511627776 j <= 1099511627776 i + 2 }",
+	"{ [i, j] : 0 <= i <= 3 and 5 <= j <= i }",
+};
 
+struct isl_test_point_batch {
+	int n;
+	int64_t sum;
+};
 
-	depth = 5;
+static int count_point_batch(int64_t *points, int n, void *user)
+{
+	struct isl_test_point_batch *data = user;
+	int i;
 
-	str = "{ [1,i,0,0,0] -> [i,j] : 0 <= i <= 10 and 0 <= j <= 10 }";
-	map = isl_map_read_from_str(ctx, str);
-	ai = isl_access_info_alloc(map, &depth, &common_space, 1);
+	for (i = 0; i < n; ++i)
+		data->sum += points[2 * i] + points[2 * i + 1];
+	data->n += n;
+	return 0;
+}
 
-	str = "{ [0,i,0,j,0] -> [i,j] : 0 <= i <= 10 and 0 <= j <= 10 }";
-	map = isl_map_read_from_str(ctx, str);
-	ai = isl_access_info_add_source(ai, map, 1, &depth);
+/* Check that isl_set_foreach_point_batch enumerates the expected points,
+ * including when the last batch is only partially filled,
+ * and that it fails on coordinates that do not fit in 64 bits.
+ */
+static int test_scan_batch(isl_ctx *ctx)
+{
+	const char *str;
+	isl_set *set;
+	int64_t buffer[2 * 4];
+	struct isl_test_point_batch data = { 0, 0 };
+	int r;
 
-	flow = isl_access_info_compute_flow(ai);
-	dim = isl_space_alloc(ctx, 0, 5, 5);
-	mm.must = isl_map_empty(isl_space_copy(dim));
-	mm.may = isl_map_empty(dim);
+	str = "{ [i, j] : 0 <= i <= 3 and 0 <= j <= i }";
+	set = isl_set_read_from_str(ctx, str);
+	r = isl_set_foreach_point_batch(set, buffer, 4,
+					&count_point_batch, &data);
+	isl_set_free(set);
+	if (r < 0)
+		return -1;
+	if (data.n != 10 || data.sum != 30)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected batch of points", return -1);
 
-	isl_flow_foreach(flow, collect_must_may, &mm);
+	str = "{ [i, j] : i = 0 and j = 36893488147419103232 }";
+	set = isl_set_read_from_str(ctx, str);
+	r = isl_set_foreach_point_batch(set, buffer, 4,
+					&count_point_batch, &data);
+	isl_set_free(set);
+	if (r >= 0)
+		isl_die(ctx, isl_error_unknown,
+			"overflow not detected", return -1);
 
-	str = "{ [0,i,0,j,0] -> [1,i,0,0,0] : 0 <= i,j <= 10 }";
-	assert(map_is_equal(mm.must, str));
-	str = "{ [0,0,0,0,0] -> [0,0,0,0,0] : 1 = 0 }";
-	assert(map_is_equal(mm.may, str));
+	return 0;
+}
 
-	isl_map_free(mm.must);
-	isl_map_free(mm.may);
-	isl_flow_free(flow);
+/* Check whether isl_set_contains_point agrees with isl_set_is_subset
+ * on the point "pnt" and the set "user".
+ */
+static int check_contains_point(__isl_take isl_point *pnt, void *user)
+{
+	isl_set *set = user;
+	isl_set *pnt_set;
+	int contains, subset;
+
+	contains = isl_set_contains_point(set, pnt);
+	pnt_set = isl_set_from_point(pnt);
+	subset = isl_set_is_subset(pnt_set, set);
+	isl_set_free(pnt_set);
+	if (contains < 0 || subset < 0)
+		return -1;
+	if (contains != subset)
+		isl_die(isl_set_get_ctx(set), isl_error_unknown,
+			"unexpected result of isl_set_contains_point",
+			return -1);
+	return 0;
 }
 
-/* Check that the dependence analysis proceeds without errors.
- * Earlier versions of isl would break down during the analysis
- * due to the use of the wrong spaces.
+/* Check isl_set_contains_point on a set consisting of basic sets
+ * with different numbers of integer divisions.
  */
-static int test_flow(isl_ctx *ctx)
+static int test_contains_point(isl_ctx *ctx)
 {
-	const char *str;
-	isl_union_map *access, *schedule;
-	isl_union_map *must_dep, *may_dep;
+	isl_set *set, *box;
 	int r;
 
-	str = "{ S0[j] -> i[]; S1[j,i] -> i[]; S2[] -> i[]; S3[] -> i[] }";
-	access = isl_union_map_read_from_str(ctx, str);
-	str = "{ S0[j] -> [0,j,0,0] : 0 <= j < 10; "
-		"S1[j,i] -> [0,j,1,i] : 0 <= j < i < 10; "
-		"S2[] -> [1,0,0,0]; "
-		"S3[] -> [-1,0,0,0] }";
-	schedule = isl_union_map_read_from_str(ctx, str);
-	r = isl_union_map_compute_flow(access, isl_union_map_copy(access),
-					isl_union_map_copy(access), schedule,
-					&must_dep, &may_dep, NULL, NULL);
-	isl_union_map_free(may_dep);
-	isl_union_map_free(must_dep);
+	set = isl_set_read_from_str(ctx, "{ [i, j] : 0 <= i, j <= 10 and "
+		"((exists a : i = 3a) or (exists a, b : i = 5a + 1 and "
+		"j = 2b) or i = j) }");
+	box = isl_set_read_from_str(ctx, "{ [i, j] : -1 <= i, j <= 11 }");
+	r = isl_set_foreach_point(box, &check_contains_point, set);
+	isl_set_free(box);
+	isl_set_free(set);
 
 	return r;
 }
 
-struct {
-	const char *map;
-	int sv;
-} sv_tests[] = {
-	{ "[N] -> { [i] -> [f] : 0 <= i <= N and 0 <= i - 10 f <= 9 }", 1 },
-	{ "[N] -> { [i] -> [f] : 0 <= i <= N and 0 <= i - 10 f <= 10 }", 0 },
-	{ "{ [i] -> [3*floor(i/2) + 5*floor(i/3)] }", 1 },
-	{ "{ S1[i] -> [i] : 0 <= i <= 9; S2[i] -> [i] : 0 <= i <= 9 }", 1 },
-	{ "{ [i] -> S1[i] : 0 <= i <= 9; [i] -> S2[i] : 0 <= i <= 9 }", 0 },
-	{ "{ A[i] -> [i]; B[i] -> [i]; B[i] -> [i + 1] }", 0 },
-	{ "{ A[i] -> [i]; B[i] -> [i] : i < 0; B[i] -> [i + 1] : i > 0 }", 1 },
-	{ "{ A[i] -> [i]; B[i] -> A[i] : i < 0; B[i] -> [i + 1] : i > 0 }", 1 },
-	{ "{ A[i] -> [i]; B[i] -> [j] : i - 1 <= j <= i }", 0 },
-};
-
-int test_sv(isl_ctx *ctx)
+/* Check that enumerating the points of a set produces
+ * as many points as counting them.
+ */
+static int test_scan(isl_ctx *ctx)
 {
-	isl_union_map *umap;
 	int i;
-	int sv;
 
-	for (i = 0; i < ARRAY_SIZE(sv_tests); ++i) {
-		umap = isl_union_map_read_from_str(ctx, sv_tests[i].map);
-		sv = isl_union_map_is_single_valued(umap);
-		isl_union_map_free(umap);
-		if (sv < 0)
+	for (i = 0; i < ARRAY_SIZE(scan_tests); ++i) {
+		isl_set *set;
+		isl_val *v;
+		int n = 0;
+		int ok;
+
+		set = isl_set_read_from_str(ctx, scan_tests[i]);
+		if (isl_set_foreach_point(set, &count_point, &n) < 0)
+			set = isl_set_free(set);
+		v = isl_set_count_val(set);
+		isl_set_free(set);
+		if (!v)
 			return -1;
-		if (sv_tests[i].sv && !sv)
-			isl_die(ctx, isl_error_internal,
-				"map not detected as single valued", return -1);
-		if (!sv_tests[i].sv && sv)
-			isl_die(ctx, isl_error_internal,
-				"map detected as single valued", return -1);
+		ok = isl_val_cmp_si(v, n) == 0;
+		isl_val_free(v);
+		if (!ok)
+			isl_die(ctx, isl_error_unknown,
+				"enumerated and counted points differ",
+				return -1);
 	}
 
+	if (test_scan_batch(ctx) < 0)
+		return -1;
+	if (test_contains_point(ctx) < 0)
+		return -1;
+
 	return 0;
 }
 
-void test_bijective_case(struct isl_ctx *ctx, const char *str, int bijective)
-{
-	isl_map *map;
+struct {
+	const char *set;
+	const char *card;
+} card_tests[] = {
+	{ "[N] -> { [i, j] : 0 <= i <= N and 0 <= j <= i }",
+	  "[N] -> { (1 + 3/2 * N + 1/2 * N^2) : N >= 0 }" },
+	{ "[N] -> { [i] : 0 <= i <= N and exists a : i = 3a }",
+	  "[N] -> { (1 + floor(N/3)) : N >= 0 }" },
+	{ "[N] -> { [i, j] : 0 <= i <= N and i = 2j }",
+	  "[N] -> { (1 + floor(N/2)) : N >= 0 }" },
+	{ "[N] -> { [i] : N <= i <= N - 1 }", "[N] -> { 0 }" },
+};
 
-	map = isl_map_read_from_str(ctx, str);
-	if (bijective)
-		assert(isl_map_is_bijective(map));
-	else
-		assert(!isl_map_is_bijective(map));
-	isl_map_free(map);
-}
+/* Sets for which the result of isl_set_card is compared to
+ * the result of isl_set_count_val for the parameter values
+ * in the range from -2 to 10.
+ */
+const char *card_count_tests[] = {
+	"[N] -> { [i, j, k] : 0 <= i <= N and 0 <= j <= N and 0 <= k <= N and "
+		"i + j + k <= N and 2k <= i + j }",
+	"[N] -> { [i, j] : 0 <= 7i <= 3N + 2 and 2i <= 5j <= N + 3i }",
+	"[N] -> { [i, j] : 0 <= i <= N and 0 <= j <= N and "
+		"(i >= 5 or j >= 5) }",
+	"[N] -> { [i, j] : 0 <= i <= N and j = floor(i/2) + floor(i/3) }",
+	"[N] -> { [i, j] : -1 <= i <= 6 and 0 <= j <= 6 and "
+		"2i - 3j <= 2N + 1 and exists a : j = 3a + 1 }",
+};
 
-void test_bijective(struct isl_ctx *ctx)
+/* Check that the number of points in each set of card_count_tests
+ * computed by isl_set_card is the same as the number of points
+ * computed by isl_set_count_val for a range of parameter values.
+ */
+static int test_card_count(isl_ctx *ctx)
 {
-	test_bijective_case(ctx, "[N,M]->{[i,j] -> [i]}", 0);
-	test_bijective_case(ctx, "[N,M]->{[i,j] -> [i] : j=i}", 1);
-	test_bijective_case(ctx, "[N,M]->{[i,j] -> [i] : j=0}", 1);
-	test_bijective_case(ctx, "[N,M]->{[i,j] -> [i] : j=N}", 1);
-	test_bijective_case(ctx, "[N,M]->{[i,j] -> [j,i]}", 1);
-	test_bijective_case(ctx, "[N,M]->{[i,j] -> [i+j]}", 0);
-	test_bijective_case(ctx, "[N,M]->{[i,j] -> []}", 0);
-	test_bijective_case(ctx, "[N,M]->{[i,j] -> [i,j,N]}", 1);
-	test_bijective_case(ctx, "[N,M]->{[i,j] -> [2i]}", 0);
-	test_bijective_case(ctx, "[N,M]->{[i,j] -> [i,i]}", 0);
-	test_bijective_case(ctx, "[N,M]->{[i,j] -> [2i,i]}", 0);
-	test_bijective_case(ctx, "[N,M]->{[i,j] -> [2i,j]}", 1);
-	test_bijective_case(ctx, "[N,M]->{[i,j] -> [x,y] : 2x=i & y =j}", 1);
+	int i, n;
+
+	for (i = 0; i < ARRAY_SIZE(card_count_tests); ++i) {
+		isl_set *set;
+		isl_pw_qpolynomial *card;
+		int ok = 1;
+
+		set = isl_set_read_from_str(ctx, card_count_tests[i]);
+		card = isl_set_card(isl_set_copy(set));
+		for (n = -2; ok && n <= 10; ++n) {
+			isl_point *pnt;
+			isl_set *set_n;
+			isl_val *v, *count;
+
+			pnt = isl_point_zero(
+				isl_pw_qpolynomial_get_domain_space(card));
+			pnt = isl_point_set_coordinate_val(pnt, isl_dim_param,
+					0, isl_val_int_from_si(ctx, n));
+			v = isl_pw_qpolynomial_eval(
+				isl_pw_qpolynomial_copy(card), pnt);
+			set_n = isl_set_fix_si(isl_set_copy(set),
+						isl_dim_param, 0, n);
+			count = isl_set_count_val(set_n);
+			isl_set_free(set_n);
+			ok = v && count ? isl_val_eq(v, count) : -1;
+			isl_val_free(v);
+			isl_val_free(count);
+		}
+		isl_pw_qpolynomial_free(card);
+		isl_set_free(set);
+		if (ok < 0)
+			return -1;
+		if (!ok)
+			isl_die(ctx, isl_error_unknown,
+				"card and count differ", return -1);
+	}
+
+	return 0;
 }
 
-/* Inputs for isl_pw_qpolynomial_gist tests.
- * "pwqp" is the input, "set" is the context and "gist" is the expected result.
+/* Check that the points of sets that can be factored
+ * are counted correctly, also when counting up to a maximum,
+ * and that sample points of such sets are found,
+ * also if the factors are unbounded.
  */
-struct {
-	const char *pwqp;
-	const char *set;
-	const char *gist;
-} pwqp_gist_tests[] = {
-	{ "{ [i] -> i }", "{ [k] : exists a : k = 2a }", "{ [i] -> i }" },
-	{ "{ [i] -> i + [ (i + [i/3])/2 ] }", "{ [10] }", "{ [i] -> 16 }" },
-	{ "{ [i] -> ([(i)/2]) }", "{ [k] : exists a : k = 2a+1 }",
-	  "{ [i] -> -1/2 + 1/2 * i }" },
-	{ "{ [i] -> i^2 : i != 0 }", "{ [i] : i != 0 }", "{ [i] -> i^2 }" },
-};
-
-static int test_pwqp(struct isl_ctx *ctx)
+static int test_count_factors(isl_ctx *ctx)
 {
-	int i;
 	const char *str;
 	isl_set *set;
-	isl_pw_qpolynomial *pwqp1, *pwqp2;
-	int equal;
+	isl_set *sample;
+	isl_basic_set *bset;
+	isl_val *v;
+	isl_int max, count;
+	int ok, empty;
 
-	str = "{ [i,j,k] -> 1 + 9 * [i/5] + 7 * [j/11] + 4 * [k/13] }";
-	pwqp1 = isl_pw_qpolynomial_read_from_str(ctx, str);
+	str = "{ [i, j, k, l] : 0 <= i <= j <= 50 and 0 <= k <= l <= 60 and "
+		"k + l <= 100 }";
+	set = isl_set_read_from_str(ctx, str);
+	v = isl_set_count_val(set);
+	ok = v ? isl_val_cmp_si(v, 1326 * 1781) == 0 : -1;
+	isl_val_free(v);
+
+	isl_int_init(max);
+	isl_int_init(count);
+	isl_int_set_si(max, 2000);
+	if (ok > 0 && isl_set_count_upto(set, max, &count) < 0)
+		ok = -1;
+	if (ok > 0)
+		ok = isl_int_cmp_si(count, 2000) == 0;
+	isl_int_clear(max);
+	isl_int_clear(count);
+	isl_set_free(set);
 
-	pwqp1 = isl_pw_qpolynomial_move_dims(pwqp1, isl_dim_param, 0,
-						isl_dim_in, 1, 1);
+	if (ok < 0)
+		return -1;
+	if (!ok)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of points", return -1);
 
-	str = "[j] -> { [i,k] -> 1 + 9 * [i/5] + 7 * [j/11] + 4 * [k/13] }";
-	pwqp2 = isl_pw_qpolynomial_read_from_str(ctx, str);
+	str = "{ [i, j, k] : i >= 0 and 2j <= 3i and j >= 7 and "
+		"3 <= 2k <= 9 }";
+	bset = isl_basic_set_read_from_str(ctx, str);
+	empty = isl_basic_set_is_empty(bset);
+	set = isl_set_from_basic_set(isl_basic_set_copy(bset));
+	sample = isl_set_from_basic_set(isl_basic_set_sample(bset));
+	ok = isl_set_is_subset(sample, set);
+	isl_set_free(sample);
+	isl_set_free(set);
 
-	pwqp1 = isl_pw_qpolynomial_sub(pwqp1, pwqp2);
+	if (empty < 0 || ok < 0)
+		return -1;
+	if (empty || !ok)
+		isl_die(ctx, isl_error_unknown,
+			"invalid sample of factored set", return -1);
 
-	assert(isl_pw_qpolynomial_is_zero(pwqp1));
+	str = "{ [i, j, k] : i >= 0 and 2j <= 3i and j >= 7 and 2k = 7 }";
+	bset = isl_basic_set_read_from_str(ctx, str);
+	empty = isl_basic_set_is_empty(bset);
+	isl_basic_set_free(bset);
+	if (empty < 0)
+		return -1;
+	if (!empty)
+		isl_die(ctx, isl_error_unknown,
+			"factored set should be empty", return -1);
 
-	isl_pw_qpolynomial_free(pwqp1);
+	return 0;
+}
 
-	for (i = 0; i < ARRAY_SIZE(pwqp_gist_tests); ++i) {
-		str = pwqp_gist_tests[i].pwqp;
-		pwqp1 = isl_pw_qpolynomial_read_from_str(ctx, str);
-		str = pwqp_gist_tests[i].set;
-		set = isl_set_read_from_str(ctx, str);
-		pwqp1 = isl_pw_qpolynomial_gist(pwqp1, set);
-		str = pwqp_gist_tests[i].gist;
-		pwqp2 = isl_pw_qpolynomial_read_from_str(ctx, str);
-		pwqp1 = isl_pw_qpolynomial_sub(pwqp1, pwqp2);
-		equal = isl_pw_qpolynomial_is_zero(pwqp1);
-		isl_pw_qpolynomial_free(pwqp1);
+/* Small sets, the points of which are counted directly by scan_fm,
+ * possibly without solving any LP, along with their number of points.
+ */
+struct {
+	const char *set;
+	int count;
+} count_small_tests[] = {
+	{ "{ [5] }", 1 },
+	{ "{ [i, j] : i = 2j and 0 <= i <= 10 }", 6 },
+	{ "{ [i] : exists a : i = 3a and 0 <= i <= 7 }", 3 },
+	{ "{ [i, j, k] : i + j + k = 3 and i, j, k >= 0 }", 10 },
+	{ "{ [i] : 0 <= 2i <= 5 }", 3 },
+	{ "{ [i, j] : 0 <= i - j <= 2 and 0 <= i + j <= 4 }", 8 },
+	{ "{ [i, j] : 0 <= i <= 100 and 0 <= j <= i }", 5151 },
+	{ "{ [i, j] : 0 <= i, j <= 3 and (i = j or i + j = 3) }", 8 },
+	{ "{ [i, j] : j = floor(i/3) and 0 <= i <= 8 }", 9 },
+	{ "{ [i] : 0 <= i <= 5 and i >= 7 }", 0 },
+};
 
-		if (equal < 0)
-			return -1;
-		if (!equal)
-			isl_die(ctx, isl_error_unknown,
-				"unexpected result", return -1);
+/* Check that the points of the sets in count_small_tests
+ * are counted correctly, also when counting up to a maximum.
+ */
+static int test_count_small(isl_ctx *ctx)
+{
+	int i;
+	isl_int max, count;
+	int ok = 1;
+
+	isl_int_init(max);
+	isl_int_init(count);
+	isl_int_set_si(max, 5);
+	for (i = 0; ok > 0 && i < ARRAY_SIZE(count_small_tests); ++i) {
+		isl_set *set;
+		isl_val *v;
+		int n = count_small_tests[i].count;
+
+		set = isl_set_read_from_str(ctx, count_small_tests[i].set);
+		v = isl_set_count_val(set);
+		ok = v ? isl_val_cmp_si(v, n) == 0 : -1;
+		isl_val_free(v);
+		if (ok > 0 && isl_set_count_upto(set, max, &count) < 0)
+			ok = -1;
+		if (ok > 0)
+			ok = isl_int_cmp_si(count, n < 5 ? n : 5) == 0;
+		isl_set_free(set);
 	}
+	isl_int_clear(max);
+	isl_int_clear(count);
 
-	str = "{ [i] -> ([([i/2] + [i/2])/5]) }";
-	pwqp1 = isl_pw_qpolynomial_read_from_str(ctx, str);
-	str = "{ [i] -> ([(2 * [i/2])/5]) }";
-	pwqp2 = isl_pw_qpolynomial_read_from_str(ctx, str);
-
-	pwqp1 = isl_pw_qpolynomial_sub(pwqp1, pwqp2);
+	if (ok < 0)
+		return -1;
+	if (!ok)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of points", return -1);
 
-	assert(isl_pw_qpolynomial_is_zero(pwqp1));
+	return 0;
+}
 
-	isl_pw_qpolynomial_free(pwqp1);
+/* Sets the points of which are counted by test_count_threads.
+ */
+const char *count_threads_tests[] = {
+	"{ [i, j] : 0 <= i <= 100 and 0 <= j <= i }",
+	"{ [i] : exists a : i = 3a and 0 <= i <= 200 }",
+	"{ [i, j, k] : 0 <= i, j, k <= 20 and i + j + k <= 30; "
+		"[i, j, k] : 10 <= i <= 40 and 0 <= j, k <= 2 }",
+	"{ [i, j] : j = floor(i/3) and 0 <= i <= 8 }",
+	"{ [5, j] : 0 <= j <= 3 }",
+	"{ [i, j, k, l] : 0 <= i <= 30 and 0 <= j <= i and "
+		"0 <= k <= 40 and 0 <= l <= 2k }",
+	"{ [i, j, k, l] : 0 <= i <= 30 and 0 <= j <= i and "
+		"0 <= k <= 40 and 0 <= l <= 2k; [i, j, k, l] : i > 40 and "
+		"0 <= i, j, k, l <= 50 and j + k + l <= i }",
+	"{ [i] : 0 <= i <= 5 and i >= 7 }",
+	"{ [] }",
+};
 
-	str = "{ [x] -> ([x/2] + [(x+1)/2]) }";
-	pwqp1 = isl_pw_qpolynomial_read_from_str(ctx, str);
-	str = "{ [x] -> x }";
-	pwqp2 = isl_pw_qpolynomial_read_from_str(ctx, str);
+/* Check that the points of the sets in count_threads_tests
+ * are counted in the same way, also when counting up to a maximum,
+ * independently of whether the counting is split over several threads.
+ */
+static int test_count_threads(isl_ctx *ctx)
+{
+	int i, j;
+	int n_thread;
+	isl_int max, count[2];
+	int ok = 1;
+
+	n_thread = isl_options_get_threads(ctx);
+	isl_int_init(max);
+	isl_int_init(count[0]);
+	isl_int_init(count[1]);
+	for (i = 0; ok > 0 && i < ARRAY_SIZE(count_threads_tests); ++i) {
+		isl_set *set;
+		isl_val *v[2];
+
+		set = isl_set_read_from_str(ctx, count_threads_tests[i]);
+		for (j = 0; j < 2; ++j) {
+			isl_options_set_threads(ctx, j == 0 ? 1 : 3);
+			v[j] = isl_set_count_val(set);
+			isl_int_set_si(max, 100);
+			if (isl_set_count_upto(set, max, &count[j]) < 0)
+				ok = -1;
+		}
+		isl_options_set_threads(ctx, n_thread);
+		if (!v[0] || !v[1])
+			ok = -1;
+		if (ok > 0)
+			ok = isl_val_eq(v[0], v[1]);
+		if (ok > 0)
+			ok = isl_int_eq(count[0], count[1]);
+		isl_val_free(v[0]);
+		isl_val_free(v[1]);
+		isl_set_free(set);
+	}
+	isl_int_clear(max);
+	isl_int_clear(count[0]);
+	isl_int_clear(count[1]);
 
-	pwqp1 = isl_pw_qpolynomial_sub(pwqp1, pwqp2);
+	if (ok < 0)
+		return -1;
+	if (!ok)
+		isl_die(ctx, isl_error_unknown,
+			"number of points depends on number of threads",
+			return -1);
 
-	assert(isl_pw_qpolynomial_is_zero(pwqp1));
+	return 0;
+}
 
-	isl_pw_qpolynomial_free(pwqp1);
+/* Check that counting the points of a set with equalities twice
+ * reuses the compressions computed the first time and
+ * that the result is the same as without compression cache.
+ */
+static int test_card_compression_cache(isl_ctx *ctx)
+{
+	const char *str;
+	isl_set *set;
+	isl_pw_qpolynomial *card1, *card2, *card3;
+	long hits;
+	int size, equal;
 
-	str = "{ [i] -> ([i/2]) : i >= 0; [i] -> ([i/3]) : i < 0 }";
-	pwqp1 = isl_pw_qpolynomial_read_from_str(ctx, str);
-	pwqp2 = isl_pw_qpolynomial_read_from_str(ctx, str);
-	pwqp1 = isl_pw_qpolynomial_coalesce(pwqp1);
-	pwqp1 = isl_pw_qpolynomial_sub(pwqp1, pwqp2);
-	assert(isl_pw_qpolynomial_is_zero(pwqp1));
-	isl_pw_qpolynomial_free(pwqp1);
+	str = "[N] -> { [i, j, k] : i = 2j + N and k = 3i and 0 <= j <= N }";
+	set = isl_set_read_from_str(ctx, str);
+	size = isl_options_get_compression_cache_size(ctx);
+	isl_options_set_compression_cache_size(ctx, 0);
+	card1 = isl_set_card(isl_set_copy(set));
+	isl_options_set_compression_cache_size(ctx, size);
+	card2 = isl_set_card(isl_set_copy(set));
+	hits = isl_ctx_get_stat(ctx, "compression_cache_hits");
+	card3 = isl_set_card(set);
+	card2 = isl_pw_qpolynomial_sub(card2, isl_pw_qpolynomial_copy(card1));
+	card3 = isl_pw_qpolynomial_sub(card3, card1);
+	equal = isl_pw_qpolynomial_is_zero(card2);
+	if (equal > 0)
+		equal = isl_pw_qpolynomial_is_zero(card3);
+	isl_pw_qpolynomial_free(card2);
+	isl_pw_qpolynomial_free(card3);
 
-	str = "{ [a,b,a] -> (([(2*[a/3]+b)/5]) * ([(2*[a/3]+b)/5])) }";
-	pwqp2 = isl_pw_qpolynomial_read_from_str(ctx, str);
-	str = "{ [a,b,c] -> (([(2*[a/3]+b)/5]) * ([(2*[c/3]+b)/5])) }";
-	pwqp1 = isl_pw_qpolynomial_read_from_str(ctx, str);
-	set = isl_set_read_from_str(ctx, "{ [a,b,a] }");
-	pwqp1 = isl_pw_qpolynomial_intersect_domain(pwqp1, set);
-	equal = isl_pw_qpolynomial_plain_is_equal(pwqp1, pwqp2);
-	isl_pw_qpolynomial_free(pwqp1);
-	isl_pw_qpolynomial_free(pwqp2);
 	if (equal < 0)
 		return -1;
 	if (!equal)
-		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+		isl_die(ctx, isl_error_unknown,
+			"compression cache changes result", return -1);
+	if (isl_ctx_get_stat(ctx, "compression_cache_hits") <= hits)
+		isl_die(ctx, isl_error_unknown,
+			"compressions not reused", return -1);
 
-	str = "{ [a,b,c] -> (([(2*[a/3]+1)/5]) * ([(2*[c/3]+1)/5])) : b = 1 }";
-	pwqp2 = isl_pw_qpolynomial_read_from_str(ctx, str);
-	str = "{ [a,b,c] -> (([(2*[a/3]+b)/5]) * ([(2*[c/3]+b)/5])) }";
-	pwqp1 = isl_pw_qpolynomial_read_from_str(ctx, str);
-	pwqp1 = isl_pw_qpolynomial_fix_val(pwqp1, isl_dim_set, 1,
-						isl_val_one(ctx));
-	equal = isl_pw_qpolynomial_plain_is_equal(pwqp1, pwqp2);
-	isl_pw_qpolynomial_free(pwqp1);
-	isl_pw_qpolynomial_free(pwqp2);
-	if (equal < 0)
+	return 0;
+}
+
+/* Check the results of counting the points of parametric sets.
+ */
+static int test_card(isl_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(card_tests); ++i) {
+		isl_set *set;
+		isl_pw_qpolynomial *card, *expected;
+		int equal;
+
+		set = isl_set_read_from_str(ctx, card_tests[i].set);
+		card = isl_set_card(set);
+		expected = isl_pw_qpolynomial_read_from_str(ctx,
+							card_tests[i].card);
+		card = isl_pw_qpolynomial_sub(card, expected);
+		equal = isl_pw_qpolynomial_is_zero(card);
+		isl_pw_qpolynomial_free(card);
+		if (equal < 0)
+			return -1;
+		if (!equal)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected number of points", return -1);
+	}
+
+	if (test_card_count(ctx) < 0)
+		return -1;
+	if (test_count_factors(ctx) < 0)
+		return -1;
+	if (test_count_small(ctx) < 0)
+		return -1;
+	if (test_count_threads(ctx) < 0)
+		return -1;
+	if (test_card_compression_cache(ctx) < 0)
 		return -1;
-	if (!equal)
-		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
 
 	return 0;
 }
 
-void test_split_periods(isl_ctx *ctx)
+/* Piecewise quasi-polynomials that are compiled by test_compile.
+ */
+const char *compile_tests[] = {
+	"[N] -> { [i] -> i^2 + N : 0 <= i <= N }",
+	"[N] -> { [i] -> floor((i + N)/3) * i : 0 <= i <= N; "
+		"[i] -> 1/2 * i : i < 0 and i >= -N }",
+	"[N] -> { [i, j] -> floor(i/2) + floor((j + floor(i/2))/3) : "
+		"exists (a : i = 2a and 0 <= j <= N) }",
+	"{ [i, j] -> 7 * i * j^2 - 1/3 : i >= 0 and j >= 0 and i + j <= 4 }",
+	"[N] -> { [i] -> i : i <= -2; [i] -> 2 : i = -1; "
+		"[i] -> i^2 : 0 <= i <= 2; [i] -> N : 3 <= i <= 4 and N >= 0; "
+		"[i] -> -N : 3 <= i <= 4 and N < 0; [i] -> i + N : i >= 5 }",
+};
+
+/* Evaluate "pwqp" at the integer point "coord" of dimension "n"
+ * using isl_pw_qpolynomial_eval.
+ */
+static double eval_at(__isl_keep isl_pw_qpolynomial *pwqp, int n, int *coord)
 {
-	const char *str;
+	int i, nparam;
+	isl_space *space;
+	isl_point *pnt;
+	isl_val *v;
+	double d;
+
+	space = isl_pw_qpolynomial_get_domain_space(pwqp);
+	nparam = isl_space_dim(space, isl_dim_param);
+	pnt = isl_point_zero(space);
+	for (i = 0; i < n; ++i) {
+		enum isl_dim_type type;
+		int pos;
+
+		type = i < nparam ? isl_dim_param : isl_dim_set;
+		pos = i < nparam ? i : i - nparam;
+		v = isl_val_int_from_si(isl_pw_qpolynomial_get_ctx(pwqp),
+					coord[i]);
+		pnt = isl_point_set_coordinate_val(pnt, type, pos, v);
+	}
+	v = isl_pw_qpolynomial_eval(isl_pw_qpolynomial_copy(pwqp), pnt);
+	d = isl_val_get_d(v);
+	isl_val_free(v);
+
+	return d;
+}
+
+/* Check that evaluating the compiled version of the piecewise
+ * quasi-polynomial described by "str" on all points in a box produces
+ * the same result as evaluating the original piecewise quasi-polynomial,
+ * for both the int64_t and the double interface.
+ */
+static int test_compile_one(isl_ctx *ctx, const char *str)
+{
+	int j, k;
+	int lo = -3, hi = 6;
 	isl_pw_qpolynomial *pwqp;
+	isl_pw_qpolynomial_compiled *c;
+	int n, n_pnt, coord[3];
+	int64_t points[1000 * 3];
+	double dpoints[1000 * 3];
+	double values[1000], dvalues[1000];
 
-	str = "{ [U,V] -> 1/3 * U + 2/3 * V - [(U + 2V)/3] + [U/2] : "
-		"U + 2V + 3 >= 0 and - U -2V  >= 0 and - U + 10 >= 0 and "
-		"U  >= 0; [U,V] -> U^2 : U >= 100 }";
 	pwqp = isl_pw_qpolynomial_read_from_str(ctx, str);
+	c = isl_pw_qpolynomial_compile(pwqp);
+	if (!c)
+		goto error;
+	n = isl_pw_qpolynomial_compiled_dim(c);
+	if (n > 3)
+		isl_die(ctx, isl_error_internal,
+			"too many dimensions", goto error);
+
+	n_pnt = 1;
+	for (j = 0; j < n; ++j) {
+		n_pnt *= hi - lo + 1;
+		coord[j] = lo;
+	}
+	for (j = 0; j < n_pnt; ++j) {
+		for (k = 0; k < n; ++k) {
+			points[j * n + k] = coord[k];
+			dpoints[j * n + k] = coord[k];
+		}
+		for (k = n - 1; k >= 0 && coord[k] == hi; --k)
+			coord[k] = lo;
+		if (k >= 0)
+			coord[k]++;
+	}
+	if (isl_pw_qpolynomial_compiled_eval_int64(c, n_pnt,
+						points, values) < 0)
+		goto error;
+	if (isl_pw_qpolynomial_compiled_eval_double(c, n_pnt,
+						dpoints, dvalues) < 0)
+		goto error;
 
-	pwqp = isl_pw_qpolynomial_split_periods(pwqp, 2);
-	assert(pwqp);
+	for (j = 0; j < n_pnt; ++j) {
+		double d;
+
+		for (k = 0; k < n; ++k)
+			coord[k] = points[j * n + k];
+		d = eval_at(pwqp, n, coord);
+		if (values[j] - d > 1e-9 || d - values[j] > 1e-9 ||
+		    dvalues[j] != values[j])
+			isl_die(ctx, isl_error_unknown,
+				"unexpected value", goto error);
+	}
 
+	isl_pw_qpolynomial_compiled_free(c);
 	isl_pw_qpolynomial_free(pwqp);
+	return 0;
+error:
+	isl_pw_qpolynomial_compiled_free(c);
+	isl_pw_qpolynomial_free(pwqp);
+	return -1;
 }
 
-void test_union(isl_ctx *ctx)
+/* Piecewise multi-affine expressions that are compiled
+ * by test_compile_pma.
+ */
+const char *compile_pma_tests[] = {
+	"[N] -> { [i] -> [floor(i/3) + N, i - 2] : 0 <= i <= N }",
+	"{ [i, j] -> [i + floor((j + 1)/2)] : i >= 0; "
+		"[i, j] -> [-i] : i < 0 and j >= i }",
+	"[N] -> { [i] -> [(i)/2] : exists (a : i = 2a) and i <= N }",
+	"{ [i, j] -> [0, i] : i < 0 and j < 0; [i, j] -> [1, j] : i >= 0 and j < 0; "
+		"[i, j] -> [2, i + j] : i < 0 and j >= 0; "
+		"[i, j] -> [i + j, 3] : 0 <= i <= 2 and j >= 0; "
+		"[i, j] -> [i - j, 4] : i >= 3 and 0 <= j <= 2 }",
+};
+
+/* Check that the image of the point "coord" of dimension "n_in"
+ * under "pma" is equal to the point "out" if "defined" is set
+ * and that it is empty otherwise.
+ */
+static int check_pma_at(__isl_keep isl_pw_multi_aff *pma, int n_in,
+	int *coord, int64_t *out, int defined)
 {
-	const char *str;
-	isl_union_set *uset1, *uset2;
-	isl_union_map *umap1, *umap2;
+	int i, nparam, n_out, equal;
+	isl_ctx *ctx;
+	isl_space *space;
+	isl_point *pnt;
+	isl_set *image, *expected;
 
-	str = "{ [i] : 0 <= i <= 1 }";
-	uset1 = isl_union_set_read_from_str(ctx, str);
-	str = "{ [1] -> [0] }";
-	umap1 = isl_union_map_read_from_str(ctx, str);
+	ctx = isl_pw_multi_aff_get_ctx(pma);
+	nparam = isl_pw_multi_aff_dim(pma, isl_dim_param);
+	n_out = isl_pw_multi_aff_dim(pma, isl_dim_out);
+	space = isl_space_domain(isl_pw_multi_aff_get_space(pma));
+	pnt = isl_point_zero(space);
+	for (i = 0; i < n_in; ++i) {
+		enum isl_dim_type type;
+		int pos;
+
+		type = i < nparam ? isl_dim_param : isl_dim_set;
+		pos = i < nparam ? i : i - nparam;
+		pnt = isl_point_set_coordinate_val(pnt, type, pos,
+					isl_val_int_from_si(ctx, coord[i]));
+	}
+	image = isl_set_apply(isl_set_from_point(pnt),
+		    isl_map_from_pw_multi_aff(isl_pw_multi_aff_copy(pma)));
+	if (!defined) {
+		equal = isl_set_is_empty(image);
+		isl_set_free(image);
+		return equal;
+	}
 
-	umap2 = isl_union_set_lex_gt_union_set(isl_union_set_copy(uset1), uset1);
-	assert(isl_union_map_is_equal(umap1, umap2));
+	pnt = isl_point_zero(isl_set_get_space(image));
+	for (i = 0; i < nparam; ++i)
+		pnt = isl_point_set_coordinate_val(pnt, isl_dim_param, i,
+					isl_val_int_from_si(ctx, coord[i]));
+	for (i = 0; i < n_out; ++i)
+		pnt = isl_point_set_coordinate_val(pnt, isl_dim_set, i,
+					isl_val_int_from_si(ctx, out[i]));
+	expected = isl_set_from_point(pnt);
+	equal = isl_set_is_equal(image, expected);
+	isl_set_free(image);
+	isl_set_free(expected);
 
-	isl_union_map_free(umap1);
-	isl_union_map_free(umap2);
+	return equal;
+}
 
-	str = "{ A[i] -> B[i]; B[i] -> C[i]; A[0] -> C[1] }";
-	umap1 = isl_union_map_read_from_str(ctx, str);
-	str = "{ A[i]; B[i] }";
-	uset1 = isl_union_set_read_from_str(ctx, str);
+/* Check that evaluating the compiled version of the piecewise
+ * multi-affine expression described by "str" on all points in a box
+ * produces the same results as applying the original expression.
+ */
+static int test_compile_pma_one(isl_ctx *ctx, const char *str)
+{
+	int j, k;
+	int lo = -3, hi = 6;
+	isl_pw_multi_aff *pma;
+	isl_pw_multi_aff_compiled *c;
+	int n_in, n_out, n_pnt, coord[3];
+	int64_t points[1000 * 3];
+	int64_t values[1000 * 2];
+	int defined[1000];
+
+	pma = isl_pw_multi_aff_read_from_str(ctx, str);
+	c = isl_pw_multi_aff_compile(pma);
+	if (!c)
+		goto error;
+	n_in = isl_pw_multi_aff_compiled_dim(c, isl_dim_in);
+	n_out = isl_pw_multi_aff_compiled_dim(c, isl_dim_out);
+	if (n_in > 3 || n_out > 2)
+		isl_die(ctx, isl_error_internal,
+			"too many dimensions", goto error);
+
+	n_pnt = 1;
+	for (j = 0; j < n_in; ++j) {
+		n_pnt *= hi - lo + 1;
+		coord[j] = lo;
+	}
+	for (j = 0; j < n_pnt; ++j) {
+		for (k = 0; k < n_in; ++k)
+			points[j * n_in + k] = coord[k];
+		for (k = n_in - 1; k >= 0 && coord[k] == hi; --k)
+			coord[k] = lo;
+		if (k >= 0)
+			coord[k]++;
+	}
+	if (isl_pw_multi_aff_compiled_eval(c, n_pnt, points, values,
+						defined) < 0)
+		goto error;
 
-	uset2 = isl_union_map_domain(umap1);
+	for (j = 0; j < n_pnt; ++j) {
+		int ok;
 
-	assert(isl_union_set_is_equal(uset1, uset2));
+		for (k = 0; k < n_in; ++k)
+			coord[k] = points[j * n_in + k];
+		ok = check_pma_at(pma, n_in, coord, values + j * n_out,
+				    defined[j]);
+		if (ok < 0)
+			goto error;
+		if (!ok)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected value", goto error);
+	}
 
-	isl_union_set_free(uset1);
-	isl_union_set_free(uset2);
+	isl_pw_multi_aff_compiled_free(c);
+	isl_pw_multi_aff_free(pma);
+	return 0;
+error:
+	isl_pw_multi_aff_compiled_free(c);
+	isl_pw_multi_aff_free(pma);
+	return -1;
 }
 
-void test_bound(isl_ctx *ctx)
+/* Check that evaluating compiled piecewise multi-affine expressions
+ * produces the expected results and that overflows and points
+ * outside the domain are reported as errors.
+ */
+static int test_compile_pma(isl_ctx *ctx)
 {
-	const char *str;
-	isl_pw_qpolynomial *pwqp;
-	isl_pw_qpolynomial_fold *pwf;
-
-	str = "{ [[a, b, c, d] -> [e]] -> 0 }";
-	pwqp = isl_pw_qpolynomial_read_from_str(ctx, str);
-	pwf = isl_pw_qpolynomial_bound(pwqp, isl_fold_max, NULL);
-	assert(isl_pw_qpolynomial_fold_dim(pwf, isl_dim_in) == 4);
-	isl_pw_qpolynomial_fold_free(pwf);
+	int i, r1, r2;
+	int on_error;
+	isl_pw_multi_aff *pma;
+	isl_pw_multi_aff_compiled *c;
+	int64_t point, value;
 
-	str = "{ [[x]->[x]] -> 1 : exists a : x = 2 a }";
-	pwqp = isl_pw_qpolynomial_read_from_str(ctx, str);
-	pwf = isl_pw_qpolynomial_bound(pwqp, isl_fold_max, NULL);
-	assert(isl_pw_qpolynomial_fold_dim(pwf, isl_dim_in) == 1);
-	isl_pw_qpolynomial_fold_free(pwf);
-}
+	for (i = 0; i < ARRAY_SIZE(compile_pma_tests); ++i)
+		if (test_compile_pma_one(ctx, compile_pma_tests[i]) < 0)
+			return -1;
 
-void test_lift(isl_ctx *ctx)
-{
-	const char *str;
-	isl_basic_map *bmap;
-	isl_basic_set *bset;
+	pma = isl_pw_multi_aff_read_from_str(ctx, "{ [i] -> [4i] : i >= 0 }");
+	c = isl_pw_multi_aff_compile(pma);
+	isl_pw_multi_aff_free(pma);
+	if (!c)
+		return -1;
+	on_error = isl_options_get_on_error(ctx);
+	isl_options_set_on_error(ctx, ISL_ON_ERROR_CONTINUE);
+	point = (int64_t) 1 << 62;
+	r1 = isl_pw_multi_aff_compiled_eval(c, 1, &point, &value, NULL);
+	point = -1;
+	r2 = isl_pw_multi_aff_compiled_eval(c, 1, &point, &value, NULL);
+	isl_options_set_on_error(ctx, on_error);
+	isl_pw_multi_aff_compiled_free(c);
+	if (r1 >= 0 || r2 >= 0)
+		isl_die(ctx, isl_error_unknown,
+			"error not detected", return -1);
 
-	str = "{ [i0] : exists e0 : i0 = 4e0 }";
-	bset = isl_basic_set_read_from_str(ctx, str);
-	bset = isl_basic_set_lift(bset);
-	bmap = isl_basic_map_from_range(bset);
-	bset = isl_basic_map_domain(bmap);
-	isl_basic_set_free(bset);
+	return 0;
 }
 
+/* Pairs of union sets, where the compiled version of the first
+ * is checked on all points of the second, which contains a box
+ * in each space of the first.
+ */
 struct {
-	const char *set1;
-	const char *set2;
-	int subset;
-} subset_tests[] = {
-	{ "{ [112, 0] }",
-	  "{ [i0, i1] : exists (e0 = [(i0 - i1)/16], e1: "
-		"16e0 <= i0 - i1 and 16e0 >= -15 + i0 - i1 and "
-		"16e1 <= i1 and 16e0 >= -i1 and 16e1 >= -i0 + i1) }", 1 },
-	{ "{ [65] }",
-	  "{ [i] : exists (e0 = [(255i)/256], e1 = [(127i + 65e0)/191], "
-		"e2 = [(3i + 61e1)/65], e3 = [(52i + 12e2)/61], "
-		"e4 = [(2i + e3)/3], e5 = [(4i + e3)/4], e6 = [(8i + e3)/12]: "
-		    "3e4 = 2i + e3 and 4e5 = 4i + e3 and 12e6 = 8i + e3 and "
-		    "i <= 255 and 64e3 >= -45 + 67i and i >= 0 and "
-		    "256e0 <= 255i and 256e0 >= -255 + 255i and "
-		    "191e1 <= 127i + 65e0 and 191e1 >= -190 + 127i + 65e0 and "
-		    "65e2 <= 3i + 61e1 and 65e2 >= -64 + 3i + 61e1 and "
-		    "61e3 <= 52i + 12e2 and 61e3 >= -60 + 52i + 12e2) }", 1 },
-	{ "{ [i] : 0 <= i <= 10 }", "{ rat: [i] : 0 <= i <= 10 }", 1 },
-	{ "{ rat: [i] : 0 <= i <= 10 }", "{ [i] : 0 <= i <= 10 }", 0 },
-	{ "{ rat: [0] }", "{ [i] : 0 <= i <= 10 }", 1 },
-	{ "{ rat: [(1)/2] }", "{ [i] : 0 <= i <= 10 }", 0 },
-	{ "{ [t, i] : (exists (e0 = [(2 + t)/4]: 4e0 <= 2 + t and "
-			"4e0 >= -1 + t and i >= 57 and i <= 62 and "
-			"4e0 <= 62 + t - i and 4e0 >= -61 + t + i and "
-			"t >= 0 and t <= 511 and 4e0 <= -57 + t + i and "
-			"4e0 >= 58 + t - i and i >= 58 + t and i >= 62 - t)) }",
-	  "{ [i0, i1] : (exists (e0 = [(4 + i0)/4]: 4e0 <= 62 + i0 - i1 and "
-			"4e0 >= 1 + i0 and i0 >= 0 and i0 <= 511 and "
-			"4e0 <= -57 + i0 + i1)) or "
-		"(exists (e0 = [(2 + i0)/4]: 4e0 <= i0 and "
-			"4e0 >= 58 + i0 - i1 and i0 >= 2 and i0 <= 511 and "
-			"4e0 >= -61 + i0 + i1)) or "
-		"(i1 <= 66 - i0 and i0 >= 2 and i1 >= 59 + i0) }", 1 },
+	const char *set;
+	const char *box;
+} compile_uset_tests[] = {
+	{ "[N] -> { A[i, j] : 0 <= i <= N and 0 <= j <= i and "
+		"exists a : j = 2a; B[i] : (exists a : 3a <= i <= 3a + 1 and "
+		"-5 <= i <= 5) or i = N }",
+	  "[N] -> { A[i, j] : -2 <= N, i, j <= 6; B[i] : -2 <= N <= 6 and "
+		"-7 <= i <= 7 }" },
+	{ "{ A[i] : 0 <= i <= 10 and exists a, b : i = 2a + 3b + 1 and "
+		"a >= 2 and b >= 1; B[] }",
+	  "{ A[i] : -3 <= i <= 13; B[] }" },
 };
 
-static int test_subset(isl_ctx *ctx)
+/* Data used in test_compile_uset_set.
+ *
+ * "uset" is the original union set and "c" its compiled version.
+ * "pos" is the position in "c" of the set that is being tested and
+ * "count" is the number of points found to be contained in that set.
+ */
+struct isl_test_compile_uset {
+	isl_union_set *uset;
+	isl_union_set_compiled *c;
+	int pos;
+	int count;
+};
+
+/* Add the number of points in "points" that are contained in
+ * set data->pos of data->c to data->count.
+ */
+static int count_compiled_contains(int64_t *points, int n, void *user)
 {
+	struct isl_test_compile_uset *data = user;
+	int contains[16];
 	int i;
-	isl_set *set1, *set2;
-	int subset;
 
-	for (i = 0; i < ARRAY_SIZE(subset_tests); ++i) {
-		set1 = isl_set_read_from_str(ctx, subset_tests[i].set1);
-		set2 = isl_set_read_from_str(ctx, subset_tests[i].set2);
-		subset = isl_set_is_subset(set1, set2);
-		isl_set_free(set1);
-		isl_set_free(set2);
-		if (subset < 0)
-			return -1;
-		if (subset != subset_tests[i].subset)
-			isl_die(ctx, isl_error_unknown,
-				"incorrect subset result", return -1);
-	}
+	if (isl_union_set_compiled_contains(data->c, data->pos, n, points,
+						contains) < 0)
+		return -1;
+	for (i = 0; i < n; ++i)
+		data->count += contains[i];
+	return 0;
+}
+
+/* Add the number of points in "points" to the integer pointed to
+ * by "user".
+ */
+static int count_batch(int64_t *points, int n, void *user)
+{
+	int *count = user;
 
+	*count += n;
 	return 0;
 }
 
-struct {
-	const char *minuend;
-	const char *subtrahend;
-	const char *difference;
-} subtract_domain_tests[] = {
-	{ "{ A[i] -> B[i] }", "{ A[i] }", "{ }" },
-	{ "{ A[i] -> B[i] }", "{ B[i] }", "{ A[i] -> B[i] }" },
-	{ "{ A[i] -> B[i] }", "{ A[i] : i > 0 }", "{ A[i] -> B[i] : i <= 0 }" },
-};
+/* Check that the number of points in the box "box" that are contained
+ * in the compiled union set data->c is equal to the number of points
+ * in the intersection of "box" and the corresponding set of data->uset.
+ */
+static int test_compile_uset_set(__isl_take isl_set *box, void *user)
+{
+	struct isl_test_compile_uset *data = user;
+	isl_ctx *ctx = isl_set_get_ctx(box);
+	isl_space *space;
+	isl_set *set;
+	int64_t buffer[16 * 3];
+	int count = 0;
+	int r;
+
+	space = isl_set_get_space(box);
+	data->pos = isl_union_set_compiled_find_space(data->c, space);
+	isl_space_free(space);
+	if (data->pos < 0)
+		isl_die(ctx, isl_error_unknown, "space not found",
+			goto error);
+	data->count = 0;
+	if (isl_set_foreach_point_batch(box, buffer, 16,
+					&count_compiled_contains, data) < 0)
+		goto error;
+
+	set = isl_union_set_extract_set(data->uset, isl_set_get_space(box));
+	set = isl_set_intersect(set, box);
+	r = isl_set_foreach_point_batch(set, buffer, 16, &count_batch, &count);
+	isl_set_free(set);
+	if (r < 0)
+		return -1;
+	if (count != data->count)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of contained points", return -1);
+
+	return 0;
+error:
+	isl_set_free(box);
+	return -1;
+}
 
-static int test_subtract(isl_ctx *ctx)
+/* Check that the compiled versions of the union sets
+ * in compile_uset_tests agree with the originals.
+ */
+static int test_compile_uset(isl_ctx *ctx)
 {
 	int i;
-	isl_union_map *umap1, *umap2;
-	isl_union_set *uset;
-	int equal;
 
-	for (i = 0; i < ARRAY_SIZE(subtract_domain_tests); ++i) {
-		umap1 = isl_union_map_read_from_str(ctx,
-				subtract_domain_tests[i].minuend);
-		uset = isl_union_set_read_from_str(ctx,
-				subtract_domain_tests[i].subtrahend);
-		umap2 = isl_union_map_read_from_str(ctx,
-				subtract_domain_tests[i].difference);
-		umap1 = isl_union_map_subtract_domain(umap1, uset);
-		equal = isl_union_map_is_equal(umap1, umap2);
-		isl_union_map_free(umap1);
-		isl_union_map_free(umap2);
-		if (equal < 0)
-			return -1;
-		if (!equal)
+	for (i = 0; i < ARRAY_SIZE(compile_uset_tests); ++i) {
+		struct isl_test_compile_uset data;
+		isl_union_set *box;
+		int r;
+
+		data.uset = isl_union_set_read_from_str(ctx,
+						compile_uset_tests[i].set);
+		box = isl_union_set_read_from_str(ctx,
+						compile_uset_tests[i].box);
+		data.c = isl_union_set_compile(data.uset);
+		r = data.c ? 0 : -1;
+		if (r >= 0 && isl_union_set_compiled_n_space(data.c) !=
+				isl_union_set_n_set(data.uset))
 			isl_die(ctx, isl_error_unknown,
-				"incorrect subtract domain result", return -1);
+				"unexpected number of spaces", r = -1);
+		if (r >= 0)
+			r = isl_union_set_foreach_set(box,
+						&test_compile_uset_set, &data);
+		isl_union_set_compiled_free(data.c);
+		isl_union_set_free(data.uset);
+		isl_union_set_free(box);
+		if (r < 0)
+			return -1;
 	}
 
 	return 0;
 }
 
-int test_factorize(isl_ctx *ctx)
+static int test_compile(isl_ctx *ctx)
 {
-	const char *str;
-	isl_basic_set *bset;
-	isl_factorizer *f;
+	int i;
 
-	str = "{ [i0, i1, i2, i3, i4, i5, i6, i7] : 3i5 <= 2 - 2i0 and "
-	    "i0 >= -2 and i6 >= 1 + i3 and i7 >= 0 and 3i5 >= -2i0 and "
-	    "2i4 <= i2 and i6 >= 1 + 2i0 + 3i1 and i4 <= -1 and "
-	    "i6 >= 1 + 2i0 + 3i5 and i6 <= 2 + 2i0 + 3i5 and "
-	    "3i5 <= 2 - 2i0 - i2 + 3i4 and i6 <= 2 + 2i0 + 3i1 and "
-	    "i0 <= -1 and i7 <= i2 + i3 - 3i4 - i6 and "
-	    "3i5 >= -2i0 - i2 + 3i4 }";
-	bset = isl_basic_set_read_from_str(ctx, str);
-	f = isl_basic_set_factorizer(bset);
-	isl_basic_set_free(bset);
-	isl_factorizer_free(f);
-	if (!f)
-		isl_die(ctx, isl_error_unknown,
-			"failed to construct factorizer", return -1);
+	for (i = 0; i < ARRAY_SIZE(compile_tests); ++i)
+		if (test_compile_one(ctx, compile_tests[i]) < 0)
+			return -1;
 
-	str = "{ [i0, i1, i2, i3, i4, i5, i6, i7, i8, i9, i10, i11, i12] : "
-	    "i12 <= 2 + i0 - i11 and 2i8 >= -i4 and i11 >= i1 and "
-	    "3i5 <= -i2 and 2i11 >= -i4 - 2i7 and i11 <= 3 + i0 + 3i9 and "
-	    "i11 <= -i4 - 2i7 and i12 >= -i10 and i2 >= -2 and "
-	    "i11 >= i1 + 3i10 and i11 >= 1 + i0 + 3i9 and "
-	    "i11 <= 1 - i4 - 2i8 and 6i6 <= 6 - i2 and 3i6 >= 1 - i2 and "
-	    "i11 <= 2 + i1 and i12 <= i4 + i11 and i12 >= i0 - i11 and "
-	    "3i5 >= -2 - i2 and i12 >= -1 + i4 + i11 and 3i3 <= 3 - i2 and "
-	    "9i6 <= 11 - i2 + 6i5 and 3i3 >= 1 - i2 and "
-	    "9i6 <= 5 - i2 + 6i3 and i12 <= -1 and i2 <= 0 }";
-	bset = isl_basic_set_read_from_str(ctx, str);
-	f = isl_basic_set_factorizer(bset);
-	isl_basic_set_free(bset);
-	isl_factorizer_free(f);
-	if (!f)
-		isl_die(ctx, isl_error_unknown,
-			"failed to construct factorizer", return -1);
+	if (test_compile_pma(ctx) < 0)
+		return -1;
+	if (test_compile_uset(ctx) < 0)
+		return -1;
 
 	return 0;
 }
 
-static int check_injective(__isl_take isl_map *map, void *user)
+/* Store the quasi-polynomial of the (single) piece in "user".
+ */
+static int extract_qp(__isl_take isl_set *set, __isl_take isl_qpolynomial *qp,
+	void *user)
 {
-	int *injective = user;
+	isl_qpolynomial **res = user;
 
-	*injective = isl_map_is_injective(map);
-	isl_map_free(map);
+	isl_qpolynomial_free(*res);
+	*res = qp;
+	isl_set_free(set);
+	return 0;
+}
 
-	if (*injective < 0 || !*injective)
-		return -1;
+/* Construct a fold of type "type" with as single element
+ * the quasi-polynomial described by "str".
+ */
+static __isl_give isl_qpolynomial_fold *fold_read(isl_ctx *ctx,
+	enum isl_fold type, const char *str)
+{
+	isl_pw_qpolynomial *pwqp;
+	isl_qpolynomial *qp = NULL;
+
+	pwqp = isl_pw_qpolynomial_read_from_str(ctx, str);
+	if (isl_pw_qpolynomial_foreach_piece(pwqp, &extract_qp, &qp) < 0)
+		qp = isl_qpolynomial_free(qp);
+	isl_pw_qpolynomial_free(pwqp);
+
+	return isl_qpolynomial_fold_alloc(type, qp);
+}
 
+/* Increment the counter pointed to by "user".
+ */
+static int count_fold_qp(__isl_take isl_qpolynomial *qp, void *user)
+{
+	int *n = user;
+
+	(*n)++;
+	isl_qpolynomial_free(qp);
 	return 0;
 }
 
-int test_one_schedule(isl_ctx *ctx, const char *d, const char *w,
-	const char *r, const char *s, int tilable, int parallel)
+/* Pairs of quasi-polynomials that are combined
+ * using isl_qpolynomial_fold_fold with fold type "type",
+ * along with the expected number of elements in the result.
+ */
+struct {
+	enum isl_fold type;
+	const char *qp1;
+	const char *qp2;
+	int n;
+} fold_redundant_tests[] = {
+	{ isl_fold_max, "{ [x] -> x }", "{ [x] -> x }", 1 },
+	{ isl_fold_max, "{ [x] -> x }", "{ [x] -> x + 1 }", 1 },
+	{ isl_fold_min, "{ [x] -> x }", "{ [x] -> x + 1 }", 1 },
+	{ isl_fold_max, "{ [x] -> floor(x/2) }", "{ [x] -> floor(x/2) - 3 }",
+	  1 },
+	{ isl_fold_max, "{ [x] -> x }", "{ [x] -> 2x }", 2 },
+	{ isl_fold_max, "{ [x] -> x^2 }", "{ [x] -> x }", 2 },
+	{ isl_fold_list, "{ [x] -> x }", "{ [x] -> x }", 4 },
+};
+
+/* Check that isl_qpolynomial_fold_fold removes elements
+ * that are identical to or differ by a constant from other elements.
+ * The folds are combined twice to also check that folding
+ * a fold with itself does not increase the number of elements.
+ */
+static int test_fold_redundant(isl_ctx *ctx)
 {
 	int i;
-	isl_union_set *D;
-	isl_union_map *W, *R, *S;
-	isl_union_map *empty;
-	isl_union_map *dep_raw, *dep_war, *dep_waw, *dep;
-	isl_union_map *validity, *proximity, *coincidence;
-	isl_union_map *schedule;
-	isl_union_map *test;
-	isl_union_set *delta;
-	isl_union_set *domain;
-	isl_set *delta_set;
-	isl_set *slice;
-	isl_set *origin;
-	isl_schedule_constraints *sc;
-	isl_schedule *sched;
-	int is_nonneg, is_parallel, is_tilable, is_injection, is_complete;
 
-	D = isl_union_set_read_from_str(ctx, d);
-	W = isl_union_map_read_from_str(ctx, w);
-	R = isl_union_map_read_from_str(ctx, r);
-	S = isl_union_map_read_from_str(ctx, s);
+	for (i = 0; i < ARRAY_SIZE(fold_redundant_tests); ++i) {
+		enum isl_fold type = fold_redundant_tests[i].type;
+		isl_qpolynomial_fold *fold1, *fold2;
+		int n = 0;
+
+		fold1 = fold_read(ctx, type, fold_redundant_tests[i].qp1);
+		fold2 = fold_read(ctx, type, fold_redundant_tests[i].qp2);
+		fold1 = isl_qpolynomial_fold_fold(fold1, fold2);
+		fold2 = isl_qpolynomial_fold_copy(fold1);
+		fold1 = isl_qpolynomial_fold_fold(fold1, fold2);
+		if (isl_qpolynomial_fold_foreach_qpolynomial(fold1,
+					&count_fold_qp, &n) < 0)
+			n = -1;
+		isl_qpolynomial_fold_free(fold1);
+		if (n < 0)
+			return -1;
+		if (n != fold_redundant_tests[i].n)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected number of fold elements",
+				return -1);
+	}
 
-	W = isl_union_map_intersect_domain(W, isl_union_set_copy(D));
-	R = isl_union_map_intersect_domain(R, isl_union_set_copy(D));
+	return 0;
+}
 
-	empty = isl_union_map_empty(isl_union_map_get_space(S));
-        isl_union_map_compute_flow(isl_union_map_copy(R),
-				   isl_union_map_copy(W), empty,
-				   isl_union_map_copy(S),
-				   &dep_raw, NULL, NULL, NULL);
-        isl_union_map_compute_flow(isl_union_map_copy(W),
-				   isl_union_map_copy(W),
-				   isl_union_map_copy(R),
-				   isl_union_map_copy(S),
-				   &dep_waw, &dep_war, NULL, NULL);
+/* Maps that are encoded in binary and then decoded again.
+ */
+const char *binary_map_tests[] = {
+	"{ [i] -> [j] : 0 <= i < j < 10 }",
+	"[n, m] -> { A[i, j] -> B[i + j] : exists (a : i = 3a) and i <= n }",
+	"{ A[B[i] -> C[j]] -> D[x, y] : x = floor((i + j)/5) and y < 7 }",
+	"{ [i] -> [i + 123456789012345678901234567890] }",
+	"{ [i] -> [j] : -1152921504606846976 <= i <= 1152921504606846977 }",
+	"{ [x] -> [y] : false }",
+	"[n] -> { [] -> [] : n >= 0 }",
+	"[n] -> { : n >= 0 }",
+	"{ [i, j] : i < j or 2i >= j + 1000 }",
+};
 
-	dep = isl_union_map_union(dep_waw, dep_war);
-	dep = isl_union_map_union(dep, dep_raw);
-	validity = isl_union_map_copy(dep);
-	coincidence = isl_union_map_copy(dep);
-	proximity = isl_union_map_copy(dep);
+/* Union maps that are encoded in binary and then decoded again.
+ */
+const char *binary_union_map_tests[] = {
+	"{ A[i] -> B[i + 1]; B[i] -> C[i, 2i]; D[] -> E[] }",
+	"[n] -> { S[i] -> T[i, j] : 0 <= i < j < n; U[] -> V[] : n > 0 }",
+	"{ }",
+};
 
-	sc = isl_schedule_constraints_on_domain(isl_union_set_copy(D));
-	sc = isl_schedule_constraints_set_validity(sc, validity);
-	sc = isl_schedule_constraints_set_coincidence(sc, coincidence);
-	sc = isl_schedule_constraints_set_proximity(sc, proximity);
-	sched = isl_schedule_constraints_compute_schedule(sc);
-	schedule = isl_schedule_get_map(sched);
-	isl_schedule_free(sched);
-	isl_union_map_free(W);
-	isl_union_map_free(R);
-	isl_union_map_free(S);
+/* Piecewise multi-affine expressions that are encoded in binary
+ * and then decoded again.
+ */
+const char *binary_pma_tests[] = {
+	"{ [i] -> [floor(i/3), 2i] : i >= 0; [i] -> [0, -i] : i < 0 }",
+	"[n] -> { A[i, j] -> B[n - i, j + floor((i + n)/7)] : i <= n }",
+	"{ [i] -> [] }",
+};
 
-	is_injection = 1;
-	isl_union_map_foreach_map(schedule, &check_injective, &is_injection);
+/* Encode "map" in binary, decode the result and check that
+ * the decoded map is identical to "map".
+ * Also check that the encoding can be decoded from the middle
+ * of a larger buffer and that truncated encodings are rejected.
+ */
+static int test_binary_map(isl_ctx *ctx, __isl_keep isl_map *map)
+{
+	unsigned char *buf, *big;
+	size_t size, used;
+	isl_map *map2;
+	int equal;
+	int on_error;
 
-	domain = isl_union_map_domain(isl_union_map_copy(schedule));
-	is_complete = isl_union_set_is_subset(D, domain);
-	isl_union_set_free(D);
-	isl_union_set_free(domain);
+	buf = isl_map_to_binary(map, &size);
+	if (!buf)
+		return -1;
+	big = isl_alloc_array(ctx, unsigned char, size + 2);
+	if (!big) {
+		free(buf);
+		return -1;
+	}
+	big[0] = 0;
+	memcpy(big + 1, buf, size);
+	big[size + 1] = 0;
 
-	test = isl_union_map_reverse(isl_union_map_copy(schedule));
-	test = isl_union_map_apply_range(test, dep);
-	test = isl_union_map_apply_range(test, schedule);
+	map2 = isl_map_from_binary(ctx, big + 1, size + 1, &used);
+	equal = isl_map_plain_is_equal(map, map2);
+	isl_map_free(map2);
+	if (equal >= 0 && (!equal || used != size))
+		isl_die(ctx, isl_error_unknown, "binary map not preserved",
+			equal = -1);
+
+	on_error = isl_options_get_on_error(ctx);
+	isl_options_set_on_error(ctx, ISL_ON_ERROR_CONTINUE);
+	map2 = isl_map_from_binary(ctx, buf, size - 1, NULL);
+	if (map2 && equal >= 0)
+		isl_die(ctx, isl_error_unknown, "truncated map accepted",
+			equal = -1);
+	isl_map_free(map2);
+	map2 = isl_map_from_binary(ctx, big + 1, size + 1, NULL);
+	if (map2 && equal >= 0)
+		isl_die(ctx, isl_error_unknown, "trailing data accepted",
+			equal = -1);
+	isl_map_free(map2);
+	isl_options_set_on_error(ctx, on_error);
 
-	delta = isl_union_map_deltas(test);
-	if (isl_union_set_n_set(delta) == 0) {
-		is_tilable = 1;
-		is_parallel = 1;
-		is_nonneg = 1;
-		isl_union_set_free(delta);
-	} else {
-		delta_set = isl_set_from_union_set(delta);
+	free(buf);
+	free(big);
+	return equal < 0 ? -1 : 0;
+}
 
-		slice = isl_set_universe(isl_set_get_space(delta_set));
-		for (i = 0; i < tilable; ++i)
-			slice = isl_set_lower_bound_si(slice, isl_dim_set, i, 0);
-		is_tilable = isl_set_is_subset(delta_set, slice);
-		isl_set_free(slice);
+/* Encode "umap" in binary, decode the result and check that
+ * the decoded union map is equal to "umap".
+ */
+static int test_binary_union_map(isl_ctx *ctx, __isl_keep isl_union_map *umap)
+{
+	void *buf;
+	size_t size;
+	isl_union_map *umap2;
+	int equal;
 
-		slice = isl_set_universe(isl_set_get_space(delta_set));
-		for (i = 0; i < parallel; ++i)
-			slice = isl_set_fix_si(slice, isl_dim_set, i, 0);
-		is_parallel = isl_set_is_subset(delta_set, slice);
-		isl_set_free(slice);
+	buf = isl_union_map_to_binary(umap, &size);
+	umap2 = isl_union_map_from_binary(ctx, buf, size, NULL);
+	equal = isl_union_map_is_equal(umap, umap2);
+	isl_union_map_free(umap2);
+	free(buf);
 
-		origin = isl_set_universe(isl_set_get_space(delta_set));
-		for (i = 0; i < isl_set_dim(origin, isl_dim_set); ++i)
-			origin = isl_set_fix_si(origin, isl_dim_set, i, 0);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"binary union map not preserved", return -1);
+	return 0;
+}
 
-		delta_set = isl_set_union(delta_set, isl_set_copy(origin));
-		delta_set = isl_set_lexmin(delta_set);
+/* Store the multi-affine expression of the first piece in "user".
+ */
+static int extract_first_ma(__isl_take isl_set *set,
+	__isl_take isl_multi_aff *ma, void *user)
+{
+	isl_multi_aff **first = user;
 
-		is_nonneg = isl_set_is_equal(delta_set, origin);
+	isl_set_free(set);
+	if (*first)
+		isl_multi_aff_free(ma);
+	else
+		*first = ma;
+	return 0;
+}
 
-		isl_set_free(origin);
-		isl_set_free(delta_set);
-	}
+/* Encode "pma" in binary, decode the result and check that
+ * the decoded piecewise multi-affine expression is identical to "pma".
+ * Also do the same for each of the affine expressions
+ * in the first piece.
+ */
+static int test_binary_pma(isl_ctx *ctx, __isl_keep isl_pw_multi_aff *pma)
+{
+	void *buf;
+	size_t size;
+	isl_pw_multi_aff *pma2;
+	isl_multi_aff *ma = NULL;
+	int i, n, equal;
 
-	if (is_nonneg < 0 || is_parallel < 0 || is_tilable < 0 ||
-	    is_injection < 0 || is_complete < 0)
+	buf = isl_pw_multi_aff_to_binary(pma, &size);
+	pma2 = isl_pw_multi_aff_from_binary(ctx, buf, size, NULL);
+	equal = isl_pw_multi_aff_plain_is_equal(pma, pma2);
+	isl_pw_multi_aff_free(pma2);
+	free(buf);
+	if (equal < 0)
 		return -1;
-	if (!is_complete)
-		isl_die(ctx, isl_error_unknown,
-			"generated schedule incomplete", return -1);
-	if (!is_injection)
-		isl_die(ctx, isl_error_unknown,
-			"generated schedule not injective on each statement",
-			return -1);
-	if (!is_nonneg)
+	if (!equal)
 		isl_die(ctx, isl_error_unknown,
-			"negative dependences in generated schedule",
-			return -1);
-	if (!is_tilable)
+			"binary pw_multi_aff not preserved", return -1);
+
+	if (isl_pw_multi_aff_foreach_piece(pma, &extract_first_ma, &ma) < 0)
+		ma = isl_multi_aff_free(ma);
+	n = isl_pw_multi_aff_dim(pma, isl_dim_out);
+	for (i = 0; ma && i < n; ++i) {
+		isl_aff *aff, *aff2;
+
+		aff = isl_multi_aff_get_aff(ma, i);
+		buf = isl_aff_to_binary(aff, &size);
+		aff2 = isl_aff_from_binary(ctx, buf, size, NULL);
+		equal = isl_aff_plain_is_equal(aff, aff2);
+		isl_aff_free(aff);
+		isl_aff_free(aff2);
+		free(buf);
+		if (equal < 0 || !equal)
+			break;
+	}
+	isl_multi_aff_free(ma);
+	if (equal < 0)
+		return -1;
+	if (!equal)
 		isl_die(ctx, isl_error_unknown,
-			"generated schedule not as tilable as expected",
-			return -1);
-	if (!is_parallel)
+			"binary aff not preserved", return -1);
+	return 0;
+}
+
+/* Construct the binary encoding of a set in which the tuple
+ * is nested "depth" times and check whether it is decoded successfully.
+ * Each nested tuple is encoded as a pair of bytes (nested, no identifier)
+ * while each other tuple is encoded as three zero bytes
+ * (not nested, no identifier, zero dimensions).
+ * Return 1 if the set is decoded, 0 if it is rejected as invalid and
+ * -1 on any other error.
+ */
+static int decode_nested_binary(isl_ctx *ctx, int depth)
+{
+	unsigned char *buf;
+	size_t size;
+	int i, on_error;
+	isl_map *map;
+	enum isl_error error;
+
+	size = 6 + 2 + 2 * depth + 3 * (depth + 1) + 2;
+	buf = calloc(size, 1);
+	if (!buf)
+		return -1;
+	memcpy(buf, "ISLB\1\2\1", 7);
+	for (i = 0; i < depth; ++i)
+		buf[8 + 2 * i] = 1;
+
+	on_error = isl_options_get_on_error(ctx);
+	isl_options_set_on_error(ctx, ISL_ON_ERROR_CONTINUE);
+	isl_ctx_reset_error(ctx);
+	map = isl_map_from_binary(ctx, buf, size, NULL);
+	error = isl_ctx_last_error(ctx);
+	isl_options_set_on_error(ctx, on_error);
+	free(buf);
+
+	if (map) {
+		isl_map_free(map);
+		return 1;
+	}
+	return error == isl_error_invalid ? 0 : -1;
+}
+
+/* Check that moderately nested tuples are decoded from
+ * the binary format, while excessively nested tuples are rejected.
+ */
+static int test_binary_nesting(isl_ctx *ctx)
+{
+	int r;
+
+	r = decode_nested_binary(ctx, 10);
+	if (r < 0)
+		return -1;
+	if (!r)
 		isl_die(ctx, isl_error_unknown,
-			"generated schedule not as parallel as expected",
-			return -1);
+			"nested tuples rejected", return -1);
+	r = decode_nested_binary(ctx, 100000);
+	if (r < 0)
+		return -1;
+	if (r)
+		isl_die(ctx, isl_error_unknown,
+			"deeply nested tuples accepted", return -1);
 
 	return 0;
 }
 
-static __isl_give isl_union_map *compute_schedule(isl_ctx *ctx,
-	const char *domain, const char *validity, const char *proximity)
+static int test_binary(isl_ctx *ctx)
 {
-	isl_union_set *dom;
-	isl_union_map *dep;
-	isl_union_map *prox;
-	isl_schedule_constraints *sc;
-	isl_schedule *schedule;
-	isl_union_map *sched;
+	int i, r;
+	isl_map *map;
+	isl_basic_map *bmap, *bmap2;
+	isl_union_map *umap;
+	isl_pw_multi_aff *pma;
+	void *buf;
+	size_t size;
+	int equal;
 
-	dom = isl_union_set_read_from_str(ctx, domain);
-	dep = isl_union_map_read_from_str(ctx, validity);
-	prox = isl_union_map_read_from_str(ctx, proximity);
-	sc = isl_schedule_constraints_on_domain(dom);
-	sc = isl_schedule_constraints_set_validity(sc, dep);
-	sc = isl_schedule_constraints_set_proximity(sc, prox);
-	schedule = isl_schedule_constraints_compute_schedule(sc);
-	sched = isl_schedule_get_map(schedule);
-	isl_schedule_free(schedule);
+	for (i = 0; i < ARRAY_SIZE(binary_map_tests); ++i) {
+		map = isl_map_read_from_str(ctx, binary_map_tests[i]);
+		r = test_binary_map(ctx, map);
+		isl_map_free(map);
+		if (r < 0)
+			return -1;
+	}
 
-	return sched;
+	for (i = 0; i < ARRAY_SIZE(binary_union_map_tests); ++i) {
+		umap = isl_union_map_read_from_str(ctx,
+						binary_union_map_tests[i]);
+		r = test_binary_union_map(ctx, umap);
+		isl_union_map_free(umap);
+		if (r < 0)
+			return -1;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(binary_pma_tests); ++i) {
+		pma = isl_pw_multi_aff_read_from_str(ctx, binary_pma_tests[i]);
+		r = test_binary_pma(ctx, pma);
+		isl_pw_multi_aff_free(pma);
+		if (r < 0)
+			return -1;
+	}
+
+	bmap = isl_basic_map_read_from_str(ctx,
+		"[n] -> { [i] -> [j] : exists (a : j = 2a and 0 <= i < n) }");
+	buf = isl_basic_map_to_binary(bmap, &size);
+	bmap2 = isl_basic_map_from_binary(ctx, buf, size, NULL);
+	equal = isl_basic_map_is_equal(bmap, bmap2);
+	isl_basic_map_free(bmap);
+	isl_basic_map_free(bmap2);
+	free(buf);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"binary basic map not preserved", return -1);
+
+	if (test_binary_nesting(ctx) < 0)
+		return -1;
+
+	return 0;
 }
 
-/* Check that a schedule can be constructed on the given domain
- * with the given validity and proximity constraints.
+/* Pairs of union maps along with whether they are expected
+ * to have the same fingerprint.
  */
-static int test_has_schedule(isl_ctx *ctx, const char *domain,
-	const char *validity, const char *proximity)
+struct {
+	const char *str1;
+	const char *str2;
+	int same;
+} fingerprint_tests[] = {
+	{ "{ A[i] -> B[i] : 0 <= i < 10 or 20 <= i < 30 }",
+	  "{ A[i] -> B[i] : 20 <= i < 30 or 0 <= i < 10 }", 1 },
+	{ "{ A[i] -> B[i]; C[i] -> D[i + 1] }",
+	  "{ C[i] -> D[1 + i]; A[i] -> B[i] }", 1 },
+	{ "{ A[i] -> B[i] }", "{ A[i] -> C[i] }", 0 },
+	{ "{ [i] -> [i + 1] }", "{ [i] -> [i + 2] }", 0 },
+	{ "[n] -> { A[i] -> B[] : i < n }", "[n] -> { A[i] -> B[] : i <= n }", 0 },
+	{ "{ A[i] -> B[i]; C[i] -> D[i] }", "{ A[i] -> B[i] }", 0 },
+};
+
+/* Check that isl_union_map_get_fingerprint and isl_set_get_fingerprint
+ * do not depend on the order of the disjuncts or the spaces and
+ * that they distinguish some obviously different objects.
+ */
+static int test_fingerprint(isl_ctx *ctx)
 {
-	isl_union_map *sched;
+	int i;
+	isl_set *set1, *set2;
+	isl_union_map *umap1, *umap2;
+	uint32_t h1, h2;
 
-	sched = compute_schedule(ctx, domain, validity, proximity);
-	if (!sched)
+	for (i = 0; i < ARRAY_SIZE(fingerprint_tests); ++i) {
+		umap1 = isl_union_map_read_from_str(ctx,
+						fingerprint_tests[i].str1);
+		umap2 = isl_union_map_read_from_str(ctx,
+						fingerprint_tests[i].str2);
+		h1 = isl_union_map_get_fingerprint(umap1);
+		h2 = isl_union_map_get_fingerprint(umap2);
+		isl_union_map_free(umap1);
+		isl_union_map_free(umap2);
+		if (!umap1 || !umap2)
+			return -1;
+		if ((h1 == h2) != fingerprint_tests[i].same)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected fingerprint", return -1);
+	}
+
+	set1 = isl_set_read_from_str(ctx, "{ [i] : i = 5 or i = 0 }");
+	set2 = isl_set_read_from_str(ctx, "{ [i] : i = 0 or i = 5 }");
+	h1 = isl_set_get_fingerprint(set1);
+	h2 = isl_set_get_fingerprint(set2);
+	isl_set_free(set1);
+	isl_set_free(set2);
+	if (!set1 || !set2)
 		return -1;
+	if (h1 != h2)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected fingerprint", return -1);
 
-	isl_union_map_free(sched);
 	return 0;
 }
 
-int test_special_schedule(isl_ctx *ctx, const char *domain,
-	const char *validity, const char *proximity, const char *expected_sched)
+/* Check that objects can be copied to another isl_ctx and back.
+ */
+static int test_import(isl_ctx *ctx)
 {
-	isl_union_map *sched1, *sched2;
-	int equal;
+	const char *str;
+	isl_ctx *ctx2;
+	isl_union_map *umap, *umap2, *umap3;
+	isl_set *set, *set2;
+	isl_id *id;
+	int equal, user;
 
-	sched1 = compute_schedule(ctx, domain, validity, proximity);
-	sched2 = isl_union_map_read_from_str(ctx, expected_sched);
+	ctx2 = isl_ctx_alloc();
+	if (!ctx2)
+		return -1;
 
-	equal = isl_union_map_is_equal(sched1, sched2);
-	isl_union_map_free(sched1);
-	isl_union_map_free(sched2);
+	str = "[n] -> { A[i] -> B[[i] -> C[j]] : exists (a : i = 2a) and "
+		"0 <= j < n; D[x] -> E[] : x > n }";
+	umap = isl_union_map_read_from_str(ctx, str);
+	umap2 = isl_union_map_import(ctx2, umap);
+	if (isl_union_map_get_ctx(umap2) != ctx2)
+		umap2 = isl_union_map_free(umap2);
+	umap3 = isl_union_map_import(ctx, umap2);
+	isl_union_map_free(umap2);
+	equal = isl_union_map_is_equal(umap, umap3);
+	isl_union_map_free(umap);
+	isl_union_map_free(umap3);
+
+	set = isl_set_read_from_str(ctx, "[n] -> { [i] : 0 <= i < n }");
+	set = isl_set_set_tuple_id(set, isl_id_alloc(ctx, "S", &user));
+	set2 = isl_set_import(ctx2, set);
+	id = isl_set_get_tuple_id(set2);
+	if (isl_id_get_user(id) != &user ||
+	    strcmp(isl_id_get_name(id), "S") ||
+	    isl_set_dim(set2, isl_dim_param) != 1)
+		equal = 0;
+	isl_id_free(id);
+	isl_set_free(set);
+	isl_set_free(set2);
+	if (!set2)
+		equal = -1;
+
+	isl_ctx_free(ctx2);
 
 	if (equal < 0)
 		return -1;
 	if (!equal)
-		isl_die(ctx, isl_error_unknown, "unexpected schedule",
+		isl_die(ctx, isl_error_unknown, "object not preserved",
 			return -1);
 
 	return 0;
 }
 
-/* Check that the schedule map is properly padded, even after being
- * reconstructed from the band forest.
+/* Check that two sets are not considered disjoint just because
+ * they have a different set of (named) parameters.
+ * Also check that sets with opposite constraints on the same
+ * affine combination of variables are plainly disjoint,
+ * even if they involve integer divisions elsewhere.
  */
-static int test_padded_schedule(isl_ctx *ctx)
+static int test_disjoint(isl_ctx *ctx)
 {
 	const char *str;
-	isl_union_set *D;
-	isl_union_map *validity, *proximity;
-	isl_schedule_constraints *sc;
-	isl_schedule *sched;
-	isl_union_map *map1, *map2;
-	isl_band_list *list;
-	int equal;
+	isl_set *set, *set2;
+	int disjoint;
 
-	str = "[N] -> { S0[i] : 0 <= i <= N; S1[i, j] : 0 <= i, j <= N }";
-	D = isl_union_set_read_from_str(ctx, str);
-	validity = isl_union_map_empty(isl_union_set_get_space(D));
-	proximity = isl_union_map_copy(validity);
-	sc = isl_schedule_constraints_on_domain(D);
-	sc = isl_schedule_constraints_set_validity(sc, validity);
-	sc = isl_schedule_constraints_set_proximity(sc, proximity);
-	sched = isl_schedule_constraints_compute_schedule(sc);
-	map1 = isl_schedule_get_map(sched);
-	list = isl_schedule_get_band_forest(sched);
-	isl_band_list_free(list);
-	map2 = isl_schedule_get_map(sched);
-	isl_schedule_free(sched);
-	equal = isl_union_map_is_equal(map1, map2);
-	isl_union_map_free(map1);
-	isl_union_map_free(map2);
+	str = "[n] -> { [[]->[]] }";
+	set = isl_set_read_from_str(ctx, str);
+	str = "{ [[]->[]] }";
+	set2 = isl_set_read_from_str(ctx, str);
+	disjoint = isl_set_is_disjoint(set, set2);
+	isl_set_free(set);
+	isl_set_free(set2);
+	if (disjoint < 0)
+		return -1;
+	if (disjoint)
+		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+
+	str = "{ [i, j] : i + j >= 10 and exists a : i = 2a }";
+	set = isl_set_read_from_str(ctx, str);
+	str = "{ [i, j] : i + j <= 5 and 0 <= i <= 100 }";
+	set2 = isl_set_read_from_str(ctx, str);
+	disjoint = isl_set_plain_is_disjoint(set, set2);
+	isl_set_free(set);
+	isl_set_free(set2);
+	if (disjoint < 0)
+		return -1;
+	if (!disjoint)
+		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+
+	return 0;
+}
+
+int test_equal(isl_ctx *ctx)
+{
+	const char *str;
+	isl_set *set, *set2;
+	int equal;
 
+	str = "{ S_6[i] }";
+	set = isl_set_read_from_str(ctx, str);
+	str = "{ S_7[i] }";
+	set2 = isl_set_read_from_str(ctx, str);
+	equal = isl_set_is_equal(set, set2);
+	isl_set_free(set);
+	isl_set_free(set2);
 	if (equal < 0)
 		return -1;
-	if (!equal)
-		isl_die(ctx, isl_error_unknown,
-			"reconstructed schedule map not the same as original",
-			return -1);
+	if (equal)
+		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
 
 	return 0;
 }
 
-/* Input for testing of schedule construction based on
- * conditional constraints.
- *
- * domain is the iteration domain
- * flow are the flow dependences, which determine the validity and
- * 	proximity constraints
- * condition are the conditions on the conditional validity constraints
- * conditional_validity are the conditional validity constraints
- * outer_band_n is the expected number of members in the outer band
- */
-struct {
-	const char *domain;
-	const char *flow;
-	const char *condition;
-	const char *conditional_validity;
-	int outer_band_n;
-} live_range_tests[] = {
-	/* Contrived example that illustrates that we need to keep
-	 * track of tagged condition dependences and
-	 * tagged conditional validity dependences
-	 * in isl_sched_edge separately.
-	 * In particular, the conditional validity constraints on A
-	 * cannot be satisfied,
-	 * but they can be ignored because there are no corresponding
-	 * condition constraints.  However, we do have an additional
-	 * conditional validity constraint that maps to the same
-	 * dependence relation
-	 * as the condition constraint on B.  If we did not make a distinction
-	 * between tagged condition and tagged conditional validity
-	 * dependences, then we
-	 * could end up treating this shared dependence as an condition
-	 * constraint on A, forcing a localization of the conditions,
-	 * which is impossible.
-	 */
-	{ "{ S[i] : 0 <= 1 < 100; T[i] : 0 <= 1 < 100 }",
-	  "{ S[i] -> S[i+1] : 0 <= i < 99 }",
-	  "{ [S[i] -> B[]] -> [S[i+1] -> B[]] : 0 <= i < 99 }",
-	  "{ [S[i] -> A[]] -> [T[i'] -> A[]] : 0 <= i', i < 100 and i != i';"
-	    "[T[i] -> A[]] -> [S[i'] -> A[]] : 0 <= i', i < 100 and i != i';"
-	    "[S[i] -> A[]] -> [S[i+1] -> A[]] : 0 <= i < 99 }",
-	  1
-	},
-	/* TACO 2013 Fig. 7 */
-	{ "[n] -> { S1[i,j] : 0 <= i,j < n; S2[i,j] : 0 <= i,j < n }",
-	  "[n] -> { S1[i,j] -> S2[i,j] : 0 <= i,j < n;"
-		   "S2[i,j] -> S2[i,j+1] : 0 <= i < n and 0 <= j < n - 1 }",
-	  "[n] -> { [S1[i,j] -> t[]] -> [S2[i,j] -> t[]] : 0 <= i,j < n;"
-		   "[S2[i,j] -> x1[]] -> [S2[i,j+1] -> x1[]] : "
-				"0 <= i < n and 0 <= j < n - 1 }",
-	  "[n] -> { [S2[i,j] -> t[]] -> [S1[i,j'] -> t[]] : "
-				"0 <= i < n and 0 <= j < j' < n;"
-		   "[S2[i,j] -> t[]] -> [S1[i',j'] -> t[]] : "
-				"0 <= i < i' < n and 0 <= j,j' < n;"
-		   "[S2[i,j] -> x1[]] -> [S2[i,j'] -> x1[]] : "
-				"0 <= i,j,j' < n and j < j' }",
-	    2
-	},
-	/* TACO 2013 Fig. 7, without tags */
-	{ "[n] -> { S1[i,j] : 0 <= i,j < n; S2[i,j] : 0 <= i,j < n }",
-	  "[n] -> { S1[i,j] -> S2[i,j] : 0 <= i,j < n;"
-		   "S2[i,j] -> S2[i,j+1] : 0 <= i < n and 0 <= j < n - 1 }",
-	  "[n] -> { S1[i,j] -> S2[i,j] : 0 <= i,j < n;"
-		   "S2[i,j] -> S2[i,j+1] : 0 <= i < n and 0 <= j < n - 1 }",
-	  "[n] -> { S2[i,j] -> S1[i,j'] : 0 <= i < n and 0 <= j < j' < n;"
-		   "S2[i,j] -> S1[i',j'] : 0 <= i < i' < n and 0 <= j,j' < n;"
-		   "S2[i,j] -> S2[i,j'] : 0 <= i,j,j' < n and j < j' }",
-	   1
-	},
-	/* TACO 2013 Fig. 12 */
-	{ "{ S1[i,0] : 0 <= i <= 1; S2[i,j] : 0 <= i <= 1 and 1 <= j <= 2;"
-	    "S3[i,3] : 0 <= i <= 1 }",
-	  "{ S1[i,0] -> S2[i,1] : 0 <= i <= 1;"
-	    "S2[i,1] -> S2[i,2] : 0 <= i <= 1;"
-	    "S2[i,2] -> S3[i,3] : 0 <= i <= 1 }",
-	  "{ [S1[i,0]->t[]] -> [S2[i,1]->t[]] : 0 <= i <= 1;"
-	    "[S2[i,1]->t[]] -> [S2[i,2]->t[]] : 0 <= i <= 1;"
-	    "[S2[i,2]->t[]] -> [S3[i,3]->t[]] : 0 <= i <= 1 }",
-	  "{ [S2[i,1]->t[]] -> [S2[i,2]->t[]] : 0 <= i <= 1;"
-	    "[S2[0,j]->t[]] -> [S2[1,j']->t[]] : 1 <= j,j' <= 2;"
-	    "[S2[0,j]->t[]] -> [S1[1,0]->t[]] : 1 <= j <= 2;"
-	    "[S3[0,3]->t[]] -> [S2[1,j]->t[]] : 1 <= j <= 2;"
-	    "[S3[0,3]->t[]] -> [S1[1,0]->t[]] }",
-	   1
-	}
+static int test_plain_fixed(isl_ctx *ctx, __isl_take isl_map *map,
+	enum isl_dim_type type, unsigned pos, int fixed)
+{
+	int test;
+
+	test = isl_map_plain_is_fixed(map, type, pos, NULL);
+	isl_map_free(map);
+	if (test < 0)
+		return -1;
+	if (test == fixed)
+		return 0;
+	if (fixed)
+		isl_die(ctx, isl_error_unknown,
+			"map not detected as fixed", return -1);
+	else
+		isl_die(ctx, isl_error_unknown,
+			"map detected as fixed", return -1);
+}
+
+int test_fixed(isl_ctx *ctx)
+{
+	const char *str;
+	isl_map *map;
+
+	str = "{ [i] -> [i] }";
+	map = isl_map_read_from_str(ctx, str);
+	if (test_plain_fixed(ctx, map, isl_dim_out, 0, 0))
+		return -1;
+	str = "{ [i] -> [1] }";
+	map = isl_map_read_from_str(ctx, str);
+	if (test_plain_fixed(ctx, map, isl_dim_out, 0, 1))
+		return -1;
+	str = "{ S_1[p1] -> [o0] : o0 = -2 and p1 >= 1 and p1 <= 7 }";
+	map = isl_map_read_from_str(ctx, str);
+	if (test_plain_fixed(ctx, map, isl_dim_out, 0, 1))
+		return -1;
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_neg(map);
+	if (test_plain_fixed(ctx, map, isl_dim_out, 0, 1))
+		return -1;
+
+	return 0;
+}
+
+struct isl_vertices_test_data {
+	const char *set;
+	int n;
+	const char *vertex[2];
+} vertices_tests[] = {
+	{ "{ A[t, i] : t = 12 and i >= 4 and i <= 12 }",
+	  2, { "{ A[12, 4] }", "{ A[12, 12] }" } },
+	{ "{ A[t, i] : t = 14 and i = 1 }",
+	  1, { "{ A[14, 1] }" } },
 };
 
-/* Test schedule construction based on conditional constraints.
- * In particular, check the number of members in the outer band
- * as an indication of whether tiling is possible or not.
+/* Check that "vertex" corresponds to one of the vertices in data->vertex.
  */
-static int test_conditional_schedule_constraints(isl_ctx *ctx)
+static int find_vertex(__isl_take isl_vertex *vertex, void *user)
 {
+	struct isl_vertices_test_data *data = user;
+	isl_ctx *ctx;
+	isl_multi_aff *ma;
+	isl_basic_set *bset;
+	isl_pw_multi_aff *pma;
 	int i;
-	isl_union_set *domain;
-	isl_union_map *condition;
-	isl_union_map *flow;
-	isl_union_map *validity;
-	isl_schedule_constraints *sc;
-	isl_schedule *schedule;
-	isl_band_list *list;
-	isl_band *band;
-	int n_member;
+	int equal;
 
-	for (i = 0; i < ARRAY_SIZE(live_range_tests); ++i) {
-		domain = isl_union_set_read_from_str(ctx,
-				live_range_tests[i].domain);
-		flow = isl_union_map_read_from_str(ctx,
-				live_range_tests[i].flow);
-		condition = isl_union_map_read_from_str(ctx,
-				live_range_tests[i].condition);
-		validity = isl_union_map_read_from_str(ctx,
-				live_range_tests[i].conditional_validity);
-		sc = isl_schedule_constraints_on_domain(domain);
-		sc = isl_schedule_constraints_set_validity(sc,
-				isl_union_map_copy(flow));
-		sc = isl_schedule_constraints_set_proximity(sc, flow);
-		sc = isl_schedule_constraints_set_conditional_validity(sc,
-				condition, validity);
-		schedule = isl_schedule_constraints_compute_schedule(sc);
-		list = isl_schedule_get_band_forest(schedule);
-		band = isl_band_list_get_band(list, 0);
-		n_member = isl_band_n_member(band);
-		isl_band_free(band);
-		isl_band_list_free(list);
-		isl_schedule_free(schedule);
+	ctx = isl_vertex_get_ctx(vertex);
+	bset = isl_vertex_get_domain(vertex);
+	ma = isl_vertex_get_expr(vertex);
+	pma = isl_pw_multi_aff_alloc(isl_set_from_basic_set(bset), ma);
 
-		if (!schedule)
-			return -1;
-		if (n_member != live_range_tests[i].outer_band_n)
-			isl_die(ctx, isl_error_unknown,
-				"unexpected number of members in outer band",
-				return -1);
+	for (i = 0; i < data->n; ++i) {
+		isl_pw_multi_aff *pma_i;
+
+		pma_i = isl_pw_multi_aff_read_from_str(ctx, data->vertex[i]);
+		equal = isl_pw_multi_aff_plain_is_equal(pma, pma_i);
+		isl_pw_multi_aff_free(pma_i);
+
+		if (equal < 0 || equal)
+			break;
 	}
+
+	isl_pw_multi_aff_free(pma);
+	isl_vertex_free(vertex);
+
+	if (equal < 0)
+		return -1;
+
+	return equal ? 0 : - 1;
+}
+
+/* Add the vertex "vertex", as a set on its activity domain,
+ * to the union pointed to by "user".
+ */
+static int collect_vertex(__isl_take isl_vertex *vertex, void *user)
+{
+	isl_set **set = user;
+	isl_basic_set *dom;
+	isl_multi_aff *ma;
+	isl_set *v;
+
+	dom = isl_vertex_get_domain(vertex);
+	ma = isl_vertex_get_expr(vertex);
+	isl_vertex_free(vertex);
+	v = isl_set_from_pw_multi_aff(isl_pw_multi_aff_alloc(
+					isl_set_from_basic_set(dom), ma));
+	*set = isl_set_union(*set, v);
+
+	return *set ? 0 : -1;
+}
+
+/* Count the number of chambers.
+ */
+static int count_cell(__isl_take isl_cell *cell, void *user)
+{
+	int *n = user;
+
+	(*n)++;
+	isl_cell_free(cell);
 	return 0;
 }
 
-int test_schedule(isl_ctx *ctx)
+/* Return the union of the vertices in "vertices" (each restricted
+ * to its activity domain), living in "space",
+ * and store the number of chambers in "n_cell".
+ */
+static __isl_give isl_set *vertices_set(__isl_keep isl_vertices *vertices,
+	__isl_take isl_space *space, int *n_cell)
 {
-	const char *D, *W, *R, *V, *P, *S;
+	isl_set *set;
 
-	/* Handle resulting schedule with zero bands. */
-	if (test_one_schedule(ctx, "{[]}", "{}", "{}", "{[] -> []}", 0, 0) < 0)
-		return -1;
+	set = isl_set_empty(space);
+	*n_cell = 0;
+	if (isl_vertices_foreach_vertex(vertices, &collect_vertex, &set) < 0 ||
+	    isl_vertices_foreach_cell(vertices, &count_cell, n_cell) < 0)
+		return isl_set_free(set);
 
-	/* Jacobi */
-	D = "[T,N] -> { S1[t,i] : 1 <= t <= T and 2 <= i <= N - 1 }";
-	W = "{ S1[t,i] -> a[t,i] }";
-	R = "{ S1[t,i] -> a[t-1,i]; S1[t,i] -> a[t-1,i-1]; "
-	    	"S1[t,i] -> a[t-1,i+1] }";
-	S = "{ S1[t,i] -> [t,i] }";
-	if (test_one_schedule(ctx, D, W, R, S, 2, 0) < 0)
-		return -1;
+	return set;
+}
 
-	/* Fig. 5 of CC2008 */
-	D = "[N] -> { S_0[i, j] : i >= 0 and i <= -1 + N and j >= 2 and "
-				"j <= -1 + N }";
-	W = "[N] -> { S_0[i, j] -> a[i, j] : i >= 0 and i <= -1 + N and "
-				"j >= 2 and j <= -1 + N }";
-	R = "[N] -> { S_0[i, j] -> a[j, i] : i >= 0 and i <= -1 + N and "
-				"j >= 2 and j <= -1 + N; "
-		    "S_0[i, j] -> a[i, -1 + j] : i >= 0 and i <= -1 + N and "
-				"j >= 2 and j <= -1 + N }";
-	S = "[N] -> { S_0[i, j] -> [0, i, 0, j, 0] }";
-	if (test_one_schedule(ctx, D, W, R, S, 2, 0) < 0)
-		return -1;
+struct {
+	const char *set;
+	const char *constraint;
+} vertices_add_tests[] = {
+	{ "[n, m] -> { [i, j] : 0 <= i <= n and 0 <= j <= m }",
+	  "[n, m] -> { [i, j] -> [(n - i - j)] }" },
+	{ "[n] -> { [i, j] : 0 <= i <= n and 0 <= j <= n }",
+	  "[n] -> { [i, j] -> [(2n - i - j + 5)] }" },
+	{ "[n] -> { [i, j] : 0 <= i <= n and 0 <= j <= n }",
+	  "[n] -> { [i, j] -> [(-1 - i)] }" },
+	{ "[n] -> { [i, j, k] : 0 <= i <= n and 0 <= j <= i and 0 <= k <= n }",
+	  "[n] -> { [i, j, k] -> [(n - j - k)] }" },
+	{ "[n] -> { [i] : 0 <= i <= n }",
+	  "[n] -> { [i] -> [(10 - i)] }" },
+	{ "[n] -> { [i, j] : 0 <= i <= n and 0 <= j <= n }",
+	  "[n] -> { [i, j] -> [(n - 3)] }" },
+	{ "[n, m] -> { [i, j] : 0 <= i <= n and 0 <= j <= m and i + j <= 10 }",
+	  "[n, m] -> { [i, j] -> [(i - j + m)] }" },
+};
 
-	D = "{ S1[i] : 0 <= i <= 10; S2[i] : 0 <= i <= 9 }";
-	W = "{ S1[i] -> a[i] }";
-	R = "{ S2[i] -> a[i+1] }";
-	S = "{ S1[i] -> [0,i]; S2[i] -> [1,i] }";
-	if (test_one_schedule(ctx, D, W, R, S, 1, 1) < 0)
-		return -1;
+/* Check that adding a constraint to the vertices of a polytope
+ * through isl_vertices_add_constraint produces the same vertices
+ * and the same number of chambers as computing the vertices
+ * of the intersection from scratch.
+ */
+static int test_vertices_add_constraint(isl_ctx *ctx)
+{
+	int i;
 
-	D = "{ S1[i] : 0 <= i < 10; S2[i] : 0 <= i < 10 }";
-	W = "{ S1[i] -> a[i] }";
-	R = "{ S2[i] -> a[9-i] }";
-	S = "{ S1[i] -> [0,i]; S2[i] -> [1,i] }";
-	if (test_one_schedule(ctx, D, W, R, S, 1, 1) < 0)
-		return -1;
+	for (i = 0; i < ARRAY_SIZE(vertices_add_tests); ++i) {
+		isl_basic_set *bset, *bset2;
+		isl_aff *aff;
+		isl_vertices *vertices, *vertices2;
+		isl_set *set, *set2;
+		int n, n2, n_cell, n_cell2;
+		int equal;
 
-	D = "[N] -> { S1[i] : 0 <= i < N; S2[i] : 0 <= i < N }";
-	W = "{ S1[i] -> a[i] }";
-	R = "[N] -> { S2[i] -> a[N-1-i] }";
-	S = "{ S1[i] -> [0,i]; S2[i] -> [1,i] }";
-	if (test_one_schedule(ctx, D, W, R, S, 1, 1) < 0)
-		return -1;
-	
-	D = "{ S1[i] : 0 < i < 10; S2[i] : 0 <= i < 10 }";
-	W = "{ S1[i] -> a[i]; S2[i] -> b[i] }";
-	R = "{ S2[i] -> a[i]; S1[i] -> b[i-1] }";
-	S = "{ S1[i] -> [i,0]; S2[i] -> [i,1] }";
-	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
-		return -1;
+		bset = isl_basic_set_read_from_str(ctx,
+						vertices_add_tests[i].set);
+		aff = isl_aff_read_from_str(ctx,
+					vertices_add_tests[i].constraint);
+		bset2 = isl_basic_set_copy(bset);
+		bset2 = isl_basic_set_intersect(bset2,
+			isl_basic_set_from_constraint(
+				isl_inequality_from_aff(isl_aff_copy(aff))));
+		vertices = isl_basic_set_compute_vertices(bset);
+		vertices = isl_vertices_add_constraint(vertices,
+					isl_inequality_from_aff(aff));
+		vertices2 = isl_basic_set_compute_vertices(bset2);
+		n = isl_vertices_get_n_vertices(vertices);
+		n2 = isl_vertices_get_n_vertices(vertices2);
+		set = vertices_set(vertices, isl_basic_set_get_space(bset2),
+					&n_cell);
+		set2 = vertices_set(vertices2, isl_basic_set_get_space(bset2),
+					&n_cell2);
+		equal = isl_set_is_equal(set, set2);
+		isl_set_free(set);
+		isl_set_free(set2);
+		isl_vertices_free(vertices);
+		isl_vertices_free(vertices2);
+		isl_basic_set_free(bset);
+		isl_basic_set_free(bset2);
 
-	D = "[N] -> { S1[i] : 1 <= i <= N; S2[i,j] : 1 <= i,j <= N }";
-	W = "{ S1[i] -> a[0,i]; S2[i,j] -> a[i,j] }";
-	R = "{ S2[i,j] -> a[i-1,j] }";
-	S = "{ S1[i] -> [0,i,0]; S2[i,j] -> [1,i,j] }";
-	if (test_one_schedule(ctx, D, W, R, S, 2, 1) < 0)
-		return -1;
+		if (equal < 0 || n < 0 || n2 < 0)
+			return -1;
+		if (!equal || n != n2 || n_cell != n_cell2)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected vertices", return -1);
+	}
 
-	D = "[N] -> { S1[i] : 1 <= i <= N; S2[i,j] : 1 <= i,j <= N }";
-	W = "{ S1[i] -> a[i,0]; S2[i,j] -> a[i,j] }";
-	R = "{ S2[i,j] -> a[i,j-1] }";
-	S = "{ S1[i] -> [0,i,0]; S2[i,j] -> [1,i,j] }";
-	if (test_one_schedule(ctx, D, W, R, S, 2, 1) < 0)
-		return -1;
+	return 0;
+}
 
-	D = "[N] -> { S_0[]; S_1[i] : i >= 0 and i <= -1 + N; S_2[] }";
-	W = "[N] -> { S_0[] -> a[0]; S_2[] -> b[0]; "
-		    "S_1[i] -> a[1 + i] : i >= 0 and i <= -1 + N }";
-	R = "[N] -> { S_2[] -> a[N]; S_1[i] -> a[i] : i >= 0 and i <= -1 + N }";
-	S = "[N] -> { S_1[i] -> [1, i, 0]; S_2[] -> [2, 0, 1]; "
-		    "S_0[] -> [0, 0, 0] }";
-	if (test_one_schedule(ctx, D, W, R, S, 1, 0) < 0)
-		return -1;
-	ctx->opt->schedule_parametric = 0;
-	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
-		return -1;
-	ctx->opt->schedule_parametric = 1;
+int test_vertices(isl_ctx *ctx)
+{
+	int i;
 
-	D = "[N] -> { S1[i] : 1 <= i <= N; S2[i] : 1 <= i <= N; "
-		    "S3[i,j] : 1 <= i,j <= N; S4[i] : 1 <= i <= N }";
-	W = "{ S1[i] -> a[i,0]; S2[i] -> a[0,i]; S3[i,j] -> a[i,j] }";
-	R = "[N] -> { S3[i,j] -> a[i-1,j]; S3[i,j] -> a[i,j-1]; "
-		    "S4[i] -> a[i,N] }";
-	S = "{ S1[i] -> [0,i,0]; S2[i] -> [1,i,0]; S3[i,j] -> [2,i,j]; "
-		"S4[i] -> [4,i,0] }";
-	if (test_one_schedule(ctx, D, W, R, S, 2, 0) < 0)
-		return -1;
+	for (i = 0; i < ARRAY_SIZE(vertices_tests); ++i) {
+		isl_basic_set *bset;
+		isl_vertices *vertices;
+		int ok = 1;
+		int n;
 
-	D = "[N] -> { S_0[i, j] : i >= 1 and i <= N and j >= 1 and j <= N }";
-	W = "[N] -> { S_0[i, j] -> s[0] : i >= 1 and i <= N and j >= 1 and "
-					"j <= N }";
-	R = "[N] -> { S_0[i, j] -> s[0] : i >= 1 and i <= N and j >= 1 and "
-					"j <= N; "
-		    "S_0[i, j] -> a[i, j] : i >= 1 and i <= N and j >= 1 and "
-					"j <= N }";
-	S = "[N] -> { S_0[i, j] -> [0, i, 0, j, 0] }";
-	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
-		return -1;
+		bset = isl_basic_set_read_from_str(ctx, vertices_tests[i].set);
+		vertices = isl_basic_set_compute_vertices(bset);
+		n = isl_vertices_get_n_vertices(vertices);
+		if (vertices_tests[i].n != n)
+			ok = 0;
+		if (isl_vertices_foreach_vertex(vertices, &find_vertex,
+						&vertices_tests[i]) < 0)
+			ok = 0;
+		isl_vertices_free(vertices);
+		isl_basic_set_free(bset);
 
-	D = "[N] -> { S_0[t] : t >= 0 and t <= -1 + N; "
-		    " S_2[t] : t >= 0 and t <= -1 + N; "
-		    " S_1[t, i] : t >= 0 and t <= -1 + N and i >= 0 and "
-				"i <= -1 + N }";
-	W = "[N] -> { S_0[t] -> a[t, 0] : t >= 0 and t <= -1 + N; "
-		    " S_2[t] -> b[t] : t >= 0 and t <= -1 + N; "
-		    " S_1[t, i] -> a[t, 1 + i] : t >= 0 and t <= -1 + N and "
-						"i >= 0 and i <= -1 + N }";
-	R = "[N] -> { S_1[t, i] -> a[t, i] : t >= 0 and t <= -1 + N and "
-					    "i >= 0 and i <= -1 + N; "
-		    " S_2[t] -> a[t, N] : t >= 0 and t <= -1 + N }";
-	S = "[N] -> { S_2[t] -> [0, t, 2]; S_1[t, i] -> [0, t, 1, i, 0]; "
-		    " S_0[t] -> [0, t, 0] }";
+		if (!vertices)
+			return -1;
+		if (!ok)
+			isl_die(ctx, isl_error_unknown, "unexpected vertices",
+				return -1);
+	}
 
-	if (test_one_schedule(ctx, D, W, R, S, 2, 1) < 0)
+	if (test_vertices_add_constraint(ctx) < 0)
 		return -1;
-	ctx->opt->schedule_parametric = 0;
-	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
-		return -1;
-	ctx->opt->schedule_parametric = 1;
 
-	D = "[N] -> { S1[i,j] : 0 <= i,j < N; S2[i,j] : 0 <= i,j < N }";
-	S = "{ S1[i,j] -> [0,i,j]; S2[i,j] -> [1,i,j] }";
-	if (test_one_schedule(ctx, D, "{}", "{}", S, 2, 2) < 0)
-		return -1;
+	return 0;
+}
 
-	D = "[M, N] -> { S_1[i] : i >= 0 and i <= -1 + M; "
-	    "S_0[i, j] : i >= 0 and i <= -1 + M and j >= 0 and j <= -1 + N }";
-	W = "[M, N] -> { S_0[i, j] -> a[j] : i >= 0 and i <= -1 + M and "
-					    "j >= 0 and j <= -1 + N; "
-			"S_1[i] -> b[0] : i >= 0 and i <= -1 + M }";
-	R = "[M, N] -> { S_0[i, j] -> a[0] : i >= 0 and i <= -1 + M and "
-					    "j >= 0 and j <= -1 + N; "
-			"S_1[i] -> b[0] : i >= 0 and i <= -1 + M }";
-	S = "[M, N] -> { S_1[i] -> [1, i, 0]; S_0[i, j] -> [0, i, 0, j, 0] }";
-	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
-		return -1;
+int test_union_pw(isl_ctx *ctx)
+{
+	int equal;
+	const char *str;
+	isl_union_set *uset;
+	isl_union_pw_qpolynomial *upwqp1, *upwqp2;
 
-	D = "{ S_0[i] : i >= 0 }";
-	W = "{ S_0[i] -> a[i] : i >= 0 }";
-	R = "{ S_0[i] -> a[0] : i >= 0 }";
-	S = "{ S_0[i] -> [0, i, 0] }";
-	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
+	str = "{ [x] -> x^2 }";
+	upwqp1 = isl_union_pw_qpolynomial_read_from_str(ctx, str);
+	upwqp2 = isl_union_pw_qpolynomial_copy(upwqp1);
+	uset = isl_union_pw_qpolynomial_domain(upwqp1);
+	upwqp1 = isl_union_pw_qpolynomial_copy(upwqp2);
+	upwqp1 = isl_union_pw_qpolynomial_intersect_domain(upwqp1, uset);
+	equal = isl_union_pw_qpolynomial_plain_is_equal(upwqp1, upwqp2);
+	isl_union_pw_qpolynomial_free(upwqp1);
+	isl_union_pw_qpolynomial_free(upwqp2);
+	if (equal < 0)
 		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
 
-	D = "{ S_0[i] : i >= 0; S_1[i] : i >= 0 }";
-	W = "{ S_0[i] -> a[i] : i >= 0; S_1[i] -> b[i] : i >= 0 }";
-	R = "{ S_0[i] -> b[0] : i >= 0; S_1[i] -> a[i] : i >= 0 }";
-	S = "{ S_1[i] -> [0, i, 1]; S_0[i] -> [0, i, 0] }";
-	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
-		return -1;
+	return 0;
+}
 
-	D = "[n] -> { S_0[j, k] : j <= -1 + n and j >= 0 and "
-				"k <= -1 + n and k >= 0 }";
-	W = "[n] -> { S_0[j, k] -> B[j] : j <= -1 + n and j >= 0 and "							"k <= -1 + n and k >= 0 }";
-	R = "[n] -> { S_0[j, k] -> B[j] : j <= -1 + n and j >= 0 and "
-					"k <= -1 + n and k >= 0; "
-		    "S_0[j, k] -> B[k] : j <= -1 + n and j >= 0 and "
-					"k <= -1 + n and k >= 0; "
-		    "S_0[j, k] -> A[k] : j <= -1 + n and j >= 0 and "
-					"k <= -1 + n and k >= 0 }";
-	S = "[n] -> { S_0[j, k] -> [2, j, k] }";
-	ctx->opt->schedule_outer_coincidence = 1;
-	if (test_one_schedule(ctx, D, W, R, S, 0, 0) < 0)
-		return -1;
-	ctx->opt->schedule_outer_coincidence = 0;
+struct {
+	const char *umap1;
+	const char *umap2;
+	const char *res;
+} union_map_apply_tests[] = {
+	{ "{ A[i] -> B[i + 1]; A[i] -> C[i]; D[i] -> B[2i] }",
+	  "{ B[i] -> E[i]; B[i] -> F[i, i]; C[i] -> B[i]; G[i] -> B[i] }",
+	  "{ A[i] -> E[i + 1]; A[i] -> F[i + 1, i + 1]; A[i] -> B[i]; "
+	    "D[i] -> E[2i]; D[i] -> F[2i, 2i] }" },
+	{ "{ A[i] -> [B[i] -> C[i]]; A[i] -> [B[i] -> D[i]] }",
+	  "{ [B[i] -> C[j]] -> E[i + j]; [B[i] -> C[j]] -> C[i]; B[i] -> E[i] }",
+	  "{ A[i] -> E[2i]; A[i] -> C[i] }" },
+	{ "{ A[i] -> B[i] }", "{ C[i] -> D[i] }", "{ }" },
+};
 
-	D = "{Stmt_for_body24[i0, i1, i2, i3]:"
-		"i0 >= 0 and i0 <= 1 and i1 >= 0 and i1 <= 6 and i2 >= 2 and "
-		"i2 <= 6 - i1 and i3 >= 0 and i3 <= -1 + i2;"
-	     "Stmt_for_body24[i0, i1, 1, 0]:"
-		"i0 >= 0 and i0 <= 1 and i1 >= 0 and i1 <= 5;"
-	     "Stmt_for_body7[i0, i1, i2]:"
-		"i0 >= 0 and i0 <= 1 and i1 >= 0 and i1 <= 7 and i2 >= 0 and "
-		"i2 <= 7 }";
+/* Check that isl_union_map_apply_range and isl_union_map_apply_domain
+ * only combine maps with matching tuples and combine all of them.
+ */
+static int test_union_map_apply(isl_ctx *ctx)
+{
+	int i;
+	isl_union_map *umap1, *umap2, *res;
+	int equal;
 
-	V = "{Stmt_for_body24[0, i1, i2, i3] -> "
-		"Stmt_for_body24[1, i1, i2, i3]:"
-		"i3 >= 0 and i3 <= -1 + i2 and i1 >= 0 and i2 <= 6 - i1 and "
-		"i2 >= 1;"
-	     "Stmt_for_body24[0, i1, i2, i3] -> "
-		"Stmt_for_body7[1, 1 + i1 + i3, 1 + i1 + i2]:"
-		"i3 <= -1 + i2 and i2 <= 6 - i1 and i2 >= 1 and i1 >= 0 and "
-		"i3 >= 0;"
-	      "Stmt_for_body24[0, i1, i2, i3] ->"
-		"Stmt_for_body7[1, i1, 1 + i1 + i3]:"
-		"i3 >= 0 and i2 <= 6 - i1 and i1 >= 0 and i3 <= -1 + i2;"
-	      "Stmt_for_body7[0, i1, i2] -> Stmt_for_body7[1, i1, i2]:"
-		"(i2 >= 1 + i1 and i2 <= 6 and i1 >= 0 and i1 <= 4) or "
-		"(i2 >= 3 and i2 <= 7 and i1 >= 1 and i2 >= 1 + i1) or "
-		"(i2 >= 0 and i2 <= i1 and i2 >= -7 + i1 and i1 <= 7);"
-	      "Stmt_for_body7[0, i1, 1 + i1] -> Stmt_for_body7[1, i1, 1 + i1]:"
-		"i1 <= 6 and i1 >= 0;"
-	      "Stmt_for_body7[0, 0, 7] -> Stmt_for_body7[1, 0, 7];"
-	      "Stmt_for_body7[i0, i1, i2] -> "
-		"Stmt_for_body24[i0, o1, -1 + i2 - o1, -1 + i1 - o1]:"
-		"i0 >= 0 and i0 <= 1 and o1 >= 0 and i2 >= 1 + i1 and "
-		"o1 <= -2 + i2 and i2 <= 7 and o1 <= -1 + i1;"
-	      "Stmt_for_body7[i0, i1, i2] -> "
-		"Stmt_for_body24[i0, i1, o2, -1 - i1 + i2]:"
-		"i0 >= 0 and i0 <= 1 and i1 >= 0 and o2 >= -i1 + i2 and "
-		"o2 >= 1 and o2 <= 6 - i1 and i2 >= 1 + i1 }";
-	P = V;
-	S = "{ Stmt_for_body24[i0, i1, i2, i3] -> "
-		"[i0, 5i0 + i1, 6i0 + i1 + i2, 1 + 6i0 + i1 + i2 + i3, 1];"
-	    "Stmt_for_body7[i0, i1, i2] -> [0, 5i0, 6i0 + i1, 6i0 + i2, 0] }";
+	for (i = 0; i < ARRAY_SIZE(union_map_apply_tests); ++i) {
+		umap1 = isl_union_map_read_from_str(ctx,
+					union_map_apply_tests[i].umap1);
+		umap2 = isl_union_map_read_from_str(ctx,
+					union_map_apply_tests[i].umap2);
+		res = isl_union_map_read_from_str(ctx,
+					union_map_apply_tests[i].res);
+		umap1 = isl_union_map_apply_range(umap1, umap2);
+		equal = isl_union_map_is_equal(umap1, res);
+		isl_union_map_free(umap1);
+		if (equal >= 0 && equal) {
+			umap1 = isl_union_map_read_from_str(ctx,
+					union_map_apply_tests[i].umap1);
+			umap2 = isl_union_map_read_from_str(ctx,
+					union_map_apply_tests[i].umap2);
+			umap2 = isl_union_map_apply_domain(umap2,
+						isl_union_map_reverse(umap1));
+			equal = isl_union_map_is_equal(umap2, res);
+			isl_union_map_free(umap2);
+		}
+		isl_union_map_free(res);
+		if (equal < 0)
+			return -1;
+		if (!equal)
+			isl_die(ctx, isl_error_unknown,
+				"incorrect union map application", return -1);
+	}
 
-	if (test_special_schedule(ctx, D, V, P, S) < 0)
-		return -1;
+	return 0;
+}
 
-	D = "{ S_0[i, j] : i >= 1 and i <= 10 and j >= 1 and j <= 8 }";
-	V = "{ S_0[i, j] -> S_0[i, 1 + j] : i >= 1 and i <= 10 and "
-					   "j >= 1 and j <= 7;"
-		"S_0[i, j] -> S_0[1 + i, j] : i >= 1 and i <= 9 and "
-					     "j >= 1 and j <= 8 }";
-	P = "{ }";
-	S = "{ S_0[i, j] -> [i + j, j] }";
-	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_FEAUTRIER;
-	if (test_special_schedule(ctx, D, V, P, S) < 0)
-		return -1;
-	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_ISL;
+/* Check that isl_union_set_from_set_list and adding sets to
+ * a union set with reserved room produce the same result
+ * as adding the sets one by one, including when some of the sets
+ * live in the same space or have different parameters.
+ */
+static int test_union_set_from_list(isl_ctx *ctx)
+{
+	int i, n = 100;
+	char buf[100];
+	isl_set_list *list;
+	isl_union_set *uset1, *uset2, *uset3;
+	int equal;
 
-	/* Fig. 1 from Feautrier's "Some Efficient Solutions..." pt. 2, 1992 */
-	D = "[N] -> { S_0[i, j] : i >= 0 and i <= -1 + N and "
-				 "j >= 0 and j <= -1 + i }";
-	V = "[N] -> { S_0[i, j] -> S_0[i, 1 + j] : j <= -2 + i and "
-					"i <= -1 + N and j >= 0;"
-		     "S_0[i, -1 + i] -> S_0[1 + i, 0] : i >= 1 and "
-					"i <= -2 + N }";
-	P = "{ }";
-	S = "{ S_0[i, j] -> [i, j] }";
-	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_FEAUTRIER;
-	if (test_special_schedule(ctx, D, V, P, S) < 0)
-		return -1;
-	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_ISL;
+	list = isl_set_list_alloc(ctx, n + 2);
+	uset1 = isl_union_set_empty(isl_space_params_alloc(ctx, 0));
+	uset2 = isl_union_set_empty(isl_space_params_alloc(ctx, 0));
+	uset2 = isl_union_set_reserve(uset2, n + 2);
+	for (i = 0; i < n + 2; ++i) {
+		isl_set *set;
+
+		if (i < n)
+			snprintf(buf, sizeof(buf), "{ S%d[x] : 0 <= x <= %d }",
+				i, i);
+		else if (i == n)
+			snprintf(buf, sizeof(buf), "{ S0[x] : x = 5 }");
+		else
+			snprintf(buf, sizeof(buf),
+				"[N] -> { S1[x] : 10 <= x <= N }");
+		set = isl_set_read_from_str(ctx, buf);
+		list = isl_set_list_add(list, isl_set_copy(set));
+		uset1 = isl_union_set_add_set(uset1, isl_set_copy(set));
+		uset2 = isl_union_set_add_set(uset2, set);
+	}
+	uset3 = isl_union_set_from_set_list(list);
 
-	/* Test both algorithms on a case with only proximity dependences. */
-	D = "{ S[i,j] : 0 <= i <= 10 }";
-	V = "{ }";
-	P = "{ S[i,j] -> S[i+1,j] : 0 <= i,j <= 10 }";
-	S = "{ S[i, j] -> [j, i] }";
-	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_FEAUTRIER;
-	if (test_special_schedule(ctx, D, V, P, S) < 0)
-		return -1;
-	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_ISL;
-	if (test_special_schedule(ctx, D, V, P, S) < 0)
-		return -1;
-	
-	D = "{ A[a]; B[] }";
-	V = "{}";
-	P = "{ A[a] -> B[] }";
-	if (test_has_schedule(ctx, D, V, P) < 0)
+	equal = isl_union_set_is_equal(uset1, uset2);
+	if (equal >= 0 && equal)
+		equal = isl_union_set_is_equal(uset1, uset3);
+	if (equal >= 0 && equal)
+		equal = isl_union_set_n_set(uset3) == n;
+	isl_union_set_free(uset1);
+	isl_union_set_free(uset2);
+	isl_union_set_free(uset3);
+	if (equal < 0)
 		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected union set", return -1);
 
-	if (test_padded_schedule(ctx) < 0)
-		return -1;
+	return 0;
+}
 
-	/* Check that check for progress is not confused by rational
-	 * solution.
-	 */
-	D = "[N] -> { S0[i, j] : i >= 0 and i <= N and j >= 0 and j <= N }";
-	V = "[N] -> { S0[i0, -1 + N] -> S0[2 + i0, 0] : i0 >= 0 and "
-							"i0 <= -2 + N; "
-			"S0[i0, i1] -> S0[i0, 1 + i1] : i0 >= 0 and "
-				"i0 <= N and i1 >= 0 and i1 <= -1 + N }";
-	P = "{}";
-	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_FEAUTRIER;
-	if (test_has_schedule(ctx, D, V, P) < 0)
-		return -1;
-	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_ISL;
+/* Data used by collect_output.
+ * "fail" is set if the callback should fail.
+ */
+struct isl_test_output_data {
+	char *buf;
+	size_t len;
+	int n_call;
+	int fail;
+};
 
-	/* Check that we allow schedule rows that are only non-trivial
-	 * on some full-dimensional domains.
-	 */
-	D = "{ S1[j] : 0 <= j <= 1; S0[]; S2[k] : 0 <= k <= 1 }";
-	V = "{ S0[] -> S1[j] : 0 <= j <= 1; S2[0] -> S0[];"
-		"S1[j] -> S2[1] : 0 <= j <= 1 }";
-	P = "{}";
-	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_FEAUTRIER;
-	if (test_has_schedule(ctx, D, V, P) < 0)
-		return -1;
-	ctx->opt->schedule_algorithm = ISL_SCHEDULE_ALGORITHM_ISL;
+/* Append the "len" characters starting at "s" to data->buf.
+ */
+static int collect_output(const char *s, size_t len, void *user)
+{
+	struct isl_test_output_data *data = user;
+	char *buf;
 
-	if (test_conditional_schedule_constraints(ctx) < 0)
+	data->n_call++;
+	if (data->fail)
 		return -1;
-
+	buf = realloc(data->buf, data->len + len + 1);
+	if (!buf)
+		return -1;
+	data->buf = buf;
+	memcpy(data->buf + data->len, s, len);
+	data->len += len;
+	data->buf[data->len] = '\0';
 	return 0;
 }
 
-int test_plain_injective(isl_ctx *ctx, const char *str, int injective)
+/* Check that printing a large set to a callback printer produces
+ * the same output as printing it to a string printer and
+ * that the output is passed to the callback in several batches.
+ * Also check that a failure of the callback is reported.
+ */
+static int test_output_callback(isl_ctx *ctx)
 {
-	isl_union_map *umap;
-	int test;
+	struct isl_test_output_data data = { NULL, 0, 0, 0 };
+	int i, n = 4000, equal, on_error;
+	isl_printer *p;
+	isl_set *set;
+	char *s, *str;
+	char *pos;
+
+	str = malloc(40 * n + 10);
+	if (!str)
+		return -1;
+	pos = str + sprintf(str, "{ ");
+	for (i = 0; i < n; ++i)
+		pos += sprintf(pos, "[i, j] : i = %d and j >= %d; ", i, i);
+	sprintf(pos, "}");
+	set = isl_set_read_from_str(ctx, str);
+	free(str);
+
+	p = isl_printer_to_str(ctx);
+	p = isl_printer_print_set(p, set);
+	s = isl_printer_get_str(p);
+	isl_printer_free(p);
+
+	p = isl_printer_to_callback(ctx, &collect_output, &data);
+	p = isl_printer_print_set(p, set);
+	p = isl_printer_flush(p);
+	equal = p && s && data.buf ? !strcmp(s, data.buf) : -1;
+	isl_printer_free(p);
+	free(s);
+	free(data.buf);
+
+	on_error = isl_options_get_on_error(ctx);
+	isl_options_set_on_error(ctx, ISL_ON_ERROR_CONTINUE);
+	data.fail = 1;
+	p = isl_printer_to_callback(ctx, &collect_output, &data);
+	p = isl_printer_print_set(p, set);
+	p = isl_printer_flush(p);
+	isl_printer_free(p);
+	isl_options_set_on_error(ctx, on_error);
+	isl_set_free(set);
 
-	umap = isl_union_map_read_from_str(ctx, str);
-	test = isl_union_map_plain_is_injective(umap);
-	isl_union_map_free(umap);
-	if (test < 0)
+	if (equal < 0)
 		return -1;
-	if (test == injective)
-		return 0;
-	if (injective)
+	if (!equal)
+		isl_die(ctx, isl_error_unknown, "unexpected output",
+			return -1);
+	if (data.n_call < 3)
 		isl_die(ctx, isl_error_unknown,
-			"map not detected as injective", return -1);
-	else
+			"output not passed in batches", return -1);
+	if (p)
 		isl_die(ctx, isl_error_unknown,
-			"map detected as injective", return -1);
+			"callback failure not reported", return -1);
+	return 0;
 }
 
-int test_injective(isl_ctx *ctx)
+int test_output(isl_ctx *ctx)
 {
+	char *s;
 	const char *str;
+	isl_pw_aff *pa;
+	isl_printer *p;
+	int equal;
 
-	if (test_plain_injective(ctx, "{S[i,j] -> A[0]; T[i,j] -> B[1]}", 0))
-		return -1;
-	if (test_plain_injective(ctx, "{S[] -> A[0]; T[] -> B[0]}", 1))
-		return -1;
-	if (test_plain_injective(ctx, "{S[] -> A[0]; T[] -> A[1]}", 1))
-		return -1;
-	if (test_plain_injective(ctx, "{S[] -> A[0]; T[] -> A[0]}", 0))
-		return -1;
-	if (test_plain_injective(ctx, "{S[i] -> A[i,0]; T[i] -> A[i,1]}", 1))
-		return -1;
-	if (test_plain_injective(ctx, "{S[i] -> A[i]; T[i] -> A[i]}", 0))
-		return -1;
-	if (test_plain_injective(ctx, "{S[] -> A[0,0]; T[] -> A[0,1]}", 1))
-		return -1;
-	if (test_plain_injective(ctx, "{S[] -> A[0,0]; T[] -> A[1,0]}", 1))
-		return -1;
+	str = "[x] -> { [1] : x % 4 <= 2; [2] : x = 3 }";
+	pa = isl_pw_aff_read_from_str(ctx, str);
 
-	str = "{S[] -> A[0,0]; T[] -> A[0,1]; U[] -> A[1,0]}";
-	if (test_plain_injective(ctx, str, 1))
+	p = isl_printer_to_str(ctx);
+	p = isl_printer_set_output_format(p, ISL_FORMAT_C);
+	p = isl_printer_print_pw_aff(p, pa);
+	s = isl_printer_get_str(p);
+	isl_printer_free(p);
+	isl_pw_aff_free(pa);
+	if (!s)
+		equal = -1;
+	else
+		equal = !strcmp(s, "4 * floord(x, 4) + 2 >= x ? 1 : 2");
+	free(s);
+	if (equal < 0)
 		return -1;
-	str = "{S[] -> A[0,0]; T[] -> A[0,1]; U[] -> A[0,0]}";
-	if (test_plain_injective(ctx, str, 0))
+	if (!equal)
+		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+
+	if (test_output_callback(ctx) < 0)
 		return -1;
 
 	return 0;
 }
 
-static int aff_plain_is_equal(__isl_keep isl_aff *aff, const char *str)
+int test_sample(isl_ctx *ctx)
 {
-	isl_aff *aff2;
-	int equal;
+	const char *str;
+	isl_basic_set *bset1, *bset2;
+	int empty, subset;
 
-	if (!aff)
+	str = "{ [a, b, c, d, e, f, g, h, i, j, k] : "
+	    "3i >= 1073741823b - c - 1073741823e + f and c >= 0 and "
+	    "3i >= -1 + 3221225466b + c + d - 3221225466e - f and "
+	    "2e >= a - b and 3e <= 2a and 3k <= -a and f <= -1 + a and "
+	    "3i <= 4 - a + 4b + 2c - e - 2f and 3k <= -a + c - f and "
+	    "3h >= -2 + a and 3g >= -3 - a and 3k >= -2 - a and "
+	    "3i >= -2 - a - 2c + 3e + 2f and 3h <= a + c - f and "
+	    "3h >= a + 2147483646b + 2c - 2147483646e - 2f and "
+	    "3g <= -1 - a and 3i <= 1 + c + d - f and a <= 1073741823 and "
+	    "f >= 1 - a + 1073741822b + c + d - 1073741822e and "
+	    "3i >= 1 + 2b - 2c + e + 2f + 3g and "
+	    "1073741822f <= 1073741822 - a + 1073741821b + 1073741822c +"
+		"d - 1073741821e and "
+	    "3j <= 3 - a + 3b and 3g <= -2 - 2b + c + d - e - f and "
+	    "3j >= 1 - a + b + 2e and "
+	    "3f >= -3 + a + 3221225462b + 3c + d - 3221225465e and "
+	    "3i <= 4 - a + 4b - e and "
+	    "f <= 1073741822 + 1073741822b - 1073741822e and 3h <= a and "
+	    "f >= 0 and 2e <= 4 - a + 5b - d and 2e <= a - b + d and "
+	    "c <= -1 + a and 3i >= -2 - a + 3e and "
+	    "1073741822e <= 1073741823 - a + 1073741822b + c and "
+	    "3g >= -4 + 3221225464b + 3c + d - 3221225467e - 3f and "
+	    "3i >= -1 + 3221225466b + 3c + d - 3221225466e - 3f and "
+	    "1073741823e >= 1 + 1073741823b - d and "
+	    "3i >= 1073741823b + c - 1073741823e - f and "
+	    "3i >= 1 + 2b + e + 3g }";
+	bset1 = isl_basic_set_read_from_str(ctx, str);
+	bset2 = isl_basic_set_sample(isl_basic_set_copy(bset1));
+	empty = isl_basic_set_is_empty(bset2);
+	subset = isl_basic_set_is_subset(bset2, bset1);
+	isl_basic_set_free(bset1);
+	isl_basic_set_free(bset2);
+	if (empty < 0 || subset < 0)
 		return -1;
+	if (empty)
+		isl_die(ctx, isl_error_unknown, "point not found", return -1);
+	if (!subset)
+		isl_die(ctx, isl_error_unknown, "bad point found", return -1);
 
-	aff2 = isl_aff_read_from_str(isl_aff_get_ctx(aff), str);
-	equal = isl_aff_plain_is_equal(aff, aff2);
-	isl_aff_free(aff2);
-
-	return equal;
+	return 0;
 }
 
-static int aff_check_plain_equal(__isl_keep isl_aff *aff, const char *str)
+int test_fixed_power(isl_ctx *ctx)
 {
+	const char *str;
+	isl_map *map;
+	isl_int exp;
 	int equal;
 
-	equal = aff_plain_is_equal(aff, str);
+	isl_int_init(exp);
+	str = "{ [i] -> [i + 1] }";
+	map = isl_map_read_from_str(ctx, str);
+	isl_int_set_si(exp, 23);
+	map = isl_map_fixed_power(map, exp);
+	equal = map_check_equal(map, "{ [i] -> [i + 23] }");
+	isl_int_clear(exp);
+	isl_map_free(map);
 	if (equal < 0)
 		return -1;
-	if (!equal)
-		isl_die(isl_aff_get_ctx(aff), isl_error_unknown,
-			"result not as expected", return -1);
+
 	return 0;
 }
 
-struct {
-	__isl_give isl_aff *(*fn)(__isl_take isl_aff *aff1,
-				__isl_take isl_aff *aff2);
-} aff_bin_op[] = {
-	['+'] = { &isl_aff_add },
-	['-'] = { &isl_aff_sub },
-	['*'] = { &isl_aff_mul },
-	['/'] = { &isl_aff_div },
-};
+int test_slice(isl_ctx *ctx)
+{
+	const char *str;
+	isl_map *map;
+	int equal;
 
-struct {
-	const char *arg1;
-	unsigned char op;
-	const char *arg2;
-	const char *res;
-} aff_bin_tests[] = {
-	{ "{ [i] -> [i] }", '+', "{ [i] -> [i] }",
-	  "{ [i] -> [2i] }" },
-	{ "{ [i] -> [i] }", '-', "{ [i] -> [i] }",
-	  "{ [i] -> [0] }" },
-	{ "{ [i] -> [i] }", '*', "{ [i] -> [2] }",
-	  "{ [i] -> [2i] }" },
-	{ "{ [i] -> [2] }", '*', "{ [i] -> [i] }",
-	  "{ [i] -> [2i] }" },
-	{ "{ [i] -> [i] }", '/', "{ [i] -> [2] }",
-	  "{ [i] -> [i/2] }" },
-	{ "{ [i] -> [2i] }", '/', "{ [i] -> [2] }",
-	  "{ [i] -> [i] }" },
-	{ "{ [i] -> [i] }", '+', "{ [i] -> [NaN] }",
-	  "{ [i] -> [NaN] }" },
-	{ "{ [i] -> [i] }", '-', "{ [i] -> [NaN] }",
-	  "{ [i] -> [NaN] }" },
-	{ "{ [i] -> [i] }", '*', "{ [i] -> [NaN] }",
-	  "{ [i] -> [NaN] }" },
-	{ "{ [i] -> [2] }", '*', "{ [i] -> [NaN] }",
-	  "{ [i] -> [NaN] }" },
-	{ "{ [i] -> [i] }", '/', "{ [i] -> [NaN] }",
-	  "{ [i] -> [NaN] }" },
-	{ "{ [i] -> [2] }", '/', "{ [i] -> [NaN] }",
-	  "{ [i] -> [NaN] }" },
-	{ "{ [i] -> [NaN] }", '+', "{ [i] -> [i] }",
-	  "{ [i] -> [NaN] }" },
-	{ "{ [i] -> [NaN] }", '-', "{ [i] -> [i] }",
-	  "{ [i] -> [NaN] }" },
-	{ "{ [i] -> [NaN] }", '*', "{ [i] -> [2] }",
-	  "{ [i] -> [NaN] }" },
-	{ "{ [i] -> [NaN] }", '*', "{ [i] -> [i] }",
-	  "{ [i] -> [NaN] }" },
-	{ "{ [i] -> [NaN] }", '/', "{ [i] -> [2] }",
-	  "{ [i] -> [NaN] }" },
-	{ "{ [i] -> [NaN] }", '/', "{ [i] -> [i] }",
-	  "{ [i] -> [NaN] }" },
-};
+	str = "{ [i] -> [j] }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_equate(map, isl_dim_in, 0, isl_dim_out, 0);
+	equal = map_check_equal(map, "{ [i] -> [i] }");
+	isl_map_free(map);
+	if (equal < 0)
+		return -1;
 
-/* Perform some basic tests of binary operations on isl_aff objects.
- */
-static int test_bin_aff(isl_ctx *ctx)
-{
-	int i;
-	isl_aff *aff1, *aff2, *res;
-	__isl_give isl_aff *(*fn)(__isl_take isl_aff *aff1,
-				__isl_take isl_aff *aff2);
-	int ok;
+	str = "{ [i] -> [j] }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_equate(map, isl_dim_in, 0, isl_dim_in, 0);
+	equal = map_check_equal(map, "{ [i] -> [j] }");
+	isl_map_free(map);
+	if (equal < 0)
+		return -1;
 
-	for (i = 0; i < ARRAY_SIZE(aff_bin_tests); ++i) {
-		aff1 = isl_aff_read_from_str(ctx, aff_bin_tests[i].arg1);
-		aff2 = isl_aff_read_from_str(ctx, aff_bin_tests[i].arg2);
-		res = isl_aff_read_from_str(ctx, aff_bin_tests[i].res);
-		fn = aff_bin_op[aff_bin_tests[i].op].fn;
-		aff1 = fn(aff1, aff2);
-		if (isl_aff_is_nan(res))
-			ok = isl_aff_is_nan(aff1);
-		else
-			ok = isl_aff_plain_is_equal(aff1, res);
-		isl_aff_free(aff1);
-		isl_aff_free(res);
-		if (ok < 0)
-			return -1;
-		if (!ok)
-			isl_die(ctx, isl_error_unknown,
-				"unexpected result", return -1);
-	}
+	str = "{ [i] -> [j] }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_oppose(map, isl_dim_in, 0, isl_dim_out, 0);
+	equal = map_check_equal(map, "{ [i] -> [-i] }");
+	isl_map_free(map);
+	if (equal < 0)
+		return -1;
+
+	str = "{ [i] -> [j] }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_oppose(map, isl_dim_in, 0, isl_dim_in, 0);
+	equal = map_check_equal(map, "{ [0] -> [j] }");
+	isl_map_free(map);
+	if (equal < 0)
+		return -1;
+
+	str = "{ [i] -> [j] }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_order_gt(map, isl_dim_in, 0, isl_dim_out, 0);
+	equal = map_check_equal(map, "{ [i] -> [j] : i > j }");
+	isl_map_free(map);
+	if (equal < 0)
+		return -1;
+
+	str = "{ [i] -> [j] }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_order_gt(map, isl_dim_in, 0, isl_dim_in, 0);
+	equal = map_check_equal(map, "{ [i] -> [j] : false }");
+	isl_map_free(map);
+	if (equal < 0)
+		return -1;
 
 	return 0;
 }
 
-int test_aff(isl_ctx *ctx)
+/* Check that eliminating several variables at once from a rational
+ * basic map produces the same result as eliminating them one by one
+ * and that some redundant combinations get skipped along the way.
+ */
+static int test_eliminate_selected(isl_ctx *ctx)
 {
 	const char *str;
-	isl_set *set;
-	isl_space *space;
-	isl_local_space *ls;
-	isl_aff *aff;
-	int zero, equal;
+	isl_basic_map *bmap, *bmap1, *bmap2;
+	int elim[4] = { 0, 1, 1, 1 };
+	long pruned;
+	int equal;
 
-	if (test_bin_aff(ctx) < 0)
-		return -1;
+	str = "{ rat: [t] -> [x, y, z] : 0 <= x, y, z <= 1 and "
+		"x + y + z <= t <= x + y + z + 1 and t <= 2 + x - y + z }";
+	bmap = isl_basic_map_read_from_str(ctx, str);
+	pruned = isl_ctx_get_stat(ctx, "fm_pruned");
+	bmap1 = isl_basic_map_eliminate_selected_vars(
+					isl_basic_map_copy(bmap), elim);
+	if (bmap1 && isl_ctx_get_stat(ctx, "fm_pruned") == pruned)
+		isl_die(ctx, isl_error_unknown, "no combinations pruned",
+			bmap1 = isl_basic_map_free(bmap1));
+	bmap2 = isl_basic_map_copy(bmap);
+	bmap2 = isl_basic_map_eliminate(bmap2, isl_dim_out, 2, 1);
+	bmap2 = isl_basic_map_eliminate(bmap2, isl_dim_out, 1, 1);
+	bmap2 = isl_basic_map_eliminate(bmap2, isl_dim_out, 0, 1);
+	equal = isl_basic_map_is_equal(bmap1, bmap2);
+	isl_basic_map_free(bmap1);
+	isl_basic_map_free(bmap2);
 
-	space = isl_space_set_alloc(ctx, 0, 1);
-	ls = isl_local_space_from_space(space);
-	aff = isl_aff_zero_on_domain(ls);
+	elim[2] = 0;
+	bmap1 = isl_basic_map_eliminate_selected_vars(
+					isl_basic_map_copy(bmap), elim);
+	bmap2 = isl_basic_map_copy(bmap);
+	bmap2 = isl_basic_map_eliminate(bmap2, isl_dim_out, 2, 1);
+	bmap2 = isl_basic_map_eliminate(bmap2, isl_dim_out, 0, 1);
+	if (equal >= 0 && equal)
+		equal = isl_basic_map_is_equal(bmap1, bmap2);
+	isl_basic_map_free(bmap1);
+	isl_basic_map_free(bmap2);
+	isl_basic_map_free(bmap);
 
-	aff = isl_aff_add_coefficient_si(aff, isl_dim_in, 0, 1);
-	aff = isl_aff_scale_down_ui(aff, 3);
-	aff = isl_aff_floor(aff);
-	aff = isl_aff_add_coefficient_si(aff, isl_dim_in, 0, 1);
-	aff = isl_aff_scale_down_ui(aff, 2);
-	aff = isl_aff_floor(aff);
-	aff = isl_aff_add_coefficient_si(aff, isl_dim_in, 0, 1);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected result of elimination", return -1);
 
-	str = "{ [10] }";
-	set = isl_set_read_from_str(ctx, str);
-	aff = isl_aff_gist(aff, set);
+	return 0;
+}
 
-	aff = isl_aff_add_constant_si(aff, -16);
-	zero = isl_aff_plain_is_zero(aff);
-	isl_aff_free(aff);
+int test_eliminate(isl_ctx *ctx)
+{
+	const char *str;
+	isl_map *map;
+	int equal;
 
-	if (zero < 0)
+	str = "{ [i] -> [j] : i = 2j }";
+	map = isl_map_read_from_str(ctx, str);
+	map = isl_map_eliminate(map, isl_dim_out, 0, 1);
+	equal = map_check_equal(map, "{ [i] -> [j] : exists a : i = 2a }");
+	isl_map_free(map);
+	if (equal < 0)
 		return -1;
-	if (!zero)
-		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
 
-	aff = isl_aff_read_from_str(ctx, "{ [-1] }");
-	aff = isl_aff_scale_down_ui(aff, 64);
-	aff = isl_aff_floor(aff);
-	equal = aff_check_plain_equal(aff, "{ [-1] }");
-	isl_aff_free(aff);
-	if (equal < 0)
+	if (test_eliminate_selected(ctx) < 0)
 		return -1;
 
 	return 0;
 }
 
-int test_dim_max(isl_ctx *ctx)
+/* Check that isl_set_dim_residue_class detects that the values of j
+ * in the set below are all odd and that it does not detect any spurious
+ * strides.
+ */
+static int test_residue_class(isl_ctx *ctx)
 {
-	int equal;
 	const char *str;
-	isl_set *set1, *set2;
 	isl_set *set;
-	isl_map *map;
-	isl_pw_aff *pwaff;
+	isl_int m, r;
+	int res;
 
-	str = "[N] -> { [i] : 0 <= i <= min(N,10) }";
+	str = "{ [i,j] : j = 4 i + 1 and 0 <= i <= 100; "
+		"[i,j] : j = 4 i + 3 and 500 <= i <= 600 }";
 	set = isl_set_read_from_str(ctx, str);
-	pwaff = isl_set_dim_max(set, 0);
-	set1 = isl_set_from_pw_aff(pwaff);
-	str = "[N] -> { [10] : N >= 10; [N] : N <= 9 and N >= 0 }";
-	set2 = isl_set_read_from_str(ctx, str);
-	equal = isl_set_is_equal(set1, set2);
+	isl_int_init(m);
+	isl_int_init(r);
+	res = isl_set_dim_residue_class(set, 1, &m, &r);
+	if (res >= 0 &&
+	    (isl_int_cmp_si(m, 2) != 0 || isl_int_cmp_si(r, 1) != 0))
+		isl_die(ctx, isl_error_unknown, "incorrect residue class",
+			res = -1);
+	isl_int_clear(r);
+	isl_int_clear(m);
+	isl_set_free(set);
+
+	return res;
+}
+
+/* Check that repeatedly aligning sets with the same parameters
+ * reuses the earlier alignments and still produces correct results.
+ */
+static int test_align_parameters_cache(isl_ctx *ctx)
+{
+	int i;
+	long hits;
+	isl_set *set1, *set2, *set;
+	int equal = 1;
+
+	set1 = isl_set_read_from_str(ctx, "[M, N] -> { [i] : M <= i <= N }");
+	set2 = isl_set_read_from_str(ctx, "[N, K] -> { [i] : 0 <= i <= K }");
+	hits = isl_ctx_get_stat(ctx, "reordering_cache_hits");
+	for (i = 0; equal == 1 && i < 3; ++i) {
+		isl_set *expected;
+
+		set = isl_set_intersect(isl_set_copy(set1),
+					isl_set_copy(set2));
+		expected = isl_set_read_from_str(ctx,
+			"[M, N, K] -> { [i] : M <= i <= N and 0 <= i <= K }");
+		equal = isl_set_is_equal(set, expected);
+		isl_set_free(set);
+		isl_set_free(expected);
+	}
 	isl_set_free(set1);
 	isl_set_free(set2);
+
 	if (equal < 0)
 		return -1;
 	if (!equal)
-		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+		isl_die(ctx, isl_error_unknown,
+			"result not as expected", return -1);
+	if (isl_ctx_get_stat(ctx, "reordering_cache_hits") <= hits)
+		isl_die(ctx, isl_error_unknown,
+			"alignments not reused", return -1);
+
+	return 0;
+}
+
+int test_align_parameters(isl_ctx *ctx)
+{
+	const char *str;
+	isl_space *space;
+	isl_multi_aff *ma1, *ma2;
+	int equal;
+
+	str = "{ A[B[] -> C[]] -> D[E[] -> F[]] }";
+	ma1 = isl_multi_aff_read_from_str(ctx, str);
+
+	space = isl_space_params_alloc(ctx, 1);
+	space = isl_space_set_dim_name(space, isl_dim_param, 0, "N");
+	ma1 = isl_multi_aff_align_params(ma1, space);
+
+	str = "[N] -> { A[B[] -> C[]] -> D[E[] -> F[]] }";
+	ma2 = isl_multi_aff_read_from_str(ctx, str);
+
+	equal = isl_multi_aff_plain_is_equal(ma1, ma2);
+
+	isl_multi_aff_free(ma1);
+	isl_multi_aff_free(ma2);
 
-	str = "[N] -> { [i] : 0 <= i <= max(2N,N+6) }";
-	set = isl_set_read_from_str(ctx, str);
-	pwaff = isl_set_dim_max(set, 0);
-	set1 = isl_set_from_pw_aff(pwaff);
-	str = "[N] -> { [6 + N] : -6 <= N <= 5; [2N] : N >= 6 }";
-	set2 = isl_set_read_from_str(ctx, str);
-	equal = isl_set_is_equal(set1, set2);
-	isl_set_free(set1);
-	isl_set_free(set2);
 	if (equal < 0)
 		return -1;
 	if (!equal)
-		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+		isl_die(ctx, isl_error_unknown,
+			"result not as expected", return -1);
 
-	str = "[N] -> { [i] : 0 <= i <= 2N or 0 <= i <= N+6 }";
-	set = isl_set_read_from_str(ctx, str);
-	pwaff = isl_set_dim_max(set, 0);
-	set1 = isl_set_from_pw_aff(pwaff);
-	str = "[N] -> { [6 + N] : -6 <= N <= 5; [2N] : N >= 6 }";
-	set2 = isl_set_read_from_str(ctx, str);
-	equal = isl_set_is_equal(set1, set2);
-	isl_set_free(set1);
-	isl_set_free(set2);
-	if (equal < 0)
+	if (test_align_parameters_cache(ctx) < 0)
 		return -1;
-	if (!equal)
-		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
 
-	str = "[N,M] -> { [i,j] -> [([i/16]), i%16, ([j/16]), j%16] : "
-			"0 <= i < N and 0 <= j < M }";
-	map = isl_map_read_from_str(ctx, str);
-	set = isl_map_range(map);
+	return 0;
+}
 
-	pwaff = isl_set_dim_max(isl_set_copy(set), 0);
-	set1 = isl_set_from_pw_aff(pwaff);
-	str = "[N,M] -> { [([(N-1)/16])] : M,N > 0 }";
-	set2 = isl_set_read_from_str(ctx, str);
-	equal = isl_set_is_equal(set1, set2);
-	isl_set_free(set1);
-	isl_set_free(set2);
+/* Check that the names of the identifiers in "list" are
+ * those in the string "names", each name consisting of a single character.
+ */
+static int check_id_list(__isl_keep isl_id_list *list, const char *names)
+{
+	int i, n;
+	int ok = 1;
 
-	pwaff = isl_set_dim_max(isl_set_copy(set), 3);
-	set1 = isl_set_from_pw_aff(pwaff);
-	str = "[N,M] -> { [t] : t = min(M-1,15) and M,N > 0 }";
-	set2 = isl_set_read_from_str(ctx, str);
-	if (equal >= 0 && equal)
-		equal = isl_set_is_equal(set1, set2);
-	isl_set_free(set1);
-	isl_set_free(set2);
+	if (!list)
+		return -1;
+	n = isl_id_list_n_id(list);
+	ok = n == strlen(names);
+	for (i = 0; ok && i < n; ++i) {
+		isl_id *id = isl_id_list_get_id(list, i);
+		const char *name = isl_id_get_name(id);
 
-	isl_set_free(set);
+		ok = name && name[0] == names[i] && !name[1];
+		isl_id_free(id);
+	}
+	if (!ok)
+		isl_die(isl_id_list_get_ctx(list), isl_error_unknown,
+			"unexpected elements in list", return -1);
+	return 0;
+}
 
-	if (equal < 0)
-		return -1;
-	if (!equal)
-		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+/* Replace "id" by an identifier with the next letter as name.
+ */
+static __isl_give isl_id *next_letter(__isl_take isl_id *id, void *user)
+{
+	isl_ctx *ctx = isl_id_get_ctx(id);
+	char name[2] = { 0 };
 
-	/* Check that solutions are properly merged. */
-	str = "[n] -> { [a, b, c] : c >= -4a - 2b and "
-				"c <= -1 + n - 4a - 2b and c >= -2b and "
-				"4a >= -4 + n and c >= 0 }";
-	set = isl_set_read_from_str(ctx, str);
-	pwaff = isl_set_dim_min(set, 2);
-	set1 = isl_set_from_pw_aff(pwaff);
-	str = "[n] -> { [(0)] : n >= 1 }";
-	set2 = isl_set_read_from_str(ctx, str);
-	equal = isl_set_is_equal(set1, set2);
-	isl_set_free(set1);
-	isl_set_free(set2);
+	name[0] = isl_id_get_name(id)[0] + 1;
+	isl_id_free(id);
+	return isl_id_alloc(ctx, name, NULL);
+}
+
+/* Perform some tests on the operations that move elements
+ * into or out of lists, starting from the list "list" with elements
+ * a, c and d.
+ * In particular, concatenating a list with itself should
+ * not move elements out of the list that is being extended.
+ */
+static int test_list_move(isl_ctx *ctx, __isl_take isl_id_list *list)
+{
+	isl_id *id;
+
+	list = isl_id_list_reserve(list, 100);
+	list = isl_id_list_swap(list, 0, 2);
+	if (check_id_list(list, "dca") < 0)
+		goto error;
+	list = isl_id_list_concat(list, isl_id_list_copy(list));
+	if (check_id_list(list, "dcadca") < 0)
+		goto error;
+	list = isl_id_list_take_id(list, 1, &id);
+	list = isl_id_list_add(list, id);
+	if (check_id_list(list, "dadcac") < 0)
+		goto error;
+	list = isl_id_list_map(list, &next_letter, NULL);
+	if (check_id_list(list, "ebedbd") < 0)
+		goto error;
+	id = isl_id_list_get_id(list, 1);
+	list = isl_id_list_insert(list, 0, id);
+	if (check_id_list(list, "bebedbd") < 0)
+		goto error;
+
+	isl_id_list_free(list);
+	return 0;
+error:
+	isl_id_list_free(list);
+	return -1;
+}
+
+static int test_list(isl_ctx *ctx)
+{
+	isl_id *a, *b, *c, *d, *id;
+	isl_id_list *list;
+	int ok;
+
+	a = isl_id_alloc(ctx, "a", NULL);
+	b = isl_id_alloc(ctx, "b", NULL);
+	c = isl_id_alloc(ctx, "c", NULL);
+	d = isl_id_alloc(ctx, "d", NULL);
+
+	list = isl_id_list_alloc(ctx, 4);
+	list = isl_id_list_add(list, a);
+	list = isl_id_list_add(list, b);
+	list = isl_id_list_add(list, c);
+	list = isl_id_list_add(list, d);
+	list = isl_id_list_drop(list, 1, 1);
+
+	if (isl_id_list_n_id(list) != 3) {
+		isl_id_list_free(list);
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of elements in list", return -1);
+	}
+
+	id = isl_id_list_get_id(list, 0);
+	ok = id == a;
+	isl_id_free(id);
+	id = isl_id_list_get_id(list, 1);
+	ok = ok && id == c;
+	isl_id_free(id);
+	id = isl_id_list_get_id(list, 2);
+	ok = ok && id == d;
+	isl_id_free(id);
+
+	if (!ok) {
+		isl_id_list_free(list);
+		isl_die(ctx, isl_error_unknown,
+			"unexpected elements in list", return -1);
+	}
 
-	if (equal < 0)
-		return -1;
-	if (!equal)
-		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+	return test_list_move(ctx, list);
+}
 
-	/* Check that empty solution lie in the right space. */
-	str = "[n] -> { [t,a] : 1 = 0 }";
-	set = isl_set_read_from_str(ctx, str);
-	pwaff = isl_set_dim_max(set, 0);
-	set1 = isl_set_from_pw_aff(pwaff);
-	str = "[n] -> { [t] : 1 = 0 }";
-	set2 = isl_set_read_from_str(ctx, str);
-	equal = isl_set_is_equal(set1, set2);
-	isl_set_free(set1);
-	isl_set_free(set2);
+/* Data used in the constraint view test.
+ * "list" contains the constraints produced by
+ * isl_basic_set_foreach_constraint and "n" is the number of views
+ * that have been compared so far.  "kept" is a reference
+ * to the first view.
+ */
+struct isl_test_view_data {
+	isl_constraint_list *list;
+	int n;
+	isl_constraint *kept;
+};
 
-	if (equal < 0)
-		return -1;
-	if (!equal)
-		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+static int collect_constraint(__isl_take isl_constraint *c, void *user)
+{
+	isl_constraint_list **list = user;
 
-	return 0;
+	*list = isl_constraint_list_add(*list, c);
+	return *list ? 0 : -1;
 }
 
-/* Is "pma" obviously equal to the isl_pw_multi_aff represented by "str"?
+/* Check that the view "c" is equal to the next constraint in data->list
+ * and keep a reference to the first view.
  */
-static int pw_multi_aff_plain_is_equal(__isl_keep isl_pw_multi_aff *pma,
-	const char *str)
+static int check_view(__isl_keep isl_constraint *c, void *user)
 {
-	isl_ctx *ctx;
-	isl_pw_multi_aff *pma2;
+	struct isl_test_view_data *data = user;
+	isl_constraint *c2;
 	int equal;
 
-	if (!pma)
-		return -1;
-
-	ctx = isl_pw_multi_aff_get_ctx(pma);
-	pma2 = isl_pw_multi_aff_read_from_str(ctx, str);
-	equal = isl_pw_multi_aff_plain_is_equal(pma, pma2);
-	isl_pw_multi_aff_free(pma2);
+	c2 = isl_constraint_list_get_constraint(data->list, data->n++);
+	equal = isl_constraint_is_equal(c, c2);
+	isl_constraint_free(c2);
+	if (!equal)
+		isl_die(isl_constraint_get_ctx(c), isl_error_unknown,
+			"unexpected constraint view", return -1);
+	if (!data->kept)
+		data->kept = isl_constraint_copy(c);
 
-	return equal;
+	return 0;
 }
 
-/* Check that "pma" is obviously equal to the isl_pw_multi_aff
- * represented by "str".
+/* Check that isl_basic_set_foreach_constraint_view passes
+ * the same constraints as isl_basic_set_foreach_constraint and
+ * that a reference to a view that is kept beyond the callback
+ * is not affected by the subsequent views.
  */
-static int pw_multi_aff_check_plain_equal(__isl_keep isl_pw_multi_aff *pma,
-	const char *str)
+static int test_constraint_view(isl_ctx *ctx)
 {
-	int equal;
+	const char *str;
+	isl_basic_set *bset;
+	isl_constraint *c;
+	struct isl_test_view_data data = { NULL, 0, NULL };
+	int r, equal;
+
+	str = "[n] -> { [i, j] : exists a : i = 2a and 0 <= i <= n and "
+		"i <= j <= n + 5 }";
+	bset = isl_basic_set_read_from_str(ctx, str);
+	data.list = isl_constraint_list_alloc(ctx, 0);
+	r = isl_basic_set_foreach_constraint(bset, &collect_constraint,
+						&data.list);
+	if (r >= 0)
+		r = isl_basic_set_foreach_constraint_view(bset, &check_view,
+							&data);
+	isl_basic_set_free(bset);
+	c = isl_constraint_list_get_constraint(data.list, 0);
+	equal = r < 0 ? -1 : isl_constraint_is_equal(c, data.kept);
+	if (r >= 0 && data.n != isl_constraint_list_n_constraint(data.list))
+		equal = 0;
+	isl_constraint_free(c);
+	isl_constraint_free(data.kept);
+	isl_constraint_list_free(data.list);
 
-	equal = pw_multi_aff_plain_is_equal(pma, str);
 	if (equal < 0)
 		return -1;
 	if (!equal)
-		isl_die(isl_pw_multi_aff_get_ctx(pma), isl_error_unknown,
-			"result not as expected", return -1);
+		isl_die(ctx, isl_error_unknown,
+			"constraint views not consistent", return -1);
+
 	return 0;
 }
 
-/* Basic test for isl_pw_multi_aff_product.
- *
- * Check that multiple pieces are properly handled.
+static int count_peek_basic_set(__isl_keep isl_basic_set *bset, void *user)
+{
+	int *n = user;
+
+	(*n)++;
+	return bset ? 0 : -1;
+}
+
+static int count_peek_set(__isl_keep isl_set *set, void *user)
+{
+	return isl_set_foreach_basic_set_peek(set, &count_peek_basic_set, user);
+}
+
+/* Check that isl_union_set_foreach_set_peek and
+ * isl_set_foreach_basic_set_peek visit all basic sets.
  */
-static int test_product_pma(isl_ctx *ctx)
+static int test_foreach_peek(isl_ctx *ctx)
 {
-	int equal;
 	const char *str;
-	isl_pw_multi_aff *pma1, *pma2;
+	isl_union_set *uset;
+	int n = 0;
+	int r;
 
-	str = "{ A[i] -> B[1] : i < 0; A[i] -> B[2] : i >= 0 }";
-	pma1 = isl_pw_multi_aff_read_from_str(ctx, str);
-	str = "{ C[] -> D[] }";
-	pma2 = isl_pw_multi_aff_read_from_str(ctx, str);
-	pma1 = isl_pw_multi_aff_product(pma1, pma2);
-	str = "{ [A[i] -> C[]] -> [B[(1)] -> D[]] : i < 0;"
-		"[A[i] -> C[]] -> [B[(2)] -> D[]] : i >= 0 }";
-	equal = pw_multi_aff_check_plain_equal(pma1, str);
-	isl_pw_multi_aff_free(pma1);
-	if (equal < 0)
+	str = "{ A[i] : 0 <= i <= 10 or 20 <= i <= 30; B[i, j] : i = j; "
+		"C[] }";
+	uset = isl_union_set_read_from_str(ctx, str);
+	r = isl_union_set_foreach_set_peek(uset, &count_peek_set, &n);
+	isl_union_set_free(uset);
+	if (r < 0)
 		return -1;
+	if (n != 4)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of basic sets", return -1);
 
 	return 0;
 }
 
-int test_product(isl_ctx *ctx)
+const char *set_conversion_tests[] = {
+	"[N] -> { [i] : N - 1 <= 2 i <= N }",
+	"[N] -> { [i] : exists a : i = 4 a and N - 1 <= i <= N }",
+	"[N] -> { [i,j] : exists a : i = 4 a and N - 1 <= i, 2j <= N }",
+	"[N] -> { [[i]->[j]] : exists a : i = 4 a and N - 1 <= i, 2j <= N }",
+	"[N] -> { [3*floor(N/2) + 5*floor(N/3)] }",
+};
+
+/* Check that converting from isl_set to isl_pw_multi_aff and back
+ * to isl_set produces the original isl_set.
+ */
+static int test_set_conversion(isl_ctx *ctx)
 {
+	int i;
 	const char *str;
-	isl_set *set;
-	isl_union_set *uset1, *uset2;
-	int ok;
-
-	str = "{ A[i] }";
-	set = isl_set_read_from_str(ctx, str);
-	set = isl_set_product(set, isl_set_copy(set));
-	ok = isl_set_is_wrapping(set);
-	isl_set_free(set);
-	if (ok < 0)
-		return -1;
-	if (!ok)
-		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+	isl_set *set1, *set2;
+	isl_pw_multi_aff *pma;
+	int equal;
 
-	str = "{ [] }";
-	uset1 = isl_union_set_read_from_str(ctx, str);
-	uset1 = isl_union_set_product(uset1, isl_union_set_copy(uset1));
-	str = "{ [[] -> []] }";
-	uset2 = isl_union_set_read_from_str(ctx, str);
-	ok = isl_union_set_is_equal(uset1, uset2);
-	isl_union_set_free(uset1);
-	isl_union_set_free(uset2);
-	if (ok < 0)
-		return -1;
-	if (!ok)
-		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+	for (i = 0; i < ARRAY_SIZE(set_conversion_tests); ++i) {
+		str = set_conversion_tests[i];
+		set1 = isl_set_read_from_str(ctx, str);
+		pma = isl_pw_multi_aff_from_set(isl_set_copy(set1));
+		set2 = isl_set_from_pw_multi_aff(pma);
+		equal = isl_set_is_equal(set1, set2);
+		isl_set_free(set1);
+		isl_set_free(set2);
 
-	if (test_product_pma(ctx) < 0)
-		return -1;
+		if (equal < 0)
+			return -1;
+		if (!equal)
+			isl_die(ctx, isl_error_unknown, "bad conversion",
+				return -1);
+	}
 
 	return 0;
 }
 
-/* Check that two sets are not considered disjoint just because
- * they have a different set of (named) parameters.
+/* Check that converting from isl_map to isl_pw_multi_aff and back
+ * to isl_map produces the original isl_map.
  */
-static int test_disjoint(isl_ctx *ctx)
+static int test_map_conversion(isl_ctx *ctx)
 {
 	const char *str;
-	isl_set *set, *set2;
-	int disjoint;
+	isl_map *map1, *map2;
+	isl_pw_multi_aff *pma;
+	int equal;
 
-	str = "[n] -> { [[]->[]] }";
-	set = isl_set_read_from_str(ctx, str);
-	str = "{ [[]->[]] }";
-	set2 = isl_set_read_from_str(ctx, str);
-	disjoint = isl_set_is_disjoint(set, set2);
-	isl_set_free(set);
-	isl_set_free(set2);
-	if (disjoint < 0)
+	str = "{ [a, b, c, d] -> s0[a, b, e, f] : "
+		"exists (e0 = [(a - 2c)/3], e1 = [(-4 + b - 5d)/9], "
+		"e2 = [(-d + f)/9]: 3e0 = a - 2c and 9e1 = -4 + b - 5d and "
+		"9e2 = -d + f and f >= 0 and f <= 8 and 9e >= -5 - 2a and "
+		"9e <= -2 - 2a) }";
+	map1 = isl_map_read_from_str(ctx, str);
+	pma = isl_pw_multi_aff_from_map(isl_map_copy(map1));
+	map2 = isl_map_from_pw_multi_aff(pma);
+	equal = isl_map_is_equal(map1, map2);
+	isl_map_free(map1);
+	isl_map_free(map2);
+
+	if (equal < 0)
 		return -1;
-	if (disjoint)
-		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+	if (!equal)
+		isl_die(ctx, isl_error_unknown, "bad conversion", return -1);
 
 	return 0;
 }
 
-int test_equal(isl_ctx *ctx)
+static int test_conversion(isl_ctx *ctx)
+{
+	if (test_set_conversion(ctx) < 0)
+		return -1;
+	if (test_map_conversion(ctx) < 0)
+		return -1;
+	return 0;
+}
+
+/* Check that isl_basic_map_curry does not modify input.
+ */
+static int test_curry(isl_ctx *ctx)
 {
 	const char *str;
-	isl_set *set, *set2;
+	isl_basic_map *bmap1, *bmap2;
 	int equal;
 
-	str = "{ S_6[i] }";
-	set = isl_set_read_from_str(ctx, str);
-	str = "{ S_7[i] }";
-	set2 = isl_set_read_from_str(ctx, str);
-	equal = isl_set_is_equal(set, set2);
-	isl_set_free(set);
-	isl_set_free(set2);
+	str = "{ [A[] -> B[]] -> C[] }";
+	bmap1 = isl_basic_map_read_from_str(ctx, str);
+	bmap2 = isl_basic_map_curry(isl_basic_map_copy(bmap1));
+	equal = isl_basic_map_is_equal(bmap1, bmap2);
+	isl_basic_map_free(bmap1);
+	isl_basic_map_free(bmap2);
+
 	if (equal < 0)
 		return -1;
 	if (equal)
-		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+		isl_die(ctx, isl_error_unknown,
+			"curried map should not be equal to original",
+			return -1);
+
+	return 0;
+}
+
+struct {
+	const char *set;
+	const char *ma;
+	const char *res;
+} preimage_tests[] = {
+	{ "{ B[i,j] : 0 <= i < 10 and 0 <= j < 100 }",
+	  "{ A[j,i] -> B[i,j] }",
+	  "{ A[j,i] : 0 <= i < 10 and 0 <= j < 100 }" },
+	{ "{ rat: B[i,j] : 0 <= i, j and 3 i + 5 j <= 100 }",
+	  "{ A[a,b] -> B[a/2,b/6] }",
+	  "{ rat: A[a,b] : 0 <= a, b and 9 a + 5 b <= 600 }" },
+	{ "{ B[i,j] : 0 <= i, j and 3 i + 5 j <= 100 }",
+	  "{ A[a,b] -> B[a/2,b/6] }",
+	  "{ A[a,b] : 0 <= a, b and 9 a + 5 b <= 600 and "
+		    "exists i,j : a = 2 i and b = 6 j }" },
+	{ "[n] -> { S[i] : 0 <= i <= 100 }", "[n] -> { S[n] }",
+	  "[n] -> { : 0 <= n <= 100 }" },
+	{ "{ B[i] : 0 <= i < 100 and exists a : i = 4 a }",
+	  "{ A[a] -> B[2a] }",
+	  "{ A[a] : 0 <= a < 50 and exists b : a = 2 b }" },
+	{ "{ B[i] : 0 <= i < 100 and exists a : i = 4 a }",
+	  "{ A[a] -> B[([a/2])] }",
+	  "{ A[a] : 0 <= a < 200 and exists b : [a/2] = 4 b }" },
+	{ "{ B[i,j,k] : 0 <= i,j,k <= 100 }",
+	  "{ A[a] -> B[a,a,a/3] }",
+	  "{ A[a] : 0 <= a <= 100 and exists b : a = 3 b }" },
+	{ "{ B[i,j] : j = [(i)/2] } ", "{ A[i,j] -> B[i/3,j] }",
+	  "{ A[i,j] : j = [(i)/6] and exists a : i = 3 a }" },
+};
+
+static int test_preimage_basic_set(isl_ctx *ctx)
+{
+	int i;
+	isl_basic_set *bset1, *bset2;
+	isl_multi_aff *ma;
+	int equal;
+
+	for (i = 0; i < ARRAY_SIZE(preimage_tests); ++i) {
+		bset1 = isl_basic_set_read_from_str(ctx, preimage_tests[i].set);
+		ma = isl_multi_aff_read_from_str(ctx, preimage_tests[i].ma);
+		bset2 = isl_basic_set_read_from_str(ctx, preimage_tests[i].res);
+		bset1 = isl_basic_set_preimage_multi_aff(bset1, ma);
+		equal = isl_basic_set_is_equal(bset1, bset2);
+		isl_basic_set_free(bset1);
+		isl_basic_set_free(bset2);
+		if (equal < 0)
+			return -1;
+		if (!equal)
+			isl_die(ctx, isl_error_unknown, "bad preimage",
+				return -1);
+	}
 
 	return 0;
 }
 
-static int test_plain_fixed(isl_ctx *ctx, __isl_take isl_map *map,
-	enum isl_dim_type type, unsigned pos, int fixed)
+struct {
+	const char *map;
+	const char *ma;
+	const char *res;
+} preimage_domain_tests[] = {
+	{ "{ B[i,j] -> C[2i + 3j] : 0 <= i < 10 and 0 <= j < 100 }",
+	  "{ A[j,i] -> B[i,j] }",
+	  "{ A[j,i] -> C[2i + 3j] : 0 <= i < 10 and 0 <= j < 100 }" },
+	{ "{ B[i] -> C[i]; D[i] -> E[i] }",
+	  "{ A[i] -> B[i + 1] }",
+	  "{ A[i] -> C[i + 1] }" },
+	{ "{ B[i] -> C[i]; B[i] -> E[i] }",
+	  "{ A[i] -> B[i + 1] }",
+	  "{ A[i] -> C[i + 1]; A[i] -> E[i + 1] }" },
+	{ "{ B[i] -> C[([i/2])] }",
+	  "{ A[i] -> B[2i] }",
+	  "{ A[i] -> C[i] }" },
+	{ "{ B[i,j] -> C[([i/2]), ([(i+j)/3])] }",
+	  "{ A[i] -> B[([i/5]), ([i/7])] }",
+	  "{ A[i] -> C[([([i/5])/2]), ([(([i/5])+([i/7]))/3])] }" },
+	{ "[N] -> { B[i] -> C[([N/2]), i, ([N/3])] }",
+	  "[N] -> { A[] -> B[([N/5])] }",
+	  "[N] -> { A[] -> C[([N/2]), ([N/5]), ([N/3])] }" },
+	{ "{ B[i] -> C[i] : exists a : i = 5 a }",
+	  "{ A[i] -> B[2i] }",
+	  "{ A[i] -> C[2i] : exists a : 2i = 5 a }" },
+	{ "{ B[i] -> C[i] : exists a : i = 2 a; "
+	    "B[i] -> D[i] : exists a : i = 2 a + 1 }",
+	  "{ A[i] -> B[2i] }",
+	  "{ A[i] -> C[2i] }" },
+};
+
+static int test_preimage_union_map(isl_ctx *ctx)
 {
-	int test;
+	int i;
+	isl_union_map *umap1, *umap2;
+	isl_multi_aff *ma;
+	int equal;
 
-	test = isl_map_plain_is_fixed(map, type, pos, NULL);
-	isl_map_free(map);
-	if (test < 0)
-		return -1;
-	if (test == fixed)
-		return 0;
-	if (fixed)
-		isl_die(ctx, isl_error_unknown,
-			"map not detected as fixed", return -1);
-	else
-		isl_die(ctx, isl_error_unknown,
-			"map detected as fixed", return -1);
+	for (i = 0; i < ARRAY_SIZE(preimage_domain_tests); ++i) {
+		umap1 = isl_union_map_read_from_str(ctx,
+						preimage_domain_tests[i].map);
+		ma = isl_multi_aff_read_from_str(ctx,
+						preimage_domain_tests[i].ma);
+		umap2 = isl_union_map_read_from_str(ctx,
+						preimage_domain_tests[i].res);
+		umap1 = isl_union_map_preimage_domain_multi_aff(umap1, ma);
+		equal = isl_union_map_is_equal(umap1, umap2);
+		isl_union_map_free(umap1);
+		isl_union_map_free(umap2);
+		if (equal < 0)
+			return -1;
+		if (!equal)
+			isl_die(ctx, isl_error_unknown, "bad preimage",
+				return -1);
+	}
+
+	return 0;
 }
 
-int test_fixed(isl_ctx *ctx)
+static int test_preimage(isl_ctx *ctx)
 {
-	const char *str;
-	isl_map *map;
-
-	str = "{ [i] -> [i] }";
-	map = isl_map_read_from_str(ctx, str);
-	if (test_plain_fixed(ctx, map, isl_dim_out, 0, 0))
-		return -1;
-	str = "{ [i] -> [1] }";
-	map = isl_map_read_from_str(ctx, str);
-	if (test_plain_fixed(ctx, map, isl_dim_out, 0, 1))
-		return -1;
-	str = "{ S_1[p1] -> [o0] : o0 = -2 and p1 >= 1 and p1 <= 7 }";
-	map = isl_map_read_from_str(ctx, str);
-	if (test_plain_fixed(ctx, map, isl_dim_out, 0, 1))
+	if (test_preimage_basic_set(ctx) < 0)
 		return -1;
-	map = isl_map_read_from_str(ctx, str);
-	map = isl_map_neg(map);
-	if (test_plain_fixed(ctx, map, isl_dim_out, 0, 1))
+	if (test_preimage_union_map(ctx) < 0)
 		return -1;
 
 	return 0;
 }
 
-struct isl_vertices_test_data {
-	const char *set;
-	int n;
-	const char *vertex[2];
-} vertices_tests[] = {
-	{ "{ A[t, i] : t = 12 and i >= 4 and i <= 12 }",
-	  2, { "{ A[12, 4] }", "{ A[12, 12] }" } },
-	{ "{ A[t, i] : t = 14 and i = 1 }",
-	  1, { "{ A[14, 1] }" } },
+struct {
+	const char *ma1;
+	const char *ma;
+	const char *res;
+} pullback_tests[] = {
+	{ "{ B[i,j] -> C[i + 2j] }" , "{ A[a,b] -> B[b,a] }",
+	  "{ A[a,b] -> C[b + 2a] }" },
+	{ "{ B[i] -> C[2i] }", "{ A[a] -> B[(a)/2] }", "{ A[a] -> C[a] }" },
+	{ "{ B[i] -> C[(i)/2] }", "{ A[a] -> B[2a] }", "{ A[a] -> C[a] }" },
+	{ "{ B[i] -> C[(i)/2] }", "{ A[a] -> B[(a)/3] }",
+	  "{ A[a] -> C[(a)/6] }" },
+	{ "{ B[i] -> C[2i] }", "{ A[a] -> B[5a] }", "{ A[a] -> C[10a] }" },
+	{ "{ B[i] -> C[2i] }", "{ A[a] -> B[(a)/3] }",
+	  "{ A[a] -> C[(2a)/3] }" },
+	{ "{ B[i,j] -> C[i + j] }", "{ A[a] -> B[a,a] }", "{ A[a] -> C[2a] }"},
+	{ "{ B[a] -> C[a,a] }", "{ A[i,j] -> B[i + j] }",
+	  "{ A[i,j] -> C[i + j, i + j] }"},
+	{ "{ B[i] -> C[([i/2])] }", "{ B[5] }", "{ C[2] }" },
+	{ "[n] -> { B[i,j] -> C[([i/2]) + 2j] }",
+	  "[n] -> { B[n,[n/3]] }", "[n] -> { C[([n/2]) + 2*[n/3]] }", },
 };
 
-/* Check that "vertex" corresponds to one of the vertices in data->vertex.
- */
-static int find_vertex(__isl_take isl_vertex *vertex, void *user)
+static int test_pullback(isl_ctx *ctx)
 {
-	struct isl_vertices_test_data *data = user;
-	isl_ctx *ctx;
-	isl_multi_aff *ma;
-	isl_basic_set *bset;
-	isl_pw_multi_aff *pma;
 	int i;
+	isl_multi_aff *ma1, *ma2;
+	isl_multi_aff *ma;
 	int equal;
 
-	ctx = isl_vertex_get_ctx(vertex);
-	bset = isl_vertex_get_domain(vertex);
-	ma = isl_vertex_get_expr(vertex);
-	pma = isl_pw_multi_aff_alloc(isl_set_from_basic_set(bset), ma);
-
-	for (i = 0; i < data->n; ++i) {
-		isl_pw_multi_aff *pma_i;
-
-		pma_i = isl_pw_multi_aff_read_from_str(ctx, data->vertex[i]);
-		equal = isl_pw_multi_aff_plain_is_equal(pma, pma_i);
-		isl_pw_multi_aff_free(pma_i);
-
-		if (equal < 0 || equal)
-			break;
+	for (i = 0; i < ARRAY_SIZE(pullback_tests); ++i) {
+		ma1 = isl_multi_aff_read_from_str(ctx, pullback_tests[i].ma1);
+		ma = isl_multi_aff_read_from_str(ctx, pullback_tests[i].ma);
+		ma2 = isl_multi_aff_read_from_str(ctx, pullback_tests[i].res);
+		ma1 = isl_multi_aff_pullback_multi_aff(ma1, ma);
+		equal = isl_multi_aff_plain_is_equal(ma1, ma2);
+		isl_multi_aff_free(ma1);
+		isl_multi_aff_free(ma2);
+		if (equal < 0)
+			return -1;
+		if (!equal)
+			isl_die(ctx, isl_error_unknown, "bad pullback",
+				return -1);
 	}
 
-	isl_pw_multi_aff_free(pma);
-	isl_vertex_free(vertex);
-
-	if (equal < 0)
-		return -1;
-
-	return equal ? 0 : - 1;
+	return 0;
 }
 
-int test_vertices(isl_ctx *ctx)
+/* Check that negation is printed correctly.
+ */
+static int test_ast(isl_ctx *ctx)
 {
-	int i;
+	isl_ast_expr *expr, *expr1, *expr2, *expr3;
+	char *str;
+	int ok;
 
-	for (i = 0; i < ARRAY_SIZE(vertices_tests); ++i) {
-		isl_basic_set *bset;
-		isl_vertices *vertices;
-		int ok = 1;
-		int n;
+	expr1 = isl_ast_expr_from_id(isl_id_alloc(ctx, "A", NULL));
+	expr2 = isl_ast_expr_from_id(isl_id_alloc(ctx, "B", NULL));
+	expr = isl_ast_expr_add(expr1, expr2);
+	expr = isl_ast_expr_neg(expr);
+	str = isl_ast_expr_to_str(expr);
+	ok = str ? !strcmp(str, "-(A + B)") : -1;
+	free(str);
+	isl_ast_expr_free(expr);
 
-		bset = isl_basic_set_read_from_str(ctx, vertices_tests[i].set);
-		vertices = isl_basic_set_compute_vertices(bset);
-		n = isl_vertices_get_n_vertices(vertices);
-		if (vertices_tests[i].n != n)
-			ok = 0;
-		if (isl_vertices_foreach_vertex(vertices, &find_vertex,
-						&vertices_tests[i]) < 0)
-			ok = 0;
-		isl_vertices_free(vertices);
-		isl_basic_set_free(bset);
+	if (ok < 0)
+		return -1;
+	if (!ok)
+		isl_die(ctx, isl_error_unknown,
+			"isl_ast_expr printed incorrectly", return -1);
 
-		if (!vertices)
-			return -1;
-		if (!ok)
-			isl_die(ctx, isl_error_unknown, "unexpected vertices",
-				return -1);
-	}
+	expr1 = isl_ast_expr_from_id(isl_id_alloc(ctx, "A", NULL));
+	expr2 = isl_ast_expr_from_id(isl_id_alloc(ctx, "B", NULL));
+	expr = isl_ast_expr_add(expr1, expr2);
+	expr3 = isl_ast_expr_from_id(isl_id_alloc(ctx, "C", NULL));
+	expr = isl_ast_expr_sub(expr3, expr);
+	str = isl_ast_expr_to_str(expr);
+	ok = str ? !strcmp(str, "C - (A + B)") : -1;
+	free(str);
+	isl_ast_expr_free(expr);
+
+	if (ok < 0)
+		return -1;
+	if (!ok)
+		isl_die(ctx, isl_error_unknown,
+			"isl_ast_expr printed incorrectly", return -1);
 
 	return 0;
 }
 
-int test_union_pw(isl_ctx *ctx)
+/* Check that isl_ast_build_expr_from_set returns a valid expression
+ * for an empty set.  Note that isl_ast_build_expr_from_set getting
+ * called on an empty set probably indicates a bug in the caller.
+ */
+static int test_ast_build(isl_ctx *ctx)
 {
-	int equal;
-	const char *str;
-	isl_union_set *uset;
-	isl_union_pw_qpolynomial *upwqp1, *upwqp2;
+	isl_set *set;
+	isl_ast_build *build;
+	isl_ast_expr *expr;
+
+	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
+	build = isl_ast_build_from_context(set);
+
+	set = isl_set_empty(isl_space_params_alloc(ctx, 0));
+	expr = isl_ast_build_expr_from_set(build, set);
+
+	isl_ast_expr_free(expr);
+	isl_ast_build_free(build);
 
-	str = "{ [x] -> x^2 }";
-	upwqp1 = isl_union_pw_qpolynomial_read_from_str(ctx, str);
-	upwqp2 = isl_union_pw_qpolynomial_copy(upwqp1);
-	uset = isl_union_pw_qpolynomial_domain(upwqp1);
-	upwqp1 = isl_union_pw_qpolynomial_copy(upwqp2);
-	upwqp1 = isl_union_pw_qpolynomial_intersect_domain(upwqp1, uset);
-	equal = isl_union_pw_qpolynomial_plain_is_equal(upwqp1, upwqp2);
-	isl_union_pw_qpolynomial_free(upwqp1);
-	isl_union_pw_qpolynomial_free(upwqp2);
-	if (equal < 0)
+	if (!expr)
 		return -1;
-	if (!equal)
-		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
 
 	return 0;
 }
 
-int test_output(isl_ctx *ctx)
+/* Check that converting the same piecewise affine expression twice
+ * in the same build reuses the AST expression constructed the first time.
+ */
+static int test_ast_build_expr_memo(isl_ctx *ctx)
 {
-	char *s;
 	const char *str;
+	isl_set *set;
 	isl_pw_aff *pa;
-	isl_printer *p;
+	isl_ast_build *build;
+	isl_ast_expr *expr1, *expr2;
+	long hits;
 	int equal;
 
-	str = "[x] -> { [1] : x % 4 <= 2; [2] : x = 3 }";
+	str = "[n] -> { : n >= 0 }";
+	set = isl_set_read_from_str(ctx, str);
+	build = isl_ast_build_from_context(set);
+
+	str = "[n, m] -> { [max(n, m) - min(n, 3)] }";
 	pa = isl_pw_aff_read_from_str(ctx, str);
+	expr1 = isl_ast_build_expr_from_pw_aff(build, isl_pw_aff_copy(pa));
+	hits = isl_ctx_get_stat(ctx, "ast_expr_memo_hits");
+	expr2 = isl_ast_build_expr_from_pw_aff(build, pa);
+	equal = isl_ast_expr_is_equal(expr1, expr2);
+
+	isl_ast_expr_free(expr1);
+	isl_ast_expr_free(expr2);
+	isl_ast_build_free(build);
 
-	p = isl_printer_to_str(ctx);
-	p = isl_printer_set_output_format(p, ISL_FORMAT_C);
-	p = isl_printer_print_pw_aff(p, pa);
-	s = isl_printer_get_str(p);
-	isl_printer_free(p);
-	isl_pw_aff_free(pa);
-	if (!s)
-		equal = -1;
-	else
-		equal = !strcmp(s, "4 * floord(x, 4) + 2 >= x ? 1 : 2");
-	free(s);
 	if (equal < 0)
 		return -1;
 	if (!equal)
-		isl_die(ctx, isl_error_unknown, "unexpected result", return -1);
+		isl_die(ctx, isl_error_unknown,
+			"unexpected result", return -1);
+	if (isl_ctx_get_stat(ctx, "ast_expr_memo_hits") != hits + 1)
+		isl_die(ctx, isl_error_unknown,
+			"expression not reused", return -1);
 
 	return 0;
 }
 
-int test_sample(isl_ctx *ctx)
+/* Internal data structure for before_for and after_for callbacks.
+ *
+ * depth is the current depth
+ * before is the number of times before_for has been called
+ * after is the number of times after_for has been called
+ */
+struct isl_test_codegen_data {
+	int depth;
+	int before;
+	int after;
+};
+
+/* This function is called before each for loop in the AST generated
+ * from test_ast_gen1.
+ *
+ * Increment the number of calls and the depth.
+ * Check that the space returned by isl_ast_build_get_schedule_space
+ * matches the target space of the schedule returned by
+ * isl_ast_build_get_schedule.
+ * Return an isl_id that is checked by the corresponding call
+ * to after_for.
+ */
+static __isl_give isl_id *before_for(__isl_keep isl_ast_build *build,
+	void *user)
 {
-	const char *str;
-	isl_basic_set *bset1, *bset2;
-	int empty, subset;
+	struct isl_test_codegen_data *data = user;
+	isl_ctx *ctx;
+	isl_space *space;
+	isl_union_map *schedule;
+	isl_union_set *uset;
+	isl_set *set;
+	int empty;
+	char name[] = "d0";
 
-	str = "{ [a, b, c, d, e, f, g, h, i, j, k] : "
-	    "3i >= 1073741823b - c - 1073741823e + f and c >= 0 and "
-	    "3i >= -1 + 3221225466b + c + d - 3221225466e - f and "
-	    "2e >= a - b and 3e <= 2a and 3k <= -a and f <= -1 + a and "
-	    "3i <= 4 - a + 4b + 2c - e - 2f and 3k <= -a + c - f and "
-	    "3h >= -2 + a and 3g >= -3 - a and 3k >= -2 - a and "
-	    "3i >= -2 - a - 2c + 3e + 2f and 3h <= a + c - f and "
-	    "3h >= a + 2147483646b + 2c - 2147483646e - 2f and "
-	    "3g <= -1 - a and 3i <= 1 + c + d - f and a <= 1073741823 and "
-	    "f >= 1 - a + 1073741822b + c + d - 1073741822e and "
-	    "3i >= 1 + 2b - 2c + e + 2f + 3g and "
-	    "1073741822f <= 1073741822 - a + 1073741821b + 1073741822c +"
-		"d - 1073741821e and "
-	    "3j <= 3 - a + 3b and 3g <= -2 - 2b + c + d - e - f and "
-	    "3j >= 1 - a + b + 2e and "
-	    "3f >= -3 + a + 3221225462b + 3c + d - 3221225465e and "
-	    "3i <= 4 - a + 4b - e and "
-	    "f <= 1073741822 + 1073741822b - 1073741822e and 3h <= a and "
-	    "f >= 0 and 2e <= 4 - a + 5b - d and 2e <= a - b + d and "
-	    "c <= -1 + a and 3i >= -2 - a + 3e and "
-	    "1073741822e <= 1073741823 - a + 1073741822b + c and "
-	    "3g >= -4 + 3221225464b + 3c + d - 3221225467e - 3f and "
-	    "3i >= -1 + 3221225466b + 3c + d - 3221225466e - 3f and "
-	    "1073741823e >= 1 + 1073741823b - d and "
-	    "3i >= 1073741823b + c - 1073741823e - f and "
-	    "3i >= 1 + 2b + e + 3g }";
-	bset1 = isl_basic_set_read_from_str(ctx, str);
-	bset2 = isl_basic_set_sample(isl_basic_set_copy(bset1));
-	empty = isl_basic_set_is_empty(bset2);
-	subset = isl_basic_set_is_subset(bset2, bset1);
-	isl_basic_set_free(bset1);
-	isl_basic_set_free(bset2);
-	if (empty < 0 || subset < 0)
-		return -1;
+	ctx = isl_ast_build_get_ctx(build);
+
+	if (data->before >= 3)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of for nodes", return NULL);
+	if (data->depth >= 2)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected depth", return NULL);
+
+	snprintf(name, sizeof(name), "d%d", data->depth);
+	data->before++;
+	data->depth++;
+
+	schedule = isl_ast_build_get_schedule(build);
+	uset = isl_union_map_range(schedule);
+	if (!uset)
+		return NULL;
+	if (isl_union_set_n_set(uset) != 1) {
+		isl_union_set_free(uset);
+		isl_die(ctx, isl_error_unknown,
+			"expecting single range space", return NULL);
+	}
+
+	space = isl_ast_build_get_schedule_space(build);
+	set = isl_union_set_extract_set(uset, space);
+	isl_union_set_free(uset);
+	empty = isl_set_is_empty(set);
+	isl_set_free(set);
+
+	if (empty < 0)
+		return NULL;
 	if (empty)
-		isl_die(ctx, isl_error_unknown, "point not found", return -1);
-	if (!subset)
-		isl_die(ctx, isl_error_unknown, "bad point found", return -1);
+		isl_die(ctx, isl_error_unknown,
+			"spaces don't match", return NULL);
 
-	return 0;
+	return isl_id_alloc(ctx, name, NULL);
 }
 
-int test_fixed_power(isl_ctx *ctx)
+/* This function is called after each for loop in the AST generated
+ * from test_ast_gen1.
+ *
+ * Increment the number of calls and decrement the depth.
+ * Check that the annotation attached to the node matches
+ * the isl_id returned by the corresponding call to before_for.
+ */
+static __isl_give isl_ast_node *after_for(__isl_take isl_ast_node *node,
+	__isl_keep isl_ast_build *build, void *user)
 {
-	const char *str;
-	isl_map *map;
-	isl_int exp;
-	int equal;
+	struct isl_test_codegen_data *data = user;
+	isl_id *id;
+	const char *name;
+	int valid;
 
-	isl_int_init(exp);
-	str = "{ [i] -> [i + 1] }";
-	map = isl_map_read_from_str(ctx, str);
-	isl_int_set_si(exp, 23);
-	map = isl_map_fixed_power(map, exp);
-	equal = map_check_equal(map, "{ [i] -> [i + 23] }");
-	isl_int_clear(exp);
-	isl_map_free(map);
-	if (equal < 0)
-		return -1;
+	data->after++;
+	data->depth--;
 
-	return 0;
+	if (data->after > data->before)
+		isl_die(isl_ast_node_get_ctx(node), isl_error_unknown,
+			"mismatch in number of for nodes",
+			return isl_ast_node_free(node));
+
+	id = isl_ast_node_get_annotation(node);
+	if (!id)
+		isl_die(isl_ast_node_get_ctx(node), isl_error_unknown,
+			"missing annotation", return isl_ast_node_free(node));
+
+	name = isl_id_get_name(id);
+	valid = name && atoi(name + 1) == data->depth;
+	isl_id_free(id);
+
+	if (!valid)
+		isl_die(isl_ast_node_get_ctx(node), isl_error_unknown,
+			"wrong annotation", return isl_ast_node_free(node));
+
+	return node;
 }
 
-int test_slice(isl_ctx *ctx)
+/* Check that the before_each_for and after_each_for callbacks
+ * are called for each for loop in the generated code,
+ * that they are called in the right order and that the isl_id
+ * returned from the before_each_for callback is attached to
+ * the isl_ast_node passed to the corresponding after_each_for call.
+ */
+static int test_ast_gen1(isl_ctx *ctx)
 {
 	const char *str;
-	isl_map *map;
-	int equal;
-
-	str = "{ [i] -> [j] }";
-	map = isl_map_read_from_str(ctx, str);
-	map = isl_map_equate(map, isl_dim_in, 0, isl_dim_out, 0);
-	equal = map_check_equal(map, "{ [i] -> [i] }");
-	isl_map_free(map);
-	if (equal < 0)
-		return -1;
-
-	str = "{ [i] -> [j] }";
-	map = isl_map_read_from_str(ctx, str);
-	map = isl_map_equate(map, isl_dim_in, 0, isl_dim_in, 0);
-	equal = map_check_equal(map, "{ [i] -> [j] }");
-	isl_map_free(map);
-	if (equal < 0)
-		return -1;
+	isl_set *set;
+	isl_union_map *schedule;
+	isl_ast_build *build;
+	isl_ast_node *tree;
+	struct isl_test_codegen_data data;
 
-	str = "{ [i] -> [j] }";
-	map = isl_map_read_from_str(ctx, str);
-	map = isl_map_oppose(map, isl_dim_in, 0, isl_dim_out, 0);
-	equal = map_check_equal(map, "{ [i] -> [-i] }");
-	isl_map_free(map);
-	if (equal < 0)
-		return -1;
+	str = "[N] -> { : N >= 10 }";
+	set = isl_set_read_from_str(ctx, str);
+	str = "[N] -> { A[i,j] -> S[8,i,3,j] : 0 <= i,j <= N; "
+		    "B[i,j] -> S[8,j,9,i] : 0 <= i,j <= N }";
+	schedule = isl_union_map_read_from_str(ctx, str);
 
-	str = "{ [i] -> [j] }";
-	map = isl_map_read_from_str(ctx, str);
-	map = isl_map_oppose(map, isl_dim_in, 0, isl_dim_in, 0);
-	equal = map_check_equal(map, "{ [0] -> [j] }");
-	isl_map_free(map);
-	if (equal < 0)
+	data.before = 0;
+	data.after = 0;
+	data.depth = 0;
+	build = isl_ast_build_from_context(set);
+	build = isl_ast_build_set_before_each_for(build,
+			&before_for, &data);
+	build = isl_ast_build_set_after_each_for(build,
+			&after_for, &data);
+	tree = isl_ast_build_ast_from_schedule(build, schedule);
+	isl_ast_build_free(build);
+	if (!tree)
 		return -1;
 
-	str = "{ [i] -> [j] }";
-	map = isl_map_read_from_str(ctx, str);
-	map = isl_map_order_gt(map, isl_dim_in, 0, isl_dim_out, 0);
-	equal = map_check_equal(map, "{ [i] -> [j] : i > j }");
-	isl_map_free(map);
-	if (equal < 0)
-		return -1;
+	isl_ast_node_free(tree);
 
-	str = "{ [i] -> [j] }";
-	map = isl_map_read_from_str(ctx, str);
-	map = isl_map_order_gt(map, isl_dim_in, 0, isl_dim_in, 0);
-	equal = map_check_equal(map, "{ [i] -> [j] : false }");
-	isl_map_free(map);
-	if (equal < 0)
-		return -1;
+	if (data.before != 3 || data.after != 3)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of for nodes", return -1);
 
 	return 0;
 }
 
-int test_eliminate(isl_ctx *ctx)
+/* Check that the AST generator handles domains that are integrally disjoint
+ * but not ratinoally disjoint.
+ */
+static int test_ast_gen2(isl_ctx *ctx)
 {
 	const char *str;
-	isl_map *map;
-	int equal;
+	isl_set *set;
+	isl_union_map *schedule;
+	isl_union_map *options;
+	isl_ast_build *build;
+	isl_ast_node *tree;
 
-	str = "{ [i] -> [j] : i = 2j }";
-	map = isl_map_read_from_str(ctx, str);
-	map = isl_map_eliminate(map, isl_dim_out, 0, 1);
-	equal = map_check_equal(map, "{ [i] -> [j] : exists a : i = 2a }");
-	isl_map_free(map);
-	if (equal < 0)
+	str = "{ A[i,j] -> [i,j] : 0 <= i,j <= 1 }";
+	schedule = isl_union_map_read_from_str(ctx, str);
+	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
+	build = isl_ast_build_from_context(set);
+
+	str = "{ [i,j] -> atomic[1] : i + j = 1; [i,j] -> unroll[1] : i = j }";
+	options = isl_union_map_read_from_str(ctx, str);
+	build = isl_ast_build_set_options(build, options);
+	tree = isl_ast_build_ast_from_schedule(build, schedule);
+	isl_ast_build_free(build);
+	if (!tree)
 		return -1;
+	isl_ast_node_free(tree);
 
 	return 0;
 }
 
-/* Check that isl_set_dim_residue_class detects that the values of j
- * in the set below are all odd and that it does not detect any spurious
- * strides.
+/* Increment *user on each call.
  */
-static int test_residue_class(isl_ctx *ctx)
+static __isl_give isl_ast_node *count_domains(__isl_take isl_ast_node *node,
+	__isl_keep isl_ast_build *build, void *user)
 {
-	const char *str;
-	isl_set *set;
-	isl_int m, r;
-	int res;
+	int *n = user;
 
-	str = "{ [i,j] : j = 4 i + 1 and 0 <= i <= 100; "
-		"[i,j] : j = 4 i + 3 and 500 <= i <= 600 }";
-	set = isl_set_read_from_str(ctx, str);
-	isl_int_init(m);
-	isl_int_init(r);
-	res = isl_set_dim_residue_class(set, 1, &m, &r);
-	if (res >= 0 &&
-	    (isl_int_cmp_si(m, 2) != 0 || isl_int_cmp_si(r, 1) != 0))
-		isl_die(ctx, isl_error_unknown, "incorrect residue class",
-			res = -1);
-	isl_int_clear(r);
-	isl_int_clear(m);
-	isl_set_free(set);
+	(*n)++;
 
-	return res;
+	return node;
 }
 
-int test_align_parameters(isl_ctx *ctx)
+/* Test that unrolling tries to minimize the number of instances.
+ * In particular, for the schedule given below, make sure it generates
+ * 3 nodes (rather than 101).
+ */
+static int test_ast_gen3(isl_ctx *ctx)
 {
 	const char *str;
-	isl_space *space;
-	isl_multi_aff *ma1, *ma2;
-	int equal;
-
-	str = "{ A[B[] -> C[]] -> D[E[] -> F[]] }";
-	ma1 = isl_multi_aff_read_from_str(ctx, str);
-
-	space = isl_space_params_alloc(ctx, 1);
-	space = isl_space_set_dim_name(space, isl_dim_param, 0, "N");
-	ma1 = isl_multi_aff_align_params(ma1, space);
-
-	str = "[N] -> { A[B[] -> C[]] -> D[E[] -> F[]] }";
-	ma2 = isl_multi_aff_read_from_str(ctx, str);
+	isl_set *set;
+	isl_union_map *schedule;
+	isl_union_map *options;
+	isl_ast_build *build;
+	isl_ast_node *tree;
+	int n_domain = 0;
 
-	equal = isl_multi_aff_plain_is_equal(ma1, ma2);
+	str = "[n] -> { A[i] -> [i] : 0 <= i <= 100 and n <= i <= n + 2 }";
+	schedule = isl_union_map_read_from_str(ctx, str);
+	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
 
-	isl_multi_aff_free(ma1);
-	isl_multi_aff_free(ma2);
+	str = "{ [i] -> unroll[0] }";
+	options = isl_union_map_read_from_str(ctx, str);
 
-	if (equal < 0)
+	build = isl_ast_build_from_context(set);
+	build = isl_ast_build_set_options(build, options);
+	build = isl_ast_build_set_at_each_domain(build,
+			&count_domains, &n_domain);
+	tree = isl_ast_build_ast_from_schedule(build, schedule);
+	isl_ast_build_free(build);
+	if (!tree)
 		return -1;
-	if (!equal)
-		isl_die(ctx, isl_error_unknown,
-			"result not as expected", return -1);
-
-	return 0;
-}
-
-static int test_list(isl_ctx *ctx)
-{
-	isl_id *a, *b, *c, *d, *id;
-	isl_id_list *list;
-	int ok;
-
-	a = isl_id_alloc(ctx, "a", NULL);
-	b = isl_id_alloc(ctx, "b", NULL);
-	c = isl_id_alloc(ctx, "c", NULL);
-	d = isl_id_alloc(ctx, "d", NULL);
-
-	list = isl_id_list_alloc(ctx, 4);
-	list = isl_id_list_add(list, a);
-	list = isl_id_list_add(list, b);
-	list = isl_id_list_add(list, c);
-	list = isl_id_list_add(list, d);
-	list = isl_id_list_drop(list, 1, 1);
-
-	if (isl_id_list_n_id(list) != 3) {
-		isl_id_list_free(list);
-		isl_die(ctx, isl_error_unknown,
-			"unexpected number of elements in list", return -1);
-	}
-
-	id = isl_id_list_get_id(list, 0);
-	ok = id == a;
-	isl_id_free(id);
-	id = isl_id_list_get_id(list, 1);
-	ok = ok && id == c;
-	isl_id_free(id);
-	id = isl_id_list_get_id(list, 2);
-	ok = ok && id == d;
-	isl_id_free(id);
 
-	isl_id_list_free(list);
+	isl_ast_node_free(tree);
 
-	if (!ok)
+	if (n_domain != 3)
 		isl_die(ctx, isl_error_unknown,
-			"unexpected elements in list", return -1);
+			"unexpected number of for nodes", return -1);
 
 	return 0;
 }
 
-const char *set_conversion_tests[] = {
-	"[N] -> { [i] : N - 1 <= 2 i <= N }",
-	"[N] -> { [i] : exists a : i = 4 a and N - 1 <= i <= N }",
-	"[N] -> { [i,j] : exists a : i = 4 a and N - 1 <= i, 2j <= N }",
-	"[N] -> { [[i]->[j]] : exists a : i = 4 a and N - 1 <= i, 2j <= N }",
-	"[N] -> { [3*floor(N/2) + 5*floor(N/3)] }",
-};
-
-/* Check that converting from isl_set to isl_pw_multi_aff and back
- * to isl_set produces the original isl_set.
+/* Check that if the ast_build_exploit_nested_bounds options is set,
+ * we do not get an outer if node in the generated AST,
+ * while we do get such an outer if node if the options is not set.
  */
-static int test_set_conversion(isl_ctx *ctx)
+static int test_ast_gen4(isl_ctx *ctx)
 {
-	int i;
 	const char *str;
-	isl_set *set1, *set2;
-	isl_pw_multi_aff *pma;
-	int equal;
+	isl_set *set;
+	isl_union_map *schedule;
+	isl_ast_build *build;
+	isl_ast_node *tree;
+	enum isl_ast_node_type type;
+	int enb;
 
-	for (i = 0; i < ARRAY_SIZE(set_conversion_tests); ++i) {
-		str = set_conversion_tests[i];
-		set1 = isl_set_read_from_str(ctx, str);
-		pma = isl_pw_multi_aff_from_set(isl_set_copy(set1));
-		set2 = isl_set_from_pw_multi_aff(pma);
-		equal = isl_set_is_equal(set1, set2);
-		isl_set_free(set1);
-		isl_set_free(set2);
+	enb = isl_options_get_ast_build_exploit_nested_bounds(ctx);
+	str = "[N,M] -> { A[i,j] -> [i,j] : 0 <= i <= N and 0 <= j <= M }";
 
-		if (equal < 0)
-			return -1;
-		if (!equal)
-			isl_die(ctx, isl_error_unknown, "bad conversion",
-				return -1);
-	}
+	isl_options_set_ast_build_exploit_nested_bounds(ctx, 1);
 
-	return 0;
-}
+	schedule = isl_union_map_read_from_str(ctx, str);
+	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
+	build = isl_ast_build_from_context(set);
+	tree = isl_ast_build_ast_from_schedule(build, schedule);
+	isl_ast_build_free(build);
+	if (!tree)
+		return -1;
 
-/* Check that converting from isl_map to isl_pw_multi_aff and back
- * to isl_map produces the original isl_map.
- */
-static int test_map_conversion(isl_ctx *ctx)
-{
-	const char *str;
-	isl_map *map1, *map2;
-	isl_pw_multi_aff *pma;
-	int equal;
+	type = isl_ast_node_get_type(tree);
+	isl_ast_node_free(tree);
 
-	str = "{ [a, b, c, d] -> s0[a, b, e, f] : "
-		"exists (e0 = [(a - 2c)/3], e1 = [(-4 + b - 5d)/9], "
-		"e2 = [(-d + f)/9]: 3e0 = a - 2c and 9e1 = -4 + b - 5d and "
-		"9e2 = -d + f and f >= 0 and f <= 8 and 9e >= -5 - 2a and "
-		"9e <= -2 - 2a) }";
-	map1 = isl_map_read_from_str(ctx, str);
-	pma = isl_pw_multi_aff_from_map(isl_map_copy(map1));
-	map2 = isl_map_from_pw_multi_aff(pma);
-	equal = isl_map_is_equal(map1, map2);
-	isl_map_free(map1);
-	isl_map_free(map2);
+	if (type == isl_ast_node_if)
+		isl_die(ctx, isl_error_unknown,
+			"not expecting if node", return -1);
 
-	if (equal < 0)
+	isl_options_set_ast_build_exploit_nested_bounds(ctx, 0);
+
+	schedule = isl_union_map_read_from_str(ctx, str);
+	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
+	build = isl_ast_build_from_context(set);
+	tree = isl_ast_build_ast_from_schedule(build, schedule);
+	isl_ast_build_free(build);
+	if (!tree)
 		return -1;
-	if (!equal)
-		isl_die(ctx, isl_error_unknown, "bad conversion", return -1);
 
-	return 0;
-}
+	type = isl_ast_node_get_type(tree);
+	isl_ast_node_free(tree);
+
+	if (type != isl_ast_node_if)
+		isl_die(ctx, isl_error_unknown,
+			"expecting if node", return -1);
+
+	isl_options_set_ast_build_exploit_nested_bounds(ctx, enb);
 
-static int test_conversion(isl_ctx *ctx)
-{
-	if (test_set_conversion(ctx) < 0)
-		return -1;
-	if (test_map_conversion(ctx) < 0)
-		return -1;
 	return 0;
 }
 
-/* Check that isl_basic_map_curry does not modify input.
+/* This function is called for each leaf in the AST generated
+ * from test_ast_gen5.
+ *
+ * We finalize the AST generation by extending the outer schedule
+ * with a zero-dimensional schedule.  If this results in any for loops,
+ * then this means that we did not pass along enough information
+ * about the outer schedule to the inner AST generation.
  */
-static int test_curry(isl_ctx *ctx)
+static __isl_give isl_ast_node *create_leaf(__isl_take isl_ast_build *build,
+	void *user)
 {
-	const char *str;
-	isl_basic_map *bmap1, *bmap2;
-	int equal;
+	isl_union_map *schedule, *extra;
+	isl_ast_node *tree;
 
-	str = "{ [A[] -> B[]] -> C[] }";
-	bmap1 = isl_basic_map_read_from_str(ctx, str);
-	bmap2 = isl_basic_map_curry(isl_basic_map_copy(bmap1));
-	equal = isl_basic_map_is_equal(bmap1, bmap2);
-	isl_basic_map_free(bmap1);
-	isl_basic_map_free(bmap2);
+	schedule = isl_ast_build_get_schedule(build);
+	extra = isl_union_map_copy(schedule);
+	extra = isl_union_map_from_domain(isl_union_map_domain(extra));
+	schedule = isl_union_map_range_product(schedule, extra);
+	tree = isl_ast_build_ast_from_schedule(build, schedule);
+	isl_ast_build_free(build);
 
-	if (equal < 0)
-		return -1;
-	if (equal)
-		isl_die(ctx, isl_error_unknown,
-			"curried map should not be equal to original",
-			return -1);
+	if (!tree)
+		return NULL;
 
-	return 0;
-}
+	if (isl_ast_node_get_type(tree) == isl_ast_node_for)
+		isl_die(isl_ast_node_get_ctx(tree), isl_error_unknown,
+			"code should not contain any for loop",
+			return isl_ast_node_free(tree));
 
-struct {
-	const char *set;
-	const char *ma;
-	const char *res;
-} preimage_tests[] = {
-	{ "{ B[i,j] : 0 <= i < 10 and 0 <= j < 100 }",
-	  "{ A[j,i] -> B[i,j] }",
-	  "{ A[j,i] : 0 <= i < 10 and 0 <= j < 100 }" },
-	{ "{ rat: B[i,j] : 0 <= i, j and 3 i + 5 j <= 100 }",
-	  "{ A[a,b] -> B[a/2,b/6] }",
-	  "{ rat: A[a,b] : 0 <= a, b and 9 a + 5 b <= 600 }" },
-	{ "{ B[i,j] : 0 <= i, j and 3 i + 5 j <= 100 }",
-	  "{ A[a,b] -> B[a/2,b/6] }",
-	  "{ A[a,b] : 0 <= a, b and 9 a + 5 b <= 600 and "
-		    "exists i,j : a = 2 i and b = 6 j }" },
-	{ "[n] -> { S[i] : 0 <= i <= 100 }", "[n] -> { S[n] }",
-	  "[n] -> { : 0 <= n <= 100 }" },
-	{ "{ B[i] : 0 <= i < 100 and exists a : i = 4 a }",
-	  "{ A[a] -> B[2a] }",
-	  "{ A[a] : 0 <= a < 50 and exists b : a = 2 b }" },
-	{ "{ B[i] : 0 <= i < 100 and exists a : i = 4 a }",
-	  "{ A[a] -> B[([a/2])] }",
-	  "{ A[a] : 0 <= a < 200 and exists b : [a/2] = 4 b }" },
-	{ "{ B[i,j,k] : 0 <= i,j,k <= 100 }",
-	  "{ A[a] -> B[a,a,a/3] }",
-	  "{ A[a] : 0 <= a <= 100 and exists b : a = 3 b }" },
-	{ "{ B[i,j] : j = [(i)/2] } ", "{ A[i,j] -> B[i/3,j] }",
-	  "{ A[i,j] : j = [(i)/6] and exists a : i = 3 a }" },
-};
+	return tree;
+}
 
-static int test_preimage_basic_set(isl_ctx *ctx)
+/* Check that we do not lose any information when going back and
+ * forth between internal and external schedule.
+ *
+ * In particular, we create an AST where we unroll the only
+ * non-constant dimension in the schedule.  We therefore do
+ * not expect any for loops in the AST.  However, older versions
+ * of isl would not pass along enough information about the outer
+ * schedule when performing an inner code generation from a create_leaf
+ * callback, resulting in the inner code generation producing a for loop.
+ */
+static int test_ast_gen5(isl_ctx *ctx)
 {
-	int i;
-	isl_basic_set *bset1, *bset2;
-	isl_multi_aff *ma;
-	int equal;
-
-	for (i = 0; i < ARRAY_SIZE(preimage_tests); ++i) {
-		bset1 = isl_basic_set_read_from_str(ctx, preimage_tests[i].set);
-		ma = isl_multi_aff_read_from_str(ctx, preimage_tests[i].ma);
-		bset2 = isl_basic_set_read_from_str(ctx, preimage_tests[i].res);
-		bset1 = isl_basic_set_preimage_multi_aff(bset1, ma);
-		equal = isl_basic_set_is_equal(bset1, bset2);
-		isl_basic_set_free(bset1);
-		isl_basic_set_free(bset2);
-		if (equal < 0)
-			return -1;
-		if (!equal)
-			isl_die(ctx, isl_error_unknown, "bad preimage",
-				return -1);
-	}
-
-	return 0;
-}
+	const char *str;
+	isl_set *set;
+	isl_union_map *schedule, *options;
+	isl_ast_build *build;
+	isl_ast_node *tree;
 
-struct {
-	const char *map;
-	const char *ma;
-	const char *res;
-} preimage_domain_tests[] = {
-	{ "{ B[i,j] -> C[2i + 3j] : 0 <= i < 10 and 0 <= j < 100 }",
-	  "{ A[j,i] -> B[i,j] }",
-	  "{ A[j,i] -> C[2i + 3j] : 0 <= i < 10 and 0 <= j < 100 }" },
-	{ "{ B[i] -> C[i]; D[i] -> E[i] }",
-	  "{ A[i] -> B[i + 1] }",
-	  "{ A[i] -> C[i + 1] }" },
-	{ "{ B[i] -> C[i]; B[i] -> E[i] }",
-	  "{ A[i] -> B[i + 1] }",
-	  "{ A[i] -> C[i + 1]; A[i] -> E[i + 1] }" },
-	{ "{ B[i] -> C[([i/2])] }",
-	  "{ A[i] -> B[2i] }",
-	  "{ A[i] -> C[i] }" },
-	{ "{ B[i,j] -> C[([i/2]), ([(i+j)/3])] }",
-	  "{ A[i] -> B[([i/5]), ([i/7])] }",
-	  "{ A[i] -> C[([([i/5])/2]), ([(([i/5])+([i/7]))/3])] }" },
-	{ "[N] -> { B[i] -> C[([N/2]), i, ([N/3])] }",
-	  "[N] -> { A[] -> B[([N/5])] }",
-	  "[N] -> { A[] -> C[([N/2]), ([N/5]), ([N/3])] }" },
-	{ "{ B[i] -> C[i] : exists a : i = 5 a }",
-	  "{ A[i] -> B[2i] }",
-	  "{ A[i] -> C[2i] : exists a : 2i = 5 a }" },
-	{ "{ B[i] -> C[i] : exists a : i = 2 a; "
-	    "B[i] -> D[i] : exists a : i = 2 a + 1 }",
-	  "{ A[i] -> B[2i] }",
-	  "{ A[i] -> C[2i] }" },
-};
+	str = "{ A[] -> [1, 1, 2]; B[i] -> [1, i, 0] : i >= 1 and i <= 2 }";
+	schedule = isl_union_map_read_from_str(ctx, str);
 
-static int test_preimage_union_map(isl_ctx *ctx)
-{
-	int i;
-	isl_union_map *umap1, *umap2;
-	isl_multi_aff *ma;
-	int equal;
+	str = "{ [a, b, c] -> unroll[1] : exists (e0 = [(a)/4]: "
+				"4e0 >= -1 + a - b and 4e0 <= -2 + a + b) }";
+	options = isl_union_map_read_from_str(ctx, str);
 
-	for (i = 0; i < ARRAY_SIZE(preimage_domain_tests); ++i) {
-		umap1 = isl_union_map_read_from_str(ctx,
-						preimage_domain_tests[i].map);
-		ma = isl_multi_aff_read_from_str(ctx,
-						preimage_domain_tests[i].ma);
-		umap2 = isl_union_map_read_from_str(ctx,
-						preimage_domain_tests[i].res);
-		umap1 = isl_union_map_preimage_domain_multi_aff(umap1, ma);
-		equal = isl_union_map_is_equal(umap1, umap2);
-		isl_union_map_free(umap1);
-		isl_union_map_free(umap2);
-		if (equal < 0)
-			return -1;
-		if (!equal)
-			isl_die(ctx, isl_error_unknown, "bad preimage",
-				return -1);
-	}
+	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
+	build = isl_ast_build_from_context(set);
+	build = isl_ast_build_set_options(build, options);
+        build = isl_ast_build_set_create_leaf(build, &create_leaf, NULL);
+	tree = isl_ast_build_ast_from_schedule(build, schedule);
+	isl_ast_build_free(build);
+	isl_ast_node_free(tree);
+	if (!tree)
+		return -1;
 
 	return 0;
 }
 
-static int test_preimage(isl_ctx *ctx)
+/* Count the number of AST pieces passed to this callback.
+ */
+static int count_pieces(__isl_take isl_ast_node *node, void *user)
 {
-	if (test_preimage_basic_set(ctx) < 0)
-		return -1;
-	if (test_preimage_union_map(ctx) < 0)
-		return -1;
+	int *n = user;
+
+	isl_ast_node_free(node);
+	(*n)++;
 
 	return 0;
 }
 
-struct {
-	const char *ma1;
-	const char *ma;
-	const char *res;
-} pullback_tests[] = {
-	{ "{ B[i,j] -> C[i + 2j] }" , "{ A[a,b] -> B[b,a] }",
-	  "{ A[a,b] -> C[b + 2a] }" },
-	{ "{ B[i] -> C[2i] }", "{ A[a] -> B[(a)/2] }", "{ A[a] -> C[a] }" },
-	{ "{ B[i] -> C[(i)/2] }", "{ A[a] -> B[2a] }", "{ A[a] -> C[a] }" },
-	{ "{ B[i] -> C[(i)/2] }", "{ A[a] -> B[(a)/3] }",
-	  "{ A[a] -> C[(a)/6] }" },
-	{ "{ B[i] -> C[2i] }", "{ A[a] -> B[5a] }", "{ A[a] -> C[10a] }" },
-	{ "{ B[i] -> C[2i] }", "{ A[a] -> B[(a)/3] }",
-	  "{ A[a] -> C[(2a)/3] }" },
-	{ "{ B[i,j] -> C[i + j] }", "{ A[a] -> B[a,a] }", "{ A[a] -> C[2a] }"},
-	{ "{ B[a] -> C[a,a] }", "{ A[i,j] -> B[i + j] }",
-	  "{ A[i,j] -> C[i + j, i + j] }"},
-	{ "{ B[i] -> C[([i/2])] }", "{ B[5] }", "{ C[2] }" },
-	{ "[n] -> { B[i,j] -> C[([i/2]) + 2j] }",
-	  "[n] -> { B[n,[n/3]] }", "[n] -> { C[([n/2]) + 2*[n/3]] }", },
-};
-
-static int test_pullback(isl_ctx *ctx)
+/* Check that isl_ast_build_foreach_ast_from_schedule passes
+ * each outermost component of the AST to the callback separately
+ * and that all domain elements are visited.
+ */
+static int test_ast_gen6(isl_ctx *ctx)
 {
-	int i;
-	isl_multi_aff *ma1, *ma2;
-	isl_multi_aff *ma;
-	int equal;
+	const char *str;
+	isl_set *set;
+	isl_union_map *schedule;
+	isl_ast_build *build;
+	int n_domain = 0;
+	int n_piece = 0;
+	int r;
 
-	for (i = 0; i < ARRAY_SIZE(pullback_tests); ++i) {
-		ma1 = isl_multi_aff_read_from_str(ctx, pullback_tests[i].ma1);
-		ma = isl_multi_aff_read_from_str(ctx, pullback_tests[i].ma);
-		ma2 = isl_multi_aff_read_from_str(ctx, pullback_tests[i].res);
-		ma1 = isl_multi_aff_pullback_multi_aff(ma1, ma);
-		equal = isl_multi_aff_plain_is_equal(ma1, ma2);
-		isl_multi_aff_free(ma1);
-		isl_multi_aff_free(ma2);
-		if (equal < 0)
-			return -1;
-		if (!equal)
-			isl_die(ctx, isl_error_unknown, "bad pullback",
-				return -1);
-	}
+	str = "[n] -> { A[i] -> [0, i] : 0 <= i < n; B[i] -> [1, i] : "
+		"0 <= i < n; C[] -> [2, 0] }";
+	schedule = isl_union_map_read_from_str(ctx, str);
+	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
+	build = isl_ast_build_from_context(set);
+	build = isl_ast_build_set_at_each_domain(build,
+			&count_domains, &n_domain);
+	r = isl_ast_build_foreach_ast_from_schedule(build, schedule,
+			&count_pieces, &n_piece);
+	isl_ast_build_free(build);
+	if (r < 0)
+		return -1;
+
+	if (n_piece != 3)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of AST pieces", return -1);
+	if (n_domain != 3)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of user nodes", return -1);
 
 	return 0;
 }
 
-/* Check that negation is printed correctly.
+/* Check that isl_ast_build_set_reuse_subtrees allows the outermost
+ * components that are not affected by a change in the schedule
+ * to be reused.  In particular, only the user node of B
+ * should be generated again.
  */
-static int test_ast(isl_ctx *ctx)
+static int test_ast_gen7(isl_ctx *ctx)
 {
-	isl_ast_expr *expr, *expr1, *expr2, *expr3;
-	char *str;
-	int ok;
+	const char *str;
+	isl_set *set;
+	isl_union_map *schedule;
+	isl_ast_build *build;
+	isl_ast_node *node;
+	int n_domain = 0;
+	long hits;
 
-	expr1 = isl_ast_expr_from_id(isl_id_alloc(ctx, "A", NULL));
-	expr2 = isl_ast_expr_from_id(isl_id_alloc(ctx, "B", NULL));
-	expr = isl_ast_expr_add(expr1, expr2);
-	expr = isl_ast_expr_neg(expr);
-	str = isl_ast_expr_to_str(expr);
-	ok = str ? !strcmp(str, "-(A + B)") : -1;
-	free(str);
-	isl_ast_expr_free(expr);
+	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
+	build = isl_ast_build_from_context(set);
+	build = isl_ast_build_set_at_each_domain(build,
+			&count_domains, &n_domain);
+	build = isl_ast_build_set_reuse_subtrees(build, 1);
 
-	if (ok < 0)
+	str = "[n] -> { A[i] -> [0, i] : 0 <= i < n; B[i] -> [1, i] : "
+		"0 <= i < n; C[] -> [2, 0] }";
+	schedule = isl_union_map_read_from_str(ctx, str);
+	node = isl_ast_build_ast_from_schedule(build, schedule);
+	isl_ast_node_free(node);
+	if (!node) {
+		isl_ast_build_free(build);
 		return -1;
-	if (!ok)
-		isl_die(ctx, isl_error_unknown,
-			"isl_ast_expr printed incorrectly", return -1);
-
-	expr1 = isl_ast_expr_from_id(isl_id_alloc(ctx, "A", NULL));
-	expr2 = isl_ast_expr_from_id(isl_id_alloc(ctx, "B", NULL));
-	expr = isl_ast_expr_add(expr1, expr2);
-	expr3 = isl_ast_expr_from_id(isl_id_alloc(ctx, "C", NULL));
-	expr = isl_ast_expr_sub(expr3, expr);
-	str = isl_ast_expr_to_str(expr);
-	ok = str ? !strcmp(str, "C - (A + B)") : -1;
-	free(str);
-	isl_ast_expr_free(expr);
+	}
 
-	if (ok < 0)
+	hits = isl_ctx_get_stat(ctx, "ast_reuse_hits");
+	n_domain = 0;
+	str = "[n] -> { A[i] -> [0, i] : 0 <= i < n; B[i] -> [1, -i] : "
+		"0 <= i < n; C[] -> [2, 0] }";
+	schedule = isl_union_map_read_from_str(ctx, str);
+	node = isl_ast_build_ast_from_schedule(build, schedule);
+	isl_ast_node_free(node);
+	isl_ast_build_free(build);
+	if (!node)
 		return -1;
-	if (!ok)
+
+	if (isl_ctx_get_stat(ctx, "ast_reuse_hits") != hits + 2)
 		isl_die(ctx, isl_error_unknown,
-			"isl_ast_expr printed incorrectly", return -1);
+			"unexpected number of reused components", return -1);
+	if (n_domain != 1)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of user nodes", return -1);
 
 	return 0;
 }
 
-/* Check that isl_ast_build_expr_from_set returns a valid expression
- * for an empty set.  Note that isl_ast_build_expr_from_set getting
- * called on an empty set probably indicates a bug in the caller.
+/* Generate an AST for "schedule_str" with options "options_str"
+ * and return the number of user nodes in the result.
  */
-static int test_ast_build(isl_ctx *ctx)
+static int count_user_nodes(isl_ctx *ctx, const char *schedule_str,
+	const char *options_str)
 {
 	isl_set *set;
+	isl_union_map *schedule;
+	isl_union_map *options;
 	isl_ast_build *build;
-	isl_ast_expr *expr;
+	isl_ast_node *tree;
+	int n_domain = 0;
 
+	schedule = isl_union_map_read_from_str(ctx, schedule_str);
+	options = isl_union_map_read_from_str(ctx, options_str);
 	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
 	build = isl_ast_build_from_context(set);
-
-	set = isl_set_empty(isl_space_params_alloc(ctx, 0));
-	expr = isl_ast_build_expr_from_set(build, set);
-
-	isl_ast_expr_free(expr);
+	build = isl_ast_build_set_options(build, options);
+	build = isl_ast_build_set_at_each_domain(build,
+			&count_domains, &n_domain);
+	tree = isl_ast_build_ast_from_schedule(build, schedule);
 	isl_ast_build_free(build);
-
-	if (!expr)
+	if (!tree)
 		return -1;
+	isl_ast_node_free(tree);
 
-	return 0;
+	return n_domain;
 }
 
-/* Internal data structure for before_for and after_for callbacks.
- *
- * depth is the current depth
- * before is the number of times before_for has been called
- * after is the number of times after_for has been called
+/* Check that the ast_build_max_pieces option makes unrolling and
+ * separation fall back to atomic code generation when they
+ * would generate too many statement copies.
  */
-struct isl_test_codegen_data {
-	int depth;
-	int before;
-	int after;
-};
+static int test_ast_gen8(isl_ctx *ctx)
+{
+	const char *sched_unroll, *sched_separate;
+	int max;
+	int n_unroll, n_separate;
+	int n_unroll_limited, n_separate_limited;
+
+	sched_unroll = "{ A[i] -> [i] : 0 <= i < 100 }";
+	sched_separate = "[n] -> { A[i] -> [i] : 0 <= i < n; "
+			"B[i] -> [i] : 10 <= i < 20 }";
+
+	max = isl_options_get_ast_build_max_pieces(ctx);
+	n_unroll = count_user_nodes(ctx, sched_unroll, "{ [i] -> unroll[0] }");
+	n_separate = count_user_nodes(ctx, sched_separate,
+					"{ [i] -> separate[0] }");
+	isl_options_set_ast_build_max_pieces(ctx, 4);
+	n_unroll_limited = count_user_nodes(ctx, sched_unroll,
+					"{ [i] -> unroll[0] }");
+	n_separate_limited = count_user_nodes(ctx, sched_separate,
+					"{ [i] -> separate[0] }");
+	isl_options_set_ast_build_max_pieces(ctx, max);
+
+	if (n_unroll < 0 || n_separate < 0 ||
+	    n_unroll_limited < 0 || n_separate_limited < 0)
+		return -1;
+	if (n_unroll != 100 || n_unroll_limited != 1)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of unrolled nodes", return -1);
+	if (n_separate <= 2 || n_separate_limited != 2)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of separated nodes", return -1);
 
-/* This function is called before each for loop in the AST generated
- * from test_ast_gen1.
- *
- * Increment the number of calls and the depth.
- * Check that the space returned by isl_ast_build_get_schedule_space
- * matches the target space of the schedule returned by
- * isl_ast_build_get_schedule.
- * Return an isl_id that is checked by the corresponding call
- * to after_for.
+	return 0;
+}
+
+/* Check that the ast_print_hoist_bounds option makes the printer
+ * evaluate the upper bound of the inner loop before that loop.
  */
-static __isl_give isl_id *before_for(__isl_keep isl_ast_build *build,
-	void *user)
+static int test_ast_gen9(isl_ctx *ctx)
 {
-	struct isl_test_codegen_data *data = user;
-	isl_ctx *ctx;
-	isl_space *space;
-	isl_union_map *schedule;
-	isl_union_set *uset;
+	const char *str;
 	isl_set *set;
-	int empty;
-	char name[] = "d0";
+	isl_union_map *schedule;
+	isl_ast_build *build;
+	isl_ast_node *tree;
+	isl_printer *p;
+	char *s;
+	int hoist;
+	int found;
 
-	ctx = isl_ast_build_get_ctx(build);
+	str = "[n] -> { A[i, j] -> [i, j] : 0 <= i, j < n and j <= i + 10 }";
+	schedule = isl_union_map_read_from_str(ctx, str);
+	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
+	build = isl_ast_build_from_context(set);
+	tree = isl_ast_build_ast_from_schedule(build, schedule);
+	isl_ast_build_free(build);
 
-	if (data->before >= 3)
-		isl_die(ctx, isl_error_unknown,
-			"unexpected number of for nodes", return NULL);
-	if (data->depth >= 2)
+	hoist = isl_options_get_ast_print_hoist_bounds(ctx);
+	isl_options_set_ast_print_hoist_bounds(ctx, 1);
+	p = isl_printer_to_str(ctx);
+	p = isl_printer_set_output_format(p, ISL_FORMAT_C);
+	p = isl_printer_print_ast_node(p, tree);
+	s = isl_printer_get_str(p);
+	isl_printer_free(p);
+	isl_options_set_ast_print_hoist_bounds(ctx, hoist);
+	isl_ast_node_free(tree);
+	if (!s)
+		return -1;
+
+	found = strstr(s, "int c1_ub = min(") != NULL &&
+		strstr(s, "c1 <= c1_ub;") != NULL;
+	free(s);
+	if (!found)
 		isl_die(ctx, isl_error_unknown,
-			"unexpected depth", return NULL);
+			"upper bound not hoisted", return -1);
 
-	snprintf(name, sizeof(name), "d%d", data->depth);
-	data->before++;
-	data->depth++;
+	return 0;
+}
 
-	schedule = isl_ast_build_get_schedule(build);
-	uset = isl_union_map_range(schedule);
-	if (!uset)
-		return NULL;
-	if (isl_union_set_n_set(uset) != 1) {
-		isl_union_set_free(uset);
-		isl_die(ctx, isl_error_unknown,
-			"expecting single range space", return NULL);
-	}
+/* Print "tree" in C format with the ast_print_omp_pragmas option set
+ * and check whether the result contains "pragma".
+ */
+static int check_omp_pragma(isl_ctx *ctx, __isl_keep isl_ast_node *tree,
+	const char *pragma)
+{
+	isl_printer *p;
+	char *s;
+	int omp;
+	int found;
 
-	space = isl_ast_build_get_schedule_space(build);
-	set = isl_union_set_extract_set(uset, space);
-	isl_union_set_free(uset);
-	empty = isl_set_is_empty(set);
-	isl_set_free(set);
+	omp = isl_options_get_ast_print_omp_pragmas(ctx);
+	isl_options_set_ast_print_omp_pragmas(ctx, 1);
+	p = isl_printer_to_str(ctx);
+	p = isl_printer_set_output_format(p, ISL_FORMAT_C);
+	p = isl_printer_print_ast_node(p, tree);
+	s = isl_printer_get_str(p);
+	isl_printer_free(p);
+	isl_options_set_ast_print_omp_pragmas(ctx, omp);
+	if (!s)
+		return -1;
 
-	if (empty < 0)
-		return NULL;
-	if (empty)
-		isl_die(ctx, isl_error_unknown,
-			"spaces don't match", return NULL);
+	found = strstr(s, pragma) != NULL;
+	free(s);
 
-	return isl_id_alloc(ctx, name, NULL);
+	return found;
 }
 
-/* This function is called after each for loop in the AST generated
- * from test_ast_gen1.
- *
- * Increment the number of calls and decrement the depth.
- * Check that the annotation attached to the node matches
- * the isl_id returned by the corresponding call to before_for.
+/* Check that coincidence information is propagated to the for nodes
+ * and that the corresponding OpenMP pragmas are printed.
+ * The coincident dimensions are first specified explicitly and
+ * then obtained from a computed schedule.
  */
-static __isl_give isl_ast_node *after_for(__isl_take isl_ast_node *node,
-	__isl_keep isl_ast_build *build, void *user)
+static int test_ast_gen10(isl_ctx *ctx)
 {
-	struct isl_test_codegen_data *data = user;
-	isl_id *id;
-	const char *name;
-	int valid;
-
-	data->after++;
-	data->depth--;
-
-	if (data->after > data->before)
-		isl_die(isl_ast_node_get_ctx(node), isl_error_unknown,
-			"mismatch in number of for nodes",
-			return isl_ast_node_free(node));
+	const char *str;
+	isl_set *set;
+	isl_union_set *domain;
+	isl_union_map *schedule, *coincident, *dep;
+	isl_schedule_constraints *sc;
+	isl_schedule *sched;
+	isl_ast_build *build;
+	isl_ast_node *tree;
+	int coincident_for, parallel, simd;
 
-	id = isl_ast_node_get_annotation(node);
-	if (!id)
-		isl_die(isl_ast_node_get_ctx(node), isl_error_unknown,
-			"missing annotation", return isl_ast_node_free(node));
+	str = "[n] -> { A[i, j] -> [i, j] : 0 <= i, j < n }";
+	schedule = isl_union_map_read_from_str(ctx, str);
+	str = "{ A[i, j] -> coincident[0]; A[i, j] -> coincident[1] }";
+	coincident = isl_union_map_read_from_str(ctx, str);
+	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
+	build = isl_ast_build_from_context(set);
+	build = isl_ast_build_set_coincident(build, coincident);
+	tree = isl_ast_build_ast_from_schedule(build, schedule);
+	isl_ast_build_free(build);
+	if (!tree)
+		return -1;
 
-	name = isl_id_get_name(id);
-	valid = name && atoi(name + 1) == data->depth;
-	isl_id_free(id);
+	coincident_for = isl_ast_node_for_is_coincident(tree);
+	parallel = check_omp_pragma(ctx, tree, "#pragma omp parallel for");
+	simd = check_omp_pragma(ctx, tree, "#pragma omp simd");
+	isl_ast_node_free(tree);
+	if (coincident_for < 0 || parallel < 0 || simd < 0)
+		return -1;
+	if (!coincident_for || !parallel || !simd)
+		isl_die(ctx, isl_error_unknown,
+			"coincident loops not annotated", return -1);
+
+	str = "[n] -> { A[i, j] : 0 <= i, j < n }";
+	domain = isl_union_set_read_from_str(ctx, str);
+	str = "[n] -> { A[i, j] -> A[i + 1, j] : 0 <= i < n - 1 and "
+		"0 <= j < n }";
+	dep = isl_union_map_read_from_str(ctx, str);
+	sc = isl_schedule_constraints_on_domain(isl_union_set_copy(domain));
+	sc = isl_schedule_constraints_set_validity(sc,
+						isl_union_map_copy(dep));
+	sc = isl_schedule_constraints_set_coincidence(sc, dep);
+	sched = isl_schedule_constraints_compute_schedule(sc);
+	schedule = isl_schedule_get_map(sched);
+	schedule = isl_union_map_intersect_domain(schedule, domain);
+	coincident = isl_schedule_get_coincident(sched);
+	isl_schedule_free(sched);
+	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
+	build = isl_ast_build_from_context(set);
+	build = isl_ast_build_set_coincident(build, coincident);
+	tree = isl_ast_build_ast_from_schedule(build, schedule);
+	isl_ast_build_free(build);
+	if (!tree)
+		return -1;
 
-	if (!valid)
-		isl_die(isl_ast_node_get_ctx(node), isl_error_unknown,
-			"wrong annotation", return isl_ast_node_free(node));
+	parallel = check_omp_pragma(ctx, tree, "#pragma omp parallel for");
+	isl_ast_node_free(tree);
+	if (parallel < 0)
+		return -1;
+	if (!parallel)
+		isl_die(ctx, isl_error_unknown,
+			"coincident loop not annotated", return -1);
 
-	return node;
+	return 0;
 }
 
-/* Check that the before_each_for and after_each_for callbacks
- * are called for each for loop in the generated code,
- * that they are called in the right order and that the isl_id
- * returned from the before_each_for callback is attached to
- * the isl_ast_node passed to the corresponding after_each_for call.
+/* Check that division expressions in a loop body are replaced
+ * by incrementally updated variables if the ast_print_strength_reduce
+ * option is set.
  */
-static int test_ast_gen1(isl_ctx *ctx)
+static int test_ast_gen11(isl_ctx *ctx)
 {
 	const char *str;
 	isl_set *set;
 	isl_union_map *schedule;
 	isl_ast_build *build;
 	isl_ast_node *tree;
-	struct isl_test_codegen_data data;
+	isl_printer *p;
+	char *s;
+	int reduce;
+	int found;
 
-	str = "[N] -> { : N >= 10 }";
-	set = isl_set_read_from_str(ctx, str);
-	str = "[N] -> { A[i,j] -> S[8,i,3,j] : 0 <= i,j <= N; "
-		    "B[i,j] -> S[8,j,9,i] : 0 <= i,j <= N }";
+	str = "[n] -> { A[i, j] -> [i] : -n <= i < n and 3j <= i < 3j + 3 }";
 	schedule = isl_union_map_read_from_str(ctx, str);
-
-	data.before = 0;
-	data.after = 0;
-	data.depth = 0;
+	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
 	build = isl_ast_build_from_context(set);
-	build = isl_ast_build_set_before_each_for(build,
-			&before_for, &data);
-	build = isl_ast_build_set_after_each_for(build,
-			&after_for, &data);
 	tree = isl_ast_build_ast_from_schedule(build, schedule);
 	isl_ast_build_free(build);
-	if (!tree)
-		return -1;
 
+	reduce = isl_options_get_ast_print_strength_reduce(ctx);
+	isl_options_set_ast_print_strength_reduce(ctx, 1);
+	p = isl_printer_to_str(ctx);
+	p = isl_printer_set_output_format(p, ISL_FORMAT_C);
+	p = isl_printer_print_ast_node(p, tree);
+	s = isl_printer_get_str(p);
+	isl_printer_free(p);
+	isl_options_set_ast_print_strength_reduce(ctx, reduce);
 	isl_ast_node_free(tree);
+	if (!s)
+		return -1;
 
-	if (data.before != 3 || data.after != 3)
+	found = strstr(s, "int c0_q0 = floord(-n, 3);") != NULL &&
+		strstr(s, "A(c0, c0_q0);") != NULL &&
+		strstr(s, "c0_q0 += 1;") != NULL &&
+		strstr(s, "floord(c0, 3)") == NULL;
+	free(s);
+	if (!found)
 		isl_die(ctx, isl_error_unknown,
-			"unexpected number of for nodes", return -1);
+			"division not strength reduced", return -1);
 
 	return 0;
 }
 
-/* Check that the AST generator handles domains that are integrally disjoint
- * but not ratinoally disjoint.
+/* Generate an AST for "schedule_str" with options "options_str"
+ * and return its C representation.
  */
-static int test_ast_gen2(isl_ctx *ctx)
+static char *ast_gen_str(isl_ctx *ctx, const char *schedule_str,
+	const char *options_str)
 {
-	const char *str;
 	isl_set *set;
 	isl_union_map *schedule;
 	isl_union_map *options;
 	isl_ast_build *build;
 	isl_ast_node *tree;
+	isl_printer *p;
+	char *s;
 
-	str = "{ A[i,j] -> [i,j] : 0 <= i,j <= 1 }";
-	schedule = isl_union_map_read_from_str(ctx, str);
+	schedule = isl_union_map_read_from_str(ctx, schedule_str);
+	options = isl_union_map_read_from_str(ctx, options_str);
 	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
 	build = isl_ast_build_from_context(set);
-
-	str = "{ [i,j] -> atomic[1] : i + j = 1; [i,j] -> unroll[1] : i = j }";
-	options = isl_union_map_read_from_str(ctx, str);
 	build = isl_ast_build_set_options(build, options);
 	tree = isl_ast_build_ast_from_schedule(build, schedule);
 	isl_ast_build_free(build);
-	if (!tree)
-		return -1;
+	p = isl_printer_to_str(ctx);
+	p = isl_printer_set_output_format(p, ISL_FORMAT_C);
+	p = isl_printer_print_ast_node(p, tree);
+	s = isl_printer_get_str(p);
+	isl_printer_free(p);
 	isl_ast_node_free(tree);
 
-	return 0;
+	return s;
 }
 
-/* Increment *user on each call.
+/* Check that computing the separated pieces in parallel
+ * produces the same AST as the sequential computation and
+ * that the ast_build_max_pieces option is still respected.
  */
-static __isl_give isl_ast_node *count_domains(__isl_take isl_ast_node *node,
-	__isl_keep isl_ast_build *build, void *user)
+static int test_ast_gen12(isl_ctx *ctx)
 {
-	int *n = user;
+	const char *str;
+	char *s1, *s2;
+	int threads, max;
+	int n_separate_limited, equal;
+
+	str = "[n, m] -> { A[i] -> [i] : 0 <= i < n; "
+		"B[i] -> [i] : 10 <= i < 20; C[i] -> [i] : m <= i < 2m; "
+		"D[i] -> [i] : 5 <= i <= n + m }";
+	threads = isl_options_get_threads(ctx);
+	max = isl_options_get_ast_build_max_pieces(ctx);
+	isl_options_set_threads(ctx, 1);
+	s1 = ast_gen_str(ctx, str, "{ [i] -> separate[0] }");
+	isl_options_set_threads(ctx, 4);
+	s2 = ast_gen_str(ctx, str, "{ [i] -> separate[0] }");
+	isl_options_set_ast_build_max_pieces(ctx, 4);
+	n_separate_limited = count_user_nodes(ctx, str,
+					"{ [i] -> separate[0] }");
+	isl_options_set_ast_build_max_pieces(ctx, max);
+	isl_options_set_threads(ctx, threads);
+
+	equal = s1 && s2 && !strcmp(s1, s2);
+	free(s1);
+	free(s2);
+	if (!equal || n_separate_limited < 0)
+		return -1;
+	if (n_separate_limited != 4)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of separated nodes", return -1);
 
-	(*n)++;
+	return 0;
+}
 
-	return node;
+static int test_ast_gen(isl_ctx *ctx)
+{
+	if (test_ast_gen1(ctx) < 0)
+		return -1;
+	if (test_ast_gen2(ctx) < 0)
+		return -1;
+	if (test_ast_gen3(ctx) < 0)
+		return -1;
+	if (test_ast_gen4(ctx) < 0)
+		return -1;
+	if (test_ast_gen5(ctx) < 0)
+		return -1;
+	if (test_ast_gen6(ctx) < 0)
+		return -1;
+	if (test_ast_gen7(ctx) < 0)
+		return -1;
+	if (test_ast_gen8(ctx) < 0)
+		return -1;
+	if (test_ast_gen9(ctx) < 0)
+		return -1;
+	if (test_ast_gen10(ctx) < 0)
+		return -1;
+	if (test_ast_gen11(ctx) < 0)
+		return -1;
+	if (test_ast_gen12(ctx) < 0)
+		return -1;
+	return 0;
 }
 
-/* Test that unrolling tries to minimize the number of instances.
- * In particular, for the schedule given below, make sure it generates
- * 3 nodes (rather than 101).
+/* Check if dropping output dimensions from an isl_pw_multi_aff
+ * works properly.
  */
-static int test_ast_gen3(isl_ctx *ctx)
+static int test_pw_multi_aff(isl_ctx *ctx)
 {
 	const char *str;
-	isl_set *set;
-	isl_union_map *schedule;
-	isl_union_map *options;
-	isl_ast_build *build;
-	isl_ast_node *tree;
-	int n_domain = 0;
-
-	str = "[n] -> { A[i] -> [i] : 0 <= i <= 100 and n <= i <= n + 2 }";
-	schedule = isl_union_map_read_from_str(ctx, str);
-	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
+	isl_pw_multi_aff *pma1, *pma2;
+	int equal;
 
-	str = "{ [i] -> unroll[0] }";
-	options = isl_union_map_read_from_str(ctx, str);
+	str = "{ [i,j] -> [i+j, 4i-j] }";
+	pma1 = isl_pw_multi_aff_read_from_str(ctx, str);
+	str = "{ [i,j] -> [4i-j] }";
+	pma2 = isl_pw_multi_aff_read_from_str(ctx, str);
 
-	build = isl_ast_build_from_context(set);
-	build = isl_ast_build_set_options(build, options);
-	build = isl_ast_build_set_at_each_domain(build,
-			&count_domains, &n_domain);
-	tree = isl_ast_build_ast_from_schedule(build, schedule);
-	isl_ast_build_free(build);
-	if (!tree)
-		return -1;
+	pma1 = isl_pw_multi_aff_drop_dims(pma1, isl_dim_out, 0, 1);
 
-	isl_ast_node_free(tree);
+	equal = isl_pw_multi_aff_plain_is_equal(pma1, pma2);
 
-	if (n_domain != 3)
+	isl_pw_multi_aff_free(pma1);
+	isl_pw_multi_aff_free(pma2);
+	if (equal < 0)
+		return -1;
+	if (!equal)
 		isl_die(ctx, isl_error_unknown,
-			"unexpected number of for nodes", return -1);
+			"expressions not equal", return -1);
 
 	return 0;
 }
 
-/* Check that if the ast_build_exploit_nested_bounds options is set,
- * we do not get an outer if node in the generated AST,
- * while we do get such an outer if node if the options is not set.
+/* Check that we can properly parse multi piecewise affine expressions
+ * where the piecewise affine expressions have different domains.
  */
-static int test_ast_gen4(isl_ctx *ctx)
+static int test_multi_pw_aff(isl_ctx *ctx)
 {
 	const char *str;
-	isl_set *set;
-	isl_union_map *schedule;
-	isl_ast_build *build;
-	isl_ast_node *tree;
-	enum isl_ast_node_type type;
-	int enb;
+	isl_set *dom, *dom2;
+	isl_multi_pw_aff *mpa1, *mpa2;
+	isl_pw_aff *pa;
+	int equal;
+	int equal_domain;
 
-	enb = isl_options_get_ast_build_exploit_nested_bounds(ctx);
-	str = "[N,M] -> { A[i,j] -> [i,j] : 0 <= i <= N and 0 <= j <= M }";
+	mpa1 = isl_multi_pw_aff_read_from_str(ctx, "{ [i] -> [i] }");
+	dom = isl_set_read_from_str(ctx, "{ [i] : i > 0 }");
+	mpa1 = isl_multi_pw_aff_intersect_domain(mpa1, dom);
+	mpa2 = isl_multi_pw_aff_read_from_str(ctx, "{ [i] -> [2i] }");
+	mpa2 = isl_multi_pw_aff_flat_range_product(mpa1, mpa2);
+	str = "{ [i] -> [(i : i > 0), 2i] }";
+	mpa1 = isl_multi_pw_aff_read_from_str(ctx, str);
 
-	isl_options_set_ast_build_exploit_nested_bounds(ctx, 1);
+	equal = isl_multi_pw_aff_plain_is_equal(mpa1, mpa2);
 
-	schedule = isl_union_map_read_from_str(ctx, str);
-	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
-	build = isl_ast_build_from_context(set);
-	tree = isl_ast_build_ast_from_schedule(build, schedule);
-	isl_ast_build_free(build);
-	if (!tree)
-		return -1;
+	pa = isl_multi_pw_aff_get_pw_aff(mpa1, 0);
+	dom = isl_pw_aff_domain(pa);
+	pa = isl_multi_pw_aff_get_pw_aff(mpa1, 1);
+	dom2 = isl_pw_aff_domain(pa);
+	equal_domain = isl_set_is_equal(dom, dom2);
 
-	type = isl_ast_node_get_type(tree);
-	isl_ast_node_free(tree);
+	isl_set_free(dom);
+	isl_set_free(dom2);
+	isl_multi_pw_aff_free(mpa1);
+	isl_multi_pw_aff_free(mpa2);
 
-	if (type == isl_ast_node_if)
+	if (equal < 0)
+		return -1;
+	if (!equal)
 		isl_die(ctx, isl_error_unknown,
-			"not expecting if node", return -1);
-
-	isl_options_set_ast_build_exploit_nested_bounds(ctx, 0);
+			"expressions not equal", return -1);
 
-	schedule = isl_union_map_read_from_str(ctx, str);
-	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
-	build = isl_ast_build_from_context(set);
-	tree = isl_ast_build_ast_from_schedule(build, schedule);
-	isl_ast_build_free(build);
-	if (!tree)
+	if (equal_domain < 0)
 		return -1;
-
-	type = isl_ast_node_get_type(tree);
-	isl_ast_node_free(tree);
-
-	if (type != isl_ast_node_if)
+	if (equal_domain)
 		isl_die(ctx, isl_error_unknown,
-			"expecting if node", return -1);
-
-	isl_options_set_ast_build_exploit_nested_bounds(ctx, enb);
+			"domains unexpectedly equal", return -1);
 
 	return 0;
 }
 
-/* This function is called for each leaf in the AST generated
- * from test_ast_gen5.
- *
- * We finalize the AST generation by extending the outer schedule
- * with a zero-dimensional schedule.  If this results in any for loops,
- * then this means that we did not pass along enough information
- * about the outer schedule to the inner AST generation.
+/* Basic sets along with the number of inequality constraints
+ * that remain after removing redundant constraints.
  */
-static __isl_give isl_ast_node *create_leaf(__isl_take isl_ast_build *build,
-	void *user)
-{
-	isl_union_map *schedule, *extra;
-	isl_ast_node *tree;
-
-	schedule = isl_ast_build_get_schedule(build);
-	extra = isl_union_map_copy(schedule);
-	extra = isl_union_map_from_domain(isl_union_map_domain(extra));
-	schedule = isl_union_map_range_product(schedule, extra);
-	tree = isl_ast_build_ast_from_schedule(build, schedule);
-	isl_ast_build_free(build);
-
-	if (!tree)
-		return NULL;
+struct {
+	const char *set;
+	int n_ineq;
+} float_filter_tests[] = {
+	{ "{ [x, y] : 0 <= x <= 10 and 0 <= y <= 10 and x + y <= 15 }", 5 },
+	{ "{ [x, y] : 0 <= x <= 10 and 0 <= y <= 10 and x + y <= 30 }", 4 },
+	{ "{ [x, y, z] : x >= 0 and y >= 0 and z >= 0 and "
+		"x + y + z <= 10 and 2x + y <= 30 }", 4 },
+	{ "{ [x, y] : x >= 0 and y >= 0 and x + y <= 0 }", 0 },
+	{ "{ [x, y] : 3y <= 2x and 5y >= 3x - 4 and x <= 20 and "
+		"7y >= 4x - 100 }", 3 },
+};
 
-	if (isl_ast_node_get_type(tree) == isl_ast_node_for)
-		isl_die(isl_ast_node_get_ctx(tree), isl_error_unknown,
-			"code should not contain any for loop",
-			return isl_ast_node_free(tree));
+/* Check that removing redundant constraints from the inputs
+ * in float_filter_tests produces the expected number of constraints,
+ * both with and without the floating point filter, and
+ * that the filter is able to certify some of the results.
+ */
+static int test_float_filter(isl_ctx *ctx)
+{
+	int i, j;
+	int filter;
+	long hits;
+
+	filter = isl_options_get_float_filter(ctx);
+	hits = isl_ctx_get_stat(ctx, "float_filter_hits");
+	for (i = 0; i < ARRAY_SIZE(float_filter_tests); ++i) {
+		for (j = 0; j < 2; ++j) {
+			isl_basic_set *bset;
+			int n;
+
+			isl_options_set_float_filter(ctx, j);
+			bset = isl_basic_set_read_from_str(ctx,
+						float_filter_tests[i].set);
+			bset = isl_basic_set_remove_redundancies(bset);
+			if (!bset)
+				break;
+			n = bset->n_ineq;
+			isl_basic_set_free(bset);
+			if (n != float_filter_tests[i].n_ineq)
+				break;
+		}
+		isl_options_set_float_filter(ctx, filter);
+		if (j < 2)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected number of constraints", return -1);
+	}
+	if (isl_ctx_get_stat(ctx, "float_filter_hits") <= hits)
+		isl_die(ctx, isl_error_unknown,
+			"floating point filter not used", return -1);
 
-	return tree;
+	return 0;
 }
 
-/* Check that we do not lose any information when going back and
- * forth between internal and external schedule.
- *
- * In particular, we create an AST where we unroll the only
- * non-constant dimension in the schedule.  We therefore do
- * not expect any for loops in the AST.  However, older versions
- * of isl would not pass along enough information about the outer
- * schedule when performing an inner code generation from a create_leaf
- * callback, resulting in the inner code generation producing a for loop.
+/* Basic sets from which redundant constraints are removed
+ * in test_batch_redundant.
  */
-static int test_ast_gen5(isl_ctx *ctx)
+const char *batch_redundant_tests[] = {
+	"{ [x, y] : 0 <= x, y <= 10 and x + y <= 30 and x - y <= 15 and "
+		"x + 2y <= 40 and 3x + y >= -5 }",
+	"{ [x, y, z] : 0 <= x, y, z <= 10 and x + y + z <= 25 and "
+		"x + y <= 18 and y + z >= 2 and x - z <= 12 and 2x + 3y <= 70 }",
+	"{ [x, y] : x >= 0 and y >= 0 and x + y <= 1 and 2x + y <= 3 }",
+	"[n] -> { [i, j] : 0 <= i <= n and 0 <= j <= i and j <= n and "
+		"i + j <= 3n and n >= 1 }",
+	"{ [x, y, z] : x + y + z >= 0 and x - y + z >= 0 and "
+		"x + y - z >= 0 and -x + y + z >= 0 and x + y + z <= 12 and "
+		"x <= 100 and y <= 100 and z <= 100 }",
+};
+
+/* Check that removing redundant constraints produces the same results
+ * with and without the use of shared witness points and
+ * that some constraints are actually shown to be irredundant
+ * by such witnesses.  The floating point filter is turned off
+ * to make sure that a tableau is constructed and the shared witness
+ * points are also used for these small systems.
+ */
+static int test_batch_redundant(isl_ctx *ctx)
 {
-	const char *str;
-	isl_set *set;
-	isl_union_map *schedule, *options;
-	isl_ast_build *build;
-	isl_ast_node *tree;
+	int i, j;
+	int batch, batch_min, filter;
+	long n_batch;
+
+	batch = isl_options_get_tab_batch_redundant(ctx);
+	batch_min = isl_options_get_tab_batch_redundant_min(ctx);
+	filter = isl_options_get_float_filter(ctx);
+	isl_options_set_float_filter(ctx, 0);
+	isl_options_set_tab_batch_redundant_min(ctx, 0);
+	n_batch = isl_ctx_get_stat(ctx, "batch_irredundant");
+	for (i = 0; i < ARRAY_SIZE(batch_redundant_tests); ++i) {
+		isl_basic_set *bset[2];
+		int equal;
 
-	str = "{ A[] -> [1, 1, 2]; B[i] -> [1, i, 0] : i >= 1 and i <= 2 }";
-	schedule = isl_union_map_read_from_str(ctx, str);
+		for (j = 0; j < 2; ++j) {
+			isl_options_set_tab_batch_redundant(ctx, j);
+			bset[j] = isl_basic_set_read_from_str(ctx,
+						batch_redundant_tests[i]);
+			bset[j] = isl_basic_set_remove_redundancies(bset[j]);
+		}
+		isl_options_set_tab_batch_redundant(ctx, batch);
+		equal = isl_basic_set_is_equal(bset[0], bset[1]);
+		if (equal >= 0 && equal && bset[0]->n_ineq != bset[1]->n_ineq)
+			equal = 0;
+		isl_basic_set_free(bset[0]);
+		isl_basic_set_free(bset[1]);
+		if (equal < 0)
+			break;
+		if (!equal) {
+			isl_options_set_float_filter(ctx, filter);
+			isl_options_set_tab_batch_redundant_min(ctx,
+								batch_min);
+			isl_die(ctx, isl_error_unknown,
+				"unexpected redundant constraints", return -1);
+		}
+	}
+	isl_options_set_float_filter(ctx, filter);
+	isl_options_set_tab_batch_redundant_min(ctx, batch_min);
+	if (i < ARRAY_SIZE(batch_redundant_tests))
+		return -1;
+	if (isl_ctx_get_stat(ctx, "batch_irredundant") <= n_batch)
+		isl_die(ctx, isl_error_unknown,
+			"no shared witnesses found", return -1);
 
-	str = "{ [a, b, c] -> unroll[1] : exists (e0 = [(a)/4]: "
-				"4e0 >= -1 + a - b and 4e0 <= -2 + a + b) }";
-	options = isl_union_map_read_from_str(ctx, str);
+	return 0;
+}
 
-	set = isl_set_universe(isl_space_params_alloc(ctx, 0));
-	build = isl_ast_build_from_context(set);
-	build = isl_ast_build_set_options(build, options);
-        build = isl_ast_build_set_create_leaf(build, &create_leaf, NULL);
-	tree = isl_ast_build_ast_from_schedule(build, schedule);
-	isl_ast_build_free(build);
-	isl_ast_node_free(tree);
-	if (!tree)
-		return -1;
+/* Basic sets along with their emptiness, the integer points of which
+ * can only be found (or shown not to exist) by a search.
+ */
+struct {
+	const char *set;
+	int empty;
+} sample_search_tests[] = {
+	{ "{ [x, y, z] : -11x + 3y + 12z = 8 and 15 <= 10x + 9y - 13z <= 18 and "
+		"-20 <= x, y, z <= 20 }", 0 },
+	{ "{ [x, y, z] : 5y - 3z = 15 and 28 <= 10x - 9y - 12z <= 31 and "
+		"-20 <= x, y, z <= 20 }", 0 },
+	{ "{ [x, y, z] : 14 <= -2x + 4y + 9z <= 16 and "
+		"23 <= 9x - 15y + 7z <= 24 and -20 <= x, y, z <= 20 }", 0 },
+	{ "{ [x, y, z] : 27 <= 8x - 15y <= 30 and 20 <= -14x - 6y + 7z <= 21 and "
+		"-20 <= x, y, z <= 20 }", 1 },
+	{ "{ [x, y, z] : 5 <= -13x - 10y - 10z <= 7 and "
+		"20 <= -7x + y + 15z <= 22 and -20 <= x, y, z <= 20 }", 1 },
+	{ "{ [a, b, c, d, e] : -6 <= a, b, c, d, e <= 6 and "
+		"-40 <= -7a + 6b - 3c - 9d + 4e <= -34 and "
+		"-44 <= -16a - 12b + 19c + 19d + 8e <= -43 and "
+		"51 <= -20a - 20b - 7c - 7d - 10e <= 52 }", 1 },
+	{ "{ [a, b, c, d, e, f] : -10 <= a, b, c, d, e, f <= 10 and "
+		"-49 <= 10a + 32b + 29c - 20d - 32e + 46f <= -11 and "
+		"70 <= 19a - 5b - 22c - 3d - 8e - 32f <= 73 and "
+		"-88 <= -11a + 28b + 45c - 15d - 27e - 30f <= -87 }", 0 },
+	{ "{ [x, y, z, u, v] : 14 <= -2x + 4y + 9z <= 16 and "
+		"23 <= 9x - 15y + 7z <= 24 and -20 <= x, y, z <= 20 and "
+		"3 <= 4u + 7v <= 5 and -10 <= u, v <= 10 }", 0 },
+	{ "{ [x, y, z, u, v] : 27 <= 8x - 15y <= 30 and "
+		"20 <= -14x - 6y + 7z <= 21 and -20 <= x, y, z <= 20 and "
+		"3 <= 4u + 7v <= 5 and -10 <= u, v <= 10 }", 1 },
+};
+
+/* Check that the integer sampling produces consistent results
+ * on the inputs in sample_search_tests, independently of
+ * the order in which the values are scanned and
+ * of whether the search is split over several threads.
+ */
+static int test_sample_search(isl_ctx *ctx)
+{
+	int i, j;
+	int centre_out;
+	int n_thread;
+	long nodes;
+
+	centre_out = isl_options_get_sample_centre_out(ctx);
+	n_thread = isl_options_get_threads(ctx);
+	nodes = isl_ctx_get_stat(ctx, "sample_nodes");
+	for (i = 0; i < ARRAY_SIZE(sample_search_tests); ++i) {
+		for (j = 0; j < 3; ++j) {
+			isl_basic_set *bset, *sample;
+			int empty, subset;
+
+			isl_options_set_sample_centre_out(ctx, j == 1);
+			isl_options_set_threads(ctx, j < 2 ? 1 : 4);
+			bset = isl_basic_set_read_from_str(ctx,
+						sample_search_tests[i].set);
+			sample = isl_basic_set_sample(isl_basic_set_copy(bset));
+			empty = isl_basic_set_is_empty(sample);
+			subset = isl_basic_set_is_subset(sample, bset);
+			isl_basic_set_free(sample);
+			isl_basic_set_free(bset);
+			if (empty < 0 || subset < 0)
+				break;
+			if (empty != sample_search_tests[i].empty || !subset)
+				break;
+		}
+		isl_options_set_sample_centre_out(ctx, centre_out);
+		isl_options_set_threads(ctx, n_thread);
+		if (j < 3)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected sampling result", return -1);
+	}
+	if (isl_ctx_get_stat(ctx, "sample_nodes") <= nodes)
+		isl_die(ctx, isl_error_unknown,
+			"no search performed", return -1);
 
 	return 0;
 }
 
-static int test_ast_gen(isl_ctx *ctx)
+/* Check that the emptiness tests on the inputs in sample_search_tests
+ * produce the same results when the sample cache is enabled,
+ * that repeated tests are answered from the cache and
+ * that the cache does not grow beyond its specified size.
+ */
+static int test_sample_cache(isl_ctx *ctx)
 {
-	if (test_ast_gen1(ctx) < 0)
-		return -1;
-	if (test_ast_gen2(ctx) < 0)
-		return -1;
-	if (test_ast_gen3(ctx) < 0)
-		return -1;
-	if (test_ast_gen4(ctx) < 0)
-		return -1;
-	if (test_ast_gen5(ctx) < 0)
-		return -1;
+	int i, j;
+	int size;
+	long hits;
+
+	size = isl_options_get_sample_cache_size(ctx);
+	isl_options_set_sample_cache_size(ctx, 2);
+	hits = isl_ctx_get_stat(ctx, "sample_cache_hits");
+	for (j = 0; j < 2; ++j) {
+		for (i = 0; i < ARRAY_SIZE(sample_search_tests); ++i) {
+			isl_basic_set *bset;
+			int empty;
+
+			bset = isl_basic_set_read_from_str(ctx,
+						sample_search_tests[i].set);
+			empty = isl_basic_set_is_empty(bset);
+			if (empty >= 0)
+				empty = isl_basic_set_is_empty(bset);
+			isl_basic_set_free(bset);
+			if (empty < 0)
+				break;
+			if (empty != sample_search_tests[i].empty)
+				break;
+			bset = isl_basic_set_read_from_str(ctx,
+						sample_search_tests[i].set);
+			empty = isl_basic_set_is_empty(bset);
+			isl_basic_set_free(bset);
+			if (empty != sample_search_tests[i].empty)
+				break;
+			if (ctx->n_sample_cache > 2)
+				break;
+		}
+		if (i < ARRAY_SIZE(sample_search_tests))
+			break;
+	}
+	isl_options_set_sample_cache_size(ctx, size);
+	if (j < 2)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected result with sample cache", return -1);
+	if (isl_ctx_get_stat(ctx, "sample_cache_hits") <= hits)
+		isl_die(ctx, isl_error_unknown,
+			"sample cache not used", return -1);
+
 	return 0;
 }
 
-/* Check if dropping output dimensions from an isl_pw_multi_aff
- * works properly.
+/* Check that the sample point that is computed by an emptiness test
+ * is kept when dimensions are inserted, moved or dropped,
+ * so that the resulting basic set is known to be non-empty
+ * without solving another sampling problem.
  */
-static int test_pw_multi_aff(isl_ctx *ctx)
+static int test_sample_keep(isl_ctx *ctx)
 {
+	isl_basic_set *bset;
 	const char *str;
-	isl_pw_multi_aff *pma1, *pma2;
-	int equal;
+	int empty, keep;
 
-	str = "{ [i,j] -> [i+j, 4i-j] }";
-	pma1 = isl_pw_multi_aff_read_from_str(ctx, str);
-	str = "{ [i,j] -> [4i-j] }";
-	pma2 = isl_pw_multi_aff_read_from_str(ctx, str);
+	str = "{ [x, y, z] : 3x + 5y >= 7 and 2x - 7y <= 3 and "
+		"x + y + z <= 100 and x + 2y >= 12 }";
+	bset = isl_basic_set_read_from_str(ctx, str);
+	empty = isl_basic_set_is_empty(bset);
+	bset = isl_basic_set_insert_dims(bset, isl_dim_set, 1, 2);
+	bset = isl_basic_set_move_dims(bset, isl_dim_param, 0,
+					isl_dim_set, 0, 1);
+	bset = isl_basic_set_drop(bset, isl_dim_set, 0, 2);
+	keep = bset && bset->sample &&
+	    bset->sample->size == 1 + isl_basic_set_total_dim(bset) &&
+	    isl_basic_set_contains(bset, bset->sample);
+	if (keep)
+		empty = isl_basic_set_is_empty(bset);
+	isl_basic_set_free(bset);
+	if (empty < 0)
+		return -1;
+	if (empty || !keep)
+		isl_die(ctx, isl_error_unknown,
+			"sample point not kept", return -1);
 
-	pma1 = isl_pw_multi_aff_drop_dims(pma1, isl_dim_out, 0, 1);
+	return 0;
+}
 
-	equal = isl_pw_multi_aff_plain_is_equal(pma1, pma2);
+/* Check that the floating point pre-reduction of the basis
+ * in generalized basis reduction does not affect the sample point
+ * found in a thin, skewed set, while it does reduce the number of LPs
+ * that need to be solved by the exact reduction.
+ */
+static int test_gbr_lll(isl_ctx *ctx)
+{
+	const char *str;
+	isl_basic_set *bset;
+	isl_point *pnt1, *pnt2;
+	isl_set *set1, *set2;
+	int lll, empty, equal;
+	long lps1, lps2;
 
-	isl_pw_multi_aff_free(pma1);
-	isl_pw_multi_aff_free(pma2);
-	if (equal < 0)
+	str = "{ [x, y] : 1 <= 101x - 103y <= 2 and 500 <= x + y <= 1000 }";
+	lll = isl_options_get_gbr_lll(ctx);
+	isl_options_set_gbr_lll(ctx, 0);
+	lps1 = ctx->stats->gbr_solved_lps;
+	bset = isl_basic_set_read_from_str(ctx, str);
+	pnt1 = isl_basic_set_sample_point(bset);
+	lps1 = ctx->stats->gbr_solved_lps - lps1;
+	isl_options_set_gbr_lll(ctx, 1);
+	lps2 = ctx->stats->gbr_solved_lps;
+	bset = isl_basic_set_read_from_str(ctx, str);
+	pnt2 = isl_basic_set_sample_point(bset);
+	lps2 = ctx->stats->gbr_solved_lps - lps2;
+	isl_options_set_gbr_lll(ctx, lll);
+	empty = isl_point_is_void(pnt1);
+	set1 = isl_set_from_point(pnt1);
+	set2 = isl_set_from_point(pnt2);
+	equal = isl_set_is_equal(set1, set2);
+	isl_set_free(set1);
+	isl_set_free(set2);
+
+	if (empty < 0 || equal < 0)
 		return -1;
-	if (!equal)
+	if (empty || !equal)
 		isl_die(ctx, isl_error_unknown,
-			"expressions not equal", return -1);
+			"unexpected sample point", return -1);
+	if (lps2 >= lps1)
+		isl_die(ctx, isl_error_unknown,
+			"basis not pre-reduced", return -1);
 
 	return 0;
 }
 
-/* Check that we can properly parse multi piecewise affine expressions
- * where the piecewise affine expressions have different domains.
+/* Pairs of sets along with their expected equality.
+ * The sets in the first pairs are only equal after normalization.
+ * For the other pairs, an emptiness test on the first set
+ * produces a sample point that does not belong to the second set.
  */
-static int test_multi_pw_aff(isl_ctx *ctx)
+struct {
+	const char *set1;
+	const char *set2;
+	int equal;
+} equal_fast_tests[] = {
+	{ "{ [x, y] : 0 <= x <= 10 and y = 2x }",
+	  "{ [x, y] : y = 2x and x <= 10 and x >= 0 }", 1 },
+	{ "{ [x] : 0 <= x <= 10; [x] : 20 <= x <= 30 }",
+	  "{ [x] : 20 <= x <= 30; [x] : 0 <= x <= 10 }", 1 },
+	{ "{ [x, y] : x >= 3 and y >= 2x and x + y <= 100 }",
+	  "{ [x, y] : x >= 4 and y >= 2x and x + y <= 100 }", 0 },
+	{ "{ [x] : exists e : x = 3e and 0 <= x <= 30 }",
+	  "{ [x] : exists e : x = 3e + 1 and 0 <= x <= 30 }", 0 },
+};
+
+/* Check that the equality tests on the pairs in equal_fast_tests
+ * produce the expected results without performing any subset tests.
+ */
+static int test_equal_fast(isl_ctx *ctx)
 {
-	const char *str;
-	isl_set *dom, *dom2;
-	isl_multi_pw_aff *mpa1, *mpa2;
-	isl_pw_aff *pa;
+	int i;
+	long misses;
+
+	misses = isl_ctx_get_stat(ctx, "equal_fast_misses");
+	for (i = 0; i < ARRAY_SIZE(equal_fast_tests); ++i) {
+		isl_set *set1, *set2;
+		int equal;
+
+		set1 = isl_set_read_from_str(ctx, equal_fast_tests[i].set1);
+		set2 = isl_set_read_from_str(ctx, equal_fast_tests[i].set2);
+		equal = isl_set_is_empty(set1);
+		if (equal >= 0)
+			equal = isl_set_is_equal(set1, set2);
+		isl_set_free(set1);
+		isl_set_free(set2);
+		if (equal < 0)
+			return -1;
+		if (equal != equal_fast_tests[i].equal)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected equality result", return -1);
+	}
+	if (isl_ctx_get_stat(ctx, "equal_fast_misses") != misses)
+		isl_die(ctx, isl_error_unknown,
+			"equality not decided by fast path", return -1);
+
+	return 0;
+}
+
+/* Pairs of sets along with whether they are plainly equal,
+ * i.e., equal after normalization.
+ */
+struct {
+	const char *set1;
+	const char *set2;
 	int equal;
-	int equal_domain;
+} plain_equal_tests[] = {
+	{ "{ [x] : 0 <= x <= 1; [x] : 3 <= x <= 4; [x] : 6 <= x <= 7; "
+		"[x] : 9 <= x <= 10 and x = 9 }",
+	  "{ [x] : x = 9; [x] : 6 <= x <= 7; [x] : 3 <= x <= 4; "
+		"[x] : 0 <= x <= 1 }", 1 },
+	{ "{ [x, y] : x = y and 0 <= x <= 5; [x, y] : x = -y and 0 <= x <= 5; "
+		"[x, y] : 0 <= x, y <= 1 }",
+	  "{ [x, y] : 0 <= x, y <= 1; [x, y] : y = x and 0 <= x <= 5; "
+		"[x, y] : x = -y and 0 <= x <= 5 }", 1 },
+	{ "{ [x] : 0 <= x <= 1; [x] : 3 <= x <= 4 }",
+	  "{ [x] : 0 <= x <= 1; [x] : 3 <= x <= 5 }", 0 },
+};
 
-	mpa1 = isl_multi_pw_aff_read_from_str(ctx, "{ [i] -> [i] }");
-	dom = isl_set_read_from_str(ctx, "{ [i] : i > 0 }");
-	mpa1 = isl_multi_pw_aff_intersect_domain(mpa1, dom);
-	mpa2 = isl_multi_pw_aff_read_from_str(ctx, "{ [i] -> [2i] }");
-	mpa2 = isl_multi_pw_aff_flat_range_product(mpa1, mpa2);
-	str = "{ [i] -> [(i : i > 0), 2i] }";
-	mpa1 = isl_multi_pw_aff_read_from_str(ctx, str);
+/* Check that isl_set_plain_is_equal produces the expected results
+ * on the pairs in plain_equal_tests and that the same results
+ * are obtained when duplicate disjuncts are added to the second set.
+ */
+static int test_plain_equal(isl_ctx *ctx)
+{
+	int i;
 
-	equal = isl_multi_pw_aff_plain_is_equal(mpa1, mpa2);
+	for (i = 0; i < ARRAY_SIZE(plain_equal_tests); ++i) {
+		isl_set *set1, *set2;
+		int equal, equal_dup;
 
-	pa = isl_multi_pw_aff_get_pw_aff(mpa1, 0);
-	dom = isl_pw_aff_domain(pa);
-	pa = isl_multi_pw_aff_get_pw_aff(mpa1, 1);
-	dom2 = isl_pw_aff_domain(pa);
-	equal_domain = isl_set_is_equal(dom, dom2);
+		set1 = isl_set_read_from_str(ctx, plain_equal_tests[i].set1);
+		set2 = isl_set_read_from_str(ctx, plain_equal_tests[i].set2);
+		equal = isl_set_plain_is_equal(set1, set2);
+		set2 = isl_set_union_disjoint(set2, isl_set_copy(set2));
+		equal_dup = isl_set_plain_is_equal(set1, set2);
+		isl_set_free(set1);
+		isl_set_free(set2);
+		if (equal < 0 || equal_dup < 0)
+			return -1;
+		if (equal != plain_equal_tests[i].equal ||
+		    equal_dup != plain_equal_tests[i].equal)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected plain equality result", return -1);
+	}
 
-	isl_set_free(dom);
-	isl_set_free(dom2);
-	isl_multi_pw_aff_free(mpa1);
-	isl_multi_pw_aff_free(mpa2);
+	return 0;
+}
 
-	if (equal < 0)
-		return -1;
-	if (!equal)
-		isl_die(ctx, isl_error_unknown,
-			"expressions not equal", return -1);
+/* Basic sets along with their emptiness, some of which can be decided
+ * by bound propagation and some of which cannot.
+ */
+struct {
+	const char *set;
+	int empty;
+} bound_prop_tests[] = {
+	{ "{ [x, y] : x >= 5 and y >= x + 1 and y <= 3 }", 1 },
+	{ "{ [x, y] : x >= 3 and y >= 2x and x + y <= 100 }", 0 },
+	{ "{ [x, y, z] : x >= 0 and y >= x + 2 and z >= x + y and "
+		"z <= 1 }", 1 },
+	{ "{ [x, y] : x <= -2 and y <= x - 3 and 2y >= -20 }", 0 },
+	{ "{ [x, y] : 0 <= x, y <= 10 and x + y = 7 and x - y = 1 }", 0 },
+	{ "{ [x, y] : 0 <= x, y <= 10 and 2x + 2y = 7 + 2x - 2y }", 1 },
+	{ "{ [x, y] : x >= y + 1 and y >= x + 1 }", 1 },
+	{ "{ [x, y] : exists e : x = 3e and y = x + 1 and 5 <= y <= 6 }", 1 },
+};
 
-	if (equal_domain < 0)
-		return -1;
-	if (equal_domain)
+/* Check that isl_basic_set_is_empty produces the correct results
+ * on the inputs in bound_prop_tests and that some of them
+ * are decided by bound propagation.
+ */
+static int test_bound_prop_empty(isl_ctx *ctx)
+{
+	int i;
+	long hits;
+
+	hits = isl_ctx_get_stat(ctx, "bound_prop_hits");
+	for (i = 0; i < ARRAY_SIZE(bound_prop_tests); ++i) {
+		isl_basic_set *bset;
+		int empty;
+
+		bset = isl_basic_set_read_from_str(ctx, bound_prop_tests[i].set);
+		empty = isl_basic_set_is_empty(bset);
+		isl_basic_set_free(bset);
+		if (empty < 0)
+			return -1;
+		if (empty != bound_prop_tests[i].empty)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected emptiness", return -1);
+	}
+	if (isl_ctx_get_stat(ctx, "bound_prop_hits") <= hits)
 		isl_die(ctx, isl_error_unknown,
-			"domains unexpectedly equal", return -1);
+			"bound propagation not used", return -1);
+
+	return 0;
+}
+
+/* Inputs for Gaussian elimination tests.
+ * "set" is a set involving large coefficients, "point" is a point
+ * and "in" is set if "point" is an element of "set".
+ */
+struct {
+	const char *set;
+	const char *point;
+	int in;
+} gauss_tests[] = {
+	{ "{ [y, z, x] : x = 4611686018427387904 y + z and "
+		"3x >= 4611686018427387904 y }",
+	  "{ [1, -3074457345618258602, 1537228672809129302] }", 1 },
+	{ "{ [y, z, x] : x = 4611686018427387904 y + z and "
+		"3x >= 4611686018427387904 y }",
+	  "{ [1, -3074457345618258603, 1537228672809129301] }", 0 },
+	{ "{ [y, z, x] : 2x = 9223372036854775806 y + 4 z and "
+		"x <= 3 }",
+	  "{ [0, 1, 2] }", 1 },
+	{ "{ [y, z, x] : 2x = 9223372036854775806 y + 4 z and "
+		"x <= 3 }",
+	  "{ [0, 2, 4] }", 0 },
+};
+
+/* Check that Gaussian elimination produces correct results
+ * on constraints with coefficients that are close to
+ * or beyond the size of a machine integer.
+ */
+static int test_gauss(isl_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(gauss_tests); ++i) {
+		isl_set *set, *point;
+		int in;
+
+		set = isl_set_read_from_str(ctx, gauss_tests[i].set);
+		point = isl_set_read_from_str(ctx, gauss_tests[i].point);
+		in = isl_set_is_subset(point, set);
+		isl_set_free(set);
+		isl_set_free(point);
+		if (in < 0)
+			return -1;
+		if (in != gauss_tests[i].in)
+			isl_die(ctx, isl_error_unknown,
+				"unexpected result of Gaussian elimination",
+				return -1);
+	}
 
 	return 0;
 }
@@ -4899,6 +12226,156 @@ static int test_simplify(isl_ctx *ctx)
 	return 0;
 }
 
+/* Maps for which the computation of the lexicographic minimum
+ * involves context splits where several rows can attain both signs.
+ */
+const char *split_inherit_tests[] = {
+	"[K, N] -> { [x, y] -> [a, b] : K+2<=N<=K+4 and x>=4 and "
+		"2N-6<=x<K+N and N-1<=a<=K+N-1 and N+b-6<=a<=2N-4 and "
+		"b<=2N-3K+a and 3b<=4N-K+1 and b>=N and a>=x+1 }",
+	"[n, m] -> { [i, j] -> [a, b] : 0 <= a <= n and 0 <= b <= m and "
+		"a + b >= i and a - b <= j and 2a + b >= i + j }",
+};
+
+/* Check that the lexicographic minimum of the maps in
+ * split_inherit_tests does not depend on whether row signs
+ * are inherited across context splits and that some signs
+ * are effectively inherited.
+ */
+static int test_pip_split_inherit(isl_ctx *ctx)
+{
+	int i;
+	int inherit;
+	long inherited;
+
+	inherit = isl_options_get_pip_split_inherit(ctx);
+	inherited = isl_ctx_get_stat(ctx, "pip_inherited_signs");
+	for (i = 0; i < ARRAY_SIZE(split_inherit_tests); ++i) {
+		isl_map *map, *min0, *min1;
+		int equal;
+
+		map = isl_map_read_from_str(ctx, split_inherit_tests[i]);
+		isl_options_set_pip_split_inherit(ctx, 0);
+		min0 = isl_map_lexmin(isl_map_copy(map));
+		isl_options_set_pip_split_inherit(ctx, 1);
+		min1 = isl_map_lexmin(map);
+		equal = isl_map_plain_is_equal(min0, min1);
+		isl_map_free(min0);
+		isl_map_free(min1);
+		if (equal < 0)
+			break;
+		if (!equal)
+			isl_die(ctx, isl_error_unknown,
+				"result depends on inheritance of row signs",
+				break);
+	}
+	isl_options_set_pip_split_inherit(ctx, inherit);
+	if (i < ARRAY_SIZE(split_inherit_tests))
+		return -1;
+	if (isl_ctx_get_stat(ctx, "pip_inherited_signs") <= inherited)
+		isl_die(ctx, isl_error_unknown,
+			"no row signs inherited", return -1);
+
+	return 0;
+}
+
+/* Check that isl_set_normalize removes all duplicate disjuncts
+ * from a set with many copies of a few basic sets
+ * and that the result is equal to the input.
+ */
+static int test_normalize_duplicates(isl_ctx *ctx)
+{
+	int i;
+	int equal;
+	const char *str[] = {
+		"{ [i] : 0 <= i <= 10 }",
+		"{ [i] : 20 <= i <= 30 }",
+		"{ [i] : exists a : i = 2a and 40 <= i <= 50 }",
+	};
+	int n = ARRAY_SIZE(str);
+	isl_set *set, *norm;
+
+	set = isl_set_alloc_space(isl_space_set_alloc(ctx, 0, 1), 100 * n, 0);
+	for (i = 0; i < 100 * n; ++i) {
+		isl_basic_set *bset;
+		bset = isl_basic_set_read_from_str(ctx, str[(7 * i) % n]);
+		set = isl_set_add_basic_set(set, bset);
+	}
+	norm = isl_set_normalize(isl_set_copy(set));
+	if (!norm)
+		goto error;
+	if (isl_set_n_basic_set(norm) != n) {
+		isl_set_free(norm);
+		isl_die(ctx, isl_error_unknown,
+			"unexpected number of disjuncts", goto error);
+	}
+	equal = isl_set_is_equal(set, norm);
+	isl_set_free(norm);
+	isl_set_free(set);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"normalization changed set", return -1);
+
+	return 0;
+error:
+	isl_set_free(set);
+	return -1;
+}
+
+/* Check that the adaptive context mode switches to a gbr context
+ * after some hard integer feasibility checks in lexmin contexts and
+ * that the results are the same as those obtained with a gbr context.
+ * The input is derived from test_inputs/seghir-vd.pip.
+ */
+static int test_pip_adaptive_context(isl_ctx *ctx)
+{
+	int i;
+	int context;
+	int switched;
+	long switches;
+	const char *str;
+	isl_set *set, *min, *ref;
+	int equal = 1;
+
+	str = "[p0, p1, p2, p3] -> { [x0, x1] : p0 + p1 + 2 = 0 and "
+		"2x0 + x1 + p2 >= 0 and x1 >= p1 + 1 and 2x0 + x1 <= -1 and "
+		"7x0 + 3x1 >= 1 and 6x0 + 4x1 <= p1 + 3p3 + 1 and "
+		"7x0 + 3x1 <= p2 + 6p3 + 4 and p3 >= 0 }";
+	set = isl_set_read_from_str(ctx, str);
+
+	context = ctx->opt->context;
+	ctx->opt->context = ISL_CONTEXT_GBR;
+	ref = isl_set_lexmin(isl_set_copy(set));
+
+	ctx->opt->context = ISL_CONTEXT_ADAPTIVE;
+	switched = ctx->pip_adaptive_gbr;
+	ctx->pip_adaptive_gbr = 0;
+	ctx->pip_hard_lexmin = 0;
+	switches = isl_ctx_get_stat(ctx, "pip_context_switches");
+	for (i = 0; equal == 1 && i < 3; ++i) {
+		min = isl_set_lexmin(isl_set_copy(set));
+		equal = isl_set_is_equal(min, ref);
+		isl_set_free(min);
+	}
+	ctx->opt->context = context;
+	ctx->pip_adaptive_gbr = switched;
+
+	isl_set_free(set);
+	isl_set_free(ref);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"result depends on context type", return -1);
+	if (isl_ctx_get_stat(ctx, "pip_context_switches") <= switches)
+		isl_die(ctx, isl_error_unknown,
+			"no switch to gbr context", return -1);
+
+	return 0;
+}
+
 /* This is a regression test for a bug where isl_tab_basic_map_partial_lexopt
  * with gbr context would fail to disable the use of the shifted tableau
  * when transferring equalities for the input to the context, resulting
@@ -4957,6 +12434,19 @@ struct {
 	  "{ rat: coefficients[[cst] -> [a]] }" },
 	{ "{ rat: [i] : }",
 	  "{ rat: coefficients[[cst] -> [0]] : cst >= 0 }" },
+	{ "{ rat: [i, j] : i >= 0 and j >= i }",
+	  "{ rat: coefficients[[cst] -> [a, b]] : "
+		"cst >= 0 and b >= 0 and a + b >= 0 }" },
+	{ "[n] -> { rat: [i] : i = n and i >= 0 }",
+	  "{ rat: coefficients[[cst, n] -> [i]] : cst >= 0 and i + n >= 0 }" },
+	{ "{ rat: [i, j] : i = 2 and j >= 1 }",
+	  "{ rat: coefficients[[cst] -> [a, b]] : "
+		"b >= 0 and cst + 2a + b >= 0 }" },
+	{ "{ rat: [i, j] : i + j >= 0 }",
+	  "{ rat: coefficients[[cst] -> [a, a]] : cst >= 0 and a >= 0 }" },
+	{ "{ rat: [i, j] : 2i + 3j >= 1 and i - j >= 0 }",
+	  "{ rat: coefficients[[cst] -> [a, b]] : "
+		"a + b >= 0 and 3a - 2b >= 0 and 5cst + a + b >= 0 }" },
 };
 
 struct {
@@ -4971,6 +12461,46 @@ struct {
 	  "{ rat: [i] : FALSE }" },
 };
 
+/* Check that computing the coefficients of the same set twice
+ * reuses the result of the first computation and
+ * that the result is the same as without coefficients cache.
+ */
+static int test_coefficients_cache(isl_ctx *ctx)
+{
+	const char *str = "{ [i, j] : 0 <= i <= 10 and i <= j <= 2i + 3 }";
+	isl_basic_set *bset;
+	isl_basic_set *coef1, *coef2, *coef3;
+	long hits;
+	int size;
+	int equal;
+
+	bset = isl_basic_set_read_from_str(ctx, str);
+	size = isl_options_get_coefficients_cache_size(ctx);
+	isl_options_set_coefficients_cache_size(ctx, 0);
+	coef1 = isl_basic_set_coefficients(isl_basic_set_copy(bset));
+	isl_options_set_coefficients_cache_size(ctx, size);
+	coef2 = isl_basic_set_coefficients(isl_basic_set_copy(bset));
+	hits = isl_ctx_get_stat(ctx, "coefficients_cache_hits");
+	coef3 = isl_basic_set_coefficients(bset);
+	equal = isl_basic_set_is_equal(coef1, coef2);
+	if (equal >= 0 && equal)
+		equal = isl_basic_set_is_equal(coef1, coef3);
+	isl_basic_set_free(coef1);
+	isl_basic_set_free(coef2);
+	isl_basic_set_free(coef3);
+	if (equal < 0)
+		return -1;
+	if (!equal)
+		isl_die(ctx, isl_error_unknown,
+			"coefficients cache changes result", return -1);
+	if (size > 0 &&
+	    isl_ctx_get_stat(ctx, "coefficients_cache_hits") <= hits)
+		isl_die(ctx, isl_error_unknown,
+			"coefficients cache not used", return -1);
+
+	return 0;
+}
+
 /* Test the basic functionality of isl_basic_set_coefficients and
  * isl_basic_set_solutions.
  */
@@ -5012,6 +12542,50 @@ static int test_dual(isl_ctx *ctx)
 				"incorrect dual", return -1);
 	}
 
+	if (test_coefficients_cache(ctx) < 0)
+		return -1;
+
+	return 0;
+}
+
+/* Check that isl_ids with the same name share the same interned name,
+ * irrespective of their user pointers, and that allocating
+ * an isl_id with the name of an existing isl_id, passed either
+ * as a copy of the name or as the interned name itself,
+ * returns the existing isl_id.
+ */
+static int test_id_intern(isl_ctx *ctx)
+{
+	char name[] = "intern";
+	isl_id *id1, *id2, *id3, *id4;
+	int ok;
+
+	id1 = isl_id_alloc(ctx, name, NULL);
+	id2 = isl_id_alloc(ctx, name, &ok);
+	id3 = isl_id_alloc(ctx, isl_id_get_name(id2), NULL);
+	name[0] = 'I';
+	id4 = isl_id_alloc(ctx, name, NULL);
+	ok = id1 && id2 && id3 && id4 &&
+	    isl_id_get_name(id1) == isl_id_get_name(id2) &&
+	    id1 != id2 && id1 == id3 && id1 != id4 &&
+	    !strcmp(isl_id_get_name(id4), "Intern") &&
+	    isl_id_get_hash(id1) == isl_id_get_hash(id2);
+	isl_id_free(id1);
+	isl_id_free(id2);
+	isl_id_free(id3);
+	isl_id_free(id4);
+
+	if (!ok)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected identifiers", return -1);
+
+	id1 = isl_id_alloc(ctx, "intern", NULL);
+	ok = id1 && !strcmp(isl_id_get_name(id1), "intern");
+	isl_id_free(id1);
+	if (!ok)
+		isl_die(ctx, isl_error_unknown,
+			"unexpected identifier", return -1);
+
 	return 0;
 }
 
@@ -5020,21 +12594,50 @@ struct {
 	int (*fn)(isl_ctx *ctx);
 } tests [] = {
 	{ "dual", &test_dual },
+	{ "identifier interning", &test_id_intern },
 	{ "dependence analysis", &test_flow },
+	{ "int", &test_int },
+	{ "sequence hash", &test_seq_hash },
+	{ "sort", &test_sort },
+	{ "Hermite normal form", &test_left_hermite },
+	{ "strongly connected components", &test_tarjan },
+	{ "block cache", &test_blk_cache },
+	{ "deferred free", &test_deferred_free },
+	{ "arena", &test_arena },
+	{ "compact", &test_compact },
+	{ "small vector", &test_vec_small },
+	{ "memory bound", &test_max_memory },
+	{ "deadline", &test_deadline },
+	{ "worker isl_ctx", &test_worker_ctx },
+	{ "worker threads", &test_thread_run },
+	{ "hash table", &test_hash_table },
+	{ "associative array", &test_hmap },
+	{ "profile", &test_profile },
+	{ "profile allocations", &test_profile_allocations },
+	{ "trace", &test_trace },
+	{ "free lists", &test_free_list },
 	{ "val", &test_val },
 	{ "compute divs", &test_compute_divs },
 	{ "partial lexmin", &test_partial_lexmin },
+	{ "pip split inheritance", &test_pip_split_inherit },
+	{ "pip adaptive context", &test_pip_adaptive_context },
+	{ "normalize duplicates", &test_normalize_duplicates },
 	{ "simplify", &test_simplify },
+	{ "Gaussian elimination", &test_gauss },
 	{ "curry", &test_curry },
 	{ "piecewise multi affine expressions", &test_pw_multi_aff },
 	{ "multi piecewise affine expressions", &test_multi_pw_aff },
 	{ "conversion", &test_conversion },
 	{ "list", &test_list },
+	{ "constraint views", &test_constraint_view },
+	{ "borrowing iteration", &test_foreach_peek },
 	{ "align parameters", &test_align_parameters },
+	{ "dimension edits", &test_dim_edits },
 	{ "preimage", &test_preimage },
 	{ "pullback", &test_pullback },
 	{ "AST", &test_ast },
 	{ "AST build", &test_ast_build },
+	{ "AST expression memo", &test_ast_build_expr_memo },
 	{ "AST generation", &test_ast_gen },
 	{ "eliminate", &test_eliminate },
 	{ "residue class", &test_residue_class },
@@ -5047,21 +12650,50 @@ struct {
 	{ "fixed", &test_fixed },
 	{ "equal", &test_equal },
 	{ "disjoint", &test_disjoint },
+	{ "box", &test_box },
+	{ "scan", &test_scan },
+	{ "card", &test_card },
+	{ "compile", &test_compile },
+	{ "fold", &test_fold_redundant },
+	{ "binary", &test_binary },
+	{ "fingerprint", &test_fingerprint },
+	{ "import", &test_import },
 	{ "product", &test_product },
 	{ "dim_max", &test_dim_max },
 	{ "affine", &test_aff },
 	{ "injective", &test_injective },
 	{ "schedule", &test_schedule },
 	{ "union_pw", &test_union_pw },
+	{ "union map apply", &test_union_map_apply },
+	{ "union set from list", &test_union_set_from_list },
 	{ "parse", &test_parse },
 	{ "single-valued", &test_sv },
 	{ "affine hull", &test_affine_hull },
 	{ "coalesce", &test_coalesce },
+	{ "simplify budget", &test_simplify_budget },
 	{ "factorize", &test_factorize },
 	{ "subset", &test_subset },
 	{ "subtract", &test_subtract },
+	{ "make disjoint", &test_make_disjoint },
 	{ "lexmin", &test_lexmin },
+	{ "foreach lexopt", &test_foreach_lexopt },
+	{ "incremental LP", &test_tab_lp },
+	{ "lean tableau", &test_tab_lean },
+	{ "bound propagation", &test_bound_prop_empty },
+	{ "range bound threads", &test_bound_range_threads },
+	{ "Bernstein bound threads", &test_bound_bernstein_threads },
+	{ "floating point filter", &test_float_filter },
+	{ "sample search", &test_sample_search },
+	{ "sample cache", &test_sample_cache },
+	{ "sample point", &test_sample_keep },
+	{ "gbr lll", &test_gbr_lll },
+	{ "fast equality", &test_equal_fast },
+	{ "plain equality", &test_plain_equal },
+	{ "batch redundancy detection", &test_batch_redundant },
+	{ "dual simplex", &test_tab_dual_simplex },
+	{ "pivot rules", &test_tab_pivot },
 	{ "min", &test_min },
+	{ "min over disjuncts", &test_min_disjuncts },
 	{ "gist", &test_gist },
 	{ "piecewise quasi-polynomials", &test_pwqp },
 };
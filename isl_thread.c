@@ -0,0 +1,489 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <isl_config.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include <isl_ctx_private.h>
+#include <isl_options_private.h>
+#include <isl_profile.h>
+#include <isl_thread.h>
+
+/* Data shared by the workers of a single call to isl_thread_run.
+ * "ctx" is the isl_ctx on whose behalf the workers perform
+ * the computation.  "fn" is called on each of the "n" items.
+ * "next" is the index of the next item that has not been claimed
+ * by any worker yet.
+ * "failed" is set as soon as "fn" fails on some item,
+ * after which no further items are claimed, and
+ * "error" is the error of the worker isl_ctx at that point.
+ * "lock" protects "next", "failed" and "error" as well as
+ * all accesses to objects that live in "ctx".
+ */
+struct isl_thread_pool {
+	isl_ctx *ctx;
+	int n;
+	int (*fn)(struct isl_thread_worker *worker, int i, void *user);
+	void *user;
+	int next;
+	int failed;
+	enum isl_error error;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_t lock;
+#endif
+};
+
+/* A worker of isl_thread_run, with its own isl_ctx.
+ * "id" is the position of the worker in "team" and
+ * "pool" describes the call to isl_thread_run in which
+ * the worker currently takes part.
+ */
+struct isl_thread_worker {
+	struct isl_thread_team *team;
+	int id;
+	isl_ctx *ctx;
+	struct isl_thread_pool *pool;
+};
+
+/* The workers and threads that perform the computations
+ * of isl_thread_run on behalf of an isl_ctx.
+ * They are created when they are first needed and
+ * kept until the isl_ctx is freed.
+ *
+ * "worker" holds the "n_worker" workers created so far.
+ *
+ * The remaining fields are only used if isl has been built
+ * with thread support.
+ * "trace_lock" serializes the trace events of the workers.
+ * The default executor (see team_execute) runs the tasks
+ * on the "n_thread" threads in "thread" and the calling thread.
+ * "lock" protects the fields below it.
+ * "task" is called with argument "data" on each of the "n_task" tasks,
+ * "next" is the index of the next task that has not been started yet and
+ * "n_left" is the number of tasks that have not finished yet.
+ * "start" is signaled when new tasks are available or
+ * when "shutdown" is set and "done" is signaled when "n_left"
+ * drops to zero.
+ */
+struct isl_thread_team {
+	int n_worker;
+	struct isl_thread_worker *worker;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_t trace_lock;
+
+	int n_thread;
+	pthread_t *thread;
+
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	int shutdown;
+	void (*task)(int i, void *data);
+	void *data;
+	int n_task;
+	int next;
+	int n_left;
+#endif
+};
+
+/* Return the isl_ctx of "worker".
+ */
+isl_ctx *isl_thread_worker_get_ctx(struct isl_thread_worker *worker)
+{
+	return worker ? worker->ctx : NULL;
+}
+
+/* Acquire the lock that protects the objects that live in the isl_ctx
+ * passed to isl_thread_run.
+ */
+void isl_thread_worker_lock(struct isl_thread_worker *worker)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&worker->pool->lock);
+#endif
+}
+
+/* Release the lock acquired by isl_thread_worker_lock.
+ */
+void isl_thread_worker_unlock(struct isl_thread_worker *worker)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&worker->pool->lock);
+#endif
+}
+
+/* Repeatedly claim an item and call the function on it
+ * in "worker" until all items have been claimed or
+ * the function has failed on some item.
+ * In the latter case, the error of the worker isl_ctx is recorded
+ * such that it can be passed on to the isl_ctx of the caller.
+ */
+static void work(struct isl_thread_worker *worker)
+{
+	struct isl_thread_pool *pool = worker->pool;
+
+	for (;;) {
+		int i = -1;
+
+		isl_thread_worker_lock(worker);
+		if (!pool->failed && pool->next < pool->n)
+			i = pool->next++;
+		isl_thread_worker_unlock(worker);
+		if (i < 0)
+			break;
+
+		if (pool->fn(worker, i, pool->user) < 0) {
+			isl_thread_worker_lock(worker);
+			if (!pool->failed) {
+				pool->failed = 1;
+				pool->error = isl_ctx_last_error(worker->ctx);
+			}
+			isl_thread_worker_unlock(worker);
+			break;
+		}
+	}
+}
+
+#ifdef HAVE_PTHREAD
+
+/* Run the tasks of "team" that have not been started yet.
+ * This function is called with the lock of "team" held,
+ * but the lock is released while a task is running.
+ */
+static void team_run_tasks(struct isl_thread_team *team)
+{
+	while (team->next < team->n_task) {
+		int i = team->next++;
+
+		pthread_mutex_unlock(&team->lock);
+		team->task(i, team->data);
+		pthread_mutex_lock(&team->lock);
+		if (--team->n_left == 0)
+			pthread_cond_broadcast(&team->done);
+	}
+}
+
+/* The main function of a thread of "user", the team of an isl_ctx.
+ * Wait for tasks to become available and run them
+ * until the team is shut down.
+ */
+static void *team_main(void *user)
+{
+	struct isl_thread_team *team = user;
+
+	pthread_mutex_lock(&team->lock);
+	while (!team->shutdown) {
+		if (team->next < team->n_task)
+			team_run_tasks(team);
+		else
+			pthread_cond_wait(&team->start, &team->lock);
+	}
+	pthread_mutex_unlock(&team->lock);
+
+	return NULL;
+}
+
+/* Make sure "team" has at least "n" threads, if possible.
+ * If not all of them can be created, then the tasks
+ * are run by the threads that could be created.
+ */
+static void team_add_threads(struct isl_thread_team *team, int n)
+{
+	pthread_t *thread;
+
+	if (team->n_thread >= n)
+		return;
+	thread = realloc(team->thread, n * sizeof(pthread_t));
+	if (!thread)
+		return;
+	team->thread = thread;
+	for (; team->n_thread < n; ++team->n_thread)
+		if (pthread_create(&team->thread[team->n_thread], NULL,
+				    &team_main, team) != 0)
+			break;
+}
+
+/* The default executor of the isl_ctx with team "user".
+ * Run "task" on the "n" tasks using the threads of the team,
+ * starting any threads that are still missing, and
+ * the calling thread, and wait for all of them to finish.
+ */
+static int team_execute(int n, void (*task)(int i, void *data), void *data,
+	void *user)
+{
+	struct isl_thread_team *team = user;
+
+	team_add_threads(team, n - 1);
+
+	pthread_mutex_lock(&team->lock);
+	team->task = task;
+	team->data = data;
+	team->n_task = n;
+	team->next = 0;
+	team->n_left = n;
+	pthread_cond_broadcast(&team->start);
+	team_run_tasks(team);
+	while (team->n_left > 0)
+		pthread_cond_wait(&team->done, &team->lock);
+	team->n_task = 0;
+	team->next = 0;
+	pthread_mutex_unlock(&team->lock);
+
+	return 0;
+}
+
+#endif
+
+/* Forward the event described by "name", "begin", "timestamp" and "args"
+ * of the worker "user" to the trace callback of the isl_ctx
+ * on whose behalf it performs its computation.
+ */
+static void forward_trace_event(const char *name, int begin,
+	double timestamp, const char *args, void *user)
+{
+	struct isl_thread_worker *worker = user;
+
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&worker->team->trace_lock);
+#endif
+	isl_ctx_trace_event(worker->ctx->parent, 1 + worker->id,
+			    name, begin, timestamp, args);
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&worker->team->trace_lock);
+#endif
+}
+
+/* Return the team of "ctx", allocating it if needed.
+ */
+static struct isl_thread_team *get_team(isl_ctx *ctx)
+{
+	struct isl_thread_team *team;
+
+	if (ctx->thread_team)
+		return ctx->thread_team;
+
+	team = isl_calloc_type(ctx, struct isl_thread_team);
+	if (!team)
+		return NULL;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_init(&team->trace_lock, NULL);
+	pthread_mutex_init(&team->lock, NULL);
+	pthread_cond_init(&team->start, NULL);
+	pthread_cond_init(&team->done, NULL);
+#endif
+	ctx->thread_team = team;
+
+	return team;
+}
+
+/* Make sure "team" of "ctx" has at least "n" workers.
+ */
+static int team_add_workers(isl_ctx *ctx, struct isl_thread_team *team, int n)
+{
+	struct isl_thread_worker *worker;
+
+	if (team->n_worker >= n)
+		return 0;
+	worker = isl_realloc_array(ctx, team->worker,
+				    struct isl_thread_worker, n);
+	if (!worker)
+		return -1;
+	team->worker = worker;
+	for (; team->n_worker < n; ++team->n_worker) {
+		worker = &team->worker[team->n_worker];
+		worker->team = team;
+		worker->id = team->n_worker;
+		worker->pool = NULL;
+		worker->ctx = isl_ctx_alloc_worker(ctx);
+		if (!worker->ctx)
+			return -1;
+	}
+
+	return 0;
+}
+
+/* Free the workers and stop the threads used by isl_thread_run
+ * on behalf of "ctx".
+ * The operations and statistics of the workers have already been
+ * added to those of "ctx" at the end of each call to isl_thread_run.
+ */
+void isl_thread_team_free(isl_ctx *ctx)
+{
+	int i;
+	struct isl_thread_team *team;
+
+	if (!ctx || !ctx->thread_team)
+		return;
+
+	team = ctx->thread_team;
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&team->lock);
+	team->shutdown = 1;
+	pthread_cond_broadcast(&team->start);
+	pthread_mutex_unlock(&team->lock);
+	for (i = 0; i < team->n_thread; ++i)
+		pthread_join(team->thread[i], NULL);
+	free(team->thread);
+	pthread_cond_destroy(&team->done);
+	pthread_cond_destroy(&team->start);
+	pthread_mutex_destroy(&team->lock);
+	pthread_mutex_destroy(&team->trace_lock);
+#endif
+	for (i = 0; i < team->n_worker; ++i)
+		isl_ctx_free(team->worker[i].ctx);
+	free(team->worker);
+	free(team);
+	ctx->thread_team = NULL;
+}
+
+/* Set the executor that isl_thread_run uses for running the workers
+ * of "ctx" in parallel to "execute", with user argument "user".
+ * "execute" is called with the number "n" of tasks and
+ * should call "task" on each task 0 to "n" - 1, with argument "data",
+ * possibly from different threads and in any order.
+ * It should only return once all of the tasks it started have finished.
+ * If it returns a negative value, then any work that has not
+ * been performed by the tasks is performed in the calling thread.
+ * A NULL "execute" selects the default executor, which runs
+ * the tasks on threads that are owned by "ctx" and
+ * that are kept until "ctx" is freed.
+ * The executor is only used if isl has been built with thread support.
+ */
+int isl_ctx_set_thread_executor(isl_ctx *ctx,
+	int (*execute)(int n, void (*task)(int i, void *data), void *data,
+		void *user), void *user)
+{
+	if (!ctx)
+		return -1;
+
+	ctx->thread_execute = execute;
+	ctx->thread_execute_user = user;
+
+	return 0;
+}
+
+/* Prepare the worker "worker" for taking part in the computation
+ * described by "pool".
+ * If the isl_ctx on whose behalf the computation is performed
+ * has a trace callback, then the trace events of the worker
+ * are forwarded to this callback.
+ */
+static int prepare_worker(struct isl_thread_worker *worker,
+	struct isl_thread_pool *pool)
+{
+	worker->pool = pool;
+	if (isl_ctx_prepare_worker(pool->ctx, worker->ctx) < 0)
+		return -1;
+	worker->ctx->trace = pool->ctx->trace ? &forward_trace_event : NULL;
+	worker->ctx->trace_user = worker;
+
+	return 0;
+}
+
+#ifdef HAVE_PTHREAD
+
+/* Run the worker of task "i" of the isl_thread_run call
+ * described by "data" on the items that are still available.
+ */
+static void run_task(int i, void *data)
+{
+	struct isl_thread_pool *pool = data;
+
+	work(&pool->ctx->thread_team->worker[i]);
+}
+
+#endif
+
+/* Run the first "n_worker" workers of "team" on the items of "pool".
+ * If "n_worker" is greater than one, then the workers are run
+ * in parallel through the executor of pool->ctx.
+ * Any items that have not been claimed when the executor returns
+ * (e.g., because it failed or because isl has been built
+ * without thread support) are handled by the first worker
+ * in the calling thread.
+ */
+static void run_workers(struct isl_thread_pool *pool,
+	struct isl_thread_team *team, int n_worker)
+{
+#ifdef HAVE_PTHREAD
+	isl_ctx *ctx = pool->ctx;
+
+	pthread_mutex_init(&pool->lock, NULL);
+	if (n_worker > 1) {
+		if (ctx->thread_execute)
+			ctx->thread_execute(n_worker, &run_task, pool,
+					    ctx->thread_execute_user);
+		else
+			team_execute(n_worker, &run_task, pool, team);
+	}
+#endif
+	work(&team->worker[0]);
+#ifdef HAVE_PTHREAD
+	pthread_mutex_destroy(&pool->lock);
+#endif
+}
+
+/* Call "fn" on each of the items 0 to "n" - 1 on behalf of "ctx"
+ * using (at most) as many workers as allowed by the threads option
+ * of "ctx".
+ * Return 0 if "fn" succeeded on all items and -1 otherwise.
+ *
+ * Each worker has its own worker isl_ctx (see isl_ctx_prepare_worker)
+ * and claims the items in increasing order.
+ * The workers and their isl_ctx objects are kept in "ctx"
+ * for use by later calls.
+ * Since an isl_ctx cannot be used by several threads at the same time,
+ * "fn" may only access objects that live in "ctx" (including
+ * importing objects from or into "ctx") between calls
+ * to isl_thread_worker_lock and isl_thread_worker_unlock.
+ * Any objects that "fn" creates in the worker isl_ctx need to be
+ * freed (or imported into "ctx") before it returns.
+ * After all workers have finished, their operations and statistics
+ * are added to those of "ctx".
+ * If "fn" fails on some item, then no further items are claimed and
+ * the error of the worker isl_ctx is passed on to "ctx".
+ */
+int isl_thread_run(isl_ctx *ctx, int n,
+	int (*fn)(struct isl_thread_worker *worker, int i, void *user),
+	void *user)
+{
+	int i;
+	int n_worker;
+	struct isl_thread_pool pool = { ctx, n, fn, user };
+	struct isl_thread_team *team;
+
+	if (!ctx)
+		return -1;
+	if (n < 1)
+		return 0;
+	n_worker = ctx->opt->threads;
+	if (n_worker > n)
+		n_worker = n;
+	if (n_worker < 1)
+		n_worker = 1;
+	team = get_team(ctx);
+	if (!team || team_add_workers(ctx, team, n_worker) < 0)
+		return -1;
+	for (i = 0; i < n_worker; ++i)
+		if (prepare_worker(&team->worker[i], &pool) < 0) {
+			pool.failed = 1;
+			pool.error = isl_error_alloc;
+		}
+
+	if (!pool.failed)
+		run_workers(&pool, team, n_worker);
+
+	for (i = 0; i < n_worker; ++i) {
+		isl_ctx_collect_worker(ctx, team->worker[i].ctx);
+		team->worker[i].pool = NULL;
+	}
+
+	if (!pool.failed)
+		return 0;
+	if (pool.error == isl_error_none)
+		pool.error = isl_error_unknown;
+	isl_ctx_set_error(ctx, pool.error);
+	return -1;
+}
@@ -0,0 +1,28 @@
+#ifndef ISL_THREAD_H
+#define ISL_THREAD_H
+
+#include <isl/ctx.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* A worker of isl_thread_run, with its own isl_ctx.
+ */
+struct isl_thread_worker;
+
+isl_ctx *isl_thread_worker_get_ctx(struct isl_thread_worker *worker);
+void isl_thread_worker_lock(struct isl_thread_worker *worker);
+void isl_thread_worker_unlock(struct isl_thread_worker *worker);
+
+int isl_thread_run(isl_ctx *ctx, int n,
+	int (*fn)(struct isl_thread_worker *worker, int i, void *user),
+	void *user);
+
+void isl_thread_team_free(isl_ctx *ctx);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
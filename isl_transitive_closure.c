@@ -8,6 +8,7 @@
  * 91893 Orsay, France 
  */
 
+#include <isl_config.h>
 #include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include <isl/map.h>
@@ -19,6 +20,9 @@
 #include <isl_vec_private.h>
 #include <isl_options_private.h>
 #include <isl_tarjan.h>
+#include <isl_transitive_closure_private.h>
+#include <isl_profile.h>
+#include <isl_thread.h>
 
 int isl_map_is_transitively_closed(__isl_keep isl_map *map)
 {
@@ -297,7 +301,6 @@ static int parametric_constant_never_positive(__isl_keep isl_basic_set *bset,
 	nparam = isl_basic_set_dim(bset, isl_dim_param);
 
 	bset = isl_basic_set_copy(bset);
-	bset = isl_basic_set_cow(bset);
 	bset = isl_basic_set_extend_constraints(bset, 0, 1);
 	k = isl_basic_set_alloc_inequality(bset);
 	if (k < 0)
@@ -1120,8 +1123,8 @@ static __isl_give isl_map *compose(__isl_keep isl_map *map, int i,
 	return comp;
 }
 
-/* Compute the transitive closure of "map" incrementally by
- * computing
+/* Given the transitive closure "tc" of map_i and the transitive closure
+ * "qc" of the remaining (composed) basic maps, return
  *
  *	map_i^+ \cup qc^+
  *
@@ -1133,6 +1136,26 @@ static __isl_give isl_map *compose(__isl_keep isl_map *map, int i,
  *
  *	map_i^+ \cup (qc^+ \circ (id \cup map_i^))
  *
+ * depending on whether "left" or "right" are set.
+ */
+static __isl_give isl_map *combine_incremental(__isl_take isl_map *tc,
+	__isl_take isl_map *qc, int left, int right)
+{
+	isl_map *rtc = NULL;
+
+	if (!left || !right)
+		rtc = isl_map_union(isl_map_copy(tc),
+				    isl_map_identity(isl_map_get_space(tc)));
+	if (!right)
+		qc = isl_map_apply_range(rtc, qc);
+	if (!left)
+		qc = isl_map_apply_range(qc, rtc);
+	return isl_map_union(tc, qc);
+}
+
+/* Compute the transitive closure of "map" incrementally by
+ * computing the transitive closure of map_i and that of "qc" and
+ * combining them in combine_incremental,
  * depending on whether left or right are NULL.
  */
 static __isl_give isl_map *compute_incremental(
@@ -1141,7 +1164,6 @@ static __isl_give isl_map *compute_incremental(
 {
 	isl_map *map_i;
 	isl_map *tc;
-	isl_map *rtc = NULL;
 
 	if (!map)
 		goto error;
@@ -1162,14 +1184,7 @@ static __isl_give isl_map *compute_incremental(
 		return isl_map_universe(isl_map_get_space(map));
 	}
 
-	if (!left || !right)
-		rtc = isl_map_union(isl_map_copy(tc),
-				    isl_map_identity(isl_map_get_space(tc)));
-	if (!right)
-		qc = isl_map_apply_range(rtc, qc);
-	if (!left)
-		qc = isl_map_apply_range(qc, rtc);
-	qc = isl_map_union(tc, qc);
+	qc = combine_incremental(tc, qc, left != NULL, right != NULL);
 
 	isl_space_free(dim);
 
@@ -1494,6 +1509,141 @@ static int add_length(__isl_keep isl_map *map, isl_map ***grid, int n)
 	return 0;
 }
 
+/* Update column "q" of the n x n matrix of relations "grid"
+ * in the step of the Floyd-Warshall algorithm for vertex "r"
+ * (see floyd_warshall_iterate).
+ * Only grid[r][r], the column of "r" and the column of "q" are accessed
+ * and only the column of "q" is modified.
+ */
+static void floyd_warshall_update_column(isl_map ***grid, int n,
+	int r, int q)
+{
+	int p;
+	isl_map *rq;
+
+	if (isl_map_plain_is_empty(grid[r][q]) == 1)
+		return;
+	rq = isl_map_apply_range(isl_map_copy(grid[r][r]),
+				isl_map_copy(grid[r][q]));
+	rq = isl_map_union(isl_map_copy(grid[r][q]), rq);
+	rq = isl_map_coalesce(rq);
+	for (p = 0; p < n; ++p) {
+		isl_map *loop;
+		if (p == r)
+			continue;
+		if (isl_map_plain_is_empty(grid[p][r]) == 1)
+			continue;
+		loop = isl_map_apply_range(isl_map_copy(grid[p][r]),
+					isl_map_copy(rq));
+		grid[p][q] = isl_map_union(grid[p][q], loop);
+		grid[p][q] = isl_map_coalesce(grid[p][q]);
+	}
+	isl_map_free(grid[r][q]);
+	grid[r][q] = rq;
+}
+
+#ifdef HAVE_PTHREAD
+
+/* Data used by floyd_warshall_update_threads and its workers.
+ * "grid" is the n x n matrix of relations, which live in "ctx",
+ * and "r" is the current vertex.
+ */
+struct isl_floyd_warshall_threads {
+	isl_ctx *ctx;
+	isl_map ***grid;
+	int n;
+	int r;
+};
+
+/* Update column "q" of data->grid, with "q" the "i"-th vertex
+ * different from data->r, in the isl_ctx of "worker".
+ * In particular, import the columns of data->r and "q"
+ * into a matrix of relations in this isl_ctx that has the same size
+ * as data->grid, perform the update on this matrix and
+ * import the updated column back.
+ */
+static int floyd_warshall_update_work(struct isl_thread_worker *worker,
+	int i, void *user)
+{
+	struct isl_floyd_warshall_threads *data = user;
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	isl_map ***grid = data->grid;
+	isl_map ***copy;
+	int n = data->n;
+	int r = data->r;
+	int q = i < r ? i : i + 1;
+	int p, empty;
+	int res = -1;
+
+	isl_thread_worker_lock(worker);
+	empty = isl_map_plain_is_empty(grid[r][q]);
+	isl_thread_worker_unlock(worker);
+	if (empty < 0)
+		return -1;
+	if (empty)
+		return 0;
+
+	copy = isl_calloc_array(ctx, isl_map **, n);
+	if (!copy)
+		return -1;
+	for (p = 0; p < n; ++p) {
+		copy[p] = isl_calloc_array(ctx, isl_map *, n);
+		if (!copy[p])
+			goto error;
+	}
+
+	isl_thread_worker_lock(worker);
+	for (p = 0; p < n; ++p) {
+		copy[p][r] = isl_map_import(ctx, grid[p][r]);
+		copy[p][q] = isl_map_import(ctx, grid[p][q]);
+	}
+	isl_thread_worker_unlock(worker);
+
+	floyd_warshall_update_column(copy, n, r, q);
+
+	res = 0;
+	isl_thread_worker_lock(worker);
+	for (p = 0; p < n; ++p) {
+		isl_map_free(grid[p][q]);
+		grid[p][q] = isl_map_import(data->ctx, copy[p][q]);
+		if (!grid[p][q])
+			res = -1;
+	}
+	isl_thread_worker_unlock(worker);
+
+error:
+	for (p = 0; p < n; ++p) {
+		if (!copy[p])
+			continue;
+		isl_map_free(copy[p][r]);
+		isl_map_free(copy[p][q]);
+		free(copy[p]);
+	}
+	free(copy);
+	return res;
+}
+
+/* Update all columns of the n x n matrix of relations "grid"
+ * other than that of "r" in the step of the Floyd-Warshall algorithm
+ * for vertex "r" using several threads.
+ *
+ * Each thread has its own isl_ctx, with the same options as
+ * the isl_ctx of "grid", into which it imports the columns
+ * that it needs (see isl_thread_run).
+ * Since the columns are independent of each other,
+ * the result does not depend on which thread updated which column.
+ */
+static int floyd_warshall_update_threads(isl_map ***grid, int n, int r)
+{
+	struct isl_floyd_warshall_threads data = { NULL, grid, n, r };
+
+	data.ctx = isl_map_get_ctx(grid[r][r]);
+	return isl_thread_run(data.ctx, n - 1,
+				&floyd_warshall_update_work, &data);
+}
+
+#endif
+
 /* The core of the Floyd-Warshall algorithm.
  * Updates the given n x x matrix of relations in place.
  *
@@ -1504,10 +1654,33 @@ static int add_length(__isl_keep isl_map *map, isl_map ***grid, int n)
  * element corresponding to the current vertex is replaced by its
  * transitive closure to account for all indirect paths that stay
  * in the current vertex.
+ *
+ * For each target vertex q, the paths that start in the current vertex r,
+ * possibly stay there a while and then move to q are computed only once
+ * and then combined with the paths from each vertex p to r.
+ * That is, with R the transitive closure of the diagonal element,
+ * the paths (grid[r][q] + R . grid[r][q]) are computed first and
+ * are then prepended by grid[p][r] for each p different from r.
+ * The column of the current vertex is only updated after all other
+ * columns such that the paths from p to r that are used in
+ * the other columns do not yet include R.
+ * Since the graph formed by the groups is typically sparse,
+ * any update involving paths that are known to be empty is skipped.
+ *
+ * The columns other than that of the current vertex are independent
+ * of each other.  If the threads option is set to a value
+ * greater than one and isl has been built with thread support,
+ * then they are updated by several threads in parallel.
  */
 static void floyd_warshall_iterate(isl_map ***grid, int n, int *exact)
 {
 	int r, p, q;
+	int n_thread = 1;
+
+#ifdef HAVE_PTHREAD
+	if (n > 2 && grid[0][0])
+		n_thread = grid[0][0]->ctx->opt->threads;
+#endif
 
 	for (r = 0; r < n; ++r) {
 		int r_exact;
@@ -1516,23 +1689,27 @@ static void floyd_warshall_iterate(isl_map ***grid, int n, int *exact)
 		if (exact && *exact && !r_exact)
 			*exact = 0;
 
-		for (p = 0; p < n; ++p)
-			for (q = 0; q < n; ++q) {
-				isl_map *loop;
-				if (p == r && q == r)
-					continue;
-				loop = isl_map_apply_range(
-						isl_map_copy(grid[p][r]),
-						isl_map_copy(grid[r][q]));
-				grid[p][q] = isl_map_union(grid[p][q], loop);
-				loop = isl_map_apply_range(
-						isl_map_copy(grid[p][r]),
-					isl_map_apply_range(
-						isl_map_copy(grid[r][r]),
-						isl_map_copy(grid[r][q])));
-				grid[p][q] = isl_map_union(grid[p][q], loop);
-				grid[p][q] = isl_map_coalesce(grid[p][q]);
-			}
+#ifdef HAVE_PTHREAD
+		if (n_thread > 1) {
+			if (floyd_warshall_update_threads(grid, n, r) < 0)
+				grid[r][r] = isl_map_free(grid[r][r]);
+		} else
+#endif
+		for (q = 0; q < n; ++q)
+			if (q != r)
+				floyd_warshall_update_column(grid, n, r, q);
+
+		for (p = 0; p < n; ++p) {
+			isl_map *loop;
+			if (p == r)
+				continue;
+			if (isl_map_plain_is_empty(grid[p][r]) == 1)
+				continue;
+			loop = isl_map_apply_range(isl_map_copy(grid[p][r]),
+						isl_map_copy(grid[r][r]));
+			grid[p][r] = isl_map_union(grid[p][r], loop);
+			grid[p][r] = isl_map_coalesce(grid[p][r]);
+		}
 	}
 }
 
@@ -2000,6 +2177,213 @@ error:
 	return NULL;
 }
 
+/* A cached result "result" of isl_map_power (if "power" is set) or
+ * isl_map_transitive_closure (if "power" is not set) applied to "map".
+ * "closure" is the value of the closure option at the time
+ * of the computation and "want_exact" records whether the exactness
+ * of the result was requested.  If so, "exact" is the exactness
+ * of the result.
+ */
+struct isl_closure_cache_entry {
+	uint32_t	hash;
+	int		power;
+	int		closure;
+	int		want_exact;
+	isl_map		*map;
+	isl_map		*result;
+	int		exact;
+
+	struct isl_closure_cache_entry	*prev;
+	struct isl_closure_cache_entry	*next;
+};
+
+static void closure_cache_entry_free(struct isl_closure_cache_entry *entry)
+{
+	if (!entry)
+		return;
+	isl_map_free(entry->map);
+	isl_map_free(entry->result);
+	free(entry);
+}
+
+/* Remove "entry" from the list of cache entries of "ctx".
+ */
+static void closure_cache_unlink(isl_ctx *ctx,
+	struct isl_closure_cache_entry *entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		ctx->closure_cache_first = entry->next;
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		ctx->closure_cache_last = entry->prev;
+	entry->prev = entry->next = NULL;
+}
+
+/* Add "entry" to the front of the list of cache entries of "ctx".
+ */
+static void closure_cache_push_front(isl_ctx *ctx,
+	struct isl_closure_cache_entry *entry)
+{
+	entry->prev = NULL;
+	entry->next = ctx->closure_cache_first;
+	if (ctx->closure_cache_first)
+		ctx->closure_cache_first->prev = entry;
+	else
+		ctx->closure_cache_last = entry;
+	ctx->closure_cache_first = entry;
+}
+
+/* Remove all entries from the closure cache of "ctx".
+ */
+void isl_closure_cache_clear(isl_ctx *ctx)
+{
+	struct isl_closure_cache_entry *entry, *next;
+
+	for (entry = ctx->closure_cache_first; entry; entry = next) {
+		next = entry->next;
+		closure_cache_entry_free(entry);
+	}
+	ctx->closure_cache_first = ctx->closure_cache_last = NULL;
+	ctx->n_closure_cache = 0;
+	isl_hash_table_clear(&ctx->closure_cache);
+	isl_hash_table_init(ctx, &ctx->closure_cache, 0);
+}
+
+/* Is "entry" a cached result for the computation described by "val",
+ * a partially filled in isl_closure_cache_entry?
+ */
+static int closure_cache_has_key(const void *entry, const void *val)
+{
+	const struct isl_closure_cache_entry *e = entry;
+	const struct isl_closure_cache_entry *q = val;
+
+	if (e->power != q->power || e->closure != q->closure ||
+	    e->want_exact != q->want_exact)
+		return 0;
+	return isl_map_plain_is_equal(e->map, q->map) == 1;
+}
+
+static int closure_cache_is_entry(const void *entry, const void *val)
+{
+	return entry == val;
+}
+
+/* Remove the least recently used entry from the closure cache of "ctx".
+ */
+static void closure_cache_evict(isl_ctx *ctx)
+{
+	struct isl_closure_cache_entry *entry = ctx->closure_cache_last;
+	struct isl_hash_table_entry *he;
+
+	he = isl_hash_table_find(ctx, &ctx->closure_cache, entry->hash,
+				&closure_cache_is_entry, entry, 0);
+	if (he)
+		isl_hash_table_remove(ctx, &ctx->closure_cache, he);
+	closure_cache_unlink(ctx, entry);
+	closure_cache_entry_free(entry);
+	ctx->n_closure_cache--;
+}
+
+/* Add "entry" to the closure cache of "ctx", evicting the least recently
+ * used entries if the cache would otherwise exceed the size specified
+ * by the closure_cache_size option.
+ * The same computation may have been cached in the mean time by
+ * a nested call, in which case "entry" is simply dropped.
+ */
+static int closure_cache_add(isl_ctx *ctx,
+	struct isl_closure_cache_entry *entry)
+{
+	struct isl_hash_table_entry *he;
+
+	while (ctx->n_closure_cache > 0 &&
+	       ctx->n_closure_cache >= ctx->opt->closure_cache_size)
+		closure_cache_evict(ctx);
+
+	he = isl_hash_table_find(ctx, &ctx->closure_cache, entry->hash,
+				&closure_cache_has_key, entry, 1);
+	if (!he) {
+		closure_cache_entry_free(entry);
+		return -1;
+	}
+	if (he->data) {
+		closure_cache_entry_free(entry);
+		return 0;
+	}
+	he->data = entry;
+	closure_cache_push_front(ctx, entry);
+	ctx->n_closure_cache++;
+
+	return 0;
+}
+
+/* Apply "fn", which computes either the powers (if "power" is set)
+ * or the transitive closure of its argument, to "map",
+ * reusing the result of an earlier computation on an equal map
+ * with the same settings if it is available in the closure cache.
+ * The cache is keyed on a hash of the normalized "map" and its space.
+ */
+static __isl_give isl_map *cached_closure(__isl_take isl_map *map,
+	int *exact, int power,
+	__isl_give isl_map *(*fn)(__isl_take isl_map *map, int *exact))
+{
+	isl_ctx *ctx;
+	isl_map *res;
+	struct isl_closure_cache_entry q;
+	struct isl_closure_cache_entry *entry;
+	struct isl_hash_table_entry *he;
+
+	if (!map)
+		return NULL;
+	ctx = isl_map_get_ctx(map);
+	if (ctx->opt->closure_cache_size <= 0)
+		return fn(map, exact);
+
+	q.power = power;
+	q.closure = ctx->opt->closure;
+	q.want_exact = exact != NULL;
+	q.map = map;
+	q.hash = isl_hash_init();
+	isl_hash_hash(q.hash, isl_space_get_hash(map->dim));
+	isl_hash_hash(q.hash, isl_map_get_hash(map));
+	isl_hash_byte(q.hash, q.power);
+	isl_hash_byte(q.hash, q.closure);
+	isl_hash_byte(q.hash, q.want_exact);
+
+	he = isl_hash_table_find(ctx, &ctx->closure_cache, q.hash,
+				&closure_cache_has_key, &q, 0);
+	if (he) {
+		ctx->stats->closure_cache_hits++;
+		entry = he->data;
+		closure_cache_unlink(ctx, entry);
+		closure_cache_push_front(ctx, entry);
+		if (exact)
+			*exact = entry->exact;
+		isl_map_free(map);
+		return isl_map_copy(entry->result);
+	}
+	ctx->stats->closure_cache_misses++;
+
+	entry = isl_calloc_type(ctx, struct isl_closure_cache_entry);
+	if (!entry)
+		return isl_map_free(map);
+	*entry = q;
+	entry->map = isl_map_copy(map);
+	res = fn(map, exact);
+	if (!res) {
+		closure_cache_entry_free(entry);
+		return NULL;
+	}
+	entry->exact = exact ? *exact : 0;
+	entry->result = isl_map_copy(res);
+	if (closure_cache_add(ctx, entry) < 0)
+		return isl_map_free(res);
+
+	return res;
+}
+
 /* Compute the positive powers of "map", or an overapproximation.
  * The result maps the exponent to a nested copy of the corresponding power.
  * If the result is exact, then *exact is set to 1.
@@ -2009,7 +2393,7 @@ error:
  * and made positive.  The extra coordinates are subsequently projected out
  * and the parameter is turned into the domain of the result.
  */
-__isl_give isl_map *isl_map_power(__isl_take isl_map *map, int *exact)
+static __isl_give isl_map *compute_power(__isl_take isl_map *map, int *exact)
 {
 	isl_space *target_dim;
 	isl_space *dim;
@@ -2054,6 +2438,14 @@ __isl_give isl_map *isl_map_power(__isl_take isl_map *map, int *exact)
 	return map;
 }
 
+/* Compute the positive powers of "map", or an overapproximation,
+ * possibly reusing an earlier result from the closure cache.
+ */
+__isl_give isl_map *isl_map_power(__isl_take isl_map *map, int *exact)
+{
+	return cached_closure(map, exact, 1, &compute_power);
+}
+
 /* Compute a relation that maps each element in the range of the input
  * relation to the lengths of all paths composed of edges in the input
  * relation that end up in the given range element.
@@ -2559,21 +2951,140 @@ error:
 	return NULL;
 }
 
+/* Is "bmap" a uniform relation, i.e., does it map every element x
+ * of its domain to x + d, with d a constant vector?
+ * If so, then the constant vector d is stored in *delta.
+ * Only relations without existentially quantified variables
+ * are considered, such that the domain is the set of integer points
+ * in a polyhedron.
+ */
+static int is_uniform(__isl_keep isl_basic_map *bmap, isl_vec **delta)
+{
+	int i;
+	unsigned d;
+	isl_basic_set *deltas;
+	isl_vec *v;
+	int fixed = 1;
+
+	*delta = NULL;
+	if (!bmap)
+		return -1;
+	if (bmap->n_div != 0 ||
+	    ISL_F_ISSET(bmap, ISL_BASIC_MAP_RATIONAL))
+		return 0;
+
+	d = isl_basic_map_dim(bmap, isl_dim_in);
+	if (d != isl_basic_map_dim(bmap, isl_dim_out))
+		return 0;
+	v = isl_vec_alloc(bmap->ctx, d);
+	if (!v)
+		return -1;
+	deltas = isl_basic_map_deltas(isl_basic_map_copy(bmap));
+	for (i = 0; fixed == 1 && i < d; ++i)
+		fixed = isl_basic_set_plain_dim_is_fixed(deltas, i, &v->el[i]);
+	isl_basic_set_free(deltas);
+
+	if (fixed == 1)
+		*delta = v;
+	else
+		isl_vec_free(v);
+
+	return fixed;
+}
+
+/* Construct the transitive closure of the uniform relation "bmap",
+ * mapping every element x of its domain D to x + d,
+ * with d equal to "delta".
+ * The transitive closure is
+ *
+ *	{ x -> y : exists k >= 1 : y = x + k d and x in D and y in D + d }
+ *
+ * Since D is the set of integer points in a polyhedron and since
+ * x + i d is an integer point on the segment between x and x + (k - 1) d
+ * for every 0 <= i <= k - 1, all intermediate steps then also
+ * start in D.  Note that D + d is the range of "bmap".
+ * The result is therefore exact.
+ */
+static __isl_give isl_map *uniform_closure(__isl_keep isl_basic_map *bmap,
+	__isl_keep isl_vec *delta)
+{
+	int i, k;
+	unsigned d, nparam, total;
+	isl_basic_map *path;
+
+	d = isl_basic_map_dim(bmap, isl_dim_in);
+	nparam = isl_basic_map_dim(bmap, isl_dim_param);
+	path = isl_basic_map_alloc_space(isl_basic_map_get_space(bmap),
+					1, d, 1);
+	k = isl_basic_map_alloc_div(path);
+	if (k < 0)
+		goto error;
+	isl_int_set_si(path->div[k][0], 0);
+	total = isl_basic_map_total_dim(path);
+
+	for (i = 0; i < d; ++i) {
+		k = isl_basic_map_alloc_equality(path);
+		if (k < 0)
+			goto error;
+		isl_seq_clr(path->eq[k], 1 + total);
+		isl_int_set_si(path->eq[k][1 + nparam + i], 1);
+		isl_int_set_si(path->eq[k][1 + nparam + d + i], -1);
+		isl_int_set(path->eq[k][1 + nparam + 2 * d], delta->el[i]);
+	}
+
+	k = isl_basic_map_alloc_inequality(path);
+	if (k < 0)
+		goto error;
+	isl_seq_clr(path->ineq[k], 1 + total);
+	isl_int_set_si(path->ineq[k][0], -1);
+	isl_int_set_si(path->ineq[k][1 + nparam + 2 * d], 1);
+
+	path = isl_basic_map_simplify(path);
+	path = isl_basic_map_finalize(path);
+	path = isl_basic_map_intersect_domain(path,
+				isl_basic_map_domain(isl_basic_map_copy(bmap)));
+	path = isl_basic_map_intersect_range(path,
+				isl_basic_map_range(isl_basic_map_copy(bmap)));
+
+	return isl_map_from_basic_map(path);
+error:
+	isl_basic_map_free(path);
+	return NULL;
+}
+
 /* Compute the transitive closure  of "map", or an overapproximation.
  * If the result is exact, then *exact is set to 1.
- * Simply use map_power to compute the powers of map, but tell
+ * If "map" consists of a single uniform relation, then its transitive
+ * closure is constructed directly by uniform_closure and is exact.
+ * Otherwise, simply use map_power to compute the powers of map, but tell
  * it to project out the lengths of the paths instead of equating
  * the length to a parameter.
  */
-__isl_give isl_map *isl_map_transitive_closure(__isl_take isl_map *map,
+static __isl_give isl_map *compute_transitive_closure(__isl_take isl_map *map,
 	int *exact)
 {
 	isl_space *target_dim;
+	isl_vec *delta;
 	int closed;
+	int uniform;
 
 	if (!map)
 		goto error;
 
+	uniform = map->n == 1 ? is_uniform(map->p[0], &delta) : 0;
+	if (uniform < 0)
+		goto error;
+	if (uniform) {
+		isl_map *res;
+
+		res = uniform_closure(map->p[0], delta);
+		isl_vec_free(delta);
+		isl_map_free(map);
+		if (exact)
+			*exact = 1;
+		return res;
+	}
+
 	if (map->ctx->opt->closure == ISL_CLOSURE_BOX)
 		return transitive_closure_omega(map, exact);
 
@@ -2598,13 +3109,100 @@ error:
 	return NULL;
 }
 
-static int inc_count(__isl_take isl_map *map, void *user)
+/* Compute the transitive closure of "map", or an overapproximation,
+ * possibly reusing an earlier result from the closure cache.
+ */
+__isl_give isl_map *isl_map_transitive_closure(__isl_take isl_map *map,
+	int *exact)
 {
-	int *n = user;
+	isl_ctx *ctx = isl_map_get_ctx(map);
+	struct isl_profile_node *prof;
 
-	*n += map->n;
+	prof = isl_profile_enter(ctx, "isl_map_transitive_closure");
+	map = cached_closure(map, exact, 0, &compute_transitive_closure);
+	isl_profile_leave(ctx, prof);
+
+	return map;
+}
+
+/* Given the transitive closure "closure" of some relation R,
+ * with "closure_exact" set if "closure" is known to be exact,
+ * compute the transitive closure of the union of R and "map".
+ *
+ * Any path in R \cup map either consists only of edges in R or
+ * can be decomposed into a (possibly empty) path in R,
+ * followed by one or more sequences consisting of an edge in "map"
+ * followed by a (possibly empty) path in R.  That is,
+ *
+ *	(R \cup map)^+ = R^+ \cup ((id \cup R^+) \circ Q^+)
+ *
+ * with
+ *
+ *	Q = (id \cup R^+) \circ map
+ *
+ * The result is combined in the same way as in compute_incremental,
+ * with R^+ taking on the role of map_i^+.
+ * The result is exact if both "closure" and Q^+ are exact.
+ */
+__isl_give isl_map *isl_map_transitive_closure_extend(
+	__isl_take isl_map *closure, int closure_exact,
+	__isl_take isl_map *map, int *exact)
+{
+	isl_ctx *ctx;
+	isl_map *rtc, *qc;
+	int exact_q = 1;
+	int empty, equal;
+
+	if (!closure || !map)
+		goto error;
+	ctx = isl_map_get_ctx(closure);
+	closure = isl_map_align_params(closure, isl_map_get_space(map));
+	map = isl_map_align_params(map, isl_map_get_space(closure));
+	if (!closure || !map)
+		goto error;
+	equal = isl_space_is_equal(closure->dim, map->dim);
+	if (equal < 0)
+		goto error;
+	if (!equal)
+		isl_die(ctx, isl_error_invalid,
+			"closure and relation should live in the same space",
+			goto error);
+	if (!isl_space_tuple_is_equal(map->dim, isl_dim_in,
+					map->dim, isl_dim_out))
+		isl_die(ctx, isl_error_invalid,
+			"domain and range don't match", goto error);
+
+	empty = isl_map_plain_is_empty(map);
+	if (empty < 0)
+		goto error;
+	if (empty) {
+		isl_map_free(map);
+		if (exact)
+			*exact = closure_exact;
+		return closure;
+	}
 
+	rtc = isl_map_union(isl_map_copy(closure),
+			    isl_map_identity(isl_map_get_space(closure)));
+	qc = isl_map_apply_range(map, rtc);
+	qc = isl_map_transitive_closure(qc, &exact_q);
+	closure = combine_incremental(closure, qc, 1, 0);
+	closure = isl_map_coalesce(closure);
+
+	if (exact)
+		*exact = closure_exact && exact_q;
+	return closure;
+error:
+	isl_map_free(closure);
 	isl_map_free(map);
+	return NULL;
+}
+
+static int inc_count(__isl_keep isl_map *map, void *user)
+{
+	int *n = user;
+
+	*n += map->n;
 
 	return 0;
 }
@@ -2726,7 +3324,7 @@ static __isl_give isl_union_map *union_floyd_warshall(
 	isl_union_map *res;
 
 	n = 0;
-	if (isl_union_map_foreach_map(umap, inc_count, &n) < 0)
+	if (isl_union_map_foreach_map_peek(umap, inc_count, &n) < 0)
 		goto error;
 
 	ctx = isl_union_map_get_ctx(umap);
@@ -2778,7 +3376,7 @@ static __isl_give isl_union_map *union_components(
 	int recheck = 0;
 
 	n = 0;
-	if (isl_union_map_foreach_map(umap, inc_count, &n) < 0)
+	if (isl_union_map_foreach_map_peek(umap, inc_count, &n) < 0)
 		goto error;
 
 	if (n == 0)
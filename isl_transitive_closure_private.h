@@ -0,0 +1,8 @@
+#ifndef ISL_TRANSITIVE_CLOSURE_PRIVATE_H
+#define ISL_TRANSITIVE_CLOSURE_PRIVATE_H
+
+#include <isl/ctx.h>
+
+void isl_closure_cache_clear(isl_ctx *ctx);
+
+#endif
@@ -10,7 +10,10 @@
  */
 
 #define ISL_DIM_H
+#include <isl_config.h>
+#include <isl_ctx_private.h>
 #include <isl_map_private.h>
+#include <isl_options_private.h>
 #include <isl/ctx.h>
 #include <isl/hash.h>
 #include <isl/aff.h>
@@ -18,6 +21,7 @@
 #include <isl/set.h>
 #include <isl_space_private.h>
 #include <isl_union_map_private.h>
+#include <isl_thread.h>
 #include <isl/union_set.h>
 #include <isl/deprecated/union_map_int.h>
 
@@ -52,6 +56,8 @@ __isl_give isl_id *isl_union_map_get_dim_id(__isl_keep isl_union_map *umap,
 	return isl_space_get_dim_id(umap->dim, type, pos);
 }
 
+static int remove_empty_inplace(__isl_keep isl_union_map *umap);
+
 /* Is this union set a parameter domain?
  */
 int isl_union_set_is_params(__isl_keep isl_union_set *uset)
@@ -59,7 +65,7 @@ int isl_union_set_is_params(__isl_keep isl_union_set *uset)
 	isl_set *set;
 	int params;
 
-	if (!uset)
+	if (remove_empty_inplace(uset) < 0)
 		return -1;
 	if (uset->table.n != 1)
 		return 0;
@@ -148,7 +154,7 @@ __isl_give isl_union_map *isl_union_map_dup(__isl_keep isl_union_map *umap)
 	if (!umap)
 		return NULL;
 
-	dup = isl_union_map_empty(isl_space_copy(umap->dim));
+	dup = isl_union_map_alloc(isl_space_copy(umap->dim), umap->table.n);
 	if (isl_union_map_foreach_map(umap, &add_map, &dup) < 0)
 		goto error;
 	return dup;
@@ -162,12 +168,34 @@ __isl_give isl_union_map *isl_union_map_cow(__isl_take isl_union_map *umap)
 	if (!umap)
 		return NULL;
 
-	if (umap->ref == 1)
+	if (umap->ref == 1) {
+		umap->non_empty = 0;
 		return umap;
+	}
 	umap->ref--;
 	return isl_union_map_dup(umap);
 }
 
+/* Make sure that maps living in "n" extra spaces can be added to "umap"
+ * without having to resize its hash table along the way.
+ */
+__isl_give isl_union_map *isl_union_map_reserve(
+	__isl_take isl_union_map *umap, int n)
+{
+	umap = isl_union_map_cow(umap);
+	if (!umap)
+		return NULL;
+	if (isl_hash_table_reserve(umap->dim->ctx, &umap->table, n) < 0)
+		return isl_union_map_free(umap);
+	return umap;
+}
+
+__isl_give isl_union_set *isl_union_set_reserve(
+	__isl_take isl_union_set *uset, int n)
+{
+	return isl_union_map_reserve(uset, n);
+}
+
 struct isl_union_align {
 	isl_reordering *exp;
 	isl_union_map *res;
@@ -278,6 +306,49 @@ __isl_give isl_union_set *isl_union_set_copy(__isl_keep isl_union_set *uset)
 	return isl_union_map_copy(uset);
 }
 
+/* Add a copy of the map in "entry", allocated in the context
+ * of *user, to *user.
+ */
+static int add_imported_map(void **entry, void *user)
+{
+	isl_map *map = *entry;
+	isl_union_map **res = user;
+	isl_ctx *ctx = isl_union_map_get_ctx(*res);
+
+	*res = isl_union_map_add_map(*res, isl_map_import(ctx, map));
+
+	return *res ? 0 : -1;
+}
+
+/* Return a copy of "umap" that is allocated in "ctx".
+ */
+__isl_give isl_union_map *isl_union_map_import(isl_ctx *ctx,
+	__isl_keep isl_union_map *umap)
+{
+	isl_union_map *res;
+
+	if (!umap)
+		return NULL;
+	if (umap->dim->ctx == ctx)
+		return isl_union_map_copy(umap);
+
+	res = isl_union_map_alloc(isl_space_import(ctx, umap->dim),
+				umap->table.n);
+	if (!res)
+		return NULL;
+	if (isl_hash_table_foreach(umap->dim->ctx, &umap->table,
+				    &add_imported_map, &res) < 0)
+		return isl_union_map_free(res);
+
+	return res;
+}
+
+__isl_give isl_union_set *isl_union_set_import(isl_ctx *ctx,
+	__isl_keep isl_union_set *uset)
+{
+	return isl_union_map_import(ctx, uset);
+}
+
 __isl_null isl_union_map *isl_union_map_free(__isl_take isl_union_map *umap)
 {
 	if (!umap)
@@ -380,6 +451,35 @@ __isl_give isl_union_set *isl_union_set_from_set(__isl_take isl_set *set)
 	return isl_union_map_from_map((isl_map *)set);
 }
 
+/* Construct a union set containing the elements of the sets in "list".
+ * The hash table of the result is allocated to hold all of them
+ * such that it does not need to be resized while the sets are added.
+ * The parameters of the result are the union of those of the sets.
+ */
+__isl_give isl_union_set *isl_union_set_from_set_list(
+	__isl_take isl_set_list *list)
+{
+	int i, n;
+	isl_ctx *ctx;
+	isl_union_set *uset;
+
+	if (!list)
+		return NULL;
+
+	ctx = isl_set_list_get_ctx(list);
+	n = isl_set_list_n_set(list);
+	uset = isl_union_map_alloc(isl_space_params_alloc(ctx, 0), n);
+	for (i = 0; i < n; ++i) {
+		isl_set *set;
+
+		set = isl_set_list_get_set(list, i);
+		uset = isl_union_set_add_set(uset, set);
+	}
+
+	isl_set_list_free(list);
+	return uset;
+}
+
 __isl_give isl_union_map *isl_union_map_from_basic_map(
 	__isl_take isl_basic_map *bmap)
 {
@@ -392,6 +492,61 @@ __isl_give isl_union_set *isl_union_set_from_basic_set(
 	return isl_union_map_from_basic_map(bset);
 }
 
+/* Add the map in "entry" to *res if it is not empty.
+ */
+static int add_non_empty(void **entry, void *user)
+{
+	isl_union_map **res = user;
+	isl_map *map = *entry;
+	int empty;
+
+	empty = isl_map_is_empty(map);
+	if (empty < 0)
+		return -1;
+	if (empty)
+		return 0;
+	*res = isl_union_map_add_map(*res, isl_map_copy(map));
+
+	return 0;
+}
+
+/* If the union_map_lazy_empty option is set, then "umap" may contain
+ * empty maps.  Remove them, unless it is already known that
+ * "umap" does not contain any.
+ * Since removing empty maps does not change the meaning of "umap",
+ * they are removed in place, even if "umap" has other references.
+ * This function is called by all operations that expose
+ * the individual maps of "umap", such that users never see
+ * any of these empty maps.
+ */
+static int remove_empty_inplace(__isl_keep isl_union_map *umap)
+{
+	isl_ctx *ctx;
+	isl_union_map *res;
+	struct isl_hash_table table;
+
+	if (!umap)
+		return -1;
+	ctx = umap->dim->ctx;
+	if (!ctx->opt->union_map_lazy_empty || umap->non_empty)
+		return 0;
+
+	res = isl_union_map_alloc(isl_space_copy(umap->dim), umap->table.n);
+	if (isl_hash_table_foreach(ctx, &umap->table,
+				   &add_non_empty, &res) < 0)
+		res = isl_union_map_free(res);
+	if (!res)
+		return -1;
+
+	table = umap->table;
+	umap->table = res->table;
+	res->table = table;
+	isl_union_map_free(res);
+	umap->non_empty = 1;
+
+	return 0;
+}
+
 struct isl_union_map_foreach_data
 {
 	int (*fn)(__isl_take isl_map *map, void *user);
@@ -409,12 +564,16 @@ static int call_on_copy(void **entry, void *user)
 
 int isl_union_map_n_map(__isl_keep isl_union_map *umap)
 {
-	return umap ? umap->table.n : 0;
+	if (!umap)
+		return 0;
+	if (remove_empty_inplace(umap) < 0)
+		return -1;
+	return umap->table.n;
 }
 
 int isl_union_set_n_set(__isl_keep isl_union_set *uset)
 {
-	return uset ? uset->table.n : 0;
+	return isl_union_map_n_map(uset);
 }
 
 int isl_union_map_foreach_map(__isl_keep isl_union_map *umap,
@@ -422,13 +581,54 @@ int isl_union_map_foreach_map(__isl_keep isl_union_map *umap,
 {
 	struct isl_union_map_foreach_data data = { fn, user };
 
-	if (!umap)
+	if (remove_empty_inplace(umap) < 0)
 		return -1;
 
 	return isl_hash_table_foreach(umap->dim->ctx, &umap->table,
 				      &call_on_copy, &data);
 }
 
+/* Add the fingerprint of the map in "entry" to *user.
+ */
+static int add_fingerprint(void **entry, void *user)
+{
+	isl_map *map = *entry;
+	uint32_t *sum = user;
+
+	*sum += isl_map_get_fingerprint(map);
+
+	return 0;
+}
+
+/* Return a fingerprint of "umap", combining the fingerprints
+ * of its maps.
+ * The order in which the maps are stored in the hash table
+ * depends on the history of "umap", so the fingerprints of the maps
+ * are combined in an order independent way by adding them up.
+ */
+uint32_t isl_union_map_get_fingerprint(__isl_keep isl_union_map *umap)
+{
+	uint32_t hash, sum = 0;
+
+	if (remove_empty_inplace(umap) < 0)
+		return 0;
+
+	if (isl_hash_table_foreach(umap->dim->ctx, &umap->table,
+				    &add_fingerprint, &sum) < 0)
+		return 0;
+
+	hash = isl_hash_init();
+	isl_hash_byte(hash, umap->table.n & 0xFF);
+	isl_hash_hash(hash, sum);
+
+	return hash;
+}
+
+uint32_t isl_union_set_get_fingerprint(__isl_keep isl_union_set *uset)
+{
+	return isl_union_map_get_fingerprint(uset);
+}
+
 static int copy_map(void **entry, void *user)
 {
 	isl_map *map = *entry;
@@ -444,8 +644,8 @@ __isl_give isl_map *isl_map_from_union_map(__isl_take isl_union_map *umap)
 	isl_ctx *ctx;
 	isl_map *map = NULL;
 
-	if (!umap)
-		return NULL;
+	if (remove_empty_inplace(umap) < 0)
+		goto error;
 	ctx = isl_union_map_get_ctx(umap);
 	if (umap->table.n != 1)
 		isl_die(ctx, isl_error_invalid,
@@ -508,7 +708,7 @@ __isl_give int isl_union_map_contains(__isl_keep isl_union_map *umap,
 	uint32_t hash;
 	struct isl_hash_table_entry *entry;
 
-	if (!umap || !dim)
+	if (!dim || remove_empty_inplace(umap) < 0)
 		return -1;
 
 	hash = isl_space_get_hash(dim);
@@ -530,6 +730,42 @@ int isl_union_set_foreach_set(__isl_keep isl_union_set *uset,
 		(int(*)(__isl_take isl_map *, void*))fn, user);
 }
 
+struct isl_union_map_foreach_peek_data {
+	int (*fn)(__isl_keep isl_map *map, void *user);
+	void *user;
+};
+
+static int call_on_map(void **entry, void *user)
+{
+	isl_map *map = *entry;
+	struct isl_union_map_foreach_peek_data *data = user;
+
+	return data->fn(map, data->user);
+}
+
+/* Call "fn" on each map of "umap", without passing
+ * ownership of the map to "fn".
+ * "fn" is not allowed to modify or free the map.
+ */
+int isl_union_map_foreach_map_peek(__isl_keep isl_union_map *umap,
+	int (*fn)(__isl_keep isl_map *map, void *user), void *user)
+{
+	struct isl_union_map_foreach_peek_data data = { fn, user };
+
+	if (remove_empty_inplace(umap) < 0)
+		return -1;
+
+	return isl_hash_table_foreach(umap->dim->ctx, &umap->table,
+				      &call_on_map, &data);
+}
+
+int isl_union_set_foreach_set_peek(__isl_keep isl_union_set *uset,
+	int (*fn)(__isl_keep isl_set *set, void *user), void *user)
+{
+	return isl_union_map_foreach_map_peek(uset,
+		(int(*)(__isl_keep isl_map *, void*))fn, user);
+}
+
 struct isl_union_set_foreach_point_data {
 	int (*fn)(__isl_take isl_point *pnt, void *user);
 	void *user;
@@ -553,9 +789,235 @@ int isl_union_set_foreach_point(__isl_keep isl_union_set *uset,
 	return isl_union_set_foreach_set(uset, &foreach_point, &data);
 }
 
+/* Is "map", the result of an operation on a map in a union map,
+ * empty such that it should not be added to the resulting union map?
+ * If the union_map_lazy_empty option is set, then only check
+ * whether "map" is obviously empty.  Any remaining empty maps
+ * are removed by isl_union_map_coalesce.
+ */
+static int result_is_empty(__isl_keep isl_map *map)
+{
+	if (!map)
+		return -1;
+	if (map->ctx->opt->union_map_lazy_empty)
+		return isl_map_plain_is_empty(map);
+	return isl_map_is_empty(map);
+}
+
+/* Return the map in "entry" of a union map that is about to be freed.
+ * If "steal" is set, then the union map has no other references and
+ * the map is removed from the union map such that the caller
+ * holds the only reference to the map (from the union map) and
+ * can therefore modify it without having to duplicate it first.
+ * Otherwise, a copy of the map is returned.
+ */
+static __isl_give isl_map *take_entry(void **entry, int steal)
+{
+	isl_map *map = *entry;
+
+	if (!steal)
+		return isl_map_copy(map);
+	*entry = NULL;
+	return map;
+}
+
+#ifdef HAVE_PTHREAD
+
+/* Sort the indices of the input maps in decreasing number of disjuncts.
+ */
+#define SORT_FN		sort_by_disjuncts
+#define SORT_EL		int
+#define SORT_ARG	isl_map **
+#define SORT_CMP(a,b,map)	((map)[*(b)]->n - (map)[*(a)]->n)
+
+#include <isl_sort_templ.c>
+
+/* Data used by bin_op_threads and its workers.
+ * "map1" and "map2" contain the pairs of input maps with the same space,
+ * which live in "ctx".  The pair at position i is only set
+ * if the i-th map of the first union map has a matching map
+ * in "umap2".  The positions of the "n_pair" pairs are stored
+ * in "order", in the order in which they are claimed by the workers.
+ * "res" is filled with the non-empty results of applying "fn"
+ * to these pairs, which are imported back into "ctx", and,
+ * if "keep" is set, with the maps without a matching map in "umap2".
+ * "n" is the number of maps of the first union map that have been
+ * collected so far and "steal" is set if these maps may be removed
+ * from the first union map.
+ */
+struct isl_union_map_bin_threads {
+	isl_ctx *ctx;
+	__isl_give isl_map *(*fn)(__isl_take isl_map *map1,
+		__isl_take isl_map *map2);
+	isl_union_map *umap2;
+	int keep;
+	int steal;
+	int n;
+	int n_pair;
+	isl_map **map1;
+	isl_map **map2;
+	int *order;
+	isl_map **res;
+};
+
+/* Store the map in "entry" along with the map with the same space
+ * in data->umap2, if any, in the next position of "data".
+ * If there is no such map, then the map in "entry" is only kept
+ * if data->keep is set, and then directly as a result.
+ */
+static int collect_pair(void **entry, void *user)
+{
+	struct isl_union_map_bin_threads *data = user;
+	uint32_t hash;
+	struct isl_hash_table_entry *entry2;
+	isl_map *map = *entry;
+	int i;
+
+	hash = isl_space_get_hash(map->dim);
+	entry2 = isl_hash_table_find(data->umap2->dim->ctx, &data->umap2->table,
+				     hash, &has_dim, map->dim, 0);
+	i = data->n++;
+	if (entry2) {
+		data->map1[i] = take_entry(entry, data->steal);
+		data->map2[i] = isl_map_copy(entry2->data);
+		data->order[data->n_pair++] = i;
+	} else if (data->keep) {
+		data->res[i] = take_entry(entry, data->steal);
+	}
+
+	return 0;
+}
+
+/* Import the pair of input maps at position "pos" in the claiming order
+ * into the isl_ctx of "worker", apply the function to them and,
+ * if the result is not empty, import it back.
+ */
+static int bin_op_work(struct isl_thread_worker *worker, int pos, void *user)
+{
+	struct isl_union_map_bin_threads *data = user;
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	int i = data->order[pos];
+	isl_map *map1, *map2;
+	int empty;
+
+	isl_thread_worker_lock(worker);
+	map1 = isl_map_import(ctx, data->map1[i]);
+	map2 = isl_map_import(ctx, data->map2[i]);
+	isl_thread_worker_unlock(worker);
+
+	map1 = data->fn(map1, map2);
+	empty = result_is_empty(map1);
+	if (empty < 0) {
+		isl_map_free(map1);
+		return -1;
+	}
+	if (empty) {
+		isl_map_free(map1);
+		return 0;
+	}
+
+	isl_thread_worker_lock(worker);
+	data->res[i] = isl_map_import(data->ctx, map1);
+	isl_thread_worker_unlock(worker);
+	isl_map_free(map1);
+
+	return data->res[i] ? 0 : -1;
+}
+
+/* Apply "fn" to each pair of maps with the same space in "umap1"
+ * and "umap2" using several threads and collect the non-empty results.
+ * If "keep" is set, then the maps in "umap1" without a matching map
+ * in "umap2" are added to the result as well.
+ *
+ * As in union_map_apply_threads, each thread imports the maps
+ * that it handles into its own isl_ctx, the pairs are claimed
+ * in decreasing number of disjuncts of the map in "umap1" and
+ * the results are added in the order of the maps in "umap1",
+ * such that the result does not depend on which thread
+ * handled which pair.
+ */
+static __isl_give isl_union_map *bin_op_threads(
+	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2,
+	__isl_give isl_map *(*fn)(__isl_take isl_map *map1,
+		__isl_take isl_map *map2), int keep)
+{
+	int i, n;
+	isl_ctx *ctx;
+	isl_union_map *res = NULL;
+	struct isl_union_map_bin_threads data = { 0 };
+
+	umap1 = isl_union_map_align_params(umap1, isl_union_map_get_space(umap2));
+	umap2 = isl_union_map_align_params(umap2, isl_union_map_get_space(umap1));
+	if (!umap1 || !umap2)
+		goto error;
+
+	ctx = isl_union_map_get_ctx(umap1);
+	n = umap1->table.n;
+	data.ctx = ctx;
+	data.fn = fn;
+	data.umap2 = umap2;
+	data.keep = keep;
+	data.steal = umap1->ref == 1 && umap1 != umap2;
+	data.map1 = isl_calloc_array(ctx, isl_map *, n);
+	data.map2 = isl_calloc_array(ctx, isl_map *, n);
+	data.res = isl_calloc_array(ctx, isl_map *, n);
+	data.order = isl_alloc_array(ctx, int, n);
+	if (n && (!data.map1 || !data.map2 || !data.res || !data.order))
+		goto error;
+	if (isl_hash_table_foreach(ctx, &umap1->table,
+				    &collect_pair, &data) < 0)
+		goto error;
+	if (sort_by_disjuncts(data.order, data.n_pair, data.map1) < 0)
+		goto error;
+	if (isl_thread_run(ctx, data.n_pair, &bin_op_work, &data) < 0)
+		goto error;
+
+	res = isl_union_map_alloc(isl_space_copy(umap1->dim), n);
+	for (i = 0; i < data.n; ++i) {
+		if (!data.res[i])
+			continue;
+		res = isl_union_map_add_map(res, data.res[i]);
+		data.res[i] = NULL;
+	}
+
+	if (0)
+error:
+		res = isl_union_map_free(res);
+	for (i = 0; i < data.n; ++i) {
+		isl_map_free(data.res[i]);
+		isl_map_free(data.map1[i]);
+		isl_map_free(data.map2[i]);
+	}
+	free(data.order);
+	free(data.res);
+	free(data.map2);
+	free(data.map1);
+	isl_union_map_free(umap1);
+	isl_union_map_free(umap2);
+	return res;
+}
+
+/* Should a binary operation be applied to the pairs of maps
+ * with the same space in "umap1" and some other union map
+ * by several threads in parallel?
+ * That is, is the threads option set to a value greater than one and
+ * does "umap1" contain more than one map?
+ */
+static int bin_op_use_threads(__isl_keep isl_union_map *umap1)
+{
+	return umap1 && umap1->table.n > 1 &&
+		umap1->dim->ctx->opt->threads > 1;
+}
+
+#endif
+
+/* "steal" is set if the maps may be removed from the union map
+ * that is being traversed.
+ */
 struct isl_union_map_gen_bin_data {
 	isl_union_map *umap2;
 	isl_union_map *res;
+	int steal;
 };
 
 static int subtract_entry(void **entry, void *user)
@@ -568,12 +1030,12 @@ static int subtract_entry(void **entry, void *user)
 	hash = isl_space_get_hash(map->dim);
 	entry2 = isl_hash_table_find(data->umap2->dim->ctx, &data->umap2->table,
 				     hash, &has_dim, map->dim, 0);
-	map = isl_map_copy(map);
+	map = take_entry(entry, data->steal);
 	if (entry2) {
 		int empty;
 		map = isl_map_subtract(map, isl_map_copy(entry2->data));
 
-		empty = isl_map_is_empty(map);
+		empty = result_is_empty(map);
 		if (empty < 0) {
 			isl_map_free(map);
 			return -1;
@@ -588,10 +1050,15 @@ static int subtract_entry(void **entry, void *user)
 	return 0;
 }
 
+/* Construct a union map from the results of applying "fn"
+ * to each map in "umap1".
+ * If "umap1" has no other references, then "fn" may remove
+ * the maps from "umap1" using take_entry.
+ */
 static __isl_give isl_union_map *gen_bin_op(__isl_take isl_union_map *umap1,
 	__isl_take isl_union_map *umap2, int (*fn)(void **, void *))
 {
-	struct isl_union_map_gen_bin_data data = { NULL, NULL };
+	struct isl_union_map_gen_bin_data data = { NULL, NULL, 0 };
 
 	umap1 = isl_union_map_align_params(umap1, isl_union_map_get_space(umap2));
 	umap2 = isl_union_map_align_params(umap2, isl_union_map_get_space(umap1));
@@ -600,6 +1067,7 @@ static __isl_give isl_union_map *gen_bin_op(__isl_take isl_union_map *umap1,
 		goto error;
 
 	data.umap2 = umap2;
+	data.steal = umap1->ref == 1 && umap1 != umap2;
 	data.res = isl_union_map_alloc(isl_space_copy(umap1->dim),
 				       umap1->table.n);
 	if (isl_hash_table_foreach(umap1->dim->ctx, &umap1->table,
@@ -616,9 +1084,18 @@ error:
 	return NULL;
 }
 
+/* Subtract "umap2" from "umap1".
+ * If the threads option is set to a value greater than one
+ * and isl has been built with thread support, then the pairs of maps
+ * with the same space are handled by several threads in parallel.
+ */
 __isl_give isl_union_map *isl_union_map_subtract(
 	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2)
 {
+#ifdef HAVE_PTHREAD
+	if (bin_op_use_threads(umap1))
+		return bin_op_threads(umap1, umap2, &isl_map_subtract, 1);
+#endif
 	return gen_bin_op(umap1, umap2, &subtract_entry);
 }
 
@@ -642,7 +1119,7 @@ static int intersect_params_entry(void **entry, void *user)
 	map = isl_map_copy(map);
 	map = isl_map_intersect_params(map, isl_set_copy(data->set));
 
-	empty = isl_map_is_empty(map);
+	empty = result_is_empty(map);
 	if (empty < 0) {
 		isl_map_free(map);
 		return -1;
@@ -706,10 +1183,14 @@ static __isl_give isl_union_map *union_map_gist_params(
 	return isl_union_map_gist_params(umap, isl_set_from_union_set(uset));
 }
 
+/* "steal" is set if the maps may be removed from the union map
+ * that is being traversed.
+ */
 struct isl_union_map_match_bin_data {
 	isl_union_map *umap2;
 	isl_union_map *res;
 	__isl_give isl_map *(*fn)(__isl_take isl_map*, __isl_take isl_map*);
+	int steal;
 };
 
 static int match_bin_entry(void **entry, void *user)
@@ -726,10 +1207,10 @@ static int match_bin_entry(void **entry, void *user)
 	if (!entry2)
 		return 0;
 
-	map = isl_map_copy(map);
+	map = take_entry(entry, data->steal);
 	map = data->fn(map, isl_map_copy(entry2->data));
 
-	empty = isl_map_is_empty(map);
+	empty = result_is_empty(map);
 	if (empty < 0) {
 		isl_map_free(map);
 		return -1;
@@ -744,11 +1225,21 @@ static int match_bin_entry(void **entry, void *user)
 	return 0;
 }
 
+/* Construct a union map from the non-empty results of applying "fn"
+ * to each pair of maps with the same space in "umap1" and "umap2".
+ * If the threads option is set to a value greater than one
+ * and isl has been built with thread support, then the pairs
+ * are handled by several threads in parallel.
+ */
 static __isl_give isl_union_map *match_bin_op(__isl_take isl_union_map *umap1,
 	__isl_take isl_union_map *umap2,
 	__isl_give isl_map *(*fn)(__isl_take isl_map*, __isl_take isl_map*))
 {
-	struct isl_union_map_match_bin_data data = { NULL, NULL, fn };
+	struct isl_union_map_match_bin_data data = { NULL, NULL, fn, 0 };
+#ifdef HAVE_PTHREAD
+	if (bin_op_use_threads(umap1))
+		return bin_op_threads(umap1, umap2, fn, 0);
+#endif
 
 	umap1 = isl_union_map_align_params(umap1, isl_union_map_get_space(umap2));
 	umap2 = isl_union_map_align_params(umap2, isl_union_map_get_space(umap1));
@@ -757,6 +1248,7 @@ static __isl_give isl_union_map *match_bin_op(__isl_take isl_union_map *umap1,
 		goto error;
 
 	data.umap2 = umap2;
+	data.steal = umap1->ref == 1 && umap1 != umap2;
 	data.res = isl_union_map_alloc(isl_space_copy(umap1->dim),
 				       umap1->table.n);
 	if (isl_hash_table_foreach(umap1->dim->ctx, &umap1->table,
@@ -813,7 +1305,7 @@ static int gist_params_entry(void **entry, void *user)
 	map = isl_map_copy(map);
 	map = isl_map_gist_params(map, isl_set_copy(data->set));
 
-	empty = isl_map_is_empty(map);
+	empty = result_is_empty(map);
 	if (empty < 0) {
 		isl_map_free(map);
 		return -1;
@@ -919,7 +1411,7 @@ static int intersect_domain_entry(void **entry, void *user)
 	map = isl_map_copy(map);
 	map = isl_map_intersect_domain(map, isl_set_copy(entry2->data));
 
-	empty = isl_map_is_empty(map);
+	empty = result_is_empty(map);
 	if (empty < 0) {
 		isl_map_free(map);
 		return -1;
@@ -974,7 +1466,7 @@ static int subtract_domain_entry(void **entry, void *user)
 
 	map = isl_map_subtract_domain(map, isl_set_copy(entry2->data));
 
-	empty = isl_map_is_empty(map);
+	empty = result_is_empty(map);
 	if (empty < 0) {
 		isl_map_free(map);
 		return -1;
@@ -1025,7 +1517,7 @@ static int subtract_range_entry(void **entry, void *user)
 
 	map = isl_map_subtract_range(map, isl_set_copy(entry2->data));
 
-	empty = isl_map_is_empty(map);
+	empty = result_is_empty(map);
 	if (empty < 0) {
 		isl_map_free(map);
 		return -1;
@@ -1069,7 +1561,7 @@ static int gist_domain_entry(void **entry, void *user)
 	map = isl_map_copy(map);
 	map = isl_map_gist_domain(map, isl_set_copy(entry2->data));
 
-	empty = isl_map_is_empty(map);
+	empty = result_is_empty(map);
 	if (empty < 0) {
 		isl_map_free(map);
 		return -1;
@@ -1113,7 +1605,7 @@ static int gist_range_entry(void **entry, void *user)
 	map = isl_map_copy(map);
 	map = isl_map_gist_range(map, isl_set_copy(entry2->data));
 
-	empty = isl_map_is_empty(map);
+	empty = result_is_empty(map);
 	if (empty < 0) {
 		isl_map_free(map);
 		return -1;
@@ -1153,7 +1645,7 @@ static int intersect_range_entry(void **entry, void *user)
 	map = isl_map_copy(map);
 	map = isl_map_intersect_range(map, isl_set_copy(entry2->data));
 
-	empty = isl_map_is_empty(map);
+	empty = result_is_empty(map);
 	if (empty < 0) {
 		isl_map_free(map);
 		return -1;
@@ -1174,11 +1666,14 @@ __isl_give isl_union_map *isl_union_map_intersect_range(
 	return gen_bin_op(umap, uset, &intersect_range_entry);
 }
 
+/* "user" holds any additional data needed by "fn".
+ */
 struct isl_union_map_bin_data {
 	isl_union_map *umap2;
 	isl_union_map *res;
 	isl_map *map;
 	int (*fn)(void **entry, void *user);
+	void *user;
 };
 
 static int apply_range_entry(void **entry, void *user)
@@ -1193,7 +1688,7 @@ static int apply_range_entry(void **entry, void *user)
 
 	map2 = isl_map_apply_range(isl_map_copy(data->map), isl_map_copy(map2));
 
-	empty = isl_map_is_empty(map2);
+	empty = result_is_empty(map2);
 	if (empty < 0) {
 		isl_map_free(map2);
 		return -1;
@@ -1224,7 +1719,7 @@ static int bin_entry(void **entry, void *user)
 static __isl_give isl_union_map *bin_op(__isl_take isl_union_map *umap1,
 	__isl_take isl_union_map *umap2, int (*fn)(void **entry, void *user))
 {
-	struct isl_union_map_bin_data data = { NULL, NULL, NULL, fn };
+	struct isl_union_map_bin_data data = { NULL, NULL, NULL, fn, NULL };
 
 	umap1 = isl_union_map_align_params(umap1, isl_union_map_get_space(umap2));
 	umap2 = isl_union_map_align_params(umap2, isl_union_map_get_space(umap1));
@@ -1249,10 +1744,212 @@ error:
 	return NULL;
 }
 
+/* A group of maps in a union map that share the same tuple
+ * of a given type, in the order in which they appear in the union map.
+ * The maps are not referenced by the group.
+ */
+struct isl_union_map_tuple_group {
+	int n;
+	int size;
+	isl_map **map;
+};
+
+/* The tuple of type "type" of "space", used as a key
+ * in an index of maps on their tuples of type "index_type".
+ */
+struct isl_union_map_tuple_key {
+	isl_space *space;
+	enum isl_dim_type type;
+	enum isl_dim_type index_type;
+};
+
+static int has_tuple(const void *entry, const void *val)
+{
+	struct isl_union_map_tuple_group *group;
+	struct isl_union_map_tuple_key *key;
+
+	group = (struct isl_union_map_tuple_group *) entry;
+	key = (struct isl_union_map_tuple_key *) val;
+	return isl_space_tuple_is_equal(group->map[0]->dim, key->index_type,
+					key->space, key->type);
+}
+
+/* Look for the group of maps in "index" with a tuple of type "index_type"
+ * that is equal to the tuple of type "type" of "space".
+ * If "reserve" is set, then create an entry if it does not exist yet.
+ */
+static struct isl_hash_table_entry *find_tuple_group(isl_ctx *ctx,
+	struct isl_hash_table *index, enum isl_dim_type index_type,
+	__isl_keep isl_space *space, enum isl_dim_type type, int reserve)
+{
+	uint32_t hash;
+	struct isl_union_map_tuple_key key = { space, type, index_type };
+
+	hash = isl_space_get_tuple_hash(space, type);
+	return isl_hash_table_find(ctx, index, hash, &has_tuple, &key, reserve);
+}
+
+struct isl_union_map_tuple_index_data {
+	struct isl_hash_table *index;
+	enum isl_dim_type type;
+};
+
+/* Add the map in "entry" to the group of maps with the same tuple
+ * of type data->type in data->index.
+ */
+static int add_to_tuple_index(void **entry, void *user)
+{
+	struct isl_union_map_tuple_index_data *data = user;
+	isl_map *map = *entry;
+	isl_ctx *ctx = isl_map_get_ctx(map);
+	struct isl_hash_table_entry *group_entry;
+	struct isl_union_map_tuple_group *group;
+
+	group_entry = find_tuple_group(ctx, data->index, data->type,
+					map->dim, data->type, 1);
+	if (!group_entry)
+		return -1;
+	group = group_entry->data;
+	if (!group) {
+		group = isl_calloc_type(ctx, struct isl_union_map_tuple_group);
+		if (!group)
+			return -1;
+		group_entry->data = group;
+	}
+	if (group->n >= group->size) {
+		int size = 2 * group->size + 1;
+		isl_map **maps;
+
+		maps = isl_realloc_array(ctx, group->map, isl_map *, size);
+		if (!maps)
+			return -1;
+		group->map = maps;
+		group->size = size;
+	}
+	group->map[group->n++] = map;
+
+	return 0;
+}
+
+static int free_tuple_group(void **entry, void *user)
+{
+	struct isl_union_map_tuple_group *group = *entry;
+
+	free(group->map);
+	free(group);
+
+	return 0;
+}
+
+/* Free an index constructed by tuple_index.
+ */
+static void tuple_index_free(isl_ctx *ctx, struct isl_hash_table *index)
+{
+	if (!index)
+		return;
+	isl_hash_table_foreach(ctx, index, &free_tuple_group, NULL);
+	isl_hash_table_free(ctx, index);
+}
+
+/* Construct an index of the maps in "umap" on their tuples
+ * of type "type".
+ * The index does not hold any references to the maps and
+ * should therefore be freed (using tuple_index_free) before "umap".
+ */
+static struct isl_hash_table *tuple_index(__isl_keep isl_union_map *umap,
+	enum isl_dim_type type)
+{
+	isl_ctx *ctx;
+	struct isl_union_map_tuple_index_data data;
+
+	if (!umap)
+		return NULL;
+
+	ctx = isl_union_map_get_ctx(umap);
+	data.type = type;
+	data.index = isl_hash_table_alloc(ctx, umap->table.n);
+	if (!data.index)
+		return NULL;
+	if (isl_hash_table_foreach(ctx, &umap->table,
+				    &add_to_tuple_index, &data) < 0) {
+		tuple_index_free(ctx, data.index);
+		return NULL;
+	}
+
+	return data.index;
+}
+
+/* Apply every map in data->umap2 with a domain tuple equal
+ * to the range tuple of the map in "entry" to that map.
+ * The maps of data->umap2 are looked up in the index data->user,
+ * constructed by tuple_index on the domain tuples.
+ */
+static int apply_range_indexed_entry(void **entry, void *user)
+{
+	struct isl_union_map_bin_data *data = user;
+	struct isl_hash_table *index = data->user;
+	struct isl_hash_table_entry *group_entry;
+	struct isl_union_map_tuple_group *group;
+	isl_map *map = *entry;
+	int i;
+
+	group_entry = find_tuple_group(isl_map_get_ctx(map), index, isl_dim_in,
+					map->dim, isl_dim_out, 0);
+	if (!group_entry)
+		return 0;
+
+	group = group_entry->data;
+	data->map = map;
+	for (i = 0; i < group->n; ++i)
+		if (apply_range_entry((void **) &group->map[i], data) < 0)
+			return -1;
+
+	return 0;
+}
+
+/* Compute the composition of "umap1" and "umap2",
+ * only combining maps of "umap1" with maps of "umap2"
+ * that have a matching domain tuple.
+ * These maps are obtained from a temporary index of "umap2"
+ * on the domain tuples, which avoids comparing each map of "umap1"
+ * to each map of "umap2".
+ */
 __isl_give isl_union_map *isl_union_map_apply_range(
 	__isl_take isl_union_map *umap1, __isl_take isl_union_map *umap2)
 {
-	return bin_op(umap1, umap2, &apply_range_entry);
+	isl_ctx *ctx;
+	struct isl_hash_table *index;
+	struct isl_union_map_bin_data data = { NULL, NULL, NULL, NULL, NULL };
+
+	umap1 = isl_union_map_align_params(umap1, isl_union_map_get_space(umap2));
+	umap2 = isl_union_map_align_params(umap2, isl_union_map_get_space(umap1));
+
+	if (!umap1 || !umap2)
+		goto error;
+
+	ctx = isl_union_map_get_ctx(umap1);
+	index = tuple_index(umap2, isl_dim_in);
+	if (!index)
+		goto error;
+	data.umap2 = umap2;
+	data.user = index;
+	data.res = isl_union_map_alloc(isl_space_copy(umap1->dim),
+				       umap1->table.n);
+	if (isl_hash_table_foreach(ctx, &umap1->table,
+				   &apply_range_indexed_entry, &data) < 0) {
+		tuple_index_free(ctx, index);
+		goto error;
+	}
+
+	tuple_index_free(ctx, index);
+	isl_union_map_free(umap1);
+	isl_union_map_free(umap2);
+	return data.res;
+error:
+	isl_union_map_free(umap1);
+	isl_union_map_free(umap2);
+	isl_union_map_free(data.res);
+	return NULL;
 }
 
 __isl_give isl_union_map *isl_union_map_apply_domain(
@@ -1549,14 +2246,22 @@ __isl_give isl_union_set *isl_union_set_simple_hull(
 	return isl_union_map_simple_hull(uset);
 }
 
+/* "steal" is set if the union map has no other references,
+ * in which case the maps can be modified in place without
+ * keeping the original around.
+ */
+struct isl_union_map_inplace_data {
+	__isl_give isl_map *(*fn)(__isl_take isl_map *);
+	int steal;
+};
+
 static int inplace_entry(void **entry, void *user)
 {
-	__isl_give isl_map *(*fn)(__isl_take isl_map *);
+	struct isl_union_map_inplace_data *data = user;
 	isl_map **map = (isl_map **)entry;
 	isl_map *copy;
 
-	fn = *(__isl_give isl_map *(**)(__isl_take isl_map *)) user;
-	copy = fn(isl_map_copy(*map));
+	copy = data->fn(take_entry(entry, data->steal));
 	if (!copy)
 		return -1;
 
@@ -1566,14 +2271,20 @@ static int inplace_entry(void **entry, void *user)
 	return 0;
 }
 
+/* Replace each map in "umap" by the result of applying "fn" to it,
+ * where "fn" does not change the meaning of the map.
+ */
 static __isl_give isl_union_map *inplace(__isl_take isl_union_map *umap,
 	__isl_give isl_map *(*fn)(__isl_take isl_map *))
 {
+	struct isl_union_map_inplace_data data = { fn };
+
 	if (!umap)
 		return NULL;
 
+	data.steal = umap->ref == 1;
 	if (isl_hash_table_foreach(umap->dim->ctx, &umap->table,
-				    &inplace_entry, &fn) < 0)
+				    &inplace_entry, &data) < 0)
 		goto error;
 
 	return umap;
@@ -1582,9 +2293,140 @@ error:
 	return NULL;
 }
 
+#ifdef HAVE_PTHREAD
+
+/* Data used by the workers of union_map_apply_threads.
+ * "map" contains the "n" input maps, which live in "ctx".
+ * "res" is filled with the results of applying "fn" to these maps,
+ * which are imported back into "ctx".
+ * "order" contains the indices of the input maps in the order
+ * in which they are claimed by the workers.
+ */
+struct isl_union_map_threads {
+	isl_ctx *ctx;
+	__isl_give isl_map *(*fn)(__isl_take isl_map *map);
+	int n;
+	isl_map **map;
+	int *order;
+	isl_map **res;
+};
+
+/* Import the input map at position "pos" in the claiming order
+ * into the isl_ctx of "worker", apply the function to it and
+ * import the result back.
+ */
+static int union_map_work(struct isl_thread_worker *worker, int pos,
+	void *user)
+{
+	struct isl_union_map_threads *data = user;
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	int i = data->order[pos];
+	isl_map *map;
+
+	isl_thread_worker_lock(worker);
+	map = isl_map_import(ctx, data->map[i]);
+	isl_thread_worker_unlock(worker);
+
+	map = data->fn(map);
+
+	isl_thread_worker_lock(worker);
+	data->res[i] = isl_map_import(data->ctx, map);
+	isl_thread_worker_unlock(worker);
+	isl_map_free(map);
+
+	return data->res[i] ? 0 : -1;
+}
+
+/* Add a copy of "map" to the array pointed to by "user".
+ */
+static int collect_map(__isl_take isl_map *map, void *user)
+{
+	isl_map ***next = user;
+
+	*(*next)++ = map;
+	return 0;
+}
+
+/* Apply "fn", which does not change the meaning of its argument,
+ * to each map in "umap" using several threads.
+ *
+ * Each thread has its own isl_ctx, with the same options as
+ * the isl_ctx of "umap", into which it imports the maps that it handles
+ * (see isl_thread_run).
+ * The results are added to the result in the order of the maps
+ * in "umap", such that the result does not depend on which thread
+ * handled which map.
+ * The maps are claimed in decreasing number of disjuncts,
+ * such that a map with many disjuncts is not left
+ * until all other threads have run out of work.
+ */
+static __isl_give isl_union_map *union_map_apply_threads(
+	__isl_take isl_union_map *umap,
+	__isl_give isl_map *(*fn)(__isl_take isl_map *map))
+{
+	int i;
+	isl_ctx *ctx;
+	isl_map **next;
+	isl_union_map *res = NULL;
+	struct isl_union_map_threads data = { 0 };
+
+	ctx = isl_union_map_get_ctx(umap);
+	data.ctx = ctx;
+	data.fn = fn;
+	data.n = isl_union_map_n_map(umap);
+	data.map = isl_calloc_array(ctx, isl_map *, data.n);
+	data.res = isl_calloc_array(ctx, isl_map *, data.n);
+	data.order = isl_alloc_array(ctx, int, data.n);
+	if (!data.map || !data.res || !data.order)
+		goto error;
+	next = data.map;
+	if (isl_union_map_foreach_map(umap, &collect_map, &next) < 0)
+		goto error;
+	for (i = 0; i < data.n; ++i)
+		data.order[i] = i;
+	if (sort_by_disjuncts(data.order, data.n, data.map) < 0)
+		goto error;
+	if (isl_thread_run(ctx, data.n, &union_map_work, &data) < 0)
+		goto error;
+
+	res = isl_union_map_empty(isl_union_map_get_space(umap));
+	for (i = 0; i < data.n; ++i) {
+		res = isl_union_map_add_map(res, data.res[i]);
+		data.res[i] = NULL;
+	}
+
+	if (0)
+error:
+		res = isl_union_map_free(res);
+	for (i = 0; data.res && i < data.n; ++i)
+		isl_map_free(data.res[i]);
+	for (i = 0; data.map && i < data.n; ++i)
+		isl_map_free(data.map[i]);
+	free(data.order);
+	free(data.res);
+	free(data.map);
+	isl_union_map_free(umap);
+	return res;
+}
+
+#endif
+
+/* Coalesce the maps in "umap".
+ * If the union_map_lazy_empty option is set, then "umap" may
+ * contain empty maps.  Remove them first.
+ * If the threads option is set to a value greater than one
+ * and isl has been built with thread support, then the maps
+ * are coalesced by several threads in parallel.
+ */
 __isl_give isl_union_map *isl_union_map_coalesce(
 	__isl_take isl_union_map *umap)
 {
+	if (remove_empty_inplace(umap) < 0)
+		return isl_union_map_free(umap);
+#ifdef HAVE_PTHREAD
+	if (umap->dim->ctx->opt->threads > 1 && umap->table.n > 1)
+		return union_map_apply_threads(umap, &isl_map_coalesce);
+#endif
 	return inplace(umap, &isl_map_coalesce);
 }
 
@@ -1606,6 +2448,20 @@ __isl_give isl_union_set *isl_union_set_detect_equalities(
 	return isl_union_map_detect_equalities(uset);
 }
 
+/* Reallocate the basic maps of "umap" to their exact size
+ * and let them share the spaces of the maps that contain them.
+ * See isl_map_compact.
+ */
+__isl_give isl_union_map *isl_union_map_compact(__isl_take isl_union_map *umap)
+{
+	return inplace(umap, &isl_map_compact);
+}
+
+__isl_give isl_union_set *isl_union_set_compact(__isl_take isl_union_set *uset)
+{
+	return isl_union_map_compact(uset);
+}
+
 __isl_give isl_union_map *isl_union_map_compute_divs(
 	__isl_take isl_union_map *umap)
 {
@@ -1618,6 +2474,15 @@ __isl_give isl_union_set *isl_union_set_compute_divs(
 	return isl_union_map_compute_divs(uset);
 }
 
+static int lexmax_entry(void **entry, void *user)
+{
+	isl_map **map = (isl_map **)entry;
+
+	*map = isl_map_lexmax(*map);
+
+	return *map ? 0 : -1;
+}
+
 static int lexmin_entry(void **entry, void *user)
 {
 	isl_map **map = (isl_map **)entry;
@@ -1627,10 +2492,30 @@ static int lexmin_entry(void **entry, void *user)
 	return *map ? 0 : -1;
 }
 
+
+/* Compute the lexicographic minimum (or maximum if "max" is set)
+ * of each map in "umap".
+ * If the threads option is set to a value greater than one
+ * and isl has been built with thread support, then the maps
+ * are handled by several threads in parallel.
+ */
+static __isl_give isl_union_map *union_map_lexopt(
+	__isl_take isl_union_map *umap, int max)
+{
+#ifdef HAVE_PTHREAD
+	if (!umap)
+		return NULL;
+	if (umap->dim->ctx->opt->threads > 1 && umap->table.n > 1)
+		return union_map_apply_threads(umap,
+				max ? &isl_map_lexmax : &isl_map_lexmin);
+#endif
+	return un_op(umap, max ? &lexmax_entry : &lexmin_entry);
+}
+
 __isl_give isl_union_map *isl_union_map_lexmin(
 	__isl_take isl_union_map *umap)
 {
-	return un_op(umap, &lexmin_entry);
+	return union_map_lexopt(umap, 0);
 }
 
 __isl_give isl_union_set *isl_union_set_lexmin(
@@ -1639,19 +2524,10 @@ __isl_give isl_union_set *isl_union_set_lexmin(
 	return isl_union_map_lexmin(uset);
 }
 
-static int lexmax_entry(void **entry, void *user)
-{
-	isl_map **map = (isl_map **)entry;
-
-	*map = isl_map_lexmax(*map);
-
-	return *map ? 0 : -1;
-}
-
 __isl_give isl_union_map *isl_union_map_lexmax(
 	__isl_take isl_union_map *umap)
 {
-	return un_op(umap, &lexmax_entry);
+	return union_map_lexopt(umap, 1);
 }
 
 __isl_give isl_union_set *isl_union_set_lexmax(
@@ -2704,7 +3580,7 @@ static int preimage_entry(void **entry, void *user)
 	map = isl_map_copy(map);
 	map = data->fn(map, isl_pw_multi_aff_copy(data->pma));
 
-	empty = isl_map_is_empty(map);
+	empty = result_is_empty(map);
 	if (empty < 0 || empty) {
 		isl_map_free(map);
 		return empty < 0 ? -1 : 0;
@@ -2879,7 +3755,7 @@ static int preimage_mpa_entry(void **entry, void *user)
 	map = isl_map_copy(map);
 	map = data->fn(map, isl_multi_pw_aff_copy(data->mpa));
 
-	empty = isl_map_is_empty(map);
+	empty = result_is_empty(map);
 	if (empty < 0 || empty) {
 		isl_map_free(map);
 		return empty < 0 ? -1 : 0;
@@ -6,5 +6,11 @@ struct isl_union_map {
 	int ref;
 	isl_space *dim;
 
+	/* Set if none of the maps in "table" is known to be empty.
+	 * Only used if the union_map_lazy_empty option is set,
+	 * in which case "table" may contain empty maps otherwise.
+	 */
+	int non_empty;
+
 	struct isl_hash_table	table;
 };
@@ -0,0 +1,220 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <isl_ctx_private.h>
+#include <isl/union_set.h>
+#include <isl_compile_private.h>
+
+/* A union set that has been compiled into flat tables
+ * for fast membership tests.
+ *
+ * "n" is the number of spaces in the union set.
+ * dom[i] contains the compiled version of the set in space[i].
+ */
+struct isl_union_set_compiled {
+	isl_ctx *ctx;
+
+	int n;
+	int size;
+	isl_space **space;
+	struct isl_compiled_domain **dom;
+};
+
+__isl_null isl_union_set_compiled *isl_union_set_compiled_free(
+	__isl_take isl_union_set_compiled *c)
+{
+	int i;
+
+	if (!c)
+		return NULL;
+
+	for (i = 0; i < c->n; ++i) {
+		isl_space_free(c->space[i]);
+		isl_compiled_domain_free(c->dom[i]);
+	}
+	isl_ctx_deref(c->ctx);
+	free(c->space);
+	free(c->dom);
+	free(c);
+
+	return NULL;
+}
+
+/* Compile "set" and add it to "c".
+ */
+static int add_set(__isl_take isl_set *set, void *user)
+{
+	isl_union_set_compiled *c = user;
+	struct isl_compiled_domain *dom;
+	int n_in;
+
+	if (!set)
+		return -1;
+	if (c->n >= c->size) {
+		isl_space **space;
+		struct isl_compiled_domain **dom;
+		int size = 2 * c->size + 4;
+
+		space = isl_realloc_array(c->ctx, c->space, isl_space *, size);
+		if (!space)
+			goto error;
+		c->space = space;
+		dom = isl_realloc_array(c->ctx, c->dom,
+					struct isl_compiled_domain *, size);
+		if (!dom)
+			goto error;
+		c->dom = dom;
+		c->size = size;
+	}
+
+	n_in = isl_set_dim(set, isl_dim_all);
+	c->space[c->n] = isl_set_get_space(set);
+	c->dom[c->n] = dom = isl_compiled_domain_alloc(c->ctx, n_in);
+	c->n++;
+	if (!c->space[c->n - 1] || !dom)
+		goto error;
+
+	if (isl_compiled_domain_add_set(dom, set) < 0)
+		return -1;
+	return isl_compiled_domain_finalize(dom);
+error:
+	isl_set_free(set);
+	return -1;
+}
+
+/* Compile "uset" into flat tables that allow for testing
+ * whether many integer points belong to "uset" without using
+ * any isl objects.
+ *
+ * The set in each space is compiled separately into the constraints
+ * of its basic sets, expressed in terms of the parameters,
+ * the set variables and the integer divisions, which are evaluated
+ * once per point.
+ * Compilation fails if any of the coefficients of the integer divisions
+ * or the constraints does not fit in 64 bits.
+ */
+__isl_give isl_union_set_compiled *isl_union_set_compile(
+	__isl_keep isl_union_set *uset)
+{
+	isl_ctx *ctx;
+	isl_union_set_compiled *c;
+
+	if (!uset)
+		return NULL;
+
+	ctx = isl_union_set_get_ctx(uset);
+	c = isl_calloc_type(ctx, isl_union_set_compiled);
+	if (!c)
+		return NULL;
+	c->ctx = ctx;
+	isl_ctx_ref(ctx);
+
+	if (isl_union_set_foreach_set(uset, &add_set, c) < 0)
+		return isl_union_set_compiled_free(c);
+
+	return c;
+}
+
+/* Return the number of spaces in "c".
+ */
+int isl_union_set_compiled_n_space(__isl_keep isl_union_set_compiled *c)
+{
+	return c ? c->n : -1;
+}
+
+/* Return the position of the set with space "space" in "c",
+ * or -1 if "c" has no set in that space.
+ * The parameters of "space" are assumed to be the same
+ * as those of the compiled union set.
+ */
+int isl_union_set_compiled_find_space(__isl_keep isl_union_set_compiled *c,
+	__isl_keep isl_space *space)
+{
+	int i;
+
+	if (!c || !space)
+		return -1;
+
+	for (i = 0; i < c->n; ++i) {
+		int equal = isl_space_is_equal(c->space[i], space);
+		if (equal < 0)
+			return -1;
+		if (equal)
+			return i;
+	}
+
+	return -1;
+}
+
+/* Return the space of the set at position "pos" in "c".
+ */
+__isl_give isl_space *isl_union_set_compiled_get_space(
+	__isl_keep isl_union_set_compiled *c, int pos)
+{
+	if (!c)
+		return NULL;
+	if (pos < 0 || pos >= c->n)
+		isl_die(c->ctx, isl_error_invalid,
+			"position out of bounds", return NULL);
+	return isl_space_copy(c->space[pos]);
+}
+
+/* Return the number of coordinates of each point passed
+ * to isl_union_set_compiled_contains for the set at position "pos",
+ * i.e., the number of parameters plus the number of set variables.
+ */
+int isl_union_set_compiled_dim(__isl_keep isl_union_set_compiled *c, int pos)
+{
+	if (!c)
+		return -1;
+	if (pos < 0 || pos >= c->n)
+		isl_die(c->ctx, isl_error_invalid,
+			"position out of bounds", return -1);
+	return c->dom[pos]->n_in;
+}
+
+/* Check for each of the "n" points in "points", each consisting of
+ * isl_union_set_compiled_dim(c, pos) values, whether it belongs
+ * to the set at position "pos" in "c", setting contains[i] to 1
+ * if point i does and to 0 if it does not.
+ *
+ * The integer divisions and constraints are evaluated exactly,
+ * failing if any of the intermediate results overflows.
+ */
+int isl_union_set_compiled_contains(__isl_keep isl_union_set_compiled *c,
+	int pos, int n, const int64_t *points, int *contains)
+{
+	struct isl_compiled_domain *dom;
+	int i, set;
+	int64_t *val;
+	int n_val;
+
+	if (!c)
+		return -1;
+	if (pos < 0 || pos >= c->n)
+		isl_die(c->ctx, isl_error_invalid,
+			"position out of bounds", return -1);
+
+	dom = c->dom[pos];
+	n_val = dom->n_in + dom->n_div;
+	val = isl_alloc_array(c->ctx, int64_t, n_val);
+	if (n_val && !val)
+		return -1;
+
+	for (i = 0; i < n; ++i) {
+		const int64_t *pnt = points + (size_t) i * dom->n_in;
+
+		if (isl_compiled_domain_eval_divs_int64(dom, pnt, val) < 0)
+			goto error;
+		if (isl_compiled_domain_locate_int64(dom, val, &set) < 0)
+			goto error;
+		contains[i] = set >= 0;
+	}
+
+	free(val);
+	return 0;
+error:
+	free(val);
+	return -1;
+}
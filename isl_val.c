@@ -556,6 +556,55 @@ error:
 	return NULL;
 }
 
+/* Given two rational values "v1" and "v2" with different denominators,
+ * replace "v1" by their sum (or their difference if "sub" is set).
+ * "v1" is assumed to be a private copy.
+ *
+ * Following Knuth (TAOCP, Vol. 2, 4.5.1), let g = gcd(d1, d2).
+ * If g = 1, then the result n1 * d2 +/- n2 * d1 / (d1 * d2)
+ * is already in normal form.
+ * Otherwise, the result is t / (d1/g * d2/g * g), with
+ * t = n1 * (d2/g) +/- n2 * (d1/g), and the only common divisors
+ * of t and the denominator are those of t and g.
+ * This avoids computing the gcd of the full (and typically much larger)
+ * numerator and denominator of the result.
+ */
+static __isl_give isl_val *add_rat(__isl_take isl_val *v1,
+	__isl_keep isl_val *v2, int sub)
+{
+	isl_int g, t;
+
+	isl_int_init(g);
+	isl_int_init(t);
+	isl_int_gcd(g, v1->d, v2->d);
+	if (isl_int_is_one(g)) {
+		isl_int_mul(v1->n, v1->n, v2->d);
+		if (sub)
+			isl_int_submul(v1->n, v2->n, v1->d);
+		else
+			isl_int_addmul(v1->n, v2->n, v1->d);
+		isl_int_mul(v1->d, v1->d, v2->d);
+	} else {
+		isl_int_divexact(t, v2->d, g);
+		isl_int_mul(v1->n, v1->n, t);
+		isl_int_divexact(t, v1->d, g);
+		if (sub)
+			isl_int_submul(v1->n, v2->n, t);
+		else
+			isl_int_addmul(v1->n, v2->n, t);
+		isl_int_gcd(g, v1->n, g);
+		isl_int_divexact(v1->n, v1->n, g);
+		isl_int_divexact(v1->d, v2->d, g);
+		isl_int_mul(v1->d, v1->d, t);
+	}
+	if (isl_int_is_zero(v1->n))
+		isl_int_set_si(v1->d, 1);
+	isl_int_clear(g);
+	isl_int_clear(t);
+
+	return v1;
+}
+
 /* Return the sum of "v1" and "v2".
  */
 __isl_give isl_val *isl_val_add(__isl_take isl_val *v1, __isl_take isl_val *v2)
@@ -598,14 +647,11 @@ __isl_give isl_val *isl_val_add(__isl_take isl_val *v1, __isl_take isl_val *v2)
 	if (isl_val_is_int(v1) && isl_val_is_int(v2))
 		isl_int_add(v1->n, v1->n, v2->n);
 	else {
-		if (isl_int_eq(v1->d, v2->d))
+		if (isl_int_eq(v1->d, v2->d)) {
 			isl_int_add(v1->n, v1->n, v2->n);
-		else {
-			isl_int_mul(v1->n, v1->n, v2->d);
-			isl_int_addmul(v1->n, v2->n, v1->d);
-			isl_int_mul(v1->d, v1->d, v2->d);
-		}
-		v1 = isl_val_normalize(v1);
+			v1 = isl_val_normalize(v1);
+		} else
+			v1 = add_rat(v1, v2, 0);
 	}
 	isl_val_free(v2);
 	return v1;
@@ -676,14 +722,11 @@ __isl_give isl_val *isl_val_sub(__isl_take isl_val *v1, __isl_take isl_val *v2)
 	if (isl_val_is_int(v1) && isl_val_is_int(v2))
 		isl_int_sub(v1->n, v1->n, v2->n);
 	else {
-		if (isl_int_eq(v1->d, v2->d))
+		if (isl_int_eq(v1->d, v2->d)) {
 			isl_int_sub(v1->n, v1->n, v2->n);
-		else {
-			isl_int_mul(v1->n, v1->n, v2->d);
-			isl_int_submul(v1->n, v2->n, v1->d);
-			isl_int_mul(v1->d, v1->d, v2->d);
-		}
-		v1 = isl_val_normalize(v1);
+			v1 = isl_val_normalize(v1);
+		} else
+			v1 = add_rat(v1, v2, 1);
 	}
 	isl_val_free(v2);
 	return v1;
@@ -712,6 +755,36 @@ __isl_give isl_val *isl_val_sub_ui(__isl_take isl_val *v1, unsigned long v2)
 	return v1;
 }
 
+/* Replace the rational value "v1" by its product with
+ * the rational value "v2", where "v1" is assumed to be a private copy.
+ *
+ * Since both values are normalized, the only common divisors
+ * of the numerator and the denominator of the result are those
+ * of n1 and d2 and those of n2 and d1.  These are removed
+ * before the multiplications such that the result is immediately
+ * in normal form and no gcd of the (larger) products needs to be computed.
+ */
+static __isl_give isl_val *mul_rat(__isl_take isl_val *v1,
+	__isl_keep isl_val *v2)
+{
+	isl_int g, t;
+
+	isl_int_init(g);
+	isl_int_init(t);
+	isl_int_gcd(g, v1->n, v2->d);
+	isl_int_divexact(v1->n, v1->n, g);
+	isl_int_divexact(t, v2->d, g);
+	isl_int_gcd(g, v2->n, v1->d);
+	isl_int_divexact(v1->d, v1->d, g);
+	isl_int_mul(v1->d, v1->d, t);
+	isl_int_divexact(t, v2->n, g);
+	isl_int_mul(v1->n, v1->n, t);
+	isl_int_clear(g);
+	isl_int_clear(t);
+
+	return v1;
+}
+
 /* Return the product of "v1" and "v2".
  */
 __isl_give isl_val *isl_val_mul(__isl_take isl_val *v1, __isl_take isl_val *v2)
@@ -757,11 +830,8 @@ __isl_give isl_val *isl_val_mul(__isl_take isl_val *v1, __isl_take isl_val *v2)
 		goto error;
 	if (isl_val_is_int(v1) && isl_val_is_int(v2))
 		isl_int_mul(v1->n, v1->n, v2->n);
-	else {
-		isl_int_mul(v1->n, v1->n, v2->n);
-		isl_int_mul(v1->d, v1->d, v2->d);
-		v1 = isl_val_normalize(v1);
-	}
+	else
+		v1 = mul_rat(v1, v2);
 	isl_val_free(v2);
 	return v1;
 error:
@@ -1176,6 +1246,10 @@ int isl_val_sgn(__isl_keep isl_val *v)
 }
 
 /* Is "v1" (strictly) less than "v2"?
+ *
+ * If the signs differ or if the denominators are the same,
+ * then the result can be determined without any multiplications.
+ * This also holds for infinite values, which have a zero denominator.
  */
 int isl_val_lt(__isl_keep isl_val *v1, __isl_keep isl_val *v2)
 {
@@ -1188,8 +1262,10 @@ int isl_val_lt(__isl_keep isl_val *v1, __isl_keep isl_val *v2)
 		return isl_int_lt(v1->n, v2->n);
 	if (isl_val_is_nan(v1) || isl_val_is_nan(v2))
 		return 0;
-	if (isl_val_eq(v1, v2))
-		return 0;
+	if (isl_int_sgn(v1->n) != isl_int_sgn(v2->n))
+		return isl_int_sgn(v1->n) < isl_int_sgn(v2->n);
+	if (isl_int_eq(v1->d, v2->d))
+		return isl_int_lt(v1->n, v2->n);
 	if (isl_val_is_infty(v2))
 		return 1;
 	if (isl_val_is_infty(v1))
@@ -1216,6 +1292,9 @@ int isl_val_gt(__isl_keep isl_val *v1, __isl_keep isl_val *v2)
 }
 
 /* Is "v1" less than or equal to "v2"?
+ *
+ * See isl_val_lt for the special cases that are handled
+ * without any multiplications.
  */
 int isl_val_le(__isl_keep isl_val *v1, __isl_keep isl_val *v2)
 {
@@ -1228,8 +1307,10 @@ int isl_val_le(__isl_keep isl_val *v1, __isl_keep isl_val *v2)
 		return isl_int_le(v1->n, v2->n);
 	if (isl_val_is_nan(v1) || isl_val_is_nan(v2))
 		return 0;
-	if (isl_val_eq(v1, v2))
-		return 1;
+	if (isl_int_sgn(v1->n) != isl_int_sgn(v2->n))
+		return isl_int_sgn(v1->n) < isl_int_sgn(v2->n);
+	if (isl_int_eq(v1->d, v2->d))
+		return isl_int_le(v1->n, v2->n);
 	if (isl_val_is_infty(v2))
 		return 1;
 	if (isl_val_is_infty(v1))
@@ -1534,6 +1615,40 @@ int isl_val_check_match_domain_space(__isl_keep isl_val *v,
 #define NO_MOVE_DIMS
 #include <isl_multi_templ.c>
 
+/* Construct an isl_multi_val in "space" with as elements the first
+ * "n" integer values in "seq", padded with ones if "n" is smaller
+ * than the dimension of "space".
+ *
+ * The elements are constructed directly, rather than by first
+ * constructing a zero isl_multi_val and then replacing its elements
+ * one by one, each time checking the space of the new element.
+ */
+__isl_give isl_multi_val *isl_multi_val_from_isl_int_seq(
+	__isl_take isl_space *space, int n, isl_int *seq)
+{
+	int i;
+	isl_ctx *ctx;
+	isl_multi_val *mv;
+
+	mv = isl_multi_val_alloc(space);
+	if (!mv)
+		return NULL;
+
+	ctx = isl_multi_val_get_ctx(mv);
+	if (n > mv->n)
+		n = mv->n;
+	for (i = 0; i < mv->n; ++i) {
+		if (i < n)
+			mv->p[i] = isl_val_int_from_isl_int(ctx, seq[i]);
+		else
+			mv->p[i] = isl_val_one(ctx);
+		if (!mv->p[i])
+			return isl_multi_val_free(mv);
+	}
+
+	return mv;
+}
+
 /* Apply "fn" to each of the elements of "mv" with as second argument "v".
  */
 static __isl_give isl_multi_val *isl_multi_val_fn_val(
@@ -67,4 +67,7 @@ int isl_val_check_match_domain_space(__isl_keep isl_val *v,
 
 #include <isl_multi_templ.h>
 
+__isl_give isl_multi_val *isl_multi_val_from_isl_int_seq(
+	__isl_take isl_space *space, int n, isl_int *seq);
+
 #endif
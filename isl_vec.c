@@ -20,15 +20,100 @@ isl_ctx *isl_vec_get_ctx(__isl_keep isl_vec *vec)
 	return vec ? vec->ctx : NULL;
 }
 
+/* Return a fresh isl_vec structure, taken from the free list
+ * of "ctx" if possible.
+ * The inline elements of a newly allocated structure are initialized
+ * here, while those of a structure from the free list
+ * are still initialized.
+ *
+ * The free list is kept in the isl_ctx rather than per thread.
+ * Since an isl_ctx is only used by one thread at a time and
+ * since each worker thread of isl_thread_run computes in its own
+ * worker isl_ctx, the free list already is a per-thread pool.
+ * Moreover, a vector can only be freed in the isl_ctx
+ * in which it was allocated, and these worker threads only exist
+ * for the duration of a single isl_thread_run, such that
+ * a pool that is local to the thread would not live
+ * any longer than that of its worker isl_ctx.
+ */
+static struct isl_vec *vec_header_alloc(isl_ctx *ctx)
+{
+	int i;
+	struct isl_vec *vec;
+
+	if (ctx->n_free_vec == 0) {
+		ctx->stats->free_list_misses++;
+		vec = isl_alloc_type(ctx, struct isl_vec);
+		if (!vec)
+			return NULL;
+		for (i = 0; i < ISL_VEC_SMALL_SIZE; ++i)
+			isl_int_init(vec->small[i]);
+		return vec;
+	}
+	if (isl_ctx_next_operation(ctx) < 0)
+		return NULL;
+	ctx->stats->free_list_hits++;
+	return ctx->free_vec[--ctx->n_free_vec];
+}
+
+/* Free the isl_vec structure "vec", including its inline elements.
+ */
+static void vec_header_destroy(struct isl_vec *vec)
+{
+	int i;
+
+	for (i = 0; i < ISL_VEC_SMALL_SIZE; ++i)
+		isl_int_clear(vec->small[i]);
+	free(vec);
+}
+
+/* Release the isl_vec structure "vec", keeping it in the free list
+ * of "ctx" if there is room.
+ */
+static void vec_header_free(isl_ctx *ctx, struct isl_vec *vec)
+{
+	if (ctx->n_free_vec < ISL_FREE_LIST_SIZE)
+		ctx->free_vec[ctx->n_free_vec++] = vec;
+	else
+		vec_header_destroy(vec);
+}
+
+/* Free all isl_vec structures kept in the free list of "ctx".
+ */
+void isl_vec_clear_free_list(isl_ctx *ctx)
+{
+	while (ctx->n_free_vec > 0)
+		vec_header_destroy(ctx->free_vec[--ctx->n_free_vec]);
+}
+
+/* Is the block of "vec" the inline storage of "vec"?
+ */
+static int vec_is_small(struct isl_vec *vec)
+{
+	return vec->block.data == vec->small;
+}
+
+/* Release the block of "vec", unless it refers to the inline storage.
+ */
+static void vec_block_free(struct isl_vec *vec)
+{
+	if (!vec_is_small(vec))
+		isl_blk_free(vec->ctx, vec->block);
+}
+
 struct isl_vec *isl_vec_alloc(struct isl_ctx *ctx, unsigned size)
 {
 	struct isl_vec *vec;
 
-	vec = isl_alloc_type(ctx, struct isl_vec);
+	vec = vec_header_alloc(ctx);
 	if (!vec)
 		return NULL;
 
-	vec->block = isl_blk_alloc(ctx, size);
+	if (size <= ISL_VEC_SMALL_SIZE) {
+		vec->block.size = size;
+		vec->block.data = vec->small;
+	} else
+		vec->block = isl_blk_alloc(ctx, size);
 	if (isl_blk_is_error(vec->block))
 		goto error;
 
@@ -40,10 +125,31 @@ struct isl_vec *isl_vec_alloc(struct isl_ctx *ctx, unsigned size)
 
 	return vec;
 error:
-	isl_blk_free(ctx, vec->block);
+	vec_header_free(ctx, vec);
 	return NULL;
 }
 
+/* Move the elements of "vec" from its inline storage to a separately
+ * allocated block of "size" elements.
+ * The elements are swapped rather than copied such that the inline
+ * storage remains initialized.
+ */
+static __isl_give isl_vec *vec_extend_small(__isl_take isl_vec *vec,
+	unsigned size)
+{
+	int i;
+	struct isl_blk block;
+
+	block = isl_blk_alloc(vec->ctx, size);
+	if (isl_blk_is_error(block))
+		return isl_vec_free(vec);
+	for (i = 0; i < vec->size; ++i)
+		isl_int_swap(block.data[i], vec->small[i]);
+	vec->block = block;
+
+	return vec;
+}
+
 __isl_give isl_vec *isl_vec_extend(__isl_take isl_vec *vec, unsigned size)
 {
 	if (!vec)
@@ -55,7 +161,14 @@ __isl_give isl_vec *isl_vec_extend(__isl_take isl_vec *vec, unsigned size)
 	if (!vec)
 		return NULL;
 
-	vec->block = isl_blk_extend(vec->ctx, vec->block, size);
+	if (!vec_is_small(vec))
+		vec->block = isl_blk_extend(vec->ctx, vec->block, size);
+	else if (size <= ISL_VEC_SMALL_SIZE)
+		vec->block.size = size;
+	else
+		vec = vec_extend_small(vec, size);
+	if (!vec)
+		return NULL;
 	if (!vec->block.data)
 		goto error;
 
@@ -169,8 +282,8 @@ __isl_null isl_vec *isl_vec_free(__isl_take isl_vec *vec)
 		return NULL;
 
 	isl_ctx_deref(vec->ctx);
-	isl_blk_free(vec->ctx, vec->block);
-	free(vec);
+	vec_block_free(vec);
+	vec_header_free(vec->ctx, vec);
 
 	return NULL;
 }
@@ -4,6 +4,19 @@
 #include <isl_blk.h>
 #include <isl/vec.h>
 
+/* The number of elements that can be stored inside an isl_vec.
+ */
+#define ISL_VEC_SMALL_SIZE	16
+
+/* "el" points to the elements of the vector.
+ * For vectors of at most ISL_VEC_SMALL_SIZE elements, these are
+ * stored in "small" and "block" refers to "small".
+ * Otherwise, they are stored in a separately allocated "block".
+ * The elements of "small" are initialized when the isl_vec structure
+ * is first allocated and only cleared when the structure is finally
+ * released, so that a short vector taken from the free list
+ * does not require any memory allocation.
+ */
 struct isl_vec {
 	int ref;
 
@@ -13,8 +26,12 @@ struct isl_vec {
 	isl_int *el;
 
 	struct isl_blk block;
+	isl_int small[ISL_VEC_SMALL_SIZE];
 };
 
+void isl_vec_clear_free_list(isl_ctx *ctx);
+
+__isl_give isl_vec *isl_vec_dup(__isl_keep isl_vec *vec);
 __isl_give isl_vec *isl_vec_cow(__isl_take isl_vec *vec);
 
 void isl_vec_lcm(struct isl_vec *vec, isl_int *lcm);
@@ -7,6 +7,9 @@ const char *isl_version(void)
 #ifdef USE_GMP_FOR_MP
 	"-GMP"
 #endif
+#ifdef USE_SMALL_INT_OPT
+	"-32"
+#endif
 #ifdef USE_IMATH_FOR_MP
 	"-IMath"
 #endif
@@ -10,6 +10,7 @@
 
 #include <isl_map_private.h>
 #include <isl_aff_private.h>
+#include <isl_constraint_private.h>
 #include <isl/set.h>
 #include <isl_seq.h>
 #include <isl_tab.h>
@@ -666,6 +667,8 @@ error:
 struct isl_facet_todo {
 	struct isl_tab *tab;	/* A tableau representation of the facet */
 	isl_basic_set *bset;    /* A normalized basic set representation */
+	uint32_t hash;		/* The hash value of "bset" */
+	isl_vec *sample;	/* A (rational) point on the facet */
 	isl_vec *constraint;	/* Constraint pointing to the other side */
 	struct isl_facet_todo *next;
 };
@@ -677,6 +680,7 @@ static void free_todo(struct isl_facet_todo *todo)
 
 		isl_tab_free(todo->tab);
 		isl_basic_set_free(todo->bset);
+		isl_vec_free(todo->sample);
 		isl_vec_free(todo->constraint);
 		free(todo);
 
@@ -717,9 +721,13 @@ static struct isl_facet_todo *create_todo(struct isl_tab *tab, int con)
 	if (!todo->bset)
 		goto error;
 	ISL_F_SET(todo->bset, ISL_BASIC_SET_NORMALIZED);
+	todo->hash = isl_basic_set_get_hash(todo->bset);
 	todo->tab = isl_tab_dup(tab);
 	if (!todo->tab)
 		goto error;
+	todo->sample = isl_tab_get_sample_value(todo->tab);
+	if (!todo->sample)
+		goto error;
 
 	for (i = 0; i < n_frozen; ++i)
 		tab->con[i].frozen = 1;
@@ -769,12 +777,16 @@ static int init_todo(struct isl_facet_todo **next, struct isl_tab *tab)
 
 /* Does the linked list contain a todo item that is the opposite of "todo".
  * If so, return 1 and remove the opposite todo item.
+ * The hash values are compared first to avoid most of the comparisons
+ * of the basic sets.
  */
 static int has_opposite(struct isl_facet_todo *todo,
 	struct isl_facet_todo **list)
 {
 	for (; *list; list = &(*list)->next) {
 		int eq;
+		if (todo->hash != (*list)->hash)
+			continue;
 		eq = isl_basic_set_plain_is_equal(todo->bset, (*list)->bset);
 		if (eq < 0)
 			return -1;
@@ -854,8 +866,23 @@ static int update_todo(struct isl_facet_todo *first, struct isl_tab *tab)
  * While their are any todo items left, we pick a todo item and
  * create the required chamber by intersecting all activity domains
  * that contain the facet and have a full-dimensional intersection with
- * the other side of the facet.  For each of the interior facets, we
+ * the other side of the facet.  An activity domain can only contain
+ * the facet if it contains the sample point of the facet, which is
+ * much cheaper to check than the full containment in the facet tableau.
+ * For each of the interior facets, we
  * again create todo items, taking care to cancel opposite todo items.
+ *
+ * The todo items are not handled by worker threads.
+ * The todo list is a stack, so the items of the most recently
+ * constructed chamber are handled first, and any pending item that
+ * points into a newly constructed chamber gets cancelled.
+ * Selecting the vertices for several todo items ahead of time
+ * therefore mostly selects them for items that get cancelled later.
+ * Moreover, the selection cannot simply be handed back to this thread.
+ * Each selected activity domain has to be intersected with "tab"
+ * again, since the next chamber and its facets are derived
+ * from the resulting tableau, and this intersection
+ * is the most expensive part of the selection.
  */
 static __isl_give isl_vertices *compute_chambers(__isl_take isl_basic_set *bset,
 	__isl_take isl_vertices *vertices)
@@ -925,6 +952,12 @@ static __isl_give isl_vertices *compute_chambers(__isl_take isl_basic_set *bset,
 			goto error;
 
 		for (i = 0; i < vertices->n_vertices; ++i) {
+			selection[i] = isl_basic_set_contains(
+					vertices->v[i].dom, todo->sample);
+			if (selection[i] < 0)
+				goto error;
+			if (!selection[i])
+				continue;
 			selection[i] = bset_covers_tab(vertices->v[i].dom,
 							todo->tab);
 			if (selection[i] < 0)
@@ -977,6 +1010,197 @@ error:
 	return NULL;
 }
 
+/* Restrict the parametric vertex "vertex" of some polytope P
+ * to the part of its activity domain where it satisfies
+ * the inequality constraint "c" (of length 1 + nparam + nvar).
+ * Return NULL if "vertex" is not a vertex of P \cap { c >= 0 }
+ * that does not lie on the facet c = 0 of this polytope,
+ * i.e., if the restriction is empty or if "c" holds as an equality
+ * on the restriction.
+ * Return -1 (through *valid) on error.
+ */
+static __isl_give isl_basic_set *restrict_vertex(
+	__isl_keep isl_basic_set *vertex, isl_int *c, unsigned len, int *valid)
+{
+	isl_ctx *ctx;
+	struct isl_tab *tab;
+	isl_vec *ineq;
+	int keep;
+	unsigned total;
+
+	*valid = 1;
+	ctx = isl_basic_set_get_ctx(vertex);
+	total = isl_basic_set_total_dim(vertex);
+	ineq = isl_vec_alloc(ctx, 1 + total);
+	if (!ineq)
+		goto error;
+	isl_seq_cpy(ineq->el, c, len);
+	isl_seq_clr(ineq->el + len, 1 + total - len);
+
+	tab = isl_tab_from_basic_set(vertex, 0);
+	if (!tab)
+		goto error;
+	tab->strict_redundant = 1;
+	if (isl_tab_add_ineq(tab, ineq->el) < 0 ||
+	    isl_tab_detect_implicit_equalities(tab) < 0) {
+		isl_tab_free(tab);
+		goto error;
+	}
+	keep = !tab->empty && !isl_tab_is_equality(tab, tab->n_con - 1);
+	isl_tab_free(tab);
+
+	if (!keep) {
+		isl_vec_free(ineq);
+		return NULL;
+	}
+
+	vertex = isl_basic_set_copy(vertex);
+	vertex = isl_basic_set_add_ineq(vertex, ineq->el);
+	vertex = isl_basic_set_simplify(vertex);
+	vertex = isl_basic_set_finalize(vertex);
+	isl_vec_free(ineq);
+	if (!vertex)
+		*valid = -1;
+	return vertex;
+error:
+	isl_vec_free(ineq);
+	*valid = -1;
+	return NULL;
+}
+
+/* Update the parametric vertices and the chamber decomposition "vertices"
+ * of some parametric polytope P to those of the intersection of P
+ * with the constraint "constraint".
+ *
+ * If "constraint" is an inequality c >= 0, then the vertices of
+ * P \cap { c >= 0 } are the vertices of P where c > 0 along with
+ * the vertices of the face P \cap { c = 0 }.
+ * The first are obtained by restricting the activity domains of
+ * the vertices of P.  Vertices where c < 0 everywhere are dropped,
+ * as are vertices where c = 0 everywhere since they
+ * are also vertices of the face.
+ * The second are computed by isl_basic_set_compute_vertices,
+ * but on the lower-dimensional face rather than on the entire polytope.
+ * The chamber decomposition is then recomputed from the activity domains
+ * of the resulting vertices.
+ *
+ * If "constraint" is an equality, then the result is the set
+ * of vertices of the face, which is computed directly.
+ * The same holds if "constraint" only involves the parameters,
+ * since then there is no proper face to consider.
+ *
+ * This function only supports vertices that were computed
+ * by isl_basic_set_compute_vertices on a polytope without equalities
+ * (or by this function).
+ */
+__isl_give isl_vertices *isl_vertices_add_constraint(
+	__isl_take isl_vertices *vertices,
+	__isl_take isl_constraint *constraint)
+{
+	int i, n, equal, involves;
+	isl_ctx *ctx;
+	isl_space *space;
+	isl_basic_set *bset = NULL, *face;
+	isl_vertices *res = NULL, *face_vertices = NULL;
+	isl_aff *aff;
+	unsigned len;
+
+	if (!vertices || !constraint)
+		goto error;
+
+	ctx = isl_vertices_get_ctx(vertices);
+	space = isl_constraint_get_space(constraint);
+	equal = isl_space_is_equal(vertices->bset->dim, space);
+	isl_space_free(space);
+	if (equal < 0)
+		goto error;
+	if (!equal)
+		isl_die(ctx, isl_error_invalid,
+			"constraint does not live in the space of the vertices",
+			goto error);
+	if (isl_constraint_dim(constraint, isl_dim_div) != 0)
+		isl_die(ctx, isl_error_invalid,
+			"constraint cannot involve existentially quantified "
+			"variables", goto error);
+
+	bset = isl_basic_set_copy(vertices->bset);
+	bset = isl_basic_set_intersect(bset, isl_basic_set_from_constraint(
+					    isl_constraint_copy(constraint)));
+	bset = isl_basic_set_set_rational(bset);
+	if (isl_constraint_is_equality(constraint)) {
+		res = isl_basic_set_compute_vertices(bset);
+		goto done;
+	}
+	involves = isl_constraint_involves_dims(constraint, isl_dim_set, 0,
+					isl_basic_set_dim(vertices->bset, isl_dim_set));
+	if (involves < 0)
+		goto error;
+	if (!involves) {
+		res = isl_basic_set_compute_vertices(bset);
+		goto done;
+	}
+
+	aff = isl_constraint_get_aff(constraint);
+	face = isl_basic_set_copy(vertices->bset);
+	face = isl_basic_set_intersect(face, isl_basic_set_from_constraint(
+						isl_equality_from_aff(aff)));
+	face = isl_basic_set_set_rational(face);
+	face_vertices = isl_basic_set_compute_vertices(face);
+	isl_basic_set_free(face);
+	if (!bset || !face_vertices)
+		goto error;
+
+	res = isl_calloc_type(ctx, isl_vertices);
+	if (!res)
+		goto error;
+	res->ref = 1;
+	res->bset = isl_basic_set_copy(bset);
+	n = vertices->n_vertices + face_vertices->n_vertices;
+	res->v = isl_calloc_array(ctx, struct isl_vertex, n);
+	if (n && !res->v)
+		goto error;
+
+	len = constraint->v->size;
+	for (i = 0; i < vertices->n_vertices; ++i) {
+		isl_basic_set *vertex;
+		int valid;
+
+		vertex = restrict_vertex(vertices->v[i].vertex,
+					constraint->v->el, len, &valid);
+		if (valid < 0)
+			goto error;
+		if (!vertex)
+			continue;
+		res->v[res->n_vertices++].vertex = vertex;
+	}
+	for (i = 0; i < face_vertices->n_vertices; ++i)
+		res->v[res->n_vertices++].vertex =
+			isl_basic_set_copy(face_vertices->v[i].vertex);
+	for (i = 0; i < res->n_vertices; ++i) {
+		res->v[i].dom = isl_basic_set_copy(res->v[i].vertex);
+		res->v[i].dom = isl_basic_set_params(res->v[i].dom);
+		if (!res->v[i].vertex || !res->v[i].dom)
+			goto error;
+	}
+
+	if (res->n_vertices == 0) {
+		isl_vertices_free(res);
+		res = vertices_empty(bset);
+	} else
+		res = compute_chambers(isl_basic_set_copy(bset), res);
+
+done:
+	isl_vertices_free(face_vertices);
+	isl_basic_set_free(bset);
+	isl_constraint_free(constraint);
+	isl_vertices_free(vertices);
+	return res;
+error:
+	isl_vertices_free(res);
+	res = NULL;
+	goto done;
+}
+
 isl_ctx *isl_vertex_get_ctx(__isl_keep isl_vertex *vertex)
 {
 	return vertex ? isl_vertices_get_ctx(vertex->vertices) : NULL;
@@ -1122,6 +1346,90 @@ void isl_cell_free(__isl_take isl_cell *cell)
 	free(cell);
 }
 
+/* Return a copy of "vertices" that is allocated in "ctx".
+ * The activity domains of the vertices may have been dropped
+ * after computing the chambers (see compute_chambers).
+ */
+static __isl_give isl_vertices *vertices_import(isl_ctx *ctx,
+	__isl_keep isl_vertices *vertices)
+{
+	int i, j;
+	isl_vertices *dup;
+
+	if (!vertices)
+		return NULL;
+	if (isl_vertices_get_ctx(vertices) == ctx)
+		return isl_vertices_copy(vertices);
+
+	dup = isl_calloc_type(ctx, isl_vertices);
+	if (!dup)
+		return NULL;
+	dup->ref = 1;
+	dup->bset = isl_basic_set_import(ctx, vertices->bset);
+	dup->v = isl_calloc_array(ctx, struct isl_vertex,
+					vertices->n_vertices);
+	dup->c = isl_calloc_array(ctx, struct isl_chamber,
+					vertices->n_chambers);
+	if (!dup->bset || (vertices->n_vertices && !dup->v) ||
+	    (vertices->n_chambers && !dup->c))
+		goto error;
+
+	for (i = 0; i < vertices->n_vertices; ++i) {
+		dup->n_vertices++;
+		dup->v[i].vertex = isl_basic_set_import(ctx,
+						    vertices->v[i].vertex);
+		dup->v[i].dom = isl_basic_set_import(ctx, vertices->v[i].dom);
+		if (!dup->v[i].vertex || (vertices->v[i].dom && !dup->v[i].dom))
+			goto error;
+	}
+
+	for (i = 0; i < vertices->n_chambers; ++i) {
+		struct isl_chamber *c = &vertices->c[i];
+
+		dup->n_chambers++;
+		dup->c[i].n_vertices = c->n_vertices;
+		dup->c[i].vertices = isl_alloc_array(ctx, int, c->n_vertices);
+		dup->c[i].dom = isl_basic_set_import(ctx, c->dom);
+		if ((c->n_vertices && !dup->c[i].vertices) || !dup->c[i].dom)
+			goto error;
+		for (j = 0; j < c->n_vertices; ++j)
+			dup->c[i].vertices[j] = c->vertices[j];
+	}
+
+	return dup;
+error:
+	isl_vertices_free(dup);
+	return NULL;
+}
+
+/* Return a copy of "cell" that is allocated in "ctx",
+ * along with the vertices to which it refers.
+ */
+__isl_give isl_cell *isl_cell_import(isl_ctx *ctx, __isl_keep isl_cell *cell)
+{
+	int i;
+	isl_cell *dup;
+
+	if (!cell)
+		return NULL;
+
+	dup = isl_calloc_type(ctx, isl_cell);
+	if (!dup)
+		return NULL;
+	dup->n_vertices = cell->n_vertices;
+	dup->ids = isl_alloc_array(ctx, int, cell->n_vertices);
+	dup->vertices = vertices_import(ctx, cell->vertices);
+	dup->dom = isl_basic_set_import(ctx, cell->dom);
+	if ((cell->n_vertices && !dup->ids) || !dup->vertices || !dup->dom) {
+		isl_cell_free(dup);
+		return NULL;
+	}
+	for (i = 0; i < cell->n_vertices; ++i)
+		dup->ids[i] = cell->ids[i];
+
+	return dup;
+}
+
 /* Create a tableau of the cone obtained by first homogenizing the given
  * polytope and then making all inequalities strict by setting the
  * constant term to -1.
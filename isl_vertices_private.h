@@ -55,6 +55,7 @@ int isl_vertices_foreach_disjoint_cell(__isl_keep isl_vertices *vertices,
 	int (*fn)(__isl_take isl_cell *cell, void *user), void *user);
 int isl_cell_foreach_simplex(__isl_take isl_cell *cell,
 	int (*fn)(__isl_take isl_cell *simplex, void *user), void *user);
+__isl_give isl_cell *isl_cell_import(isl_ctx *ctx, __isl_keep isl_cell *cell);
 
 __isl_give isl_vertices *isl_morph_vertices(__isl_take struct isl_morph *morph,
 	__isl_take isl_vertices *vertices);
@@ -8,9 +8,12 @@
  */
 
 #include <assert.h>
+#include <ctype.h>
 #include <string.h>
 #include <strings.h>
+#include <isl_ctx_private.h>
 #include <isl_map_private.h>
+#include <isl_options_private.h>
 #include <isl/aff.h>
 #include <isl/set.h>
 #include "isl_tab.h"
@@ -22,6 +25,7 @@
 #include <isl_point_private.h>
 #include <isl_vec_private.h>
 #include <isl/options.h>
+#include <isl_thread.h>
 
 /* The input of this program is the same as that of the "example" program
  * from the PipLib distribution, except that the "big parameter column"
@@ -37,12 +41,30 @@
  *	Rational	compute rational optimum instead of integer optimum
  *	Urs_parms	don't assume parameters are non-negative
  *	Urs_unknowns	don't assume unknowns are non-negative
+ *
+ * If the --batch option is set, then the input may consist of
+ * several problems, each terminated by a line starting with "%%",
+ * which are solved in turn using the same isl_ctx.
+ * The output for each problem is also terminated by a "%%" line.
+ * If, moreover, the --threads option is set to a value "n"
+ * greater than one, then the problems are read in groups of 4 * "n"
+ * and the problems in each group are solved on "n" threads.
+ * The solutions are still printed in input order.
+ * This does not apply to the --verify and --bench options.
+ *
+ * If the --bench option is set to a positive value "n", then
+ * each problem is solved "n" times (after one warm-up run)
+ * in the same isl_ctx, for each of the "gbr" and "lexmin" strategies
+ * for handling the context tableau, and timing statistics
+ * are printed instead of the solution.
  */
 
 struct options {
 	struct isl_options	*isl;
 	unsigned		 verify;
 	unsigned		 format;
+	unsigned		 batch;
+	int			 bench;
 };
 
 #define FORMAT_SET	0
@@ -59,6 +81,10 @@ ISL_ARG_CHILD(struct options, isl, "isl", &isl_options_args, "isl options")
 ISL_ARG_BOOL(struct options, verify, 'T', "verify", 0, NULL)
 ISL_ARG_CHOICE(struct options, format, 0, "format",
 	pip_format, FORMAT_SET, "output format")
+ISL_ARG_BOOL(struct options, batch, 0, "batch", 0,
+	"read a sequence of problems separated by \"%%\" lines")
+ISL_ARG_INT(struct options, bench, 0, "bench", "n", 0,
+	"solve each problem n times and print timing statistics")
 ISL_ARGS_END
 
 ISL_ARG_DEF(options, struct options, options_args)
@@ -276,28 +302,161 @@ static void check_solution(isl_basic_set *bset, isl_basic_set *context,
 	isl_basic_set_free(bset);
 }
 
-int main(int argc, char **argv)
+/* Solve the problem of computing the lexicographic minimum
+ * (or maximum if "max" is set) of "bset" in terms of the parameters
+ * in "context", without printing the result.
+ * Return -1 on error.
+ */
+static int solve(__isl_keep isl_basic_set *bset,
+	__isl_keep isl_basic_set *context, int max)
 {
-	struct isl_ctx *ctx;
-	struct isl_basic_set *context, *bset, *copy, *context_copy;
-	struct isl_set *set = NULL;
-	struct isl_set *empty;
-	isl_pw_multi_aff *pma = NULL;
+	isl_set *set, *empty;
+
+	bset = isl_basic_set_copy(bset);
+	context = isl_basic_set_copy(context);
+	if (max)
+		set = isl_basic_set_partial_lexmax(bset, context, &empty);
+	else
+		set = isl_basic_set_partial_lexmin(bset, context, &empty);
+	isl_set_free(empty);
+	isl_set_free(set);
+
+	return set ? 0 : -1;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	const double *x = a, *y = b;
+
+	return *x < *y ? -1 : *x > *y ? 1 : 0;
+}
+
+/* Return the "p"th percentile of the "n" sorted values in "v".
+ */
+static double percentile(double *v, int n, int p)
+{
+	int i = (p * n + 99) / 100 - 1;
+
+	return v[i < 0 ? 0 : i];
+}
+
+/* Solve the problem defined by "bset", "context" and "max"
+ * "n" times using the context strategy "strategy" (with name "name")
+ * after a warm-up run and print the median and 90th and 99th percentile
+ * wall-clock time (in microseconds), along with the number of pivots,
+ * tableaus and memory blocks allocated in each run.
+ * The latter are taken from the statistics of "ctx" and
+ * are the same in each run.
+ */
+static int bench_strategy(isl_ctx *ctx, __isl_keep isl_basic_set *bset,
+	__isl_keep isl_basic_set *context, int max, int n,
+	int strategy, const char *name)
+{
+	int i;
+	int r = 0;
+	int saved = ctx->opt->context;
+	double *time;
+	long pivots, tabs, misses;
+
+	time = isl_alloc_array(ctx, double, n);
+	if (!time)
+		return -1;
+
+	ctx->opt->context = strategy;
+	r = solve(bset, context, max);
+	pivots = isl_ctx_get_stat(ctx, "pivots");
+	tabs = isl_ctx_get_stat(ctx, "tab_allocs");
+	misses = isl_ctx_get_stat(ctx, "blk_cache_misses");
+	for (i = 0; r >= 0 && i < n; ++i) {
+		double t = isl_monotonic_time();
+		r = solve(bset, context, max);
+		time[i] = 1e6 * (isl_monotonic_time() - t);
+	}
+	ctx->opt->context = saved;
+
+	if (r >= 0) {
+		qsort(time, n, sizeof(double), &cmp_double);
+		printf("%s\t%.0f\t%.0f\t%.0f\t%ld\t%ld\t%ld\n", name,
+			percentile(time, n, 50), percentile(time, n, 90),
+			percentile(time, n, 99),
+			(isl_ctx_get_stat(ctx, "pivots") - pivots) / n,
+			(isl_ctx_get_stat(ctx, "tab_allocs") - tabs) / n,
+			(isl_ctx_get_stat(ctx, "blk_cache_misses") -
+				misses) / n);
+	}
+
+	free(time);
+	return r;
+}
+
+/* Solve the problem defined by "bset", "context" and "max"
+ * options->bench times using each of the context strategies
+ * and print the timing statistics for each of them.
+ */
+static void bench(isl_ctx *ctx, struct options *options,
+	__isl_take isl_basic_set *bset, __isl_take isl_basic_set *context,
+	int max)
+{
+	int r;
+
+	printf("#context\tmedian\tp90\tp99\tpivots\ttabs\tallocs\n");
+	r = bench_strategy(ctx, bset, context, max, options->bench,
+				ISL_CONTEXT_GBR, "gbr");
+	if (r >= 0)
+		r = bench_strategy(ctx, bset, context, max, options->bench,
+				ISL_CONTEXT_LEXMIN, "lexmin");
+	assert(r >= 0);
+
+	isl_basic_set_free(bset);
+	isl_basic_set_free(context);
+}
+
+/* Skip white space in "file" and return 1 if there is any more input.
+ */
+static int more_input(FILE *file)
+{
+	int c;
+
+	do {
+		c = fgetc(file);
+	} while (c != EOF && isspace(c));
+	if (c == EOF)
+		return 0;
+	ungetc(c, file);
+	return 1;
+}
+
+/* A problem read by read_problem.
+ * "bset" is the set of which the lexicographic optimum
+ * needs to be computed in terms of the parameters in "context".
+ * "max" is set if the maximum needs to be computed instead
+ * of the minimum and "rational" is set if the rational optimum
+ * needs to be computed.
+ */
+struct pip_problem {
+	isl_basic_set *bset;
+	isl_basic_set *context;
+	int max;
+	int rational;
+};
+
+/* Read a single problem from stdin into "problem".
+ * The options following the problem extend up to the end of the input,
+ * or, in batch mode, up to the first line starting with "%%".
+ */
+static void read_problem(isl_ctx *ctx, struct options *options,
+	struct pip_problem *problem)
+{
+	struct isl_basic_set *context, *bset;
 	int neg_one;
 	char s[1024];
 	int urs_parms = 0;
 	int urs_unknowns = 0;
-	int max = 0;
-	int rational = 0;
 	int n;
 	int nparam;
-	struct options *options;
-
-	options = options_new_with_defaults();
-	assert(options);
-	argc = options_parse(options, argc, argv, ISL_ARG_ALL);
 
-	ctx = isl_ctx_alloc_with_options(&options_args, options);
+	problem->max = 0;
+	problem->rational = 0;
 
 	context = isl_basic_set_read_from_file(ctx, stdin);
 	assert(context);
@@ -307,10 +466,12 @@ int main(int argc, char **argv)
 	bset = isl_basic_set_read_from_file(ctx, stdin);
 
 	while (fgets(s, sizeof(s), stdin)) {
+		if (options->batch && strncmp(s, "%%", 2) == 0)
+			break;
 		if (strncasecmp(s, "Maximize", 8) == 0)
-			max = 1;
+			problem->max = 1;
 		if (strncasecmp(s, "Rational", 8) == 0) {
-			rational = 1;
+			problem->rational = 1;
 			bset = isl_basic_set_set_rational(bset);
 		}
 		if (strncasecmp(s, "Urs_parms", 9) == 0)
@@ -332,10 +493,22 @@ int main(int argc, char **argv)
 		bset = isl_basic_set_intersect(bset,
 		isl_basic_set_positive_orthant(isl_basic_set_get_space(bset)));
 
-	if (options->verify) {
-		copy = isl_basic_set_copy(bset);
-		context_copy = isl_basic_set_copy(context);
-	}
+	problem->bset = bset;
+	problem->context = context;
+}
+
+/* Compute the lexicographic minimum (or maximum if "max" is set)
+ * of "bset" in terms of the parameters in "context" and
+ * print it to "p" in the format specified by options->format,
+ * followed by the parameter values for which there is no solution.
+ */
+static __isl_give isl_printer *print_solution(__isl_take isl_printer *p,
+	struct options *options, __isl_take isl_basic_set *bset,
+	__isl_take isl_basic_set *context, int max)
+{
+	isl_set *set = NULL;
+	isl_set *empty;
+	isl_pw_multi_aff *pma = NULL;
 
 	if (options->format == FORMAT_AFF) {
 		if (max)
@@ -344,6 +517,7 @@ int main(int argc, char **argv)
 		else
 			pma = isl_basic_set_partial_lexmin_pw_multi_aff(bset,
 								context, &empty);
+		p = isl_printer_print_pw_multi_aff(p, pma);
 	} else {
 		if (max)
 			set = isl_basic_set_partial_lexmax(bset,
@@ -351,31 +525,171 @@ int main(int argc, char **argv)
 		else
 			set = isl_basic_set_partial_lexmin(bset,
 								context, &empty);
+		p = isl_printer_print_set(p, set);
 	}
+	p = isl_printer_end_line(p);
+	p = isl_printer_print_str(p, "no solution: ");
+	p = isl_printer_print_set(p, empty);
+	p = isl_printer_end_line(p);
 
-	if (options->verify) {
-		assert(!rational);
-		if (options->format == FORMAT_AFF)
-			set = isl_set_from_pw_multi_aff(pma);
-		check_solution(copy, context_copy, set, empty, max);
-		isl_set_free(set);
-	} else {
-		isl_printer *p;
+	isl_set_free(set);
+	isl_pw_multi_aff_free(pma);
+	isl_set_free(empty);
+
+	return p;
+}
+
+/* Read a single problem from stdin, solve it and print the result
+ * (or verify it if the --verify option is set or
+ * measure the time it takes if the --bench option is set).
+ */
+static void pip(isl_ctx *ctx, struct options *options)
+{
+	struct pip_problem problem;
+	struct isl_basic_set *context, *bset, *copy, *context_copy;
+	isl_set *set = NULL;
+	isl_set *empty;
+	isl_pw_multi_aff *pma = NULL;
+	isl_printer *p;
+
+	read_problem(ctx, options, &problem);
+
+	if (options->bench > 0) {
+		bench(ctx, options, problem.bset, problem.context, problem.max);
+		return;
+	}
+
+	if (!options->verify) {
 		p = isl_printer_to_file(ctx, stdout);
-		if (options->format == FORMAT_AFF)
-			p = isl_printer_print_pw_multi_aff(p, pma);
-		else
-			p = isl_printer_print_set(p, set);
-		p = isl_printer_end_line(p);
-		p = isl_printer_print_str(p, "no solution: ");
-		p = isl_printer_print_set(p, empty);
-		p = isl_printer_end_line(p);
+		p = print_solution(p, options, problem.bset, problem.context,
+				    problem.max);
 		isl_printer_free(p);
-		isl_set_free(set);
-		isl_pw_multi_aff_free(pma);
+		return;
 	}
 
+	bset = problem.bset;
+	context = problem.context;
+	copy = isl_basic_set_copy(bset);
+	context_copy = isl_basic_set_copy(context);
+
+	if (options->format == FORMAT_AFF) {
+		if (problem.max)
+			pma = isl_basic_set_partial_lexmax_pw_multi_aff(bset,
+								context, &empty);
+		else
+			pma = isl_basic_set_partial_lexmin_pw_multi_aff(bset,
+								context, &empty);
+		set = isl_set_from_pw_multi_aff(pma);
+	} else {
+		if (problem.max)
+			set = isl_basic_set_partial_lexmax(bset,
+								context, &empty);
+		else
+			set = isl_basic_set_partial_lexmin(bset,
+								context, &empty);
+	}
+
+	assert(!problem.rational);
+	check_solution(copy, context_copy, set, empty, problem.max);
+	isl_set_free(set);
 	isl_set_free(empty);
+}
+/* A group of "n" problems read by pip_batch_threads.
+ * out[i] is the printed solution of problem[i], computed
+ * in a worker isl_ctx.
+ */
+struct pip_batch {
+	struct options *options;
+	int n;
+	struct pip_problem *problem;
+	char **out;
+};
+
+/* Solve problem "i" of "user" in the isl_ctx of "worker" and
+ * keep track of the printed solution.
+ */
+static int solve_problem(struct isl_thread_worker *worker, int i, void *user)
+{
+	struct pip_batch *batch = user;
+	struct pip_problem *problem = &batch->problem[i];
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	isl_basic_set *bset, *context;
+	isl_printer *p;
+
+	isl_thread_worker_lock(worker);
+	bset = isl_basic_set_import(ctx, problem->bset);
+	context = isl_basic_set_import(ctx, problem->context);
+	isl_thread_worker_unlock(worker);
+
+	p = isl_printer_to_str(ctx);
+	p = print_solution(p, batch->options, bset, context, problem->max);
+	batch->out[i] = isl_printer_get_str(p);
+	isl_printer_free(p);
+
+	return batch->out[i] ? 0 : -1;
+}
+
+/* Read problems from stdin in groups of (at most) 4 * "n" problems,
+ * with "n" the value of the threads option, solve the problems
+ * in each group using "n" threads and
+ * print the solutions in input order, each terminated by a "%%" line.
+ * The problems are read in "ctx" and solved
+ * in worker isl_ctx objects (see isl_thread_run).
+ * Stop after the first group on which solving fails.
+ */
+static void pip_batch_threads(isl_ctx *ctx, struct options *options)
+{
+	int i, r;
+	int size = 4 * options->isl->threads;
+	struct pip_batch batch = { options };
+
+	batch.problem = isl_calloc_array(ctx, struct pip_problem, size);
+	batch.out = isl_calloc_array(ctx, char *, size);
+	assert(batch.problem && batch.out);
+
+	do {
+		for (batch.n = 0; batch.n < size && more_input(stdin);
+		     ++batch.n)
+			read_problem(ctx, options, &batch.problem[batch.n]);
+		r = isl_thread_run(ctx, batch.n, &solve_problem, &batch);
+		for (i = 0; i < batch.n; ++i) {
+			if (batch.out[i])
+				printf("%s%%%%\n", batch.out[i]);
+			free(batch.out[i]);
+			batch.out[i] = NULL;
+			isl_basic_set_free(batch.problem[i].bset);
+			isl_basic_set_free(batch.problem[i].context);
+		}
+		fflush(stdout);
+	} while (r >= 0 && batch.n == size);
+
+	free(batch.problem);
+	free(batch.out);
+}
+
+int main(int argc, char **argv)
+{
+	struct isl_ctx *ctx;
+	struct options *options;
+
+	options = options_new_with_defaults();
+	assert(options);
+	argc = options_parse(options, argc, argv, ISL_ARG_ALL);
+
+	ctx = isl_ctx_alloc_with_options(&options_args, options);
+
+	if (!options->batch)
+		pip(ctx, options);
+	else if (options->isl->threads > 1 && !options->verify &&
+		 options->bench <= 0)
+		pip_batch_threads(ctx, options);
+	else
+		while (more_input(stdin)) {
+			pip(ctx, options);
+			printf("%%%%\n");
+			fflush(stdout);
+		}
+
 	isl_ctx_free(ctx);
 
 	return 0;
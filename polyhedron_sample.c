@@ -7,30 +7,212 @@
  * Computerwetenschappen, Celestijnenlaan 200A, B-3001 Leuven, Belgium
  */
 
+/* This program prints a sample point of each basic set read from stdin.
+ *
+ * If the isl --threads option is set to a value greater than one,
+ * then the basic sets are distributed over that many worker threads,
+ * each with its own isl_ctx (see isl_thread_run).
+ * The results are printed in input order.
+ * If the --time option is set, then the distribution of the time
+ * taken for each basic set is printed to stderr.
+ */
+
 #include <assert.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <isl_ctx_private.h>
 #include <isl_map_private.h>
 #include "isl_sample.h"
+#include <isl/options.h>
 #include <isl/vec.h>
+#include <isl_thread.h>
+#include "tool_latency.h"
 
-int main(int argc, char **argv)
+struct options {
+	struct isl_options	*isl;
+	unsigned		 time;
+};
+
+ISL_ARGS_START(struct options, options_args)
+ISL_ARG_CHILD(struct options, isl, "isl", &isl_options_args, "isl options")
+ISL_ARG_BOOL(struct options, time, 0, "time", 0,
+	"print per-object latency percentiles to stderr")
+ISL_ARGS_END
+
+ISL_ARG_DEF(options, struct options, options_args)
+
+/* Skip white space in "file" and return 1 if there is any more input.
+ */
+static int more_input(FILE *file)
 {
-	struct isl_ctx *ctx = isl_ctx_alloc();
-	struct isl_basic_set *bset;
-	struct isl_vec *sample;
-	isl_printer *p;
+	int c;
+
+	do {
+		c = fgetc(file);
+	} while (c != EOF && isspace(c));
+	if (c == EOF)
+		return 0;
+	ungetc(c, file);
+	return 1;
+}
+
+/* Compute a sample point of "bset", check that it belongs to "bset"
+ * and print it to "p".
+ */
+static __isl_give isl_printer *sample(__isl_take isl_printer *p,
+	__isl_take isl_basic_set *bset)
+{
+	isl_vec *sample;
 
-	bset = isl_basic_set_read_from_file(ctx, stdin);
 	sample = isl_basic_set_sample_vec(isl_basic_set_copy(bset));
-	p = isl_printer_to_file(ctx, stdout);
 	p = isl_printer_print_vec(p, sample);
 	p = isl_printer_end_line(p);
-	isl_printer_free(p);
 	assert(sample);
 	if (isl_vec_size(sample) > 0)
 		assert(isl_basic_set_contains(bset, sample));
 	isl_basic_set_free(bset);
 	isl_vec_free(sample);
-	isl_ctx_free(ctx);
+
+	return p;
+}
+
+/* The basic sets read by read_jobs.
+ * out[i] is the printed sample point of bset[i], computed
+ * in a worker isl_ctx, and time[i] is the time this took.
+ */
+struct sample_jobs {
+	int n;
+	int size;
+	isl_basic_set **bset;
+	char **out;
+	double *time;
+};
+
+/* Compute a sample point of basic set "i" of "user" in the isl_ctx
+ * of "worker" and keep track of the printed result.
+ */
+static int sample_job(struct isl_thread_worker *worker, int i, void *user)
+{
+	struct sample_jobs *jobs = user;
+	isl_ctx *ctx = isl_thread_worker_get_ctx(worker);
+	isl_basic_set *bset;
+	isl_printer *p;
+	double start;
+
+	isl_thread_worker_lock(worker);
+	bset = isl_basic_set_import(ctx, jobs->bset[i]);
+	isl_thread_worker_unlock(worker);
+
+	start = isl_monotonic_time();
+	p = isl_printer_to_str(ctx);
+	p = sample(p, bset);
+	jobs->out[i] = isl_printer_get_str(p);
+	isl_printer_free(p);
+	jobs->time[i] = isl_monotonic_time() - start;
+
+	return jobs->out[i] ? 0 : -1;
+}
+
+/* Read all basic sets from stdin into "jobs".
+ */
+static int read_jobs(isl_ctx *ctx, struct sample_jobs *jobs)
+{
+	while (more_input(stdin)) {
+		isl_basic_set *bset;
+
+		bset = isl_basic_set_read_from_file(ctx, stdin);
+		if (!bset)
+			return -1;
+		if (jobs->n >= jobs->size) {
+			jobs->size = 2 * jobs->size + 16;
+			jobs->bset = isl_realloc_array(ctx, jobs->bset,
+					isl_basic_set *, jobs->size);
+			assert(jobs->bset);
+		}
+		jobs->bset[jobs->n++] = bset;
+	}
+	jobs->out = isl_calloc_array(ctx, char *, jobs->n);
+	jobs->time = isl_calloc_array(ctx, double, jobs->n);
+	assert(jobs->n == 0 || (jobs->out && jobs->time));
 
 	return 0;
 }
+
+/* Read all basic sets from stdin and compute a sample point
+ * of each of them using several threads (see isl_thread_run),
+ * printing the results in input order.
+ * Return the number of basic sets and store the time taken
+ * for each of them in "time".
+ * Set "*r" to -1 if any of this fails.
+ */
+static int sample_threads(isl_ctx *ctx, double **time, int *r)
+{
+	int i;
+	struct sample_jobs jobs = { 0 };
+
+	*r = read_jobs(ctx, &jobs);
+	if (*r >= 0)
+		*r = isl_thread_run(ctx, jobs.n, &sample_job, &jobs);
+	for (i = 0; i < jobs.n; ++i) {
+		if (jobs.out[i])
+			fputs(jobs.out[i], stdout);
+		free(jobs.out[i]);
+		isl_basic_set_free(jobs.bset[i]);
+	}
+	free(jobs.bset);
+	free(jobs.out);
+	*time = jobs.time;
+
+	return jobs.n;
+}
+
+int main(int argc, char **argv)
+{
+	struct isl_ctx *ctx;
+	struct options *options;
+	double *time;
+	int n_time, r = 0;
+
+	options = options_new_with_defaults();
+	assert(options);
+	argc = options_parse(options, argc, argv, ISL_ARG_ALL);
+
+	ctx = isl_ctx_alloc_with_options(&options_args, options);
+
+	if (isl_options_get_threads(ctx) > 1)
+		n_time = sample_threads(ctx, &time, &r);
+	else {
+		isl_printer *p = isl_printer_to_file(ctx, stdout);
+		int size = 0;
+
+		time = NULL;
+		n_time = 0;
+		while (more_input(stdin)) {
+			isl_basic_set *bset;
+			double start;
+
+			bset = isl_basic_set_read_from_file(ctx, stdin);
+			if (!bset) {
+				r = -1;
+				break;
+			}
+			if (n_time >= size) {
+				size = 2 * size + 16;
+				time = realloc(time, size * sizeof(double));
+				assert(time);
+			}
+			start = isl_monotonic_time();
+			p = sample(p, bset);
+			time[n_time++] = isl_monotonic_time() - start;
+		}
+		isl_printer_free(p);
+	}
+
+	if (options->time)
+		tool_print_latency(stderr, n_time, time);
+
+	free(time);
+	isl_ctx_free(ctx);
+
+	return r < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,41 @@
+/*
+ * Use of this software is governed by the MIT license
+ */
+
+#include <stdlib.h>
+#include "tool_latency.h"
+
+static int cmp_double(const void *a, const void *b)
+{
+	const double *d1 = a;
+	const double *d2 = b;
+
+	return *d1 < *d2 ? -1 : *d1 > *d2 ? 1 : 0;
+}
+
+/* Return the "p"-th percentile of the "n" sorted values in "time",
+ * using the nearest-rank method.
+ */
+static double percentile(int n, double *time, int p)
+{
+	int rank = (p * n + 99) / 100;
+
+	return time[rank > 0 ? rank - 1 : 0];
+}
+
+/* Print the number of objects and the 50th, 90th and 99th percentiles
+ * and the maximum of the "n" per-object processing times
+ * in "time" (in seconds) to "out", in milliseconds.
+ * The elements of "time" are sorted in the process.
+ */
+void tool_print_latency(FILE *out, int n, double *time)
+{
+	if (n == 0)
+		return;
+
+	qsort(time, n, sizeof(double), &cmp_double);
+	fprintf(out, "objects: %d, latency (ms): p50 %.3f, p90 %.3f, "
+		"p99 %.3f, max %.3f\n", n,
+		1e3 * percentile(n, time, 50), 1e3 * percentile(n, time, 90),
+		1e3 * percentile(n, time, 99), 1e3 * time[n - 1]);
+}
@@ -0,0 +1,8 @@
+#ifndef ISL_TOOL_LATENCY_H
+#define ISL_TOOL_LATENCY_H
+
+#include <stdio.h>
+
+void tool_print_latency(FILE *out, int n, double *time);
+
+#endif